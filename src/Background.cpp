@@ -29,7 +29,9 @@
 #include "utils.h"
 
 #include <SDL_stdinc.h>
+#include <algorithm>
 #include <iostream>
+#include <list>
 #include <sstream>
 #include <numeric>
 
@@ -439,6 +441,87 @@ namespace Background {
 		return spherical_segment_volume(h, r1_sq, r2_sq);
 	}
 
+	// Stars picked from the galaxy around recently visited systems. Picking
+	// samples every sector within a few hundred light years, so re-entering
+	// a system (or loading a save there) reuses the result instead. Entries
+	// remember the settings they were picked with.
+	struct PickedStars {
+		SystemPath systemPath;
+		std::string generatorName;
+		int generatorVersion;
+		Uint32 numStars;
+		float brightnessFactor;
+		Color colorMin;
+		Color colorMax;
+		StarInfo stars;
+	};
+
+	// each entry is up to BG_STAR_MAX stars (~10MB), so keep only a few
+	static constexpr size_t PICKED_STARS_CACHE_SIZE = 3;
+	static std::list<PickedStars> s_pickedStarsCache; // most recently used first
+
+	static void PickStarsFromGalaxy(RefCountedPtr<Galaxy> galaxy, const StarQueryInfo &info, const Uint32 NUM_BG_STARS, StarInfo &stars)
+	{
+		PROFILE_SCOPED()
+		TaskGraph *graph = Pi::GetApp()->GetTaskGraph();
+
+		// We want the main thread to participate in this work as well,
+		// but don't split the number of stars too much that we have visible brightness "patches"
+		// also we want a piece of at least size 1
+		const uint32_t numTasks = std::min({ graph->GetNumWorkerThreads() + 1, 8U, uint32_t(info.sectorMax - info.sectorMin) });
+
+		TaskSet *sampleStarsTaskSet = new TaskSet();
+
+		int32_t starsLeft = NUM_BG_STARS;
+		const double realRadius = info.sectorMax;
+		const double realDensity = NUM_BG_STARS / (M_PI / 0.75 * realRadius * realRadius * realRadius);
+
+		std::vector<StarInfo> taskStars(numTasks);
+		std::vector<double> taskMedians(numTasks);
+
+		// Split the visible area of the galaxy up into separate tasks
+		uint32_t current = 0;
+		// divide the ball more evenly into tasks, when the number of tasks
+		// is comparable to the diameter of the ball (in sectors)
+		float range_step = (info.sectorMax - info.sectorMin) / (float)numTasks;
+
+		for (size_t i = 0; i < numTasks; i++) {
+			int32_t starsLimit;
+			uint32_t end = std::max(uint32_t(range_step * (i + 1)), current + 1);
+			if (i + 1 == numTasks) {
+				end = (info.sectorMax - info.sectorMin);
+				starsLimit = starsLeft;
+			} else {
+				starsLimit = realDensity * task_spherical_segment_volume(current, end, realRadius);
+				starsLeft -= starsLimit;
+			}
+
+			// in the task the loop runs from current to end inclusive
+			sampleStarsTaskSet->AddTask(new SampleStarsTask(galaxy, info, starsLimit, taskStars[i], taskMedians[i], { current, end - 1 }));
+			current = end;
+		}
+
+		// We can't make progress until all stars are gathered, so run the
+		// star collection on the 'main' thread as well.
+		auto sampleHandle = graph->QueueTaskSet(sampleStarsTaskSet);
+		graph->WaitForTaskSet(sampleHandle);
+
+		double medianBrightness = std::reduce(taskMedians.begin(), taskMedians.end()) / taskMedians.size();
+
+		TaskSet *sortStarsTaskSet = new TaskSet();
+		for (size_t i = 0; i < numTasks; i++) {
+			sortStarsTaskSet->AddTask(new SortStarsTask(info, taskStars[i], medianBrightness));
+		}
+		auto sortHandle = graph->QueueTaskSet(sortStarsTaskSet);
+		graph->WaitForTaskSet(sortHandle);
+
+		for (auto &item : taskStars) {
+			stars.pos.insert(stars.pos.end(), item.pos.begin(), item.pos.end());
+			stars.color.insert(stars.color.end(), item.color.begin(), item.color.end());
+			stars.brightness.insert(stars.brightness.end(), item.brightness.begin(), item.brightness.end());
+		}
+	}
+
 	void Starfield::Fill(Random &rand, const SystemPath *const systemPath, RefCountedPtr<Galaxy> galaxy)
 	{
 		PROFILE_SCOPED()
@@ -475,8 +558,6 @@ namespace Background {
 		if (systemPath && galaxy.Valid()) {
 			PROFILE_SCOPED_DESC("Pick Stars from Galaxy")
 
-			TaskGraph *graph = Pi::GetApp()->GetTaskGraph();
-
 			// judging by the current sector generator, maximum average number
 			// of stars in a sector is 6
 			// It’s easy to express what the radius of a ball should be so that
@@ -494,61 +575,30 @@ namespace Background {
 			info.colorMax = Color((Uint8)(m_rMax * 255), (Uint8)(m_gMax * 255), (Uint8)(m_rMax * 255));
 			info.brightnessFactor = brightnessApparentSizeFactor;
 
-			// We want the main thread to participate in this work as well,
-			// but don't split the number of stars too much that we have visible brightness "patches"
-			// also we want a piece of at least size 1
-			const uint32_t numTasks = std::min({ graph->GetNumWorkerThreads() + 1, 8U, uint32_t(info.sectorMax - info.sectorMin) });
-
-			TaskSet *sampleStarsTaskSet = new TaskSet();
-
-			int32_t starsLeft = NUM_BG_STARS;
-			const double realRadius = info.sectorMax;
-			const double realDensity = NUM_BG_STARS / (M_PI / 0.75 * realRadius * realRadius * realRadius);
-
-			std::vector<StarInfo> taskStars(numTasks);
-			std::vector<double> taskMedians(numTasks);
-
-			// Split the visible area of the galaxy up into separate tasks
-			uint32_t current = 0;
-			// divide the ball more evenly into tasks, when the number of tasks
-			// is comparable to the diameter of the ball (in sectors)
-			float range_step = (info.sectorMax - info.sectorMin) / (float)numTasks;
-
-			for (size_t i = 0; i < numTasks; i++) {
-				int32_t starsLimit;
-				uint32_t end = std::max(uint32_t(range_step * (i + 1)), current + 1);
-				if (i + 1 == numTasks) {
-					end = (info.sectorMax - info.sectorMin);
-					starsLimit = starsLeft;
-				} else {
-					starsLimit = realDensity * task_spherical_segment_volume(current, end, realRadius);
-					starsLeft -= starsLimit;
-				}
-
-				// in the task the loop runs from current to end inclusive
-				sampleStarsTaskSet->AddTask(new SampleStarsTask(galaxy, info, starsLimit, taskStars[i], taskMedians[i], { current, end - 1 }));
-				current = end;
-			}
-
-			// We can't make progress until all stars are gathered, so run the
-			// star collection on the 'main' thread as well.
-			auto sampleHandle = graph->QueueTaskSet(sampleStarsTaskSet);
-			graph->WaitForTaskSet(sampleHandle);
-
-			double medianBrightness = std::reduce(taskMedians.begin(), taskMedians.end()) / taskMedians.size();
+			const std::string &generatorName = galaxy->GetGeneratorName();
+			const int generatorVersion = galaxy->GetGeneratorVersion();
+			auto cached = std::find_if(s_pickedStarsCache.begin(), s_pickedStarsCache.end(), [&](const PickedStars &p) {
+				return p.systemPath.IsSameSystem(*systemPath) &&
+					p.generatorName == generatorName && p.generatorVersion == generatorVersion &&
+					p.numStars == NUM_BG_STARS && p.brightnessFactor == info.brightnessFactor &&
+					p.colorMin == info.colorMin && p.colorMax == info.colorMax;
+			});
 
-			TaskSet *sortStarsTaskSet = new TaskSet();
-			for (size_t i = 0; i < numTasks; i++) {
-				sortStarsTaskSet->AddTask(new SortStarsTask(info, taskStars[i], medianBrightness));
+			if (cached != s_pickedStarsCache.end()) {
+				// most recently used goes to the front
+				s_pickedStarsCache.splice(s_pickedStarsCache.begin(), s_pickedStarsCache, cached);
+			} else {
+				if (s_pickedStarsCache.size() >= PICKED_STARS_CACHE_SIZE)
+					s_pickedStarsCache.pop_back();
+				s_pickedStarsCache.push_front({ systemPath->SystemOnly(), generatorName, generatorVersion,
+					NUM_BG_STARS, info.brightnessFactor, info.colorMin, info.colorMax, StarInfo() });
+				PickStarsFromGalaxy(galaxy, info, NUM_BG_STARS, s_pickedStarsCache.front().stars);
 			}
-			auto sortHandle = graph->QueueTaskSet(sortStarsTaskSet);
-			graph->WaitForTaskSet(sortHandle);
 
-			for(auto &item : taskStars) {
-				stars.pos.insert(stars.pos.end(), item.pos.begin(), item.pos.end());
-				stars.color.insert(stars.color.end(), item.color.begin(), item.color.end());
-				stars.brightness.insert(stars.brightness.end(), item.brightness.begin(), item.brightness.end());
-			}
+			const StarInfo &picked = s_pickedStarsCache.front().stars;
+			stars.pos.insert(stars.pos.end(), picked.pos.begin(), picked.pos.end());
+			stars.color.insert(stars.color.end(), picked.color.begin(), picked.color.end());
+			stars.brightness.insert(stars.brightness.end(), picked.brightness.begin(), picked.brightness.end());
 		}
 		num = stars.pos.size();
 		Output("Stars picked from galaxy: %d\n", stars.pos.size());
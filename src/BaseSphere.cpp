@@ -35,7 +35,8 @@ static_assert(sizeof(BaseSphereDataBlock) == 192, "");
 
 BaseSphere::BaseSphere(const SystemBody *body) :
 	m_sbody(body),
-	m_terrain(Terrain::InstanceTerrain(body)) {}
+	m_terrain(Terrain::InstanceTerrain(body)),
+	m_atmosParams(body->CalcAtmosphereParams()) {}
 
 BaseSphere::~BaseSphere() {}
 
@@ -10,6 +10,8 @@
 #include "terrain/Terrain.h"
 #include "vector3.h"
 
+#include <algorithm>
+
 namespace Graphics {
 	class Renderer;
 	class RenderState;
@@ -27,6 +29,8 @@ public:
 	virtual void Render(Graphics::Renderer *renderer, const matrix4x4d &modelView, vector3d campos, const float radius, const std::vector<Camera::Shadow> &shadows) = 0;
 
 	virtual double GetHeight(const vector3d &p) const { return 0.0; }
+	// GetHeight for count points at once
+	virtual void GetHeights(const vector3d *p, double *heights, size_t count) const { std::fill_n(heights, count, 0.0); }
 
 	static void Init();
 	static void Uninit();
@@ -44,6 +48,7 @@ public:
 
 	const SystemBody *GetSystemBody() const { return m_sbody; }
 	Terrain *GetTerrain() const { return m_terrain.Get(); }
+	const AtmosphereParameters &GetAtmosphereParams() const { return m_atmosParams; }
 
 	RefCountedPtr<Graphics::Material> GetSurfaceMaterial() const { return m_surfaceMaterial; }
 
@@ -53,6 +58,10 @@ protected:
 	// all variables for GetHeight(), GetColor()
 	RefCountedPtr<Terrain> m_terrain;
 
+	// the body's parameters don't change, so the scattering coefficients
+	// are integrated once rather than every frame
+	const AtmosphereParameters m_atmosParams;
+
 	virtual void SetUpMaterials() = 0;
 
 	RefCountedPtr<Graphics::Material> m_surfaceMaterial;
@@ -8,6 +8,7 @@
 
 #include "Body.h"
 #include "Color.h"
+#include "core/PoolAllocator.h"
 #include "matrix4x4.h"
 #include "vector3.h"
 
@@ -22,7 +23,8 @@ namespace Graphics {
 
 struct ProjectileData;
 
-class Beam : public Body {
+// pooled for the same reason as Projectile
+class Beam : public Body, public PoolAllocated {
 public:
 	OBJDEF(Beam, Body, PROJECTILE);
 
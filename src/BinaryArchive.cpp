@@ -0,0 +1,210 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "BinaryArchive.h"
+
+#include "GameSaveError.h"
+#include "Json.h"
+#include "base64/base64.hpp"
+
+#include <cstring>
+
+#if (__GNUC__ && (__BYTE_ORDER_ == __ORDER_BIG_ENDIAN__)) || (__clang__ && __BIG_ENDIAN__)
+#error BinaryArchive.cpp is incompatible with big-endian architectures!
+#endif
+
+namespace {
+	enum ValueTag : Uint8 {
+		TAG_SCHEMA = 0xa5,
+		TAG_BOOL = 1,
+		TAG_INT32,
+		TAG_UINT32,
+		TAG_FLOAT,
+		TAG_DOUBLE,
+		TAG_STRING,
+		TAG_VECTOR3D,
+		TAG_MATRIX3X3D,
+	};
+} // namespace
+
+BinaryArchiveWriter::BinaryArchiveWriter(std::string_view schema, Uint32 version)
+{
+	Tag(TAG_SCHEMA);
+	String(schema);
+	UInt32(version);
+}
+
+void BinaryArchiveWriter::Tag(Uint8 tag)
+{
+	m_data.push_back(char(tag));
+}
+
+template <typename T>
+void BinaryArchiveWriter::Raw(const T &value)
+{
+	m_data.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void BinaryArchiveWriter::Bool(bool value)
+{
+	Tag(TAG_BOOL);
+	Raw(Uint8(value));
+}
+
+void BinaryArchiveWriter::Int32(Sint32 value)
+{
+	Tag(TAG_INT32);
+	Raw(value);
+}
+
+void BinaryArchiveWriter::UInt32(Uint32 value)
+{
+	Tag(TAG_UINT32);
+	Raw(value);
+}
+
+void BinaryArchiveWriter::Float(float value)
+{
+	Tag(TAG_FLOAT);
+	Raw(value);
+}
+
+void BinaryArchiveWriter::Double(double value)
+{
+	Tag(TAG_DOUBLE);
+	Raw(value);
+}
+
+void BinaryArchiveWriter::String(std::string_view value)
+{
+	Tag(TAG_STRING);
+	Raw(Uint32(value.size()));
+	m_data.append(value.data(), value.size());
+}
+
+void BinaryArchiveWriter::Vector3d(const vector3d &value)
+{
+	Tag(TAG_VECTOR3D);
+	Raw(value.x);
+	Raw(value.y);
+	Raw(value.z);
+}
+
+void BinaryArchiveWriter::Matrix3x3d(const matrix3x3d &value)
+{
+	Tag(TAG_MATRIX3X3D);
+	for (size_t i = 0; i < 9; i++)
+		Raw(value[i]);
+}
+
+void BinaryArchiveWriter::ToJson(Json &jsonObj) const
+{
+	// base64 keeps the Json valid UTF-8; the savegame as a whole is
+	// compressed, so the archive isn't deflated by itself
+	std::string encoded;
+	Base64::Encode(m_data, &encoded);
+	jsonObj = std::move(encoded);
+}
+
+BinaryArchiveReader::BinaryArchiveReader(std::string_view data, std::string_view schema, Uint32 maxVersion) :
+	m_data(data),
+	m_at(0),
+	m_version(0)
+{
+	Open(schema, maxVersion);
+}
+
+std::string BinaryArchiveReader::FromJson(const Json &jsonObj)
+{
+	std::string data;
+	if (!jsonObj.is_string() || !Base64::Decode(jsonObj.get_ref<const std::string &>(), &data))
+		throw SavedGameCorruptException();
+	return data;
+}
+
+void BinaryArchiveReader::Open(std::string_view schema, Uint32 maxVersion)
+{
+	Expect(TAG_SCHEMA);
+	if (String() != schema)
+		throw SavedGameCorruptException();
+	m_version = UInt32();
+	if (m_version > maxVersion)
+		throw SavedGameCorruptException();
+}
+
+template <typename T>
+T BinaryArchiveReader::Raw()
+{
+	if (m_data.size() - m_at < sizeof(T))
+		throw SavedGameCorruptException();
+	T value;
+	std::memcpy(&value, m_data.data() + m_at, sizeof(T)); // unaligned
+	m_at += sizeof(T);
+	return value;
+}
+
+void BinaryArchiveReader::Expect(Uint8 tag)
+{
+	if (Raw<Uint8>() != tag)
+		throw SavedGameCorruptException();
+}
+
+bool BinaryArchiveReader::Bool()
+{
+	Expect(TAG_BOOL);
+	return Raw<Uint8>() != 0;
+}
+
+Sint32 BinaryArchiveReader::Int32()
+{
+	Expect(TAG_INT32);
+	return Raw<Sint32>();
+}
+
+Uint32 BinaryArchiveReader::UInt32()
+{
+	Expect(TAG_UINT32);
+	return Raw<Uint32>();
+}
+
+float BinaryArchiveReader::Float()
+{
+	Expect(TAG_FLOAT);
+	return Raw<float>();
+}
+
+double BinaryArchiveReader::Double()
+{
+	Expect(TAG_DOUBLE);
+	return Raw<double>();
+}
+
+std::string BinaryArchiveReader::String()
+{
+	Expect(TAG_STRING);
+	const Uint32 length = Raw<Uint32>();
+	if (m_data.size() - m_at < length)
+		throw SavedGameCorruptException();
+	std::string value(m_data.substr(m_at, length));
+	m_at += length;
+	return value;
+}
+
+vector3d BinaryArchiveReader::Vector3d()
+{
+	Expect(TAG_VECTOR3D);
+	vector3d value;
+	value.x = Raw<double>();
+	value.y = Raw<double>();
+	value.z = Raw<double>();
+	return value;
+}
+
+matrix3x3d BinaryArchiveReader::Matrix3x3d()
+{
+	Expect(TAG_MATRIX3X3D);
+	matrix3x3d value;
+	for (size_t i = 0; i < 9; i++)
+		value[i] = Raw<double>();
+	return value;
+}
@@ -0,0 +1,82 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _BINARYARCHIVE_H
+#define _BINARYARCHIVE_H
+
+#include "JsonFwd.h"
+#include "matrix3x3.h"
+#include "vector3.h"
+
+#include <string>
+#include <string_view>
+
+// A compact binary encoding for saved state made of a great many small
+// fields, such as the frame tree and its effects, where building a Json
+// node for each field is most of the cost of saving and loading.
+//
+// An archive opens with the name and version of its schema, and every value
+// in it carries a one byte type tag. A reader states the schema it expects
+// and the newest version it understands, and anything else - a different
+// schema, a newer version, a value of the wrong type or data that ends
+// early - throws SavedGameCorruptException.
+//
+// Values are little-endian and floating point is IEEE-754, as for the
+// model cache (see scenegraph/Serializer.h). The archive is stored in the
+// savegame as a base64 string, so the savegame itself stays a Json object.
+class BinaryArchiveWriter {
+public:
+	BinaryArchiveWriter(std::string_view schema, Uint32 version);
+
+	void Bool(bool value);
+	void Int32(Sint32 value);
+	void UInt32(Uint32 value);
+	void Float(float value);
+	void Double(double value);
+	void String(std::string_view value);
+	void Vector3d(const vector3d &value);
+	void Matrix3x3d(const matrix3x3d &value);
+
+	const std::string &GetData() const { return m_data; }
+	void ToJson(Json &jsonObj) const;
+
+private:
+	void Tag(Uint8 tag);
+	template <typename T>
+	void Raw(const T &value);
+
+	std::string m_data;
+};
+
+class BinaryArchiveReader {
+public:
+	BinaryArchiveReader(std::string_view data, std::string_view schema, Uint32 maxVersion);
+
+	// the archive data BinaryArchiveWriter::ToJson stored, which must
+	// outlive the reader opened on it
+	static std::string FromJson(const Json &jsonObj);
+
+	Uint32 GetVersion() const { return m_version; }
+	bool AtEnd() const { return m_at == m_data.size(); }
+
+	bool Bool();
+	Sint32 Int32();
+	Uint32 UInt32();
+	float Float();
+	double Double();
+	std::string String();
+	vector3d Vector3d();
+	matrix3x3d Matrix3x3d();
+
+private:
+	void Open(std::string_view schema, Uint32 maxVersion);
+	void Expect(Uint8 tag);
+	template <typename T>
+	T Raw();
+
+	std::string_view m_data;
+	size_t m_at;
+	Uint32 m_version;
+};
+
+#endif
@@ -11,11 +11,17 @@
 #include "Player.h"
 #include "Sfx.h"
 #include "Space.h"
+#include "Sphere.h"
 #include "galaxy/StarSystem.h"
 #include "graphics/TextureBuilder.h"
 #include "graphics/Types.h"
 #include "graphics/RenderState.h"
+#include "scenegraph/EffectBatch.h"
 #include "SpaceStation.h"
+#include "core/PerfTimeline.h"
+#include "core/TaskGraph.h"
+
+#include <algorithm>
 
 using namespace Graphics;
 
@@ -25,6 +31,9 @@ static const float OBJECT_HIDDEN_PIXEL_THRESHOLD = 2.0f;
 // if a terrain object would render smaller than this many pixels, draw a billboard instead
 static const float BILLBOARD_PIXEL_THRESHOLD = 8.0f;
 
+// number of bodies evaluated by each task in Camera::Update
+static constexpr uint32_t CAMERA_BODIES_PER_TASK = 128;
+
 CameraContext::CameraContext(float width, float height, float fovAng, float zNear, float zFar) :
 	m_width(width),
 	m_height(height),
@@ -145,104 +154,211 @@ static void position_system_lights(Frame *camFrame, Frame *frame, std::vector<Ca
 	}
 }
 
-void Camera::Update()
+void Camera::UpdateFrameViewTransforms(FrameId camFrame, FrameId frame)
 {
-	FrameId camFrame = m_context->GetTempFrame();
+	Frame *f = Frame::GetFrame(frame);
+	if (m_frameViewTransforms.size() <= frame.id())
+		m_frameViewTransforms.resize(frame.id() + 1);
+
+	matrix4x4d &viewTransform = m_frameViewTransforms[frame];
+	viewTransform = f->GetInterpOrientRelTo(camFrame);
+	viewTransform.SetTranslate(f->GetInterpPositionRelTo(camFrame));
+
+	for (FrameId kid : f->GetChildren())
+		UpdateFrameViewTransforms(camFrame, kid);
+}
+
+void Camera::UpdateOccluders(FrameId camFrame)
+{
+	PROFILE_SCOPED()
+	m_occluders.clear();
 
-	// evaluate each body and determine if/where/how to draw it
-	m_sortedBodies.clear();
-	m_spaceStations.clear();
 	for (Body *b : Pi::game->GetSpace()->GetBodies()) {
-		BodyAttrs attrs;
-		attrs.body = b;
-		attrs.billboard = false; // false by default
-		attrs.calcAtmosphereLighting = false; // false by default
-		attrs.calcInteriorLighting = false;
-
-		// If the body wishes to be excluded from the draw, skip it.
-		if (b->GetFlags() & Body::FLAG_DRAW_EXCLUDE)
+		if (!b->IsType(ObjectType::TERRAINBODY) || (b->GetFlags() & Body::FLAG_DRAW_EXCLUDE))
 			continue;
 
-		// determine position and transform for draw
-		//		Frame::GetFrameTransform(b->GetFrame(), camFrame, attrs.viewTransform);		// doesn't use interp coords, so breaks in some cases
-		Frame *f = Frame::GetFrame(b->GetFrame());
-		attrs.viewTransform = f->GetInterpOrientRelTo(camFrame);
-		attrs.viewTransform.SetTranslate(f->GetInterpPositionRelTo(camFrame));
-		attrs.viewCoords = attrs.viewTransform * b->GetInterpPosition();
+		const vector3d viewCoords = GetFrameViewTransform(b->GetFrame()) * b->GetInterpPosition();
 
-		// cull off-screen objects
-		double rad = b->GetClipRadius();
-		if (!m_context->GetFrustum().TestPointInfinite(attrs.viewCoords, rad))
+		// terrain never dips below the sea-level radius, so the solid sphere of
+		// that radius is a conservative occluder. From inside it nothing is
+		// hidden reliably.
+		const double radius = b->GetSystemBody()->GetRadius();
+		if (radius <= 0.0 || viewCoords.LengthSqr() <= radius * radius)
 			continue;
 
-		attrs.camDist = attrs.viewCoords.Length();
-		attrs.bodyFlags = b->GetFlags();
-
-		// approximate pixel width (disc diameter) of body on screen
-		// FIXME: this should reference a property set on the camera instead of querying the window size
-		const float pixSize = m_renderer->GetWindowHeight() * 2.0 * rad / (attrs.camDist * Graphics::GetFovFactor());
-
-		// terrain objects are visible from distance but might not have any discernable features
-		if (b->IsType(ObjectType::TERRAINBODY)) {
-			if (pixSize < BILLBOARD_PIXEL_THRESHOLD) {
-				attrs.billboard = true;
-
-				// project the position
-				vector3d pos;
-				m_context->GetFrustum().TranslatePoint(attrs.viewCoords, pos);
-				attrs.billboardPos = vector3f(pos);
-
-				// limit the minimum billboard size for planets so they're always a little visible
-				attrs.billboardSize = std::max(1.0f, pixSize);
-				if (b->IsType(ObjectType::STAR)) {
-					attrs.billboardColor = StarSystem::starRealColors[b->GetSystemBody()->GetType()];
-				} else if (b->IsType(ObjectType::PLANET)) {
-					// XXX this should incorporate some lighting effect
-					// (ie, colour of the illuminating star(s))
-					attrs.billboardColor = b->GetSystemBody()->GetAlbedo();
-				} else {
-					attrs.billboardColor = Color::WHITE;
-				}
+		if (!m_context->GetFrustum().TestPointInfinite(viewCoords, b->GetClipRadius()))
+			continue;
 
-				// this should always be the main star in the system - except for the star itself!
-				if (!m_lightSources.empty() && !b->IsType(ObjectType::STAR)) {
-					const Graphics::Light &light = m_lightSources[0].GetLight();
-					attrs.billboardColor *= light.GetDiffuse(); // colour the billboard a little with the Starlight
-				}
+		m_occluders.push_back({ b, viewCoords, radius });
+	}
+}
 
-				attrs.billboardColor.a = 255; // no alpha, these things are hard enough to see as it is
-			}
-		} else if (pixSize < OBJECT_HIDDEN_PIXEL_THRESHOLD) {
+bool Camera::IsOccluded(const Body *b, const vector3d &viewCoords, double radius) const
+{
+	SSphere obj(radius);
+	obj.m_centre = viewCoords;
+
+	for (const Occluder &occ : m_occluders) {
+		if (occ.body == b)
 			continue;
-		}
 
-		Body *parentBody = f->GetBody();
-		if (parentBody && parentBody->GetType() == ObjectType::PLANET) {
-			auto *planet = static_cast<Planet *>(parentBody);
+		SSphere occluder(occ.radius);
+		occluder.m_centre = occ.viewCoords;
+		// the camera is at the origin of view space
+		if (!occluder.HorizonCulling(vector3d(0.0), obj))
+			return true;
+	}
+
+	return false;
+}
+
+Camera::Visibility Camera::EvaluateBody(Body *b, FrameId camFrame, BodyAttrs &attrs) const
+{
+	attrs.body = b;
+	attrs.billboard = false; // false by default
+	attrs.calcAtmosphereLighting = false; // false by default
+	attrs.calcInteriorLighting = false;
+
+	// If the body wishes to be excluded from the draw, skip it.
+	if (b->GetFlags() & Body::FLAG_DRAW_EXCLUDE)
+		return Visibility::CULLED;
+
+	// determine position and transform for draw
+	Frame *f = Frame::GetFrame(b->GetFrame());
+	attrs.viewTransform = GetFrameViewTransform(b->GetFrame());
+	attrs.viewCoords = attrs.viewTransform * b->GetInterpPosition();
+
+	// cull off-screen objects
+	double rad = b->GetClipRadius();
+	if (!m_context->GetFrustum().TestPointInfinite(attrs.viewCoords, rad))
+		return Visibility::CULLED;
+
+	// cull objects hidden behind a planet or star
+	if (IsOccluded(b, attrs.viewCoords, rad))
+		return Visibility::OCCLUDED;
+
+	attrs.camDist = attrs.viewCoords.Length();
+	attrs.bodyFlags = b->GetFlags();
+
+	// approximate pixel width (disc diameter) of body on screen
+	// FIXME: this should reference a property set on the camera instead of querying the window size
+	const float pixSize = m_renderer->GetWindowHeight() * 2.0 * rad / (attrs.camDist * Graphics::GetFovFactor());
+
+	// terrain objects are visible from distance but might not have any discernable features
+	if (b->IsType(ObjectType::TERRAINBODY)) {
+		if (pixSize < BILLBOARD_PIXEL_THRESHOLD) {
+			attrs.billboard = true;
+
+			// project the position
+			vector3d pos;
+			m_context->GetFrustum().TranslatePoint(attrs.viewCoords, pos);
+			attrs.billboardPos = vector3f(pos);
+
+			// limit the minimum billboard size for planets so they're always a little visible
+			attrs.billboardSize = std::max(1.0f, pixSize);
+			if (b->IsType(ObjectType::STAR)) {
+				attrs.billboardColor = StarSystem::starRealColors[b->GetSystemBody()->GetType()];
+			} else if (b->IsType(ObjectType::PLANET)) {
+				// XXX this should incorporate some lighting effect
+				// (ie, colour of the illuminating star(s))
+				attrs.billboardColor = b->GetSystemBody()->GetAlbedo();
+			} else {
+				attrs.billboardColor = Color::WHITE;
+			}
+
+			// this should always be the main star in the system - except for the star itself!
+			if (!m_lightSources.empty() && !b->IsType(ObjectType::STAR)) {
+				const Graphics::Light &light = m_lightSources[0].GetLight();
+				attrs.billboardColor *= light.GetDiffuse(); // colour the billboard a little with the Starlight
+			}
 
-			double atmo_rad_sqr = planet->GetAtmosphereRadius() * planet->GetAtmosphereRadius();
-			if (b->IsType(ObjectType::MODELBODY) && b->GetPosition().LengthSqr() <= atmo_rad_sqr)
-				attrs.calcAtmosphereLighting = true;
+			attrs.billboardColor.a = 255; // no alpha, these things are hard enough to see as it is
 		}
+	} else if (pixSize < OBJECT_HIDDEN_PIXEL_THRESHOLD) {
+		return Visibility::CULLED;
+	}
+
+	Body *parentBody = f->GetBody();
+	if (parentBody && parentBody->GetType() == ObjectType::PLANET) {
+		auto *planet = static_cast<Planet *>(parentBody);
+
+		double atmo_rad_sqr = planet->GetAtmosphereRadius() * planet->GetAtmosphereRadius();
+		if (b->IsType(ObjectType::MODELBODY) && b->GetPosition().LengthSqr() <= atmo_rad_sqr)
+			attrs.calcAtmosphereLighting = true;
+	}
+
+	if(b->IsType(ObjectType::SHIP)) {
+		attrs.calcInteriorLighting = true;
+	}
+
+	return Visibility::VISIBLE;
+}
 
-		if(b->IsType(ObjectType::SHIP)) {
-			attrs.calcInteriorLighting = true;
+void Camera::Update()
+{
+	PROFILE_SCOPED()
+	FrameId camFrame = m_context->GetTempFrame();
+
+	// every body in a frame shares its transform, so walk the frame tree once
+	// here rather than once per body
+	UpdateFrameViewTransforms(camFrame, Pi::game->GetSpace()->GetRootFrame());
+	UpdateOccluders(camFrame);
+
+	// evaluate each body and determine if/where/how to draw it. Bodies are
+	// only read from, and each one writes to its own slot, so this can be
+	// split over the task graph.
+	auto bodies = Pi::game->GetSpace()->GetBodies();
+	const uint32_t numBodies = bodies.end() - bodies.begin();
+	m_bodyAttrs.resize(numBodies);
+	m_bodyVisibility.resize(numBodies);
+
+	TaskGraph *taskGraph = Pi::GetApp()->GetTaskGraph();
+	if (!taskGraph || numBodies <= CAMERA_BODIES_PER_TASK) {
+		for (uint32_t idx = 0; idx < numBodies; idx++)
+			m_bodyVisibility[idx] = EvaluateBody(bodies[idx], camFrame, m_bodyAttrs[idx]);
+	} else {
+		TaskSet *taskSet = new TaskSet();
+		for (uint32_t begin = 0; begin < numBodies; begin += CAMERA_BODIES_PER_TASK) {
+			const uint32_t end = std::min(begin + CAMERA_BODIES_PER_TASK, numBodies);
+			taskSet->AddTaskLambda({ begin, end }, [this, &bodies, camFrame](TaskRange range) {
+				for (uint32_t idx = range.begin; idx < range.end; idx++)
+					m_bodyVisibility[idx] = EvaluateBody(bodies[idx], camFrame, m_bodyAttrs[idx]);
+			});
 		}
 
-		m_sortedBodies.push_back(attrs);
+		TaskSet::Handle handle = taskGraph->QueueTaskSet(taskSet);
+		taskGraph->WaitForTaskSet(handle);
+	}
+
+	// gather the results in body order, so the draw order doesn't depend on
+	// how the work was split
+	Uint32 numOccluded = 0;
+	m_sortedBodies.clear();
+	m_spaceStations.clear();
+	for (uint32_t idx = 0; idx < numBodies; idx++) {
+		if (m_bodyVisibility[idx] == Visibility::OCCLUDED)
+			numOccluded++;
+		if (m_bodyVisibility[idx] != Visibility::VISIBLE)
+			continue;
+
+		m_sortedBodies.push_back(m_bodyAttrs[idx]);
 
-		if(b->IsType(ObjectType::SPACESTATION)) {
-			m_spaceStations.push_back(b);
+		if(bodies[idx]->IsType(ObjectType::SPACESTATION)) {
+			m_spaceStations.push_back(bodies[idx]);
 		}
 	}
 
-	// depth sort
-	m_sortedBodies.sort();
+	m_renderer->GetStats().AddToStatCount(Graphics::Stats::STAT_OCCLUDED_BODIES, numOccluded);
+
+	// depth sort; stable like the list sort it replaces, so bodies at the
+	// same distance keep their order from frame to frame
+	std::stable_sort(m_sortedBodies.begin(), m_sortedBodies.end());
 }
 
 void Camera::Draw(const Body *excludeBody)
 {
 	PROFILE_SCOPED()
+	PERF_ZONE("Camera Draw")
 
 	FrameId camFrameId = m_context->GetTempFrame();
 	FrameId rootFrameId = Pi::game->GetSpace()->GetRootFrame();
@@ -252,8 +368,7 @@ void Camera::Draw(const Body *excludeBody)
 
 	m_renderer->ClearScreen();
 
-	matrix4x4d trans2bg;
-	Frame::GetFrameTransform(rootFrameId, camFrameId, trans2bg);
+	matrix4x4d trans2bg = GetFrameViewTransform(rootFrameId);
 	trans2bg.ClearToRotOnly();
 
 	// Pick up to four suitable system light sources (stars)
@@ -297,8 +412,11 @@ void Camera::Draw(const Body *excludeBody)
 		}
 	}
 
-	Pi::game->GetSpace()->GetBackground()->SetIntensity(bgIntensity);
-	Pi::game->GetSpace()->GetBackground()->Draw(trans2bg);
+	{
+		Graphics::Renderer::GPUZoneTicket zone(m_renderer, "Background");
+		Pi::game->GetSpace()->GetBackground()->SetIntensity(bgIntensity);
+		Pi::game->GetSpace()->GetBackground()->Draw(trans2bg);
+	}
 
 	{
 		std::vector<Graphics::Light> rendererLights;
@@ -318,8 +436,13 @@ void Camera::Draw(const Body *excludeBody)
 
 	Graphics::VertexArray billboards(Graphics::ATTRIB_POSITION | Graphics::ATTRIB_NORMAL);
 
-	for (std::list<BodyAttrs>::iterator i = m_sortedBodies.begin(); i != m_sortedBodies.end(); ++i) {
-		BodyAttrs *attrs = &(*i);
+	m_renderer->BeginGPUZone("Bodies");
+
+	// models shared by several bodies (ships of a type, cargo) can be drawn instanced
+	m_renderer->BeginInstanceBatch();
+	SceneGraph::EffectBatch::Begin();
+	for (BodyAttrs &bodyAttrs : m_sortedBodies) {
+		BodyAttrs *attrs = &bodyAttrs;
 
 		// explicitly exclude a single body if specified (eg player)
 		if (attrs->body == excludeBody)
@@ -334,15 +457,22 @@ void Camera::Draw(const Body *excludeBody)
 		PrepareLighting(attrs->body, attrs->calcAtmosphereLighting, attrs->calcInteriorLighting);
 		attrs->body->Render(m_renderer, this, attrs->viewCoords, attrs->viewTransform);
 	}
+	m_renderer->EndInstanceBatch();
 
 	RestoreLighting();
 
+	// thruster flames and navlights of all the bodies above
+	SceneGraph::EffectBatch::End(m_renderer);
+
 	if (!billboards.IsEmpty()) {
 		Graphics::Renderer::MatrixTicket mt(m_renderer, matrix4x4f::Identity());
 		m_renderer->DrawBuffer(&billboards, m_billboardMaterial.get());
 	}
 
-	SfxManager::RenderAll(m_renderer, rootFrameId, camFrameId);
+	m_renderer->EndGPUZone();
+
+	Graphics::Renderer::GPUZoneTicket zone(m_renderer, "Sfx");
+	SfxManager::RenderAll(m_renderer, rootFrameId, this);
 }
 
 // Calculates the ambiently and directly lit portions of the lighting model taking into account the atmosphere and sun positions at a given location
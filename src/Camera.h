@@ -91,6 +91,10 @@ public:
 	void Update();
 	void Draw(const Body *excludeBody = nullptr);
 
+	// interpolated transform from the frame to the camera frame, worked out
+	// once per frame by Update
+	const matrix4x4d &GetFrameViewTransform(FrameId frame) const { return m_frameViewTransforms[frame]; }
+
 	// camera-specific light with attached source body
 	class LightSource {
 	public:
@@ -175,7 +179,34 @@ private:
 		};
 	};
 
-	std::list<BodyAttrs> m_sortedBodies;
+	// planets and stars in view, which hide whatever lies entirely behind them
+	struct Occluder {
+		const Body *body;
+		vector3d viewCoords;
+		double radius;
+	};
+
+	void UpdateFrameViewTransforms(FrameId camFrame, FrameId frame);
+	void UpdateOccluders(FrameId camFrame);
+	bool IsOccluded(const Body *b, const vector3d &viewCoords, double radius) const;
+
+	enum class Visibility : uint8_t {
+		CULLED,
+		OCCLUDED,
+		VISIBLE
+	};
+
+	// determine if/where/how to draw a body; safe to run on worker threads
+	Visibility EvaluateBody(Body *b, FrameId camFrame, BodyAttrs &attrs) const;
+
+	// per body of the space, filled in parallel by Update
+	std::vector<BodyAttrs> m_bodyAttrs;
+	std::vector<Visibility> m_bodyVisibility;
+
+	std::vector<BodyAttrs> m_sortedBodies;
+	std::vector<Occluder> m_occluders;
+	// indexed by FrameId
+	std::vector<matrix4x4d> m_frameViewTransforms;
 	// For interior check
 	std::vector<Body*> m_spaceStations;
 	std::vector<LightSource> m_lightSources;
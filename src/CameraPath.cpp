@@ -0,0 +1,96 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "CameraPath.h"
+
+#include "Json.h"
+#include "MathUtil.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+static bool read_vector(const Json &obj, const char *name, vector3d &out)
+{
+	auto it = obj.find(name);
+	if (it == obj.end())
+		return true;
+	if (!it->is_array() || it->size() != 3)
+		return false;
+
+	out = vector3d((*it)[0].get<double>(), (*it)[1].get<double>(), (*it)[2].get<double>());
+	return true;
+}
+
+bool CameraPath::Load(const Json &obj, std::string &error)
+{
+	m_keys.clear();
+
+	try {
+		m_startPath = obj.value("start", std::string());
+		m_timeStep = obj.value("time_step", 1.0 / 60.0);
+		m_warmupFrames = obj.value("warmup_frames", 0);
+
+		const Json &keys = obj.at("keys");
+		for (const Json &keyObj : keys) {
+			Key key;
+			key.time = keyObj.at("time").get<double>();
+			key.body = keyObj.at("body").get<std::string>();
+			key.logDistance = keyObj.value("log_distance", false);
+			if (!read_vector(keyObj, "position", key.position) ||
+				!read_vector(keyObj, "look_at", key.lookAt) ||
+				!read_vector(keyObj, "up", key.up)) {
+				error = "vectors must be arrays of three numbers";
+				return false;
+			}
+
+			if (!m_keys.empty() && key.time < m_keys.back().time) {
+				error = "keys must be in time order";
+				return false;
+			}
+			m_keys.push_back(std::move(key));
+		}
+	} catch (Json::exception &e) {
+		error = e.what();
+		return false;
+	}
+
+	if (m_keys.empty()) {
+		error = "the path has no keys";
+		return false;
+	}
+	if (!(m_timeStep > 0.0)) {
+		error = "time_step must be positive";
+		return false;
+	}
+
+	return true;
+}
+
+CameraPath::Sample CameraPath::Evaluate(double time) const
+{
+	assert(!m_keys.empty());
+
+	// the last key at or before time, and the one after it
+	auto next = std::upper_bound(m_keys.begin(), m_keys.end(), time,
+		[](double t, const Key &key) { return t < key.time; });
+	const Key &a = next == m_keys.begin() ? *next : *(next - 1);
+	const Key &b = next == m_keys.end() || next->body != a.body ? a : *next;
+
+	const double t = b.time > a.time ? Clamp((time - a.time) / (b.time - a.time), 0.0, 1.0) : 0.0;
+
+	vector3d position;
+	if (a.logDistance && a.position.Length() > 0.0 && b.position.Length() > 0.0) {
+		const double distA = a.position.Length();
+		const double distB = b.position.Length();
+		const vector3d dir = MathUtil::mix(a.position / distA, b.position / distB, t).NormalizedSafe();
+		position = dir * std::exp(MathUtil::mix(std::log(distA), std::log(distB), t));
+	} else {
+		position = MathUtil::mix(a.position, b.position, t);
+	}
+
+	const vector3d lookAt = MathUtil::mix(a.lookAt, b.lookAt, t);
+	const vector3d up = MathUtil::mix(a.up, b.up, t);
+
+	return Sample{ &a.body, position, MathUtil::LookAt(position, lookAt, up) };
+}
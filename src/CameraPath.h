@@ -0,0 +1,73 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _CAMERAPATH_H
+#define _CAMERAPATH_H
+
+#include "JsonFwd.h"
+#include "matrix3x3.h"
+#include "vector3.h"
+
+#include <string>
+#include <vector>
+
+/*
+ * A scripted camera move for benchmarks, e.g. an approach from orbit down to
+ * a city. It's a list of keys, each placing the camera relative to a named
+ * body at a time from the start of the path:
+ *
+ *   {
+ *     "start": "0,0,0,0,18",   // optional system path to start the game at
+ *     "time_step": 0.0166667,  // game seconds per rendered frame
+ *     "warmup_frames": 120,    // frames held at the first key, not recorded
+ *     "keys": [
+ *       { "time": 0, "body": "Mars", "position": [0, 0, 8e6], "look_at": [0, 0, 0] },
+ *       { "time": 20, "body": "Mars", "position": [0, 0, 3.4e6], "log_distance": true }
+ *     ]
+ *   }
+ *
+ * Positions are in metres, in the rotating frame of a planet or star and in
+ * the body's own space for anything else. The camera faces look_at (the
+ * body's centre by default) with "up" as its up vector. Between two keys on
+ * the same body the camera moves linearly, or with its distance from the
+ * body's centre interpolated logarithmically if the first key asks for
+ * log_distance, which keeps a descent from orbit smooth over the whole
+ * range. A key on a different body is cut to rather than moved to.
+ */
+class CameraPath {
+public:
+	struct Key {
+		double time = 0.0;
+		std::string body;
+		vector3d position = vector3d(0.0);
+		vector3d lookAt = vector3d(0.0);
+		vector3d up = vector3d(0.0, 1.0, 0.0);
+		bool logDistance = false;
+	};
+
+	// camera placement at a point on the path
+	struct Sample {
+		const std::string *body;
+		vector3d position;
+		matrix3x3d orient;
+	};
+
+	// returns false, and the reason in error, if the path is malformed
+	bool Load(const Json &obj, std::string &error);
+
+	const std::string &GetStartPath() const { return m_startPath; }
+	double GetTimeStep() const { return m_timeStep; }
+	int GetWarmupFrames() const { return m_warmupFrames; }
+	double GetDuration() const { return m_keys.empty() ? 0.0 : m_keys.back().time; }
+	const std::vector<Key> &GetKeys() const { return m_keys; }
+
+	Sample Evaluate(double time) const;
+
+private:
+	std::string m_startPath;
+	double m_timeStep = 1.0 / 60.0;
+	int m_warmupFrames = 0;
+	std::vector<Key> m_keys;
+};
+
+#endif /* _CAMERAPATH_H */
@@ -5,13 +5,14 @@
 #define _CARGOBODY_H
 
 #include "DynamicBody.h"
+#include "core/PoolAllocator.h"
 #include "lua/LuaRef.h"
 
 namespace Graphics {
 	class Renderer;
 }
 
-class CargoBody : public DynamicBody {
+class CargoBody : public DynamicBody, public PoolAllocated {
 public:
 	OBJDEF(CargoBody, DynamicBody, CARGOBODY);
 	CargoBody() = delete;
@@ -29,6 +29,20 @@
 
 std::vector<CityOnPlanet::CityFlavourType> CityOnPlanet::s_cityFlavours;
 std::unique_ptr<Graphics::Material> CityOnPlanet::s_debugMat;
+std::list<CityOnPlanet::Layout> CityOnPlanet::s_layoutCache;
+
+static const size_t MAX_CACHED_LAYOUTS = 8;
+
+// scratch space for testing the buildings of a cull block, reused by every city
+static Graphics::SphereBatch s_cullSpheres;
+static std::vector<uint32_t> s_cullVisible;
+
+// orientation transforms to rotate buildings to face north/south/east/west
+static void CalcBuildingOrients(const matrix4x4d &stationOrient, matrix4x4d orients[4])
+{
+	for (int i = 0; i < 4; i++)
+		orients[i] = stationOrient * matrix4x4d::RotateYMatrix(M_PI * 0.5 * i);
+}
 
 void CityOnPlanet::AddStaticGeomsToCollisionSpace()
 {
@@ -74,13 +88,45 @@ void CityOnPlanet::AddStaticGeomsToCollisionSpace()
 		}
 	}
 
+	UpdateCullBlocks();
+
 	// reset the reset flag
 	m_detailLevel = Pi::detail.cities;
 }
 
+void CityOnPlanet::UpdateCullBlocks()
+{
+	PROFILE_SCOPED()
+
+	// keep the buildings of each block together
+	std::stable_sort(m_enabledBuildings.begin(), m_enabledBuildings.end(),
+		[](const BuildingInstance &a, const BuildingInstance &b) { return a.cullBlock < b.cullBlock; });
+
+	m_cullBlocks.clear();
+	for (Uint32 i = 0; i < m_enabledBuildings.size(); i++) {
+		if (i == 0 || m_enabledBuildings[i].cullBlock != m_enabledBuildings[i - 1].cullBlock)
+			m_cullBlocks.push_back({ vector3d(0.0), 0.0, i, i });
+		m_cullBlocks.back().end = i + 1;
+	}
+
+	// bound each block by the spheres of its buildings around their centre
+	for (CullBlock &block : m_cullBlocks) {
+		Aabb aabb;
+		for (Uint32 i = block.begin; i < block.end; i++)
+			aabb.Update(m_enabledBuildings[i].pos);
+
+		block.centre = aabb.min + (aabb.max - aabb.min) * 0.5;
+		for (Uint32 i = block.begin; i < block.end; i++) {
+			const BuildingInstance &building = m_enabledBuildings[i];
+			block.radius = std::max(block.radius, (building.pos - block.centre).Length() + building.clipRadius);
+		}
+	}
+}
+
 void CityOnPlanet::RemoveStaticGeomsFromCollisionSpace()
 {
 	m_enabledBuildings.clear();
+	m_cullBlocks.clear();
 	for (unsigned int i = 0; i < m_buildings.size(); i++) {
 		Frame *f = Frame::GetFrame(m_frame);
 		f->RemoveStaticGeom(m_buildings[i].geom);
@@ -154,9 +200,8 @@ void CityOnPlanet::LoadBuildingType(std::string_view key, const Json &buildingDe
 		key, out.cellSize[0], out.cellSize[1], out.rarityAtmo, out.rarityAirless, int(out.buildingKind), out.idleAnimation != nullptr);
 }
 
-void CityOnPlanet::LoadCityFlavour(const FileSystem::FileInfo &file)
+void CityOnPlanet::LoadCityFlavour(const FileSystem::FileInfo &file, Json fileData)
 {
-	Json fileData = JsonUtils::LoadJsonDataFile(file.GetPath(), true);
 	if (!fileData.is_object()) {
 		Log::Info("CityOnPlanet: Could not load city definition file '{}' as a valid JSON file.", file.GetPath());
 		return;
@@ -232,19 +277,27 @@ void CityOnPlanet::Init()
 	PROFILE_SCOPED()
 
 	// Load all city definition configs
+	std::vector<FileSystem::FileInfo> files;
+	std::vector<std::string> paths;
 	FileSystem::FileEnumerator iter(FileSystem::gameDataFiles, "configs/buildings/");
 	for (; !iter.Finished(); iter.Next()) {
 		const FileSystem::FileInfo &file = iter.Current();
-		std::string name = file.GetName();
 
-		if (!ends_with_ci(name, ".json")) {
+		if (!ends_with_ci(file.GetName(), ".json")) {
 			continue;
 		}
 
+		files.push_back(file);
+		paths.push_back(file.GetPath());
+	}
+
+	// parsed in parallel, but the flavours are built in file order
+	std::vector<Json> fileData = JsonUtils::LoadJsonDataFiles(paths, Pi::GetApp()->GetTaskGraph());
+	for (size_t i = 0; i < files.size(); i++) {
 		try {
-			LoadCityFlavour(file);
+			LoadCityFlavour(files[i], std::move(fileData[i]));
 		} catch (std::exception &e) {
-			Log::Warning("CityOnPlanet: failed to parse city definition '{}': {}", name, e.what());
+			Log::Warning("CityOnPlanet: failed to parse city definition '{}': {}", files[i].GetName(), e.what());
 		}
 	}
 
@@ -262,6 +315,7 @@ void CityOnPlanet::Init()
 
 void CityOnPlanet::Uninit()
 {
+	s_layoutCache.clear();
 	s_cityFlavours.clear();
 	s_debugMat.reset();
 }
@@ -322,12 +376,56 @@ CityOnPlanet::CityOnPlanet(Planet *planet, SpaceStation *station, const Uint32 s
 
 	CalcCityRadius(m_body);
 
-	// TODO: run in a task thread
-	Generate(station);
+	if (!RestoreLayout(station, seed)) {
+		Generate(station);
+		StoreLayout(station, seed);
+	}
 
 	AddStaticGeomsToCollisionSpace();
 }
 
+bool CityOnPlanet::RestoreLayout(const SpaceStation *station, Uint32 seed)
+{
+	PROFILE_SCOPED()
+	const SystemPath &path = station->GetSystemBody()->GetPath();
+	auto it = std::find_if(s_layoutCache.begin(), s_layoutCache.end(),
+		[&](const Layout &layout) { return layout.path == path && layout.seed == seed; });
+	if (it == s_layoutCache.end())
+		return false;
+
+	s_layoutCache.splice(s_layoutCache.begin(), s_layoutCache, it);
+	const Layout &layout = *it;
+
+	m_cityRadius = layout.cityRadius;
+	m_citySize = layout.citySize;
+	m_gridOrigin = layout.gridOrigin;
+	m_realCentre = layout.realCentre;
+	m_clipRadius = layout.clipRadius;
+
+	matrix4x4d orientcalc[4];
+	CalcBuildingOrients(station->GetOrient(), orientcalc);
+
+	m_buildings = layout.buildings;
+	for (BuildingInstance &building : m_buildings) {
+		const CollMesh *cmesh = m_cityType->buildingTypes[building.instIndex].model->GetCollisionMesh().Get();
+		building.geom = new Geom(cmesh->GetGeomTree(), orientcalc[building.rotation], building.pos, GetPlanet());
+	}
+
+	Log::Verbose("\tCityOnPlanet: restored {} buildings for spacestation {}", m_buildings.size(), station->GetSystemBody()->GetName());
+	return true;
+}
+
+void CityOnPlanet::StoreLayout(const SpaceStation *station, Uint32 seed) const
+{
+	if (s_layoutCache.size() >= MAX_CACHED_LAYOUTS)
+		s_layoutCache.pop_back();
+
+	s_layoutCache.push_front({ station->GetSystemBody()->GetPath(), seed,
+		m_cityRadius, m_citySize, m_gridOrigin, m_realCentre, m_clipRadius, m_buildings });
+	for (BuildingInstance &building : s_layoutCache.front().buildings)
+		building.geom = nullptr;
+}
+
 void CityOnPlanet::Generate(SpaceStation *station)
 {
 	PROFILE_SCOPED()
@@ -393,17 +491,20 @@ void CityOnPlanet::Generate(SpaceStation *station)
 	// ==========================================
 
 	// precalc orientation transforms (to rotate buildings to face north/south/east/west)
-	const matrix4x4d &m = station->GetOrient();
-
 	matrix4x4d orientcalc[4];
-	orientcalc[0] = m * matrix4x4d::RotateYMatrix(M_PI * 0.5 * 0);
-	orientcalc[1] = m * matrix4x4d::RotateYMatrix(M_PI * 0.5 * 1);
-	orientcalc[2] = m * matrix4x4d::RotateYMatrix(M_PI * 0.5 * 2);
-	orientcalc[3] = m * matrix4x4d::RotateYMatrix(M_PI * 0.5 * 3);
-
-	// Reserve space for all buildings we expect to generate
-	m_buildings.clear();
-	m_buildings.reserve(cityExtents * cityExtents); // estimate 25% occupancy
+	CalcBuildingOrients(station->GetOrient(), orientcalc);
+
+	// Buildings are placed on the grid first and then all their terrain
+	// heights are sampled in one batch
+	struct PlacedBuilding {
+		uint32_t typeIndex;
+		int32_t orient;
+		Uint32 cullBlock;
+	};
+	std::vector<PlacedBuilding> placed;
+	std::vector<vector3d> placedPos;
+	placed.reserve(cityExtents * cityExtents); // estimate 25% occupancy
+	placedPos.reserve(cityExtents * cityExtents);
 
 	bool hasAtmo = m_body->HasAtmosphere();
 
@@ -414,6 +515,7 @@ void CityOnPlanet::Generate(SpaceStation *station)
 	uint32_t rarityRolls = 0;
 
 	double cityRadiusSqr = m_cityRadius * m_cityRadius;
+	const uint32_t blocksPerRow = (m_citySize + CULL_BLOCK_CELLS - 1) / CULL_BLOCK_CELLS;
 
 	for (uint32_t y = 0; y < m_citySize; y++) {
 		for (uint32_t x = 0; x < m_citySize; x++) {
@@ -512,33 +614,43 @@ void CityOnPlanet::Generate(SpaceStation *station)
 				double(y) + buildingType->cellSize[1] / 2.0,
 			};
 
-			vector3d pos = m_gridOrigin + incX * buildingPos.x + incZ * buildingPos.y;
-			vector3d posNorm = pos.Normalized();
-			double height = m_planet->GetTerrainHeight(posNorm);
+			const vector3d pos = m_gridOrigin + incX * buildingPos.x + incZ * buildingPos.y;
+			const Uint32 cullBlock = (y / CULL_BLOCK_CELLS) * blocksPerRow + x / CULL_BLOCK_CELLS;
+			placed.push_back({ typeIndex, orient, cullBlock });
+			placedPos.push_back(pos.Normalized());
+		}
+	}
 
-			// don't place under planetary sea-level if the body has >10% water
-			// TODO: need a better way to sample both height and biome data to determine if the cell is actually water
-			// This will not properly handle elevated lakes or dry inland depressions below sea-level
-			if (m_body->GetVolatileLiquid() > 0.1 && height < m_body->GetRadius()) {
-				underwaterCells++;
-				continue;
-			}
+	std::vector<double> heights(placedPos.size());
+	m_planet->GetTerrainHeights(placedPos.data(), heights.data(), placedPos.size());
 
-			// Compute the terrain relative height by scaling the normal of the building's ideal position
-			// This may introduce horizontal inaccuracy errors with sufficiently small planetary radii
-			pos = posNorm * height;
+	m_buildings.clear();
+	m_buildings.reserve(placed.size());
+	for (size_t i = 0; i < placed.size(); i++) {
+		const double height = heights[i];
+
+		// don't place under planetary sea-level if the body has >10% water
+		// TODO: need a better way to sample both height and biome data to determine if the cell is actually water
+		// This will not properly handle elevated lakes or dry inland depressions below sea-level
+		if (m_body->GetVolatileLiquid() > 0.1 && height < m_body->GetRadius()) {
+			underwaterCells++;
+			continue;
+		}
 
-			const CollMesh *cmesh = buildingType->model->GetCollisionMesh().Get();
+		// Compute the terrain relative height by scaling the normal of the building's ideal position
+		// This may introduce horizontal inaccuracy errors with sufficiently small planetary radii
+		const vector3d pos = placedPos[i] * height;
 
-			// FIXME: geoms need a userdata to tell gameplay code what we actually hit.
-			// We don't want to create a separate Body for each instance of the buildings, so we
-			// scam the code by pretending we're part of the host planet.
-			Geom *geom = new Geom(cmesh->GetGeomTree(), orientcalc[orient], pos, GetPlanet());
+		const PlacedBuilding &building = placed[i];
+		const CollMesh *cmesh = m_cityType->buildingTypes[building.typeIndex].model->GetCollisionMesh().Get();
 
-			// add it to the list of buildings to render
-			m_buildings.push_back({ typeIndex, float(cmesh->GetRadius()), orient, pos, geom });
+		// FIXME: geoms need a userdata to tell gameplay code what we actually hit.
+		// We don't want to create a separate Body for each instance of the buildings, so we
+		// scam the code by pretending we're part of the host planet.
+		Geom *geom = new Geom(cmesh->GetGeomTree(), orientcalc[building.orient], pos, GetPlanet());
 
-		}
+		// add it to the list of buildings to render
+		m_buildings.push_back({ building.typeIndex, float(cmesh->GetRadius()), building.orient, pos, geom, building.cullBlock });
 	}
 
 	_genTimer.Stop();
@@ -700,17 +812,36 @@ void CityOnPlanet::Render(Graphics::Renderer *r, const Graphics::Frustum &frustu
 		transform[i].reserve(m_buildingCounts[i]);
 	}
 
-	for (const auto &building : m_enabledBuildings) {
-		const vector3d pos = viewTransform * building.pos;
-
-		if (!frustum.TestPoint(pos, building.clipRadius))
+	for (const CullBlock &block : m_cullBlocks) {
+		const vector3d blockPos = viewTransform * block.centre;
+		if (!frustum.TestPoint(blockPos, block.radius))
 			continue;
 
-		matrix4x4f instanceRot = matrix4x4f(rotf[building.rotation]);
-		instanceRot.SetTranslate(vector3f(pos));
+		// buildings of a block entirely in view need no tests of their own,
+		// otherwise they're tested together
+		const bool blockInside = frustum.ContainsPoint(blockPos, block.radius);
+		if (!blockInside) {
+			s_cullSpheres.Clear();
+			for (Uint32 i = block.begin; i < block.end; i++) {
+				const BuildingInstance &building = m_enabledBuildings[i];
+				s_cullSpheres.Add(vector3f(viewTransform * building.pos), building.clipRadius);
+			}
+			frustum.TestSpheres(s_cullSpheres, s_cullVisible);
+		}
+
+		for (Uint32 i = block.begin; i < block.end; i++) {
+			if (!blockInside && !Graphics::Frustum::IsVisible(s_cullVisible, i - block.begin))
+				continue;
 
-		transform[building.instIndex].push_back(instanceRot);
-		++uCount;
+			const BuildingInstance &building = m_enabledBuildings[i];
+			const vector3d pos = viewTransform * building.pos;
+
+			matrix4x4f instanceRot = matrix4x4f(rotf[building.rotation]);
+			instanceRot.SetTranslate(vector3f(pos));
+
+			transform[building.instIndex].push_back(instanceRot);
+			++uCount;
+		}
 	}
 
 	// render the building models using instancing
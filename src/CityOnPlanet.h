@@ -9,14 +9,15 @@
 #include "Random.h"
 #include "JsonFwd.h"
 #include "matrix4x4.h"
+#include "galaxy/SystemPath.h"
 
+#include <list>
 #include <set>
 
 class Geom;
 class Planet;
 class SpaceStation;
 class Frame;
-class SystemPath;
 class SystemBody;
 
 namespace Graphics {
@@ -55,6 +56,8 @@ public:
 	// maximum number of cells a single building may take up
 	static constexpr uint32_t CELLMAX = 32;
 	static constexpr uint32_t CELLMASK = CELLMAX - 1;
+	// number of grid cells along each side of a block of buildings culled together
+	static constexpr uint32_t CULL_BLOCK_CELLS = 8;
 
 private:
 
@@ -98,6 +101,8 @@ private:
 private:
 
 	void Generate(SpaceStation *station);
+	bool RestoreLayout(const SpaceStation *station, Uint32 seed);
+	void StoreLayout(const SpaceStation *station, Uint32 seed) const;
 	void CalcCityRadius(const SystemBody *body);
 
 	void SetGridOccupancy(uint32_t x, uint32_t y, const uint8_t size[2]);
@@ -114,6 +119,7 @@ private:
 
 	void AddStaticGeomsToCollisionSpace();
 	void RemoveStaticGeomsFromCollisionSpace();
+	void UpdateCullBlocks();
 
 	struct BuildingInstance {
 		Uint32 instIndex;
@@ -121,6 +127,16 @@ private:
 		int rotation; // 0-3
 		vector3d pos;
 		Geom *geom;
+		Uint32 cullBlock;
+	};
+
+	// A square of the city grid whose enabled buildings are frustum tested
+	// as one sphere first, and only individually if it straddles the frustum
+	struct CullBlock {
+		vector3d centre;
+		double radius;
+		Uint32 begin; // range of m_enabledBuildings
+		Uint32 end;
 	};
 
 	const SystemBody *m_body;
@@ -135,6 +151,7 @@ private:
 
 	std::vector<BuildingInstance> m_buildings;
 	std::vector<BuildingInstance> m_enabledBuildings;
+	std::vector<CullBlock> m_cullBlocks;
 	std::vector<Uint32> m_buildingCounts;
 
 	// bitmask occupancy grid for quick population of the city
@@ -150,15 +167,30 @@ private:
 
 	CityFlavourType *m_cityType;
 
+	// Everything Generate produces for a station, so returning to one
+	// (e.g. after a save/load or hyperspacing back) doesn't lay out the
+	// city and sample the terrain for every cell again
+	struct Layout {
+		SystemPath path;
+		Uint32 seed;
+		double cityRadius;
+		uint32_t citySize;
+		vector3d gridOrigin;
+		vector3d realCentre;
+		float clipRadius;
+		std::vector<BuildingInstance> buildings; // without geoms
+	};
+
 	// --------------------------------------------------------
 	// statics
 private:
 
 	static std::vector<CityFlavourType> s_cityFlavours;
+	static std::list<Layout> s_layoutCache; // most recently used first
 
 	static std::unique_ptr<Graphics::Material> s_debugMat;
 
-	static void LoadCityFlavour(const FileSystem::FileInfo &file);
+	static void LoadCityFlavour(const FileSystem::FileInfo &file, Json fileData);
 	static void LoadBuildingType(std::string_view key, const Json &buildingDef, BuildingType &out);
 	static void GetModelSize(const Aabb &aabb, uint8_t size[2]);
 };
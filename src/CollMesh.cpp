@@ -17,13 +17,6 @@ void CollMesh::Save(Serializer::Writer &wr) const
 	wr.Vector3d(m_aabb.min);
 	wr.Double(m_aabb.radius);
 
-	m_geomTree->Save(wr);
-
-	wr.Int32(m_dynGeomTrees.size());
-	for (auto it : m_dynGeomTrees) {
-		it->Save(wr);
-	}
-
 	wr.Int32(m_totalTris);
 }
 
@@ -34,6 +27,23 @@ void CollMesh::Load(Serializer::Reader &rd)
 	m_aabb.min = rd.Vector3d();
 	m_aabb.radius = rd.Double();
 
+	m_totalTris = rd.Int32();
+}
+
+void CollMesh::SaveTrees(Serializer::Writer &wr) const
+{
+	PROFILE_SCOPED()
+	GetGeomTree()->Save(wr);
+
+	wr.Int32(m_dynGeomTrees.size());
+	for (auto it : m_dynGeomTrees) {
+		it->Save(wr);
+	}
+}
+
+void CollMesh::LoadTrees(Serializer::Reader &rd)
+{
+	PROFILE_SCOPED()
 	m_geomTree = new GeomTree(rd);
 
 	const Uint32 numDynGeomTrees = rd.Int32();
@@ -41,8 +51,21 @@ void CollMesh::Load(Serializer::Reader &rd)
 	for (Uint32 it = 0; it < numDynGeomTrees; ++it) {
 		m_dynGeomTrees.push_back(new GeomTree(rd));
 	}
+}
 
-	m_totalTris = rd.Int32();
+void CollMesh::BuildTrees() const
+{
+	if (!m_treesPending.load(std::memory_order_acquire))
+		return;
+
+	std::lock_guard<std::mutex> lock(m_buildLock);
+	if (!m_treesPending.load(std::memory_order_relaxed))
+		return;
+
+	PROFILE_SCOPED()
+	m_treeBuilder(const_cast<CollMesh &>(*this));
+	m_treeBuilder = nullptr;
+	m_treesPending.store(false, std::memory_order_release);
 }
 
 CollMesh::~CollMesh()
@@ -54,20 +77,20 @@ CollMesh::~CollMesh()
 
 const std::vector<vector3f> &CollMesh::GetGeomTreeVertices() const
 {
-	return m_geomTree->GetVertices();
+	return GetGeomTree()->GetVertices();
 }
 
 const Uint32 *CollMesh::GetGeomTreeIndices() const
 {
-	return m_geomTree->GetIndices();
+	return GetGeomTree()->GetIndices();
 }
 
 const unsigned int *CollMesh::GetGeomTreeTriFlags() const
 {
-	return m_geomTree->GetTriFlags();
+	return GetGeomTree()->GetTriFlags();
 }
 
 unsigned int CollMesh::GetGeomTreeNumTris() const
 {
-	return m_geomTree->GetNumTris();
+	return GetGeomTree()->GetNumTris();
 }
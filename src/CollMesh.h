@@ -7,6 +7,9 @@
 #include "Aabb.h"
 #include "RefCounted.h"
 
+#include <atomic>
+#include <functional>
+#include <mutex>
 #include <vector>
 
 class GeomTree;
@@ -18,6 +21,9 @@ namespace Serializer {
 
 //This simply stores the collision GeomTrees
 //and AABB.
+//The trees can be left to be built (or read) when first asked for, as
+//most models are only ever drawn and never collided with; the AABB and
+//triangle count are always there.
 class CollMesh : public RefCounted {
 public:
 	CollMesh() :
@@ -40,7 +46,11 @@ public:
 	const unsigned int *GetGeomTreeTriFlags() const;
 	unsigned int GetGeomTreeNumTris() const;
 
-	inline GeomTree *GetGeomTree() const { return m_geomTree; }
+	inline GeomTree *GetGeomTree() const
+	{
+		BuildTrees();
+		return m_geomTree;
+	}
 
 	inline void SetGeomTree(GeomTree *t)
 	{
@@ -48,7 +58,11 @@ public:
 		m_geomTree = t;
 	}
 
-	inline const std::vector<GeomTree *> &GetDynGeomTrees() const { return m_dynGeomTrees; }
+	inline const std::vector<GeomTree *> &GetDynGeomTrees() const
+	{
+		BuildTrees();
+		return m_dynGeomTrees;
+	}
 	inline void AddDynGeomTree(GeomTree *t)
 	{
 		assert(t);
@@ -59,14 +73,35 @@ public:
 	inline unsigned int GetNumTriangles() const { return m_totalTris; }
 	inline void SetNumTriangles(unsigned int i) { m_totalTris = i; }
 
+	// Sets the trees lazily: builder is called, once and on whichever
+	// thread first wants them, to SetGeomTree and AddDynGeomTree
+	using TreeBuilder = std::function<void(CollMesh &)>;
+	void SetTreeBuilder(TreeBuilder builder)
+	{
+		m_treeBuilder = std::move(builder);
+		m_treesPending = bool(m_treeBuilder);
+	}
+	// whether the trees exist yet
+	bool HasTrees() const { return !m_treesPending; }
+
+	// the AABB and triangle count
 	void Save(Serializer::Writer &wr) const;
 	void Load(Serializer::Reader &rd);
+	// the static and dynamic trees
+	void SaveTrees(Serializer::Writer &wr) const;
+	void LoadTrees(Serializer::Reader &rd);
 
 protected:
+	void BuildTrees() const;
+
 	Aabb m_aabb;
 	GeomTree *m_geomTree;
 	std::vector<GeomTree *> m_dynGeomTrees;
 	unsigned int m_totalTris;
+
+	mutable TreeBuilder m_treeBuilder;
+	mutable std::atomic<bool> m_treesPending { false };
+	mutable std::mutex m_buildLock;
 };
 
 #endif
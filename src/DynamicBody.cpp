@@ -7,12 +7,35 @@
 #include "Frame.h"
 #include "GameSaveError.h"
 #include "JsonUtils.h"
+#include "KinematicStore.h"
 #include "Planet.h"
 #include "Space.h"
 #include "collider/CollisionContact.h"
+#include "collider/CollisionSpace.h"
+#include "collider/Geom.h"
 #include "ship/Propulsion.h"
 
 static const float KINETIC_ENERGY_MULT = 0.00001f;
+
+// A body is at rest while its velocity, angular velocity and the
+// acceleration from all forces acting on it stay below these limits
+static const double SLEEP_MAX_VELOCITY = 0.01;		   // m/s
+static const double SLEEP_MAX_ANG_VELOCITY = 0.001;	   // rad/s
+static const double SLEEP_MAX_ACCELERATION = 0.001;	   // m/s^2
+static const double SLEEP_MAX_ANG_ACCELERATION = 0.0001; // rad/s^2
+// and falls asleep after being at rest for this many steps
+static const uint32_t SLEEP_RESTING_STEPS = 120;
+
+// Bodies coasting under gravity alone take substeps of at most this
+// fraction of their orbital timescale, sqrt(r^3 / GM)
+static const double GRAVITY_SUBSTEP_FRACTION = 0.01;
+static const int MAX_GRAVITY_SUBSTEPS = 64;
+// A step longer than the body's radius is swept for collisions, with a
+// sphere this fraction of the radius. The sphere has to fit inside the
+// body's collision mesh, so that wherever it touches another geom the
+// meshes touch too and the next collision pass responds to the contact.
+static const double SWEEP_RADIUS_FRACTION = 0.25;
+
 const double DynamicBody::DEFAULT_DRAG_COEFF = 0.1; // 'smooth sphere'
 
 DynamicBody::DynamicBody() :
@@ -30,6 +53,10 @@ DynamicBody::DynamicBody() :
 	m_angInertia = 1;
 	m_massRadius = 1;
 	m_isMoving = true;
+	m_isSleeping = false;
+	m_restingSteps = 0;
+	m_kinematicStore = nullptr;
+	m_kinematicIndex = KinematicStore::INVALID_INDEX;
 	m_atmosForce = vector3d(0.0);
 	m_gravityForce = vector3d(0.0);
 	m_externalForce = vector3d(0.0); // do external forces calc instead?
@@ -49,6 +76,10 @@ DynamicBody::DynamicBody(const Json &jsonObj, Space *space) :
 	m_lastTorque(vector3d(0.0))
 {
 	m_flags = Body::FLAG_CAN_MOVE_FRAME;
+	m_isSleeping = false;
+	m_restingSteps = 0;
+	m_kinematicStore = nullptr;
+	m_kinematicIndex = KinematicStore::INVALID_INDEX;
 	m_oldPos = GetPosition();
 	m_oldAngDisplacement = vector3d(0.0);
 
@@ -63,6 +94,8 @@ DynamicBody::DynamicBody(const Json &jsonObj, Space *space) :
 		m_massRadius = dynamicBodyObj["mass_radius"];
 		m_angInertia = dynamicBodyObj["ang_inertia"];
 		SetMoving(dynamicBodyObj["is_moving"]);
+		// the geom of a sleeping body has been saved as static
+		m_isSleeping = dynamicBodyObj.value("is_sleeping", false);
 	} catch (Json::type_error &) {
 		throw SavedGameCorruptException();
 	}
@@ -79,6 +112,7 @@ DynamicBody::DynamicBody(const Json &jsonObj, Space *space) :
 
 void DynamicBody::SetMoving(bool isMoving)
 {
+	WakeUp();
 	m_isMoving = isMoving;
 
 	if (!m_isMoving) {
@@ -103,6 +137,7 @@ void DynamicBody::SaveToJson(Json &jsonObj, Space *space)
 	dynamicBodyObj["mass_radius"] = m_massRadius;
 	dynamicBodyObj["ang_inertia"] = m_angInertia;
 	dynamicBodyObj["is_moving"] = m_isMoving;
+	dynamicBodyObj["is_sleeping"] = m_isSleeping;
 
 	jsonObj["dynamic_body"] = dynamicBodyObj; // Add dynamic body object to supplied object.
 }
@@ -128,35 +163,49 @@ void DynamicBody::PostLoadFixup(Space *space)
 
 DynamicBody::~DynamicBody()
 {
+	if (m_kinematicStore)
+		m_kinematicStore->Remove(m_kinematicIndex);
+}
+
+void DynamicBody::SetKinematicStore(KinematicStore *store, uint32_t idx)
+{
+	m_kinematicStore = store;
+	m_kinematicIndex = idx;
 }
 
 void DynamicBody::SetForce(const vector3d &f)
 {
+	if (!f.ExactlyEqual(vector3d(0.0))) WakeUp();
 	m_force = f;
 }
 
 void DynamicBody::AddForce(const vector3d &f)
 {
+	if (!f.ExactlyEqual(vector3d(0.0))) WakeUp();
 	m_force += f;
 }
 
 void DynamicBody::AddTorque(const vector3d &t)
 {
+	if (!t.ExactlyEqual(vector3d(0.0))) WakeUp();
 	m_torque += t;
 }
 
 void DynamicBody::AddRelForce(const vector3d &f)
 {
+	if (!f.ExactlyEqual(vector3d(0.0))) WakeUp();
 	m_force += GetOrient() * f;
 }
 
 void DynamicBody::AddRelTorque(const vector3d &t)
 {
+	if (!t.ExactlyEqual(vector3d(0.0))) WakeUp();
 	m_torque += GetOrient() * t;
 }
 
 void DynamicBody::SetTorque(const vector3d &t)
 {
+	if (!t.ExactlyEqual(vector3d(0.0))) WakeUp();
 	m_torque = t;
 }
 
@@ -169,6 +218,8 @@ void DynamicBody::SetMass(double mass)
 
 void DynamicBody::SetFrame(FrameId fId)
 {
+	// the geom has to leave the static tree of the old frame
+	WakeUp();
 	ModelBody::SetFrame(fId);
 	// external forces will be wrong after frame transition
 	m_externalForce = m_gravityForce = m_atmosForce = vector3d(0.0);
@@ -233,13 +284,126 @@ void DynamicBody::CalcExternalForce()
 	}
 }
 
+void DynamicBody::SetPosition(const vector3d &p)
+{
+	// static geoms don't update the collision tree when moved
+	if (m_isSleeping && !p.ExactlyEqual(GetPosition())) WakeUp();
+	ModelBody::SetPosition(p);
+	if (m_kinematicStore)
+		m_kinematicStore->SetPosition(m_kinematicIndex, p);
+}
+
+void DynamicBody::SetOrient(const matrix3x3d &r)
+{
+	if (m_isSleeping) WakeUp();
+	ModelBody::SetOrient(r);
+	if (m_kinematicStore)
+		m_kinematicStore->SetOrient(m_kinematicIndex, r);
+}
+
+void DynamicBody::WakeUp()
+{
+	m_restingSteps = 0;
+	if (!m_isSleeping)
+		return;
+
+	m_isSleeping = false;
+	SetStatic(false);
+}
+
+void DynamicBody::Sleep()
+{
+	m_isSleeping = true;
+	m_vel = m_angVel = vector3d(0.0);
+	m_oldAngDisplacement = vector3d(0.0);
+	SetStatic(true);
+}
+
+void DynamicBody::UpdateSleepState()
+{
+	// bodies which are static for other reasons (e.g. landed ships) are left alone
+	if (IsStatic() || !GetGeom() || !GetFrame().valid()) {
+		m_restingSteps = 0;
+		return;
+	}
+
+	const double maxForce = SLEEP_MAX_ACCELERATION * m_mass;
+	const double maxTorque = SLEEP_MAX_ANG_ACCELERATION * m_angInertia;
+
+	const bool atRest = m_vel.LengthSqr() < SLEEP_MAX_VELOCITY * SLEEP_MAX_VELOCITY &&
+		m_angVel.LengthSqr() < SLEEP_MAX_ANG_VELOCITY * SLEEP_MAX_ANG_VELOCITY &&
+		m_lastForce.LengthSqr() < maxForce * maxForce &&
+		m_lastTorque.LengthSqr() < maxTorque * maxTorque &&
+		m_externalForce.LengthSqr() < maxForce * maxForce;
+
+	if (!atRest) {
+		m_restingSteps = 0;
+		return;
+	}
+
+	if (++m_restingSteps >= SLEEP_RESTING_STEPS)
+		Sleep();
+}
+
+int DynamicBody::CalcGravitySubsteps(double timeStep) const
+{
+	// only bodies with nothing but gravity acting on them; rotating frames
+	// add drag and fictitious forces which are left to the plain step
+	if (!m_force.ExactlyEqual(vector3d(0.0)) || !m_torque.ExactlyEqual(vector3d(0.0)))
+		return 1;
+
+	const Frame *f = Frame::GetFrame(GetFrame());
+	if (!f || f->IsRotFrame())
+		return 1;
+
+	const Body *body = f->GetBody();
+	if (!body || body->IsType(ObjectType::SPACESTATION) || body->GetMass() <= 0.0)
+		return 1;
+
+	const double rSqr = GetPosition().LengthSqr();
+	const double timescale = sqrt(rSqr * sqrt(rSqr) / (G * body->GetMass()));
+	const double substeps = ceil(timeStep / (GRAVITY_SUBSTEP_FRACTION * timescale));
+	return int(Clamp(substeps, 1.0, double(MAX_GRAVITY_SUBSTEPS)));
+}
+
+void DynamicBody::IntegrateGravity(double timeStep, int substeps)
+{
+	const Body *body = Frame::GetFrame(GetFrame())->GetBody();
+	const double gm = G * body->GetMass();
+	auto gravity = [gm](const vector3d &pos) {
+		const double invrsqr = 1.0 / pos.LengthSqr();
+		return -pos * (gm * invrsqr * sqrt(invrsqr));
+	};
+
+	// kick-drift-kick leapfrog, second order where the plain step is first
+	const double h = timeStep / substeps;
+	vector3d pos = GetPosition();
+	vector3d vel = m_vel;
+	vector3d acc = gravity(pos);
+	for (int i = 0; i < substeps; i++) {
+		vel += 0.5 * h * acc;
+		pos += h * vel;
+		acc = gravity(pos);
+		vel += 0.5 * h * acc;
+	}
+
+	m_vel = vel;
+	SetPosition(pos);
+}
+
 void DynamicBody::TimeStepUpdate(const float timeStep)
 {
 	m_oldPos = GetPosition();
-	if (m_isMoving) {
+	if (m_isMoving && m_isSleeping) {
+		m_oldAngDisplacement = vector3d(0.0);
+	} else if (m_isMoving) {
+		// large steps through a tight orbit are split up; everything else,
+		// including anything under thrust or in contact, takes the plain step
+		const int substeps = CalcGravitySubsteps(timeStep);
 		m_force += m_externalForce;
 
-		m_vel += double(timeStep) * m_force * (1.0 / m_mass);
+		if (substeps == 1)
+			m_vel += double(timeStep) * m_force * (1.0 / m_mass);
 		m_angVel += double(timeStep) * m_torque * (1.0 / m_angInertia);
 
 		double len = m_angVel.Length();
@@ -250,7 +414,11 @@ void DynamicBody::TimeStepUpdate(const float timeStep)
 		}
 		m_oldAngDisplacement = m_angVel * timeStep;
 
-		SetPosition(GetPosition() + m_vel * double(timeStep));
+		if (substeps == 1)
+			SetPosition(GetPosition() + m_vel * double(timeStep));
+		else
+			IntegrateGravity(timeStep, substeps);
+		SweepStep();
 
 		//if (this->IsType(ObjectType::PLAYER))
 		//Output("pos = %.1f,%.1f,%.1f, vel = %.1f,%.1f,%.1f, force = %.1f,%.1f,%.1f, external = %.1f,%.1f,%.1f\n",
@@ -262,6 +430,8 @@ void DynamicBody::TimeStepUpdate(const float timeStep)
 		m_force = vector3d(0.0);
 		m_torque = vector3d(0.0);
 		CalcExternalForce(); // regenerate for new pos/vel
+
+		UpdateSleepState();
 	} else {
 		m_oldAngDisplacement = vector3d(0.0);
 	}
@@ -269,17 +439,38 @@ void DynamicBody::TimeStepUpdate(const float timeStep)
 	ModelBody::TimeStepUpdate(timeStep);
 }
 
-void DynamicBody::UpdateInterpTransform(double alpha)
+// The collision pass only sees where bodies are at the end of each step, so
+// a body moving further than its own size in one step can pass through thin
+// geometry without ever overlapping it. Such a step stops where the swept
+// sphere first touches, and the velocity is left for the collision response.
+void DynamicBody::SweepStep()
 {
-	m_interpPos = alpha * GetPosition() + (1.0 - alpha) * m_oldPos;
+	const Geom *geom = GetGeom();
+	if (!geom || !geom->IsEnabled())
+		return;
 
-	double len = m_oldAngDisplacement.Length() * (1.0 - alpha);
-	if (len > 1e-16) {
-		vector3d axis = m_oldAngDisplacement.Normalized();
-		matrix3x3d rot = matrix3x3d::Rotate(-len, axis); // rotate backwards
-		m_interpOrient = rot * GetOrient();
-	} else
-		m_interpOrient = GetOrient();
+	const vector3d move = GetPosition() - m_oldPos;
+	const double len = move.Length();
+	const double radius = GetPhysRadius();
+	if (len <= radius)
+		return;
+
+	CollisionSpace *space = Frame::GetFrame(GetFrame())->GetCollisionSpace();
+	if (!space)
+		return;
+
+	PROFILE_SCOPED()
+	const vector3d dir = move / len;
+	CollisionContact c;
+	space->SweepSphere(m_oldPos, dir, len, radius * SWEEP_RADIUS_FRACTION, &c, geom);
+	if (c.distance < len)
+		SetPosition(m_oldPos + dir * c.distance);
+}
+
+void DynamicBody::UpdateInterpTransform(double alpha)
+{
+	KinematicStore::InterpolateTransform(alpha, m_oldPos, GetPosition(), m_oldAngDisplacement, GetOrient(),
+		m_interpPos, m_interpOrient);
 }
 
 void DynamicBody::SetMassDistributionFromModel()
@@ -303,6 +494,7 @@ vector3d DynamicBody::GetVelocity() const
 
 void DynamicBody::SetVelocity(const vector3d &v)
 {
+	if (!v.ExactlyEqual(vector3d(0.0))) WakeUp();
 	m_vel = v;
 }
 
@@ -313,6 +505,7 @@ vector3d DynamicBody::GetAngVelocity() const
 
 void DynamicBody::SetAngVelocity(const vector3d &v)
 {
+	if (!v.ExactlyEqual(vector3d(0.0))) WakeUp();
 	m_angVel = v;
 }
 
@@ -323,6 +516,8 @@ bool DynamicBody::OnCollision(Body *o, Uint32 flags, double relVel)
 	// returning true to ensure that the missile can react to the collision
 	if (o->IsType(ObjectType::MISSILE)) return true;
 
+	WakeUp();
+
 	double kineticEnergy = 0;
 	if (o->IsType(ObjectType::DYNAMICBODY)) {
 		kineticEnergy = KINETIC_ENERGY_MULT * static_cast<DynamicBody *>(o)->GetMass() * relVel * relVel;
@@ -10,12 +10,14 @@
 
 class Propulsion;
 class FixedGuns;
+class KinematicStore;
 class Orbit;
 
 class DynamicBody : public ModelBody {
 private:
 	friend class Propulsion;
 	friend class FixedGuns;
+	friend class KinematicStore;
 
 public:
 	OBJDEF(DynamicBody, ModelBody, DYNAMICBODY);
@@ -26,6 +28,8 @@ public:
 	virtual vector3d GetVelocity() const override;
 	virtual void SetVelocity(const vector3d &v) override;
 	virtual void SetFrame(FrameId fId) override;
+	void SetPosition(const vector3d &p) override;
+	void SetOrient(const matrix3x3d &r) override;
 	vector3d GetAngVelocity() const override;
 	void SetAngVelocity(const vector3d &v) override;
 	virtual bool OnCollision(Body *o, Uint32 flags, double relVel) override;
@@ -34,6 +38,13 @@ public:
 	void SetMassDistributionFromModel();
 	void SetMoving(bool isMoving);
 	bool IsMoving() const { return m_isMoving; }
+	// A moving body falls asleep when it has been at rest with no forces
+	// acting on it for a while. Sleeping bodies aren't integrated, and their
+	// geom is moved to the static collision tree until they are woken up by
+	// a collision, an applied force or velocity, or being moved.
+	bool IsSleeping() const { return m_isSleeping; }
+	void WakeUp();
+	bool IsInKinematicStore() const { return m_kinematicStore != nullptr; }
 	virtual double GetMass() const override { return m_mass; } // XXX don't override this
 	virtual void TimeStepUpdate(const float timeStep) override;
 	double CalcAtmosphericDrag(double velSqr, double area, double coeff) const;
@@ -83,6 +94,13 @@ protected:
 	virtual void SaveToJson(Json &jsonObj, Space *space) override;
 
 	void GetCurrentAtmosphericState(double &pressure, double &density) const;
+	void UpdateSleepState();
+	void Sleep();
+	// substeps needed to follow the orbit of a body coasting under gravity
+	int CalcGravitySubsteps(double timeStep) const;
+	void IntegrateGravity(double timeStep, int substeps);
+	// cut short a step that would pass right through another geom
+	void SweepStep();
 
 	virtual vector3d CalcAtmosphericForce() const;
 
@@ -105,6 +123,14 @@ private:
 	double m_massRadius; // set in a mickey-mouse fashion from the collision mesh and used to calculate m_angInertia
 	double m_angInertia; // always sphere mass distribution
 	bool m_isMoving;
+	bool m_isSleeping;
+	// number of consecutive steps this body has been at rest while awake
+	uint32_t m_restingSteps;
+
+	// the store holding a copy of our kinematic state, maintained by Space
+	void SetKinematicStore(KinematicStore *store, uint32_t idx);
+	KinematicStore *m_kinematicStore;
+	uint32_t m_kinematicIndex;
 
 	vector3d m_externalForce;
 	vector3d m_atmosForce;
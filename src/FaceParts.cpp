@@ -8,6 +8,8 @@
 #include "SDLWrappers.h"
 #include "utils.h"
 
+#include <mutex>
+
 namespace {
 	static const int MAX_GENDERS = 6;
 	static const int MAX_RACES = 16;
@@ -309,6 +311,25 @@ void FaceParts::Uninit()
 	s_partdb = nullptr;
 }
 
+size_t FaceParts::GetMemoryUsage()
+{
+	if (!s_partdb)
+		return 0;
+
+	size_t size = 0;
+	auto addSurface = [&size](const SDLSurfacePtr &im) {
+		if (im)
+			size += size_t(im->pitch) * im->h;
+	};
+	for (const std::vector<Part> *parts : { &s_partdb->heads, &s_partdb->eyes, &s_partdb->noses, &s_partdb->mouths,
+			 &s_partdb->hairstyles, &s_partdb->accessories, &s_partdb->clothes, &s_partdb->armour }) {
+		for (const Part &part : *parts)
+			addSurface(part.part);
+	}
+	addSurface(s_partdb->background_general);
+	return size;
+}
+
 int FaceParts::NumSpecies()
 {
 	return s_partdb->species.size();
@@ -411,6 +432,11 @@ void FaceParts::PickFaceParts(FaceDescriptor &inout_face, const Uint32 seed)
 void FaceParts::BuildFaceImage(SDL_Surface *faceIm, const FaceDescriptor &face)
 {
 	PROFILE_SCOPED()
+	// blitting caches a map on the source surface, so the part images can
+	// only be blitted from one thread at a time
+	static std::mutex s_blitLock;
+	std::lock_guard<std::mutex> lock(s_blitLock);
+
 	const Uint32 selector = _make_selector(face.species, face.race, face.gender);
 
 	_blit_image(faceIm, s_partdb->background_general.Get(), 0, 0);
@@ -40,6 +40,9 @@ namespace FaceParts {
 	void Init();
 	void Uninit();
 
+	// bytes of the part images held in memory
+	size_t GetMemoryUsage();
+
 	int NumSpecies();
 	int NumGenders(const int speciesIdx);
 	int NumRaces(const int speciesIdx);
@@ -54,6 +57,7 @@ namespace FaceParts {
 	int NumArmour(const int speciesIdx, const int raceIdx, const int genderIdx);
 
 	void PickFaceParts(FaceDescriptor &inout_face, const Uint32 seed);
+	// safe to call from any thread, but calls are serialised
 	void BuildFaceImage(SDL_Surface *faceIm, const FaceDescriptor &face);
 } // namespace FaceParts
 
@@ -0,0 +1,284 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "FileSourcePack.h"
+#include "core/Log.h"
+#include "lz4/lz4.h"
+#include "lz4/lz4hc.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#if (__GNUC__ && (__BYTE_ORDER_ == __ORDER_BIG_ENDIAN__)) || (__clang__ && __BIG_ENDIAN__)
+#error FileSourcePack.cpp is incompatible with big-endian architectures!
+#endif
+
+namespace FileSystem {
+
+	static const char s_packMagic[8] = { 'P', 'I', 'O', 'N', 'P', 'A', 'C', 'K' };
+	static const Uint32 s_packVersion = 1;
+	static const Uint64 s_dataAlignment = 64;
+
+	enum EntryFlags : Uint32 {
+		ENTRY_LZ4 = 1
+	};
+
+	struct FileSourcePack::Header {
+		char magic[8];
+		Uint32 version;
+		Uint32 numEntries;
+		Uint64 namesOffset;
+		Uint64 namesSize;
+	};
+
+	struct FileSourcePack::Entry {
+		Uint64 offset;
+		Uint64 storedSize;
+		Uint64 size;
+		Uint32 nameOffset;
+		Uint32 nameLength;
+		Uint32 flags;
+		Uint32 unused;
+	};
+
+	// a stored entry, shared straight out of the mapped pack
+	class FileDataPacked : public FileData {
+	public:
+		FileDataPacked(const FileInfo &info, size_t size, const char *data, const RefCountedPtr<FileData> &pack) :
+			FileData(info, size, const_cast<char *>(data)),
+			m_pack(pack) {}
+
+	private:
+		RefCountedPtr<FileData> m_pack;
+	};
+
+	FileSourcePack::FileSourcePack(FileSourceFS &fs, const std::string &packPath) :
+		FileSource(JoinPath(fs.GetRoot(), packPath), fs.IsTrusted()),
+		m_entries(nullptr)
+	{
+		m_pack = fs.MapFile(packPath);
+		if (m_pack && !Open()) {
+			Log::Warning("FileSourcePack: '{}' is not a readable pack, ignoring it\n", packPath);
+			m_pack.Reset();
+			m_files.clear();
+			m_dirs.clear();
+		}
+	}
+
+	FileSourcePack::~FileSourcePack()
+	{
+	}
+
+	bool FileSourcePack::Open()
+	{
+		static_assert(sizeof(Header) == 32, "pack header must be packed");
+		static_assert(sizeof(Entry) == 40, "pack entries must be packed");
+
+		const Uint64 packSize = m_pack->GetSize();
+		if (packSize < sizeof(Header))
+			return false;
+
+		Header header;
+		std::memcpy(&header, m_pack->GetData(), sizeof(Header));
+		if (std::memcmp(header.magic, s_packMagic, sizeof(s_packMagic)) != 0 || header.version != s_packVersion)
+			return false;
+
+		const Uint64 entriesEnd = sizeof(Header) + Uint64(header.numEntries) * sizeof(Entry);
+		if (entriesEnd > packSize || header.namesOffset < entriesEnd || header.namesSize > packSize - header.namesOffset)
+			return false;
+
+		// the entries follow the header, and the mapping is page aligned
+		m_entries = reinterpret_cast<const Entry *>(m_pack->GetData() + sizeof(Header));
+		m_dirs[""];
+
+		for (Uint32 i = 0; i < header.numEntries; i++) {
+			const Entry &entry = m_entries[i];
+			if (entry.nameOffset > header.namesSize || entry.nameLength > header.namesSize - entry.nameOffset)
+				return false;
+			if (entry.offset > packSize || entry.storedSize > packSize - entry.offset)
+				return false;
+			if (!(entry.flags & ENTRY_LZ4) && entry.storedSize != entry.size)
+				return false;
+
+			const std::string_view path(m_pack->GetData() + header.namesOffset + entry.nameOffset, entry.nameLength);
+			if (path.empty() || !m_files.emplace(path, i).second)
+				return false;
+			AddToDirectory(path, i);
+		}
+
+		return true;
+	}
+
+	void FileSourcePack::AddToDirectory(std::string_view path, Uint32 fileIndex)
+	{
+		const size_t slash = path.rfind('/');
+		std::string_view dir = path.substr(0, slash == std::string_view::npos ? 0 : slash);
+		m_dirs[dir].files.push_back(fileIndex);
+
+		// and every directory above it, the first time it's seen
+		while (!dir.empty()) {
+			const size_t up = dir.rfind('/');
+			const std::string_view parent = dir.substr(0, up == std::string_view::npos ? 0 : up);
+			auto inserted = m_dirs.try_emplace(parent);
+			Directory &parentDir = inserted.first->second;
+			if (std::find(parentDir.subdirs.begin(), parentDir.subdirs.end(), dir) != parentDir.subdirs.end())
+				break;
+			parentDir.subdirs.push_back(dir);
+			dir = parent;
+		}
+	}
+
+	std::string_view FileSourcePack::GetEntryPath(const Entry &entry) const
+	{
+		const Header *header = reinterpret_cast<const Header *>(m_pack->GetData());
+		return std::string_view(m_pack->GetData() + header->namesOffset + entry.nameOffset, entry.nameLength);
+	}
+
+	FileInfo FileSourcePack::Lookup(const std::string &path)
+	{
+		if (!m_pack)
+			return MakeFileInfo(path, FileInfo::FT_NON_EXISTENT);
+
+		const std::string normalised = NormalisePath(path);
+		if (m_files.count(normalised))
+			return MakeFileInfo(normalised, FileInfo::FT_FILE);
+		if (m_dirs.count(normalised))
+			return MakeFileInfo(normalised, FileInfo::FT_DIR);
+		return MakeFileInfo(path, FileInfo::FT_NON_EXISTENT);
+	}
+
+	RefCountedPtr<FileData> FileSourcePack::ReadFile(const std::string &path)
+	{
+		if (!m_pack)
+			return RefCountedPtr<FileData>();
+
+		const std::string normalised = NormalisePath(path);
+		auto it = m_files.find(normalised);
+		if (it == m_files.end())
+			return RefCountedPtr<FileData>();
+
+		const Entry &entry = m_entries[it->second];
+		const char *stored = m_pack->GetData() + entry.offset;
+		const FileInfo info = MakeFileInfo(normalised, FileInfo::FT_FILE);
+
+		if (!(entry.flags & ENTRY_LZ4))
+			return RefCountedPtr<FileData>(new FileDataPacked(info, entry.size, stored, m_pack));
+
+		std::unique_ptr<char, FreeDeleter> data(static_cast<char *>(std::malloc(entry.size)));
+		if (!data || entry.size > LZ4_MAX_INPUT_SIZE ||
+			LZ4_decompress_safe(stored, data.get(), int(entry.storedSize), int(entry.size)) != int(entry.size)) {
+			Output("FileSourcePack::ReadFile: couldn't inflate '%s'\n", normalised.c_str());
+			return RefCountedPtr<FileData>();
+		}
+		return RefCountedPtr<FileData>(new FileDataMalloc(info, entry.size, data.release()));
+	}
+
+	bool FileSourcePack::ReadDirectory(const std::string &path, std::vector<FileInfo> &output)
+	{
+		if (!m_pack)
+			return false;
+
+		auto it = m_dirs.find(NormalisePath(path));
+		if (it == m_dirs.end())
+			return false;
+
+		const size_t output_head_size = output.size();
+		for (std::string_view subdir : it->second.subdirs)
+			output.push_back(MakeFileInfo(std::string(subdir), FileInfo::FT_DIR));
+		for (Uint32 index : it->second.files)
+			output.push_back(MakeFileInfo(std::string(GetEntryPath(m_entries[index])), FileInfo::FT_FILE));
+
+		std::sort(output.begin() + output_head_size, output.end());
+		return true;
+	}
+
+	bool FileSourcePack::ListPaths(std::vector<std::string> &paths)
+	{
+		if (!m_pack)
+			return false;
+
+		for (const auto &file : m_files)
+			paths.emplace_back(file.first);
+		for (const auto &dir : m_dirs)
+			if (!dir.first.empty())
+				paths.emplace_back(dir.first);
+		return true;
+	}
+
+	static bool WriteAll(FILE *out, const void *data, size_t size)
+	{
+		return size == 0 || fwrite(data, size, 1, out) == 1;
+	}
+
+	bool FileSourcePack::Write(FileSource &source, FILE *out, bool compress, bool (*skip)(const FileInfo &))
+	{
+		std::vector<FileInfo> files;
+		for (const FileInfo &info : source.Recurse("")) {
+			if (info.IsFile() && !(skip && skip(info)))
+				files.push_back(info);
+		}
+		std::sort(files.begin(), files.end());
+
+		std::string names;
+		std::vector<Entry> entries(files.size());
+		for (size_t i = 0; i < files.size(); i++) {
+			entries[i] = Entry{};
+			entries[i].nameOffset = Uint32(names.size());
+			entries[i].nameLength = Uint32(files[i].GetPath().size());
+			names += files[i].GetPath();
+		}
+
+		Header header;
+		std::memcpy(header.magic, s_packMagic, sizeof(s_packMagic));
+		header.version = s_packVersion;
+		header.numEntries = Uint32(files.size());
+		header.namesOffset = sizeof(Header) + entries.size() * sizeof(Entry);
+		header.namesSize = names.size();
+
+		// the index is written again at the end, once the offsets are known
+		Uint64 offset = header.namesOffset + header.namesSize;
+		if (!WriteAll(out, &header, sizeof(header)) || !WriteAll(out, entries.data(), entries.size() * sizeof(Entry)) || !WriteAll(out, names.data(), names.size()))
+			return false;
+
+		static const char padding[s_dataAlignment] = {};
+		std::vector<char> compressed;
+		for (size_t i = 0; i < files.size(); i++) {
+			RefCountedPtr<FileData> data = source.ReadFile(files[i].GetPath());
+			if (!data) {
+				Output("FileSourcePack::Write: couldn't read '%s'\n", files[i].GetPath().c_str());
+				return false;
+			}
+
+			const Uint64 pad = (s_dataAlignment - offset % s_dataAlignment) % s_dataAlignment;
+			if (!WriteAll(out, padding, pad))
+				return false;
+			offset += pad;
+
+			Entry &entry = entries[i];
+			entry.offset = offset;
+			entry.size = data->GetSize();
+			entry.storedSize = entry.size;
+
+			const char *stored = data->GetData();
+			if (compress && entry.size > 0 && entry.size <= LZ4_MAX_INPUT_SIZE) {
+				compressed.resize(LZ4_compressBound(int(entry.size)));
+				const int compressedSize = LZ4_compress_HC(data->GetData(), compressed.data(), int(entry.size), int(compressed.size()), LZ4HC_CLEVEL_DEFAULT);
+				if (compressedSize > 0 && Uint64(compressedSize) < entry.size - entry.size / 8) {
+					entry.flags |= ENTRY_LZ4;
+					entry.storedSize = compressedSize;
+					stored = compressed.data();
+				}
+			}
+
+			if (!WriteAll(out, stored, entry.storedSize))
+				return false;
+			offset += entry.storedSize;
+		}
+
+		return fseek(out, sizeof(Header), SEEK_SET) == 0 && WriteAll(out, entries.data(), entries.size() * sizeof(Entry));
+	}
+
+} // namespace FileSystem
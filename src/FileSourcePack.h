@@ -0,0 +1,69 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _FILESOURCEPACK_H
+#define _FILESOURCEPACK_H
+
+#include "FileSystem.h"
+#include <SDL_stdinc.h>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace FileSystem {
+
+	// A read-only source over a packed archive of the data directory, so
+	// that mounting data is one mapping and lookups are a hash of the path,
+	// instead of a stat, open and read per file.
+	//
+	// A pack is a header, a table of entries sorted by path, the paths, and
+	// then the file data, each file starting on a 64 byte boundary. An entry
+	// is either stored, and read straight out of the mapping with no copy,
+	// or LZ4 compressed when that saves enough to be worth inflating.
+	// Directories aren't stored, they're the paths leading to files.
+	//
+	// The pack is built by the packdata tool (see the build-data-pack
+	// target) and is mounted ahead of the loose data files when present.
+	class FileSourcePack : public FileSource {
+	public:
+		FileSourcePack(FileSourceFS &fs, const std::string &packPath);
+		virtual ~FileSourcePack();
+
+		// false if the file isn't a pack this build can read
+		bool IsOpen() const { return m_pack.Valid(); }
+
+		virtual FileInfo Lookup(const std::string &path);
+		virtual RefCountedPtr<FileData> ReadFile(const std::string &path);
+		virtual bool ReadDirectory(const std::string &path, std::vector<FileInfo> &output);
+		virtual RefCountedPtr<FileData> MapFile(const std::string &path) { return ReadFile(path); }
+		virtual bool ListPaths(std::vector<std::string> &paths);
+
+		// Write every file of source, bar those skip returns true for, as a
+		// pack to out. With compress, entries are LZ4 compressed where that
+		// makes them at least an eighth smaller.
+		static bool Write(FileSource &source, FILE *out, bool compress, bool (*skip)(const FileInfo &) = nullptr);
+
+	private:
+		struct Header;
+		struct Entry;
+
+		struct Directory {
+			std::vector<std::string_view> subdirs;
+			std::vector<Uint32> files;
+		};
+
+		RefCountedPtr<FileData> m_pack;
+		const Entry *m_entries;
+		// paths are views of the mapped pack
+		std::unordered_map<std::string_view, Uint32> m_files;
+		std::unordered_map<std::string_view, Directory> m_dirs;
+
+		bool Open();
+		std::string_view GetEntryPath(const Entry &entry) const;
+		void AddToDirectory(std::string_view path, Uint32 fileIndex);
+	};
+
+} // namespace FileSystem
+
+#endif
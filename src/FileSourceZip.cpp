@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <stdexcept>
 
 extern "C" {
 #include "miniz/miniz.h"
@@ -13,9 +14,14 @@ extern "C" {
 
 namespace FileSystem {
 
+	// enough for the shaders and the odd texture; bigger files aren't kept
+	static const size_t s_cacheCapacity = 16 * 1024 * 1024;
+	static const size_t s_maxCachedFileSize = 2 * 1024 * 1024;
+
 	FileSourceZip::FileSourceZip(FileSourceFS &fs, const std::string &zipPath) :
 		FileSource(zipPath),
-		m_archive(0)
+		m_archive(0),
+		m_cacheSize(0)
 	{
 		mz_zip_archive *zip = static_cast<mz_zip_archive *>(std::calloc(1, sizeof(mz_zip_archive)));
 		FILE *file = fs.OpenReadStream(zipPath);
@@ -40,6 +46,7 @@ namespace FileSystem {
 				}
 			}
 		}
+		IndexDirectory(m_root);
 
 		m_archive = static_cast<void *>(zip);
 	}
@@ -94,18 +101,46 @@ namespace FileSystem {
 		return true;
 	}
 
+	const FileSourceZip::FileStat *FileSourceZip::FindFile(const std::string &path) const
+	{
+		auto it = m_index.find(NormalisePath(path));
+		return it != m_index.end() ? it->second : nullptr;
+	}
+
 	FileInfo FileSourceZip::Lookup(const std::string &path)
 	{
-		const Directory *dir;
-		std::string filename;
-		if (!FindDirectoryAndFile(path, dir, filename))
+		const FileStat *st = FindFile(path);
+		if (!st)
 			return MakeFileInfo(path, FileInfo::FT_NON_EXISTENT);
 
-		std::map<std::string, FileStat>::const_iterator i = dir->files.find(filename);
-		if (i == dir->files.end())
-			return MakeFileInfo(path, FileInfo::FT_NON_EXISTENT);
+		return st->info;
+	}
+
+	RefCountedPtr<FileData> FileSourceZip::FindCached(Uint32 index)
+	{
+		auto it = m_cache.find(index);
+		if (it == m_cache.end())
+			return RefCountedPtr<FileData>();
+
+		m_cacheAge.splice(m_cacheAge.begin(), m_cacheAge, it->second.age);
+		return it->second.data;
+	}
+
+	void FileSourceZip::AddToCache(Uint32 index, const RefCountedPtr<FileData> &data)
+	{
+		if (data->GetSize() > s_maxCachedFileSize)
+			return;
 
-		return (*i).second.info;
+		m_cacheAge.push_front(index);
+		m_cache[index] = CachedFile{ data, m_cacheAge.begin() };
+		m_cacheSize += data->GetSize();
+
+		while (m_cacheSize > s_cacheCapacity) {
+			auto oldest = m_cache.find(m_cacheAge.back());
+			m_cacheSize -= oldest->second.data->GetSize();
+			m_cache.erase(oldest);
+			m_cacheAge.pop_back();
+		}
 	}
 
 	RefCountedPtr<FileData> FileSourceZip::ReadFile(const std::string &path)
@@ -113,24 +148,27 @@ namespace FileSystem {
 		if (!m_archive) return RefCountedPtr<FileData>();
 		mz_zip_archive *zip = static_cast<mz_zip_archive *>(m_archive);
 
-		const Directory *dir;
-		std::string filename;
-		if (!FindDirectoryAndFile(path, dir, filename))
+		const FileStat *st = FindFile(path);
+		if (!st || !st->info.IsFile())
 			return RefCountedPtr<FileData>();
 
-		std::map<std::string, FileStat>::const_iterator i = dir->files.find(filename);
-		if (i == dir->files.end())
-			return RefCountedPtr<FileData>();
+		std::lock_guard<std::mutex> lock(m_lock);
 
-		const FileStat &st = (*i).second;
+		// FileData is never written to, so readers can share it
+		RefCountedPtr<FileData> cached = FindCached(st->index);
+		if (cached)
+			return cached;
 
-		char *data = static_cast<char *>(std::malloc(st.size));
-		if (!mz_zip_reader_extract_to_mem(zip, st.index, data, st.size, 0)) {
+		char *data = static_cast<char *>(std::malloc(st->size));
+		if (!mz_zip_reader_extract_to_mem(zip, st->index, data, st->size, 0)) {
 			Output("FileSourceZip::ReadFile: couldn't extract '%s'\n", path.c_str());
+			std::free(data);
 			return RefCountedPtr<FileData>();
 		}
 
-		return RefCountedPtr<FileData>(new FileDataMalloc(st.info, st.size, data));
+		RefCountedPtr<FileData> file(new FileDataMalloc(st->info, st->size, data));
+		AddToCache(st->index, file);
+		return file;
 	}
 
 	bool FileSourceZip::ReadDirectory(const std::string &path, std::vector<FileInfo> &output)
@@ -153,6 +191,16 @@ namespace FileSystem {
 		return true;
 	}
 
+	bool FileSourceZip::ListPaths(std::vector<std::string> &paths)
+	{
+		if (!m_archive)
+			return false;
+
+		for (const auto &file : m_index)
+			paths.push_back(file.first);
+		return true;
+	}
+
 	void FileSourceZip::AddFile(const std::string &path, const FileStat &fileStat)
 	{
 		std::vector<std::string> fragments;
@@ -183,4 +231,18 @@ namespace FileSystem {
 		dir->files.insert(std::make_pair(filename, fileStat));
 	}
 
+	void FileSourceZip::IndexDirectory(const Directory &dir)
+	{
+		// std::map nodes don't move, so the pointers stay good
+		for (const auto &file : dir.files) {
+			try {
+				m_index.emplace(NormalisePath(file.second.info.GetPath()), &file.second);
+			} catch (const std::invalid_argument &) {
+				// a path out of the archive, which can't be looked up anyway
+			}
+		}
+		for (const auto &subdir : dir.subdirs)
+			IndexDirectory(subdir.second);
+	}
+
 } // namespace FileSystem
@@ -6,8 +6,11 @@
 
 #include "FileSystem.h"
 #include <SDL_stdinc.h>
+#include <list>
 #include <map>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 namespace FileSystem {
 
@@ -21,6 +24,7 @@ namespace FileSystem {
 		virtual FileInfo Lookup(const std::string &path);
 		virtual RefCountedPtr<FileData> ReadFile(const std::string &path);
 		virtual bool ReadDirectory(const std::string &path, std::vector<FileInfo> &output);
+		virtual bool ListPaths(std::vector<std::string> &paths);
 
 	private:
 		void *m_archive;
@@ -41,9 +45,29 @@ namespace FileSystem {
 		};
 
 		Directory m_root;
+		// every file and directory in the tree, by normalised path
+		std::unordered_map<std::string, const FileStat *> m_index;
+
+		// the most recently read files, kept inflated up to a total size so
+		// that reading the same file again (shaders reloaded, say) is a copy
+		// of the pointer. Newest at the front.
+		struct CachedFile {
+			RefCountedPtr<FileData> data;
+			std::list<Uint32>::iterator age;
+		};
+		std::unordered_map<Uint32, CachedFile> m_cache;
+		std::list<Uint32> m_cacheAge;
+		size_t m_cacheSize;
+		// the archive is read from loader jobs as well as the main thread
+		std::mutex m_lock;
+
+		const FileStat *FindFile(const std::string &path) const;
+		RefCountedPtr<FileData> FindCached(Uint32 index);
+		void AddToCache(Uint32 index, const RefCountedPtr<FileData> &data);
 
 		bool FindDirectoryAndFile(const std::string &path, const Directory *&dir, std::string &filename);
 		void AddFile(const std::string &path, const FileStat &fileStat);
+		void IndexDirectory(const Directory &dir);
 	};
 
 } // namespace FileSystem
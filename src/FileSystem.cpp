@@ -2,12 +2,17 @@
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
 #include "FileSystem.h"
+#include "FileSourcePack.h"
 #include "StringRange.h"
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <ctime>
 #include <iterator>
 #include <map>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <stdexcept>
 
@@ -15,9 +20,13 @@ namespace FileSystem {
 
 	static FileSourceFS dataFilesApp(GetDataDir(), true);
 	static FileSourceFS dataFilesUser(JoinPath(GetUserDir(), "data"));
+	static std::unique_ptr<FileSourcePack> dataFilesPack;
 	FileSourceUnion gameDataFiles;
 	FileSourceFS userFiles(GetUserDir());
 
+	// made from the data dir by the packdata tool, and installed in it
+	static const char s_dataPackName[] = "data.pak";
+
 	// note: some functions (GetUserDir(), GetDataDir()) are in FileSystem{Posix,Win32}.cpp
 	std::string SanitiseFileName(const std::string &a)
 	{
@@ -189,6 +198,13 @@ namespace FileSystem {
 	void Init()
 	{
 		gameDataFiles.AppendSource(&dataFilesUser);
+		// the pack is ahead of the loose files it was made from, which are
+		// still there for anything it doesn't have
+		if (dataFilesApp.Lookup(s_dataPackName).IsFile()) {
+			dataFilesPack.reset(new FileSourcePack(dataFilesApp, s_dataPackName));
+			if (dataFilesPack->IsOpen())
+				gameDataFiles.AppendSource(dataFilesPack.get());
+		}
 		gameDataFiles.AppendSource(&dataFilesApp);
 	}
 
@@ -246,12 +262,24 @@ namespace FileSystem {
 
 	void FileSourceUnion::RemoveSource(FileSource *fs)
 	{
+		// the index holds positions in m_sources
+		DropIndex();
+
 		std::vector<FileSource *>::iterator nend = std::remove(m_sources.begin(), m_sources.end(), fs);
 		m_sources.erase(nend, m_sources.end());
 	}
 
 	FileInfo FileSourceUnion::Lookup(const std::string &path)
 	{
+		if (const std::vector<uint32_t> *sources = FindInIndex(path)) {
+			for (uint32_t source : *sources) {
+				FileInfo info = m_sources[source]->Lookup(path);
+				if (info.Exists())
+					return info;
+			}
+			return MakeFileInfo(path, FileInfo::FT_NON_EXISTENT);
+		}
+
 		for (std::vector<FileSource *>::const_iterator
 				 it = m_sources.begin();
 			 it != m_sources.end(); ++it) {
@@ -267,6 +295,14 @@ namespace FileSystem {
 	{
 		std::vector<FileInfo> outFiles;
 
+		if (const std::vector<uint32_t> *sources = FindInIndex(path)) {
+			for (uint32_t source : *sources) {
+				FileInfo info = m_sources[source]->Lookup(path);
+				if (info.Exists()) outFiles.push_back(info);
+			}
+			return outFiles;
+		}
+
 		for (FileSource *fs : m_sources) {
 			FileInfo info = fs->Lookup(path);
 			if (info.Exists()) outFiles.push_back(info);
@@ -277,6 +313,15 @@ namespace FileSystem {
 
 	RefCountedPtr<FileData> FileSourceUnion::ReadFile(const std::string &path)
 	{
+		if (const std::vector<uint32_t> *sources = FindInIndex(path)) {
+			for (uint32_t source : *sources) {
+				RefCountedPtr<FileData> data = m_sources[source]->ReadFile(path);
+				if (data)
+					return data;
+			}
+			return RefCountedPtr<FileData>();
+		}
+
 		for (std::vector<FileSource *>::const_iterator
 				 it = m_sources.begin();
 			 it != m_sources.end(); ++it) {
@@ -288,6 +333,314 @@ namespace FileSystem {
 		return RefCountedPtr<FileData>();
 	}
 
+	RefCountedPtr<FileData> FileSourceUnion::MapFile(const std::string &path)
+	{
+		if (const std::vector<uint32_t> *sources = FindInIndex(path)) {
+			for (uint32_t source : *sources) {
+				RefCountedPtr<FileData> data = m_sources[source]->MapFile(path);
+				if (data)
+					return data;
+			}
+			return RefCountedPtr<FileData>();
+		}
+
+		for (FileSource *source : m_sources) {
+			RefCountedPtr<FileData> data = source->MapFile(path);
+			if (data) {
+				return data;
+			}
+		}
+		return RefCountedPtr<FileData>();
+	}
+
+	// Returns the sources that have the path, or null when the index can't
+	// answer for it and every source must be asked
+	const std::vector<uint32_t> *FileSourceUnion::FindInIndex(const std::string &path) const
+	{
+		static const std::vector<uint32_t> noSources;
+
+		if (!m_indexed)
+			return nullptr;
+
+		auto it = m_index.find(path);
+		if (it != m_index.end())
+			return &it->second;
+
+		// paths outside the sources are left to them to refuse
+		if (path.empty() || path[0] == '/')
+			return nullptr;
+
+		// the index holds paths as the sources give them
+		std::string normalised;
+		try {
+			normalised = NormalisePath(path);
+		} catch (const std::invalid_argument &) {
+			return nullptr;
+		}
+		if (normalised == path)
+			return &noSources;
+
+		it = m_index.find(normalised);
+		return it != m_index.end() ? &it->second : &noSources;
+	}
+
+	namespace {
+		const char INDEX_CACHE_MAGIC[4] = { 'P', 'I', 'D', 'X' };
+		const uint32_t INDEX_CACHE_VERSION = 1;
+
+		// The paths of a loose directory, with the modification times of
+		// its directories, which change whenever an entry is added to,
+		// removed from or renamed in them
+		struct DirectoryListing {
+			std::vector<std::pair<std::string, int64_t>> dirs; // from the root, ""
+			std::vector<std::string> files;
+		};
+
+		// The cache file is the magic and version, then for each listing
+		// its root, its dirs and its files. Strings are a uint32_t length
+		// and the characters, counts are uint32_t and times int64_t.
+		class IndexCacheReader {
+		public:
+			IndexCacheReader(const char *data, size_t size) :
+				m_pos(data),
+				m_end(data + size) {}
+
+			bool Ok() const { return m_ok; }
+
+			template <typename T>
+			T Read()
+			{
+				T value = T();
+				if (size_t(m_end - m_pos) < sizeof(T)) {
+					m_ok = false;
+					return value;
+				}
+				memcpy(&value, m_pos, sizeof(T));
+				m_pos += sizeof(T);
+				return value;
+			}
+
+			std::string ReadString()
+			{
+				const uint32_t size = Read<uint32_t>();
+				if (!m_ok || size_t(m_end - m_pos) < size) {
+					m_ok = false;
+					return std::string();
+				}
+				std::string value(m_pos, size);
+				m_pos += size;
+				return value;
+			}
+
+		private:
+			const char *m_pos;
+			const char *m_end;
+			bool m_ok = true;
+		};
+
+		template <typename T>
+		void Append(std::string &out, T value)
+		{
+			out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+		}
+
+		void AppendString(std::string &out, const std::string &value)
+		{
+			Append(out, uint32_t(value.size()));
+			out.append(value);
+		}
+
+		std::map<std::string, DirectoryListing> ReadIndexCache(FileSourceFS &cacheSource, const std::string &cacheFile)
+		{
+			std::map<std::string, DirectoryListing> listings;
+			RefCountedPtr<FileData> data = cacheSource.ReadFile(cacheFile);
+			if (!data)
+				return listings;
+
+			IndexCacheReader reader(data->GetData(), data->GetSize());
+			char magic[4];
+			for (char &c : magic)
+				c = reader.Read<char>();
+			if (memcmp(magic, INDEX_CACHE_MAGIC, sizeof(magic)) != 0 || reader.Read<uint32_t>() != INDEX_CACHE_VERSION)
+				return listings;
+
+			const uint32_t numListings = reader.Read<uint32_t>();
+			for (uint32_t i = 0; i < numListings && reader.Ok(); i++) {
+				DirectoryListing &listing = listings[reader.ReadString()];
+				const uint32_t numDirs = reader.Read<uint32_t>();
+				for (uint32_t j = 0; j < numDirs && reader.Ok(); j++) {
+					std::string path = reader.ReadString();
+					listing.dirs.emplace_back(std::move(path), reader.Read<int64_t>());
+				}
+				const uint32_t numFiles = reader.Read<uint32_t>();
+				for (uint32_t j = 0; j < numFiles && reader.Ok(); j++)
+					listing.files.push_back(reader.ReadString());
+			}
+
+			if (!reader.Ok())
+				listings.clear();
+			return listings;
+		}
+
+		void WriteIndexCache(FileSourceFS &cacheSource, const std::string &cacheFile, const std::map<std::string, DirectoryListing> &listings)
+		{
+			std::string out(INDEX_CACHE_MAGIC, sizeof(INDEX_CACHE_MAGIC));
+			Append(out, INDEX_CACHE_VERSION);
+			Append(out, uint32_t(listings.size()));
+			for (const auto &listing : listings) {
+				AppendString(out, listing.first);
+				Append(out, uint32_t(listing.second.dirs.size()));
+				for (const auto &dir : listing.second.dirs) {
+					AppendString(out, dir.first);
+					Append(out, dir.second);
+				}
+				Append(out, uint32_t(listing.second.files.size()));
+				for (const std::string &file : listing.second.files)
+					AppendString(out, file);
+			}
+
+			FILE *f = cacheSource.OpenWriteStream(cacheFile);
+			if (!f)
+				return;
+			const bool written = fwrite(out.data(), 1, out.size(), f) == out.size();
+			if (fclose(f) != 0 || !written)
+				cacheSource.RemoveFile(cacheFile);
+		}
+
+		bool IsListingCurrent(FileSourceFS &fs, const DirectoryListing &listing)
+		{
+			for (const auto &dir : listing.dirs) {
+				const FileInfo info = fs.Lookup(dir.first);
+				if (!info.IsDir() || info.GetModificationTime().GetTimestamp() != dir.second)
+					return false;
+			}
+			return !listing.dirs.empty();
+		}
+
+		// Returns false if the listing mustn't be cached, as a directory was
+		// modified too recently for a later change to be sure to move its
+		// modification time on
+		bool ListDirectory(FileSourceFS &fs, DirectoryListing &listing)
+		{
+			const std::time_t now = std::time(nullptr) - 2;
+			const std::tm *nowParts = std::localtime(&now);
+			const Time::DateTime settled = nowParts ?
+				Time::DateTime(1900 + nowParts->tm_year, nowParts->tm_mon + 1, nowParts->tm_mday, nowParts->tm_hour, nowParts->tm_min, nowParts->tm_sec) :
+				Time::DateTime();
+
+			const FileInfo root = fs.Lookup("");
+			if (!root.IsDir())
+				return false;
+
+			bool cacheable = root.GetModificationTime() < settled;
+			listing.dirs.emplace_back("", root.GetModificationTime().GetTimestamp());
+			for (FileEnumerator files(fs, "", FileEnumerator::IncludeDirs | FileEnumerator::Recurse); !files.Finished(); files.Next()) {
+				const FileInfo &info = files.Current();
+				if (info.IsDir()) {
+					listing.dirs.emplace_back(info.GetPath(), info.GetModificationTime().GetTimestamp());
+					cacheable = cacheable && info.GetModificationTime() < settled;
+				} else {
+					listing.files.push_back(info.GetPath());
+				}
+			}
+			return cacheable;
+		}
+	} // namespace
+
+	void FileSourceUnion::BuildIndex(FileSourceFS &cacheSource, const std::string &cacheFile)
+	{
+		DropIndex();
+
+		std::map<std::string, DirectoryListing> cached = ReadIndexCache(cacheSource, cacheFile);
+		std::map<std::string, DirectoryListing> listings;
+		bool changed = false;
+
+		std::vector<std::string> paths;
+		for (uint32_t i = 0; i < m_sources.size(); i++) {
+			paths.clear();
+			if (FileSourceFS *fs = dynamic_cast<FileSourceFS *>(m_sources[i])) {
+				auto it = cached.find(fs->GetRoot());
+				DirectoryListing listing;
+				bool cacheable = true;
+				if (it != cached.end() && IsListingCurrent(*fs, it->second)) {
+					listing = std::move(it->second);
+				} else {
+					changed = true;
+					cacheable = ListDirectory(*fs, listing);
+				}
+
+				for (const auto &dir : listing.dirs)
+					if (!dir.first.empty())
+						paths.push_back(dir.first);
+				paths.insert(paths.end(), listing.files.begin(), listing.files.end());
+				if (cacheable)
+					listings.emplace(fs->GetRoot(), std::move(listing));
+			} else if (!m_sources[i]->ListPaths(paths)) {
+				m_index.clear();
+				return;
+			}
+
+			for (const std::string &path : paths) {
+				std::vector<uint32_t> &sources = m_index[path];
+				if (sources.empty() || sources.back() != i)
+					sources.push_back(i);
+			}
+		}
+
+		if (changed || listings.size() != cached.size())
+			WriteIndexCache(cacheSource, cacheFile, listings);
+
+		m_indexed = true;
+	}
+
+	void FileSourceUnion::DropIndex()
+	{
+		m_index.clear();
+		m_indexed = false;
+	}
+
+	// files are read from loader jobs as well as the main thread
+	static std::mutex s_recordLock;
+	static bool s_recording = false;
+	static std::vector<std::string> s_recordedReads;
+	static std::set<std::string> s_recordedPaths;
+
+	void StartRecordingReads()
+	{
+		std::lock_guard<std::mutex> lock(s_recordLock);
+		s_recording = true;
+		s_recordedReads.clear();
+		s_recordedPaths.clear();
+	}
+
+	std::vector<std::string> StopRecordingReads()
+	{
+		std::lock_guard<std::mutex> lock(s_recordLock);
+		s_recording = false;
+		s_recordedPaths.clear();
+		return std::move(s_recordedReads);
+	}
+
+	void RecordRead(const FileSource *source, const std::string &fullPath)
+	{
+		// saves and settings change from run to run, and aren't read at startup
+		if (source == &userFiles)
+			return;
+
+		std::lock_guard<std::mutex> lock(s_recordLock);
+		if (s_recording && s_recordedPaths.insert(fullPath).second)
+			s_recordedReads.push_back(fullPath);
+	}
+
+	void PrefetchFiles(const std::vector<std::string> &fullPaths, const std::atomic<bool> &cancel)
+	{
+		for (const std::string &path : fullPaths) {
+			if (cancel.load(std::memory_order_relaxed))
+				return;
+			PrefetchFile(path);
+		}
+	}
+
 	// Merge two sets of FileInfo's, by path.
 	// Input vectors must be sorted. Output will be sorted.
 	// Where a path is present in both inputs, directories are selected
@@ -8,9 +8,12 @@
 #include "DateTime.h"
 #include "RefCounted.h"
 #include "StringRange.h"
+#include <atomic>
+#include <cstdint>
 #include <deque>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /*
@@ -75,6 +78,21 @@ namespace FileSystem {
 	/// Returns false if sourceDir or targetDir are invalid
 	bool CopyDir(FileSource &sourceFS, const std::string &sourceDir, FileSourceFS &targetFS, const std::string &targetDir, CopyMode copymode = CopyMode::OVERWRITE);
 
+	/// Startup read-ahead. While recording, the full path of each game data
+	/// file read or mapped is kept, in the order they were first read. The
+	/// list from one run can be given to PrefetchFiles at the start of the
+	/// next, to have the files in the OS file cache before they're asked for.
+	void StartRecordingReads();
+	std::vector<std::string> StopRecordingReads();
+
+	/// Bring the files into the OS file cache, stopping early once cancel
+	/// is set. Files which no longer exist are skipped. Safe to call from a job.
+	void PrefetchFiles(const std::vector<std::string> &fullPaths, const std::atomic<bool> &cancel);
+
+	// used by FileSourceFS; PrefetchFile is platform specific
+	void RecordRead(const FileSource *source, const std::string &fullPath);
+	void PrefetchFile(const std::string &fullPath);
+
 	class FileInfo {
 		friend class FileSource;
 
@@ -111,6 +129,8 @@ namespace FileSystem {
 		const FileSource &GetSource() const { return *m_source; }
 
 		RefCountedPtr<FileData> Read() const;
+		// like Read, but maps the file into memory when the source supports it
+		RefCountedPtr<FileData> Map() const;
 
 		friend bool operator==(const FileInfo &a, const FileInfo &b)
 		{
@@ -259,6 +279,15 @@ namespace FileSystem {
 		virtual RefCountedPtr<FileData> ReadFile(const std::string &path) = 0;
 		virtual bool ReadDirectory(const std::string &path, std::vector<FileInfo> &output) = 0;
 
+		// maps the file read-only into memory, so its pages are only loaded
+		// as they're touched and aren't copied; sources which can't do that
+		// read the file instead. The data must not be written to.
+		virtual RefCountedPtr<FileData> MapFile(const std::string &path) { return ReadFile(path); }
+
+		// adds the path of every file and directory in the source, for
+		// sources that hold them all in memory; others return false
+		virtual bool ListPaths(std::vector<std::string> &paths) { return false; }
+
 		virtual FileEnumerator Enumerate(int enumeratorFlags)
 		{
 			return FileEnumerator(*this, enumeratorFlags);
@@ -293,6 +322,7 @@ namespace FileSystem {
 		virtual FileInfo Lookup(const std::string &path);
 		virtual RefCountedPtr<FileData> ReadFile(const std::string &path);
 		virtual bool ReadDirectory(const std::string &path, std::vector<FileInfo> &output);
+		virtual RefCountedPtr<FileData> MapFile(const std::string &path);
 
 		bool MakeDirectory(const std::string &path);
 
@@ -305,6 +335,8 @@ namespace FileSystem {
 		// similar to fopen(path, "wb")
 		FILE *OpenWriteStream(const std::string &path, int flags = 0);
 		bool RemoveFile(const std::string &relativePath);
+		// replaces any file at the new path
+		bool RenameFile(const std::string &relativePath, const std::string &newRelativePath);
 		bool IsChildOfRoot(const std::string &path);
 	};
 
@@ -324,9 +356,25 @@ namespace FileSystem {
 		std::vector<FileInfo> LookupAll(const std::string &path);
 		virtual RefCountedPtr<FileData> ReadFile(const std::string &path);
 		virtual bool ReadDirectory(const std::string &path, std::vector<FileInfo> &output);
+		virtual RefCountedPtr<FileData> MapFile(const std::string &path);
+
+		// Index the paths of all the sources, so that a lookup is one probe
+		// of the index and then only asks the sources that have the path.
+		// The paths of loose directories are kept in cacheFile in
+		// cacheSource and reused while none of their directories'
+		// modification times change. Adding or removing a source drops the index, and paths
+		// created in the sources after it's built aren't found.
+		void BuildIndex(FileSourceFS &cacheSource, const std::string &cacheFile);
+		void DropIndex();
 
 	private:
+		const std::vector<uint32_t> *FindInIndex(const std::string &path) const;
+
 		std::vector<FileSource *> m_sources;
+
+		// path -> the indices of the sources with it, in priority order
+		std::unordered_map<std::string, std::vector<uint32_t>> m_index;
+		bool m_indexed = false;
 	};
 
 } // namespace FileSystem
@@ -346,4 +394,9 @@ inline RefCountedPtr<FileSystem::FileData> FileSystem::FileInfo::Read() const
 	return m_source->ReadFile(m_path);
 }
 
+inline RefCountedPtr<FileSystem::FileData> FileSystem::FileInfo::Map() const
+{
+	return m_source->MapFile(m_path);
+}
+
 #endif
@@ -3,17 +3,34 @@
 
 #include "Frame.h"
 
+#include "BinaryArchive.h"
 #include "GameSaveError.h"
 #include "Json.h"
 #include "JsonUtils.h"
+#include "Orbit.h"
 #include "Sfx.h"
 #include "Space.h"
+#include "collider/CollisionContact.h"
 #include "collider/CollisionSpace.h"
+#include "core/TaskGraph.h"
 #include "utils.h"
 
 std::vector<Frame> Frame::s_frames;
 std::vector<CollisionSpace *> Frame::s_collisionSpaces;
 
+// per-frame contact buffers for CollideFrames, kept around to reuse their storage
+static std::vector<std::vector<CollisionContact>> s_frameContacts;
+// orbits, times and resulting positions of the frames on rails for UpdateOrbitRails
+static std::vector<const Orbit *> s_railOrbits;
+static std::vector<double> s_railTimes;
+static std::vector<vector3d> s_railPositions;
+// incremented by every UpdateOrbitRails, to tell which frames moved this step
+static uint32_t s_railStep = 0;
+
+static Perf::Stats s_stats;
+static Perf::Stats::CounterRef s_rootUpdatedCounter = s_stats.GetOrCreateCounter("Root transforms updated");
+static Perf::Stats::CounterRef s_rootReusedCounter = s_stats.GetOrCreateCounter("Root transforms reused");
+
 Frame::Frame(const Dummy &d, FrameId parent, const char *label, unsigned int flags, double radius) :
 	m_parent(parent),
 	m_sbody(nullptr),
@@ -92,6 +109,8 @@ Frame::Frame(Frame &&other) noexcept :
 	m_rootVel(other.m_rootVel),
 	m_rootPos(other.m_rootPos),
 	m_rootOrient(other.m_rootOrient),
+	m_rootDirty(other.m_rootDirty),
+	m_rootStep(other.m_rootStep),
 	m_rootInterpPos(other.m_rootInterpPos),
 	m_rootInterpOrient(other.m_rootInterpOrient),
 	m_astroBodyIndex(other.m_astroBodyIndex),
@@ -123,6 +142,8 @@ Frame &Frame::operator=(Frame &&other)
 	m_rootVel = other.m_rootVel;
 	m_rootPos = other.m_rootPos;
 	m_rootOrient = other.m_rootOrient;
+	m_rootDirty = other.m_rootDirty;
+	m_rootStep = other.m_rootStep;
 	m_rootInterpPos = other.m_rootInterpPos;
 	m_rootInterpOrient = other.m_rootInterpOrient;
 	m_astroBodyIndex = other.m_astroBodyIndex;
@@ -159,6 +180,29 @@ void Frame::ToJson(Json &frameObj, FrameId fId, Space *space)
 	SfxManager::ToJson(frameObj, f->m_thisId);
 }
 
+void Frame::ToArchive(BinaryArchiveWriter &ar, FrameId fId, Space *space)
+{
+	Frame *f = Frame::GetFrame(fId);
+
+	assert(f != nullptr);
+
+	ar.UInt32(Uint32(f->m_thisId.id()));
+	ar.Int32(f->m_flags);
+	ar.Double(f->m_radius);
+	ar.String(f->m_label);
+	ar.Vector3d(f->m_pos);
+	ar.Double(f->m_angSpeed);
+	ar.Matrix3x3d(f->m_initialOrient);
+	ar.UInt32(space->GetIndexForSystemBody(f->m_sbody));
+	ar.UInt32(space->GetIndexForBody(f->m_astroBody));
+
+	ar.UInt32(f->GetNumChildren());
+	for (FrameId kid : f->GetChildren())
+		Frame::ToArchive(ar, kid, space);
+
+	SfxManager::ToArchive(ar, f->m_thisId);
+}
+
 Frame::~Frame()
 {
 	if (!d.madeWithFactory) {
@@ -232,6 +276,55 @@ FrameId Frame::FromJson(const Json &frameObj, Space *space, FrameId parent, doub
 	return f->GetId();
 }
 
+FrameId Frame::FromArchive(BinaryArchiveReader &ar, Space *space, FrameId parent, double at_time)
+{
+	Dummy dummy;
+	dummy.madeWithFactory = true;
+
+	// as FromJson, the parent adds the child itself
+	s_frames.emplace_back(dummy, FrameId(), nullptr);
+
+	const size_t index = s_frames.size() - 1;
+	Frame *f = &s_frames.back();
+
+	f->m_parent = parent;
+	f->d.madeWithFactory = false;
+
+	try {
+		f->m_thisId = FrameId(ar.UInt32());
+		if (f->m_thisId.id() != index)
+			throw SavedGameCorruptException();
+
+		f->m_flags = ar.Int32();
+		f->m_radius = ar.Double();
+		f->m_label = ar.String();
+
+		f->m_pos = ar.Vector3d();
+		f->m_angSpeed = ar.Double();
+		f->SetInitialOrient(ar.Matrix3x3d(), at_time);
+		f->m_sbody = space->GetSystemBodyByIndex(ar.UInt32());
+		f->m_astroBodyIndex = ar.UInt32();
+		f->m_vel = vector3d(0.0); // m_vel is set to zero.
+
+		const Uint32 numChildren = ar.UInt32();
+		for (Uint32 i = 0; i < numChildren; ++i) {
+			// loading a child may reallocate s_frames, so find 'f' again
+			FrameId temp = f->m_thisId;
+			FrameId kidId = FromArchive(ar, space, f->m_thisId, at_time);
+			f = &s_frames[temp];
+			f->m_children.push_back(kidId);
+		}
+
+		SfxManager::FromArchive(ar, f->m_thisId);
+	} catch (SavedGameCorruptException &) {
+		s_frames[index].d.madeWithFactory = true;
+		throw;
+	}
+
+	f->ClearMovement();
+	return f->GetId();
+}
+
 void Frame::DeleteFrames()
 {
 	// for each set "madeWithFactory"...
@@ -297,16 +390,49 @@ void Frame::PostUnserializeFixup(FrameId fId, Space *space)
 		PostUnserializeFixup(kid, space);
 }
 
-void Frame::CollideFrames(void (*callback)(CollisionContact *))
+void Frame::CollideFrames(void (*callback)(CollisionContact *), TaskGraph *taskGraph)
 {
 	PROFILE_SCOPED()
 
-	for (auto &frame : s_frames) {
-		if (!frame.m_collisionSpace)
+	if (!taskGraph || s_frames.size() < 2) {
+		for (auto &frame : s_frames) {
+			if (!frame.m_collisionSpace)
+				continue;
+
+			PROFILE_SCOPED_DESC(frame.m_label.c_str())
+			frame.m_collisionSpace->Collide(callback);
+		}
+
+		return;
+	}
+
+	// Each frame has its own collision space which doesn't share any state
+	// with the others, so the narrow phase of every frame can run as its own
+	// task. The collision response mutates bodies and isn't thread-safe, so
+	// contacts are buffered per frame and handed to the callback afterwards
+	// in frame order, keeping the results identical to a serial run.
+	if (s_frameContacts.size() < s_frames.size())
+		s_frameContacts.resize(s_frames.size());
+
+	TaskSet *taskSet = new TaskSet();
+	for (size_t idx = 0; idx < s_frames.size(); idx++) {
+		s_frameContacts[idx].clear();
+		if (!s_frames[idx].m_collisionSpace)
 			continue;
 
-		PROFILE_SCOPED_DESC(frame.m_label.c_str())
-		frame.m_collisionSpace->Collide(callback);
+		taskSet->AddTaskLambda({}, [idx](TaskRange) {
+			Frame &frame = s_frames[idx];
+			PROFILE_SCOPED_DESC(frame.m_label.c_str())
+			frame.m_collisionSpace->Collide(s_frameContacts[idx]);
+		});
+	}
+
+	TaskSet::Handle handle = taskGraph->QueueTaskSet(taskSet);
+	taskGraph->WaitForTaskSet(handle);
+
+	for (size_t idx = 0; idx < s_frames.size(); idx++) {
+		for (CollisionContact &contact : s_frameContacts[idx])
+			callback(&contact);
 	}
 }
 
@@ -467,6 +593,11 @@ void Frame::GetFrameTransform(const FrameId fFromId, const FrameId fToId, matrix
 	m.SetTranslate(fpos);
 }
 
+Perf::Stats &Frame::GetStats()
+{
+	return s_stats;
+}
+
 void Frame::ClearMovement()
 {
 	UpdateRootRelativeVars();
@@ -480,28 +611,63 @@ void Frame::ClearMovement()
 void Frame::UpdateOrbitRails(double time, double timestep)
 {
 	PROFILE_SCOPED()
-	std::for_each(begin(s_frames), end(s_frames), [&time, &timestep](Frame &frame) {
+
+	// evaluate the orbits of all frames on rails in one batch, at the start
+	// and end of the step
+	s_railOrbits.clear();
+	s_railTimes.clear();
+	for (const Frame &frame : s_frames) {
+		if (frame.m_parent.valid() && frame.m_sbody && !frame.IsRotFrame()) {
+			s_railOrbits.push_back(&frame.m_sbody->GetOrbit());
+			s_railOrbits.push_back(&frame.m_sbody->GetOrbit());
+			s_railTimes.push_back(time);
+			s_railTimes.push_back(time + timestep);
+		}
+	}
+
+	s_railPositions.resize(s_railOrbits.size());
+	Orbit::OrbitalPosAtTimes(s_railOrbits.size(), s_railOrbits.data(), s_railTimes.data(), s_railPositions.data());
+
+	s_railStep++;
+	uint32_t numUpdated = 0;
+	const vector3d *railPos = s_railPositions.data();
+	std::for_each(begin(s_frames), end(s_frames), [&time, &timestep, &railPos, &numUpdated](Frame &frame) {
 		frame.m_oldPos = frame.m_pos;
 		frame.m_oldAngDisplacement = frame.m_angSpeed * timestep;
 
 		// update frame position and velocity
+		bool moved = frame.m_rootDirty;
 		if (frame.m_parent.valid() && frame.m_sbody && !frame.IsRotFrame()) {
-			frame.m_pos = frame.m_sbody->GetOrbit().OrbitalPosAtTime(time);
-			vector3d pos2 = frame.m_sbody->GetOrbit().OrbitalPosAtTime(time + timestep);
-			frame.m_vel = (pos2 - frame.m_pos) / timestep;
+			frame.m_pos = railPos[0];
+			frame.m_vel = (railPos[1] - frame.m_pos) / timestep;
+			railPos += 2;
+			moved = true;
 		}
 		// temporary test thing
-		else
+		else if (!frame.m_vel.ExactlyEqual(vector3d(0.0))) {
 			frame.m_pos = frame.m_pos + frame.m_vel * timestep;
+			moved = true;
+		}
 
 		// update frame rotation
 		double ang = fmod(frame.m_angSpeed * time, 2.0 * M_PI);
 		if (!is_zero_exact(ang)) {						  // frequently used with e^-10 etc
 			matrix3x3d rot = matrix3x3d::RotateY(-ang);	  // RotateY is backwards
 			frame.m_orient = frame.m_initialOrient * rot; // angvel always +y
+			moved = true;
+		}
+
+		// parents come before their children, so a moved parent has
+		// already been updated this step
+		const Frame *parent = Frame::GetFrame(frame.m_parent);
+		if (moved || (parent && parent->m_rootStep == s_railStep)) {
+			frame.UpdateRootRelativeVars(); // update root-relative pos/vel/orient
+			numUpdated++;
 		}
-		frame.UpdateRootRelativeVars(); // update root-relative pos/vel/orient
 	});
+
+	s_stats.CounterAdd(s_rootUpdatedCounter, numUpdated);
+	s_stats.CounterAdd(s_rootReusedCounter, uint32_t(s_frames.size()) - numUpdated);
 	/*
 	for (FrameId kid : m_children) {
 		Frame *kidFrame = Frame::GetFrame(kid);
@@ -520,6 +686,7 @@ void Frame::SetInitialOrient(const matrix3x3d &m, double time)
 	} else {
 		m_orient = m_initialOrient;
 	}
+	m_rootDirty = true;
 }
 
 void Frame::SetOrient(const matrix3x3d &m, double time)
@@ -532,6 +699,7 @@ void Frame::SetOrient(const matrix3x3d &m, double time)
 	} else {
 		m_initialOrient = m_orient;
 	}
+	m_rootDirty = true;
 }
 
 void Frame::UpdateRootRelativeVars()
@@ -546,4 +714,6 @@ void Frame::UpdateRootRelativeVars()
 		m_rootVel = parent->m_rootOrient * m_vel + parent->m_rootVel;
 		m_rootOrient = parent->m_rootOrient * m_orient;
 	}
+	m_rootDirty = false;
+	m_rootStep = s_railStep;
 }
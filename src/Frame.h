@@ -8,18 +8,22 @@
 
 #include "IterationProxy.h"
 #include "JsonFwd.h"
+#include "PerfStats.h"
 #include "matrix3x3.h"
 #include "matrix4x4.h"
 #include "vector3.h"
 #include <list>
 #include <string>
 
+class BinaryArchiveReader;
+class BinaryArchiveWriter;
 class Body;
 class CollisionSpace;
 class Geom;
 class SystemBody;
 class SfxManager;
 class Space;
+class TaskGraph;
 
 struct CollisionContact;
 
@@ -49,12 +53,15 @@ public:
 
 	static FrameId CreateFrame(FrameId parent, const char *label, unsigned int flags = FLAG_DEFAULT, double radius = 0.0);
 	static FrameId FromJson(const Json &jsonObj, Space *space, FrameId parent, double at_time);
+	static FrameId FromArchive(BinaryArchiveReader &ar, Space *space, FrameId parent, double at_time);
 
 	// Used to speed up creation/deletion of Frame for camera
 	static FrameId CreateCameraFrame(FrameId parent);
 	static void DeleteCameraFrame(FrameId camera);
 
 	static void ToJson(Json &jsonObj, FrameId fId, Space *space);
+	// the same as ToJson, for the thousands of small fields of a big frame tree
+	static void ToArchive(BinaryArchiveWriter &ar, FrameId fId, Space *space);
 	static void PostUnserializeFixup(FrameId fId, Space *space);
 
 	static void DeleteFrames();
@@ -66,13 +73,21 @@ public:
 	const std::string &GetLabel() const { return m_label; }
 	void SetLabel(const char *label) { m_label = label; }
 
-	void SetPosition(const vector3d &pos) { m_pos = pos; }
+	void SetPosition(const vector3d &pos)
+	{
+		m_pos = pos;
+		m_rootDirty = true;
+	}
 	vector3d GetPosition() const { return m_pos; }
 	void SetInitialOrient(const matrix3x3d &m, double time);
 	void SetOrient(const matrix3x3d &m, double time);
 	const matrix3x3d &GetOrient() const { return m_orient; }
 	const matrix3x3d &GetInterpOrient() const { return m_interpOrient; }
-	void SetVelocity(const vector3d &vel) { m_vel = vel; }
+	void SetVelocity(const vector3d &vel)
+	{
+		m_vel = vel;
+		m_rootDirty = true;
+	}
 	vector3d GetVelocity() const { return m_vel; }
 	void SetAngSpeed(const double angspeed) { m_angSpeed = angspeed; }
 	double GetAngSpeed() const { return m_angSpeed; }
@@ -109,7 +124,10 @@ public:
 	CollisionSpace *GetCollisionSpace() const;
 
 	static void UpdateOrbitRails(double time, double timestep);
-	static void CollideFrames(void (*callback)(CollisionContact *));
+	// Collide the geoms of every frame. If a task graph is given, frames are
+	// collided in parallel; contacts are always passed to the callback on the
+	// calling thread, in frame order.
+	static void CollideFrames(void (*callback)(CollisionContact *), TaskGraph *taskGraph = nullptr);
 	void UpdateInterpTransform(double alpha);
 	void ClearMovement();
 
@@ -128,8 +146,12 @@ public:
 	matrix3x3d GetInterpOrientRelTo(FrameId relTo) const;
 	matrix4x4d GetInterpTransformRelTo(FrameId relTo) const;
 
+	// O(1), through the root-relative transforms cached by UpdateOrbitRails
 	static void GetFrameTransform(FrameId fFrom, FrameId fTo, matrix4x4d &m);
 
+	// counts of root-relative transforms updated and reused by UpdateOrbitRails
+	static Perf::Stats &GetStats();
+
 	std::unique_ptr<SfxManager> m_sfx; // the last survivor. actually m_children is pretty grim too.
 
 private:
@@ -160,6 +182,8 @@ private:
 	vector3d m_rootVel; // velocity, position and orient relative to root frame
 	vector3d m_rootPos; // updated by UpdateOrbitRails
 	matrix3x3d m_rootOrient;
+	bool m_rootDirty;	 // set when the position, velocity or orient changes
+	uint32_t m_rootStep; // step the root-relative vars last changed in
 	vector3d m_rootInterpPos;	   // interp position and orient relative to root frame
 	matrix3x3d m_rootInterpOrient; // updated by UpdateInterpTransform
 
@@ -13,9 +13,13 @@
 #include "HyperspaceCloud.h"
 #include "JsonUtils.h"
 #include "MathUtil.h"
+#include "ModelCache.h"
 #include "collider/CollisionSpace.h"
 #include "core/GZipFormat.h"
 #include "galaxy/Economy.h"
+#include "galaxy/Factions.h"
+#include "galaxy/MarketSimulation.h"
+#include "galaxy/Sector.h"
 #include "lua/LuaEvent.h"
 #include "lua/LuaSerializer.h"
 #include "pigui/LuaPiGui.h"
@@ -26,15 +30,19 @@
 #include "Player.h"
 #include "SaveGameManager.h"
 #include "SectorView.h"
+#include "ShipType.h"
 #include "Sfx.h"
 #include "Space.h"
 #include "SpaceStation.h"
+#include "SpaceStationType.h"
 #include "SystemView.h"
 #include "WorldView.h"
 #include "galaxy/GalaxyGenerator.h"
 #include "pigui/PiGuiView.h"
 #include "ship/PlayerShipController.h"
 
+#include <algorithm>
+
 Game::Game(const SystemPath &path, const double startDateTime, const char *shipType) :
 	m_galaxy(GalaxyGenerator::Create()),
 	m_time(startDateTime),
@@ -162,6 +170,7 @@ Game::Game(const Json &jsonObj) :
 
 	// Preparing the Lua stuff
 	Pi::luaSerializer->InitTableRefs();
+	Pi::luaSerializer->LoadIdentities(jsonObj);
 	Pi::luaSerializer->LoadPersistent(jsonObj);
 
 	GalacticEconomy::LoadFromJson(jsonObj);
@@ -196,6 +205,8 @@ Game::Game(const Json &jsonObj) :
 		const Json &gameInfo = jsonObj["game_info"];
 		m_playedDuration = gameInfo.value("duration", 0.0);
 
+		GetMarkets()->LoadFromJson(jsonObj);
+
 	} catch (Json::type_error &) {
 		throw SavedGameCorruptException();
 	}
@@ -251,6 +262,8 @@ void Game::ToJson(Json &jsonObj)
 	m_space->ToJson(jsonObj);
 	jsonObj["player"] = m_space->GetIndexForBody(m_player.get());
 
+	GetMarkets()->SaveToJson(jsonObj);
+
 	// hyperspace clouds being brought over from the previous system
 	Json hyperspaceCloudArray = Json::array(); // Create JSON array to contain hyperspace cloud data.
 	for (std::list<HyperspaceCloud *>::const_iterator i = m_hyperspaceClouds.begin(); i != m_hyperspaceClouds.end(); ++i) {
@@ -270,6 +283,7 @@ void Game::ToJson(Json &jsonObj)
 
 	// lua
 	Pi::luaSerializer->ToJson(jsonObj);
+	Pi::luaSerializer->SaveIdentities(jsonObj);
 
 	// Stuff to show in the preview in load game window
 	// some may be redundant, but this won't require loading up a game to get it all
@@ -352,6 +366,9 @@ void Game::TimeStep(float step)
 
 	SfxManager::TimeStepAll(step, m_space->GetRootFrame());
 
+	if (m_state == State::NORMAL)
+		GetMarkets()->Update(step);
+
 	if (m_state == State::HYPERSPACE) {
 		if (Pi::game->GetTime() >= m_hyperspaceEndTime) {
 			SwitchToNormalSpace();
@@ -369,6 +386,46 @@ void Game::TimeStep(float step)
 	}
 }
 
+GalacticEconomy::MarketSimulation *Game::GetMarkets()
+{
+	SyncMarkets();
+	return m_markets.get();
+}
+
+void Game::SyncMarkets()
+{
+	PROFILE_SCOPED()
+	if (!m_markets)
+		m_markets.reset(new GalacticEconomy::MarketSimulation(GalacticEconomy::Commodities().size() + 1));
+
+	// no markets in hyperspace
+	RefCountedPtr<StarSystem> system = m_state == State::NORMAL ? m_space->GetStarSystem() : RefCountedPtr<StarSystem>();
+	const SystemPath path = system ? system->GetPath() : SystemPath();
+	if (path == m_marketsSystem)
+		return;
+
+	m_markets->Clear();
+	m_marketsSystem = path;
+	if (!system)
+		return;
+
+	// every station in a system trades at the system's prices
+	std::vector<GalacticEconomy::MarketSimulation::Equilibrium> levels(m_markets->GetNumCommodities());
+	for (const GalacticEconomy::CommodityInfo &commodity : GalacticEconomy::Commodities())
+		levels[commodity.id] = GalacticEconomy::MarketSimulation::GetEquilibrium(commodity.price,
+			system->GetCommodityBasePriceModPercent(commodity.id), system->IsCommodityLegal(commodity.id));
+
+	for (const Body *b : m_space->GetBodies()) {
+		if (b->GetType() == ObjectType::SPACESTATION && b->GetSystemBody())
+			m_markets->AddMarket(b->GetSystemBody()->GetPath(), levels);
+	}
+}
+
+static bool IsShipOnRails(const Body *b)
+{
+	return b->IsType(ObjectType::SHIP) && static_cast<const Ship *>(b)->AIIsOnRails();
+}
+
 bool Game::UpdateTimeAccel()
 {
 	PROFILE_SCOPED()
@@ -425,7 +482,8 @@ bool Game::UpdateTimeAccel()
 						newTimeAccel = std::min(newTimeAccel, Game::TIMEACCEL_100X);
 					} else if (dist < std::min(rad + 0.01 * AU, rad * 5.0)) {
 						newTimeAccel = std::min(newTimeAccel, Game::TIMEACCEL_1000X);
-					} else if (dist < std::min(rad + 0.1 * AU, rad * 500.0)) {
+					} else if (dist < std::min(rad + 0.1 * AU, rad * 500.0) && !IsShipOnRails(b)) {
+						// ships cruising on rails don't need the smaller steps
 						newTimeAccel = std::min(newTimeAccel, Game::TIMEACCEL_10000X);
 					}
 				}
@@ -481,6 +539,35 @@ void Game::SwitchToHyperspace()
 	m_hyperspaceSource = m_space->GetStarSystem()->GetPath();
 	m_hyperspaceDest = m_player->GetHyperspaceDest();
 
+	// the destination's police are bound to be about; load their ship
+	// while we're in transit
+	RefCountedPtr<const Sector> destSec = m_galaxy->GetSector(m_hyperspaceDest);
+	if (m_hyperspaceDest.systemIndex < destSec->m_systems.size()) {
+		const Faction *faction = destSec->m_systems[m_hyperspaceDest.systemIndex].GetFaction();
+		auto police = faction ? ShipType::types.find(faction->police_ship) : ShipType::types.end();
+		if (police != ShipType::types.end())
+			Pi::modelCache->Prefetch({ police->second.modelName });
+	}
+
+	// generate the destination system now rather than at exit, and once
+	// it's ready start loading the models of its stations
+	const SystemPath destSystem = m_hyperspaceDest.SystemOnly();
+	m_hyperspaceDestCache = m_galaxy->NewStarSystemSlaveCache();
+	StarSystemCache::Slave *destCache = m_hyperspaceDestCache.Get();
+	destCache->FillCache({ destSystem }, [destCache, destSystem]() {
+		RefCountedPtr<StarSystem> sys = destCache->GetIfCached(destSystem);
+		if (!sys)
+			return;
+		std::vector<std::string> models;
+		for (const SystemBody *sbody : sys->GetSpaceStations()) {
+			Random rand(sbody->GetSeed());
+			const std::string &model = SpaceStationType::ForSystemBody(sbody, rand)->ModelName();
+			if (std::find(models.begin(), models.end(), model) == models.end())
+				models.push_back(model);
+		}
+		Pi::modelCache->Prefetch(models);
+	});
+
 	// find all the departure clouds, convert them to arrival clouds and store
 	// them for the next system
 	m_hyperspaceClouds.clear();
@@ -561,6 +648,9 @@ void Game::SwitchToNormalSpace()
 	m_space.reset(new Space(this, m_galaxy, m_hyperspaceDest, m_space.get()));
 	m_state = State::NORMAL;
 
+	// the new space holds its own reference to the system now
+	m_hyperspaceDestCache.Reset();
+
 	// put the player in it
 	m_player->SetFrame(m_space->GetRootFrame());
 	m_space->AddBody(m_player.get());
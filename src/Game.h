@@ -19,6 +19,10 @@ namespace Graphics {
 	class Renderer;
 }
 
+namespace GalacticEconomy {
+	class MarketSimulation;
+}
+
 struct CannotSaveCurrentGameState {};
 struct CannotSaveInHyperspace : public CannotSaveCurrentGameState {};
 struct CannotSaveDeadPlayer : public CannotSaveCurrentGameState {};
@@ -57,6 +61,9 @@ public:
 	double GetTime() const { return m_time; }
 	Player *GetPlayer() const { return m_player.get(); }
 
+	// commodity markets of the stations in the current system
+	GalacticEconomy::MarketSimulation *GetMarkets();
+
 	// physics step
 	void TimeStep(float step);
 
@@ -98,6 +105,7 @@ public:
 
 	TimeAccel GetTimeAccel() const { return m_timeAccel; }
 	TimeAccel GetRequestedTimeAccel() const { return m_requestedTimeAccel; }
+	bool IsTimeAccelForced() const { return m_forceTimeAccel; }
 	bool IsPaused() const { return m_timeAccel == TIMEACCEL_PAUSED; }
 
 	float GetTimeAccelRate() const { return s_timeAccelRates[m_timeAccel]; }
@@ -147,6 +155,9 @@ private:
 	void SwitchToHyperspace();
 	void SwitchToNormalSpace();
 
+	// rebuilds the markets when the system has changed
+	void SyncMarkets();
+
 	std::unique_ptr<Player> m_player;
 
 	RefCountedPtr<Galaxy> m_galaxy;
@@ -154,6 +165,9 @@ private:
 	std::unique_ptr<Space> m_space;
 	double m_time;
 
+	std::unique_ptr<GalacticEconomy::MarketSimulation> m_markets;
+	SystemPath m_marketsSystem;
+
 	int64_t m_sessionStartTimestamp;
 	double m_playedDuration;
 
@@ -171,6 +185,9 @@ private:
 	double m_hyperspaceProgress;
 	double m_hyperspaceDuration;
 	double m_hyperspaceEndTime;
+	// generates the destination system in the background while in
+	// hyperspace, so exit finds it already cached
+	RefCountedPtr<StarSystemCache::Slave> m_hyperspaceDestCache;
 
 	TimeAccel m_timeAccel;
 	TimeAccel m_requestedTimeAccel;
@@ -34,6 +34,7 @@ GameConfig::GameConfig(const map_string &override_)
 	map["SectorViewZRotation"] = "0";
 	map["SectorViewZoom"] = "2.0";
 	map["MaxPhysicsCyclesPerRender"] = "4";
+	map["PhysicsFrameBudgetMS"] = "0"; // 0 to only limit by MaxPhysicsCyclesPerRender
 	map["AntiAliasingMode"] = "2";
 	map["JoystickDeadzone"] = "0.2"; // 20% deadzone is common
 	map["DefaultLowThrustPower"] = "0.25";
@@ -44,18 +45,42 @@ GameConfig::GameConfig(const map_string &override_)
 	map["EnableCockpit"] = "0";
 	map["HudTrails"] = "0";
 	map["EnableServerAgent"] = "0";
+	map["ServerCompressRequests"] = "0";
 	map["AmountOfBackgroundStars"] = "0.25";
 	map["StarFieldStarSizeFactor"] = "0.7";
 	map["UseAnisotropicFiltering"] = "0";
+	map["SortDrawCommands"] = "1";
+	map["UsePersistentBuffers"] = "1";
+	map["BatchInstancedDraws"] = "1";
+	map["ShaderProgramCache"] = "1";
+	map["ParallelShaderCompile"] = "1";
+	map["StreamTextures"] = "1";
 	map["RendererName"] = "Opengl 3.x"; // default to our best renderer
 	map["EnableGLDebug"] = "0";
 	map["EnableGPUJobs"] = "1";
+	map["GeoPatchDiskCacheMB"] = "256";
+	map["ModelCacheMB"] = "256";
+	map["MemoryBudgetMB"] = "0"; // all of the engine's caches together, 0 for no limit
+	map["PrefetchModels"] = "1";
+	map["GeoPatchFrameBudgetMS"] = "3";
+	map["GeoPatchUploadBudgetKB"] = "4096";
+	map["LuaGCFrameBudgetMS"] = "1";
+	map["IdleFrameRate"] = "20"; // while the 3D view is hidden or static; 0 to always run at full rate
+	map["DynamicResolution"] = "0"; // lower the 3D scene's resolution when over DynamicResolutionTargetMS of GPU time
+	map["DynamicResolutionMinScale"] = "0.5";
+	map["DynamicResolutionTargetMS"] = "14";
+	map["LowLatencyMode"] = "0"; // queue at most one frame and pace frames to vsync, trading frame rate headroom for input latency
+	map["QualityGovernor"] = "0"; // trade terrain and model detail for frame rate
+	map["QualityGovernorTargetFPS"] = "60";
+	map["QualityGovernorMaxJobLatencyMS"] = "500"; // longest wait for terrain patches before detail drops
 	map["GL3ForwardCompatible"] = "1";
 	map["LogVerbose"] = "1";
 	map["ProfileSlowFrames"] = "0";
 	map["ProfilerZoneOutput"] = "0";
+	map["RecordReplay"] = "0"; // record a replay of each game from its start, as Ctrl+R does
 	map["CameraSmoothing"] = "0";
 	map["AimingSensitivity"] = "1.0";
+	map["SaveGameLZ4"] = "0"; // much faster saving and loading, for somewhat bigger files
 
 	Read(FileSystem::userFiles, "config.ini");
 
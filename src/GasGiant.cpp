@@ -6,6 +6,7 @@
 #include "FileSystem.h"
 #include "Game.h"
 #include "GameConfig.h"
+#include "MathUtil.h"
 #include "Pi.h"
 #include "galaxy/AtmosphereParameters.h"
 #include "graphics/Frustum.h"
@@ -20,6 +21,9 @@
 #include "utils.h"
 #include "vcacheopt/vcacheopt.h"
 
+#include <algorithm>
+#include <list>
+
 RefCountedPtr<GasPatchContext> GasGiant::s_patchContext;
 Graphics::RenderTarget *GasGiant::s_renderTarget;
 
@@ -31,6 +35,45 @@ namespace {
 	static float s_initialCPUDelayTime = 60.0f; // (perhaps) 60 seconds seems like a reasonable default
 	static float s_initialGPUDelayTime = 5.0f;	// (perhaps) 5 seconds seems like a reasonable default
 	static std::vector<GasGiant *> s_allGasGiants;
+	static int s_detailBias = 0;
+
+	// Recently generated surface cubemaps, most recently used first, so that
+	// revisiting a system or reloading a save doesn't generate its gas giants
+	// again. Entries are only reused with the settings they were built with.
+	struct CachedSurface {
+		SystemPath path;
+		Uint32 seed;
+		int detail;
+		bool gpu;
+		Uint32 size;
+		RefCountedPtr<Graphics::Texture> texture;
+	};
+	static const size_t SURFACE_CACHE_SIZE = 4;
+	static std::list<CachedSurface> s_surfaceCache;
+
+	// returns the cached surface with faces of at least minSize, if any
+	static const CachedSurface *FindCachedSurface(const SystemBody *sbody, const bool gpu, const Uint32 minSize)
+	{
+		auto it = std::find_if(s_surfaceCache.begin(), s_surfaceCache.end(), [&](const CachedSurface &c) {
+			return c.path == sbody->GetPath() && c.seed == sbody->GetSeed() && c.detail == Pi::detail.planets && c.gpu == gpu && c.size >= minSize;
+		});
+		if (it == s_surfaceCache.end())
+			return nullptr;
+
+		s_surfaceCache.splice(s_surfaceCache.begin(), s_surfaceCache, it);
+		return &*it;
+	}
+
+	static void AddCachedSurface(const SystemBody *sbody, const bool gpu, const Uint32 size, Graphics::Texture *texture)
+	{
+		// a finer texture for the same body supersedes the coarser ones
+		s_surfaceCache.remove_if([&](const CachedSurface &c) {
+			return c.path == sbody->GetPath() && c.gpu == gpu && c.size <= size;
+		});
+		if (s_surfaceCache.size() >= SURFACE_CACHE_SIZE)
+			s_surfaceCache.pop_back();
+		s_surfaceCache.push_front({ sbody->GetPath(), sbody->GetSeed(), Pi::detail.planets, gpu, size, RefCountedPtr<Graphics::Texture>(texture) });
+	}
 
 	static const std::string GGJupiter("GGJupiter");
 	static const std::string GGNeptune("GGNeptune");
@@ -282,9 +325,16 @@ void GasGiant::UpdateAllGasGiants()
 }
 
 // static
+void GasGiant::SetDetailBias(int bias)
+{
+	s_detailBias = std::max(bias, 0);
+}
+
 void GasGiant::OnChangeDetailLevel()
 {
 	s_patchContext.Reset(new GasPatchContext(127));
+	// nothing cached at the old detail level can be used again
+	s_surfaceCache.clear();
 
 	// reinit the geosphere terrain data
 	for (std::vector<GasGiant *>::iterator i = s_allGasGiants.begin(); i != s_allGasGiants.end(); ++i) {
@@ -300,6 +350,8 @@ GasGiant::GasGiant(const SystemBody *body) :
 	BaseSphere(body),
 	m_hasTempCampos(false),
 	m_tempCampos(0.0),
+	m_textureSize(0),
+	m_pendingTextureSize(0),
 	m_hasGpuJobRequest(false),
 	m_timeDelay(s_initialCPUDelayTime)
 {
@@ -347,6 +399,7 @@ void GasGiant::Reset()
 	m_surfaceTextureSmall.Reset();
 	m_surfaceTexture.Reset();
 	m_surfaceMaterial.Reset();
+	m_textureSize = 0;
 }
 
 //static
@@ -422,6 +475,8 @@ bool GasGiant::AddTextureFaceResult(GasGiantJobs::STextureFaceResult *res)
 		tcd.posZ = m_jobColorBuffers[4].get();
 		tcd.negZ = m_jobColorBuffers[5].get();
 		m_surfaceTexture->Update(tcd, dataSize, Graphics::TEXTURE_RGBA_8888);
+		m_textureSize = uvDims;
+		AddCachedSurface(GetSystemBody(), false, m_textureSize, m_surfaceTexture.Get());
 
 		// cleanup the temporary color buffer storage
 		for (int i = 0; i < NUM_PATCHES; i++) {
@@ -459,6 +514,8 @@ bool GasGiant::AddGPUGenResult(GasGiantJobs::SGPUGenResult *res)
 
 		// these won't be automatically generated otherwise since we used it as a render target
 		m_surfaceTexture->BuildMipmaps();
+		m_textureSize = m_pendingTextureSize;
+		AddCachedSurface(GetSystemBody(), true, m_textureSize, m_surfaceTexture.Get());
 
 		// change the planet texture for the new higher resolution texture
 		if (m_surfaceMaterial.Get()) {
@@ -477,18 +534,63 @@ inline vector3d GetSpherePointFromCorners(const double x, const double y, const
 	return (corners[0] + x * (1.0 - y) * (corners[1] - corners[0]) + x * y * (corners[2] - corners[0]) + (1.0 - x) * y * (corners[3] - corners[0])).Normalized();
 }
 
-void GasGiant::GenerateTexture()
+bool GasGiant::IsGeneratingTexture() const
 {
-	using namespace GasGiantJobs;
+	if (m_hasGpuJobRequest)
+		return true;
 	for (int i = 0; i < NUM_PATCHES; i++) {
-		if (m_hasGpuJobRequest || m_hasJobRequest[i])
-			return;
+		if (m_hasJobRequest[i])
+			return true;
 	}
+	return false;
+}
 
+Uint32 GasGiant::GetTargetTextureSize() const
+{
 	const bool bEnableGPUJobs = (Pi::config->Int("EnableGPUJobs") == 1);
+	const Uint32 detailSize = bEnableGPUJobs ? s_texture_size_gpu[Pi::detail.planets] : s_texture_size_cpu[Pi::detail.planets];
+	const Uint32 minSize = std::min(s_texture_size_small * 2, detailSize);
+	const Uint32 maxSize = std::max(detailSize >> s_detailBias, minSize);
+	// not drawn yet, so start small and refine once it is
+	if (!m_hasTempCampos)
+		return minSize;
+
+	// radius of the body on screen in pixels; campos is in body radii. A
+	// cube face covers about one radius of the visible disc, so there's no
+	// point in giving it many more texels than that
+	const double dist = std::max(m_tempCampos.Length(), 1.0);
+	const double screenRadius = Pi::renderer->GetWindowHeight() / (Graphics::GetFovFactor() * dist);
+	const Uint32 size = ceil_pow2(Uint32(std::min(screenRadius, double(maxSize))));
+	return Clamp(size, minSize, maxSize);
+}
 
-	// scope the small texture generation
-	{
+void GasGiant::GenerateTexture(const Uint32 size)
+{
+	using namespace GasGiantJobs;
+	if (IsGeneratingTexture())
+		return;
+
+	const bool bEnableGPUJobs = (Pi::config->Int("EnableGPUJobs") == 1);
+
+	// generated recently, so there's nothing to do
+	if (const CachedSurface *cached = FindCachedSurface(GetSystemBody(), bEnableGPUJobs, size)) {
+		m_surfaceTexture = cached->texture;
+		m_textureSize = cached->size;
+		if (m_surfaceMaterial.Get()) {
+			m_surfaceMaterial->SetTexture("texture0"_hash, m_surfaceTexture.Get());
+			m_surfaceTextureSmall.Reset();
+		}
+		return;
+	}
+
+	m_pendingTextureSize = size;
+	// the first texture is wanted on screen as soon as possible, refinements
+	// of one that's already showing are not urgent
+	const JobPriority priority = m_surfaceTexture.Valid() ? JobPriority::Background : JobPriority::Streaming;
+
+	// scope the small texture generation, only needed until there's a
+	// proper texture to show
+	if (!m_surfaceTexture.Valid()) {
 		const vector2f texSize(1.0f, 1.0f);
 		const vector3f dataSize(s_texture_size_small, s_texture_size_small, 0.0f);
 		const Graphics::TextureDescriptor texDesc(
@@ -542,14 +644,14 @@ void GasGiant::GenerateTexture()
 			assert(!m_hasJobRequest[i]);
 			assert(!m_job[i].HasJob());
 			m_hasJobRequest[i] = true;
-			GasGiantJobs::STextureFaceRequest *ssrd = new GasGiantJobs::STextureFaceRequest(&GetPatchFaces(i, 0), GetSystemBody()->GetPath(), i, s_texture_size_cpu[Pi::detail.planets], GetTerrain());
-			m_job[i] = Pi::GetAsyncJobQueue()->Queue(new GasGiantJobs::SingleTextureFaceJob(ssrd));
+			GasGiantJobs::STextureFaceRequest *ssrd = new GasGiantJobs::STextureFaceRequest(&GetPatchFaces(i, 0), GetSystemBody()->GetPath(), i, size, GetTerrain());
+			m_job[i] = Pi::GetAsyncJobQueue()->Queue(new GasGiantJobs::SingleTextureFaceJob(ssrd), nullptr, priority);
 		}
 	} else {
 		// use m_surfaceTexture texture?
 		// create texture
 		const vector2f texSize(1.0f, 1.0f);
-		const vector3f dataSize(s_texture_size_gpu[Pi::detail.planets], s_texture_size_gpu[Pi::detail.planets], 0.0f);
+		const vector3f dataSize(size, size, 0.0f);
 		const Graphics::TextureDescriptor texDesc(
 			Graphics::TEXTURE_RGBA_8888,
 			dataSize, texSize, Graphics::LINEAR_CLAMP,
@@ -581,10 +683,10 @@ void GasGiant::GenerateTexture()
 		const std::string parentname = GetSystemBody()->GetParent()->GetName();
 		const float hueShift = (parentname == "Sol") ? 0.0f : float(((rng.Double() * 2.0) - 1.0) * 0.9);
 
-		GasGiantJobs::GenFaceQuad *pQuad = new GasGiantJobs::GenFaceQuad(Pi::renderer, vector2f(s_texture_size_gpu[Pi::detail.planets], s_texture_size_gpu[Pi::detail.planets]), GasGiantType);
+		GasGiantJobs::GenFaceQuad *pQuad = new GasGiantJobs::GenFaceQuad(Pi::renderer, vector2f(size, size), GasGiantType);
 
-		GasGiantJobs::SGPUGenRequest *pGPUReq = new GasGiantJobs::SGPUGenRequest(GetSystemBody()->GetPath(), s_texture_size_gpu[Pi::detail.planets], GetTerrain(), GetSystemBody()->GetRadius(), hueShift, pQuad, m_builtTexture.Get());
-		m_gpuJob = Pi::GetSyncJobQueue()->Queue(new GasGiantJobs::SingleGPUGenJob(pGPUReq));
+		GasGiantJobs::SGPUGenRequest *pGPUReq = new GasGiantJobs::SGPUGenRequest(GetSystemBody()->GetPath(), size, GetTerrain(), GetSystemBody()->GetRadius(), hueShift, pQuad, m_builtTexture.Get());
+		m_gpuJob = Pi::GetSyncJobQueue()->Queue(new GasGiantJobs::SingleGPUGenJob(pGPUReq), nullptr, priority);
 		m_hasGpuJobRequest = true;
 	}
 }
@@ -609,17 +711,20 @@ void GasGiant::Update()
 void GasGiant::Render(Graphics::Renderer *renderer, const matrix4x4d &modelView, vector3d campos, const float radius, const std::vector<Camera::Shadow> &shadows)
 {
 	PROFILE_SCOPED()
+	// store this for later usage in the update method.
+	m_tempCampos = campos;
+	m_hasTempCampos = true;
+
 	if (!m_surfaceTexture.Valid()) {
 		// Use the fact that we have a patch as a latch to prevent repeat generation requests.
 		if (!m_patches[0].get()) {
 			BuildFirstPatches();
 		}
+	} else if (GetTargetTextureSize() >= m_textureSize * 2) {
+		// the body has grown on screen, refine the texture a step at a time
+		GenerateTexture(std::min(GetTargetTextureSize(), m_textureSize * 4));
 	}
 
-	// store this for later usage in the update method.
-	m_tempCampos = campos;
-	m_hasTempCampos = true;
-
 	matrix4x4d trans = modelView;
 	trans.Translate(-campos.x, -campos.y, -campos.z);
 	renderer->SetTransform(matrix4x4f(trans)); //need to set this for the following line to work
@@ -635,8 +740,7 @@ void GasGiant::Render(Graphics::Renderer *renderer, const matrix4x4d &modelView,
 		SetUpMaterials();
 
 	//Update material parameters
-	//XXX no need to calculate AP every frame
-	auto ap = GetSystemBody()->CalcAtmosphereParams();
+	const AtmosphereParameters &ap = m_atmosParams;
 	SetMaterialParameters(trans, radius, shadows, ap);
 	if (ap.atmosDensity > 0.0) {
 		// make atmosphere sphere slightly bigger than required so
@@ -687,8 +791,7 @@ void GasGiant::SetUpMaterials()
 	surfDesc.textures = 1;
 
 	//planetoid with atmosphere
-	const AtmosphereParameters ap(GetSystemBody()->CalcAtmosphereParams());
-	assert(ap.atmosDensity > 0.0);
+	assert(m_atmosParams.atmosDensity > 0.0);
 	assert(m_surfaceTextureSmall.Valid() || m_surfaceTexture.Valid());
 
 	// surface material is solid
@@ -738,7 +841,7 @@ void GasGiant::BuildFirstPatches()
 	m_patches[4].reset(new GasPatch(s_patchContext, this, p3, p2, p6, p7));
 	m_patches[5].reset(new GasPatch(s_patchContext, this, p8, p7, p6, p5));
 
-	GenerateTexture();
+	GenerateTexture(GetTargetTextureSize());
 }
 
 void GasGiant::InitGasGiant()
@@ -767,6 +870,7 @@ void GasGiant::InitGasGiant()
 void GasGiant::UninitGasGiant()
 {
 	s_patchContext.Reset();
+	s_surfaceCache.clear();
 }
 
 //static
@@ -51,6 +51,10 @@ public:
 	static void UninitGasGiant();
 	static void UpdateAllGasGiants();
 	static void OnChangeDetailLevel();
+	// Halvings of the surface texture size to give up relative to the
+	// planet detail setting, see QualityGovernor. Only affects textures
+	// generated from now on, and can't go above the setting.
+	static void SetDetailBias(int bias);
 
 	static void CreateRenderTarget(const Uint16 width, const Uint16 height);
 	static void SetRenderTargetCubemap(const Uint32, Graphics::Texture *, const bool unBind = true);
@@ -58,7 +62,12 @@ public:
 
 private:
 	void BuildFirstPatches();
-	void GenerateTexture();
+	// generates a surface cubemap with faces of the given size, replacing
+	// the current one once it's ready
+	void GenerateTexture(Uint32 size);
+	// face size worth generating for the body's last seen screen size
+	Uint32 GetTargetTextureSize() const;
+	bool IsGeneratingTexture() const;
 	bool AddTextureFaceResult(GasGiantJobs::STextureFaceResult *res);
 	bool AddGPUGenResult(GasGiantJobs::SGPUGenResult *res);
 
@@ -75,6 +84,8 @@ private:
 	RefCountedPtr<Graphics::Texture> m_surfaceTextureSmall;
 	RefCountedPtr<Graphics::Texture> m_surfaceTexture;
 	RefCountedPtr<Graphics::Texture> m_builtTexture;
+	Uint32 m_textureSize; // face size of m_surfaceTexture, zero if there isn't one
+	Uint32 m_pendingTextureSize; // face size being generated
 
 	std::unique_ptr<Color[]> m_jobColorBuffers[NUM_PATCHES];
 	Job::Handle m_job[NUM_PATCHES];
@@ -20,6 +20,7 @@
 #include "perlin.h"
 #include "profiler/Profiler.h"
 #include "vcacheopt/vcacheopt.h"
+#include <SDL_timer.h>
 #include <algorithm>
 #include <deque>
 
@@ -36,6 +37,8 @@
 // tri edge lengths
 static const double GEOPATCH_SUBDIVIDE_AT_CAMDIST = 5.0;
 
+size_t GeoPatch::s_heightDataBytes = 0;
+
 GeoPatch::GeoPatch(const RefCountedPtr<GeoPatchContext> &ctx_, GeoSphere *gs,
 	const vector3d &v0_, const vector3d &v1_, const vector3d &v2_, const vector3d &v3_,
 	const int depth, const GeoPatchID &ID_) :
@@ -77,6 +80,8 @@ GeoPatch::~GeoPatch()
 	for (int i = 0; i < NUM_KIDS; i++) {
 		m_kids[i].reset();
 	}
+	if (m_heights)
+		s_heightDataBytes -= HeightDataSize();
 	m_heights.reset();
 	m_normals.reset();
 	m_colors.reset();
@@ -90,7 +95,7 @@ void GeoPatch::UpdateVBOs(Graphics::Renderer *renderer)
 		m_needUpdateVBOs = false;
 
 		//create buffer and upload data
-		auto vbd = Graphics::VertexBufferDesc::FromAttribSet(Graphics::ATTRIB_POSITION | Graphics::ATTRIB_NORMAL | Graphics::ATTRIB_DIFFUSE | Graphics::ATTRIB_UV0);
+		auto vbd = GeoPatchContext::GetVertexBufferDesc();
 		vbd.numVertices = m_ctx->NUMVERTICES();
 		vbd.usage = Graphics::BUFFER_USAGE_STATIC;
 		Graphics::VertexBuffer *vtxBuffer = renderer->CreateVertexBuffer(vbd);
@@ -121,8 +126,7 @@ void GeoPatch::UpdateVBOs(Graphics::Renderer *renderer)
 				vtxPtr->pos = vector3f(p);
 				++pHts; // next height
 
-				const vector3f norma(pNorm->Normalized());
-				vtxPtr->norm = norma;
+				vtxPtr->norm = GeoPatchContext::PackNormal(pNorm->Normalized());
 				++pNorm; // next normal
 
 				vtxPtr->col[0] = pColr->r;
@@ -132,8 +136,7 @@ void GeoPatch::UpdateVBOs(Graphics::Renderer *renderer)
 				++pColr; // next colour
 
 				// uv coords
-				vtxPtr->uv.x = 1.0f - xFrac;
-				vtxPtr->uv.y = yFrac;
+				vtxPtr->uv = GeoPatchContext::PackUV(1.0f - xFrac, yFrac);
 
 				++vtxPtr; // next vertex
 			}
@@ -332,7 +335,7 @@ void GeoPatch::LODUpdate(const vector3d &campos, const Graphics::Frustum &frustu
 	if (m_parent) {
 		centroidDist = (campos - m_centroid).Length();		 // distance from camera to centre of the patch
 		const bool tooFar = (centroidDist >= m_roughLength); // check if the distance is greater than the rough length, which is how far it should be before it can split
-		if (m_depth >= std::min(GEOPATCH_MAX_DEPTH, m_geosphere->GetMaxDepth()) || tooFar) {
+		if (m_depth >= std::min(GEOPATCH_MAX_DEPTH, m_geosphere->GetMaxSplitDepth()) || tooFar) {
 			canSplit = false; // we're too deep in the quadtree or too far away so cannot split
 		}
 	}
@@ -362,13 +365,14 @@ void GeoPatch::LODUpdate(const vector3d &campos, const Graphics::Frustum &frustu
 			// we can see this patch so submit the jobs!
 			assert(!m_HasJobRequest);
 			m_HasJobRequest = true;
+			m_requestTicks = SDL_GetTicks();
 
 			SQuadSplitRequest *ssrd = new SQuadSplitRequest(m_v0, m_v1, m_v2, m_v3, m_centroid.Normalized(), m_depth,
 				m_geosphere->GetSystemBody()->GetPath(), m_PatchID, m_ctx->GetEdgeLen() - 2,
 				m_ctx->GetFrac(), m_geosphere->GetTerrain());
 
 			// add to the GeoSphere to be processed at end of all LODUpdate requests
-			m_geosphere->AddQuadSplitRequest(centroidDist, ssrd, this);
+			m_geosphere->AddQuadSplitRequest(GetSplitError(campos), ssrd, this);
 		} else {
 			for (int i = 0; i < NUM_KIDS; i++) {
 				m_kids[i]->LODUpdate(campos, frustum);
@@ -386,6 +390,14 @@ void GeoPatch::LODUpdate(const vector3d &campos, const Graphics::Frustum &frustu
 	}
 }
 
+double GeoPatch::GetSplitError(const vector3d &campos) const
+{
+	if (!m_parent)
+		return DBL_MAX;
+
+	return m_roughLength / std::max((campos - m_centroid).Length(), DBL_EPSILON);
+}
+
 void GeoPatch::RequestSinglePatch()
 {
 	if (!m_heights) {
@@ -393,7 +405,7 @@ void GeoPatch::RequestSinglePatch()
 		m_HasJobRequest = true;
 		SSingleSplitRequest *ssrd = new SSingleSplitRequest(m_v0, m_v1, m_v2, m_v3, m_centroid.Normalized(), m_depth,
 			m_geosphere->GetSystemBody()->GetPath(), m_PatchID, m_ctx->GetEdgeLen() - 2, m_ctx->GetFrac(), m_geosphere->GetTerrain());
-		m_job = Pi::GetAsyncJobQueue()->Queue(new SinglePatchJob(ssrd));
+		m_job = Pi::GetAsyncJobQueue()->Queue(new SinglePatchJob(ssrd), nullptr, JobPriority::Interactive);
 	}
 }
 
@@ -427,6 +439,7 @@ void GeoPatch::ReceiveHeightmaps(SQuadSplitResult *psr)
 			m_kids[i]->ReceiveHeightResult(psr->data(i));
 		}
 		m_HasJobRequest = false;
+		GeoSphere::ReportSplitLatency(double(SDL_GetTicks() - m_requestTicks));
 	}
 }
 
@@ -441,8 +454,19 @@ void GeoPatch::ReceiveHeightmap(const SSingleSplitResult *psr)
 	m_HasJobRequest = false;
 }
 
+size_t GeoPatch::HeightDataSize() const
+{
+	// skirt vertices are not present in the heights array
+	const size_t edgeLen = m_ctx->GetEdgeLen() - 2;
+	return edgeLen * edgeLen * sizeof(double);
+}
+
 void GeoPatch::ReceiveHeightResult(const SSplitResultData &data)
 {
+	if (m_heights)
+		s_heightDataBytes -= HeightDataSize();
+	if (data.heights)
+		s_heightDataBytes += HeightDataSize();
 	m_heights.reset(data.heights);
 	m_normals.reset(data.normals);
 	m_colors.reset(data.colors);
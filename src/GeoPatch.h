@@ -45,6 +45,9 @@ public:
 
 	~GeoPatch();
 
+	// bytes of height data held by all patches, for the memory budget
+	static size_t GetHeightDataSize() { return s_heightDataBytes; }
+
 	inline void NeedToUpdateVBOs()
 	{
 		m_needUpdateVBOs = (nullptr != m_heights);
@@ -69,6 +72,10 @@ public:
 
 	void Render(Graphics::Renderer *r, const vector3d &campos, const matrix4x4d &modelView, const Graphics::Frustum &frustum);
 
+	// rough screen-space error of this patch seen from campos, used to order
+	// split requests. Root patches always come first.
+	double GetSplitError(const vector3d &campos) const;
+
 	inline bool canBeMerged() const
 	{
 		bool merge = true;
@@ -93,6 +100,9 @@ public:
 
 private:
 	static const int NUM_KIDS = 4;
+	static size_t s_heightDataBytes;
+
+	size_t HeightDataSize() const;
 
 	RefCountedPtr<GeoPatchContext> m_ctx;
 	const vector3d m_v0, m_v1, m_v2, m_v3;
@@ -112,6 +122,7 @@ private:
 	const GeoPatchID m_PatchID;
 	Job::Handle m_job;
 	bool m_HasJobRequest;
+	Uint32 m_requestTicks = 0; // when the pending quad split was asked for
 #ifdef DEBUG_BOUNDING_SPHERES
 	std::unique_ptr<Graphics::Drawables::Sphere3D> m_boundsphere;
 #endif
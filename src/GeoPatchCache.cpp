@@ -0,0 +1,369 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "GeoPatchCache.h"
+
+#include "FileSystem.h"
+#include "core/FNV1a.h"
+#include "core/LZ4Format.h"
+#include "core/Log.h"
+#include "core/StringUtils.h"
+#include "profiler/Profiler.h"
+#include "scenegraph/Serializer.h"
+#include "terrain/Terrain.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+	static const std::string CACHE_DIR = "geopatch_cache";
+	static const std::string CACHE_EXTENSION = ".gpc";
+
+	static const Uint32 CACHE_MAGIC = 0x31435047; // "GPC1"
+	// bump this whenever the terrain generators or the patch data layout change
+	static const Uint32 CACHE_VERSION = 1;
+
+	// lz4 frame compression; favour speed since patches are written from worker threads
+	static const int CACHE_LZ4_PRESET = 0;
+
+	struct CacheEntry {
+		size_t size;
+		std::list<uint64_t>::iterator lru;
+	};
+
+	std::mutex s_cacheMutex;
+	bool s_cacheEnabled = false;
+	size_t s_maxSize = 0;
+	size_t s_totalSize = 0;
+
+	// most recently used at the front
+	std::list<uint64_t> s_lru;
+	std::unordered_map<uint64_t, CacheEntry> s_entries;
+
+	std::string GetCacheFilename(const uint64_t hash)
+	{
+		return FileSystem::JoinPath(CACHE_DIR, fmt::format("{:016x}{}", hash, CACHE_EXTENSION));
+	}
+
+	// caller must hold s_cacheMutex
+	void InsertEntry(const uint64_t hash, const size_t size)
+	{
+		s_lru.push_front(hash);
+		s_entries[hash] = CacheEntry{ size, s_lru.begin() };
+		s_totalSize += size;
+	}
+
+	// caller must hold s_cacheMutex
+	void RemoveEntry(const uint64_t hash)
+	{
+		auto iter = s_entries.find(hash);
+		if (iter == s_entries.end())
+			return;
+
+		s_totalSize -= iter->second.size;
+		s_lru.erase(iter->second.lru);
+		s_entries.erase(iter);
+	}
+
+	// caller must hold s_cacheMutex; returns the files which should be deleted
+	std::vector<uint64_t> EvictEntries()
+	{
+		std::vector<uint64_t> evicted;
+		while (s_totalSize > s_maxSize && !s_lru.empty()) {
+			const uint64_t hash = s_lru.back();
+			RemoveEntry(hash);
+			evicted.push_back(hash);
+		}
+		return evicted;
+	}
+
+	void RemoveFiles(const std::vector<uint64_t> &hashes)
+	{
+		for (const uint64_t hash : hashes)
+			FileSystem::userFiles.RemoveFile(GetCacheFilename(hash));
+	}
+
+	size_t GetNumVertices(const GeoPatchCache::Key &key)
+	{
+		return size_t(key.edgeLen) * key.edgeLen;
+	}
+
+	void WriteKey(Serializer::Writer &wr, const GeoPatchCache::Key &key)
+	{
+		wr.Int32(key.path.sectorX);
+		wr.Int32(key.path.sectorY);
+		wr.Int32(key.path.sectorZ);
+		wr.Int32(key.path.systemIndex);
+		wr.Int32(key.path.bodyIndex);
+		wr.Int32(key.seed);
+		wr.Int64(key.terrainHash);
+		wr.Int64(key.patchID);
+		wr.Int32(key.depth);
+		wr.Int32(key.edgeLen);
+	}
+
+	bool ReadKeyMatches(Serializer::Reader &rd, const GeoPatchCache::Key &key)
+	{
+		bool match = true;
+		match &= Sint32(rd.Int32()) == key.path.sectorX;
+		match &= Sint32(rd.Int32()) == key.path.sectorY;
+		match &= Sint32(rd.Int32()) == key.path.sectorZ;
+		match &= rd.Int32() == key.path.systemIndex;
+		match &= rd.Int32() == key.path.bodyIndex;
+		match &= rd.Int32() == key.seed;
+		match &= rd.Int64() == key.terrainHash;
+		match &= rd.Int64() == key.patchID;
+		match &= rd.Int32() == key.depth;
+		match &= rd.Int32() == key.edgeLen;
+		return match;
+	}
+
+	// magic, version, 10 key fields (two of them 64-bit)
+	static const size_t HEADER_SIZE = sizeof(Uint32) * 10 + sizeof(Uint64) * 2;
+
+	// Read a blob of exactly size bytes
+	bool ReadArray(Serializer::Reader &rd, void *out, const size_t size)
+	{
+		if (!rd.Check(sizeof(Uint32)))
+			return false;
+
+		ByteRange range = rd.Blob();
+		if (range.Size() != size)
+			return false;
+
+		memcpy(out, range.begin, size);
+		return true;
+	}
+
+} // namespace
+
+GeoPatchCache::Key::Key(const SystemPath &path_, const Terrain *terrain, const GeoPatchID &patchID_, const int depth_, const int edgeLen_) :
+	path(path_),
+	seed(terrain->GetSeed()),
+	patchID(patchID_.GetValue()),
+	depth(depth_),
+	edgeLen(edgeLen_)
+{
+	const std::string terrainName = fmt::format("{}:{}:{:016x}",
+		terrain->GetHeightFractalName(), terrain->GetColorFractalName(), terrain->GetParametersHash());
+	terrainHash = hash_64_fnv1a(terrainName.data(), terrainName.size());
+}
+
+uint64_t GeoPatchCache::Key::Hash() const
+{
+	Serializer::Writer wr;
+	WriteKey(wr, *this);
+	const std::string &data = wr.GetData();
+	return hash_64_fnv1a(data.data(), data.size());
+}
+
+// static
+void GeoPatchCache::Init(const size_t maxSizeMB)
+{
+	PROFILE_SCOPED()
+	std::lock_guard<std::mutex> lock(s_cacheMutex);
+	s_lru.clear();
+	s_entries.clear();
+	s_totalSize = 0;
+	s_maxSize = maxSizeMB * 1024 * 1024;
+	s_cacheEnabled = false;
+
+	if (!s_maxSize)
+		return;
+
+	if (!FileSystem::userFiles.MakeDirectory(CACHE_DIR)) {
+		Log::Warning("GeoPatchCache: unable to create cache directory '{}', disk cache disabled\n", CACHE_DIR);
+		return;
+	}
+
+	// rebuild the index from the files left by previous sessions, using the
+	// modification time to approximate their LRU order
+	std::vector<FileSystem::FileInfo> files;
+	FileSystem::userFiles.ReadDirectory(CACHE_DIR, files);
+	std::sort(files.begin(), files.end(), [](const FileSystem::FileInfo &a, const FileSystem::FileInfo &b) {
+		return a.GetModificationTime() < b.GetModificationTime();
+	});
+
+	std::vector<uint64_t> invalid;
+	for (const FileSystem::FileInfo &info : files) {
+		if (!info.IsFile() || !ends_with_ci(info.GetName(), CACHE_EXTENSION))
+			continue;
+
+		char *end = nullptr;
+		const std::string name = info.GetName();
+		const uint64_t hash = strtoull(name.c_str(), &end, 16);
+		if (end != name.c_str() + name.size() - CACHE_EXTENSION.size())
+			continue;
+
+		FILE *f = FileSystem::userFiles.OpenReadStream(info.GetPath());
+		if (!f)
+			continue;
+
+		fseek(f, 0, SEEK_END);
+		const long size = ftell(f);
+		fclose(f);
+
+		if (size <= 0) {
+			invalid.push_back(hash);
+			continue;
+		}
+
+		InsertEntry(hash, size_t(size));
+	}
+
+	s_cacheEnabled = true;
+	const std::vector<uint64_t> evicted = EvictEntries();
+
+	Log::Info("GeoPatchCache: {} cached patches ({:.1f} of {} MB)\n",
+		s_entries.size(), s_totalSize / (1024.0 * 1024.0), maxSizeMB);
+
+	RemoveFiles(invalid);
+	RemoveFiles(evicted);
+}
+
+// static
+void GeoPatchCache::Uninit()
+{
+	std::lock_guard<std::mutex> lock(s_cacheMutex);
+	s_cacheEnabled = false;
+	s_lru.clear();
+	s_entries.clear();
+	s_totalSize = 0;
+}
+
+// static
+bool GeoPatchCache::Load(const Key &key, double *heights, vector3f *normals, Color3ub *colors)
+{
+	PROFILE_SCOPED()
+	const uint64_t hash = key.Hash();
+
+	{
+		std::lock_guard<std::mutex> lock(s_cacheMutex);
+		if (!s_cacheEnabled)
+			return false;
+
+		auto iter = s_entries.find(hash);
+		if (iter == s_entries.end())
+			return false;
+
+		// mark as most recently used
+		s_lru.splice(s_lru.begin(), s_lru, iter->second.lru);
+	}
+
+	const std::string filename = GetCacheFilename(hash);
+	RefCountedPtr<FileSystem::FileData> file = FileSystem::userFiles.ReadFile(filename);
+	if (!file) {
+		// the file was evicted or went missing since it was indexed
+		std::lock_guard<std::mutex> lock(s_cacheMutex);
+		RemoveEntry(hash);
+		return false;
+	}
+
+	const ByteRange bin = file->AsByteRange();
+	const size_t numVerts = GetNumVertices(key);
+	bool valid = false;
+
+	try {
+		if (bin.Size() >= sizeof(Uint32) && lz4::IsLZ4Format(bin.begin, bin.Size())) {
+			const std::string data = lz4::DecompressLZ4({ bin.begin, bin.Size() });
+			Serializer::Reader rd(ByteRange(data.data(), data.size()));
+
+			// the same hash may have a different key on a collision; treat as a miss
+			if (rd.Check(HEADER_SIZE) && rd.Int32() == CACHE_MAGIC && rd.Int32() == CACHE_VERSION) {
+				if (!ReadKeyMatches(rd, key))
+					return false;
+
+				// decode into temporaries so a truncated file doesn't leave partial results
+				std::unique_ptr<double[]> h(new double[numVerts]);
+				std::unique_ptr<vector3f[]> n(new vector3f[numVerts]);
+				std::unique_ptr<Color3ub[]> c(new Color3ub[numVerts]);
+				valid = ReadArray(rd, h.get(), numVerts * sizeof(double)) &&
+					ReadArray(rd, n.get(), numVerts * sizeof(vector3f)) &&
+					ReadArray(rd, c.get(), numVerts * sizeof(Color3ub));
+
+				if (valid) {
+					std::copy(h.get(), h.get() + numVerts, heights);
+					std::copy(n.get(), n.get() + numVerts, normals);
+					std::copy(c.get(), c.get() + numVerts, colors);
+				}
+			}
+		}
+	} catch (std::exception &e) {
+		// lz4 errors, or a blob running past the end of a truncated file
+		Log::Warning("GeoPatchCache: error reading {}: {}\n", filename, e.what());
+	}
+
+	if (!valid) {
+		{
+			std::lock_guard<std::mutex> lock(s_cacheMutex);
+			RemoveEntry(hash);
+		}
+		FileSystem::userFiles.RemoveFile(filename);
+	}
+
+	return valid;
+}
+
+// static
+void GeoPatchCache::Store(const Key &key, const double *heights, const vector3f *normals, const Color3ub *colors)
+{
+	PROFILE_SCOPED()
+	const uint64_t hash = key.Hash();
+
+	{
+		std::lock_guard<std::mutex> lock(s_cacheMutex);
+		if (!s_cacheEnabled || s_entries.count(hash))
+			return;
+	}
+
+	const size_t numVerts = GetNumVertices(key);
+
+	Serializer::Writer wr;
+	wr.Int32(CACHE_MAGIC);
+	wr.Int32(CACHE_VERSION);
+	WriteKey(wr, key);
+	wr.Blob(ByteRange(reinterpret_cast<const char *>(heights), numVerts * sizeof(double)));
+	wr.Blob(ByteRange(reinterpret_cast<const char *>(normals), numVerts * sizeof(vector3f)));
+	wr.Blob(ByteRange(reinterpret_cast<const char *>(colors), numVerts * sizeof(Color3ub)));
+
+	const std::string filename = GetCacheFilename(hash);
+	size_t size = 0;
+	try {
+		const std::string compressed = lz4::CompressLZ4(wr.GetData(), CACHE_LZ4_PRESET);
+
+		FILE *f = FileSystem::userFiles.OpenWriteStream(filename);
+		if (!f)
+			return;
+
+		const bool written = fwrite(compressed.data(), compressed.size(), 1, f) == 1;
+		fclose(f);
+
+		if (!written) {
+			FileSystem::userFiles.RemoveFile(filename);
+			return;
+		}
+
+		size = compressed.size();
+	} catch (std::runtime_error &e) {
+		Log::Warning("GeoPatchCache: error writing {}: {}\n", filename, e.what());
+		return;
+	}
+
+	std::vector<uint64_t> evicted;
+	{
+		std::lock_guard<std::mutex> lock(s_cacheMutex);
+		if (!s_cacheEnabled || s_entries.count(hash))
+			return;
+
+		InsertEntry(hash, size);
+		evicted = EvictEntries();
+	}
+
+	RemoveFiles(evicted);
+}
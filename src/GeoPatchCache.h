@@ -0,0 +1,51 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _GEOPATCHCACHE_H
+#define _GEOPATCHCACHE_H
+
+#include "Color.h"
+#include "GeoPatchID.h"
+#include "galaxy/SystemPath.h"
+#include "vector3.h"
+
+class Terrain;
+
+/*
+ * Persistent on-disk cache of generated GeoPatch heights, normals and colors.
+ *
+ * Patches are stored LZ4-compressed, one file per patch, in the user data
+ * directory. The total size of the cache is capped; the least recently used
+ * patches are evicted first.
+ *
+ * Load and Store are thread safe and are intended to be called from the
+ * patch generation jobs.
+ */
+class GeoPatchCache {
+public:
+	// Identifies the generated data of a single patch
+	struct Key {
+		Key(const SystemPath &path, const Terrain *terrain, const GeoPatchID &patchID, const int depth, const int edgeLen);
+
+		SystemPath path;
+		Uint32 seed;
+		uint64_t terrainHash; // fractal names and parameters of the terrain
+		uint64_t patchID;
+		Uint32 depth;
+		Uint32 edgeLen;
+
+		uint64_t Hash() const;
+	};
+
+	// maxSizeMB = 0 disables the cache
+	static void Init(const size_t maxSizeMB);
+	static void Uninit();
+
+	// Fill heights/normals/colors (edgeLen * edgeLen values each) from the cache.
+	// Returns false and leaves the buffers untouched if the patch isn't cached.
+	static bool Load(const Key &key, double *heights, vector3f *normals, Color3ub *colors);
+
+	static void Store(const Key &key, const double *heights, const vector3f *normals, const Color3ub *colors);
+};
+
+#endif /* _GEOPATCHCACHE_H */
@@ -20,6 +20,22 @@ double GeoPatchContext::m_frac = 0.0;
 RefCountedPtr<Graphics::IndexBuffer> GeoPatchContext::m_indices;
 int GeoPatchContext::m_prevEdgeLen = 0;
 
+//static
+Graphics::VertexBufferDesc GeoPatchContext::GetVertexBufferDesc()
+{
+	Graphics::VertexBufferDesc vbd;
+	vbd.attrib[0].semantic = Graphics::ATTRIB_POSITION;
+	vbd.attrib[0].format = Graphics::ATTRIB_FORMAT_FLOAT3;
+	vbd.attrib[1].semantic = Graphics::ATTRIB_NORMAL;
+	vbd.attrib[1].format = Graphics::ATTRIB_FORMAT_SBYTE4_NORM;
+	vbd.attrib[2].semantic = Graphics::ATTRIB_DIFFUSE;
+	vbd.attrib[2].format = Graphics::ATTRIB_FORMAT_UBYTE4;
+	vbd.attrib[3].semantic = Graphics::ATTRIB_UV0;
+	vbd.attrib[3].format = Graphics::ATTRIB_FORMAT_USHORT2_NORM;
+	vbd.CalculateOffsets();
+	return vbd;
+}
+
 //static
 void GeoPatchContext::GenerateIndices()
 {
@@ -67,11 +83,12 @@ void GeoPatchContext::GenerateIndices()
 #else
 		vco.Optimize(&pl_short[0], tri_count);
 #endif
-		//create buffer & copy
-		m_indices.Reset(Pi::renderer->CreateIndexBuffer(pl_short.size(), Graphics::BUFFER_USAGE_STATIC));
-		Uint32 *idxPtr = m_indices->Map(Graphics::BUFFER_MAP_WRITE);
+		//create buffer & copy, every patch has fewer than 64K vertices so 16 bit indices suffice
+		assert(NUMVERTICES() <= 0x10000);
+		m_indices.Reset(Pi::renderer->CreateIndexBuffer(pl_short.size(), Graphics::BUFFER_USAGE_STATIC, Graphics::INDEX_BUFFER_16BIT));
+		Uint16 *idxPtr = m_indices->Map16(Graphics::BUFFER_MAP_WRITE);
 		for (Uint32 j = 0; j < pl_short.size(); j++) {
-			idxPtr[j] = pl_short[j];
+			idxPtr[j] = Uint16(pl_short[j]);
 		}
 		m_indices->Unmap();
 	}
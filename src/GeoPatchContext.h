@@ -10,6 +10,7 @@
 #include "graphics/VertexBuffer.h"
 #include "vector3.h"
 
+#include <algorithm>
 #include <deque>
 
 // maximumpatch depth
@@ -17,12 +18,37 @@
 
 class GeoPatchContext : public RefCounted {
 public:
+	// normal as normalized signed bytes, w is unused
+	struct PackedNormal {
+		Sint8 x, y, z, w;
+	};
+
+	// texture coordinates as normalized unsigned shorts
+	struct PackedUV {
+		Uint16 u, v;
+	};
+
+	// 24 bytes per vertex; normals and uvs are expanded to floats by the
+	// vertex fetch, so the terrain shaders see the same inputs as before
 	struct VBOVertex {
 		vector3f pos;
-		vector3f norm;
+		PackedNormal norm;
 		Color4ub col;
-		vector2f uv;
+		PackedUV uv;
 	};
+	static_assert(sizeof(VBOVertex) == 24, "GeoPatch vertex is padded");
+
+	static inline PackedNormal PackNormal(const vector3f &n)
+	{
+		return PackedNormal{ PackSNorm8(n.x), PackSNorm8(n.y), PackSNorm8(n.z), 0 };
+	}
+
+	static inline PackedUV PackUV(const float u, const float v)
+	{
+		return PackedUV{ PackUNorm16(u), PackUNorm16(v) };
+	}
+
+	static Graphics::VertexBufferDesc GetVertexBufferDesc();
 
 	GeoPatchContext(const int _edgeLen)
 	{
@@ -46,6 +72,17 @@ public:
 	static inline double GetFrac() { return m_frac; }
 
 private:
+	static inline Sint8 PackSNorm8(const float f)
+	{
+		const float c = std::min(std::max(f, -1.0f), 1.0f) * 127.0f;
+		return Sint8(c < 0.0f ? c - 0.5f : c + 0.5f);
+	}
+
+	static inline Uint16 PackUNorm16(const float f)
+	{
+		return Uint16(std::min(std::max(f, 0.0f), 1.0f) * 65535.0f + 0.5f);
+	}
+
 	static int m_edgeLen;
 	static int m_numTris;
 
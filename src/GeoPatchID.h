@@ -19,6 +19,8 @@ public:
 	uint64_t NextPatchID(const int depth, const int idx) const;
 	int GetPatchIdx(const int depth) const;
 	int GetPatchFaceIdx() const;
+
+	uint64_t GetValue() const { return mPatchID; }
 };
 
 #endif //__GEOPATCHID_H__
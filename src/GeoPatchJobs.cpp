@@ -3,6 +3,7 @@
 
 #include "GeoPatchJobs.h"
 
+#include "GeoPatchCache.h"
 #include "GeoSphere.h"
 #include "MathUtil.h"
 #include "perlin.h"
@@ -21,6 +22,22 @@ inline vector3d GetSpherePoint(const vector3d &v0, const vector3d &v1, const vec
 	return (v0 + x * (1.0 - y) * (v1 - v0) + x * y * (v2 - v0) + (1.0 - x) * y * (v3 - v0)).Normalized();
 }
 
+// Generate one row of bordered heights and vertices, evaluating the terrain
+// for the whole row at once
+inline void GenerateHeightRow(const Terrain *pTerrain, const vector3d &v0, const vector3d &v1, const vector3d &v2, const vector3d &v3,
+	const double yfrac, const int xbegin, const double xstep, const int count, double *bhts, vector3d *vrts)
+{
+	for (int x = 0; x < count; x++)
+		vrts[x] = GetSpherePoint(v0, v1, v2, v3, double(x + xbegin) * xstep, yfrac);
+
+	pTerrain->GetHeights(vrts, bhts, count);
+
+	for (int x = 0; x < count; x++) {
+		assert(bhts[x] >= 0.0f && bhts[x] <= 1.0f);
+		vrts[x] = vrts[x] * (bhts[x] + 1.0);
+	}
+}
+
 // ********************************************************************************
 // Overloaded PureJob class to handle generating the mesh for each patch
 // ********************************************************************************
@@ -39,14 +56,9 @@ void SSingleSplitRequest::GenerateMesh() const
 	vector3d *vrts = borderVertexs.get();
 	for (int y = -BORDER_SIZE; y < borderedEdgeLen - BORDER_SIZE; y++) {
 		const double yfrac = double(y) * fracStep;
-		for (int x = -BORDER_SIZE; x < borderedEdgeLen - BORDER_SIZE; x++) {
-			const double xfrac = double(x) * fracStep;
-			const vector3d p = GetSpherePoint(v0, v1, v2, v3, xfrac, yfrac);
-			const double height = pTerrain->GetHeight(p);
-			assert(height >= 0.0f && height <= 1.0f);
-			*(bhts++) = height;
-			*(vrts++) = p * (height + 1.0);
-		}
+		GenerateHeightRow(pTerrain.Get(), v0, v1, v2, v3, yfrac, -BORDER_SIZE, fracStep, borderedEdgeLen, bhts, vrts);
+		bhts += borderedEdgeLen;
+		vrts += borderedEdgeLen;
 	}
 	assert(bhts == &borderHeights.get()[numBorderedVerts]);
 
@@ -55,6 +67,9 @@ void SSingleSplitRequest::GenerateMesh() const
 	vector3f *nrm = normals;
 	double *hts = heights;
 	vrts = borderVertexs.get();
+
+	// per-row inputs and outputs for the terrain color batch
+	PoolArray<vector3d> rowPoints(edgeLen), rowNormals(edgeLen), rowColors(edgeLen);
 	for (int y = BORDER_SIZE; y < borderedEdgeLen - BORDER_SIZE; y++) {
 		for (int x = BORDER_SIZE; x < borderedEdgeLen - BORDER_SIZE; x++) {
 			// height
@@ -71,11 +86,15 @@ void SSingleSplitRequest::GenerateMesh() const
 			assert(nrm != &normals[edgeLen * edgeLen]);
 			*(nrm++) = vector3f(n);
 
-			// color
-			const vector3d p = GetSpherePoint(v0, v1, v2, v3, (x - BORDER_SIZE) * fracStep, (y - BORDER_SIZE) * fracStep);
-			setColour(*col, pTerrain->GetColor(p, height, n));
+			rowNormals[x - BORDER_SIZE] = n;
+			rowPoints[x - BORDER_SIZE] = GetSpherePoint(v0, v1, v2, v3, (x - BORDER_SIZE) * fracStep, (y - BORDER_SIZE) * fracStep);
+		}
+
+		// color
+		pTerrain->GetColors(rowPoints.get(), hts - edgeLen, rowNormals.get(), rowColors.get(), edgeLen);
+		for (int x = 0; x < edgeLen; x++) {
 			assert(col != &colors[edgeLen * edgeLen]);
-			++col;
+			setColour(*(col++), rowColors[x]);
 		}
 	}
 	assert(hts == &heights[edgeLen * edgeLen]);
@@ -100,8 +119,12 @@ void SinglePatchJob::OnRun() // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
 
 	const SSingleSplitRequest &srd = *mData;
 
-	// fill out the data
-	mData->GenerateMesh();
+	// fill out the data, from the disk cache if possible
+	const GeoPatchCache::Key cacheKey(srd.sysPath, srd.pTerrain.Get(), srd.patchID, srd.depth, srd.edgeLen);
+	if (!GeoPatchCache::Load(cacheKey, srd.heights, srd.normals, srd.colors)) {
+		mData->GenerateMesh();
+		GeoPatchCache::Store(cacheKey, srd.heights, srd.normals, srd.colors);
+	}
 
 	// add this patches data
 	SSingleSplitResult *sr = new SSingleSplitResult(srd.patchID.GetPatchFaceIdx(), srd.depth);
@@ -138,7 +161,22 @@ void QuadPatchJob::OnRun() // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
 
 	const SQuadSplitRequest &srd = *mData;
 
-	mData->GenerateBorderedData();
+	// try the disk cache first, the bordered data is only needed if any of
+	// the sub-patches have to be generated
+	auto kidKey = [&](const int idx) {
+		return GeoPatchCache::Key(srd.sysPath, srd.pTerrain.Get(), srd.patchID.NextPatchID(srd.depth + 1, idx), srd.depth + 1, srd.edgeLen);
+	};
+	const GeoPatchCache::Key cacheKeys[4] = { kidKey(0), kidKey(1), kidKey(2), kidKey(3) };
+
+	bool cached[4];
+	bool allCached = true;
+	for (int i = 0; i < 4; i++) {
+		cached[i] = GeoPatchCache::Load(cacheKeys[i], srd.heights[i], srd.normals[i], srd.colors[i]);
+		allCached &= cached[i];
+	}
+
+	if (!allCached)
+		mData->GenerateBorderedData();
 
 	const vector3d v01 = (srd.v0 + srd.v1).Normalized();
 	const vector3d v12 = (srd.v1 + srd.v2).Normalized();
@@ -163,10 +201,13 @@ void QuadPatchJob::OnRun() // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
 	SQuadSplitResult *sr = new SQuadSplitResult(srd.patchID.GetPatchFaceIdx(), srd.depth);
 	for (int i = 0; i < 4; i++) {
 		// fill out the data
-		mData->GenerateSubPatchData(i,
-			vecs[i][0], vecs[i][1], vecs[i][2], vecs[i][3],
-			srd.edgeLen, offxy[i][0], offxy[i][1],
-			borderedEdgeLen);
+		if (!cached[i]) {
+			mData->GenerateSubPatchData(i,
+				vecs[i][0], vecs[i][1], vecs[i][2], vecs[i][3],
+				srd.edgeLen, offxy[i][0], offxy[i][1],
+				borderedEdgeLen);
+			GeoPatchCache::Store(cacheKeys[i], srd.heights[i], srd.normals[i], srd.colors[i]);
+		}
 
 		// add this patches data
 		sr->addResult(i, srd.heights[i], srd.normals[i], srd.colors[i],
@@ -199,14 +240,9 @@ void SQuadSplitRequest::GenerateBorderedData() const
 	vector3d *vrts = borderVertexs.get();
 	for (int y = -BORDER_SIZE; y < (borderedEdgeLen - BORDER_SIZE); y++) {
 		const double yfrac = double(y) * (fracStep * 0.5);
-		for (int x = -BORDER_SIZE; x < (borderedEdgeLen - BORDER_SIZE); x++) {
-			const double xfrac = double(x) * (fracStep * 0.5);
-			const vector3d p = GetSpherePoint(v0, v1, v2, v3, xfrac, yfrac);
-			const double height = pTerrain->GetHeight(p);
-			assert(height >= 0.0f && height <= 1.0f);
-			*(bhts++) = height;
-			*(vrts++) = p * (height + 1.0);
-		}
+		GenerateHeightRow(pTerrain.Get(), v0, v1, v2, v3, yfrac, -BORDER_SIZE, fracStep * 0.5, borderedEdgeLen, bhts, vrts);
+		bhts += borderedEdgeLen;
+		vrts += borderedEdgeLen;
 	}
 	assert(bhts == &borderHeights[numBorderedVerts]);
 }
@@ -229,6 +265,9 @@ void SQuadSplitRequest::GenerateSubPatchData(
 	vector3f *nrm = normals[quadrantIndex];
 	double *hts = heights[quadrantIndex];
 
+	// per-row inputs and outputs for the terrain color batch
+	PoolArray<vector3d> rowPoints(edgeLen), rowNormals(edgeLen), rowColors(edgeLen);
+
 	// step over the small square
 	for (int y = 0; y < edgeLen; y++) {
 		const int by = (y + BORDER_SIZE) + yoff;
@@ -249,11 +288,15 @@ void SQuadSplitRequest::GenerateSubPatchData(
 			assert(nrm != &normals[quadrantIndex][edgeLen * edgeLen]);
 			*(nrm++) = vector3f(n);
 
-			// color
-			const vector3d p = GetSpherePoint(v0, v1, v2, v3, x * fracStep, y * fracStep);
-			setColour(*col, pTerrain->GetColor(p, height, n));
+			rowNormals[x] = n;
+			rowPoints[x] = GetSpherePoint(v0, v1, v2, v3, x * fracStep, y * fracStep);
+		}
+
+		// color
+		pTerrain->GetColors(rowPoints.get(), hts - edgeLen, rowNormals.get(), rowColors.get(), edgeLen);
+		for (int x = 0; x < edgeLen; x++) {
 			assert(col != &colors[quadrantIndex][edgeLen * edgeLen]);
-			++col;
+			setColour(*(col++), rowColors[x]);
 		}
 	}
 	assert(hts == &heights[quadrantIndex][edgeLen * edgeLen]);
@@ -9,6 +9,7 @@
 #include "Color.h"
 #include "GeoPatchID.h"
 #include "JobQueue.h"
+#include "core/PoolAllocator.h"
 #include "vector3.h"
 #include "terrain/Terrain.h"
 
@@ -16,7 +17,7 @@ class GeoSphere;
 
 #define BORDER_SIZE 1
 
-class SBaseRequest {
+class SBaseRequest : public PoolAllocated {
 public:
 	SBaseRequest(const vector3d &v0_, const vector3d &v1_, const vector3d &v2_, const vector3d &v3_, const vector3d &cn,
 		const uint32_t depth_, const SystemPath &sysPath_, const GeoPatchID &patchID_, const int edgeLen_, const double fracStep_,
@@ -65,8 +66,8 @@ public:
 			colors[i] = new Color3ub[numVerts];
 		}
 		const int numBorderedVerts = NUMVERTICES((edgeLen_ * 2) + (BORDER_SIZE * 2) - 1);
-		borderHeights.reset(new double[numBorderedVerts]);
-		borderVertexs.reset(new vector3d[numBorderedVerts]);
+		borderHeights.reset(numBorderedVerts);
+		borderVertexs.reset(numBorderedVerts);
 	}
 
 	// Generates full-detail vertices, and also non-edge normals and colors
@@ -82,8 +83,8 @@ public:
 	double *heights[4];
 
 	// these are created with the request but are destroyed when the request is finished
-	std::unique_ptr<double[]> borderHeights;
-	std::unique_ptr<vector3d[]> borderVertexs;
+	PoolArray<double> borderHeights;
+	PoolArray<vector3d> borderVertexs;
 
 protected:
 	// deliberately prevent copy constructor access
@@ -103,8 +104,8 @@ public:
 		colors = new Color3ub[numVerts];
 
 		const int numBorderedVerts = NUMVERTICES(edgeLen_ + (BORDER_SIZE * 2));
-		borderHeights.reset(new double[numBorderedVerts]);
-		borderVertexs.reset(new vector3d[numBorderedVerts]);
+		borderHeights.reset(numBorderedVerts);
+		borderVertexs.reset(numBorderedVerts);
 	}
 
 	// Generates full-detail vertices, and also non-edge normals and colors
@@ -116,8 +117,8 @@ public:
 	double *heights;
 
 	// these are created with the request but are destroyed when the request is finished
-	std::unique_ptr<double[]> borderHeights;
-	std::unique_ptr<vector3d[]> borderVertexs;
+	PoolArray<double> borderHeights;
+	PoolArray<vector3d> borderVertexs;
 
 protected:
 	// deliberately prevent copy constructor access
@@ -145,7 +146,7 @@ struct SSplitResultData {
 	GeoPatchID patchID;
 };
 
-class SBaseSplitResult {
+class SBaseSplitResult : public PoolAllocated {
 public:
 	SBaseSplitResult(const int32_t face_, const int32_t depth_) :
 		mFace(face_),
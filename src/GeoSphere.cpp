@@ -5,6 +5,7 @@
 
 #include "GameConfig.h"
 #include "GeoPatch.h"
+#include "GeoPatchCache.h"
 #include "GeoPatchContext.h"
 #include "GeoPatchJobs.h"
 #include "Pi.h"
@@ -20,12 +21,18 @@
 #include "graphics/TextureBuilder.h"
 #include "graphics/VertexArray.h"
 #include "perlin.h"
+#include "profiler/Profiler.h"
 #include "utils.h"
 #include "vcacheopt/vcacheopt.h"
 #include <algorithm>
 #include <deque>
 
 RefCountedPtr<GeoPatchContext> GeoSphere::s_patchContext;
+GeoSphere::FrameBudget GeoSphere::s_frameBudget = {};
+int GeoSphere::s_detailBias = 0;
+
+// accumulates the time spent on budgeted work within the current frame
+static Profiler::Clock s_budgetClock;
 
 // must be odd numbers
 static const int detail_edgeLen[5] = {
@@ -38,15 +45,28 @@ static const int detail_edgeLen[5] = {
 };
 
 static const double gs_targetPatchTriLength(100.0);
+// number of frames a quad split job may wait before being demoted to background priority
+static const uint32_t QUAD_SPLIT_DEADLINE_FRAMES = 4;
 static std::vector<GeoSphere *> s_allGeospheres;
 
+// static
+int GeoSphere::GetPatchEdgeLen(int detailLevel)
+{
+	return detail_edgeLen[Clamp(detailLevel, 0, int(COUNTOF(detail_edgeLen)) - 1)];
+}
+
 void GeoSphere::InitGeoSphere()
 {
-	s_patchContext.Reset(new GeoPatchContext(detail_edgeLen[Pi::detail.planets > 4 ? 4 : Pi::detail.planets]));
+	s_patchContext.Reset(new GeoPatchContext(GetPatchEdgeLen(Pi::detail.planets)));
+	GeoPatchCache::Init(std::max(Pi::config->Int("GeoPatchDiskCacheMB"), 0));
+
+	s_frameBudget.timeBudgetMs = std::max(Pi::config->Float("GeoPatchFrameBudgetMS"), 0.f);
+	s_frameBudget.uploadBudgetBytes = size_t(std::max(Pi::config->Int("GeoPatchUploadBudgetKB"), 0)) * 1024;
 }
 
 void GeoSphere::UninitGeoSphere()
 {
+	GeoPatchCache::Uninit();
 	assert(s_patchContext.Unique());
 	s_patchContext.Reset();
 }
@@ -65,6 +85,16 @@ static void print_info(const SystemBody *sbody, const Terrain *terrain)
 void GeoSphere::UpdateAllGeoSpheres()
 {
 	PROFILE_SCOPED()
+	// start this frame's budget afresh
+	s_frameBudget.timeUsedMs = 0.0;
+	s_frameBudget.uploadBytes = 0;
+	s_frameBudget.resultsProcessed = 0;
+	s_frameBudget.resultsDeferred = 0;
+	s_frameBudget.requestsIssued = 0;
+	s_frameBudget.requestsDeferred = 0;
+	s_frameBudget.maxSplitLatencyMs = 0.0;
+	s_budgetClock.Reset();
+
 	for (std::vector<GeoSphere *>::iterator i = s_allGeospheres.begin(); i != s_allGeospheres.end(); ++i) {
 		(*i)->Update();
 	}
@@ -73,7 +103,7 @@ void GeoSphere::UpdateAllGeoSpheres()
 // static
 void GeoSphere::OnChangeGeoSphereDetailLevel()
 {
-	s_patchContext.Reset(new GeoPatchContext(detail_edgeLen[Pi::detail.planets > 4 ? 4 : Pi::detail.planets]));
+	s_patchContext.Reset(new GeoPatchContext(GetPatchEdgeLen(Pi::detail.planets)));
 
 	// reinit the geosphere terrain data
 	for (std::vector<GeoSphere *>::iterator i = s_allGeospheres.begin(); i != s_allGeospheres.end(); ++i) {
@@ -165,6 +195,8 @@ void GeoSphere::Reset()
 		mQuadSplitResults.clear();
 	}
 
+	CancelQuadSplitRequests();
+
 	for (int p = 0; p < NUM_PATCHES; p++) {
 		// delete patches
 		if (m_patches[p]) {
@@ -199,18 +231,18 @@ GeoSphere::~GeoSphere()
 	// update thread should not be able to access us now, so we can safely continue to delete
 	assert(std::count(s_allGeospheres.begin(), s_allGeospheres.end(), this) == 1);
 	s_allGeospheres.erase(std::find(s_allGeospheres.begin(), s_allGeospheres.end(), this));
+
+	CancelQuadSplitRequests();
 }
 
 bool GeoSphere::AddQuadSplitResult(SQuadSplitResult *res)
 {
-	bool result = false;
+	// Quad results may be carried over several frames by the frame budget, so
+	// they're always accepted here; ProcessQuadSplitRequests stops issuing new
+	// jobs instead once MAX_SPLIT_OPERATIONS results are waiting.
 	assert(res);
-	assert(mQuadSplitResults.size() < MAX_SPLIT_OPERATIONS);
-	if (mQuadSplitResults.size() < MAX_SPLIT_OPERATIONS) {
-		mQuadSplitResults.emplace_back(res);
-		result = true;
-	}
-	return result;
+	mQuadSplitResults.emplace_back(res);
+	return true;
 }
 
 bool GeoSphere::AddSingleSplitResult(SSingleSplitResult *res)
@@ -252,17 +284,30 @@ void GeoSphere::ProcessSplitResults()
 		mSingleSplitResults.clear();
 	}
 
-	// now handle the quad split results
+	// now handle the quad split results, as many as fit in the frame budget.
+	// Each one creates four new patches whose VBOs are uploaded when they're
+	// next rendered, so charge for those uploads here.
 	{
-		std::deque<SQuadSplitResult *>::iterator iter = mQuadSplitResults.begin();
-		while (iter != mQuadSplitResults.end()) {
+		const size_t resultBytes = 4 * GeoPatchContext::NUMVERTICES() * sizeof(GeoPatchContext::VBOVertex);
+
+		s_budgetClock.Unpause();
+		uint32_t numProcessed = 0;
+		while (!mQuadSplitResults.empty()) {
+			// always make some progress, however small the budget
+			const bool spent = s_frameBudget.timeUsedMs >= s_frameBudget.timeBudgetMs ||
+				s_frameBudget.uploadBytes + resultBytes > s_frameBudget.uploadBudgetBytes;
+			if (numProcessed && spent)
+				break;
+
 			// finally pass SplitResults
-			SQuadSplitResult *psr = (*iter);
+			SQuadSplitResult *psr = mQuadSplitResults.front();
+			mQuadSplitResults.pop_front();
 			assert(psr);
 
 			const int32_t faceIdx = psr->face();
 			if (m_patches[faceIdx]) {
 				m_patches[faceIdx]->ReceiveHeightmaps(psr);
+				s_frameBudget.uploadBytes += resultBytes;
 			} else {
 				psr->OnCancel();
 			}
@@ -270,10 +315,14 @@ void GeoSphere::ProcessSplitResults()
 			// tidyup
 			delete psr;
 
-			// Next!
-			++iter;
+			++numProcessed;
+			s_budgetClock.SoftStop();
+			s_frameBudget.timeUsedMs = s_budgetClock.milliseconds();
 		}
-		mQuadSplitResults.clear();
+		s_budgetClock.Pause();
+
+		s_frameBudget.resultsProcessed += numProcessed;
+		s_frameBudget.resultsDeferred += mQuadSplitResults.size();
 	}
 }
 
@@ -365,11 +414,46 @@ void GeoSphere::AddQuadSplitRequest(double dist, SQuadSplitRequest *pReq, GeoPat
 
 void GeoSphere::ProcessQuadSplitRequests()
 {
-	std::sort(mQuadSplitRequests.begin(), mQuadSplitRequests.end(), [](TDistanceRequest &a, TDistanceRequest &b) { return a.mDistance < b.mDistance; });
+	// Requests carried over from earlier frames were prioritised against an
+	// old camera position. The requesting patches can't be merged away while
+	// their request is pending, so they're still valid here.
+	for (TDistanceRequest &req : mQuadSplitRequests) {
+		req.mError = req.mpRequester->GetSplitError(m_tempCampos);
+	}
+	std::sort(mQuadSplitRequests.begin(), mQuadSplitRequests.end(), [](TDistanceRequest &a, TDistanceRequest &b) { return a.mError > b.mError; });
+
+	// Requests are queued largest-error-first as interactive jobs; any that
+	// haven't started within a few frames are demoted so they don't hold up
+	// patches requested later by a camera that has since moved on.
+	s_budgetClock.Unpause();
+	size_t numIssued = 0;
+	for (TDistanceRequest &req : mQuadSplitRequests) {
+		// don't generate more patches while finished ones are still waiting
+		// to be integrated, and leave the rest for later once out of time
+		if (mQuadSplitResults.size() >= MAX_SPLIT_OPERATIONS)
+			break;
+		if (numIssued && s_frameBudget.timeUsedMs >= s_frameBudget.timeBudgetMs)
+			break;
+
+		QuadPatchJob *job = new QuadPatchJob(req.mpRequest);
+		job->SetDeadline(QUAD_SPLIT_DEADLINE_FRAMES);
+		req.mpRequester->ReceiveJobHandle(Pi::GetAsyncJobQueue()->Queue(job, nullptr, JobPriority::Interactive));
+
+		++numIssued;
+		s_budgetClock.SoftStop();
+		s_frameBudget.timeUsedMs = s_budgetClock.milliseconds();
+	}
+	s_budgetClock.Pause();
 
-	for (auto iter : mQuadSplitRequests) {
-		SQuadSplitRequest *ssrd = iter.mpRequest;
-		iter.mpRequester->ReceiveJobHandle(Pi::GetAsyncJobQueue()->Queue(new QuadPatchJob(ssrd)));
+	mQuadSplitRequests.erase(mQuadSplitRequests.begin(), mQuadSplitRequests.begin() + numIssued);
+	s_frameBudget.requestsIssued += numIssued;
+	s_frameBudget.requestsDeferred += mQuadSplitRequests.size();
+}
+
+void GeoSphere::CancelQuadSplitRequests()
+{
+	for (TDistanceRequest &req : mQuadSplitRequests) {
+		delete req.mpRequest;
 	}
 	mQuadSplitRequests.clear();
 }
@@ -384,6 +468,8 @@ void GeoSphere::Render(Graphics::Renderer *renderer, const matrix4x4d &modelView
 	if (m_initStage < eDefaultUpdateState)
 		return;
 
+	Graphics::Renderer::GPUZoneTicket zone(renderer, "GeoSphere");
+
 	matrix4x4d trans = modelView;
 	trans.Translate(-campos.x, -campos.y, -campos.z);
 	renderer->SetTransform(matrix4x4f(trans)); //need to set this for the following line to work
@@ -400,8 +486,7 @@ void GeoSphere::Render(Graphics::Renderer *renderer, const matrix4x4d &modelView
 		SetUpMaterials();
 
 	//Update material parameters
-	//XXX no need to calculate AP every frame
-	auto ap = GetSystemBody()->CalcAtmosphereParams();
+	const AtmosphereParameters &ap = m_atmosParams;
 	SetMaterialParameters(trans, radius, shadows, ap);
 
 	if (m_atmosphereMaterial.Valid() && ap.atmosDensity > 0.0) {
@@ -478,9 +563,8 @@ void GeoSphere::SetUpMaterials()
 			surfDesc.quality &= ~Graphics::HAS_ATMOSPHERE;
 		} else {
 			//planetoid with or without atmosphere
-			const AtmosphereParameters ap(GetSystemBody()->CalcAtmosphereParams());
 			surfDesc.lighting = true;
-			if (ap.atmosDensity > 0.0) {
+			if (m_atmosParams.atmosDensity > 0.0) {
 				surfDesc.quality |= Graphics::HAS_ATMOSPHERE;
 			}
 		}
@@ -11,6 +11,7 @@
 #include "core/Log.h"
 #include "vector3.h"
 
+#include <algorithm>
 #include <deque>
 
 namespace Graphics {
@@ -51,12 +52,42 @@ public:
 		return h;
 	}
 
+	virtual void GetHeights(const vector3d *p, double *heights, size_t count) const override final
+	{
+		m_terrain->GetHeights(p, heights, count);
+	}
+
 	static void InitGeoSphere();
 	static void UninitGeoSphere();
 	static void UpdateAllGeoSpheres();
 	static void OnChangeGeoSphereDetailLevel();
 	static bool OnAddQuadSplitResult(const SystemPath &path, SQuadSplitResult *res);
 	static bool OnAddSingleSplitResult(const SystemPath &path, SSingleSplitResult *res);
+	// vertex edge length of the patches generated at the given planet detail level
+	static int GetPatchEdgeLen(int detailLevel);
+
+	// Per-frame budget shared by all GeoSpheres for integrating finished
+	// patches (and so the VBO uploads that follow) and issuing split jobs.
+	// Work that doesn't fit is carried over to the next frame.
+	struct FrameBudget {
+		double timeUsedMs;
+		double timeBudgetMs;
+		size_t uploadBytes;
+		size_t uploadBudgetBytes;
+		uint32_t resultsProcessed;
+		uint32_t resultsDeferred;
+		uint32_t requestsIssued;
+		uint32_t requestsDeferred;
+		// longest wait from a patch asking to split to getting its result,
+		// over the results processed this frame
+		double maxSplitLatencyMs;
+	};
+	static const FrameBudget &GetFrameBudget() { return s_frameBudget; }
+	static void ReportSplitLatency(double ms) { s_frameBudget.maxSplitLatencyMs = std::max(s_frameBudget.maxSplitLatencyMs, ms); }
+
+	// Levels of patch depth to give up (or, if negative, to add) relative
+	// to the planet detail setting, see QualityGovernor
+	static void SetDetailBias(int bias) { s_detailBias = bias; }
 	// in sbody radii
 	virtual double GetMaxFeatureHeight() const override final { return m_terrain->GetMaxHeight(); }
 
@@ -67,6 +98,8 @@ public:
 	virtual void Reset() override;
 
 	inline Sint32 GetMaxDepth() const { return m_maxDepth; }
+	// the depth patches may split down to, with the detail bias applied
+	inline Sint32 GetMaxSplitDepth() const { return std::max(m_maxDepth - s_detailBias, 1); }
 
 	void AddQuadSplitRequest(double, SQuadSplitRequest *, GeoPatch *);
 
@@ -78,14 +111,15 @@ private:
 		return m_terrain->GetColor(p, height, norm);
 	}
 	void ProcessQuadSplitRequests();
+	void CancelQuadSplitRequests();
 
 	std::unique_ptr<GeoPatch> m_patches[6];
 	struct TDistanceRequest {
-		TDistanceRequest(double dist, SQuadSplitRequest *pRequest, GeoPatch *pRequester) :
-			mDistance(dist),
+		TDistanceRequest(double error, SQuadSplitRequest *pRequest, GeoPatch *pRequester) :
+			mError(error),
 			mpRequest(pRequest),
 			mpRequester(pRequester) {}
-		double mDistance;
+		double mError;
 		SQuadSplitRequest *mpRequest;
 		GeoPatch *mpRequester;
 	};
@@ -100,6 +134,8 @@ private:
 	Graphics::Frustum m_tempFrustum;
 
 	static RefCountedPtr<GeoPatchContext> s_patchContext;
+	static FrameBudget s_frameBudget;
+	static int s_detailBias;
 
 	virtual void SetUpMaterials() override;
 	void CreateAtmosphereMaterial();
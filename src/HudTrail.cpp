@@ -10,6 +10,8 @@
 #include "graphics/RenderState.h"
 #include "graphics/Renderer.h"
 #include "graphics/Types.h"
+#include "graphics/VertexBuffer.h"
+#include "graphics/VertexWriter.h"
 
 const float UPDATE_INTERVAL = 0.1f;
 const Uint16 MAX_POINTS = 100;
@@ -18,7 +20,9 @@ HudTrail::HudTrail(Body *b, const Color &c) :
 	m_body(b),
 	m_currentFrame(b->GetFrame()),
 	m_updateTime(0.f),
-	m_color(c)
+	m_color(c),
+	m_numTrailVerts(0),
+	m_refreshTrail(false)
 {
 	Graphics::MaterialDescriptor desc;
 
@@ -27,6 +31,13 @@ HudTrail::HudTrail(Body *b, const Color &c) :
 	rsd.depthWrite = false;
 	rsd.primitiveType = Graphics::LINE_STRIP;
 	m_lineMat.reset(Pi::renderer->CreateMaterial("vtxColor", desc, rsd));
+
+	const auto vbd = Graphics::CreateVertexDesc<Graphics::VertexPosCol>(MAX_POINTS, Graphics::BUFFER_USAGE_DYNAMIC);
+	m_trailBuffer.reset(Pi::renderer->CreateVertexBuffer(vbd));
+}
+
+HudTrail::~HudTrail()
+{
 }
 
 void HudTrail::Update(float time)
@@ -43,48 +54,64 @@ void HudTrail::Update(float time)
 			m_trailPoints.clear();
 		}
 
-		if (bodyFrameId == m_currentFrame)
+		if (bodyFrameId == m_currentFrame) {
 			m_trailPoints.emplace_back(m_body->GetInterpPosition());
+			m_refreshTrail = true;
+		}
 	}
 
 	while (m_trailPoints.size() > MAX_POINTS)
 		m_trailPoints.pop_front();
 }
 
+void HudTrail::UpdateTrailBuffer()
+{
+	PROFILE_SCOPED();
+	m_refreshTrail = false;
+
+	// the oldest point is left out, as its alpha would be zero
+	m_trailOrigin = m_trailPoints.back();
+	m_numTrailVerts = Uint32(m_trailPoints.size() - 1);
+	if (m_numTrailVerts < 2)
+		return;
+
+	Graphics::VertexWriter<Graphics::VertexPosCol> out(m_trailBuffer.get());
+	float alpha = 1.f;
+	const float decrement = 1.f / m_trailPoints.size();
+	Color tcolor = m_color;
+	for (size_t i = m_trailPoints.size() - 1; i > 0; i--) {
+		alpha -= decrement;
+		tcolor.a = Uint8(alpha * 255);
+		out.Add({ vector3f(m_trailPoints[i] - m_trailOrigin), tcolor });
+	}
+}
+
 void HudTrail::Render(Graphics::Renderer *r)
 {
 	PROFILE_SCOPED();
 	//render trail
 	if (m_trailPoints.size() > 1) {
-		const vector3d vpos = m_transform * m_body->GetInterpPosition();
-		m_transform[12] = vpos.x;
-		m_transform[13] = vpos.y;
-		m_transform[14] = vpos.z;
-		m_transform[15] = 1.0;
-
-		static std::vector<vector3f> tvts;
-		static std::vector<Color> colors;
-		tvts.clear();
-		colors.clear();
-		const vector3d curpos = m_body->GetInterpPosition();
-		tvts.reserve(MAX_POINTS);
-		colors.reserve(MAX_POINTS);
-
-		tvts.emplace_back(vector3f(0.f));
-		colors.emplace_back(Color::BLANK);
-		float alpha = 1.f;
-		const float decrement = 1.f / m_trailPoints.size();
-		const Color tcolor = m_color;
-		for (size_t i = m_trailPoints.size() - 1; i > 0; i--) {
-			tvts.emplace_back(-vector3f(curpos - m_trailPoints[i]));
-			alpha -= decrement;
-			colors.emplace_back(tcolor);
-			colors.back().a = Uint8(alpha * 255);
-		}
+		if (m_refreshTrail)
+			UpdateTrailBuffer();
+
+		// draw relative to the newest point, keeping the vertices small
+		matrix4x4d trans = m_transform;
+		const vector3d vpos = m_transform * m_trailOrigin;
+		trans[12] = vpos.x;
+		trans[13] = vpos.y;
+		trans[14] = vpos.z;
+		trans[15] = 1.0;
+		r->SetTransform(matrix4x4f(trans));
 
-		r->SetTransform(matrix4x4f(m_transform));
-		m_lines.SetData(tvts.size(), &tvts[0], &colors[0]);
+		// from the body, fading in, to the newest point
+		const vector3f head[2] = { vector3f(m_body->GetInterpPosition() - m_trailOrigin), vector3f(0.f) };
+		Color colors[2] = { Color::BLANK, m_color };
+		colors[1].a = Uint8((1.f - 1.f / m_trailPoints.size()) * 255);
+		m_lines.SetData(2, head, colors);
 		m_lines.Draw(r, m_lineMat.get());
+
+		if (m_numTrailVerts >= 2)
+			r->DrawBufferDynamic(m_trailBuffer.get(), 0, nullptr, 0, m_numTrailVerts, m_lineMat.get());
 	}
 }
 
@@ -92,4 +119,6 @@ void HudTrail::Reset(FrameId newFrame)
 {
 	m_currentFrame = newFrame;
 	m_trailPoints.clear();
+	m_numTrailVerts = 0;
+	m_refreshTrail = false;
 }
@@ -14,6 +14,7 @@
 
 namespace Graphics {
 	class Renderer;
+	class VertexBuffer;
 } // namespace Graphics
 
 class Body;
@@ -22,14 +23,21 @@ class Frame;
 class HudTrail {
 public:
 	HudTrail(Body *b, const Color &);
+	~HudTrail();
 	void Update(float time);
 	void Render(Graphics::Renderer *r);
 	void Reset(const FrameId newFrame);
 
-	void SetColor(const Color &c) { m_color = c; }
+	void SetColor(const Color &c)
+	{
+		m_color = c;
+		m_refreshTrail = true;
+	}
 	void SetTransform(const matrix4x4d &t) { m_transform = t; }
 
 private:
+	void UpdateTrailBuffer();
+
 	Body *m_body;
 	FrameId m_currentFrame;
 	float m_updateTime;
@@ -37,6 +45,14 @@ private:
 	matrix4x4d m_transform;
 	std::deque<vector3d> m_trailPoints;
 	std::unique_ptr<Graphics::Material> m_lineMat;
+
+	// The recorded points, relative to the newest one, only uploaded again
+	// when a point is recorded. The segment from the body to the newest
+	// point moves every frame and is drawn separately.
+	std::unique_ptr<Graphics::VertexBuffer> m_trailBuffer;
+	vector3d m_trailOrigin;
+	Uint32 m_numTrailVerts;
+	bool m_refreshTrail;
 	Graphics::Drawables::Lines m_lines;
 };
 
@@ -6,6 +6,7 @@
 #include "GameConfig.h"
 #include "InputBindings.h"
 #include "Pi.h"
+#include "Replay.h"
 #include "utils.h"
 
 #include "SDL.h"
@@ -249,6 +250,7 @@ Manager::Manager(IniConfig *config, SDL_Window *window) :
 	mouseButton(),
 	mouseMotion(),
 	m_capturingMouse(false),
+	m_lateLatch(false),
 	joystickEnabled(true),
 	mouseYInvert(false),
 	m_enableBindings(true),
@@ -549,6 +551,9 @@ void Manager::NewFrame()
 	if (m_frameListChanged) {
 		RebuildInputFrames();
 	}
+
+	if (Replay::IsPlaying())
+		PlayBackFrameStart();
 }
 
 void Manager::RebuildInputFrames()
@@ -632,10 +637,33 @@ static float applyDeadzoneAndCurve(const JoystickInfo::Axis &axis, float value)
 	return AnimationCurves::SmoothEasing(absVal, axis.curve) * sign;
 }
 
+static bool IsDeviceInputEvent(const SDL_Event &event)
+{
+	switch (event.type) {
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+	case SDL_MOUSEWHEEL:
+	case SDL_MOUSEMOTION:
+	case SDL_JOYAXISMOTION:
+	case SDL_JOYBUTTONUP:
+	case SDL_JOYBUTTONDOWN:
+	case SDL_JOYHATMOTION:
+		return true;
+	default:
+		return false;
+	}
+}
+
 void Manager::HandleSDLEvent(SDL_Event &event)
 {
 	using namespace InputBindings;
 
+	// a replay being played back supplies the input instead
+	if (Replay::IsPlaying() && IsDeviceInputEvent(event))
+		return;
+
 	switch (event.type) {
 	case SDL_KEYDOWN:
 		// Set key state to "just pressed"
@@ -784,8 +812,27 @@ void Manager::HandleSDLEvent(SDL_Event &event)
 	}
 }
 
+// the id of a binding, for recording; only looked up when it changes
+template <typename T>
+static const std::string &FindBindingId(const std::map<std::string, T> &bindings, const T *binding)
+{
+	static const std::string empty;
+	for (const auto &pair : bindings) {
+		if (&pair.second == binding)
+			return pair.first;
+	}
+	return empty;
+}
+
 void Manager::DispatchEvents()
 {
+	if (Replay::IsPlaying()) {
+		PlayBackBindingChanges();
+		return;
+	}
+
+	const bool recording = Replay::IsRecording();
+
 	// Chords which have had their modifier keys released this frame get updated all at once
 	for (auto *chord : m_chords) {
 		if (chord->IsActive() && !GetModifierState(chord)) {
@@ -802,14 +849,23 @@ void Manager::DispatchEvents()
 			bool nowActive = action->binding.IsActive() || action->binding2.IsActive();
 			action->m_active = nowActive;
 
+			const bool pressed = queued & 1 && !wasActive;
+			const bool released = queued & 2 && !nowActive;
+			if (recording && (pressed || released || nowActive != wasActive)) {
+				Replay::RecordBindingChange({ FindBindingId(actionBindings, action), false,
+					Uint8((pressed ? Replay::BINDING_PRESSED : 0) | (released ? Replay::BINDING_RELEASED : 0) |
+						(nowActive ? Replay::BINDING_ACTIVE : 0)),
+					0.0f });
+			}
+
 			// if at least one of the bindings was pressed this frame and the action was not
 			// previously active, call the pressed event
-			if (queued & 1 && !wasActive)
+			if (pressed)
 				action->onPressed.emit();
 
 			// if at least one of the bindings was released this frame but are not pressed currently,
 			// call the released event
-			if (queued & 2 && !nowActive)
+			if (released)
 				action->onReleased.emit();
 
 			// clear queued events
@@ -827,9 +883,72 @@ void Manager::DispatchEvents()
 		value = Clamp(value, -1.0f, 1.0f);
 		if (value != 0.0 || axis->m_value != 0.0) {
 			axis->m_value = value;
+			if (recording)
+				Replay::RecordBindingChange({ FindBindingId(axisBindings, axis), true, Replay::BINDING_EMIT, value });
 			axis->onAxisValue.emit(value);
 		}
 	}
+
+	if (recording)
+		Replay::RecordMouse(mouseMotion.data(), mouseWheel, mouseButton.data(), mouseButton.size());
+}
+
+void Manager::RecordBindingState()
+{
+	for (auto &pair : actionBindings) {
+		if (pair.second.m_active)
+			Replay::RecordBindingChange({ pair.first, false, Replay::BINDING_ACTIVE, 0.0f });
+	}
+
+	for (auto &pair : axisBindings) {
+		if (pair.second.m_value != 0.0)
+			Replay::RecordBindingChange({ pair.first, true, 0, pair.second.m_value });
+	}
+}
+
+void Manager::PlayBackFrameStart()
+{
+	Replay::GetMouse(mouseMotion.data(), mouseWheel, mouseButton.data(), mouseButton.size());
+
+	// binding state from before the replay started; it emits nothing
+	for (const Replay::BindingChange &change : Replay::GetBindingChanges()) {
+		if (change.flags & (Replay::BINDING_PRESSED | Replay::BINDING_RELEASED | Replay::BINDING_EMIT))
+			continue;
+
+		if (change.axis) {
+			auto it = axisBindings.find(change.id);
+			if (it != axisBindings.end())
+				it->second.m_value = change.value;
+		} else {
+			auto it = actionBindings.find(change.id);
+			if (it != actionBindings.end())
+				it->second.m_active = change.flags & Replay::BINDING_ACTIVE;
+		}
+	}
+}
+
+void Manager::PlayBackBindingChanges()
+{
+	for (const Replay::BindingChange &change : Replay::GetBindingChanges()) {
+		if (change.axis) {
+			auto it = axisBindings.find(change.id);
+			if (it == axisBindings.end() || !(change.flags & Replay::BINDING_EMIT))
+				continue;
+
+			it->second.m_value = change.value;
+			it->second.onAxisValue.emit(change.value);
+		} else {
+			auto it = actionBindings.find(change.id);
+			if (it == actionBindings.end() || !(change.flags & (Replay::BINDING_PRESSED | Replay::BINDING_RELEASED)))
+				continue;
+
+			it->second.m_active = change.flags & Replay::BINDING_ACTIVE;
+			if (change.flags & Replay::BINDING_PRESSED)
+				it->second.onPressed.emit();
+			if (change.flags & Replay::BINDING_RELEASED)
+				it->second.onReleased.emit();
+		}
+	}
 }
 
 /*
@@ -855,6 +974,37 @@ void Manager::ClearMouse()
 	mouseMotion.fill(0);
 }
 
+void Manager::GetRelativeMouseState(int *x, int *y)
+{
+	if (Replay::IsPlaying()) {
+		Replay::GetTickMouse(*x, *y);
+		return;
+	}
+
+	SDL_GetRelativeMouseState(x, y);
+	Replay::RecordTickMouse(*x, *y);
+}
+
+void Manager::LatchMouseMotion()
+{
+	if (!m_lateLatch || !m_capturingMouse || Replay::IsPlaying())
+		return;
+
+	PROFILE_SCOPED()
+	// only motion is taken off the queue; everything else waits for the
+	// next frame's events, as usual
+	SDL_PumpEvents();
+
+	SDL_Event events[32];
+	int numEvents;
+	while ((numEvents = SDL_PeepEvents(events, 32, SDL_GETEVENT, SDL_MOUSEMOTION, SDL_MOUSEMOTION)) > 0) {
+		for (int i = 0; i < numEvents; i++) {
+			mouseMotion[0] += events[i].motion.xrel;
+			mouseMotion[1] += events[i].motion.yrel;
+		}
+	}
+}
+
 float Manager::GetMoveSpeedShiftModifier()
 {
 	// Suggestion: make x1000 speed on pressing both keys?
@@ -206,8 +206,23 @@ public:
 		std::copy_n(mouseMotion.data(), mouseMotion.size(), motion);
 	}
 
+	// While capturing the mouse, adds the motion that arrived after this
+	// frame's events were handled to GetMouseMotion, so transforms computed
+	// just before drawing (e.g. the mouselook camera) use the latest input.
+	// Does nothing unless enabled.
+	void LatchMouseMotion();
+	void SetLateLatchEnabled(bool enabled) { m_lateLatch = enabled; }
+
 	int GetMouseWheel() { return mouseWheel; }
 
+	// The mouse motion since the last call, straight from SDL rather than
+	// from this frame's events. Recorded in and played back from replays.
+	void GetRelativeMouseState(int *x, int *y);
+
+	// Adds the actions currently active and axes currently deflected to the
+	// replay being recorded, as the state it starts from.
+	void RecordBindingState();
+
 	// Capturing the mouse hides the cursor, puts the mouse into relative mode,
 	// and passes all mouse inputs to the input system, regardless of whether
 	// ImGui is using them or not.
@@ -231,6 +246,10 @@ public:
 
 private:
 	void RebuildInputFrames();
+
+	// apply the recorded input of the replay frame being played back
+	void PlayBackFrameStart();
+	void PlayBackBindingChanges();
 	bool GetModifierState(InputBindings::KeyChord *key);
 	bool GetBindingState(InputBindings::KeyBinding &key);
 	float GetAxisState(InputBindings::JoyAxis &axis);
@@ -245,6 +264,7 @@ private:
 	std::array<int, 2> mouseMotion;
 	int mouseWheel;
 	bool m_capturingMouse;
+	bool m_lateLatch;
 
 	bool joystickEnabled;
 	bool mouseYInvert;
@@ -42,7 +42,7 @@ Intro::Intro(Graphics::Renderer *r, int width, int height) :
 	m_skin.SetLabel(Lang::PIONEER);
 
 	for (const auto &i : ShipType::player_ships) {
-		SceneGraph::Model *model = Pi::FindModel(ShipType::types[i].modelName)->MakeInstance();
+		SceneGraph::Model *model = Pi::MakeModelInstance(ShipType::types[i].modelName);
 		model->SetThrust(vector3f(0.f, 0.f, -0.6f), vector3f(0.f));
 		if (ShipType::types[i].isGlobalColorDefined) model->SetThrusterColor(ShipType::types[i].globalThrusterColor);
 		for (int j = 0; j < THRUSTER_MAX; j++) {
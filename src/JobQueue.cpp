@@ -94,16 +94,18 @@ Job::Handle::~Handle()
 SyncJobQueue::~SyncJobQueue()
 {
 	// delete any remaining jobs
-	for (Job *j : m_queue)
-		delete j;
+	for (auto &queue : m_queue)
+		for (Job *j : queue)
+			delete j;
 	for (Job *j : m_finished)
 		delete j;
 }
 
-Job::Handle SyncJobQueue::Queue(Job *job, JobClient *client)
+Job::Handle SyncJobQueue::Queue(Job *job, JobClient *client, JobPriority priority)
 {
 	Job::Handle handle(job, this, client);
-	m_queue.push_back(job);
+	job->SetScheduling(priority, m_frame);
+	m_queue[size_t(priority)].push_back(job);
 	return handle;
 }
 
@@ -112,6 +114,7 @@ Uint32 SyncJobQueue::FinishJobs()
 {
 	PROFILE_SCOPED()
 	Uint32 finished = 0;
+	m_frame++;
 
 	while (!m_finished.empty()) {
 		Job *job = m_finished.front();
@@ -122,6 +125,10 @@ Uint32 SyncJobQueue::FinishJobs()
 			job->UnlinkHandle();
 			job->OnFinish();
 			finished++;
+		} else if (job->GetHandle()) {
+			// cancelled by missing its deadline rather than by the owner
+			job->UnlinkHandle();
+			job->OnCancel();
 		}
 
 		delete job;
@@ -131,12 +138,14 @@ Uint32 SyncJobQueue::FinishJobs()
 
 void SyncJobQueue::Cancel(Job *job)
 {
-	// Check the waiting list. If it's there then it hasn't run yet. Just forget about it.
-	for (std::deque<Job *>::iterator i = m_queue.begin(); i != m_queue.end(); ++i) {
-		if (*i == job) {
-			i = m_queue.erase(i);
-			delete job;
-			return;
+	// Check the waiting lists. If it's there then it hasn't run yet. Just forget about it.
+	for (auto &queue : m_queue) {
+		for (std::deque<Job *>::iterator i = queue.begin(); i != queue.end(); ++i) {
+			if (*i == job) {
+				i = queue.erase(i);
+				delete job;
+				return;
+			}
 		}
 	}
 
@@ -162,14 +171,40 @@ Uint32 SyncJobQueue::RunJobs(Uint32 count)
 	Uint32 executed = 0;
 	assert(count >= 1);
 	for (Uint32 i = 0; i < count; ++i) {
-		if (m_queue.empty())
+		Job *job = PopJob();
+		if (!job)
 			break;
 
-		Job *job = m_queue.front();
-		m_queue.pop_front();
-		job->OnRun();
+		if (!job->cancelled)
+			job->OnRun();
 		executed++;
 		m_finished.push_back(job);
 	}
 	return executed;
 }
+
+// take the next job to run from the highest-priority non-empty waiting list,
+// applying the deadline action to any jobs that have missed their deadline
+Job *SyncJobQueue::PopJob()
+{
+	for (size_t idx = 0; idx < NUM_JOB_PRIORITIES; ++idx) {
+		std::deque<Job *> &queue = m_queue[idx];
+		while (!queue.empty()) {
+			Job *job = queue.front();
+			queue.pop_front();
+
+			if (!job->IsPastDeadline(m_frame))
+				return job;
+
+			if (job->MissedDeadline()) {
+				// cancelled jobs are handed straight to FinishJobs
+				m_finished.push_back(job);
+				continue;
+			}
+
+			m_queue[size_t(job->GetPriority())].push_back(job);
+		}
+	}
+
+	return nullptr;
+}
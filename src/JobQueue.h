@@ -18,6 +18,16 @@ static const uint32_t MAX_THREADS = 64;
 class JobClient;
 class JobQueue;
 
+// The scheduling class of a queued job. Each class has its own ready list,
+// and a free worker always picks a job from the most urgent non-empty list.
+enum class JobPriority : uint8_t {
+	Interactive, // needed for what is on screen right now (e.g. terrain patches near the camera)
+	Streaming,   // needed soon, but a frame or two of latency is acceptable (e.g. textures)
+	Background   // no particular urgency (e.g. galaxy generation and caching)
+};
+
+static constexpr size_t NUM_JOB_PRIORITIES = size_t(JobPriority::Background) + 1;
+
 // represents a single unit of work that you want done
 // subclass and implement:
 //
@@ -30,7 +40,14 @@ class JobQueue;
 // OnCancel: optional. called from the main thread to tell the job that its
 //           results are not wanted. it should arrange for OnRun to return
 //           as quickly as possible. OnFinish will not be called for the job
-class Job {
+//
+// Jobs are allocated from the thread-local block pools (see PoolAllocator.h).
+//
+// A job may optionally be given a deadline, measured in frames (calls to
+// JobQueue::FinishJobs) from the point it is queued. A job that has not been
+// started when its deadline passes is either demoted to Background priority
+// or cancelled, depending on the DeadlineAction.
+class Job : public PoolAllocated {
 public:
 	// This is the RAII handle for a queued Job. A job is cancelled when the
 	// Job::Handle is destroyed. There is at most one Job::Handle for each Job
@@ -73,9 +90,18 @@ public:
 	};
 
 public:
+	enum class DeadlineAction : uint8_t {
+		Demote, // move the job to the Background ready list
+		Cancel  // cancel the job; OnCancel will be called instead of OnRun
+	};
+
 	Job() :
 		cancelled(false),
-		m_handle(nullptr) {}
+		m_handle(nullptr),
+		m_priority(JobPriority::Streaming),
+		m_deadlineAction(DeadlineAction::Demote),
+		m_deadlineFrames(0),
+		m_deadline(0) {}
 	virtual ~Job();
 
 	Job(const Job &) = delete;
@@ -85,6 +111,17 @@ public:
 	virtual void OnFinish() = 0;
 	virtual void OnCancel() {}
 
+	// Set the number of frames after queueing that this job should have
+	// started running by. Must be called before the job is queued.
+	// A value of zero (the default) means the job has no deadline.
+	void SetDeadline(uint32_t frames, DeadlineAction action = DeadlineAction::Demote)
+	{
+		m_deadlineFrames = frames;
+		m_deadlineAction = action;
+	}
+
+	JobPriority GetPriority() const { return m_priority; }
+
 private:
 	friend class AsyncJobQueue;
 	friend class SyncJobQueue;
@@ -99,8 +136,40 @@ private:
 	void SetHandle(Handle *handle) { m_handle.store(handle, std::memory_order_release); }
 	void ClearHandle() { m_handle = nullptr; }
 
+	// Called by the queue when the job is queued, with the queue's current frame
+	void SetScheduling(JobPriority priority, uint32_t frame)
+	{
+		m_priority = priority;
+		m_deadline = frame + m_deadlineFrames;
+	}
+
+	// Returns true if the job has a deadline and it is earlier than the given frame
+	bool IsPastDeadline(uint32_t frame) const
+	{
+		return m_deadlineFrames && int32_t(frame - m_deadline) > 0;
+	}
+
+	// Apply the deadline action to a job which missed its deadline.
+	// Returns true if the job was cancelled, false if it was demoted.
+	bool MissedDeadline()
+	{
+		m_deadlineFrames = 0;
+		if (m_deadlineAction == DeadlineAction::Cancel) {
+			cancelled.store(true, std::memory_order_release);
+			return true;
+		}
+
+		m_priority = JobPriority::Background;
+		return false;
+	}
+
 	std::atomic<bool> cancelled;
 	std::atomic<Handle *> m_handle;
+
+	JobPriority m_priority;
+	DeadlineAction m_deadlineAction;
+	uint32_t m_deadlineFrames;
+	uint32_t m_deadline;
 };
 
 // the queue management class. create one from the main thread, and feed your
@@ -113,8 +182,9 @@ public:
 	virtual ~JobQueue() {}
 
 	// call from the main thread to add a job to the queue. the job should be
-	// allocated with new. the queue will delete it once its its completed
-	virtual Job::Handle Queue(Job *job, JobClient *client = nullptr) = 0;
+	// allocated with new. the queue will delete it once its its completed.
+	// jobs of a higher priority are always started before lower ones.
+	virtual Job::Handle Queue(Job *job, JobClient *client = nullptr, JobPriority priority = JobPriority::Streaming) = 0;
 
 	// Call from the main thread to cancel a job.
 	// The job will not be run if it is not already executing, and OnFinished
@@ -125,6 +195,7 @@ public:
 	// call from the main loop. this will call OnFinish for any finished jobs,
 	// and then delete all finished and cancelled jobs. returns the number of
 	// finished jobs (not cancelled)
+	// each call to FinishJobs advances the frame counter used for job deadlines.
 	virtual Uint32 FinishJobs() = 0;
 };
 
@@ -133,15 +204,18 @@ public:
 	SyncJobQueue() = default;
 	virtual ~SyncJobQueue();
 
-	virtual Job::Handle Queue(Job *job, JobClient *client = nullptr) override;
+	virtual Job::Handle Queue(Job *job, JobClient *client = nullptr, JobPriority priority = JobPriority::Streaming) override;
 	virtual void Cancel(Job *job) override;
 	virtual Uint32 FinishJobs() override;
 
 	Uint32 RunJobs(Uint32 count = 1);
 
 private:
-	std::deque<Job *> m_queue;
+	Job *PopJob();
+
+	std::deque<Job *> m_queue[NUM_JOB_PRIORITIES];
 	std::deque<Job *> m_finished;
+	uint32_t m_frame = 0;
 };
 
 // JobClient is an abstraction to allow transparent management of job handles
@@ -154,16 +228,20 @@ public:
 
 // JobSet provides an interface for "fire and forget" jobs - call Order with your job,
 // and JobSet will keep the handle alive until the job has finished.
+// All jobs ordered through a JobSet are queued with the same priority.
 class JobSet : public JobClient {
 public:
-	JobSet(JobQueue *queue) :
-		m_queue(queue) {}
+	JobSet(JobQueue *queue, JobPriority priority = JobPriority::Streaming) :
+		m_queue(queue),
+		m_priority(priority) {}
 	JobSet(JobSet &&other) :
 		m_queue(other.m_queue),
+		m_priority(other.m_priority),
 		m_jobs(std::move(other.m_jobs)) { other.m_queue = nullptr; }
 	JobSet &operator=(JobSet &&other)
 	{
 		m_queue = other.m_queue;
+		m_priority = other.m_priority;
 		m_jobs = std::move(other.m_jobs);
 		other.m_queue = nullptr;
 		return *this;
@@ -174,7 +252,7 @@ public:
 
 	virtual void Order(Job *job)
 	{
-		auto x = m_jobs.insert(m_queue->Queue(job, this));
+		auto x = m_jobs.insert(m_queue->Queue(job, this, m_priority));
 		(void)x; // suppress unused variable warning
 		assert(x.second);
 	}
@@ -184,6 +262,7 @@ public:
 
 private:
 	JobQueue *m_queue;
+	JobPriority m_priority;
 	std::set<Job::Handle> m_jobs;
 };
 
@@ -9,10 +9,14 @@
 #include "FileSystem.h"
 #include "base64/base64.hpp"
 #include "core/GZipFormat.h"
+#include "core/LZ4Format.h"
+#include "core/TaskGraph.h"
+#include "profiler/Profiler.h"
 #include "utils.h"
 
 #include <cinttypes>
 #include <cmath>
+#include <istream>
 
 extern "C" {
 #include "miniz/miniz.h"
@@ -50,7 +54,9 @@ namespace JsonUtils {
 		Json out;
 
 		try {
-			out = Json::parse(std::string(fd->GetData(), fd->GetSize()));
+			// parse straight out of the file's buffer rather than a copy of it
+			const char *data = fd->GetData();
+			out = Json::parse(data, data + fd->GetSize());
 		} catch (Json::parse_error &e) {
 			Output("error in JSON file '%s': %s\n", fd->GetInfo().GetPath().c_str(), e.what());
 			return nullptr;
@@ -76,10 +82,70 @@ namespace JsonUtils {
 		return out;
 	}
 
+	std::vector<Json> LoadJsonDataFiles(const std::vector<std::string> &filenames, TaskGraph *taskGraph, bool with_merge)
+	{
+		PROFILE_SCOPED()
+		std::vector<Json> out(filenames.size());
+		if (!taskGraph || filenames.size() < 2) {
+			for (size_t i = 0; i < filenames.size(); i++)
+				out[i] = LoadJsonDataFile(filenames[i], with_merge);
+			return out;
+		}
+
+		// a file a task, as their sizes vary far more than their number
+		TaskSet *taskSet = new TaskSet();
+		for (uint32_t i = 0; i < filenames.size(); i++) {
+			taskSet->AddTaskLambda({ i, i + 1 }, [&filenames, &out, with_merge](TaskRange range) {
+				out[range.begin] = LoadJsonDataFile(filenames[range.begin], with_merge);
+			});
+		}
+
+		TaskSet::Handle handle = taskGraph->QueueTaskSet(taskSet);
+		taskGraph->WaitForTaskSet(handle);
+		return out;
+	}
+
+	bool ParseJsonDataFile(const std::string &filename, SaxReader &reader)
+	{
+		PROFILE_SCOPED()
+		RefCountedPtr<FileSystem::FileData> fd = FileSystem::gameDataFiles.ReadFile(filename);
+		if (!fd) return false;
+
+		const char *data = fd->GetData();
+		if (!Json::sax_parse(data, data + fd->GetSize(), &reader)) {
+			if (!reader.GetError().empty())
+				Output("error in JSON file '%s': %s\n", filename.c_str(), reader.GetError().c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	bool HasJsonPatches(const std::string &filename)
+	{
+		return !FileSystem::gameDataFiles.LookupAll(filename + ".patch").empty();
+	}
+
 	Json LoadJsonSaveFile(const std::string &filename, FileSystem::FileSource &source)
 	{
 		auto file = source.ReadFile(filename);
 		if (!file) return nullptr;
+
+		if (file->GetSize() >= sizeof(uint32_t) && lz4::IsLZ4Format(file->GetData(), file->GetSize())) {
+			// decompressed a chunk at a time as the CBOR is read
+			try {
+				PROFILE_SCOPED_DESC("json.from_cbor lz4");
+				lz4::DecompressStreamBuf buf({ file->GetData(), file->GetSize() });
+				std::istream in(&buf);
+				return Json::from_cbor(in);
+			} catch (Json::parse_error &e) {
+				Output("error in JSON file '%s': %s\n", file->GetInfo().GetPath().c_str(), e.what());
+				return nullptr;
+			} catch (const lz4::DecompressionFailedException &) {
+				return nullptr;
+			}
+		}
+
 		const auto file_data = std::string(file->GetData(), file->GetSize());
 		const unsigned char *dataPtr = reinterpret_cast<const unsigned char *>(&file_data[0]);
 		try {
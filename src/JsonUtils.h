@@ -23,7 +23,38 @@ namespace FileSystem {
 	class FileData;
 } // namespace FileSystem
 
+class TaskGraph;
+
 namespace JsonUtils {
+	// Base for streaming (SAX) readers which pick what they need out of a
+	// file as it's parsed, instead of building the whole Json tree first.
+	// Every event is ignored unless overridden; parse errors are kept for
+	// the caller to report.
+	class SaxReader : public Json::json_sax_t {
+	public:
+		bool null() override { return true; }
+		bool boolean(bool) override { return true; }
+		bool number_integer(number_integer_t) override { return true; }
+		bool number_unsigned(number_unsigned_t) override { return true; }
+		bool number_float(number_float_t, const string_t &) override { return true; }
+		bool string(string_t &) override { return true; }
+		bool start_object(std::size_t) override { return true; }
+		bool key(string_t &) override { return true; }
+		bool end_object() override { return true; }
+		bool start_array(std::size_t) override { return true; }
+		bool end_array() override { return true; }
+		bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &ex) override
+		{
+			m_error = ex.what();
+			return false;
+		}
+
+		const std::string &GetError() const { return m_error; }
+
+	private:
+		std::string m_error;
+	};
+
 	// Low-level load JSON from a file descriptor.
 	Json LoadJson(RefCountedPtr<FileSystem::FileData> fd);
 	// Load a JSON file from a path and a file source.
@@ -31,6 +62,16 @@ namespace JsonUtils {
 	// Load a JSON file from the game's data sources, optionally applying all
 	// files with the the name <filename>.patch as Json Merge Patch (RFC 7386) files
 	Json LoadJsonDataFile(const std::string &filename, bool with_merge = true);
+	// Load many JSON files as LoadJsonDataFile does, reading, parsing and
+	// patching them on the task graph's workers (or one after the other
+	// without one). The results are in the order of the filenames.
+	std::vector<Json> LoadJsonDataFiles(const std::vector<std::string> &filenames, TaskGraph *taskGraph, bool with_merge = true);
+	// Stream a JSON file from the game's data sources through a SaxReader,
+	// without building a DOM. Patch files aren't applied (they need the DOM),
+	// so check HasJsonPatches first and fall back to LoadJsonDataFile.
+	bool ParseJsonDataFile(const std::string &filename, SaxReader &reader);
+	// Whether there are any <filename>.patch files for a data file.
+	bool HasJsonPatches(const std::string &filename);
 	// Loads an optionally-gzipped, optionally-CBOR encoded JSON file from the specified source.
 	Json LoadJsonSaveFile(const std::string &filename, FileSystem::FileSource &source);
 	// Patches a Json object with an extended Merge-Patch object
@@ -0,0 +1,98 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "KinematicStore.h"
+
+#include "DynamicBody.h"
+#include "core/TaskGraph.h"
+#include "profiler/Profiler.h"
+
+// number of bodies interpolated by each task; below this the work isn't
+// worth handing to the worker threads
+static constexpr uint32_t INTERP_BODIES_PER_TASK = 256;
+
+KinematicStore::~KinematicStore()
+{
+	Clear();
+}
+
+void KinematicStore::Clear()
+{
+	for (DynamicBody *body : m_bodies) {
+		if (body)
+			body->SetKinematicStore(nullptr, INVALID_INDEX);
+	}
+
+	m_bodies.clear();
+	m_oldPos.clear();
+	m_pos.clear();
+	m_oldAngDisplacement.clear();
+	m_orient.clear();
+}
+
+void KinematicStore::Add(DynamicBody *body)
+{
+	body->SetKinematicStore(this, m_bodies.size());
+
+	m_bodies.push_back(body);
+	m_oldPos.push_back(body->m_oldPos);
+	m_pos.push_back(body->GetPosition());
+	m_oldAngDisplacement.push_back(body->m_oldAngDisplacement);
+	m_orient.push_back(body->GetOrient());
+}
+
+void KinematicStore::Remove(uint32_t idx)
+{
+	// keep the slot, the remaining bodies still refer to theirs by index
+	m_bodies[idx] = nullptr;
+}
+
+void KinematicStore::InterpolateTransform(double alpha, const vector3d &oldPos, const vector3d &pos,
+	const vector3d &oldAngDisplacement, const matrix3x3d &orient,
+	vector3d &interpPos, matrix3x3d &interpOrient)
+{
+	interpPos = alpha * pos + (1.0 - alpha) * oldPos;
+
+	double len = oldAngDisplacement.Length() * (1.0 - alpha);
+	if (len > 1e-16) {
+		vector3d axis = oldAngDisplacement.Normalized();
+		matrix3x3d rot = matrix3x3d::Rotate(-len, axis); // rotate backwards
+		interpOrient = rot * orient;
+	} else
+		interpOrient = orient;
+}
+
+void KinematicStore::UpdateInterpTransformRange(double alpha, size_t begin, size_t end)
+{
+	for (size_t idx = begin; idx < end; idx++) {
+		DynamicBody *body = m_bodies[idx];
+		if (!body)
+			continue;
+
+		InterpolateTransform(alpha, m_oldPos[idx], m_pos[idx], m_oldAngDisplacement[idx], m_orient[idx],
+			body->m_interpPos, body->m_interpOrient);
+	}
+}
+
+void KinematicStore::UpdateInterpTransforms(double alpha, TaskGraph *taskGraph)
+{
+	PROFILE_SCOPED()
+
+	const uint32_t numBodies = m_bodies.size();
+	if (!taskGraph || numBodies <= INTERP_BODIES_PER_TASK) {
+		UpdateInterpTransformRange(alpha, 0, numBodies);
+		return;
+	}
+
+	// every task writes only to the interpolated transforms of its own bodies
+	TaskSet *taskSet = new TaskSet();
+	for (uint32_t begin = 0; begin < numBodies; begin += INTERP_BODIES_PER_TASK) {
+		const uint32_t end = std::min(begin + INTERP_BODIES_PER_TASK, numBodies);
+		taskSet->AddTaskLambda({ begin, end }, [this, alpha](TaskRange range) {
+			UpdateInterpTransformRange(alpha, range.begin, range.end);
+		});
+	}
+
+	TaskSet::Handle handle = taskGraph->QueueTaskSet(taskSet);
+	taskGraph->WaitForTaskSet(handle);
+}
@@ -0,0 +1,62 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include "matrix3x3.h"
+#include "vector3.h"
+
+#include <vector>
+
+class DynamicBody;
+class TaskGraph;
+
+// Structure-of-arrays copy of the kinematic state of all DynamicBodies in a
+// Space. It is refreshed at the end of each physics step; bodies keep the
+// index of their slot and write position and orientation changes between
+// steps through to it.
+//
+// Interpolating the transforms of every body for each rendered frame then
+// runs over contiguous arrays instead of chasing body pointers, and is split
+// across worker threads.
+class KinematicStore {
+public:
+	static constexpr uint32_t INVALID_INDEX = ~0u;
+
+	KinematicStore() = default;
+	~KinematicStore();
+
+	KinematicStore(const KinematicStore &) = delete;
+	KinematicStore &operator=(const KinematicStore &) = delete;
+
+	// detach all bodies and empty the store
+	void Clear();
+
+	// gather the current state of a body into a new slot
+	void Add(DynamicBody *body);
+	// called by the body when it is deleted
+	void Remove(uint32_t idx);
+
+	void SetPosition(uint32_t idx, const vector3d &pos) { m_pos[idx] = pos; }
+	void SetOrient(uint32_t idx, const matrix3x3d &orient) { m_orient[idx] = orient; }
+
+	size_t GetNumBodies() const { return m_bodies.size(); }
+
+	// set the interpolated transform of every body in the store
+	void UpdateInterpTransforms(double alpha, TaskGraph *taskGraph);
+
+	// interpolate (by 0 <= alpha <= 1) between the transform at the previous
+	// and current physics tick
+	static void InterpolateTransform(double alpha, const vector3d &oldPos, const vector3d &pos,
+		const vector3d &oldAngDisplacement, const matrix3x3d &orient,
+		vector3d &interpPos, matrix3x3d &interpOrient);
+
+private:
+	void UpdateInterpTransformRange(double alpha, size_t begin, size_t end);
+
+	std::vector<DynamicBody *> m_bodies;
+	std::vector<vector3d> m_oldPos;
+	std::vector<vector3d> m_pos;
+	std::vector<vector3d> m_oldAngDisplacement;
+	std::vector<matrix3x3d> m_orient;
+};
@@ -9,6 +9,7 @@
 #include "text/TextSupport.h"
 #include "utils.h"
 
+#include <cstring>
 #include <map>
 #include <set>
 
@@ -33,20 +34,110 @@ namespace Lang {
 		return true;
 	}
 
-	bool Resource::Load()
+	namespace {
+		struct StringEntry {
+			std::string token;
+			std::string message;
+			bool hasMessage = false;
+			bool isString = false;
+		};
+
+		// Picks each token's "message" out of the parser as it goes, so the
+		// string table is never built as a Json tree.
+		class StringTableReader : public JsonUtils::SaxReader {
+		public:
+			std::vector<StringEntry> entries;
+
+			bool null() override { return Value(true, nullptr); }
+			bool boolean(bool) override { return Value(false, nullptr); }
+			bool number_integer(number_integer_t) override { return Value(false, nullptr); }
+			bool number_unsigned(number_unsigned_t) override { return Value(false, nullptr); }
+			bool number_float(number_float_t, const string_t &) override { return Value(false, nullptr); }
+			bool string(string_t &val) override { return Value(false, &val); }
+
+			bool start_object(std::size_t) override
+			{
+				Value(false, nullptr);
+				m_depth++;
+				return true;
+			}
+			bool start_array(std::size_t) override
+			{
+				Value(false, nullptr);
+				m_depth++;
+				return true;
+			}
+			bool end_object() override
+			{
+				m_depth--;
+				return true;
+			}
+			bool end_array() override
+			{
+				m_depth--;
+				return true;
+			}
+
+			bool key(string_t &val) override
+			{
+				if (m_depth == 1)
+					entries.push_back({ std::move(val) });
+				else if (m_depth == 2)
+					m_inMessage = (val == "message");
+				return true;
+			}
+
+		private:
+			bool Value(bool isNull, string_t *str)
+			{
+				if (m_depth == 2 && m_inMessage) {
+					StringEntry &entry = entries.back();
+					entry.hasMessage = !isNull;
+					entry.isString = str != nullptr;
+					if (str)
+						entry.message = std::move(*str);
+				}
+				m_inMessage = false;
+				return true;
+			}
+
+			int m_depth = 0;
+			bool m_inMessage = false;
+		};
+	} // namespace
+
+	// Tidies up a JSON message into the text of a string
+	static void AdjustText(std::string &text)
 	{
-		if (m_loaded)
-			return true;
+		// extracted quoted string
+		if (text[0] == '"' && text[text.size() - 1] == '"')
+			text = text.substr(1, text.size() - 2);
 
-		std::string filename = "lang/" + m_name + "/" + m_langCode + ".json";
-		Json data = JsonUtils::LoadJsonDataFile(filename);
-		if (data.is_null()) {
-			Log::Warning("couldn't read language file '{}'\n", filename.c_str());
-			return false;
+		// adjust for escaped newlines
+		{
+			std::string adjustedText;
+			adjustedText.reserve(text.size());
+
+			unsigned int ii;
+			for (ii = 0; ii < text.size() - 1; ii++) {
+				const char *c = &text[ii];
+				if (c[0] == '\\' && c[1] == 'n') {
+					ii++;
+					adjustedText += '\n';
+				} else
+					adjustedText += *c;
+			}
+			if (ii != text.size())
+				adjustedText += text[ii++];
+			assert(ii == text.size());
+			text = adjustedText;
 		}
+	}
 
-		for (Json::iterator i = data.begin(); i != data.end(); ++i) {
-			const std::string token = i.key();
+	static void AddEntries(const std::string &filename, std::vector<StringEntry> &entries, ModuleStrings &out)
+	{
+		for (StringEntry &entry : entries) {
+			const std::string &token = entry.token;
 			if (token.empty()) {
 				Log::Info("{}: found empty token, skipping it\n", filename.c_str());
 				continue;
@@ -56,62 +147,389 @@ namespace Lang {
 				continue;
 			}
 
-			Json message = i.value()["message"];
-			if (message.is_null()) {
+			if (!entry.hasMessage) {
 				Log::Info("{}: no 'message' key for token '{}', skipping it\n", filename.c_str(), token.c_str());
 				continue;
 			}
 
-			if (!message.is_string()) {
+			if (!entry.isString) {
 				Log::Info("{}: value for token '{}' is not a string, skipping it\n", filename.c_str(), token.c_str());
 				continue;
 			}
 
-			std::string text = message;
-			if (text.empty()) {
+			if (entry.message.empty()) {
 				Log::Info("{}: empty value for token '{}', skipping it\n", filename.c_str(), token.c_str());
 				continue;
 			}
 
-			// extracted quoted string
-			if (text[0] == '"' && text[text.size() - 1] == '"')
-				text = text.substr(1, text.size() - 2);
+			AdjustText(entry.message);
+			out.strings.emplace_back(std::move(entry.token), std::move(entry.message));
+		}
+	}
 
-			// adjust for escaped newlines
-			{
-				std::string adjustedText;
-				adjustedText.reserve(text.size());
-
-				unsigned int ii;
-				for (ii = 0; ii < text.size() - 1; ii++) {
-					const char *c = &text[ii];
-					if (c[0] == '\\' && c[1] == 'n') {
-						ii++;
-						adjustedText += '\n';
-					} else
-						adjustedText += *c;
+	static std::string GetFilename(std::string_view name, std::string_view langCode)
+	{
+		return fmt::format("lang/{}/{}.json", name, langCode);
+	}
+
+	bool ReadModuleStrings(FileSystem::FileSource &source, std::string_view name, std::string_view langCode, ModuleStrings &out)
+	{
+		const std::string filename = GetFilename(name, langCode);
+		RefCountedPtr<FileSystem::FileData> fd = source.ReadFile(filename);
+		if (!fd)
+			return false;
+
+		StringTableReader reader;
+		const char *data = fd->GetData();
+		if (!Json::sax_parse(data, data + fd->GetSize(), &reader)) {
+			if (!reader.GetError().empty())
+				Log::Warning("error in JSON file '{}': {}\n", filename, reader.GetError());
+			return false;
+		}
+
+		out.name = name;
+		out.strings.clear();
+		AddEntries(filename, reader.entries, out);
+		return true;
+	}
+
+	namespace {
+		const char TABLE_MAGIC[4] = { 'P', 'L', 'N', 'G' };
+		const Uint32 TABLE_VERSION = 1;
+
+		// A table file is the header, the modules, keys and entries, then the
+		// blob of NUL-terminated names, tokens and texts that they point
+		// into. It's in the byte order of the machine that built it, which
+		// fails the version check elsewhere.
+		struct TableHeader {
+			char magic[4];
+			Uint32 version;
+			Uint32 numModules;
+			Uint32 numKeys;
+			Uint32 numEntries;
+			Uint32 blobSize;
+		};
+
+		struct TableModule {
+			Uint32 name; // offset in the blob
+			Uint32 nameLength;
+			Uint32 firstEntry;
+			Uint32 numEntries;
+		};
+
+		// the tokens, sorted and each stored once
+		struct TableKey {
+			Uint32 offset;
+			Uint32 length;
+		};
+
+		// a module's entries are sorted by key, and so by token
+		struct TableEntry {
+			Uint32 key;
+			Uint32 text; // offset in the blob
+			Uint32 length;
+		};
+	} // namespace
+
+	std::string WriteStringTable(const std::vector<ModuleStrings> &modules)
+	{
+		std::string blob;
+		auto addToBlob = [&blob](std::string_view str) {
+			const Uint32 offset = Uint32(blob.size());
+			blob.append(str);
+			blob.push_back('\0');
+			return offset;
+		};
+
+		std::map<std::string_view, Uint32> keyIndices;
+		for (const ModuleStrings &module : modules)
+			for (const auto &string : module.strings)
+				keyIndices.emplace(string.first, 0);
+
+		std::vector<TableKey> keys;
+		keys.reserve(keyIndices.size());
+		for (auto &key : keyIndices) {
+			key.second = Uint32(keys.size());
+			keys.push_back({ addToBlob(key.first), Uint32(key.first.size()) });
+		}
+
+		std::vector<TableModule> tableModules;
+		std::vector<TableEntry> entries;
+		for (const ModuleStrings &module : modules) {
+			TableModule &tableModule = tableModules.emplace_back();
+			tableModule.name = addToBlob(module.name);
+			tableModule.nameLength = Uint32(module.name.size());
+			tableModule.firstEntry = Uint32(entries.size());
+
+			// the last of a repeated token wins, as it would in a map
+			std::map<Uint32, std::string_view> texts;
+			for (const auto &string : module.strings)
+				texts[keyIndices[string.first]] = string.second;
+			for (const auto &text : texts)
+				entries.push_back({ text.first, addToBlob(text.second), Uint32(text.second.size()) });
+
+			tableModule.numEntries = Uint32(entries.size()) - tableModule.firstEntry;
+		}
+
+		TableHeader header;
+		memcpy(header.magic, TABLE_MAGIC, sizeof(header.magic));
+		header.version = TABLE_VERSION;
+		header.numModules = Uint32(tableModules.size());
+		header.numKeys = Uint32(keys.size());
+		header.numEntries = Uint32(entries.size());
+		header.blobSize = Uint32(blob.size());
+
+		std::string out;
+		out.append(reinterpret_cast<const char *>(&header), sizeof(header));
+		out.append(reinterpret_cast<const char *>(tableModules.data()), tableModules.size() * sizeof(TableModule));
+		out.append(reinterpret_cast<const char *>(keys.data()), keys.size() * sizeof(TableKey));
+		out.append(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(TableEntry));
+		out.append(blob);
+		return out;
+	}
+
+	class StringTable {
+	public:
+		explicit StringTable(RefCountedPtr<FileSystem::FileData> file) :
+			m_file(file)
+		{
+			Parse(file->GetData(), file->GetSize());
+		}
+		explicit StringTable(std::string data) :
+			m_data(std::move(data))
+		{
+			Parse(m_data.data(), m_data.size());
+		}
+
+		// the members point into the data
+		StringTable(const StringTable &) = delete;
+		StringTable &operator=(const StringTable &) = delete;
+
+		bool IsValid() const { return m_blob != nullptr; }
+		const FileSystem::FileInfo &GetInfo() const { return m_file->GetInfo(); }
+
+		bool FindModule(std::string_view name, Uint32 &index) const
+		{
+			for (Uint32 i = 0; i < m_numModules; i++) {
+				if (GetString(m_modules[i].name, m_modules[i].nameLength) == name) {
+					index = i;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		const TableModule &GetModule(Uint32 index) const { return m_modules[index]; }
+		const TableEntry &GetEntry(const TableModule &module, Uint32 i) const { return m_entries[module.firstEntry + i]; }
+
+		std::string_view GetToken(const TableEntry &entry) const
+		{
+			const TableKey &key = m_keys[entry.key];
+			return GetString(key.offset, key.length);
+		}
+		std::string_view GetText(const TableEntry &entry) const { return GetString(entry.text, entry.length); }
+
+	private:
+		std::string_view GetString(Uint32 offset, Uint32 length) const { return std::string_view(m_blob + offset, length); }
+
+		// Checks everything that lookups rely on, leaving m_blob null if
+		// anything's amiss
+		void Parse(const char *data, size_t size)
+		{
+			TableHeader header;
+			if (size < sizeof(header))
+				return;
+			memcpy(&header, data, sizeof(header));
+			if (memcmp(header.magic, TABLE_MAGIC, sizeof(header.magic)) != 0 || header.version != TABLE_VERSION)
+				return;
+
+			const size_t modulesOffset = sizeof(header);
+			const size_t keysOffset = modulesOffset + size_t(header.numModules) * sizeof(TableModule);
+			const size_t entriesOffset = keysOffset + size_t(header.numKeys) * sizeof(TableKey);
+			const size_t blobOffset = entriesOffset + size_t(header.numEntries) * sizeof(TableEntry);
+			if (size != blobOffset + header.blobSize)
+				return;
+
+			const TableModule *modules = reinterpret_cast<const TableModule *>(data + modulesOffset);
+			const TableKey *keys = reinterpret_cast<const TableKey *>(data + keysOffset);
+			const TableEntry *entries = reinterpret_cast<const TableEntry *>(data + entriesOffset);
+			const char *blob = data + blobOffset;
+
+			auto validString = [&](Uint32 offset, Uint32 length) {
+				return size_t(offset) + length < header.blobSize && blob[offset + length] == '\0';
+			};
+			for (Uint32 i = 0; i < header.numModules; i++) {
+				const TableModule &module = modules[i];
+				if (!validString(module.name, module.nameLength) ||
+					size_t(module.firstEntry) + module.numEntries > header.numEntries)
+					return;
+				for (Uint32 j = 1; j < module.numEntries; j++)
+					if (entries[module.firstEntry + j - 1].key >= entries[module.firstEntry + j].key)
+						return;
+			}
+			for (Uint32 i = 0; i < header.numKeys; i++)
+				if (!validString(keys[i].offset, keys[i].length))
+					return;
+			for (Uint32 i = 0; i < header.numEntries; i++)
+				if (entries[i].key >= header.numKeys || !validString(entries[i].text, entries[i].length))
+					return;
+
+			m_modules = modules;
+			m_keys = keys;
+			m_entries = entries;
+			m_numModules = header.numModules;
+			m_blob = blob;
+		}
+
+		RefCountedPtr<FileSystem::FileData> m_file;
+		std::string m_data;
+
+		const TableModule *m_modules = nullptr;
+		const TableKey *m_keys = nullptr;
+		const TableEntry *m_entries = nullptr;
+		Uint32 m_numModules = 0;
+		const char *m_blob = nullptr;
+	};
+
+	// the mapped table of each language, or null if it has none
+	static std::map<std::string, std::shared_ptr<const StringTable>, std::less<>> s_compiledTables;
+
+	static std::shared_ptr<const StringTable> GetCompiledTable(std::string_view langCode)
+	{
+		auto i = s_compiledTables.find(langCode);
+		if (i != s_compiledTables.end())
+			return i->second;
+
+		std::shared_ptr<const StringTable> table;
+		const std::string filename = fmt::format("lang/{}.langtable", langCode);
+		const FileSystem::FileInfo info = FileSystem::gameDataFiles.Lookup(filename);
+		if (info.IsFile()) {
+			if (RefCountedPtr<FileSystem::FileData> file = info.Map()) {
+				table = std::make_shared<const StringTable>(file);
+				if (!table->IsValid()) {
+					Log::Warning("{} isn't a valid string table, the JSON files will be used\n", filename);
+					table.reset();
 				}
-				if (ii != text.size())
-					adjustedText += text[ii++];
-				assert(ii == text.size());
-				text = adjustedText;
 			}
+		}
+
+		s_compiledTables.emplace(langCode, table);
+		return table;
+	}
 
-			m_strings[token] = text;
+	bool Resource::Load()
+	{
+		if (m_loaded)
+			return true;
+
+		const std::string filename = GetFilename(m_name, m_langCode);
+		const FileSystem::FileInfo jsonInfo = FileSystem::gameDataFiles.Lookup(filename);
+
+		// patched files need the whole tree to apply the patches to
+		const bool patched = JsonUtils::HasJsonPatches(filename);
+
+		// the compiled table, unless the JSON file was changed or overridden
+		// after it was built
+		if (!patched && jsonInfo.IsFile()) {
+			std::shared_ptr<const StringTable> table = GetCompiledTable(m_langCode);
+			if (table) {
+				const FileSystem::FileInfo &tableInfo = table->GetInfo();
+				if (&tableInfo.GetSource() == &jsonInfo.GetSource() &&
+					tableInfo.GetModificationTime() >= jsonInfo.GetModificationTime() &&
+					table->FindModule(m_name, m_module)) {
+					m_table = table;
+					m_loaded = true;
+					return true;
+				}
+			}
 		}
 
+		ModuleStrings module;
+		if (!patched) {
+			if (!ReadModuleStrings(FileSystem::gameDataFiles, m_name, m_langCode, module)) {
+				Log::Warning("couldn't read language file '{}'\n", filename.c_str());
+				return false;
+			}
+		} else {
+			Json data = JsonUtils::LoadJsonDataFile(filename);
+			if (data.is_null()) {
+				Log::Warning("couldn't read language file '{}'\n", filename.c_str());
+				return false;
+			}
+
+			std::vector<StringEntry> entries;
+			for (Json::iterator i = data.begin(); i != data.end(); ++i) {
+				StringEntry &entry = entries.emplace_back();
+				entry.token = i.key();
+
+				Json message = i.value()["message"];
+				entry.hasMessage = !message.is_null();
+				entry.isString = message.is_string();
+				if (entry.isString)
+					entry.message = message.get<std::string>();
+			}
+
+			module.name = m_name;
+			AddEntries(filename, entries, module);
+		}
+
+		return Load(WriteStringTable({ module }));
+	}
+
+	bool Resource::Load(std::string table)
+	{
+		if (m_loaded)
+			return true;
+
+		std::shared_ptr<const StringTable> loaded = std::make_shared<const StringTable>(std::move(table));
+		if (!loaded->IsValid() || !loaded->FindModule(m_name, m_module))
+			return false;
+
+		m_table = loaded;
 		m_loaded = true;
 		return true;
 	}
 
-	static const std::string _empty = "";
-	const std::string &Resource::Get(std::string_view token) const
+	Uint32 Resource::GetNumStrings() const
+	{
+		return m_table ? m_table->GetModule(m_module).numEntries : 0;
+	}
+
+	std::string_view Resource::GetToken(Uint32 i) const
+	{
+		assert(i < GetNumStrings());
+		return m_table->GetToken(m_table->GetEntry(m_table->GetModule(m_module), i));
+	}
+
+	std::string_view Resource::GetString(Uint32 i) const
+	{
+		assert(i < GetNumStrings());
+		return m_table->GetText(m_table->GetEntry(m_table->GetModule(m_module), i));
+	}
+
+	std::string_view Resource::Get(std::string_view token) const
 	{
-		std::map<std::string, std::string>::const_iterator i = m_strings.find(token);
-		if (i == m_strings.end()) {
-			return _empty;
+		if (!m_table)
+			return std::string_view();
+
+		const TableModule &module = m_table->GetModule(m_module);
+		Uint32 first = 0, count = module.numEntries;
+		while (count > 0) {
+			const Uint32 half = count / 2;
+			if (m_table->GetToken(m_table->GetEntry(module, first + half)) < token) {
+				first += half + 1;
+				count -= half + 1;
+			} else {
+				count = half;
+			}
+		}
+
+		if (first < module.numEntries) {
+			const TableEntry &entry = m_table->GetEntry(module, first);
+			if (m_table->GetToken(entry) == token)
+				return m_table->GetText(entry);
 		}
-		return (*i).second;
+		return std::string_view();
 	}
 
 	std::vector<std::string> Resource::GetAvailableLanguages(std::string_view resourceName)
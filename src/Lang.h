@@ -4,45 +4,84 @@
 #ifndef _LANG_H
 #define _LANG_H
 
-#include "IterationProxy.h"
 #include <SDL_stdinc.h>
-#include <map>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
+namespace FileSystem {
+	class FileSource;
+}
+
+/**
+ * Translated strings, by module (the directories of data/lang) and language.
+ *
+ * langcompiler compiles each language's modules into one table file,
+ * lang/<langCode>.langtable, which is mapped at runtime rather than parsing
+ * the JSON files. In the table each token is interned once whatever the
+ * number of modules using it, the texts are in one blob, and each module is
+ * a range of entries in token order, so a lookup is a binary search over
+ * indices into the mapped file. A module whose JSON file is newer than the
+ * table, comes from another file source (a mod) or has patches is read from
+ * JSON instead, into a table of its own held in memory.
+ */
 namespace Lang {
 
+	class StringTable;
+
+	// The strings of one module in one language, as its JSON file gives them
+	struct ModuleStrings {
+		std::string name;
+		std::vector<std::pair<std::string, std::string>> strings; // token and text
+	};
+
+	// Reads lang/<name>/<langCode>.json from source, skipping (with a
+	// message) the tokens without a usable text. Patches aren't applied.
+	bool ReadModuleStrings(FileSystem::FileSource &source, std::string_view name, std::string_view langCode, ModuleStrings &out);
+
+	// A table file of the modules of one language
+	std::string WriteStringTable(const std::vector<ModuleStrings> &modules);
+
 	class Resource {
 	public:
-		using StringMap = std::map<std::string, std::string, std::less<>>;
-
 		Resource(std::string_view name, std::string_view langCode) :
 			m_name(name),
 			m_langCode(langCode),
+			m_module(0),
 			m_loaded(false) {}
 
 		std::string_view GetName() const { return m_name; }
 		std::string_view GetLangCode() const { return m_langCode; }
 
 		bool Load();
+		// Loads the module's strings from a table file held in memory
+		bool Load(std::string table);
 
-		Uint32 GetNumStrings() const { return static_cast<Uint32>(m_strings.size()); }
+		Uint32 GetNumStrings() const;
 
-		const std::string &Get(std::string_view token) const;
+		// The token and text of string i, in token order. Both are
+		// NUL-terminated.
+		std::string_view GetToken(Uint32 i) const;
+		std::string_view GetString(Uint32 i) const;
 
-		static std::vector<std::string> GetAvailableLanguages(std::string_view resourceName);
+		// Empty when the token has no text
+		std::string_view Get(std::string_view token) const;
 
-		IterationProxy<StringMap> GetStrings() { return MakeIterationProxy(m_strings); }
-		const IterationProxy<const StringMap> GetStrings() const { return MakeIterationProxy(m_strings); }
+		static std::vector<std::string> GetAvailableLanguages(std::string_view resourceName);
 
 	private:
+		bool SetTable(std::shared_ptr<const StringTable> table);
+
 		std::string m_name;
 		std::string m_langCode;
 
-		bool m_loaded;
+		// shared by all the modules of a mapped table
+		std::shared_ptr<const StringTable> m_table;
+		Uint32 m_module;
 
-		StringMap m_strings;
+		bool m_loaded;
 	};
 
 // declare all strings
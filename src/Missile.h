@@ -6,10 +6,11 @@
 
 #include "DynamicBody.h"
 #include "ShipType.h"
+#include "core/PoolAllocator.h"
 
 class AICommand;
 
-class Missile : public DynamicBody {
+class Missile : public DynamicBody, public PoolAllocated {
 public:
 	OBJDEF(Missile, DynamicBody, MISSILE);
 	Missile() = delete;
@@ -8,6 +8,9 @@
 
 std::vector<ModManager::ModInfo> ModManager::m_loadedMods;
 
+// the paths of the loose data and mod directories, kept between runs
+static const char s_dataIndexName[] = "data_index.bin";
+
 void ModManager::Init()
 {
 	FileSystem::userFiles.MakeDirectory("mods");
@@ -56,6 +59,10 @@ void ModManager::LoadMods(IniConfig *config)
 			FileSystem::gameDataFiles.PrependSource(modInfo.fs.get());
 		}
 	}
+
+	// all the sources are mounted now, so the data lookups can go through
+	// one index rather than asking every mod in turn
+	FileSystem::gameDataFiles.BuildIndex(FileSystem::userFiles, s_dataIndexName);
 }
 
 void ModManager::ReorderMods(IniConfig *config)
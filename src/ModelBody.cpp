@@ -13,6 +13,8 @@
 #include "collider/CollisionSpace.h"
 #include "collider/Geom.h"
 #include "galaxy/SystemBody.h"
+#include "graphics/Graphics.h"
+#include "graphics/Renderer.h"
 #include "scenegraph/Animation.h"
 #include "scenegraph/CollisionGeometry.h"
 #include "scenegraph/NodeVisitor.h"
@@ -67,14 +69,16 @@ ModelBody::ModelBody() :
 	m_isStatic(false),
 	m_colliding(true),
 	m_geom(nullptr),
-	m_model(nullptr)
+	m_model(nullptr),
+	m_animationsStale(false)
 {
 }
 
 ModelBody::ModelBody(const Json &jsonObj, Space *space) :
 	Body(jsonObj, space),
 	m_geom(nullptr),
-	m_model(nullptr)
+	m_model(nullptr),
+	m_animationsStale(false)
 {
 	Json modelBodyObj = jsonObj["model_body"];
 
@@ -188,10 +192,10 @@ void ModelBody::SetModel(const char *modelName)
 	m_modelName = modelName;
 
 	//create model instance (some modelbodies, like missiles could avoid this)
-	m_model = Pi::FindModel(m_modelName)->MakeInstance();
+	m_model = Pi::MakeModelInstance(m_modelName);
 	m_idleAnimation = m_model->FindAnimation("idle");
-	// TODO: this isn't great, as animations will be ticked regardless of whether the modelbody
-	// is next to the player or on the other side of the solar system.
+	// only the progress is ticked; the transforms follow when they're seen
+	// (see UpdateModelAnimations)
 	if (m_idleAnimation)
 		m_model->SetAnimationActive(m_model->FindAnimationIndex(m_idleAnimation), true);
 
@@ -275,6 +279,7 @@ void ModelBody::MoveGeoms(const matrix4x4d &m, const vector3d &p)
 
 	//accumulate transforms to animated positions
 	if (!m_dynGeoms.empty()) {
+		UpdateModelAnimations();
 		DynCollUpdateVisitor dcv;
 		m_model->GetRoot()->Accept(dcv);
 	}
@@ -295,14 +300,31 @@ void ModelBody::MoveGeoms(const matrix4x4d &m, const vector3d &p)
 
 void ModelBody::RenderModel(Graphics::Renderer *r, const Camera *camera, const vector3d &viewCoords, const matrix4x4d &viewTransform)
 {
+	// moving parts of a model only a few pixels across can't be made out
+	//fov is vertical, so using screen height
+	const double pixrad = GetClipRadius() * r->GetWindowHeight() / (viewCoords.Length() * Graphics::GetFovFactor());
+	if (pixrad >= ANIMATION_MIN_PIXEL_RADIUS)
+		UpdateModelAnimations();
+
 	m_model->Render(matrix4x4f(viewTransform * GetInterpMatrix()));
 }
 
+void ModelBody::UpdateModelAnimations()
+{
+	if (!m_animationsStale)
+		return;
+
+	m_model->UpdateAnimations();
+	m_animationsStale = false;
+}
+
 void ModelBody::TimeStepUpdate(const float timestep)
 {
 	if (m_idleAnimation)
 		// step animation by timestep/total length, loop to 0.0 if it goes >= 1.0
 		m_idleAnimation->SetProgress(fmod(m_idleAnimation->GetProgress() + timestep / m_idleAnimation->GetDuration(), 1.0));
 
-	m_model->UpdateAnimations();
+	// the transforms are brought up to date when the model is drawn, or
+	// when its animated collision geometry moves
+	m_animationsStale = true;
 }
@@ -49,6 +49,11 @@ public:
 
 	virtual void TimeStepUpdate(const float timeStep) override;
 
+	// Interpolates the model's active animations if they have been ticked
+	// since. Invisible and distant models skip it; call this before
+	// relying on animated transforms or tags.
+	void UpdateModelAnimations();
+
 protected:
 	virtual void SaveToJson(Json &jsonObj, Space *space) override;
 
@@ -67,6 +72,10 @@ private:
 	SceneGraph::Model *m_model;
 	std::vector<Geom *> m_dynGeoms;
 	SceneGraph::Animation *m_idleAnimation;
+	bool m_animationsStale;
+
+	// screen-space radius below which animations aren't interpolated
+	static constexpr double ANIMATION_MIN_PIXEL_RADIUS = 8.0;
 };
 
 #endif /* _MODELBODY_H */
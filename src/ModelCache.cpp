@@ -2,40 +2,316 @@
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
 #include "ModelCache.h"
+#include "JobQueue.h"
+#include "scenegraph/BinaryConverter.h"
 #include "scenegraph/Loader.h"
 #include "scenegraph/Model.h"
+#include "scenegraph/NodeVisitor.h"
+#include "scenegraph/StaticGeometry.h"
+#include "utils.h"
+
+#include <atomic>
+
+// the results of a prefetch, shared by the job and the cache so that a
+// FindModel can pick them up before the job has finished
+struct ModelCache::PrefetchData {
+	SceneGraph::BinaryConverter::PreparedFile file;
+	bool valid = false;
+	std::atomic<bool> ready{ false };
+};
+
+namespace {
+	// bytes of vertex and index data of a model
+	class GeometrySizeVisitor : public SceneGraph::NodeVisitor {
+	public:
+		virtual void ApplyStaticGeometry(SceneGraph::StaticGeometry &g) override
+		{
+			for (unsigned int i = 0; i < g.GetNumMeshes(); i++) {
+				const SceneGraph::StaticGeometry::Mesh &mesh = g.GetMeshAt(i);
+				const Graphics::VertexBufferDesc &desc = mesh.vertexBuffer->GetDesc();
+				size += size_t(desc.numVertices) * desc.stride + size_t(mesh.indexBuffer->GetSize()) * sizeof(Uint32);
+			}
+		}
+
+		size_t size = 0;
+	};
+
+	static constexpr size_t PREFETCH_PAGE_SIZE = 4096;
+} // namespace
+
+// Reads and decompresses a compiled model on a worker; the scenegraph is
+// built from it when the job finishes on the main thread
+class ModelPrefetchJob : public Job {
+public:
+	ModelPrefetchJob(ModelCache *cache, const std::string &name, const FileSystem::FileInfo &info, std::shared_ptr<ModelCache::PrefetchData> data) :
+		m_cache(cache),
+		m_name(name),
+		m_info(info),
+		m_data(std::move(data))
+	{}
+
+	virtual void OnRun() override
+	{
+		PROFILE_SCOPED()
+		ModelCache::PrefetchData &data = *m_data;
+		data.valid = SceneGraph::BinaryConverter::PrepareFile(m_info, data.file);
+
+		// take the page faults of the mapped buffer data here rather than
+		// while uploading it on the main thread
+		if (data.valid) {
+			volatile char sink;
+			const ByteRange &buffers = data.file.buffers;
+			for (size_t i = 0; i < buffers.Size(); i += PREFETCH_PAGE_SIZE)
+				sink = buffers[i];
+			(void)sink;
+		}
+
+		data.ready.store(true, std::memory_order_release);
+	}
+
+	virtual void OnFinish() override
+	{
+		m_cache->FinishPrefetch(m_name);
+	}
+
+private:
+	// the cache cancels its jobs before it goes
+	ModelCache *m_cache;
+	std::string m_name;
+	FileSystem::FileInfo m_info;
+	std::shared_ptr<ModelCache::PrefetchData> m_data;
+};
 
 ModelCache::ModelCache(Graphics::Renderer *r) :
-	m_renderer(r)
+	m_renderer(r),
+	m_indexed(false),
+	m_memoryBudget(0),
+	m_evictableSize(0),
+	m_useCounter(0)
 {
 }
 
 ModelCache::~ModelCache()
 {
+	// releasing the job handles cancels the jobs
+	m_prefetchJobs.reset();
 	Flush();
 }
 
 SceneGraph::Model *ModelCache::FindModel(const std::string &name)
+{
+	Entry &entry = Load(name);
+	if (!entry.pinned) {
+		entry.pinned = true;
+		m_evictableSize -= entry.size;
+	}
+	return entry.model;
+}
+
+SceneGraph::Model *ModelCache::MakeInstance(const std::string &name)
+{
+	return Load(name).model->MakeInstance();
+}
+
+void ModelCache::Prefetch(const std::vector<std::string> &names)
+{
+	PROFILE_SCOPED()
+	if (!m_prefetchJobs)
+		return;
+
+	BuildIndex();
+	for (const std::string &name : names) {
+		if (m_models.count(name) || m_prefetches.count(name))
+			continue;
+
+		// models loaded from their definition can't be prepared off the main thread
+		auto sgm = m_sgmFiles.find(name);
+		if (sgm == m_sgmFiles.end())
+			continue;
+
+		std::shared_ptr<PrefetchData> data = std::make_shared<PrefetchData>();
+		m_prefetches.emplace(name, data);
+		m_prefetchJobs->Order(new ModelPrefetchJob(this, name, sgm->second, data));
+	}
+}
+
+void ModelCache::SetStreamingQueue(JobQueue *queue)
+{
+	// releasing the job handles cancels the jobs
+	m_prefetchJobs.reset(queue ? new JobSet(queue, JobPriority::Background) : nullptr);
+	m_prefetches.clear();
+}
+
+void ModelCache::SetMemoryBudget(size_t bytes)
+{
+	m_memoryBudget = bytes;
+	EvictOverBudget();
+}
+
+void ModelCache::Flush()
+{
+	for (ModelMap::iterator it = m_models.begin(); it != m_models.end(); ++it) {
+		delete it->second.model;
+	}
+	m_models.clear();
+	m_evictableSize = 0;
+
+	// jobs still in flight find nothing to finish
+	m_prefetches.clear();
+	m_sgmFiles.clear();
+	m_indexed = false;
+}
+
+ModelCache::Entry &ModelCache::Load(const std::string &name)
 {
 	ModelMap::iterator it = m_models.find(name);
 
 	if (it == m_models.end()) {
-		try {
-			SceneGraph::Loader loader(m_renderer);
-			SceneGraph::Model *m = loader.LoadModel(name);
-			m_models[name] = m;
-			return m;
-		} catch (SceneGraph::LoadingError &) {
-			throw ModelNotFoundException();
+		// pick up a prefetch which has done its part, rather than read the file again
+		std::shared_ptr<PrefetchData> prefetch;
+		auto pit = m_prefetches.find(name);
+		if (pit != m_prefetches.end() && pit->second->ready.load(std::memory_order_acquire)) {
+			prefetch = pit->second;
+			m_prefetches.erase(pit);
 		}
+
+		it = AddModel(name, LoadModel(name, prefetch.get()));
 	}
+
+	it->second.lastUsed = ++m_useCounter;
 	return it->second;
 }
 
-void ModelCache::Flush()
+SceneGraph::Model *ModelCache::LoadModel(const std::string &name, const PrefetchData *prefetch)
+{
+	PROFILE_SCOPED()
+	BuildIndex();
+
+	SceneGraph::Model *m = nullptr;
+	try {
+		auto sgm = m_sgmFiles.find(name);
+		if (sgm != m_sgmFiles.end()) {
+			SceneGraph::BinaryConverter::PreparedFile file;
+			const bool valid = prefetch ? prefetch->valid : SceneGraph::BinaryConverter::PrepareFile(sgm->second, file);
+			if (valid) {
+				SceneGraph::BinaryConverter bc(m_renderer);
+				m = bc.Load(sgm->second.GetName(), prefetch ? prefetch->file : file);
+			}
+		}
+
+		// no usable compiled model, build it from its definition
+		if (!m) {
+			SceneGraph::Loader loader(m_renderer, false, false);
+			m = loader.LoadModel(name);
+		}
+	} catch (SceneGraph::LoadingError &) {
+		throw ModelNotFoundException();
+	}
+
+	if (!m)
+		throw ModelNotFoundException();
+	return m;
+}
+
+ModelCache::ModelMap::iterator ModelCache::AddModel(const std::string &name, SceneGraph::Model *model)
+{
+	GeometrySizeVisitor sizer;
+	model->GetRoot()->Accept(sizer);
+
+	ModelMap::iterator it = m_models.emplace(name, Entry()).first;
+	it->second.model = model;
+	it->second.size = sizer.size;
+	it->second.lastUsed = ++m_useCounter;
+	m_evictableSize += sizer.size;
+
+	EvictOverBudget();
+	return it;
+}
+
+void ModelCache::FinishPrefetch(const std::string &name)
+{
+	PROFILE_SCOPED()
+	auto it = m_prefetches.find(name);
+	if (it == m_prefetches.end())
+		return; // picked up by FindModel, or flushed
+
+	std::shared_ptr<PrefetchData> prefetch = it->second;
+	m_prefetches.erase(it);
+	if (m_models.count(name))
+		return;
+
+	try {
+		AddModel(name, LoadModel(name, prefetch.get()));
+	} catch (const ModelNotFoundException &) {
+		Output("Could not prefetch model: %s\n", name.c_str());
+	}
+}
+
+void ModelCache::EvictOverBudget()
 {
+	if (m_memoryBudget == 0)
+		return;
+
+	while (m_evictableSize > m_memoryBudget) {
+		if (!EvictLeastRecentlyUsed())
+			break;
+	}
+}
+
+size_t ModelCache::EvictLeastRecentlyUsed()
+{
+	// the model used last is about to be handed out, so it stays
+	ModelMap::iterator lru = m_models.end();
 	for (ModelMap::iterator it = m_models.begin(); it != m_models.end(); ++it) {
-		delete it->second;
+		const Entry &entry = it->second;
+		if (entry.pinned || entry.lastUsed == m_useCounter)
+			continue;
+		if (lru == m_models.end() || entry.lastUsed < lru->second.lastUsed)
+			lru = it;
+	}
+
+	if (lru == m_models.end())
+		return 0;
+
+	const size_t size = lru->second.size;
+	m_evictableSize -= size;
+	delete lru->second.model;
+	m_models.erase(lru);
+	return size;
+}
+
+size_t ModelCache::GetMemoryUsage() const
+{
+	size_t size = 0;
+	for (const auto &model : m_models)
+		size += model.second.size;
+	return size;
+}
+
+void ModelCache::Trim(size_t bytes)
+{
+	size_t freed = 0;
+	while (freed < bytes) {
+		const size_t size = EvictLeastRecentlyUsed();
+		if (!size)
+			break;
+		freed += size;
+	}
+}
+
+void ModelCache::BuildIndex()
+{
+	if (m_indexed)
+		return;
+	PROFILE_SCOPED()
+	m_indexed = true;
+
+	// the first file found wins, as with the loaders
+	for (FileSystem::FileEnumerator files(FileSystem::gameDataFiles, "models", FileSystem::FileEnumerator::Recurse); !files.Finished(); files.Next()) {
+		const FileSystem::FileInfo &info = files.Current();
+		if (info.IsFile() && ends_with_ci(info.GetPath(), ".sgm")) {
+			const std::string name = info.GetName();
+			m_sgmFiles.emplace(name.substr(0, name.size() - 4), info);
+		}
 	}
-	m_models.clear();
 }
@@ -4,12 +4,33 @@
 #ifndef _MODELCACHE_H
 #define _MODELCACHE_H
 /*
- * This class is a quick thoughtless hack
- * Also it only deals in New Models
+ * Owns the template of every model loaded by name, which instances are
+ * made from.
+ *
+ * Models are loaded on first use, but can be prefetched: compiled (.sgm)
+ * models are then read and decompressed on the streaming queue, leaving
+ * only building the scenegraph and uploading buffers to the main thread,
+ * when the prefetch finishes. A FindModel for a model still in flight
+ * loads it straight away rather than wait for the job.
+ *
+ * A template handed out by FindModel is pinned until Flush, as callers
+ * keep the pointer around. Templates only used through MakeInstance (most
+ * ships) are evicted least recently used first while the cache's geometry
+ * exceeds the memory budget. Instances hold their own references to the
+ * shared buffers and materials, so they are unaffected.
  */
 
+#include "FileSystem.h"
+
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <vector>
+
+class JobQueue;
+class JobSet;
 
 namespace Graphics {
 	class Renderer;
@@ -26,13 +47,69 @@ public:
 	};
 	ModelCache(Graphics::Renderer *);
 	~ModelCache();
+
+	// the template of the model, valid until Flush
 	SceneGraph::Model *FindModel(const std::string &);
+	// a new instance of the model, owned by the caller
+	SceneGraph::Model *MakeInstance(const std::string &);
+
+	// starts loading models which aren't loaded yet in the background
+	void Prefetch(const std::vector<std::string> &names);
+	// true while a background load of the model is in flight
+	bool IsPrefetching(const std::string &name) const { return m_prefetches.count(name) > 0; }
+
+	// Set the job queue models are prefetched on; nullptr (the default)
+	// disables prefetching and cancels any prefetches in flight.
+	void SetStreamingQueue(JobQueue *queue);
+
+	// bytes of vertex and index data unpinned templates may take up;
+	// zero (the default) for no limit
+	void SetMemoryBudget(size_t bytes);
+
+	// bytes of vertex and index data of every template
+	size_t GetMemoryUsage() const;
+	// evicts unpinned templates, least recently used first, until at least
+	// bytes have been freed or none are left
+	void Trim(size_t bytes);
+
 	void Flush();
 
 private:
-	typedef std::map<std::string, SceneGraph::Model *> ModelMap;
+	friend class ModelPrefetchJob;
+
+	struct Entry {
+		SceneGraph::Model *model = nullptr;
+		// vertex and index data of the model, in bytes
+		size_t size = 0;
+		uint64_t lastUsed = 0;
+		bool pinned = false;
+	};
+
+	struct PrefetchData;
+	typedef std::map<std::string, Entry> ModelMap;
+
+	Entry &Load(const std::string &name);
+	SceneGraph::Model *LoadModel(const std::string &name, const PrefetchData *prefetch);
+	ModelMap::iterator AddModel(const std::string &name, SceneGraph::Model *model);
+	void FinishPrefetch(const std::string &name);
+	void EvictOverBudget();
+	// returns the bytes freed, zero if nothing could be evicted
+	size_t EvictLeastRecentlyUsed();
+	void BuildIndex();
+
 	ModelMap m_models;
 	Graphics::Renderer *m_renderer;
+
+	// compiled models by name, found on first use
+	std::map<std::string, FileSystem::FileInfo> m_sgmFiles;
+	bool m_indexed;
+
+	std::map<std::string, std::shared_ptr<PrefetchData>> m_prefetches;
+	std::unique_ptr<JobSet> m_prefetchJobs;
+
+	size_t m_memoryBudget;
+	size_t m_evictableSize;
+	uint64_t m_useCounter;
 };
 
 #endif
@@ -9,6 +9,7 @@
 #include "core/IniConfig.h"
 #include "graphics/RenderState.h"
 #include "graphics/TextureBuilder.h"
+#include "scenegraph/EffectBatch.h"
 #include "scenegraph/FindNodeVisitor.h"
 #include "scenegraph/SceneGraph.h"
 #include "utils.h"
@@ -206,8 +207,13 @@ void NavLights::Update(float time)
 void NavLights::Render(Graphics::Renderer *renderer)
 {
 	if (!m_billboardTris.IsEmpty()) {
-		renderer->SetTransform(matrix4x4f::Identity());
-		renderer->DrawBuffer(&m_billboardTris, matHalos4x4.Get());
+		// the sprites are already in view space
+		if (SceneGraph::EffectBatch::IsCollecting()) {
+			SceneGraph::EffectBatch::AddVertices(matHalos4x4.Get(), m_billboardTris);
+		} else {
+			renderer->SetTransform(matrix4x4f::Identity());
+			renderer->DrawBuffer(&m_billboardTris, matHalos4x4.Get());
+		}
 		renderer->GetStats().AddToStatCount(Graphics::Stats::STAT_BILLBOARD, m_billboardTris.GetNumVerts());
 
 		m_billboardTris.Clear();
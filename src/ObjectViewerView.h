@@ -15,6 +15,7 @@ public:
 	ObjectViewerView();
 	virtual void Update() override;
 	virtual void Draw3D() override;
+	virtual bool HasScene() override { return true; }
 
 protected:
 	virtual void OnSwitchTo() override;
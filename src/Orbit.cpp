@@ -10,6 +10,16 @@
 #include "win32/WinMath.h"
 #endif
 
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define ORBIT_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ORBIT_SIMD_SSE2
+#endif
+
 double Orbit::OrbitalPeriod(double semiMajorAxis, double centralMass)
 {
 	return 2.0 * M_PI * sqrt((semiMajorAxis * semiMajorAxis * semiMajorAxis) / (G * centralMass));
@@ -173,6 +183,356 @@ vector3d Orbit::OrbitalPosAtTime(double t) const
 	return m_orient * vector3d(-cos_v * r, sin_v * r, 0);
 }
 
+// =============================================================================
+// Ephemeris
+
+// samples per period of a circular orbit, close enough for a single Newton
+// step to converge. Closer to parabolic orbits the eccentric anomaly changes
+// faster around periapsis, needing more of them
+static constexpr size_t EPHEMERIS_MIN_SAMPLES = 128;
+static constexpr size_t EPHEMERIS_MAX_SAMPLES = 4096;
+static constexpr int EPHEMERIS_MAX_ITERATIONS = 8;
+static constexpr double EPHEMERIS_TOLERANCE = 1e-13;
+
+OrbitEphemeris::OrbitEphemeris(double eccentricity) :
+	m_eccentricity(eccentricity)
+{
+	assert(eccentricity >= 0.0 && eccentricity < 1.0);
+	const double e = eccentricity;
+
+	// an even number, so that there is a sample at apoapsis
+	const double density = std::ceil(double(EPHEMERIS_MIN_SAMPLES) / sqrt(1.0 - e));
+	size_t numSteps = size_t(std::min(density, double(EPHEMERIS_MAX_SAMPLES)));
+	numSteps += numSteps & 1;
+	m_step = 2.0 * M_PI / double(numSteps);
+
+	m_eccentricAnomaly.resize(numSteps + 1);
+	m_derivative.resize(numSteps + 1);
+	m_eccentricAnomaly[0] = 0.0;
+	m_derivative[0] = 1.0 / (1.0 - e);
+
+	// E(M) is concave from periapsis to apoapsis, so stepping along the
+	// tangent from the previous sample starts Newton's method above the root,
+	// from where it converges monotonically
+	const size_t half = numSteps / 2;
+	for (size_t k = 1; k < half; k++) {
+		const double M = double(k) * m_step;
+		double E = m_eccentricAnomaly[k - 1] + m_step * m_derivative[k - 1];
+		for (int iter = 0; iter < 100; iter++) {
+			const double dE = (E - e * sin(E) - M) / (1.0 - e * cos(E));
+			E -= dE;
+			if (std::abs(dE) <= 1e-15)
+				break;
+		}
+
+		m_eccentricAnomaly[k] = E;
+		m_derivative[k] = 1.0 / (1.0 - e * cos(E));
+	}
+
+	m_eccentricAnomaly[half] = M_PI;
+	m_derivative[half] = 1.0 / (1.0 + e);
+
+	// and the way back is symmetric: E(2pi - M) = 2pi - E(M)
+	for (size_t k = half + 1; k <= numSteps; k++) {
+		m_eccentricAnomaly[k] = 2.0 * M_PI - m_eccentricAnomaly[numSteps - k];
+		m_derivative[k] = m_derivative[numSteps - k];
+	}
+}
+
+double OrbitEphemeris::EccentricAnomaly(double meanAnomaly, double &sinE, double &cosE) const
+{
+	const double e = m_eccentricity;
+	const size_t numSteps = m_eccentricAnomaly.size() - 1;
+
+	const double revolutions = std::floor(meanAnomaly * (0.5 / M_PI));
+	const double M = meanAnomaly - revolutions * 2.0 * M_PI;
+	const double x = Clamp(M / m_step, 0.0, double(numSteps));
+	const size_t k = std::min(size_t(x), numSteps - 1);
+
+	// cubic Hermite interpolation between the neighbouring samples
+	const double u = x - double(k);
+	const double u2 = u * u;
+	const double u3 = u2 * u;
+	double E = (2.0 * u3 - 3.0 * u2 + 1.0) * m_eccentricAnomaly[k] +
+		(u3 - 2.0 * u2 + u) * m_step * m_derivative[k] +
+		(3.0 * u2 - 2.0 * u3) * m_eccentricAnomaly[k + 1] +
+		(u3 - u2) * m_step * m_derivative[k + 1];
+
+	for (int iter = 0; iter < EPHEMERIS_MAX_ITERATIONS; iter++) {
+		const double sinE0 = sin(E);
+		const double cosE0 = cos(E);
+		const double slope = 1.0 - e * cosE0;
+		const double dE = (E - e * sinE0 - M) / slope;
+
+		// rotate the sine and cosine along with the Newton step, good enough
+		// while the step is small, as is its error e sinE dE^2 / 2 slope
+		E -= dE;
+		sinE = sinE0 - dE * cosE0;
+		cosE = cosE0 + dE * sinE0;
+		if (dE * dE * std::max(1.0, e / slope) < 2.0 * EPHEMERIS_TOLERANCE)
+			break;
+	}
+
+	return E + revolutions * 2.0 * M_PI;
+}
+
+const OrbitEphemeris &Orbit::GetEphemeris() const
+{
+	if (!m_ephemeris)
+		m_ephemeris = std::make_shared<const OrbitEphemeris>(m_eccentricity);
+	return *m_ephemeris;
+}
+
+vector3d Orbit::EphemerisPosAtTime(double t) const
+{
+	if (is_zero_general(m_semiMajorAxis)) return m_positionForStaticBody;
+	const double e = m_eccentricity;
+	if (!(e >= 0.0 && e < 1.0))
+		return OrbitalPosAtTime(t);
+
+	double sinE, cosE;
+	GetEphemeris().EccentricAnomaly(MeanAnomalyAtTime(t), sinE, cosE);
+
+	// as the elliptic case of calc_position_from_mean_anomaly, with r folded in
+	const double a = m_semiMajorAxis;
+	return m_orient * vector3d(a * (e - cosE), a * sqrt(1.0 - e * e) * sinE, 0);
+}
+
+double Orbit::TrueAnomalyAtTime(double t) const
+{
+	const double e = m_eccentricity;
+	if (!m_ephemeris || !(e >= 0.0 && e < 1.0))
+		return TrueAnomalyFromMeanAnomaly(MeanAnomalyAtTime(t));
+
+	double sinE, cosE;
+	m_ephemeris->EccentricAnomaly(MeanAnomalyAtTime(t), sinE, cosE);
+	return atan2(sqrt(1.0 - e * e) * sinE, cosE - e);
+}
+
+// =============================================================================
+// Batched Kepler solver
+//
+// Kepler's equation is solved for the elliptic orbits of a batch together,
+// running Newton iterations on all lanes until every one has converged, up to
+// a fixed maximum. The sine and cosine are evaluated with the fdlibm kernel
+// polynomials so that every lane runs the same instructions. Lanes which
+// haven't converged by then (only with eccentricities very close to 1) are
+// solved again by the scalar code above.
+
+namespace {
+#if defined(ORBIT_SIMD_AVX)
+	struct Lanes {
+		using V = __m256d;
+		static constexpr int WIDTH = 4;
+		static V load(const double *p) { return _mm256_loadu_pd(p); }
+		static void store(double *p, V v) { _mm256_storeu_pd(p, v); }
+		static V set1(double d) { return _mm256_set1_pd(d); }
+		static V add(V a, V b) { return _mm256_add_pd(a, b); }
+		static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+		static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+		static V div(V a, V b) { return _mm256_div_pd(a, b); }
+		static V abs(V a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+		static V round(V a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static V or_(V a, V b) { return _mm256_or_pd(a, b); }
+		static V cmpeq(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+		static V cmpge(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+		static V cmpgt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+		static V select(V mask, V a, V b) { return _mm256_blendv_pd(b, a, mask); }
+		static int movemask(V v) { return _mm256_movemask_pd(v); }
+	};
+#elif defined(ORBIT_SIMD_SSE2)
+	struct Lanes {
+		using V = __m128d;
+		static constexpr int WIDTH = 2;
+		static V load(const double *p) { return _mm_loadu_pd(p); }
+		static void store(double *p, V v) { _mm_storeu_pd(p, v); }
+		static V set1(double d) { return _mm_set1_pd(d); }
+		static V add(V a, V b) { return _mm_add_pd(a, b); }
+		static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+		static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+		static V div(V a, V b) { return _mm_div_pd(a, b); }
+		static V abs(V a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+		static V round(V a)
+		{
+			// adding and subtracting 2^52 + 2^51 rounds any |a| < 2^51 to the nearest integer
+			const V magic = _mm_set1_pd(6755399441055744.0);
+			return _mm_sub_pd(_mm_add_pd(a, magic), magic);
+		}
+		static V or_(V a, V b) { return _mm_or_pd(a, b); }
+		static V cmpeq(V a, V b) { return _mm_cmpeq_pd(a, b); }
+		static V cmpge(V a, V b) { return _mm_cmpge_pd(a, b); }
+		static V cmpgt(V a, V b) { return _mm_cmpgt_pd(a, b); }
+		static V select(V mask, V a, V b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+		static int movemask(V v) { return _mm_movemask_pd(v); }
+	};
+#else
+	struct Lanes {
+		using V = double;
+		static constexpr int WIDTH = 1;
+		static V load(const double *p) { return *p; }
+		static void store(double *p, V v) { *p = v; }
+		static V set1(double d) { return d; }
+		static V add(V a, V b) { return a + b; }
+		static V sub(V a, V b) { return a - b; }
+		static V mul(V a, V b) { return a * b; }
+		static V div(V a, V b) { return a / b; }
+		static V abs(V a) { return std::fabs(a); }
+		static V round(V a) { return std::nearbyint(a); }
+		// masks are 1.0 for true and 0.0 for false
+		static V or_(V a, V b) { return a != 0.0 || b != 0.0 ? 1.0 : 0.0; }
+		static V cmpeq(V a, V b) { return a == b ? 1.0 : 0.0; }
+		static V cmpge(V a, V b) { return a >= b ? 1.0 : 0.0; }
+		static V cmpgt(V a, V b) { return a > b ? 1.0 : 0.0; }
+		static V select(V mask, V a, V b) { return mask != 0.0 ? a : b; }
+		static int movemask(V v) { return v != 0.0 ? 1 : 0; }
+	};
+#endif
+
+	using V = Lanes::V;
+	constexpr int W = Lanes::WIDTH;
+
+	// Newton iterations starting from E = M + 0.85e (Danby), which are enough
+	// to converge for all but the most eccentric orbits
+	constexpr int KEPLER_MAX_ITERATIONS = 8;
+	// residual of Kepler's equation at which a lane has converged
+	constexpr double KEPLER_TOLERANCE = 1e-12;
+
+	inline V negate(V mask, V x)
+	{
+		return Lanes::select(mask, Lanes::sub(Lanes::set1(0.0), x), x);
+	}
+
+	// sine and cosine with a single Cody-Waite range reduction step, which is
+	// accurate for the few radians the eccentric anomaly can take here
+	inline void sincos(V x, V &sin, V &cos)
+	{
+		// fdlibm's two-part pi/2 split and __kernel_sin / __kernel_cos coefficients
+		const V k = Lanes::round(Lanes::mul(x, Lanes::set1(6.36619772367581382433e-01)));
+		V r = Lanes::sub(x, Lanes::mul(k, Lanes::set1(1.57079632673412561417e+00)));
+		r = Lanes::sub(r, Lanes::mul(k, Lanes::set1(6.07710050650619224932e-11)));
+		const V z = Lanes::mul(r, r);
+
+		V ps = Lanes::set1(1.58969099521155010221e-10);
+		ps = Lanes::add(Lanes::mul(ps, z), Lanes::set1(-2.50507602534068634195e-08));
+		ps = Lanes::add(Lanes::mul(ps, z), Lanes::set1(2.75573137070700676789e-06));
+		ps = Lanes::add(Lanes::mul(ps, z), Lanes::set1(-1.98412698298579493134e-04));
+		ps = Lanes::add(Lanes::mul(ps, z), Lanes::set1(8.33333333332248946124e-03));
+		ps = Lanes::add(Lanes::mul(ps, z), Lanes::set1(-1.66666666666666324348e-01));
+		const V s = Lanes::add(r, Lanes::mul(Lanes::mul(r, z), ps));
+
+		V pc = Lanes::set1(-1.13596475577881948265e-11);
+		pc = Lanes::add(Lanes::mul(pc, z), Lanes::set1(2.08757232129817482790e-09));
+		pc = Lanes::add(Lanes::mul(pc, z), Lanes::set1(-2.75573143513906633035e-07));
+		pc = Lanes::add(Lanes::mul(pc, z), Lanes::set1(2.48015872894767294178e-05));
+		pc = Lanes::add(Lanes::mul(pc, z), Lanes::set1(-1.38888888888741095749e-03));
+		pc = Lanes::add(Lanes::mul(pc, z), Lanes::set1(4.16666666666666019037e-02));
+		const V c = Lanes::add(Lanes::sub(Lanes::set1(1.0), Lanes::mul(z, Lanes::set1(0.5))), Lanes::mul(Lanes::mul(z, z), pc));
+
+		// quadrant in [0, 4): sin is s, c, -s, -c and cos is c, -s, -c, s
+		const V quadrant = Lanes::sub(k, Lanes::mul(Lanes::set1(4.0), Lanes::round(Lanes::mul(Lanes::sub(k, Lanes::set1(1.5)), Lanes::set1(0.25)))));
+		const V isOne = Lanes::cmpeq(quadrant, Lanes::set1(1.0));
+		const V isOdd = Lanes::or_(isOne, Lanes::cmpeq(quadrant, Lanes::set1(3.0)));
+		const V negSin = Lanes::cmpge(quadrant, Lanes::set1(2.0));
+		const V negCos = Lanes::or_(isOne, Lanes::cmpeq(quadrant, Lanes::set1(2.0)));
+
+		sin = negate(negSin, Lanes::select(isOdd, c, s));
+		cos = negate(negCos, Lanes::select(isOdd, s, c));
+	}
+
+	// Solve M = E - e sin(E) for the elliptic orbits of a batch, returning
+	// the sine and cosine of E. Returns false if any lane failed to converge.
+	inline bool SolveKepler(const double *meanAnomaly, const double *eccentricity, double *sinE, double *cosE, int *converged)
+	{
+		const V e = Lanes::load(eccentricity);
+
+		// mean anomaly reduced to [-pi, pi]
+		V M = Lanes::load(meanAnomaly);
+		M = Lanes::sub(M, Lanes::mul(Lanes::round(Lanes::mul(M, Lanes::set1(0.5 / M_PI))), Lanes::set1(2.0 * M_PI)));
+
+		V E = Lanes::add(M, negate(Lanes::cmpgt(Lanes::set1(0.0), M), Lanes::mul(Lanes::set1(0.85), e)));
+
+		// iterate until every lane has converged
+		V s, c;
+		int mask = 0;
+		for (int iter = 0; iter <= KEPLER_MAX_ITERATIONS; iter++) {
+			sincos(E, s, c);
+			const V f = Lanes::sub(Lanes::sub(E, Lanes::mul(e, s)), M);
+			// NaN residuals fail the comparison and are treated as not converged
+			mask = Lanes::movemask(Lanes::cmpge(Lanes::set1(KEPLER_TOLERANCE), Lanes::abs(f)));
+			if (mask == (1 << W) - 1 || iter == KEPLER_MAX_ITERATIONS)
+				break;
+
+			const V df = Lanes::sub(Lanes::set1(1.0), Lanes::mul(e, c));
+			E = Lanes::sub(E, Lanes::div(f, df));
+		}
+
+		Lanes::store(sinE, s);
+		Lanes::store(cosE, c);
+
+		for (int lane = 0; lane < W; lane++)
+			converged[lane] = (mask >> lane) & 1;
+
+		return mask == (1 << W) - 1;
+	}
+} // namespace
+
+void Orbit::OrbitalPosAtTimes(size_t count, const Orbit *const *orbits, const double *times, vector3d *positions)
+{
+	// gather the elliptic orbits, everything else takes the scalar path
+	std::vector<uint32_t> batch;
+	std::vector<double> meanAnomaly;
+	std::vector<double> eccentricity;
+	batch.reserve(count);
+	meanAnomaly.reserve(count + W);
+	eccentricity.reserve(count + W);
+
+	for (size_t idx = 0; idx < count; idx++) {
+		const Orbit *orbit = orbits[idx];
+		if (is_zero_general(orbit->m_semiMajorAxis) || !(orbit->m_eccentricity < 1.0)) {
+			positions[idx] = orbit->OrbitalPosAtTime(times[idx]);
+			continue;
+		}
+
+		batch.push_back(idx);
+		meanAnomaly.push_back(orbit->MeanAnomalyAtTime(times[idx]));
+		eccentricity.push_back(orbit->m_eccentricity);
+	}
+
+	// pad to a whole number of lanes with circular orbits
+	const size_t batchSize = batch.size();
+	meanAnomaly.resize((batchSize + W - 1) / W * W, 0.0);
+	eccentricity.resize(meanAnomaly.size(), 0.0);
+
+	std::vector<double> sinE(meanAnomaly.size());
+	std::vector<double> cosE(meanAnomaly.size());
+	for (size_t lane = 0; lane < batchSize; lane += W) {
+		int converged[W];
+		if (SolveKepler(&meanAnomaly[lane], &eccentricity[lane], &sinE[lane], &cosE[lane], converged))
+			continue;
+
+		for (int idx = 0; idx < W; idx++) {
+			if (!converged[idx] && lane + idx < batchSize) {
+				const size_t orbit = batch[lane + idx];
+				positions[orbit] = orbits[orbit]->OrbitalPosAtTime(times[orbit]);
+				// marks the position as already done
+				eccentricity[lane + idx] = -1.0;
+			}
+		}
+	}
+
+	for (size_t idx = 0; idx < batchSize; idx++) {
+		if (eccentricity[idx] < 0.0)
+			continue;
+
+		// the same position as OrbitalPosAtTime, with r * cos(v) and r * sin(v)
+		// expressed in terms of the eccentric anomaly
+		const Orbit *orbit = orbits[batch[idx]];
+		const double e = eccentricity[idx];
+		const double a = orbit->m_semiMajorAxis;
+		positions[batch[idx]] = orbit->m_orient * vector3d(a * (e - cosE[idx]), a * sqrt(1.0 - e * e) * sinE[idx], 0);
+	}
+}
+
 double Orbit::OrbitalTimeAtPos(const vector3d &pos, double centralMass) const
 {
 	double c = m_eccentricity * m_semiMajorAxis;
@@ -233,9 +593,14 @@ vector3d Orbit::OrbitalVelocityAtTime(double totalMass, double t) const
 // mean anomaly <-> true anomaly conversion doesn't have
 // to be taken into account
 vector3d Orbit::EvenSpacedPosTrajectory(double t, double timeOffset) const
+{
+	return EvenSpacedPosTrajectoryFrom(t, TrueAnomalyAtTime(timeOffset));
+}
+
+vector3d Orbit::EvenSpacedPosTrajectoryFrom(double t, double startTrueAnomaly) const
 {
 	const double e = m_eccentricity;
-	double v = 2 * M_PI * t + TrueAnomalyFromMeanAnomaly(MeanAnomalyAtTime(timeOffset));
+	double v = 2 * M_PI * t + startTrueAnomaly;
 	double r;
 
 	if (e < 1.0) {
@@ -291,6 +656,7 @@ void Orbit::SetShapeAroundBarycentre(double semiMajorAxis, double totalMass, dou
 	m_semiMajorAxis = semiMajorAxis;
 	m_eccentricity = eccentricity;
 	m_velocityAreaPerSecond = calc_velocity_area_per_sec_gravpoint(semiMajorAxis, totalMass, bodyMass, eccentricity);
+	m_ephemeris.reset();
 }
 
 void Orbit::SetShapeAroundPrimary(double semiMajorAxis, double centralMass, double eccentricity)
@@ -298,6 +664,7 @@ void Orbit::SetShapeAroundPrimary(double semiMajorAxis, double centralMass, doub
 	m_semiMajorAxis = semiMajorAxis;
 	m_eccentricity = eccentricity;
 	m_velocityAreaPerSecond = calc_velocity_area_per_sec(semiMajorAxis, centralMass, eccentricity);
+	m_ephemeris.reset();
 }
 
 Orbit Orbit::ForStaticBody(const vector3d &position)
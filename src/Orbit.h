@@ -9,6 +9,31 @@
 
 #include <cassert>
 #include <cmath>
+#include <memory>
+#include <vector>
+
+// Eccentric anomaly of an elliptic orbit tabulated over one period of mean
+// anomaly. Samples are spaced more closely the more eccentric the orbit is,
+// and interpolating between them gives a start for Newton's method which
+// usually converges in a single step. The table only depends on the
+// eccentricity, so an Orbit keeps it until its shape changes.
+class OrbitEphemeris {
+public:
+	explicit OrbitEphemeris(double eccentricity);
+
+	// solve Kepler's equation for any mean anomaly, returning the eccentric
+	// anomaly along with its sine and cosine
+	double EccentricAnomaly(double meanAnomaly, double &sinE, double &cosE) const;
+
+	double GetEccentricity() const { return m_eccentricity; }
+	size_t GetNumSamples() const { return m_eccentricAnomaly.size(); }
+
+private:
+	double m_eccentricity;
+	double m_step; // mean anomaly between samples
+	std::vector<double> m_eccentricAnomaly;
+	std::vector<double> m_derivative; // dE/dM = 1 / (1 - e cos E)
+};
 
 class Orbit {
 public:
@@ -40,11 +65,23 @@ public:
 	void SetPhase(double orbitalPhaseAtStart) { m_orbitalPhaseAtStart = orbitalPhaseAtStart; }
 
 	vector3d OrbitalPosAtTime(double t) const;
+	// OrbitalPosAtTime for many orbits at once, with the elliptic orbits solved
+	// together in SIMD lanes
+	static void OrbitalPosAtTimes(size_t count, const Orbit *const *orbits, const double *times, vector3d *positions);
+	// OrbitalPosAtTime through the ephemeris of an elliptic orbit, which is
+	// built by the first call and then shared with copies of this Orbit.
+	// Not safe to call concurrently on the same Orbit.
+	vector3d EphemerisPosAtTime(double t) const;
 	double OrbitalTimeAtPos(const vector3d &pos, double centralMass) const;
 	vector3d OrbitalVelocityAtTime(double totalMass, double t) const;
 
 	// 0.0 <= t <= 1.0. Not for finding orbital pos
 	vector3d EvenSpacedPosTrajectory(double t, double timeOffset = 0) const;
+	// as above, starting from a true anomaly given by TrueAnomalyAtTime(), so
+	// that a whole trajectory only needs to solve Kepler's equation once
+	vector3d EvenSpacedPosTrajectoryFrom(double t, double startTrueAnomaly) const;
+	// uses the ephemeris if it has already been built
+	double TrueAnomalyAtTime(double t) const;
 
 	double Period() const;
 	vector3d Apogeum() const;
@@ -60,6 +97,7 @@ private:
 	double TrueAnomalyFromMeanAnomaly(double MeanAnomaly) const;
 	double MeanAnomalyFromTrueAnomaly(double trueAnomaly) const;
 	double MeanAnomalyAtTime(double time) const;
+	const OrbitEphemeris &GetEphemeris() const;
 
 	vector3d m_positionForStaticBody;
 	double m_eccentricity;
@@ -68,6 +106,8 @@ private:
 	/* dup " " --------------------------------------- */
 	double m_velocityAreaPerSecond; // seconds
 	matrix3x3d m_orient;
+	// built on demand by GetEphemeris() and dropped when the shape changes
+	mutable std::shared_ptr<const OrbitEphemeris> m_ephemeris;
 };
 
 #endif
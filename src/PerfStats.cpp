@@ -2,50 +2,155 @@
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
 #include "PerfStats.h"
-#include "utils.h"
-#include <mutex>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <stdexcept>
-#include <tuple>
-#include <utility>
+#include <thread>
 
 using namespace Perf;
 
-Stats::CounterRef Stats::GetOrCreateCounter(std::string str, bool resetOnNewFrame)
+Summary Perf::Summarise(std::vector<double> samples)
 {
-	size_t hash = m_strHashFn(str);
-	if (hash == 0)
-		throw std::runtime_error("Hash of string " + str + " equals zero. This should never happen.");
+	Summary summary;
+	if (samples.empty())
+		return summary;
 
-	m_counterMutex.lock();
-	m_definedCounters.emplace(hash, str);
+	std::sort(samples.begin(), samples.end());
 
-	// Use std::piecewise_construct, as it's the only overload for non-copyable,
-	// non-movable objects like std::atomic
-	m_counters.emplace(std::piecewise_construct,
-		std::forward_as_tuple(hash),
-		std::forward_as_tuple(resetOnNewFrame));
-	m_counterMutex.unlock();
+	const auto percentile = [&samples](double p) {
+		const size_t rank = size_t(std::ceil(p * samples.size()));
+		return samples[std::max<size_t>(rank, 1) - 1];
+	};
 
-	return CounterRef(hash);
+	double total = 0.0;
+	for (double sample : samples)
+		total += sample;
+
+	summary.count = samples.size();
+	summary.mean = total / samples.size();
+	summary.min = samples.front();
+	summary.p50 = percentile(0.50);
+	summary.p95 = percentile(0.95);
+	summary.p99 = percentile(0.99);
+	summary.max = samples.back();
+	return summary;
 }
 
-void Stats::FlushFrame()
+Stats::Stats()
+{
+	for (Counter &counter : m_counters) {
+		counter.hash.store(0, std::memory_order_relaxed);
+		counter.ready.store(false, std::memory_order_relaxed);
+		counter.resetOnNewFrame = true;
+	}
+
+	for (Shard &shard : m_shards)
+		for (auto &value : shard.values)
+			value.store(0, std::memory_order_relaxed);
+
+	memset(m_history, 0, sizeof(m_history));
+}
+
+// Threads are spread over the shards in the order they first touch a counter
+uint32_t Stats::GetShard()
+{
+	static std::atomic<uint32_t> s_nextShard = 0;
+	thread_local uint32_t tl_shard = s_nextShard.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS;
+	return tl_shard;
+}
+
+const Stats::Counter *Stats::GetReadyCounter(uint32_t slot) const
 {
-	m_counterMutex.lock();
+	const Counter &counter = m_counters[slot];
+	if (!counter.hash.load(std::memory_order_acquire))
+		return nullptr;
 
-	FrameInfo lastFrame;
+	// the slot has been claimed; its owner is about to fill in the name
+	while (!counter.ready.load(std::memory_order_acquire))
+		std::this_thread::yield();
 
-	try {
-		for (auto iter = m_counters.begin(); iter != m_counters.end(); iter++) {
-			lastFrame.emplace(m_definedCounters[iter->first], iter->second.ctr.load());
-			if (iter->second.resetOnNewFrame && !m_neverReset)
-				iter->second.ctr.store(0);
+	return &counter;
+}
+
+Stats::CounterRef Stats::GetOrCreateCounter(CounterName name, bool resetOnNewFrame)
+{
+	// zero marks a free slot
+	const uint32_t hash = name.hash ? name.hash : 1;
+
+	for (uint32_t probe = 0; probe < MAX_COUNTERS; probe++) {
+		const uint32_t slot = (hash + probe) % MAX_COUNTERS;
+		Counter &counter = m_counters[slot];
+
+		uint32_t expected = 0;
+		if (counter.hash.compare_exchange_strong(expected, hash, std::memory_order_acq_rel)) {
+			counter.name = name.name;
+			counter.resetOnNewFrame = resetOnNewFrame;
+			counter.ready.store(true, std::memory_order_release);
+			return CounterRef(slot + 1);
 		}
 
-		m_frameCache = lastFrame;
-	} catch (std::runtime_error &e) {
-		Output("Error updating stats for frame: %s\n", e.what());
+		if (expected == hash && GetReadyCounter(slot)->name == name.name)
+			return CounterRef(slot + 1);
+	}
+
+	throw std::runtime_error("Unable to create counter " + std::string(name.name) + ": too many counters.");
+}
+
+Stats::CounterRef Stats::FindCounter(CounterName name) const
+{
+	const uint32_t hash = name.hash ? name.hash : 1;
+
+	for (uint32_t probe = 0; probe < MAX_COUNTERS; probe++) {
+		const uint32_t slot = (hash + probe) % MAX_COUNTERS;
+		const Counter *counter = GetReadyCounter(slot);
+		if (!counter)
+			break;
+
+		if (counter->hash.load(std::memory_order_relaxed) == hash && counter->name == name.name)
+			return CounterRef(slot + 1);
+	}
+
+	return CounterRef(nullptr);
+}
+
+std::string Stats::GetNameForCounter(CounterRef ref) const
+{
+	assert(ref.id != 0);
+	return GetReadyCounter(ref.id - 1)->name;
+}
+
+uint32_t Stats::GetFrameValue(CounterRef ref, uint32_t framesAgo) const
+{
+	assert(ref.id != 0);
+	if (framesAgo >= GetNumFrames())
+		return 0;
+
+	return m_history[(m_numFrames - 1 - framesAgo) % HISTORY_FRAMES][ref.id - 1];
+}
+
+void Stats::FlushFrame()
+{
+	uint32_t *totals = m_history[m_numFrames % HISTORY_FRAMES];
+
+	for (uint32_t slot = 0; slot < MAX_COUNTERS; slot++) {
+		const Counter *counter = GetReadyCounter(slot);
+		if (!counter) {
+			totals[slot] = 0;
+			continue;
+		}
+
+		const bool reset = counter->resetOnNewFrame && !m_neverReset;
+
+		// exchanging rather than loading and storing, so that nothing added
+		// while the shards are collected is lost
+		uint32_t total = 0;
+		for (Shard &shard : m_shards)
+			total += reset ? shard.values[slot].exchange(0, std::memory_order_relaxed) : shard.values[slot].load(std::memory_order_relaxed);
+
+		totals[slot] = total;
+		m_frameCache[counter->name] = total;
 	}
 
-	m_counterMutex.unlock();
+	m_numFrames++;
 }
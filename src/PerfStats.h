@@ -3,16 +3,32 @@
 
 #pragma once
 
+#include "core/FNV1a.h"
+
 #include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <map>
-#include <mutex>
-#include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace Perf {
+	// Distribution of a series of samples, e.g. frame times in a benchmark.
+	// Percentiles are nearest-rank.
+	struct Summary {
+		size_t count = 0;
+		double mean = 0.0;
+		double min = 0.0;
+		double p50 = 0.0;
+		double p95 = 0.0;
+		double p99 = 0.0;
+		double max = 0.0;
+	};
+
+	Summary Summarise(std::vector<double> samples);
+
 	/**
 	* Simple atomic counter implementation for performance counters.
 	*
@@ -20,11 +36,35 @@ namespace Perf {
 	* Once you have a counter reference, you can call stats->CounterAdd(ref, 12) to update the counter.
 	* The Counter* functions are thread-safe so long as they are called with a proper CounterRef.
 	* Call FlushFrame() to collate all stats from the current frame and write them to the frame cache.
+	*
+	* Counters live in a fixed-size, lock-free table keyed by the FNV1a hash of
+	* their name, so creating and looking up counters from any thread never
+	* blocks. Each counter has a value per shard, and a thread only writes to
+	* its own shard; FlushFrame() adds the shards up. The totals of the last
+	* HISTORY_FRAMES frames are kept for graphing.
 	*/
 	class Stats {
 	public:
+		static constexpr uint32_t MAX_COUNTERS = 128;
+		static constexpr uint32_t NUM_SHARDS = 8;
+		static constexpr uint32_t HISTORY_FRAMES = 128;
+
 		using FrameInfo = std::map<std::string, uint32_t>;
 
+		// A counter name with its hash, computed at compile time when built
+		// from a literal
+		struct CounterName {
+			constexpr CounterName(std::string_view n) :
+				name(n), hash(hash_32_fnv1a(n.data(), n.size())) {}
+			constexpr CounterName(const char *n) :
+				CounterName(std::string_view(n)) {}
+			CounterName(const std::string &n) :
+				CounterName(std::string_view(n)) {}
+
+			std::string_view name;
+			uint32_t hash;
+		};
+
 		// Simple opaque struct to make it more difficult to accidentally clobber memory or threading constraints
 		struct CounterRef {
 			CounterRef() = delete;
@@ -38,65 +78,91 @@ namespace Perf {
 				id(t) {}
 		};
 
-		CounterRef GetOrCreateCounter(std::string name, bool resetOnNewFrame = true);
+		Stats();
+
+		// Throws std::runtime_error if all MAX_COUNTERS are in use
+		CounterRef GetOrCreateCounter(CounterName name, bool resetOnNewFrame = true);
+
+		// Returns a null CounterRef if there is no such counter
+		CounterRef FindCounter(CounterName name) const;
 
 		void CounterAdd(CounterRef ref, uint32_t amount = 1) const
 		{
 			assert(ref.id != 0);
-			m_counters.at(ref.id).ctr.fetch_add(amount);
+			Value(ref, GetShard()).fetch_add(amount, std::memory_order_relaxed);
 		}
 
 		void CounterDec(CounterRef ref, uint32_t amount = 1) const
 		{
 			assert(ref.id != 0);
-			m_counters.at(ref.id).ctr.fetch_sub(amount);
+			Value(ref, GetShard()).fetch_sub(amount, std::memory_order_relaxed);
 		}
 
+		// Setting a counter clears the other shards, so an add racing with
+		// a set may be lost
 		void CounterSet(CounterRef ref, uint32_t value) const
 		{
 			assert(ref.id != 0);
-			m_counters.at(ref.id).ctr.store(value);
+			for (uint32_t shard = 1; shard < NUM_SHARDS; shard++)
+				Value(ref, shard).store(0, std::memory_order_relaxed);
+			Value(ref, 0).store(value, std::memory_order_relaxed);
 		}
 
-		void CounterReset(CounterRef ref) const
-		{
-			assert(ref.id != 0);
-			m_counters.at(ref.id).ctr.store(0);
-		}
+		void CounterReset(CounterRef ref) const { CounterSet(ref, 0); }
 
 		void EnableReset(bool enabled) { m_neverReset = !enabled; }
 
 		const FrameInfo &GetFrameStats() const { return m_frameCache; }
 
-		std::string GetNameForCounter(CounterRef ref) const { return m_definedCounters.at(ref.id); }
+		// The total of a counter at the end of a flushed frame, framesAgo
+		// frames before the last one
+		uint32_t GetFrameValue(CounterRef ref, uint32_t framesAgo = 0) const;
+
+		// Number of frames in the history, up to HISTORY_FRAMES
+		uint32_t GetNumFrames() const { return m_numFrames < HISTORY_FRAMES ? m_numFrames : HISTORY_FRAMES; }
+
+		std::string GetNameForCounter(CounterRef ref) const;
 
 		// Terminate the current frame and make performance counters available with GetFrameStats().
+		// Should not be called from more than one thread at a time.
 		void FlushFrame();
 
 	private:
 		struct Counter {
-			Counter(bool reset) :
-				ctr(0), resetOnNewFrame(reset){};
-			// mutable because the only thing we're modifying via non-const references is the atomic counters
-			mutable std::atomic<uint32_t> ctr;
+			std::atomic<uint32_t> hash; // zero when the slot is free
+			std::atomic<bool> ready;	// name and flags are set
 			bool resetOnNewFrame;
+			std::string name;
+		};
+
+		// each shard's values fill whole cache lines, so threads writing to
+		// different shards don't contend
+		struct alignas(64) Shard {
+			// mutable because the only thing we're modifying via const references is the atomic counters
+			mutable std::atomic<uint32_t> values[MAX_COUNTERS];
 		};
 
-		// hashmap of counter ID to counter value
-		std::map<std::size_t, Counter> m_counters;
+		static uint32_t GetShard();
+
+		std::atomic<uint32_t> &Value(CounterRef ref, uint32_t shard) const
+		{
+			return m_shards[shard].values[ref.id - 1];
+		}
+
+		const Counter *GetReadyCounter(uint32_t slot) const;
+
+		// open-addressed by name hash
+		Counter m_counters[MAX_COUNTERS];
+		Shard m_shards[NUM_SHARDS];
+
+		// per-frame totals, indexed by frame % HISTORY_FRAMES
+		uint32_t m_history[HISTORY_FRAMES][MAX_COUNTERS];
+		uint32_t m_numFrames = 0;
 
 		// Cache the previous frame
 		FrameInfo m_frameCache;
 
 		bool m_neverReset = false;
-
-		// hashmap of counter IDs to counter names
-		std::map<std::size_t, std::string> m_definedCounters;
-
-		// mutex used to synchronize updates to definedCounters
-		std::mutex m_counterMutex;
-		// store a std::hash instance so we don't have to recreate it every time we want to hash a string.
-		std::hash<std::string> m_strHashFn;
 	};
 
 } // namespace Perf
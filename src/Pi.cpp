@@ -10,26 +10,36 @@
 
 #include "BaseSphere.h"
 #include "Beam.h"
+#include "Camera.h"
+#include "CameraPath.h"
 #include "CityOnPlanet.h"
 #include "DeathView.h"
 #include "EnumStrings.h"
 #include "FaceParts.h"
 #include "FileSystem.h"
 #include "Frame.h"
+#include "GasGiant.h"
+#include "GeoPatch.h"
 #include "Game.h"
 #include "GameConfig.h"
 #include "GameLog.h"
 #include "GameSaveError.h"
+#include "GeoSphere.h"
 #include "Input.h"
 #include "Intro.h"
+#include "JsonUtils.h"
 #include "Lang.h"
 #include "Missile.h"
 #include "ModManager.h"
 #include "ModelCache.h"
 #include "NavLights.h"
+#include "Planet.h"
 #include "Player.h"
+#include "PerfStats.h"
 #include "PngWriter.h"
 #include "Projectile.h"
+#include "QualityGovernor.h"
+#include "Replay.h"
 #include "SaveGameManager.h"
 #include "SectorView.h"
 #include "Sfx.h"
@@ -47,26 +57,39 @@
 #include "ObjectViewerView.h"
 #endif
 
+#include "collider/BVHTree.h"
+
+#include "galaxy/Galaxy.h"
 #include "galaxy/GalaxyGenerator.h"
 
 #include "graphics/Material.h"
 #include "graphics/RenderState.h"
 #include "graphics/Renderer.h"
+#include "graphics/TextureBuilder.h"
+#include "graphics/dummy/RendererDummy.h"
 #include "graphics/opengl/RendererGL.h"
 
 #include "core/GuiApplication.h"
 #include "core/Log.h"
+#include "core/MemoryBudget.h"
 #include "core/OS.h"
+#include "core/PerfTimeline.h"
 
 #include "lua/Lua.h"
+#include "lua/LuaChunkCache.h"
 #include "lua/LuaConsole.h"
 #include "lua/LuaEvent.h"
 #include "lua/LuaTimer.h"
 
+#include "pigui/FaceCache.h"
 #include "pigui/LuaPiGui.h"
 #include "pigui/PerfInfo.h"
 #include "pigui/PiGui.h"
 
+#include "scenegraph/ColorMap.h"
+#include "scenegraph/LOD.h"
+#include "scenegraph/Loader.h"
+
 #include "sound/AmbientSounds.h"
 #include "sound/Sound.h"
 #include "sound/SoundMusic.h"
@@ -75,6 +98,8 @@
 #include "versioningInfo.h"
 
 #include <SDL.h>
+#include <algorithm>
+#include <cinttypes>
 
 #ifdef PROFILE_LUA_TIME
 #include <time.h>
@@ -128,6 +153,7 @@ bool Pi::DrawGUI = true;
 Graphics::Renderer *Pi::renderer;
 PiGui::Instance *Pi::pigui = nullptr;
 ModelCache *Pi::modelCache;
+MemoryBudget *Pi::memoryBudget = nullptr;
 Intro *Pi::intro;
 SDLGraphics *Pi::sdl;
 bool Pi::isRecordingVideo = false;
@@ -137,6 +163,45 @@ Pi::App *Pi::m_instance = nullptr;
 
 Sound::MusicPlayer Pi::musicPlayer;
 
+// the game data files read during the last startup, in the user dir
+static const char s_readAheadListName[] = "startup-readahead.txt";
+
+// Warms the OS file cache with the files the last startup read, so the
+// loaders find them there instead of waiting on the disk one at a time
+class ReadAheadJob : public Job {
+public:
+	ReadAheadJob(std::vector<std::string> &&paths) :
+		m_paths(std::move(paths)),
+		m_cancelled(false)
+	{}
+
+	void OnRun() override
+	{
+		PROFILE_SCOPED()
+		FileSystem::PrefetchFiles(m_paths, m_cancelled);
+	}
+	void OnFinish() override {}
+	void OnCancel() override { m_cancelled = true; }
+
+private:
+	std::vector<std::string> m_paths;
+	std::atomic<bool> m_cancelled;
+};
+
+// Runs a load step that doesn't need the main thread on a worker
+class LoadStepJob : public Job {
+public:
+	LoadStepJob(const std::function<void()> &fn) :
+		m_fn(fn)
+	{}
+
+	void OnRun() override { m_fn(); }
+	void OnFinish() override {}
+
+private:
+	std::function<void()> m_fn;
+};
+
 class StartupScreen : public Application::Lifecycle {
 public:
 	StartupScreen() :
@@ -145,35 +210,74 @@ public:
 	}
 
 	std::unique_ptr<JobSet> asyncStartupQueue;
-	std::unique_ptr<JobSet> currentStepQueue;
+
+	// jobs queued by the load step running on the main thread
+	JobSet *GetCurrentStepQueue() const { return m_runningStep ? m_runningStep->jobs.get() : nullptr; }
 
 protected:
+	enum class StepThread {
+		Main, // needs the main thread, e.g. for the renderer or the Lua state
+		Any	  // may run on a worker; must not queue jobs of its own
+	};
+
 	struct LoadStep {
 		// TODO: use a lighter-weight wrapper over lambdas instead of std::function
 		std::function<void()> fn;
 		std::string name;
+		std::vector<size_t> deps; // steps to finish before this one starts
+		StepThread thread;
+		// the jobs the step queued, or the step itself when run on a worker
+		std::unique_ptr<JobSet> jobs;
+		bool started;
+		bool done;
+		Profiler::Clock timer;
 	};
 
 	std::vector<LoadStep> m_loaders;
-	size_t m_currentLoader = 0;
-	bool m_hasQueuedJobs = 0;
+	size_t m_numDone = 0;
+	LoadStep *m_runningStep = nullptr;
 
+	// The step starts once the steps named in after are done. Steps whose
+	// dependencies are met run side by side: those that may use any thread
+	// are started on the workers straight away, the main thread ones one
+	// per frame so the loading screen keeps drawing.
 	template <typename T>
-	void AddStep(const std::string &name, T fn)
+	void AddStep(const std::string &name, T fn, const std::vector<std::string> &after = {}, StepThread thread = StepThread::Main)
+	{
+		LoadStep step{ fn, name, {}, thread, nullptr, false, false, {} };
+		for (const std::string &dep : after) {
+			auto it = std::find_if(m_loaders.begin(), m_loaders.end(), [&dep](const LoadStep &s) { return s.name == dep; });
+			assert(it != m_loaders.end() && "load step dependencies must be added first");
+			if (it != m_loaders.end())
+				step.deps.push_back(it - m_loaders.begin());
+		}
+		m_loaders.push_back(std::move(step));
+	}
+
+	// names of all the steps added so far
+	std::vector<std::string> AllSteps() const
 	{
-		m_loaders.push_back(LoadStep{ fn, name });
+		std::vector<std::string> names;
+		for (const LoadStep &step : m_loaders)
+			names.push_back(step.name);
+		return names;
 	}
 
 	Profiler::Clock m_loadTimer;
-	Profiler::Clock m_stepTimer;
+
+	// dropping the handle cancels the job if startup outruns it
+	Job::Handle m_readAhead;
+	void StartReadAhead();
+	void SaveReadAheadList();
 
 	void Start() override;
 	void Update(float) override;
 	void End() override;
 
-	void RunNewLoader();
-	void FinishLoadStep();
-	float GetProgress() { return (m_currentLoader) / float(m_loaders.size()); }
+	bool IsReady(const LoadStep &step) const;
+	void StartLoadStep(LoadStep &step);
+	void FinishLoadStep(LoadStep &step);
+	float GetProgress() { return m_numDone / float(m_loaders.size()); }
 };
 
 // FIXME: this is a hack, this class should have its lifecycle managed elsewhere
@@ -189,6 +293,11 @@ public:
 		m_skipMenu = true;
 	}
 
+	void SetReplay(const std::string &path)
+	{
+		m_replayPath = path;
+	}
+
 protected:
 	std::unique_ptr<Intro> m_intro;
 
@@ -198,6 +307,7 @@ protected:
 
 	bool m_skipMenu;
 	SystemPath m_startPath;
+	std::string m_replayPath;
 };
 
 class GameLoop : public Application::Lifecycle {
@@ -209,6 +319,9 @@ protected:
 	void InitGame();
 	void EndGame();
 
+	void UpdateQualityGovernor();
+	static void SetDetailBias(int bias);
+
 	double time_player_died;
 
 	// Used to measure frame and physics performance timing info
@@ -227,9 +340,16 @@ protected:
 	uint32_t startup_ticks;
 
 	int MAX_PHYSICS_TICKS;
+	// wall-clock time the physics ticks of a frame may take, 0 for no limit
+	float physicsBudgetMs;
 	double accumulator;
 
 	Uint32 last_stats = SDL_GetTicks();
+
+	// adjusts terrain and model detail to the frame rate, if enabled
+	std::unique_ptr<QualityGovernor> qualityGovernor;
+	// CPU time of the frame so far, without waiting for vsync or the GPU
+	Profiler::Clock frameWorkTimer;
 };
 
 class TombstoneLoop : public Application::Lifecycle {
@@ -242,6 +362,69 @@ protected:
 	std::unique_ptr<Tombstone> tombstone;
 };
 
+class SimBenchmark : public Application::Lifecycle {
+public:
+	SimBenchmark(const SystemPath &startPath, const std::string &saveName, double hours, Game::TimeAccel timeAccel) :
+		m_startPath(startPath),
+		m_saveName(saveName),
+		m_duration(hours * 60.0 * 60.0),
+		m_timeAccel(timeAccel)
+	{}
+
+protected:
+	void Start() override;
+	void Update(float) override;
+	void End() override;
+
+	// wall-clock time to spend stepping the simulation each frame, so the
+	// application still gets to handle its events now and then
+	static constexpr double FRAME_BUDGET_MS = 100.0;
+
+	SystemPath m_startPath;
+	std::string m_saveName;
+	double m_duration;
+	Game::TimeAccel m_timeAccel;
+
+	double m_startTime = 0.0;
+	Profiler::Clock m_wallTimer;
+};
+
+class FlythroughBenchmark : public Application::Lifecycle {
+public:
+	FlythroughBenchmark(const std::string &pathFile) :
+		m_pathFile(pathFile)
+	{}
+
+protected:
+	void Start() override;
+	void Update(float) override;
+	void End() override;
+
+	const Body *FindBody(const std::string &name) const;
+	void WriteResults() const;
+
+	struct FrameRecord {
+		double frameMs; // the whole frame, including the swap
+		double cpuMs;	// updating and drawing the scene
+		double gpuMs;	// negative if the GPU time isn't known
+		uint32_t drawCalls;
+		uint32_t triangles;
+	};
+
+	std::string m_pathFile;
+	CameraPath m_path;
+	int m_numFrames = 0;
+	// negative while warming up
+	int m_frame = 0;
+
+	RefCountedPtr<CameraContext> m_cameraContext;
+	std::unique_ptr<Camera> m_camera;
+
+	Profiler::Clock m_cpuTimer;
+	double m_lastCpuMs = 0.0;
+	std::vector<FrameRecord> m_records;
+};
+
 /*
 ===============================================================================
 	INITIALIZATION
@@ -272,6 +455,22 @@ void Pi::App::SetStartPath(const SystemPath &startPath)
 	static_cast<MainMenu *>(m_mainMenu.Get())->SetStartPath(startPath);
 }
 
+void Pi::App::QueueSimBenchmark(const SystemPath &startPath, const std::string &saveName, double hours, int timeAccel)
+{
+	const Game::TimeAccel accel = Game::TimeAccel(Clamp(timeAccel, int(Game::TIMEACCEL_1X), int(Game::TIMEACCEL_10000X)));
+	QueueLifecycle(RefCountedPtr<Lifecycle>(new SimBenchmark(startPath, saveName, hours, accel)));
+}
+
+void Pi::App::QueueFlythroughBenchmark(const std::string &pathFile)
+{
+	QueueLifecycle(RefCountedPtr<Lifecycle>(new FlythroughBenchmark(pathFile)));
+}
+
+void Pi::App::QueueReplay(const std::string &path)
+{
+	static_cast<MainMenu *>(m_mainMenu.Get())->SetReplay(path);
+}
+
 void TestGPUJobsSupport()
 {
 	PROFILE_SCOPED()
@@ -279,6 +478,10 @@ void TestGPUJobsSupport()
 	if (!Pi::config->Int("EnableGPUJobs"))
 		return;
 
+	// there are no shaders to compile without a GPU
+	if (Pi::renderer->GetRendererType() == Graphics::RENDERER_DUMMY)
+		return;
+
 	Uint32 octaves = 8;
 	Graphics::MaterialDescriptor desc;
 	desc.quality = Graphics::MaterialQuality::HAS_OCTAVES | (octaves << 16);
@@ -353,6 +556,7 @@ void Pi::App::OnStartup()
 	Pi::detail.cities = config->Int("DetailCities");
 
 	Graphics::RendererOGL::RegisterRenderer();
+	Graphics::RendererDummy::RegisterRenderer();
 	Pi::renderer = StartupRenderer(Pi::config, false, config->Int("DebugWindowResize"));
 
 	Pi::rng.IncRefCount(); // so nothing tries to free it
@@ -390,6 +594,17 @@ void Pi::App::OnStartup()
 	Uint32 numThreads = config->Int("WorkerThreads");
 	numThreads = numThreads ? numThreads : std::max(OS::GetNumCores() - 1, 1U);
 	GetTaskGraph()->SetWorkerThreads(numThreads);
+	SingleBVHTreeBase::SetTaskGraph(GetTaskGraph());
+	GalaxyGenerator::SetTaskGraph(GetTaskGraph());
+	SceneGraph::Loader::SetTaskGraph(GetTaskGraph());
+
+	// model textures are decoded on the workers and swapped in once uploaded
+	if (config->Int("StreamTextures"))
+		Graphics::TextureBuilder::SetStreamingQueue(GetAsyncJobQueue());
+
+	// as are the faces of characters
+	PiGui::FaceCache::Init(Pi::renderer);
+	PiGui::FaceCache::Get()->SetJobQueue(GetAsyncJobQueue());
 
 	threadTimer.Stop();
 	Output("started %d worker threads in %.2fms\n", numThreads, threadTimer.milliseconds());
@@ -424,6 +639,13 @@ void Pi::App::OnShutdown()
 
 	perfInfoDisplay.reset();
 
+	// before the caches it measures go away
+	delete Pi::memoryBudget;
+	Pi::memoryBudget = nullptr;
+
+	Graphics::TextureBuilder::SetStreamingQueue(nullptr);
+	PiGui::FaceCache::Uninit();
+
 	// TODO: connect initializers and deinitializers in a single Module interface
 	// Will need to think about dependency injection for e.g. modules which need a
 	// reference to the renderer
@@ -436,6 +658,7 @@ void Pi::App::OnShutdown()
 	SfxManager::Uninit();
 	Sound::Uninit();
 	CityOnPlanet::Uninit();
+	Planet::Uninit();
 	BaseSphere::Uninit();
 	FaceParts::Uninit();
 	Graphics::Uninit();
@@ -447,6 +670,7 @@ void Pi::App::OnShutdown()
 	Lua::Uninit();
 
 	delete Pi::modelCache;
+	SceneGraph::ColorMap::ClearCache();
 
 	GalaxyGenerator::Uninit();
 
@@ -462,6 +686,10 @@ void Pi::App::OnShutdown()
 
 	delete Pi::config;
 	delete Pi::planner;
+
+	SingleBVHTreeBase::SetTaskGraph(nullptr);
+	GalaxyGenerator::SetTaskGraph(nullptr);
+	SceneGraph::Loader::SetTaskGraph(nullptr);
 }
 
 void Pi::Uninit()
@@ -486,16 +714,46 @@ JobSet *Pi::App::GetAsyncStartupQueue() const
 
 JobSet *Pi::App::GetCurrentLoadStepQueue() const
 {
-	return static_cast<StartupScreen *>(m_loader.Get())->currentStepQueue.get();
+	return static_cast<StartupScreen *>(m_loader.Get())->GetCurrentStepQueue();
+}
+
+// Caches over the memory budget are trimmed lowest priority first. Those
+// without a trim function are only measured: cached textures are still used
+// through raw pointers by materials, galaxy objects through their users'
+// slave caches, and patch heights and face parts are in use.
+static void RegisterMemoryBudget()
+{
+	Pi::memoryBudget = new MemoryBudget();
+	Pi::memoryBudget->SetBudget(size_t(std::max(Pi::config->Int("MemoryBudgetMB"), 0)) * 1024 * 1024);
+
+	// unpinned model templates are read again from their .sgm when next used
+	Pi::memoryBudget->AddCache("Models", 0,
+		[]() { return Pi::modelCache->GetMemoryUsage(); },
+		[](size_t bytes) { Pi::modelCache->Trim(bytes); });
+
+	// a full collection is a long stall, and frees only what's garbage anyway
+	Pi::memoryBudget->AddCache("Lua heap", 1,
+		[]() { return Lua::manager->GetMemoryUsage(); },
+		[](size_t) { Lua::manager->CollectGarbage(); });
+
+	Pi::memoryBudget->AddCache("Textures", 2, []() { return Pi::renderer->GetCachedTextureMemSize(); });
+	Pi::memoryBudget->AddCache("Galaxy", 2, []() { return Pi::game ? Pi::game->GetGalaxy()->GetMemoryUsage() : size_t(0); });
+	Pi::memoryBudget->AddCache("Terrain heights", 2, &GeoPatch::GetHeightDataSize);
+	Pi::memoryBudget->AddCache("Face parts", 2, &FaceParts::GetMemoryUsage);
+
+	// faces not on screen are composited again when next shown
+	Pi::memoryBudget->AddCache("Faces", 0,
+		[]() { return PiGui::FaceCache::Get()->GetMemoryUsage(); },
+		[](size_t bytes) { PiGui::FaceCache::Get()->Trim(bytes); });
 }
 
-// TODO: investigate constructing a DAG out of Init functions and dependencies
 void StartupScreen::Start()
 {
 	PROFILE_SCOPED()
 
 	asyncStartupQueue.reset(new JobSet(Pi::GetAsyncJobQueue()));
-	currentStepQueue.reset(new JobSet(Pi::GetAsyncJobQueue()));
+
+	StartReadAhead();
 
 	Output("StartupScreen::Start()\n");
 	m_loadTimer.Reset();
@@ -503,12 +761,13 @@ void StartupScreen::Start()
 
 	Output("ShipType::Init()\n");
 	// XXX early, Lua init needs it
-	ShipType::Init();
+	ShipType::Init(Pi::GetApp()->GetTaskGraph());
 
 	// XXX UI requires Lua  but Pi::ui must exist before we start loading
 	// templates. so now we have crap everywhere :/
 	Output("Lua::Init()\n");
 	Lua::Init(Pi::GetAsyncJobQueue());
+	Lua::manager->SetGCFrameBudget(Pi::config->Float("LuaGCFrameBudgetMS"));
 
 	// TODO: Get the lua state responsible for drawing the init progress up as fast as possible
 	// Investigate using a pigui-only Lua state that we can initialize without depending on
@@ -524,6 +783,12 @@ void StartupScreen::Start()
 	PiGui::RunHandler(0.01, "init");
 	Pi::pigui->EndFrame();
 
+	// queue the shader variants the last session used first, so the driver
+	// can compile them while everything else loads
+	AddStep("PreloadShaderVariants", []() {
+		Pi::renderer->PreloadShaderVariants();
+	});
+
 	AddStep("Sound::Init", []() {
 		if (Pi::GetApp()->HeadlessMode() || Pi::config->Int("DisableSound"))
 			return;
@@ -546,7 +811,7 @@ void StartupScreen::Start()
 			const std::string endpoint(Pi::config->String("ServerEndpoint"));
 			if (endpoint.size() > 0) {
 				Output("Server agent enabled, endpoint: %s\n", endpoint.c_str());
-				Pi::serverAgent = new HTTPServerAgent(endpoint);
+				Pi::serverAgent = new HTTPServerAgent(endpoint, Pi::config->Int("ServerCompressRequests") != 0);
 			}
 		}
 		if (!Pi::serverAgent) {
@@ -556,32 +821,46 @@ void StartupScreen::Start()
 	});
 #endif
 
+	// compile the modules on the workers, so InitModules only has to run them
+	AddStep("LuaChunkCache::Precompile()", []() {
+		LuaChunkCache::Precompile(Pi::GetApp()->GetCurrentLoadStepQueue(), { "libs", "pigui", "modules" });
+	});
+
 	// TODO: expose the AddStep interface so Lua::InitModules can granularize its registration
-	AddStep("Lua::InitModules()", &Lua::InitModules);
+	AddStep("Lua::InitModules()", &Lua::InitModules, { "Sound::Init", "LuaChunkCache::Precompile()" });
 
+	// the galaxy loads its factions and custom systems with Lua states of
+	// its own, so it can be built on a worker
 	AddStep("GalaxyGenerator::Init()", []() {
 		if (Pi::config->HasEntry("GalaxyGenerator"))
 			GalaxyGenerator::Init(Pi::config->String("GalaxyGenerator"),
 				Pi::config->Int("GalaxyGeneratorVersion", GalaxyGenerator::LAST_VERSION));
 		else
 			GalaxyGenerator::Init();
-	});
+	}, {}, StepThread::Any);
 
 	AddStep("FaceParts::Init()", &FaceParts::Init);
 
 	AddStep("new ModelCache", []() {
 		Pi::modelCache = new ModelCache(Pi::renderer);
+		Pi::modelCache->SetMemoryBudget(size_t(std::max(Pi::config->Int("ModelCacheMB"), 0)) * 1024 * 1024);
+		// compiled models are read and decompressed on the workers ahead of use
+		if (Pi::config->Int("PrefetchModels"))
+			Pi::modelCache->SetStreamingQueue(Pi::GetAsyncJobQueue());
 	});
 
+	AddStep("MemoryBudget", &RegisterMemoryBudget, { "new ModelCache", "FaceParts::Init()" });
+
 	AddStep("Shields::Init", []() {
 		Shields::Init(Pi::renderer);
 	});
 
 	AddStep("BaseSphere::Init", &BaseSphere::Init);
 
-	AddStep("CityOnPlanet::Init", &CityOnPlanet::Init);
+	AddStep("CityOnPlanet::Init", &CityOnPlanet::Init, { "new ModelCache" });
 
-	AddStep("SpaceStation::Init", &SpaceStation::Init);
+	// station types load their models
+	AddStep("SpaceStation::Init", &SpaceStation::Init, { "new ModelCache" });
 
 	AddStep("NavLights::Init", []() {
 		NavLights::Init(Pi::renderer);
@@ -598,23 +877,34 @@ void StartupScreen::Start()
 		Pi::planner = new TransferPlanner();
 
 		perfInfoDisplay.reset(new PiGui::PerfInfo());
-	});
+	}, AllSteps());
 }
 
 void StartupScreen::Update(float deltaTime)
 {
 	PROFILE_SCOPED()
 
-	// if we have queued jobs from the current loader step and they're all done, finish up
-	if (m_hasQueuedJobs && currentStepQueue->IsEmpty())
-		FinishLoadStep();
+	// a step is done once the jobs it queued (or its own, for steps run on a
+	// worker) have finished
+	for (LoadStep &step : m_loaders) {
+		if (step.started && !step.done && step.jobs->IsEmpty())
+			FinishLoadStep(step);
+	}
 
-	if (!m_hasQueuedJobs) {
-		if (m_currentLoader < m_loaders.size())
-			RunNewLoader();
-		// finish loading once all steps are complete and there's nothing left in the queue.
-		else if (asyncStartupQueue->IsEmpty())
-			return RequestEndLifecycle();
+	// finish loading once all steps are complete and there's nothing left in the queue.
+	if (m_numDone == m_loaders.size() && asyncStartupQueue->IsEmpty())
+		return RequestEndLifecycle();
+
+	bool ranMainStep = false;
+	for (LoadStep &step : m_loaders) {
+		if (step.started || !IsReady(step))
+			continue;
+		if (step.thread == StepThread::Main) {
+			if (ranMainStep)
+				continue;
+			ranMainStep = true;
+		}
+		StartLoadStep(step);
 	}
 
 	Pi::pigui->NewFrame();
@@ -623,32 +913,88 @@ void StartupScreen::Update(float deltaTime)
 	Pi::pigui->Render();
 }
 
-void StartupScreen::RunNewLoader()
+bool StartupScreen::IsReady(const LoadStep &step) const
+{
+	for (size_t dep : step.deps) {
+		if (!m_loaders[dep].done)
+			return false;
+	}
+	return true;
+}
+
+void StartupScreen::StartLoadStep(LoadStep &step)
 {
-	// don't increment the current loader count and run the loader if async jobs haven't finished yet
-	LoadStep &loader = m_loaders[m_currentLoader];
-	Output("Loading [%02.f%%]: %s started\n", GetProgress() * 100., loader.name.c_str());
+	Output("Loading [%02.f%%]: %s started\n", GetProgress() * 100., step.name.c_str());
+
+	step.started = true;
+	step.jobs.reset(new JobSet(Pi::GetAsyncJobQueue()));
+	step.timer.SoftReset();
+
+	if (step.thread == StepThread::Any) {
+		step.jobs->Order(new LoadStepJob(step.fn));
+		return;
+	}
 
-	m_stepTimer.SoftReset();
-	loader.fn();
+	m_runningStep = &step;
+	step.fn();
+	m_runningStep = nullptr;
 
-	// if we haven't queued any jobs, just finish this step and skip to the next one
-	m_hasQueuedJobs = !currentStepQueue->IsEmpty();
-	if (currentStepQueue->IsEmpty())
-		FinishLoadStep();
+	// if we haven't queued any jobs, the step is already done
+	if (step.jobs->IsEmpty())
+		FinishLoadStep(step);
 }
 
-void StartupScreen::FinishLoadStep()
+void StartupScreen::FinishLoadStep(LoadStep &step)
 {
-	m_hasQueuedJobs = false;
-	m_stepTimer.Stop();
+	step.done = true;
+	step.timer.Stop();
+	m_numDone++;
 	Output("Loading [%02.f%%]: %s took %.2fms\n", GetProgress() * 100.,
-		m_loaders[m_currentLoader].name.c_str(), m_stepTimer.milliseconds());
-	m_currentLoader++;
+		step.name.c_str(), step.timer.milliseconds());
+}
+
+void StartupScreen::StartReadAhead()
+{
+	std::vector<std::string> paths;
+	RefCountedPtr<FileSystem::FileData> list = FileSystem::userFiles.ReadFile(s_readAheadListName);
+	if (list) {
+		std::string_view lines = list->AsStringView();
+		while (!lines.empty()) {
+			const size_t end = std::min(lines.find('\n'), lines.size());
+			if (end > 0)
+				paths.emplace_back(lines.substr(0, end));
+			lines.remove_prefix(std::min(end + 1, lines.size()));
+		}
+	}
+
+	if (!paths.empty()) {
+		Output("StartupScreen: prefetching %zu files\n", paths.size());
+		m_readAhead = Pi::GetAsyncJobQueue()->Queue(new ReadAheadJob(std::move(paths)));
+	}
+
+	FileSystem::StartRecordingReads();
+}
+
+void StartupScreen::SaveReadAheadList()
+{
+	const std::vector<std::string> paths = FileSystem::StopRecordingReads();
+
+	FILE *f = FileSystem::userFiles.OpenWriteStream(s_readAheadListName, FileSystem::FileSourceFS::WRITE_TEXT);
+	if (!f)
+		return;
+	for (const std::string &path : paths) {
+		fputs(path.c_str(), f);
+		fputc('\n', f);
+	}
+	fclose(f);
 }
 
 void StartupScreen::End()
 {
+	SaveReadAheadList();
+	m_readAhead = Job::Handle();
+	LuaChunkCache::Clear();
+
 	OS::NotifyLoadEnd();
 	Pi::GetApp()->RequestProfileFrame();
 
@@ -666,7 +1012,12 @@ void MainMenu::Start()
 {
 	// TODO: just calculate this at draw time inside Intro
 	Pi::intro = new Intro(Pi::renderer, Pi::renderer->GetWindowWidth(), Pi::renderer->GetWindowHeight());
-	if (m_skipMenu) {
+	if (!m_replayPath.empty()) {
+		// the main menu is shown if the replay can't be loaded
+		if (Game *game = Replay::StartPlayback(m_replayPath))
+			Pi::StartGame(game);
+		m_replayPath.clear();
+	} else if (m_skipMenu) {
 		Output("Loading new game immediately!\n");
 		Pi::StartGame(new Game(m_startPath, 0.0));
 		m_skipMenu = false; // Show the main menu once we're done here.
@@ -739,6 +1090,25 @@ void Pi::StartGame(Game *game)
 ===============================================================================
 */
 
+static void OnQuicksaveFinished(std::string_view name, SaveGameManager::SaveResult result)
+{
+	if (!Pi::game)
+		return;
+
+	const std::string path = FileSystem::JoinPath(SaveGameManager::GetSaveGameDirectory(), std::string(name));
+	switch (result) {
+	case SaveGameManager::SAVE_OK:
+		Pi::game->log->Add(Lang::GAME_SAVED_TO + path);
+		break;
+	case SaveGameManager::SAVE_COULD_NOT_OPEN:
+		Pi::game->log->Add(stringf(Lang::COULD_NOT_OPEN_FILENAME, formatarg("path", path)));
+		break;
+	case SaveGameManager::SAVE_COULD_NOT_WRITE:
+		Pi::game->log->Add(Lang::GAME_SAVE_CANNOT_WRITE);
+		break;
+	}
+}
+
 void Pi::HandleKeyDown(SDL_Keysym *key)
 {
 	const bool CTRL = input->KeyState(SDLK_LCTRL) || input->KeyState(SDLK_RCTRL);
@@ -771,6 +1141,25 @@ void Pi::HandleKeyDown(SDL_Keysym *key)
 		Pi::showDebugInfo = !Pi::showDebugInfo;
 		break;
 
+	case SDLK_r: // Start or stop recording a replay
+		if (Replay::IsRecording()) {
+			if (Replay::StopRecording().empty())
+				Log::Warning("Unable to write replay\n");
+		} else if (Pi::game) {
+			Replay::RequestRecording();
+		}
+		break;
+
+	case SDLK_t: // Export the recent perf timeline
+	{
+		const std::string path = PiGui::PerfInfo::ExportTimeline();
+		if (!path.empty())
+			Log::Info("Timeline trace written to {}\n", path);
+		else
+			Log::Warning("Unable to write timeline trace\n");
+		break;
+	}
+
 #if WITH_DEVKEYS
 #ifdef PIONEER_PROFILER
 	case SDLK_p: // alert it that we want to profile
@@ -806,15 +1195,12 @@ void Pi::HandleKeyDown(SDL_Keysym *key)
 			Pi::game->log->Add(Lang::CANT_SAVE_IN_HYPERSPACE);
 
 		else {
+			// written in the background, and logged once it's done
 			const std::string name = "_quicksave";
-			const std::string path = FileSystem::JoinPath(SaveGameManager::GetSaveGameDirectory(), name);
 			try {
-				SaveGameManager::SaveGame(name, Pi::game);
-				Pi::game->log->Add(Lang::GAME_SAVED_TO + path);
-			} catch (CouldNotOpenFileException) {
-				Pi::game->log->Add(stringf(Lang::COULD_NOT_OPEN_FILENAME, formatarg("path", path)));
-			} catch (CouldNotWriteToFileException) {
-				Pi::game->log->Add(Lang::GAME_SAVE_CANNOT_WRITE);
+				Lua::manager->ScheduleJob(SaveGameManager::SaveGameAsync(name, Pi::game, OnQuicksaveFinished));
+			} catch (CannotSaveDeadPlayer) {
+				Pi::game->log->Add(Lang::CANT_SAVE_DEAD_PLAYER);
 			}
 		}
 		break;
@@ -858,10 +1244,18 @@ void Pi::App::HandleRequests()
 ===============================================================================
 */
 
+// time each frame may spend creating queued ships
+static const double SHIP_SPAWN_FRAME_BUDGET_MS = 2.0;
+// seconds between polls of the caches' memory usage
+static const double MEMORY_BUDGET_INTERVAL = 1.0;
+static double s_memoryBudgetTime = 0.0;
+
 void Pi::App::PreUpdate()
 {
 	PROFILE_SCOPED()
 	Pi::frameTime = DeltaTime();
+
+	Sound::Update();
 }
 
 void Pi::App::PostUpdate()
@@ -869,6 +1263,26 @@ void Pi::App::PostUpdate()
 	PROFILE_SCOPED()
 
 	HandleRequests();
+
+	if (Pi::game) {
+		PERF_ZONE("Ship spawns")
+		Pi::game->GetSpace()->GetSpawnQueue().Update(SHIP_SPAWN_FRAME_BUDGET_MS);
+	}
+
+	// whatever is left of the frame is the collector's
+	if (Lua::manager) {
+		PERF_ZONE("Lua GC")
+		Lua::manager->StepGarbageCollector();
+	}
+
+	s_memoryBudgetTime += DeltaTime();
+	if (Pi::memoryBudget && s_memoryBudgetTime >= MEMORY_BUDGET_INTERVAL) {
+		PERF_ZONE("Memory budget")
+		s_memoryBudgetTime = 0.0;
+		const size_t freed = Pi::memoryBudget->Update();
+		if (freed)
+			Log::Verbose("Memory budget: trimmed {} KB, {} KB in use\n", freed / 1024, Pi::memoryBudget->GetTotalUsage() / 1024);
+	}
 }
 
 // FIXME: delete/move this function out of Pi.cpp
@@ -916,6 +1330,18 @@ void GameLoop::Start()
 	MAX_PHYSICS_TICKS = Pi::config->Int("MaxPhysicsCyclesPerRender");
 	if (MAX_PHYSICS_TICKS <= 0)
 		MAX_PHYSICS_TICKS = 4;
+	physicsBudgetMs = Clamp(Pi::config->Int("PhysicsFrameBudgetMS"), 0, 1000);
+
+	if (Pi::config->Int("QualityGovernor")) {
+		QualityGovernor::Settings settings;
+		settings.targetFrameTime = 1000.0 / std::max(Pi::config->Int("QualityGovernorTargetFPS"), 1);
+		settings.maxJobLatency = std::max(Pi::config->Int("QualityGovernorMaxJobLatencyMS"), 0);
+		qualityGovernor.reset(new QualityGovernor(settings));
+
+		// with vsync the frame time says nothing about how much spare time
+		// there is, so the governor goes by the CPU and GPU work instead
+		Pi::renderer->SetGPUTimingEnabled(true);
+	}
 
 	Pi::SetGameTickAlpha(0);
 	// If we have a tombstone loop, we will SetNextLifecycle() so it runs before
@@ -925,15 +1351,23 @@ void GameLoop::Start()
 	profile_startup_ms = Clamp(Pi::config->Int("ProfileStartupMs", 0), 0, 10000);
 	startup_ticks = SDL_GetTicks();
 	SetProfilerAccumulate(profile_startup_ms > 0);
+
+	if (Pi::config->Int("RecordReplay") && !Replay::IsPlaying())
+		Replay::RequestRecording();
 }
 
 void GameLoop::Update(float deltaTime)
 {
 	PROFILE_SCOPED()
 	perfTimer.SoftReset();			   // Reset() + Start()
+	frameWorkTimer.SoftReset();
 	frame_time_real = deltaTime * 1e3; // convert to ms
 	frame_stat++;
 
+	// a replay being played back has the time step of the recorded frame
+	if (!Replay::BeginFrame(deltaTime))
+		Pi::RequestQuit();
+
 	// Read events into internal structures and into imgui structures,
 	// dispatch will be performed after the imgui frame, so that imgui can add
 	// something based on clicks on widgets
@@ -952,17 +1386,37 @@ void GameLoop::Update(float deltaTime)
 	const float step = Pi::game->GetTimeStep();
 	if (step > 0.0f) {
 		PROFILE_SCOPED_RAW("Physics Update [unpaused]")
+		PERF_ZONE("Physics")
 		int phys_ticks = 0;
-		while (accumulator >= step) {
-			if (++phys_ticks >= MAX_PHYSICS_TICKS) {
-				accumulator = 0.0;
-				break;
+		int replayTicks;
+		if (Replay::GetPhysics(replayTicks, accumulator)) {
+			// the ticks the recorded frame ran, however long they take now
+			for (; phys_ticks < replayTicks; phys_ticks++) {
+				Pi::game->TimeStep(step);
+				BaseSphere::UpdateAllBaseSphereDerivatives();
 			}
-
-			Pi::game->TimeStep(step);
-			BaseSphere::UpdateAllBaseSphereDerivatives();
-
-			accumulator -= step;
+		} else {
+			// the budget only covers the ticks, not the event handling before them
+			Profiler::Clock budgetTimer;
+			budgetTimer.SoftReset();
+			while (accumulator >= step) {
+				// past the tick limit or the time budget, ticks still owed are kept
+				// for the next frames to catch up on, up to a frame's worth; time
+				// beyond that is dropped so heavy physics doesn't stall rendering
+				const bool overBudget = physicsBudgetMs > 0.f && phys_ticks > 0 &&
+					budgetTimer.currentmilliseconds() >= physicsBudgetMs;
+				if (phys_ticks + 1 >= MAX_PHYSICS_TICKS || overBudget) {
+					accumulator = std::min(accumulator, double(step) * (MAX_PHYSICS_TICKS - 1));
+					break;
+				}
+
+				Pi::game->TimeStep(step);
+				BaseSphere::UpdateAllBaseSphereDerivatives();
+				phys_ticks++;
+
+				accumulator -= step;
+			}
+			Replay::RecordPhysics(phys_ticks, accumulator);
 		}
 
 		// rendering interpolation between frames: don't use when docked
@@ -971,12 +1425,14 @@ void GameLoop::Update(float deltaTime)
 		if (pstate == Ship::DOCKED || pstate == Ship::DOCKING || pstate == Ship::UNDOCKING)
 			Pi::SetGameTickAlpha(1.0);
 		else
-			Pi::SetGameTickAlpha(accumulator / step);
+			Pi::SetGameTickAlpha(std::min(accumulator / step, 1.0));
 
 		phys_stat += phys_ticks;
+		Perf::Timeline::RecordCounter("Physics Ticks", phys_ticks);
 	} else {
 		// paused
 		PROFILE_SCOPED_RAW("Physics Update [paused]")
+		PERF_ZONE("Physics")
 		BaseSphere::UpdateAllBaseSphereDerivatives();
 	}
 
@@ -1005,18 +1461,29 @@ void GameLoop::Update(float deltaTime)
 
 	/* Calculate position for this rendered frame (interpolated between two physics ticks */
 	// XXX should this be here? what is this anyway?
-	for (Body *b : Pi::game->GetSpace()->GetBodies()) {
-		b->UpdateInterpTransform(Pi::GetGameTickAlpha());
-	}
+	Pi::game->GetSpace()->UpdateInterpTransforms(Pi::GetGameTickAlpha());
 	Frame::GetFrame(Pi::game->GetSpace()->GetRootFrame())->UpdateInterpTransform(Pi::GetGameTickAlpha());
 
-	Pi::GetView()->Update();
-	Pi::GetView()->Draw3D();
+	Perf::Timeline::Zone renderZone("Render");
+	View *view = Pi::GetView();
+	view->Update();
+
+	// a hidden or unchanging scene lets the loop idle between frames, and an
+	// unchanging one is redrawn from a cached copy
+	Pi::GetApp()->SetSceneStatic(!view->HasScene() || view->IsSceneStatic());
+	if (Pi::GetApp()->BeginSceneCache(view->HasScene() && view->IsSceneStatic())) {
+		if (view->HasScene())
+			Pi::GetApp()->DrawScene([view]() { view->Draw3D(); });
+		else
+			view->Draw3D();
+		Pi::GetApp()->EndSceneCache();
+	}
 
 	// Kick rendering in the background to avoid write->delete->read issues with UI command processing
 	// This may cause future issues if graphic resources are deleted while in-flight, but OpenGL is
 	// capable of handling that eventuality and it prevents application-scope crashes
 	Pi::renderer->FlushCommandBuffers();
+	renderZone.End();
 
 #ifdef REMOTE_LUA_REPL
 	Pi::luaConsole->HandleTCPDebugConnections();
@@ -1032,6 +1499,7 @@ void GameLoop::Update(float deltaTime)
 	// Move HandleEvents to either the end of the loop or the very start of the loop
 	// The goal is to be able to call imgui functions for debugging inside C++ code
 	perfTimer.SoftReset();
+	Perf::Timeline::Zone piguiZone("PiGui");
 	Pi::pigui->NewFrame();
 
 	if (Pi::game && !Pi::player->IsDead()) {
@@ -1057,10 +1525,12 @@ void GameLoop::Update(float deltaTime)
 	// Reset the depth buffer so our UI can get drawn right overtop
 	Pi::renderer->ClearDepthBuffer();
 	Pi::pigui->Render();
+	piguiZone.End();
 
 	perfTimer.SoftStop();
 	pigui_time = perfTimer.milliseconds();
 
+	Replay::UpdateTimeAccel(Pi::game);
 	if (Pi::game->UpdateTimeAccel())
 		accumulator = 0; // fix for huge pauses 10000x -> 1x
 
@@ -1076,6 +1546,9 @@ void GameLoop::Update(float deltaTime)
 	perfInfoDisplay->UpdateCounter(PiGui::PerfInfo::COUNTER_PHYS, phys_time);
 	perfInfoDisplay->UpdateCounter(PiGui::PerfInfo::COUNTER_PIGUI, pigui_time);
 
+	if (qualityGovernor)
+		UpdateQualityGovernor();
+
 	// XXX: profile game startup
 	if (GetProfilerAccumulate() && (SDL_GetTicks() - startup_ticks) >= profile_startup_ms) {
 		SetProfilerAccumulate(false);
@@ -1108,8 +1581,38 @@ void GameLoop::Update(float deltaTime)
 #endif
 }
 
+void GameLoop::SetDetailBias(int bias)
+{
+	GeoSphere::SetDetailBias(bias);
+	GasGiant::SetDetailBias(bias);
+	SceneGraph::LOD::SetDetailBias(bias);
+}
+
+void GameLoop::UpdateQualityGovernor()
+{
+	// the GPU time is a few frames old, but it changes slowly enough
+	const double cpuTime = frameWorkTimer.currentmilliseconds();
+	const double workTime = std::max(cpuTime, Pi::renderer->GetGPUFrameTime());
+
+	const GeoSphere::FrameBudget &geoBudget = GeoSphere::GetFrameBudget();
+	const double jobLatency = geoBudget.resultsProcessed ? geoBudget.maxSplitLatencyMs : -1.0;
+
+	const int oldLevel = qualityGovernor->GetLevel();
+	qualityGovernor->Update(workTime, jobLatency);
+
+	const int level = qualityGovernor->GetLevel();
+	if (level != oldLevel) {
+		Log::Info("Quality governor: detail bias {} (frame work {:.1f} ms, terrain job latency {:.0f} ms)\n",
+			level, qualityGovernor->GetSmoothedFrameTime(), qualityGovernor->GetSmoothedJobLatency());
+		SetDetailBias(level);
+	}
+}
+
 void GameLoop::End()
 {
+	// written or reported before the game goes
+	Replay::EndGame();
+
 	// Process any pending UI events
 	PiGui::EmitEvents();
 
@@ -1119,6 +1622,17 @@ void GameLoop::End()
 	// Clean up any left-over mouse state
 	Pi::input->SetCapturingMouse(false);
 
+	// back to full rate for the menus' animated backgrounds
+	Pi::GetApp()->SetSceneStatic(false);
+
+	if (qualityGovernor) {
+		qualityGovernor.reset();
+		SetDetailBias(0);
+		if (!Pi::GetApp()->GetDynamicResolution())
+			Pi::renderer->SetGPUTimingEnabled(false);
+	}
+	Pi::GetApp()->ClearSceneCache();
+
 #ifdef REMOTE_LUA_REPL
 	Pi::luaConsole->CloseTCPDebugConnection();
 #endif
@@ -1174,6 +1688,327 @@ void TombstoneLoop::Update(float deltaTime)
 	}
 }
 
+/*
+===============================================================================
+	SIMULATION BENCHMARK
+===============================================================================
+*/
+
+void SimBenchmark::Start()
+{
+	OS::DisableFPE();
+
+	if (!m_saveName.empty()) {
+		Output("Benchmarking savegame '%s'\n", m_saveName.c_str());
+		Pi::game = SaveGameManager::LoadGame(m_saveName);
+	} else {
+		Output("Benchmarking new game at %s\n", to_string(m_startPath).c_str());
+		Pi::game = new Game(m_startPath, 0.0);
+	}
+
+	LuaEvent::Clear();
+	LuaEvent::Queue("onGameStart");
+	LuaEvent::Emit();
+
+	Pi::game->SetTimeAccel(m_timeAccel);
+	m_startTime = Pi::game->GetTime();
+	Pi::game->GetSpace()->ResetStepTimes();
+
+	m_wallTimer.Start();
+}
+
+void SimBenchmark::Update(float deltaTime)
+{
+	PROFILE_SCOPED()
+	Pi::GetApp()->HandleEvents();
+
+	Profiler::Clock frameTimer;
+	frameTimer.Start();
+
+	while (frameTimer.currentmilliseconds() < FRAME_BUDGET_MS) {
+		if (Pi::game->GetTime() - m_startTime >= m_duration || Pi::player->IsDead()) {
+			RequestEndLifecycle();
+			break;
+		}
+
+		// the game drops the time acceleration near other bodies, as it
+		// would for the player, so the benchmark runs at whatever rate it
+		// allows and only the game time covered is fixed
+		const float step = Pi::game->GetTimeStep();
+		if (step <= 0.0f)
+			Pi::game->SetTimeAccel(m_timeAccel);
+
+		Pi::game->TimeStep(Pi::game->GetTimeStep());
+		BaseSphere::UpdateAllBaseSphereDerivatives();
+	}
+}
+
+void SimBenchmark::End()
+{
+	m_wallTimer.Stop();
+
+	const Space::StepTimes &times = Pi::game->GetSpace()->GetStepTimes();
+	const double wallMs = m_wallTimer.milliseconds();
+	const double stepMs = times.collision + times.ai + times.physics + times.lua + times.bookkeeping;
+	const auto percent = [stepMs](double ms) { return stepMs > 0.0 ? 100.0 * ms / stepMs : 0.0; };
+
+	Output("\nSimulation benchmark\n");
+	Output("  game time:   %.1f hours%s\n", (Pi::game->GetTime() - m_startTime) / (60.0 * 60.0),
+		Pi::player->IsDead() ? " (player died)" : "");
+	Output("  wall time:   %.2f s\n", wallMs * 1e-3);
+	Output("  steps:       %" PRIu64 " (%.1f per second)\n", times.steps, wallMs > 0.0 ? times.steps * 1e3 / wallMs : 0.0);
+	Output("  collision:   %10.2f ms %5.1f%%\n", times.collision, percent(times.collision));
+	Output("  ai:          %10.2f ms %5.1f%%\n", times.ai, percent(times.ai));
+	Output("  physics:     %10.2f ms %5.1f%%\n", times.physics, percent(times.physics));
+	Output("  lua:         %10.2f ms %5.1f%%\n", times.lua, percent(times.lua));
+	Output("  bookkeeping: %10.2f ms %5.1f%%\n", times.bookkeeping, percent(times.bookkeeping));
+
+	LuaEvent::Queue("onGameEnd");
+	LuaEvent::Emit();
+
+	Pi::luaTimer->RemoveAll();
+	Lua::manager->CollectGarbage();
+
+	delete Pi::game;
+	Pi::game = nullptr;
+	Pi::player = nullptr;
+}
+
+/*
+===============================================================================
+	FLYTHROUGH BENCHMARK
+===============================================================================
+*/
+
+void FlythroughBenchmark::Start()
+{
+	// shipped paths live in the game data, anything else in the user's files
+	Json pathObj = JsonUtils::LoadJsonDataFile(m_pathFile, false);
+	if (pathObj.is_null())
+		pathObj = JsonUtils::LoadJsonFile(m_pathFile, FileSystem::userFiles);
+
+	std::string error = "file not found";
+	if (pathObj.is_null() || !m_path.Load(pathObj, error)) {
+		Log::Warning("Could not load camera path '{}': {}\n", m_pathFile, error);
+		RequestEndLifecycle();
+		return;
+	}
+
+	SystemPath startPath(0, 0, 0, 0, 18);
+	if (!m_path.GetStartPath().empty()) {
+		try {
+			startPath = SystemPath::Parse(m_path.GetStartPath().c_str());
+		} catch (const SystemPath::ParseFailure &) {
+			Log::Warning("Could not parse camera path start '{}'\n", m_path.GetStartPath());
+			RequestEndLifecycle();
+			return;
+		}
+	}
+
+	OS::DisableFPE();
+
+	Output("Flythrough benchmark '%s' at %s\n", m_pathFile.c_str(), to_string(startPath).c_str());
+	Pi::game = new Game(startPath, 0.0);
+
+	LuaEvent::Clear();
+	LuaEvent::Queue("onGameStart");
+	LuaEvent::Emit();
+
+	float znear, zfar;
+	Pi::renderer->GetNearFarRange(znear, zfar);
+	m_cameraContext.Reset(new CameraContext(Pi::renderer->GetWindowWidth(), Pi::renderer->GetWindowHeight(),
+		Pi::config->Float("FOVVertical"), znear, zfar));
+	m_camera.reset(new Camera(m_cameraContext, Pi::renderer));
+
+	// run as fast as the frames can be drawn
+	Pi::renderer->SetVSyncEnabled(false);
+	Pi::renderer->SetGPUTimingEnabled(true);
+	Pi::GetApp()->SetSceneStatic(false);
+
+	m_numFrames = int(std::ceil(m_path.GetDuration() / m_path.GetTimeStep())) + 1;
+	m_frame = -m_path.GetWarmupFrames();
+	m_records.reserve(m_numFrames);
+}
+
+const Body *FlythroughBenchmark::FindBody(const std::string &name) const
+{
+	for (const Body *body : Pi::game->GetSpace()->GetBodies()) {
+		if (body->GetLabel() == name)
+			return body;
+	}
+	return nullptr;
+}
+
+void FlythroughBenchmark::Update(float deltaTime)
+{
+	PROFILE_SCOPED()
+	if (!Pi::game)
+		return;
+
+	// events are read but never dispatched, so nothing but the path moves
+	// the camera and the run can be repeated exactly
+	Pi::GetApp()->PollEvents();
+
+	// the previous frame has been swapped by now, so its stats are complete
+	if (m_frame > 0) {
+		const Graphics::Stats::TFrameData &stats = Pi::renderer->GetStats().FrameStatsPrevious();
+		m_records.push_back({ deltaTime * 1e3, m_lastCpuMs, Pi::renderer->GetGPUFrameTime(),
+			stats.m_stats[Graphics::Stats::STAT_DRAWCALL], stats.m_stats[Graphics::Stats::STAT_NUM_TRIS] });
+	}
+
+	if (m_frame >= m_numFrames) {
+		RequestEndLifecycle();
+		return;
+	}
+
+	m_cpuTimer.SoftReset();
+
+	// game time stands still during the warmup, while terrain around the
+	// first key streams in, then advances by exactly one step per frame
+	if (m_frame >= 0)
+		Pi::game->TimeStep(m_path.GetTimeStep());
+	BaseSphere::UpdateAllBaseSphereDerivatives();
+
+	Pi::SetGameTickAlpha(1.0);
+	Pi::game->GetSpace()->UpdateInterpTransforms(1.0);
+	Frame::GetFrame(Pi::game->GetSpace()->GetRootFrame())->UpdateInterpTransform(1.0);
+
+	const CameraPath::Sample sample = m_path.Evaluate(std::max(m_frame, 0) * m_path.GetTimeStep());
+	const Body *body = FindBody(*sample.body);
+	if (!body) {
+		Log::Warning("Camera path body '{}' is not in this system\n", *sample.body);
+		m_records.clear();
+		RequestEndLifecycle();
+		return;
+	}
+
+	// planets and stars have frames of their own, and the camera goes in the
+	// rotating one so paths can follow the surface; anything else is
+	// followed in its own space
+	const Frame *frame = Frame::GetFrame(body->GetFrame());
+	if (frame->GetBody() == body) {
+		m_cameraContext->SetCameraFrame(frame->GetRotFrame());
+		m_cameraContext->SetCameraPosition(sample.position);
+		m_cameraContext->SetCameraOrient(sample.orient);
+	} else {
+		m_cameraContext->SetCameraFrame(body->GetFrame());
+		m_cameraContext->SetCameraPosition(body->GetInterpPosition() + body->GetInterpOrient() * sample.position);
+		m_cameraContext->SetCameraOrient(body->GetInterpOrient() * sample.orient);
+	}
+
+	m_cameraContext->BeginFrame();
+	m_camera->Update();
+
+	Pi::renderer->SetTransform(matrix4x4f::Identity());
+	m_cameraContext->ApplyDrawTransforms(Pi::renderer);
+	m_camera->Draw();
+	m_cameraContext->EndFrame();
+
+	Pi::renderer->FlushCommandBuffers();
+
+	m_cpuTimer.SoftStop();
+	m_lastCpuMs = m_cpuTimer.milliseconds();
+	m_frame++;
+}
+
+static Json summary_to_json(const Perf::Summary &summary)
+{
+	Json obj = Json::object();
+	obj["count"] = summary.count;
+	obj["mean"] = summary.mean;
+	obj["min"] = summary.min;
+	obj["p50"] = summary.p50;
+	obj["p95"] = summary.p95;
+	obj["p99"] = summary.p99;
+	obj["max"] = summary.max;
+	return obj;
+}
+
+void FlythroughBenchmark::WriteResults() const
+{
+	std::vector<double> frameMs, cpuMs, gpuMs, drawCalls, triangles;
+	for (const FrameRecord &record : m_records) {
+		frameMs.push_back(record.frameMs);
+		cpuMs.push_back(record.cpuMs);
+		if (record.gpuMs >= 0.0)
+			gpuMs.push_back(record.gpuMs);
+		drawCalls.push_back(record.drawCalls);
+		triangles.push_back(record.triangles);
+	}
+
+	const std::pair<const char *, const std::vector<double> *> series[] = {
+		{ "frame_ms", &frameMs },
+		{ "cpu_ms", &cpuMs },
+		{ "gpu_ms", &gpuMs },
+		{ "draw_calls", &drawCalls },
+		{ "triangles", &triangles },
+	};
+
+	Json results = Json::object();
+	results["path"] = m_pathFile;
+	results["renderer"] = Pi::renderer->GetName();
+	results["width"] = Pi::renderer->GetWindowWidth();
+	results["height"] = Pi::renderer->GetWindowHeight();
+	results["frames"] = m_records.size();
+
+	Output("\nFlythrough benchmark, %zu frames\n", m_records.size());
+	Output("  %-11s %10s %10s %10s %10s %10s\n", "", "mean", "p50", "p95", "p99", "max");
+
+	Json summaries = Json::object();
+	Json perFrame = Json::object();
+	for (const auto &[name, values] : series) {
+		const Perf::Summary summary = Perf::Summarise(*values);
+		summaries[name] = summary_to_json(summary);
+		perFrame[name] = *values;
+		Output("  %-11s %10.2f %10.2f %10.2f %10.2f %10.2f\n", name, summary.mean, summary.p50, summary.p95, summary.p99, summary.max);
+	}
+	results["summary"] = summaries;
+	results["per_frame"] = perFrame;
+
+	FileSystem::userFiles.MakeDirectory("benchmark");
+
+	char name[32];
+	const time_t t = time(nullptr);
+	strftime(name, sizeof(name), "flythrough-%Y%m%d-%H%M%S", localtime(&t));
+	const std::string path = FileSystem::JoinPath("benchmark", std::string(name) + ".json");
+
+	FILE *f = FileSystem::userFiles.OpenWriteStream(path, FileSystem::FileSourceFS::WRITE_TEXT);
+	if (!f) {
+		Log::Warning("Could not write benchmark results to {}\n", path);
+		return;
+	}
+	const std::string text = results.dump(1, '\t');
+	fwrite(text.data(), 1, text.size(), f);
+	fclose(f);
+
+	Output("Results written to %s\n", FileSystem::JoinPath(FileSystem::GetUserDir(), path).c_str());
+}
+
+void FlythroughBenchmark::End()
+{
+	if (!Pi::game)
+		return;
+
+	if (!m_records.empty())
+		WriteResults();
+
+	Pi::renderer->SetGPUTimingEnabled(false);
+	Pi::renderer->SetVSyncEnabled(Pi::config->Int("VSync") != 0);
+
+	m_camera.reset();
+	m_cameraContext.Reset();
+
+	LuaEvent::Queue("onGameEnd");
+	LuaEvent::Emit();
+
+	Pi::luaTimer->RemoveAll();
+	Lua::manager->CollectGarbage();
+
+	delete Pi::game;
+	Pi::game = nullptr;
+	Pi::player = nullptr;
+}
+
 /*
 ===============================================================================
 	MISCELLANEOUS GARBAGE THAT OUGHT NOT TO BE IN THIS CLASS
@@ -1199,6 +2034,25 @@ SceneGraph::Model *Pi::FindModel(const std::string &name, bool allowPlaceholder)
 	return m;
 }
 
+SceneGraph::Model *Pi::MakeModelInstance(const std::string &name, bool allowPlaceholder)
+{
+	SceneGraph::Model *m = 0;
+	try {
+		m = Pi::modelCache->MakeInstance(name);
+	} catch (const ModelCache::ModelNotFoundException &) {
+		Output("Could not find model: %s\n", name.c_str());
+		if (allowPlaceholder) {
+			try {
+				m = Pi::modelCache->MakeInstance("error");
+			} catch (const ModelCache::ModelNotFoundException &) {
+				Error("Could not find placeholder model");
+			}
+		}
+	}
+
+	return m;
+}
+
 // request that the game is ended as soon as safely possible
 void Pi::RequestEndGame()
 {
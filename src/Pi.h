@@ -28,6 +28,7 @@ class JobSet;
 class LuaConsole;
 class LuaNameGen;
 class LuaTimer;
+class MemoryBudget;
 class ModelCache;
 class ObjectViewerView;
 class Player;
@@ -73,6 +74,23 @@ public:
 
 		void SetStartPath(const SystemPath &startPath);
 
+		// Once loading has finished, run the simulation of a new game at
+		// startPath (or of the named savegame) as fast as possible for the
+		// given number of game hours, then print how long each part of the
+		// physics step took. Used to benchmark the simulation without a GPU.
+		void QueueSimBenchmark(const SystemPath &startPath, const std::string &saveName, double hours, int timeAccel);
+
+		// Once loading has finished, fly the camera along the path in the
+		// named JSON file (see CameraPath) at a fixed time step, and write the
+		// frame times and rendering stats of each frame to the user's
+		// benchmark directory.
+		void QueueFlythroughBenchmark(const std::string &pathFile);
+
+		// Once loading has finished, play back a replay recorded with
+		// Ctrl+R, then print the frame times and quit. The path is relative
+		// to the user's data directory.
+		void QueueReplay(const std::string &path);
+
 		// Returns a pointer to the async JobSet for the current startup loading step.
 		// The current load step will not complete until all ordered jobs have finished.
 		// NOTE: this queue runs on a different thread.
@@ -91,6 +109,8 @@ public:
 		friend class MainMenu;
 		friend class GameLoop;
 		friend class TombstoneLoop;
+		friend class SimBenchmark;
+		friend class FlythroughBenchmark;
 
 		App() :
 			GuiApplication("Pioneer") {}
@@ -151,6 +171,8 @@ public:
 	static void SetHudTrailsDisplayed(bool state) { hudTrailsDisplayed = state; }
 
 	static SceneGraph::Model *FindModel(const std::string &, bool allowPlaceholder = true);
+	// a new instance owned by the caller; the template may be evicted from the cache
+	static SceneGraph::Model *MakeModelInstance(const std::string &, bool allowPlaceholder = true);
 
 	static LuaSerializer *luaSerializer;
 	static LuaTimer *luaTimer;
@@ -199,6 +221,8 @@ public:
 	static Sound::MusicPlayer &GetMusicPlayer() { return musicPlayer; }
 	static Graphics::Renderer *renderer;
 	static ModelCache *modelCache;
+	// the engine's caches, trimmed to MemoryBudgetMB between them
+	static MemoryBudget *memoryBudget;
 	static Intro *intro;
 	static SDLGraphics *sdl;
 
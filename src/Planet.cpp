@@ -17,6 +17,9 @@
 #include "perlin.h"
 #include "profiler/Profiler.h"
 
+#include <map>
+#include <tuple>
+
 #ifdef _MSC_VER
 #include "win32/WinMath.h"
 #endif // _MSC_VER
@@ -96,15 +99,61 @@ void Planet::GetAtmosphericState(double dist, double *outPressure, double *outDe
 	*outDensity = sbody->GetAtmDensity(height_h, *outPressure);
 }
 
-void Planet::GenerateRings(Graphics::Renderer *renderer)
+// Ring geometry depends only on the ring radii and the texture only on the
+// ring style, body radius and seed, so planets sharing them (most commonly
+// the same planet seen again after leaving and returning to a system) reuse
+// them instead of generating and uploading another copy.
+// Entries no longer used by any planet are pruned as new ones are added.
+struct RingMeshKey {
+	fixed minRadius, maxRadius;
+
+	bool operator<(const RingMeshKey &o) const
+	{
+		return std::tie(minRadius.v, maxRadius.v) < std::tie(o.minRadius.v, o.maxRadius.v);
+	}
+};
+
+struct RingTextureKey {
+	RingMeshKey radii;
+	Uint32 baseColor;
+	Uint32 seed;
+	double bodyRadius;
+
+	bool operator<(const RingTextureKey &o) const
+	{
+		if (radii < o.radii) return true;
+		if (o.radii < radii) return false;
+		return std::tie(baseColor, seed, bodyRadius) < std::tie(o.baseColor, o.seed, o.bodyRadius);
+	}
+};
+
+static std::map<RingMeshKey, RefCountedPtr<Graphics::MeshObject>> s_ringMeshCache;
+static std::map<RingTextureKey, RefCountedPtr<Graphics::Texture>> s_ringTextureCache;
+
+// drop cached entries only referenced by the cache
+template <typename Map>
+static void PruneRingCache(Map &cache)
 {
-	const SystemBody *sbody = GetSystemBody();
+	for (auto it = cache.begin(); it != cache.end();) {
+		if (it->second->GetRefCount() == 1)
+			it = cache.erase(it);
+		else
+			++it;
+	}
+}
+
+//static
+void Planet::Uninit()
+{
+	s_ringMeshCache.clear();
+	s_ringTextureCache.clear();
+}
 
+static Graphics::MeshObject *CreateRingMesh(Graphics::Renderer *renderer, float inner, float outer)
+{
 	Graphics::VertexArray ringVertices(RING_VERTEX_ATTRIBS);
 
 	// generate the ring geometry
-	const float inner = sbody->GetRings().minRadius.ToFloat();
-	const float outer = sbody->GetRings().maxRadius.ToFloat();
 	int segments = 200;
 	for (int i = 0; i <= segments; ++i) {
 		const float a = (2.0f * float(M_PI)) * (float(i) / float(segments));
@@ -115,8 +164,11 @@ void Planet::GenerateRings(Graphics::Renderer *renderer)
 	}
 
 	// Upload vertex data to GPU
-	m_ringMesh.reset(renderer->CreateMeshObjectFromArray(&ringVertices));
+	return renderer->CreateMeshObjectFromArray(&ringVertices);
+}
 
+static Graphics::Texture *CreateRingTexture(Graphics::Renderer *renderer, const SystemBody *sbody, float inner, float outer)
+{
 	// generate the ring texture
 	// NOTE: texture width must be > 1 to avoid graphical glitches with Intel GMA 900 systems
 	//       this is something to do with mipmapping (probably mipmap generation going wrong)
@@ -128,7 +180,7 @@ void Planet::GenerateRings(Graphics::Renderer *renderer)
 
 	const float ringScale = (outer - inner) * sbody->GetRadius() / 1.5e7f;
 
-	Random rng(GetSystemBody()->GetSeed() + 4609837);
+	Random rng(sbody->GetSeed() + 4609837);
 	Color baseCol = sbody->GetRings().baseColor;
 	double noiseOffset = 2048.0 * rng.Double();
 	for (int i = 0; i < RING_TEXTURE_LENGTH; ++i) {
@@ -165,10 +217,38 @@ void Planet::GenerateRings(Graphics::Renderer *renderer)
 	const Graphics::TextureDescriptor texDesc(
 		Graphics::TEXTURE_RGBA_8888, texSize, Graphics::LINEAR_REPEAT, true, true, true, 0, Graphics::TEXTURE_2D);
 
-	m_ringTexture.Reset(renderer->CreateTexture(texDesc));
-	m_ringTexture->Update(
+	Graphics::Texture *texture = renderer->CreateTexture(texDesc);
+	texture->Update(
 		static_cast<void *>(buf.get()), texSize,
 		Graphics::TEXTURE_RGBA_8888);
+	return texture;
+}
+
+void Planet::GenerateRings(Graphics::Renderer *renderer)
+{
+	PROFILE_SCOPED()
+	const SystemBody *sbody = GetSystemBody();
+	const RingStyle &rings = sbody->GetRings();
+
+	const float inner = rings.minRadius.ToFloat();
+	const float outer = rings.maxRadius.ToFloat();
+
+	const RingMeshKey meshKey = { rings.minRadius, rings.maxRadius };
+	auto meshIt = s_ringMeshCache.find(meshKey);
+	if (meshIt == s_ringMeshCache.end()) {
+		PruneRingCache(s_ringMeshCache);
+		meshIt = s_ringMeshCache.emplace(meshKey, CreateRingMesh(renderer, inner, outer)).first;
+	}
+	m_ringMesh = meshIt->second;
+
+	const Color &c = rings.baseColor;
+	const RingTextureKey texKey = { meshKey, Uint32(c.r) << 24 | Uint32(c.g) << 16 | Uint32(c.b) << 8 | c.a, sbody->GetSeed(), sbody->GetRadius() };
+	auto texIt = s_ringTextureCache.find(texKey);
+	if (texIt == s_ringTextureCache.end()) {
+		PruneRingCache(s_ringTextureCache);
+		texIt = s_ringTextureCache.emplace(texKey, CreateRingTexture(renderer, sbody, inner, outer)).first;
+	}
+	m_ringTexture = texIt->second;
 
 	Graphics::MaterialDescriptor desc;
 	desc.lighting = true;
@@ -191,7 +271,7 @@ void Planet::DrawGasGiantRings(Renderer *renderer, const matrix4x4d &modelView)
 		GenerateRings(renderer);
 
 	renderer->SetTransform(matrix4x4f(modelView));
-	renderer->DrawMesh(m_ringMesh.get(), m_ringMaterial.get());
+	renderer->DrawMesh(m_ringMesh.Get(), m_ringMaterial.get());
 }
 
 void Planet::SubRender(Renderer *r, const matrix4x4d &viewTran, const vector3d &camPos)
@@ -27,6 +27,9 @@ public:
 	void GetAtmosphericState(double dist, double *outPressure, double *outDensity) const;
 	double GetAtmosphereRadius() const { return m_atmosphereRadius; }
 
+	// releases the ring meshes and textures shared between planets
+	static void Uninit();
+
 	friend class ObjectViewerView;
 
 protected:
@@ -37,9 +40,9 @@ private:
 
 	double m_atmosphereRadius;
 	double m_surfaceGravity_g;
-	RefCountedPtr<Graphics::Texture> m_ringTexture;
+	RefCountedPtr<Graphics::Texture> m_ringTexture; // shared with planets with the same rings
 	std::unique_ptr<Graphics::Material> m_ringMaterial;
-	std::unique_ptr<Graphics::MeshObject> m_ringMesh;
+	RefCountedPtr<Graphics::MeshObject> m_ringMesh; // shared with planets with the same rings
 };
 
 #endif /* _PLANET_H */
@@ -6,6 +6,7 @@
 
 #include "Body.h"
 #include "Color.h"
+#include "core/PoolAllocator.h"
 
 struct ProjectileData {
 	ProjectileData() :
@@ -35,7 +36,9 @@ namespace Graphics {
 	class MeshObject;
 } // namespace Graphics
 
-class Projectile : public Body {
+// Projectiles are short-lived and created in bursts by every gun in a fight,
+// so instances come from the block pools rather than the general heap
+class Projectile : public Body, public PoolAllocated {
 public:
 	OBJDEF(Projectile, Body, PROJECTILE);
 
@@ -0,0 +1,75 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "QualityGovernor.h"
+
+#include <algorithm>
+
+// weight of the newest sample in the moving averages, about a quarter of a
+// second at 60 fps
+static constexpr double SMOOTHING = 0.06;
+
+QualityGovernor::QualityGovernor(const Settings &settings) :
+	m_settings(settings)
+{
+	Reset();
+}
+
+void QualityGovernor::Reset()
+{
+	m_level = 0;
+	m_frameTime = m_settings.targetFrameTime;
+	m_jobLatency = 0.0;
+	m_overFrames = 0;
+	m_underFrames = 0;
+	m_cooldown = 0;
+}
+
+void QualityGovernor::SetLevel(int level)
+{
+	level = std::clamp(level, MIN_LEVEL, MAX_LEVEL);
+	if (level == m_level)
+		return;
+
+	m_level = level;
+	m_overFrames = 0;
+	m_underFrames = 0;
+	m_cooldown = COOLDOWN_FRAMES;
+	// measurements from before the change say nothing about the new level
+	m_frameTime = m_settings.targetFrameTime;
+	m_jobLatency = 0.0;
+}
+
+void QualityGovernor::Update(double frameTime, double jobLatency)
+{
+	if (m_cooldown > 0) {
+		m_cooldown--;
+		return;
+	}
+
+	m_frameTime += (frameTime - m_frameTime) * SMOOTHING;
+	// latency only decays on frames that finish jobs, so a single slow job
+	// followed by an idle spell doesn't hold detail down
+	if (jobLatency >= 0.0)
+		m_jobLatency += (jobLatency - m_jobLatency) * SMOOTHING;
+	else
+		m_jobLatency *= 1.0 - SMOOTHING;
+
+	const bool slowFrames = m_frameTime > m_settings.targetFrameTime * OVER_BUDGET;
+	const bool slowJobs = m_settings.maxJobLatency > 0.0 && m_jobLatency > m_settings.maxJobLatency;
+	const bool spareTime = m_frameTime < m_settings.targetFrameTime * UNDER_BUDGET &&
+		(m_settings.maxJobLatency <= 0.0 || m_jobLatency < m_settings.maxJobLatency * UNDER_BUDGET);
+
+	if (slowFrames || slowJobs) {
+		m_underFrames = 0;
+		if (++m_overFrames >= LOWER_FRAMES)
+			SetLevel(m_level + 1);
+	} else if (spareTime) {
+		m_overFrames = 0;
+		if (++m_underFrames >= RAISE_FRAMES)
+			SetLevel(m_level - 1);
+	} else {
+		m_overFrames = 0;
+		m_underFrames = 0;
+	}
+}
@@ -0,0 +1,67 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _QUALITYGOVERNOR_H
+#define _QUALITYGOVERNOR_H
+
+#include <cstdint>
+
+/*
+ * Trades terrain and model detail for frame rate at runtime, on top of the
+ * detail levels the player chose. The governor's level is how far to stray
+ * from those: positive levels take detail away (shallower GeoSphere patch
+ * trees, smaller gas giant textures, coarser model LODs), a negative one
+ * adds some when there's time to spare.
+ *
+ * Detail goes down when the frame time stays over its target, or terrain
+ * jobs take too long to come back (a descent outrunning the patch
+ * generation), and comes back up only after a long spell well within
+ * both. Each change is followed by a cool-down, as the patch trees take a
+ * while to settle at their new depth, so the level never flaps.
+ */
+class QualityGovernor {
+public:
+	struct Settings {
+		double targetFrameTime = 1000.0 / 60.0; // ms
+		double maxJobLatency = 500.0;			// ms from a terrain job's request to its result
+	};
+
+	static constexpr int MIN_LEVEL = -1;
+	static constexpr int MAX_LEVEL = 3;
+
+	// over budget for this many frames in a row before detail drops
+	static constexpr uint32_t LOWER_FRAMES = 30;
+	// well within budget for this many frames in a row before it rises
+	static constexpr uint32_t RAISE_FRAMES = 600;
+	// frames after a change in which nothing is measured
+	static constexpr uint32_t COOLDOWN_FRAMES = 180;
+
+	// over budget: smoothed frame time above this share of the target
+	static constexpr double OVER_BUDGET = 1.1;
+	// well within budget: below this share of the target and latency limit
+	static constexpr double UNDER_BUDGET = 0.7;
+
+	explicit QualityGovernor(const Settings &settings);
+
+	// with the frame time in milliseconds, and the longest latency of the
+	// terrain jobs finished this frame, or a negative number if none were
+	void Update(double frameTime, double jobLatency);
+	void Reset();
+
+	int GetLevel() const { return m_level; }
+	double GetSmoothedFrameTime() const { return m_frameTime; }
+	double GetSmoothedJobLatency() const { return m_jobLatency; }
+
+private:
+	void SetLevel(int level);
+
+	Settings m_settings;
+	int m_level = 0;
+	double m_frameTime = 0.0;
+	double m_jobLatency = 0.0;
+	uint32_t m_overFrames = 0;
+	uint32_t m_underFrames = 0;
+	uint32_t m_cooldown = 0;
+};
+
+#endif /* _QUALITYGOVERNOR_H */
@@ -25,10 +25,42 @@ extern "C" {
 #define PCG_LITTLE_ENDIAN 1
 #include "pcg-cpp/pcg_random.hpp"
 
+// Philox4x32-10, from Salmon et al., "Parallel Random Numbers: As Easy as
+// 1, 2, 3": a keyed bijection of a 128-bit counter, giving four numbers
+inline void Philox4x32(Uint32 ctr[4], const Uint32 key[2])
+{
+	Uint32 k0 = key[0], k1 = key[1];
+	for (int round = 0; round < 10; round++) {
+		const Uint64 p0 = Uint64(0xD2511F53) * ctr[0];
+		const Uint64 p1 = Uint64(0xCD9E8D57) * ctr[2];
+		const Uint32 c1 = ctr[1], c3 = ctr[3];
+		ctr[0] = Uint32(p1 >> 32) ^ c1 ^ k0;
+		ctr[1] = Uint32(p1);
+		ctr[2] = Uint32(p0 >> 32) ^ c3 ^ k1;
+		ctr[3] = Uint32(p0);
+		k0 += 0x9E3779B9;
+		k1 += 0xBB67AE85;
+	}
+}
+
 // A deterministic random number generator
+//
+// By default the numbers come one after another from a PCG sequence.
+// seedStream() makes it a counter-based generator instead, where each
+// number is a function of the key and its place in the stream alone, so
+// any number of streams can be set up independently and drawn from in any
+// order, e.g. on different threads, with the same results.
 class Random : public RefCounted {
 	pcg32 mPCG;
 
+	// counter-based stream, if mStream
+	bool mStream = false;
+	Uint32 mKey[2];
+	Uint32 mStreamIndex;
+	Uint32 mStreamPurpose;
+	Uint64 mPosition; // of the next number
+	Uint32 mBlock[4]; // the four numbers of the block mPosition is in
+
 	// For storing second rand from Normal
 	bool cached;
 	double z1;
@@ -72,9 +104,30 @@ public:
 	{
 		const Uint32 hash = lookup3_hashword(seeds, length, 0);
 		mPCG.seed(hash);
+		mStream = false;
+		cached = false;
+	}
+
+	// Make this the counter-based stream keyed by the hash of the given
+	// seeds, addressed by an index (e.g. of a body) and a purpose (a salt
+	// for what the numbers are for). Streams differing in any of these are
+	// independent of each other.
+	void seedStream(const Uint32 *const seeds, size_t length, Uint32 index, Uint32 purpose)
+	{
+		mKey[0] = mKey[1] = 0;
+		lookup3_hashword2(seeds, length, &mKey[0], &mKey[1]);
+		mStreamIndex = index;
+		mStreamPurpose = purpose;
+		mPosition = 0;
+		mStream = true;
 		cached = false;
 	}
 
+	void seedStream(std::initializer_list<uint32_t> list, Uint32 index, Uint32 purpose)
+	{
+		seedStream(&*list.begin(), list.size(), index, purpose);
+	}
+
 	// Seed using an array of 64-bit integers
 	void seed(const Uint64 *const seeds, size_t length)
 	{
@@ -92,6 +145,28 @@ public:
 		seed(&value, 1);
 	}
 
+	// Move the sequence on by count numbers, as that many calls to Int32()
+	// would, in time logarithmic in count
+	void Skip(Uint64 count)
+	{
+		if (mStream) {
+			mPosition += count;
+			if (mPosition & 3)
+				FillBlock();
+		} else {
+			mPCG.discard(count);
+		}
+		cached = false;
+	}
+
+	// The count of Int32() calls it takes to get from origin's place in
+	// the sequence to this one's
+	Uint64 DrawsSince(const Random &origin) const
+	{
+		assert(mStream == origin.mStream);
+		return mStream ? mPosition - origin.mPosition : mPCG - origin.mPCG;
+	}
+
 	//
 	// Number generators.
 	//
@@ -104,7 +179,12 @@ public:
 	// interval [0, 2**32)
 	inline Uint32 Int32()
 	{
-		return mPCG();
+		if (!mStream)
+			return mPCG();
+
+		if ((mPosition & 3) == 0)
+			FillBlock();
+		return mBlock[mPosition++ & 3];
 	}
 
 	// Pick an integer like you're rolling a "choices" sided die,
@@ -266,6 +346,15 @@ public:
 	const pcg32 &GetPCG() const { return mPCG; }
 
 private:
+	void FillBlock()
+	{
+		mBlock[0] = Uint32(mPosition >> 2);
+		mBlock[1] = Uint32(mPosition >> 34);
+		mBlock[2] = mStreamIndex;
+		mBlock[3] = mStreamPurpose;
+		Philox4x32(mBlock, mKey);
+	}
+
 	Random(const Random &); // copy constructor not defined
 	void operator=(const Random &); // assignment operator not defined
 };
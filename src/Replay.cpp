@@ -0,0 +1,426 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "Replay.h"
+
+#include "FileSystem.h"
+#include "Game.h"
+#include "GameSaveError.h"
+#include "Input.h"
+#include "JsonUtils.h"
+#include "PerfStats.h"
+#include "Pi.h"
+#include "Player.h"
+#include "core/GZipFormat.h"
+#include "core/Log.h"
+#include "profiler/Profiler.h"
+
+#include <array>
+#include <time.h>
+
+namespace {
+	static constexpr int REPLAY_VERSION = 1;
+
+	struct ReplayFrame {
+		float deltaTime = 0.0f;
+		int ticks = 0;
+		double accumulator = 0.0;
+		std::vector<Replay::BindingChange> bindings;
+		std::array<int, 2> mouseMotion = {};
+		int mouseWheel = 0;
+		std::vector<char> mouseButtons;
+		// x, y of each physics tick
+		std::vector<int> tickMouse;
+		// -1 if the requested time acceleration didn't change
+		int timeAccel = -1;
+		bool forceTimeAccel = false;
+	};
+
+	Replay::Mode s_mode = Replay::Mode::Off;
+	bool s_recordingRequested = false;
+
+	Json s_game;
+	Uint32 s_rngSeed = 0;
+	std::vector<Uint32> s_seeds;
+	std::vector<ReplayFrame> s_frames;
+
+	// recording: the last requested time acceleration written out
+	int s_lastTimeAccel = -1;
+	bool s_lastForceTimeAccel = false;
+
+	// playback
+	size_t s_frame = 0;
+	size_t s_seed = 0;
+	size_t s_tickMouse = 0;
+	Profiler::Clock s_frameTimer;
+	std::vector<double> s_frameTimes;
+
+	const std::vector<Replay::BindingChange> s_noBindingChanges;
+} // namespace
+
+static Json FrameToJson(const ReplayFrame &frame)
+{
+	Json node = Json::object();
+	node["dt"] = frame.deltaTime;
+	node["ticks"] = frame.ticks;
+	node["acc"] = frame.accumulator;
+
+	if (!frame.bindings.empty()) {
+		Json bindings = Json::array();
+		for (const Replay::BindingChange &change : frame.bindings)
+			bindings.push_back(Json::array({ change.id, change.axis, change.flags, change.value }));
+		node["bindings"] = bindings;
+	}
+
+	if (frame.mouseMotion[0] || frame.mouseMotion[1] || frame.mouseWheel)
+		node["mouse"] = Json::array({ frame.mouseMotion[0], frame.mouseMotion[1], frame.mouseWheel });
+	for (char button : frame.mouseButtons) {
+		if (button) {
+			node["buttons"] = frame.mouseButtons;
+			break;
+		}
+	}
+	if (!frame.tickMouse.empty())
+		node["tick_mouse"] = frame.tickMouse;
+	if (frame.timeAccel >= 0)
+		node["accel"] = Json::array({ frame.timeAccel, frame.forceTimeAccel });
+
+	return node;
+}
+
+static ReplayFrame FrameFromJson(const Json &node)
+{
+	ReplayFrame frame;
+	frame.deltaTime = node["dt"];
+	frame.ticks = node["ticks"];
+	frame.accumulator = node["acc"];
+
+	if (node.count("bindings")) {
+		for (const Json &change : node["bindings"])
+			frame.bindings.push_back({ change[0].get<std::string>(), change[1].get<bool>(),
+				change[2].get<Uint8>(), change[3].get<float>() });
+	}
+
+	if (node.count("mouse")) {
+		const Json &mouse = node["mouse"];
+		frame.mouseMotion = { mouse[0].get<int>(), mouse[1].get<int>() };
+		frame.mouseWheel = mouse[2];
+	}
+	if (node.count("buttons"))
+		frame.mouseButtons = node["buttons"].get<std::vector<char>>();
+	if (node.count("tick_mouse"))
+		frame.tickMouse = node["tick_mouse"].get<std::vector<int>>();
+	if (node.count("accel")) {
+		frame.timeAccel = node["accel"][0];
+		frame.forceTimeAccel = node["accel"][1];
+	}
+
+	return frame;
+}
+
+static void Clear()
+{
+	s_mode = Replay::Mode::Off;
+	s_game = Json();
+	s_seeds.clear();
+	s_frames.clear();
+	s_frameTimes.clear();
+	s_frame = s_seed = s_tickMouse = 0;
+}
+
+static bool StartRecording()
+{
+	Game *game = Pi::game;
+	if (!game || game->IsHyperspace() || game->GetPlayer()->IsDead())
+		return false;
+
+	PROFILE_SCOPED()
+	Clear();
+	game->ToJson(s_game);
+
+	// whatever the game has drawn from Pi::rng so far is in the save
+	s_rngSeed = Pi::rng.Int32();
+	Pi::rng.seed(s_rngSeed);
+
+	s_lastTimeAccel = game->GetRequestedTimeAccel();
+	s_lastForceTimeAccel = game->IsTimeAccelForced();
+
+	s_mode = Replay::Mode::Recording;
+	s_recordingRequested = false;
+	s_frames.emplace_back();
+
+	// actions held and axes deflected as recording starts
+	Pi::input->RecordBindingState();
+
+	Log::Info("Recording replay\n");
+	return true;
+}
+
+namespace Replay {
+
+	Mode GetMode()
+	{
+		return s_mode;
+	}
+
+	void RequestRecording()
+	{
+		if (s_mode == Mode::Off)
+			s_recordingRequested = true;
+	}
+
+	std::string StopRecording()
+	{
+		s_recordingRequested = false;
+		if (s_mode != Mode::Recording)
+			return std::string();
+
+		PROFILE_SCOPED()
+		Json rootNode = Json::object();
+		rootNode["version"] = REPLAY_VERSION;
+		rootNode["game"] = std::move(s_game);
+		rootNode["rng_seed"] = s_rngSeed;
+		rootNode["seeds"] = s_seeds;
+
+		Json frames = Json::array();
+		for (const ReplayFrame &frame : s_frames)
+			frames.push_back(FrameToJson(frame));
+		rootNode["frames"] = std::move(frames);
+
+		const size_t numFrames = s_frames.size();
+		Clear();
+
+		FileSystem::userFiles.MakeDirectory("replays");
+
+		char name[40];
+		const time_t t = time(nullptr);
+		strftime(name, sizeof(name), "replay-%Y%m%d-%H%M%S", localtime(&t));
+		const std::string path = FileSystem::JoinPath("replays", name);
+
+		FILE *f = FileSystem::userFiles.OpenWriteStream(path);
+		if (!f)
+			return std::string();
+
+		const std::vector<uint8_t> cbor = Json::to_cbor(rootNode);
+		bool ok;
+		try {
+			const std::string compressed = gzip::CompressGZip(
+				std::string(reinterpret_cast<const char *>(cbor.data()), cbor.size()), std::string(name) + ".json");
+			ok = fwrite(compressed.data(), compressed.size(), 1, f) == 1;
+		} catch (const gzip::CompressionFailedException &) {
+			ok = false;
+		}
+		ok = fclose(f) == 0 && ok;
+
+		if (!ok)
+			return std::string();
+
+		Log::Info("Replay of {} frames written to {}\n", numFrames, path);
+		return path;
+	}
+
+	Game *StartPlayback(const std::string &path)
+	{
+		PROFILE_SCOPED()
+		Clear();
+
+		const Json rootNode = JsonUtils::LoadJsonSaveFile(path, FileSystem::userFiles);
+		if (!rootNode.is_object() || rootNode.value("version", 0) != REPLAY_VERSION) {
+			Log::Warning("Could not load replay '{}'\n", path);
+			return nullptr;
+		}
+
+		Game *game;
+		try {
+			s_rngSeed = rootNode["rng_seed"];
+			s_seeds = rootNode["seeds"].get<std::vector<Uint32>>();
+			for (const Json &frame : rootNode["frames"])
+				s_frames.push_back(FrameFromJson(frame));
+
+			game = new Game(rootNode["game"]);
+		} catch (const Json::exception &) {
+			Log::Warning("Replay '{}' is corrupt\n", path);
+			Clear();
+			return nullptr;
+		} catch (const SavedGameCorruptException &) {
+			Log::Warning("Replay '{}' is corrupt\n", path);
+			Clear();
+			return nullptr;
+		} catch (const SavedGameWrongVersionException &) {
+			Log::Warning("Replay '{}' was recorded with an incompatible version\n", path);
+			Clear();
+			return nullptr;
+		}
+
+		Output("Playing back replay '%s', %zu frames\n", path.c_str(), s_frames.size());
+		s_mode = Mode::Playing;
+		// BeginFrame moves on to the first frame
+		s_frame = size_t(-1);
+		return game;
+	}
+
+	void StopPlayback()
+	{
+		if (s_mode != Mode::Playing)
+			return;
+
+		const Perf::Summary summary = Perf::Summarise(s_frameTimes);
+		Output("\nReplay finished, %zu of %zu frames played\n", s_frameTimes.size(), s_frames.size());
+		Output("  %-11s %10s %10s %10s %10s %10s\n", "", "mean", "p50", "p95", "p99", "max");
+		Output("  %-11s %10.2f %10.2f %10.2f %10.2f %10.2f\n", "frame_ms", summary.mean, summary.p50, summary.p95, summary.p99, summary.max);
+
+		Clear();
+	}
+
+	bool BeginFrame(float &deltaTime)
+	{
+		if (s_mode == Mode::Recording) {
+			s_frames.emplace_back();
+			s_frames.back().deltaTime = deltaTime;
+			return true;
+		}
+
+		// the first frame is added by StartRecording, with the binding state
+		if (s_recordingRequested && StartRecording()) {
+			s_frames.back().deltaTime = deltaTime;
+			return true;
+		}
+
+		if (s_mode != Mode::Playing)
+			return true;
+
+		// the whole of the previous frame, swap and all
+		if (++s_frame == 0) {
+			Pi::rng.seed(s_rngSeed);
+		} else {
+			s_frameTimer.SoftStop();
+			s_frameTimes.push_back(s_frameTimer.milliseconds());
+		}
+		s_frameTimer.SoftReset();
+
+		if (s_frame >= s_frames.size()) {
+			StopPlayback();
+			return false;
+		}
+
+		s_tickMouse = 0;
+		deltaTime = s_frames[s_frame].deltaTime;
+		return true;
+	}
+
+	void RecordPhysics(int ticks, double accumulator)
+	{
+		if (s_mode != Mode::Recording)
+			return;
+
+		s_frames.back().ticks = ticks;
+		s_frames.back().accumulator = accumulator;
+	}
+
+	bool GetPhysics(int &ticks, double &accumulator)
+	{
+		if (s_mode != Mode::Playing)
+			return false;
+
+		ticks = s_frames[s_frame].ticks;
+		accumulator = s_frames[s_frame].accumulator;
+		return true;
+	}
+
+	void UpdateTimeAccel(Game *game)
+	{
+		if (s_mode == Mode::Recording) {
+			const int requested = game->GetRequestedTimeAccel();
+			const bool force = game->IsTimeAccelForced();
+			if (requested != s_lastTimeAccel || force != s_lastForceTimeAccel) {
+				s_frames.back().timeAccel = s_lastTimeAccel = requested;
+				s_frames.back().forceTimeAccel = s_lastForceTimeAccel = force;
+			}
+		} else if (s_mode == Mode::Playing) {
+			const ReplayFrame &frame = s_frames[s_frame];
+			if (frame.timeAccel >= 0)
+				game->RequestTimeAccel(Game::TimeAccel(frame.timeAccel), frame.forceTimeAccel);
+		}
+	}
+
+	void EndGame()
+	{
+		if (s_mode == Mode::Recording) {
+			if (StopRecording().empty())
+				Log::Warning("Unable to write replay\n");
+		} else {
+			StopPlayback();
+		}
+		s_recordingRequested = false;
+	}
+
+	Uint32 Seed(Uint32 seed)
+	{
+		if (s_mode == Mode::Recording)
+			s_seeds.push_back(seed);
+		else if (s_mode == Mode::Playing && s_seed < s_seeds.size())
+			return s_seeds[s_seed++];
+		return seed;
+	}
+
+	void RecordBindingChange(BindingChange &&change)
+	{
+		if (s_mode == Mode::Recording)
+			s_frames.back().bindings.push_back(std::move(change));
+	}
+
+	const std::vector<BindingChange> &GetBindingChanges()
+	{
+		if (s_mode != Mode::Playing)
+			return s_noBindingChanges;
+		return s_frames[s_frame].bindings;
+	}
+
+	void RecordMouse(const int motion[2], int wheel, const char *buttons, size_t numButtons)
+	{
+		if (s_mode != Mode::Recording)
+			return;
+
+		ReplayFrame &frame = s_frames.back();
+		frame.mouseMotion = { motion[0], motion[1] };
+		frame.mouseWheel = wheel;
+		frame.mouseButtons.assign(buttons, buttons + numButtons);
+	}
+
+	void GetMouse(int motion[2], int &wheel, char *buttons, size_t numButtons)
+	{
+		if (s_mode != Mode::Playing)
+			return;
+
+		const ReplayFrame &frame = s_frames[s_frame];
+		motion[0] = frame.mouseMotion[0];
+		motion[1] = frame.mouseMotion[1];
+		wheel = frame.mouseWheel;
+		for (size_t i = 0; i < numButtons; i++)
+			buttons[i] = i < frame.mouseButtons.size() ? frame.mouseButtons[i] : 0;
+	}
+
+	void RecordTickMouse(int x, int y)
+	{
+		if (s_mode != Mode::Recording)
+			return;
+
+		s_frames.back().tickMouse.push_back(x);
+		s_frames.back().tickMouse.push_back(y);
+	}
+
+	void GetTickMouse(int &x, int &y)
+	{
+		x = y = 0;
+		if (s_mode != Mode::Playing)
+			return;
+
+		const std::vector<int> &tickMouse = s_frames[s_frame].tickMouse;
+		if (s_tickMouse + 2 > tickMouse.size())
+			return;
+
+		x = tickMouse[s_tickMouse++];
+		y = tickMouse[s_tickMouse++];
+	}
+
+} // namespace Replay
@@ -0,0 +1,105 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _REPLAY_H
+#define _REPLAY_H
+
+#include <SDL_stdinc.h>
+#include <string>
+#include <vector>
+
+class Game;
+
+// Replays: a recording of a stretch of play that can be run back to compare
+// the performance of builds or settings on exactly the same session.
+//
+// A replay starts with the game saved at the first recorded frame. Each
+// frame after that holds its time step, the number of physics ticks run,
+// the changes DispatchEvents made to the input bindings, the mouse state,
+// and any time acceleration asked for. Seeds taken from the clock (Lua's
+// Rand.New() with no seed, and the like) go through Seed() so they are
+// recorded too, and Pi::rng is seeded afresh when recording starts.
+//
+// Playing a replay back loads the saved game and runs the normal game loop
+// on the recorded frames, ignoring input from the devices, then reports the
+// frame times. Anything not driven by the bindings (clicks on the UI, Lua
+// iterating over a table in a different order) can still make the session
+// drift.
+namespace Replay {
+
+	enum class Mode {
+		Off,
+		Recording,
+		Playing
+	};
+
+	Mode GetMode();
+	inline bool IsRecording() { return GetMode() == Mode::Recording; }
+	inline bool IsPlaying() { return GetMode() == Mode::Playing; }
+
+	// start recording at the beginning of the next game frame that the
+	// game can be saved on
+	void RequestRecording();
+	// stop recording and write the replay out, returning its path; empty
+	// if nothing was recorded or it couldn't be written
+	std::string StopRecording();
+
+	// load a replay from the user's files, returning the game to play it
+	// back on, or nullptr if it couldn't be loaded
+	Game *StartPlayback(const std::string &path);
+	// print the frame times of the frames played back so far and stop
+	void StopPlayback();
+
+	// Called by the game loop at the start of each frame. While playing
+	// back, deltaTime is replaced with the recorded one. Returns false
+	// once a replay has run out of frames.
+	bool BeginFrame(float &deltaTime);
+
+	// the physics ticks of the frame and the time left over after them;
+	// GetPhysics returns false unless playing back
+	void RecordPhysics(int ticks, double accumulator);
+	bool GetPhysics(int &ticks, double &accumulator);
+
+	// called just before Game::UpdateTimeAccel, to record or apply a
+	// change in the requested time acceleration
+	void UpdateTimeAccel(Game *game);
+
+	// called when the game ends, writing or stopping the replay in progress
+	void EndGame();
+
+	// a seed that would otherwise differ from run to run
+	Uint32 Seed(Uint32 seed);
+
+	// Used by Input::Manager. Binding changes are recorded with their
+	// binding id; flags are BINDING_* values. A change that emits nothing
+	// is binding state from before recording started, applied as the frame
+	// starts rather than when the frame's events are dispatched.
+	enum BindingFlags : Uint8 {
+		BINDING_PRESSED = 1,  // emit onPressed
+		BINDING_RELEASED = 2, // emit onReleased
+		BINDING_ACTIVE = 4,	  // the action is active afterwards
+		BINDING_EMIT = 8,	  // emit onAxisValue
+	};
+
+	struct BindingChange {
+		std::string id;
+		bool axis;
+		Uint8 flags;
+		float value;
+	};
+
+	void RecordBindingChange(BindingChange &&change);
+	// the binding changes of the frame being played back
+	const std::vector<BindingChange> &GetBindingChanges();
+
+	// mouse motion, wheel and button state of the frame
+	void RecordMouse(const int motion[2], int wheel, const char *buttons, size_t numButtons);
+	void GetMouse(int motion[2], int &wheel, char *buttons, size_t numButtons);
+
+	// the relative mouse motion read on each physics tick
+	void RecordTickMouse(int x, int y);
+	void GetTickMouse(int &x, int &y);
+
+} // namespace Replay
+
+#endif
@@ -0,0 +1,168 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "SaveGameDelta.h"
+
+#include "GameSaveError.h"
+
+#define XXH_INLINE_ALL
+#include "lz4/xxhash.h"
+
+// deep enough for space/bodies/<body> and lua_modules_json/table/<module>
+static const int s_chunkDepth = 3;
+
+static const char s_baseIdKey[] = "delta_base_id";
+
+namespace {
+	using namespace SaveGameDelta;
+
+	bool IsContainer(const Json &node, int depth)
+	{
+		return depth < s_chunkDepth && (node.is_object() || node.is_array()) && !node.empty();
+	}
+
+	// member names or length, so a changed shape makes the node one chunk
+	Uint64 HashShape(const Json &node)
+	{
+		if (node.is_array())
+			return XXH64(nullptr, 0, node.size());
+
+		std::string names;
+		for (auto it = node.begin(); it != node.end(); ++it) {
+			names += it.key();
+			names += '\0';
+		}
+		return XXH64(names.data(), names.size(), 0);
+	}
+
+	Uint64 HashChunk(const Json &node, size_t &size)
+	{
+		const std::vector<uint8_t> cbor = Json::to_cbor(node);
+		size += cbor.size();
+		return XXH64(cbor.data(), cbor.size(), 0);
+	}
+
+	std::string MemberPath(const std::string &path, const std::string &name)
+	{
+		// escaped as RFC 6901 says
+		std::string member = path + '/';
+		for (char c : name) {
+			if (c == '~')
+				member += "~0";
+			else if (c == '/')
+				member += "~1";
+			else
+				member += c;
+		}
+		return member;
+	}
+
+	template <typename F>
+	void ForEachMember(const Json &node, const std::string &path, F func)
+	{
+		if (node.is_array()) {
+			for (size_t i = 0; i < node.size(); i++)
+				func(node[i], path + '/' + std::to_string(i));
+		} else {
+			for (auto it = node.begin(); it != node.end(); ++it)
+				func(it.value(), MemberPath(path, it.key()));
+		}
+	}
+
+	void AddChunks(Base &base, const Json &node, const std::string &path, int depth)
+	{
+		if (IsContainer(node, depth)) {
+			base.chunks[path] = { true, HashShape(node) };
+			ForEachMember(node, path, [&](const Json &member, const std::string &memberPath) {
+				AddChunks(base, member, memberPath, depth + 1);
+			});
+		} else {
+			base.chunks[path] = { false, HashChunk(node, base.size) };
+		}
+	}
+
+	void DiffChunks(const Base &base, const Json &node, const std::string &path, int depth, Json &out, size_t &size)
+	{
+		const auto chunk = base.chunks.find(path);
+		if (chunk != base.chunks.end() && chunk->second.container) {
+			if (IsContainer(node, depth) && HashShape(node) == chunk->second.hash) {
+				ForEachMember(node, path, [&](const Json &member, const std::string &memberPath) {
+					DiffChunks(base, member, memberPath, depth + 1, out, size);
+				});
+				return;
+			}
+		} else if (chunk != base.chunks.end()) {
+			size_t chunkSize = 0;
+			if (HashChunk(node, chunkSize) == chunk->second.hash)
+				return;
+		}
+
+		HashChunk(node, size);
+		out.push_back(Json::array({ path, node }));
+	}
+} // namespace
+
+namespace SaveGameDelta {
+
+	Base MakeBase(Json &rootNode, Uint64 id)
+	{
+		assert(id != 0);
+		rootNode[s_baseIdKey] = id;
+
+		Base base;
+		base.id = id;
+		AddChunks(base, rootNode, "", 0);
+		return base;
+	}
+
+	Json Diff(const Base &base, Json &rootNode, size_t &size)
+	{
+		rootNode[s_baseIdKey] = base.id;
+
+		Json chunks = Json::array();
+		size = 0;
+		DiffChunks(base, rootNode, "", 0, chunks, size);
+		return chunks;
+	}
+
+	Uint64 GetBaseId(const Json &node)
+	{
+		if (!node.is_object())
+			return 0;
+		const auto id = node.find(s_baseIdKey);
+		if (id == node.end() || !id->is_number_unsigned())
+			return 0;
+		return id->get<Uint64>();
+	}
+
+	Json MakeDeltaFile(const Base &base, Json &&chunks)
+	{
+		Json deltaNode = Json::object();
+		deltaNode[s_baseIdKey] = base.id;
+		deltaNode["chunks"] = std::move(chunks);
+		return deltaNode;
+	}
+
+	bool Apply(Json &rootNode, const Json &deltaNode)
+	{
+		const Uint64 id = GetBaseId(deltaNode);
+		if (id == 0 || id != GetBaseId(rootNode))
+			return false;
+
+		const auto chunks = deltaNode.find("chunks");
+		if (chunks == deltaNode.end() || !chunks->is_array())
+			throw SavedGameCorruptException();
+
+		try {
+			for (const Json &chunk : *chunks) {
+				if (!chunk.is_array() || chunk.size() != 2 || !chunk[0].is_string())
+					throw SavedGameCorruptException();
+				rootNode[Json::json_pointer(chunk[0].get<std::string>())] = chunk[1];
+			}
+		} catch (const Json::exception &) {
+			throw SavedGameCorruptException();
+		}
+		return true;
+	}
+
+} // namespace SaveGameDelta
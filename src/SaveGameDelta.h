@@ -0,0 +1,61 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _SAVEGAMEDELTA_H
+#define _SAVEGAMEDELTA_H
+
+#include "Json.h"
+
+#include <SDL_stdinc.h>
+#include <map>
+#include <string>
+
+// Delta savegames: a full "base" save, plus a delta file holding the parts
+// of the game that have changed since the base was written.
+//
+// The Json tree of a save is cut into chunks: objects and arrays are split
+// into their members down to a fixed depth, so that each body in space,
+// each Lua module's saved table and so on is a chunk of its own. A Base
+// remembers a hash of each chunk of the full save, and Diff gives the
+// chunks of a later save that differ from it, each with its Json pointer.
+// Wherever the set of members of an object or the length of an array has
+// changed the whole of it is one chunk, so applying a delta never has to
+// add or remove members.
+//
+// A delta is always against the base, not the previous delta, so there is
+// only ever one delta file to apply.
+namespace SaveGameDelta {
+
+	struct Base {
+		struct Chunk {
+			bool container; // the hash is of the member names or length
+			Uint64 hash;
+		};
+
+		Uint64 id = 0;
+		size_t size = 0; // the CBOR size of all the chunks
+		std::map<std::string, Chunk> chunks;
+	};
+
+	// hash the chunks of a full save, which is then the base of later
+	// deltas; id is stored in the save to match deltas with it
+	Base MakeBase(Json &rootNode, Uint64 id);
+
+	// the chunks of a later save that differ from base, and their CBOR
+	// size. The save is stamped with the base id as MakeBase stamps the base
+	Json Diff(const Base &base, Json &rootNode, size_t &size);
+
+	// the base id a save or delta was written with, 0 for one written
+	// without deltas
+	Uint64 GetBaseId(const Json &node);
+
+	// make a delta file of the chunks that differ from base
+	Json MakeDeltaFile(const Base &base, Json &&chunks);
+
+	// bring a base save up to date with a delta file written against it.
+	// returns false, leaving the save alone, if the delta is of another base
+	bool Apply(Json &rootNode, const Json &deltaNode);
+
+} // namespace SaveGameDelta
+
+#endif
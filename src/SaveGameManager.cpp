@@ -3,20 +3,103 @@
 
 #include "SaveGameManager.h"
 #include "core/GZipFormat.h"
+#include "core/LZ4Format.h"
 #include "core/Log.h"
+#include "core/StringUtils.h"
 #include "FileSystem.h"
 #include "Game.h"
+#include "GameConfig.h"
 #include "GameSaveError.h"
 #include "JsonUtils.h"
 #include "Player.h"
 #include "Pi.h"
+#include "SaveGameDelta.h"
 #include "profiler/Profiler.h"
 
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <ostream>
+
 
 static const char s_saveDirName[] = "savefiles";
 
 static const int s_saveVersion = 90;
 
+// fast rather than small; the HC presets take several times longer
+static const int s_lz4Preset = 0;
+
+// the delta of a save is written next to it with this suffix
+static const char s_deltaSuffix[] = ".delta";
+
+// saves are written to a file with this suffix and renamed into place
+static const char s_tempSuffix[] = ".tmp";
+
+// once a delta has grown to this fraction of its base, a full save is
+// cheaper to load and not much dearer to write, so the next delta save
+// writes a new base instead
+static const size_t s_deltaCompactDivisor = 4;
+
+// the bases of the delta saves written this session, by save name. Only
+// touched from the main thread; a delta save takes its base for the job
+// and gives it back when the job finishes
+static std::map<std::string, SaveGameDelta::Base> s_deltaBases;
+
+// numbers the game snapshots in the order they're taken, and the last one
+// taken of each save name. Only touched from the main thread
+static Uint64 s_saveSerial = 0;
+static std::map<std::string, Uint64> s_latestSaves;
+
+static Uint64 NextSaveSerial(const std::string &name)
+{
+	s_latestSaves[name] = ++s_saveSerial;
+	return s_saveSerial;
+}
+
+// Held while a save is written, as the save jobs of the same name can run on
+// different worker threads at once. The last snapshot written to each name
+// is kept, so an older one finishing later doesn't overwrite a newer one.
+class SaveFileLock {
+public:
+	SaveFileLock(const std::string &name, Uint64 serial) :
+		m_file(GetSaveFile(name)),
+		m_lock(m_file.mutex),
+		m_serial(serial)
+	{
+	}
+
+	bool IsSuperseded() const { return m_file.written > m_serial; }
+	void SetWritten() { m_file.written = m_serial; }
+
+private:
+	struct SaveFile {
+		std::mutex mutex;
+		Uint64 written = 0;
+	};
+
+	static SaveFile &GetSaveFile(const std::string &name)
+	{
+		static std::mutex s_filesMutex;
+		static std::map<std::string, SaveFile> s_files;
+		std::lock_guard<std::mutex> lock(s_filesMutex);
+		return s_files[name];
+	}
+
+	SaveFile &m_file;
+	std::lock_guard<std::mutex> m_lock;
+	Uint64 m_serial;
+};
+
+static void RemoveDeltaFile(const std::string &name)
+{
+	try {
+		const std::string path = FileSystem::JoinPathBelow(s_saveDirName, name + s_deltaSuffix);
+		if (FileSystem::userFiles.Lookup(path).Exists())
+			FileSystem::userFiles.RemoveFile(path);
+	} catch (const std::invalid_argument &) {
+	}
+}
+
 // A simple job to load a savegame into a Json object
 class LoadGameToJsonJob : public Job
 {
@@ -39,6 +122,109 @@ private:
 	void(*m_callback)(std::string_view, const Json &);
 };
 
+// Writes out a snapshot of the game taken on the main thread
+class SaveGameJob : public Job
+{
+public:
+	SaveGameJob(std::string_view filename, Json &&rootNode, bool useLZ4, void(*callback)(std::string_view, SaveGameManager::SaveResult)) :
+		m_filename(filename), m_rootNode(std::move(rootNode)), m_serial(NextSaveSerial(m_filename)), m_useLZ4(useLZ4), m_callback(callback), m_result(SaveGameManager::SAVE_OK)
+	{
+	}
+
+	virtual void OnRun() {
+		SaveFileLock lock(m_filename, m_serial);
+		if (!lock.IsSuperseded()) {
+			try {
+				SaveGameManager::WriteSaveFile(m_filename, m_rootNode, m_useLZ4);
+				RemoveDeltaFile(m_filename);
+				lock.SetWritten();
+			} catch (const CouldNotOpenFileException &) {
+				m_result = SaveGameManager::SAVE_COULD_NOT_OPEN;
+			} catch (const CouldNotWriteToFileException &) {
+				m_result = SaveGameManager::SAVE_COULD_NOT_WRITE;
+			}
+		}
+		// the snapshot can be big, so don't keep it until OnFinish
+		m_rootNode = Json();
+	};
+	virtual void OnFinish() {
+		m_callback(m_filename, m_result);
+	};
+	virtual void OnCancel() {};
+private:
+	std::string m_filename;
+	Json m_rootNode;
+	Uint64 m_serial;
+	bool m_useLZ4;
+	void(*m_callback)(std::string_view, SaveGameManager::SaveResult);
+	SaveGameManager::SaveResult m_result;
+};
+
+
+// Writes out a snapshot of the game as a delta against the base of the
+// last delta save of the same name, or as a new base if there isn't one
+// or the delta has grown too big
+class SaveGameDeltaJob : public Job
+{
+public:
+	SaveGameDeltaJob(std::string_view filename, Json &&rootNode, SaveGameDelta::Base &&base, Uint64 newBaseId, bool useLZ4, void(*callback)(std::string_view, SaveGameManager::SaveResult)) :
+		m_filename(filename), m_rootNode(std::move(rootNode)), m_serial(NextSaveSerial(m_filename)), m_base(std::move(base)), m_newBaseId(newBaseId), m_useLZ4(useLZ4), m_callback(callback), m_result(SaveGameManager::SAVE_OK), m_written(false)
+	{
+	}
+
+	virtual void OnRun() {
+		SaveFileLock lock(m_filename, m_serial);
+		if (!lock.IsSuperseded()) {
+			try {
+				if (m_base.id == 0 || !WriteDelta()) {
+					PROFILE_SCOPED_DESC("write base");
+					m_base = SaveGameDelta::MakeBase(m_rootNode, m_newBaseId);
+					SaveGameManager::WriteSaveFile(m_filename, m_rootNode, m_useLZ4);
+					RemoveDeltaFile(m_filename);
+				}
+				lock.SetWritten();
+				m_written = true;
+			} catch (const CouldNotOpenFileException &) {
+				m_result = SaveGameManager::SAVE_COULD_NOT_OPEN;
+			} catch (const CouldNotWriteToFileException &) {
+				m_result = SaveGameManager::SAVE_COULD_NOT_WRITE;
+			}
+		}
+		if (!m_written)
+			m_base = SaveGameDelta::Base();
+		m_rootNode = Json();
+	};
+	virtual void OnFinish() {
+		// the next delta save builds on this one, unless a later save of
+		// the name has been started since
+		if (m_written && s_latestSaves[m_filename] == m_serial)
+			s_deltaBases[m_filename] = std::move(m_base);
+		m_callback(m_filename, m_result);
+	};
+	virtual void OnCancel() {};
+private:
+	bool WriteDelta() {
+		PROFILE_SCOPED()
+		size_t size;
+		Json chunks = SaveGameDelta::Diff(m_base, m_rootNode, size);
+		if (size > m_base.size / s_deltaCompactDivisor)
+			return false;
+		const Json deltaNode = SaveGameDelta::MakeDeltaFile(m_base, std::move(chunks));
+		SaveGameManager::WriteSaveFile(m_filename + s_deltaSuffix, deltaNode, m_useLZ4);
+		return true;
+	}
+
+	std::string m_filename;
+	Json m_rootNode;
+	Uint64 m_serial;
+	SaveGameDelta::Base m_base;
+	Uint64 m_newBaseId;
+	bool m_useLZ4;
+	void(*m_callback)(std::string_view, SaveGameManager::SaveResult);
+	SaveGameManager::SaveResult m_result;
+	bool m_written;
+};
+
 
 void SaveGameManager::Init()
 {
@@ -79,7 +265,23 @@ bool SaveGameManager::CanLoadGame(const std::string &name)
 
 Json SaveGameManager::LoadGameToJson(const std::string &filename)
 {
-	return JsonUtils::LoadJsonSaveFile(FileSystem::JoinPathBelow(s_saveDirName, filename), FileSystem::userFiles);
+	Json rootNode = JsonUtils::LoadJsonSaveFile(FileSystem::JoinPathBelow(s_saveDirName, filename), FileSystem::userFiles);
+	if (SaveGameDelta::GetBaseId(rootNode) == 0)
+		return rootNode;
+
+	const std::string deltaName = filename + s_deltaSuffix;
+	if (!CanLoadGame(deltaName))
+		return rootNode;
+
+	// a delta that can't be read loses the play since the base, but not the game
+	try {
+		const Json deltaNode = JsonUtils::LoadJsonSaveFile(FileSystem::JoinPathBelow(s_saveDirName, deltaName), FileSystem::userFiles);
+		if (!SaveGameDelta::Apply(rootNode, deltaNode))
+			Output("SaveGameManager: ignoring '%s', it was written for another save\n", deltaName.c_str());
+	} catch (const SavedGameCorruptException &) {
+		Warning("The delta save '%s' is damaged, loading '%s' as it was last saved in full\n", deltaName.c_str(), filename.c_str());
+	}
+	return rootNode;
 }
 
 Job *SaveGameManager::LoadGameToJsonAsync(std::string_view filename, void(*callback)(std::string_view, const Json &))
@@ -104,9 +306,13 @@ Game *SaveGameManager::LoadGame(const std::string &name)
 	}
 }
 
-void SaveGameManager::SaveGame(const std::string &name, Game *game)
+static bool UseLZ4()
+{
+	return Pi::config->Int("SaveGameLZ4") != 0;
+}
+
+static void CheckCanSave(const std::string &name, Game *game)
 {
-	PROFILE_SCOPED()
 	assert(game);
 
 	if (game->IsHyperspace()) {
@@ -120,40 +326,130 @@ void SaveGameManager::SaveGame(const std::string &name, Game *game)
 	if (!FileSystem::IsValidFilename(name)) {
 		throw std::invalid_argument(name);
 	}
+}
+
+void SaveGameManager::SaveGame(const std::string &name, Game *game)
+{
+	PROFILE_SCOPED()
+	CheckCanSave(name, game);
 
-	FILE *f = NULL;
-	try {
-		f = FileSystem::userFiles.OpenWriteStream(FileSystem::JoinPathBelow(s_saveDirName, name));
-	} catch (const std::invalid_argument &) {
-		throw CouldNotOpenFileException();
-	}
-	if (!f) {
-		throw CouldNotOpenFileException();
-	}
 	Json rootNode;
 	game->ToJson(rootNode); // Encode the game data as JSON and give to the root value.
+	SaveFileLock lock(name, NextSaveSerial(name));
+	WriteSaveFile(name, rootNode, UseLZ4());
+	lock.SetWritten();
+	s_deltaBases.erase(name);
+	RemoveDeltaFile(name);
+
+	Pi::GetApp()->RequestProfileFrame("SaveGame");
+}
+
+Job *SaveGameManager::SaveGameAsync(const std::string &name, Game *game, void(*callback)(std::string_view, SaveGameManager::SaveResult))
+{
+	PROFILE_SCOPED()
+	CheckCanSave(name, game);
+
+	Json rootNode;
+	game->ToJson(rootNode);
+	s_deltaBases.erase(name);
+	return new SaveGameJob(name, std::move(rootNode), UseLZ4(), callback);
+}
+
+Job *SaveGameManager::SaveGameDeltaAsync(const std::string &name, Game *game, void(*callback)(std::string_view, SaveGameManager::SaveResult))
+{
+	PROFILE_SCOPED()
+	CheckCanSave(name, game);
+
+	Json rootNode;
+	game->ToJson(rootNode);
+
+	SaveGameDelta::Base base;
+	auto it = s_deltaBases.find(name);
+	if (it != s_deltaBases.end()) {
+		base = std::move(it->second);
+		s_deltaBases.erase(it);
+	}
+
+	// only has to tell this base from the earlier ones of the same save
+	static Uint64 s_baseCount = 0;
+	const Uint64 newBaseId = Uint64(std::chrono::system_clock::now().time_since_epoch().count()) + ++s_baseCount;
+
+	return new SaveGameDeltaJob(name, std::move(rootNode), std::move(base), newBaseId, UseLZ4(), callback);
+}
+
+// Write the save out to an open file, closing it
+static void WriteSaveStream(FILE *f, const std::string &name, const Json &rootNode, bool useLZ4)
+{
+	if (useLZ4) {
+		// CBOR is compressed and written out as it's encoded, never
+		// existing in full
+		try {
+			PROFILE_SCOPED_DESC("json.to_cbor lz4");
+			lz4::CompressStreamBuf buf(f, s_lz4Preset);
+			std::ostream out(&buf);
+			Json::to_cbor(rootNode, out);
+			buf.Finish();
+		} catch (const lz4::CompressionFailedException &) {
+			fclose(f);
+			throw CouldNotWriteToFileException();
+		}
+		if (fclose(f) != 0) {
+			throw CouldNotWriteToFileException();
+		}
+		return;
+	}
+
 	std::vector<uint8_t> jsonData;
 	{
 		PROFILE_SCOPED_DESC("json.to_cbor");
 		jsonData = Json::to_cbor(rootNode); // Convert the JSON data to CBOR.
 	}
 
+	std::string comressed_data;
 	try {
 		// Compress the CBOR data.
-		const std::string comressed_data = gzip::CompressGZip(
+		comressed_data = gzip::CompressGZip(
 			std::string(reinterpret_cast<const char *>(jsonData.data()), jsonData.size()),
 			name + ".json");
-		size_t nwritten = fwrite(comressed_data.data(), comressed_data.size(), 1, f);
-		fclose(f);
-		if (nwritten != 1) {
-			throw CouldNotWriteToFileException();
-		}
 	} catch (gzip::CompressionFailedException) {
 		fclose(f);
 		throw CouldNotWriteToFileException();
 	}
 
-	Pi::GetApp()->RequestProfileFrame("SaveGame");
+	size_t nwritten = fwrite(comressed_data.data(), comressed_data.size(), 1, f);
+	if (fclose(f) != 0 || nwritten != 1) {
+		throw CouldNotWriteToFileException();
+	}
+}
+
+void SaveGameManager::WriteSaveFile(const std::string &name, const Json &rootNode, bool useLZ4)
+{
+	PROFILE_SCOPED()
+	std::string path;
+	try {
+		path = FileSystem::JoinPathBelow(s_saveDirName, name);
+	} catch (const std::invalid_argument &) {
+		throw CouldNotOpenFileException();
+	}
+
+	// only replaces the save once it has been written in full
+	const std::string tempPath = path + s_tempSuffix;
+	FILE *f = FileSystem::userFiles.OpenWriteStream(tempPath);
+	if (!f) {
+		throw CouldNotOpenFileException();
+	}
+
+	try {
+		WriteSaveStream(f, name, rootNode, useLZ4);
+	} catch (const CouldNotWriteToFileException &) {
+		FileSystem::userFiles.RemoveFile(tempPath);
+		throw;
+	}
+
+	if (!FileSystem::userFiles.RenameFile(tempPath, path)) {
+		FileSystem::userFiles.RemoveFile(tempPath);
+		throw CouldNotWriteToFileException();
+	}
 }
 
 
@@ -165,6 +461,8 @@ bool SaveGameManager::DeleteSave(const std::string &name)
 	} catch (const std::invalid_argument &) {
 		return false;
 	}
+	s_deltaBases.erase(name);
+	RemoveDeltaFile(name);
 	return FileSystem::userFiles.RemoveFile(filePath);
 }
 
@@ -177,6 +475,8 @@ std::vector<FileSystem::FileInfo> SaveGameManager::ListSaves()
 		// savegame file. But that would require actually loading the file,
 		// parsing it into a JSON object, and at the very least extracting the
 		// version number.
+		if (ends_with(fileInfo.GetName(), s_deltaSuffix) || ends_with(fileInfo.GetName(), s_tempSuffix))
+			continue; // part of the save it's named after, or one being written
 		saves.push_back(fileInfo);
 	}
 	return saves;
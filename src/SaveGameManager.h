@@ -15,6 +15,13 @@ class Job;
 
 class SaveGameManager {
 public:
+	// how a save written in the background went
+	enum SaveResult {
+		SAVE_OK,
+		SAVE_COULD_NOT_OPEN, // as CouldNotOpenFileException
+		SAVE_COULD_NOT_WRITE // as CouldNotWriteToFileException
+	};
+
 	static void Init();
 	static void Uninit();
 
@@ -68,10 +75,55 @@ public:
 	*/
 	static void SaveGame(const std::string &name, Game *game);
 
-	/** Delete a savegame file. */
+	/** Create a job which can be scheduled on a job queue to save the game.
+	 * The game is encoded as Json here, on the main thread, and the job then
+	 * does the CBOR encoding, compression and writing in the background, so
+	 * the game can carry on while the file is written.
+	 *
+	 * The \p callback is called in the main thread once the job has
+	 * completed, with whether the file was written. A job cancelled before
+	 * it starts leaves any existing file alone. Saves of the same name are
+	 * written one at a time, and a save finishing after a later one of the
+	 * same name has been written is dropped and reported as written.
+	 *
+	 * NOTE: This function will throw the same exceptions as SaveGame if the
+	 * game can't be saved at all.
+	 *
+	 * \param[in] name The name of the savegame to write.
+	 * \param[in] game The game to save.
+	 * \param[in] callback A callback to be called once the file has been written.
+	 * \return A newly-created Job which can be passed to a job queue.
+	 */
+	static Job *SaveGameAsync(const std::string &name, Game *game, void(*callback)(std::string_view, SaveResult));
+
+	/** As SaveGameAsync, but writing only what has changed.
+	 * The first delta save of a name in a session writes a full base save,
+	 * and later ones write a delta file beside it holding the parts of the
+	 * game that differ from that base (see SaveGameDelta.h), which is
+	 * applied when the save is loaded. When the delta grows to a good part
+	 * of the size of the base, a new base is written in its place.
+	 *
+	 * This is meant for frequent autosaves, where most of the game - the
+	 * explored systems, most of the Lua modules - is as it was the last time.
+	 * A full save of the same name discards the delta.
+	 */
+	static Job *SaveGameDeltaAsync(const std::string &name, Game *game, void(*callback)(std::string_view, SaveResult));
+
+	/** Write a game already encoded as Json to the named save.
+	 * This is the part of saving that doesn't touch the game, and is safe to
+	 * call from a job. With \p useLZ4 the file is a LZ4 frame streamed out
+	 * as it's encoded, otherwise it is gzip compressed. The file is written
+	 * beside the save and renamed over it once complete, so a save that fails
+	 * part-way leaves the previous one as it was.
+	 * NOTE: This function will throw CouldNotOpenFileException or
+	 * CouldNotWriteToFileException if the file can't be written.
+	 */
+	static void WriteSaveFile(const std::string &name, const Json &rootNode, bool useLZ4);
+
+	/** Delete a savegame file, and its delta if it has one. */
 	static bool DeleteSave(const std::string &name);
 
-	/** Return a  list of saved games. */
+	/** Return a  list of saved games. Delta files aren't listed. */
 	static std::vector<FileSystem::FileInfo> ListSaves();
 };
 
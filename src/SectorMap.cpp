@@ -11,6 +11,7 @@
 #include "pigui/PiGuiRenderer.h"
 #include "galaxy/Sector.h"
 #include "galaxy/Galaxy.h"
+#include "galaxy/GalaxyDensityVolume.h"
 #include "GameConfig.h"
 #include "graphics/Material.h"
 #include "graphics/RenderState.h"
@@ -21,6 +22,7 @@
 #include "pigui/PiGui.h"
 
 #include <float.h>
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <sstream>
@@ -33,6 +35,12 @@ static const int DRAW_RAD = 5;
 static const float FAR_THRESHOLD = 7.5f;
 static const float FAR_LIMIT = 36.f;
 static const float FAR_MAX = 46.f;
+// sectors across the finest blocks of the galaxy density splats
+static const int DENSITY_BLOCK_SECTORS = 4;
+// a little more than the number of sectors within the largest far star radius
+static const size_t SECTOR_CACHE_CAPACITY = 16384;
+// size of the label declutter grid cells, in multiples of the label font size
+static const float LABEL_CELL_SCALE = 1.5f;
 
 class SectorMap::Label {
 public:
@@ -42,6 +50,8 @@ public:
 	virtual bool Hovered(const ImVec2 &p) = 0;
 	virtual void Draw(ImDrawList &dl, bool hovered = false) = 0;
 	virtual void OnClick() = 0;
+	// whether the label can be left out when it's crowded by nearer labels
+	virtual bool CanDeclutter() const { return false; }
 	ImVec2 GetPos() { return ImVec2{ pos.x, pos.y }; }
 	float Depth() const { return pos.z; }
 	Label(Labels &host, const vector3f &pos, ImU32 color) :
@@ -158,6 +168,8 @@ public:
 		host.map.OnClickLabel(path);
 	}
 
+	bool CanDeclutter() const override { return true; }
+
 	static void InitFonts(Labels &host, ImDrawList &dl)
 	{
 		ImFont *&font = host.starLabelFont;
@@ -522,6 +534,8 @@ void SectorMap::InitDefaults()
 	m_cacheYMax = 0;
 
 	m_sectorCache = m_context.galaxy->NewSectorSlaveCache();
+	m_sectorCache->SetCapacity(SECTOR_CACHE_CAPACITY);
+	m_farSectorsArrived = false;
 	InputBindings.RegisterBindings();
 	m_size.x = m_context.renderer->GetWindowWidth();
 	m_size.y = m_context.renderer->GetWindowHeight();
@@ -554,6 +568,16 @@ void SectorMap::InitObject()
 	m_lineMat.Reset(m_context.renderer->CreateMaterial("vtxColor", lineDesc, rsd));
 
 	m_drawList.reset(new ImDrawList(ImGui::GetDrawListSharedData()));
+
+	// outside the density map the galaxy is empty
+	const Galaxy *galaxy = m_context.galaxy.Get();
+	auto density = [galaxy](int sx, int sy, int sz) {
+		if (std::abs(sx * Sector::SIZE + galaxy->SOL_OFFSET_X) >= galaxy->GALAXY_RADIUS ||
+			std::abs(sy * Sector::SIZE - galaxy->SOL_OFFSET_Y) >= galaxy->GALAXY_RADIUS)
+			return 0.f;
+		return float(galaxy->GetSectorDensity(sx, sy, sz));
+	};
+	m_densityVolume.reset(new GalaxyDensityVolume(density, DENSITY_BLOCK_SECTORS, NUM_DENSITY_LEVELS));
 }
 
 SectorMap::~SectorMap() {}
@@ -727,9 +751,50 @@ void SectorMap::SetLabelParams(std::string fontName, int fontSize, float gap, Co
 	m_labels.shadeColor = IM_COL32(shade.r, shade.g, shade.b, shade.a);
 }
 
+void SectorMap::DeclutterLabels()
+{
+	PROFILE_SCOPED()
+	const float cellSize = std::max(m_labels.fontSize * LABEL_CELL_SCALE, 1.f);
+	const int cols = std::max(int(m_size.x / cellSize), 0) + 1;
+	const int rows = std::max(int(m_size.y / cellSize), 0) + 1;
+
+	std::vector<std::unique_ptr<Label>> &labels = m_labels.array;
+	const size_t NOT_FOUND = labels.size();
+	m_labelCells.assign(cols * rows, NOT_FOUND);
+
+	// nearer labels win their cell; labels off the screen share the edge cells
+	for (size_t i = 0; i < labels.size(); ++i) {
+		Label &label = *labels[i];
+		if (!label.CanDeclutter())
+			continue;
+
+		const ImVec2 pos = label.GetPos();
+		const int col = Clamp(int(pos.x / cellSize), 0, cols - 1);
+		const int row = Clamp(int(pos.y / cellSize), 0, rows - 1);
+		size_t &cell = m_labelCells[row * cols + col];
+		if (cell == NOT_FOUND || label.Depth() < labels[cell]->Depth())
+			cell = i;
+	}
+
+	std::vector<bool> keep(labels.size(), false);
+	for (size_t cell : m_labelCells) {
+		if (cell != NOT_FOUND)
+			keep[cell] = true;
+	}
+
+	size_t numKept = 0;
+	for (size_t i = 0; i < labels.size(); ++i) {
+		if (keep[i] || !labels[i]->CanDeclutter())
+			labels[numKept++] = std::move(labels[i]);
+	}
+	labels.resize(numKept);
+}
+
 // function should run inside imgui context
 void SectorMap::DrawLabelsInternal(bool interactive, const ImVec2 &imagePos)
 {
+	DeclutterLabels();
+
 	// sort the labels to draw them starting from the farthest
 	std::sort(m_labels.array.begin(), m_labels.array.end(), [](const std::unique_ptr<Label> &a, const std::unique_ptr<Label> &b) {
 		return a->Depth() > b->Depth();
@@ -854,7 +919,7 @@ void SectorMap::PutFactionLabels(const vector3f &origin)
 {
 	PROFILE_SCOPED()
 	for (auto it = m_visibleFactions.begin(); it != m_visibleFactions.end(); ++it) {
-		if ((*it)->hasHomeworld && m_hiddenFactions.find((*it)) == m_hiddenFactions.end()) {
+		if ((*it)->hasHomeworld && !m_hiddenFactionMask.Test((*it)->idx)) {
 			Sector::System sys = GetCached((*it)->homeworld)->m_systems[(*it)->homeworld.systemIndex];
 			if ((m_pos * Sector::SIZE - sys.GetFullPosition()).Length() > (m_zoomClamped / FAR_THRESHOLD) * OUTER_RADIUS) continue;
 
@@ -910,7 +975,7 @@ void SectorMap::ClearLineVerts()
 void SectorMap::DrawNearSectors(const matrix4x4f &modelview)
 {
 	PROFILE_SCOPED()
-	m_visibleFactions.clear();
+	m_visibleFactionMask.Clear();
 
 	for (int sx = -DRAW_RAD; sx <= DRAW_RAD; sx++) {
 		for (int sy = -DRAW_RAD; sy <= DRAW_RAD; sy++) {
@@ -920,6 +985,8 @@ void SectorMap::DrawNearSectors(const matrix4x4f &modelview)
 			}
 		}
 	}
+
+	SetVisibleFactions(m_visibleFactionMask);
 }
 
 void SectorMap::DrawNearSector(const int sx, const int sy, const int sz, const matrix4x4f &trans)
@@ -954,6 +1021,9 @@ void SectorMap::DrawNearSector(const int sx, const int sy, const int sz, const m
 		m_secLineVerts->Add(vts[0], darkgreen);
 	}
 
+	// only test the systems against the hidden factions if the sector has any
+	const bool hasHiddenFaction = ps->GetFactionMask().Intersects(m_hiddenFactionMask);
+
 	const size_t numLineVerts = ps->m_systems.size() * 8;
 	m_lineVerts->position.reserve(numLineVerts);
 	m_lineVerts->diffuse.reserve(numLineVerts);
@@ -973,8 +1043,9 @@ void SectorMap::DrawNearSector(const int sx, const int sy, const int sz, const m
 
 		// if the system belongs to a faction we've chosen to temporarily hide
 		// then skip it if we can
-		m_visibleFactions.insert(i->GetFaction());
-		if (can_skip && m_hiddenFactions.find(i->GetFaction()) != m_hiddenFactions.end()) continue;
+		const Uint32 factionIdx = i->GetFaction()->idx;
+		m_visibleFactionMask.Set(factionIdx);
+		if (can_skip && hasHiddenFaction && m_hiddenFactionMask.Test(factionIdx)) continue;
 
 		// don't worry about looking for inhabited systems if they're
 		// unexplored (same calculation as in StarSystem.cpp) or we've
@@ -990,7 +1061,7 @@ void SectorMap::DrawNearSector(const int sx, const int sy, const int sz, const m
 			// Ideally, since this takes so f'ing long, it wants to be done as a threaded job but haven't written that yet.
 			if ((diff.x < 0.001f && diff.y < 0.001f && diff.z < 0.001f)) {
 				SystemPath current = SystemPath(sx, sy, sz, sysIdx);
-				RefCountedPtr<StarSystem> pSS = m_context.galaxy->GetStarSystem(current);
+				RefCountedPtr<StarSystem> pSS = m_context.galaxy->GetStarSystemSummary(current);
 				i->SetPopulation(pSS->GetTotalPop());
 			}
 		}
@@ -1038,6 +1109,15 @@ void SectorMap::DrawNearSector(const int sx, const int sy, const int sz, const m
 	}
 }
 
+static bool same_rotation(const matrix4x4f &a, const matrix4x4f &b)
+{
+	for (int col = 0; col < 3; col++)
+		for (int row = 0; row < 3; row++)
+			if (a[col * 4 + row] != b[col * 4 + row])
+				return false;
+	return true;
+}
+
 void SectorMap::DrawFarSectors(const matrix4x4f &modelview)
 {
 	PROFILE_SCOPED()
@@ -1046,32 +1126,72 @@ void SectorMap::DrawFarSectors(const matrix4x4f &modelview)
 
 	const vector3f secOrigin = vector3f(int(floorf(m_pos.x)), int(floorf(m_pos.y)), int(floorf(m_pos.z)));
 
+	// stream in the sectors around the view, nearest first, rather than
+	// generating them all here when the view moves into a new sector
+	const bool moved = buildRadius != m_radiusFar || !secOrigin.ExactlyEqual(m_secPosFar);
+	if (moved) {
+		m_sectorCache->Prefetch(SystemPath(secOrigin.x, secOrigin.y, secOrigin.z), buildRadius,
+			[this]() { m_farSectorsArrived = true; });
+	}
+
 	// build vertex and colour arrays for all the stars we want to see, if we don't already have them
-	if (m_toggledFaction || buildRadius != m_radiusFar || !secOrigin.ExactlyEqual(m_secPosFar)) {
-		m_farstars.clear();
-		m_farstarsColor.clear();
-		m_visibleFactions.clear();
+	if (moved || m_farSectorsArrived) {
+		m_farstarsAll.clear();
+		m_farstarsAllColor.clear();
+		m_farstarsAllFaction.clear();
+		m_farFactionMask.Clear();
 
 		for (int sx = secOrigin.x - buildRadius; sx <= secOrigin.x + buildRadius; sx++) {
 			for (int sy = secOrigin.y - buildRadius; sy <= secOrigin.y + buildRadius; sy++) {
 				for (int sz = secOrigin.z - buildRadius; sz <= secOrigin.z + buildRadius; sz++) {
 					if ((vector3f(sx, sy, sz) - secOrigin).Length() <= buildRadius) {
-						BuildFarSector(GetCached(SystemPath(sx, sy, sz)), Sector::SIZE * secOrigin, m_farstars, m_farstarsColor);
+						const Sector *sec = m_sectorCache->Peek(SystemPath(sx, sy, sz));
+						if (sec)
+							BuildFarSector(sec, Sector::SIZE * secOrigin);
 					}
 				}
 			}
 		}
 
+		if (moved)
+			BuildDensitySplats(Sector::SIZE * secOrigin);
+
 		m_secPosFar = secOrigin;
 		m_radiusFar = buildRadius;
+		m_farSectorsArrived = false;
+		m_toggledFaction = true;
+	}
+
+	if (m_toggledFaction) {
+		FilterFarStars();
 		m_toggledFaction = false;
+		m_farstarsChanged = true;
+	}
+
+	// TODO: this should query screen DPI instead of platform window height
+	const float sizeFactor = 0.25f * (m_context.renderer->GetWindowHeight() / 720.f);
+	// panning the view only changes the translation, which the quads don't depend on
+	const bool updateQuads = m_farstarsChanged || sizeFactor != m_farstarsSize || !same_rotation(modelview, m_farstarsView);
+	m_farstarsView = modelview;
+	m_farstarsSize = sizeFactor;
+	m_farstarsChanged = false;
+
+	// the density splats are drawn first, behind the stars
+	for (int level = 0; level < NUM_DENSITY_LEVELS; level++) {
+		if (m_densityPos[level].empty())
+			continue;
+		if (updateQuads) {
+			// blocks overlap a little, so the splats blend into a haze
+			const float splatSize = 1.5f * m_densityVolume->GetBlockSectors(level) * Sector::SIZE;
+			m_densityPoints[level].SetData(m_context.renderer, m_densityPos[level].size(), &m_densityPos[level][0], &m_densityColor[level][0], modelview, splatSize);
+		}
+		m_densityPoints[level].Draw(m_context.renderer, m_farStarsMat.Get());
 	}
 
 	// always draw the stars, slightly altering their size for different different resolutions, so they still look okay
 	if (m_farstars.size() > 0) {
-		// TODO: this should query screen DPI instead of platform window height
-		float sizeFactor = 0.25f * (m_context.renderer->GetWindowHeight() / 720.f);
-		m_farstarsPoints.SetData(m_context.renderer, m_farstars.size(), &m_farstars[0], &m_farstarsColor[0], modelview, sizeFactor);
+		if (updateQuads)
+			m_farstarsPoints.SetData(m_context.renderer, m_farstars.size(), &m_farstars[0], &m_farstarsColor[0], modelview, sizeFactor);
 		m_farstarsPoints.Draw(m_context.renderer, m_farStarsMat.Get());
 	}
 
@@ -1079,32 +1199,94 @@ void SectorMap::DrawFarSectors(const matrix4x4f &modelview)
 	PutFactionLabels(Sector::SIZE * secOrigin);
 }
 
-void SectorMap::BuildFarSector(RefCountedPtr<Sector> sec, const vector3f &origin, std::vector<vector3f> &points, std::vector<Color> &colors)
+void SectorMap::BuildDensitySplats(const vector3f &origin)
+{
+	PROFILE_SCOPED()
+	// the far stars reach out this far, in light years
+	const float starRadius = (m_zoomClamped / FAR_THRESHOLD) * OUTER_RADIUS;
+	// fade the haze in as the view zooms out, and at the edge of the real stars
+	const float zoomFade = Clamp((m_zoomClamped - FAR_THRESHOLD) / FAR_THRESHOLD, 0.f, 1.f);
+	const float edgeFade = 0.25f * starRadius;
+	const vector3f centre = m_pos * Sector::SIZE;
+
+	std::vector<GalaxyDensityVolume::Block> blocks;
+	for (int level = 0; level < NUM_DENSITY_LEVELS; level++) {
+		m_densityPos[level].clear();
+		m_densityColor[level].clear();
+		if (zoomFade <= 0.f)
+			continue;
+
+		// each level covers a shell twice as deep as the one inside it
+		const float minRadius = starRadius * float(1 << level);
+		const float maxRadius = starRadius * float(2 << level);
+
+		blocks.clear();
+		m_densityVolume->GetBlocks(level, m_pos, minRadius / Sector::SIZE, maxRadius / Sector::SIZE, blocks);
+		for (const GalaxyDensityVolume::Block &block : blocks) {
+			const vector3f pos = block.centre * Sector::SIZE;
+			const float fade = zoomFade * Clamp(((pos - centre).Length() - starRadius) / edgeFade, 0.f, 1.f);
+			const Uint8 alpha = Uint8(std::min(block.density * fade * 0.5f, 255.f));
+			if (alpha == 0)
+				continue;
+
+			m_densityPos[level].push_back(pos - origin);
+			m_densityColor[level].push_back({ 180, 170, 220, alpha });
+		}
+	}
+}
+
+void SectorMap::BuildFarSector(const Sector *sec, const vector3f &origin)
 {
 	PROFILE_SCOPED()
 	Color starColor;
-	for (std::vector<Sector::System>::iterator i = sec->m_systems.begin(); i != sec->m_systems.end(); ++i) {
+	for (std::vector<Sector::System>::const_iterator i = sec->m_systems.begin(); i != sec->m_systems.end(); ++i) {
 		// skip the system if it doesn't fall within the sphere we're viewing.
 		if ((m_pos * Sector::SIZE - (*i).GetFullPosition()).Length() > (m_zoomClamped / FAR_THRESHOLD) * OUTER_RADIUS) continue;
 
+		// add the system's position (origin must be m_pos's *sector* or we get judder)
+		m_farstarsAll.push_back((*i).GetFullPosition() - origin);
+
 		if (!i->IsExplored()) {
-			points.push_back((*i).GetFullPosition() - origin);
-			colors.push_back({ 100, 100, 100, 155 }); // flat gray for unexplored systems
+			m_farstarsAllColor.push_back({ 100, 100, 100, 155 }); // flat gray for unexplored systems
+			m_farstarsAllFaction.push_back(nullptr);
 			continue;
 		}
 
-		// if the system belongs to a faction we've chosen to hide also skip it, if it's not selectd in some way
-		m_visibleFactions.insert(i->GetFaction());
-		if (m_hiddenFactions.find(i->GetFaction()) != m_hiddenFactions.end()) continue;
-
-		// otherwise add the system's position (origin must be m_pos's *sector* or we get judder)
-		// and faction color to the list to draw
-		starColor = i->GetFaction()->colour;
+		// and its faction color, though FilterFarStars may hide it
+		const Faction *faction = i->GetFaction();
+		starColor = faction->colour;
 		starColor.a = 120;
 
-		points.push_back((*i).GetFullPosition() - origin);
-		colors.push_back(starColor);
+		m_farstarsAllColor.push_back(starColor);
+		m_farstarsAllFaction.push_back(faction);
+		m_farFactionMask.Set(faction->idx);
+	}
+}
+
+void SectorMap::FilterFarStars()
+{
+	PROFILE_SCOPED()
+	m_farstars.clear();
+	m_farstarsColor.clear();
+	for (size_t i = 0; i < m_farstarsAll.size(); i++) {
+		// skip the systems of the factions we've chosen to hide
+		const Faction *faction = m_farstarsAllFaction[i];
+		if (faction && m_hiddenFactionMask.Test(faction->idx)) continue;
+
+		m_farstars.push_back(m_farstarsAll[i]);
+		m_farstarsColor.push_back(m_farstarsAllColor[i]);
 	}
+
+	SetVisibleFactions(m_farFactionMask);
+}
+
+void SectorMap::SetVisibleFactions(const FactionMask &mask)
+{
+	const FactionsDatabase *factions = m_context.galaxy->GetFactions();
+	m_visibleFactions.clear();
+	mask.ForEach([&](Uint32 factionIdx) {
+		m_visibleFactions.insert(factions->GetFaction(factionIdx));
+	});
 }
 
 void SectorMap::Update(float frameTime)
@@ -1260,40 +1442,40 @@ double SectorMap::GetZoomLevel() const
 
 std::vector<SystemPath> SectorMap::GetNearbyStarSystemsByName(std::string pattern)
 {
-	std::vector<SystemPath> result;
-	for (auto i = m_sectorCache->Begin(); i != m_sectorCache->End(); ++i) {
-		for (unsigned int systemIndex = 0; systemIndex < (*i).second->m_systems.size(); systemIndex++) {
-			const Sector::System *ss = &((*i).second->m_systems[systemIndex]);
-
-			// compare with the start of the current system
-			if (strncasecmp(pattern.c_str(), ss->GetName().c_str(), pattern.size()) == 0
-				// look for the pattern term somewhere within the current system
-				|| pi_strcasestr(ss->GetName().c_str(), pattern.c_str())) {
-				SystemPath match((*i).first);
-				match.systemIndex = systemIndex;
-				result.push_back(match);
-			}
-			// now also check other names of this system, if there are any
-			for (const std::string &other_name : ss->GetOtherNames()) {
-				if (strncasecmp(pattern.c_str(), other_name.c_str(), pattern.size()) == 0
-					// look for the pattern term somewhere within the current system
-					|| pi_strcasestr(other_name.c_str(), pattern.c_str())) {
-					SystemPath match((*i).first);
-					match.systemIndex = systemIndex;
-					result.push_back(match);
-				}
-			}
-		}
+	PROFILE_SCOPED()
+	std::vector<SystemPath> matches;
+	m_context.galaxy->GetSystemNames().Find(pattern, matches);
+
+	// the index holds every cached sector, so keep those of the map's
+	// cache, nearest first
+	std::vector<std::pair<float, SystemPath>> ranked;
+	ranked.reserve(matches.size());
+	for (const SystemPath &path : matches) {
+		const Sector *sec = m_sectorCache->Peek(path);
+		if (!sec)
+			continue;
+		const vector3f pos = vector3f(float(path.sectorX), float(path.sectorY), float(path.sectorZ)) +
+			sec->m_systems[path.systemIndex].GetPosition() / Sector::SIZE;
+		ranked.emplace_back((pos - m_pos).LengthSqr(), path);
 	}
+	std::sort(ranked.begin(), ranked.end());
+
+	std::vector<SystemPath> result;
+	result.reserve(ranked.size());
+	for (const auto &match : ranked)
+		result.push_back(match.second);
 	return result;
 }
 
 void SectorMap::SetFactionVisible(const Faction *faction, bool visible)
 {
-	if (visible)
+	if (visible) {
 		m_hiddenFactions.erase(faction);
-	else
+		m_hiddenFactionMask.Reset(faction->idx);
+	} else {
 		m_hiddenFactions.insert(faction);
+		m_hiddenFactionMask.Set(faction->idx);
+	}
 	m_toggledFaction = true;
 }
 
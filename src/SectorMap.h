@@ -16,6 +16,8 @@
 #include "imgui/imgui_internal.h"
 #include "SectorMapContext.h"
 
+class GalaxyDensityVolume;
+
 namespace Graphics {
 	class RenderTarget;
 }
@@ -95,12 +97,19 @@ private:
 	void DrawNearSectors(const matrix4x4f &modelview);
 	void DrawNearSector(const int sx, const int sy, const int sz, const matrix4x4f &trans);
 	void DrawLabelsInternal(bool interactive, const ImVec2 &imagePos = { 0.0, 0.0 });
+	// keep only the nearest star label in each cell of a screen-space grid
+	void DeclutterLabels();
 	void PutSystemLabels(RefCountedPtr<Sector> sec, const vector3f &origin, int drawRadius);
 	void PutSystemLabel(const Sector::System &sys, bool shadow);
 
 	void DrawFarSectors(const matrix4x4f &modelview);
-	void BuildFarSector(RefCountedPtr<Sector> sec, const vector3f &origin, std::vector<vector3f> &points, std::vector<Color> &colors);
+	void BuildFarSector(const Sector *sec, const vector3f &origin);
+	// picks the far stars of the factions that aren't hidden
+	void FilterFarStars();
+	void SetVisibleFactions(const FactionMask &mask);
 	void PutFactionLabels(const vector3f &secPos);
+	// splats standing in for the galaxy beyond the far stars
+	void BuildDensitySplats(const vector3f &origin);
 
 	void OnClickLabel(const SystemPath &path);
 
@@ -133,6 +142,9 @@ private:
 
 	std::set<const Faction *> m_visibleFactions;
 	std::set<const Faction *> m_hiddenFactions;
+	// the same as bits, to test each star against
+	FactionMask m_visibleFactionMask;
+	FactionMask m_hiddenFactionMask;
 
 	Uint8 m_detailBoxVisible;
 
@@ -144,10 +156,23 @@ private:
 
 	std::vector<vector3f> m_farstars;
 	std::vector<Color> m_farstarsColor;
+	// every far star in range with its faction, or nullptr if unexplored, so
+	// hiding a faction filters these rather than walking the sectors again
+	std::vector<vector3f> m_farstarsAll;
+	std::vector<Color> m_farstarsAllColor;
+	std::vector<const Faction *> m_farstarsAllFaction;
+	FactionMask m_farFactionMask;
+	// the far star quads face the camera, and are only rebuilt when the stars,
+	// the view rotation or the star size change
+	matrix4x4f m_farstarsView;
+	float m_farstarsSize = 0.f;
+	bool m_farstarsChanged = true;
 
 	vector3f m_secPosFar;
 	int m_radiusFar;
 	bool m_toggledFaction;
+	// set when prefetched sectors arrive, so the far stars are rebuilt
+	bool m_farSectorsArrived;
 
 	int m_cacheXMin;
 	int m_cacheXMax;
@@ -177,6 +202,13 @@ private:
 	Graphics::Drawables::Lines m_sectorlines;
 	Graphics::Drawables::Points m_farstarsPoints;
 
+	// the density volume levels drawn beyond the far stars, nearest first
+	static const int NUM_DENSITY_LEVELS = 2;
+	std::unique_ptr<GalaxyDensityVolume> m_densityVolume;
+	std::vector<vector3f> m_densityPos[NUM_DENSITY_LEVELS];
+	std::vector<Color> m_densityColor[NUM_DENSITY_LEVELS];
+	Graphics::Drawables::Points m_densityPoints[NUM_DENSITY_LEVELS];
+
 	struct SphereParam {
 		matrix4x4f trans;
 		Color color;
@@ -210,6 +242,8 @@ private:
 	};
 	Labels m_labels;
 	bool m_hideLabels = false;
+	// index of the label kept in each declutter grid cell
+	std::vector<size_t> m_labelCells;
 };
 
 #endif /* _SECTORMAP_H */
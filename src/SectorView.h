@@ -7,6 +7,7 @@
 #include "ConnectionTicket.h"
 #include "DeleteEmitter.h"
 #include "Input.h"
+#include "JobQueue.h"
 #include "JsonFwd.h"
 
 #include "galaxy/SystemPath.h"
@@ -29,6 +30,7 @@ public:
 	void Update() override;
 	// void ShowAll() override;
 	void Draw3D() override;
+	bool HasScene() override { return true; }
 
 	void DrawPiGui() override;
 
@@ -58,6 +60,11 @@ public:
 	void ClearRoute();
 	const std::vector<SystemPath>& GetRoute() const;
 	const std::string AutoRoute(const SystemPath &start, const SystemPath &target, std::vector<SystemPath> &outRoute) const;
+	// plans a route from the current to the selected system on the job queue,
+	// replacing the route when one is found
+	const std::string StartAutoRoute();
+	// "PENDING" while a route is being planned, otherwise the result of the last one
+	const std::string GetAutoRouteStatus() const;
 	void SetDrawRouteLines(bool value);
 
 	sigc::signal<void> onHyperspaceTargetChanged;
@@ -110,6 +117,8 @@ private:
 	std::unique_ptr<SectorMap> m_map;
 	std::vector<SystemPath> m_route;
 
+	Job::Handle m_autoRouteJob;
+	std::string m_autoRouteStatus;
 };
 
 #endif /* _SECTORVIEW_H */
@@ -10,9 +10,10 @@
 #include "Ship.h"
 #include "Space.h"
 
+#include <algorithm>
+
 Sensors::RadarContact::RadarContact() :
 	body(0),
-	trail(0),
 	distance(0.0),
 	iff(IFF_UNKNOWN),
 	fresh(true)
@@ -21,18 +22,15 @@ Sensors::RadarContact::RadarContact() :
 
 Sensors::RadarContact::RadarContact(Body *b) :
 	body(b),
-	trail(0),
 	distance(0.0),
 	iff(IFF_UNKNOWN),
 	fresh(true)
 {
 }
 
-Sensors::RadarContact::~RadarContact()
-{
-	body = 0;
-	delete trail;
-}
+Sensors::RadarContact::RadarContact(RadarContact &&) = default;
+Sensors::RadarContact &Sensors::RadarContact::operator=(RadarContact &&) = default;
+Sensors::RadarContact::~RadarContact() = default;
 
 Color Sensors::IFFColor(IFF iff)
 {
@@ -51,7 +49,8 @@ bool Sensors::ContactDistanceSort(const RadarContact &a, const RadarContact &b)
 	return a.distance < b.distance;
 }
 
-Sensors::Sensors(Ship *owner)
+Sensors::Sensors(Ship *owner) :
+	m_staticBodiesVersion(0)
 {
 	m_owner = owner;
 }
@@ -65,9 +64,16 @@ Body* Sensors::ChooseTarget(TargetingCriteria crit, const Body* oldTarget )
 		
 	const Body* currTarget = oldTarget;
 
-	m_radarContacts.sort(ContactDistanceSort);
+	// sort a list of pointers, the contacts themselves stay where the index expects them
+	std::vector<const RadarContact *> sorted;
+	sorted.reserve(m_radarContacts.size());
+	for (const RadarContact &contact : m_radarContacts)
+		sorted.push_back(&contact);
+	std::stable_sort(sorted.begin(), sorted.end(), [](const RadarContact *a, const RadarContact *b) {
+		return ContactDistanceSort(*a, *b);
+	});
 
-	for (auto it = m_radarContacts.begin(); it != m_radarContacts.end(); ++it) {
+	for (const RadarContact *it : sorted) {
 		//match object type
 		//match iff
 		if (it->body->IsType(ObjectType::SHIP)) {
@@ -115,70 +121,99 @@ void Sensors::Update(float time)
 	PROFILE_SCOPED();
 	if (m_owner != Pi::player) return;
 
-	PopulateStaticContacts(); //no need to do all the time
+	Space *space = Pi::game->GetSpace();
+
+	// only gather the static contacts again when bodies came or went
+	if (space->GetBodiesVersion() != m_staticBodiesVersion) {
+		PopulateStaticContacts();
+		m_staticBodiesVersion = space->GetBodiesVersion();
+	}
 
 	//Find nearby contacts, same range as radar scanner. It should use these
-	//contacts, worldview labels too.
-	Space::BodyNearList nearby = Pi::game->GetSpace()->GetBodiesMaybeNear(m_owner, 100000.0f);
+	//contacts, worldview labels too. The candidates come from the space's
+	//spatial index, so this doesn't depend on the number of bodies in space.
+	Space::BodyNearList nearby = space->GetBodiesMaybeNear(m_owner, 100000.0f);
 	for (Body *body : nearby) {
 		if (body == m_owner || !body->IsType(ObjectType::SHIP)) continue;
 		if (body->IsDead()) continue;
 
-		auto cit = m_radarContacts.begin();
-		while (cit != m_radarContacts.end()) {
-			if (cit->body == body) break;
-			++cit;
+		auto cit = m_contactIndex.find(body);
+		if (cit != m_contactIndex.end()) {
+			m_radarContacts[cit->second].fresh = true;
+			continue;
 		}
 
-		//create new contact or refresh old
-		if (cit == m_radarContacts.end()) {
-			m_radarContacts.push_back(RadarContact());
-			RadarContact &rc = m_radarContacts.back();
-			rc.body = body;
-			rc.iff = CheckIFF(rc.body);
-			rc.trail = new HudTrail(rc.body, IFFColor(rc.iff));
-		} else {
-			cit->fresh = true;
-		}
+		//create new contact
+		m_contactIndex.emplace(body, uint32_t(m_radarContacts.size()));
+		RadarContact &rc = m_radarContacts.emplace_back(body);
+		rc.iff = CheckIFF(rc.body);
+		rc.trail.reset(new HudTrail(rc.body, IFFColor(rc.iff)));
 	}
 
 	//update contacts and delete stale ones
-	auto it = m_radarContacts.begin();
-	while (it != m_radarContacts.end()) {
-		if (!it->fresh) {
-			m_radarContacts.erase(it++);
+	uint32_t idx = 0;
+	while (idx < m_radarContacts.size()) {
+		RadarContact &rc = m_radarContacts[idx];
+		if (!rc.fresh) {
+			RemoveContact(idx);
+			continue;
+		}
+
+		const Ship *ship = rc.body->IsType(ObjectType::SHIP) ? static_cast<Ship *>(rc.body) : nullptr;
+		if (ship && Ship::FLYING == ship->GetFlightState()) {
+			rc.distance = m_owner->GetPositionRelTo(rc.body).Length();
+			SetContactIFF(rc, CheckIFF(rc.body));
+			rc.trail->Update(time);
 		} else {
-			const Ship *ship = it->body->IsType(ObjectType::SHIP) ? static_cast<Ship *>(it->body) : nullptr;
-			if (ship && Ship::FLYING == ship->GetFlightState()) {
-				it->distance = m_owner->GetPositionRelTo(it->body).Length();
-				it->iff = CheckIFF(it->body);
-				it->trail->SetColor(IFFColor(it->iff));
-				it->trail->Update(time);
-			} else {
-				it->trail->Reset(FrameId::Invalid);
-			}
-			it->fresh = false;
-			++it;
+			rc.trail->Reset(FrameId::Invalid);
 		}
+		rc.fresh = false;
+		++idx;
 	}
 }
 
+const Sensors::RadarContact *Sensors::FindContact(const Body *b) const
+{
+	auto it = m_contactIndex.find(b);
+	return it != m_contactIndex.end() ? &m_radarContacts[it->second] : nullptr;
+}
+
 void Sensors::UpdateIFF(Body *b)
 {
 	PROFILE_SCOPED();
-	for (auto it = m_radarContacts.begin(); it != m_radarContacts.end(); ++it) {
-		if (it->body == b) {
-			it->iff = CheckIFF(b);
-			it->trail->SetColor(IFFColor(it->iff));
-		}
-	}
+	auto it = m_contactIndex.find(b);
+	if (it != m_contactIndex.end())
+		SetContactIFF(m_radarContacts[it->second], CheckIFF(b));
 }
 
 void Sensors::ResetTrails()
 {
 	PROFILE_SCOPED();
-	for (auto it = m_radarContacts.begin(); it != m_radarContacts.end(); ++it)
-		it->trail->Reset(Pi::player->GetFrame());
+	for (RadarContact &rc : m_radarContacts)
+		rc.trail->Reset(Pi::player->GetFrame());
+}
+
+// Swap the last contact into the removed one's place, keeping the index up to date
+void Sensors::RemoveContact(uint32_t idx)
+{
+	m_contactIndex.erase(m_radarContacts[idx].body);
+
+	if (idx + 1 < m_radarContacts.size()) {
+		m_radarContacts[idx] = std::move(m_radarContacts.back());
+		m_contactIndex[m_radarContacts[idx].body] = idx;
+	}
+
+	m_radarContacts.pop_back();
+}
+
+// static
+void Sensors::SetContactIFF(RadarContact &rc, IFF iff)
+{
+	if (rc.iff == iff)
+		return;
+
+	rc.iff = iff;
+	rc.trail->SetColor(IFFColor(iff));
 }
 
 void Sensors::PopulateStaticContacts()
@@ -13,7 +13,9 @@
  */
 #include "Body.h"
 
-#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 class Body;
 class HudTrail;
@@ -36,15 +38,19 @@ public:
 	struct RadarContact {
 		RadarContact();
 		RadarContact(Body *);
+		RadarContact(RadarContact &&);
+		RadarContact &operator=(RadarContact &&);
 		~RadarContact();
 		Body *body;
-		HudTrail *trail;
+		std::unique_ptr<HudTrail> trail;
 		double distance;
 		IFF iff;
 		bool fresh;
 	};
 
-	typedef std::list<RadarContact> ContactList;
+	// A flat array, in no particular order; the body is the handle to a
+	// contact, see FindContact()
+	typedef std::vector<RadarContact> ContactList;
 
 	static Color IFFColor(IFF);
 	static bool ContactDistanceSort(const RadarContact &a, const RadarContact &b);
@@ -52,8 +58,10 @@ public:
 	Sensors(Ship *owner);
 	Body* ChooseTarget(TargetingCriteria, const Body* oldTarget);
 	IFF CheckIFF(Body *other);
-	const ContactList &GetContacts() { return m_radarContacts; }
-	const ContactList &GetStaticContacts() { return m_staticContacts; }
+	const ContactList &GetContacts() const { return m_radarContacts; }
+	const ContactList &GetStaticContacts() const { return m_staticContacts; }
+	// Returns nullptr if the body isn't a contact
+	const RadarContact *FindContact(const Body *) const;
 	void Update(float time);
 	void UpdateIFF(Body *);
 	void ResetTrails();
@@ -63,7 +71,14 @@ private:
 	ContactList m_radarContacts;
 	ContactList m_staticContacts; //things we know of regardless of range
 
+	// position of each body's contact in m_radarContacts
+	std::unordered_map<const Body *, uint32_t> m_contactIndex;
+	// Space::GetBodiesVersion() when the static contacts were gathered
+	uint32_t m_staticBodiesVersion;
+
 	void PopulateStaticContacts();
+	void RemoveContact(uint32_t idx);
+	static void SetContactIFF(RadarContact &, IFF);
 };
 
 #endif
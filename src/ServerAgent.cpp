@@ -13,6 +13,7 @@
 
 #include "ServerAgent.h"
 #include "StringF.h"
+#include "core/GZipFormat.h"
 #include <curl/curl.h>
 
 void NullServerAgent::Call(const std::string &method, const Json &data, SuccessCallback onSuccess, FailCallback onFail, void *userdata)
@@ -31,28 +32,35 @@ void NullServerAgent::ProcessResponses()
 
 bool HTTPServerAgent::s_initialised = false;
 
-HTTPServerAgent::HTTPServerAgent(const std::string &endpoint) :
-	m_endpoint(endpoint)
+HTTPServerAgent::HTTPServerAgent(const std::string &endpoint, bool compressRequests) :
+	m_endpoint(endpoint),
+	m_compressRequests(compressRequests),
+	m_wakeupPending(false),
+	m_quit(false)
 {
 	if (!s_initialised)
 		curl_global_init(CURL_GLOBAL_ALL);
 
-	m_curl = curl_easy_init();
-	//curl_easy_setopt(m_curl, CURLOPT_VERBOSE, 1);
-
-	curl_easy_setopt(m_curl, CURLOPT_POST, 1);
-
-	curl_easy_setopt(m_curl, CURLOPT_READFUNCTION, HTTPServerAgent::FillRequestBuffer);
-	curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, HTTPServerAgent::FillResponseBuffer);
-
-	m_curlHeaders = 0;
-	m_curlHeaders = curl_slist_append(m_curlHeaders, ("User-agent: " + UserAgent()).c_str());
-	m_curlHeaders = curl_slist_append(m_curlHeaders, "Content-type: application/json");
-	curl_easy_setopt(m_curl, CURLOPT_HTTPHEADER, m_curlHeaders);
+	m_curlMulti = curl_multi_init();
+	// one connection per concurrent request, all kept open for reuse
+	curl_multi_setopt(m_curlMulti, CURLMOPT_MAX_HOST_CONNECTIONS, long(MAX_CONCURRENT_REQUESTS));
+	curl_multi_setopt(m_curlMulti, CURLMOPT_MAXCONNECTS, long(MAX_CONCURRENT_REQUESTS));
+
+	m_connections.resize(MAX_CONCURRENT_REQUESTS);
+	for (Connection &conn : m_connections) {
+		conn.curl = curl_easy_init();
+		//curl_easy_setopt(conn.curl, CURLOPT_VERBOSE, 1);
+
+		curl_easy_setopt(conn.curl, CURLOPT_POST, 1);
+		curl_easy_setopt(conn.curl, CURLOPT_TCP_KEEPALIVE, 1L);
+		// accept any response encoding curl can decode
+		curl_easy_setopt(conn.curl, CURLOPT_ACCEPT_ENCODING, "");
+		curl_easy_setopt(conn.curl, CURLOPT_WRITEFUNCTION, HTTPServerAgent::FillResponseBuffer);
+		curl_easy_setopt(conn.curl, CURLOPT_PRIVATE, &conn);
+		conn.headers = 0;
+	}
 
 	m_requestQueueLock = SDL_CreateMutex();
-	m_requestQueueCond = SDL_CreateCond();
-
 	m_responseQueueLock = SDL_CreateMutex();
 
 	m_thread = SDL_CreateThread(&HTTPServerAgent::ThreadEntry, "HTTPServerAgent", this);
@@ -60,61 +68,57 @@ HTTPServerAgent::HTTPServerAgent(const std::string &endpoint) :
 
 HTTPServerAgent::~HTTPServerAgent()
 {
-	// flush the queue
+	// drop the queue and tell the thread to exit
 	SDL_LockMutex(m_requestQueueLock);
 	while (m_requestQueue.size() > 0)
 		m_requestQueue.pop();
+	m_quit = true;
 	SDL_UnlockMutex(m_requestQueueLock);
 
-	// signal the thread. empty queue will cause it to exit
-	SDL_CondBroadcast(m_requestQueueCond);
+	curl_multi_wakeup(m_curlMulti);
+	SDL_WaitThread(m_thread, 0);
 
-	// first thing the queue does is check the queue, so we must
-	// not shut down until its done that. it will release the queue
-	// lock before it dies, so try to take it
-	SDL_LockMutex(m_requestQueueLock);
+	// abandon whatever is still in flight
+	for (Connection &conn : m_connections) {
+		if (conn.response)
+			curl_multi_remove_handle(m_curlMulti, conn.curl);
+		curl_easy_cleanup(conn.curl);
+		curl_slist_free_all(conn.headers);
+	}
+	curl_multi_cleanup(m_curlMulti);
 
-	// we have the lock, so we know the thread won't doing anything
-	// else. we can clean up now
 	SDL_DestroyMutex(m_responseQueueLock);
 	SDL_DestroyMutex(m_requestQueueLock);
-	SDL_DestroyCond(m_requestQueueCond);
-
-	curl_slist_free_all(m_curlHeaders);
-
-	curl_easy_cleanup(m_curl);
 }
 
 void HTTPServerAgent::Call(const std::string &method, const Json &data, SuccessCallback onSuccess, FailCallback onFail, void *userdata)
 {
 	SDL_LockMutex(m_requestQueueLock);
 	m_requestQueue.push(Request(method, data, onSuccess, onFail, userdata));
+	// several calls made in a frame are picked up by one wakeup
+	const bool wakeup = !m_wakeupPending;
+	m_wakeupPending = true;
 	SDL_UnlockMutex(m_requestQueueLock);
 
-	SDL_CondBroadcast(m_requestQueueCond);
+	if (wakeup)
+		curl_multi_wakeup(m_curlMulti);
 }
 
 void HTTPServerAgent::ProcessResponses()
 {
-	std::queue<Response> responseQueue;
+	std::vector<Response> responseQueue;
 
-	// make a copy of the response queue so we can process
-	// the response at our leisure
+	// take the response queue so we can process
+	// the responses at our leisure
 	SDL_LockMutex(m_responseQueueLock);
-	responseQueue = m_responseQueue;
-	while (!m_responseQueue.empty())
-		m_responseQueue.pop();
+	responseQueue.swap(m_responseQueue);
 	SDL_UnlockMutex(m_responseQueueLock);
 
-	while (!responseQueue.empty()) {
-		Response &resp = responseQueue.front();
-
+	for (Response &resp : responseQueue) {
 		if (resp.success)
 			resp.onSuccess(resp.data, resp.userdata);
 		else
 			resp.onFail(resp.buffer, resp.userdata);
-
-		responseQueue.pop();
 	}
 }
 
@@ -126,77 +130,116 @@ int HTTPServerAgent::ThreadEntry(void *data)
 
 void HTTPServerAgent::ThreadMain()
 {
-	while (1) {
+	std::vector<Response> finished;
 
-		// look for requests
+	while (1) {
+		// start as many queued requests as there are idle connections
 		SDL_LockMutex(m_requestQueueLock);
 
-		// if there's no requests, wait until the main thread wakes us
-		if (m_requestQueue.empty())
-			SDL_CondWait(m_requestQueueCond, m_requestQueueLock);
-
-		// woken up but nothing on the queue means we're being destroyed
-		if (m_requestQueue.empty()) {
-			// main thread is waiting for this lock, and will start
-			// cleanup as soon as it has it
+		if (m_quit) {
 			SDL_UnlockMutex(m_requestQueueLock);
-
-			// might be cleaned up already, so don't do anything else,
-			// just get out of here
 			return;
 		}
 
-		// grab a request
-		Request req = m_requestQueue.front();
-		m_requestQueue.pop();
+		for (Connection &conn : m_connections) {
+			if (m_requestQueue.empty())
+				break;
+			if (conn.response)
+				continue;
+
+			StartRequest(conn, m_requestQueue.front());
+			m_requestQueue.pop();
+		}
+		m_wakeupPending = false;
 
-		// done with the queue
 		SDL_UnlockMutex(m_requestQueueLock);
 
-		Json::FastWriter writer;
-		req.buffer = writer.write(req.data);
+		int running;
+		curl_multi_perform(m_curlMulti, &running);
 
-		Response resp(req.onSuccess, req.onFail, req.userdata);
+		CURLMsg *msg;
+		int remaining;
+		while ((msg = curl_multi_info_read(m_curlMulti, &remaining))) {
+			if (msg->msg != CURLMSG_DONE)
+				continue;
 
-		curl_easy_setopt(m_curl, CURLOPT_URL, std::string(m_endpoint + "/" + req.method).c_str());
-		curl_easy_setopt(m_curl, CURLOPT_POSTFIELDSIZE, req.buffer.size());
-		curl_easy_setopt(m_curl, CURLOPT_READDATA, &req);
-		curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, &resp);
+			Connection *conn;
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, reinterpret_cast<char **>(&conn));
+			FinishRequest(*conn, msg->data.result);
 
-		CURLcode rc = curl_easy_perform(m_curl);
-		resp.success = rc == CURLE_OK;
-		if (!resp.success)
-			resp.buffer = std::string("call failed: " + std::string(curl_easy_strerror(rc)));
-
-		if (resp.success) {
-			uint32_t code;
-			curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &code);
-			if (code != 200) {
-				resp.success = false;
-				resp.buffer = stringf("call returned HTTP status: %0{d}", code);
-			}
+			finished.push_back(std::move(*conn->response));
+			conn->response.reset();
 		}
 
-		if (resp.success) {
-			Json::Reader reader;
-			resp.success = reader.parse(resp.buffer, resp.data, false);
-			if (!resp.success)
-				resp.buffer = std::string("JSON parse error: " + reader.getFormattedErrorMessages());
+		// hand over everything that finished together
+		if (!finished.empty()) {
+			SDL_LockMutex(m_responseQueueLock);
+			for (Response &resp : finished)
+				m_responseQueue.push_back(std::move(resp));
+			SDL_UnlockMutex(m_responseQueueLock);
+			finished.clear();
 		}
 
-		SDL_LockMutex(m_responseQueueLock);
-		m_responseQueue.push(resp);
-		SDL_UnlockMutex(m_responseQueueLock);
+		// sleep until there's network activity or Call wakes us
+		curl_multi_poll(m_curlMulti, 0, 0, 1000, 0);
 	}
 }
 
-size_t HTTPServerAgent::FillRequestBuffer(char *ptr, size_t size, size_t nmemb, void *userdata)
+void HTTPServerAgent::StartRequest(Connection &conn, const Request &req)
 {
-	HTTPServerAgent::Request *req = reinterpret_cast<HTTPServerAgent::Request *>(userdata);
-	size_t amount = std::max(size * nmemb, req->buffer.size());
-	memcpy(ptr, req->buffer.data(), amount);
-	req->buffer.erase(0, amount);
-	return amount;
+	conn.response.reset(new Response(req.onSuccess, req.onFail, req.userdata));
+	conn.url = m_endpoint + "/" + req.method;
+	conn.body = req.data.dump();
+
+	curl_slist_free_all(conn.headers);
+	conn.headers = 0;
+	conn.headers = curl_slist_append(conn.headers, ("User-agent: " + UserAgent()).c_str());
+	conn.headers = curl_slist_append(conn.headers, "Content-type: application/json");
+
+	if (m_compressRequests && conn.body.size() >= COMPRESS_MIN_SIZE) {
+		try {
+			conn.body = gzip::CompressGZip(conn.body, req.method + ".json");
+			conn.headers = curl_slist_append(conn.headers, "Content-encoding: gzip");
+		} catch (gzip::CompressionFailedException &) {
+			// send it as it is
+		}
+	}
+
+	// curl doesn't copy the body; it lives in the connection until the next request
+	curl_easy_setopt(conn.curl, CURLOPT_URL, conn.url.c_str());
+	curl_easy_setopt(conn.curl, CURLOPT_HTTPHEADER, conn.headers);
+	curl_easy_setopt(conn.curl, CURLOPT_POSTFIELDS, conn.body.data());
+	curl_easy_setopt(conn.curl, CURLOPT_POSTFIELDSIZE, long(conn.body.size()));
+	curl_easy_setopt(conn.curl, CURLOPT_WRITEDATA, conn.response.get());
+
+	curl_multi_add_handle(m_curlMulti, conn.curl);
+}
+
+void HTTPServerAgent::FinishRequest(Connection &conn, CURLcode rc)
+{
+	// the connection stays open in the multi handle's cache for the next request
+	curl_multi_remove_handle(m_curlMulti, conn.curl);
+
+	Response &resp = *conn.response;
+	resp.success = rc == CURLE_OK;
+	if (!resp.success)
+		resp.buffer = std::string("call failed: " + std::string(curl_easy_strerror(rc)));
+
+	if (resp.success) {
+		long code;
+		curl_easy_getinfo(conn.curl, CURLINFO_RESPONSE_CODE, &code);
+		if (code != 200) {
+			resp.success = false;
+			resp.buffer = stringf("call returned HTTP status: %0{d}", int(code));
+		}
+	}
+
+	if (resp.success) {
+		resp.data = Json::parse(resp.buffer, nullptr, false);
+		resp.success = !resp.data.is_discarded();
+		if (!resp.success)
+			resp.buffer = std::string("JSON parse error");
+	}
 }
 
 size_t HTTPServerAgent::FillResponseBuffer(char *ptr, size_t size, size_t nmemb, void *userdata)
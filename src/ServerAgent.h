@@ -5,11 +5,12 @@
 #ifndef SERVERAGENT_H
 #define SERVERAGENT_H
 
+#include "Json.h"
 #include "libs.h"
 #include <curl/curl.h>
-#include <json/json.h>
-#include <map>
+#include <memory>
 #include <queue>
+#include <vector>
 
 class ServerAgent {
 public:
@@ -47,9 +48,22 @@ private:
 	std::queue<Response> m_queue;
 };
 
+/*
+ * Sends calls to the server from a worker thread, several at a time over
+ * kept-alive connections, so a slow response doesn't hold up the calls
+ * behind it. Responses arrive in any order; their callbacks are still
+ * run from ProcessResponses on the main thread.
+ */
 class HTTPServerAgent : public ServerAgent {
 public:
-	HTTPServerAgent(const std::string &endpoint);
+	// the most calls that are in flight at once; the rest wait in the queue
+	static const int MAX_CONCURRENT_REQUESTS = 4;
+	// request bodies smaller than this aren't worth compressing
+	static const size_t COMPRESS_MIN_SIZE = 1024;
+
+	// compressRequests gzips request bodies, for servers that accept
+	// Content-Encoding: gzip
+	HTTPServerAgent(const std::string &endpoint, bool compressRequests = false);
 	virtual ~HTTPServerAgent();
 
 	virtual void Call(const std::string &method, const Json &data, SuccessCallback onSuccess = sigc::ptr_fun(&ServerAgent::IgnoreSuccessCallback), FailCallback onFail = sigc::ptr_fun(&ServerAgent::IgnoreFailCallback), void *userdata = 0);
@@ -65,10 +79,8 @@ private:
 			onFail(_onFail),
 			userdata(_userdata) {}
 
-		const std::string method;
-		const Json data;
-
-		std::string buffer;
+		std::string method;
+		Json data;
 
 		SuccessCallback onSuccess;
 		FailCallback onFail;
@@ -95,28 +107,45 @@ private:
 		void *userdata;
 	};
 
+	// an easy handle of the pool; its connection is kept open between
+	// requests and reused by the next one to the endpoint
+	struct Connection {
+		CURL *curl;
+		curl_slist *headers;
+		std::string url;
+		std::string body;
+		// set while a request is in flight
+		std::unique_ptr<Response> response;
+	};
+
 	static int ThreadEntry(void *data);
 	void ThreadMain();
 
+	void StartRequest(Connection &conn, const Request &req);
+	void FinishRequest(Connection &conn, CURLcode rc);
+
 	static const std::string &UserAgent();
 
-	static size_t FillRequestBuffer(char *ptr, size_t size, size_t nmemb, void *userdata);
 	static size_t FillResponseBuffer(char *ptr, size_t size, size_t nmemb, void *userdata);
 
 	static bool s_initialised;
 
 	const std::string m_endpoint;
+	const bool m_compressRequests;
 
 	SDL_Thread *m_thread;
 
-	CURL *m_curl;
-	curl_slist *m_curlHeaders;
+	CURLM *m_curlMulti;
+	std::vector<Connection> m_connections;
 
 	std::queue<Request> m_requestQueue;
 	SDL_mutex *m_requestQueueLock;
-	SDL_cond *m_requestQueueCond;
+	// the worker has been woken and not yet picked up the queue, so
+	// calls made in the meantime needn't wake it again
+	bool m_wakeupPending;
+	bool m_quit;
 
-	std::queue<Response> m_responseQueue;
+	std::vector<Response> m_responseQueue;
 	SDL_mutex *m_responseQueueLock;
 };
 
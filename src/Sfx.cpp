@@ -3,7 +3,9 @@
 
 #include "Sfx.h"
 
+#include "BinaryArchive.h"
 #include "Body.h"
+#include "Camera.h"
 #include "FileSystem.h"
 #include "Frame.h"
 #include "GameSaveError.h"
@@ -23,6 +25,8 @@
 #include "graphics/VertexArray.h"
 #include "matrix4x4.h"
 
+#include <algorithm>
+
 using namespace Graphics;
 
 namespace {
@@ -49,6 +53,11 @@ namespace {
 			return 0.f;
 		}
 	}
+
+	// shared by every frame and type; DrawBuffer copies the vertices out, so
+	// the array can be refilled straight away and keeps its storage between
+	// frames
+	static std::unique_ptr<Graphics::VertexArray> s_pointArray;
 } // namespace
 
 std::unique_ptr<Graphics::Material> SfxManager::damageParticle;
@@ -99,7 +108,6 @@ void Sfx::SetPosition(const vector3d &p)
 
 void Sfx::TimeStepUpdate(const float timeStep)
 {
-	PROFILE_SCOPED()
 	m_age += timeStep;
 	m_pos += m_vel * double(timeStep);
 
@@ -169,6 +177,54 @@ void SfxManager::FromJson(const Json &jsonObj, FrameId fId)
 	}
 }
 
+void SfxManager::ToArchive(BinaryArchiveWriter &ar, const FrameId fId)
+{
+	Frame *f = Frame::GetFrame(fId);
+
+	// as ToJson, only the live ones
+	std::vector<const Sfx *> live;
+	if (f->m_sfx) {
+		for (size_t t = TYPE_EXPLOSION; t < TYPE_NONE; t++) {
+			for (size_t i = 0; i < f->m_sfx->GetNumberInstances(SFX_TYPE(t)); i++) {
+				const Sfx &inst(f->m_sfx->GetInstanceByIndex(SFX_TYPE(t), i));
+				if (inst.m_type != TYPE_NONE)
+					live.push_back(&inst);
+			}
+		}
+	}
+
+	ar.UInt32(Uint32(live.size()));
+	for (const Sfx *inst : live) {
+		ar.Vector3d(inst->m_pos);
+		ar.Vector3d(inst->m_vel);
+		ar.Float(inst->m_age);
+		ar.Float(inst->m_speed);
+		ar.Int32(inst->m_type);
+	}
+}
+
+void SfxManager::FromArchive(BinaryArchiveReader &ar, FrameId fId)
+{
+	const Uint32 count = ar.UInt32();
+
+	Frame *f = Frame::GetFrame(fId);
+
+	if (count) f->m_sfx.reset(new SfxManager);
+	for (Uint32 i = 0; i < count; ++i) {
+		const vector3d pos = ar.Vector3d();
+		const vector3d vel = ar.Vector3d();
+		const float age = ar.Float();
+		const float speed = ar.Float();
+		const Sint32 type = ar.Int32();
+		if (type < TYPE_EXPLOSION || type >= TYPE_NONE)
+			throw SavedGameCorruptException();
+
+		Sfx inst(pos, vel, speed, SFX_TYPE(type));
+		inst.m_age = age;
+		f->m_sfx->AddInstance(inst);
+	}
+}
+
 SfxManager *SfxManager::AllocSfxInFrame(FrameId fId)
 {
 	Frame *f = Frame::GetFrame(fId);
@@ -241,24 +297,23 @@ void SfxManager::Cleanup()
 		if (!numInstances)
 			continue;
 
-		for (Sint64 i = Sint64(numInstances - 1); i >= 0; i--) {
-			Sfx &inst(GetInstanceByIndex(SFX_TYPE(t), i));
-			if (inst.m_type == TYPE_NONE) {
-				m_instances[t].erase(m_instances[t].begin() + i);
-			}
-		}
+		// a single compacting pass, rather than erasing from the middle of
+		// the deque once per expired particle
+		auto &instances = m_instances[t];
+		instances.erase(std::remove_if(instances.begin(), instances.end(),
+							[](const Sfx &inst) { return inst.m_type == TYPE_NONE; }),
+			instances.end());
 	}
 }
 
-void SfxManager::RenderAll(Renderer *renderer, FrameId fId, FrameId camFrameId)
+void SfxManager::RenderAll(Renderer *renderer, FrameId fId, const Camera *camera)
 {
 	Frame *f = Frame::GetFrame(fId);
 	int screenHeight = renderer->GetWindowHeight();
 
 	PROFILE_SCOPED()
 	if (f->m_sfx) {
-		matrix4x4d ftran;
-		Frame::GetFrameTransform(fId, camFrameId, ftran);
+		const matrix4x4d &ftran = camera->GetFrameViewTransform(fId);
 
 		for (size_t t = TYPE_EXPLOSION; t < TYPE_NONE; t++) {
 			const size_t numInstances = f->m_sfx->GetNumberInstances(SFX_TYPE(t));
@@ -280,7 +335,10 @@ void SfxManager::RenderAll(Renderer *renderer, FrameId fId, FrameId camFrameId)
 			}
 
 			// NB - we're (ab)using the normal type to hold (uv coordinate offset value + point size)
-			Graphics::VertexArray pointArray(Graphics::ATTRIB_POSITION | Graphics::ATTRIB_NORMAL, numInstances);
+			if (!s_pointArray)
+				s_pointArray.reset(new Graphics::VertexArray(Graphics::ATTRIB_POSITION | Graphics::ATTRIB_NORMAL));
+			Graphics::VertexArray &pointArray = *s_pointArray;
+			pointArray.Clear(numInstances);
 
 			for (size_t i = 0; i < numInstances; i++) {
 				Sfx &inst(f->m_sfx->GetInstanceByIndex(SFX_TYPE(t), i));
@@ -302,7 +360,7 @@ void SfxManager::RenderAll(Renderer *renderer, FrameId fId, FrameId camFrameId)
 	}
 
 	for (FrameId kid : f->GetChildren()) {
-		RenderAll(renderer, kid, camFrameId);
+		RenderAll(renderer, kid, camera);
 	}
 }
 
@@ -438,4 +496,5 @@ void SfxManager::Uninit()
 	ecmParticle.reset();
 	smokeParticle.reset();
 	explosionParticle.reset();
+	s_pointArray.reset();
 }
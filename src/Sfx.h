@@ -10,7 +10,10 @@
 
 #include <deque>
 
+class BinaryArchiveReader;
+class BinaryArchiveWriter;
 class Body;
+class Camera;
 class Frame;
 
 namespace Graphics {
@@ -52,9 +55,11 @@ public:
 	static void AddExplosion(Body *);
 	static void AddThrustSmoke(const Body *b, float speed, const vector3d &adjustpos);
 	static void TimeStepAll(const float timeStep, FrameId f);
-	static void RenderAll(Graphics::Renderer *r, FrameId f, const FrameId camFrame);
+	static void RenderAll(Graphics::Renderer *r, FrameId f, const Camera *camera);
 	static void ToJson(Json &jsonObj, const FrameId f);
 	static void FromJson(const Json &jsonObj, FrameId f);
+	static void ToArchive(BinaryArchiveWriter &ar, const FrameId f);
+	static void FromArchive(BinaryArchiveReader &ar, FrameId f);
 
 	//create shared models
 	static void Init(Graphics::Renderer *r);
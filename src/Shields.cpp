@@ -107,6 +107,9 @@ struct ShieldNodeAccumulator : SceneGraph::NodeVisitor {
 };
 
 Shields::Shields() :
+	m_uploadedNumHits(0),
+	m_uploadedStrength(-1.f),
+	m_uploadedCooldown(-1.f),
 	m_enabled(false)
 {
 	using namespace SceneGraph;
@@ -127,6 +130,13 @@ void Shields::ApplyModel(SceneGraph::Model *model)
 	Graphics::Material *globalShield = GetGlobalShieldMaterial().Get();
 	m_shieldMaterial.Reset(r->CloneMaterial(globalShield, globalShield->GetDescriptor(), r->GetMaterialRenderState(globalShield)));
 
+	m_shieldData.Reset(r->CreateUniformBuffer(sizeof(ShieldData), Graphics::BUFFER_USAGE_DYNAMIC));
+	m_shieldData->BufferData(ShieldData{});
+	m_shieldMaterial->SetBuffer(s_shieldDataName, m_shieldData->GetBufferBinding());
+	// upload the first state Update() sees
+	m_uploadedNumHits = 0;
+	m_uploadedStrength = -1.f;
+
 	// Find all static geometry nodes in the shield model
 	ShieldNodeAccumulator accum = {};
 	model->GetRoot()->Accept(accum);
@@ -153,6 +163,7 @@ void Shields::ClearModel()
 {
 	m_shields.clear();
 	m_shieldMaterial.Reset();
+	m_shieldData.Reset();
 }
 
 void Shields::SaveToJson(Json &jsonObj)
@@ -222,10 +233,14 @@ void Shields::Update(const float coolDown, const float shieldStrength)
 	}
 
 	// setup the render params
-	if (shieldStrength > 0.0f && m_shieldMaterial) {
+	// hits are animated, otherwise the data only changes with the strength
+	const Uint32 numHits = std::min(m_hits.size(), MAX_SHIELD_HITS);
+	const bool changed = numHits > 0 || m_uploadedNumHits > 0 ||
+		shieldStrength != m_uploadedStrength || coolDown != m_uploadedCooldown;
+
+	if (shieldStrength > 0.0f && m_shieldMaterial && changed) {
 		ShieldData renderData{};
 
-		Uint32 numHits = std::min(m_hits.size(), MAX_SHIELD_HITS);
 		for (Uint32 i = 0; i < numHits; ++i) {
 			const Hits &hit = m_hits[i];
 
@@ -242,8 +257,12 @@ void Shields::Update(const float coolDown, const float shieldStrength)
 		renderData.shieldStrength = shieldStrength;
 		renderData.shieldCooldown = coolDown;
 
-		m_shieldMaterial->SetBufferDynamic(s_shieldDataName, &renderData);
+		m_shieldData->BufferData(renderData);
 		m_shieldMaterial->SetPushConstant(s_numHitsName, int(numHits));
+
+		m_uploadedNumHits = numHits;
+		m_uploadedStrength = shieldStrength;
+		m_uploadedCooldown = coolDown;
 	}
 
 	// update the shield visibility
@@ -18,6 +18,7 @@
 namespace Graphics {
 	class Renderer;
 	class Material;
+	class UniformBuffer;
 }
 namespace SceneGraph {
 	class Model;
@@ -62,6 +63,12 @@ protected:
 	std::deque<Hits> m_hits;
 	std::vector<Shield> m_shields;
 	RefCountedPtr<Graphics::Material> m_shieldMaterial;
+	// the shield data of this model, only rewritten when it changes so
+	// that idle shields (e.g. ships parked in a station) cost no uploads
+	RefCountedPtr<Graphics::UniformBuffer> m_shieldData;
+	Uint32 m_uploadedNumHits;
+	float m_uploadedStrength;
+	float m_uploadedCooldown;
 
 	bool m_enabled;
 
@@ -15,6 +15,35 @@
 #include "perlin.h"
 #include "ship/Propulsion.h"
 
+// AI level of detail: ships further than this from the player decide at a
+// reduced rate, holding their last thruster outputs in between
+static const double AI_LOD_NEAR_DISTANCE = 25.0e3;
+static const double AI_LOD_FAR_DISTANCE = 500.0e3;
+static const float AI_LOD_NEAR_INTERVAL = 0.1f;
+static const float AI_LOD_FAR_INTERVAL = 0.25f;
+
+// returns the game time between AI decisions, or zero to decide every step
+float Ship::AIDecisionInterval() const
+{
+	if (this == Pi::player || !Pi::player || !m_curAICmd)
+		return 0.f;
+
+	// docking, combat and formation flying need every step, as does anything
+	// near a surface or station
+	if (m_flightState != FLYING || m_curAICmd->NeedsFullRate())
+		return 0.f;
+	if (Frame::GetFrame(GetFrame())->IsRotFrame())
+		return 0.f;
+
+	if (Pi::player->GetCombatTarget() == this || Pi::player->GetNavTarget() == this)
+		return 0.f;
+
+	const double dist = GetPositionRelTo(Pi::player).Length();
+	if (dist < AI_LOD_NEAR_DISTANCE)
+		return 0.f;
+	return dist < AI_LOD_FAR_DISTANCE ? AI_LOD_NEAR_INTERVAL : AI_LOD_FAR_INTERVAL;
+}
+
 // returns true if command is complete
 bool Ship::AITimeStep(float timeStep)
 {
@@ -22,6 +51,25 @@ bool Ship::AITimeStep(float timeStep)
 	// allow the launch thruster thing to happen
 	if (m_launchLockTimeout > 0.0) return false;
 
+	const float interval = AIDecisionInterval();
+	if (interval > 0.f) {
+		// stagger ships entering reduced rate so they don't all decide on the same step
+		if (!m_aiReducedRate) {
+			m_aiReducedRate = true;
+			m_aiTickDelay = interval * float((reinterpret_cast<uintptr_t>(this) / sizeof(Ship)) % 8) / 8.f;
+		}
+		// hold the last outputs until the next decision is due; once a
+		// single step covers the interval this runs every step anyway
+		if (m_aiTickDelay > 0.f) {
+			m_aiTickDelay -= timeStep;
+			return false;
+		}
+		m_aiTickDelay = std::max(0.f, m_aiTickDelay + interval);
+	} else {
+		m_aiReducedRate = false;
+		m_aiTickDelay = 0.f;
+	}
+
 	m_decelerating = false;
 	if (!m_curAICmd) {
 		if (this == Pi::player) return true;
@@ -49,6 +97,13 @@ void Ship::AIClearInstructions()
 	delete m_curAICmd; // rely on destructor to kill children
 	m_curAICmd = 0;
 	m_decelerating = false; // don't adjust unless AI is running
+	m_aiReducedRate = false; // a new command decides straight away
+	m_aiTickDelay = 0.f;
+}
+
+bool Ship::AIIsOnRails() const
+{
+	return m_curAICmd && m_curAICmd->IsOnRails();
 }
 
 void Ship::AIGetStatusText(char *str)
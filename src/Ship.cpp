@@ -15,6 +15,7 @@
 #include "Pi.h"
 #include "Planet.h"
 #include "Player.h" // <-- Here only for 1 occurrence of "Pi::player" in Ship::Explode
+#include "Replay.h"
 #include "Sensors.h"
 #include "Sfx.h"
 #include "Shields.h"
@@ -586,7 +587,7 @@ bool Ship::DoDamage(float kgDamage)
 		m_shieldCooldown = DEFAULT_SHIELD_COOLDOWN_TIME;
 		// create a collision location in the models local space and add it as a hit.
 		Random rnd;
-		rnd.seed(time(0));
+		rnd.seed(Replay::Seed(Uint32(time(0))));
 		const vector3d randPos(
 			rnd.Double() * 2.0 - 1.0,
 			rnd.Double() * 2.0 - 1.0,
@@ -1548,10 +1549,10 @@ void Ship::OnEnterSystem()
 
 void Ship::SetupShields()
 {
-	SceneGraph::Model *sm = Pi::FindModel(m_type->shieldName, false);
+	SceneGraph::Model *sm = Pi::MakeModelInstance(m_type->shieldName, false);
 
 	if (sm) {
-		m_shieldModel.reset(sm->MakeInstance());
+		m_shieldModel.reset(sm);
 		m_shields->ApplyModel(m_shieldModel.get());
 	} else {
 		m_shieldModel.reset();
@@ -184,6 +184,7 @@ public:
 
 	void AIClearInstructions(); // Note: defined in Ship-AI.cpp
 	bool AIIsActive() const { return m_curAICmd ? true : false; }
+	bool AIIsOnRails() const; // Note: defined in Ship-AI.cpp
 	void AIGetStatusText(char *str); // Note: defined in Ship-AI.cpp
 
 	void AIKamikaze(Body *target); // Note: defined in Ship-AI.cpp
@@ -249,6 +250,7 @@ protected:
 	virtual void SaveToJson(Json &jsonObj, Space *space) override;
 
 	bool AITimeStep(float timeStep); // Called by controller. Returns true if complete
+	float AIDecisionInterval() const; // Note: defined in Ship-AI.cpp
 
 	virtual void SetAlertState(AlertState as);
 
@@ -319,6 +321,10 @@ private:
 	HyperspaceCloud *m_hyperspaceCloud;
 
 	AICommand *m_curAICmd;
+	// AI level of detail: game time until the next decision, and whether
+	// the ship is currently running at a reduced rate
+	float m_aiTickDelay = 0.f;
+	bool m_aiReducedRate = false;
 
 	double m_landingMinOffset; // offset from the centre of the ship used during docking
 
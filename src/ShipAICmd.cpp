@@ -8,7 +8,9 @@
 #include "JsonUtils.h"
 #include "Pi.h"
 #include "Planet.h"
+#include "Player.h"
 #include "Ship.h"
+#include "ShipType.h"
 #include "Space.h"
 #include "SpaceStation.h"
 #include "perlin.h"
@@ -793,8 +795,9 @@ int CheckCollision(DynamicBody *dBody, const vector3d &pathdir, double pathdist,
 }
 
 // ok, need thing to step down through bodies and find closest approach
-// modify targpos directly to aim short of dangerous bodies
-static bool ParentSafetyAdjust(DynamicBody *dBody, FrameId targframeId, vector3d &targpos, vector3d &targvel)
+// returns the body of the outermost frame between the ship and the target,
+// which the ship should stop short of
+static Body *FindParentSafetyBody(DynamicBody *dBody, FrameId targframeId)
 {
 	Body *body = nullptr;
 	FrameId frameId = Frame::GetFrame(targframeId)->GetNonRotFrame();
@@ -815,22 +818,24 @@ static bool ParentSafetyAdjust(DynamicBody *dBody, FrameId targframeId, vector3d
 		frameId = parent->GetNonRotFrame();
 		frame = Frame::GetFrame(frameId); // check next frame down
 	}
-	if (!body) return false;
+	return body;
+}
 
+// modify targpos directly to aim short of the body found above, bodydist is
+// how far from its centre to stop
+static bool ParentSafetyAdjust(DynamicBody *dBody, Body *body, double bodydist, vector3d &targpos, vector3d &targvel)
+{
 	// aim for zero velocity at surface of that body
 	// still along path to target
-	Propulsion *prop = dBody->GetComponent<Propulsion>();
-	if (prop == nullptr) return false;
 	vector3d targpos2 = targpos - dBody->GetPosition();
 	double targdist = targpos2.Length();
-	double bodydist = body->GetPositionRelTo(dBody).Length() - MaxEffectRad(body, prop) * 1.5;
+	bodydist = body->GetPositionRelTo(dBody).Length() - bodydist;
 	if (targdist < bodydist) return false;
 	targpos -= (targdist - bodydist) * targpos2 / targdist;
 	targvel = body->GetVelocityRelTo(dBody->GetFrame());
 	return true;
 }
 
-
 // check for collision course with frame body
 //#define DEBUG_CHECK_SUICIDE
 static bool CheckSuicide(DynamicBody *dBody, const vector3d &obspos, double obsMass, double safeAlt, double targetAlt, bool recovering)
@@ -890,6 +895,117 @@ void AICmdFlyTo::OnDeleted(const Body *body)
 {
 	AICommand::OnDeleted(body);
 	if (m_target == body) m_target = 0;
+	if (m_obstacles.safetyBody == body) m_obstaclesValid = false;
+}
+
+// obstacles only move with their frames, so the frame walk and effect radii
+// are reused until the ship or target changes frame, or the ship has drifted
+// from where they were last found
+static const double OBSTACLE_DRIFT = 0.05;		   // fraction of the ship's distance from the frame centre
+static const double OBSTACLE_MIN_DRIFT = 1000.0;   // m
+static const double OBSTACLE_DIR_TOLERANCE = 0.996; // cosine, about 5 degrees
+
+void AICmdFlyTo::UpdateObstacles(FrameId targframeId, const vector3d &targpos)
+{
+	const vector3d pos = m_dBody->GetPosition();
+	const vector3d dir = (targpos - pos).NormalizedSafe();
+	if (m_obstaclesValid && m_obstacles.frameId == m_dBody->GetFrame() && m_obstacles.targframeId == targframeId) {
+		const double drift = std::max(OBSTACLE_MIN_DRIFT, OBSTACLE_DRIFT * m_obstacles.pos.Length());
+		if ((pos - m_obstacles.pos).LengthSqr() < drift * drift && dir.Dot(m_obstacles.dir) > OBSTACLE_DIR_TOLERANCE)
+			return;
+	}
+
+	m_obstacles.frameId = m_dBody->GetFrame();
+	m_obstacles.targframeId = targframeId;
+	m_obstacles.pos = pos;
+	m_obstacles.dir = dir;
+	m_obstacles.safetyBody = FindParentSafetyBody(m_dBody, targframeId);
+	m_obstacles.safetyDist = MaxEffectRad(m_obstacles.safetyBody, m_prop) * 1.5;
+	m_obstacles.frameRad = MaxEffectRad(Frame::GetFrame(m_obstacles.frameId)->GetBody(), m_prop);
+	m_obstaclesValid = true;
+}
+
+// On-rails cruise: at high time acceleration NPCs far from the player follow
+// PrecalcPath's closed-form accelerate/coast/decelerate profile instead of
+// integrating thrust, and are handed back to the AI near the target, on a
+// frame change or when the player gets close
+static const double RAILS_MIN_DIST = 1.0e7;
+static const double RAILS_PLAYER_DIST = 1.0e6;
+static const double RAILS_EXIT_STEPS = 10.0; // hand back this many steps before arrival
+static const double RAILS_BRAKING_MARGIN = 0.85;
+
+static bool RailsAllowed(const DynamicBody *dBody, FrameId frameId)
+{
+	if (Pi::game->GetTimeAccel() < Game::TIMEACCEL_1000X || dBody == Pi::player)
+		return false;
+	if (Frame::GetFrame(frameId)->IsRotFrame())
+		return false;
+	if (Pi::player->GetCombatTarget() == dBody || Pi::player->GetNavTarget() == dBody)
+		return false;
+	return dBody->GetPositionRelTo(Pi::player).Length() >= RAILS_PLAYER_DIST;
+}
+
+bool AICmdFlyTo::CanUseRails(double targdist, const vector3d &reldir, const vector3d &relvel) const
+{
+	if (targdist < RAILS_MIN_DIST || m_child || !RailsAllowed(m_dBody, m_frameId))
+		return false;
+
+	// only once the AI has the ship heading straight for the target
+	const double curspeed = -relvel.Dot(reldir);
+	const double perpspeed = (relvel + reldir * curspeed).Length();
+	return curspeed >= 0.0 && perpspeed < std::max(10.0, 0.01 * curspeed);
+}
+
+bool AICmdFlyTo::StartRails(double targdist, double curspeed)
+{
+	const ShipType *st = static_cast<Ship *>(m_dBody)->GetShipType();
+	const double fuel = m_prop->GetFuel();
+	const double deltaV = m_prop->GetSpeedReachedWithFuel();
+	// PrecalcPath spends half the fuel on each burn, it has to be able to stop
+	if (fuel <= 0.0 || deltaV <= 2.0 * curspeed)
+		return false;
+
+	const double mass = m_dBody->GetMass();
+	const double EV = st->effectiveExhaustVelocity;
+	const double propellant = mass * (1.0 - exp(-deltaV / EV)); // kg above the reserve
+	std::unique_ptr<PrecalcPath> path(new PrecalcPath(targdist, curspeed, EV,
+		st->linThrust[THRUSTER_FORWARD], st->linAccelerationCap[THRUSTER_FORWARD],
+		mass, propellant, RAILS_BRAKING_MARGIN));
+
+	// not worth it for a trip that's over in a few steps
+	if (path->getFullTime() < 2.0 * RAILS_EXIT_STEPS * Pi::game->GetTimeStep())
+		return false;
+
+	m_rails = std::move(path);
+	m_railsStartTime = Pi::game->GetTime();
+	m_railsDist = targdist;
+	m_railsMass = mass;
+	m_railsFuel = fuel;
+	m_railsFuelPerKg = fuel / (1000.0 * m_prop->FuelTankMassLeft());
+	return true;
+}
+
+// places the body on the path at the current time, returns false when it
+// should go back to normal flight
+bool AICmdFlyTo::UpdateRails(const vector3d &targpos, const vector3d &targvel)
+{
+	if (!RailsAllowed(m_dBody, m_frameId))
+		return false;
+
+	m_rails->setTime(Pi::game->GetTime() - m_railsStartTime);
+	const double remaining = m_railsDist - m_rails->getDist();
+	if (remaining < RAILS_MIN_DIST || m_rails->getEstimate() < RAILS_EXIT_STEPS * Pi::game->GetTimeStep())
+		return false;
+
+	// measured from the target so a moving target is followed; the integrator
+	// advances the body one step from here, and the next update snaps it back
+	const vector3d dir = (targpos - m_dBody->GetPosition()).NormalizedSafe();
+	m_dBody->SetPosition(targpos - dir * remaining);
+	m_dBody->SetVelocity(targvel + dir * m_rails->getVel());
+	m_prop->SetFuel(m_railsFuel - (m_railsMass - m_rails->getMass()) * m_railsFuelPerKg);
+	m_prop->ClearLinThrusterState();
+	m_prop->AIFaceDirection(dir);
+	return true;
 }
 
 void AICmdFlyTo::GetStatusText(char *str)
@@ -1035,7 +1151,9 @@ bool AICmdFlyTo::TimeStepUpdate()
 		targvel = GetVelInFrame(m_dBody->GetFrame(), m_targframeId, m_posoff);
 	}
 	FrameId targframeId = m_target ? m_target->GetFrame() : m_targframeId;
-	ParentSafetyAdjust(m_dBody, targframeId, targpos, targvel);
+	UpdateObstacles(targframeId, targpos);
+	if (m_obstacles.safetyBody)
+		ParentSafetyAdjust(m_dBody, m_obstacles.safetyBody, m_obstacles.safetyDist, targpos, targvel);
 	vector3d relpos = targpos - m_dBody->GetPosition();
 	double targdist = relpos.Length();
 
@@ -1044,7 +1162,7 @@ bool AICmdFlyTo::TimeStepUpdate()
 
 	if(planetNear) {
 		double M = planetNear->IsType(ObjectType::TERRAINBODY) ? planetNear->GetMass() : 0;
-		double safeAlt = MaxEffectRad(planetNear, m_prop);
+		double safeAlt = m_obstacles.frameRad;
 		vector3d obspos = -m_dBody->GetPosition();
 
 
@@ -1094,15 +1212,21 @@ bool AICmdFlyTo::TimeStepUpdate()
 		if (m_child) {
 			m_child.reset();
 		}
+		m_rails.reset(); // re-materialise near whatever owns the new frame
 		if (m_tangent && m_frameId.valid()) return true; // regen tangent on frame switch
 		m_reldir = reldir;								 // for +vel termination condition
 		m_frameId = m_dBody->GetFrame();
 	}
 
+	if (m_rails) {
+		if (UpdateRails(targpos, targvel)) return false;
+		m_rails.reset();
+	}
+
 	// TODO: collision needs to be processed according to vdiff, not reldir?
 
 	Body *body = Frame::GetFrame(m_frameId)->GetBody();
-	double erad = MaxEffectRad(body, m_prop);
+	double erad = m_obstacles.frameRad;
 	Frame *targframe = Frame::GetFrame(targframeId);
 	if ((m_target && body != m_target) || (targframe && (!m_tangent || body != targframe->GetBody()))) {
 		int coll = CheckCollision(m_dBody, reldir, targdist, targetAlt, m_endvel, erad);
@@ -1126,6 +1250,11 @@ bool AICmdFlyTo::TimeStepUpdate()
 	if (m_state < 0 && m_state > -6 && m_tangent) return true; // bail out
 	if (m_state < 0) m_state = targdist > 10000000.0 ? 1 : 0;  // still lame
 
+	if (CanUseRails(targdist, reldir, relvel) && StartRails(targdist, -relvel.Dot(reldir))) {
+		if (UpdateRails(targpos, targvel)) return false;
+		m_rails.reset();
+	}
+
 	double maxdecel = m_state ? m_prop->GetAccelFwd() : m_prop->GetAccelRev();
 	double gravdir = -reldir.Dot(m_dBody->GetPosition().Normalized());
 	maxdecel -= gravdir * GetGravityAtPos(m_dBody->GetFrame(), m_dBody->GetPosition());
@@ -1240,6 +1369,15 @@ bool AICmdFlyTo::TimeStepUpdate()
 	return false;
 }
 
+// how long NPCs wait for a bay before giving up, in seconds
+static const double DOCKING_QUEUE_TIMEOUT = 600.0;
+
+AICmdDock::~AICmdDock()
+{
+	if (m_queueTimeout > 0.0 && m_target)
+		m_target->LeaveDockingQueue(static_cast<Ship *>(m_dBody));
+}
+
 void AICmdDock::OnDeleted(const Body *body)
 {
 	AICommand::OnDeleted(body);
@@ -1372,11 +1510,34 @@ bool AICmdDock::TimeStepUpdate()
 		return false;
 	}
 
+	// waiting in the station's docking queue: hold still, and let the ship
+	// fall asleep until the station wakes it with a bay
+	if (m_queueTimeout > 0.0) {
+		if (Pi::game->GetTime() > m_queueTimeout) {
+			m_target->LeaveDockingQueue(ship);
+			m_queueTimeout = 0.0;
+			ship->AIMessage(Ship::AIERROR_REFUSED_PERM);
+			return true;
+		}
+		if (ship->IsSleeping()) return false;
+		if (m_target->GetMyDockingPort(ship) == -1) {
+			m_prop->AIMatchVel(m_target->GetVelocityRelTo(m_dBody->GetFrame()));
+			m_prop->ClearAngThrusterState();
+			return false;
+		}
+		m_queueTimeout = 0.0;
+	}
+
 	int port = m_target->GetMyDockingPort(ship);
 	if (port == -1) {
 		const bool cleared = m_target->GetDockingClearance(ship);
 		port = m_target->GetMyDockingPort(ship);
 		if (!cleared || (port == -1)) {
+			// the player's autopilot reports the refusal straight away
+			if (ship != Pi::player && m_target->QueueForDocking(ship)) {
+				m_queueTimeout = Pi::game->GetTime() + DOCKING_QUEUE_TIMEOUT;
+				return false;
+			}
 			ship->AIMessage(Ship::AIERROR_REFUSED_PERM);
 			return true;
 		}
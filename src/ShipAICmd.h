@@ -10,6 +10,7 @@
 #include "DynamicBody.h"
 #include "FixedGuns.h"
 #include "FrameId.h"
+#include "ship/PrecalcPath.h"
 #include "ship/Propulsion.h"
 
 class Ship;
@@ -62,6 +63,25 @@ public:
 
 	CmdName GetType() const { return m_cmdName; }
 
+	// true if this command or its active child must decide every step,
+	// i.e. it is manoeuvring close to another body
+	bool NeedsFullRate() const
+	{
+		switch (m_cmdName) {
+		case CMD_DOCK:
+		case CMD_KILL:
+		case CMD_KAMIKAZE:
+		case CMD_FORMATION:
+			return true;
+		default:
+			return m_child && m_child->NeedsFullRate();
+		}
+	}
+
+	// true if this command or its active child is moving the body along an
+	// analytic trajectory instead of integrating thrust
+	virtual bool IsOnRails() const { return m_child && m_child->IsOnRails(); }
+
 protected:
 	DynamicBody *m_dBody;
 	Propulsion *m_prop;
@@ -77,6 +97,7 @@ class AICmdDock : public AICommand {
 public:
 	virtual bool TimeStepUpdate();
 	AICmdDock(DynamicBody *dBody, SpaceStation *target);
+	virtual ~AICmdDock();
 
 	virtual void GetStatusText(char *str);
 	virtual void SaveToJson(Json &jsonObj);
@@ -101,6 +122,7 @@ private:
 	vector3d m_dockupdir;
 	EDockingStates m_state; // see TimeStepUpdate()
 	int m_targetIndex;		// used during deserialisation
+	double m_queueTimeout = 0.0; // game time to give up waiting for a bay, zero if not queued
 
 	void IncrementState()
 	{
@@ -128,7 +150,14 @@ public:
 
 	virtual void OnDeleted(const Body *body);
 
+	virtual bool IsOnRails() const { return m_rails || AICommand::IsOnRails(); }
+
 private:
+	bool CanUseRails(double targdist, const vector3d &reldir, const vector3d &relvel) const;
+	bool StartRails(double targdist, double curspeed);
+	bool UpdateRails(const vector3d &targpos, const vector3d &targvel);
+	void UpdateObstacles(FrameId targframeId, const vector3d &targpos);
+
 	Body *m_target;		   // target for vicinity. Either this or targframe is 0
 	double m_dist;		   // vicinity distance
 	FrameId m_targframeId; // target frame for waypoint
@@ -141,6 +170,27 @@ private:
 	vector3d m_reldir; // target direction relative to ship at last frame change
 	FrameId m_frameId; // last frame of ship
 	bool m_suicideRecovery;
+
+	// on-rails cruise during high time acceleration, not saved: the ship
+	// keeps its velocity and goes back on rails after loading
+	std::unique_ptr<PrecalcPath> m_rails;
+	double m_railsStartTime;
+	double m_railsDist;		// path length when the rails started
+	double m_railsMass;		// body mass when the rails started, kg
+	double m_railsFuel;		// fuel level when the rails started
+	double m_railsFuelPerKg; // fuel level used per kg of propellant
+
+	// obstacles around the path, see UpdateObstacles()
+	struct Obstacles {
+		FrameId frameId;	 // ship frame when found
+		FrameId targframeId; // target frame when found
+		vector3d pos;		 // ship position when found
+		vector3d dir;		 // path direction when found
+		Body *safetyBody;	 // parent frame body to stop short of
+		double safetyDist;	 // distance from its centre to stop at
+		double frameRad;	 // effect radius of the ship frame's body
+	} m_obstacles;
+	bool m_obstaclesValid = false;
 };
 
 class AICmdFlyAround : public AICommand {
@@ -0,0 +1,48 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "ShipSpawnQueue.h"
+
+#include "ModelCache.h"
+#include "Pi.h"
+#include "profiler/Profiler.h"
+
+// stop waiting for a background load after this many frames and load the
+// model on the spot
+static const unsigned int MAX_FRAMES_WAITING = 120;
+
+void ShipSpawnQueue::Queue(const std::string &modelName, std::function<void()> spawn)
+{
+	Pi::modelCache->Prefetch({ modelName });
+	m_pending.push_back({ modelName, std::move(spawn), 0 });
+}
+
+void ShipSpawnQueue::Update(double budgetMs)
+{
+	PROFILE_SCOPED()
+	if (m_pending.empty())
+		return;
+
+	Profiler::Clock clock;
+	clock.Start();
+	do {
+		// first come first served among the ships whose models are ready,
+		// so one slow model doesn't hold up the rest
+		auto it = m_pending.begin();
+		while (it != m_pending.end() && Pi::modelCache->IsPrefetching(it->modelName) && it->framesWaited < MAX_FRAMES_WAITING)
+			++it;
+		if (it == m_pending.end())
+			break;
+
+		// the spawn can queue more spawns, so take it out first
+		std::function<void()> spawn = std::move(it->spawn);
+		m_pending.erase(it);
+		spawn();
+
+		clock.SoftStop();
+	} while (!m_pending.empty() && clock.milliseconds() < budgetMs);
+	clock.Stop();
+
+	for (Spawn &s : m_pending)
+		s.framesWaited++;
+}
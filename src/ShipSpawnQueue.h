@@ -0,0 +1,37 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <string>
+
+/*
+ * Spreads the creation of ships over several frames. Each spawn starts
+ * loading its model in the background when queued, and runs once the model
+ * is ready, as many a frame as fit in the time budget (at least one, so the
+ * queue always drains).
+ */
+class ShipSpawnQueue {
+public:
+	// spawn creates the ship and adds it to space; it runs on the main
+	// thread from Update()
+	void Queue(const std::string &modelName, std::function<void()> spawn);
+
+	void Update(double budgetMs);
+
+	size_t GetNumPending() const { return m_pending.size(); }
+
+	// drops the pending spawns without running them
+	void Clear() { m_pending.clear(); }
+
+private:
+	struct Spawn {
+		std::string modelName;
+		std::function<void()> spawn;
+		unsigned int framesWaited;
+	};
+
+	std::deque<Spawn> m_pending;
+};
@@ -41,10 +41,9 @@ static bool ShipIsUnbuyable(const std::string &id)
 	return is_zero_exact(t.baseprice);
 }
 
-ShipType::ShipType(const Id &_id, const std::string &path)
+ShipType::ShipType(const Id &_id, const std::string &path, Json data)
 {
 	PROFILE_SCOPED()
-	Json data = JsonUtils::LoadJsonDataFile(path);
 	if (data.is_null()) {
 		Output("couldn't read ship def '%s'\n", path.c_str());
 		throw ShipTypeLoadError();
@@ -218,7 +217,7 @@ ShipType::ShipType(const Id &_id, const std::string &path)
 	hyperdriveClass = data.value("hyperdrive_class", 1);
 }
 
-void ShipType::Init()
+void ShipType::Init(TaskGraph *taskGraph)
 {
 	PROFILE_SCOPED()
 	static bool isInitted = false;
@@ -226,32 +225,39 @@ void ShipType::Init()
 		return;
 	isInitted = true;
 
-	// load all ship definitions
+	// load all ship definitions, parsed together on the workers
 	namespace fs = FileSystem;
+	std::vector<std::string> ids, paths;
 	for (fs::FileEnumerator files(fs::gameDataFiles, "ships", fs::FileEnumerator::Recurse); !files.Finished(); files.Next()) {
 		const fs::FileInfo &info = files.Current();
 		if (ends_with_ci(info.GetPath(), ".json")) {
-			const std::string id(info.GetName().substr(0, info.GetName().size() - 5));
-			try {
-				ShipType st = ShipType(id, info.GetPath());
-				types.insert(std::make_pair(st.id, st));
+			ids.push_back(info.GetName().substr(0, info.GetName().size() - 5));
+			paths.push_back(info.GetPath());
+		}
+	}
+
+	std::vector<Json> datas = JsonUtils::LoadJsonDataFiles(paths, taskGraph);
+	for (size_t i = 0; i < ids.size(); i++) {
+		const std::string &id = ids[i];
+		try {
+			ShipType st = ShipType(id, paths[i], std::move(datas[i]));
+			types.insert(std::make_pair(st.id, st));
 
-				// assign the names to the various lists
-				switch (st.tag) {
-				case TAG_SHIP: player_ships.push_back(id); break;
-				case TAG_STATIC_SHIP: static_ships.push_back(id); break;
-				case TAG_MISSILE:
-					missile_ships.push_back(id);
-					break;
-					break;
-				case TAG_NONE:
-				default:
-					break;
-				}
-			} catch (ShipTypeLoadError) {
-				// TODO: Actual error handling would be nice.
-				Error("Error while loading Ship data (check stdout/output.txt).\n");
+			// assign the names to the various lists
+			switch (st.tag) {
+			case TAG_SHIP: player_ships.push_back(id); break;
+			case TAG_STATIC_SHIP: static_ships.push_back(id); break;
+			case TAG_MISSILE:
+				missile_ships.push_back(id);
+				break;
+				break;
+			case TAG_NONE:
+			default:
+				break;
 			}
+		} catch (ShipTypeLoadError) {
+			// TODO: Actual error handling would be nice.
+			Error("Error while loading Ship data (check stdout/output.txt).\n");
 		}
 	}
 
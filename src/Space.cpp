@@ -3,8 +3,10 @@
 
 #include "Space.h"
 
+#include "BinaryArchive.h"
 #include "Body.h"
 #include "CityOnPlanet.h"
+#include "DynamicBody.h"
 #include "Frame.h"
 #include "Game.h"
 #include "GameSaveError.h"
@@ -21,10 +23,12 @@
 #include "collider/CollisionContact.h"
 #include "collider/CollisionSpace.h"
 #include "core/Log.h"
+#include "core/TaskGraph.h"
 #include "galaxy/Galaxy.h"
 #include "graphics/Graphics.h"
 #include "lua/LuaEvent.h"
 #include "lua/LuaTimer.h"
+#include "profiler/Profiler.h"
 #include <algorithm>
 #include <functional>
 
@@ -156,15 +160,30 @@ static void RelocateStarportIfNecessary(SystemBody *sbody, Planet *planet, vecto
 	}
 }
 
+// size of the grid cells used to find nearby bodies; most queries are for
+// the 100km radar and sensor range, which then visit at most 8 cells
+// schema of the frame tree archive; bump the version when Frame::ToArchive
+// or SfxManager::ToArchive change what they write
+static constexpr const char FRAME_ARCHIVE_SCHEMA[] = "frames";
+static constexpr Uint32 FRAME_ARCHIVE_VERSION = 1;
+
+static constexpr double BODY_NEAR_CELL_SIZE = 200000.0;
+
+Space::BodyNearFinder::BodyNearFinder(const Space *space) :
+	m_space(space),
+	m_grid(BODY_NEAR_CELL_SIZE)
+{}
+
 void Space::BodyNearFinder::Prepare()
 {
 	PROFILE_SCOPED()
-	m_bodyDist.clear();
+	m_grid.Clear();
+	m_grid.Reserve(m_space->GetNumBodies());
 
 	for (Body *b : m_space->GetBodies())
-		m_bodyDist.emplace_back(b, b->GetPositionRelTo(m_space->GetRootFrame()).Length());
+		m_grid.Add(b, b->GetPositionRelTo(m_space->GetRootFrame()));
 
-	std::sort(m_bodyDist.begin(), m_bodyDist.end());
+	m_grid.Build();
 }
 
 Space::BodyNearList Space::BodyNearFinder::GetBodiesMaybeNear(const Body *b, double dist)
@@ -174,20 +193,8 @@ Space::BodyNearList Space::BodyNearFinder::GetBodiesMaybeNear(const Body *b, dou
 
 Space::BodyNearList Space::BodyNearFinder::GetBodiesMaybeNear(const vector3d &pos, double dist)
 {
-	if (m_bodyDist.empty()) {
-		m_nearBodies.clear();
-		return std::move(m_nearBodies);
-	}
-
-	const double len = pos.Length();
-
-	std::vector<BodyDist>::const_iterator min = std::lower_bound(m_bodyDist.begin(), m_bodyDist.end(), len - dist);
-	std::vector<BodyDist>::const_iterator max = std::upper_bound(min, m_bodyDist.cend(), len + dist);
-
 	m_nearBodies.clear();
-	m_nearBodies.reserve(max - min);
-
-	std::for_each(min, max, [&](BodyDist const &bd) { m_nearBodies.push_back(bd.body); });
+	m_grid.QueryRadius(pos, dist, m_nearBodies);
 
 	return std::move(m_nearBodies);
 }
@@ -258,15 +265,23 @@ Space::Space(Game *game, RefCountedPtr<Galaxy> galaxy, const Json &jsonObj, doub
 
 	CityOnPlanet::SetCityModelPatterns(m_starSystem->GetPath());
 
-	if (!spaceObj.count("frame")) throw SavedGameCorruptException();
-	m_rootFrameId = Frame::FromJson(spaceObj["frame"], this, FrameId::Invalid, at_time);
+	if (spaceObj.count("frame_archive")) {
+		const std::string frameData = BinaryArchiveReader::FromJson(spaceObj["frame_archive"]);
+		BinaryArchiveReader frameArchive(frameData, FRAME_ARCHIVE_SCHEMA, FRAME_ARCHIVE_VERSION);
+		m_rootFrameId = Frame::FromArchive(frameArchive, this, FrameId::Invalid, at_time);
+		if (!frameArchive.AtEnd()) throw SavedGameCorruptException();
+	} else {
+		// saved before the frames were archived
+		if (!spaceObj.count("frame")) throw SavedGameCorruptException();
+		m_rootFrameId = Frame::FromJson(spaceObj["frame"], this, FrameId::Invalid, at_time);
+	}
 
 	try {
 		Json bodyArray = spaceObj["bodies"].get<Json::array_t>();
 		for (Uint32 i = 0; i < bodyArray.size(); i++) {
 			if (bodyArray[i].count("is_not_in_space") > 0)
 				continue;
-			m_bodies.push_back(Body::FromJson(bodyArray[i], this));
+			AddBody(Body::FromJson(bodyArray[i], this));
 		}
 	} catch (Json::type_error &) {
 		throw SavedGameCorruptException();
@@ -347,9 +362,11 @@ void Space::ToJson(Json &jsonObj)
 
 	StarSystem::ToJson(spaceObj, m_starSystem.Get());
 
-	Json frameObj({});
-	Frame::ToJson(frameObj, m_rootFrameId, this);
-	spaceObj["frame"] = frameObj;
+	// the frame tree and its effects are a great many small fields, so
+	// they're kept in a binary archive rather than as Json
+	BinaryArchiveWriter frameArchive(FRAME_ARCHIVE_SCHEMA, FRAME_ARCHIVE_VERSION);
+	Frame::ToArchive(frameArchive, m_rootFrameId, this);
+	frameArchive.ToJson(spaceObj["frame_archive"]);
 
 	Json bodyArray = Json::array(); // Create JSON array to contain body data.
 	for (size_t i = 0; i < m_bodyIndex.size() - 1; i++) {
@@ -398,8 +415,9 @@ SystemBody *Space::GetSystemBodyByIndex(Uint32 idx) const
 Uint32 Space::GetIndexForBody(const Body *body) const
 {
 	assert(m_bodyIndexValid);
-	for (Uint32 i = 0; i < m_bodyIndex.size(); i++)
-		if (m_bodyIndex[i] == body) return i;
+	auto it = m_bodyIndexLookup.find(body);
+	if (it != m_bodyIndexLookup.end())
+		return it->second;
 	assert(false);
 	Output("GetIndexForBody passed unknown body");
 	return SDL_MAX_UINT32;
@@ -408,8 +426,9 @@ Uint32 Space::GetIndexForBody(const Body *body) const
 Uint32 Space::GetIndexForSystemBody(const SystemBody *sbody) const
 {
 	assert(m_sbodyIndexValid);
-	for (Uint32 i = 0; i < m_sbodyIndex.size(); i++)
-		if (m_sbodyIndex[i] == sbody) return i;
+	auto it = m_sbodyIndexLookup.find(sbody);
+	if (it != m_sbodyIndexLookup.end())
+		return it->second;
 	assert(0);
 	return SDL_MAX_UINT32;
 }
@@ -438,6 +457,11 @@ void Space::RebuildBodyIndex()
 		}
 	}
 
+	// the null entry at index 0 is looked up like any other
+	m_bodyIndexLookup.clear();
+	for (Uint32 i = 0; i < m_bodyIndex.size(); i++)
+		m_bodyIndexLookup.emplace(m_bodyIndex[i], i);
+
 	Pi::SetAmountBackgroundStars(Pi::GetAmountBackgroundStars());
 	Pi::SetStarFieldStarSizeFactor(Pi::GetStarFieldStarSizeFactor());
 
@@ -452,12 +476,25 @@ void Space::RebuildSystemBodyIndex()
 	if (m_starSystem)
 		AddSystemBodyToIndex(m_starSystem->GetRootBody().Get());
 
+	m_sbodyIndexLookup.clear();
+	for (Uint32 i = 0; i < m_sbodyIndex.size(); i++)
+		m_sbodyIndexLookup.emplace(m_sbodyIndex[i], i);
+
 	m_sbodyIndexValid = true;
 }
 
+// static
+Uint32 Space::NextBodiesVersion()
+{
+	static Uint32 s_version = 0;
+	return ++s_version;
+}
+
 void Space::AddBody(Body *b)
 {
+	m_bodySlots[b] = Uint32(m_bodies.size());
 	m_bodies.push_back(b);
+	m_bodiesVersion = NextBodiesVersion();
 }
 
 void Space::RemoveBody(Body *b)
@@ -1024,33 +1061,84 @@ static void hitCallback(CollisionContact *c)
 }
 
 // temporary one-point version
-static void CollideWithTerrain(Body *body, float timeStep)
+// Only reads the state of the body and its terrain, so this can run on any thread
+static bool FindTerrainContact(Body *body, float timeStep, CollisionContact &contact)
 {
-	PROFILE_SCOPED()
 	if (!body->IsType(ObjectType::DYNAMICBODY))
-		return;
+		return false;
 	DynamicBody *dynBody = static_cast<DynamicBody *>(body);
-	if (!dynBody->IsMoving())
-		return;
+	if (!dynBody->IsMoving() || dynBody->IsSleeping())
+		return false;
 
 	Frame *f = Frame::GetFrame(body->GetFrame());
 	if (!f || !f->GetBody() || f->GetId() != f->GetBody()->GetFrame())
-		return;
+		return false;
 	if (!f->GetBody()->IsType(ObjectType::TERRAINBODY))
-		return;
+		return false;
 	TerrainBody *terrain = static_cast<TerrainBody *>(f->GetBody());
 
 	const Aabb &aabb = dynBody->GetAabb();
 	double altitude = body->GetPosition().Length() + aabb.min.y;
 	if (altitude >= (terrain->GetMaxFeatureRadius() * 2.0))
-		return;
+		return false;
 
 	double terrHeight = terrain->GetTerrainHeight(body->GetPosition().Normalized());
 	if (altitude >= terrHeight)
+		return false;
+
+	contact = CollisionContact(body->GetPosition(), body->GetPosition().Normalized(), terrHeight - altitude, timeStep, static_cast<void *>(body), static_cast<void *>(f->GetBody()));
+	return true;
+}
+
+// number of bodies tested against the terrain by each task
+static constexpr uint32_t TERRAIN_BODIES_PER_TASK = 64;
+// per-task contact buffers for CollideWithTerrain, kept around to reuse their storage
+static std::vector<std::vector<CollisionContact>> s_terrainContacts;
+
+static void CollideWithTerrain(const std::vector<Body *> &bodies, float timeStep, TaskGraph *taskGraph)
+{
+	PROFILE_SCOPED()
+
+	CollisionContact contact;
+	const uint32_t numBodies = bodies.size();
+	if (!taskGraph || numBodies <= TERRAIN_BODIES_PER_TASK) {
+		for (Body *b : bodies) {
+			if (FindTerrainContact(b, timeStep, contact))
+				hitCallback(&contact);
+		}
+
 		return;
+	}
+
+	// Which bodies touch the terrain can be found in parallel; the collision
+	// response runs afterwards in body order, as the response of one body
+	// never changes whether another one is touching the terrain.
+	const uint32_t numTasks = (numBodies + TERRAIN_BODIES_PER_TASK - 1) / TERRAIN_BODIES_PER_TASK;
+	if (s_terrainContacts.size() < numTasks)
+		s_terrainContacts.resize(numTasks);
+
+	TaskSet *taskSet = new TaskSet();
+	for (uint32_t task = 0; task < numTasks; task++) {
+		s_terrainContacts[task].clear();
+
+		const uint32_t begin = task * TERRAIN_BODIES_PER_TASK;
+		const uint32_t end = std::min(begin + TERRAIN_BODIES_PER_TASK, numBodies);
+		taskSet->AddTaskLambda({ begin, end }, [&bodies, timeStep, task](TaskRange range) {
+			CollisionContact contact;
+			for (uint32_t idx = range.begin; idx < range.end; idx++) {
+				if (FindTerrainContact(bodies[idx], timeStep, contact))
+					s_terrainContacts[task].push_back(contact);
+			}
+		});
+	}
 
-	CollisionContact c(body->GetPosition(), body->GetPosition().Normalized(), terrHeight - altitude, timeStep, static_cast<void *>(body), static_cast<void *>(f->GetBody()));
-	hitCallback(&c);
+	TaskSet::Handle handle = taskGraph->QueueTaskSet(taskSet);
+	taskGraph->WaitForTaskSet(handle);
+
+	for (uint32_t task = 0; task < numTasks; task++) {
+		for (CollisionContact &c : s_terrainContacts[task])
+			hitCallback(&c);
+	}
 }
 
 void Space::TimeStep(float step)
@@ -1062,16 +1150,32 @@ void Space::TimeStep(float step)
 
 	m_bodyIndexValid = m_sbodyIndexValid = false;
 
-	Frame::CollideFrames(&hitCallback);
+	TaskGraph *taskGraph = Pi::GetApp()->GetTaskGraph();
 
-	for (Body *b : m_bodies)
-		CollideWithTerrain(b, step);
+	Profiler::Clock phaseTimer;
+	phaseTimer.SoftReset();
+	auto endPhase = [&phaseTimer](double &total) {
+		phaseTimer.SoftStop();
+		total += phaseTimer.milliseconds();
+		phaseTimer.SoftReset();
+	};
+
+	// The step runs in fixed phases. Contacts are found in parallel but their
+	// response is applied serially in a fixed order, so the outcome of a step
+	// does not depend on the number of worker threads.
+
+	// collide: all bodies against each other, then against the terrain
+	Frame::CollideFrames(&hitCallback, taskGraph);
+	CollideWithTerrain(m_bodies, step, taskGraph);
+	endPhase(m_stepTimes.collision);
 
 	// update frames of reference
 	for (Body *b : m_bodies)
 		b->UpdateFrame();
+	endPhase(m_stepTimes.physics);
 
-	// AI acts here, then move all bodies and frames
+	// AI acts here, then move all bodies and frames. This stays serial: the
+	// AI reads the state of other bodies, fires weapons and spawns bodies.
 	// NOTE: The AI can add bodies here so we can't use an iterator
 	// this restores the previous version where only the initial list is
 	// updated unless the bodies vector reallocated where anything could
@@ -1084,18 +1188,52 @@ void Space::TimeStep(float step)
 		auto b = m_bodies[i];
 		b->StaticUpdate(step);
 	}
+	endPhase(m_stepTimes.ai);
+
 	Frame::UpdateOrbitRails(m_game->GetTime(), m_game->GetTimeStep());
 
+	// integrate; SpaceStations move the ships docked with them from here
 	for (Body *b : m_bodies) {
 		b->TimeStepUpdate(step);
 	}
+	endPhase(m_stepTimes.physics);
 
+	// commit: Lua events queued by any of the phases above are only
+	// emitted once all bodies have been updated
 	LuaEvent::Emit();
 	Pi::luaTimer->Tick();
+	endPhase(m_stepTimes.lua);
 
 	UpdateBodies();
+	RebuildKinematicStore();
 
 	m_bodyNearFinder.Prepare();
+	endPhase(m_stepTimes.bookkeeping);
+	m_stepTimes.steps++;
+}
+
+void Space::RebuildKinematicStore()
+{
+	PROFILE_SCOPED()
+
+	m_kinematicStore.Clear();
+	for (Body *b : m_bodies) {
+		if (b->IsType(ObjectType::DYNAMICBODY))
+			m_kinematicStore.Add(static_cast<DynamicBody *>(b));
+	}
+}
+
+void Space::UpdateInterpTransforms(double alpha)
+{
+	PROFILE_SCOPED()
+
+	m_kinematicStore.UpdateInterpTransforms(alpha, Pi::GetApp()->GetTaskGraph());
+
+	// bodies added since the last physics step aren't in the store yet
+	for (Body *b : m_bodies) {
+		if (!b->IsType(ObjectType::DYNAMICBODY) || !static_cast<DynamicBody *>(b)->IsInKinematicStore())
+			b->UpdateInterpTransform(alpha);
+	}
 }
 
 void Space::UpdateBodies()
@@ -1105,23 +1243,37 @@ void Space::UpdateBodies()
 	m_processingFinalizationQueue = true;
 #endif
 
+	// let every body drop its references to the departing ones before any
+	// of them is deleted
+	if (!m_assignedBodies.empty()) {
+		for (Body *body : m_bodies) {
+			for (const auto &b : m_assignedBodies) {
+				if (body != b.first)
+					body->NotifyRemoved(b.first);
+			}
+		}
+	}
+
 	// removing or deleting bodies from space
 	for (const auto &b : m_assignedBodies) {
-		auto remove_iterator = m_bodies.end();
-		for (auto it = m_bodies.begin(); it != m_bodies.end(); ++it) {
-			if (*it != b.first)
-				(*it)->NotifyRemoved(b.first);
-			else
-				remove_iterator = it;
-		}
-		if (remove_iterator != m_bodies.end()) {
-			*remove_iterator = m_bodies.back();
-			m_bodies.pop_back();
-			if (b.second == BodyAssignation::KILL)
-				delete b.first;
-			else
-				b.first->SetFrame(FrameId::Invalid);
+		auto slot = m_bodySlots.find(b.first);
+		if (slot == m_bodySlots.end())
+			continue;
+
+		// move the last body into the freed slot
+		const Uint32 idx = slot->second;
+		m_bodySlots.erase(slot);
+		if (idx + 1 != m_bodies.size()) {
+			m_bodies[idx] = m_bodies.back();
+			m_bodySlots[m_bodies[idx]] = idx;
 		}
+		m_bodies.pop_back();
+		m_bodiesVersion = NextBodiesVersion();
+
+		if (b.second == BodyAssignation::KILL)
+			delete b.first;
+		else
+			b.first->SetFrame(FrameId::Invalid);
 	}
 
 	m_assignedBodies.clear();
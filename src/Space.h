@@ -7,10 +7,15 @@
 #include "Background.h"
 #include "FrameId.h"
 #include "IterationProxy.h"
+#include "KinematicStore.h"
 #include "RefCounted.h"
+#include "ShipSpawnQueue.h"
+#include "SpatialHashGrid.h"
 #include "galaxy/StarSystem.h"
 #include "vector3.h"
 
+#include <unordered_map>
+
 class Body;
 class Frame;
 class Game;
@@ -49,6 +54,26 @@ public:
 
 	void TimeStep(float step);
 
+	// wall-clock time spent in each phase of TimeStep, in milliseconds,
+	// summed over the steps since the last reset
+	struct StepTimes {
+		double collision = 0.0;
+		double ai = 0.0;		  // StaticUpdate: AI, weapons and spawning
+		double physics = 0.0;	  // frame changes, orbit rails and integration
+		double lua = 0.0;		  // Lua events and timers
+		double bookkeeping = 0.0; // body removal and the caches rebuilt after a step
+		uint64_t steps = 0;
+	};
+	const StepTimes &GetStepTimes() const { return m_stepTimes; }
+	void ResetStepTimes() { m_stepTimes = {}; }
+
+	// ships waiting to be created, see ShipSpawnQueue
+	ShipSpawnQueue &GetSpawnQueue() { return m_spawnQueue; }
+
+	// interpolate the transforms of all bodies (by 0 <= alpha <= 1) between
+	// the previous and current physics tick
+	void UpdateInterpTransforms(double alpha);
+
 	void GetHyperspaceExitParams(const SystemPath &source, const SystemPath &dest,
 		vector3d &pos, vector3d &vel) const;
 	vector3d GetHyperspaceExitPoint(const SystemPath &source, const SystemPath &dest) const
@@ -66,6 +91,9 @@ public:
 	Body *FindBodyForPath(const SystemPath *path) const;
 
 	Uint32 GetNumBodies() const { return static_cast<Uint32>(m_bodies.size()); }
+	// Changes whenever a body is added to or removed from this space, and
+	// differs between spaces, so cached body lists can tell they're stale
+	Uint32 GetBodiesVersion() const { return m_bodiesVersion; }
 	IterationProxy<std::vector<Body *>> GetBodies() { return MakeIterationProxy(m_bodies); }
 	const IterationProxy<const std::vector<Body *>> GetBodies() const { return MakeIterationProxy(m_bodies); }
 
@@ -126,6 +154,11 @@ private:
 
 	// all the bodies we know about
 	std::vector<Body *> m_bodies;
+	// position of each body in m_bodies, so it can be removed without a search
+	std::unordered_map<const Body *, Uint32> m_bodySlots;
+
+	static Uint32 NextBodiesVersion();
+	Uint32 m_bodiesVersion = NextBodiesVersion();
 
 	// bodies that were removed/killed this timestep and need pruning at the end
 	enum class BodyAssignation {
@@ -135,6 +168,13 @@ private:
 
 	std::vector<std::pair<Body *, BodyAssignation>> m_assignedBodies;
 
+	// contiguous copy of the kinematic state of all dynamic bodies,
+	// rebuilt after each physics step
+	KinematicStore m_kinematicStore;
+	void RebuildKinematicStore();
+
+	StepTimes m_stepTimes;
+
 	void RebuildBodyIndex();
 	void RebuildSystemBodyIndex();
 
@@ -143,15 +183,20 @@ private:
 	bool m_bodyIndexValid, m_sbodyIndexValid;
 	std::vector<Body *> m_bodyIndex;
 	std::vector<SystemBody *> m_sbodyIndex;
+	// reverse lookups of the indices, so serializing references doesn't
+	// have to scan the whole index for each one
+	std::unordered_map<const Body *, Uint32> m_bodyIndexLookup;
+	std::unordered_map<const SystemBody *, Uint32> m_sbodyIndexLookup;
 
 	//background (elements that are infinitely far away,
 	//e.g. starfield and milky way)
 	std::unique_ptr<Background::Container> m_background;
 
+	// Finds bodies by their root-relative position at the end of the last
+	// physics step
 	class BodyNearFinder {
 	public:
-		BodyNearFinder(const Space *space) :
-			m_space(space) {}
+		BodyNearFinder(const Space *space);
 		void Prepare();
 
 		BodyNearList GetBodiesMaybeNear(const Body *b, double dist);
@@ -159,12 +204,14 @@ private:
 
 	private:
 		const Space *m_space;
-		std::vector<BodyDist> m_bodyDist;
+		SpatialHashGrid<Body *> m_grid;
 		std::vector<Body *> m_nearBodies;
 	};
 
 	BodyNearFinder m_bodyNearFinder;
 
+	ShipSpawnQueue m_spawnQueue;
+
 #ifndef NDEBUG
 	//to check RemoveBody and KillBody are not called from within
 	//the NotifyRemoved callback (#735)
@@ -178,14 +178,7 @@ void SpaceStation::InitStation()
 		m_staticSlot[i] = false;
 	Random rand(m_sbody->GetSeed());
 	const bool ground = m_sbody->GetType() == SystemBody::TYPE_STARPORT_ORBITAL ? false : true;
-	const std::string &space_station_type = m_sbody->GetSpaceStationType();
-	if (space_station_type != "") {
-		m_type = SpaceStationType::FindByName(space_station_type);
-		if (m_type == nullptr)
-			Output("WARNING: SpaceStation::InitStation wants to initialize a custom station of type %s, but no station type with that id has been found.\n", space_station_type.c_str());
-	}
-	if (m_type == nullptr)
-		m_type = SpaceStationType::RandomStationType(rand, ground);
+	m_type = SpaceStationType::ForSystemBody(m_sbody, rand);
 
 	if (m_shipDocking.empty()) {
 		m_shipDocking.reserve(m_type->NumDockingPorts());
@@ -248,8 +241,11 @@ void SpaceStation::NotifyRemoved(const Body *const removedBody)
 	for (Uint32 i = 0; i < m_shipDocking.size(); i++) {
 		if (m_shipDocking[i].ship == removedBody) {
 			m_shipDocking[i].ship = 0;
+			m_bayFreed = true;
 		}
 	}
+	if (removedBody->IsType(ObjectType::SHIP))
+		LeaveDockingQueue(static_cast<const Ship *>(removedBody));
 }
 
 int SpaceStation::GetMyDockingPort(const Ship *s) const
@@ -315,6 +311,7 @@ void SpaceStation::SwapDockedShipsPort(const int oldBay, const int newBay)
 
 	m_shipDocking[oldBay].ship = nullptr;
 	SwitchToStage(oldBay, DockStage::NONE);
+	m_bayFreed = true;
 }
 
 bool SpaceStation::LaunchShip(Ship *ship, const int bay)
@@ -371,16 +368,11 @@ bool SpaceStation::GetDockingClearance(Ship *s)
 		}
 	}
 
-	const Aabb &bbox = s->GetAabb();
-	const float bboxRad = vector2f(float(bbox.max.x), float(bbox.max.z)).Length();
-
 	for (Uint32 i = 0; i < m_shipDocking.size(); i++) {
 		// initial unoccupied check
 		if (m_shipDocking[i].ship != 0) continue;
 
-		// size-of-ship vs size-of-bay check
-		const SpaceStationType::SPort *const pPort = m_type->FindPortByBay(i);
-		if (!pPort) continue;
+		if (!m_type->FindPortByBay(i)) continue;
 
 		// distance-to-station check
 		const double shipDist = s->GetPositionRelTo(this).Length();
@@ -391,13 +383,8 @@ bool SpaceStation::GetDockingClearance(Ship *s)
 			return false;
 		}
 
-		if (pPort->minShipSize < bboxRad && bboxRad < pPort->maxShipSize) {
-			shipDocking_t &sd = m_shipDocking[i];
-			sd.ship = s;
-			sd.stagePos = 0;
-			sd.maxOffset = calculate_max_offset_squared(pPort->maxShipSize, bboxRad);
-			LuaEvent::Queue("onDockingClearanceGranted", this, s);
-			SwitchToStage(i, DockStage::CLEARANCE_GRANTED);
+		if (PortFitsShip(i, s)) {
+			GrantClearance(i, s);
 			return true;
 		}
 	}
@@ -407,6 +394,71 @@ bool SpaceStation::GetDockingClearance(Ship *s)
 	return false;
 }
 
+// size-of-ship vs size-of-bay check
+bool SpaceStation::PortFitsShip(Uint32 bay, const Ship *s) const
+{
+	const SpaceStationType::SPort *const pPort = m_type->FindPortByBay(bay);
+	if (!pPort) return false;
+
+	const Aabb &bbox = s->GetAabb();
+	const float bboxRad = vector2f(float(bbox.max.x), float(bbox.max.z)).Length();
+	return pPort->minShipSize < bboxRad && bboxRad < pPort->maxShipSize;
+}
+
+void SpaceStation::GrantClearance(Uint32 bay, Ship *s)
+{
+	const Aabb &bbox = s->GetAabb();
+	const float bboxRad = vector2f(float(bbox.max.x), float(bbox.max.z)).Length();
+
+	shipDocking_t &sd = m_shipDocking[bay];
+	sd.ship = s;
+	sd.stagePos = 0;
+	sd.maxOffset = calculate_max_offset_squared(m_type->FindPortByBay(bay)->maxShipSize, bboxRad);
+	LuaEvent::Queue("onDockingClearanceGranted", this, s);
+	SwitchToStage(bay, DockStage::CLEARANCE_GRANTED);
+}
+
+bool SpaceStation::QueueForDocking(Ship *s)
+{
+	if (std::find(m_dockingQueue.begin(), m_dockingQueue.end(), s) != m_dockingQueue.end())
+		return true;
+
+	for (Uint32 i = 0; i < m_shipDocking.size(); i++) {
+		if (PortFitsShip(i, s)) {
+			m_dockingQueue.push_back(s);
+			return true;
+		}
+	}
+	return false;
+}
+
+void SpaceStation::LeaveDockingQueue(const Ship *s)
+{
+	auto it = std::find(m_dockingQueue.begin(), m_dockingQueue.end(), s);
+	if (it != m_dockingQueue.end())
+		m_dockingQueue.erase(it);
+}
+
+// hand bays freed since the last update to the waiting ships, first come
+// first served among the ships that fit
+void SpaceStation::ServiceDockingQueue()
+{
+	m_bayFreed = false;
+	for (Uint32 i = 0; i < m_shipDocking.size() && !m_dockingQueue.empty(); i++) {
+		if (m_shipDocking[i].ship) continue;
+
+		for (auto it = m_dockingQueue.begin(); it != m_dockingQueue.end(); ++it) {
+			Ship *s = *it;
+			if (GetMyDockingPort(s) != -1 || !PortFitsShip(i, s)) continue;
+
+			m_dockingQueue.erase(it);
+			GrantClearance(i, s);
+			s->WakeUp();
+			break;
+		}
+	}
+}
+
 bool SpaceStation::OnCollision(Body *b, Uint32 flags, double relVel)
 {
 	if (!b->IsType(ObjectType::SHIP)) return true;
@@ -542,6 +594,7 @@ void SpaceStation::SwitchToStage(Uint32 bay, DockStage stage)
 		LockPort(bay, false);
 		m_doorAnimationStep = -0.3; // close door
 		SwitchToStage(bay, DockStage::NONE);
+		m_bayFreed = true;
 		break;
 
 	case DockStage::CLEARANCE_GRANTED:
@@ -590,6 +643,7 @@ void SpaceStation::DockingUpdate(const double timeStep)
 				dt.ship = nullptr;
 				m_doorAnimationStep = -0.3; // close door
 				SwitchToStage(i, DockStage::NONE);
+				m_bayFreed = true;
 			}
 			continue;
 
@@ -718,6 +772,7 @@ void SpaceStation::PositionDockedShip(Ship *ship, int bay) const
 void SpaceStation::StaticUpdate(const float timeStep)
 {
 	DockingUpdate(timeStep);
+	if (m_bayFreed) ServiceDockingQueue();
 	m_navLights->Update(timeStep);
 }
 
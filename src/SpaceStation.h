@@ -8,6 +8,8 @@
 #include "Quaternion.h"
 #include "SpaceStationType.h"
 
+#include <deque>
+
 #define MAX_DOCKING_PORTS 240 //256-(0x10), 0x10 is used because the collision surfaces use it as an identifying flag
 
 class Body;
@@ -66,6 +68,12 @@ public:
 	int GetNearbyTraffic(double radius);
 
 	bool GetDockingClearance(Ship *s);
+	// Waiting list for ships refused clearance because all suitable bays
+	// are busy. Bays are granted in order as they free up, and the ship is
+	// woken up (see DynamicBody::WakeUp) so the AI can start its approach.
+	// Returns false if no bay would ever fit the ship.
+	bool QueueForDocking(Ship *s);
+	void LeaveDockingQueue(const Ship *s);
 	int GetDockingPortCount() const { return m_type->NumDockingPorts(); }
 	int GetFreeDockingPort(const Ship *s) const; // returns -1 if none free
 	int GetMyDockingPort(const Ship *s) const;
@@ -123,12 +131,17 @@ private:
 	typedef std::vector<shipDocking_t>::const_iterator constShipDockingIter;
 	typedef std::vector<shipDocking_t>::iterator shipDockingIter;
 	std::vector<shipDocking_t> m_shipDocking;
+	std::deque<Ship *> m_dockingQueue; // not saved, the AI queues again after loading
+	bool m_bayFreed = false;
 
 	SpaceStationType::TPorts m_ports;
 
 	double m_oldAngDisplacement;
 
 	void SwitchToStage(Uint32 bay, DockStage stage);
+	bool PortFitsShip(Uint32 bay, const Ship *s) const;
+	void GrantClearance(Uint32 bay, Ship *s);
+	void ServiceDockingQueue();
 	matrix4x4d GetBayTransform(Uint32 bay) const;
 
 	void InitStation();
@@ -12,6 +12,7 @@
 #include "scenegraph/Model.h"
 #include "utils.h"
 #include "EnumStrings.h"
+#include "galaxy/SystemBody.h"
 
 #include <algorithm>
 
@@ -311,6 +312,21 @@ const SpaceStationType *SpaceStationType::FindByName(const std::string &name)
 	return nullptr;
 }
 
+/*static*/
+const SpaceStationType *SpaceStationType::ForSystemBody(const SystemBody *sbody, Random &rand)
+{
+	const SpaceStationType *type = nullptr;
+	const std::string &space_station_type = sbody->GetSpaceStationType();
+	if (space_station_type != "") {
+		type = FindByName(space_station_type);
+		if (type == nullptr)
+			Output("WARNING: SpaceStation::InitStation wants to initialize a custom station of type %s, but no station type with that id has been found.\n", space_station_type.c_str());
+	}
+	if (type == nullptr)
+		type = RandomStationType(rand, sbody->GetType() != SystemBody::TYPE_STARPORT_ORBITAL);
+	return type;
+}
+
 DockStage SpaceStationType::PivotStage(DockStage s) const {
 	switch (s) {
 		// at these stages, the position of the ship relative to the station has
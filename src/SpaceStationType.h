@@ -15,6 +15,7 @@
 //Space station definition, loaded from data/stations
 
 class Ship;
+class SystemBody;
 namespace SceneGraph {
 	class Model;
 }
@@ -165,6 +166,9 @@ public:
 
 	static const SpaceStationType *RandomStationType(Random &random, const bool bIsGround);
 	static const SpaceStationType *FindByName(const std::string &name);
+	// the type a station will be built as for the given SystemBody, drawing
+	// from rand (seeded from the body) in the same way the station itself does
+	static const SpaceStationType *ForSystemBody(const SystemBody *sbody, Random &rand);
 };
 
 #endif
@@ -0,0 +1,176 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include "vector3.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid over a set of points, hashed so that only occupied cells take
+// up any memory. Build() sorts the points by cell; radius queries then only
+// visit the cells overlapping the query sphere, or every occupied cell when
+// the query covers more cells than that.
+template <typename T>
+class SpatialHashGrid {
+public:
+	SpatialHashGrid(double cellSize) :
+		m_invCellSize(1.0 / cellSize)
+	{}
+
+	void Clear()
+	{
+		m_entries.clear();
+		m_cells.clear();
+		m_cellTable.clear();
+	}
+
+	void Reserve(size_t numEntries) { m_entries.reserve(numEntries); }
+
+	// points are added first, then Build() makes them available to queries
+	void Add(const T &value, const vector3d &pos)
+	{
+		m_entries.push_back({ GetCellCoord(pos), pos, value });
+	}
+
+	void Build()
+	{
+		// stable, so the order of the results only depends on the input
+		std::stable_sort(m_entries.begin(), m_entries.end(),
+			[](const Entry &a, const Entry &b) { return a.cell < b.cell; });
+
+		m_cells.clear();
+		for (uint32_t idx = 0; idx < m_entries.size(); idx++) {
+			if (m_cells.empty() || !(m_cells.back().coord == m_entries[idx].cell))
+				m_cells.push_back({ m_entries[idx].cell, idx, idx });
+			m_cells.back().end = idx + 1;
+		}
+
+		// open addressing hash table of cell indices, kept at most half full
+		size_t tableSize = 16;
+		while (tableSize < m_cells.size() * 2)
+			tableSize *= 2;
+
+		m_cellTable.assign(tableSize, INVALID_CELL);
+		m_tableMask = tableSize - 1;
+		for (uint32_t idx = 0; idx < m_cells.size(); idx++) {
+			size_t slot = HashCellCoord(m_cells[idx].coord) & m_tableMask;
+			while (m_cellTable[slot] != INVALID_CELL)
+				slot = (slot + 1) & m_tableMask;
+			m_cellTable[slot] = idx;
+		}
+	}
+
+	size_t GetNumEntries() const { return m_entries.size(); }
+	size_t GetNumCells() const { return m_cells.size(); }
+
+	// append every value within dist of pos to out
+	void QueryRadius(const vector3d &pos, double dist, std::vector<T> &out) const
+	{
+		if (m_cells.empty() || !(dist >= 0.0))
+			return;
+
+		const double distSqr = dist * dist;
+		const vector3d minCell = (pos - vector3d(dist)) * m_invCellSize;
+		const vector3d maxCell = (pos + vector3d(dist)) * m_invCellSize;
+		const vector3d minCoord(std::floor(minCell.x), std::floor(minCell.y), std::floor(minCell.z));
+		const vector3d maxCoord(std::floor(maxCell.x), std::floor(maxCell.y), std::floor(maxCell.z));
+		const vector3d span = maxCoord - minCoord + vector3d(1.0);
+
+		// a large query is cheaper to answer by walking the occupied cells
+		if (span.x * span.y * span.z > double(m_cells.size())) {
+			for (const Cell &cell : m_cells) {
+				if (double(cell.coord.x) < minCoord.x || double(cell.coord.x) > maxCoord.x ||
+					double(cell.coord.y) < minCoord.y || double(cell.coord.y) > maxCoord.y ||
+					double(cell.coord.z) < minCoord.z || double(cell.coord.z) > maxCoord.z)
+					continue;
+
+				QueryCell(cell, pos, distSqr, out);
+			}
+
+			return;
+		}
+
+		CellCoord coord;
+		for (coord.x = int64_t(minCoord.x); coord.x <= int64_t(maxCoord.x); coord.x++) {
+			for (coord.y = int64_t(minCoord.y); coord.y <= int64_t(maxCoord.y); coord.y++) {
+				for (coord.z = int64_t(minCoord.z); coord.z <= int64_t(maxCoord.z); coord.z++) {
+					const Cell *cell = FindCell(coord);
+					if (cell)
+						QueryCell(*cell, pos, distSqr, out);
+				}
+			}
+		}
+	}
+
+private:
+	struct CellCoord {
+		int64_t x, y, z;
+
+		bool operator==(const CellCoord &a) const { return x == a.x && y == a.y && z == a.z; }
+		bool operator<(const CellCoord &a) const
+		{
+			return x != a.x ? x < a.x : y != a.y ? y < a.y : z < a.z;
+		}
+	};
+
+	static constexpr uint32_t INVALID_CELL = ~0u;
+
+	static size_t HashCellCoord(const CellCoord &c)
+	{
+		// large primes, as suggested by Teschner et al. for spatial hashing
+		return size_t(uint64_t(c.x) * 73856093u ^ uint64_t(c.y) * 19349663u ^ uint64_t(c.z) * 83492791u);
+	}
+
+	struct Entry {
+		CellCoord cell;
+		vector3d pos;
+		T value;
+	};
+
+	struct Cell {
+		CellCoord coord;
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	CellCoord GetCellCoord(const vector3d &pos) const
+	{
+		return CellCoord{
+			int64_t(std::floor(pos.x * m_invCellSize)),
+			int64_t(std::floor(pos.y * m_invCellSize)),
+			int64_t(std::floor(pos.z * m_invCellSize))
+		};
+	}
+
+	const Cell *FindCell(const CellCoord &coord) const
+	{
+		size_t slot = HashCellCoord(coord) & m_tableMask;
+		while (m_cellTable[slot] != INVALID_CELL) {
+			const Cell &cell = m_cells[m_cellTable[slot]];
+			if (cell.coord == coord)
+				return &cell;
+			slot = (slot + 1) & m_tableMask;
+		}
+
+		return nullptr;
+	}
+
+	void QueryCell(const Cell &cell, const vector3d &pos, double distSqr, std::vector<T> &out) const
+	{
+		for (uint32_t idx = cell.begin; idx < cell.end; idx++) {
+			if ((m_entries[idx].pos - pos).LengthSqr() <= distSqr)
+				out.push_back(m_entries[idx].value);
+		}
+	}
+
+	double m_invCellSize;
+
+	std::vector<Entry> m_entries;
+	std::vector<Cell> m_cells;
+	std::vector<uint32_t> m_cellTable;
+	size_t m_tableMask = 0;
+};
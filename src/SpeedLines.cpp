@@ -10,6 +10,7 @@
 #include "core/IniConfig.h"
 #include "graphics/RenderState.h"
 #include "graphics/Renderer.h"
+#include "graphics/VertexWriter.h"
 
 // default values
 float SpeedLines::BOUNDS = 2000.f;
@@ -36,12 +37,7 @@ SpeedLines::SpeedLines(Ship *s) :
 		}
 	}
 
-	const Uint32 doubleNumPoints = static_cast<Uint32>(m_points.size()) * 2;
-	m_varray.reset(new Graphics::VertexArray(Graphics::ATTRIB_POSITION | Graphics::ATTRIB_DIFFUSE, doubleNumPoints));
-	for (Uint32 i = 0; i < doubleNumPoints; i++)
-		m_varray->Add(vector3f(0.0f), Color::BLACK);
-
-	CreateVertexBuffer(Pi::renderer, doubleNumPoints);
+	CreateMaterial(Pi::renderer);
 }
 
 void SpeedLines::Update(float time)
@@ -111,25 +107,20 @@ void SpeedLines::Render(Graphics::Renderer *r)
 
 	const vector3f dir = m_dir * m_lineLength;
 
-	Uint16 vtx = 0;
+	r->SetTransform(matrix4x4f(m_transform));
+	Graphics::VertexWriter<Graphics::VertexPosCol> out(r, m_material.Get(), Uint32(m_points.size()) * 2);
+
 	//distance fade
 	Color col(Color::GRAY);
 	for (auto it = m_points.begin(); it != m_points.end(); ++it) {
 		col.a = Clamp((1.f - it->Length() / BOUNDS), 0.f, 1.f) * 255;
 
-		m_varray->Set(vtx, *it - dir, col);
-		m_varray->Set(vtx + 1, *it + dir, col);
-
-		vtx += 2;
+		out.Add({ *it - dir, col });
+		out.Add({ *it + dir, col });
 	}
-
-	m_mesh->GetVertexBuffer()->Populate(*m_varray);
-
-	r->SetTransform(matrix4x4f(m_transform));
-	r->DrawMesh(m_mesh.get(), m_material.Get());
 }
 
-void SpeedLines::CreateVertexBuffer(Graphics::Renderer *r, const Uint32 size)
+void SpeedLines::CreateMaterial(Graphics::Renderer *r)
 {
 	PROFILE_SCOPED();
 	Graphics::MaterialDescriptor desc;
@@ -141,11 +132,6 @@ void SpeedLines::CreateVertexBuffer(Graphics::Renderer *r, const Uint32 size)
 	rsd.primitiveType = Graphics::LINE_SINGLE;
 
 	m_material.Reset(r->CreateMaterial("unlit", desc, rsd));
-
-	auto vbd = Graphics::VertexBufferDesc::FromAttribSet(m_varray->GetAttributeSet());
-	vbd.usage = Graphics::BUFFER_USAGE_DYNAMIC;
-	vbd.numVertices = size;
-	m_mesh.reset(r->CreateMeshObject(r->CreateVertexBuffer(vbd)));
 }
 
 void SpeedLines::Init()
@@ -5,11 +5,9 @@
 #define _SPEEDLINES_H
 
 #include "graphics/Material.h"
-#include "graphics/VertexBuffer.h"
 #include "matrix4x4.h"
 #include "vector3.h"
 
-#include <memory>
 #include <vector>
 
 namespace Graphics {
@@ -38,15 +36,14 @@ private:
 	static float SPACING;
 	static float MAX_VEL;
 
-	void CreateVertexBuffer(Graphics::Renderer *r, const Uint32 size);
+	void CreateMaterial(Graphics::Renderer *r);
 
 	Ship *m_ship;
 
 	std::vector<vector3f> m_points;
 
+	// the lines are written straight into the renderer's dynamic draw buffer
 	RefCountedPtr<Graphics::Material> m_material;
-	std::unique_ptr<Graphics::VertexArray> m_varray;
-	std::unique_ptr<Graphics::MeshObject> m_mesh;
 
 	matrix4x4d m_transform;
 
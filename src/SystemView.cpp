@@ -34,6 +34,8 @@
 using namespace Graphics;
 
 static constexpr Uint16 N_VERTICES_MAX = 100;
+// orbits small on screen are drawn with fewer vertices, down to this
+static constexpr Uint16 N_VERTICES_MIN = 24;
 static const float MIN_ZOOM = 1e-30f; // Just to avoid having 0
 static const float MAX_ZOOM = 1e30f;
 static const float MIN_ATLAS_ZOOM = 0.5f; // Just to avoid having 0
@@ -113,7 +115,7 @@ void SystemView::CalculateFramePositionAtTime(FrameId frameId, double t, vector3
 	else {
 		Frame *frame = Frame::GetFrame(frameId);
 		CalculateFramePositionAtTime(frame->GetParent(), t, pos);
-		pos += frame->GetSystemBody()->GetOrbit().OrbitalPosAtTime(t);
+		pos += frame->GetSystemBody()->GetOrbit().EphemerisPosAtTime(t);
 	}
 }
 
@@ -324,12 +326,11 @@ SystemMapViewport::SystemMapViewport(GuiApplication *app) :
 
 	Graphics::MaterialDescriptor lineMatDesc;
 
+	// orbits are collected as line segments and drawn together
 	Graphics::RenderStateDesc rsd;
-	rsd.primitiveType = Graphics::LINE_STRIP;
+	rsd.primitiveType = Graphics::LINE_SINGLE;
 
 	m_lineMat.reset(m_renderer->CreateMaterial("vtxColor", lineMatDesc, rsd)); //m_renderer not set yet
-
-	rsd.primitiveType = Graphics::LINE_SINGLE;
 	m_gridMat.reset(m_renderer->CreateMaterial("vtxColor", lineMatDesc, rsd));
 
 	ResetViewpoint();
@@ -408,17 +409,21 @@ void SystemMapViewport::SetCurrentSystem(RefCountedPtr<StarSystem> system)
 	ResetViewpoint();
 }
 
-void SystemMapViewport::RenderOrbit(const Projectable &p, const ProjectedOrbit *orbitData, const vector3d &offset)
+void SystemMapViewport::RenderOrbit(const Projectable &p, const ProjectedOrbit *orbitData, const vector3d &offset, double projectedSize)
 {
 	PROFILE_SCOPED()
 
+	// tessellate by how large the orbit is on screen
+	const Uint16 numSegments = Clamp<Uint16>(Uint16(std::min(projectedSize * 2.0, 1.0) * N_VERTICES_MAX), N_VERTICES_MIN, N_VERTICES_MAX);
+
 	double ecc = orbitData->orbit.GetEccentricity();
 	double timeshift = ecc > 0.6 ? 0.0 : 0.5;
 	double maxT = 1.;
 	unsigned short num_vertices = 0;
-	for (unsigned short i = 0; i < N_VERTICES_MAX; ++i) {
-		const double t = (double(i) + timeshift) / double(N_VERTICES_MAX);
-		const vector3d pos = orbitData->orbit.EvenSpacedPosTrajectory(t);
+	const double startTrueAnomaly = orbitData->orbit.TrueAnomalyAtTime(0.0);
+	for (unsigned short i = 0; i < numSegments; ++i) {
+		const double t = (double(i) + timeshift) / double(numSegments);
+		const vector3d pos = orbitData->orbit.EvenSpacedPosTrajectoryFrom(t, startTrueAnomaly);
 		if (pos.Length() < orbitData->planetRadius) {
 			maxT = t;
 			break;
@@ -430,11 +435,12 @@ void SystemMapViewport::RenderOrbit(const Projectable &p, const ProjectedOrbit *
 
 	Uint16 fadingColors = 0;
 	const double tMinust0 = p.base == Projectable::SYSTEMBODY ? m_time : m_time - m_refTime;
-	for (unsigned short i = 0; i < N_VERTICES_MAX; ++i) {
-		const double t = (double(i) + timeshift) / double(N_VERTICES_MAX) * maxT;
+	const double trueAnomaly = orbitData->orbit.TrueAnomalyAtTime(tMinust0);
+	for (unsigned short i = 0; i < numSegments; ++i) {
+		const double t = (double(i) + timeshift) / double(numSegments) * maxT;
 		if (fadingColors == 0 && t >= startTrailPercent * maxT)
 			fadingColors = i;
-		const vector3d pos = orbitData->orbit.EvenSpacedPosTrajectory(t, tMinust0);
+		const vector3d pos = orbitData->orbit.EvenSpacedPosTrajectoryFrom(t, trueAnomaly);
 		m_orbitVts[i] = vector3f(offset + pos);
 		++num_vertices;
 		if (pos.Length() < orbitData->planetRadius)
@@ -458,8 +464,13 @@ void SystemMapViewport::RenderOrbit(const Projectable &p, const ProjectedOrbit *
 			m_orbitColors[currentColor + fadingColors] = fadedColor * scalingParameter;
 		}
 
-		m_orbits.SetData(num_vertices, m_orbitVts.get(), m_orbitColors.get());
-		m_orbits.Draw(m_renderer, m_lineMat.get());
+		// append the strip to the orbit batch as separate segments
+		for (Uint16 i = 1; i < num_vertices; ++i) {
+			m_orbitLineVts.push_back(m_orbitVts[i - 1]);
+			m_orbitLineVts.push_back(m_orbitVts[i]);
+			m_orbitLineColors.push_back(m_orbitColors[i - 1]);
+			m_orbitLineColors.push_back(m_orbitColors[i]);
+		}
 	}
 
 	AddProjected(p, Projectable::PERIAPSIS, offset + orbitData->orbit.Perigeum());
@@ -514,6 +525,10 @@ void SystemMapViewport::AddBodyTrack(const SystemBody *b, const vector3d &offset
 				continue;
 			}
 
+			// body orbits don't change, so this builds their ephemeris once and
+			// the copy in the orbit track below shares it
+			const vector3d kidPos = kid->GetOrbit().EphemerisPosAtTime(m_time);
+
 			if (!is_zero_general(kid->GetOrbit().GetSemiMajorAxis())) {
 				// Add the body's orbit
 				Projectable p(Projectable::ORBIT, Projectable::SYSTEMBODY, kid);
@@ -522,7 +537,7 @@ void SystemMapViewport::AddBodyTrack(const SystemBody *b, const vector3d &offset
 			}
 
 			// not using current time yet
-			AddBodyTrack(kid, offset + kid->GetOrbit().OrbitalPosAtTime(m_time));
+			AddBodyTrack(kid, offset + kidPos);
 		}
 	}
 }
@@ -656,6 +671,9 @@ void SystemMapViewport::DrawOrreryView()
 		m_trans = m_viewedObject.worldpos;
 	}
 
+	m_orbitLineVts.clear();
+	m_orbitLineColors.clear();
+
 	// Transform all tracks + render system bodies
 	for (auto &track : m_objectTracks) {
 		m_renderer->SetTransform(m_cameraSpace);
@@ -667,8 +685,9 @@ void SystemMapViewport::DrawOrreryView()
 
 			//semimajor axis radius should be at least 1% of screen width to show the orbit
 			//FIXME: this has never worked, the returned size is not in screen %
-			if (ProjectedSize(axisZoom, viewpos) > 0.01) {
-				RenderOrbit(track, orbitData, viewpos);
+			const double projectedSize = ProjectedSize(axisZoom, viewpos);
+			if (projectedSize > 0.01) {
+				RenderOrbit(track, orbitData, viewpos, projectedSize);
 			}
 		} else {
 			AddProjected(track, track.type, viewpos);
@@ -681,6 +700,12 @@ void SystemMapViewport::DrawOrreryView()
 
 	m_renderer->SetTransform(m_cameraSpace);
 
+	// all orbit lines in a single draw
+	if (!m_orbitLineVts.empty()) {
+		m_orbits.SetData(m_orbitLineVts.size(), m_orbitLineVts.data(), m_orbitLineColors.data());
+		m_orbits.Draw(m_renderer, m_lineMat.get());
+	}
+
 	if (m_gridDrawing != GridDrawing::OFF) {
 		// calculate lines for this system:
 		DrawGrid(std::floor(m_system->GetRootBody()->GetMaxChildOrbitalDistance() * 1.2 / AU));
@@ -177,6 +177,7 @@ public:
 	~SystemView() override;
 	void Update() override;
 	void Draw3D() override;
+	bool HasScene() override { return true; }
 	void OnSwitchFrom() override;
 
 	Mode GetDisplayMode() { return m_displayMode; }
@@ -333,7 +334,8 @@ private:
 	// Project a track to screenspace with the current renderer state and add it to the list of projected objects
 	void AddProjected(Projectable p, Projectable::types type, const vector3d &transformedPos, float screensize = 0.f);
 	void RenderBody(const SystemBody *b, const vector3d &pos, const matrix4x4f &trans);
-	void RenderOrbit(const Projectable &p, const ProjectedOrbit *orbitData, const vector3d &transformedPos);
+	// Add the orbit's line to the orbit batch, which is drawn after all tracks
+	void RenderOrbit(const Projectable &p, const ProjectedOrbit *orbitData, const vector3d &transformedPos, double projectedSize);
 
 	// draw a grid with `radius` * 2 gridlines on an evenly spaced 1-AU grid
 	void DrawGrid(uint32_t radius);
@@ -392,6 +394,9 @@ private:
 
 	std::unique_ptr<vector3f[]> m_orbitVts;
 	std::unique_ptr<Color[]> m_orbitColors;
+	// line segments of every orbit drawn this frame
+	std::vector<vector3f> m_orbitLineVts;
+	std::vector<Color> m_orbitLineColors;
 
 	std::unique_ptr<Graphics::VertexArray> m_lineVerts;
 	Graphics::Drawables::Lines m_lines;
@@ -12,6 +12,9 @@
 #include "galaxy/SystemBody.h"
 #include "graphics/Renderer.h"
 
+// starts at one so that the zero-initialised cache entries never match
+std::atomic<Uint32> TerrainBody::s_heightCacheGeneration{ 1 };
+
 TerrainBody::TerrainBody(SystemBody *sbody) :
 	Body(),
 	m_sbody(sbody),
@@ -68,36 +71,13 @@ TerrainBody::TerrainBody(const Json &jsonObj, Space *space) :
 
 void TerrainBody::Render(Graphics::Renderer *renderer, const Camera *camera, const vector3d &viewCoords, const matrix4x4d &viewTransform)
 {
+	// Bodies are drawn at their true distance, however far away: the camera
+	// projection has no far plane and the floating-point reverse-Z depth
+	// buffer keeps enough precision to sort them against the foreground.
 	matrix4x4d ftran = viewTransform;
-	vector3d fpos = viewCoords;
-	double rad = m_sbody->GetRadius();
-
-	float znear, zfar;
-	renderer->GetNearFarRange(znear, zfar);
-
-	//stars very far away are downscaled, because they cannot be
-	//accurately drawn using actual distances
-	int shrink = 0;
-	if (m_sbody->GetSuperType() == SystemBody::SUPERTYPE_STAR) {
-		double len = fpos.Length();
-		double dist_to_horizon;
-		for (;;) {
-			if (len < rad) // player inside radius case
-				break;
-
-			dist_to_horizon = sqrt(len * len - rad * rad);
-
-			if (dist_to_horizon < zfar * 0.5)
-				break;
-
-			rad *= 0.25;
-			fpos = 0.25 * fpos;
-			len *= 0.25;
-			++shrink;
-		}
-	}
+	const double rad = m_sbody->GetRadius();
 
-	vector3d campos = fpos;
+	vector3d campos = viewCoords;
 	ftran.ClearToRotOnly();
 	campos = campos * ftran;
 
@@ -118,10 +98,6 @@ void TerrainBody::Render(Graphics::Renderer *renderer, const Camera *camera, con
 
 	ftran.Translate(campos.x, campos.y, campos.z);
 	SubRender(renderer, ftran, campos);
-
-	//clear depth buffer, shrunken objects should not interact with foreground
-	if (shrink)
-		renderer->ClearDepthBuffer();
 }
 
 void TerrainBody::SetFrame(FrameId fId)
@@ -142,17 +118,51 @@ void TerrainBody::SetFrame(FrameId fId)
 double TerrainBody::GetTerrainHeight(const vector3d &pos_) const
 {
 	double radius = m_sbody->GetRadius();
-	if (m_baseSphere) {
-		return radius * (1.0 + m_baseSphere->GetHeight(pos_));
-	} else {
+	if (!m_baseSphere) {
 		assert(0);
 		return radius;
 	}
+
+	// only exact repeats are answered from the cache, so the result is the
+	// same as evaluating the terrain
+	const Uint32 generation = s_heightCacheGeneration.load(std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(m_heightCacheLock);
+		for (const HeightSample &sample : m_heightCache) {
+			if (sample.generation == generation && sample.pos == pos_)
+				return sample.height;
+		}
+	}
+
+	// the terrain is evaluated outside the lock, so parallel contact
+	// queries against the same planet don't wait on each other
+	const double height = radius * (1.0 + m_baseSphere->GetHeight(pos_));
+
+	std::lock_guard<std::mutex> lock(m_heightCacheLock);
+	m_heightCache[m_heightCacheNext] = { pos_, height, generation };
+	m_heightCacheNext = (m_heightCacheNext + 1) % HEIGHT_CACHE_SIZE;
+	return height;
+}
+
+void TerrainBody::GetTerrainHeights(const vector3d *pos, double *heights, size_t count) const
+{
+	const double radius = m_sbody->GetRadius();
+	if (!m_baseSphere) {
+		assert(0);
+		std::fill_n(heights, count, radius);
+		return;
+	}
+
+	m_baseSphere->GetHeights(pos, heights, count);
+	for (size_t i = 0; i < count; i++)
+		heights[i] = radius * (1.0 + heights[i]);
 }
 
 //static
 void TerrainBody::OnChangeDetailLevel()
 {
+	// the terrain is about to be rebuilt, so forget every cached height
+	++s_heightCacheGeneration;
 	GeoSphere::OnChangeDetailLevel();
 	GasGiant::OnChangeDetailLevel();
 }
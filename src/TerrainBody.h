@@ -8,6 +8,9 @@
 #include "JsonFwd.h"
 #include "matrix4x4.h"
 
+#include <atomic>
+#include <mutex>
+
 class BaseSphere;
 class Camera;
 class Frame;
@@ -28,6 +31,8 @@ public:
 	virtual bool OnCollision(Body *b, Uint32 flags, double relVel) override { return true; }
 	virtual double GetMass() const override { return m_mass; }
 	double GetTerrainHeight(const vector3d &pos) const;
+	// GetTerrainHeight for count positions at once, bypassing the cache
+	void GetTerrainHeights(const vector3d *pos, double *heights, size_t count) const;
 	virtual const SystemBody *GetSystemBody() const override { return m_sbody; }
 
 	// returns value in metres
@@ -51,6 +56,20 @@ private:
 	double m_mass;
 	std::unique_ptr<BaseSphere> m_baseSphere;
 	double m_maxFeatureHeight;
+
+	// Recent GetTerrainHeight results. Collision, landed ships, the AI and
+	// the altimeter ask about the same few points every step, and each
+	// fresh answer evaluates the whole fractal.
+	struct HeightSample {
+		vector3d pos;
+		double height;
+		Uint32 generation; // s_heightCacheGeneration when sampled
+	};
+	static constexpr int HEIGHT_CACHE_SIZE = 16;
+	static std::atomic<Uint32> s_heightCacheGeneration; // bumped when the terrain changes
+	mutable HeightSample m_heightCache[HEIGHT_CACHE_SIZE] = {};
+	mutable int m_heightCacheNext = 0;
+	mutable std::mutex m_heightCacheLock;
 };
 
 #endif
@@ -28,6 +28,12 @@ public:
 	virtual void Update() = 0;
 	// Called during the pigui frame to draw UI
 	virtual void DrawPiGui(){};
+	// False if Draw3D() draws nothing at all
+	virtual bool HasScene() { return true; }
+	// True if Draw3D() would draw the same image as it did last frame, so
+	// that it can be redrawn from a cached copy at a lower frame rate.
+	// Valid after Update().
+	virtual bool IsSceneStatic() { return false; }
 	virtual void SaveToJson(Json &jsonObj) {}
 	virtual void LoadFromJson(const Json &jsonObj) {}
 
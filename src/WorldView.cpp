@@ -7,6 +7,7 @@
 #include "Game.h"
 #include "GameConfig.h"
 #include "GameSaveError.h"
+#include "GeoSphere.h"
 #include "HudTrail.h"
 #include "HyperspaceCloud.h"
 #include "Input.h"
@@ -19,6 +20,7 @@
 #include "Sensors.h"
 #include "SpeedLines.h"
 #include "StringF.h"
+#include "core/PerfTimeline.h"
 #include "graphics/Frustum.h"
 #include "graphics/Graphics.h"
 #include "graphics/Material.h"
@@ -29,6 +31,8 @@
 #include "ship/ShipViewController.h"
 #include "sound/Sound.h"
 
+#include <cstring>
+
 WorldView::~WorldView() {}
 
 namespace {
@@ -209,6 +213,7 @@ void WorldView::OnToggleLabels()
 void WorldView::Update()
 {
 	PROFILE_SCOPED()
+	PERF_ZONE("WorldView Update")
 	assert(m_game);
 	assert(Pi::player);
 	assert(!Pi::player->IsDead());
@@ -218,6 +223,19 @@ void WorldView::Update()
 	m_cameraContext->BeginFrame();
 	m_camera->Update();
 
+	// while paused, nothing moves unless the camera does, apart from terrain
+	// patches streaming in
+	const bool cameraMoved = m_cameraContext->GetCameraFrame() != m_lastCameraFrame ||
+		!(m_cameraContext->GetCameraPos() == m_lastCameraPos) ||
+		m_cameraContext->GetFovAng() != m_lastCameraFov ||
+		memcmp(&m_cameraContext->GetCameraOrient()[0], &m_lastCameraOrient[0], sizeof(matrix3x3d)) != 0;
+	m_sceneStatic = m_game->IsPaused() && !cameraMoved && GeoSphere::GetFrameBudget().resultsProcessed == 0;
+
+	m_lastCameraFrame = m_cameraContext->GetCameraFrame();
+	m_lastCameraPos = m_cameraContext->GetCameraPos();
+	m_lastCameraOrient = m_cameraContext->GetCameraOrient();
+	m_lastCameraFov = m_cameraContext->GetFovAng();
+
 	UpdateProjectedObjects();
 
 	FrameId playerFrameId = Pi::player->GetFrame();
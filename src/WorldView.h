@@ -5,7 +5,9 @@
 #define _WORLDVIEW_H
 
 #include "ConnectionTicket.h"
+#include "FrameId.h"
 #include "graphics/Drawables.h"
+#include "matrix3x3.h"
 #include "pigui/PiGuiView.h"
 #include "ship/ShipViewController.h"
 
@@ -38,6 +40,8 @@ public:
 	void Update() override;
 	void Draw3D() override;
 	void Draw() override;
+	bool HasScene() override { return true; }
+	bool IsSceneStatic() override { return m_sceneStatic; }
 	void SaveToJson(Json &jsonObj) override;
 
 	RefCountedPtr<CameraContext> GetCameraContext() const { return m_cameraContext; }
@@ -118,6 +122,14 @@ private:
 	RefCountedPtr<CameraContext> m_cameraContext;
 	std::unique_ptr<Camera> m_camera;
 
+	// the camera as of the last Update(), to tell whether a paused scene has
+	// changed
+	bool m_sceneStatic = false;
+	FrameId m_lastCameraFrame;
+	vector3d m_lastCameraPos;
+	matrix3x3d m_lastCameraOrient;
+	float m_lastCameraFov = 0.f;
+
 	Indicator m_combatTargetIndicator;
 	Indicator m_targetLeadIndicator;
 
@@ -0,0 +1,121 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "Benchmark.h"
+#include "collider/BVHTree.h"
+#include "collider/GeomTree.h"
+
+#include <memory>
+#include <random>
+
+static constexpr uint32_t NUM_OBJECTS = 20000;
+static constexpr uint32_t NUM_QUERIES = 20000;
+static constexpr uint32_t NUM_TRIANGLES = 200000;
+static constexpr uint32_t NUM_RAYS = 1 << 15;
+
+// objects scattered through a space the size of a busy orbit
+static std::vector<AABBd> MakeObjectAabbs(AABBd &bounds)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<double> pos(-1000.0, 1000.0);
+	std::uniform_real_distribution<double> size(0.1, 10.0);
+
+	std::vector<AABBd> aabbs(NUM_OBJECTS);
+	bounds = AABBd::Invalid();
+	for (AABBd &aabb : aabbs) {
+		const vector3d center(pos(rng), pos(rng), pos(rng));
+		const vector3d extent(size(rng), size(rng), size(rng));
+		aabb = AABBd{ center - extent, center + extent };
+		bounds.Update(aabb);
+	}
+
+	return aabbs;
+}
+
+static void BVHTreeBuild(Bench::Run &run)
+{
+	AABBd bounds;
+	std::vector<AABBd> aabbs = MakeObjectAabbs(bounds);
+
+	BinnedAreaBVHTree tree;
+	run.Measure(NUM_OBJECTS, [&]() {
+		tree.Build(bounds, aabbs.data(), aabbs.size());
+	});
+
+	Bench::Consume(tree.GetNumNodes());
+}
+
+static void BVHTreeOverlap(Bench::Run &run)
+{
+	AABBd bounds;
+	std::vector<AABBd> aabbs = MakeObjectAabbs(bounds);
+
+	BinnedAreaBVHTree tree;
+	tree.Build(bounds, aabbs.data(), aabbs.size());
+	CompactBVHTree compactTree;
+	compactTree.Build(tree);
+
+	std::vector<uint32_t> isect;
+	size_t numFound = 0;
+	run.Measure(NUM_QUERIES, [&]() {
+		for (uint32_t i = 0; i < NUM_QUERIES; i++) {
+			isect.clear();
+			compactTree.ComputeOverlap(aabbs[i % NUM_OBJECTS], isect);
+			numFound += isect.size();
+		}
+	});
+
+	Bench::Consume(numFound);
+}
+
+// a soup of randomly placed triangles, standing in for the collision mesh
+// of a large station
+static std::unique_ptr<GeomTree> MakeGeomTree()
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> pos(-500.f, 500.f);
+	std::uniform_real_distribution<float> offset(-20.f, 20.f);
+
+	std::vector<vector3f> vertices;
+	std::vector<Uint32> indices;
+	std::vector<Uint32> triFlags(NUM_TRIANGLES, 0);
+	for (uint32_t tri = 0; tri < NUM_TRIANGLES; tri++) {
+		const vector3f center(pos(rng), pos(rng), pos(rng));
+		for (uint32_t i = 0; i < 3; i++) {
+			indices.push_back(vertices.size());
+			vertices.push_back(center + vector3f(offset(rng), offset(rng), offset(rng)));
+		}
+	}
+
+	return std::make_unique<GeomTree>(vertices.size(), NUM_TRIANGLES, vertices, indices, triFlags);
+}
+
+static void GeomTreeTraceRay(Bench::Run &run)
+{
+	// building the tree takes far longer than tracing through it
+	static std::unique_ptr<GeomTree> tree = MakeGeomTree();
+
+	std::mt19937 rng(5678);
+	std::uniform_real_distribution<float> pos(-600.f, 600.f);
+	std::uniform_real_distribution<float> unit(-1.f, 1.f);
+	std::vector<vector3f> starts(NUM_RAYS), dirs(NUM_RAYS);
+	for (uint32_t i = 0; i < NUM_RAYS; i++) {
+		starts[i] = vector3f(pos(rng), pos(rng), pos(rng));
+		dirs[i] = vector3f(unit(rng), unit(rng), unit(rng)).NormalizedSafe();
+	}
+
+	double sumDist = 0.0;
+	run.Measure(NUM_RAYS, [&]() {
+		for (uint32_t i = 0; i < NUM_RAYS; i++) {
+			isect_t isect{ -1, 1000.f };
+			tree->TraceRay(starts[i], dirs[i], &isect);
+			sumDist += isect.dist;
+		}
+	});
+
+	Bench::Consume(sumDist);
+}
+
+BENCHMARK("BVHTree/Build", BVHTreeBuild);
+BENCHMARK("BVHTree/ComputeOverlap", BVHTreeOverlap);
+BENCHMARK("GeomTree/TraceRay", GeomTreeTraceRay);
@@ -0,0 +1,120 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "Benchmark.h"
+#include "Frame.h"
+#include "Orbit.h"
+
+#include <cfloat>
+#include <random>
+
+static constexpr uint32_t NUM_PLANETS = 8;
+static constexpr uint32_t MOONS_PER_PLANET = 3;
+static constexpr uint32_t NUM_TRANSFORMS = 100000;
+static constexpr uint32_t NUM_ORBITS = 1000;
+static constexpr uint32_t NUM_POSITIONS = 100000;
+
+// A frame and its rotating child, as Space builds for a body
+static void AddBodyFrames(FrameId parent, const vector3d &pos, double angSpeed, std::vector<FrameId> &frames)
+{
+	const FrameId frame = Frame::CreateFrame(parent, "body", Frame::FLAG_HAS_ROT, 1e8);
+	Frame::GetFrame(frame)->SetPosition(pos);
+	frames.push_back(frame);
+
+	const FrameId rotFrame = Frame::CreateFrame(frame, "body rot", Frame::FLAG_ROTATING, 1e7);
+	Frame *rot = Frame::GetFrame(rotFrame);
+	rot->SetAngSpeed(angSpeed);
+	rot->SetOrient(matrix3x3d::RotateX(0.4), 0.0);
+	frames.push_back(rotFrame);
+}
+
+static void FrameGetFrameTransform(Bench::Run &run)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<double> dist(1e9, 1e12);
+	std::uniform_real_distribution<double> angle(-M_PI, M_PI);
+
+	std::vector<FrameId> frames;
+	const FrameId root = Frame::CreateFrame(FrameId::Invalid, "system", Frame::FLAG_DEFAULT, FLT_MAX);
+	frames.push_back(root);
+	for (uint32_t planet = 0; planet < NUM_PLANETS; planet++) {
+		const FrameId planetFrame = FrameId(frames.size());
+		AddBodyFrames(root, matrix3x3d::RotateY(angle(rng)) * vector3d(dist(rng), 0.0, 0.0), 7e-5, frames);
+		for (uint32_t moon = 0; moon < MOONS_PER_PLANET; moon++)
+			AddBodyFrames(planetFrame, matrix3x3d::RotateY(angle(rng)) * vector3d(dist(rng) * 1e-3, 0.0, 0.0), 3e-6, frames);
+	}
+
+	// fills in the root-relative transforms GetFrameTransform reads
+	Frame::UpdateOrbitRails(0.0, 1.0);
+
+	std::uniform_int_distribution<size_t> pick(0, frames.size() - 1);
+	std::vector<std::pair<FrameId, FrameId>> pairs(NUM_TRANSFORMS);
+	for (auto &pair : pairs)
+		pair = { frames[pick(rng)], frames[pick(rng)] };
+
+	double sum = 0.0;
+	run.Measure(NUM_TRANSFORMS, [&]() {
+		matrix4x4d m;
+		for (const auto &pair : pairs) {
+			Frame::GetFrameTransform(pair.first, pair.second, m);
+			sum += m[12];
+		}
+	});
+
+	Frame::DeleteFrames();
+	Bench::Consume(sum);
+}
+
+// a system's worth of moons and asteroids on random, mostly elliptic orbits
+static std::vector<Orbit> MakeOrbits()
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<double> axis(1e7, 1e12);
+	std::uniform_real_distribution<double> ecc(0.0, 0.9);
+	std::uniform_real_distribution<double> angle(-M_PI, M_PI);
+
+	std::vector<Orbit> orbits(NUM_ORBITS);
+	for (Orbit &orbit : orbits) {
+		orbit.SetShapeAroundPrimary(axis(rng), 2e30, ecc(rng));
+		orbit.SetPlane(matrix3x3d::RotateY(angle(rng)) * matrix3x3d::RotateX(angle(rng)));
+		orbit.SetPhase(angle(rng));
+	}
+
+	return orbits;
+}
+
+static void OrbitOrbitalPosAtTime(Bench::Run &run)
+{
+	const std::vector<Orbit> orbits = MakeOrbits();
+
+	vector3d sum(0.0);
+	run.Measure(NUM_POSITIONS, [&]() {
+		for (uint32_t i = 0; i < NUM_POSITIONS; i++)
+			sum += orbits[i % NUM_ORBITS].OrbitalPosAtTime(i * 3600.0);
+	});
+
+	Bench::Consume(sum.x + sum.y + sum.z);
+}
+
+static void OrbitOrbitalPosAtTimes(Bench::Run &run)
+{
+	const std::vector<Orbit> orbits = MakeOrbits();
+
+	std::vector<const Orbit *> orbitPtrs(NUM_POSITIONS);
+	std::vector<double> times(NUM_POSITIONS);
+	std::vector<vector3d> positions(NUM_POSITIONS);
+	for (uint32_t i = 0; i < NUM_POSITIONS; i++) {
+		orbitPtrs[i] = &orbits[i % NUM_ORBITS];
+		times[i] = i * 3600.0;
+	}
+
+	run.Measure(NUM_POSITIONS, [&]() {
+		Orbit::OrbitalPosAtTimes(NUM_POSITIONS, orbitPtrs.data(), times.data(), positions.data());
+	});
+
+	Bench::Consume(positions.back().x);
+}
+
+BENCHMARK("Frame/GetFrameTransform", FrameGetFrameTransform);
+BENCHMARK("Orbit/OrbitalPosAtTime", OrbitOrbitalPosAtTime);
+BENCHMARK("Orbit/OrbitalPosAtTimes", OrbitOrbitalPosAtTimes);
@@ -0,0 +1,61 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "Benchmark.h"
+#include "Json.h"
+
+#include <string>
+#include <vector>
+
+static constexpr int NUM_BODIES = 5000;
+
+// shaped like the body list of a saved game: objects of mixed values with
+// nested arrays
+static Json MakeSaveJson()
+{
+	Json root = Json::object();
+	Json bodies = Json::array();
+	for (int i = 0; i < NUM_BODIES; i++) {
+		Json body = Json::object();
+		body["index"] = i;
+		body["label"] = "Body " + std::to_string(i * 7919 % 10007);
+		body["frame"] = i % 17;
+		body["is_dead"] = false;
+		body["pos"] = Json::array({ i * 0.5, -i * 1.25, double(i * i) });
+		body["vel"] = Json::array({ i * 0.01, 3.5, -i * 0.02 });
+		body["orient"] = Json::array({ 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 });
+		body["properties"] = Json::object({ { "mass", 1000.0 + i }, { "shield", 0.75 }, { "model", "kanara" } });
+		bodies.push_back(body);
+	}
+	root["bodies"] = bodies;
+	root["time"] = 3.2e9;
+	return root;
+}
+
+static void SaveEncodeCBOR(Bench::Run &run)
+{
+	const Json root = MakeSaveJson();
+
+	std::vector<uint8_t> cbor;
+	run.Measure(NUM_BODIES, [&]() {
+		cbor = Json::to_cbor(root);
+	});
+
+	Bench::Consume(cbor.size());
+}
+
+static void SaveEncodeJson(Bench::Run &run)
+{
+	const Json root = MakeSaveJson();
+
+	std::string text;
+	run.Measure(NUM_BODIES, [&]() {
+		text = root.dump();
+	});
+
+	Bench::Consume(text.size());
+}
+
+// ops are bodies, so the figures read as the cost of one body's worth of save
+BENCHMARK("Save/EncodeCBOR", SaveEncodeCBOR);
+BENCHMARK("Save/EncodeJson", SaveEncodeJson);
@@ -0,0 +1,66 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "Benchmark.h"
+#include "core/StringName.h"
+#include "lua/Lua.h"
+#include "lua/LuaPushPull.h"
+
+#include <fmt/core.h>
+
+#include <string>
+#include <vector>
+
+static constexpr uint32_t NUM_NAMES = 1024;
+static constexpr uint32_t NUM_NAME_PASSES = 16;
+static constexpr uint32_t NUM_ROUND_TRIPS = 100000;
+
+// Long enough not to fit the small string buffer, so every name goes
+// through the shared string table
+static void StringNameCreate(Bench::Run &run)
+{
+	std::vector<std::string> strings;
+	for (uint32_t i = 0; i < NUM_NAMES; i++)
+		strings.push_back(fmt::format("model/ship/part_{}_lod0", i));
+
+	std::vector<StringName> names;
+	names.reserve(NUM_NAMES);
+	size_t sum = 0;
+	run.Measure(NUM_NAMES * NUM_NAME_PASSES, [&]() {
+		for (uint32_t pass = 0; pass < NUM_NAME_PASSES; pass++) {
+			for (const std::string &str : strings)
+				names.emplace_back(str);
+			sum += names.back().size();
+			names.clear();
+		}
+	});
+
+	Bench::Consume(sum);
+}
+
+// a value of each of the common types pushed to Lua and pulled back
+static void LuaPushPullRoundTrip(Bench::Run &run)
+{
+	lua_State *l = luaL_newstate();
+	const std::string text = "Pioneer";
+
+	double sum = 0.0;
+	run.Measure(NUM_ROUND_TRIPS, [&]() {
+		for (uint32_t i = 0; i < NUM_ROUND_TRIPS; i++) {
+			LuaPush<bool>(l, i & 1);
+			LuaPush<int>(l, int(i));
+			LuaPush<double>(l, i * 0.5);
+			LuaPush<std::string>(l, text);
+
+			sum += LuaPull<bool>(l, -4) + LuaPull<int>(l, -3) + LuaPull<double>(l, -2);
+			sum += LuaPull<std::string>(l, -1).size();
+			lua_pop(l, 4);
+		}
+	});
+
+	lua_close(l);
+	Bench::Consume(sum);
+}
+
+BENCHMARK("StringName/Create", StringNameCreate);
+BENCHMARK("LuaPushPull/RoundTrip", LuaPushPullRoundTrip);
@@ -0,0 +1,142 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "Benchmark.h"
+#include "JobQueue.h"
+#include "core/TaskGraph.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// TaskGraph/Tasks and TaskGraph/NestedTasks are also measured with
+// different numbers of worker threads, as TaskGraph/Tasks/<threads>
+
+static constexpr uint32_t NUM_WORKER_THREADS = 4;
+static constexpr uint32_t NUM_SETS = 64;
+static constexpr uint32_t TASKS_PER_SET = 256;
+static constexpr uint32_t NESTED_LAUNCHERS = 16;
+static constexpr uint32_t NUM_JOBS = 4096;
+
+static std::atomic<uint32_t> s_numExecuted = 0;
+
+// shared by the benchmarks, so worker threads are only started once for
+// each number of them
+static TaskGraph *GetTaskGraph(uint32_t numThreads = NUM_WORKER_THREADS)
+{
+	static std::map<uint32_t, std::unique_ptr<TaskGraph>> graphs;
+	std::unique_ptr<TaskGraph> &graph = graphs[numThreads];
+	if (!graph) {
+		graph = std::make_unique<TaskGraph>();
+		graph->SetWorkerThreads(numThreads);
+	}
+	return graph.get();
+}
+
+// a little busywork, so the scheduler isn't measured on empty tasks
+static void BusyWork(uint32_t seed)
+{
+	volatile uint32_t accum = seed;
+	for (uint32_t i = 0; i < 64; i++)
+		accum = accum * 2654435761u + i;
+}
+
+class BenchTask : public Task {
+public:
+	void OnExecute(TaskRange range) override
+	{
+		BusyWork(range.begin);
+		s_numExecuted.fetch_add(1, std::memory_order_relaxed);
+	}
+};
+
+class BenchJob : public Job {
+public:
+	void OnRun() override { BusyWork(0); }
+	void OnFinish() override { s_numExecuted.fetch_add(1, std::memory_order_relaxed); }
+};
+
+static void TaskGraphThroughput(Bench::Run &run, uint32_t numThreads)
+{
+	TaskGraph *graph = GetTaskGraph(numThreads);
+	s_numExecuted = 0;
+
+	run.Measure(NUM_SETS * TASKS_PER_SET, [&]() {
+		for (uint32_t set = 0; set < NUM_SETS; set++) {
+			TaskSet *taskSet = new TaskSet();
+			for (uint32_t i = 0; i < TASKS_PER_SET; i++)
+				taskSet->AddTask(new BenchTask());
+
+			TaskSet::Handle handle = graph->QueueTaskSet(taskSet);
+			graph->WaitForTaskSet(handle);
+		}
+	});
+
+	Bench::Consume(s_numExecuted.load());
+}
+
+// task sets queued from inside tasks running on worker threads
+static void TaskGraphNestedThroughput(Bench::Run &run, uint32_t numThreads)
+{
+	TaskGraph *graph = GetTaskGraph(numThreads);
+	s_numExecuted = 0;
+
+	run.Measure(NUM_SETS * TASKS_PER_SET, [&]() {
+		for (uint32_t set = 0; set < NUM_SETS / NESTED_LAUNCHERS; set++) {
+			TaskSet *launchSet = new TaskSet();
+			for (uint32_t launcher = 0; launcher < NESTED_LAUNCHERS; launcher++) {
+				launchSet->AddTaskLambda({}, [=](TaskRange) {
+					TaskSet *nested = new TaskSet();
+					for (uint32_t i = 0; i < TASKS_PER_SET; i++)
+						nested->AddTask(new BenchTask());
+
+					TaskSet::Handle handle = graph->QueueTaskSet(nested);
+					graph->WaitForTaskSet(handle);
+				});
+			}
+
+			TaskSet::Handle handle = graph->QueueTaskSet(launchSet);
+			graph->WaitForTaskSet(handle);
+		}
+	});
+
+	Bench::Consume(s_numExecuted.load());
+}
+
+// jobs are finished on the queuing thread, so this includes the round trip
+static void JobQueueThroughput(Bench::Run &run)
+{
+	JobQueue *queue = GetTaskGraph()->GetJobQueue();
+	s_numExecuted = 0;
+
+	// dropping a handle would cancel its job
+	std::vector<Job::Handle> handles;
+	handles.reserve(NUM_JOBS);
+
+	run.Measure(NUM_JOBS, [&]() {
+		for (uint32_t i = 0; i < NUM_JOBS; i++)
+			handles.push_back(queue->Queue(new BenchJob()));
+
+		while (s_numExecuted.load() < NUM_JOBS)
+			queue->FinishJobs();
+	});
+
+	Bench::Consume(s_numExecuted.load());
+}
+
+static bool RegisterTaskGraphBenchmarks()
+{
+	Bench::Register("TaskGraph/Tasks", [](Bench::Run &run) { TaskGraphThroughput(run, NUM_WORKER_THREADS); });
+	Bench::Register("TaskGraph/NestedTasks", [](Bench::Run &run) { TaskGraphNestedThroughput(run, NUM_WORKER_THREADS); });
+	for (uint32_t numThreads = 1; numThreads <= MAX_THREADS; numThreads *= 2) {
+		const std::string threads = std::to_string(numThreads);
+		Bench::Register("TaskGraph/Tasks/" + threads, [=](Bench::Run &run) { TaskGraphThroughput(run, numThreads); });
+		Bench::Register("TaskGraph/NestedTasks/" + threads, [=](Bench::Run &run) { TaskGraphNestedThroughput(run, numThreads); });
+	}
+	return true;
+}
+
+static const bool s_taskGraphBenchmarks = RegisterTaskGraphBenchmarks();
+BENCHMARK("JobQueue/Jobs", JobQueueThroughput);
@@ -0,0 +1,250 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "Benchmark.h"
+#include "GeoPatchID.h"
+#include "GeoPatchJobs.h"
+#include "GeoSphere.h"
+#include "Random.h"
+#include "galaxy/SystemBody.h"
+#include "terrain/Terrain.h"
+
+#include <string>
+#include <vector>
+
+// Terrain generation, for each reference body and fractal:
+//   Terrain/Height/<body>/<fractal>       ns per height sample
+//   Terrain/Color/<body>/<fractal>        ns per colour sample
+//   Terrain/GeoPatch/<body>/<fractal>/<n> ns per root patch at detail level n
+// There are a lot of them, so pick some with --filter.
+
+static constexpr size_t NUM_SAMPLES = 50000;
+static constexpr int NUM_PATCH_ITERATIONS = 8;
+static constexpr int NUM_DETAIL_LEVELS = 5;
+
+// SystemBody with its generation parameters filled in by hand, rather than
+// requiring a whole StarSystem to be generated
+class BenchBody : public SystemBody {
+public:
+	BenchBody(const char *name, Uint32 bodyIndex, BodyType type, fixed radius, fixed mass, int averageTemp) :
+		SystemBody(SystemPath(0, 0, 0, 0, bodyIndex), nullptr)
+	{
+		m_name = name;
+		m_type = type;
+		m_seed = 0xC0FFEE + bodyIndex;
+		m_radius = radius;
+		m_mass = mass;
+		m_averageTemp = averageTemp;
+		m_metallicity = fixed(1, 2);
+		m_volcanicity = fixed(3, 10);
+		m_volatileLiquid = fixed(7, 10);
+		m_volatileIces = fixed(3, 100);
+		m_volatileGas = fixed(1225, 1000);
+		m_life = fixed(9, 10);
+	}
+};
+
+static const int NUM_BODIES = 3;
+static const char *const s_bodyNames[NUM_BODIES] = { "terrestrial", "asteroid", "gas_giant" };
+
+static RefCountedPtr<SystemBody> MakeBody(int body)
+{
+	switch (body) {
+	case 0: return RefCountedPtr<SystemBody>(new BenchBody(s_bodyNames[0], 0, SystemBody::TYPE_PLANET_TERRESTRIAL, fixed(1, 1), fixed(1, 1), 288));
+	case 1: return RefCountedPtr<SystemBody>(new BenchBody(s_bodyNames[1], 1, SystemBody::TYPE_PLANET_ASTEROID, fixed(1, 10000), fixed(1, 10000000), 150));
+	default: return RefCountedPtr<SystemBody>(new BenchBody(s_bodyNames[2], 2, SystemBody::TYPE_PLANET_GAS_GIANT, fixed(11, 1), fixed(318, 1), 120));
+	}
+}
+
+typedef Terrain *(*BenchInstancer)(const SystemBody *);
+
+template <typename HeightFractal, typename ColorFractal>
+static Terrain *InstanceBenchTerrain(const SystemBody *body) { return new TerrainGenerator<HeightFractal, ColorFractal>(body); }
+
+struct BenchFractal {
+	const char *name;
+	BenchInstancer instancer;
+};
+
+// Every height fractal except the heightmapped ones, which need their data
+// files. Paired with a cheap colour fractal as only the height is measured.
+static const BenchFractal s_heightFractals[] = {
+	{ "Asteroid", InstanceBenchTerrain<TerrainHeightAsteroid, TerrainColorWhite> },
+	{ "Asteroid2", InstanceBenchTerrain<TerrainHeightAsteroid2, TerrainColorWhite> },
+	{ "Asteroid3", InstanceBenchTerrain<TerrainHeightAsteroid3, TerrainColorWhite> },
+	{ "Asteroid4", InstanceBenchTerrain<TerrainHeightAsteroid4, TerrainColorWhite> },
+	{ "BarrenRock", InstanceBenchTerrain<TerrainHeightBarrenRock, TerrainColorWhite> },
+	{ "BarrenRock2", InstanceBenchTerrain<TerrainHeightBarrenRock2, TerrainColorWhite> },
+	{ "BarrenRock3", InstanceBenchTerrain<TerrainHeightBarrenRock3, TerrainColorWhite> },
+	{ "Ellipsoid", InstanceBenchTerrain<TerrainHeightEllipsoid, TerrainColorWhite> },
+	{ "Flat", InstanceBenchTerrain<TerrainHeightFlat, TerrainColorWhite> },
+	{ "HillsCraters", InstanceBenchTerrain<TerrainHeightHillsCraters, TerrainColorWhite> },
+	{ "HillsCraters2", InstanceBenchTerrain<TerrainHeightHillsCraters2, TerrainColorWhite> },
+	{ "HillsDunes", InstanceBenchTerrain<TerrainHeightHillsDunes, TerrainColorWhite> },
+	{ "HillsNormal", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorWhite> },
+	{ "HillsRidged", InstanceBenchTerrain<TerrainHeightHillsRidged, TerrainColorWhite> },
+	{ "HillsRivers", InstanceBenchTerrain<TerrainHeightHillsRivers, TerrainColorWhite> },
+	{ "MountainsCraters", InstanceBenchTerrain<TerrainHeightMountainsCraters, TerrainColorWhite> },
+	{ "MountainsCraters2", InstanceBenchTerrain<TerrainHeightMountainsCraters2, TerrainColorWhite> },
+	{ "MountainsNormal", InstanceBenchTerrain<TerrainHeightMountainsNormal, TerrainColorWhite> },
+	{ "MountainsRidged", InstanceBenchTerrain<TerrainHeightMountainsRidged, TerrainColorWhite> },
+	{ "MountainsRivers", InstanceBenchTerrain<TerrainHeightMountainsRivers, TerrainColorWhite> },
+	{ "MountainsRiversVolcano", InstanceBenchTerrain<TerrainHeightMountainsRiversVolcano, TerrainColorWhite> },
+	{ "MountainsVolcano", InstanceBenchTerrain<TerrainHeightMountainsVolcano, TerrainColorWhite> },
+	{ "RuggedDesert", InstanceBenchTerrain<TerrainHeightRuggedDesert, TerrainColorWhite> },
+	{ "RuggedLava", InstanceBenchTerrain<TerrainHeightRuggedLava, TerrainColorWhite> },
+	{ "WaterSolid", InstanceBenchTerrain<TerrainHeightWaterSolid, TerrainColorWhite> },
+	{ "WaterSolidCanyons", InstanceBenchTerrain<TerrainHeightWaterSolidCanyons, TerrainColorWhite> }
+};
+
+// Every colour fractal, paired with a height fractal that gives them some
+// varied terrain to colour
+static const BenchFractal s_colorFractals[] = {
+	{ "Asteroid", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorAsteroid> },
+	{ "BandedRock", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorBandedRock> },
+	{ "Black", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorBlack> },
+	{ "DeadWithWater", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorDeadWithWater> },
+	{ "Desert", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorDesert> },
+	{ "EarthLike", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorEarthLike> },
+	{ "EarthLikeHeightmapped", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorEarthLikeHeightmapped> },
+	{ "GGJupiter", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorGGJupiter> },
+	{ "GGNeptune", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorGGNeptune> },
+	{ "GGNeptune2", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorGGNeptune2> },
+	{ "GGSaturn", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorGGSaturn> },
+	{ "GGSaturn2", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorGGSaturn2> },
+	{ "GGUranus", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorGGUranus> },
+	{ "Ice", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorIce> },
+	{ "Methane", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorMethane> },
+	{ "Rock", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorRock> },
+	{ "Rock2", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorRock2> },
+	{ "StarBrownDwarf", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorStarBrownDwarf> },
+	{ "StarG", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorStarG> },
+	{ "StarK", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorStarK> },
+	{ "StarM", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorStarM> },
+	{ "StarWhiteDwarf", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorStarWhiteDwarf> },
+	{ "TFGood", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorTFGood> },
+	{ "TFPoor", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorTFPoor> },
+	{ "Volcanic", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorVolcanic> },
+	{ "White", InstanceBenchTerrain<TerrainHeightHillsNormal, TerrainColorWhite> }
+};
+
+static std::vector<vector3d> MakeSpherePoints(size_t count)
+{
+	Random rand(42);
+	std::vector<vector3d> points(count);
+	for (vector3d &p : points)
+		p = vector3d(rand.Double(-1.0, 1.0), rand.Double(-1.0, 1.0), rand.Double(-1.0, 1.0)).NormalizedSafe();
+	return points;
+}
+
+static void TerrainHeight(Bench::Run &run, int bodyIdx, BenchInstancer instancer)
+{
+	RefCountedPtr<SystemBody> body = MakeBody(bodyIdx);
+	RefCountedPtr<Terrain> terrain(instancer(body.Get()));
+	const std::vector<vector3d> points = MakeSpherePoints(NUM_SAMPLES);
+
+	double sum = 0.0;
+	run.Measure(NUM_SAMPLES, [&]() {
+		for (const vector3d &p : points)
+			sum += terrain->GetHeight(p);
+	});
+
+	Bench::Consume(sum);
+}
+
+static void TerrainColor(Bench::Run &run, int bodyIdx, BenchInstancer instancer)
+{
+	RefCountedPtr<SystemBody> body = MakeBody(bodyIdx);
+	RefCountedPtr<Terrain> terrain(instancer(body.Get()));
+	const std::vector<vector3d> points = MakeSpherePoints(NUM_SAMPLES);
+	std::vector<double> heights(NUM_SAMPLES);
+	terrain->GetHeights(points.data(), heights.data(), NUM_SAMPLES);
+
+	vector3d sum(0.0);
+	run.Measure(NUM_SAMPLES, [&]() {
+		for (size_t idx = 0; idx < NUM_SAMPLES; idx++)
+			sum += terrain->GetColor(points[idx], heights[idx], points[idx]);
+	});
+
+	Bench::Consume(sum.x + sum.y + sum.z);
+}
+
+// Generates the six root patches of the terrain, exactly as the patch jobs
+// do, at a planet detail level
+static void TerrainGeoPatch(Bench::Run &run, int bodyIdx, BenchInstancer instancer, int detail)
+{
+	RefCountedPtr<SystemBody> body = MakeBody(bodyIdx);
+	RefCountedPtr<Terrain> terrain(instancer(body.Get()));
+
+	// the root faces of the cube, see GeoSphere::BuildFirstPatches
+	const vector3d p1 = (vector3d(1, 1, 1)).Normalized();
+	const vector3d p2 = (vector3d(-1, 1, 1)).Normalized();
+	const vector3d p3 = (vector3d(-1, -1, 1)).Normalized();
+	const vector3d p4 = (vector3d(1, -1, 1)).Normalized();
+	const vector3d p5 = (vector3d(1, 1, -1)).Normalized();
+	const vector3d p6 = (vector3d(-1, 1, -1)).Normalized();
+	const vector3d p7 = (vector3d(-1, -1, -1)).Normalized();
+	const vector3d p8 = (vector3d(1, -1, -1)).Normalized();
+	const vector3d faces[6][4] = {
+		{ p1, p2, p3, p4 },
+		{ p4, p3, p7, p8 },
+		{ p1, p4, p8, p5 },
+		{ p2, p1, p5, p6 },
+		{ p3, p2, p6, p7 },
+		{ p8, p7, p6, p5 }
+	};
+
+	// matches GeoPatch::RequestSinglePatch
+	const int ctxEdgeLen = GeoSphere::GetPatchEdgeLen(detail);
+	const int edgeLen = ctxEdgeLen - 2;
+	const double fracStep = 1.0 / double(ctxEdgeLen - 3);
+
+	double sum = 0.0;
+	run.Measure(NUM_PATCH_ITERATIONS * 6, [&]() {
+		for (int iter = 0; iter < NUM_PATCH_ITERATIONS; iter++) {
+			for (int face = 0; face < 6; face++) {
+				const vector3d *v = faces[face];
+				const vector3d centroid = (v[0] + v[1] + v[2] + v[3]).Normalized();
+				const GeoPatchID patchID(uint64_t(face) << GeoPatchID::MAX_SHIFT_DEPTH);
+
+				SSingleSplitRequest req(v[0], v[1], v[2], v[3], centroid, 0,
+					body->GetPath(), patchID, edgeLen, fracStep, terrain.Get());
+				req.GenerateMesh();
+				sum += req.heights[0];
+
+				delete[] req.heights;
+				delete[] req.normals;
+				delete[] req.colors;
+			}
+		}
+	});
+
+	Bench::Consume(sum);
+}
+
+static bool RegisterTerrainBenchmarks()
+{
+	for (int body = 0; body < NUM_BODIES; body++) {
+		const std::string bodyName = s_bodyNames[body];
+		for (const BenchFractal &fractal : s_heightFractals) {
+			const BenchInstancer instancer = fractal.instancer;
+			Bench::Register("Terrain/Height/" + bodyName + "/" + fractal.name,
+				[=](Bench::Run &run) { TerrainHeight(run, body, instancer); });
+		}
+		for (const BenchFractal &fractal : s_colorFractals) {
+			const BenchInstancer instancer = fractal.instancer;
+			Bench::Register("Terrain/Color/" + bodyName + "/" + fractal.name,
+				[=](Bench::Run &run) { TerrainColor(run, body, instancer); });
+		}
+		for (const BenchFractal &fractal : s_heightFractals) {
+			const BenchInstancer instancer = fractal.instancer;
+			for (int detail = 0; detail < NUM_DETAIL_LEVELS; detail++) {
+				Bench::Register("Terrain/GeoPatch/" + bodyName + "/" + fractal.name + "/" + std::to_string(detail),
+					[=](Bench::Run &run) { TerrainGeoPatch(run, body, instancer, detail); });
+			}
+		}
+	}
+	return true;
+}
+
+static const bool s_terrainBenchmarks = RegisterTerrainBenchmarks();
@@ -0,0 +1,33 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "Benchmark.h"
+
+namespace Bench {
+
+	static volatile double s_consumed = 0.0;
+
+	// constructed on first use, as benchmarks register during static initialisation
+	static std::vector<Benchmark> &GetRegistry()
+	{
+		static std::vector<Benchmark> benchmarks;
+		return benchmarks;
+	}
+
+	bool Register(const std::string &name, Function function)
+	{
+		GetRegistry().push_back({ name, function });
+		return true;
+	}
+
+	const std::vector<Benchmark> &GetBenchmarks()
+	{
+		return GetRegistry();
+	}
+
+	void Consume(double value)
+	{
+		s_consumed = s_consumed + value;
+	}
+
+} // namespace Bench
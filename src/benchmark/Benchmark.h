@@ -0,0 +1,71 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include "profiler/Profiler.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+ * Microbenchmarks of the engine's hot paths, built as the benchmarks target.
+ *
+ * A benchmark is a function the harness calls once to warm up and then a
+ * number of times to measure. Each call sets up whatever it needs and times
+ * the interesting part through Bench::Run::Measure, so set-up costs don't
+ * count. Results are in nanoseconds per operation, the median over the
+ * measured calls.
+ *
+ * Register a benchmark at file scope with
+ *   BENCHMARK("Subsystem/Operation", Function);
+ * or call Bench::Register from a static initialiser to register a family of
+ * them in a loop.
+ */
+namespace Bench {
+
+	class Run {
+	public:
+		// time fn, which performs numOps of the benchmarked operation
+		template <typename Fn>
+		void Measure(uint64_t numOps, Fn &&fn)
+		{
+			Profiler::Clock clock{};
+			clock.Start();
+			fn();
+			clock.Stop();
+			m_milliseconds += clock.milliseconds();
+			m_numOps += numOps;
+		}
+
+		double GetMilliseconds() const { return m_milliseconds; }
+		uint64_t GetNumOps() const { return m_numOps; }
+
+	private:
+		double m_milliseconds = 0.0;
+		uint64_t m_numOps = 0;
+	};
+
+	typedef std::function<void(Run &run)> Function;
+
+	struct Benchmark {
+		std::string name;
+		Function function;
+	};
+
+	// returns true, so it can initialise a static
+	bool Register(const std::string &name, Function function);
+	const std::vector<Benchmark> &GetBenchmarks();
+
+	// Keeps a result from being optimised away; benchmarks should fold
+	// what they compute into a value passed here.
+	void Consume(double value);
+
+} // namespace Bench
+
+#define BENCHMARK_CONCAT_(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_(a, b)
+#define BENCHMARK(name, function) \
+	static const bool BENCHMARK_CONCAT(s_benchmark, __LINE__) = Bench::Register(name, function)
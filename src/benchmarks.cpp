@@ -0,0 +1,172 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "Json.h"
+#include "benchmark/Benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+static const int DEFAULT_RUNS = 5;
+static const double DEFAULT_THRESHOLD = 10.0;
+
+static int info()
+{
+	printf(
+		"benchmarks - Microbenchmarks of the engine's hot paths.\n"
+		"USAGE: benchmarks [options]\n"
+		"  --filter <text>      only run the benchmarks with text in their name\n"
+		"  --runs <n>           measured runs of each benchmark (default %d)\n"
+		"  --json <file>        write the results to file as JSON\n"
+		"  --baseline <file>    compare with results written by --json, failing if\n"
+		"                       any benchmark is slower by more than the threshold\n"
+		"  --threshold <pct>    the slowdown allowed over the baseline (default %.0f)\n"
+		"  --list               list the benchmarks and exit\n"
+		"Exits with 1 if a benchmark regressed and 2 on bad arguments.\n",
+		DEFAULT_RUNS, DEFAULT_THRESHOLD);
+	return 2;
+}
+
+struct Result {
+	std::string name;
+	double nsPerOp;	   // median over the runs
+	double minNsPerOp; // fastest run
+	uint64_t opsPerRun;
+	int runs;
+};
+
+static Result RunBenchmark(const Bench::Benchmark &benchmark, int numRuns)
+{
+	// the first call warms caches and lazily built state up
+	Bench::Run warmUp;
+	benchmark.function(warmUp);
+
+	std::vector<double> nsPerOp;
+	uint64_t opsPerRun = 0;
+	for (int i = 0; i < numRuns; i++) {
+		Bench::Run run;
+		benchmark.function(run);
+		opsPerRun = run.GetNumOps();
+		nsPerOp.push_back(run.GetMilliseconds() * 1e6 / double(std::max<uint64_t>(opsPerRun, 1)));
+	}
+
+	std::sort(nsPerOp.begin(), nsPerOp.end());
+	return { benchmark.name, nsPerOp[nsPerOp.size() / 2], nsPerOp.front(), opsPerRun, numRuns };
+}
+
+static Json ResultsToJson(const std::vector<Result> &results)
+{
+	Json benchmarks = Json::array();
+	for (const Result &result : results) {
+		Json entry = Json::object();
+		entry["name"] = result.name;
+		entry["ns_per_op"] = result.nsPerOp;
+		entry["min_ns_per_op"] = result.minNsPerOp;
+		entry["ops_per_run"] = result.opsPerRun;
+		entry["runs"] = result.runs;
+		benchmarks.push_back(entry);
+	}
+
+	Json root = Json::object();
+	root["benchmarks"] = benchmarks;
+	return root;
+}
+
+// benchmark name -> ns/op of the baseline
+static bool LoadBaseline(const std::string &filename, std::map<std::string, double> &baseline)
+{
+	std::ifstream in(filename);
+	if (!in)
+		return false;
+
+	Json root = Json::parse(in, nullptr, false);
+	if (root.is_discarded() || !root["benchmarks"].is_array())
+		return false;
+
+	for (const Json &entry : root["benchmarks"])
+		baseline[entry.value("name", "")] = entry.value("ns_per_op", 0.0);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	std::string filter, jsonFile, baselineFile;
+	int numRuns = DEFAULT_RUNS;
+	double threshold = DEFAULT_THRESHOLD;
+	bool list = false;
+
+	for (int i = 1; i < argc; i++) {
+		const bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--filter") && hasValue)
+			filter = argv[++i];
+		else if (!strcmp(argv[i], "--runs") && hasValue)
+			numRuns = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--json") && hasValue)
+			jsonFile = argv[++i];
+		else if (!strcmp(argv[i], "--baseline") && hasValue)
+			baselineFile = argv[++i];
+		else if (!strcmp(argv[i], "--threshold") && hasValue)
+			threshold = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--list"))
+			list = true;
+		else
+			return info();
+	}
+
+	if (numRuns < 1 || threshold < 0.0)
+		return info();
+
+	std::map<std::string, double> baseline;
+	if (!baselineFile.empty() && !LoadBaseline(baselineFile, baseline)) {
+		fprintf(stderr, "Could not read baseline '%s'\n", baselineFile.c_str());
+		return 2;
+	}
+
+	std::vector<Result> results;
+	int numRegressions = 0;
+	for (const Bench::Benchmark &benchmark : Bench::GetBenchmarks()) {
+		if (benchmark.name.find(filter) == std::string::npos)
+			continue;
+
+		if (list) {
+			printf("%s\n", benchmark.name.c_str());
+			continue;
+		}
+
+		const Result result = RunBenchmark(benchmark, numRuns);
+		results.push_back(result);
+		printf("%-36s %14.1f ns/op %14.1f min", result.name.c_str(), result.nsPerOp, result.minNsPerOp);
+
+		auto it = baseline.find(result.name);
+		if (it != baseline.end() && it->second > 0.0) {
+			const double change = (result.nsPerOp / it->second - 1.0) * 100.0;
+			const bool regressed = change > threshold;
+			printf(" %+8.1f%%%s", change, regressed ? " REGRESSED" : "");
+			numRegressions += regressed;
+		} else if (!baseline.empty()) {
+			printf("      (new)");
+		}
+		printf("\n");
+		fflush(stdout);
+	}
+
+	if (!jsonFile.empty()) {
+		std::ofstream out(jsonFile);
+		out << ResultsToJson(results).dump(1, '\t') << "\n";
+		if (!out) {
+			fprintf(stderr, "Could not write '%s'\n", jsonFile.c_str());
+			return 2;
+		}
+	}
+
+	if (numRegressions) {
+		printf("%d benchmark(s) regressed by more than %.1f%%\n", numRegressions, threshold);
+		return 1;
+	}
+
+	return 0;
+}
@@ -6,9 +6,24 @@
 #include "Aabb.h"
 #include "MathUtil.h"
 #include "core/Log.h"
+#include "core/TaskGraph.h"
 #include "core/macros.h"
 #include "profiler/Profiler.h"
 
+#include <cfloat>
+#include <cmath>
+
+// trees with fewer objects than this are always built on the calling thread
+static constexpr uint32_t PARALLEL_BUILD_MIN_OBJS = 8192;
+// smallest subtree handed to a worker thread during a parallel build
+static constexpr uint32_t PARALLEL_BUILD_MIN_TASK_OBJS = 1024;
+
+// relative SAH cost of traversing an interior node vs. testing a leaf
+static constexpr double SAH_NODE_COST = 1.2;
+static constexpr double SAH_LEAF_COST = 1.0;
+
+TaskGraph *SingleBVHTreeBase::s_taskGraph = nullptr;
+
 SingleBVHTreeBase::SingleBVHTreeBase() :
 	m_treeHeight(0),
 	m_boundsCenter(0.0, 0.0, 0.0),
@@ -33,15 +48,23 @@ void SingleBVHTreeBase::Clear()
 	m_nodes.push_back(invalid);
 }
 
+void SingleBVHTreeBase::SetTaskGraph(TaskGraph *graph)
+{
+	s_taskGraph = graph;
+}
+
 void SingleBVHTreeBase::Build(const AABBd &bounds, AABBd *objAabbs, uint32_t numObjs)
 {
 	PROFILE_SCOPED()
 
-	// bound on a fully-populated perfect binary tree: 2 * 2^(log2(n)) - 1
-	// reserve less than that, assuming this won't be a perfect tree
-	// experimental data shows generally 2 nodes per leaf object
-	m_nodes.clear();
-	m_nodes.reserve(2 * numObjs + 1);
+	if (numObjs == 0) {
+		Clear();
+		return;
+	}
+
+	// every node is either a leaf or has exactly two children, so the tree
+	// always contains 2n - 1 nodes
+	m_nodes.assign(2 * numObjs - 1, Node{});
 
 	// compute a remapping term to express object positions with highest precision using single floating point
 	// use the average of the bounding volume to remap into [-1 .. 1] space
@@ -56,7 +79,57 @@ void SingleBVHTreeBase::Build(const AABBd &bounds, AABBd *objAabbs, uint32_t num
 		sortKeys[idx].index = idx;
 	}
 
-	BuildNode(&m_nodes.emplace_back(), sortKeys.data(), numObjs, objAabbs, 0);
+	if (!s_taskGraph || numObjs < PARALLEL_BUILD_MIN_OBJS) {
+		m_treeHeight = BuildNode(0, 1, sortKeys.data(), numObjs, objAabbs, 0, nullptr);
+		return;
+	}
+
+	// Build the top of the tree on this thread until it has been split into
+	// enough subtrees to keep all worker threads busy, then build those in parallel.
+	// The resulting tree is identical to one built on a single thread.
+	BuildContext ctx;
+	ctx.maxTaskKeys = std::max(PARALLEL_BUILD_MIN_TASK_OBJS, numObjs / ((s_taskGraph->GetNumWorkerThreads() + 1) * 4));
+	m_treeHeight = BuildNode(0, 1, sortKeys.data(), numObjs, objAabbs, 0, &ctx);
+
+	std::vector<uint32_t> taskHeights(ctx.tasks.size());
+	TaskSet *taskSet = new TaskSet();
+	for (size_t idx = 0; idx < ctx.tasks.size(); idx++) {
+		taskSet->AddTaskLambda({}, [this, idx, objAabbs, &ctx, &taskHeights](TaskRange) {
+			const BuildTask &task = ctx.tasks[idx];
+			taskHeights[idx] = BuildNode(task.nodeIdx, task.freeIdx, task.keys, task.numKeys, objAabbs, task.height, nullptr);
+		});
+	}
+
+	TaskSet::Handle handle = s_taskGraph->QueueTaskSet(taskSet);
+	s_taskGraph->WaitForTaskSet(handle);
+
+	for (uint32_t height : taskHeights)
+		m_treeHeight = std::max(m_treeHeight, height);
+}
+
+double SingleBVHTreeBase::Refit(const AABBd *objAabbs)
+{
+	PROFILE_SCOPED()
+
+	// Both children of a node are always stored after it, so walking the node
+	// array backwards updates every child before its parent.
+	double outSAH = 0.0;
+	for (size_t idx = m_nodes.size(); idx-- > 0;) {
+		Node &node = m_nodes[idx];
+
+		if (node.kids[0] == 0) {
+			node.aabb = objAabbs[node.leafIndex];
+			outSAH += SAH_LEAF_COST * node.aabb.SurfaceArea();
+			continue;
+		}
+
+		node.aabb = m_nodes[node.kids[0]].aabb;
+		node.aabb.Update(m_nodes[node.kids[1]].aabb);
+		outSAH += SAH_NODE_COST * node.aabb.SurfaceArea();
+	}
+
+	// Normalize the same way as CalculateSAH()
+	return outSAH / m_nodes[0].aabb.SurfaceArea() - 1.0;
 }
 
 void SingleBVHTreeBase::ComputeOverlap(uint32_t nodeId, const AABBd &nodeAabb, std::vector<std::pair<uint32_t, uint32_t>> &out_isect, uint32_t startNode) const
@@ -128,7 +201,7 @@ double SingleBVHTreeBase::CalculateSAH() const
 			m_nodeStack.push_back(node->kids[1]);
 
 		// Cost function according to https://users.aalto.fi/~laines9/publications/aila2013hpg_paper.pdf Eq. 1
-		outSAH += (node->kids[0] ? 1.2 : 1.0) * node->aabb.SurfaceArea();
+		outSAH += (node->kids[0] ? SAH_NODE_COST : SAH_LEAF_COST) * node->aabb.SurfaceArea();
 	}
 
 	double rootArea = rootNode->aabb.SurfaceArea();
@@ -146,18 +219,25 @@ double SingleBVHTreeBase::CalculateSAH() const
 // ============================================================================
 
 
-void SingleBVHTree::BuildNode(Node *node, SortKey *keys, uint32_t numKeys, const AABBd *objAabbs, uint32_t height)
+uint32_t SingleBVHTree::BuildNode(uint32_t nodeIdx, uint32_t freeIdx, SortKey *keys, uint32_t numKeys, const AABBd *objAabbs, uint32_t height, BuildContext *ctx)
 {
 	// PROFILE_SCOPED()
 
+	// leave this subtree for a worker thread
+	if (ctx && numKeys <= ctx->maxTaskKeys) {
+		ctx->tasks.push_back({ nodeIdx, freeIdx, keys, numKeys, height });
+		return height;
+	}
+
 	AABBd aabb = AABBd::Invalid();
-	m_treeHeight = std::max(++height, m_treeHeight);
+	++height;
 
 	// Compute the AABB for this node
 	for (size_t idx = 0; idx < numKeys; idx++) {
 		aabb.Update(objAabbs[keys[idx].index]);
 	}
 
+	Node *node = &m_nodes[nodeIdx];
 	node->aabb = aabb;
 	node->leafIndex = 0;
 	node->treeHeight = height;
@@ -166,7 +246,7 @@ void SingleBVHTree::BuildNode(Node *node, SortKey *keys, uint32_t numKeys, const
 	if (numKeys == 1) {
 		node->kids[0] = node->kids[1] = 0;
 		node->leafIndex = keys[0].index;
-		return;
+		return height;
 	}
 
 	uint32_t startIdx = Partition(keys, numKeys, aabb, objAabbs);
@@ -176,17 +256,16 @@ void SingleBVHTree::BuildNode(Node *node, SortKey *keys, uint32_t numKeys, const
 	if (std::min(startIdx, numKeys - startIdx) == 0)
 		startIdx = numKeys >> 1;
 
-	// Allocate both child nodes together for cache optimization
-	node->kids[0] = m_nodes.size();
-	Node *leftNode = &m_nodes.emplace_back();
-
-	node->kids[1] = m_nodes.size();
-	Node *rightNode = &m_nodes.emplace_back();
+	// Allocate both child nodes together for cache optimization, followed
+	// by the rest of the left subtree and then the rest of the right subtree
+	node->kids[0] = freeIdx;
+	node->kids[1] = freeIdx + 1;
 
 	// Descend into left/right node trees
 	// This could potentially be made into a non-recursive stack-based algorithm
-	BuildNode(leftNode, keys, startIdx, objAabbs, height);
-	BuildNode(rightNode, keys + startIdx, numKeys - startIdx, objAabbs, height);
+	const uint32_t leftHeight = BuildNode(freeIdx, freeIdx + 2, keys, startIdx, objAabbs, height, ctx);
+	const uint32_t rightHeight = BuildNode(freeIdx + 1, freeIdx + 2 * startIdx, keys + startIdx, numKeys - startIdx, objAabbs, height, ctx);
+	return std::max(leftHeight, rightHeight);
 }
 
 uint32_t SingleBVHTree::Partition(SortKey *keys, uint32_t numKeys, const AABBd &aabb, const AABBd *objAabbs)
@@ -226,18 +305,25 @@ uint32_t SingleBVHTree::Partition(SortKey *keys, uint32_t numKeys, const AABBd &
 // ============================================================================
 
 
-void BinnedAreaBVHTree::BuildNode(Node *node, SortKey *keys, uint32_t numKeys, const AABBd *objAabbs, uint32_t height)
+uint32_t BinnedAreaBVHTree::BuildNode(uint32_t nodeIdx, uint32_t freeIdx, SortKey *keys, uint32_t numKeys, const AABBd *objAabbs, uint32_t height, BuildContext *ctx)
 {
 	// PROFILE_SCOPED()
 
+	// leave this subtree for a worker thread
+	if (ctx && numKeys <= ctx->maxTaskKeys) {
+		ctx->tasks.push_back({ nodeIdx, freeIdx, keys, numKeys, height });
+		return height;
+	}
+
 	AABBd aabb = AABBd::Invalid();
-	m_treeHeight = std::max(++height, m_treeHeight);
+	++height;
 
 	// Compute the AABB for this node
 	for (size_t idx = 0; idx < numKeys; idx++) {
 		aabb.Update(objAabbs[keys[idx].index]);
 	}
 
+	Node *node = &m_nodes[nodeIdx];
 	node->aabb = aabb;
 	node->leafIndex = 0;
 	node->treeHeight = height;
@@ -246,7 +332,7 @@ void BinnedAreaBVHTree::BuildNode(Node *node, SortKey *keys, uint32_t numKeys, c
 	if (numKeys == 1) {
 		node->kids[0] = node->kids[1] = 0;
 		node->leafIndex = keys[0].index;
-		return;
+		return height;
 	}
 
 	uint32_t startIdx = Partition(keys, numKeys, aabb, objAabbs);
@@ -256,34 +342,22 @@ void BinnedAreaBVHTree::BuildNode(Node *node, SortKey *keys, uint32_t numKeys, c
 	if (std::min(startIdx, numKeys - startIdx) == 0)
 		startIdx = numKeys >> 1;
 
-	// Allocate both child nodes together for cache optimization
-	node->kids[0] = m_nodes.size();
-	Node *leftNode = &m_nodes.emplace_back();
-
-	node->kids[1] = m_nodes.size();
-	Node *rightNode = &m_nodes.emplace_back();
+	// Allocate both child nodes together for cache optimization, followed
+	// by the rest of the left subtree and then the rest of the right subtree
+	node->kids[0] = freeIdx;
+	node->kids[1] = freeIdx + 1;
 
 	// Descend into left/right node trees
 	// This could potentially be made into a non-recursive stack-based algorithm
-	BuildNode(leftNode, keys, startIdx, objAabbs, height);
-	BuildNode(rightNode, keys + startIdx, numKeys - startIdx, objAabbs, height);
+	const uint32_t leftHeight = BuildNode(freeIdx, freeIdx + 2, keys, startIdx, objAabbs, height, ctx);
+	const uint32_t rightHeight = BuildNode(freeIdx + 1, freeIdx + 2 * startIdx, keys + startIdx, numKeys - startIdx, objAabbs, height, ctx);
+	return std::max(leftHeight, rightHeight);
 }
 
 uint32_t BinnedAreaBVHTree::Partition(SortKey *keys, uint32_t numKeys, const AABBd &aabb, const AABBd *objAabbs)
 {
 	uint32_t axis = 0;
-	float pivot = 0.0;
-	float cost = FLT_MAX;
-
-	for (uint32_t i = 0; i < 3; i++) {
-		float newCost = FLT_MAX;
-		float newPivot = FindPivot(keys, numKeys, aabb, objAabbs, i, newCost);
-		if (newCost < cost) {
-			axis = i;
-			pivot = newPivot;
-			cost = newCost;
-		}
-	}
+	const float pivot = FindPivot(keys, numKeys, aabb, objAabbs, axis);
 
 	// Simple O(n) sort algorithm to sort all objects according to side of pivot
 	uint32_t startIdx = 0;
@@ -304,56 +378,204 @@ uint32_t BinnedAreaBVHTree::Partition(SortKey *keys, uint32_t numKeys, const AAB
 	return startIdx;
 }
 
-float BinnedAreaBVHTree::FindPivot(SortKey *keys, uint32_t numKeys, const AABBd &aabb, const AABBd *objAabbs, uint32_t axis, float &outCost) const
+float BinnedAreaBVHTree::FindPivot(const SortKey *keys, uint32_t numKeys, const AABBd &aabb, const AABBd *objAabbs, uint32_t &outAxis) const
 {
 	// Uses binned surface-area-heuristic construction:
 	// https://jacco.ompf2.com/2022/04/21/how-to-build-a-bvh-part-3-quick-builds/
 
-	SortBin bins[NUM_BINS] = {};
+	// All three axes are binned in a single pass over the objects, so each
+	// object's AABB is only fetched once and the bin indices for all axes
+	// are computed together.
+	SortBin bins[3][NUM_BINS];
+
+	const vector3f boundsMin = ToSortSpace(aabb.min);
+	const vector3f boundsMax = ToSortSpace(aabb.max);
+	const vector3f extent = boundsMax - boundsMin;
 
-	float boundsMin = ToSortSpace(aabb.min)[axis];
-	float boundsMax = ToSortSpace(aabb.max)[axis];
+	// axes with no extent can't be split and are skipped
+	const bool canSplit[3] = { extent.x > 0.f, extent.y > 0.f, extent.z > 0.f };
+	const vector3f scale(
+		canSplit[0] ? NUM_BINS / extent.x : 0.f,
+		canSplit[1] ? NUM_BINS / extent.y : 0.f,
+		canSplit[2] ? NUM_BINS / extent.z : 0.f);
 
-	float scale = NUM_BINS / (boundsMax - boundsMin);
-	float invScale = (boundsMax - boundsMin) / NUM_BINS;
+	// Keys are in no particular order by the time they reach deeper nodes;
+	// fetch object AABBs a little ahead to hide the cost of the indirect load
+	constexpr size_t PREFETCH_DISTANCE = 16;
 
 	// Bin each object, using the sort key as its centroid
 	for (size_t i = 0; i < numKeys; i++) {
-		size_t bin_idx = std::min(NUM_BINS - 1, size_t((keys[i].center[axis] - boundsMin) * scale));
-		bins[bin_idx].objCount++;
-		bins[bin_idx].bounds.Update(objAabbs[keys[i].index]);
+		if (i + PREFETCH_DISTANCE < numKeys)
+			PREFETCH(&objAabbs[keys[i + PREFETCH_DISTANCE].index]);
+
+		// copy the AABB so it isn't reloaded after every bin update
+		const AABBd objAabb = objAabbs[keys[i].index];
+		const vector3f binPos = (keys[i].center - boundsMin) * scale;
+
+		SortBin &binX = bins[0][std::min(NUM_BINS - 1, size_t(binPos.x))];
+		SortBin &binY = bins[1][std::min(NUM_BINS - 1, size_t(binPos.y))];
+		SortBin &binZ = bins[2][std::min(NUM_BINS - 1, size_t(binPos.z))];
+
+		binX.objCount++;
+		binX.bounds.Update(objAabb);
+		binY.objCount++;
+		binY.bounds.Update(objAabb);
+		binZ.objCount++;
+		binZ.bounds.Update(objAabb);
 	}
 
 	constexpr int NUM_PLANES = NUM_BINS - 1;
 
-	float planeCost[NUM_PLANES];
 	float bestCost = FLT_MAX;
 	float pivot = 0.0;
+	outAxis = 0;
+
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		if (!canSplit[axis])
+			continue;
 
-	AABBd leftBox = AABBd::Invalid();
-	AABBd rightBox = AABBd::Invalid();
-	uint32_t leftSum = 0;
-	uint32_t rightSum = 0;
+		const float invScale = extent[axis] / NUM_BINS;
 
-	// Calculate the left-side SAH cost of each splitting plane
-	for (int i = 0; i < NUM_PLANES; i++) {
-		leftSum += bins[i].objCount;
-		leftBox.Update(bins[i].bounds);
-		planeCost[i] = leftSum * leftBox.SurfaceArea();
-	}
+		float planeCost[NUM_PLANES];
+		AABBd leftBox = AABBd::Invalid();
+		AABBd rightBox = AABBd::Invalid();
+		uint32_t leftSum = 0;
+		uint32_t rightSum = 0;
 
-	// Calculate the right-side SAH cost of each splitting plane
-	for (int i = NUM_PLANES - 1; i >= 0; i--) {
-		rightSum += bins[i + 1].objCount;
-		rightBox.Update(bins[i + 1].bounds);
-		planeCost[i] += rightSum * rightBox.SurfaceArea();
+		// Calculate the left-side SAH cost of each splitting plane
+		for (int i = 0; i < NUM_PLANES; i++) {
+			leftSum += bins[axis][i].objCount;
+			leftBox.Update(bins[axis][i].bounds);
+			planeCost[i] = leftSum * leftBox.SurfaceArea();
+		}
 
-		if (planeCost[i] < bestCost) {
-			pivot = boundsMin + invScale * (i + 1);
-			bestCost = planeCost[i];
+		// Calculate the right-side SAH cost of each splitting plane
+		for (int i = NUM_PLANES - 1; i >= 0; i--) {
+			rightSum += bins[axis][i + 1].objCount;
+			rightBox.Update(bins[axis][i + 1].bounds);
+			planeCost[i] += rightSum * rightBox.SurfaceArea();
+
+			if (planeCost[i] < bestCost) {
+				pivot = boundsMin[axis] + invScale * (i + 1);
+				bestCost = planeCost[i];
+				outAxis = axis;
+			}
 		}
 	}
 
-	outCost = bestCost;
 	return pivot;
 }
+
+// ============================================================================
+
+// Round a double-precision bound outwards to the nearest float
+static float RoundDown(double value)
+{
+	if (value >= double(FLT_MAX))
+		return FLT_MAX;
+	if (value <= -double(FLT_MAX))
+		return -FLT_MAX;
+
+	const float result = float(value);
+	return double(result) > value ? std::nextafter(result, -FLT_MAX) : result;
+}
+
+static float RoundUp(double value)
+{
+	if (value >= double(FLT_MAX))
+		return FLT_MAX;
+	if (value <= -double(FLT_MAX))
+		return -FLT_MAX;
+
+	const float result = float(value);
+	return double(result) < value ? std::nextafter(result, FLT_MAX) : result;
+}
+
+CompactBVHTree::CompactBVHTree() :
+	m_treeHeight(0)
+{
+}
+
+void CompactBVHTree::Build(const SingleBVHTreeBase &tree)
+{
+	PROFILE_SCOPED()
+
+	m_nodes.resize(tree.GetNumNodes());
+	m_treeHeight = tree.GetHeight();
+
+	for (uint32_t idx = 0; idx < tree.GetNumNodes(); idx++) {
+		const SingleBVHTreeBase::Node *src = tree.GetNode(idx);
+		Node &node = m_nodes[idx];
+
+		// children are always allocated as a pair
+		assert(src->kids[0] == 0 || src->kids[1] == src->kids[0] + 1);
+
+		node.min = vector3f(RoundDown(src->aabb.min.x), RoundDown(src->aabb.min.y), RoundDown(src->aabb.min.z));
+		node.max = vector3f(RoundUp(src->aabb.max.x), RoundUp(src->aabb.max.y), RoundUp(src->aabb.max.z));
+		node.firstKid = src->kids[0];
+		node.leafIndex = src->leafIndex;
+	}
+}
+
+void CompactBVHTree::TraceRay(const vector3d &start, const vector3d &inv_dir, double len, std::vector<uint32_t> &out_isect, uint32_t startNode) const
+{
+	// PROFILE_SCOPED() // Called often, only enable when needed
+
+	int32_t stackLevel = 0;
+	uint32_t *stack = stackalloc(uint32_t, m_treeHeight + 1);
+	stack[stackLevel++] = startNode;
+
+	while (stackLevel > 0) {
+		uint32_t nodeIdx = stack[--stackLevel];
+		const Node *node = &m_nodes[nodeIdx];
+
+		// Didn't intersect with the node, ignore it
+		if (!node->GetAabb().IntersectsRay(start, inv_dir, len))
+			continue;
+
+		// Leaf node - mark intersection and continue
+		if (node->IsLeaf()) {
+			out_isect.push_back(node->leafIndex);
+			continue;
+		}
+
+		stack[stackLevel++] = node->firstKid + 1;
+		stack[stackLevel++] = node->firstKid;
+	}
+}
+
+void CompactBVHTree::ComputeOverlap(const AABBd &aabb, std::vector<uint32_t> &out_isect, uint32_t startNode) const
+{
+	int32_t stackLevel = 0;
+	uint32_t *stack = stackalloc(uint32_t, m_treeHeight + 1);
+	stack[stackLevel++] = startNode;
+
+	while (stackLevel > 0) {
+		const Node *node = &m_nodes[stack[--stackLevel]];
+
+		if (!aabb.Intersects(node->GetAabb()))
+			continue;
+
+		if (node->IsLeaf()) {
+			out_isect.push_back(node->leafIndex);
+			continue;
+		}
+
+		stack[stackLevel++] = node->firstKid + 1;
+		stack[stackLevel++] = node->firstKid;
+	}
+}
+
+double CompactBVHTree::CalculateSAH() const
+{
+	double outSAH = 0.0;
+
+	for (const Node &node : m_nodes) {
+		// Cost function according to https://users.aalto.fi/~laines9/publications/aila2013hpg_paper.pdf Eq. 1
+		outSAH += (node.IsLeaf() ? SAH_LEAF_COST : SAH_NODE_COST) * node.GetAabb().SurfaceArea();
+	}
+
+	// Perform 1 / Aroot * ( SAH sums ) and remove the (normalized) SAH cost
+	// of the root node, which the SAH metric doesn't include
+	return outSAH / m_nodes[0].GetAabb().SurfaceArea() - 1.0;
+}
@@ -8,6 +8,8 @@
 #include "../vector3.h"
 #include <vector>
 
+class TaskGraph;
+
 /*
  * Base class for BVH trees with a single leaf per node.
  */
@@ -29,6 +31,12 @@ public:
 	// Individual nodes will have leaf indices into this array
 	void Build(const AABBd &bounds, AABBd *objAabbs, uint32_t numObjs);
 
+	// Update the node AABBs in place from a new list of object AABBs, keeping
+	// the existing tree structure. The list must describe the same objects
+	// in the same order as the last call to Build(), and the tree must not
+	// have been cleared since. Returns the SAH cost of the refitted tree.
+	double Refit(const AABBd *objAabbs);
+
 	// Return a pointer to the node at the given index
 	inline const Node *GetNode(uint32_t index) const { return m_nodes.data() + index; }
 
@@ -41,16 +49,42 @@ public:
 	uint32_t GetHeight() const { return m_treeHeight; }
 	double CalculateSAH() const;
 
+	// Large trees are built in parallel on the worker threads of this graph.
+	// If no graph is set, all trees are built on the calling thread.
+	static void SetTaskGraph(TaskGraph *graph);
+
 protected:
 	struct SortKey {
 		vector3f center;
 		uint32_t index;
 	};
 
+	// A subtree left to be built on a worker thread
+	struct BuildTask {
+		uint32_t nodeIdx;
+		uint32_t freeIdx;
+		SortKey *keys;
+		uint32_t numKeys;
+		uint32_t height;
+	};
+
+	// Collects subtrees of no more than maxTaskKeys objects during a parallel build
+	struct BuildContext {
+		std::vector<BuildTask> tasks;
+		uint32_t maxTaskKeys;
+	};
+
 	vector3f ToSortSpace(vector3d point) const { return vector3f((point - m_boundsCenter) * m_inv_scale_factor); }
 
+	// Build the subtree rooted at nodeIdx. A subtree of N objects always has
+	// 2N - 1 nodes; the other 2N - 2 are allocated in order starting at freeIdx,
+	// so independent subtrees can be built concurrently.
+	// If ctx is set, small enough subtrees are added to it instead of built.
+	// Returns the height of the tallest leaf built.
 	// Override in final for specific tree construction behavior without vfunction call overhead
-	virtual void BuildNode(Node *node, SortKey *keys, uint32_t numKeys, const AABBd *objAabbs, uint32_t height) = 0;
+	virtual uint32_t BuildNode(uint32_t nodeIdx, uint32_t freeIdx, SortKey *keys, uint32_t numKeys, const AABBd *objAabbs, uint32_t height, BuildContext *ctx) = 0;
+
+	static TaskGraph *s_taskGraph;
 
 	std::vector<Node> m_nodes;
 	uint32_t m_treeHeight;
@@ -74,7 +108,7 @@ public:
 	~SingleBVHTree() {};
 
 protected:
-	virtual void BuildNode(Node *node, SortKey *keys, uint32_t numKeys, const AABBd *objAabbs, uint32_t height) override final;
+	virtual uint32_t BuildNode(uint32_t nodeIdx, uint32_t freeIdx, SortKey *keys, uint32_t numKeys, const AABBd *objAabbs, uint32_t height, BuildContext *ctx) override final;
 	uint32_t Partition(SortKey *keys, uint32_t numKeys, const AABBd &aabb, const AABBd *objAabbs);
 };
 
@@ -105,9 +139,56 @@ protected:
 	// experimentally shown to provide a better SAH for human-authored models.
 	static constexpr size_t NUM_BINS = 12;
 
-	virtual void BuildNode(Node *node, SortKey *keys, uint32_t numKeys, const AABBd *objAabbs, uint32_t height) override final;
+	virtual uint32_t BuildNode(uint32_t nodeIdx, uint32_t freeIdx, SortKey *keys, uint32_t numKeys, const AABBd *objAabbs, uint32_t height, BuildContext *ctx) override final;
 	uint32_t Partition(SortKey *keys, uint32_t numKeys, const AABBd &aabb, const AABBd *objAabbs);
-	float FindPivot(SortKey *keys, uint32_t numKeys, const AABBd &aabb, const AABBd *objAabbs, uint32_t axis, float &outCost) const;
+	// Bin all objects along all three axes at once and return the lowest-cost split
+	float FindPivot(const SortKey *keys, uint32_t numKeys, const AABBd &aabb, const AABBd *objAabbs, uint32_t &outAxis) const;
+};
+
+/*
+ * Read-only, compact copy of a SingleBVHTreeBase for the static per-model
+ * trees of a GeomTree.
+ *
+ * Node bounds are stored in single precision (rounded outwards, so a node
+ * never shrinks), and the two children of a node are stored next to each
+ * other so only the index of the first one is kept. A node is 32 bytes,
+ * half the size of a SingleBVHTreeBase::Node, and two nodes fit in one cache
+ * line. The world-space CollisionSpace trees keep using the double-precision
+ * trees, as they need the range and are rebuilt and refitted constantly.
+ */
+class CompactBVHTree {
+public:
+	struct Node {
+		vector3f min;
+		uint32_t firstKid; // zero for leaf nodes; the second child is at firstKid + 1
+		vector3f max;
+		uint32_t leafIndex;
+
+		bool IsLeaf() const { return firstKid == 0; }
+		AABBd GetAabb() const { return AABBd{ vector3d(min), vector3d(max) }; }
+	};
+
+	static_assert(sizeof(Node) == 32, "CompactBVHTree::Node should be 32 bytes");
+
+	CompactBVHTree();
+
+	// Build a compact copy of the given tree
+	void Build(const SingleBVHTreeBase &tree);
+
+	inline const Node *GetNode(uint32_t index) const { return m_nodes.data() + index; }
+
+	// Trace a ray through this AABB and add the list of intersected leaves to the passed array
+	void TraceRay(const vector3d &start, const vector3d &inv_dir, double len, std::vector<uint32_t> &out_isect, uint32_t startNode = 0) const;
+	// Add the list of leaves overlapping the given AABB to the passed array
+	void ComputeOverlap(const AABBd &aabb, std::vector<uint32_t> &out_isect, uint32_t startNode = 0) const;
+
+	size_t GetNumNodes() const { return m_nodes.size(); }
+	uint32_t GetHeight() const { return m_treeHeight; }
+	double CalculateSAH() const;
+
+private:
+	std::vector<Node> m_nodes;
+	uint32_t m_treeHeight;
 };
 
 #endif /* _BVHTREE_H */
@@ -10,15 +10,43 @@
 #include "profiler/Profiler.h"
 
 #include <algorithm>
+#include <cmath>
 
 int CollisionSpace::s_nextHandle = 1;
 
+// The dynamic tree is refitted to the new geom positions each step rather than
+// rebuilt, until its SAH cost has grown by this factor since the last rebuild
+static constexpr double MAX_REFIT_SAH_GROWTH = 1.3;
+
+// Cached contacts between two geoms are reused while their relative
+// orientation and position stay within these tolerances
+static constexpr double CONTACT_CACHE_ROTATION_EPSILON = 1e-9;
+static constexpr double CONTACT_CACHE_POSITION_EPSILON = 1e-6;
+
+static bool IsSameRelTransform(const matrix4x4d &a, const matrix4x4d &b)
+{
+	for (size_t idx = 0; idx < 12; idx++) {
+		if (std::abs(a[idx] - b[idx]) > CONTACT_CACHE_ROTATION_EPSILON)
+			return false;
+	}
+
+	for (size_t idx = 12; idx < 15; idx++) {
+		if (std::abs(a[idx] - b[idx]) > CONTACT_CACHE_POSITION_EPSILON)
+			return false;
+	}
+
+	return true;
+}
+
 CollisionSpace::CollisionSpace() :
 	m_staticObjectTree(new SingleBVHTree()),
 	m_dynamicObjectTree(new SingleBVHTree()),
 	m_enabledStaticGeoms(0),
 	m_enabledDynGeoms(0),
+	m_dynamicTreeSAH(0.0),
+	m_collisionPass(0),
 	m_needStaticGeomRebuild(true),
+	m_needDynamicGeomRebuild(true),
 	m_duringCollision(false)
 {
 	sphere.radius = 0;
@@ -34,6 +62,7 @@ void CollisionSpace::AddGeom(Geom *geom)
 	assert(!m_duringCollision);
 
 	m_geoms.push_back(geom);
+	m_needDynamicGeomRebuild = true;
 }
 
 void CollisionSpace::RemoveGeom(Geom *geom)
@@ -48,6 +77,9 @@ void CollisionSpace::RemoveGeom(Geom *geom)
 	if (m_geoms.size() > 1)
 		std::swap(*iter, m_geoms.back());
 	m_geoms.pop_back();
+	m_needDynamicGeomRebuild = true;
+
+	EvictContactCache(geom);
 }
 
 void CollisionSpace::AddStaticGeom(Geom *geom)
@@ -73,6 +105,19 @@ void CollisionSpace::RemoveStaticGeom(Geom *geom)
 	if (m_staticGeoms.size() > 1)
 		std::swap(*iter, m_staticGeoms.back());
 	m_staticGeoms.pop_back();
+
+	EvictContactCache(geom);
+}
+
+void CollisionSpace::EvictContactCache(const Geom *geom)
+{
+	// a new geom may be allocated at the address of the removed one
+	for (auto iter = m_contactCache.begin(); iter != m_contactCache.end();) {
+		if (iter->first.first == geom || iter->first.second == geom)
+			iter = m_contactCache.erase(iter);
+		else
+			++iter;
+	}
 }
 
 void CollisionSpace::CollideRaySphere(const vector3d &start, const vector3d &dir, isect_t *isect)
@@ -137,21 +182,147 @@ void CollisionSpace::TraceRay(const vector3d &start, const vector3d &dir, double
 		}
 	}
 
-	{
-		isect_t isect;
-		isect.dist = float(c->distance);
-		isect.triIdx = -1;
-		CollideRaySphere(start, dir, &isect);
-		if (isect.triIdx != -1) {
-			c->pos = start + dir * double(isect.dist);
-			c->normal = vector3d(0.0);
-			c->depth = len - isect.dist;
-			c->triIdx = -1;
-			c->userData1 = sphere.userData;
-			c->userData2 = 0;
-			c->geomFlag = 0;
-			c->distance = isect.dist;
+	TraceRaySphere(start, dir, len, c);
+}
+
+void CollisionSpace::TraceRays(int numRays, const vector3d *starts, const vector3d *dirs, const double *lens, CollisionContact *contacts, const Geom *ignore /*= nullptr*/)
+{
+	PROFILE_SCOPED()
+
+	// { geom, ray } pairs found by the object trees. Rays hitting the same
+	// geom are then traced through its GeomTree together.
+	std::vector<std::pair<Geom *, uint32_t>> geomRays;
+	std::vector<uint32_t> isect_result;
+	isect_result.reserve(8);
+
+	for (int ray = 0; ray < numRays; ray++) {
+		const vector3d &dir = dirs[ray];
+		vector3d invDir(1.0 / dir.x, 1.0 / dir.y, 1.0 / dir.z);
+		contacts[ray].distance = lens[ray];
+
+		if (m_enabledStaticGeoms > 0) {
+			m_staticObjectTree->TraceRay(starts[ray], invDir, lens[ray], isect_result);
+
+			for (uint32_t &idx : isect_result)
+				geomRays.emplace_back(m_staticGeoms[idx], ray);
+
+			isect_result.clear();
 		}
+
+		if (m_enabledDynGeoms > 0) {
+			m_dynamicObjectTree->TraceRay(starts[ray], invDir, lens[ray], isect_result);
+
+			for (uint32_t &idx : isect_result) {
+				if (m_geoms[idx] != ignore)
+					geomRays.emplace_back(m_geoms[idx], ray);
+			}
+
+			isect_result.clear();
+		}
+	}
+
+	std::stable_sort(geomRays.begin(), geomRays.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+	std::vector<vector3f> modelStarts;
+	std::vector<vector3f> modelDirs;
+	std::vector<isect_t> isects;
+
+	for (size_t begin = 0; begin < geomRays.size();) {
+		Geom *g = geomRays[begin].first;
+		size_t end = begin + 1;
+		while (end < geomRays.size() && geomRays[end].first == g)
+			end++;
+
+		const matrix4x4d &invTrans = g->GetInvTransform();
+		modelStarts.clear();
+		modelDirs.clear();
+		isects.clear();
+		for (size_t idx = begin; idx < end; idx++) {
+			const uint32_t ray = geomRays[idx].second;
+			modelStarts.push_back(vector3f(invTrans * starts[ray]));
+			modelDirs.push_back(vector3f(invTrans.ApplyRotationOnly(dirs[ray])));
+			isects.push_back({ -1, float(contacts[ray].distance) });
+		}
+
+		g->GetGeomTree()->TraceRays(int(end - begin), modelStarts.data(), modelDirs.data(), isects.data());
+
+		for (size_t idx = begin; idx < end; idx++) {
+			const uint32_t ray = geomRays[idx].second;
+			const isect_t &isect = isects[idx - begin];
+			if (isect.triIdx != -1)
+				SetGeomContact(g, starts[ray], dirs[ray], lens[ray], isect, &contacts[ray]);
+		}
+
+		begin = end;
+	}
+
+	for (int ray = 0; ray < numRays; ray++)
+		TraceRaySphere(starts[ray], dirs[ray], lens[ray], &contacts[ray]);
+}
+
+void CollisionSpace::SweepSphere(const vector3d &start, const vector3d &dir, double len, double radius, CollisionContact *c, const Geom *ignore /*= nullptr*/)
+{
+	PROFILE_SCOPED()
+	c->distance = len;
+
+	AABBd sweep{ start, start };
+	sweep.Update(start + dir * len);
+	sweep.min -= vector3d(radius);
+	sweep.max += vector3d(radius);
+
+	// the trees index into the geom lists as they were when last built
+	std::vector<std::pair<uint32_t, uint32_t>> isect_result;
+	if (m_enabledStaticGeoms > 0 && !m_needStaticGeomRebuild) {
+		m_staticObjectTree->ComputeOverlap(0, sweep, isect_result);
+
+		for (const auto &isect : isect_result)
+			SweepSphereGeom(m_staticGeoms[isect.second], start, dir, len, radius, c, ignore);
+
+		isect_result.clear();
+	}
+
+	if (m_enabledDynGeoms > 0 && !m_needDynamicGeomRebuild) {
+		m_dynamicObjectTree->ComputeOverlap(0, sweep, isect_result);
+
+		for (const auto &isect : isect_result)
+			SweepSphereGeom(m_geoms[isect.second], start, dir, len, radius, c, ignore);
+	}
+}
+
+void CollisionSpace::SweepSphereGeom(Geom *g, const vector3d &start, const vector3d &dir, double len, double radius, CollisionContact *c, const Geom *ignore)
+{
+	if (g == ignore || !g->IsEnabled())
+		return;
+	if (ignore && ignore->GetGroup() && ignore->GetGroup() == g->GetGroup())
+		return;
+
+	const matrix4x4d &invTrans = g->GetInvTransform();
+	vector3f modelStart = vector3f(invTrans * start);
+	vector3f modelDir = vector3f(invTrans.ApplyRotationOnly(dir));
+
+	isect_t isect;
+	isect.dist = float(c->distance);
+	isect.triIdx = -1;
+	g->GetGeomTree()->SweepSphere(modelStart, modelDir, float(radius), &isect);
+	if (isect.triIdx != -1)
+		SetGeomContact(g, start, dir, len, isect, c);
+}
+
+void CollisionSpace::TraceRaySphere(const vector3d &start, const vector3d &dir, double len, CollisionContact *c)
+{
+	isect_t isect;
+	isect.dist = float(c->distance);
+	isect.triIdx = -1;
+	CollideRaySphere(start, dir, &isect);
+	if (isect.triIdx != -1) {
+		c->pos = start + dir * double(isect.dist);
+		c->normal = vector3d(0.0);
+		c->depth = len - isect.dist;
+		c->triIdx = -1;
+		c->userData1 = sphere.userData;
+		c->userData2 = 0;
+		c->geomFlag = 0;
+		c->distance = isect.dist;
 	}
 }
 
@@ -169,23 +340,27 @@ void CollisionSpace::TraceRayGeom(Geom *g, const vector3d &start, const vector3d
 	isect.dist = float(c->distance);
 	isect.triIdx = -1;
 	g->GetGeomTree()->TraceRay(modelStart, modelDir, &isect);
-	if (isect.triIdx != -1) {
-		c->pos = start + dir * double(isect.dist);
-
-		vector3f n = g->GetGeomTree()->GetTriNormal(isect.triIdx);
-		c->normal = vector3d(n.x, n.y, n.z);
-		c->normal = g->GetTransform().ApplyRotationOnly(c->normal);
+	if (isect.triIdx != -1)
+		SetGeomContact(g, start, dir, len, isect, c);
+}
 
-		c->depth = len - isect.dist;
-		c->triIdx = isect.triIdx;
-		c->userData1 = g->GetUserData();
-		c->userData2 = 0;
-		c->geomFlag = g->GetGeomTree()->GetTriFlag(isect.triIdx);
-		c->distance = isect.dist;
-	}
+void CollisionSpace::SetGeomContact(const Geom *g, const vector3d &start, const vector3d &dir, double len, const isect_t &isect, CollisionContact *c)
+{
+	c->pos = start + dir * double(isect.dist);
+
+	vector3f n = g->GetGeomTree()->GetTriNormal(isect.triIdx);
+	c->normal = vector3d(n.x, n.y, n.z);
+	c->normal = g->GetTransform().ApplyRotationOnly(c->normal);
+
+	c->depth = len - isect.dist;
+	c->triIdx = isect.triIdx;
+	c->userData1 = g->GetUserData();
+	c->userData2 = 0;
+	c->geomFlag = g->GetGeomTree()->GetTriFlag(isect.triIdx);
+	c->distance = isect.dist;
 }
 
-void CollisionSpace::CollideGeom(Geom *a, Geom *b, void (*callback)(CollisionContact *))
+void CollisionSpace::CollideGeom(Geom *a, Geom *b, std::vector<CollisionContact> &contacts)
 {
 	PROFILE_SCOPED()
 
@@ -200,12 +375,34 @@ void CollisionSpace::CollideGeom(Geom *a, Geom *b, void (*callback)(CollisionCon
 	double r1 = a->GetGeomTree()->GetRadius();
 	double r2 = b->GetGeomTree()->GetRadius();
 
-	if ((pos1 - pos2).Length() <= (r1 + r2)) {
-		std::vector<CollisionContact> contacts = a->Collide(b);
+	if ((pos1 - pos2).Length() > (r1 + r2))
+		return;
 
-		for (auto &contact : contacts) {
-			callback(&contact);
+	// entries still in the cache were used during the previous pass
+	auto [iter, inserted] = m_contactCache.try_emplace(GeomPair(a, b));
+	ContactCacheEntry &entry = iter->second;
+	const matrix4x4d relTransform = b->GetInvTransform() * a->GetTransform();
+	const bool isCached = !inserted && IsSameRelTransform(relTransform, entry.relTransform);
+	entry.lastPass = m_collisionPass;
+
+	if (isCached) {
+		for (CollisionContact contact : entry.contacts) {
+			contact.pos = a->GetTransform() * contact.pos;
+			contact.normal = a->GetTransform().ApplyRotationOnly(contact.normal);
+			contacts.push_back(contact);
 		}
+
+		return;
+	}
+
+	std::vector<CollisionContact> geomContacts = a->Collide(b);
+	contacts.insert(contacts.end(), geomContacts.begin(), geomContacts.end());
+
+	entry.relTransform = relTransform;
+	entry.contacts = std::move(geomContacts);
+	for (CollisionContact &contact : entry.contacts) {
+		contact.pos = a->GetInvTransform() * contact.pos;
+		contact.normal = a->GetInvTransform().ApplyRotationOnly(contact.normal);
 	}
 }
 
@@ -223,11 +420,42 @@ void CollisionSpace::RebuildObjectTrees()
 		m_needStaticGeomRebuild = false;
 	}
 
+	UpdateDynamicTree();
+}
+
+void CollisionSpace::UpdateDynamicTree()
+{
+	PROFILE_SCOPED()
+
+	m_enabledDynGeoms = SortEnabledGeoms(m_geoms);
+
+	if (m_enabledDynGeoms == 0) {
+		m_dynamicObjectTree->Clear();
+		m_dynamicTreeGeoms.clear();
+		m_needDynamicGeomRebuild = false;
+		return;
+	}
+
 	// NOTE: we store AABBs in m_geomAabbs for fast O(1) lookup during Collide()
 	// This doubles the memory cost but allows SingleBVHTree to store leaf nodes
 	// in a cache-friendly order.
-	m_enabledDynGeoms = SortEnabledGeoms(m_geoms);
-	RebuildBVHTree(m_dynamicObjectTree.get(), m_enabledDynGeoms, m_geoms, m_geomAabbs);
+	const AABBd bounds = UpdateGeomAabbs(m_enabledDynGeoms, m_geoms, m_geomAabbs);
+
+	// Most geoms barely move between physics steps, so as long as the same
+	// geoms are enabled in the same order the existing tree only needs its
+	// node bounds updated. Refitting gradually degrades the tree as geoms
+	// move relative to each other, so rebuild once it has become too costly.
+	const bool canRefit = !m_needDynamicGeomRebuild &&
+		m_dynamicTreeGeoms.size() == m_enabledDynGeoms &&
+		std::equal(m_dynamicTreeGeoms.begin(), m_dynamicTreeGeoms.end(), m_geoms.begin());
+
+	if (canRefit && m_dynamicObjectTree->Refit(m_geomAabbs.data()) <= m_dynamicTreeSAH * MAX_REFIT_SAH_GROWTH)
+		return;
+
+	m_dynamicObjectTree->Build(bounds, m_geomAabbs.data(), m_enabledDynGeoms);
+	m_dynamicTreeSAH = m_dynamicObjectTree->CalculateSAH();
+	m_dynamicTreeGeoms.assign(m_geoms.begin(), m_geoms.begin() + m_enabledDynGeoms);
+	m_needDynamicGeomRebuild = false;
 }
 
 uint32_t CollisionSpace::SortEnabledGeoms(std::vector<Geom *> &geoms)
@@ -264,6 +492,12 @@ void CollisionSpace::RebuildBVHTree(SingleBVHTree *tree, uint32_t numGeoms, cons
 		return;
 	}
 
+	const AABBd bounds = UpdateGeomAabbs(numGeoms, geoms, aabbs);
+	tree->Build(bounds, aabbs.data(), aabbs.size());
+}
+
+AABBd CollisionSpace::UpdateGeomAabbs(uint32_t numGeoms, const std::vector<Geom *> &geoms, std::vector<AABBd> &aabbs)
+{
 	aabbs.resize(0);
 	aabbs.reserve(numGeoms);
 
@@ -282,13 +516,23 @@ void CollisionSpace::RebuildBVHTree(SingleBVHTree *tree, uint32_t numGeoms, cons
 		bounds.Update(aabb);
 	}
 
-	tree->Build(bounds, aabbs.data(), aabbs.size());
+	return bounds;
 }
 
 void CollisionSpace::Collide(void (*callback)(CollisionContact *))
+{
+	std::vector<CollisionContact> contacts;
+	Collide(contacts);
+
+	for (CollisionContact &contact : contacts)
+		callback(&contact);
+}
+
+void CollisionSpace::Collide(std::vector<CollisionContact> &contacts)
 {
 	PROFILE_SCOPED()
 	m_duringCollision = true;
+	m_collisionPass++;
 
 	RebuildObjectTrees();
 
@@ -316,7 +560,7 @@ void CollisionSpace::Collide(void (*callback)(CollisionContact *))
 
 	// No mailbox test needed for colliding a dynamic geom against static geoms
 	for (const Intersection &isect : static_isect) {
-		CollideGeom(m_geoms[isect.first], m_staticGeoms[isect.second], callback);
+		CollideGeom(m_geoms[isect.first], m_staticGeoms[isect.second], contacts);
 	}
 
 	// Simple mailbox test to ensure every valid collision is only processed once
@@ -324,15 +568,23 @@ void CollisionSpace::Collide(void (*callback)(CollisionContact *))
 		if (isect.first >= isect.second)
 			continue;
 
-		CollideGeom(m_geoms[isect.first], m_geoms[isect.second], callback);
+		CollideGeom(m_geoms[isect.first], m_geoms[isect.second], contacts);
 	}
 
-	CollidePlanet(callback);
+	CollidePlanet(contacts);
+
+	// drop the cached contacts of geom pairs which are no longer close
+	for (auto iter = m_contactCache.begin(); iter != m_contactCache.end();) {
+		if (iter->second.lastPass != m_collisionPass)
+			iter = m_contactCache.erase(iter);
+		else
+			++iter;
+	}
 
 	m_duringCollision = false;
 }
 
-void CollisionSpace::CollidePlanet(void (*callback)(CollisionContact *))
+void CollisionSpace::CollidePlanet(std::vector<CollisionContact> &contacts)
 {
 	PROFILE_SCOPED()
 
@@ -344,7 +596,7 @@ void CollisionSpace::CollidePlanet(void (*callback)(CollisionContact *))
 			if (!g->IsEnabled())
 				continue;
 
-			g->CollideSphere(sphere, callback);
+			g->CollideSphere(sphere, contacts);
 		}
 	}
 }
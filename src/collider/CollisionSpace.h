@@ -5,16 +5,18 @@
 #define _COLLISION_SPACE
 
 #include "../Aabb.h"
+#include "../matrix4x4.h"
 #include "../vector3.h"
+#include "CollisionContact.h"
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 class Geom;
 class SingleBVHTree;
 
 struct isect_t;
-struct CollisionContact;
 
 struct Sphere {
 	vector3d pos;
@@ -34,7 +36,23 @@ public:
 	void AddStaticGeom(Geom *);
 	void RemoveStaticGeom(Geom *);
 	void TraceRay(const vector3d &start, const vector3d &dir, double len, CollisionContact *c, const Geom *ignore = nullptr);
+	// Trace numRays rays at once, with the same results as calling TraceRay()
+	// for each of them. The rays hitting each geom are traced through its
+	// GeomTree as packets; see GeomTree::TraceRays().
+	void TraceRays(int numRays, const vector3d *starts, const vector3d *dirs, const double *lens, CollisionContact *contacts, const Geom *ignore = nullptr);
+	// Sweep a sphere of the given radius from start along dir (unit length)
+	// for up to len, and fill in c for the first geom it touches, with
+	// c->distance how far the centre got. Geoms sharing a group with ignore
+	// are skipped, and so are those the sphere touches at the start, as the
+	// collision pass already deals with them. The planet isn't swept against;
+	// bodies collide with its terrain separately.
+	void SweepSphere(const vector3d &start, const vector3d &dir, double len, double radius, CollisionContact *c, const Geom *ignore = nullptr);
 	void Collide(void (*callback)(CollisionContact *));
+	// Collide all geoms in this space and append the resulting contacts to
+	// the given buffer instead of handling them immediately. Collision spaces
+	// are independent of each other, so different spaces may be collided on
+	// different threads at the same time.
+	void Collide(std::vector<CollisionContact> &contacts);
 	void SetSphere(const vector3d &pos, double radius, void *user_data)
 	{
 		sphere.pos = pos;
@@ -59,14 +77,39 @@ public:
 
 private:
 	using Intersection = std::pair<uint32_t, uint32_t>;
+	using GeomPair = std::pair<const Geom *, const Geom *>;
+
+	// Contacts last found between a pair of geoms. If the geoms haven't
+	// moved relative to each other since, the contacts are reused instead of
+	// colliding the meshes again (e.g. for ships landed or parked in a station).
+	struct ContactCacheEntry {
+		// transform from the first geom's model space to the second's
+		matrix4x4d relTransform;
+		// contact positions and normals are in the first geom's model space
+		std::vector<CollisionContact> contacts;
+		uint32_t lastPass;
+	};
+
+	struct GeomPairHash {
+		size_t operator()(const GeomPair &pair) const
+		{
+			return std::hash<const Geom *>()(pair.first) ^ (std::hash<const Geom *>()(pair.second) * 31);
+		}
+	};
 
 	void CollideRaySphere(const vector3d &start, const vector3d &dir, isect_t *isect);
 	uint32_t SortEnabledGeoms(std::vector<Geom *> &geoms);
+	AABBd UpdateGeomAabbs(uint32_t numEnabled, const std::vector<Geom *> &geoms, std::vector<AABBd> &aabbs);
 	void RebuildBVHTree(SingleBVHTree *tree, uint32_t numEnabled, const std::vector<Geom *> &geoms, std::vector<AABBd> &aabbs);
+	void UpdateDynamicTree();
+	void EvictContactCache(const Geom *geom);
 
-	void CollideGeom(Geom *a, Geom *b, void (*callback)(CollisionContact *));
-	void CollidePlanet(void (*callback)(CollisionContact *));
+	void CollideGeom(Geom *a, Geom *b, std::vector<CollisionContact> &contacts);
+	void CollidePlanet(std::vector<CollisionContact> &contacts);
 	void TraceRayGeom(Geom *g, const vector3d &start, const vector3d &dir, double len, CollisionContact *c);
+	void TraceRaySphere(const vector3d &start, const vector3d &dir, double len, CollisionContact *c);
+	void SweepSphereGeom(Geom *g, const vector3d &start, const vector3d &dir, double len, double radius, CollisionContact *c, const Geom *ignore);
+	void SetGeomContact(const Geom *g, const vector3d &start, const vector3d &dir, double len, const isect_t &isect, CollisionContact *c);
 
 	std::unique_ptr<SingleBVHTree> m_staticObjectTree;
 	std::unique_ptr<SingleBVHTree> m_dynamicObjectTree;
@@ -80,7 +123,18 @@ private:
 	std::vector<AABBd> m_geomAabbs;
 	Sphere sphere;
 
+	// enabled geoms the dynamic tree was last built from, in leaf index order
+	std::vector<Geom *> m_dynamicTreeGeoms;
+	// SAH cost of the dynamic tree when it was last built
+	double m_dynamicTreeSAH;
+
+	std::unordered_map<GeomPair, ContactCacheEntry, GeomPairHash> m_contactCache;
+	// incremented on every call to Collide(); cache entries not used during
+	// a pass are dropped at the end of it
+	uint32_t m_collisionPass;
+
 	bool m_needStaticGeomRebuild;
+	bool m_needDynamicGeomRebuild;
 	bool m_duringCollision;
 
 	static int s_nextHandle;
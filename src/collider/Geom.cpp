@@ -43,7 +43,7 @@ void Geom::MoveTo(const matrix4x4d &m, const vector3d &pos)
 	m_invOrient = m_orient.Inverse();
 }
 
-void Geom::CollideSphere(Sphere &sphere, void (*callback)(CollisionContact *)) const
+void Geom::CollideSphere(Sphere &sphere, std::vector<CollisionContact> &contacts) const
 {
 	PROFILE_SCOPED()
 	/* if the geom is actually within the sphere, create a contact so
@@ -59,7 +59,7 @@ void Geom::CollideSphere(Sphere &sphere, void (*callback)(CollisionContact *)) c
 		contact.userData1 = this->m_data;
 		contact.userData2 = sphere.userData;
 		contact.geomFlag = 0;
-		callback(&contact);
+		contacts.push_back(contact);
 		return;
 	}
 }
@@ -116,8 +116,8 @@ void Geom::CollideEdgesWithTrisOf(std::vector<CollisionContact> &contacts, size_
 		uint32_t triNode;
 	};
 
-	SingleBVHTreeBase *edgeBvh = GetGeomTree()->GetEdgeTree();
-	SingleBVHTreeBase *triBvh = b->GetGeomTree()->GetTriTree();
+	const CompactBVHTree *edgeBvh = GetGeomTree()->GetEdgeTree();
+	const CompactBVHTree *triBvh = b->GetGeomTree()->GetTriTree();
 
 	// Allocate space for BVH trace intersections (to avoid heap-allocating inside CollideEdgesTris)
 	std::vector<uint32_t> isect_buf;
@@ -132,8 +132,8 @@ void Geom::CollideEdgesWithTrisOf(std::vector<CollisionContact> &contacts, size_
 
 	while ((stackpos >= 0) && (contacts.size() < maxContacts)) {
 		stackobj curr = stack[stackpos--];
-		const SingleBVHTreeBase::Node *edgeNode = edgeBvh->GetNode(curr.edgeNode);
-		const SingleBVHTreeBase::Node *triNode = triBvh->GetNode(curr.triNode);
+		const CompactBVHTree::Node *edgeNode = edgeBvh->GetNode(curr.edgeNode);
+		const CompactBVHTree::Node *triNode = triBvh->GetNode(curr.triNode);
 
 		// NOTE:
 		// This behavior is preserved almost verbatim from existing collision
@@ -142,33 +142,33 @@ void Geom::CollideEdgesWithTrisOf(std::vector<CollisionContact> &contacts, size_
 		// However, this is the most performant version of this code by a large
 		// margin, with seemingly no impact on collision robustness.
 
-		if (!edgeNode->kids[0]) {
+		if (edgeNode->IsLeaf()) {
 			// Reached edge leaf node, perform edge-triangle ray intersection
 			CollideEdgeTris(contacts, transTo, b, edgeNode->leafIndex, curr.triNode, isect_buf);
 
 			if (contacts.size() >= maxContacts) break;
-		} else if (!triNode->kids[0]) {
+		} else if (triNode->IsLeaf()) {
 			// Reached triangle leaf node, recursively descend through edge nodes
-			stack[++stackpos] = stackobj { edgeNode->kids[1], curr.triNode };
-			stack[++stackpos] = stackobj { edgeNode->kids[0], curr.triNode };
+			stack[++stackpos] = stackobj { edgeNode->firstKid + 1, curr.triNode };
+			stack[++stackpos] = stackobj { edgeNode->firstKid, curr.triNode };
 		} else {
 			// does the edgeNode (with its aabb described in 6 planes transformed and rotated to
 			// b's coordinates) intersect with one or other of b's child nodes?
-			AABBd rotAabb = rotateAaabb(edgeNode->aabb, transTo);
-			const bool left = rotAabb.Intersects(triBvh->GetNode(triNode->kids[0])->aabb);
-			const bool right = rotAabb.Intersects(triBvh->GetNode(triNode->kids[1])->aabb);
+			AABBd rotAabb = rotateAaabb(edgeNode->GetAabb(), transTo);
+			const bool left = rotAabb.Intersects(triBvh->GetNode(triNode->firstKid)->GetAabb());
+			const bool right = rotAabb.Intersects(triBvh->GetNode(triNode->firstKid + 1)->GetAabb());
 
 			if (left & right) {
 				// Recurse into edge nodes until we find one that's smaller than the tri node
 				// (or hit a single edge leaf)
-				stack[++stackpos] = stackobj { edgeNode->kids[1], curr.triNode };
-				stack[++stackpos] = stackobj { edgeNode->kids[0], curr.triNode };
+				stack[++stackpos] = stackobj { edgeNode->firstKid + 1, curr.triNode };
+				stack[++stackpos] = stackobj { edgeNode->firstKid, curr.triNode };
 			} else if (left) {
 				// Triangle BVH node is larger than the edge, split it and try again
-				stack[++stackpos] = stackobj { curr.edgeNode, triNode->kids[0] };
+				stack[++stackpos] = stackobj { curr.edgeNode, triNode->firstKid };
 			} else if (right) {
 				// Triangle BVH node is larger than the edge, split it and try again
-				stack[++stackpos] = stackobj { curr.edgeNode, triNode->kids[1] };
+				stack[++stackpos] = stackobj { curr.edgeNode, triNode->firstKid + 1 };
 			}
 		}
 	}
@@ -28,7 +28,7 @@ public:
 	inline const GeomTree *GetGeomTree() const { return m_geomtree; }
 
 	std::vector<CollisionContact> Collide(Geom *b) const;
-	void CollideSphere(Sphere &sphere, void (*callback)(CollisionContact *)) const;
+	void CollideSphere(Sphere &sphere, std::vector<CollisionContact> &contacts) const;
 	inline void *GetUserData() const { return m_data; }
 	inline void SetMailboxIndex(int idx) { m_mailboxIndex = idx; }
 	inline int GetMailboxIndex() const { return m_mailboxIndex; }
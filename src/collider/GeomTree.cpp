@@ -11,8 +11,27 @@
 #include <array>
 #include <map>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#define GEOMTREE_SIMD_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GEOMTREE_SIMD_SSE2 1
+#endif
+
 #pragma GCC optimize("O3")
 
+// Build a compact BVH tree over the given object AABBs
+static std::unique_ptr<CompactBVHTree> BuildCompactTree(const AABBd &bounds, AABBd *objAabbs, uint32_t numObjs)
+{
+	BinnedAreaBVHTree tree;
+	tree.Build(bounds, objAabbs, numObjs);
+
+	std::unique_ptr<CompactBVHTree> compactTree(new CompactBVHTree());
+	compactTree->Build(tree);
+	return compactTree;
+}
+
 GeomTree::~GeomTree()
 {
 }
@@ -93,7 +112,7 @@ GeomTree::GeomTree(const int numVerts, const int numTris, const std::vector<vect
 
 	m_numEdges = edges.size();
 	m_edges.resize(m_numEdges);
-	m_edgeAABBs.reset(new AABBd[m_numEdges]);
+	std::vector<AABBd> edgeAabbs(m_numEdges);
 
 	int pos = 0;
 	typedef EdgeType::iterator MapPairIter;
@@ -114,10 +133,7 @@ GeomTree::GeomTree(const int numVerts, const int numTris, const std::vector<vect
 		m_edges[pos].dir = dir;
 
 		// Build list of AABBs for edge BVH tree
-		AABBd edgeAabb = AABBd::Invalid();
-		edgeAabb.Update(vector3d(v1));
-		edgeAabb.Update(vector3d(v2));
-		m_edgeAABBs[pos] = edgeAabb;
+		edgeAabbs[pos] = GetEdgeAabb(pos);
 	}
 
 	// Compute the bounds for edge/triangle BVH tree
@@ -125,28 +141,10 @@ GeomTree::GeomTree(const int numVerts, const int numTris, const std::vector<vect
 
 	{
 		PROFILE_SCOPED_DESC("GeomTree::CreateEdgeTree");
-		m_edgeTree.reset(new BinnedAreaBVHTree());
-		m_edgeTree->Build(bounds, m_edgeAABBs.get(), m_numEdges);
+		m_edgeTree = BuildCompactTree(bounds, edgeAabbs.data(), m_numEdges);
 	}
 
-	{
-		PROFILE_SCOPED_DESC("GeomTree::CreateTriTree");
-
-		m_triAABBs.reset(new AABBd[m_numTris]);
-		for (size_t i = 0; i < m_numTris; i++) {
-			const vector3d v0 = vector3d(m_vertices[m_indices[i * 3 + 0]]);
-			const vector3d v1 = vector3d(m_vertices[m_indices[i * 3 + 1]]);
-			const vector3d v2 = vector3d(m_vertices[m_indices[i * 3 + 2]]);
-
-			AABBd aabb = { v0, v0 };
-			aabb.Update(v1);
-			aabb.Update(v2);
-			m_triAABBs.get()[i] = aabb;
-		}
-
-		m_triTree.reset(new BinnedAreaBVHTree());
-		m_triTree->Build(bounds, m_triAABBs.get(), m_numTris);
-	}
+	CreateTriTree(bounds);
 }
 
 GeomTree::GeomTree(Serializer::Reader &rd)
@@ -168,15 +166,14 @@ GeomTree::GeomTree(Serializer::Reader &rd)
 
 		Aabb _oldAabb;
 		const Uint32 numAabbs = rd.Int32();
-		m_edgeAABBs.reset(new AABBd[numAabbs]);
+		std::vector<AABBd> edgeAabbs(numAabbs);
 
 		for (Uint32 iAabb = 0; iAabb < numAabbs; ++iAabb) {
 			rd >> _oldAabb;
-			m_edgeAABBs.get()[iAabb] = AABBd { _oldAabb.min, _oldAabb.max };
+			edgeAabbs[iAabb] = AABBd { _oldAabb.min, _oldAabb.max };
 		}
 
-		m_edgeTree.reset(new BinnedAreaBVHTree());
-		m_edgeTree->Build(bounds, m_edgeAABBs.get(), m_numEdges);
+		m_edgeTree = BuildCompactTree(bounds, edgeAabbs.data(), m_numEdges);
 	}
 
 	{
@@ -204,25 +201,35 @@ GeomTree::GeomTree(Serializer::Reader &rd)
 		m_triFlags[iTri] = rd.Int32();
 	}
 
-	{
-		PROFILE_SCOPED_DESC("GeomTree::CreateTriTree");
-
-		// TODO: triangle AABBs should be written to the SGM file similarly to edge AABBs
-		m_triAABBs.reset(new AABBd[m_numTris]);
-		for (size_t i = 0; i < m_numTris; i++) {
-			const vector3d v0 = vector3d(m_vertices[m_indices[i * 3 + 0]]);
-			const vector3d v1 = vector3d(m_vertices[m_indices[i * 3 + 1]]);
-			const vector3d v2 = vector3d(m_vertices[m_indices[i * 3 + 2]]);
-
-			AABBd aabb = { v0, v0 };
-			aabb.Update(v1);
-			aabb.Update(v2);
-			m_triAABBs.get()[i] = aabb;
-		}
+	CreateTriTree(bounds);
+}
 
-		m_triTree.reset(new BinnedAreaBVHTree());
-		m_triTree->Build(bounds, m_triAABBs.get(), m_numTris);
+void GeomTree::CreateTriTree(const AABBd &bounds)
+{
+	PROFILE_SCOPED_DESC("GeomTree::CreateTriTree");
+
+	// TODO: triangle AABBs should be written to the SGM file similarly to edge AABBs
+	std::vector<AABBd> triAabbs(m_numTris);
+	for (int i = 0; i < m_numTris; i++) {
+		const vector3d v0 = vector3d(m_vertices[m_indices[i * 3 + 0]]);
+		const vector3d v1 = vector3d(m_vertices[m_indices[i * 3 + 1]]);
+		const vector3d v2 = vector3d(m_vertices[m_indices[i * 3 + 2]]);
+
+		AABBd aabb = { v0, v0 };
+		aabb.Update(v1);
+		aabb.Update(v2);
+		triAabbs[i] = aabb;
 	}
+
+	m_triTree = BuildCompactTree(bounds, triAabbs.data(), m_numTris);
+}
+
+AABBd GeomTree::GetEdgeAabb(int edgeIdx) const
+{
+	AABBd edgeAabb = AABBd::Invalid();
+	edgeAabb.Update(vector3d(m_vertices[m_edges[edgeIdx].v1i]));
+	edgeAabb.Update(vector3d(m_vertices[m_edges[edgeIdx].v2i]));
+	return edgeAabb;
 }
 
 void GeomTree::TraceRay(const vector3f &start, const vector3f &dir, isect_t *isect) const
@@ -236,6 +243,377 @@ void GeomTree::TraceRay(const vector3f &start, const vector3f &dir, isect_t *ise
 	}
 }
 
+// =============================================================================
+// Ray packets
+//
+// The triangle test below mirrors RayTriIntersect() operation for operation,
+// so a ray traced as part of a packet hits the same triangle at the same
+// distance as when traced on its own.
+
+#if defined(GEOMTREE_SIMD_AVX) || defined(GEOMTREE_SIMD_SSE2)
+
+namespace {
+#if defined(GEOMTREE_SIMD_AVX)
+	struct Lanes {
+		using V = __m256;
+		static constexpr int WIDTH = 8;
+		static V load(const float *p) { return _mm256_loadu_ps(p); }
+		static void store(float *p, V v) { _mm256_storeu_ps(p, v); }
+		static V set1(float f) { return _mm256_set1_ps(f); }
+		static V add(V a, V b) { return _mm256_add_ps(a, b); }
+		static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+		static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+		static V div(V a, V b) { return _mm256_div_ps(a, b); }
+		static V min(V a, V b) { return _mm256_min_ps(a, b); }
+		static V max(V a, V b) { return _mm256_max_ps(a, b); }
+		static V and_(V a, V b) { return _mm256_and_ps(a, b); }
+		static V or_(V a, V b) { return _mm256_or_ps(a, b); }
+		static V cmpgt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		static V cmplt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static V cmpge(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+		static V select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+		static int movemask(V v) { return _mm256_movemask_ps(v); }
+	};
+#else
+	struct Lanes {
+		using V = __m128;
+		static constexpr int WIDTH = 4;
+		static V load(const float *p) { return _mm_loadu_ps(p); }
+		static void store(float *p, V v) { _mm_storeu_ps(p, v); }
+		static V set1(float f) { return _mm_set1_ps(f); }
+		static V add(V a, V b) { return _mm_add_ps(a, b); }
+		static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+		static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+		static V div(V a, V b) { return _mm_div_ps(a, b); }
+		static V min(V a, V b) { return _mm_min_ps(a, b); }
+		static V max(V a, V b) { return _mm_max_ps(a, b); }
+		static V and_(V a, V b) { return _mm_and_ps(a, b); }
+		static V or_(V a, V b) { return _mm_or_ps(a, b); }
+		static V cmpgt(V a, V b) { return _mm_cmpgt_ps(a, b); }
+		static V cmplt(V a, V b) { return _mm_cmplt_ps(a, b); }
+		static V cmpge(V a, V b) { return _mm_cmpge_ps(a, b); }
+		static V select(V mask, V a, V b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+		static int movemask(V v) { return _mm_movemask_ps(v); }
+	};
+#endif
+
+	using V = Lanes::V;
+	constexpr int W = Lanes::WIDTH;
+
+	// Direction components are clamped away from zero before inverting so
+	// the slab test never multiplies zero by infinity
+	constexpr float MIN_RAY_DIR = 1e-20f;
+
+	struct LaneVec {
+		V x, y, z;
+	};
+
+	inline LaneVec splat(const vector3f &v)
+	{
+		return { Lanes::set1(v.x), Lanes::set1(v.y), Lanes::set1(v.z) };
+	}
+
+	inline LaneVec sub(const LaneVec &a, const LaneVec &b)
+	{
+		return { Lanes::sub(a.x, b.x), Lanes::sub(a.y, b.y), Lanes::sub(a.z, b.z) };
+	}
+
+	inline V dot(const LaneVec &a, const LaneVec &b)
+	{
+		return Lanes::add(Lanes::add(Lanes::mul(a.x, b.x), Lanes::mul(a.y, b.y)), Lanes::mul(a.z, b.z));
+	}
+
+	inline LaneVec cross(const LaneVec &a, const LaneVec &b)
+	{
+		return {
+			Lanes::sub(Lanes::mul(a.y, b.z), Lanes::mul(a.z, b.y)),
+			Lanes::sub(Lanes::mul(a.z, b.x), Lanes::mul(a.x, b.z)),
+			Lanes::sub(Lanes::mul(a.x, b.y), Lanes::mul(a.y, b.x))
+		};
+	}
+
+	struct RayPacket {
+		LaneVec origin;
+		LaneVec dir;
+		LaneVec invDir;
+		V active;
+		V dist;
+		int triIdx[W];
+	};
+
+	// Returns a mask of the active rays which hit the AABB closer than their current hit
+	inline V IntersectsRays(const CompactBVHTree::Node *node, const RayPacket &rays)
+	{
+		const LaneVec l1 = { Lanes::mul(Lanes::sub(Lanes::set1(node->min.x), rays.origin.x), rays.invDir.x),
+			Lanes::mul(Lanes::sub(Lanes::set1(node->min.y), rays.origin.y), rays.invDir.y),
+			Lanes::mul(Lanes::sub(Lanes::set1(node->min.z), rays.origin.z), rays.invDir.z) };
+		const LaneVec l2 = { Lanes::mul(Lanes::sub(Lanes::set1(node->max.x), rays.origin.x), rays.invDir.x),
+			Lanes::mul(Lanes::sub(Lanes::set1(node->max.y), rays.origin.y), rays.invDir.y),
+			Lanes::mul(Lanes::sub(Lanes::set1(node->max.z), rays.origin.z), rays.invDir.z) };
+
+		const V lmin = Lanes::max(Lanes::min(l1.x, l2.x), Lanes::max(Lanes::min(l1.y, l2.y), Lanes::min(l1.z, l2.z)));
+		const V lmax = Lanes::min(Lanes::max(l1.x, l2.x), Lanes::min(Lanes::max(l1.y, l2.y), Lanes::max(l1.z, l2.z)));
+
+		const V hit = Lanes::and_(Lanes::cmpge(lmax, Lanes::set1(0.f)), Lanes::and_(Lanes::cmpge(lmax, lmin), Lanes::cmplt(lmin, rays.dist)));
+		return Lanes::and_(hit, rays.active);
+	}
+
+	// Packet version of GeomTree::RayTriIntersect(), for rays with individual origins
+	inline void RayTriIntersect(const vector3f *vertices, const Uint32 *indices, int triIdx, RayPacket &rays)
+	{
+		const vector3f a(vertices[indices[triIdx + 0]]);
+		const vector3f b(vertices[indices[triIdx + 1]]);
+		const vector3f c(vertices[indices[triIdx + 2]]);
+
+		const LaneVec n = splat((c - a).Cross(b - a));
+
+		const LaneVec ao = sub(splat(a), rays.origin);
+		const LaneVec bo = sub(splat(b), rays.origin);
+		const LaneVec co = sub(splat(c), rays.origin);
+		const V nominator = dot(n, ao);
+
+		const V v0d = dot(cross(co, bo), rays.dir);
+		const V v1d = dot(cross(bo, ao), rays.dir);
+		const V v2d = dot(cross(ao, co), rays.dir);
+
+		const V zero = Lanes::set1(0.f);
+		const V front = Lanes::and_(Lanes::cmpgt(v0d, zero), Lanes::and_(Lanes::cmpgt(v1d, zero), Lanes::cmpgt(v2d, zero)));
+		const V back = Lanes::and_(Lanes::cmplt(v0d, zero), Lanes::and_(Lanes::cmplt(v1d, zero), Lanes::cmplt(v2d, zero)));
+
+		const V dist = Lanes::div(nominator, dot(rays.dir, n));
+		const V hit = Lanes::and_(Lanes::and_(rays.active, Lanes::or_(front, back)),
+			Lanes::and_(Lanes::cmpgt(dist, zero), Lanes::cmplt(dist, rays.dist)));
+
+		const int hitMask = Lanes::movemask(hit);
+		if (!hitMask)
+			return;
+
+		rays.dist = Lanes::select(hit, dist, rays.dist);
+		for (int lane = 0; lane < W; lane++) {
+			if (hitMask & (1 << lane))
+				rays.triIdx[lane] = triIdx / 3;
+		}
+	}
+
+	// Trace up to W rays through the triangle tree together. A node is only
+	// visited if at least one of the rays hits it, and children are visited
+	// front to back along the first ray to shorten the rays as early as possible.
+	void TraceRayPacket(const CompactBVHTree *tree, const vector3f *vertices, const Uint32 *indices, int numRays, const vector3f *starts, const vector3f *dirs, isect_t *isects)
+	{
+		float lanes[10][W];
+		for (int lane = 0; lane < W; lane++) {
+			// unused lanes repeat the first ray but are never active
+			const int ray = lane < numRays ? lane : 0;
+			const vector3f &dir = dirs[ray];
+			lanes[0][lane] = starts[ray].x;
+			lanes[1][lane] = starts[ray].y;
+			lanes[2][lane] = starts[ray].z;
+			lanes[3][lane] = dir.x;
+			lanes[4][lane] = dir.y;
+			lanes[5][lane] = dir.z;
+			lanes[6][lane] = 1.0f / (std::fabs(dir.x) < MIN_RAY_DIR ? std::copysign(MIN_RAY_DIR, dir.x) : dir.x);
+			lanes[7][lane] = 1.0f / (std::fabs(dir.y) < MIN_RAY_DIR ? std::copysign(MIN_RAY_DIR, dir.y) : dir.y);
+			lanes[8][lane] = 1.0f / (std::fabs(dir.z) < MIN_RAY_DIR ? std::copysign(MIN_RAY_DIR, dir.z) : dir.z);
+			lanes[9][lane] = isects[ray].dist;
+		}
+
+		RayPacket rays;
+		rays.origin = { Lanes::load(lanes[0]), Lanes::load(lanes[1]), Lanes::load(lanes[2]) };
+		rays.dir = { Lanes::load(lanes[3]), Lanes::load(lanes[4]), Lanes::load(lanes[5]) };
+		rays.invDir = { Lanes::load(lanes[6]), Lanes::load(lanes[7]), Lanes::load(lanes[8]) };
+		rays.dist = Lanes::load(lanes[9]);
+
+		float laneActive[W];
+		for (int lane = 0; lane < W; lane++) {
+			laneActive[lane] = lane < numRays ? 1.f : 0.f;
+			rays.triIdx[lane] = lane < numRays ? isects[lane].triIdx : -1;
+		}
+		rays.active = Lanes::cmpgt(Lanes::load(laneActive), Lanes::set1(0.f));
+
+		const vector3f &firstDir = dirs[0];
+
+		int32_t stackLevel = 0;
+		uint32_t *stack = stackalloc(uint32_t, tree->GetHeight() + 1);
+		stack[stackLevel++] = 0;
+
+		while (stackLevel > 0) {
+			const CompactBVHTree::Node *node = tree->GetNode(stack[--stackLevel]);
+
+			if (!Lanes::movemask(IntersectsRays(node, rays)))
+				continue;
+
+			if (node->IsLeaf()) {
+				RayTriIntersect(vertices, indices, node->leafIndex * 3, rays);
+				continue;
+			}
+
+			const CompactBVHTree::Node *kid0 = tree->GetNode(node->firstKid);
+			const CompactBVHTree::Node *kid1 = tree->GetNode(node->firstKid + 1);
+			const vector3f kidOffset = kid1->min + kid1->max - kid0->min - kid0->max;
+			const uint32_t nearKid = kidOffset.Dot(firstDir) >= 0.f ? 0 : 1;
+			stack[stackLevel++] = node->firstKid + (1 - nearKid);
+			stack[stackLevel++] = node->firstKid + nearKid;
+		}
+
+		Lanes::store(lanes[9], rays.dist);
+		for (int ray = 0; ray < numRays; ray++) {
+			isects[ray].dist = lanes[9][ray];
+			isects[ray].triIdx = rays.triIdx[ray];
+		}
+	}
+} // namespace
+
+void GeomTree::TraceRays(int numRays, const vector3f *starts, const vector3f *dirs, isect_t *isects) const
+{
+	if (m_numTris == 0)
+		return;
+
+	for (int idx = 0; idx < numRays; idx += W) {
+		TraceRayPacket(m_triTree.get(), m_vertices.data(), m_indices.data(), std::min(W, numRays - idx), &starts[idx], &dirs[idx], &isects[idx]);
+	}
+}
+
+#else
+
+void GeomTree::TraceRays(int numRays, const vector3f *starts, const vector3f *dirs, isect_t *isects) const
+{
+	for (int idx = 0; idx < numRays; idx++)
+		TraceRay(starts[idx], dirs[idx], &isects[idx]);
+}
+
+#endif
+
+// =============================================================================
+// Swept spheres
+//
+// A sphere swept along a ray first touches a triangle either on its face, on
+// one of its edges or at one of its corners, which is where the ray hits the
+// triangle pushed out by the radius, a cylinder around an edge or a sphere
+// around a corner.
+
+// distance along the ray to where it enters the sphere, or a negative value
+static float RaySphereEntry(const vector3f &start, const vector3f &dir, const vector3f &centre, float radius)
+{
+	const vector3f m = start - centre;
+	const float b = m.Dot(dir);
+	const float c = m.Dot(m) - radius * radius;
+	// inside already or moving away
+	if (c <= 0.f || b > 0.f)
+		return -1.f;
+	const float disc = b * b - c;
+	if (disc < 0.f)
+		return -1.f;
+	return -b - sqrtf(disc);
+}
+
+// distance along the ray to where it enters the cylinder around the edge
+// from a to b, or a negative value
+static float RayEdgeEntry(const vector3f &start, const vector3f &dir, const vector3f &a, const vector3f &b, float radius)
+{
+	const vector3f e = b - a;
+	const float ee = e.Dot(e);
+	if (ee <= 0.f)
+		return -1.f;
+
+	// the ray and its start relative to a, less their parts along the edge
+	const vector3f m = start - a;
+	const vector3f md = m - e * (m.Dot(e) / ee);
+	const vector3f dd = dir - e * (dir.Dot(e) / ee);
+
+	const float qa = dd.Dot(dd);
+	const float qb = md.Dot(dd);
+	const float qc = md.Dot(md) - radius * radius;
+	// parallel to the edge (the corners catch it), inside already or moving away
+	if (qa <= 1e-12f || qc <= 0.f || qb > 0.f)
+		return -1.f;
+	const float disc = qb * qb - qa * qc;
+	if (disc < 0.f)
+		return -1.f;
+
+	const float dist = (-qb - sqrtf(disc)) / qa;
+	const float along = (m + dir * dist).Dot(e);
+	if (along < 0.f || along > ee)
+		return -1.f;
+	return dist;
+}
+
+static void SphereTriSweep(const vector3f &start, const vector3f &dir, float radius, const vector3f &a, const vector3f &b, const vector3f &c, int triIdx, isect_t *isect)
+{
+	vector3f n = (c - a).Cross(b - a);
+	const float nlen = n.Length();
+	if (nlen <= 0.f)
+		return;
+	n = n * (1.f / nlen);
+
+	// triangles are two sided; take the face towards the start
+	float height = (start - a).Dot(n);
+	if (height < 0.f) {
+		n = -n;
+		height = -height;
+	}
+
+	float best = -1.f;
+	const float approach = dir.Dot(n);
+	if (height > radius && approach < 0.f) {
+		const float dist = (radius - height) / approach;
+		const vector3f p = start + dir * dist - n * radius;
+		// inside if on the same side of all three edges
+		const float e0 = (b - a).Cross(p - a).Dot(n);
+		const float e1 = (c - b).Cross(p - b).Dot(n);
+		const float e2 = (a - c).Cross(p - c).Dot(n);
+		if ((e0 >= 0.f && e1 >= 0.f && e2 >= 0.f) || (e0 <= 0.f && e1 <= 0.f && e2 <= 0.f))
+			best = dist;
+	} else if (height <= radius) {
+		// already touching the plane; only a sphere clear of the triangle
+		// itself can still run into it
+		const float e0 = (b - a).Cross(start - a).Dot(n);
+		const float e1 = (c - b).Cross(start - b).Dot(n);
+		const float e2 = (a - c).Cross(start - c).Dot(n);
+		if ((e0 >= 0.f && e1 >= 0.f && e2 >= 0.f) || (e0 <= 0.f && e1 <= 0.f && e2 <= 0.f))
+			return;
+	}
+
+	if (best < 0.f) {
+		const vector3f corners[3] = { a, b, c };
+		for (int i = 0; i < 3; i++) {
+			float dist = RayEdgeEntry(start, dir, corners[i], corners[(i + 1) % 3], radius);
+			if (dist >= 0.f && (best < 0.f || dist < best))
+				best = dist;
+			dist = RaySphereEntry(start, dir, corners[i], radius);
+			if (dist >= 0.f && (best < 0.f || dist < best))
+				best = dist;
+		}
+	}
+
+	if (best >= 0.f && best < isect->dist) {
+		isect->dist = best;
+		isect->triIdx = triIdx;
+	}
+}
+
+void GeomTree::SweepSphere(const vector3f &start, const vector3f &dir, float radius, isect_t *isect) const
+{
+	if (m_numTris == 0)
+		return;
+
+	// the triangles near the swept volume
+	const vector3d end = vector3d(start + dir * isect->dist);
+	AABBd sweep{ vector3d(start), vector3d(start) };
+	sweep.Update(end);
+	sweep.min -= vector3d(radius);
+	sweep.max += vector3d(radius);
+
+	std::vector<uint32_t> tri_isect;
+	m_triTree->ComputeOverlap(sweep, tri_isect);
+
+	for (uint32_t triIdx : tri_isect) {
+		const vector3f a(m_vertices[m_indices[triIdx * 3 + 0]]);
+		const vector3f b(m_vertices[m_indices[triIdx * 3 + 1]]);
+		const vector3f c(m_vertices[m_indices[triIdx * 3 + 2]]);
+		SphereTriSweep(start, dir, radius, a, b, c, int(triIdx), isect);
+	}
+}
+
 void GeomTree::RayTriIntersect(int numRays, const vector3f &origin, const vector3f *dirs, int triIdx, isect_t *isects) const
 {
 	// PROFILE_SCOPED()
@@ -293,7 +671,7 @@ void GeomTree::Save(Serializer::Writer &wr) const
 
 	wr.Int32(m_numEdges);
 	for (Sint32 iAabb = 0; iAabb < m_numEdges; ++iAabb) {
-		AABBd &aabb = m_edgeAABBs.get()[iAabb];
+		const AABBd aabb = GetEdgeAabb(iAabb);
 		// Write back an old-style min-max-radius Aabb for compatibility with old SGM versions
 		wr << aabb.min << aabb.max << double(0.0);
 	}
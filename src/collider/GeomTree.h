@@ -20,7 +20,7 @@ struct isect_t {
 	float dist;
 };
 
-class SingleBVHTreeBase;
+class CompactBVHTree;
 
 class GeomTree {
 public:
@@ -36,6 +36,16 @@ public:
 	// isect.dist should be ray length
 	// isect.triIdx should be -1 unless repeat calls with same isect_t
 	void TraceRay(const vector3f &start, const vector3f &dir, isect_t *isect) const;
+	// Trace numRays rays at once, with the same contract as TraceRay() for
+	// each ray. Rays are traced through the triangle tree together in
+	// SIMD-width packets, which is fastest when neighbouring rays start
+	// close to each other and point in similar directions.
+	void TraceRays(int numRays, const vector3f *starts, const vector3f *dirs, isect_t *isects) const;
+	// Sweep a sphere of the given radius from start along dir, with the same
+	// contract as TraceRay(); isect.dist is how far the centre gets before the
+	// sphere first touches a triangle. Triangles the sphere already touches
+	// at the start are ignored.
+	void SweepSphere(const vector3f &start, const vector3f &dir, float radius, isect_t *isect) const;
 
 	vector3f GetTriNormal(int triIdx) const;
 	Uint32 GetTriFlag(int triIdx) const { return m_triFlags[triIdx]; }
@@ -58,8 +68,8 @@ public:
 	}
 	int GetNumEdges() const { return m_numEdges; }
 
-	SingleBVHTreeBase *GetTriTree() const { return m_triTree.get(); }
-	SingleBVHTreeBase *GetEdgeTree() const { return m_edgeTree.get(); }
+	const CompactBVHTree *GetTriTree() const { return m_triTree.get(); }
+	const CompactBVHTree *GetEdgeTree() const { return m_edgeTree.get(); }
 
 	const std::vector<vector3f> &GetVertices() const { return m_vertices; }
 	const Uint32 *GetIndices() const { return &m_indices[0]; }
@@ -69,6 +79,8 @@ public:
 
 	void RayTriIntersect(int numRays, const vector3f &origin, const vector3f *dirs, int triIdx, isect_t *isects) const;
 private:
+	void CreateTriTree(const AABBd &bounds);
+	AABBd GetEdgeAabb(int edgeIdx) const;
 
 	int m_numVertices;
 	int m_numEdges;
@@ -77,10 +89,8 @@ private:
 	double m_radius;
 	Aabb m_aabb;
 
-	std::unique_ptr<SingleBVHTreeBase> m_triTree;
-	std::unique_ptr<SingleBVHTreeBase> m_edgeTree;
-	std::unique_ptr<AABBd[]> m_triAABBs;
-	std::unique_ptr<AABBd[]> m_edgeAABBs;
+	std::unique_ptr<CompactBVHTree> m_triTree;
+	std::unique_ptr<CompactBVHTree> m_edgeTree;
 
 	std::vector<Edge> m_edges;
 	std::vector<vector3f> m_vertices;
@@ -0,0 +1,154 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "AllocTracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace Perf;
+
+namespace {
+	struct Tag {
+		std::atomic<const char *> name;
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> bytes;
+	};
+
+	// zero-initialised, so usable by allocations made before main()
+	Tag s_tags[AllocTracker::MAX_TAGS];
+
+	const char UNTAGGED[] = "Untagged";
+	const char OTHER[] = "Other";
+
+	// the first two slots are taken by these up front
+	constexpr uint32_t UNTAGGED_SLOT = 0;
+	constexpr uint32_t OTHER_SLOT = 1;
+
+	struct TagStack {
+		uint32_t depth;
+		uint32_t slots[AllocTracker::MAX_DEPTH];
+	};
+	thread_local TagStack tl_stack;
+
+	// totals at the end of the last frame
+	uint64_t s_lastCount[AllocTracker::MAX_TAGS];
+	uint64_t s_lastBytes[AllocTracker::MAX_TAGS];
+	std::vector<AllocTracker::TagStats> s_frameStats;
+
+	uint32_t FindSlot(const char *name)
+	{
+		// names are string literals, so spread the address bits out
+		const uintptr_t addr = reinterpret_cast<uintptr_t>(name);
+		uint32_t slot = uint32_t((addr >> 3) * 2654435761u) % AllocTracker::MAX_TAGS;
+
+		for (uint32_t probe = 0; probe < AllocTracker::MAX_TAGS; probe++) {
+			if (slot > OTHER_SLOT) {
+				const char *current = s_tags[slot].name.load(std::memory_order_acquire);
+				if (current == name)
+					return slot;
+				if (!current) {
+					if (s_tags[slot].name.compare_exchange_strong(current, name, std::memory_order_acq_rel))
+						return slot;
+					if (current == name)
+						return slot;
+				}
+			}
+			slot = (slot + 1) % AllocTracker::MAX_TAGS;
+		}
+
+		return OTHER_SLOT;
+	}
+} // namespace
+
+void AllocTracker::PushTag(const char *name)
+{
+	TagStack &stack = tl_stack;
+	if (stack.depth < MAX_DEPTH)
+		stack.slots[stack.depth] = FindSlot(name);
+	stack.depth++;
+}
+
+void AllocTracker::PopTag()
+{
+	TagStack &stack = tl_stack;
+	if (stack.depth > 0)
+		stack.depth--;
+}
+
+void AllocTracker::RecordAlloc(size_t bytes)
+{
+	const TagStack &stack = tl_stack;
+	const uint32_t slot = stack.depth ? stack.slots[std::min(stack.depth, MAX_DEPTH) - 1] : UNTAGGED_SLOT;
+	s_tags[slot].count.fetch_add(1, std::memory_order_relaxed);
+	s_tags[slot].bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void AllocTracker::EndFrame()
+{
+	s_tags[UNTAGGED_SLOT].name.store(UNTAGGED, std::memory_order_relaxed);
+	s_tags[OTHER_SLOT].name.store(OTHER, std::memory_order_relaxed);
+
+	// the vector is only ever as long as the table, so after the first
+	// frame collating it doesn't allocate
+	s_frameStats.reserve(MAX_TAGS);
+	s_frameStats.clear();
+	for (uint32_t slot = 0; slot < MAX_TAGS; slot++) {
+		const char *name = s_tags[slot].name.load(std::memory_order_acquire);
+		if (!name)
+			continue;
+
+		const uint64_t count = s_tags[slot].count.load(std::memory_order_relaxed);
+		const uint64_t bytes = s_tags[slot].bytes.load(std::memory_order_relaxed);
+		if (count != s_lastCount[slot])
+			s_frameStats.push_back({ name, count - s_lastCount[slot], bytes - s_lastBytes[slot] });
+		s_lastCount[slot] = count;
+		s_lastBytes[slot] = bytes;
+	}
+
+	std::sort(s_frameStats.begin(), s_frameStats.end(), [](const TagStats &a, const TagStats &b) {
+		return a.count > b.count;
+	});
+}
+
+const std::vector<AllocTracker::TagStats> &AllocTracker::GetFrameStats()
+{
+	return s_frameStats;
+}
+
+#ifdef PIONEER_ALLOC_TRACKING
+// Only the plain forms are replaced; the aligned ones keep the library's
+// allocator, and with it their own deletes.
+
+static void *TrackedAlloc(size_t size)
+{
+	AllocTracker::RecordAlloc(size);
+	return std::malloc(size ? size : 1);
+}
+
+void *operator new(size_t size)
+{
+	if (void *ptr = TrackedAlloc(size))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+	if (void *ptr = TrackedAlloc(size))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return TrackedAlloc(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return TrackedAlloc(size); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+#endif
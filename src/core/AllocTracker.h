@@ -0,0 +1,62 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Perf {
+
+	/**
+	* Heap allocations counted per PERF_ZONE, to find what allocates every
+	* frame.
+	*
+	* In builds with ALLOC_TRACKING (PIONEER_ALLOC_TRACKING), the global
+	* operator new counts every allocation, with its size, against the
+	* innermost PERF_ZONE open on the allocating thread, or "Untagged"
+	* outside of any. Frees aren't tracked, as it's the churn that costs.
+	* Without it, nothing calls in here and the frame stats stay empty.
+	*
+	* Tags are keyed by the address of the zone's name, which like the
+	* timeline's must outlive the program. Counting never locks or
+	* allocates; once MAX_TAGS names have been seen, new ones are counted as
+	* "Other".
+	*/
+	namespace AllocTracker {
+		static constexpr uint32_t MAX_TAGS = 256;
+		// deeper zones count against the one at this depth
+		static constexpr uint32_t MAX_DEPTH = 64;
+
+		struct TagStats {
+			const char *name;
+			uint64_t count;
+			uint64_t bytes;
+		};
+
+		constexpr bool IsEnabled()
+		{
+#ifdef PIONEER_ALLOC_TRACKING
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		// the zone the calling thread's allocations are counted against
+		void PushTag(const char *name);
+		void PopTag();
+
+		// called by operator new
+		void RecordAlloc(size_t bytes);
+
+		// Ends the frame, on the main thread: the allocations of every
+		// thread since the last EndFrame are collated, most first
+		void EndFrame();
+
+		// the tags which allocated in the last frame, most allocations first
+		const std::vector<TagStats> &GetFrameStats();
+	} // namespace AllocTracker
+
+} // namespace Perf
@@ -2,9 +2,12 @@
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
 #include "Application.h"
+#include "AllocTracker.h"
 #include "FileSystem.h"
 #include "JobQueue.h"
 #include "OS.h"
+#include "PerfTimeline.h"
+#include "Property.h"
 #include "SDL.h"
 #include "StringName.h"
 #include "TaskGraph.h"
@@ -149,13 +152,14 @@ void Application::ClearQueuedLifecycles()
 
 void Application::HandleJobs()
 {
+	PERF_ZONE("Jobs")
 	m_taskGraph->RunPinnedTasks();
 	m_syncJobQueue->RunJobs(SYNC_JOBS_PER_LOOP);
 	m_syncJobQueue->FinishJobs();
 	m_taskGraph->GetJobQueue()->FinishJobs();
 
 	// Reclaim StringTable memory periodically
-	StringTable::Get()->Reclaim();
+	SharedStringTable::Get()->Reclaim();
 }
 
 void Application::Run()
@@ -169,8 +173,11 @@ void Application::Run()
 	m_runtime.SoftStop();
 	m_totalTime = m_runtime.seconds();
 
+	Perf::Timeline::SetThreadName("Main");
+
 	m_applicationRunning = true;
 	while (m_applicationRunning) {
+		PERF_ZONE("Frame")
 		m_runtime.SoftStop();
 		double thisTime = m_runtime.seconds();
 		m_deltaTime = thisTime - m_totalTime;
@@ -194,11 +201,17 @@ void Application::Run()
 
 		HandleJobs();
 
+		// the frame's property changes are delivered together here
+		PropertyMap::DeliverChanges();
+
 		// The PostUpdate hook should be used for finalizing per-frame state, rendering, etc.
 		PostUpdate();
 
 		EndFrame();
 
+		if (Perf::AllocTracker::IsEnabled())
+			Perf::AllocTracker::EndFrame();
+
 #ifdef PIONEER_PROFILER
 		const bool profileReset = (m_activeLifecycle && !m_activeLifecycle->m_profilerAccumulate);
 #endif
@@ -1,4 +1,5 @@
 #include "GZipFormat.h"
+#include <cassert>
 #include <cstdint>
 #include <cstring>
 #include <string>
@@ -50,6 +51,83 @@ namespace {
 		out[2] = (value >> 16) & 0xffu;
 		out[3] = (value >> 24) & 0xffu;
 	}
+
+	// Checks the header of GZip format data and returns where the DEFLATE data
+	// starts; the footer is the last BASE_FOOTER_SIZE bytes.
+	static const unsigned char *SkipGZipHeader(const unsigned char *data, size_t length)
+	{
+		assert(length >= BASE_HEADER_SIZE + BASE_FOOTER_SIZE);
+
+		const unsigned char *at_header = data;
+		const unsigned char *at_footer = data + (length - BASE_FOOTER_SIZE);
+
+		// We only know about DEFLATE.
+		if (at_header[2] != CM_DEFLATE) {
+			throw gzip::DecompressionFailedException();
+		}
+
+		int gzip_flags = at_header[3];
+		// There are not supposed to be any unknown flags!
+		if (gzip_flags & ~FLAGS_ALL) {
+			throw gzip::DecompressionFailedException();
+		}
+
+		const unsigned char *at_data = at_header + BASE_HEADER_SIZE;
+		assert(at_data <= at_footer);
+		size_t data_length = at_footer - at_data;
+
+		if (gzip_flags & FLAG_EXTRA) {
+			if (data_length < 2) {
+				throw gzip::DecompressionFailedException();
+			}
+			size_t xlen = uint8_t(at_data[0]) | (uint8_t(at_data[1]) << 8);
+			xlen += 2; // Add the two bytes for the length itself.
+			if (data_length < xlen) {
+				throw gzip::DecompressionFailedException();
+			}
+			at_data += xlen;
+			assert(at_data <= at_footer);
+			data_length = at_footer - at_data;
+		}
+
+		if (gzip_flags & FLAG_NAME) {
+			const unsigned char *name_end = static_cast<const unsigned char *>(std::memchr(at_data, 0, data_length));
+			if (!name_end) {
+				throw gzip::DecompressionFailedException();
+			}
+			at_data = name_end + 1; // +1 to skip the null terminator.
+			assert(at_data <= at_footer);
+			data_length = at_footer - at_data;
+		}
+
+		if (gzip_flags & FLAG_COMMENT) {
+			const unsigned char *comment_end = static_cast<const unsigned char *>(std::memchr(at_data, 0, data_length));
+			if (!comment_end) {
+				throw gzip::DecompressionFailedException();
+			}
+			at_data = comment_end + 1; // +1 to skip the null terminator.
+			assert(at_data <= at_footer);
+			data_length = at_footer - at_data;
+		}
+
+		if (gzip_flags & FLAG_HCRC) {
+			if (data_length < 2) {
+				throw gzip::DecompressionFailedException();
+			}
+			uint32_t true_crc = mz_crc32(MZ_CRC32_INIT, at_header, (at_data - at_header));
+			true_crc &= 0xffffu; // Only care about the bottom 16 bits.
+			uint32_t file_crc = uint8_t(at_data[0]) | (uint8_t(at_data[1]) << 8);
+			if (true_crc != file_crc) {
+				throw gzip::DecompressionFailedException();
+			}
+			at_data += 2;
+			data_length -= 2;
+			assert(at_data <= at_footer);
+		}
+
+		assert(at_data + data_length == at_footer);
+		return at_data;
+	}
 } // namespace
 
 bool gzip::IsGZipFormat(const unsigned char *data, size_t length)
@@ -78,74 +156,10 @@ std::string gzip::DecompressDeflateOrGZip(const unsigned char *data, size_t leng
 std::string gzip::DecompressGZip(const unsigned char *data, size_t length)
 {
 	assert(data != nullptr);
-	assert(length >= BASE_HEADER_SIZE + BASE_FOOTER_SIZE);
 
-	const unsigned char *at_header = data;
+	const unsigned char *at_data = SkipGZipHeader(data, length);
 	const unsigned char *at_footer = data + (length - BASE_FOOTER_SIZE);
-
-	// We only know about DEFLATE.
-	if (at_header[2] != CM_DEFLATE) {
-		throw gzip::DecompressionFailedException();
-	}
-
-	int gzip_flags = at_header[3];
-	// There are not supposed to be any unknown flags!
-	if (gzip_flags & ~FLAGS_ALL) {
-		throw gzip::DecompressionFailedException();
-	}
-
-	const unsigned char *at_data = at_header + BASE_HEADER_SIZE;
-	assert(at_data <= at_footer);
-	size_t data_length = length - BASE_HEADER_SIZE + BASE_FOOTER_SIZE;
-
-	if (gzip_flags & FLAG_EXTRA) {
-		if (data_length < 2) {
-			throw gzip::DecompressionFailedException();
-		}
-		size_t xlen = uint8_t(at_data[0]) | (uint8_t(at_data[1]) << 8);
-		xlen += 2; // Add the two bytes for the length itself.
-		if (data_length < xlen) {
-			throw gzip::DecompressionFailedException();
-		}
-		at_data += xlen;
-		assert(at_data <= at_footer);
-		data_length = at_footer - at_data;
-	}
-
-	if (gzip_flags & FLAG_NAME) {
-		const unsigned char *name_end = static_cast<const unsigned char *>(std::memchr(at_data, 0, data_length));
-		if (!name_end) {
-			throw gzip::DecompressionFailedException();
-		}
-		at_data = name_end + 1; // +1 to skip the null terminator.
-		assert(at_data <= at_footer);
-		data_length = at_footer - at_data;
-	}
-
-	if (gzip_flags & FLAG_COMMENT) {
-		const unsigned char *comment_end = static_cast<const unsigned char *>(std::memchr(at_data, 0, data_length));
-		if (!comment_end) {
-			throw gzip::DecompressionFailedException();
-		}
-		at_data = comment_end + 1; // +1 to skip the null terminator.
-		assert(at_data <= at_footer);
-		data_length = at_footer - at_data;
-	}
-
-	if (gzip_flags & FLAG_HCRC) {
-		if (data_length < 2) {
-			throw gzip::DecompressionFailedException();
-		}
-		uint32_t true_crc = mz_crc32(MZ_CRC32_INIT, at_header, (at_data - at_header));
-		true_crc &= 0xffffu; // Only care about the bottom 16 bits.
-		uint32_t file_crc = uint8_t(at_data[0]) | (uint8_t(at_data[1]) << 8);
-		if (true_crc != file_crc) {
-			throw gzip::DecompressionFailedException();
-		}
-		at_data += 2;
-		data_length -= 2;
-		assert(at_data <= at_footer);
-	}
+	size_t data_length = at_footer - at_data;
 
 	std::string out;
 
@@ -214,3 +228,62 @@ std::string gzip::CompressGZip(const std::string &data, const std::string &inner
 
 	return out;
 }
+
+static const size_t STREAM_CHUNK_SIZE = 1 << 16;
+
+gzip::DecompressStreamBuf::DecompressStreamBuf(const std::string_view data) :
+	m_stream(new mz_stream),
+	m_chunk(new char[STREAM_CHUNK_SIZE]),
+	m_crc(MZ_CRC32_INIT),
+	m_size(0),
+	m_done(false)
+{
+	const unsigned char *begin = reinterpret_cast<const unsigned char *>(data.data());
+	if (!gzip::IsGZipFormat(begin, data.size())) {
+		throw gzip::DecompressionFailedException();
+	}
+	const unsigned char *at_data = SkipGZipHeader(begin, data.size());
+	m_footer = begin + (data.size() - BASE_FOOTER_SIZE);
+
+	std::memset(m_stream.get(), 0, sizeof(mz_stream));
+	m_stream->next_in = at_data;
+	m_stream->avail_in = static_cast<unsigned int>(m_footer - at_data);
+	// negative window bits: raw DEFLATE data, as the GZip header is already parsed
+	if (mz_inflateInit2(m_stream.get(), -MZ_DEFAULT_WINDOW_BITS) != MZ_OK) {
+		throw gzip::DecompressionFailedException();
+	}
+}
+
+gzip::DecompressStreamBuf::~DecompressStreamBuf()
+{
+	mz_inflateEnd(m_stream.get());
+}
+
+gzip::DecompressStreamBuf::int_type gzip::DecompressStreamBuf::underflow()
+{
+	while (!m_done) {
+		m_stream->next_out = reinterpret_cast<unsigned char *>(m_chunk.get());
+		m_stream->avail_out = STREAM_CHUNK_SIZE;
+		const int status = mz_inflate(m_stream.get(), MZ_NO_FLUSH);
+		if (status != MZ_OK && status != MZ_STREAM_END) {
+			throw gzip::DecompressionFailedException();
+		}
+
+		const size_t write_len = STREAM_CHUNK_SIZE - m_stream->avail_out;
+		m_crc = mz_crc32(m_crc, reinterpret_cast<const mz_uint8 *>(m_chunk.get()), write_len);
+		m_size += static_cast<uint32_t>(write_len);
+
+		if (status == MZ_STREAM_END) {
+			m_done = true;
+			if (m_crc != ReadLE32(m_footer + 0) || m_size != ReadLE32(m_footer + 4)) {
+				throw gzip::DecompressionFailedException();
+			}
+		}
+
+		if (write_len > 0) {
+			setg(m_chunk.get(), m_chunk.get(), m_chunk.get() + write_len);
+			return traits_type::to_int_type(*gptr());
+		}
+	}
+	return traits_type::eof();
+}
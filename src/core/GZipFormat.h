@@ -4,7 +4,13 @@
 #ifndef GZIP_FORMAT_H
 #define GZIP_FORMAT_H
 
+#include <cstdint>
+#include <memory>
+#include <streambuf>
 #include <string>
+#include <string_view>
+
+struct mz_stream_s;
 
 namespace gzip {
 	struct GZipException {};
@@ -34,6 +40,27 @@ namespace gzip {
 	// If compression fails it throws an exception.
 	// Parameter 'inner_file_name' is the name written in the GZip header as the file name of the compressed block.
 	std::string CompressGZip(const std::string &data, const std::string &inner_file_name);
+
+	// A stream buffer that reads back GZip format data, inflating a chunk of
+	// it at a time as the reader gets to it. The data must outlive it.
+	// The header is checked on construction and the CRC once the end is read;
+	// either throws DecompressionFailedException if the data is corrupt.
+	class DecompressStreamBuf : public std::streambuf {
+	public:
+		DecompressStreamBuf(const std::string_view data);
+		~DecompressStreamBuf();
+
+	protected:
+		int_type underflow() override;
+
+	private:
+		const unsigned char *m_footer;
+		std::unique_ptr<mz_stream_s> m_stream;
+		std::unique_ptr<char[]> m_chunk;
+		uint32_t m_crc;
+		uint32_t m_size;
+		bool m_done;
+	};
 } // namespace gzip
 
 #endif
@@ -4,13 +4,17 @@
 #include "GuiApplication.h"
 #include "IniConfig.h"
 #include "Input.h"
+#include "MathUtil.h"
 #include "OS.h"
+#include "PerfTimeline.h"
 
 #include "SDL.h"
 #include "SDL_video.h"
 #include "graphics/Drawables.h"
+#include "graphics/DynamicResolution.h"
 #include "graphics/Graphics.h"
 #include "graphics/RenderState.h"
+#include "graphics/RenderGraph.h"
 #include "graphics/RenderTarget.h"
 #include "graphics/Renderer.h"
 #include "graphics/Texture.h"
@@ -19,6 +23,8 @@
 #include "profiler/Profiler.h"
 #include "versioningInfo.h"
 
+#include <algorithm>
+
 GuiApplication::GuiApplication(const std::string &title) :
 	Application(), m_applicationTitle(title)
 {}
@@ -29,6 +35,9 @@ GuiApplication::~GuiApplication()
 void GuiApplication::BeginFrame()
 {
 	PROFILE_SCOPED()
+	WaitForNextFrame();
+
+	PERF_ZONE("BeginFrame")
 
 	m_renderer->SetRenderTarget(m_renderTarget.get());
 	m_renderer->SetViewport({ 0, 0, m_renderer->GetWindowWidth(), m_renderer->GetWindowHeight() });
@@ -36,15 +45,201 @@ void GuiApplication::BeginFrame()
 
 	m_renderer->BeginFrame();
 	m_input->NewFrame();
+
+	if (m_dynamicResolution)
+		m_dynamicResolution->Update(m_renderer->GetGPUFrameTime());
 }
 
 void GuiApplication::EndFrame()
 {
 	PROFILE_SCOPED()
+	PERF_ZONE("EndFrame")
 
 	m_renderer->FlushCommandBuffers();
+	m_renderer->GetRenderTargetPool()->EndFrame();
 	m_renderer->EndFrame();
+
+	PERF_ZONE("Swap")
+	const uint64_t swapStart = SDL_GetPerformanceCounter();
 	m_renderer->SwapBuffers();
+
+	if (m_lowLatency)
+		UpdateFramePacing(swapStart, SDL_GetPerformanceCounter());
+}
+
+void GuiApplication::WaitForNextFrame()
+{
+	if (m_sceneStatic && m_idleFrameRate > 0) {
+		PERF_ZONE("Idle")
+
+		// returns early, without consuming it, as soon as there's an event
+		const uint32_t interval = 1000 / m_idleFrameRate;
+		const uint32_t elapsed = SDL_GetTicks() - m_lastFrameTicks;
+		if (elapsed < interval)
+			SDL_WaitEventTimeout(nullptr, int(interval - elapsed));
+	}
+
+	m_lastFrameTicks = SDL_GetTicks();
+
+	if (m_lowLatency) {
+		if (m_frameDelay > 0.0 && m_lastSwapTicks) {
+			PERF_ZONE("Pacing")
+			const uint64_t freq = SDL_GetPerformanceFrequency();
+			const uint64_t target = m_lastSwapTicks + uint64_t(m_frameDelay * 1e-3 * double(freq));
+
+			// sleep most of the way, as sleeps overshoot, and spin the rest
+			uint64_t now = SDL_GetPerformanceCounter();
+			while (now < target) {
+				const double remaining = double(target - now) * 1e3 / double(freq);
+				if (remaining > 2.0)
+					SDL_Delay(uint32_t(remaining - 1.0));
+				now = SDL_GetPerformanceCounter();
+			}
+		}
+
+		// input is handled right after this
+		m_renderer->SetFrameInputTime(SDL_GetPerformanceCounter());
+	}
+}
+
+void GuiApplication::UpdateFramePacing(uint64_t swapStart, uint64_t swapEnd)
+{
+	// keep this much of the time spent waiting in the swap in hand
+	static constexpr double MARGIN_MS = 2.0;
+
+	const double freq = double(SDL_GetPerformanceFrequency());
+	const double blockedMs = double(swapEnd - swapStart) * 1e3 / freq;
+	const double intervalMs = m_lastSwapTicks ? double(swapEnd - m_lastSwapTicks) * 1e3 / freq : 0.0;
+	m_lastSwapTicks = swapEnd;
+
+	if (!m_settings.vsync || m_refreshPeriod <= 0.0) {
+		m_frameDelay = 0.0;
+		return;
+	}
+
+	if (intervalMs > m_refreshPeriod * 1.5) {
+		// missed a refresh: back off quickly
+		m_frameDelay *= 0.5;
+	} else {
+		// the swap waits for the GPU to finish the frame, then for the
+		// refresh; only the latter can be slept away before the frame
+		const double gpuMs = std::max(m_renderer->GetGPUFrameTime(), 0.0);
+		m_frameDelay += (blockedMs - gpuMs - MARGIN_MS) * 0.25;
+	}
+
+	m_frameDelay = Clamp(m_frameDelay, 0.0, std::max(m_refreshPeriod - MARGIN_MS, 0.0));
+}
+
+void GuiApplication::UpdateRefreshPeriod()
+{
+	SDL_DisplayMode mode;
+	const int display = SDL_GetWindowDisplayIndex(m_renderer->GetSDLWindow());
+	if (display >= 0 && SDL_GetCurrentDisplayMode(display, &mode) == 0 && mode.refresh_rate > 0)
+		m_refreshPeriod = 1000.0 / mode.refresh_rate;
+	else
+		m_refreshPeriod = 0.0;
+}
+
+bool GuiApplication::BeginSceneCache(bool isStatic)
+{
+	if (!isStatic || m_idleFrameRate <= 0) {
+		m_sceneCacheValid = false;
+		return true;
+	}
+
+	if (m_sceneCacheValid) {
+		PROFILE_SCOPED()
+		const Graphics::RenderTargetDesc &desc = m_renderTarget->GetDesc();
+		const Graphics::ViewportExtents extents = { 0, 0, desc.width, desc.height };
+		m_renderer->CopyRenderTarget(m_sceneCache.get(), m_renderTarget.get(), extents, extents, false);
+		return false;
+	}
+
+	m_sceneCacheRecording = true;
+	return true;
+}
+
+void GuiApplication::EndSceneCache()
+{
+	if (!m_sceneCacheRecording)
+		return;
+
+	PROFILE_SCOPED()
+	m_sceneCacheRecording = false;
+
+	// the same format and sample count as the main target, so the copy back
+	// is a straight blit
+	const Graphics::RenderTargetDesc &desc = m_renderTarget->GetDesc();
+	if (!m_sceneCache)
+		m_sceneCache.reset(m_renderer->CreateRenderTarget(desc));
+
+	const Graphics::ViewportExtents extents = { 0, 0, desc.width, desc.height };
+	m_renderer->CopyRenderTarget(m_renderTarget.get(), m_sceneCache.get(), extents, extents, false);
+	m_sceneCacheValid = true;
+}
+
+void GuiApplication::DrawScene(const std::function<void()> &draw)
+{
+	if (!m_dynamicResolution || m_dynamicResolution->GetScale() >= 1.f) {
+		draw();
+		return;
+	}
+
+	PROFILE_SCOPED()
+
+	// the scene is drawn into the corner of a full size target, so changing
+	// the scale never needs a new one
+	const Graphics::RenderTargetDesc &desc = m_renderTarget->GetDesc();
+	const Graphics::ViewportExtents fullExtents = { 0, 0, desc.width, desc.height };
+	const Graphics::ViewportExtents sceneExtents = {
+		0, 0, m_dynamicResolution->GetScaledSize(desc.width), m_dynamicResolution->GetScaledSize(desc.height)
+	};
+
+	Graphics::RenderTargetDesc resolvedDesc = desc;
+	resolvedDesc.depthFormat = Graphics::TEXTURE_NONE;
+	resolvedDesc.allowDepthTexture = false;
+	resolvedDesc.numSamples = 0;
+
+	Graphics::RenderGraph graph(m_renderer->GetRenderTargetPool(), m_renderer.get());
+	const auto output = graph.ImportTarget(m_renderTarget.get());
+	const auto scene = graph.CreateTarget(desc);
+
+	graph.AddPass("Scaled Scene", {}, { scene }, [&](const Graphics::RenderGraph &g) {
+		m_renderer->SetRenderTarget(g.GetTarget(scene));
+		m_renderer->SetViewport(sceneExtents);
+		m_renderer->ClearScreen();
+		draw();
+	});
+
+	if (desc.numSamples == 0) {
+		graph.AddPass("Scene Upscale", { scene }, { output }, [&](const Graphics::RenderGraph &g) {
+			m_renderer->CopyRenderTarget(g.GetTarget(scene), g.GetTarget(output), sceneExtents, fullExtents, true);
+		});
+	} else {
+		// multisampled targets can't be scaled as they're blitted, so the
+		// scene is resolved and scaled up in single sampled targets first
+		const auto resolved = graph.CreateTarget(resolvedDesc);
+		const auto upscaled = graph.CreateTarget(resolvedDesc);
+
+		graph.AddPass("Scene Resolve", { scene }, { resolved }, [&](const Graphics::RenderGraph &g) {
+			m_renderer->ResolveRenderTarget(g.GetTarget(scene), g.GetTarget(resolved), sceneExtents);
+		});
+		graph.AddPass("Scene Upscale", { resolved }, { upscaled }, [&](const Graphics::RenderGraph &g) {
+			m_renderer->CopyRenderTarget(g.GetTarget(resolved), g.GetTarget(upscaled), sceneExtents, fullExtents, true);
+		});
+		graph.AddPass("Scene Copy", { upscaled }, { output }, [&](const Graphics::RenderGraph &g) {
+			m_renderer->CopyRenderTarget(g.GetTarget(upscaled), g.GetTarget(output), fullExtents, fullExtents, false);
+		});
+	}
+
+	const bool drawn = graph.Execute();
+
+	m_renderer->SetRenderTarget(m_renderTarget.get());
+	m_renderer->SetViewport(fullExtents);
+
+	// without the targets to scale through, draw at full resolution
+	if (!drawn)
+		draw();
 }
 
 Graphics::RenderTarget *GuiApplication::CreateRenderTarget(const Graphics::Settings &settings)
@@ -64,6 +259,10 @@ void GuiApplication::OnWindowResized()
 	// Let the renderer determine the new size of the backbuffer
 	m_renderer->OnWindowResized();
 
+	// e.g. moved to another display by going fullscreen
+	if (m_lowLatency)
+		UpdateRefreshPeriod();
+
 	// Check to see if we need to resize the render target (events are flushed after BeginFrame)
 	Graphics::RenderTargetDesc rtDesc = m_renderTarget->GetDesc();
 	int width = m_renderer->GetWindowWidth();
@@ -80,6 +279,10 @@ void GuiApplication::OnWindowResized()
 		rtDesc.height = height;
 		m_renderTarget.reset(m_renderer->CreateRenderTarget(rtDesc));
 
+		// the cached scene is recreated at the new size when next needed
+		m_sceneCache.reset();
+		m_sceneCacheValid = false;
+
 		// Setup the new render target for rendering
 		m_renderer->SetRenderTarget(m_renderTarget.get());
 		m_renderer->SetViewport({ 0, 0, width, height });
@@ -170,8 +373,13 @@ Graphics::Renderer *GuiApplication::StartupRenderer(IniConfig *config, bool hidd
 
 	// determine what renderer we should use, default to Opengl 3.x
 	const std::string rendererName = config->String("RendererName", Graphics::RendererNameFromType(Graphics::RENDERER_OPENGL_3x));
-	// if we add new renderer types, make sure to update this logic
-	Graphics::RendererType rType = Graphics::RENDERER_OPENGL_3x;
+	// fall back to the default for unknown renderers, and those not built
+	// into this executable
+	Graphics::RendererType rType = Graphics::RendererTypeFromName(rendererName);
+	if (!Graphics::IsRendererRegistered(rType)) {
+		Log::Warning("Renderer '{}' is not available, using {}\n", rendererName, Graphics::RendererNameFromType(Graphics::RENDERER_OPENGL_3x));
+		rType = Graphics::RENDERER_OPENGL_3x;
+	}
 
 	Graphics::Settings videoSettings = {};
 	videoSettings.rendererType = rType;
@@ -184,6 +392,11 @@ Graphics::Renderer *GuiApplication::StartupRenderer(IniConfig *config, bool hidd
 	videoSettings.vsync = (config->Int("VSync") != 0);
 	videoSettings.useTextureCompression = (config->Int("UseTextureCompression") != 0);
 	videoSettings.useAnisotropicFiltering = (config->Int("UseAnisotropicFiltering") != 0);
+	videoSettings.sortDrawCommands = (config->Int("SortDrawCommands") != 0);
+	videoSettings.usePersistentBuffers = (config->Int("UsePersistentBuffers") != 0);
+	videoSettings.batchInstances = (config->Int("BatchInstancedDraws") != 0);
+	videoSettings.useProgramCache = (config->Int("ShaderProgramCache") != 0);
+	videoSettings.parallelShaderCompile = (config->Int("ParallelShaderCompile") != 0);
 	videoSettings.enableDebugMessages = (config->Int("EnableGLDebug") != 0);
 	videoSettings.gl3ForwardCompatible = (config->Int("GL3ForwardCompatible") != 0);
 	videoSettings.iconFile = OS::GetIconFilename();
@@ -193,6 +406,26 @@ Graphics::Renderer *GuiApplication::StartupRenderer(IniConfig *config, bool hidd
 	m_renderTarget.reset(CreateRenderTarget(videoSettings));
 
 	m_settings = videoSettings;
+	m_idleFrameRate = config->Int("IdleFrameRate", 20);
+
+	// driven by GPU frame times, which the dummy renderer doesn't have
+	if (config->Int("DynamicResolution", 0) && rType != Graphics::RENDERER_DUMMY) {
+		Graphics::DynamicResolution::Settings dynres;
+		dynres.minScale = config->Float("DynamicResolutionMinScale", 0.5f);
+		dynres.maxScale = config->Float("DynamicResolutionMaxScale", 1.f);
+		dynres.targetFrameTime = config->Float("DynamicResolutionTargetMS", 14.f);
+
+		m_dynamicResolution.reset(new Graphics::DynamicResolution(dynres));
+		m_renderer->SetGPUTimingEnabled(true);
+	}
+
+	// frame pacing uses the GPU frame times too
+	if (config->Int("LowLatencyMode", 0) && rType != Graphics::RENDERER_DUMMY) {
+		m_lowLatency = true;
+		m_renderer->SetMaxFramesInFlight(1);
+		m_renderer->SetGPUTimingEnabled(true);
+		UpdateRefreshPeriod();
+	}
 
 	return m_renderer.get();
 }
@@ -200,6 +433,8 @@ Graphics::Renderer *GuiApplication::StartupRenderer(IniConfig *config, bool hidd
 void GuiApplication::ShutdownRenderer()
 {
 	PROFILE_SCOPED()
+	m_dynamicResolution.reset();
+	m_sceneCache.reset();
 	m_renderTarget.reset();
 	m_renderer.reset();
 
@@ -210,6 +445,7 @@ Input::Manager *GuiApplication::StartupInput(IniConfig *config)
 {
 	PROFILE_SCOPED()
 	m_input.reset(new Input::Manager(config, m_renderer->GetSDLWindow()));
+	m_input->SetLateLatchEnabled(m_lowLatency);
 
 	return m_input.get();
 }
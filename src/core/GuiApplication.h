@@ -9,6 +9,8 @@
 
 #include "graphics/Graphics.h"
 
+#include <functional>
+
 class IniConfig;
 
 namespace Input {
@@ -20,6 +22,7 @@ namespace PiGui {
 }
 
 namespace Graphics {
+	class DynamicResolution;
 	class Renderer;
 	class RenderTarget;
 }
@@ -37,6 +40,35 @@ public:
 
 	const Graphics::Settings &GetGraphicsSettings() { return m_settings; }
 
+	// While the 3D scene is static or hidden, frames are paced down to the
+	// IdleFrameRate config value, and the loop sleeps until input arrives or
+	// the next frame is due. Call every frame.
+	void SetSceneStatic(bool isStatic) { m_sceneStatic = isStatic; }
+
+	// Returns true if the 3D scene must be drawn this frame, followed by a
+	// call to EndSceneCache(); false if it is static and a copy cached from
+	// an earlier frame has been drawn instead.
+	bool BeginSceneCache(bool isStatic);
+	void EndSceneCache();
+	void ClearSceneCache() { m_sceneCacheValid = false; }
+
+	// Draws the 3D scene through draw(). With the DynamicResolution config
+	// option on, the scene is drawn at a lower resolution while the GPU is
+	// over its frame time budget, then scaled up to fill the render target;
+	// anything drawn after (the UI) stays at full resolution.
+	void DrawScene(const std::function<void()> &draw);
+	// nullptr unless dynamic resolution is on
+	Graphics::DynamicResolution *GetDynamicResolution() { return m_dynamicResolution.get(); }
+
+	// With the LowLatencyMode config option on, at most one frame is queued
+	// ahead of the GPU, and with vsync the start of each frame is delayed
+	// for as long as it can be while still making the next refresh, so it's
+	// built from the most recent input. Mouselook motion is also sampled
+	// again just before the camera transforms are computed.
+	bool IsLowLatencyMode() const { return m_lowLatency; }
+	// how long the start of the frame is being delayed, in milliseconds
+	double GetFrameDelay() const { return m_frameDelay; }
+
 protected:
 
 	// Call this from your OnStartup() method
@@ -81,6 +113,9 @@ protected:
 private:
 	Graphics::RenderTarget *CreateRenderTarget(const Graphics::Settings &settings);
 	void OnWindowResized();
+	void WaitForNextFrame();
+	void UpdateFramePacing(uint64_t swapStart, uint64_t swapEnd);
+	void UpdateRefreshPeriod();
 
 	RefCountedPtr<PiGui::Instance> m_pigui;
 	std::unique_ptr<Input::Manager> m_input;
@@ -90,4 +125,19 @@ private:
 	std::unique_ptr<Graphics::Renderer> m_renderer;
 	std::unique_ptr<Graphics::RenderTarget> m_renderTarget;
 	Graphics::Settings m_settings;
+
+	std::unique_ptr<Graphics::DynamicResolution> m_dynamicResolution;
+
+	std::unique_ptr<Graphics::RenderTarget> m_sceneCache;
+	bool m_sceneCacheValid = false;
+	bool m_sceneCacheRecording = false;
+
+	bool m_sceneStatic = false;
+	int m_idleFrameRate = 0;
+	uint32_t m_lastFrameTicks = 0;
+
+	bool m_lowLatency = false;
+	double m_refreshPeriod = 0.0; // ms, 0 if unknown
+	double m_frameDelay = 0.0;	  // ms after the previous swap
+	uint64_t m_lastSwapTicks = 0; // SDL_GetPerformanceCounter
 };
@@ -83,3 +83,117 @@ std::string lz4::CompressLZ4(const std::string_view data, const int lz4_preset)
 
 	return std::string(out.get(), outSize);
 }
+
+// the largest block size of the frame format, so each chunk is one block
+static const std::size_t STREAM_CHUNK_SIZE = 1 << 16;
+
+static LZ4F_preferences_t streamPreferences(const int lz4_preset)
+{
+	LZ4F_preferences_t pref = LZ4F_INIT_PREFERENCES;
+	pref.compressionLevel = lz4_preset;
+	pref.frameInfo.blockSizeID = LZ4F_max64KB;
+	// a stream's whole content is never in one place to be checked otherwise
+	pref.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+	return pref;
+}
+
+lz4::CompressStreamBuf::CompressStreamBuf(FILE *file, const int lz4_preset) :
+	m_file(file),
+	m_ctx(nullptr),
+	m_chunk(new char[STREAM_CHUNK_SIZE]),
+	m_failed(false)
+{
+	const LZ4F_preferences_t pref = streamPreferences(lz4_preset);
+	// enough for the header, any one chunk, or the end of the frame
+	m_compressedSize = LZ4F_compressBound(STREAM_CHUNK_SIZE, &pref) + LZ4F_HEADER_SIZE_MAX;
+	m_compressed.reset(new char[m_compressedSize]);
+	setp(m_chunk.get(), m_chunk.get() + STREAM_CHUNK_SIZE);
+
+	checkError<lz4::CompressionFailedException>(LZ4F_createCompressionContext(&m_ctx, LZ4F_VERSION));
+	const std::size_t headerSize = LZ4F_compressBegin(m_ctx, m_compressed.get(), m_compressedSize, &pref);
+	if (LZ4F_isError(headerSize)) {
+		LZ4F_freeCompressionContext(m_ctx);
+		throw lz4::CompressionFailedException(LZ4F_getErrorName(headerSize));
+	}
+	m_failed = !Write(headerSize);
+}
+
+lz4::CompressStreamBuf::~CompressStreamBuf()
+{
+	LZ4F_freeCompressionContext(m_ctx);
+}
+
+bool lz4::CompressStreamBuf::Write(size_t length)
+{
+	return length == 0 || fwrite(m_compressed.get(), length, 1, m_file) == 1;
+}
+
+bool lz4::CompressStreamBuf::CompressChunk()
+{
+	PROFILE_SCOPED()
+	const std::size_t length = pptr() - pbase();
+	setp(m_chunk.get(), m_chunk.get() + STREAM_CHUNK_SIZE);
+	if (m_failed || length == 0)
+		return !m_failed;
+
+	const std::size_t size = LZ4F_compressUpdate(m_ctx, m_compressed.get(), m_compressedSize, m_chunk.get(), length, nullptr);
+	m_failed = LZ4F_isError(size) || !Write(size);
+	return !m_failed;
+}
+
+lz4::CompressStreamBuf::int_type lz4::CompressStreamBuf::overflow(int_type c)
+{
+	if (!CompressChunk())
+		return traits_type::eof();
+	if (!traits_type::eq_int_type(c, traits_type::eof())) {
+		*pptr() = traits_type::to_char_type(c);
+		pbump(1);
+	}
+	return traits_type::not_eof(c);
+}
+
+void lz4::CompressStreamBuf::Finish()
+{
+	if (CompressChunk()) {
+		const std::size_t size = LZ4F_compressEnd(m_ctx, m_compressed.get(), m_compressedSize, nullptr);
+		m_failed = LZ4F_isError(size) || !Write(size);
+	}
+	if (m_failed)
+		throw lz4::CompressionFailedException("could not write compressed stream");
+}
+
+lz4::DecompressStreamBuf::DecompressStreamBuf(const std::string_view data) :
+	m_data(data),
+	m_ctx(nullptr),
+	m_chunk(new char[STREAM_CHUNK_SIZE]),
+	m_done(false)
+{
+	checkError<lz4::DecompressionFailedException>(LZ4F_createDecompressionContext(&m_ctx, LZ4F_VERSION));
+}
+
+lz4::DecompressStreamBuf::~DecompressStreamBuf()
+{
+	LZ4F_freeDecompressionContext(m_ctx);
+}
+
+lz4::DecompressStreamBuf::int_type lz4::DecompressStreamBuf::underflow()
+{
+	// the frame header and block headers produce no output, so keep going
+	// until there is some or the frame ends
+	while (!m_done) {
+		std::size_t read_len = m_data.size();
+		std::size_t write_len = STREAM_CHUNK_SIZE;
+		const std::size_t nextLen = LZ4F_decompress(m_ctx, m_chunk.get(), &write_len, m_data.data(), &read_len, nullptr);
+		checkError<lz4::DecompressionFailedException>(nextLen);
+		m_data.remove_prefix(read_len);
+		m_done = nextLen == 0;
+
+		if (write_len > 0) {
+			setg(m_chunk.get(), m_chunk.get(), m_chunk.get() + write_len);
+			return traits_type::to_int_type(*gptr());
+		}
+		if (!m_done && read_len == 0)
+			throw lz4::DecompressionFailedException("truncated lz4 stream");
+	}
+	return traits_type::eof();
+}
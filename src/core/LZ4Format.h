@@ -3,11 +3,16 @@
 
 #pragma once
 
+#include <cstdio>
 #include <memory>
 #include <stdexcept>
+#include <streambuf>
 #include <string>
 #include <string_view>
 
+struct LZ4F_cctx_s;
+struct LZ4F_dctx_s;
+
 namespace lz4 {
 
 	struct DecompressionFailedException : public std::runtime_error {
@@ -29,4 +34,49 @@ namespace lz4 {
 	// If compression fails it throws an exception.
 	// lz4_speed is the compression preset; 0 = default compression, 3-12 = HC compression
 	std::string CompressLZ4(const std::string_view data, const int lz4_preset);
+
+	// A stream buffer that compresses everything written through it into a
+	// lz4 frame, written to the file a chunk at a time so the uncompressed
+	// data never has to be held in memory all at once.
+	// Finish() must be called after the last write; it throws if anything
+	// along the way failed. The file is not closed.
+	class CompressStreamBuf : public std::streambuf {
+	public:
+		CompressStreamBuf(FILE *file, const int lz4_preset);
+		~CompressStreamBuf();
+
+		void Finish();
+
+	protected:
+		int_type overflow(int_type c) override;
+
+	private:
+		bool CompressChunk();
+		bool Write(size_t length);
+
+		FILE *m_file;
+		LZ4F_cctx_s *m_ctx;
+		std::unique_ptr<char[]> m_chunk;
+		std::unique_ptr<char[]> m_compressed;
+		size_t m_compressedSize;
+		bool m_failed;
+	};
+
+	// A stream buffer that reads back a lz4 frame, decompressing a chunk of
+	// it at a time as the reader gets to it. The data must outlive it.
+	// Reading throws DecompressionFailedException if the data is corrupt.
+	class DecompressStreamBuf : public std::streambuf {
+	public:
+		DecompressStreamBuf(const std::string_view data);
+		~DecompressStreamBuf();
+
+	protected:
+		int_type underflow() override;
+
+	private:
+		std::string_view m_data;
+		LZ4F_dctx_s *m_ctx;
+		std::unique_ptr<char[]> m_chunk;
+		bool m_done;
+	};
 } // namespace lz4
@@ -0,0 +1,63 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "MemoryBudget.h"
+
+#include <algorithm>
+
+MemoryBudget::CacheId MemoryBudget::AddCache(const std::string &name, int priority, UsageFn getUsage, TrimFn trim)
+{
+	Cache cache;
+	cache.id = m_nextId++;
+	const CacheId id = cache.id;
+	cache.name = name;
+	cache.priority = priority;
+	cache.getUsage = std::move(getUsage);
+	cache.trim = std::move(trim);
+
+	// after any others of the same priority, so those added first go first
+	auto pos = std::upper_bound(m_caches.begin(), m_caches.end(), priority,
+		[](int p, const Cache &c) { return p < c.priority; });
+	m_caches.insert(pos, std::move(cache));
+	return id;
+}
+
+void MemoryBudget::RemoveCache(CacheId id)
+{
+	m_caches.erase(std::remove_if(m_caches.begin(), m_caches.end(),
+					   [id](const Cache &c) { return c.id == id; }),
+		m_caches.end());
+}
+
+size_t MemoryBudget::Update()
+{
+	m_totalUsage = 0;
+	for (Cache &cache : m_caches) {
+		cache.usage = cache.getUsage();
+		m_totalUsage += cache.usage;
+	}
+
+	if (m_budget == 0 || m_totalUsage <= m_budget)
+		return 0;
+
+	size_t excess = m_totalUsage - m_budget;
+	size_t freed = 0;
+	for (Cache &cache : m_caches) {
+		if (!cache.trim)
+			continue;
+
+		cache.trim(excess);
+		const size_t usage = cache.getUsage();
+		const size_t given = cache.usage > usage ? cache.usage - usage : 0;
+		cache.usage = usage;
+		cache.trimmed += given;
+		freed += given;
+
+		if (given >= excess)
+			break;
+		excess -= given;
+	}
+
+	m_totalUsage -= freed;
+	return freed;
+}
@@ -0,0 +1,67 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+ * One budget for the memory of the engine's caches, which otherwise each
+ * grow on their own terms.
+ *
+ * Each cache is registered with a function reporting how many bytes it
+ * holds and, if it can give any back, one trimming it. Update() polls the
+ * usage of every cache and, while the total is over the budget, trims the
+ * caches in order of priority, the lowest (cheapest to refill) first,
+ * until enough has been given back or nothing trimmable is left.
+ *
+ * Caches which can't give anything back still count towards the total, and
+ * so take their share of the budget from those which can.
+ */
+class MemoryBudget {
+public:
+	// returns the bytes the cache holds
+	using UsageFn = std::function<size_t()>;
+	// asked to free at least this many bytes, as far as it can; what it
+	// did free is measured through its usage
+	using TrimFn = std::function<void(size_t bytes)>;
+
+	using CacheId = uint32_t;
+
+	struct Cache {
+		CacheId id;
+		std::string name;
+		int priority;
+		UsageFn getUsage;
+		TrimFn trim;
+
+		size_t usage = 0;	// at the last Update
+		size_t trimmed = 0; // total given back to the budget
+	};
+
+	CacheId AddCache(const std::string &name, int priority, UsageFn getUsage, TrimFn trim = TrimFn());
+	void RemoveCache(CacheId id);
+
+	// zero (the default) for no limit
+	void SetBudget(size_t bytes) { m_budget = bytes; }
+	size_t GetBudget() const { return m_budget; }
+
+	// polls the usage of every cache and trims them down to the budget,
+	// returning the bytes given back
+	size_t Update();
+
+	// at the last Update
+	size_t GetTotalUsage() const { return m_totalUsage; }
+	// in the order they're trimmed
+	const std::vector<Cache> &GetCaches() const { return m_caches; }
+
+private:
+	std::vector<Cache> m_caches;
+	CacheId m_nextId = 1;
+	size_t m_budget = 0;
+	size_t m_totalUsage = 0;
+};
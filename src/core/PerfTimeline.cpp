@@ -0,0 +1,184 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "PerfTimeline.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+using namespace Perf;
+
+std::atomic<bool> Timeline::s_enabled = true;
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point s_epoch = Clock::now();
+
+	// Slots are atomics so that a reader copying the ring while its thread
+	// writes gets a torn-free (if possibly stale) value; stale slots are
+	// detected from the head counter and dropped.
+	struct Slot {
+		std::atomic<const char *> name;
+		std::atomic<uint64_t> start;
+		std::atomic<uint64_t> value;
+		std::atomic<uint32_t> type;
+	};
+
+	struct Ring {
+		uint32_t tid;
+		std::string name;		// guarded by s_ringsMutex
+		std::atomic<uint64_t> head; // number of events ever written
+		Slot slots[Timeline::RING_SIZE];
+	};
+
+	// Rings are never freed, so that a thread's events outlive the thread
+	std::mutex s_ringsMutex;
+	std::vector<std::unique_ptr<Ring>> s_rings;
+
+	thread_local Ring *tl_ring = nullptr;
+
+	Ring *GetRing()
+	{
+		if (!tl_ring) {
+			std::lock_guard<std::mutex> lock(s_ringsMutex);
+			auto ring = std::make_unique<Ring>();
+			ring->tid = uint32_t(s_rings.size()) + 1;
+			ring->name = fmt::format("Thread {}", ring->tid);
+			ring->head.store(0, std::memory_order_relaxed);
+			tl_ring = ring.get();
+			s_rings.push_back(std::move(ring));
+		}
+
+		return tl_ring;
+	}
+
+	void Record(const char *name, Timeline::EventType type, uint64_t start, uint64_t value)
+	{
+		Ring *ring = GetRing();
+		const uint64_t head = ring->head.load(std::memory_order_relaxed);
+		Slot &slot = ring->slots[head % Timeline::RING_SIZE];
+
+		slot.name.store(name, std::memory_order_relaxed);
+		slot.type.store(type, std::memory_order_relaxed);
+		slot.start.store(start, std::memory_order_relaxed);
+		slot.value.store(value, std::memory_order_relaxed);
+		ring->head.store(head + 1, std::memory_order_release);
+	}
+
+	void AppendJsonString(std::string &out, const std::string &str)
+	{
+		out += '"';
+		for (char c : str) {
+			if (c == '"' || c == '\\')
+				out += '\\';
+			if (uint8_t(c) < 0x20)
+				out += fmt::format("\\u{:04x}", int(uint8_t(c)));
+			else
+				out += c;
+		}
+		out += '"';
+	}
+} // namespace
+
+uint64_t Timeline::Now()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - s_epoch).count()) + 1;
+}
+
+void Timeline::RecordZone(const char *name, uint64_t start, uint64_t end)
+{
+	Record(name, EVENT_ZONE, start, end);
+}
+
+void Timeline::RecordCounter(const char *name, uint64_t value)
+{
+	if (IsEnabled())
+		Record(name, EVENT_COUNTER, Now(), value);
+}
+
+void Timeline::SetThreadName(const std::string &name)
+{
+	Ring *ring = GetRing();
+	std::lock_guard<std::mutex> lock(s_ringsMutex);
+	ring->name = name;
+}
+
+std::vector<Timeline::ThreadEvents> Timeline::Collect(uint64_t since)
+{
+	std::vector<ThreadEvents> threads;
+	std::lock_guard<std::mutex> lock(s_ringsMutex);
+
+	for (auto &ring : s_rings) {
+		ThreadEvents &out = threads.emplace_back();
+		out.tid = ring->tid;
+		out.name = ring->name;
+
+		const uint64_t head = ring->head.load(std::memory_order_acquire);
+		const uint64_t first = head > RING_SIZE ? head - RING_SIZE : 0;
+
+		out.events.reserve(head - first);
+		for (uint64_t i = first; i < head; i++) {
+			const Slot &slot = ring->slots[i % RING_SIZE];
+			out.events.push_back({ slot.name.load(std::memory_order_relaxed),
+				EventType(slot.type.load(std::memory_order_relaxed)),
+				slot.start.load(std::memory_order_relaxed),
+				slot.value.load(std::memory_order_relaxed) });
+		}
+
+		// anything the writer may have lapped while we were copying is dropped,
+		// including the slot it could be writing right now
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64_t newHead = ring->head.load(std::memory_order_relaxed);
+		const uint64_t valid = newHead >= RING_SIZE ? newHead - RING_SIZE + 1 : 0;
+		if (valid > first)
+			out.events.erase(out.events.begin(), out.events.begin() + std::min(valid - first, head - first));
+
+		if (since) {
+			auto end = std::remove_if(out.events.begin(), out.events.end(), [since](const Event &ev) {
+				return (ev.type == EVENT_ZONE ? ev.value : ev.start) < since;
+			});
+			out.events.erase(end, out.events.end());
+		}
+	}
+
+	return threads;
+}
+
+std::string Timeline::ToChromeTrace(const std::vector<ThreadEvents> &threads)
+{
+	std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	auto separator = [&]() {
+		if (!first)
+			out += ",\n";
+		first = false;
+	};
+
+	for (const auto &thread : threads) {
+		separator();
+		out += fmt::format("{{\"ph\":\"M\",\"pid\":1,\"tid\":{},\"name\":\"thread_name\",\"args\":{{\"name\":", thread.tid);
+		AppendJsonString(out, thread.name);
+		out += "}}";
+
+		for (const Event &ev : thread.events) {
+			separator();
+			out += "{\"name\":";
+			AppendJsonString(out, ev.name);
+
+			// timestamps are in microseconds
+			if (ev.type == EVENT_ZONE)
+				out += fmt::format(",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+					thread.tid, ev.start * 1e-3, (ev.value - ev.start) * 1e-3);
+			else
+				out += fmt::format(",\"ph\":\"C\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"args\":{{\"value\":{}}}}}",
+					thread.tid, ev.start * 1e-3, ev.value);
+		}
+	}
+
+	out += "]}\n";
+	return out;
+}
@@ -0,0 +1,113 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef PIONEER_ALLOC_TRACKING
+#include "AllocTracker.h"
+#endif
+
+namespace Perf {
+	/**
+	* Always-on timeline of recent zones and counter samples on every thread.
+	*
+	* Each thread records into its own fixed-size ring the first time it uses
+	* the timeline; recording never locks and never allocates, and only the
+	* newest RING_SIZE events per thread are kept. Readers take a consistent
+	* copy of each ring without stopping the writer, so the timeline can be
+	* inspected or exported at any moment, e.g. right after a stutter.
+	*
+	* Zone and counter names must be string literals (or otherwise outlive the
+	* program), as only the pointer is stored.
+	*
+	* Use PERF_ZONE("Name") to time the rest of the enclosing scope.
+	*/
+	class Timeline {
+	public:
+		static constexpr uint32_t RING_SIZE = 1 << 14;
+
+		enum EventType : uint32_t {
+			EVENT_ZONE,
+			EVENT_COUNTER
+		};
+
+		struct Event {
+			const char *name;
+			EventType type;
+			uint64_t start; // nanoseconds since the timeline epoch
+			uint64_t value; // end time of a zone, value of a counter
+		};
+
+		struct ThreadEvents {
+			uint32_t tid;
+			std::string name;
+			std::vector<Event> events; // in the order they were recorded
+		};
+
+		// Time the enclosing scope as a zone
+		class Zone {
+		public:
+			explicit Zone(const char *name) :
+				m_name(name),
+				m_start(IsEnabled() ? Now() : 0)
+			{
+#ifdef PIONEER_ALLOC_TRACKING
+				AllocTracker::PushTag(name);
+#endif
+			}
+			~Zone() { End(); }
+
+			// Finish the zone before the end of its scope
+			void End()
+			{
+				if (m_start)
+					RecordZone(m_name, m_start, Now());
+				m_start = 0;
+#ifdef PIONEER_ALLOC_TRACKING
+				if (m_name)
+					AllocTracker::PopTag();
+				m_name = nullptr;
+#endif
+			}
+
+			Zone(const Zone &) = delete;
+			Zone &operator=(const Zone &) = delete;
+
+		private:
+			const char *m_name;
+			uint64_t m_start;
+		};
+
+		static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+		static void SetEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+
+		// Nanoseconds since the timeline epoch; never zero
+		static uint64_t Now();
+
+		static void RecordZone(const char *name, uint64_t start, uint64_t end);
+		static void RecordCounter(const char *name, uint64_t value);
+
+		// Name the calling thread in collected and exported timelines
+		static void SetThreadName(const std::string &name);
+
+		// Copy the events of every thread that ended at or after since
+		static std::vector<ThreadEvents> Collect(uint64_t since = 0);
+
+		// Format collected events as Chrome trace event JSON, which can be
+		// opened in chrome://tracing or ui.perfetto.dev
+		static std::string ToChromeTrace(const std::vector<ThreadEvents> &threads);
+
+	private:
+		static std::atomic<bool> s_enabled;
+	};
+
+} // namespace Perf
+
+#define PERF_ZONE_CONCAT2(a, b) a##b
+#define PERF_ZONE_CONCAT(a, b) PERF_ZONE_CONCAT2(a, b)
+#define PERF_ZONE(name) Perf::Timeline::Zone PERF_ZONE_CONCAT(perfZone_, __LINE__)(name);
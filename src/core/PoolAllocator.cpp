@@ -0,0 +1,163 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "PoolAllocator.h"
+
+#include <atomic>
+
+namespace {
+
+	// Small size classes cover 16..512 bytes in 16 byte steps, large size
+	// classes cover 1KB..256KB in power-of-two steps.
+	constexpr size_t SMALL_GRANULARITY = 16;
+	constexpr size_t MAX_SMALL_SIZE = 512;
+	constexpr size_t NUM_SMALL_CLASSES = MAX_SMALL_SIZE / SMALL_GRANULARITY;
+
+	constexpr size_t MIN_LARGE_SHIFT = 10;
+	constexpr size_t MAX_LARGE_SHIFT = 18;
+	constexpr size_t MAX_LARGE_SIZE = size_t(1) << MAX_LARGE_SHIFT;
+	constexpr size_t NUM_LARGE_CLASSES = MAX_LARGE_SHIFT - MIN_LARGE_SHIFT + 1;
+
+	constexpr size_t NUM_SIZE_CLASSES = NUM_SMALL_CLASSES + NUM_LARGE_CLASSES;
+
+	// maximum number of free blocks each thread keeps around per size class
+	constexpr uint32_t MAX_SMALL_FREE_BLOCKS = 256;
+	constexpr uint32_t MAX_LARGE_FREE_BLOCKS = 8;
+
+	constexpr size_t INVALID_CLASS = ~size_t(0);
+
+	size_t GetSizeClass(size_t size)
+	{
+		if (size <= MAX_SMALL_SIZE)
+			return (size + SMALL_GRANULARITY - 1) / SMALL_GRANULARITY - (size ? 1 : 0);
+
+		if (size > MAX_LARGE_SIZE)
+			return INVALID_CLASS;
+
+		size_t shift = MIN_LARGE_SHIFT;
+		while ((size_t(1) << shift) < size)
+			shift++;
+
+		return NUM_SMALL_CLASSES + (shift - MIN_LARGE_SHIFT);
+	}
+
+	size_t GetClassBlockSize(size_t sizeClass)
+	{
+		if (sizeClass < NUM_SMALL_CLASSES)
+			return (sizeClass + 1) * SMALL_GRANULARITY;
+
+		return size_t(1) << (sizeClass - NUM_SMALL_CLASSES + MIN_LARGE_SHIFT);
+	}
+
+	uint32_t GetClassMaxFreeBlocks(size_t sizeClass)
+	{
+		return sizeClass < NUM_SMALL_CLASSES ? MAX_SMALL_FREE_BLOCKS : MAX_LARGE_FREE_BLOCKS;
+	}
+
+	struct FreeBlock {
+		FreeBlock *next;
+	};
+
+	struct ThreadCache {
+		FreeBlock *freeList[NUM_SIZE_CLASSES] = {};
+		uint32_t numFree[NUM_SIZE_CLASSES] = {};
+
+		~ThreadCache();
+	};
+
+	std::atomic<uint64_t> s_numAllocs = 0;
+	std::atomic<uint64_t> s_numHeapAllocs = 0;
+	std::atomic<uint64_t> s_numFrees = 0;
+
+	// Blocks may still be freed during thread shutdown after the cache has been
+	// destroyed (e.g. by other thread_local or static objects); this flag is
+	// trivially destructible and remains valid for the whole lifetime of the thread.
+	thread_local bool tl_cacheAlive = false;
+	thread_local ThreadCache tl_cache;
+
+	ThreadCache::~ThreadCache()
+	{
+		tl_cacheAlive = false;
+
+		for (size_t idx = 0; idx < NUM_SIZE_CLASSES; idx++) {
+			FreeBlock *block = freeList[idx];
+			while (block) {
+				FreeBlock *next = block->next;
+				::operator delete(block);
+				block = next;
+			}
+
+			freeList[idx] = nullptr;
+			numFree[idx] = 0;
+		}
+	}
+
+	ThreadCache *GetThreadCache()
+	{
+		if (!tl_cacheAlive) {
+			// first use on this thread; touching tl_cache constructs it and
+			// registers its destructor. Once it's been destroyed, never revive it.
+			static thread_local bool tl_cacheCreated = false;
+			if (tl_cacheCreated)
+				return nullptr;
+
+			tl_cacheCreated = true;
+			tl_cacheAlive = true;
+		}
+
+		return &tl_cache;
+	}
+
+} // namespace
+
+void *PoolAllocator::Allocate(size_t size)
+{
+	s_numAllocs.fetch_add(1, std::memory_order_relaxed);
+
+	size_t sizeClass = GetSizeClass(size);
+	if (sizeClass == INVALID_CLASS) {
+		s_numHeapAllocs.fetch_add(1, std::memory_order_relaxed);
+		return ::operator new(size);
+	}
+
+	ThreadCache *cache = GetThreadCache();
+	if (cache && cache->freeList[sizeClass]) {
+		FreeBlock *block = cache->freeList[sizeClass];
+		cache->freeList[sizeClass] = block->next;
+		cache->numFree[sizeClass]--;
+		return block;
+	}
+
+	s_numHeapAllocs.fetch_add(1, std::memory_order_relaxed);
+	return ::operator new(GetClassBlockSize(sizeClass));
+}
+
+void PoolAllocator::Free(void *ptr, size_t size)
+{
+	if (!ptr)
+		return;
+
+	s_numFrees.fetch_add(1, std::memory_order_relaxed);
+
+	size_t sizeClass = GetSizeClass(size);
+	ThreadCache *cache = sizeClass != INVALID_CLASS ? GetThreadCache() : nullptr;
+
+	if (!cache || cache->numFree[sizeClass] >= GetClassMaxFreeBlocks(sizeClass)) {
+		::operator delete(ptr);
+		return;
+	}
+
+	FreeBlock *block = static_cast<FreeBlock *>(ptr);
+	block->next = cache->freeList[sizeClass];
+	cache->freeList[sizeClass] = block;
+	cache->numFree[sizeClass]++;
+}
+
+PoolAllocator::Stats PoolAllocator::GetStats()
+{
+	return Stats{
+		s_numAllocs.load(std::memory_order_relaxed),
+		s_numHeapAllocs.load(std::memory_order_relaxed),
+		s_numFrees.load(std::memory_order_relaxed)
+	};
+}
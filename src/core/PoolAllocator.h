@@ -0,0 +1,96 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Thread-aware block pool for short-lived, frequently allocated objects such
+ * as Jobs, Tasks, their scratch buffers and weapon projectiles.
+ *
+ * Each thread keeps its own free lists of recently freed blocks, grouped into
+ * size classes. Allocation and deallocation never take a lock: a block freed
+ * on a thread goes onto that thread's free list, and is returned to the heap
+ * once the list for its size class is full. Requests larger than the largest
+ * size class are passed straight through to the heap.
+ *
+ * Blocks must be freed with the same size they were allocated with.
+ */
+namespace PoolAllocator {
+
+	struct Stats {
+		uint64_t numAllocs;     // total blocks handed out
+		uint64_t numHeapAllocs; // blocks which could not be served from a free list
+		uint64_t numFrees;      // total blocks given back
+	};
+
+	void *Allocate(size_t size);
+	void Free(void *ptr, size_t size);
+
+	// running totals since program start, summed across all threads
+	Stats GetStats();
+
+} // namespace PoolAllocator
+
+// Inherit from this type to allocate instances (including instances of
+// derived classes) from the thread-local block pools. Classes deleted through
+// a base pointer must have a virtual destructor so the correct size is freed.
+struct PoolAllocated {
+	static void *operator new(size_t size) { return PoolAllocator::Allocate(size); }
+	static void operator delete(void *ptr, size_t size) { PoolAllocator::Free(ptr, size); }
+};
+
+// Owning fixed-size array allocated from the block pools, intended for the
+// scratch buffers of worker jobs. Element type must be trivially destructible.
+template <typename T>
+class PoolArray {
+	static_assert(std::is_trivially_destructible_v<T>, "PoolArray elements must be trivially destructible");
+
+public:
+	PoolArray() :
+		m_data(nullptr),
+		m_size(0) {}
+	explicit PoolArray(size_t size) :
+		PoolArray() { reset(size); }
+	~PoolArray() { reset(); }
+
+	PoolArray(const PoolArray &) = delete;
+	PoolArray &operator=(const PoolArray &) = delete;
+
+	PoolArray(PoolArray &&other) :
+		m_data(std::exchange(other.m_data, nullptr)),
+		m_size(std::exchange(other.m_size, 0)) {}
+	PoolArray &operator=(PoolArray &&other)
+	{
+		reset();
+		m_data = std::exchange(other.m_data, nullptr);
+		m_size = std::exchange(other.m_size, 0);
+		return *this;
+	}
+
+	// free the current contents and allocate space for size (default-initialized) elements
+	void reset(size_t size = 0)
+	{
+		if (m_data)
+			PoolAllocator::Free(m_data, m_size * sizeof(T));
+
+		m_size = size;
+		m_data = size ? static_cast<T *>(PoolAllocator::Allocate(size * sizeof(T))) : nullptr;
+		for (size_t idx = 0; idx < size; idx++)
+			new (&m_data[idx]) T;
+	}
+
+	T *get() const { return m_data; }
+	size_t size() const { return m_size; }
+
+	T &operator[](size_t idx) const { return m_data[idx]; }
+
+private:
+	T *m_data;
+	size_t m_size;
+};
@@ -5,6 +5,11 @@
 
 #include "Json.h"
 #include "JsonUtils.h"
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
 
 PropertyMapWrapper::PropertyMapWrapper(PropertyMap *m) :
 	m_map(m)
@@ -129,6 +134,22 @@ PropertyMap::iterator PropertyMap::iterator::operator++(int)
 
 // =============================================================================
 
+struct PropertyMap::ChangeTracking {
+	ChangeSignal onChanged;
+	// keys set to a new value since the last delivery, possibly repeated
+	std::vector<StringName> changed;
+
+	// maps with changes to deliver, and those being delivered to
+	static std::vector<PropertyMap *> pendingMaps;
+	static std::vector<PropertyMap *> deliveringMaps;
+	// the thread the first map was observed on
+	static std::thread::id thread;
+};
+
+std::vector<PropertyMap *> PropertyMap::ChangeTracking::pendingMaps;
+std::vector<PropertyMap *> PropertyMap::ChangeTracking::deliveringMaps;
+std::thread::id PropertyMap::ChangeTracking::thread;
+
 PropertyMap::PropertyMap() :
 	m_keys(),
 	m_values(),
@@ -144,6 +165,13 @@ PropertyMap::PropertyMap(uint32_t size) :
 PropertyMap::~PropertyMap()
 {
 	Clear();
+
+	// don't deliver changes to a map that's gone
+	if (m_changes) {
+		assert(IsChangeThread());
+		for (auto *maps : { &ChangeTracking::pendingMaps, &ChangeTracking::deliveringMaps })
+			std::replace(maps->begin(), maps->end(), this, static_cast<PropertyMap *>(nullptr));
+	}
 }
 
 // =============================================================================
@@ -198,8 +226,15 @@ void PropertyMap::SetRef(uint32_t hash, value_type &&value)
 
 		uint32_t probed_key = m_keys[idx];
 		if (probed_key == hash || probed_key == 0) {
+			assert(!m_changes || IsChangeThread());
+
 			if (probed_key == 0)
 				m_entries++;
+			else if (m_values[idx].second == value.second)
+				return;
+
+			if (m_changes)
+				RecordChange(value.first);
 
 			m_keys[idx] = hash;
 			m_values[idx] = std::move(value);
@@ -210,10 +245,15 @@ void PropertyMap::SetRef(uint32_t hash, value_type &&value)
 
 void PropertyMap::Clear()
 {
+	assert(!m_changes || IsChangeThread());
+
 	for (uint32_t idx = 0; idx < m_keys.size(); idx++) {
 		uint32_t probed_key = m_keys[idx];
-		if (probed_key)
+		if (probed_key) {
+			if (m_changes && !m_values[idx].second.is_null())
+				RecordChange(m_values[idx].first);
 			m_values[idx] = {};
+		}
 	}
 
 	if (m_keys.size())
@@ -251,3 +291,55 @@ void PropertyMap::Grow()
 	std::swap(m_keys, newMap.m_keys);
 	std::swap(m_values, newMap.m_values);
 }
+
+// =============================================================================
+
+PropertyMap::ChangeSignal &PropertyMap::OnChanged()
+{
+	if (ChangeTracking::thread == std::thread::id())
+		ChangeTracking::thread = std::this_thread::get_id();
+	assert(IsChangeThread());
+
+	if (!m_changes)
+		m_changes.reset(new ChangeTracking());
+	return m_changes->onChanged;
+}
+
+bool PropertyMap::IsChangeThread()
+{
+	return ChangeTracking::thread == std::this_thread::get_id();
+}
+
+void PropertyMap::RecordChange(const StringName &key)
+{
+	if (m_changes->changed.empty())
+		ChangeTracking::pendingMaps.push_back(this);
+	m_changes->changed.push_back(key);
+}
+
+void PropertyMap::DeliverChanges()
+{
+	PROFILE_SCOPED()
+	assert(ChangeTracking::pendingMaps.empty() || IsChangeThread());
+
+	// changes made by observers go into a fresh list, for the next delivery
+	std::vector<PropertyMap *> &maps = ChangeTracking::deliveringMaps;
+	maps.swap(ChangeTracking::pendingMaps);
+
+	std::vector<StringName> changed;
+	for (size_t i = 0; i < maps.size(); i++) {
+		PropertyMap *map = maps[i];
+		if (!map)
+			continue;
+
+		changed.swap(map->m_changes->changed);
+
+		std::sort(changed.begin(), changed.end(), [](const StringName &a, const StringName &b) { return a.hash() < b.hash(); });
+		changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+		map->m_changes->onChanged.emit(map, changed);
+		changed.clear();
+	}
+
+	maps.clear();
+}
@@ -11,6 +11,9 @@
 #include "vector2.h"
 #include "vector3.h"
 
+#include <sigc++/sigc++.h>
+
+#include <memory>
 #include <string>
 #include <string_view>
 #include <type_traits>
@@ -42,6 +45,8 @@ public:
 
 	PropertyMap *get() const { return m_map; }
 
+	bool operator==(const PropertyMapWrapper &rhs) const { return m_map == rhs.m_map; }
+
 	auto begin();
 	auto end();
 
@@ -167,6 +172,15 @@ void to_json(Json &obj, const Property &n);
  * Internally, a power-of-two based Robin-Hood hash map is used to associate
  * StringName keys with Property values with extremely low hashing and lookup
  * overhead.
+ *
+ * Changes can be observed through OnChanged(). Rather than a notification per
+ * Set, observers are called once at the next DeliverChanges() sync point with
+ * every key whose value changed since the last one, however often it was set.
+ * Setting a property to the value it already has isn't a change.
+ *
+ * The change tracking isn't synchronised: once a map is observed, it must only
+ * be modified on the thread that observes it and delivers the changes (the
+ * main thread). Maps nothing observes can still be used from anywhere.
  */
 class PropertyMap : public RefCounted {
 public:
@@ -199,9 +213,15 @@ public:
 	};
 
 public:
+	// the map, and the keys changed since the last delivery (each listed once)
+	using ChangeSignal = sigc::signal<void, PropertyMap *, const std::vector<StringName> &>;
+
 	PropertyMap();
 	~PropertyMap();
 
+	PropertyMap(const PropertyMap &) = delete;
+	PropertyMap &operator=(const PropertyMap &) = delete;
+
 	void SaveToJson(Json &obj);
 	void LoadFromJson(const Json &obj);
 
@@ -238,9 +258,22 @@ public:
 
 	operator PropertyMapWrapper() { return PropertyMapWrapper(this); }
 
+	// Connecting to the signal starts tracking the changes made to this map;
+	// from then on it must only be modified on the main thread
+	ChangeSignal &OnChanged();
+
+	// Deliver the pending changes of every map, on the main thread once per
+	// frame. Changes made by the observers are delivered the next time; an
+	// observer must not destroy the map it is called for.
+	static void DeliverChanges();
+
 private:
+	struct ChangeTracking;
+
 	reference GetRef(uint32_t hash) const;
 	void SetRef(uint32_t hash, value_type &&value);
+	void RecordChange(const StringName &key);
+	static bool IsChangeThread();
 
 	PropertyMap(uint32_t size);
 	void Grow();
@@ -248,6 +281,8 @@ private:
 	std::vector<uint32_t> m_keys;
 	std::vector<value_type> m_values;
 	uint32_t m_entries;
+	// only allocated once something observes the map
+	std::unique_ptr<ChangeTracking> m_changes;
 };
 
 inline auto PropertyMapWrapper::begin() { return m_map->begin(); }
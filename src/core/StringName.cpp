@@ -55,15 +55,7 @@ StringName &StringName::operator=(StringName &&rhs)
 
 StringName::StringData *StringName::make_data(const char *c, uint32_t s, uint32_t h)
 {
-	auto &entry = StringTable::Get()->FindOrCreate(h);
-	if (!entry) {
-		entry = new (std::malloc(sizeof(StringData) + s + 1)) StringData();
-		std::memcpy(entry->get(), c, s);
-		entry->get()[s] = '\0';
-	}
-
-	entry->ref();
-	return entry;
+	return SharedStringTable::Get()->Intern(c, s, h);
 }
 
 // =============================================================================
@@ -165,15 +157,37 @@ void StringTable::Reclaim(bool force)
 		return;
 
 	m_reclaimClock.SoftReset();
-	for (uint32_t idx = 0; idx < keys.size(); idx++) {
+	EraseUnreferenced();
+}
+
+void StringTable::EraseUnreferenced()
+{
+	for (uint32_t idx = 0; idx < keys.size();) {
 		uint32_t probed_key = keys[idx];
 
 		// the refcount can be decremented to zero from another thread,
 		// and it can be incremented on another thread as long as it is >0
-		// but only this thread can increment it from zero
-		if (probed_key && !values[idx]->get_ref()) {
-			Erase(probed_key);
+		// but only the owner of this table can increment it from zero
+		if (probed_key && values[idx]) {
+			Data *link = &values[idx];
+			while (*link) {
+				Data data = *link;
+				if (!data->get_ref()) {
+					*link = data->next;
+					std::free(data);
+				} else {
+					link = &data->next;
+				}
+			}
+
+			if (!values[idx]) {
+				Erase(probed_key);
+				// erasing backshifts the following entries into this slot
+				continue;
+			}
 		}
+
+		idx++;
 	}
 }
 
@@ -196,10 +210,69 @@ void StringTable::Grow()
 	}
 }
 
+// =============================================================================
+
+SharedStringTable::SharedStringTable(uint32_t shardSize)
+{
+	m_shards.reserve(NUM_SHARDS);
+	for (uint32_t idx = 0; idx < NUM_SHARDS; idx++)
+		m_shards.emplace_back(new Shard(shardSize));
+}
+
+StringName::StringData *SharedStringTable::Intern(const char *c, uint32_t s, uint32_t h)
+{
+	Shard &shard = *m_shards[h >> (32 - SHARD_BITS)];
+	std::lock_guard<std::mutex> lock(shard.lock);
+
+	auto &head = shard.table.FindOrCreate(h);
+	StringName::StringData *entry = head;
+	while (entry && (entry->size != s || std::memcmp(entry->get(), c, s)))
+		entry = entry->next;
+
+	if (!entry) {
+		entry = new (std::malloc(sizeof(StringName::StringData) + s + 1)) StringName::StringData();
+		entry->size = s;
+		entry->next = head;
+		std::memcpy(entry->get(), c, s);
+		entry->get()[s] = '\0';
+		head = entry;
+	}
+
+	entry->ref();
+	return entry;
+}
+
+size_t SharedStringTable::Size() const
+{
+	size_t size = 0;
+	for (const auto &shard : m_shards) {
+		std::lock_guard<std::mutex> lock(shard->lock);
+		size += shard->table.Size();
+	}
+
+	return size;
+}
+
+void SharedStringTable::Reclaim(bool force)
+{
+	m_reclaimClock.SoftStop();
+	if (m_reclaimClock.seconds() < 15.0 && !force)
+		return;
+
+	m_reclaimClock.SoftReset();
+	for (const auto &shard : m_shards) {
+		std::lock_guard<std::mutex> lock(shard->lock);
+		shard->table.EraseUnreferenced();
+	}
+}
+
 // Lookup is extremely cheap when the string table has low to medium occupancy,
 // and resize/rehash is extremely expensive. We trade some static memory
-// allocated once for each thread to make reallocations very unlikely.
+// allocated once to make reallocations very unlikely.
 
-// 16k slots == 208kb per thread
-thread_local StringTable tl_stringTable = StringTable(1 << 14);
-StringTable *StringTable::Get() { return &tl_stringTable; }
+// 32 shards of 1k slots == 416kb
+SharedStringTable *SharedStringTable::Get()
+{
+	static SharedStringTable s_stringTable(1 << 10);
+	return &s_stringTable;
+}
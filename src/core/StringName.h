@@ -7,13 +7,16 @@
 #include "profiler/Profiler.h"
 
 #include <atomic>
+#include <memory>
+#include <mutex>
 #include <string_view>
 #include <type_traits>
 #include <vector>
 
 /*
  * Lightweight immutable refcounted string class. Internally stores string data
- * in the string object or in a thread-local hashtable for storage efficiency.
+ * in the string object or in a shared hashtable for storage efficiency.
+ * StringNames can be created and copied freely from any thread.
  */
 class StringName {
 	static constexpr uint32_t MAX_SSO_SIZE = 15;
@@ -52,15 +55,24 @@ public:
 	bool operator!=(std::string_view rhs) const { return !(*this == rhs); }
 	bool operator<(std::string_view rhs) const { return sv() < rhs; }
 
-	bool operator==(const StringName &rhs) const { return hash() == rhs.hash(); }
+	// equal long strings share their interned data, so only short strings
+	// need comparing once the hashes match
+	bool operator==(const StringName &rhs) const
+	{
+		return m_hash == rhs.m_hash && m_size == rhs.m_size &&
+			(m_size > MAX_SSO_SIZE ? m_str.ptr == rhs.m_str.ptr : sv() == rhs.sv());
+	}
 	bool operator!=(const StringName &rhs) const { return !(*this == rhs); }
 	bool operator<(const StringName &rhs) const { return sv() < rhs.sv(); }
 
 private:
 	friend class StringTable;
+	friend class SharedStringTable;
 
 	struct StringData {
 		mutable std::atomic<uint32_t> refcount;
+		uint32_t size;
+		StringData *next; // the next string with the same hash
 		char *get() { return reinterpret_cast<char *>(&this[1]); }
 
 		uint32_t ref() const { return refcount.fetch_add(1) + 1; }
@@ -80,9 +92,10 @@ private:
 };
 
 /*
- * Thread-local hash table for efficient storage of immutable strings.
+ * Hash table for efficient storage of immutable strings.
  * StringTable uses a power-of-two based robin-hood hash table to keep
- * indexing overhead as small as possible.
+ * indexing overhead as small as possible. It is not thread-safe on its own;
+ * StringName interns through a SharedStringTable instead.
  */
 class StringTable {
 public:
@@ -94,8 +107,6 @@ public:
 		values(size),
 		entries(0) {}
 
-	static StringTable *Get();
-
 	size_t Size() const { return entries; }
 	size_t Capacity() const { return keys.size(); }
 
@@ -116,6 +127,9 @@ public:
 	// from the owning thread
 	void Reclaim(bool force = false);
 
+	// Erase and free all string data no longer referenced by a StringName
+	void EraseUnreferenced();
+
 private:
 	void Grow();
 
@@ -126,4 +140,50 @@ private:
 	Profiler::Clock m_reclaimClock;
 };
 
+/*
+ * Process-wide string table shared by all threads. Entries are sharded by the
+ * high bits of their hash (the low bits index each shard's StringTable), with
+ * each shard behind its own lock, so threads interning different strings
+ * rarely contend.
+ *
+ * Reclamation needs no epochs: a refcount can only be raised from zero by
+ * make_data while holding the shard lock, and Reclaim erases zero-refcount
+ * entries under that same lock.
+ *
+ * Different strings can share a hash, so each entry is a chain of the
+ * strings with its hash, and Size() counts hashes rather than strings.
+ */
+class SharedStringTable {
+public:
+	static constexpr uint32_t SHARD_BITS = 5;
+	static constexpr uint32_t NUM_SHARDS = 1 << SHARD_BITS;
+
+	SharedStringTable(uint32_t shardSize);
+
+	static SharedStringTable *Get();
+
+	size_t Size() const;
+
+	// Reclaim unreferenced strings in all shards. Call this periodically
+	// from one thread; it does nothing if called again within 15 seconds
+	// unless forced.
+	void Reclaim(bool force = false);
+
+private:
+	friend class StringName;
+
+	StringName::StringData *Intern(const char *s, uint32_t size, uint32_t hash);
+
+	struct alignas(64) Shard {
+		Shard(uint32_t size) :
+			table(size) {}
+
+		mutable std::mutex lock;
+		StringTable table;
+	};
+
+	std::vector<std::unique_ptr<Shard>> m_shards;
+	Profiler::Clock m_reclaimClock;
+};
+
 inline StringName operator""_name(const char *c, size_t l) { return StringName(std::string_view(c, l)); }
@@ -126,27 +126,30 @@ std::string format_duration(double seconds)
 	return ss.str();
 }
 
-std::string format_distance(double dist, int precision)
+size_t format_distance(char *buf, size_t size, double dist, int precision)
 {
-	std::ostringstream ss;
-	ss.setf(std::ios::fixed, std::ios::floatfield);
+	fmt::format_to_n_result<char *> result;
 	if (dist < 1e3) {
-		ss.precision(0);
-		ss << dist << " m";
+		result = fmt::format_to_n(buf, size, "{:.0f} m", dist);
 	} else {
 		const float LY = 9.4607e15f;
-		ss.precision(precision);
 
 		if (dist < 1e6)
-			ss << (dist * 1e-3) << " km";
+			result = fmt::format_to_n(buf, size, "{:.{}f} km", dist * 1e-3, precision);
 		else if (dist < AU * 0.01)
-			ss << (dist * 1e-6) << " Mm";
+			result = fmt::format_to_n(buf, size, "{:.{}f} Mm", dist * 1e-6, precision);
 		else if (dist < LY * 0.1)
-			ss << (dist / AU) << " " << Lang::UNIT_AU;
+			result = fmt::format_to_n(buf, size, "{:.{}f} {}", dist / AU, precision, Lang::UNIT_AU);
 		else
-			ss << (dist / LY) << " " << Lang::UNIT_LY;
+			result = fmt::format_to_n(buf, size, "{:.{}f} {}", dist / LY, precision, Lang::UNIT_LY);
 	}
-	return ss.str();
+	return std::min(result.size, size);
+}
+
+std::string format_distance(double dist, int precision)
+{
+	char buf[64];
+	return std::string(buf, format_distance(buf, sizeof(buf), dist, precision));
 }
 
 // strcasestr() adapted from gnulib
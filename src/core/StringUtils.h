@@ -24,6 +24,9 @@
 std::string format_date(double time);
 std::string format_date_only(double time);
 std::string format_distance(double dist, int precision = 2);
+// Formats into buf without allocating, returns the length written (the text
+// is truncated to fit, and not null-terminated)
+size_t format_distance(char *buf, size_t size, double dist, int precision = 2);
 std::string format_money(double cents, bool showCents = true);
 std::string format_duration(double seconds);
 
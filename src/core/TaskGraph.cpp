@@ -5,7 +5,8 @@
 
 #include "JobQueue.h"
 #include "SDL_timer.h"
-#include "core/StringName.h"
+#include "core/PerfTimeline.h"
+#include "core/WorkStealingDeque.h"
 #include "fmt/format.h"
 #include "profiler/Profiler.h"
 #include <atomic_queue/atomic_queue.h>
@@ -13,12 +14,45 @@
 
 static constexpr size_t MAX_TASK_QUEUE_SIZE = 1024;
 static constexpr size_t MAX_JOB_QUEUE_SIZE = 1024;
+static constexpr size_t MAX_LOCAL_TASK_QUEUE_SIZE = 4096;
 
 static constexpr size_t MAX_PINNED_TASKS_STEP = 8;
 static constexpr size_t MAX_SPIN_COUNT = 10000;
 
 class AsyncTaskQueueImpl : public atomic_queue::AtomicQueue2<Task *, MAX_TASK_QUEUE_SIZE> {};
 class AsyncJobQueueImpl : public atomic_queue::AtomicQueue2<Job *, MAX_JOB_QUEUE_SIZE> {};
+class LocalTaskQueueImpl : public WorkStealingDeque<Task *, MAX_LOCAL_TASK_QUEUE_SIZE> {};
+
+// separate ready lists for each job priority class
+class PriorityJobQueueImpl {
+public:
+	void push(Job *job) { m_ready[size_t(job->GetPriority())].push(job); }
+	bool try_push(Job *job) { return m_ready[size_t(job->GetPriority())].try_push(job); }
+
+	// pop a job from the most urgent non-empty ready list
+	bool try_pop(Job *&job)
+	{
+		for (auto &list : m_ready) {
+			if (list.try_pop(job))
+				return true;
+		}
+
+		return false;
+	}
+
+	bool was_size() const
+	{
+		for (auto &list : m_ready) {
+			if (list.was_size())
+				return true;
+		}
+
+		return false;
+	}
+
+private:
+	AsyncJobQueueImpl m_ready[NUM_JOB_PRIORITIES];
+};
 
 // =============================================================================
 
@@ -28,17 +62,20 @@ public:
 	TaskGraphJobQueueImpl(TaskGraph *graph) :
 		m_graph(graph) {}
 
-	virtual Job::Handle Queue(Job *job, JobClient *client) override;
+	virtual Job::Handle Queue(Job *job, JobClient *client, JobPriority priority) override;
 	virtual void Cancel(Job *job) override;
 	virtual Uint32 FinishJobs() override;
 
 	TaskGraph *m_graph;
+	// incremented once per FinishJobs call, used to evaluate job deadlines
+	std::atomic<uint32_t> m_frame = 0;
 };
 
-Job::Handle TaskGraphJobQueueImpl::Queue(Job *job, JobClient *client)
+Job::Handle TaskGraphJobQueueImpl::Queue(Job *job, JobClient *client, JobPriority priority)
 {
 	Job::Handle handle(job, this, client);
 
+	job->SetScheduling(priority, m_frame.load(std::memory_order_relaxed));
 	m_graph->m_jobQueue->push(job);
 
 	std::atomic_thread_fence(std::memory_order_release);
@@ -58,6 +95,8 @@ Uint32 TaskGraphJobQueueImpl::FinishJobs()
 	uint32_t numFinished = 0;
 	Job *job = nullptr;
 
+	m_frame.fetch_add(1, std::memory_order_relaxed);
+
 	while (m_graph->m_jobFinishedQueue->try_pop(job)) {
 		job->UnlinkHandle();
 		if (job->cancelled.load(std::memory_order_relaxed)) {
@@ -102,11 +141,16 @@ TaskGraph::TaskGraph() :
 	m_taskQueue(new AsyncTaskQueueImpl()),
 	m_pinnedTasks(new AsyncTaskQueueImpl()),
 	m_jobHandlerImpl(new TaskGraphJobQueueImpl(this)),
-	m_jobQueue(new AsyncJobQueueImpl()),
+	m_jobQueue(new PriorityJobQueueImpl()),
 	m_jobFinishedQueue(new AsyncJobQueueImpl()),
 	m_isRunning(true),
-	m_numAliveThreads(0)
+	m_numAliveThreads(0),
+	m_numStealThreads(0)
 {
+	// worker threads read m_threads while stealing work; reserve the maximum
+	// size up front so adding threads never reallocates the storage
+	m_threads.reserve(MAX_THREADS + 1);
+
 	// initialize the main thread data
 	SetWorkerThreads(0);
 }
@@ -128,12 +172,21 @@ TaskGraph::~TaskGraph()
 			m_threads[idx]->threadHandle->join();
 			delete m_threads[idx]->threadHandle;
 		}
-
-		delete m_threads[idx];
 	}
 
 	// Cleanup leftover task objects
 	Task *task = nullptr;
+	for (ThreadData *thr : m_threads) {
+		if (thr->localTasks) {
+			while (thr->localTasks->pop(task))
+				delete task;
+
+			delete thr->localTasks;
+		}
+
+		delete thr;
+	}
+
 	while (m_taskQueue->try_pop(task)) {
 		delete task;
 	}
@@ -173,6 +226,8 @@ uint32_t TaskGraph::GetNumWorkerThreads() const
 
 void TaskGraph::SetWorkerThreads(uint32_t numThreads)
 {
+	numThreads = std::min(numThreads, MAX_THREADS);
+
 	// numThreads + 1 because we have an implicit thread entry for the "main" thread
 	if (numThreads + 1 <= m_threads.size())
 		return;
@@ -187,11 +242,16 @@ void TaskGraph::SetWorkerThreads(uint32_t numThreads)
 		thr->threadNum = idx;
 		thr->graph = this;
 		thr->isJobThread = idx > 0;
+		thr->localTasks = idx > 0 ? new LocalTaskQueueImpl() : nullptr;
+		thr->stealIndex = idx;
 		m_numAliveThreads.fetch_add(1, std::memory_order_release);
 		if (idx > 0)
 			thr->threadHandle = new std::thread(&ThreadData::RunThread, thr);
 	}
 
+	// publish the new threads' local queues to thieves
+	m_numStealThreads.store(numThreads + 1, std::memory_order_release);
+
 	// setup threadlocal data for the "main" thread here
 	tl_threadData = m_threads[0];
 	assert(m_numAliveThreads == numThreads + 1);
@@ -199,9 +259,11 @@ void TaskGraph::SetWorkerThreads(uint32_t numThreads)
 
 TaskSet::Handle TaskGraph::QueueTaskSet(TaskSet *taskSet)
 {
+	ThreadData *thread = GetThreadData();
+
 	taskSet->m_executing = true;
 	for (auto task : taskSet->m_tasks) {
-		m_taskQueue->push(task);
+		PushTask(thread, task);
 	}
 
 	std::atomic_thread_fence(std::memory_order_release);
@@ -211,7 +273,7 @@ TaskSet::Handle TaskGraph::QueueTaskSet(TaskSet *taskSet)
 
 void TaskGraph::QueueTask(Task *task)
 {
-	m_taskQueue->push(task);
+	PushTask(GetThreadData(), task);
 
 	// wake all threads that can run this task
 	WakeForNewTasks();
@@ -259,11 +321,17 @@ void TaskGraph::WaitForTaskSet(TaskSet::Handle &setHandle)
 	// if the currently running thread can't accomplish anything until the
 	// TaskSet has finished executing, this thread is implicitly free to assist
 	// in executing the TaskSet to minimize overall latency.
+	// Use the calling thread's data so a waiting worker drains its own
+	// deque first (where nested tasks were queued) before stealing.
+	ThreadData *thread = GetThreadData();
+	if (!thread || thread->graph != this)
+		thread = m_threads[0];
+
 	uint32_t spinCount = 0;
 	while (m_isRunning && !setHandle.IsComplete()) {
 		// We don't want to run any background Jobs during this loop as they
 		// cannot contribute towards the goal of completing the TaskSet
-		if (!TryRunTask(m_threads[0], false)) {
+		if (!TryRunTask(thread, false)) {
 			if (++spinCount > MAX_SPIN_COUNT) {
 				WaitForFinishedTask();
 			} else {
@@ -331,10 +399,13 @@ void TaskGraph::ThreadData::RunThread()
 	tl_threadData = this;
 	tl_threadName = fmt::format("Thread {}", threadNum);
 	Profiler::threadenter(tl_threadName.c_str());
+	Perf::Timeline::SetThreadName(tl_threadName);
 
-	// Worker threads pull Tasks / Jobs off of a central queue that all
-	// threads can push to - this requires the use of a bulletproof atomic
-	// queue implementation for speed and reliability.
+	// Worker threads first pull Tasks off of their own local deque, then off
+	// of a central queue that non-worker threads push to, and finally steal
+	// from the deques of other workers before looking for background Jobs.
+	// Nested tasks queued by a worker therefore stay on that worker unless
+	// another thread is idle and takes them.
 
 	// We also spin-wait for a fairly long time retrying for more work items
 	// to optimize the case in which there are many threaded work items being
@@ -350,9 +421,6 @@ void TaskGraph::ThreadData::RunThread()
 			}
 		} else {
 			spinCount = 0;
-
-			// reclaim used space in this thread's StringTable periodically
-			StringTable::Get()->Reclaim();
 		}
 	}
 
@@ -384,6 +452,12 @@ bool TaskGraph::HasTasks(ThreadData *thread)
 	if (m_taskQueue->was_size())
 		return true;
 
+	uint32_t numThreads = m_numStealThreads.load(std::memory_order_acquire);
+	for (uint32_t idx = 1; idx < numThreads; idx++) {
+		if (m_threads[idx]->localTasks->was_size())
+			return true;
+	}
+
 	if (thread->isJobThread && m_jobQueue->was_size())
 		return true;
 
@@ -396,12 +470,18 @@ bool TaskGraph::TryRunTask(ThreadData *thread, bool allowJobs)
 	Task *taskToRun = nullptr;
 	bool hasTask = false;
 
-	if (thread->threadNum == 0)
+	if (thread->localTasks)
+		hasTask = thread->localTasks->pop(taskToRun);
+
+	if (!hasTask && thread->threadNum == 0)
 		hasTask = m_pinnedTasks->try_pop(taskToRun);
 
 	if (!hasTask)
 		hasTask = m_taskQueue->try_pop(taskToRun);
 
+	if (!hasTask)
+		hasTask = TryStealTask(thread, taskToRun);
+
 	if (hasTask) {
 		ExecTask(taskToRun);
 		return true;
@@ -409,8 +489,16 @@ bool TaskGraph::TryRunTask(ThreadData *thread, bool allowJobs)
 
 	Job *job = nullptr;
 	if (allowJobs && thread->isJobThread && m_jobQueue->try_pop(job)) {
-		if (!job->cancelled.load(std::memory_order_acquire))
+		// jobs which have missed their deadline are moved out of the way of
+		// more urgent work (if there's no room to demote them, just run them)
+		uint32_t frame = m_jobHandlerImpl->m_frame.load(std::memory_order_relaxed);
+		if (job->IsPastDeadline(frame) && !job->MissedDeadline() && m_jobQueue->try_push(job))
+			return true;
+
+		if (!job->cancelled.load(std::memory_order_acquire)) {
+			PERF_ZONE("Job")
 			job->OnRun();
+		}
 		m_jobFinishedQueue->push(job);
 
 		return true;
@@ -419,12 +507,48 @@ bool TaskGraph::TryRunTask(ThreadData *thread, bool allowJobs)
 	return false;
 }
 
+// Try to take a task from the local deque of another worker thread
+bool TaskGraph::TryStealTask(ThreadData *thread, Task *&task)
+{
+	uint32_t numThreads = m_numStealThreads.load(std::memory_order_acquire);
+	if (numThreads <= 1)
+		return false;
+
+	// visit every worker once, starting after the last successful victim so
+	// that thieves spread out rather than all hammering the same deque
+	for (uint32_t count = 0; count < numThreads; count++) {
+		uint32_t victim = thread->stealIndex++ % numThreads;
+		if (victim == 0 || victim == thread->threadNum)
+			continue;
+
+		if (m_threads[victim]->localTasks->steal(task)) {
+			thread->stealIndex = victim;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Place a task on the calling worker's local deque if possible, otherwise on
+// the shared task queue
+void TaskGraph::PushTask(ThreadData *thread, Task *task)
+{
+	if (thread && thread->graph == this && thread->localTasks && thread->localTasks->push(task))
+		return;
+
+	m_taskQueue->push(task);
+}
+
 void TaskGraph::ExecTask(Task *task)
 {
-	task->OnExecute(task->m_range);
+	{
+		PERF_ZONE("Task")
+		task->OnExecute(task->m_range);
+	}
 
 	if (task->m_owner)
-		task->m_owner->m_dependants.fetch_sub(1);
+		task->m_owner->m_dependants.fetch_sub(1, std::memory_order_release);
 	else
 		delete task;
 
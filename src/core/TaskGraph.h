@@ -7,6 +7,7 @@
 #include <thread>
 #include <vector>
 
+#include "core/PoolAllocator.h"
 #include "core/Semaphore.h"
 
 struct TaskRange {
@@ -16,6 +17,8 @@ struct TaskRange {
 
 class AsyncTaskQueueImpl;
 class AsyncJobQueueImpl;
+class LocalTaskQueueImpl;
+class PriorityJobQueueImpl;
 
 class JobQueue;
 class TaskGraphJobQueueImpl;
@@ -30,7 +33,7 @@ public:
 
 	std::atomic<uint32_t> m_dependants;
 
-	bool IsComplete() { return m_dependants.load(std::memory_order_relaxed) == 0; }
+	bool IsComplete() { return m_dependants.load(std::memory_order_acquire) == 0; }
 };
 
 // A Task is the building block of the TaskGraph system.
@@ -41,7 +44,8 @@ public:
 //
 // Tasks are managed by raw pointers and should not be deleted by
 // user code - the owning TaskSet or TaskGraph will delete the task
-// when it is complete.
+// when it is complete. Tasks are allocated from the thread-local block
+// pools (see PoolAllocator.h) to avoid a heap round-trip per task.
 //
 // Subclass and implement these methods:
 //   OnExecute: responsible for carrying out the actual work done by the task,
@@ -49,7 +53,7 @@ public:
 //
 //   OnComplete: used to synchronize reporting of task results, called by the
 //     task owner at a synchronization point on the task owner's thread.
-class Task {
+class Task : public PoolAllocated {
 public:
 	Task(TaskRange range = {}) :
 		m_owner(nullptr),
@@ -147,6 +151,9 @@ public:
 
 	// Queues all tasks in a TaskSet for execution. The TaskGraph now owns
 	// the underlying TaskSet and is responsible for deletion.
+	// When called from a worker thread, the tasks are placed on that
+	// worker's local deque and will be stolen by other threads as they
+	// become idle.
 	TaskSet::Handle QueueTaskSet(TaskSet *set);
 	// Queues a single task without a TaskSet for execution
 	void QueueTask(Task *task);
@@ -182,6 +189,12 @@ private:
 		TaskGraph *graph;
 		bool isJobThread;
 
+		// per-worker deque of tasks queued from this thread
+		// (nullptr for the main thread)
+		LocalTaskQueueImpl *localTasks;
+		// index of the next thread to try stealing from
+		uint32_t stealIndex;
+
 		void RunThread();
 		void WaitForTasks();
 	};
@@ -189,6 +202,8 @@ private:
 	static thread_local ThreadData *tl_threadData;
 
 	bool TryRunTask(ThreadData *thread, bool allowJobs = true);
+	bool TryStealTask(ThreadData *thread, Task *&task);
+	void PushTask(ThreadData *thread, Task *task);
 	void ExecTask(Task *task);
 	bool HasTasks(ThreadData *thread);
 	static ThreadData *GetThreadData();
@@ -200,7 +215,8 @@ private:
 
 	std::vector<ThreadData *> m_threads;
 
-	// queue for short-lived high-priority tasks
+	// queue for short-lived high-priority tasks queued from outside the
+	// worker threads; tasks queued from a worker go to its local deque
 	AsyncTaskQueueImpl *m_taskQueue;
 	// queue of tasks to run on the main thread
 	AsyncTaskQueueImpl *m_pinnedTasks;
@@ -209,12 +225,14 @@ private:
 	// with the old JobQueue system
 	TaskGraphJobQueueImpl *m_jobHandlerImpl;
 
-	// queue for long-lived low-priority background jobs
-	AsyncJobQueueImpl *m_jobQueue;
+	// queues for long-lived background jobs, one ready list per JobPriority
+	PriorityJobQueueImpl *m_jobQueue;
 	AsyncJobQueueImpl *m_jobFinishedQueue;
 
 	std::atomic<bool> m_isRunning;
 	std::atomic<uint32_t> m_numAliveThreads;
+	// number of entries in m_threads visible to work-stealing threads
+	std::atomic<uint32_t> m_numStealThreads;
 
 	Semaphore m_newTasksSemaphore;
 	Semaphore m_finishedTasksSemaphore;
@@ -0,0 +1,111 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-capacity Chase-Lev work-stealing deque, following the weak memory
+// model formulation of Le, Pop, Cohen and Zappa Nardelli (PPoPP 2013).
+//
+// The owning thread pushes and pops at the bottom of the deque (LIFO, which
+// keeps nested work hot in that thread's caches), while any other thread may
+// steal from the top (FIFO, taking the oldest and usually largest work item).
+//
+// push() and pop() must only ever be called by the owning thread. steal() and
+// was_size() may be called from any thread.
+//
+// T must be trivially copyable (typically a pointer type).
+template <typename T, size_t Capacity>
+class WorkStealingDeque {
+	static_assert((Capacity & (Capacity - 1)) == 0, "WorkStealingDeque capacity must be a power of two");
+	static constexpr int64_t MASK = int64_t(Capacity) - 1;
+
+public:
+	WorkStealingDeque() :
+		m_top(0),
+		m_bottom(0)
+	{}
+
+	WorkStealingDeque(const WorkStealingDeque &) = delete;
+	WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+	// Push an item onto the bottom of the deque. Owner thread only.
+	// Returns false if the deque is full; the caller should fall back to
+	// another queue in that case.
+	bool push(T item)
+	{
+		int64_t b = m_bottom.load(std::memory_order_relaxed);
+		int64_t t = m_top.load(std::memory_order_acquire);
+		if (b - t >= int64_t(Capacity))
+			return false;
+
+		m_buffer[b & MASK].store(item, std::memory_order_relaxed);
+		// release-store (rather than a fence) publishes the item to thieves
+		m_bottom.store(b + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Pop the most recently pushed item. Owner thread only.
+	bool pop(T &item)
+	{
+		int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+		m_bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = m_top.load(std::memory_order_relaxed);
+
+		if (t > b) {
+			// deque was empty, restore the canonical empty state
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		item = m_buffer[b & MASK].load(std::memory_order_relaxed);
+		if (t != b)
+			return true;
+
+		// Last item in the deque; race any thieves for it.
+		bool won = m_top.compare_exchange_strong(t, t + 1,
+			std::memory_order_seq_cst, std::memory_order_relaxed);
+		m_bottom.store(b + 1, std::memory_order_relaxed);
+		return won;
+	}
+
+	// Steal the oldest item from the top of the deque. Any thread.
+	// Returns false if the deque was empty or the steal lost a race; callers
+	// should simply move on to the next victim.
+	bool steal(T &item)
+	{
+		int64_t t = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = m_bottom.load(std::memory_order_acquire);
+
+		if (t >= b)
+			return false;
+
+		T value = m_buffer[t & MASK].load(std::memory_order_relaxed);
+		if (!m_top.compare_exchange_strong(t, t + 1,
+				std::memory_order_seq_cst, std::memory_order_relaxed))
+			return false;
+
+		item = value;
+		return true;
+	}
+
+	// Approximate number of items in the deque, intended for wakeup heuristics.
+	size_t was_size() const
+	{
+		int64_t b = m_bottom.load(std::memory_order_relaxed);
+		int64_t t = m_top.load(std::memory_order_relaxed);
+		return b > t ? size_t(b - t) : 0;
+	}
+
+private:
+	// top and bottom are written by different threads, keep them on separate
+	// cache lines to avoid false sharing between the owner and thieves
+	alignas(64) std::atomic<int64_t> m_top;
+	alignas(64) std::atomic<int64_t> m_bottom;
+	alignas(64) std::atomic<T> m_buffer[Capacity];
+};
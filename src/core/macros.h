@@ -52,3 +52,13 @@ char (&COUNTOF_Helper(T (&array)[N]))[N];
 #endif
 #define stackalloc(T, n) reinterpret_cast<T *>(alloca(sizeof(T) * n))
 #endif
+
+// Hint that the cache line containing addr will be read soon
+// Useful ahead of indirect loads in tight loops over large arrays
+
+#ifdef _MSC_VER
+#include <xmmintrin.h>
+#define PREFETCH(addr) _mm_prefetch(reinterpret_cast<const char *>(addr), _MM_HINT_T0)
+#else
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#endif
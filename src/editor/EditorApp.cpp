@@ -16,12 +16,14 @@
 #include "EnumStrings.h"
 
 #include "argh/argh.h"
+#include "collider/BVHTree.h"
 #include "core/IniConfig.h"
 #include "core/OS.h"
 #include "graphics/Graphics.h"
 #include "imgui/imgui.h"
 #include "lua/Lua.h"
 #include "graphics/opengl/RendererGL.h"
+#include "scenegraph/Loader.h"
 
 #include "system/SystemEditor.h"
 
@@ -117,6 +119,8 @@ void EditorApp::OnStartup()
 	Uint32 numThreads = m_editorCfg->Int("WorkerThreads");
 	numThreads = numThreads ? numThreads : std::max(OS::GetNumCores() - 1, 1U);
 	GetTaskGraph()->SetWorkerThreads(numThreads);
+	SingleBVHTreeBase::SetTaskGraph(GetTaskGraph());
+	SceneGraph::Loader::SetTaskGraph(GetTaskGraph());
 
 	Lang::Resource &res(Lang::GetResource("core", m_editorCfg->String("Lang", "en")));
 	Lang::MakeCore(res);
@@ -148,6 +152,9 @@ void EditorApp::OnShutdown()
 	ShutdownInput();
 
 	m_editorCfg.reset();
+
+	SingleBVHTreeBase::SetTaskGraph(nullptr);
+	SceneGraph::Loader::SetTaskGraph(nullptr);
 }
 
 void EditorApp::PreUpdate()
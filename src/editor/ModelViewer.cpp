@@ -54,6 +54,7 @@ ModelViewer::ModelViewer(EditorApp *app, LuaManager *lm) :
 	m_modelWindow->GetUIExtPostRender().connect(sigc::mem_fun(this, &ModelViewer::OnPostRender));
 	m_modelWindow->GetUIExtOverlay().connect(sigc::mem_fun(this, &ModelViewer::DrawTagNames));
 	m_modelWindow->GetUIExtMenu().connect(sigc::mem_fun(this, &ModelViewer::ExtendMenuBar));
+	m_modelWindow->GetModelLoaded().connect(sigc::mem_fun(this, &ModelViewer::OnModelLoaded));
 
 	ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
 }
@@ -90,8 +91,11 @@ void ModelViewer::End()
 void ModelViewer::ReloadModel()
 {
 	Log::Info("Reloading model {}", m_modelName);
-	m_requestedModelName = m_modelName;
 	m_resetLogScroll = true;
+
+	// loaded again from scratch if it can't be reloaded in place
+	if (!m_modelWindow->ReloadModel())
+		m_requestedModelName = m_modelName;
 }
 
 void ModelViewer::ToggleGuns()
@@ -262,7 +266,7 @@ void ModelViewer::HandleInput()
 	 */
 
 	if (m_input->IsKeyPressed(SDLK_ESCAPE)) {
-		if (m_modelWindow->GetModel()) {
+		if (m_modelWindow->GetModel() || m_modelWindow->IsLoading()) {
 			ClearModel();
 			UpdateModelList();
 			UpdateDecalList();
@@ -388,16 +392,21 @@ void ModelViewer::SetModel(const std::string &filename)
 
 	ClearModel();
 
-	if (m_modelWindow->LoadModel(filename)) {
+	// OnModelLoaded is called once the model is done loading
+	if (m_modelWindow->LoadModel(filename))
 		m_modelName = filename;
-		OnModelLoaded();
-	}
 }
 
 void ModelViewer::OnModelLoaded()
 {
 	SceneGraph::Model *model = m_modelWindow->GetModel();
 
+	// a reloaded model replaces the one this state refers to
+	m_shields->ClearModel();
+	m_shieldModel.reset();
+	m_selectedTag = nullptr;
+	m_attachGuns = false;
+
 	ResetThrusters();
 
 	SceneGraph::DumpVisitor d(model);
@@ -554,7 +563,7 @@ static Color get_color(int colorBase)
 	}
 }
 
-void ModelViewer::BuildGeomTreeVisualizer(Graphics::VertexArray &va, SingleBVHTreeBase *bvh, int colIndexBase)
+void ModelViewer::BuildGeomTreeVisualizer(Graphics::VertexArray &va, const CompactBVHTree *bvh, int colIndexBase)
 {
 	uint32_t stackLevel = 0;
 	uint32_t *stack = stackalloc(uint32_t, bvh->GetHeight() + 1);
@@ -562,15 +571,15 @@ void ModelViewer::BuildGeomTreeVisualizer(Graphics::VertexArray &va, SingleBVHTr
 	stack[stackLevel++] = 0;
 
 	while (stackLevel > 0) {
-		const SingleBVHTree::Node *node = bvh->GetNode(stack[--stackLevel]);
+		const CompactBVHTree::Node *node = bvh->GetNode(stack[--stackLevel]);
 
-		if (node->kids[0] != 0) {
+		if (!node->IsLeaf()) {
 			// Push in reverse order for pre-order traversal
-			stack[stackLevel++] = node->kids[1];
-			stack[stackLevel++] = node->kids[0];
+			stack[stackLevel++] = node->firstKid + 1;
+			stack[stackLevel++] = node->firstKid;
 		}
 
-		Graphics::Drawables::AABB::DrawVertices(va, matrix4x4fIdentity, Aabb(node->aabb.min, node->aabb.max, 0.1), get_color(colIndexBase));
+		Graphics::Drawables::AABB::DrawVertices(va, matrix4x4fIdentity, Aabb(vector3d(node->min), vector3d(node->max), 0.1), get_color(colIndexBase));
 	}
 }
 
@@ -23,7 +23,7 @@ namespace SceneGraph {
 	class Tag;
 }
 
-class SingleBVHTreeBase;
+class CompactBVHTree;
 
 namespace Editor {
 
@@ -76,7 +76,7 @@ private:
 
 	// Draw additional debug overlays
 	void OnPostRender();
-	void BuildGeomTreeVisualizer(Graphics::VertexArray &va, SingleBVHTreeBase *bvh, int colIndexBase);
+	void BuildGeomTreeVisualizer(Graphics::VertexArray &va, const CompactBVHTree *bvh, int colIndexBase);
 
 	void ExtendMenuBar();
 
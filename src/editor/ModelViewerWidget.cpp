@@ -4,6 +4,8 @@
 #include "ModelViewerWidget.h"
 
 #include "EditorIcons.h"
+#include "FileSystem.h"
+#include "JobQueue.h"
 #include "MathUtil.h"
 #include "NavLights.h"
 
@@ -30,6 +32,10 @@
 #include "imgui/imgui.h"
 #include "imgui/imgui_internal.h"
 
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+
 using namespace Editor;
 
 // ─── Utility Functions ───────────────────────────────────────────────────────
@@ -86,55 +92,81 @@ SceneGraph::Model *ModelViewerWidget::GetModel()
 	return m_model.get();
 }
 
-bool ModelViewerWidget::LoadModel(std::string_view path)
-{
-	ClearModel();
+// ─── Background Loading ──────────────────────────────────────────────────────
+
+struct ModelViewerWidget::LoadState {
+	std::string modelName;
+	bool reloading = false;
+	Job::Handle job;
+	std::shared_ptr<SceneGraph::Loader::ImportProgress> progress;
+
+	// lent to the job while a load is in flight
+	std::unique_ptr<SceneGraph::Loader::ImportCache> importCache;
+
+	// files the shown model was loaded from, with their modification times
+	std::map<std::string, Time::DateTime> sourceFiles;
+	std::vector<std::string> meshFiles;
+	float checkTimer = 0.f;
+};
+
+// Parses the .model file and imports its mesh files on a worker; the model
+// is created on the main thread when the job finishes, as that needs the renderer
+class ModelViewerWidget::LoadModelJob : public Job {
+public:
+	LoadModelJob(ModelViewerWidget *widget, const std::string &name,
+		std::unique_ptr<SceneGraph::Loader::ImportCache> cache,
+		std::shared_ptr<SceneGraph::Loader::ImportProgress> progress) :
+		loader(new SceneGraph::Loader(widget->m_renderer, true, false)),
+		importCache(std::move(cache)),
+		m_widget(widget),
+		m_name(name),
+		m_progress(progress)
+	{
+		loader->SetImportCache(importCache.get());
+		loader->SetImportProgress(m_progress.get());
+	}
 
-	try {
-		if (ends_with_ci(path, ".sgm")) {
-			//binary loader expects extension-less name. Might want to change this.
-			std::string modelName = std::string(path.substr(0, path.size() - 4));
-			SceneGraph::BinaryConverter bc(m_renderer);
-			m_model.reset(bc.Load(modelName));
-		} else {
-			std::string modelName = std::string(path);
-			SceneGraph::Loader loader(m_renderer, true, false);
-			m_model.reset(loader.LoadModel(modelName));
-
-			//dump warnings
-			for (std::vector<std::string>::const_iterator it = loader.GetLogMessages().begin();
-				 it != loader.GetLogMessages().end(); ++it) {
-				Log::Warning("{}", *it);
-			}
+	virtual void OnRun() override
+	{
+		PROFILE_SCOPED()
+		try {
+			loader->PrepareModel(m_name);
+		} catch (SceneGraph::LoadingError &err) {
+			error = err.what();
 		}
+	}
 
-		if (!m_model) {
-			Log::Warning("Could not load model {}", path);
-			return false;
-		}
+	virtual void OnFinish() override
+	{
+		m_widget->OnModelPrepared(this);
+	}
 
-		// set model colors
-		m_model->SetColors(m_colors);
+	std::unique_ptr<SceneGraph::Loader> loader;
+	std::unique_ptr<SceneGraph::Loader::ImportCache> importCache;
+	std::string error;
 
-		//set decal textures, max 4 supported.
-		//Identical texture at the moment
-		SetDecals("pioneer");
+private:
+	ModelViewerWidget *m_widget;
+	std::string m_name;
+	// kept alive for the loader if the job is cancelled
+	std::shared_ptr<SceneGraph::Loader::ImportProgress> m_progress;
+};
 
-		// TODO: preload grid option from approximate model bounds
-		m_options.gridInterval = 10.f;
+bool ModelViewerWidget::LoadModel(std::string_view path)
+{
+	ClearModel();
 
-		// If we've got the tag_landing set then use it for an offset otherwise grab the AABB
-		const SceneGraph::Tag *mt = m_model->FindTagByName("tag_landing");
-		if (mt)
-			m_landingMinOffset = mt->GetGlobalTransform().GetTranslate().y;
-		else if (m_model->GetCollisionMesh())
-			m_landingMinOffset = m_model->GetCollisionMesh()->GetAabb().min.y;
-		else
-			m_landingMinOffset = 0.0f;
+	if (!ends_with_ci(path, ".sgm")) {
+		m_load.reset(new LoadState());
+		StartLoad(std::string(path), false);
+		return true;
+	}
 
-		//note: stations won't demonstrate full docking light logic in MV
-		m_navLights.reset(new NavLights(m_model.get()));
-		m_navLights->SetEnabled(true);
+	try {
+		//binary loader expects extension-less name. Might want to change this.
+		std::string modelName = std::string(path.substr(0, path.size() - 4));
+		SceneGraph::BinaryConverter bc(m_renderer);
+		m_model.reset(bc.Load(modelName));
 	} catch (SceneGraph::LoadingError &err) {
 		// report the error and show model picker.
 		m_model.reset();
@@ -142,12 +174,189 @@ bool ModelViewerWidget::LoadModel(std::string_view path)
 		return false;
 	}
 
+	if (!SetupModel(path))
+		return false;
+
+	ResetCamera();
+	OnModelLoaded();
+	m_modelLoaded.emit();
+	return true;
+}
+
+bool ModelViewerWidget::ReloadModel()
+{
+	if (!m_load)
+		return false;
+
+	if (!m_load->job.HasJob())
+		StartLoad(m_load->modelName, m_model != nullptr);
+	return true;
+}
+
+bool ModelViewerWidget::IsLoading() const
+{
+	return m_load && m_load->job.HasJob();
+}
+
+void ModelViewerWidget::StartLoad(const std::string &name, bool reload)
+{
+	m_load->modelName = name;
+	m_load->reloading = reload;
+	m_load->progress.reset(new SceneGraph::Loader::ImportProgress());
+	if (!m_load->importCache)
+		m_load->importCache.reset(new SceneGraph::Loader::ImportCache());
+
+	LoadModelJob *job = new LoadModelJob(this, name, std::move(m_load->importCache), m_load->progress);
+	m_load->job = GetApp()->GetAsyncJobQueue()->Queue(job);
+}
+
+void ModelViewerWidget::OnModelPrepared(LoadModelJob *job)
+{
+	PROFILE_SCOPED()
+	LoadState &load = *m_load;
+	load.importCache = std::move(job->importCache);
+
+	if (!job->error.empty()) {
+		Log::Warning("Could not load model {}: {}", load.modelName, job->error);
+		if (!load.reloading)
+			m_load.reset();
+		return;
+	}
+
+	SceneGraph::Loader &loader = *job->loader;
+	std::map<std::string, Time::DateTime> sourceFiles;
+	for (const std::string &file : loader.GetSourceFiles())
+		sourceFiles[file] = FileSystem::gameDataFiles.Lookup(file).GetModificationTime();
+
+	const std::vector<std::string> meshFiles = loader.GetMeshFiles();
+	if (load.reloading) {
+		// textures are cached by the renderer; drop the ones that changed
+		bool meshesChanged = meshFiles != load.meshFiles;
+		for (const auto &file : sourceFiles) {
+			auto it = load.sourceFiles.find(file.first);
+			if (it != load.sourceFiles.end() && it->second == file.second)
+				continue;
+
+			if (std::find(meshFiles.begin(), meshFiles.end(), file.first) != meshFiles.end())
+				meshesChanged = true;
+			else
+				m_renderer->RemoveCachedTexture("model", file.first);
+		}
+
+		// nothing the collision mesh is built from changed; skip rebuilding
+		// it and its GeomTree
+		if (!meshesChanged && m_model && m_model->GetCollisionMesh())
+			loader.SetCollisionMesh(m_model->GetCollisionMesh());
+	}
+
+	load.sourceFiles = std::move(sourceFiles);
+	load.meshFiles = meshFiles;
+	load.checkTimer = 0.f;
+
+	std::unique_ptr<SceneGraph::Model> model;
+	try {
+		model.reset(loader.CreatePreparedModel());
+	} catch (SceneGraph::LoadingError &err) {
+		Log::Warning("Could not load model {}: {}", load.modelName, err.what());
+		if (!load.reloading)
+			m_load.reset();
+		return;
+	}
+
+	//dump warnings
+	for (const std::string &msg : loader.GetLogMessages())
+		Log::Warning("{}", msg);
+
+	const bool reloading = load.reloading;
+	const std::string modelName = load.modelName;
+
+	// the old model stays shown until here; keep the camera where it was
+	m_animations.clear();
+	m_currentAnimation = nullptr;
+	m_model = std::move(model);
+
+	if (!SetupModel(modelName)) {
+		m_load.reset();
+		return;
+	}
+
+	if (!reloading)
+		ResetCamera();
 	OnModelLoaded();
+	m_modelLoaded.emit();
+}
+
+bool ModelViewerWidget::SetupModel(std::string_view path)
+{
+	if (!m_model) {
+		Log::Warning("Could not load model {}", path);
+		return false;
+	}
+
+	// set model colors
+	m_model->SetColors(m_colors);
+
+	//set decal textures, max 4 supported.
+	//Identical texture at the moment
+	SetDecals("pioneer");
+
+	// TODO: preload grid option from approximate model bounds
+	m_options.gridInterval = 10.f;
+
+	// If we've got the tag_landing set then use it for an offset otherwise grab the AABB
+	const SceneGraph::Tag *mt = m_model->FindTagByName("tag_landing");
+	if (mt)
+		m_landingMinOffset = mt->GetGlobalTransform().GetTranslate().y;
+	else if (m_model->GetCollisionMesh())
+		m_landingMinOffset = m_model->GetCollisionMesh()->GetAabb().min.y;
+	else
+		m_landingMinOffset = 0.0f;
+
+	//note: stations won't demonstrate full docking light logic in MV
+	m_navLights.reset(new NavLights(m_model.get()));
+	m_navLights->SetEnabled(true);
 	return true;
 }
 
+void ModelViewerWidget::CheckSourceFiles(float deltaTime)
+{
+	if (!m_load || !m_model || m_load->job.HasJob())
+		return;
+
+	// stat the files about once a second
+	m_load->checkTimer += deltaTime;
+	if (m_load->checkTimer < 1.f)
+		return;
+	m_load->checkTimer = 0.f;
+
+	for (const auto &file : m_load->sourceFiles) {
+		if (FileSystem::gameDataFiles.Lookup(file.first).GetModificationTime() != file.second) {
+			Log::Info("{} changed, reloading model {}", file.first, m_load->modelName);
+			StartLoad(m_load->modelName, true);
+			return;
+		}
+	}
+}
+
+void ModelViewerWidget::DrawLoadProgress()
+{
+	if (!IsLoading())
+		return;
+
+	const uint32_t numFiles = m_load->progress->numFiles;
+	const uint32_t numImported = m_load->progress->numImported;
+
+	ImGui::NewLine();
+	ImGui::Text("%s %s", m_load->reloading ? "Reloading" : "Loading", m_load->modelName.c_str());
+	ImGui::ProgressBar(numFiles ? float(numImported) / float(numFiles) : 0.f, ImVec2(-FLT_MIN, 0.f),
+		fmt::format("{}/{} files", numImported, numFiles).c_str());
+}
+
 void ModelViewerWidget::ClearModel()
 {
+	// cancels a load in flight
+	m_load.reset();
+
 	ResetCamera();
 	m_model.reset();
 
@@ -163,8 +372,6 @@ void ModelViewerWidget::ClearModel()
 
 void ModelViewerWidget::OnModelLoaded()
 {
-	ResetCamera();
-
 	m_animations = m_model->GetAnimations();
 	m_currentAnimation = m_animations.size() ? m_animations.front() : nullptr;
 
@@ -442,6 +649,8 @@ void ModelViewerWidget::ToggleViewControlMode()
 
 void ModelViewerWidget::OnUpdate(float deltaTime)
 {
+	CheckSourceFiles(deltaTime);
+
 	if (m_model) {
 
 		// Update navlights
@@ -650,6 +859,8 @@ void ModelViewerWidget::OnDraw()
 	DrawViewportControls();
 	m_extViewportControls.emit();
 
+	DrawLoadProgress();
+
 	if (m_animations.empty()) {
 		return;
 	}
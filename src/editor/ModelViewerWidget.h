@@ -14,6 +14,7 @@
 #include "matrix3x3.h"
 #include "matrix4x4.h"
 
+#include <memory>
 #include <string_view>
 
 class NavLights;
@@ -72,9 +73,19 @@ namespace Editor
 		ModelViewerWidget(EditorApp *app);
 		~ModelViewerWidget();
 
+		// .model files are loaded on a job; the model is swapped in (and
+		// GetModelLoaded emitted) once it's done. Returns false if the load
+		// failed or could not be started.
 		bool LoadModel(std::string_view path);
+		// Load the current model again, keeping it shown until the new one
+		// is done. Files that haven't changed since are not imported again.
+		// Returns false for models that can only be loaded again from scratch
+		// (.sgm files, or a model that failed to load).
+		bool ReloadModel();
 		void ClearModel();
 
+		bool IsLoading() const;
+
 		void OnAppearing() override;
 		void OnDisappearing() override;
 
@@ -98,6 +109,9 @@ namespace Editor
 		// Extend to add additional viewport control widgets
 		UIDelegate &GetUIExtViewportControls() { return m_extViewportControls; }
 
+		// Emitted when a model has been loaded or reloaded
+		UIDelegate &GetModelLoaded() { return m_modelLoaded; }
+
 	protected:
 
 		void OnUpdate(float deltaTime) override;
@@ -111,6 +125,7 @@ namespace Editor
 		UIDelegate m_extOverlay;
 		UIDelegate m_extMenus;
 		UIDelegate m_extViewportControls;
+		UIDelegate m_modelLoaded;
 
 	private:
 		struct Inputs : Input::InputFrame {
@@ -134,6 +149,15 @@ namespace Editor
 		void CreateTestResources();
 		void OnModelLoaded();
 
+		// Background loading
+		class LoadModelJob;
+		struct LoadState;
+		void StartLoad(const std::string &name, bool reload);
+		void OnModelPrepared(LoadModelJob *job);
+		bool SetupModel(std::string_view path);
+		void CheckSourceFiles(float deltaTime);
+		void DrawLoadProgress();
+
 		// Input controls
 		void ChangeCameraPreset(CameraPreset preset);
 		void ToggleViewControlMode();
@@ -156,6 +180,7 @@ namespace Editor
 
 		std::unique_ptr<SceneGraph::Model> m_model;
 		std::unique_ptr<NavLights> m_navLights;
+		std::unique_ptr<LoadState> m_load;
 
 		std::unique_ptr<Graphics::MeshObject> m_bgMesh;
 		std::unique_ptr<Graphics::Material> m_bgMaterial;
@@ -494,7 +494,7 @@ void SystemBody::EditorAPI::EditOrbitalParameters(SystemBody *body, UndoSystem *
 	ImGui::SeparatorText("Orbital Parameters");
 
 	bool orbitChanged = false;
-	auto updateBodyOrbit = [=](){ body->SetOrbitFromParameters(); };
+	auto updateBodyOrbit = [=](){ UpdateDerived(body, DERIVED_Orbit); };
 
 	orbitChanged |= Draw::InputFixedDistance("Semi-Major Axis", &body->m_semiMajorAxis);
 	if (Draw::UndoHelper("Edit Semi-Major Axis", undo))
@@ -570,7 +570,7 @@ void SystemBody::EditorAPI::EditOrbitalParameters(SystemBody *body, UndoSystem *
 		AddUndoSingleValueClosure(undo, &body->m_rotationPeriod, updateBodyOrbit);
 
 	if (orbitChanged)
-		body->SetOrbitFromParameters();
+		UpdateDerived(body, DERIVED_Orbit);
 
 }
 
@@ -605,16 +605,18 @@ void SystemBody::EditorAPI::EditStarportProperties(SystemBody *body, UndoSystem
 	if (body->GetType() == TYPE_STARPORT_SURFACE) {
 		ImGui::SeparatorText("Surface Parameters");
 
+		auto updateBodyOrbit = [=](){ UpdateDerived(body, DERIVED_Orbit); };
+
 		orbitChanged |= Draw::InputFixedDegrees("Latitude", &body->m_inclination);
 		if (Draw::UndoHelper("Edit Latitude", undo))
-			AddUndoSingleValueClosure(undo, &body->m_inclination, [=](){ body->SetOrbitFromParameters(); });
+			AddUndoSingleValueClosure(undo, &body->m_inclination, updateBodyOrbit);
 
 		orbitChanged |= Draw::InputFixedDegrees("Longitude", &body->m_orbitalOffset);
 		if (Draw::UndoHelper("Edit Longitude", undo))
-			AddUndoSingleValueClosure(undo, &body->m_orbitalOffset, [=](){ body->SetOrbitFromParameters(); });
+			AddUndoSingleValueClosure(undo, &body->m_orbitalOffset, updateBodyOrbit);
 
 		if (orbitChanged)
-			body->SetOrbitFromParameters();
+			UpdateDerived(body, DERIVED_Orbit);
 
 	} else {
 		EditOrbitalParameters(body, undo);
@@ -657,12 +659,19 @@ void SystemBody::EditorAPI::EditProperties(SystemBody *body, Random &rng, UndoSy
 {
 	bool isStar = body->GetSuperType() <= SUPERTYPE_STAR;
 
-	bool bodyChanged = false;
+	// derived state to update for the parameters edited this frame
+	uint32_t derived = 0;
+	auto updateBodyMass = [=]() {
+		UpdateDerived(body, GetParamDerived(PARAM_Mass));
+	};
 	auto updateBodyDerived = [=]() {
-		body->SetAtmFromParameters();
+		UpdateDerived(body, DERIVED_Atmosphere);
 	};
 
+	const BodyType prevType = body->GetType();
 	Draw::EditEnum("Edit Body Type", "Body Type", "BodyType", reinterpret_cast<int *>(&body->m_type), BodyType::TYPE_MAX, undo);
+	if (body->GetType() != prevType)
+		derived |= GetParamDerived(PARAM_Type);
 
 	ImGui::InputInt("Seed", reinterpret_cast<int *>(&body->m_seed));
 	if (Draw::UndoHelper("Edit Seed", undo))
@@ -672,18 +681,19 @@ void SystemBody::EditorAPI::EditProperties(SystemBody *body, Random &rng, UndoSy
 
 		if ((!isStar || body->GetType() == TYPE_BROWN_DWARF) && ImGui::Button(EICON_RANDOM " Body Stats")) {
 			GenerateDerivedStats(body, rng, undo);
-			bodyChanged = true;
 		}
 
 		ImGui::SetItemTooltip("Generate body type, radius, temperature, and surface parameters using the same method as procedural system generation.");
 
 		ImGui::SeparatorText("Body Parameters");
 
-		bodyChanged |= Draw::InputFixedMass("Mass", &body->m_mass, isStar);
+		if (Draw::InputFixedMass("Mass", &body->m_mass, isStar))
+			derived |= GetParamDerived(PARAM_Mass);
 		if (Draw::UndoHelper("Edit Mass", undo))
-			AddUndoSingleValueClosure(undo, &body->m_mass, updateBodyDerived);
+			AddUndoSingleValueClosure(undo, &body->m_mass, updateBodyMass);
 
-		bodyChanged |= Draw::InputFixedRadius("Radius",  &body->m_radius, isStar);
+		if (Draw::InputFixedRadius("Radius",  &body->m_radius, isStar))
+			derived |= GetParamDerived(PARAM_Radius);
 		if (Draw::UndoHelper("Edit Radius", undo))
 			AddUndoSingleValueClosure(undo, &body->m_radius, updateBodyDerived);
 
@@ -704,10 +714,15 @@ void SystemBody::EditorAPI::EditProperties(SystemBody *body, Random &rng, UndoSy
 
 		}
 
-		bodyChanged |= ImGui::InputInt("Temperature (K)", &body->m_averageTemp, 1, 10, "%d°K");
+		if (ImGui::InputInt("Temperature (K)", &body->m_averageTemp, 1, 10, "%d°K"))
+			derived |= GetParamDerived(PARAM_AverageTemp);
 		if (Draw::UndoHelper("Edit Temperature", undo))
 			AddUndoSingleValueClosure(undo, &body->m_averageTemp, updateBodyDerived);
 
+		// update before the orbits of this body and its children are shown
+		UpdateDerived(body, derived);
+		derived = 0;
+
 		ImGui::Spacing();
 
 		const bool hasDerived = (body->GetType() != TYPE_GRAVPOINT || body->HasChildren());
@@ -756,8 +771,8 @@ void SystemBody::EditorAPI::EditProperties(SystemBody *body, Random &rng, UndoSy
 
 	bool gasGiant = body->GetSuperType() == SystemBody::SUPERTYPE_GAS_GIANT;
 
-	bodyChanged |= Draw::InputFixedSlider("Atm. Density", &body->m_volatileGas,
-		0.0, gasGiant ? 2.0 : 1.225, "%.3f kg/m³", 0);
+	if (Draw::InputFixedSlider("Atm. Density", &body->m_volatileGas, 0.0, gasGiant ? 2.0 : 1.225, "%.3f kg/m³", 0))
+		UpdateDerived(body, GetParamDerived(PARAM_VolatileGas));
 	if (Draw::UndoHelper("Edit Atmosphere Density", undo))
 		AddUndoSingleValueClosure(undo, &body->m_volatileGas, updateBodyDerived);
 
@@ -803,9 +818,6 @@ void SystemBody::EditorAPI::EditProperties(SystemBody *body, Random &rng, UndoSy
 	if (Draw::DerivedValues("Surface Parameters")) {
 		ImGui::BeginDisabled();
 
-		if (bodyChanged)
-			body->SetAtmFromParameters();
-
 		double pressure_p0 = body->GetAtmSurfacePressure();
 		ImGui::InputDouble("Surface Pressure", &pressure_p0, 0.0, 0.0, "%.4f atm");
 
@@ -823,27 +835,85 @@ void SystemBody::EditorAPI::EditProperties(SystemBody *body, Random &rng, UndoSy
 
 void SystemBody::EditorAPI::GenerateDerivedStats(SystemBody *body, Random &rng, UndoSystem *undo)
 {
+	// Back up all potentially-modified body variables; only those which
+	// actually change are kept in the undo entry
+	const auto before = SystemEditorUndo::UndoBodyParameters::Capture(body);
+
+	StarSystemRandomGenerator().PickPlanetType(body, rng);
+
 	undo->BeginEntry("Generate Body Parameters");
+	auto *step = undo->AddUndoStep<SystemEditorUndo::UndoBodyParameters>(body, before);
+	undo->EndEntry();
 
-	// Back up all potentially-modified body variables
-	AddUndoSingleValue(undo, &body->m_mass);
-	AddUndoSingleValue(undo, &body->m_type);
-	AddUndoSingleValue(undo, &body->m_radius);
-	AddUndoSingleValue(undo, &body->m_averageTemp);
+	UpdateDerived(body, step->GetDerived());
+}
 
-	AddUndoSingleValue(undo, &body->m_axialTilt);
-	AddUndoSingleValue(undo, &body->m_rotationPeriod);
+void SystemBody::EditorAPI::UpdateDerived(SystemBody *body, uint32_t derivedFlags)
+{
+	if (derivedFlags & DERIVED_Orbit)
+		body->SetOrbitFromParameters();
 
-	AddUndoSingleValue(undo, &body->m_metallicity);
-	AddUndoSingleValue(undo, &body->m_volcanicity);
-	AddUndoSingleValue(undo, &body->m_volatileGas);
-	AddUndoSingleValue(undo, &body->m_atmosOxidizing);
-	AddUndoSingleValue(undo, &body->m_volatileLiquid);
-	AddUndoSingleValue(undo, &body->m_volatileIces);
-	// AddUndoSingleValue(undo, &body->m_humanActivity);
-	AddUndoSingleValue(undo, &body->m_life);
+	if (derivedFlags & DERIVED_Atmosphere)
+		body->SetAtmFromParameters();
 
-	StarSystemRandomGenerator().PickPlanetType(body, rng);
+	// Only the orbits of direct children depend on this body; bodies further
+	// down the tree orbit their own parents and keep their derived state
+	if (derivedFlags & DERIVED_Satellites)
+		for (SystemBody *child : body->m_children)
+			child->SetOrbitFromParameters();
+}
 
-	undo->EndEntry();
+int64_t SystemBody::EditorAPI::GetParam(const SystemBody *body, BodyParam param)
+{
+	switch (param) {
+	case PARAM_Type: return body->m_type;
+	case PARAM_Mass: return body->m_mass.v;
+	case PARAM_Radius: return body->m_radius.v;
+	case PARAM_AverageTemp: return body->m_averageTemp;
+	case PARAM_AxialTilt: return body->m_axialTilt.v;
+	case PARAM_RotationPeriod: return body->m_rotationPeriod.v;
+	case PARAM_Metallicity: return body->m_metallicity.v;
+	case PARAM_Volcanicity: return body->m_volcanicity.v;
+	case PARAM_VolatileGas: return body->m_volatileGas.v;
+	case PARAM_AtmosOxidizing: return body->m_atmosOxidizing.v;
+	case PARAM_VolatileLiquid: return body->m_volatileLiquid.v;
+	case PARAM_VolatileIces: return body->m_volatileIces.v;
+	case PARAM_Life: return body->m_life.v;
+	default: return 0;
+	}
+}
+
+void SystemBody::EditorAPI::SetParam(SystemBody *body, BodyParam param, int64_t value)
+{
+	switch (param) {
+	case PARAM_Type: body->m_type = BodyType(value); break;
+	case PARAM_Mass: body->m_mass.v = value; break;
+	case PARAM_Radius: body->m_radius.v = value; break;
+	case PARAM_AverageTemp: body->m_averageTemp = int(value); break;
+	case PARAM_AxialTilt: body->m_axialTilt.v = value; break;
+	case PARAM_RotationPeriod: body->m_rotationPeriod.v = value; break;
+	case PARAM_Metallicity: body->m_metallicity.v = value; break;
+	case PARAM_Volcanicity: body->m_volcanicity.v = value; break;
+	case PARAM_VolatileGas: body->m_volatileGas.v = value; break;
+	case PARAM_AtmosOxidizing: body->m_atmosOxidizing.v = value; break;
+	case PARAM_VolatileLiquid: body->m_volatileLiquid.v = value; break;
+	case PARAM_VolatileIces: body->m_volatileIces.v = value; break;
+	case PARAM_Life: body->m_life.v = value; break;
+	default: break;
+	}
+}
+
+uint32_t SystemBody::EditorAPI::GetParamDerived(BodyParam param)
+{
+	switch (param) {
+	// mass sets the surface gravity, the body's orbit around a barycentre and
+	// the orbits of its children
+	case PARAM_Mass: return DERIVED_Orbit | DERIVED_Atmosphere | DERIVED_Satellites;
+	// the body type sets the atmosphere's molar mass and specific heat
+	case PARAM_Type:
+	case PARAM_Radius:
+	case PARAM_AverageTemp:
+	case PARAM_VolatileGas: return DERIVED_Atmosphere;
+	default: return 0;
+	}
 }
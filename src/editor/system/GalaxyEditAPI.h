@@ -55,6 +55,31 @@ public:
 
 class SystemBody::EditorAPI {
 public:
+	// Derived state of a body which has to follow an edit to its parameters
+	enum DerivedFlags : uint32_t {
+		DERIVED_Orbit = 1 << 0,      // orbit shape, plane and apsides
+		DERIVED_Atmosphere = 1 << 1, // surface pressure and atmosphere height
+		DERIVED_Satellites = 1 << 2, // orbits of the body's children, which depend on its mass
+	};
+
+	// Generated body parameters, tracked together by UndoBodyParameters
+	enum BodyParam : uint8_t {
+		PARAM_Type,
+		PARAM_Mass,
+		PARAM_Radius,
+		PARAM_AverageTemp,
+		PARAM_AxialTilt,
+		PARAM_RotationPeriod,
+		PARAM_Metallicity,
+		PARAM_Volcanicity,
+		PARAM_VolatileGas,
+		PARAM_AtmosOxidizing,
+		PARAM_VolatileLiquid,
+		PARAM_VolatileIces,
+		PARAM_Life,
+		PARAM_MAX
+	};
+
 	static void GenerateDefaultName(SystemBody *body);
 	static void GenerateCustomName(SystemBody *body, Random &rng);
 
@@ -69,4 +94,14 @@ public:
 	static void EditProperties(SystemBody *body, Random &rng, Editor::UndoSystem *undo);
 
 	static void GenerateDerivedStats(SystemBody *body, Random &rng, Editor::UndoSystem *undo);
+
+	// Recompute only the given derived state of the body and the bodies
+	// depending on it, rather than refreshing the whole system after an edit
+	static void UpdateDerived(SystemBody *body, uint32_t derivedFlags);
+
+	// Parameter values as raw integers (fixed-point values as their raw representation)
+	static int64_t GetParam(const SystemBody *body, BodyParam param);
+	static void SetParam(SystemBody *body, BodyParam param, int64_t value);
+	// The derived state to update when the given parameter changes
+	static uint32_t GetParamDerived(BodyParam param);
 };
@@ -9,6 +9,9 @@
 #include "galaxy/StarSystem.h"
 #include "galaxy/SystemBody.h"
 
+#include <array>
+#include <vector>
+
 namespace Editor::SystemEditorUndo {
 
 	class ManageStarSystemBody : public UndoStep {
@@ -127,4 +130,57 @@ namespace Editor::SystemEditorUndo {
 		size_t m_idx;
 	};
 
+	// UndoStep for an operation which may change any of a body's generated
+	// parameters at once (e.g. regenerating its stats). Created after the
+	// change with the parameters captured before it, it keeps only those
+	// which differ instead of a copy of every parameter that might have.
+	class UndoBodyParameters : public UndoStep {
+	public:
+		using Params = std::array<int64_t, SystemBody::EditorAPI::PARAM_MAX>;
+
+		static Params Capture(const SystemBody *body)
+		{
+			Params params;
+			for (size_t idx = 0; idx < params.size(); idx++)
+				params[idx] = SystemBody::EditorAPI::GetParam(body, SystemBody::EditorAPI::BodyParam(idx));
+			return params;
+		}
+
+		UndoBodyParameters(SystemBody *body, const Params &before) :
+			m_body(body),
+			m_derived(0)
+		{
+			for (size_t idx = 0; idx < before.size(); idx++) {
+				auto param = SystemBody::EditorAPI::BodyParam(idx);
+				if (SystemBody::EditorAPI::GetParam(body, param) == before[idx])
+					continue;
+
+				m_delta.push_back({ param, before[idx] });
+				m_derived |= SystemBody::EditorAPI::GetParamDerived(param);
+			}
+
+			m_delta.shrink_to_fit();
+		}
+
+		void Swap() override {
+			for (auto &entry : m_delta) {
+				int64_t value = SystemBody::EditorAPI::GetParam(m_body, entry.first);
+				SystemBody::EditorAPI::SetParam(m_body, entry.first, entry.second);
+				entry.second = value;
+			}
+
+			SystemBody::EditorAPI::UpdateDerived(m_body, m_derived);
+		}
+
+		bool HasChanged() const override { return !m_delta.empty(); }
+
+		// derived state depending on the parameters which changed
+		uint32_t GetDerived() const { return m_derived; }
+
+	private:
+		SystemBody *m_body;
+		std::vector<std::pair<SystemBody::EditorAPI::BodyParam, int64_t>> m_delta;
+		uint32_t m_derived;
+	};
+
 } // namespace Editor
@@ -0,0 +1,273 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "BakedGalaxy.h"
+
+#include "core/Log.h"
+#include "gameconsts.h"
+#include "profiler/Profiler.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace {
+	static const char FILE_MAGIC[4] = { 'P', 'G', 'B', 'K' };
+	static const Uint32 FILE_VERSION = 1;
+	// written as is, so a file from a machine of the other byte order reads back swapped
+	static const Uint32 BYTE_ORDER_MARK = 0x01020304;
+
+	enum Column {
+		COL_SECTOR_FIRST, // Uint32 per sector, plus one
+		COL_POSITION,	  // three floats per system
+		COL_SEED,		  // Uint32
+		COL_POPULATION,	  // Sint64, the raw fixed point value
+		COL_FACTION,	  // Uint32
+		COL_NAME_OFFSET,  // Uint32 into COL_NAMES
+		COL_NUM_STARS,	  // Uint8
+		COL_STAR_TYPE,	  // four Uint8 per system
+		COL_FLAGS,		  // Uint8
+		COL_NAMES,		  // nul terminated strings
+		NUM_COLUMNS
+	};
+
+	struct FileHeader {
+		char magic[4];
+		Uint32 byteOrder;
+		Uint32 version;
+		Uint32 universeSeed;
+		char generatorName[32];
+		Sint32 generatorVersion;
+		Uint32 factionsFingerprint;
+		Sint32 min[3];
+		Uint32 size[3];
+		Uint32 numSystems;
+		Uint32 namesSize;
+		// from the start of the file, each aligned to its element size
+		Uint32 columnOffset[NUM_COLUMNS];
+	};
+
+	struct ColumnLayout {
+		size_t elementSize;
+		size_t perSystem;
+	};
+
+	static const ColumnLayout s_columns[NUM_COLUMNS] = {
+		{ sizeof(Uint32), 0 },
+		{ sizeof(float), 3 },
+		{ sizeof(Uint32), 1 },
+		{ sizeof(Sint64), 1 },
+		{ sizeof(Uint32), 1 },
+		{ sizeof(Uint32), 1 },
+		{ sizeof(Uint8), 1 },
+		{ sizeof(Uint8), 4 },
+		{ sizeof(Uint8), 1 },
+		{ sizeof(char), 0 },
+	};
+
+	static size_t column_count(int col, size_t numSectors, size_t numSystems, size_t namesSize)
+	{
+		if (col == COL_SECTOR_FIRST)
+			return numSectors + 1;
+		if (col == COL_NAMES)
+			return namesSize;
+		return s_columns[col].perSystem * numSystems;
+	}
+
+	template <typename T>
+	static void put(std::vector<char> &out, size_t offset, size_t index, const T &value)
+	{
+		std::memcpy(&out[offset + index * sizeof(T)], &value, sizeof(T));
+	}
+} // namespace
+
+BakedGalaxy::Builder::Builder(const std::string &generatorName, int generatorVersion, Uint32 factionsFingerprint,
+	int minX, int minY, int minZ, int sizeX, int sizeY, int sizeZ) :
+	m_generatorName(generatorName),
+	m_generatorVersion(generatorVersion),
+	m_factionsFingerprint(factionsFingerprint),
+	m_min{ minX, minY, minZ },
+	m_size{ sizeX, sizeY, sizeZ }
+{
+	assert(sizeX > 0 && sizeX <= MAX_BOX_SIZE);
+	assert(sizeY > 0 && sizeY <= MAX_BOX_SIZE);
+	assert(sizeZ > 0 && sizeZ <= MAX_BOX_SIZE);
+	assert(generatorName.size() < sizeof(FileHeader::generatorName));
+	m_sectorFirst.push_back(0);
+}
+
+void BakedGalaxy::Builder::AddSystem(const SystemData &sys)
+{
+	assert(sys.numStars <= 4);
+	m_systems.push_back(sys);
+}
+
+void BakedGalaxy::Builder::EndSector()
+{
+	m_sectorFirst.push_back(m_systems.size());
+}
+
+std::vector<char> BakedGalaxy::Builder::Finish() const
+{
+	const size_t numSectors = size_t(m_size[0]) * m_size[1] * m_size[2];
+	assert(m_sectorFirst.size() == numSectors + 1);
+
+	size_t namesSize = 0;
+	for (const SystemData &sys : m_systems)
+		namesSize += sys.name.size() + 1;
+
+	FileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+	header.byteOrder = BYTE_ORDER_MARK;
+	header.version = FILE_VERSION;
+	header.universeSeed = UNIVERSE_SEED;
+	std::strncpy(header.generatorName, m_generatorName.c_str(), sizeof(header.generatorName) - 1);
+	header.generatorVersion = m_generatorVersion;
+	header.factionsFingerprint = m_factionsFingerprint;
+	for (int i = 0; i < 3; i++) {
+		header.min[i] = m_min[i];
+		header.size[i] = m_size[i];
+	}
+	header.numSystems = m_systems.size();
+	header.namesSize = namesSize;
+
+	size_t offset = sizeof(FileHeader);
+	for (int col = 0; col < NUM_COLUMNS; col++) {
+		const size_t align = s_columns[col].elementSize;
+		offset = (offset + align - 1) / align * align;
+		header.columnOffset[col] = offset;
+		offset += column_count(col, numSectors, m_systems.size(), namesSize) * s_columns[col].elementSize;
+	}
+
+	std::vector<char> out(offset, 0);
+	std::memcpy(out.data(), &header, sizeof(header));
+
+	for (size_t i = 0; i < m_sectorFirst.size(); i++)
+		put(out, header.columnOffset[COL_SECTOR_FIRST], i, Uint32(m_sectorFirst[i]));
+
+	Uint32 nameOffset = 0;
+	for (size_t i = 0; i < m_systems.size(); i++) {
+		const SystemData &sys = m_systems[i];
+		put(out, header.columnOffset[COL_POSITION], 3 * i, sys.pos.x);
+		put(out, header.columnOffset[COL_POSITION], 3 * i + 1, sys.pos.y);
+		put(out, header.columnOffset[COL_POSITION], 3 * i + 2, sys.pos.z);
+		put(out, header.columnOffset[COL_SEED], i, sys.seed);
+		put(out, header.columnOffset[COL_POPULATION], i, sys.population.v);
+		put(out, header.columnOffset[COL_FACTION], i, sys.factionIdx);
+		put(out, header.columnOffset[COL_NAME_OFFSET], i, nameOffset);
+		put(out, header.columnOffset[COL_NUM_STARS], i, Uint8(sys.numStars));
+		for (unsigned star = 0; star < 4; star++)
+			put(out, header.columnOffset[COL_STAR_TYPE], 4 * i + star, Uint8(star < sys.numStars ? sys.starType[star] : 0));
+		put(out, header.columnOffset[COL_FLAGS], i, Uint8((sys.isCustom ? FLAG_CUSTOM : 0) | (sys.explored ? FLAG_EXPLORED : 0)));
+
+		std::memcpy(&out[header.columnOffset[COL_NAMES] + nameOffset], sys.name.c_str(), sys.name.size() + 1);
+		nameOffset += sys.name.size() + 1;
+	}
+
+	return out;
+}
+
+//static
+std::unique_ptr<BakedGalaxy> BakedGalaxy::Load(const std::string &path, const std::string &generatorName,
+	int generatorVersion, Uint32 factionsFingerprint)
+{
+	PROFILE_SCOPED()
+	RefCountedPtr<FileSystem::FileData> file = FileSystem::gameDataFiles.MapFile(path);
+	if (!file)
+		return nullptr;
+
+	std::unique_ptr<BakedGalaxy> baked(new BakedGalaxy);
+	baked->m_file = file;
+	if (!baked->Parse(file->GetData(), file->GetSize(), generatorName, generatorVersion, factionsFingerprint)) {
+		Output("Galaxy: not using baked sectors in '%s', they don't match this galaxy\n", path.c_str());
+		return nullptr;
+	}
+
+	Output("Galaxy: %u baked systems in %d x %d x %d sectors from '%s'\n", baked->m_numSystems,
+		baked->m_size[0], baked->m_size[1], baked->m_size[2], path.c_str());
+	return baked;
+}
+
+//static
+std::unique_ptr<BakedGalaxy> BakedGalaxy::FromBuffer(std::vector<char> buffer, const std::string &generatorName,
+	int generatorVersion, Uint32 factionsFingerprint)
+{
+	std::unique_ptr<BakedGalaxy> baked(new BakedGalaxy);
+	baked->m_buffer = std::move(buffer);
+	if (!baked->Parse(baked->m_buffer.data(), baked->m_buffer.size(), generatorName, generatorVersion, factionsFingerprint))
+		return nullptr;
+	return baked;
+}
+
+bool BakedGalaxy::Parse(const char *data, size_t size, const std::string &generatorName, int generatorVersion, Uint32 factionsFingerprint)
+{
+	FileHeader header;
+	if (size < sizeof(header))
+		return false;
+	std::memcpy(&header, data, sizeof(header));
+
+	if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.byteOrder != BYTE_ORDER_MARK || header.version != FILE_VERSION)
+		return false;
+
+	header.generatorName[sizeof(header.generatorName) - 1] = '\0';
+	if (header.universeSeed != UNIVERSE_SEED || generatorName != header.generatorName ||
+		header.generatorVersion != generatorVersion || header.factionsFingerprint != factionsFingerprint)
+		return false;
+
+	for (int i = 0; i < 3; i++) {
+		if (header.size[i] == 0 || header.size[i] > Uint32(MAX_BOX_SIZE))
+			return false;
+		m_min[i] = header.min[i];
+		m_size[i] = header.size[i];
+	}
+
+	const size_t numSectors = size_t(m_size[0]) * m_size[1] * m_size[2];
+	for (int col = 0; col < NUM_COLUMNS; col++) {
+		const size_t offset = header.columnOffset[col];
+		const size_t bytes = column_count(col, numSectors, header.numSystems, header.namesSize) * s_columns[col].elementSize;
+		if (offset % s_columns[col].elementSize != 0 || offset > size || bytes > size - offset)
+			return false;
+	}
+
+	m_numSystems = header.numSystems;
+	m_sectorFirst = reinterpret_cast<const Uint32 *>(data + header.columnOffset[COL_SECTOR_FIRST]);
+	m_pos = reinterpret_cast<const float *>(data + header.columnOffset[COL_POSITION]);
+	m_seed = reinterpret_cast<const Uint32 *>(data + header.columnOffset[COL_SEED]);
+	m_population = reinterpret_cast<const Sint64 *>(data + header.columnOffset[COL_POPULATION]);
+	m_faction = reinterpret_cast<const Uint32 *>(data + header.columnOffset[COL_FACTION]);
+	m_nameOffset = reinterpret_cast<const Uint32 *>(data + header.columnOffset[COL_NAME_OFFSET]);
+	m_numStars = reinterpret_cast<const Uint8 *>(data + header.columnOffset[COL_NUM_STARS]);
+	m_starType = reinterpret_cast<const Uint8 *>(data + header.columnOffset[COL_STAR_TYPE]);
+	m_flags = reinterpret_cast<const Uint8 *>(data + header.columnOffset[COL_FLAGS]);
+	m_names = data + header.columnOffset[COL_NAMES];
+
+	// everything read later indexes through these, so check them once here
+	if (m_sectorFirst[0] != 0 || m_sectorFirst[numSectors] != m_numSystems)
+		return false;
+	for (size_t i = 0; i < numSectors; i++) {
+		if (m_sectorFirst[i] > m_sectorFirst[i + 1])
+			return false;
+	}
+	if (header.namesSize == 0 ? m_numSystems != 0 : m_names[header.namesSize - 1] != '\0')
+		return false;
+	for (Uint32 i = 0; i < m_numSystems; i++) {
+		if (m_nameOffset[i] >= header.namesSize || m_numStars[i] > 4)
+			return false;
+	}
+
+	return true;
+}
+
+bool BakedGalaxy::FindSector(int sx, int sy, int sz, Uint32 &first, Uint32 &count) const
+{
+	const int x = sx - m_min[0];
+	const int y = sy - m_min[1];
+	const int z = sz - m_min[2];
+	if (x < 0 || x >= m_size[0] || y < 0 || y >= m_size[1] || z < 0 || z >= m_size[2])
+		return false;
+
+	const size_t sector = (size_t(x) * m_size[1] + y) * m_size[2] + z;
+	first = m_sectorFirst[sector];
+	count = m_sectorFirst[sector + 1] - first;
+	return true;
+}
@@ -0,0 +1,116 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _BAKEDGALAXY_H
+#define _BAKEDGALAXY_H
+
+#include "FileSystem.h"
+#include "RefCounted.h"
+#include "fixed.h"
+#include "galaxy/StarSystem.h"
+#include "vector3.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * A box of sectors generated ahead of time (pioneer -galaxybake) and stored
+ * column by column, so that the sector generator can fill a sector from a
+ * handful of array lookups into a mapped file instead of running the random
+ * generator, and the sector map gets populations without generating systems.
+ *
+ * A file is only used by the generator name and version, universe seed and
+ * set of factions it was baked with; sectors outside the box, or whose custom
+ * systems no longer match, are generated as usual.
+ */
+class BakedGalaxy {
+public:
+	// sectors along each side of the box, at most
+	static const int MAX_BOX_SIZE = 4096;
+
+	struct SystemData {
+		std::string name;
+		vector3f pos;
+		unsigned numStars = 0;
+		SystemBody::BodyType starType[4] = {};
+		Uint32 seed = 0;
+		bool isCustom = false;
+		bool explored = false;
+		fixed population;
+		Uint32 factionIdx = 0;
+	};
+
+	// collects the systems of a box of sectors, sector by sector with the
+	// z coordinate varying fastest, then y, then x
+	class Builder {
+	public:
+		Builder(const std::string &generatorName, int generatorVersion, Uint32 factionsFingerprint,
+			int minX, int minY, int minZ, int sizeX, int sizeY, int sizeZ);
+
+		void AddSystem(const SystemData &sys);
+		void EndSector();
+
+		// the file contents, once every sector in the box has been added
+		std::vector<char> Finish() const;
+
+	private:
+		std::string m_generatorName;
+		int m_generatorVersion;
+		Uint32 m_factionsFingerprint;
+		int m_min[3];
+		int m_size[3];
+		std::vector<SystemData> m_systems;
+		std::vector<Uint32> m_sectorFirst;
+	};
+
+	// nullptr if there is no file, or it doesn't match the galaxy
+	static std::unique_ptr<BakedGalaxy> Load(const std::string &path, const std::string &generatorName,
+		int generatorVersion, Uint32 factionsFingerprint);
+	static std::unique_ptr<BakedGalaxy> FromBuffer(std::vector<char> buffer, const std::string &generatorName,
+		int generatorVersion, Uint32 factionsFingerprint);
+
+	// the systems of a sector are first .. first + count - 1, custom systems first
+	bool FindSector(int sx, int sy, int sz, Uint32 &first, Uint32 &count) const;
+	Uint32 GetNumSystems() const { return m_numSystems; }
+
+	const char *GetName(Uint32 i) const { return m_names + m_nameOffset[i]; }
+	vector3f GetPosition(Uint32 i) const { return vector3f(m_pos[3 * i], m_pos[3 * i + 1], m_pos[3 * i + 2]); }
+	unsigned GetNumStars(Uint32 i) const { return m_numStars[i]; }
+	SystemBody::BodyType GetStarType(Uint32 i, unsigned star) const { return SystemBody::BodyType(m_starType[4 * i + star]); }
+	Uint32 GetSeed(Uint32 i) const { return m_seed[i]; }
+	bool IsCustom(Uint32 i) const { return m_flags[i] & FLAG_CUSTOM; }
+	bool IsExplored(Uint32 i) const { return m_flags[i] & FLAG_EXPLORED; }
+	fixed GetPopulation(Uint32 i) const { return fixed(m_population[i]); }
+	Uint32 GetFactionIndex(Uint32 i) const { return m_faction[i]; }
+
+private:
+	enum SystemFlags : Uint8 {
+		FLAG_CUSTOM = 1,
+		FLAG_EXPLORED = 2
+	};
+
+	BakedGalaxy() = default;
+	bool Parse(const char *data, size_t size, const std::string &generatorName, int generatorVersion, Uint32 factionsFingerprint);
+
+	// one of these holds the bytes
+	RefCountedPtr<FileSystem::FileData> m_file;
+	std::vector<char> m_buffer;
+
+	int m_min[3];
+	int m_size[3];
+	Uint32 m_numSystems;
+
+	const Uint32 *m_sectorFirst;
+	const float *m_pos;
+	const Uint32 *m_seed;
+	const Sint64 *m_population;
+	const Uint32 *m_faction;
+	const Uint32 *m_nameOffset;
+	const Uint8 *m_numStars;
+	const Uint8 *m_starType;
+	const Uint8 *m_flags;
+	const char *m_names;
+};
+
+#endif /* _BAKEDGALAXY_H */
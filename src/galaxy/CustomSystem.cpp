@@ -16,6 +16,7 @@
 #include "Factions.h"
 #include "FileSystem.h"
 #include "Polit.h"
+#include "galaxy/GalaxyGenerator.h"
 #include "galaxy/StarSystemGenerator.h"
 #include "galaxy/SystemBody.h"
 #include "lua/LuaConstants.h"
@@ -772,37 +773,41 @@ void CustomSystemsDatabase::Load()
 
 	LoadAllLuaSystems();
 
-	// Load Json array files containing random-fill system definitions
+	// Gather the Json files up front so they can be parsed in parallel;
+	// systems are still added in the same order as before.
+	std::vector<std::string> paths;
+	auto addPaths = [&](FileSystem::FileEnumerator files) {
+		size_t first = paths.size();
+		for (auto &file : files) {
+			if (ends_with_ci(file.GetPath(), ".json"))
+				paths.push_back(file.GetPath());
+		}
+		return paths.size() - first;
+	};
+
+	// Json array files containing random-fill system definitions
 	std::string partialPath = FileSystem::JoinPathBelow(m_customSysDirectory, "partial");
-	for (auto &file : FileSystem::gameDataFiles.Recurse(partialPath)) {
-		if (!ends_with_ci(file.GetPath(), ".json"))
-			continue;
+	const size_t numPartial = addPaths(FileSystem::gameDataFiles.Recurse(partialPath));
 
+	// top-level custom system defines, then all complete custom system definitions
+	std::string customPath = FileSystem::JoinPathBelow(m_customSysDirectory, "custom");
+	addPaths(FileSystem::gameDataFiles.Enumerate(m_customSysDirectory, 0));
+	addPaths(FileSystem::gameDataFiles.Recurse(customPath));
+
+	std::vector<Json> fileData = JsonUtils::LoadJsonDataFiles(paths, GalaxyGenerator::GetTaskGraph());
+
+	for (size_t i = 0; i < numPartial; i++) {
 		PROFILE_SCOPED_DESC("Load Partial System List")
-		const Json fileData = JsonUtils::LoadJsonDataFile(file.GetPath());
-		for (const Json &sysdef : fileData) {
+		for (const Json &sysdef : fileData[i]) {
 			if (!sysdef.is_object())
 				continue;
 
-			LoadSystemFromJSON(file.GetPath(), sysdef);
+			LoadSystemFromJSON(paths[i], sysdef);
 		}
 	}
 
-	// Load top-level custom system defines
-	for (auto &file : FileSystem::gameDataFiles.Enumerate(m_customSysDirectory, 0)) {
-		if (!ends_with_ci(file.GetPath(), ".json"))
-			continue;
-
-		LoadSystemFromJSON(file.GetPath(), JsonUtils::LoadJsonDataFile(file.GetPath()));
-	}
-
-	// Load all complete custom system definitions
-	std::string customPath = FileSystem::JoinPathBelow(m_customSysDirectory, "custom");
-	for (auto &file : FileSystem::gameDataFiles.Recurse(customPath)) {
-		if (!ends_with_ci(file.GetPath(), ".json"))
-			continue;
-
-		LoadSystemFromJSON(file.GetPath(), JsonUtils::LoadJsonDataFile(file.GetPath()));
+	for (size_t i = numPartial; i < paths.size(); i++) {
+		LoadSystemFromJSON(paths[i], fileData[i]);
 	}
 }
 
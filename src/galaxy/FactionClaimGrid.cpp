@@ -0,0 +1,191 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "FactionClaimGrid.h"
+
+#include "MathUtil.h"
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace {
+	// slack on faction radii, so float rounding in the distance checks
+	// never leaves a system's owner out of its cell
+	static const float RADIUS_MARGIN = 1.0f;
+
+	static int floor_div(int a, int b)
+	{
+		return a >= 0 ? a / b : -((-a + b - 1) / b);
+	}
+
+	struct SectorBox {
+		int min[3] = { INT_MAX, INT_MAX, INT_MAX };
+		int max[3] = { INT_MIN, INT_MIN, INT_MIN };
+
+		void Add(int sx, int sy, int sz)
+		{
+			const int s[3] = { sx, sy, sz };
+			for (int i = 0; i < 3; i++) {
+				min[i] = std::min(min[i], s[i]);
+				max[i] = std::max(max[i], s[i]);
+			}
+		}
+		void Add(const SectorBox &box)
+		{
+			Add(box.min[0], box.min[1], box.min[2]);
+			Add(box.max[0], box.max[1], box.max[2]);
+		}
+		bool IsEmpty() const { return min[0] > max[0]; }
+	};
+} // namespace
+
+FactionClaimGrid::FactionClaimGrid(float sectorSize) :
+	m_sectorSize(sectorSize),
+	m_cellSectors(1),
+	m_minSector{ 0, 0, 0 },
+	m_numCells{ 0, 0, 0 }
+{
+}
+
+void FactionClaimGrid::Clear()
+{
+	m_cellSectors = 1;
+	for (int i = 0; i < 3; i++) {
+		m_minSector[i] = 0;
+		m_numCells[i] = 0;
+	}
+	m_cellStart.clear();
+	m_candidates.clear();
+	m_unbounded.clear();
+}
+
+void FactionClaimGrid::Build(const std::vector<Territory> &territories)
+{
+	PROFILE_SCOPED()
+	Clear();
+
+	// the sectors each bounded faction's sphere might reach, and the bounds of everything
+	std::vector<SectorBox> spheres(territories.size());
+	SectorBox bounds;
+	for (size_t t = 0; t < territories.size(); t++) {
+		const Territory &ter = territories[t];
+		if (!ter.bounded) {
+			m_unbounded.push_back(ter.id);
+			continue;
+		}
+
+		const float r = std::max(ter.radius, 0.0f) + RADIUS_MARGIN;
+		SectorBox &box = spheres[t];
+		box.Add(int(std::floor((ter.homePos.x - r) / m_sectorSize)),
+			int(std::floor((ter.homePos.y - r) / m_sectorSize)),
+			int(std::floor((ter.homePos.z - r) / m_sectorSize)));
+		box.Add(int(std::floor((ter.homePos.x + r) / m_sectorSize)),
+			int(std::floor((ter.homePos.y + r) / m_sectorSize)),
+			int(std::floor((ter.homePos.z + r) / m_sectorSize)));
+		box.Add(ter.homeSector.sectorX, ter.homeSector.sectorY, ter.homeSector.sectorZ);
+		bounds.Add(box);
+		for (const SystemPath &claim : ter.claims)
+			bounds.Add(claim.sectorX, claim.sectorY, claim.sectorZ);
+	}
+
+	if (bounds.IsEmpty())
+		return;
+
+	auto cellsAlong = [&](int axis) {
+		return (bounds.max[axis] - bounds.min[axis]) / m_cellSectors + 1;
+	};
+	while (cellsAlong(0) > MAX_CELLS || cellsAlong(1) > MAX_CELLS || cellsAlong(2) > MAX_CELLS)
+		m_cellSectors *= 2;
+	for (int i = 0; i < 3; i++) {
+		m_minSector[i] = bounds.min[i];
+		m_numCells[i] = cellsAlong(i);
+	}
+	const size_t numCells = size_t(m_numCells[0]) * m_numCells[1] * m_numCells[2];
+
+	// calls fn once for each cell the territory touches
+	std::vector<Uint32> lastVisit(numCells, Uint32(-1));
+	auto forEachCell = [&](Uint32 t, auto &&fn) {
+		const Territory &ter = territories[t];
+		if (!ter.bounded) {
+			for (size_t cell = 0; cell < numCells; cell++)
+				fn(cell);
+			return;
+		}
+
+		auto visit = [&](size_t cell) {
+			if (lastVisit[cell] != t) {
+				lastVisit[cell] = t;
+				fn(cell);
+			}
+		};
+
+		const float r = std::max(ter.radius, 0.0f) + RADIUS_MARGIN;
+		const float cellSize = m_sectorSize * m_cellSectors;
+		const SectorBox &box = spheres[t];
+		int cmin[3], cmax[3];
+		for (int i = 0; i < 3; i++) {
+			cmin[i] = (box.min[i] - m_minSector[i]) / m_cellSectors;
+			cmax[i] = (box.max[i] - m_minSector[i]) / m_cellSectors;
+		}
+		for (int cx = cmin[0]; cx <= cmax[0]; cx++) {
+			for (int cy = cmin[1]; cy <= cmax[1]; cy++) {
+				for (int cz = cmin[2]; cz <= cmax[2]; cz++) {
+					const vector3f lo = m_sectorSize * vector3f(float(m_minSector[0]), float(m_minSector[1]), float(m_minSector[2])) +
+						cellSize * vector3f(float(cx), float(cy), float(cz));
+					const vector3f nearest(
+						Clamp(ter.homePos.x, lo.x, lo.x + cellSize),
+						Clamp(ter.homePos.y, lo.y, lo.y + cellSize),
+						Clamp(ter.homePos.z, lo.z, lo.z + cellSize));
+					if ((nearest - ter.homePos).LengthSqr() <= r * r)
+						visit((size_t(cx) * m_numCells[1] + cy) * m_numCells[2] + cz);
+				}
+			}
+		}
+
+		visit(CellIndex(ter.homeSector.sectorX, ter.homeSector.sectorY, ter.homeSector.sectorZ));
+		for (const SystemPath &claim : ter.claims)
+			visit(CellIndex(claim.sectorX, claim.sectorY, claim.sectorZ));
+	};
+
+	// count, then fill, each cell in territory order
+	std::vector<Uint32> count(numCells, 0);
+	for (Uint32 t = 0; t < territories.size(); t++)
+		forEachCell(t, [&](size_t cell) { count[cell]++; });
+
+	m_cellStart.resize(numCells + 1);
+	m_cellStart[0] = 0;
+	for (size_t cell = 0; cell < numCells; cell++)
+		m_cellStart[cell + 1] = m_cellStart[cell] + count[cell];
+
+	m_candidates.resize(m_cellStart[numCells]);
+	std::fill(lastVisit.begin(), lastVisit.end(), Uint32(-1));
+	std::fill(count.begin(), count.end(), 0);
+	for (Uint32 t = 0; t < territories.size(); t++)
+		forEachCell(t, [&](size_t cell) { m_candidates[m_cellStart[cell] + count[cell]++] = territories[t].id; });
+}
+
+int FactionClaimGrid::CellIndex(int sx, int sy, int sz) const
+{
+	const int s[3] = { sx, sy, sz };
+	int c[3];
+	for (int i = 0; i < 3; i++) {
+		c[i] = floor_div(s[i] - m_minSector[i], m_cellSectors);
+		if (c[i] < 0 || c[i] >= m_numCells[i])
+			return -1;
+	}
+	return (c[0] * m_numCells[1] + c[1]) * m_numCells[2] + c[2];
+}
+
+void FactionClaimGrid::GetCandidates(int sx, int sy, int sz, const Uint32 *&first, const Uint32 *&last) const
+{
+	const int cell = m_cellStart.empty() ? -1 : CellIndex(sx, sy, sz);
+	if (cell < 0) {
+		first = m_unbounded.data();
+		last = first + m_unbounded.size();
+	} else {
+		first = m_candidates.data() + m_cellStart[cell];
+		last = m_candidates.data() + m_cellStart[cell + 1];
+	}
+}
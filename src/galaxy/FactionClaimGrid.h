@@ -0,0 +1,66 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _FACTIONCLAIMGRID_H
+#define _FACTIONCLAIMGRID_H
+
+#include "galaxy/SystemPath.h"
+#include "vector3.h"
+
+#include <vector>
+
+/*
+ * The factions that might own a system, by sector.
+ *
+ * A faction owns the systems within its radius of its homeworld, the sector
+ * of its homeworld, and any sectors or systems it explicitly claims; a
+ * faction without a known homeworld might own anything. This is a grid over
+ * the sectors covered by all of those, with the list of factions whose
+ * territory touches each cell, so the candidates for a system are a single
+ * cell lookup. Systems outside the grid can only belong to the unbounded
+ * factions.
+ *
+ * Candidates come back in the order the factions were added, which the
+ * nearest claimant search relies on to break ties.
+ */
+class FactionClaimGrid {
+public:
+	struct Territory {
+		Uint32 id;
+		// false if the faction has no homeworld to measure from
+		bool bounded = false;
+		SystemPath homeSector;
+		vector3f homePos; // light years from the galactic origin
+		float radius = 0.0f;
+		std::vector<SystemPath> claims;
+	};
+
+	// sectorSize is the side of a sector, in light years
+	explicit FactionClaimGrid(float sectorSize);
+
+	void Build(const std::vector<Territory> &territories);
+	void Clear();
+
+	// ids of the factions that might own systems in the sector, [first, last)
+	void GetCandidates(int sx, int sy, int sz, const Uint32 *&first, const Uint32 *&last) const;
+
+	// sectors along each side of a cell
+	int GetCellSectors() const { return m_cellSectors; }
+	size_t GetNumCells() const { return m_cellStart.empty() ? 0 : m_cellStart.size() - 1; }
+
+private:
+	// cells along each side of the grid, at most
+	static const int MAX_CELLS = 64;
+
+	int CellIndex(int sx, int sy, int sz) const;
+
+	float m_sectorSize;
+	int m_cellSectors;
+	int m_minSector[3];
+	int m_numCells[3];
+	std::vector<Uint32> m_cellStart; // per cell, plus one
+	std::vector<Uint32> m_candidates;
+	std::vector<Uint32> m_unbounded;
+};
+
+#endif /* _FACTIONCLAIMGRID_H */
@@ -0,0 +1,104 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _FACTIONMASK_H
+#define _FACTIONMASK_H
+
+#include <SDL_stdinc.h>
+#include <algorithm>
+#include <vector>
+
+/*
+ * A set of factions, as a bit per faction index.
+ *
+ * The "no faction" has an index of Faction::BAD_FACTION_IDX, and gets the
+ * first bit; every other faction's bit follows on from that. The mask grows
+ * to fit the highest faction set in it, so an empty mask costs nothing.
+ */
+class FactionMask {
+public:
+	void Set(Uint32 factionIdx)
+	{
+		const Uint32 bit = ToBit(factionIdx);
+		if (bit / 64 >= m_words.size())
+			m_words.resize(bit / 64 + 1, 0);
+		m_words[bit / 64] |= Uint64(1) << (bit % 64);
+	}
+
+	void Reset(Uint32 factionIdx)
+	{
+		const Uint32 bit = ToBit(factionIdx);
+		if (bit / 64 < m_words.size())
+			m_words[bit / 64] &= ~(Uint64(1) << (bit % 64));
+	}
+
+	bool Test(Uint32 factionIdx) const
+	{
+		const Uint32 bit = ToBit(factionIdx);
+		return bit / 64 < m_words.size() && (m_words[bit / 64] >> (bit % 64)) & 1;
+	}
+
+	bool Intersects(const FactionMask &other) const
+	{
+		const size_t num = std::min(m_words.size(), other.m_words.size());
+		for (size_t i = 0; i < num; i++)
+			if (m_words[i] & other.m_words[i])
+				return true;
+		return false;
+	}
+
+	bool IsEmpty() const
+	{
+		for (Uint64 word : m_words)
+			if (word)
+				return false;
+		return true;
+	}
+
+	void Clear() { m_words.clear(); }
+
+	FactionMask &operator|=(const FactionMask &other)
+	{
+		if (other.m_words.size() > m_words.size())
+			m_words.resize(other.m_words.size(), 0);
+		for (size_t i = 0; i < other.m_words.size(); i++)
+			m_words[i] |= other.m_words[i];
+		return *this;
+	}
+
+	bool operator==(const FactionMask &other) const
+	{
+		const size_t num = std::max(m_words.size(), other.m_words.size());
+		for (size_t i = 0; i < num; i++) {
+			const Uint64 a = i < m_words.size() ? m_words[i] : 0;
+			const Uint64 b = i < other.m_words.size() ? other.m_words[i] : 0;
+			if (a != b)
+				return false;
+		}
+		return true;
+	}
+	bool operator!=(const FactionMask &other) const { return !(*this == other); }
+
+	// calls fn(factionIdx) for each faction in the mask, the no faction first
+	template <typename Fn>
+	void ForEach(Fn fn) const
+	{
+		for (size_t i = 0; i < m_words.size(); i++) {
+			for (Uint64 word = m_words[i]; word; word &= word - 1) {
+				Uint32 bit = 0;
+				while (!((word >> bit) & 1))
+					bit++;
+				fn(ToFactionIdx(Uint32(i * 64 + bit)));
+			}
+		}
+	}
+
+private:
+	// the no faction's index wraps around to the first bit
+	static Uint32 ToBit(Uint32 factionIdx) { return factionIdx + 1; }
+	static Uint32 ToFactionIdx(Uint32 bit) { return bit - 1; }
+
+	std::vector<Uint64> m_words;
+};
+
+#endif /* _FACTIONMASK_H */
@@ -517,9 +517,33 @@ void FactionsDatabase::SetHomeSectors()
 	for (auto it = m_factions.begin(); it != m_factions.end(); ++it)
 		if ((*it)->hasHomeworld)
 			(*it)->m_homesector = m_galaxy->GetSector((*it)->homeworld);
+	BuildClaimGrid();
 	m_may_assign_factions = true;
 }
 
+void FactionsDatabase::BuildClaimGrid()
+{
+	PROFILE_SCOPED()
+	// custom systems are all in by now, so every homeworld can be placed
+	std::vector<FactionClaimGrid::Territory> territories(m_factions.size());
+	for (size_t i = 0; i < m_factions.size(); i++) {
+		const Faction *faction = m_factions[i];
+		FactionClaimGrid::Territory &ter = territories[i];
+		ter.id = i;
+
+		RefCountedPtr<const Sector> sec = faction->hasHomeworld ? faction->GetHomeSector() : RefCountedPtr<const Sector>();
+		if (sec && faction->homeworld.systemIndex < sec->m_systems.size()) {
+			ter.bounded = true;
+			ter.homeSector = faction->homeworld.SectorOnly();
+			ter.homePos = sec->m_systems[faction->homeworld.systemIndex].GetFullPosition();
+			ter.radius = faction->Radius();
+			ter.claims = faction->m_ownedsystemlist;
+		}
+	}
+	m_claim_grid.Build(territories);
+	Log::Verbose("Faction claim grid: {} cells of {} sectors", m_claim_grid.GetNumCells(), m_claim_grid.GetCellSectors());
+}
+
 bool FactionsDatabase::IsInitialized() const
 {
 	return m_initialized;
@@ -543,7 +567,6 @@ void FactionsDatabase::AddFaction(Faction *faction)
 		}
 		m_missingFactionsMap.erase(it);
 	}
-	m_spatial_index.Add(faction);
 
 	if (faction->hasHomeworld) m_homesystems.insert(faction->homeworld.SystemOnly());
 	faction->idx = m_factions.size() - 1;
@@ -552,6 +575,8 @@ void FactionsDatabase::AddFaction(Faction *faction)
 const Faction *FactionsDatabase::GetFaction(const Uint32 index) const
 {
 	PROFILE_SCOPED()
+	if (index == Faction::BAD_FACTION_IDX)
+		return &m_no_faction;
 	assert(index < m_factions.size());
 	return m_factions[index];
 }
@@ -590,13 +615,15 @@ const Faction *FactionsDatabase::GetNearestClaimant(const Sector::System *sys) c
 	// if it didn't, or it wasn't a custom StarStystem, then we go ahead and assign it a faction allegiance like normal below...
 	const Faction *result = &m_no_faction;
 	double closestFactionDist = HUGE_VAL;
-	ConstFactionList &candidates = m_spatial_index.CandidateFactions(sys);
-
-	for (ConstFactionIterator it = candidates.begin(); it != candidates.end(); ++it) {
-		if ((*it)->IsClaimed(sys->GetPath()))
-			return *it; // this is a very specific claim, no further checks for distance from another factions homeworld is needed.
-		if ((*it)->IsCloserAndContains(closestFactionDist, sys))
-			result = *it;
+	const Uint32 *first, *last;
+	m_claim_grid.GetCandidates(sys->sx, sys->sy, sys->sz, first, last);
+
+	for (const Uint32 *it = first; it != last; ++it) {
+		const Faction *faction = m_factions[*it];
+		if (faction->IsClaimed(sys->GetPath()))
+			return faction; // this is a very specific claim, no further checks for distance from another factions homeworld is needed.
+		if (faction->IsCloserAndContains(closestFactionDist, sys))
+			result = faction;
 	}
 	return result;
 }
@@ -792,94 +819,3 @@ Faction::Faction(Galaxy *galaxy) :
 	govtype_weights_total = 0;
 }
 
-// ------ Factions Spatial Indexing ------
-
-void FactionsDatabase::Octsapling::Add(const Faction *faction)
-{
-	/*  The general principle here is to put the faction in every octbox cell that a system
-	    that is a member of that faction could be in. This should let us cut the number
-		of factions that have to be checked by GetNearestFaction, by eliminating right off
-		all the those Factions that aren't in the same cell.
-
-		As I'm just going for the quick performance win, I'm being very sloppy and
-		treating a Faction as if it was a cube rather than a sphere. I'm also not even
-		attempting to work out real faction boundaries for this.
-
-		Obviously this all could be improved even without this Octsapling growing into
-		a full Octree.
-
-		This part happens at faction generation time so shouldn't be too performance
-		critical
-	*/
-	RefCountedPtr<const Sector> sec = faction->GetHomeSector();
-
-	/* only factions with homeworlds that are available at faction generation time can
-	   be added to specific cells...
-	*/
-	if (faction->hasHomeworld && (faction->homeworld.systemIndex < sec->m_systems.size())) {
-		/* calculate potential indexes for the octbox cells the faction needs to go into
-		*/
-		Sector::System sys = sec->m_systems[faction->homeworld.systemIndex];
-
-		int xmin = BoxIndex(Sint32(sys.GetFullPosition().x - float((faction->Radius()))));
-		int xmax = BoxIndex(Sint32(sys.GetFullPosition().x + float((faction->Radius()))));
-		int ymin = BoxIndex(Sint32(sys.GetFullPosition().y - float((faction->Radius()))));
-		int ymax = BoxIndex(Sint32(sys.GetFullPosition().y + float((faction->Radius()))));
-		int zmin = BoxIndex(Sint32(sys.GetFullPosition().z - float((faction->Radius()))));
-		int zmax = BoxIndex(Sint32(sys.GetFullPosition().z + float((faction->Radius()))));
-
-		/* put the faction in all the octbox cells needed in a hideously inexact way that
-		   will generate duplicates in each cell in many cases
-		*/
-		octbox[xmin][ymin][zmin].push_back(faction); // 0,0,0
-		octbox[xmax][ymin][zmin].push_back(faction); // 1,0,0
-		octbox[xmax][ymax][zmin].push_back(faction); // 1,1,0
-		octbox[xmax][ymax][zmax].push_back(faction); // 1,1,1
-
-		octbox[xmin][ymax][zmin].push_back(faction); // 0,1,0
-		octbox[xmin][ymax][zmax].push_back(faction); // 0,1,1
-		octbox[xmin][ymin][zmax].push_back(faction); // 0,0,1
-		octbox[xmax][ymin][zmax].push_back(faction); // 1,0,1
-
-		/* prune any duplicates from the octbox cells making things slightly saner
-		*/
-		PruneDuplicates(0, 0, 0);
-		PruneDuplicates(1, 0, 0);
-		PruneDuplicates(1, 1, 0);
-		PruneDuplicates(1, 1, 1);
-
-		PruneDuplicates(0, 1, 0);
-		PruneDuplicates(0, 1, 1);
-		PruneDuplicates(0, 0, 1);
-		PruneDuplicates(1, 0, 1);
-
-	} else {
-		/* ...other factions, such as ones with no homeworlds, and more annoyingly ones
-	   whose homeworlds don't exist yet because they're custom systems have to go in
-	   *every* octbox cell
-	*/
-		octbox[0][0][0].push_back(faction);
-		octbox[1][0][0].push_back(faction);
-		octbox[1][1][0].push_back(faction);
-		octbox[1][1][1].push_back(faction);
-
-		octbox[0][1][0].push_back(faction);
-		octbox[0][1][1].push_back(faction);
-		octbox[0][0][1].push_back(faction);
-		octbox[1][0][1].push_back(faction);
-	}
-}
-
-void FactionsDatabase::Octsapling::PruneDuplicates(const int bx, const int by, const int bz)
-{
-	octbox[bx][by][bz].erase(std::unique(octbox[bx][by][bz].begin(), octbox[bx][by][bz].end()), octbox[bx][by][bz].end());
-}
-
-const std::vector<const Faction *> &FactionsDatabase::Octsapling::CandidateFactions(const Sector::System *sys) const
-{
-	/* answer the factions that we've put in the same octobox cell as the one the
-	   system would go in. This part happens every time we do GetNearest faction
-	   so *is* performance criticale.e
-	*/
-	return octbox[BoxIndex(sys->sx)][BoxIndex(sys->sy)][BoxIndex(sys->sz)];
-}
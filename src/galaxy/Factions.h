@@ -8,6 +8,7 @@
 #include "Polit.h"
 #include "fixed.h"
 #include "galaxy/Economy.h"
+#include "galaxy/FactionClaimGrid.h"
 #include "galaxy/Sector.h"
 #include "galaxy/StarSystem.h"
 #include "vector3.h"
@@ -79,17 +80,13 @@ private:
 	bool IsCloserAndContains(double &closestFactionDist, const Sector::System *sys) const;
 };
 
-/* One day it might grow up to become a full tree, on the  other hand it might be
-   cut down before it's full growth to be replaced by
-   a proper spatial data structure.
-*/
-
 class FactionsDatabase {
 public:
 	FactionsDatabase(Galaxy *galaxy, const std::string &factionDir) :
 		m_galaxy(galaxy),
 		m_factionDirectory(factionDir),
 		m_no_faction(galaxy),
+		m_claim_grid(Sector::SIZE),
 		m_may_assign_factions(false),
 		m_initialized(false) {}
 	~FactionsDatabase();
@@ -112,27 +109,15 @@ public:
 	bool MayAssignFactions() const;
 
 private:
-	class Octsapling {
-	public:
-		void Add(const Faction *faction);
-		const std::vector<const Faction *> &CandidateFactions(const Sector::System *sys) const;
-
-	private:
-		std::vector<const Faction *> octbox[2][2][2];
-		static int BoxIndex(Sint32 sectorIndex) { return sectorIndex < 0 ? 0 : 1; };
-		void PruneDuplicates(const int bx, const int by, const int bz);
-	};
-
 	typedef std::vector<Faction *> FactionList;
 	typedef FactionList::iterator FactionIterator;
-	typedef const std::vector<const Faction *> ConstFactionList;
-	typedef ConstFactionList::const_iterator ConstFactionIterator;
 	typedef std::map<std::string, Faction *> FactionMap;
 	typedef std::set<SystemPath> HomeSystemSet;
 	typedef std::map<std::string, std::list<CustomSystem *>> MissingFactionsMap;
 
 	void ClearHomeSectors();
 	void SetHomeSectors();
+	void BuildClaimGrid();
 
 	Galaxy *const m_galaxy;
 	const std::string m_factionDirectory;
@@ -140,7 +125,7 @@ private:
 	FactionList m_factions;
 	FactionMap m_factions_byName;
 	HomeSystemSet m_homesystems;
-	Octsapling m_spatial_index;
+	FactionClaimGrid m_claim_grid; // candidate factions by sector, for GetNearestClaimant
 	bool m_may_assign_factions;
 	bool m_initialized = false;
 	MissingFactionsMap m_missingFactionsMap;
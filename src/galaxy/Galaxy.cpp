@@ -3,16 +3,33 @@
 
 #include "Galaxy.h"
 
+#include "BakedGalaxy.h"
 #include "FileSystem.h"
 #include "GalaxyGenerator.h"
 #include "GameSaveError.h"
 #include "Json.h"
+#include "MathUtil.h"
 #include "Sector.h"
 #include "core/Log.h"
 
 // FIXME(sturnclaw): don't need to be pulling in SDL_image here
 #include <SDL_image.h>
 
+static const char BAKED_GALAXY_FILE[] = "galaxy_baked.bin";
+
+// a baked galaxy assigned factions by their index, which is only
+// meaningful with the same factions loaded in the same order
+static Uint32 factions_fingerprint(FactionsDatabase &factions)
+{
+	Uint32 hash = 2166136261u; // FNV-1a
+	for (Uint32 i = 0; i < factions.GetNumFactions(); i++) {
+		const std::string &name = factions.GetFaction(i)->name;
+		for (size_t c = 0; c <= name.size(); c++)
+			hash = (hash ^ Uint8(name.c_str()[c])) * 16777619u;
+	}
+	return hash;
+}
+
 Galaxy::Galaxy(RefCountedPtr<GalaxyGenerator> galaxyGenerator, float radius, float sol_offset_x, float sol_offset_y,
 	const std::string &factionsDir, const std::string &customSysDir) :
 	GALAXY_RADIUS(radius),
@@ -58,6 +75,7 @@ void Galaxy::Init()
 {
 	m_customSystems.Load();
 	m_factions.Init();
+	m_baked = BakedGalaxy::Load(BAKED_GALAXY_FILE, GetGeneratorName(), GetGeneratorVersion(), factions_fingerprint(m_factions));
 	m_initialized = true;
 	m_factions.PostInit(); // So, cached home sectors take persisted state into account
 #if 0
@@ -79,6 +97,14 @@ void Galaxy::Init()
 #endif
 }
 
+RefCountedPtr<StarSystem> Galaxy::GetStarSystem(const SystemPath &path)
+{
+	RefCountedPtr<StarSystem> system = m_starSystemCache.GetCached(path);
+	if (!system->HasDetail())
+		m_galaxyGenerator->AddStarSystemDetail(RefCountedPtr<Galaxy>(this), system);
+	return system;
+}
+
 void Galaxy::FlushCaches()
 {
 	m_factions.ClearCache();
@@ -102,6 +128,52 @@ void Galaxy::Dump(FILE *file, Sint32 centerX, Sint32 centerY, Sint32 centerZ, Si
 	}
 }
 
+bool Galaxy::Bake(FILE *file, Sint32 centerX, Sint32 centerY, Sint32 centerZ, Sint32 radius)
+{
+	// generate everything afresh rather than copy an earlier bake
+	m_baked.reset();
+	FlushCaches();
+
+	const int size = 2 * radius + 1;
+	if (size > BakedGalaxy::MAX_BOX_SIZE) {
+		Output("Galaxy: can't bake more than %d sectors across\n", BakedGalaxy::MAX_BOX_SIZE);
+		return false;
+	}
+
+	BakedGalaxy::Builder builder(GetGeneratorName(), GetGeneratorVersion(), factions_fingerprint(m_factions),
+		centerX - radius, centerY - radius, centerZ - radius, size, size, size);
+
+	for (Sint32 sx = centerX - radius; sx <= centerX + radius; ++sx) {
+		for (Sint32 sy = centerY - radius; sy <= centerY + radius; ++sy) {
+			for (Sint32 sz = centerZ - radius; sz <= centerZ + radius; ++sz) {
+				RefCountedPtr<const Sector> sector = GetSector(SystemPath(sx, sy, sz));
+				// the sector map only works out populations this close in
+				const bool withPopulation = isqrt(1 + sx * sx + sy * sy + sz * sz) <= 90;
+
+				for (const Sector::System &sys : sector->m_systems) {
+					BakedGalaxy::SystemData data;
+					data.name = sys.GetName();
+					data.pos = sys.GetPosition();
+					data.numStars = sys.GetNumStars();
+					for (unsigned i = 0; i < sys.GetNumStars(); i++)
+						data.starType[i] = sys.GetStarType(i);
+					data.seed = sys.GetSeed();
+					data.isCustom = sys.GetCustomSystem() != nullptr;
+					data.explored = sys.IsExplored();
+					data.population = withPopulation ? GetStarSystemSummary(sys.GetPath())->GetTotalPop() : sys.GetPopulation();
+					data.factionIdx = sys.GetFaction()->idx;
+					builder.AddSystem(data);
+				}
+				builder.EndSector();
+			}
+			m_starSystemCache.ClearCache();
+		}
+	}
+
+	const std::vector<char> data = builder.Finish();
+	return fwrite(data.data(), 1, data.size(), file) == data.size();
+}
+
 RefCountedPtr<GalaxyGenerator> Galaxy::GetGenerator() const
 {
 	return m_galaxyGenerator;
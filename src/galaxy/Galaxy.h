@@ -10,9 +10,12 @@
 #include "JsonFwd.h"
 #include "PerfStats.h"
 #include "RefCounted.h"
+#include "SystemNameIndex.h"
 #include <cstdio>
+#include <memory>
 
 struct SDL_Surface;
+class BakedGalaxy;
 class GalaxyGenerator;
 
 class Galaxy : public RefCounted {
@@ -43,12 +46,24 @@ public:
 	RefCountedPtr<const Sector> GetSector(const SystemPath &path) { return m_sectorCache.GetCached(path); }
 	RefCountedPtr<Sector> GetMutableSector(const SystemPath &path) { return m_sectorCache.GetCached(path); }
 	RefCountedPtr<SectorCache::Slave> NewSectorSlaveCache() { return m_sectorCache.NewSlaveCache(); }
+	// the names of the systems in the sector cache
+	SystemNameIndex &GetSystemNames() { return m_systemNames; }
 
-	RefCountedPtr<StarSystem> GetStarSystem(const SystemPath &path) { return m_starSystemCache.GetCached(path); }
+	// with every detail, generating what's missing
+	RefCountedPtr<StarSystem> GetStarSystem(const SystemPath &path);
+	// enough for maps and lists of systems, see StarSystem::HasDetail()
+	RefCountedPtr<StarSystem> GetStarSystemSummary(const SystemPath &path) { return m_starSystemCache.GetCached(path); }
 	RefCountedPtr<StarSystemCache::Slave> NewStarSystemSlaveCache() { return m_starSystemCache.NewSlaveCache(); }
 
 	void FlushCaches();
+	// roughly, of the sectors and systems generated
+	size_t GetMemoryUsage() const { return m_sectorCache.GetMemoryUsage() + m_starSystemCache.GetMemoryUsage(); }
 	void Dump(FILE *file, Sint32 centerX, Sint32 centerY, Sint32 centerZ, Sint32 radius);
+	// writes the sectors within radius of the centre in the format of BakedGalaxy
+	bool Bake(FILE *file, Sint32 centerX, Sint32 centerY, Sint32 centerZ, Sint32 radius);
+
+	// sectors generated ahead of time, nullptr if there are none for this galaxy
+	const BakedGalaxy *GetBakedGalaxy() const { return m_baked.get(); }
 
 	RefCountedPtr<GalaxyGenerator> GetGenerator() const;
 	const std::string &GetGeneratorName() const;
@@ -61,10 +76,12 @@ private:
 	bool m_initialized;
 	Perf::Stats m_stats;
 	RefCountedPtr<GalaxyGenerator> m_galaxyGenerator;
+	SystemNameIndex m_systemNames; // before m_sectorCache, which removes its sectors from it
 	SectorCache m_sectorCache;
 	StarSystemCache m_starSystemCache;
 	FactionsDatabase m_factions;
 	CustomSystemsDatabase m_customSystems;
+	std::unique_ptr<BakedGalaxy> m_baked;
 };
 
 class DensityMapGalaxy : public Galaxy {
@@ -5,16 +5,57 @@
 
 #include "Game.h"
 #include "Pi.h"
+#include "galaxy/Factions.h"
 #include "galaxy/Galaxy.h"
 #include "galaxy/GalaxyGenerator.h"
 #include "galaxy/Sector.h"
 #include "galaxy/StarSystem.h"
 #include "core/Log.h"
 #include "profiler/Profiler.h"
+#include <algorithm>
+#include <type_traits>
 #include <utility>
 
 //#define DEBUG_CACHE
 
+template <typename T, typename CompareT>
+void GalaxyObjectCache<T, CompareT>::OnAdded(T *object)
+{
+}
+
+template <typename T, typename CompareT>
+void GalaxyObjectCache<T, CompareT>::OnRemoved(const SystemPath &path)
+{
+}
+
+// the system names of the sectors in the cache are indexed for search
+template <>
+void GalaxyObjectCache<Sector, SystemPath::LessSectorOnly>::OnAdded(Sector *sector)
+{
+	m_galaxy->GetSystemNames().QueueSector(sector);
+}
+
+template <>
+void GalaxyObjectCache<Sector, SystemPath::LessSectorOnly>::OnRemoved(const SystemPath &path)
+{
+	m_galaxy->GetSystemNames().RemoveSector(path);
+}
+
+template <typename T, typename CompareT>
+void GalaxyObjectCache<T, CompareT>::OnGenerated(Galaxy *galaxy, T *object)
+{
+}
+
+// working out which factions own a sector's systems means searching for the
+// nearest claimant of each, which is better done here than as the sector map
+// first draws them
+template <>
+void GalaxyObjectCache<Sector, SystemPath::LessSectorOnly>::OnGenerated(Galaxy *galaxy, Sector *sector)
+{
+	if (galaxy->GetFactions()->MayAssignFactions())
+		sector->AssignFactions();
+}
+
 //virtual
 
 template <typename T, typename CompareT>
@@ -35,6 +76,7 @@ void GalaxyObjectCache<T, CompareT>::AddToCache(std::vector<RefCountedPtr<T>> &o
 			it->Reset(inserted.first->second);
 		} else {
 			(*it)->SetCache(this);
+			OnAdded(it->Get());
 		}
 	}
 }
@@ -55,16 +97,87 @@ template <typename T, typename CompareT>
 RefCountedPtr<T> GalaxyObjectCache<T, CompareT>::GetCached(const SystemPath &path)
 {
 	RefCountedPtr<T> s = this->GetIfCached(path);
-	if (!s) {
-		++m_cacheMisses;
-		s = m_galaxy->GetGenerator()->Generate<T, GalaxyObjectCache<T, CompareT>>(RefCountedPtr<Galaxy>(m_galaxy), path, this);
-		m_attic.insert(std::make_pair(path, s.Get()));
-	} else {
+	if (s) {
 		++m_cacheHits;
+		return s;
+	}
+
+	// a cache job may already have it, or be about to
+	s = WaitForInFlight(path);
+	if (s) {
+		++m_cacheShared;
+		std::vector<RefCountedPtr<T>> objects(1, s);
+		AddToCache(objects);
+		return objects.front();
+	}
+
+	++m_cacheMisses;
+	s = m_galaxy->GetGenerator()->Generate<T, GalaxyObjectCache<T, CompareT>>(RefCountedPtr<Galaxy>(m_galaxy), path, this);
+	m_attic.insert(std::make_pair(path, s.Get()));
+	OnAdded(s.Get());
+	return s;
+}
+
+template <typename T, typename CompareT>
+RefCountedPtr<T> GalaxyObjectCache<T, CompareT>::GenerateOnce(const SystemPath &path, const CacheJob *job) // RUNS IN ANOTHER THREAD!!
+{
+	std::unique_lock<std::mutex> lock(m_inFlightLock);
+	if (!m_inFlight.insert(std::make_pair(path, InFlight{ job, RefCountedPtr<T>() })).second) {
+		RefCountedPtr<T> s = WaitForInFlight(path, lock);
+		if (s) {
+			++m_cacheShared;
+			return s;
+		}
 	}
+	lock.unlock();
+
+	RefCountedPtr<T> s = m_galaxy->GetGenerator()->Generate<T, GalaxyObjectCache<T, CompareT>>(RefCountedPtr<Galaxy>(m_galaxy), path, nullptr);
+	OnGenerated(m_galaxy, s.Get());
+
+	lock.lock();
+	auto it = m_inFlight.find(path);
+	if (it != m_inFlight.end() && it->second.owner == job)
+		it->second.object = s;
+	m_inFlightDone.notify_all();
 	return s;
 }
 
+template <typename T, typename CompareT>
+RefCountedPtr<T> GalaxyObjectCache<T, CompareT>::WaitForInFlight(const SystemPath &path)
+{
+	std::unique_lock<std::mutex> lock(m_inFlightLock);
+	return WaitForInFlight(path, lock);
+}
+
+template <typename T, typename CompareT>
+RefCountedPtr<T> GalaxyObjectCache<T, CompareT>::WaitForInFlight(const SystemPath &path, std::unique_lock<std::mutex> &lock)
+{
+	PROFILE_SCOPED()
+	// an object is generated by a running job before it moves on, so this
+	// never waits long or on anything that waits in turn
+	RefCountedPtr<T> s;
+	m_inFlightDone.wait(lock, [&]() {
+		auto it = m_inFlight.find(path);
+		if (it == m_inFlight.end())
+			return true;
+		s = it->second.object;
+		return bool(s);
+	});
+	return s;
+}
+
+template <typename T, typename CompareT>
+void GalaxyObjectCache<T, CompareT>::ReleaseInFlight(const CacheJob *job)
+{
+	std::lock_guard<std::mutex> lock(m_inFlightLock);
+	for (const SystemPath &path : *job->m_paths) {
+		auto it = m_inFlight.find(path);
+		if (it != m_inFlight.end() && it->second.owner == job)
+			m_inFlight.erase(path);
+	}
+	m_inFlightDone.notify_all();
+}
+
 template <typename T, typename CompareT>
 bool GalaxyObjectCache<T, CompareT>::HasCached(const SystemPath &path) const
 {
@@ -76,7 +189,8 @@ bool GalaxyObjectCache<T, CompareT>::HasCached(const SystemPath &path) const
 template <typename T, typename CompareT>
 void GalaxyObjectCache<T, CompareT>::RemoveFromAttic(const SystemPath &path)
 {
-	m_attic.erase(path);
+	if (m_attic.erase(path))
+		OnRemoved(path);
 }
 
 template <typename T, typename CompareT>
@@ -89,9 +203,18 @@ void GalaxyObjectCache<T, CompareT>::ClearCache()
 template <typename T, typename CompareT>
 void GalaxyObjectCache<T, CompareT>::OutputCacheStatistics(bool reset)
 {
-	Output("%s: misses: %llu, slave hits: %llu, master hits: %llu\n", CACHE_NAME.c_str(), m_cacheMisses, m_cacheHitsSlave, m_cacheHits);
+	Output("%s: misses: %llu, slave hits: %llu, master hits: %llu, shared: %llu\n", CACHE_NAME.c_str(), m_cacheMisses, m_cacheHitsSlave, m_cacheHits, m_cacheShared.load());
 	if (reset)
-		m_cacheMisses = m_cacheHitsSlave = m_cacheHits = 0;
+		m_cacheMisses = m_cacheHitsSlave = m_cacheHits = m_cacheShared = 0;
+}
+
+template <typename T, typename CompareT>
+size_t GalaxyObjectCache<T, CompareT>::GetMemoryUsage() const
+{
+	size_t size = 0;
+	for (const auto &it : m_attic)
+		size += it.second->GetMemoryUsage();
+	return size;
 }
 
 template <typename T, typename CompareT>
@@ -104,7 +227,11 @@ template <typename T, typename CompareT>
 GalaxyObjectCache<T, CompareT>::Slave::Slave(GalaxyObjectCache<T, CompareT> *master, RefCountedPtr<Galaxy> galaxy, JobQueue *jobQueue) :
 	m_master(master),
 	m_galaxy(galaxy),
-	m_jobs(Pi::GetAsyncJobQueue())
+	m_jobs(Pi::GetAsyncJobQueue(), JobPriority::Background),
+	m_prefetchJobs(Pi::GetAsyncJobQueue(), JobPriority::Background),
+	m_prefetchRadius(-1),
+	m_prefetchChunks(0),
+	m_capacity(0)
 {
 	m_master->m_slaves.insert(this);
 }
@@ -124,6 +251,15 @@ RefCountedPtr<T> GalaxyObjectCache<T, CompareT>::Slave::GetIfCached(const System
 	return RefCountedPtr<T>();
 }
 
+template <typename T, typename CompareT>
+const T *GalaxyObjectCache<T, CompareT>::Slave::Peek(const SystemPath &path) const
+{
+	typename CacheMap::const_iterator i = m_cache.find(path);
+	if (i != m_cache.end())
+		return (*i).second.Get();
+	return nullptr;
+}
+
 template <typename T, typename CompareT>
 RefCountedPtr<T> GalaxyObjectCache<T, CompareT>::Slave::GetCached(const SystemPath &path)
 {
@@ -151,7 +287,14 @@ template <typename T, typename CompareT>
 void GalaxyObjectCache<T, CompareT>::Slave::Erase(const typename CacheMap::const_iterator &it) { m_cache.erase(it); }
 
 template <typename T, typename CompareT>
-void GalaxyObjectCache<T, CompareT>::Slave::ClearCache() { m_cache.clear(); }
+void GalaxyObjectCache<T, CompareT>::Slave::ClearCache()
+{
+	m_cache.clear();
+
+	// the next Prefetch starts over
+	m_prefetchPending.clear();
+	m_prefetchRadius = -1;
+}
 
 template <typename T, typename CompareT>
 GalaxyObjectCache<T, CompareT>::Slave::~Slave()
@@ -235,6 +378,135 @@ void GalaxyObjectCache<T, CompareT>::Slave::FillCache(const typename GalaxyObjec
 	}
 }
 
+template <typename T, typename CompareT>
+void GalaxyObjectCache<T, CompareT>::Slave::Prefetch(const SystemPath &centre, int radius,
+	typename GalaxyObjectCache<T, CompareT>::CacheFilledCallback callback)
+{
+	PROFILE_SCOPED()
+	assert((std::is_same<CompareT, SystemPath::LessSectorOnly>::value));
+
+	m_prefetchCallback = callback;
+	if (radius == m_prefetchRadius && centre.IsSameSector(m_prefetchCentre))
+		return;
+
+	m_prefetchCentre = centre.SectorOnly();
+	m_prefetchRadius = radius;
+	m_prefetchPending.clear();
+	if (!m_master)
+		return;
+
+	const Sint32 cx = m_prefetchCentre.sectorX, cy = m_prefetchCentre.sectorY, cz = m_prefetchCentre.sectorZ;
+	for (Sint32 x = cx - radius; x <= cx + radius; x++) {
+		for (Sint32 y = cy - radius; y <= cy + radius; y++) {
+			for (Sint32 z = cz - radius; z <= cz + radius; z++) {
+				const SystemPath path(x, y, z);
+				if (!InPrefetchRange(path) || m_cache.count(path) || m_prefetchInFlight.count(path))
+					continue;
+
+				RefCountedPtr<T> s = m_master->GetIfCached(path);
+				if (s)
+					m_cache.insert(std::make_pair(path, s));
+				else
+					m_prefetchPending.push_back(path);
+			}
+		}
+	}
+
+	// concentric shells around the centre, the nearest at the back
+	const SystemPath &c = m_prefetchCentre;
+	std::sort(m_prefetchPending.begin(), m_prefetchPending.end(), [&c](const SystemPath &a, const SystemPath &b) {
+		const double da = SystemPath::SectorDistanceSqr(c, a), db = SystemPath::SectorDistanceSqr(c, b);
+		return da != db ? da > db : b < a;
+	});
+
+	EvictOverCapacity();
+	QueuePrefetchChunks();
+}
+
+template <typename T, typename CompareT>
+void GalaxyObjectCache<T, CompareT>::Slave::SetCapacity(size_t maxObjects)
+{
+	m_capacity = maxObjects;
+	EvictOverCapacity();
+}
+
+template <typename T, typename CompareT>
+bool GalaxyObjectCache<T, CompareT>::Slave::InPrefetchRange(const SystemPath &path) const
+{
+	return SystemPath::SectorDistanceSqr(m_prefetchCentre, path) <= double(m_prefetchRadius) * m_prefetchRadius;
+}
+
+template <typename T, typename CompareT>
+void GalaxyObjectCache<T, CompareT>::Slave::QueuePrefetchChunks()
+{
+	while (m_prefetchChunks < PREFETCH_MAX_JOBS && !m_prefetchPending.empty()) {
+		std::unique_ptr<PathVector> chunk(new PathVector);
+		chunk->reserve(PREFETCH_JOB_SIZE);
+		while (chunk->size() < PREFETCH_JOB_SIZE && !m_prefetchPending.empty()) {
+			const SystemPath path = m_prefetchPending.back();
+			m_prefetchPending.pop_back();
+
+			// may have been fetched directly in the meantime
+			if (m_cache.count(path))
+				continue;
+
+			m_prefetchInFlight[path] = true;
+			chunk->push_back(path);
+		}
+
+		if (chunk->empty())
+			break;
+
+		m_prefetchChunks++;
+		m_prefetchJobs.Order(new GalaxyObjectCache<T, CompareT>::PrefetchJob(std::move(chunk), this, m_galaxy));
+	}
+}
+
+template <typename T, typename CompareT>
+void GalaxyObjectCache<T, CompareT>::Slave::FinishPrefetchChunk(const PathVector &paths, std::vector<RefCountedPtr<T>> &objects)
+{
+	PROFILE_SCOPED()
+	assert(m_prefetchChunks > 0);
+	m_prefetchChunks--;
+	for (const SystemPath &path : paths)
+		m_prefetchInFlight.erase(path);
+
+	if (m_master) {
+		// the view may have moved on while the chunk was being generated
+		objects.erase(std::remove_if(objects.begin(), objects.end(), [this](const RefCountedPtr<T> &o) {
+			return !InPrefetchRange(o->GetPath());
+		}),
+			objects.end());
+
+		AddToCache(objects);
+		EvictOverCapacity();
+	}
+
+	QueuePrefetchChunks();
+	if (m_prefetchCallback && !objects.empty())
+		m_prefetchCallback();
+}
+
+template <typename T, typename CompareT>
+void GalaxyObjectCache<T, CompareT>::Slave::EvictOverCapacity()
+{
+	if (m_capacity == 0 || m_cache.size() <= m_capacity)
+		return;
+
+	PROFILE_SCOPED()
+	std::vector<std::pair<double, SystemPath>> byDistance;
+	byDistance.reserve(m_cache.size());
+	for (const auto &entry : m_cache)
+		byDistance.push_back(std::make_pair(SystemPath::SectorDistanceSqr(m_prefetchCentre, entry.first), entry.first));
+
+	const size_t excess = m_cache.size() - m_capacity;
+	std::nth_element(byDistance.begin(), byDistance.begin() + excess, byDistance.end(),
+		[](const std::pair<double, SystemPath> &a, const std::pair<double, SystemPath> &b) { return a.first > b.first; });
+
+	for (size_t i = 0; i < excess; i++)
+		m_cache.erase(byDistance[i].second);
+}
+
 template <typename T, typename CompareT>
 GalaxyObjectCache<T, CompareT>::CacheJob::CacheJob(std::unique_ptr<std::vector<SystemPath>> path,
 	typename GalaxyObjectCache<T, CompareT>::Slave *slaveCache, RefCountedPtr<Galaxy> galaxy,
@@ -242,6 +514,7 @@ GalaxyObjectCache<T, CompareT>::CacheJob::CacheJob(std::unique_ptr<std::vector<S
 	Job(),
 	m_paths(std::move(path)),
 	m_slaveCache(slaveCache),
+	m_master(slaveCache->m_master),
 	m_galaxy(galaxy),
 	m_galaxyGenerator(galaxy->GetGenerator()),
 	m_callback(callback)
@@ -249,13 +522,28 @@ GalaxyObjectCache<T, CompareT>::CacheJob::CacheJob(std::unique_ptr<std::vector<S
 	m_objects.reserve(m_paths->size());
 }
 
+// the job is deleted once it has been finished or cancelled, and is no
+// longer running
+template <typename T, typename CompareT>
+GalaxyObjectCache<T, CompareT>::CacheJob::~CacheJob()
+{
+	if (m_master)
+		m_master->ReleaseInFlight(this);
+}
+
 //virtual
 template <typename T, typename CompareT>
 void GalaxyObjectCache<T, CompareT>::CacheJob::OnRun() // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
 {
 	PROFILE_SCOPED()
-	for (auto it = m_paths->begin(), itEnd = m_paths->end(); it != itEnd; ++it)
-		m_objects.push_back(m_galaxyGenerator->Generate<T, GalaxyObjectCache<T, CompareT>>(m_galaxy, *it, nullptr));
+	for (auto it = m_paths->begin(), itEnd = m_paths->end(); it != itEnd; ++it) {
+		if (m_master) {
+			m_objects.push_back(m_master->GenerateOnce(*it, this));
+		} else {
+			m_objects.push_back(m_galaxyGenerator->Generate<T, GalaxyObjectCache<T, CompareT>>(m_galaxy, *it, nullptr));
+			OnGenerated(m_galaxy.Get(), m_objects.back().Get());
+		}
+	}
 }
 
 //virtual
@@ -268,6 +556,13 @@ void GalaxyObjectCache<T, CompareT>::CacheJob::OnFinish() // runs in primary thr
 		m_callback();
 }
 
+//virtual
+template <typename T, typename CompareT>
+void GalaxyObjectCache<T, CompareT>::PrefetchJob::OnFinish() // runs in primary thread of the context
+{
+	this->m_slaveCache->FinishPrefetchChunk(*this->m_paths, this->m_objects);
+}
+
 /****** SectorCache ******/
 
 template <>
@@ -281,7 +576,11 @@ template <>
 GalaxyObjectCache<StarSystem, SystemPath::LessSystemOnly>::Slave::Slave(GalaxyObjectCache<StarSystem, SystemPath::LessSystemOnly> *master, RefCountedPtr<Galaxy> galaxy, JobQueue *jobQueue) :
 	m_master(master),
 	m_galaxy(galaxy),
-	m_jobs(Pi::GetSyncJobQueue())
+	m_jobs(Pi::GetSyncJobQueue()),
+	m_prefetchJobs(Pi::GetAsyncJobQueue(), JobPriority::Background),
+	m_prefetchRadius(-1),
+	m_prefetchChunks(0),
+	m_capacity(0)
 {
 	m_master->m_slaves.insert(this);
 }
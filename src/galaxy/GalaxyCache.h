@@ -7,9 +7,12 @@
 #include "JobQueue.h"
 #include "RefCounted.h"
 #include "galaxy/SystemPath.h"
+#include "galaxy/SystemPathHashMap.h"
+#include <atomic>
+#include <condition_variable>
 #include <functional>
-#include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <vector>
 
@@ -27,7 +30,8 @@ public:
 		m_galaxy(galaxy),
 		m_cacheHits(0),
 		m_cacheHitsSlave(0),
-		m_cacheMisses(0) {}
+		m_cacheMisses(0),
+		m_cacheShared(0) {}
 	~GalaxyObjectCache();
 
 	RefCountedPtr<T> GetCached(const SystemPath &path);
@@ -37,10 +41,12 @@ public:
 	bool IsEmpty() { return m_attic.empty(); }
 
 	void OutputCacheStatistics(bool reset = true);
+	// roughly, of every object alive, cached or not
+	size_t GetMemoryUsage() const;
 
 	typedef std::vector<SystemPath> PathVector;
-	typedef std::map<SystemPath, RefCountedPtr<T>, CompareT> CacheMap;
-	typedef std::map<SystemPath, T *, CompareT> AtticMap;
+	typedef SystemPathHashMap<RefCountedPtr<T>, CompareT> CacheMap;
+	typedef SystemPathHashMap<T *, CompareT> AtticMap;
 	typedef std::function<void()> CacheFilledCallback;
 
 	class Slave : public RefCounted {
@@ -49,10 +55,25 @@ public:
 	public:
 		RefCountedPtr<T> GetCached(const SystemPath &path);
 		RefCountedPtr<T> GetIfCached(const SystemPath &path);
+		// The cached object without taking a reference to it, for reading
+		// on hot paths. It stays valid until the slave drops it, so don't
+		// hold on to it past an Erase, ClearCache or Prefetch.
+		const T *Peek(const SystemPath &path) const;
 		typename CacheMap::const_iterator Begin() const { return m_cache.begin(); }
 		typename CacheMap::const_iterator End() const { return m_cache.end(); }
 
 		void FillCache(const PathVector &paths, CacheFilledCallback callback = CacheFilledCallback());
+
+		// Streams the objects within radius sectors of centre into the cache
+		// in the background, nearest first and a few at a time. A new centre
+		// or radius replaces whatever hasn't been queued yet, and objects
+		// arriving out of range are dropped. callback is called on the main
+		// thread whenever more objects have arrived. Sector caches only.
+		void Prefetch(const SystemPath &centre, int radius, CacheFilledCallback callback = CacheFilledCallback());
+		// keep at most this many objects, dropping those farthest from the
+		// prefetch centre first; zero (the default) for no limit
+		void SetCapacity(size_t maxObjects);
+
 		void Erase(const SystemPath &path);
 		void Erase(const typename CacheMap::const_iterator &it);
 		void ClearCache();
@@ -65,26 +86,64 @@ public:
 		CacheMap m_cache;
 		JobSet m_jobs;
 
+		JobSet m_prefetchJobs;
+		PathVector m_prefetchPending; // farthest first, chunks are taken from the back
+		SystemPathHashMap<bool, CompareT> m_prefetchInFlight;
+		SystemPath m_prefetchCentre;
+		int m_prefetchRadius;
+		unsigned m_prefetchChunks;
+		CacheFilledCallback m_prefetchCallback;
+		size_t m_capacity;
+
 		Slave(GalaxyObjectCache *master, RefCountedPtr<Galaxy> galaxy, JobQueue *jobQueue);
 		void MasterDeleted();
 		void AddToCache(std::vector<RefCountedPtr<T>> &objects);
+		bool InPrefetchRange(const SystemPath &path) const;
+		void QueuePrefetchChunks();
+		void FinishPrefetchChunk(const PathVector &paths, std::vector<RefCountedPtr<T>> &objects);
+		void EvictOverCapacity();
 	};
 
 	RefCountedPtr<Slave> NewSlaveCache();
 
 private:
 	static const unsigned CACHE_JOB_SIZE = 100;
+	// prefetching uses small jobs, so that what's needed first arrives first
+	// and a change of view doesn't leave much work queued for nothing
+	static const unsigned PREFETCH_JOB_SIZE = 16;
+	static const unsigned PREFETCH_MAX_JOBS = 8;
 
 	void AddToCache(std::vector<RefCountedPtr<T>> &objects);
 	bool HasCached(const SystemPath &path) const;
 	void RemoveFromAttic(const SystemPath &path);
+	// as objects enter and leave the attic
+	void OnAdded(T *object);
+	void OnRemoved(const SystemPath &path);
+	// as objects are generated by a cache job, on its worker thread
+	static void OnGenerated(Galaxy *galaxy, T *object);
+
+	class CacheJob;
+
+	// Generates the object for a cache job, unless another job is already
+	// generating it, in which case this waits for and shares its result.
+	// Called from worker threads.
+	RefCountedPtr<T> GenerateOnce(const SystemPath &path, const CacheJob *job);
+	// the object another job is generating or has generated, if any,
+	// waiting for it to be done
+	RefCountedPtr<T> WaitForInFlight(const SystemPath &path);
+	RefCountedPtr<T> WaitForInFlight(const SystemPath &path, std::unique_lock<std::mutex> &lock);
+	// forgets the objects the job generated, once they've been delivered
+	void ReleaseInFlight(const CacheJob *job);
 
 	// ********************************************************************************
 	// Overloaded Job class to handle generating a collection of sectors
 	// ********************************************************************************
 	class CacheJob : public Job {
+		friend class GalaxyObjectCache<T, CompareT>;
+
 	public:
 		CacheJob(std::unique_ptr<std::vector<SystemPath>> path, Slave *slaveCache, RefCountedPtr<Galaxy> galaxy, CacheFilledCallback callback = CacheFilledCallback());
+		virtual ~CacheJob();
 
 		virtual void OnRun(); // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
 		virtual void OnFinish(); // runs in primary thread of the context
@@ -94,20 +153,42 @@ private:
 		std::unique_ptr<std::vector<SystemPath>> m_paths;
 		std::vector<RefCountedPtr<T>> m_objects;
 		Slave *m_slaveCache;
+		GalaxyObjectCache *m_master; // kept alive by m_galaxy
 		RefCountedPtr<Galaxy> m_galaxy;
 		RefCountedPtr<GalaxyGenerator> m_galaxyGenerator;
 		CacheFilledCallback m_callback;
 	};
 
+	// a chunk of Slave::Prefetch
+	class PrefetchJob : public CacheJob {
+	public:
+		PrefetchJob(std::unique_ptr<std::vector<SystemPath>> path, Slave *slaveCache, RefCountedPtr<Galaxy> galaxy) :
+			CacheJob(std::move(path), slaveCache, galaxy) {}
+
+		virtual void OnFinish() override; // runs in primary thread of the context
+	};
+
 	Galaxy *m_galaxy;
 	std::set<Slave *> m_slaves;
 	AtticMap m_attic; // Those contains non-refcounted pointers which are kept alive by RefCountedPtrs in slave caches
 		// or elsewhere. The Sector destructor ensures that it is removed from here.
 		// This ensures, that there is only ever one object for each Sector.
 
+	// The objects cache jobs are generating, or have generated and not yet
+	// delivered, so each is only generated once however many slaves or
+	// jobs ask for it at the same time. Shared with the worker threads.
+	struct InFlight {
+		const CacheJob *owner = nullptr;
+		RefCountedPtr<T> object; // empty while it's being generated
+	};
+	SystemPathHashMap<InFlight, CompareT> m_inFlight;
+	std::mutex m_inFlightLock;
+	std::condition_variable m_inFlightDone;
+
 	unsigned long long m_cacheHits;
 	unsigned long long m_cacheHitsSlave;
 	unsigned long long m_cacheMisses;
+	std::atomic<unsigned long long> m_cacheShared; // generated by one job, taken by another
 };
 
 class Sector;
@@ -0,0 +1,112 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "GalaxyDensityVolume.h"
+
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+static int floor_div(int a, int b)
+{
+	return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+// 21 bits per coordinate is plenty for blocks of at least one sector
+static uint64_t block_key(int bx, int by, int bz)
+{
+	return (uint64_t(uint32_t(bx) & 0x1FFFFF) << 42) |
+		(uint64_t(uint32_t(by) & 0x1FFFFF) << 21) |
+		uint64_t(uint32_t(bz) & 0x1FFFFF);
+}
+
+GalaxyDensityVolume::GalaxyDensityVolume(DensityFunc density, int baseBlockSectors, int numLevels) :
+	m_density(std::move(density)),
+	m_baseBlockSectors(baseBlockSectors),
+	m_levels(numLevels)
+{
+	assert(baseBlockSectors > 0 && numLevels > 0);
+}
+
+float GalaxyDensityVolume::GetDensity(int level, int sx, int sy, int sz)
+{
+	const int size = GetBlockSectors(level);
+	return BlockDensity(level, floor_div(sx, size), floor_div(sy, size), floor_div(sz, size));
+}
+
+void GalaxyDensityVolume::GetBlocks(int level, const vector3f &centre, float minRadius, float maxRadius, std::vector<Block> &out)
+{
+	PROFILE_SCOPED()
+	const int size = GetBlockSectors(level);
+	const float half = 0.5f * size;
+
+	int minBlock[3], maxBlock[3];
+	for (int axis = 0; axis < 3; axis++) {
+		minBlock[axis] = int(std::floor((centre[axis] - maxRadius) / size));
+		maxBlock[axis] = int(std::floor((centre[axis] + maxRadius) / size));
+	}
+
+	const float minRadiusSqr = minRadius * minRadius;
+	const float maxRadiusSqr = maxRadius * maxRadius;
+	for (int bx = minBlock[0]; bx <= maxBlock[0]; bx++) {
+		for (int by = minBlock[1]; by <= maxBlock[1]; by++) {
+			for (int bz = minBlock[2]; bz <= maxBlock[2]; bz++) {
+				const vector3f blockCentre(bx * size + half, by * size + half, bz * size + half);
+				const float distSqr = (blockCentre - centre).LengthSqr();
+				if (distSqr < minRadiusSqr || distSqr > maxRadiusSqr)
+					continue;
+
+				const float density = BlockDensity(level, bx, by, bz);
+				if (density > 0.f)
+					out.push_back({ blockCentre, density });
+			}
+		}
+	}
+}
+
+size_t GalaxyDensityVolume::GetNumCachedBlocks() const
+{
+	size_t count = 0;
+	for (const auto &level : m_levels)
+		count += level.size();
+	return count;
+}
+
+float GalaxyDensityVolume::BlockDensity(int level, int bx, int by, int bz)
+{
+	const uint64_t key = block_key(bx, by, bz);
+	auto it = m_levels[level].find(key);
+	if (it != m_levels[level].end())
+		return it->second;
+
+	// blocks are cheap to work out again, so rather than tracking their use
+	// start afresh once too many have been visited
+	if (GetNumCachedBlocks() >= MAX_CACHED_BLOCKS) {
+		for (auto &cache : m_levels)
+			cache.clear();
+	}
+
+	float density = 0.f;
+	if (level == 0) {
+		const int samples = std::min(m_baseBlockSectors, MAX_SAMPLES);
+		const int stride = m_baseBlockSectors / samples;
+		const int first = stride / 2;
+		for (int x = 0; x < samples; x++)
+			for (int y = 0; y < samples; y++)
+				for (int z = 0; z < samples; z++)
+					density += m_density(
+						bx * m_baseBlockSectors + first + x * stride,
+						by * m_baseBlockSectors + first + y * stride,
+						bz * m_baseBlockSectors + first + z * stride);
+		density /= float(samples * samples * samples);
+	} else {
+		for (int child = 0; child < 8; child++)
+			density += BlockDensity(level - 1, bx * 2 + (child & 1), by * 2 + ((child >> 1) & 1), bz * 2 + (child >> 2));
+		density *= 0.125f;
+	}
+
+	m_levels[level][key] = density;
+	return density;
+}
@@ -0,0 +1,62 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _GALAXYDENSITYVOLUME_H
+#define _GALAXYDENSITYVOLUME_H
+
+#include "vector3.h"
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * The mean star density of the galaxy over cubic blocks of sectors, at
+ * several resolutions. Level 0 blocks are a few sectors across and each
+ * further level doubles that, so distant parts of the galaxy can be drawn
+ * from a handful of coarse blocks instead of generating their sectors.
+ *
+ * Blocks are computed when they are first asked for, level 0 by sampling the
+ * density function and the coarser levels by averaging the eight blocks of
+ * the level below, and kept until the volume grows past its size limit.
+ */
+class GalaxyDensityVolume {
+public:
+	// density of the given sector, 0 - 255
+	using DensityFunc = std::function<float(int sx, int sy, int sz)>;
+
+	struct Block {
+		vector3f centre; // in sectors
+		float density;	 // mean density of the sectors in the block
+	};
+
+	GalaxyDensityVolume(DensityFunc density, int baseBlockSectors, int numLevels);
+
+	int GetNumLevels() const { return int(m_levels.size()); }
+	// sectors along each side of the level's blocks
+	int GetBlockSectors(int level) const { return m_baseBlockSectors << level; }
+
+	// mean density of the block containing the given sector
+	float GetDensity(int level, int sx, int sy, int sz);
+
+	// append the non-empty blocks of the level whose centres lie between
+	// minRadius and maxRadius sectors of centre
+	void GetBlocks(int level, const vector3f &centre, float minRadius, float maxRadius, std::vector<Block> &out);
+
+	size_t GetNumCachedBlocks() const;
+
+private:
+	// cached blocks at most, over all levels
+	static const size_t MAX_CACHED_BLOCKS = 1 << 18;
+	// density samples along each side of a level 0 block, at most
+	static const int MAX_SAMPLES = 4;
+
+	float BlockDensity(int level, int bx, int by, int bz);
+
+	DensityFunc m_density;
+	int m_baseBlockSectors;
+	std::vector<std::unordered_map<uint64_t, float>> m_levels;
+};
+
+#endif /* _GALAXYDENSITYVOLUME_H */
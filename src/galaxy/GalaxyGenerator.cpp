@@ -8,13 +8,21 @@
 #include "SectorGenerator.h"
 #include "galaxy/Galaxy.h"
 #include "galaxy/StarSystemGenerator.h"
+#include "profiler/Profiler.h"
 #include "utils.h"
 
+#include <chrono>
+
+// version 2 makes each body's satellites from a counter-based stream of its
+// own, so they can be made in parallel; it generates a different universe,
+// so for now it's only used when asked for with GalaxyGeneratorVersion
 static const GalaxyGenerator::Version LAST_VERSION_LEGACY = 1;
+static const GalaxyGenerator::Version MAX_VERSION_LEGACY = 2;
 
 std::string GalaxyGenerator::s_defaultGenerator = "legacy";
 GalaxyGenerator::Version GalaxyGenerator::s_defaultVersion = LAST_VERSION_LEGACY;
 RefCountedPtr<Galaxy> GalaxyGenerator::s_galaxy;
+TaskGraph *GalaxyGenerator::s_taskGraph = nullptr;
 
 //static
 void GalaxyGenerator::Init(const std::string &name, Version version)
@@ -51,14 +59,15 @@ RefCountedPtr<Galaxy> GalaxyGenerator::Create(const std::string &name, Version v
 	RefCountedPtr<GalaxyGenerator> galgen;
 	if (name == "legacy") {
 		Output("Creating new galaxy generator '%s' version %d\n", name.c_str(), version);
-		if (version == 0 || version == 1) {
+		if (version >= 0 && version <= MAX_VERSION_LEGACY) {
 			galgen.Reset((new GalaxyGenerator(name, version))
+							 ->AddSectorStage(new SectorBakedSystemsGenerator)
 							 ->AddSectorStage(new SectorCustomSystemsGenerator(CustomSystem::CUSTOM_ONLY_RADIUS))
 							 ->AddSectorStage(new SectorRandomSystemsGenerator)
 							 ->AddSectorStage(new SectorPersistenceGenerator(version))
 							 ->AddStarSystemStage(new StarSystemFromSectorGenerator)
 							 ->AddStarSystemStage(new StarSystemCustomGenerator)
-							 ->AddStarSystemStage(new StarSystemRandomGenerator)
+							 ->AddStarSystemStage(new StarSystemRandomGenerator(version))
 							 ->AddStarSystemStage(new PopulateStarSystemGenerator));
 		}
 	}
@@ -67,6 +76,7 @@ RefCountedPtr<Galaxy> GalaxyGenerator::Create(const std::string &name, Version v
 		if (s_galaxy && galgen->m_name == s_galaxy->GetGeneratorName() && galgen->m_version == s_galaxy->GetGeneratorVersion()) {
 			Output("Clearing and re-using previous Galaxy object\n");
 			s_galaxy->SetGalaxyGenerator(galgen);
+			galgen->RegisterStageCounters(s_galaxy->GetStats());
 			s_galaxy->FlushCaches();
 			return s_galaxy;
 		}
@@ -74,6 +84,7 @@ RefCountedPtr<Galaxy> GalaxyGenerator::Create(const std::string &name, Version v
 		assert(name == "legacy"); // Once whe have have more, this will become an if switch
 		// NB : The galaxy density image MUST be in BMP format due to OSX failing to load pngs the same as Linux/Windows
 		s_galaxy = RefCountedPtr<Galaxy>(new DensityMapGalaxy(galgen, "galaxy_dense.bmp", 50000.0, 25000.0, 0.0, "factions", "systems"));
+		galgen->RegisterStageCounters(s_galaxy->GetStats());
 		s_galaxy->Init();
 		return s_galaxy;
 	} else {
@@ -168,15 +179,42 @@ GalaxyGenerator *GalaxyGenerator::AddStarSystemStage(StarSystemGeneratorStage *s
 	return this;
 }
 
+void GalaxyGenerator::RegisterStageCounters(Perf::Stats &stats)
+{
+	for (SectorGeneratorStage *secgen : m_sectorStage)
+		RegisterStageCounters(stats, secgen);
+	for (StarSystemGeneratorStage *sysgen : m_starSystemStage)
+		RegisterStageCounters(stats, sysgen);
+}
+
+//static
+void GalaxyGenerator::RegisterStageCounters(Perf::Stats &stats, GalaxyGeneratorStage *stage)
+{
+	stage->m_timeCounter = stats.GetOrCreateCounter(std::string(stage->GetName()) + " (us)", false);
+	stage->m_runCounter = stats.GetOrCreateCounter(std::string(stage->GetName()) + " (runs)", false);
+}
+
+//static
+void GalaxyGenerator::AddStageTime(const Perf::Stats &stats, const GalaxyGeneratorStage *stage, Uint64 startTicks)
+{
+	const std::chrono::steady_clock::duration elapsed(Profiler::Clock::getticks() - startTicks);
+	stats.CounterAdd(stage->m_timeCounter, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+	stats.CounterAdd(stage->m_runCounter);
+}
+
 RefCountedPtr<Sector> GalaxyGenerator::GenerateSector(RefCountedPtr<Galaxy> galaxy, const SystemPath &path, SectorCache *cache)
 {
-	const Uint32 _init[4] = { Uint32(path.sectorX), Uint32(path.sectorY), Uint32(path.sectorZ), UNIVERSE_SEED };
-	Random rng(_init, 4);
 	SectorConfig config;
 	RefCountedPtr<Sector> sector(new Sector(galaxy, path, cache));
-	for (SectorGeneratorStage *secgen : m_sectorStage)
-		if (!secgen->Apply(rng, galaxy, sector, &config))
+	Random rng;
+	sector->SeedRandom(rng);
+	for (SectorGeneratorStage *secgen : m_sectorStage) {
+		const Uint64 start = Profiler::Clock::getticks();
+		const bool proceed = secgen->Apply(rng, galaxy, sector, &config);
+		AddStageTime(galaxy->GetStats(), secgen, start);
+		if (!proceed)
 			break;
+	}
 	return sector;
 }
 
@@ -191,8 +229,26 @@ RefCountedPtr<StarSystem> GalaxyGenerator::GenerateStarSystem(RefCountedPtr<Gala
 	Random rng(_init, 5);
 	StarSystemConfig config;
 	RefCountedPtr<StarSystem::GeneratorAPI> system(new StarSystem::GeneratorAPI(path, galaxy, cache, rng));
-	for (StarSystemGeneratorStage *sysgen : m_starSystemStage)
-		if (!sysgen->Apply(rng, galaxy, system, &config))
+	system->SetHasDetail(false);
+	for (StarSystemGeneratorStage *sysgen : m_starSystemStage) {
+		const Uint64 start = Profiler::Clock::getticks();
+		const bool proceed = sysgen->Apply(rng, galaxy, system, &config);
+		AddStageTime(galaxy->GetStats(), sysgen, start);
+		if (!proceed)
 			break;
+	}
 	return system;
 }
+
+void GalaxyGenerator::AddStarSystemDetail(RefCountedPtr<Galaxy> galaxy, RefCountedPtr<StarSystem> system)
+{
+	PROFILE_SCOPED()
+	if (system->HasDetail())
+		return;
+
+	// every system made by GenerateStarSystem is one
+	RefCountedPtr<StarSystem::GeneratorAPI> sysAPI(static_cast<StarSystem::GeneratorAPI *>(system.Get()));
+	for (StarSystemGeneratorStage *sysgen : m_starSystemStage)
+		sysgen->ApplyDetail(galaxy, sysAPI);
+	sysAPI->SetHasDetail(true);
+}
@@ -4,6 +4,7 @@
 #ifndef GALAXYGENERATOR_H
 #define GALAXYGENERATOR_H
 
+#include "PerfStats.h"
 #include "RefCounted.h"
 #include "Sector.h"
 #include "StarSystem.h"
@@ -11,8 +12,10 @@
 #include <list>
 #include <string>
 
+class GalaxyGeneratorStage;
 class SectorGeneratorStage;
 class StarSystemGeneratorStage;
+class TaskGraph;
 
 class GalaxyGenerator : public RefCounted {
 public:
@@ -33,6 +36,10 @@ public:
 	static Version GetDefaultGeneratorVersion() { return s_defaultVersion; }
 	static Version GetLastVersion(const std::string &name);
 
+	// stages may split their work into tasks on this graph, if there is one
+	static void SetTaskGraph(TaskGraph *graph) { s_taskGraph = graph; }
+	static TaskGraph *GetTaskGraph() { return s_taskGraph; }
+
 	virtual ~GalaxyGenerator();
 
 	const std::string &GetName() const { return m_name; }
@@ -47,13 +54,18 @@ public:
 	template <typename T, typename Cache>
 	RefCountedPtr<T> Generate(RefCountedPtr<Galaxy> galaxy, const SystemPath &path, Cache *cache);
 
+	// fills in what a summary left out, see StarSystem::HasDetail()
+	void AddStarSystemDetail(RefCountedPtr<Galaxy> galaxy, RefCountedPtr<StarSystem> system);
+
 	GalaxyGenerator *AddSectorStage(SectorGeneratorStage *sectorGenerator);
 	GalaxyGenerator *AddStarSystemStage(StarSystemGeneratorStage *starSystemGenerator);
 
 	struct SectorConfig {
+		bool isBaked;
 		bool isCustomOnly;
 
 		SectorConfig() :
+			isBaked(false),
 			isCustomOnly(false) {}
 	};
 
@@ -72,6 +84,11 @@ private:
 	virtual RefCountedPtr<Sector> GenerateSector(RefCountedPtr<Galaxy> galaxy, const SystemPath &path, SectorCache *cache);
 	virtual RefCountedPtr<StarSystem> GenerateStarSystem(RefCountedPtr<Galaxy> galaxy, const SystemPath &path, StarSystemCache *cache);
 
+	// per-stage time and run counters in the galaxy's stats
+	void RegisterStageCounters(Perf::Stats &stats);
+	static void RegisterStageCounters(Perf::Stats &stats, GalaxyGeneratorStage *stage);
+	static void AddStageTime(const Perf::Stats &stats, const GalaxyGeneratorStage *stage, Uint64 startTicks);
+
 	const std::string m_name;
 	const Version m_version;
 
@@ -79,6 +96,7 @@ private:
 	std::list<StarSystemGeneratorStage *> m_starSystemStage;
 
 	static RefCountedPtr<Galaxy> s_galaxy;
+	static TaskGraph *s_taskGraph;
 	static std::string s_defaultGenerator;
 	static Version s_defaultVersion;
 };
@@ -99,17 +117,26 @@ class GalaxyGeneratorStage {
 public:
 	virtual ~GalaxyGeneratorStage() {}
 
+	// names the stage's counters in the galaxy's stats
+	virtual const char *GetName() const = 0;
+
 	virtual void ToJson(Json &jsonObj, RefCountedPtr<Galaxy> galaxy) {}
 	virtual void FromJson(const Json &jsonObj, RefCountedPtr<Galaxy> galaxy) {}
 
 protected:
 	GalaxyGeneratorStage() :
-		m_galaxyGenerator(nullptr) {}
+		m_galaxyGenerator(nullptr),
+		m_timeCounter(nullptr),
+		m_runCounter(nullptr) {}
 
 	friend class GalaxyGenerator;
 	void AssignToGalaxyGenerator(GalaxyGenerator *galaxyGenerator) { m_galaxyGenerator = galaxyGenerator; }
 
 	GalaxyGenerator *m_galaxyGenerator;
+
+private:
+	Perf::Stats::CounterRef m_timeCounter;
+	Perf::Stats::CounterRef m_runCounter;
 };
 
 class SectorGeneratorStage : public GalaxyGeneratorStage {
@@ -124,6 +151,8 @@ public:
 	virtual ~StarSystemGeneratorStage() {}
 
 	virtual bool Apply(Random &rng, RefCountedPtr<Galaxy> galaxy, RefCountedPtr<StarSystem::GeneratorAPI> system, GalaxyGenerator::StarSystemConfig *config) = 0;
+	// the part of Apply left out while the system had no detail
+	virtual void ApplyDetail(RefCountedPtr<Galaxy> galaxy, RefCountedPtr<StarSystem::GeneratorAPI> system) {}
 };
 
 #endif
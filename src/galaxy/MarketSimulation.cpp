@@ -0,0 +1,190 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "galaxy/MarketSimulation.h"
+
+#include "GameSaveError.h"
+#include "Json.h"
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace GalacticEconomy {
+
+	// value, in credits, of a station's usual stock of any one commodity
+	static const float STOCK_VALUE = 20000.0f;
+	static const float MIN_STOCK = 5.0f;
+	static const float MAX_STOCK = 2000.0f;
+	// alteration at which a station holds nothing and wants double, or the reverse
+	static const float FULL_ALTERATION = 50.0f;
+
+	MarketSimulation::MarketSimulation(size_t numCommodities) :
+		m_numCommodities(numCommodities),
+		m_capacity(0)
+	{
+	}
+
+	MarketSimulation::Equilibrium MarketSimulation::GetEquilibrium(float basePrice, int priceModPercent, bool legal)
+	{
+		Equilibrium eq;
+		eq.price = basePrice * (1.0f + float(priceModPercent) * 0.01f);
+		if (!legal)
+			return eq;
+
+		// cheap goods come by the container load. a commodity the economy
+		// is short of is scarce and sought after, a surplus the other way
+		const float usual = std::clamp(STOCK_VALUE / std::max(std::abs(basePrice), 1.0f), MIN_STOCK, MAX_STOCK);
+		const float scarcity = std::clamp(float(priceModPercent) / FULL_ALTERATION, -1.0f, 1.0f);
+		eq.stock = std::floor(usual * (1.0f - scarcity));
+		eq.demand = std::floor(usual * (1.0f + scarcity));
+		return eq;
+	}
+
+	void MarketSimulation::Clear()
+	{
+		m_capacity = 0;
+		m_stations.clear();
+		for (std::vector<float> *v : { &m_stock, &m_demand, &m_price, &m_eqStock, &m_eqDemand, &m_eqPrice })
+			v->clear();
+	}
+
+	void MarketSimulation::Reserve(size_t capacity)
+	{
+		if (capacity <= m_capacity)
+			return;
+
+		// rows keep their commodity order, each padded out to the new width
+		for (std::vector<float> *v : { &m_stock, &m_demand, &m_price, &m_eqStock, &m_eqDemand, &m_eqPrice }) {
+			std::vector<float> grown(m_numCommodities * capacity, 0.0f);
+			for (size_t id = 0; id < m_numCommodities; id++)
+				std::copy_n(v->begin() + id * m_capacity, m_stations.size(), grown.begin() + id * capacity);
+			v->swap(grown);
+		}
+		m_capacity = capacity;
+	}
+
+	size_t MarketSimulation::AddMarket(const SystemPath &station, const std::vector<Equilibrium> &levels)
+	{
+		if (m_stations.size() == m_capacity)
+			Reserve(std::max<size_t>(8, m_capacity * 2));
+
+		const size_t market = m_stations.size();
+		m_stations.push_back(station);
+
+		// the invalid commodity stays at zero
+		for (size_t id = 1; id < std::min(levels.size(), m_numCommodities); id++) {
+			const size_t i = Index(market, CommodityId(id));
+			m_stock[i] = m_eqStock[i] = levels[id].stock;
+			m_demand[i] = m_eqDemand[i] = levels[id].demand;
+			m_price[i] = m_eqPrice[i] = levels[id].price;
+		}
+		return market;
+	}
+
+	size_t MarketSimulation::FindMarket(const SystemPath &station) const
+	{
+		for (size_t market = 0; market < m_stations.size(); market++) {
+			if (m_stations[market] == station)
+				return market;
+		}
+		return SIZE_MAX;
+	}
+
+	void MarketSimulation::UpdatePrices(size_t first, size_t last)
+	{
+		const float *stock = m_stock.data();
+		const float *demand = m_demand.data();
+		const float *eqStock = m_eqStock.data();
+		const float *eqDemand = m_eqDemand.data();
+		const float *eqPrice = m_eqPrice.data();
+		float *price = m_price.data();
+
+		// shortfall in stock and excess of demand, each relative to what's usual
+		for (size_t i = first; i < last; i++) {
+			const float shortage = (eqStock[i] - stock[i]) / (eqStock[i] + 1.0f) + (demand[i] - eqDemand[i]) / (eqDemand[i] + 1.0f);
+			const float factor = 1.0f + 0.5f * PRICE_ELASTICITY * shortage;
+			price[i] = eqPrice[i] * std::min(std::max(factor, MIN_PRICE_FACTOR), MAX_PRICE_FACTOR);
+		}
+	}
+
+	void MarketSimulation::Update(double step)
+	{
+		PROFILE_SCOPED()
+		if (m_stations.empty() || step <= 0.0)
+			return;
+
+		// exact for any step, so time acceleration doesn't overshoot
+		const float recovery = float(1.0 - std::exp(-step / RECOVERY_TIME));
+
+		// the padding past the last market is all zeros and stays that way,
+		// so every array is stepped whole
+		const size_t count = m_stock.size();
+		float *stock = m_stock.data();
+		float *demand = m_demand.data();
+		const float *eqStock = m_eqStock.data();
+		const float *eqDemand = m_eqDemand.data();
+		for (size_t i = 0; i < count; i++) {
+			stock[i] += (eqStock[i] - stock[i]) * recovery;
+			demand[i] += (eqDemand[i] - demand[i]) * recovery;
+		}
+		UpdatePrices(0, count);
+	}
+
+	void MarketSimulation::AddStock(size_t market, CommodityId id, float stock, float demand)
+	{
+		const size_t i = Index(market, id);
+		m_stock[i] = std::max(m_stock[i] + stock, 0.0f);
+		m_demand[i] = std::max(m_demand[i] + demand, 0.0f);
+		UpdatePrices(i, i + 1);
+	}
+
+	void MarketSimulation::SaveToJson(Json &jsonObj) const
+	{
+		Json marketArray = Json::array();
+		for (size_t market = 0; market < m_stations.size(); market++) {
+			Json marketObj({});
+			m_stations[market].ToJson(marketObj);
+
+			Json stockArray = Json::array();
+			Json demandArray = Json::array();
+			for (size_t id = 0; id < m_numCommodities; id++) {
+				stockArray.push_back(m_stock[Index(market, CommodityId(id))]);
+				demandArray.push_back(m_demand[Index(market, CommodityId(id))]);
+			}
+			marketObj["stock"] = stockArray;
+			marketObj["demand"] = demandArray;
+			marketArray.push_back(marketObj);
+		}
+		jsonObj["markets"] = marketArray;
+	}
+
+	void MarketSimulation::LoadFromJson(const Json &jsonObj)
+	{
+		// saves from before the markets were simulated start at equilibrium
+		if (!jsonObj.count("markets"))
+			return;
+
+		try {
+			for (const Json &marketObj : jsonObj["markets"]) {
+				const size_t market = FindMarket(SystemPath::FromJson(marketObj));
+				if (market == SIZE_MAX)
+					continue;
+
+				const Json &stockArray = marketObj["stock"];
+				const Json &demandArray = marketObj["demand"];
+				const size_t count = std::min({ stockArray.size(), demandArray.size(), m_numCommodities });
+				for (size_t id = 1; id < count; id++) {
+					const size_t i = Index(market, CommodityId(id));
+					m_stock[i] = stockArray[id];
+					m_demand[i] = demandArray[id];
+				}
+			}
+		} catch (Json::type_error &) {
+			throw SavedGameCorruptException();
+		}
+		UpdatePrices(0, m_price.size());
+	}
+
+} // namespace GalacticEconomy
@@ -0,0 +1,100 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef GALAXY_MARKETSIMULATION_H
+#define GALAXY_MARKETSIMULATION_H
+
+#include "galaxy/Economy.h"
+#include "JsonFwd.h"
+#include "galaxy/SystemPath.h"
+
+#include <vector>
+
+namespace GalacticEconomy {
+
+	/*
+	 * Commodity markets of a set of stations, stepped together.
+	 *
+	 * Each commodity at each market has a stock the station holds, a demand
+	 * it wants to buy, and the levels both return to when left alone. Trading
+	 * moves stock and demand away from those levels, time brings them back,
+	 * and prices follow the difference.
+	 *
+	 * The state is kept in one dense array per quantity, laid out by commodity
+	 * and then by market, so a step is a single branch free pass over
+	 * contiguous floats the compiler can vectorise, however many stations
+	 * there are.
+	 */
+	class MarketSimulation {
+	public:
+		// the levels a commodity settles at in one market
+		struct Equilibrium {
+			float price = 0.0f;
+			float stock = 0.0f;
+			float demand = 0.0f;
+		};
+
+		// numCommodities is one more than the highest CommodityId,
+		// with InvalidCommodityId always empty
+		explicit MarketSimulation(size_t numCommodities);
+
+		// equilibrium for a commodity of the given base price, altered by
+		// an economy's percentage as StarSystem::GetCommodityBasePriceModPercent
+		static Equilibrium GetEquilibrium(float basePrice, int priceModPercent, bool legal);
+
+		void Clear();
+
+		// returns the index of the new market, which starts at equilibrium
+		size_t AddMarket(const SystemPath &station, const std::vector<Equilibrium> &levels);
+		// SIZE_MAX if there's no market for the station
+		size_t FindMarket(const SystemPath &station) const;
+
+		size_t GetNumMarkets() const { return m_stations.size(); }
+		size_t GetNumCommodities() const { return m_numCommodities; }
+		const SystemPath &GetStation(size_t market) const { return m_stations[market]; }
+
+		// seconds of game time
+		void Update(double step);
+
+		float GetStock(size_t market, CommodityId id) const { return m_stock[Index(market, id)]; }
+		float GetDemand(size_t market, CommodityId id) const { return m_demand[Index(market, id)]; }
+		float GetPrice(size_t market, CommodityId id) const { return m_price[Index(market, id)]; }
+
+		// a trade, or anything else that moves the market; the price
+		// reflects it immediately
+		void AddStock(size_t market, CommodityId id, float stock, float demand);
+
+		// the stock and demand of the markets, restored into matching
+		// markets already added
+		void SaveToJson(Json &jsonObj) const;
+		void LoadFromJson(const Json &jsonObj);
+
+	private:
+		// time for stock and demand to recover two thirds of the way to equilibrium
+		static constexpr double RECOVERY_TIME = 7.0 * 24.0 * 60.0 * 60.0;
+		// relative price rise at a market that has sold out and wants twice
+		// its usual amount
+		static constexpr float PRICE_ELASTICITY = 0.5f;
+		static constexpr float MIN_PRICE_FACTOR = 0.5f;
+		static constexpr float MAX_PRICE_FACTOR = 2.0f;
+
+		size_t Index(size_t market, CommodityId id) const { return size_t(id) * m_capacity + market; }
+		void Reserve(size_t capacity);
+		void UpdatePrices(size_t first, size_t last);
+
+		size_t m_numCommodities;
+		size_t m_capacity;
+		std::vector<SystemPath> m_stations;
+
+		// per commodity, per market
+		std::vector<float> m_stock;
+		std::vector<float> m_demand;
+		std::vector<float> m_price;
+		std::vector<float> m_eqStock;
+		std::vector<float> m_eqDemand;
+		std::vector<float> m_eqPrice;
+	};
+
+} // namespace GalacticEconomy
+
+#endif
@@ -4,19 +4,15 @@
 #include "NameGenerator.h"
 #include "utils.h"
 
-void NameGenerator::GetSystemName(std::string &name, Random &rng)
-{
-	int nameGen = rng.Int32(0, 3);
-	switch (nameGen) {
-	case 0: FrontierNames::GetName(name, rng); break;
-	case 1: HybridNames::GetName(name, rng); break;
-	case 2: Doomdark::GetName(name, rng); break;
-	case 3: Katakana::GetName(name, rng); break;
-	default:
-		FrontierNames::GetName(name, rng);
-		break;
-	}
-}
+namespace {
+	// stands in for the name when only the draws matter, so skipping a name
+	// takes exactly the numbers from the sequence building it would
+	struct NoName {
+		NoName &operator+=(const char *) { return *this; }
+		char &operator[](size_t) { return c; }
+		char c;
+	};
+} // namespace
 
 namespace FrontierNames {
 	static const char *sys_names[] = {
@@ -32,7 +28,8 @@ namespace FrontierNames {
 	};
 	static const unsigned int SYS_NAME_FRAGS = ((unsigned int)(sizeof(sys_names) / sizeof(char *)));
 
-	void GetName(std::string &name, Random &rng)
+	template <typename Name>
+	static void BuildName(Name &name, Random &rng)
 	{
 		// add fragments to build a name
 		int len = rng.Int32(2, 3);
@@ -42,6 +39,11 @@ namespace FrontierNames {
 
 		name[0] = toupper(name[0]);
 	}
+
+	void GetName(std::string &name, Random &rng)
+	{
+		BuildName(name, rng);
+	}
 } // namespace FrontierNames
 
 namespace HybridNames {
@@ -78,7 +80,8 @@ namespace HybridNames {
 	};
 	static const unsigned int SYS_NAME_FRAGS = ((unsigned int)(sizeof(sys_names) / sizeof(char *)));
 
-	void GetName(std::string &name, Random &rng)
+	template <typename Name>
+	static void BuildName(Name &name, Random &rng)
 	{
 		// add fragments to build a name
 		int len = rng.Int32(2, 3);
@@ -88,6 +91,11 @@ namespace HybridNames {
 
 		name[0] = toupper(name[0]);
 	}
+
+	void GetName(std::string &name, Random &rng)
+	{
+		BuildName(name, rng);
+	}
 } // namespace HybridNames
 
 namespace Doomdark {
@@ -107,7 +115,8 @@ namespace Doomdark {
 	};
 	static const unsigned int SUFFIX_FRAGS = ((unsigned int)(sizeof(Suffixes) / sizeof(char *)));
 
-	void GetName(std::string &name, Random &rng)
+	template <typename Name>
+	static void BuildName(Name &name, Random &rng)
 	{
 		// Doodarken a name
 		name += Prefixes[rng.Int32(0, PREFIX_FRAGS - 1)];
@@ -116,6 +125,11 @@ namespace Doomdark {
 
 		name[0] = toupper(name[0]);
 	}
+
+	void GetName(std::string &name, Random &rng)
+	{
+		BuildName(name, rng);
+	}
 } // namespace Doomdark
 
 namespace Katakana {
@@ -160,7 +174,8 @@ namespace Katakana {
 	static const unsigned int NUM_MIDDLE_FRAGS = COUNTOF(MiddleFragments);
 	static const unsigned int NUM_END_FRAGS = COUNTOF(EndFragments);
 
-	void GetName(std::string &name, Random &rng)
+	template <typename Name>
+	static void BuildName(Name &name, Random &rng)
 	{
 		// beginning
 		name += StartFragments[rng.Int32(0, NUM_START_FRAGS - 1)];
@@ -177,4 +192,35 @@ namespace Katakana {
 		// Capitalisation
 		name[0] = toupper(name[0]);
 	}
+
+	void GetName(std::string &name, Random &rng)
+	{
+		BuildName(name, rng);
+	}
 } // namespace Katakana
+
+template <typename Name>
+static void BuildSystemName(Name &name, Random &rng)
+{
+	int nameGen = rng.Int32(0, 3);
+	switch (nameGen) {
+	case 0: FrontierNames::BuildName(name, rng); break;
+	case 1: HybridNames::BuildName(name, rng); break;
+	case 2: Doomdark::BuildName(name, rng); break;
+	case 3: Katakana::BuildName(name, rng); break;
+	default:
+		FrontierNames::BuildName(name, rng);
+		break;
+	}
+}
+
+void NameGenerator::GetSystemName(std::string &name, Random &rng)
+{
+	BuildSystemName(name, rng);
+}
+
+void NameGenerator::SkipSystemName(Random &rng)
+{
+	NoName name;
+	BuildSystemName(name, rng);
+}
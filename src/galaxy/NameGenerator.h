@@ -8,6 +8,8 @@
 
 namespace NameGenerator {
 	void GetSystemName(std::string &name, Random &rng);
+	// takes the same numbers from rng as GetSystemName, without the name
+	void SkipSystemName(Random &rng);
 }
 
 namespace FrontierNames {
@@ -0,0 +1,262 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "RoutePlanner.h"
+
+#include "Galaxy.h"
+#include "GalaxyCache.h"
+#include "GalaxyGenerator.h"
+#include "MathUtil.h"
+#include "Sector.h"
+#include "core/Log.h"
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <queue>
+
+RoutePlanner::JumpCost::JumpCost(float maxRange, std::vector<float> samples) :
+	m_maxRange(maxRange),
+	m_samples(std::move(samples))
+{
+	assert(m_samples.size() >= 2);
+	m_step = m_maxRange / float(m_samples.size() - 1);
+
+	// between samples the cost is linear, so its cost per light year is
+	// lowest at one of the samples
+	m_minCostPerLy = std::numeric_limits<float>::infinity();
+	for (size_t i = 1; i < m_samples.size(); i++)
+		m_minCostPerLy = std::min(m_minCostPerLy, m_samples[i] / (m_step * float(i)));
+	if (!(m_minCostPerLy > 0.0f))
+		m_minCostPerLy = 0.0f;
+}
+
+float RoutePlanner::JumpCost::operator()(float distance) const
+{
+	const float s = std::max(0.0f, distance / m_step);
+	const size_t i = std::min(size_t(s), m_samples.size() - 2);
+	const float t = std::min(s - float(i), 1.0f);
+	return m_samples[i] + (m_samples[i + 1] - m_samples[i]) * t;
+}
+
+RoutePlanner::RoutePlanner(float cellSize, SectorSource source) :
+	m_cellSize(cellSize),
+	m_source(std::move(source)),
+	m_numSettled(0)
+{
+}
+
+const RoutePlanner::Cell &RoutePlanner::LoadCell(const SystemPath &sector)
+{
+	auto it = m_cells.find(sector);
+	if (it != m_cells.end())
+		return it->second;
+
+	Cell cell;
+	cell.first = m_nodes.size();
+	m_source(sector.SectorOnly(), m_nodes);
+	cell.count = m_nodes.size() - cell.first;
+	return m_cells.insert(std::make_pair(sector.SectorOnly(), cell)).first->second;
+}
+
+size_t RoutePlanner::FindNode(const SystemPath &path)
+{
+	const Cell cell = LoadCell(path);
+	for (Uint32 i = cell.first; i < cell.first + cell.count; i++) {
+		if (m_nodes[i].path.IsSameSystem(path))
+			return i;
+	}
+	return SIZE_MAX;
+}
+
+template <typename F>
+void RoutePlanner::ForEachNeighbour(size_t node, float range, F &&fn)
+{
+	// copied, loading a cell may move the nodes
+	const System from = m_nodes[node];
+	const float rangeSqr = range * range;
+	const int reach = int(std::ceil(range / m_cellSize));
+
+	for (int dx = -reach; dx <= reach; dx++) {
+		for (int dy = -reach; dy <= reach; dy++) {
+			for (int dz = -reach; dz <= reach; dz++) {
+				const SystemPath sector(from.path.sectorX + dx, from.path.sectorY + dy, from.path.sectorZ + dz);
+
+				// skip cells whose nearest point is out of range
+				const vector3f cellMin = m_cellSize * vector3f(float(sector.sectorX), float(sector.sectorY), float(sector.sectorZ));
+				const vector3f nearest(
+					Clamp(from.pos.x, cellMin.x, cellMin.x + m_cellSize),
+					Clamp(from.pos.y, cellMin.y, cellMin.y + m_cellSize),
+					Clamp(from.pos.z, cellMin.z, cellMin.z + m_cellSize));
+				if ((nearest - from.pos).LengthSqr() > rangeSqr)
+					continue;
+
+				const Cell cell = LoadCell(sector);
+				for (Uint32 i = cell.first; i < cell.first + cell.count; i++) {
+					const float distSqr = (m_nodes[i].pos - from.pos).LengthSqr();
+					if (i != node && distSqr <= rangeSqr)
+						fn(size_t(i), std::sqrt(distSqr));
+				}
+			}
+		}
+	}
+}
+
+bool RoutePlanner::FindRoute(const SystemPath &start, const SystemPath &target, const JumpCost &cost,
+	std::vector<SystemPath> &outRoute, size_t maxSettled)
+{
+	PROFILE_SCOPED()
+	m_numSettled = 0;
+
+	const size_t startNode = FindNode(start);
+	const size_t targetNode = FindNode(target);
+	if (startNode == SIZE_MAX || targetNode == SIZE_MAX || cost.GetMaxRange() <= 0.0f)
+		return false;
+	if (startNode == targetNode) {
+		outRoute.push_back(m_nodes[targetNode].path);
+		return true;
+	}
+
+	const float INF = std::numeric_limits<float>::infinity();
+	const Uint32 NONE = std::numeric_limits<Uint32>::max();
+	const float costPerLy = cost.GetMinCostPerLy();
+
+	typedef std::pair<float, Uint32> OpenEntry;
+	typedef std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> OpenList;
+
+	// one per direction, 0 searching forwards from start and 1 backwards from target;
+	// the per node vectors grow as the graph does
+	struct Search {
+		vector3f goal;
+		OpenList open;
+		std::vector<float> g;
+		std::vector<Uint32> prev;
+		std::vector<bool> closed;
+
+		void Grow(size_t n)
+		{
+			if (g.size() < n) {
+				g.resize(n, std::numeric_limits<float>::infinity());
+				prev.resize(n, std::numeric_limits<Uint32>::max());
+				closed.resize(n, false);
+			}
+		}
+
+		// drops entries of nodes settled since they were pushed
+		void Prune()
+		{
+			while (!open.empty() && closed[open.top().second])
+				open.pop();
+		}
+	} search[2];
+
+	search[0].goal = m_nodes[targetNode].pos;
+	search[1].goal = m_nodes[startNode].pos;
+	const size_t ends[2] = { startNode, targetNode };
+	for (int d = 0; d < 2; d++) {
+		Search &s = search[d];
+		s.Grow(m_nodes.size());
+		s.g[ends[d]] = 0.0f;
+		s.open.push(OpenEntry(costPerLy * (m_nodes[ends[d]].pos - s.goal).Length(), Uint32(ends[d])));
+	}
+
+	// the cheapest complete route seen so far goes through meet
+	float best = INF;
+	size_t meet = SIZE_MAX;
+
+	while (m_numSettled < maxSettled) {
+		search[0].Prune();
+		search[1].Prune();
+		// either side running dry means everything reachable from its end has been searched
+		if (search[0].open.empty() || search[1].open.empty())
+			break;
+		// with a consistent heuristic, nothing left on either side can beat the best route
+		if (search[0].open.top().first >= best || search[1].open.top().first >= best)
+			break;
+
+		// expand the smaller frontier, which keeps the two roughly balanced
+		const int d = search[0].open.size() <= search[1].open.size() ? 0 : 1;
+		Search &s = search[d];
+		Search &other = search[1 - d];
+
+		const size_t u = s.open.top().second;
+		s.open.pop();
+		s.closed[u] = true;
+		m_numSettled++;
+
+		const float gU = s.g[u];
+		ForEachNeighbour(u, cost.GetMaxRange(), [&](size_t v, float dist) {
+			s.Grow(m_nodes.size());
+			other.Grow(m_nodes.size());
+			if (s.closed[v])
+				return;
+
+			const float gV = gU + cost(dist);
+			if (gV >= s.g[v])
+				return;
+
+			s.g[v] = gV;
+			s.prev[v] = Uint32(u);
+			s.open.push(OpenEntry(gV + costPerLy * (m_nodes[v].pos - s.goal).Length(), Uint32(v)));
+
+			if (other.g[v] < INF && gV + other.g[v] < best) {
+				best = gV + other.g[v];
+				meet = v;
+			}
+		});
+	}
+
+	if (meet == SIZE_MAX)
+		return false;
+
+	// walk back to start from the meeting point, then on to target
+	const size_t first = outRoute.size();
+	for (Uint32 n = search[0].prev[meet]; n != NONE && n != startNode; n = search[0].prev[n])
+		outRoute.push_back(m_nodes[n].path);
+	std::reverse(outRoute.begin() + first, outRoute.end());
+
+	for (Uint32 n = Uint32(meet); n != NONE; n = search[1].prev[n])
+		outRoute.push_back(m_nodes[n].path);
+
+	// a meeting point on the start itself
+	if (outRoute.size() > first && outRoute[first].IsSameSystem(start))
+		outRoute.erase(outRoute.begin() + first);
+	return true;
+}
+
+RoutePlannerJob::RoutePlannerJob(RefCountedPtr<Galaxy> galaxy, const SystemPath &start, const SystemPath &target,
+	const RoutePlanner::JumpCost &cost, ResultCallback callback) :
+	m_galaxy(galaxy),
+	m_start(start),
+	m_target(target),
+	m_cost(cost),
+	m_callback(std::move(callback)),
+	m_found(false)
+{
+}
+
+//virtual
+void RoutePlannerJob::OnRun() // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
+{
+	PROFILE_SCOPED()
+	RefCountedPtr<GalaxyGenerator> generator = m_galaxy->GetGenerator();
+	RoutePlanner planner(Sector::SIZE, [&](const SystemPath &sector, std::vector<RoutePlanner::System> &systems) {
+		// not the sector cache, that belongs to the main thread
+		RefCountedPtr<Sector> sec = generator->Generate<Sector, SectorCache>(m_galaxy, sector, nullptr);
+		for (const Sector::System &sys : sec->m_systems)
+			systems.push_back({ sys.GetPath(), sys.GetFullPosition() });
+	});
+	m_found = planner.FindRoute(m_start, m_target, m_cost, m_route);
+	Output("RoutePlannerJob: %s after settling %zu systems in %zu sectors\n", m_found ? "found a route" : "no route",
+		planner.GetNumSettled(), planner.GetNumLoadedSectors());
+}
+
+//virtual
+void RoutePlannerJob::OnFinish() // runs in primary thread of the context
+{
+	if (m_callback)
+		m_callback(m_found, m_route);
+}
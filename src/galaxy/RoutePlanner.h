@@ -0,0 +1,117 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _ROUTEPLANNER_H
+#define _ROUTEPLANNER_H
+
+#include "JobQueue.h"
+#include "RefCounted.h"
+#include "galaxy/SystemPath.h"
+#include "galaxy/SystemPathHashMap.h"
+#include "vector3.h"
+
+#include <functional>
+#include <vector>
+
+class Galaxy;
+
+/*
+ * Finds the quickest chain of hyperjumps between two systems.
+ *
+ * The jump graph is built lazily: a sector's systems are only asked for when
+ * the search first reaches a system within jump range of it, and kept in a
+ * grid of one cell per sector so the neighbours of a system are the systems
+ * of the few cells around it that are in range.
+ *
+ * The search is a bidirectional A*, run from both ends at once with the
+ * straight line distance times the cheapest cost per light year of any jump
+ * as the heuristic. Jump costs are sampled up front (see JumpCost) so that a
+ * search needs nothing from Lua and can run on a worker thread.
+ */
+class RoutePlanner {
+public:
+	struct System {
+		SystemPath path;
+		vector3f pos; // in light years from the galactic origin
+	};
+
+	// appends the systems of a sector, in system index order
+	typedef std::function<void(const SystemPath &sector, std::vector<System> &systems)> SectorSource;
+
+	// the cost of a single jump by its length, interpolated from samples
+	// taken at even steps from zero to the maximum range
+	class JumpCost {
+	public:
+		JumpCost(float maxRange, std::vector<float> samples);
+
+		float GetMaxRange() const { return m_maxRange; }
+		// a lower bound on the cost of travelling a light year by any jumps
+		float GetMinCostPerLy() const { return m_minCostPerLy; }
+
+		float operator()(float distance) const;
+
+	private:
+		float m_maxRange;
+		float m_step;
+		float m_minCostPerLy;
+		std::vector<float> m_samples;
+	};
+
+	// cellSize is the side of a sector, in light years
+	RoutePlanner(float cellSize, SectorSource source);
+
+	// the systems after start up to and including target, or false if there
+	// is no route, or none was found before maxSettled systems were searched
+	bool FindRoute(const SystemPath &start, const SystemPath &target, const JumpCost &cost,
+		std::vector<SystemPath> &outRoute, size_t maxSettled = 200000);
+
+	size_t GetNumLoadedSectors() const { return m_cells.size(); }
+	// systems settled by the last FindRoute, from both ends
+	size_t GetNumSettled() const { return m_numSettled; }
+
+private:
+	struct Cell {
+		Uint32 first = 0;
+		Uint32 count = 0;
+	};
+
+	const Cell &LoadCell(const SystemPath &sector);
+	// SIZE_MAX if the system doesn't exist
+	size_t FindNode(const SystemPath &path);
+	template <typename F>
+	void ForEachNeighbour(size_t node, float range, F &&fn);
+
+	float m_cellSize;
+	SectorSource m_source;
+	SystemPathHashMap<Cell, SystemPath::LessSectorOnly> m_cells;
+	std::vector<System> m_nodes;
+	size_t m_numSettled;
+};
+
+/*
+ * Runs a RoutePlanner search on the job queue, generating the sectors it
+ * needs directly from the galaxy generator as the sector cache jobs do.
+ * The callback is called on the main thread, unless the job is cancelled.
+ */
+class RoutePlannerJob : public Job {
+public:
+	typedef std::function<void(bool found, const std::vector<SystemPath> &route)> ResultCallback;
+
+	RoutePlannerJob(RefCountedPtr<Galaxy> galaxy, const SystemPath &start, const SystemPath &target,
+		const RoutePlanner::JumpCost &cost, ResultCallback callback);
+
+	virtual void OnRun() override;	  // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
+	virtual void OnFinish() override; // runs in primary thread of the context
+	virtual void OnCancel() override {}
+
+private:
+	RefCountedPtr<Galaxy> m_galaxy;
+	SystemPath m_start;
+	SystemPath m_target;
+	RoutePlanner::JumpCost m_cost;
+	ResultCallback m_callback;
+	bool m_found;
+	std::vector<SystemPath> m_route;
+};
+
+#endif /* _ROUTEPLANNER_H */
@@ -4,16 +4,31 @@
 #include "Sector.h"
 #include "CustomSystem.h"
 #include "Galaxy.h"
+#include "SectorGenerator.h"
 #include "StarSystem.h"
 
 #include "EnumStrings.h"
 #include "Factions.h"
+#include "MathUtil.h"
+#include "gameconsts.h"
 
 #include "core/StringUtils.h"
 #include "profiler/Profiler.h"
 
+#include <cmath>
+
 const float Sector::SIZE = 8.f;
 
+static_assert(SystemBody::TYPE_MAX <= 0xff, "star types are stored in a byte");
+
+namespace {
+	static const int POS_BITS = 21;
+	static const Uint64 POS_MASK = (Uint64(1) << POS_BITS) - 1;
+	static const float POS_SCALE = float(POS_MASK) / Sector::SIZE;
+
+	static const std::vector<std::string> s_noOtherNames;
+} // namespace
+
 //////////////////////// Sector
 
 Sector::Sector(RefCountedPtr<Galaxy> galaxy, const SystemPath &path, SectorCache *cache) :
@@ -23,6 +38,15 @@ Sector::Sector(RefCountedPtr<Galaxy> galaxy, const SystemPath &path, SectorCache
 	m_galaxy(galaxy),
 	m_cache(cache) {}
 
+void Sector::AssignFactions() const
+{
+	PROFILE_SCOPED()
+	assert(m_galaxy->GetFactions()->MayAssignFactions());
+	for (const System &sys : m_systems)
+		m_factionMask.Set(sys.GetFaction()->idx);
+	m_factionsAssigned = true;
+}
+
 Sector::~Sector()
 {
 	if (m_cache)
@@ -58,6 +82,12 @@ bool Sector::WithinBox(const int Xmin, const int Xmax, const int Ymin, const int
 	return false;
 }
 
+void Sector::SeedRandom(Random &rng) const
+{
+	const Uint32 _init[4] = { Uint32(sx), Uint32(sy), Uint32(sz), UNIVERSE_SEED };
+	rng.seed(_init, 4);
+}
+
 /*	answer whether the system path is in this sector
 */
 bool Sector::Contains(const SystemPath &sysPath) const
@@ -69,6 +99,47 @@ bool Sector::Contains(const SystemPath &sysPath) const
 	return true;
 }
 
+std::string Sector::System::GetName() const
+{
+	if (!m_nameDraw)
+		return std::string(m_name.sv());
+
+	// nothing's kept, so this is as safe from any thread as the rest
+	Random rng;
+	m_sector->SeedRandom(rng);
+	rng.Skip(m_nameDraw);
+	std::string name;
+	SectorRandomSystemsGenerator::GenName(&name, m_sector->m_galaxy, *m_sector, *this, rng);
+	return name;
+}
+
+const std::vector<std::string> &Sector::System::GetOtherNames() const
+{
+	return m_customSys ? m_customSys->other_names : s_noOtherNames;
+}
+
+vector3f Sector::System::GetPosition() const
+{
+	return vector3f(
+		float(m_pos & POS_MASK),
+		float((m_pos >> POS_BITS) & POS_MASK),
+		float((m_pos >> (2 * POS_BITS)) & POS_MASK)) /
+		POS_SCALE;
+}
+
+void Sector::System::SetPosition(const vector3f &pos)
+{
+	auto pack = [](float v) {
+		return Uint64(Clamp(std::round(v * POS_SCALE), 0.0f, float(POS_MASK)));
+	};
+	m_pos = pack(pos.x) | (pack(pos.y) << POS_BITS) | (pack(pos.z) << (2 * POS_BITS));
+}
+
+void Sector::System::SetName(std::string_view name)
+{
+	m_name = StringName(name);
+}
+
 void Sector::System::SetExplored(StarSystem::ExplorationState e, double time)
 {
 	if (e != m_explored) {
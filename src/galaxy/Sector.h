@@ -6,6 +6,8 @@
 
 #include "GalaxyCache.h"
 #include "RefCounted.h"
+#include "core/StringName.h"
+#include "galaxy/FactionMask.h"
 #include "galaxy/CustomSystem.h"
 #include "galaxy/StarSystem.h"
 #include "galaxy/SystemPath.h"
@@ -16,6 +18,7 @@
 
 class Faction;
 class Galaxy;
+class Random;
 
 class Sector : public RefCounted {
 	friend class GalaxyObjectCache<Sector, SystemPath::LessSectorOnly>;
@@ -36,6 +39,13 @@ public:
 	// get the SystemPath for this sector
 	SystemPath GetPath() const { return SystemPath(sx, sy, sz); }
 
+	// roughly, for the memory budget
+	size_t GetMemoryUsage() const { return sizeof(Sector) + m_systems.capacity() * sizeof(System); }
+
+	// The sector cache holds thousands of these, so they are kept small: the
+	// name is interned, or for random systems not kept at all, the position is fixed point within the sector, star
+	// types are packed into bytes and the other names of custom systems are
+	// read from the custom system rather than copied.
 	class System {
 	public:
 		System(Sector *sector, int x, int y, int z, Uint32 si) :
@@ -44,27 +54,30 @@ public:
 			sz(z),
 			idx(si),
 			m_sector(sector),
-			m_numStars(0),
+			m_pos(0),
 			m_seed(0),
+			m_numStars(0),
+			m_starType{},
+			m_explored(StarSystem::eUNEXPLORED),
+			m_nameDraw(0),
 			m_customSys(nullptr),
 			m_faction(nullptr),
 			m_population(-1),
-			m_explored(StarSystem::eUNEXPLORED),
 			m_exploredTime(0.0) {}
 
 		static float DistanceBetween(const System *a, const System *b);
 
 		// Check that we've had our habitation status set
 
-		const std::string &GetName() const { return m_name; }
-		const std::vector<std::string> &GetOtherNames() const { return m_other_names; }
-		const vector3f &GetPosition() const { return m_pos; }
-		vector3f GetFullPosition() const { return Sector::SIZE * vector3f(float(sx), float(sy), float(sz)) + m_pos; };
+		std::string GetName() const;
+		const std::vector<std::string> &GetOtherNames() const;
+		vector3f GetPosition() const;
+		vector3f GetFullPosition() const { return Sector::SIZE * vector3f(float(sx), float(sy), float(sz)) + GetPosition(); };
 		unsigned GetNumStars() const { return m_numStars; }
 		SystemBody::BodyType GetStarType(unsigned i) const
 		{
 			assert(i < m_numStars);
-			return m_starType[i];
+			return SystemBody::BodyType(m_starType[i]);
 		}
 		Uint32 GetSeed() const { return m_seed; }
 		const CustomSystem *GetCustomSystem() const { return m_customSys; }
@@ -75,7 +88,7 @@ public:
 		}
 		fixed GetPopulation() const { return m_population; }
 		void SetPopulation(fixed pop) { m_population = pop; }
-		StarSystem::ExplorationState GetExplored() const { return m_explored; }
+		StarSystem::ExplorationState GetExplored() const { return StarSystem::ExplorationState(m_explored); }
 		double GetExploredTime() const { return m_exploredTime; }
 		bool IsExplored() const { return m_explored != StarSystem::eUNEXPLORED; }
 		void SetExplored(StarSystem::ExplorationState e, double time);
@@ -95,23 +108,28 @@ public:
 
 	private:
 		friend class Sector;
+		friend class SectorBakedSystemsGenerator;
 		friend class SectorCustomSystemsGenerator;
 		friend class SectorRandomSystemsGenerator;
 		friend class SectorPersistenceGenerator;
 
 		void AssignFaction() const;
+		void SetName(std::string_view name);
+		void SetPosition(const vector3f &pos);
 
 		Sector *m_sector;
-		std::string m_name;
-		std::vector<std::string> m_other_names;
-		vector3f m_pos;
-		unsigned m_numStars;
-		SystemBody::BodyType m_starType[4];
+		StringName m_name;
+		Uint64 m_pos; // 21 bits per axis, 0 to Sector::SIZE
 		Uint32 m_seed;
+		Uint8 m_numStars;
+		Uint8 m_starType[4]; // SystemBody::BodyType
+		Uint8 m_explored;	 // StarSystem::ExplorationState
+		// where in the sector's random sequence the name starts, for a name
+		// drawn again each time it's asked for; 0 if m_name holds it
+		Uint32 m_nameDraw;
 		const CustomSystem *m_customSys;
 		mutable const Faction *m_faction; // mutable because we only calculate on demand
 		fixed m_population;
-		StarSystem::ExplorationState m_explored;
 		double m_exploredTime;
 	};
 	std::vector<System> m_systems;
@@ -119,6 +137,17 @@ public:
 
 	void Dump(FILE *file, const char *indent = "") const;
 
+	// seeds rng as it is at the start of the sector's generation
+	void SeedRandom(Random &rng) const;
+
+	// the factions owning the sector's systems; the sector cache works this
+	// out as the sector is generated, otherwise it is done here on demand
+	const FactionMask &GetFactionMask() const
+	{
+		if (!m_factionsAssigned) AssignFactions();
+		return m_factionMask;
+	}
+
 	sigc::signal<void, Sector::System *, StarSystem::ExplorationState, double> onSetExplorationState;
 
 private:
@@ -136,6 +165,10 @@ private:
 		m_cache = cache;
 	}
 	// sets appropriate factions for all systems in the sector
+	void AssignFactions() const;
+
+	mutable FactionMask m_factionMask; // mutable because we only calculate on demand
+	mutable bool m_factionsAssigned = false;
 };
 
 #endif /* _SECTOR_H */
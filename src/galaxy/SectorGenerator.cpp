@@ -3,6 +3,7 @@
 
 #include "SectorGenerator.h"
 
+#include "BakedGalaxy.h"
 #include "CustomSystem.h"
 #include "DateTime.h"
 #include "Factions.h"
@@ -14,8 +15,62 @@
 
 #define Square(x) ((x) * (x))
 
+bool SectorBakedSystemsGenerator::Apply(Random &rng, RefCountedPtr<Galaxy> galaxy, RefCountedPtr<Sector> sector, GalaxyGenerator::SectorConfig *config)
+{
+	const BakedGalaxy *baked = galaxy->GetBakedGalaxy();
+	if (!baked)
+		return true;
+
+	const int sx = sector->sx;
+	const int sy = sector->sy;
+	const int sz = sector->sz;
+	Uint32 first, count;
+	if (!baked->FindSector(sx, sy, sz, first, count))
+		return true;
+
+	// custom systems come first, if they changed since the bake the sector is generated as usual
+	const std::vector<const CustomSystem *> &customs = galaxy->GetCustomSystems()->GetCustomSystemsForSector(sx, sy, sz);
+	Uint32 numCustom = 0;
+	while (numCustom < count && baked->IsCustom(first + numCustom))
+		numCustom++;
+	if (numCustom != customs.size())
+		return true;
+	for (Uint32 i = 0; i < numCustom; i++) {
+		if (customs[i]->name != baked->GetName(first + i))
+			return true;
+	}
+	for (Uint32 i = 0; i < count; i++) {
+		const Uint32 factionIdx = baked->GetFactionIndex(first + i);
+		if (factionIdx != Faction::BAD_FACTION_IDX && factionIdx >= galaxy->GetFactions()->GetNumFactions())
+			return true;
+	}
+
+	sector->m_systems.reserve(count);
+	for (Uint32 i = 0; i < count; i++) {
+		const Uint32 bi = first + i;
+		Sector::System s(sector.Get(), sx, sy, sz, i);
+		s.SetPosition(baked->GetPosition(bi));
+		s.SetName(baked->GetName(bi));
+		for (s.m_numStars = 0; s.m_numStars < baked->GetNumStars(bi); s.m_numStars++)
+			s.m_starType[s.m_numStars] = baked->GetStarType(bi, s.m_numStars);
+		s.m_seed = baked->GetSeed(bi);
+		if (i < numCustom)
+			s.m_customSys = customs[i];
+		s.m_faction = galaxy->GetFactions()->GetFaction(baked->GetFactionIndex(bi));
+		s.m_population = baked->GetPopulation(bi);
+		s.m_explored = baked->IsExplored(bi) ? StarSystem::eEXPLORED_AT_START : StarSystem::eUNEXPLORED;
+		sector->m_systems.push_back(s);
+	}
+
+	config->isBaked = true;
+	return true;
+}
+
 bool SectorCustomSystemsGenerator::Apply(Random &rng, RefCountedPtr<Galaxy> galaxy, RefCountedPtr<Sector> sector, GalaxyGenerator::SectorConfig *config)
 {
+	if (config->isBaked)
+		return true;
+
 	const int sx = sector->sx;
 	const int sy = sector->sy;
 	const int sz = sector->sz;
@@ -33,9 +88,8 @@ bool SectorCustomSystemsGenerator::Apply(Random &rng, RefCountedPtr<Galaxy> gala
 	for (std::vector<const CustomSystem *>::const_iterator it = systems.begin(); it != systems.end(); ++it, ++sysIdx) {
 		const CustomSystem *cs = *it;
 		Sector::System s(sector.Get(), sx, sy, sz, sysIdx);
-		s.m_pos = cs->pos;
-		s.m_name = cs->name;
-		s.m_other_names = cs->other_names;
+		s.SetPosition(cs->pos);
+		s.SetName(cs->name);
 		for (s.m_numStars = 0; s.m_numStars < cs->numStars; s.m_numStars++) {
 			if (cs->primaryType[s.m_numStars] == 0) break;
 			s.m_starType[s.m_numStars] = cs->primaryType[s.m_numStars];
@@ -64,9 +118,9 @@ bool SectorCustomSystemsGenerator::Apply(Random &rng, RefCountedPtr<Galaxy> gala
 	return true;
 }
 
-const std::string SectorRandomSystemsGenerator::GenName(RefCountedPtr<Galaxy> galaxy, const Sector &sec, Sector::System &sys, int si, Random &rng)
+void SectorRandomSystemsGenerator::GenName(std::string *name, const RefCountedPtr<Galaxy> &galaxy, const Sector &sec, const Sector::System &sys, Random &rng)
 {
-	std::string name;
+	const int si = sys.idx;
 	const int sx = sec.sx;
 	const int sy = sec.sy;
 	const int sz = sec.sz;
@@ -107,27 +161,32 @@ const std::string SectorRandomSystemsGenerator::GenName(RefCountedPtr<Galaxy> ga
 	Uint32 weight = rng.Int32(chance);
 	if (weight < 500 || galaxy->GetFactions()->IsHomeSystem(SystemPath(sx, sy, sz, si))) {
 		// well done. you get a "real" name
-		NameGenerator::GetSystemName(name, rng);
-		return name;
-	} else if (weight < 800) {
-		char buf[128];
-		snprintf(buf, sizeof(buf), "MJBN %d%+d%+d", rng.Int32(10, 999), sx, sy); // MJBN -> Morton Jordan Bennett Norris
-		return buf;
-	} else if (weight < 1200) {
-		char buf[128];
-		snprintf(buf, sizeof(buf), "SC %d%+d%+d", rng.Int32(1000, 9999), sx, sy);
-		return buf;
+		if (name)
+			NameGenerator::GetSystemName(*name, rng);
+		else
+			NameGenerator::SkipSystemName(rng);
 	} else {
-		char buf[128];
-		snprintf(buf, sizeof(buf), "DSC %d%+d%+d", rng.Int32(1000, 9999), sx, sy);
-		return buf;
+		// a catalogue number
+		auto catalogue = [&](const char *format, int number) {
+			if (name) {
+				char buf[128];
+				snprintf(buf, sizeof(buf), format, number, sx, sy);
+				*name = buf;
+			}
+		};
+		if (weight < 800)
+			catalogue("MJBN %d%+d%+d", rng.Int32(10, 999)); // MJBN -> Morton Jordan Bennett Norris
+		else if (weight < 1200)
+			catalogue("SC %d%+d%+d", rng.Int32(1000, 9999));
+		else
+			catalogue("DSC %d%+d%+d", rng.Int32(1000, 9999));
 	}
 }
 
 bool SectorRandomSystemsGenerator::Apply(Random &rng, RefCountedPtr<Galaxy> galaxy, RefCountedPtr<Sector> sector, GalaxyGenerator::SectorConfig *config)
 {
 	/* Always place random systems outside the core custom-only region */
-	if (config->isCustomOnly)
+	if (config->isCustomOnly || config->isBaked)
 		return true;
 
 	const int sx = sector->sx;
@@ -137,6 +196,9 @@ bool SectorRandomSystemsGenerator::Apply(Random &rng, RefCountedPtr<Galaxy> gala
 	const Sint64 dist = (1 + sx * sx + sy * sy + sz * sz);
 	const Sint64 freq = (1 + sx * sx + sy * sy);
 
+	Random origin;
+	sector->SeedRandom(origin);
+
 	const int numSystems = (rng.Int32(4, 20) * galaxy->GetSectorDensity(sx, sy, sz)) >> 8;
 	sector->m_systems.reserve(numSystems);
 
@@ -162,9 +224,11 @@ bool SectorRandomSystemsGenerator::Apply(Random &rng, RefCountedPtr<Galaxy> gala
 			break;
 		}
 
-		s.m_pos.x = rng.Double(Sector::SIZE);
-		s.m_pos.y = rng.Double(Sector::SIZE);
-		s.m_pos.z = rng.Double(Sector::SIZE);
+		vector3f pos;
+		pos.x = rng.Double(Sector::SIZE);
+		pos.y = rng.Double(Sector::SIZE);
+		pos.z = rng.Double(Sector::SIZE);
+		s.SetPosition(pos);
 
 		/*
 		 * 0 - ~500ly from sol: explored
@@ -319,8 +383,9 @@ bool SectorRandomSystemsGenerator::Apply(Random &rng, RefCountedPtr<Galaxy> gala
 			//Output("%d: %d%\n", sx, sy);
 		}
 
-		s.m_name = GenName(galaxy, *sector, s, customCount + i, rng);
-		//Output("%s: \n", s.m_name.c_str());
+		// the name is drawn again from here when it's wanted
+		s.m_nameDraw = Uint32(rng.DrawsSince(origin));
+		GenName(nullptr, galaxy, *sector, s, rng);
 
 		s.m_seed = rng.Int32();
 
@@ -10,10 +10,19 @@
 #include "Sector.h"
 #include "StarSystem.h"
 
+// fills sectors inside the baked box from the galaxy's BakedGalaxy, the
+// stages after it then leave those sectors be
+class SectorBakedSystemsGenerator : public SectorGeneratorStage {
+public:
+	virtual const char *GetName() const { return "Sector baked systems"; }
+	virtual bool Apply(Random &rng, RefCountedPtr<Galaxy> galaxy, RefCountedPtr<Sector> sector, GalaxyGenerator::SectorConfig *config);
+};
+
 class SectorCustomSystemsGenerator : public SectorGeneratorStage {
 public:
 	SectorCustomSystemsGenerator(int customOnlyRadius) :
 		m_customOnlyRadius(customOnlyRadius) {}
+	virtual const char *GetName() const { return "Sector custom systems"; }
 	virtual bool Apply(Random &rng, RefCountedPtr<Galaxy> galaxy, RefCountedPtr<Sector> sector, GalaxyGenerator::SectorConfig *config);
 
 private:
@@ -22,16 +31,20 @@ private:
 
 class SectorRandomSystemsGenerator : public SectorGeneratorStage {
 public:
+	virtual const char *GetName() const { return "Sector random systems"; }
 	virtual bool Apply(Random &rng, RefCountedPtr<Galaxy> galaxy, RefCountedPtr<Sector> sector, GalaxyGenerator::SectorConfig *config);
 
-private:
-	const std::string GenName(RefCountedPtr<Galaxy> galaxy, const Sector &sec, Sector::System &sys, int si, Random &rand);
+	// draws the system's name from rng, or with a null name only takes the
+	// numbers drawing it would. generation skips the names, and
+	// Sector::System::GetName draws them again when they're wanted
+	static void GenName(std::string *name, const RefCountedPtr<Galaxy> &galaxy, const Sector &sec, const Sector::System &sys, Random &rng);
 };
 
 class SectorPersistenceGenerator : public SectorGeneratorStage {
 public:
 	SectorPersistenceGenerator(GalaxyGenerator::Version version) :
 		m_version(version) {}
+	virtual const char *GetName() const { return "Sector persistence"; }
 	virtual bool Apply(Random &rng, RefCountedPtr<Galaxy> galaxy, RefCountedPtr<Sector> sector, GalaxyGenerator::SectorConfig *config);
 	virtual void FromJson(const Json &jsonObj, RefCountedPtr<Galaxy> galaxy);
 	virtual void ToJson(Json &jsonObj, RefCountedPtr<Galaxy> galaxy);
@@ -224,6 +224,7 @@ StarSystem::StarSystem(const SystemPath &path, RefCountedPtr<Galaxy> galaxy, Sta
 	m_path(path.SystemOnly()),
 	m_numStars(0),
 	m_isCustom(false),
+	m_hasDetail(true),
 	m_faction(nullptr),
 	m_explored(eEXPLORED_AT_START),
 	m_exploredTime(0.0),
@@ -310,17 +311,17 @@ void StarSystem::MakeShortDescription()
 	else if (GetTotalPop() == 0) {
 		SetShortDesc(Lang::SMALL_SCALE_PROSPECTING_NO_SETTLEMENTS);
 	} else if (GetTotalPop() < fixed(1, 10)) {
-		SetShortDesc(Lang::GetCore().Get(
-			GalacticEconomy::GetEconomyById(GetEconType()).l10n_key.small));
+		SetShortDesc(std::string(Lang::GetCore().Get(
+			GalacticEconomy::GetEconomyById(GetEconType()).l10n_key.small)));
 	} else if (GetTotalPop() < fixed(1, 2)) {
-		SetShortDesc(Lang::GetCore().Get(
-			GalacticEconomy::GetEconomyById(GetEconType()).l10n_key.medium));
+		SetShortDesc(std::string(Lang::GetCore().Get(
+			GalacticEconomy::GetEconomyById(GetEconType()).l10n_key.medium)));
 	} else if (GetTotalPop() < fixed(5, 1)) {
-		SetShortDesc(Lang::GetCore().Get(
-			GalacticEconomy::GetEconomyById(GetEconType()).l10n_key.large));
+		SetShortDesc(std::string(Lang::GetCore().Get(
+			GalacticEconomy::GetEconomyById(GetEconType()).l10n_key.large)));
 	} else {
-		SetShortDesc(Lang::GetCore().Get(
-			GalacticEconomy::GetEconomyById(GetEconType()).l10n_key.huge));
+		SetShortDesc(std::string(Lang::GetCore().Get(
+			GalacticEconomy::GetEconomyById(GetEconType()).l10n_key.huge)));
 	}
 }
 
@@ -68,6 +68,8 @@ public:
 	IterationProxy<std::vector<SystemBody *>> GetStars() { return MakeIterationProxy(m_stars); }
 	const IterationProxy<const std::vector<SystemBody *>> GetStars() const { return MakeIterationProxy(m_stars); }
 	Uint32 GetNumBodies() const { return static_cast<Uint32>(m_bodies.size()); }
+	// roughly, for the memory budget
+	size_t GetMemoryUsage() const { return sizeof(StarSystem) + m_bodies.size() * sizeof(SystemBody); }
 	IterationProxy<std::vector<RefCountedPtr<SystemBody>>> GetBodies() { return MakeIterationProxy(m_bodies); }
 	const IterationProxy<const std::vector<RefCountedPtr<SystemBody>>> GetBodies() const { return MakeIterationProxy(m_bodies); }
 
@@ -89,6 +91,11 @@ public:
 
 	bool HasCustomBodies() const { return m_hasCustomBodies; }
 
+	// Systems are generated as a summary first: the bodies, populations and
+	// economy, but not the starports or how the bodies look. Galaxy::GetStarSystem
+	// fills in the rest when it's asked for; Galaxy::GetStarSystemSummary doesn't.
+	bool HasDetail() const { return m_hasDetail; }
+
 	fixed GetMetallicity() const { return m_metallicity; }
 	fixed GetIndustrial() const { return m_industrial; }
 	fixed GetAgricultural() const { return m_agricultural; }
@@ -116,6 +123,19 @@ protected:
 		return body;
 	}
 
+	// A body for a generator to fill in away from the system, e.g. on
+	// another thread; it gets its place in the system from AddBody.
+	RefCountedPtr<SystemBody> NewDetachedBody()
+	{
+		return RefCountedPtr<SystemBody>(new SystemBody(SystemPath(m_path.sectorX, m_path.sectorY, m_path.sectorZ, m_path.systemIndex), this));
+	}
+
+	void AddBody(const RefCountedPtr<SystemBody> &body)
+	{
+		body->m_path.bodyIndex = static_cast<Uint32>(m_bodies.size());
+		m_bodies.push_back(body);
+	}
+
 	void MakeShortDescription();
 	void SetShortDesc(const std::string &desc) { m_shortDesc = desc; }
 
@@ -139,6 +159,7 @@ private:
 
 	bool m_isCustom;
 	bool m_hasCustomBodies;
+	bool m_hasDetail;
 
 	const Faction *m_faction;
 	ExplorationState m_explored;
@@ -178,6 +199,7 @@ public:
 		m_hasCustomBodies = hasCustomBodies;
 	}
 	void SetPosition(const vector3f &pos) { m_pos = pos; }
+	void SetHasDetail(bool hasDetail) { m_hasDetail = hasDetail; }
 	void SetNumStars(int numStars) { m_numStars = numStars; }
 	void SetRootBody(RefCountedPtr<SystemBody> rootBody) { m_rootBody = rootBody; }
 	void SetRootBody(SystemBody *rootBody) { m_rootBody.Reset(rootBody); }
@@ -216,7 +238,9 @@ public:
 		m_stars.push_back(star);
 	}
 	using StarSystem::MakeShortDescription;
+	using StarSystem::AddBody;
 	using StarSystem::NewBody;
+	using StarSystem::NewDetachedBody;
 	using StarSystem::SetShortDesc;
 };
 
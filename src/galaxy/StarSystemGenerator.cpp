@@ -12,6 +12,7 @@
 #include "Sector.h"
 #include "gameconsts.h"
 #include "core/Log.h"
+#include "core/TaskGraph.h"
 #include "core/macros.h"
 #include "galaxy/Economy.h"
 #include "lua/LuaNameGen.h"
@@ -32,6 +33,12 @@ static const double CELSIUS = 273.15;
 // max surface gravity for a permanent human settlement
 static const double MAX_SETTLEMENT_SURFACE_GRAVITY = 50; // m/s2 .. roughly 5 g
 
+// systems with fewer bodies than this are populated on the calling thread
+static const size_t PARALLEL_POPULATE_MIN_BODIES = 32;
+static const uint32_t PARALLEL_POPULATE_TASK_BODIES = 8;
+static const size_t PARALLEL_MOONS_MIN_PLANETS = 8;
+static const uint32_t PARALLEL_MOONS_TASK_PLANETS = 2;
+
 static const Uint32 POLIT_SEED = 0x1234abcd;
 static const Uint32 POLIT_SALT = 0x8732abdf;
 
@@ -837,8 +844,12 @@ void StarSystemRandomGenerator::PickPlanetType(SystemBody *sbody, Random &rand)
 
 	sbody->SetAtmFromParameters();
 
-	PickAtmosphere(sbody);
-	PickRings(sbody);
+	// neither draws from rand, so a summary can leave them for ApplyDetail;
+	// except for brown dwarfs, which it couldn't tell from the stars
+	if (sbody->GetStarSystem()->HasDetail() || sbody->GetSuperType() == SystemBody::SUPERTYPE_STAR) {
+		PickAtmosphere(sbody);
+		PickRings(sbody);
+	}
 }
 
 static fixed mass_from_disk_area(fixed a, fixed b, fixed max)
@@ -969,7 +980,7 @@ fixed StarSystemRandomGenerator::CalcBodySatelliteShellDensity(Random &rand, Sys
 	}
 }
 
-void StarSystemRandomGenerator::MakePlanetsAround(RefCountedPtr<StarSystem::GeneratorAPI> system, SystemBody *primary, Random &rand)
+void StarSystemRandomGenerator::MakePlanetsAround(RefCountedPtr<StarSystem::GeneratorAPI> system, SystemBody *primary, Random &rand, BodyList *detached)
 {
 	PROFILE_SCOPED()
 	SystemBody::BodySuperType parentSuperType = primary->GetSuperType();
@@ -1001,7 +1012,7 @@ void StarSystemRandomGenerator::MakePlanetsAround(RefCountedPtr<StarSystem::Gene
 	uint32_t numTries = 0;
 
 	while (pos < discMax && numTries++ < 30) {
-		SystemBody *planet = MakeBodyInOrbitSlice(rand, system.Get(), primary, pos, fixed(0), discMax, discDensity);
+		SystemBody *planet = MakeBodyInOrbitSlice(rand, system.Get(), primary, pos, fixed(0), discMax, discDensity, detached);
 
 		if (!planet)
 			continue;
@@ -1026,7 +1037,8 @@ void StarSystemRandomGenerator::MakePlanetsAround(RefCountedPtr<StarSystem::Gene
 	}
 
 	int idx = 0;
-	bool make_moons = parentSuperType <= SystemBody::SUPERTYPE_STAR;
+	// from version 2 moons are made separately, see MakeSatellitesFromStreams
+	bool make_moons = parentSuperType <= SystemBody::SUPERTYPE_STAR && m_version < 2;
 
 	for (std::vector<SystemBody *>::iterator i = primary->m_children.begin(); i != primary->m_children.end(); ++i) {
 		// planets around a binary pair [gravpoint] -- ignore the stars...
@@ -1047,7 +1059,82 @@ void StarSystemRandomGenerator::MakePlanetsAround(RefCountedPtr<StarSystem::Gene
 	}
 }
 
-SystemBody *StarSystemRandomGenerator::MakeBodyInOrbitSlice(Random &rand, StarSystem::GeneratorAPI *system, SystemBody *primary, fixed min_slice, fixed max_slice, fixed discMax, fixed discDensity)
+/*
+ * From version 2 the planets of each primary, then the moons of each planet,
+ * are made from a counter-based stream of their own, keyed by the system and
+ * addressed by the index of the body they orbit. A body's satellites then
+ * don't depend on the numbers drawn for any other body's, so the moons of
+ * all the planets are made in parallel. They're added to the system in the
+ * order of their planets, whichever finished first.
+ */
+void StarSystemRandomGenerator::MakeSatellitesFromStreams(RefCountedPtr<StarSystem::GeneratorAPI> system, const std::vector<SystemBody *> &primaries)
+{
+	PROFILE_SCOPED()
+	const SystemPath &path = system->GetPath();
+	const Uint32 key[5] = { Uint32(system->GetSeed()), Uint32(path.sectorX), Uint32(path.sectorY), Uint32(path.sectorZ), UNIVERSE_SEED };
+
+	// there are only a few primaries, and the shells of some depend on the
+	// planets of others, so planets are made one primary at a time
+	std::vector<SystemBody *> planets;
+	for (SystemBody *primary : primaries) {
+		Random rand;
+		rand.seedStream(key, 5, primary->GetPath().bodyIndex, PLANETS_STREAM);
+		MakePlanetsAround(system, primary, rand);
+
+		// planets around a binary pair [gravpoint] -- ignore the stars...
+		for (SystemBody *child : primary->GetChildren()) {
+			if (child->GetSuperType() != SystemBody::SUPERTYPE_STAR)
+				planets.push_back(child);
+		}
+	}
+
+	// moons only read their planet's parents, and what they change is their
+	// own planet's
+	std::vector<BodyList> moons(planets.size());
+	auto makeMoons = [this, system, &key, &planets, &moons](size_t i) {
+		Random rand;
+		rand.seedStream(key, 5, planets[i]->GetPath().bodyIndex, MOONS_STREAM);
+		MakePlanetsAround(system, planets[i], rand, &moons[i]);
+	};
+
+	TaskGraph *taskGraph = GalaxyGenerator::GetTaskGraph();
+	if (!taskGraph || planets.size() < PARALLEL_MOONS_MIN_PLANETS) {
+		for (size_t i = 0; i < planets.size(); i++)
+			makeMoons(i);
+	} else {
+		TaskSet *taskSet = new TaskSet();
+		for (uint32_t begin = 0; begin < planets.size(); begin += PARALLEL_MOONS_TASK_PLANETS) {
+			const TaskRange range = { begin, std::min(uint32_t(planets.size()), begin + PARALLEL_MOONS_TASK_PLANETS) };
+			taskSet->AddTaskLambda(range, [&makeMoons](TaskRange r) {
+				for (uint32_t i = r.begin; i < r.end; i++)
+					makeMoons(i);
+			});
+		}
+
+		TaskSet::Handle handle = taskGraph->QueueTaskSet(taskSet);
+		taskGraph->WaitForTaskSet(handle);
+	}
+
+	for (const BodyList &planetMoons : moons) {
+		for (const RefCountedPtr<SystemBody> &moon : planetMoons)
+			system->AddBody(moon);
+	}
+}
+
+void StarSystemRandomGenerator::ApplyDetail(RefCountedPtr<Galaxy> galaxy, RefCountedPtr<StarSystem::GeneratorAPI> system)
+{
+	PROFILE_SCOPED()
+	// the planets and moons PickPlanetType made
+	for (RefCountedPtr<SystemBody> body : system->GetBodies()) {
+		const SystemBody::BodySuperType superType = body->GetSuperType();
+		if (!body->IsCustomBody() && (superType == SystemBody::SUPERTYPE_ROCKY_PLANET || superType == SystemBody::SUPERTYPE_GAS_GIANT)) {
+			PickAtmosphere(body.Get());
+			PickRings(body.Get());
+		}
+	}
+}
+
+SystemBody *StarSystemRandomGenerator::MakeBodyInOrbitSlice(Random &rand, StarSystem::GeneratorAPI *system, SystemBody *primary, fixed min_slice, fixed max_slice, fixed discMax, fixed discDensity, BodyList *detached)
 {
 	fixed semiMajorAxis;
 	fixed eccentricity;
@@ -1122,7 +1209,13 @@ SystemBody *StarSystemRandomGenerator::MakeBodyInOrbitSlice(Random &rand, StarSy
 		mass = fixed(Sint64(0x7fFFffFFffFFffFFull));
 	}
 
-	SystemBody *planet = system->NewBody();
+	SystemBody *planet;
+	if (detached) {
+		detached->push_back(system->NewDetachedBody());
+		planet = detached->back().Get();
+	} else {
+		planet = system->NewBody();
+	}
 	planet->m_semiMajorAxis = semiMajorAxis;
 	planet->m_eccentricity = eccentricity;
 	planet->m_axialTilt = fixed(100, 157) * rand.NFixed(2);
@@ -1386,14 +1479,25 @@ bool StarSystemRandomGenerator::Apply(Random &rng, RefCountedPtr<Galaxy> galaxy,
 		system->AddStar(star[i]);
 	}
 	// ... because we need them when making planets to calculate surface temperatures
-	for (auto *s : system->GetStars()) {
-		MakePlanetsAround(system, s, rng);
-	}
+	if (m_version >= 2) {
+		std::vector<SystemBody *> primaries;
+		for (auto *s : system->GetStars())
+			primaries.push_back(s);
+		if (system->GetNumStars() > 1)
+			primaries.push_back(centGrav1);
+		if (system->GetNumStars() == 4)
+			primaries.push_back(centGrav2);
+		MakeSatellitesFromStreams(system, primaries);
+	} else {
+		for (auto *s : system->GetStars()) {
+			MakePlanetsAround(system, s, rng);
+		}
 
-	if (system->GetNumStars() > 1)
-		MakePlanetsAround(system, centGrav1, rng);
-	if (system->GetNumStars() == 4)
-		MakePlanetsAround(system, centGrav2, rng);
+		if (system->GetNumStars() > 1)
+			MakePlanetsAround(system, centGrav1, rng);
+		if (system->GetNumStars() == 4)
+			MakePlanetsAround(system, centGrav2, rng);
+	}
 
 		// an example export of generated system, can be removed during the merge
 		//char filename[500];
@@ -1443,16 +1547,76 @@ void PopulateStarSystemGenerator::PositionSettlementOnPlanet(SystemBody *sbody,
 /*
  * Set natural resources, tech level, industry strengths and population levels
  */
+static void collect_bodies_children_first(SystemBody *sbody, std::vector<SystemBody *> &bodies)
+{
+	for (auto *child : sbody->GetChildren())
+		collect_bodies_children_first(child, bodies);
+	bodies.push_back(sbody);
+}
+
 void PopulateStarSystemGenerator::PopulateStage1(SystemBody *sbody, StarSystem::GeneratorAPI *system, fixed &outTotalPop)
 {
 	PROFILE_SCOPED()
-	for (auto *child : sbody->GetChildren()) {
-		PopulateStage1(child, system, outTotalPop);
+	// bodies are populated from their own seed and only read the system, so
+	// they can be populated in any order and on any thread; what they change
+	// in the system is applied afterwards in the order the bodies were
+	// always populated in, which keeps the result exactly as it was
+	std::vector<SystemBody *> bodies;
+	collect_bodies_children_first(sbody, bodies);
+	std::vector<BodyPopulation> results(bodies.size());
+
+	TaskGraph *taskGraph = GalaxyGenerator::GetTaskGraph();
+	if (!taskGraph || bodies.size() < PARALLEL_POPULATE_MIN_BODIES) {
+		for (size_t i = 0; i < bodies.size(); i++)
+			PopulateBody(bodies[i], system, results[i]);
+	} else {
+		TaskSet *taskSet = new TaskSet();
+		for (uint32_t begin = 0; begin < bodies.size(); begin += PARALLEL_POPULATE_TASK_BODIES) {
+			const TaskRange range = { begin, std::min(uint32_t(bodies.size()), begin + PARALLEL_POPULATE_TASK_BODIES) };
+			taskSet->AddTaskLambda(range, [this, system, &bodies, &results](TaskRange r) {
+				for (uint32_t i = r.begin; i < r.end; i++)
+					PopulateBody(bodies[i], system, results[i]);
+			});
+		}
+
+		TaskSet::Handle handle = taskGraph->QueueTaskSet(taskSet);
+		taskGraph->WaitForTaskSet(handle);
+	}
+
+	for (size_t i = 0; i < bodies.size(); i++) {
+		SystemBody *body = bodies[i];
+		const BodyPopulation &result = results[i];
+
+		system->SetAgricultural(system->GetAgricultural() + result.agricultural);
+		for (const auto &trade : result.tradeLevels)
+			system->AddTradeLevel(trade.first, trade.second);
+
+		if (result.wantsName) {
+			Uint32 _init[6] = { Uint32(system->GetSeed()), Uint32(system->GetPath().sectorX),
+				Uint32(system->GetPath().sectorY), Uint32(system->GetPath().sectorZ), UNIVERSE_SEED, Uint32(body->GetSeed()) };
+			RefCountedPtr<Random> namerand(new Random);
+			namerand->seed(_init, 6);
+
+			// the name generator sees the body as it was before the final population was worked out
+			const fixed population = body->m_population;
+			body->m_population = result.namingPopulation;
+			body->m_name = Pi::luaNameGen->BodyName(body, namerand);
+			body->m_population = population;
+		}
+
+		if (result.totalPop == BodyPopulation::TOTAL_POP_ADD)
+			outTotalPop += body->GetPopulationAsFixed();
+		else if (result.totalPop == BodyPopulation::TOTAL_POP_RESET)
+			outTotalPop = fixed();
 	}
+}
 
+void PopulateStarSystemGenerator::PopulateBody(SystemBody *sbody, const StarSystem::GeneratorAPI *system, BodyPopulation &out) const
+{
 	// unexplored systems have no population (that we know about)
 	if (system->GetExplored() != StarSystem::eEXPLORED_AT_START) {
-		sbody->m_population = outTotalPop = fixed();
+		sbody->m_population = fixed();
+		out.totalPop = BodyPopulation::TOTAL_POP_RESET;
 		return;
 	}
 
@@ -1468,9 +1632,6 @@ void PopulateStarSystemGenerator::PopulateStage1(SystemBody *sbody, StarSystem::
 	Random rand;
 	rand.seed(_init, 6);
 
-	RefCountedPtr<Random> namerand(new Random);
-	namerand->seed(_init, 6);
-
 	sbody->m_population = fixed();
 
 	/* Bad type of planet for settlement */
@@ -1483,15 +1644,15 @@ void PopulateStarSystemGenerator::PopulateStage1(SystemBody *sbody, StarSystem::
 		if (sbody->GetType() == SystemBody::TYPE_STARPORT_ORBITAL) {
 			// give starports a population between 9000 and 30000
 			sbody->m_population = fixed(1, 100000) + fixed(starportPopRand.Int32(-1000, 20000), 1000000000);
-			outTotalPop += sbody->m_population;
+			out.totalPop = BodyPopulation::TOTAL_POP_ADD;
 		} else if (sbody->GetType() == SystemBody::TYPE_STARPORT_SURFACE) {
 			// No permanent population on gravities larger than defined in MAX_SETTLEMENT_SURFACE_GRAVITY
 			if (sbody->CalcSurfaceGravity() > MAX_SETTLEMENT_SURFACE_GRAVITY) {
-				outTotalPop = fixed();
+				out.totalPop = BodyPopulation::TOTAL_POP_RESET;
 			} else {
 				// give surface spaceports a population between 80000 and 250000
 				sbody->m_population = fixed(1, 10000) + fixed(starportPopRand.Int32(-2000, 15000), 100000000);
-				outTotalPop += sbody->m_population;
+				out.totalPop = BodyPopulation::TOTAL_POP_ADD;
 			}
 		}
 
@@ -1502,10 +1663,10 @@ void PopulateStarSystemGenerator::PopulateStage1(SystemBody *sbody, StarSystem::
 
 	if (sbody->GetLifeAsFixed() > fixed(9, 10)) {
 		sbody->m_agricultural = Clamp(fixed(1, 1) - fixed(CELSIUS + 25 - sbody->GetAverageTemp(), 40), fixed(), fixed(1, 1));
-		system->SetAgricultural(system->GetAgricultural() + 2 * sbody->m_agricultural);
+		out.agricultural = 2 * sbody->m_agricultural;
 	} else if (sbody->GetLifeAsFixed() > fixed(1, 2)) {
 		sbody->m_agricultural = Clamp(fixed(1, 1) - fixed(CELSIUS + 30 - sbody->GetAverageTemp(), 50), fixed(), fixed(1, 1));
-		system->SetAgricultural(system->GetAgricultural() + 1 * sbody->m_agricultural);
+		out.agricultural = 1 * sbody->m_agricultural;
 	} else {
 		// don't bother populating crap planets
 		if (sbody->GetMetallicityAsFixed() < fixed(5, 10) &&
@@ -1563,19 +1724,19 @@ void PopulateStarSystemGenerator::PopulateStage1(SystemBody *sbody, StarSystem::
 			continue;
 
 		// Produce X amount of this commodity
-		system->AddTradeLevel(commodity.id, -2 * howmuch.ToInt32());
-		// Output("System %s.%s adding commodity %s (%d) -> %d\n",
-		// 	system->GetName(), sbody->GetName(), commodity.name, -2 * howmuch.ToInt32(), system->GetTradeLevel(commodity.id));
+		out.tradeLevels.emplace_back(commodity.id, -2 * howmuch.ToInt32());
 		for (const auto &input : commodity.inputs) {
 			// Consume Y amount of the input commodities
-			system->AddTradeLevel(input.first, (input.second * howmuch).ToInt32());
+			out.tradeLevels.emplace_back(input.first, (input.second * howmuch).ToInt32());
 		}
 	}
 
 	sbody->m_population += workforce;
 
-	if (!system->HasCustomBodies() && sbody->GetPopulationAsFixed() > 0)
-		sbody->m_name = Pi::luaNameGen->BodyName(sbody, namerand);
+	if (!system->HasCustomBodies() && sbody->GetPopulationAsFixed() > 0) {
+		out.wantsName = true;
+		out.namingPopulation = sbody->m_population;
+	}
 
 	// Add a bunch of things people consume
 	for (const auto &pair : GalacticEconomy::Consumables()) {
@@ -1587,11 +1748,7 @@ void PopulateStarSystemGenerator::PopulateStage1(SystemBody *sbody, StarSystem::
 
 		const auto &consume_bounds = consumable.random_consumption;
 		uint32_t consumption = rand.Int32(consume_bounds[0], consume_bounds[1]);
-		system->AddTradeLevel(pair.first, consumption);
-
-		// auto &commodity = GalacticEconomy::GetCommodityById(t.first);
-		// Output("System %s.%s adding consumable %s (%d) -> %d\n",
-		// 	system->GetName(), sbody->GetName(), commodity.name, consumption, system->GetTradeLevel(commodity.id));
+		out.tradeLevels.emplace_back(pair.first, consumption);
 	}
 
 	// well, outdoor worlds should have way more people
@@ -1599,7 +1756,7 @@ void PopulateStarSystemGenerator::PopulateStage1(SystemBody *sbody, StarSystem::
 
 	//	Output("%s: pop %.3f billion\n", name.c_str(), sbody->m_population.ToFloat());
 
-	outTotalPop += sbody->GetPopulationAsFixed();
+	out.totalPop = BodyPopulation::TOTAL_POP_ADD;
 }
 
 static bool check_unique_station_name(const std::string &name, const StarSystem *system)
@@ -1908,7 +2065,8 @@ bool PopulateStarSystemGenerator::Apply(Random &rng, RefCountedPtr<Galaxy> galax
 	SetSysPolit(galaxy, system, system->GetTotalPop());
 	SetCommodityLegality(system);
 
-	if (addSpaceStations) {
+	// starports come last and have their own seeds, so they can wait for ApplyDetail
+	if (addSpaceStations && system->HasDetail()) {
 		PopulateAddStations(system->GetRootBody().Get(), system.Get());
 	}
 
@@ -1919,3 +2077,10 @@ bool PopulateStarSystemGenerator::Apply(Random &rng, RefCountedPtr<Galaxy> galax
 
 	return true;
 }
+
+void PopulateStarSystemGenerator::ApplyDetail(RefCountedPtr<Galaxy> galaxy, RefCountedPtr<StarSystem::GeneratorAPI> system)
+{
+	PROFILE_SCOPED()
+	if (!system->HasCustomBodies())
+		PopulateAddStations(system->GetRootBody().Get(), system.Get());
+}
@@ -9,6 +9,7 @@
 
 class StarSystemFromSectorGenerator : public StarSystemGeneratorStage {
 public:
+	virtual const char *GetName() const { return "System from sector"; }
 	virtual bool Apply(Random &rng, RefCountedPtr<Galaxy> galaxy, RefCountedPtr<StarSystem::GeneratorAPI> system, GalaxyGenerator::StarSystemConfig *config);
 };
 
@@ -31,6 +32,7 @@ protected:
 
 class StarSystemCustomGenerator : public StarSystemLegacyGeneratorBase {
 public:
+	virtual const char *GetName() const { return "System custom bodies"; }
 	virtual bool Apply(Random &rng, RefCountedPtr<Galaxy> galaxy, RefCountedPtr<StarSystem::GeneratorAPI> system, GalaxyGenerator::StarSystemConfig *config);
 
 	// returns true if the system is custom, false if the contents should be randomly generated
@@ -43,17 +45,30 @@ private:
 class StarSystemRandomGenerator : public StarSystemLegacyGeneratorBase {
 public:
 	static constexpr uint32_t BODY_SATELLITE_SALT = 0xf5123a90;
+	// purposes of the counter-based streams satellites are made from, from version 2
+	static constexpr uint32_t PLANETS_STREAM = 0x9a3f61c2;
+	static constexpr uint32_t MOONS_STREAM = 0x47d2b80e;
 
+	typedef std::vector<RefCountedPtr<SystemBody>> BodyList;
+
+	StarSystemRandomGenerator() = default;
+	explicit StarSystemRandomGenerator(GalaxyGenerator::Version version) :
+		m_version(version) {}
+
+	virtual const char *GetName() const { return "System random bodies"; }
 	virtual bool Apply(Random &rng, RefCountedPtr<Galaxy> galaxy, RefCountedPtr<StarSystem::GeneratorAPI> system, GalaxyGenerator::StarSystemConfig *config);
+	virtual void ApplyDetail(RefCountedPtr<Galaxy> galaxy, RefCountedPtr<StarSystem::GeneratorAPI> system);
 
 	// Calculate the min, max distances from the primary where satellites should be generated
 	// Returns the mass density of a 2d slice through the center of the shell
 	fixed CalcBodySatelliteShellDensity(Random &rand, SystemBody *primary, fixed &discMin, fixed &discMax);
-	SystemBody *MakeBodyInOrbitSlice(Random &rand, StarSystem::GeneratorAPI *system, SystemBody *primary, fixed min, fixed max, fixed discMax, fixed discDensity);
+	// the body is added to the system, or to detached if given
+	SystemBody *MakeBodyInOrbitSlice(Random &rand, StarSystem::GeneratorAPI *system, SystemBody *primary, fixed min, fixed max, fixed discMax, fixed discDensity, BodyList *detached = nullptr);
 	void PickPlanetType(SystemBody *sbody, Random &rand);
 
 private:
-	void MakePlanetsAround(RefCountedPtr<StarSystem::GeneratorAPI> system, SystemBody *primary, Random &rand);
+	void MakePlanetsAround(RefCountedPtr<StarSystem::GeneratorAPI> system, SystemBody *primary, Random &rand, BodyList *detached = nullptr);
+	void MakeSatellitesFromStreams(RefCountedPtr<StarSystem::GeneratorAPI> system, const std::vector<SystemBody *> &primaries);
 	void MakeRandomStar(SystemBody *sbody, Random &rand);
 	void MakeStarOfType(SystemBody *sbody, SystemBody::BodyType type, Random &rand);
 	void MakeStarOfTypeLighterThan(SystemBody *sbody, SystemBody::BodyType type, fixed maxMass, Random &rand);
@@ -61,11 +76,15 @@ private:
 
 	int CalcSurfaceTemp(const SystemBody *primary, fixed distToPrimary, fixed albedo, fixed greenhouse);
 	const SystemBody *FindStarAndTrueOrbitalRange(const SystemBody *planet, fixed &orbMin_, fixed &orbMax_) const;
+
+	const GalaxyGenerator::Version m_version = 1;
 };
 
 class PopulateStarSystemGenerator : public StarSystemLegacyGeneratorBase {
 public:
+	virtual const char *GetName() const { return "System population"; }
 	virtual bool Apply(Random &rng, RefCountedPtr<Galaxy> galaxy, RefCountedPtr<StarSystem::GeneratorAPI> system, GalaxyGenerator::StarSystemConfig *config);
+	virtual void ApplyDetail(RefCountedPtr<Galaxy> galaxy, RefCountedPtr<StarSystem::GeneratorAPI> system);
 
 private:
 	void SetSysPolit(RefCountedPtr<Galaxy> galaxy, RefCountedPtr<StarSystem::GeneratorAPI> system, const fixed &human_infestedness);
@@ -75,6 +94,24 @@ private:
 	void PopulateAddStations(SystemBody *sbody, StarSystem::GeneratorAPI *system);
 	void PositionSettlementOnPlanet(SystemBody *sbody, std::vector<fixed> &prevOrbits);
 	void PopulateStage1(SystemBody *sbody, StarSystem::GeneratorAPI *system, fixed &outTotalPop);
+
+	// what populating a body changes outside of the body itself, applied
+	// to the system in body order once every body has been populated
+	struct BodyPopulation {
+		enum TotalPopChange {
+			TOTAL_POP_KEEP,
+			TOTAL_POP_ADD,
+			TOTAL_POP_RESET
+		};
+
+		TotalPopChange totalPop = TOTAL_POP_KEEP;
+		fixed agricultural;
+		// the population the name generator sees, if the body wants a name
+		bool wantsName = false;
+		fixed namingPopulation;
+		std::vector<std::pair<GalacticEconomy::CommodityId, int>> tradeLevels;
+	};
+	void PopulateBody(SystemBody *sbody, const StarSystem::GeneratorAPI *system, BodyPopulation &out) const;
 };
 
 #endif
@@ -0,0 +1,163 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "SystemNameIndex.h"
+
+#include "galaxy/Sector.h"
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+
+// below this many removed names, the lists aren't worth rebuilding
+static const size_t MIN_COMPACT_NAMES = 1024;
+
+static char LowerCase(char c)
+{
+	return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+static Uint32 MakeGram(const char *text, size_t length)
+{
+	Uint32 gram = Uint32(length) << 24;
+	for (size_t i = 0; i < length; i++)
+		gram |= Uint32(Uint8(text[i])) << (8 * (2 - i));
+	return gram;
+}
+
+void SystemNameIndex::QueueSector(const Sector *sector)
+{
+	m_queued[sector->GetPath()] = sector;
+}
+
+void SystemNameIndex::RemoveSector(const SystemPath &sectorPath)
+{
+	auto queued = m_queued.find(sectorPath);
+	if (queued != m_queued.end())
+		m_queued.erase(queued);
+
+	auto it = m_sectorNames.find(sectorPath);
+	if (it == m_sectorNames.end())
+		return;
+
+	for (Uint32 index : it->second)
+		m_names[index].removed = true;
+	m_numRemoved += it->second.size();
+	m_sectorNames.erase(it);
+
+	if (m_numRemoved >= MIN_COMPACT_NAMES && m_numRemoved * 2 > m_names.size())
+		Compact();
+}
+
+void SystemNameIndex::Clear()
+{
+	m_names.clear();
+	m_numRemoved = 0;
+	m_grams.clear();
+	m_sectorNames.clear();
+	m_queued.clear();
+}
+
+void SystemNameIndex::Add(const SystemPath &path, std::string_view name)
+{
+	const Uint32 index = Uint32(m_names.size());
+	Name &entry = m_names.emplace_back();
+	entry.system = path;
+	entry.text.resize(name.size());
+	std::transform(name.begin(), name.end(), entry.text.begin(), LowerCase);
+
+	m_sectorNames[path.SectorOnly()].push_back(index);
+	AddGrams(index);
+}
+
+void SystemNameIndex::AddGrams(Uint32 nameIndex)
+{
+	const std::string &text = m_names[nameIndex].text;
+
+	// each list gets the name once, however often the n-gram appears in it
+	std::vector<Uint32> grams;
+	grams.reserve(text.size() * 3);
+	for (size_t i = 0; i < text.size(); i++)
+		for (size_t length = 1; length <= 3 && i + length <= text.size(); length++)
+			grams.push_back(MakeGram(&text[i], length));
+	std::sort(grams.begin(), grams.end());
+	grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+	for (Uint32 gram : grams)
+		m_grams[gram].push_back(nameIndex);
+}
+
+void SystemNameIndex::Compact()
+{
+	PROFILE_SCOPED()
+	std::vector<Name> names;
+	names.reserve(m_names.size() - m_numRemoved);
+	for (Name &name : m_names)
+		if (!name.removed)
+			names.push_back(std::move(name));
+
+	m_names = std::move(names);
+	m_numRemoved = 0;
+	m_grams.clear();
+	m_sectorNames.clear();
+	for (Uint32 i = 0; i < m_names.size(); i++) {
+		m_sectorNames[m_names[i].system.SectorOnly()].push_back(i);
+		AddGrams(i);
+	}
+}
+
+void SystemNameIndex::IndexQueued()
+{
+	if (m_queued.size() == 0)
+		return;
+
+	PROFILE_SCOPED()
+	for (const auto &queued : m_queued) {
+		const Sector *sector = queued.second;
+		for (Uint32 i = 0; i < sector->m_systems.size(); i++) {
+			const Sector::System &system = sector->m_systems[i];
+			const SystemPath path(sector->sx, sector->sy, sector->sz, i);
+			Add(path, system.GetName());
+			for (const std::string &otherName : system.GetOtherNames())
+				Add(path, otherName);
+		}
+	}
+	m_queued.clear();
+}
+
+void SystemNameIndex::Find(std::string_view pattern, std::vector<SystemPath> &systems)
+{
+	PROFILE_SCOPED()
+	IndexQueued();
+
+	const size_t first = systems.size();
+	if (pattern.empty()) {
+		for (const Name &name : m_names)
+			if (!name.removed)
+				systems.push_back(name.system);
+	} else {
+		std::string lowered(pattern.size(), '\0');
+		std::transform(pattern.begin(), pattern.end(), lowered.begin(), LowerCase);
+
+		// the candidates are the names with the rarest of the pattern's
+		// n-grams, which for a short pattern is the pattern itself
+		const std::vector<Uint32> *candidates = nullptr;
+		const size_t gramLength = std::min<size_t>(lowered.size(), 3);
+		for (size_t i = 0; i + gramLength <= lowered.size(); i++) {
+			auto it = m_grams.find(MakeGram(&lowered[i], gramLength));
+			if (it == m_grams.end())
+				return;
+			if (!candidates || it->second.size() < candidates->size())
+				candidates = &it->second;
+		}
+
+		for (Uint32 index : *candidates) {
+			const Name &name = m_names[index];
+			if (!name.removed && (lowered.size() <= 3 || name.text.find(lowered) != std::string::npos))
+				systems.push_back(name.system);
+		}
+	}
+
+	// a system with several matching names
+	std::sort(systems.begin() + first, systems.end());
+	systems.erase(std::unique(systems.begin() + first, systems.end()), systems.end());
+}
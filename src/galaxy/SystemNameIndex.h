@@ -0,0 +1,67 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _SYSTEMNAMEINDEX_H
+#define _SYSTEMNAMEINDEX_H
+
+#include "galaxy/SystemPath.h"
+#include "galaxy/SystemPathHashMap.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class Sector;
+
+/*
+ * The names of the systems in the sectors the sector cache holds, for
+ * finding systems by part of their name.
+ *
+ * Every name is broken into its n-grams of one, two and three bytes, each
+ * with the list of names that contain it. A pattern of up to three bytes is
+ * then its own list, and a longer one is checked against the names in the
+ * shortest list of its trigrams. Matching ignores ASCII case, as
+ * pi_strcasestr does.
+ *
+ * The sector cache queues sectors as they arrive and removes them as they're
+ * destroyed. Most random system names are drawn again each time they're
+ * asked for, so queued sectors' names are only drawn and indexed by the next
+ * Find, and sectors that are never searched cost nothing. Removed names are
+ * left in the lists until enough have gone to make rebuilding them worth it.
+ */
+class SystemNameIndex {
+public:
+	void QueueSector(const Sector *sector);
+	void RemoveSector(const SystemPath &sectorPath);
+	void Clear();
+
+	// index a name of the system at path
+	void Add(const SystemPath &path, std::string_view name);
+
+	// Appends the systems with a name containing pattern, each once and in
+	// no particular order. An empty pattern matches every system.
+	void Find(std::string_view pattern, std::vector<SystemPath> &systems);
+
+	size_t GetNumNames() const { return m_names.size() - m_numRemoved; }
+
+private:
+	struct Name {
+		SystemPath system;
+		std::string text; // lower case
+		bool removed = false;
+	};
+
+	void IndexQueued();
+	void AddGrams(Uint32 nameIndex);
+	void Compact();
+
+	std::vector<Name> m_names;
+	size_t m_numRemoved = 0;
+	// n-gram (its length in the top byte) -> names containing it, ascending
+	std::unordered_map<Uint32, std::vector<Uint32>> m_grams;
+	SystemPathHashMap<std::vector<Uint32>, SystemPath::LessSectorOnly> m_sectorNames;
+	SystemPathHashMap<const Sector *, SystemPath::LessSectorOnly> m_queued;
+};
+
+#endif /* _SYSTEMNAMEINDEX_H */
@@ -8,6 +8,7 @@
 #include "lua/LuaWrappable.h"
 #include <SDL_stdinc.h>
 #include <cassert>
+#include <cmath>
 #include <stdexcept>
 
 class SystemPath : public LuaWrappable {
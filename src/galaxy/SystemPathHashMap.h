@@ -0,0 +1,286 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _SYSTEMPATHHASHMAP_H
+#define _SYSTEMPATHHASHMAP_H
+
+#include "galaxy/SystemPath.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+/*
+ * Open addressing hash map from SystemPath to V, standing in for a
+ * std::map<SystemPath, V, CompareT> where CompareT is SystemPath::LessSectorOnly
+ * or SystemPath::LessSystemOnly, and only the parts of the path the comparator
+ * looks at are part of the key.
+ *
+ * The sector coordinates are packed into a single 64 bit word (21 bits each,
+ * far more than the galaxy needs), so finding a sector is a hash and a couple
+ * of integer compares rather than a walk down a tree.
+ *
+ * Erasing leaves a tombstone, so that an erase doesn't move other entries
+ * and iterators other than the erased one stay valid, which allows the
+ * usual "Erase(it++)" loops. Inserting may rehash and invalidates iterators.
+ * Iteration order is unspecified.
+ */
+template <typename V, typename CompareT>
+class SystemPathHashMap {
+	enum SlotState : uint8_t {
+		SLOT_EMPTY,
+		SLOT_FULL,
+		SLOT_ERASED
+	};
+
+	struct Key {
+		uint64_t sector;
+		uint32_t system;
+
+		bool operator==(const Key &k) const { return sector == k.sector && system == k.system; }
+	};
+
+public:
+	typedef SystemPath key_type;
+	typedef V mapped_type;
+	typedef std::pair<SystemPath, V> value_type;
+
+	template <typename MapT, typename ValueT>
+	class iterator_base {
+		friend class SystemPathHashMap;
+
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef ValueT value_type;
+		typedef ptrdiff_t difference_type;
+		typedef ValueT *pointer;
+		typedef ValueT &reference;
+
+		iterator_base() :
+			m_map(nullptr),
+			m_slot(0) {}
+		// iterators convert to const_iterators
+		template <typename M, typename T>
+		iterator_base(const iterator_base<M, T> &it) :
+			m_map(it.m_map),
+			m_slot(it.m_slot) {}
+
+		reference operator*() const { return m_map->m_values[m_slot]; }
+		pointer operator->() const { return &m_map->m_values[m_slot]; }
+
+		iterator_base &operator++()
+		{
+			m_slot = m_map->NextFull(m_slot + 1);
+			return *this;
+		}
+		iterator_base operator++(int)
+		{
+			iterator_base it(*this);
+			++*this;
+			return it;
+		}
+
+		bool operator==(const iterator_base &it) const { return m_slot == it.m_slot; }
+		bool operator!=(const iterator_base &it) const { return m_slot != it.m_slot; }
+
+	private:
+		template <typename M, typename T>
+		friend class iterator_base;
+
+		iterator_base(MapT *map, size_t slot) :
+			m_map(map),
+			m_slot(slot) {}
+
+		MapT *m_map;
+		size_t m_slot;
+	};
+
+	typedef iterator_base<SystemPathHashMap, value_type> iterator;
+	typedef iterator_base<const SystemPathHashMap, const value_type> const_iterator;
+
+	SystemPathHashMap() :
+		m_size(0),
+		m_numErased(0) {}
+
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	iterator begin() { return iterator(this, NextFull(0)); }
+	iterator end() { return iterator(this, m_states.size()); }
+	const_iterator begin() const { return const_iterator(this, NextFull(0)); }
+	const_iterator end() const { return const_iterator(this, m_states.size()); }
+
+	iterator find(const SystemPath &path) { return iterator(this, FindSlot(MakeKey(path))); }
+	const_iterator find(const SystemPath &path) const { return const_iterator(this, FindSlot(MakeKey(path))); }
+	size_t count(const SystemPath &path) const { return FindSlot(MakeKey(path)) != m_states.size(); }
+
+	std::pair<iterator, bool> insert(const value_type &value)
+	{
+		const Key key = MakeKey(value.first);
+		size_t slot = FindSlot(key);
+		if (slot != m_states.size())
+			return std::make_pair(iterator(this, slot), false);
+
+		slot = InsertSlot(key);
+		m_values[slot] = value;
+		return std::make_pair(iterator(this, slot), true);
+	}
+
+	V &operator[](const SystemPath &path)
+	{
+		const Key key = MakeKey(path);
+		size_t slot = FindSlot(key);
+		if (slot == m_states.size()) {
+			slot = InsertSlot(key);
+			m_values[slot].first = path;
+		}
+		return m_values[slot].second;
+	}
+
+	size_t erase(const SystemPath &path)
+	{
+		const size_t slot = FindSlot(MakeKey(path));
+		if (slot == m_states.size())
+			return 0;
+		EraseSlot(slot);
+		return 1;
+	}
+
+	void erase(const const_iterator &it) { EraseSlot(it.m_slot); }
+
+	void clear()
+	{
+		m_keys.clear();
+		m_states.clear();
+		m_values.clear();
+		m_size = m_numErased = 0;
+	}
+
+private:
+	static constexpr size_t MIN_CAPACITY = 16;
+	static constexpr int SECTOR_BITS = 21;
+	static constexpr uint64_t SECTOR_MASK = (uint64_t(1) << SECTOR_BITS) - 1;
+
+	static Key MakeKey(const SystemPath &path)
+	{
+		assert(path.sectorX >= -(1 << (SECTOR_BITS - 1)) && path.sectorX < (1 << (SECTOR_BITS - 1)));
+		assert(path.sectorY >= -(1 << (SECTOR_BITS - 1)) && path.sectorY < (1 << (SECTOR_BITS - 1)));
+		assert(path.sectorZ >= -(1 << (SECTOR_BITS - 1)) && path.sectorZ < (1 << (SECTOR_BITS - 1)));
+
+		Key key;
+		key.sector = (uint64_t(uint32_t(path.sectorX)) & SECTOR_MASK) |
+			((uint64_t(uint32_t(path.sectorY)) & SECTOR_MASK) << SECTOR_BITS) |
+			((uint64_t(uint32_t(path.sectorZ)) & SECTOR_MASK) << (2 * SECTOR_BITS));
+		key.system = KeySystem(path, CompareT());
+		return key;
+	}
+
+	static uint32_t KeySystem(const SystemPath &, SystemPath::LessSectorOnly) { return 0; }
+	static uint32_t KeySystem(const SystemPath &path, SystemPath::LessSystemOnly) { return path.systemIndex; }
+
+	static size_t Hash(const Key &key)
+	{
+		// splitmix64 finaliser, neighbouring sectors differ in only a few bits
+		uint64_t h = key.sector ^ (uint64_t(key.system) * 0x9E3779B97F4A7C15ull);
+		h ^= h >> 30;
+		h *= 0xBF58476D1CE4E5B9ull;
+		h ^= h >> 27;
+		h *= 0x94D049BB133111EBull;
+		h ^= h >> 31;
+		return size_t(h);
+	}
+
+	size_t NextFull(size_t slot) const
+	{
+		while (slot < m_states.size() && m_states[slot] != SLOT_FULL)
+			slot++;
+		return slot;
+	}
+
+	// the slot holding key, or the number of slots if it isn't there
+	size_t FindSlot(const Key &key) const
+	{
+		if (m_states.empty())
+			return 0;
+
+		const size_t mask = m_states.size() - 1;
+		for (size_t slot = Hash(key) & mask;; slot = (slot + 1) & mask) {
+			if (m_states[slot] == SLOT_EMPTY)
+				return m_states.size();
+			if (m_states[slot] == SLOT_FULL && m_keys[slot] == key)
+				return slot;
+		}
+	}
+
+	// a free slot for a key known not to be in the map
+	size_t InsertSlot(const Key &key)
+	{
+		// at most three quarters of the slots are in use, tombstones included
+		if ((m_size + m_numErased + 1) * 4 > m_states.size() * 3)
+			Rehash();
+
+		const size_t mask = m_states.size() - 1;
+		size_t slot = Hash(key) & mask;
+		while (m_states[slot] == SLOT_FULL)
+			slot = (slot + 1) & mask;
+
+		if (m_states[slot] == SLOT_ERASED)
+			m_numErased--;
+		m_states[slot] = SLOT_FULL;
+		m_keys[slot] = key;
+		m_size++;
+		return slot;
+	}
+
+	void EraseSlot(size_t slot)
+	{
+		assert(m_states[slot] == SLOT_FULL);
+		m_states[slot] = SLOT_ERASED;
+		m_values[slot] = value_type();
+		m_size--;
+		m_numErased++;
+	}
+
+	void Rehash()
+	{
+		// grow if the entries alone would fill more than half, otherwise
+		// only clear out the tombstones
+		size_t capacity = MIN_CAPACITY;
+		while ((m_size + 1) * 2 > capacity)
+			capacity *= 2;
+
+		std::vector<Key> keys(capacity);
+		std::vector<uint8_t> states(capacity, SLOT_EMPTY);
+		std::vector<value_type> values(capacity);
+
+		const size_t mask = capacity - 1;
+		for (size_t i = 0; i < m_states.size(); i++) {
+			if (m_states[i] != SLOT_FULL)
+				continue;
+
+			size_t slot = Hash(m_keys[i]) & mask;
+			while (states[slot] == SLOT_FULL)
+				slot = (slot + 1) & mask;
+
+			states[slot] = SLOT_FULL;
+			keys[slot] = m_keys[i];
+			values[slot] = std::move(m_values[i]);
+		}
+
+		m_keys.swap(keys);
+		m_states.swap(states);
+		m_values.swap(values);
+		m_numErased = 0;
+	}
+
+	std::vector<Key> m_keys;
+	std::vector<uint8_t> m_states;
+	std::vector<value_type> m_values;
+	size_t m_size;
+	size_t m_numErased;
+};
+
+#endif
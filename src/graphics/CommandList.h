@@ -0,0 +1,39 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include "matrix4x4.h"
+
+namespace Graphics {
+
+	class InstanceBuffer;
+	class Material;
+	class MeshObject;
+
+	/*
+	 * A list of draw commands recorded apart from the renderer's own, so that
+	 * several worker threads can each record one in parallel.
+	 *
+	 * Lists are obtained from Renderer::BeginCommandList() and handed back with
+	 * Renderer::SubmitCommandList(), both on the main thread. Submitted lists
+	 * are executed in submission order, after whatever had been drawn through
+	 * the renderer before, at the next command buffer flush.
+	 *
+	 * While any list is being recorded, the renderer's lights, ambient color
+	 * and projection must not change, and a material drawn into one list must
+	 * not be drawn into another or modified by any other thread.
+	 */
+	class CommandList {
+	public:
+		virtual ~CommandList() {}
+
+		// the view transform of the following draws; a list starts out with
+		// the renderer's transform at the time it was begun
+		virtual void SetTransform(const matrix4x4f &m) = 0;
+
+		virtual void DrawMesh(MeshObject *mesh, Material *mat) = 0;
+		virtual void DrawMeshInstanced(MeshObject *mesh, Material *mat, InstanceBuffer *inst) = 0;
+	};
+
+} // namespace Graphics
@@ -204,9 +204,7 @@ namespace Graphics {
 
 		//------------------------------------------------------------
 
-		Lines::Lines() :
-			m_refreshVertexBuffer(true),
-			m_va(new VertexArray(Graphics::ATTRIB_POSITION | Graphics::ATTRIB_DIFFUSE))
+		Lines::Lines()
 		{
 			PROFILE_SCOPED()
 			// XXX bug in Radeon drivers will cause crash in glLineWidth if width >= 3
@@ -217,19 +215,9 @@ namespace Graphics {
 			PROFILE_SCOPED()
 			assert(vertices);
 
-			// somethings changed so even if the number of verts is constant the data must be uploaded
-			m_refreshVertexBuffer = true;
-
-			// if the number of vert mismatches then clear the current vertex buffer
-			if (m_lineMesh.Valid() && m_lineMesh->GetVertexBuffer()->GetCapacity() < vertCount) {
-				// a new one will be created when it is drawn
-				m_lineMesh.Reset();
-			}
-
-			// populate the VertexArray
-			m_va->Clear(vertCount);
+			m_vertices.resize(vertCount);
 			for (Uint32 i = 0; i < vertCount; i++) {
-				m_va->Add(vertices[i], color);
+				m_vertices[i] = { vertices[i], color };
 			}
 		}
 
@@ -238,55 +226,29 @@ namespace Graphics {
 			PROFILE_SCOPED()
 			assert(vertices);
 
-			// somethings changed so even if the number of verts is constant the data must be uploaded
-			m_refreshVertexBuffer = true;
-
-			// if the number of vert mismatches then clear the current vertex buffer
-			if (m_lineMesh.Valid() && m_lineMesh->GetVertexBuffer()->GetCapacity() < vertCount) {
-				// a new one will be created when it is drawn
-				m_lineMesh.Reset();
-			}
-
-			// populate the VertexArray
-			m_va->Clear(vertCount);
+			m_vertices.resize(vertCount);
 			for (Uint32 i = 0; i < vertCount; i++) {
-				m_va->Add(vertices[i], colors[i]);
+				m_vertices[i] = { vertices[i], colors[i] };
 			}
 		}
 
 		void Lines::Draw(Renderer *r, Material *mat)
 		{
 			PROFILE_SCOPED()
-			if (m_va->IsEmpty())
+			if (m_vertices.empty())
 				return;
 
-			/*
-			if (!m_lineMesh.Valid()) {
-				Graphics::VertexBufferDesc vbd = VertexBufferDesc::FromAttribSet(m_va->GetAttributeSet());
-				vbd.usage = Graphics::BUFFER_USAGE_DYNAMIC;
-				vbd.numVertices = m_va->GetNumVerts() * 2; // ask for twice as many as we need to reduce buffer thrashing
-				m_lineMesh.Reset(r->CreateMeshObject(r->CreateVertexBuffer(vbd)));
-				m_refreshVertexBuffer = true;
-			}
-
-			if (m_refreshVertexBuffer) {
-				m_refreshVertexBuffer = false;
-				m_lineMesh->GetVertexBuffer()->Populate(*m_va);
-			}
-			*/
-
 			// XXX would be nicer to draw this as a textured triangle strip
 			// can't guarantee linewidth support
 			// glLineWidth(m_width);
-			// r->DrawMesh(m_lineMesh.Get(), mat);
-			r->DrawBuffer(m_va.get(), mat);
+			VertexWriter<VertexPosCol> out(r, mat, Uint32(m_vertices.size()));
+			out.Add(m_vertices.data(), Uint32(m_vertices.size()));
 			// glLineWidth(1.f);
 		}
 
 		//------------------------------------------------------------
 		PointSprites::PointSprites() :
-			m_refreshVertexBuffer(true),
-			m_va(new VertexArray(ATTRIB_POSITION | ATTRIB_NORMAL | ATTRIB_DIFFUSE))
+			m_refreshVertexBuffer(true)
 		{
 		}
 
@@ -298,11 +260,9 @@ namespace Graphics {
 
 			assert(positions);
 
-			m_va->Clear(count);
-
+			m_vertices.resize(count);
 			for (int i = 0; i < count; i++) {
-				vector3f vSize(sizes[i]);
-				m_va->Add(positions[i], colours[i], vSize);
+				m_vertices[i] = { positions[i], vector3f(sizes[i]), colours[i] };
 			}
 
 			m_refreshVertexBuffer = true;
@@ -314,14 +274,11 @@ namespace Graphics {
 			if (count < 1)
 				return;
 
-			m_va->Clear();
-			m_va->position = std::move(positions);
-			m_va->diffuse = std::move(colors);
-
-			m_va->normal.reserve(count);
-			for (int i = 0; i < count; i++) {
-				m_va->normal.emplace_back(sizes[i]);
-			}
+			// the vertices are interleaved, so the arrays are only consumed
+			SetData(count, positions.data(), colors.data(), sizes.data());
+			positions.clear();
+			colors.clear();
+			sizes.clear();
 		}
 
 		void PointSprites::Draw(Renderer *r, Material *mat)
@@ -329,17 +286,20 @@ namespace Graphics {
 			PROFILE_SCOPED()
 			assert(r->GetMaterialRenderState(mat).primitiveType == Graphics::POINTS);
 
-			if (m_va->GetNumVerts() == 0)
+			if (m_vertices.empty())
 				return;
 
-			if (!m_pointData.Valid()) {
-				m_pointData.Reset(r->CreateMeshObjectFromArray(m_va.get()));
-				m_refreshVertexBuffer = false;
+			const Uint32 numVerts = Uint32(m_vertices.size());
+			if (!m_pointData.Valid() || m_pointData->GetVertexBuffer()->GetCapacity() < numVerts) {
+				const auto desc = CreateVertexDesc<VertexPosNormCol>(numVerts, BUFFER_USAGE_STATIC);
+				m_pointData.Reset(r->CreateMeshObject(r->CreateVertexBuffer(desc)));
+				m_refreshVertexBuffer = true;
 			}
 
 			if (m_refreshVertexBuffer) {
 				m_refreshVertexBuffer = false;
-				m_pointData->GetVertexBuffer()->Populate(*m_va);
+				VertexWriter<VertexPosNormCol> out(m_pointData->GetVertexBuffer());
+				out.Add(m_vertices.data(), numVerts);
 			}
 
 			r->DrawMesh(m_pointData.Get(), mat);
@@ -347,13 +307,21 @@ namespace Graphics {
 
 		//------------------------------------------------------------
 
-		Points::Points() :
-			m_refreshVertexBuffer(true),
-			m_va(new VertexArray(ATTRIB_POSITION | ATTRIB_DIFFUSE))
+		Points::Points()
 		{
 			PROFILE_SCOPED()
 		}
 
+		VertexBuffer *Points::GetVertexBuffer(Renderer *r, const Uint32 numVerts)
+		{
+			if (!m_pointMesh.Valid() || m_pointMesh->GetVertexBuffer()->GetCapacity() < numVerts) {
+				const auto desc = CreateVertexDesc<VertexPosCol>(numVerts, BUFFER_USAGE_DYNAMIC);
+				m_pointMesh.Reset(r->CreateMeshObject(r->CreateVertexBuffer(desc)));
+			}
+
+			return m_pointMesh->GetVertexBuffer();
+		}
+
 		void Points::SetData(Renderer *r, const int count, const vector3f *positions, const matrix4x4f &trans, const Color &color, const float size)
 		{
 			PROFILE_SCOPED()
@@ -363,8 +331,6 @@ namespace Graphics {
 			assert(positions);
 			const unsigned int total = (count * 6);
 
-			m_va->Clear(total);
-
 			matrix4x4f rot(trans);
 			rot.ClearToRotOnly();
 			rot = rot.Inverse();
@@ -378,25 +344,18 @@ namespace Graphics {
 			//do two-triangle quads. Could also do indexed surfaces.
 			//PiGL renderer should use actual point sprites
 			//(see history of Render.cpp for point code remnants)
+			VertexWriter<VertexPosCol> out(GetVertexBuffer(r, total));
 			for (int i = 0; i < count; i++) {
 				const vector3f &pos = positions[i];
 
-				m_va->Add(pos + rotv4, color); //top left
-				m_va->Add(pos + rotv3, color); //bottom left
-				m_va->Add(pos + rotv1, color); //top right
-
-				m_va->Add(pos + rotv1, color); //top right
-				m_va->Add(pos + rotv3, color); //bottom left
-				m_va->Add(pos + rotv2, color); //bottom right
-			}
+				out.Add({ pos + rotv4, color }); //top left
+				out.Add({ pos + rotv3, color }); //bottom left
+				out.Add({ pos + rotv1, color }); //top right
 
-			// if the number of vert mismatches then clear the current vertex buffer
-			if (m_pointMesh.Valid() && m_pointMesh->GetVertexBuffer()->GetCapacity() < total) {
-				// a new one will be created when it is drawn
-				m_pointMesh.Reset();
+				out.Add({ pos + rotv1, color }); //top right
+				out.Add({ pos + rotv3, color }); //bottom left
+				out.Add({ pos + rotv2, color }); //bottom right
 			}
-
-			m_refreshVertexBuffer = true;
 		}
 
 		void Points::SetData(Renderer *r, const int count, const vector3f *positions, const Color *color, const matrix4x4f &trans, const float size)
@@ -408,8 +367,6 @@ namespace Graphics {
 			assert(positions);
 			const unsigned int total = (count * 6);
 
-			m_va->Clear(total);
-
 			matrix4x4f rot(trans);
 			rot.ClearToRotOnly();
 			rot = rot.Inverse();
@@ -421,44 +378,26 @@ namespace Graphics {
 			//do two-triangle quads. Could also do indexed surfaces.
 			//PiGL renderer should use actual point sprites
 			//(see history of Render.cpp for point code remnants)
+			VertexWriter<VertexPosCol> out(GetVertexBuffer(r, total));
 			for (int i = 0; i < count; i++) {
 				const vector3f &pos = positions[i];
 
-				m_va->Add(pos - rotv2, color[i]); //top left
-				m_va->Add(pos - rotv1, color[i]); //bottom left
-				m_va->Add(pos + rotv1, color[i]); //top right
+				out.Add({ pos - rotv2, color[i] }); //top left
+				out.Add({ pos - rotv1, color[i] }); //bottom left
+				out.Add({ pos + rotv1, color[i] }); //top right
 
-				m_va->Add(pos + rotv1, color[i]); //top right
-				m_va->Add(pos - rotv1, color[i]); //bottom left
-				m_va->Add(pos + rotv2, color[i]); //bottom right
+				out.Add({ pos + rotv1, color[i] }); //top right
+				out.Add({ pos - rotv1, color[i] }); //bottom left
+				out.Add({ pos + rotv2, color[i] }); //bottom right
 			}
-
-			// if the number of vert mismatches then clear the current vertex buffer
-			if (m_pointMesh.Valid() && m_pointMesh->GetVertexBuffer()->GetCapacity() < total) {
-				// a new one will be created when it is drawn
-				m_pointMesh.Reset();
-			}
-
-			m_refreshVertexBuffer = true;
 		}
 
 		void Points::Draw(Renderer *r, Material *mat)
 		{
 			PROFILE_SCOPED()
-			if (m_va->GetNumVerts() == 0)
+			if (!m_pointMesh.Valid())
 				return;
 
-			if (!m_pointMesh.Valid()) {
-				m_pointMesh.Reset(r->CreateMeshObjectFromArray(m_va.get()));
-				// the vertex buffer will have already been populated during creation
-				m_refreshVertexBuffer = false;
-			}
-
-			if (m_refreshVertexBuffer) {
-				m_refreshVertexBuffer = false;
-				m_pointMesh->GetVertexBuffer()->Populate(*m_va);
-			}
-
 			r->DrawMesh(m_pointMesh.Get(), mat);
 		}
 
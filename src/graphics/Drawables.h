@@ -7,6 +7,7 @@
 #include "graphics/Material.h"
 #include "graphics/VertexArray.h"
 #include "graphics/VertexBuffer.h"
+#include "graphics/VertexWriter.h"
 
 #include <memory>
 
@@ -88,9 +89,8 @@ namespace Graphics {
 			void Draw(Renderer *, Material *);
 
 		private:
-			bool m_refreshVertexBuffer;
-			RefCountedPtr<MeshObject> m_lineMesh;
-			std::unique_ptr<VertexArray> m_va;
+			// written to the renderer's dynamic draw buffer as they are
+			std::vector<VertexPosCol> m_vertices;
 		};
 		//------------------------------------------------------------
 
@@ -109,7 +109,8 @@ namespace Graphics {
 		private:
 			bool m_refreshVertexBuffer;
 			RefCountedPtr<Graphics::MeshObject> m_pointData;
-			std::unique_ptr<VertexArray> m_va;
+			// the size of each point is passed in the normal
+			std::vector<VertexPosNormCol> m_vertices;
 		};
 		//------------------------------------------------------------
 
@@ -122,11 +123,11 @@ namespace Graphics {
 			void Draw(Renderer *, Material *);
 
 		private:
-			void CreateVertexBuffer(Graphics::Renderer *r, const Uint32 size);
+			// returns a mesh with room for at least numVerts vertices
+			VertexBuffer *GetVertexBuffer(Graphics::Renderer *r, const Uint32 numVerts);
 
-			bool m_refreshVertexBuffer;
+			// the quads are written straight into its vertex buffer
 			RefCountedPtr<MeshObject> m_pointMesh;
-			std::unique_ptr<VertexArray> m_va;
 		};
 
 		//------------------------------------------------------------
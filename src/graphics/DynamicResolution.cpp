@@ -0,0 +1,64 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Graphics;
+
+DynamicResolution::DynamicResolution(const Settings &settings) :
+	m_settings(settings)
+{
+	m_settings.maxScale = std::clamp(m_settings.maxScale, 0.1f, 1.f);
+	m_settings.minScale = std::clamp(m_settings.minScale, 0.1f, m_settings.maxScale);
+	m_scale = m_settings.maxScale;
+}
+
+void DynamicResolution::Reset()
+{
+	m_scale = m_settings.maxScale;
+	m_settleFrames = 0;
+	m_underBudgetFrames = 0;
+}
+
+void DynamicResolution::SetScale(float scale)
+{
+	scale = std::clamp(scale, m_settings.minScale, m_settings.maxScale);
+	if (scale == m_scale)
+		return;
+
+	m_scale = scale;
+	m_settleFrames = SETTLE_FRAMES;
+	m_underBudgetFrames = 0;
+}
+
+void DynamicResolution::Update(double gpuFrameTime)
+{
+	if (gpuFrameTime < 0.0 || m_settings.targetFrameTime <= 0.0)
+		return;
+
+	// still measuring frames drawn at the previous scale
+	if (m_settleFrames > 0) {
+		m_settleFrames--;
+		return;
+	}
+
+	const double budget = m_settings.targetFrameTime;
+	if (gpuFrameTime > budget) {
+		m_underBudgetFrames = 0;
+		// the pixel count goes with the square of the scale
+		SetScale(m_scale * float(std::sqrt(budget / gpuFrameTime)));
+	} else if (gpuFrameTime < budget * RAISE_THRESHOLD) {
+		if (++m_underBudgetFrames >= RAISE_FRAMES)
+			SetScale(m_scale + RAISE_STEP);
+	} else {
+		m_underBudgetFrames = 0;
+	}
+}
+
+int DynamicResolution::GetScaledSize(int size) const
+{
+	return std::max(1, int(std::lround(size * m_scale)));
+}
@@ -0,0 +1,58 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include <cstdint>
+
+namespace Graphics {
+
+	/*
+	 * Picks the scale the 3D scene is rendered at from the measured GPU frame
+	 * time, to keep it within a budget when something expensive (a planet
+	 * with atmosphere filling the view) comes into sight.
+	 *
+	 * Over budget, the scale drops straight to the one that would have met it,
+	 * on the assumption that GPU time goes with the number of pixels. Well
+	 * under budget it creeps back up a step at a time. As GPU times arrive a
+	 * few frames late, the times measured just after a change are ignored.
+	 */
+	class DynamicResolution {
+	public:
+		struct Settings {
+			float minScale = 0.5f;
+			float maxScale = 1.f;
+			double targetFrameTime = 16.0; // ms of GPU time per frame
+		};
+
+		// measurements ignored after the scale changes
+		static constexpr uint32_t SETTLE_FRAMES = 4;
+		// measurements under budget before the scale is raised
+		static constexpr uint32_t RAISE_FRAMES = 30;
+		// below this share of the budget, the scale may be raised
+		static constexpr double RAISE_THRESHOLD = 0.8;
+		static constexpr float RAISE_STEP = 0.05f;
+
+		explicit DynamicResolution(const Settings &settings);
+
+		const Settings &GetSettings() const { return m_settings; }
+
+		// with the GPU time of a frame in milliseconds; negative if there's
+		// no measurement this frame
+		void Update(double gpuFrameTime);
+		void Reset();
+
+		float GetScale() const { return m_scale; }
+		// the scaled size of a target, in whole pixels
+		int GetScaledSize(int size) const;
+
+	private:
+		void SetScale(float scale);
+
+		Settings m_settings;
+		float m_scale;
+		uint32_t m_settleFrames = 0;
+		uint32_t m_underBudgetFrames = 0;
+	};
+
+} // namespace Graphics
@@ -5,6 +5,11 @@
 #include "Graphics.h"
 #include "MathUtil.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_SIMD_SSE2 1
+#endif
+
 namespace Graphics {
 
 	// min/max FOV in degrees
@@ -71,6 +76,11 @@ namespace Graphics {
 			m_planes[i].b *= invlen;
 			m_planes[i].c *= invlen;
 			m_planes[i].d *= invlen;
+
+			m_planesf[i][0] = float(m_planes[i].a);
+			m_planesf[i][1] = float(m_planes[i].b);
+			m_planesf[i][2] = float(m_planes[i].c);
+			m_planesf[i][3] = float(m_planes[i].d);
 		}
 	}
 
@@ -91,6 +101,96 @@ namespace Graphics {
 		return true;
 	}
 
+	bool Frustum::ContainsPoint(const vector3d &p, double radius) const
+	{
+		for (int i = 0; i < 6; i++)
+			if (m_planes[i].DistanceToPoint(p) - radius < 0)
+				return false;
+		return true;
+	}
+
+	// Tests count items against the planes, four at a time where SSE2 is
+	// available. getPoint(plane, i) gives the point of item i to measure
+	// against the plane, and its slack: how far behind the plane the point
+	// may be and still count as in view. The SIMD version has the same from
+	// getPoint4, for items i..i+3.
+	template <typename PointFn, typename Point4Fn>
+	static void TestBatch(const float (&planes)[6][4], size_t count, std::vector<uint32_t> &visible, PointFn getPoint, Point4Fn getPoint4)
+	{
+		visible.assign((count + 31) / 32, 0);
+
+		size_t i = 0;
+#ifdef FRUSTUM_SIMD_SSE2
+		for (; i + 4 <= count; i += 4) {
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				__m128 x, y, z, slack;
+				getPoint4(p, i, x, y, z, slack);
+				__m128 dist = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(planes[p][0])), _mm_mul_ps(y, _mm_set1_ps(planes[p][1])));
+				dist = _mm_add_ps(dist, _mm_mul_ps(z, _mm_set1_ps(planes[p][2])));
+				dist = _mm_add_ps(dist, _mm_add_ps(_mm_set1_ps(planes[p][3]), slack));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, _mm_setzero_ps()));
+			}
+			// i is a multiple of four, so the lanes never straddle two words
+			visible[i >> 5] |= uint32_t(_mm_movemask_ps(inside)) << (i & 31);
+		}
+#endif
+		for (; i < count; i++) {
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++) {
+				float x, y, z, slack;
+				getPoint(p, i, x, y, z, slack);
+				inside = planes[p][0] * x + planes[p][1] * y + planes[p][2] * z + planes[p][3] + slack >= 0.0f;
+			}
+			if (inside)
+				visible[i >> 5] |= 1u << (i & 31);
+		}
+	}
+
+	void Frustum::TestSpheres(const SphereBatch &spheres, std::vector<uint32_t> &visible) const
+	{
+		// the sphere's centre, which may be up to its radius behind a plane
+		TestBatch(
+			m_planesf, spheres.Size(), visible,
+			[&](int, size_t i, float &x, float &y, float &z, float &slack) {
+				x = spheres.x[i];
+				y = spheres.y[i];
+				z = spheres.z[i];
+				slack = spheres.radius[i];
+			},
+			[&](int, size_t i, auto &x, auto &y, auto &z, auto &slack) {
+#ifdef FRUSTUM_SIMD_SSE2
+				x = _mm_loadu_ps(&spheres.x[i]);
+				y = _mm_loadu_ps(&spheres.y[i]);
+				z = _mm_loadu_ps(&spheres.z[i]);
+				slack = _mm_loadu_ps(&spheres.radius[i]);
+#endif
+			});
+	}
+
+	void Frustum::TestAabbs(const AabbBatch &boxes, std::vector<uint32_t> &visible) const
+	{
+		// the box's corner furthest along the plane's normal; if even that is
+		// behind the plane, so is the rest of the box
+		const float(&planes)[6][4] = m_planesf;
+		TestBatch(
+			m_planesf, boxes.Size(), visible,
+			[&](int p, size_t i, float &x, float &y, float &z, float &slack) {
+				x = planes[p][0] >= 0.0f ? boxes.maxX[i] : boxes.minX[i];
+				y = planes[p][1] >= 0.0f ? boxes.maxY[i] : boxes.minY[i];
+				z = planes[p][2] >= 0.0f ? boxes.maxZ[i] : boxes.minZ[i];
+				slack = 0.0f;
+			},
+			[&](int p, size_t i, auto &x, auto &y, auto &z, auto &slack) {
+#ifdef FRUSTUM_SIMD_SSE2
+				x = _mm_loadu_ps(&(planes[p][0] >= 0.0f ? boxes.maxX : boxes.minX)[i]);
+				y = _mm_loadu_ps(&(planes[p][1] >= 0.0f ? boxes.maxY : boxes.minY)[i]);
+				z = _mm_loadu_ps(&(planes[p][2] >= 0.0f ? boxes.maxZ : boxes.minZ)[i]);
+				slack = _mm_setzero_ps();
+#endif
+			});
+	}
+
 	// Returns a vector3d in the range { 0..1, 0..1, 1..0 }
 	bool Frustum::ProjectPoint(const vector3d &in, vector3d &out) const
 	{
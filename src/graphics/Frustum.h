@@ -8,8 +8,58 @@
 #include "matrix4x4.h"
 #include "vector3.h"
 
+#include <cstdint>
+#include <vector>
+
 namespace Graphics {
 
+	// Spheres laid out for testing against a frustum in batches, with one
+	// array per component
+	struct SphereBatch {
+		std::vector<float> x, y, z, radius;
+
+		size_t Size() const { return x.size(); }
+		void Clear()
+		{
+			x.clear();
+			y.clear();
+			z.clear();
+			radius.clear();
+		}
+		void Add(const vector3f &centre, float r)
+		{
+			x.push_back(centre.x);
+			y.push_back(centre.y);
+			z.push_back(centre.z);
+			radius.push_back(r);
+		}
+	};
+
+	// Axis-aligned boxes laid out as SphereBatch is
+	struct AabbBatch {
+		std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+
+		size_t Size() const { return minX.size(); }
+		void Clear()
+		{
+			minX.clear();
+			minY.clear();
+			minZ.clear();
+			maxX.clear();
+			maxY.clear();
+			maxZ.clear();
+		}
+		void Add(const vector3f &min, const vector3f &max)
+		{
+			minX.push_back(min.x);
+			minY.push_back(min.y);
+			minZ.push_back(min.z);
+			maxX.push_back(max.x);
+			maxY.push_back(max.y);
+			maxZ.push_back(max.z);
+		}
+	};
+
 	// Frustum can be used for projecting points (3D to 2D) and testing
 	// if a point lies inside the visible area
 	// Its' internal projection matrix should, but does not have to, match
@@ -24,6 +74,18 @@ namespace Graphics {
 		bool TestPoint(const vector3d &p, double radius) const;
 		// test if point (sphere) is in the frustum, ignoring the far plane
 		bool TestPointInfinite(const vector3d &p, double radius) const;
+		// test if point (sphere) is entirely inside the frustum
+		bool ContainsPoint(const vector3d &p, double radius) const;
+
+		// Test a whole batch against all six planes, several at a time, as
+		// TestPoint does for a sphere. This is single precision, so meant for
+		// camera-relative positions. Bit (i % 32) of visible[i / 32] is set
+		// for each item i in view.
+		void TestSpheres(const SphereBatch &spheres, std::vector<uint32_t> &visible) const;
+		// a box is in view unless it's entirely behind one of the planes
+		void TestAabbs(const AabbBatch &boxes, std::vector<uint32_t> &visible) const;
+
+		static bool IsVisible(const std::vector<uint32_t> &visible, size_t i) { return visible[i >> 5] & (1u << (i & 31)); }
 
 		// project a point onto the near plane (typically the screen)
 		bool ProjectPoint(const vector3d &in, vector3d &out) const;
@@ -41,6 +103,7 @@ namespace Graphics {
 		matrix4x4d m_projMatrix;
 		matrix4x4d m_modelMatrix;
 		SPlane m_planes[6];
+		float m_planesf[6][4]; // for the batch tests
 		double m_translateThresholdSqr;
 	};
 
@@ -25,6 +25,15 @@ namespace Graphics {
 		return s_rendererTypeNames[rType];
 	}
 
+	RendererType RendererTypeFromName(const std::string &name)
+	{
+		for (int type = 0; type < MAX_RENDERER_TYPE; type++) {
+			if (name == RendererNameFromType(RendererType(type)))
+				return RendererType(type);
+		}
+		return MAX_RENDERER_TYPE;
+	}
+
 	static RendererCreateFunc rendererCreateFunc[MAX_RENDERER_TYPE] = {};
 
 	void RegisterRenderer(RendererType type, RendererCreateFunc fn)
@@ -34,6 +43,11 @@ namespace Graphics {
 		rendererCreateFunc[type] = fn;
 	}
 
+	bool IsRendererRegistered(RendererType type)
+	{
+		return type < MAX_RENDERER_TYPE && rendererCreateFunc[type];
+	}
+
 	static bool initted = false;
 	Material *vtxColorMaterial;
 	static float g_fov = 85.f;
@@ -7,6 +7,7 @@
 #include "RenderTarget.h"
 #include "matrix4x4.h"
 #include <memory>
+#include <string>
 #include <vector>
 
 /*
@@ -22,6 +23,8 @@ namespace Graphics {
 	};
 
 	const char *RendererNameFromType(const RendererType rType);
+	// MAX_RENDERER_TYPE if no renderer has the name
+	RendererType RendererTypeFromName(const std::string &name);
 
 	// requested video settings
 	struct Settings {
@@ -30,6 +33,11 @@ namespace Graphics {
 		bool hidden;
 		bool useTextureCompression;
 		bool useAnisotropicFiltering;
+		bool sortDrawCommands;
+		bool usePersistentBuffers;
+		bool batchInstances;
+		bool useProgramCache;
+		bool parallelShaderCompile;
 		bool enableDebugMessages;
 		bool gl3ForwardCompatible;
 		bool canBeResized;
@@ -45,6 +53,8 @@ namespace Graphics {
 
 	typedef Renderer *(*RendererCreateFunc)(const Settings &vs);
 	void RegisterRenderer(RendererType type, RendererCreateFunc fn);
+	// whether the renderer was built into this executable and registered
+	bool IsRendererRegistered(RendererType type);
 
 	//for querying available modes
 	struct VideoMode {
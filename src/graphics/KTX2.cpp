@@ -0,0 +1,499 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "KTX2.h"
+#include "MathUtil.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+#include "miniz/miniz.h"
+}
+
+namespace Graphics {
+	namespace KTX2 {
+
+		static const uint8_t s_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+		// identifier, the nine fields of the header and the index
+		static const size_t HEADER_SIZE = 80;
+		static const size_t LEVEL_INDEX_ENTRY_SIZE = 24;
+
+		enum : uint32_t {
+			VK_FORMAT_UNDEFINED = 0,
+			VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131,
+			VK_FORMAT_BC1_RGB_SRGB_BLOCK = 132,
+			VK_FORMAT_BC3_UNORM_BLOCK = 137,
+			VK_FORMAT_BC3_SRGB_BLOCK = 138
+		};
+
+		enum : uint32_t {
+			SUPERCOMPRESSION_NONE = 0,
+			SUPERCOMPRESSION_BASIS_LZ = 1,
+			SUPERCOMPRESSION_ZSTD = 2,
+			SUPERCOMPRESSION_ZLIB = 3
+		};
+
+		// Khronos data format descriptor values
+		enum : uint32_t {
+			KHR_DF_MODEL_BC1A = 128,
+			KHR_DF_MODEL_BC3 = 130,
+			KHR_DF_PRIMARIES_BT709 = 1,
+			KHR_DF_TRANSFER_LINEAR = 1,
+			KHR_DF_CHANNEL_COLOR = 0,
+			KHR_DF_CHANNEL_BC3_ALPHA = 15
+		};
+
+		static uint32_t ReadU32(const char *p)
+		{
+			const uint8_t *b = reinterpret_cast<const uint8_t *>(p);
+			return uint32_t(b[0]) | (uint32_t(b[1]) << 8) | (uint32_t(b[2]) << 16) | (uint32_t(b[3]) << 24);
+		}
+
+		static uint64_t ReadU64(const char *p)
+		{
+			return uint64_t(ReadU32(p)) | (uint64_t(ReadU32(p + 4)) << 32);
+		}
+
+		static void PutU32(std::string &out, uint32_t v)
+		{
+			for (int i = 0; i < 4; i++)
+				out.push_back(char((v >> (i * 8)) & 0xff));
+		}
+
+		static void PutU64(std::string &out, uint64_t v)
+		{
+			PutU32(out, uint32_t(v));
+			PutU32(out, uint32_t(v >> 32));
+		}
+
+		static uint32_t GetBlockSize(TextureFormat format)
+		{
+			return format == TEXTURE_DXT5 ? 16 : 8;
+		}
+
+		// bytes in one face of a level
+		static size_t GetLevelSize(uint32_t width, uint32_t height, uint32_t level, uint32_t blockSize)
+		{
+			const size_t w = std::max(width >> level, 1U);
+			const size_t h = std::max(height >> level, 1U);
+			return ((w + 3) / 4) * ((h + 3) / 4) * blockSize;
+		}
+
+		bool IsKTX2(const char *data, size_t size)
+		{
+			return size >= sizeof(s_identifier) && memcmp(data, s_identifier, sizeof(s_identifier)) == 0;
+		}
+
+		bool Read(const char *data, size_t size, Image &image, std::string &error)
+		{
+			if (!IsKTX2(data, size) || size < HEADER_SIZE) {
+				error = "not a KTX2 file";
+				return false;
+			}
+
+			const uint32_t vkFormat = ReadU32(data + 12);
+			const uint32_t width = ReadU32(data + 20);
+			const uint32_t height = ReadU32(data + 24);
+			const uint32_t depth = ReadU32(data + 28);
+			const uint32_t layers = ReadU32(data + 32);
+			const uint32_t faces = ReadU32(data + 36);
+			const uint32_t levels = std::max(ReadU32(data + 40), 1U);
+			const uint32_t scheme = ReadU32(data + 44);
+
+			TextureFormat format;
+			switch (vkFormat) {
+			case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+				format = TEXTURE_DXT1;
+				break;
+			case VK_FORMAT_BC3_UNORM_BLOCK:
+			case VK_FORMAT_BC3_SRGB_BLOCK:
+				format = TEXTURE_DXT5;
+				break;
+			case VK_FORMAT_UNDEFINED:
+				error = "Basis Universal textures are not supported";
+				return false;
+			default:
+				error = "unsupported format " + std::to_string(vkFormat) + " (only BC1 and BC3 are supported)";
+				return false;
+			}
+
+			if (scheme != SUPERCOMPRESSION_NONE && scheme != SUPERCOMPRESSION_ZLIB) {
+				error = "unsupported supercompression scheme " + std::to_string(scheme);
+				return false;
+			}
+
+			if (!width || !height || depth > 1 || layers > 1 || (faces != 1 && faces != 6) || levels > 32 ||
+				(std::max(width, height) >> (levels - 1)) == 0) {
+				error = "unsupported dimensions";
+				return false;
+			}
+
+			if (HEADER_SIZE + levels * LEVEL_INDEX_ENTRY_SIZE > size) {
+				error = "truncated level index";
+				return false;
+			}
+
+			const uint32_t blockSize = GetBlockSize(format);
+			size_t faceSize = 0;
+			for (uint32_t level = 0; level < levels; level++)
+				faceSize += GetLevelSize(width, height, level, blockSize);
+
+			image.data.resize(faceSize * faces);
+
+			// the file holds each level's faces together
+			std::vector<uint8_t> inflated;
+			size_t levelOffset = 0;
+			for (uint32_t level = 0; level < levels; level++) {
+				const char *entry = data + HEADER_SIZE + level * LEVEL_INDEX_ENTRY_SIZE;
+				const uint64_t offset = ReadU64(entry);
+				const uint64_t length = ReadU64(entry + 8);
+				const uint64_t uncompressedLength = ReadU64(entry + 16);
+				const size_t levelSize = GetLevelSize(width, height, level, blockSize);
+
+				if (offset > size || length > size - offset || uncompressedLength != levelSize * faces) {
+					error = "level " + std::to_string(level) + " is corrupt";
+					return false;
+				}
+
+				const uint8_t *levelData = reinterpret_cast<const uint8_t *>(data + offset);
+				if (scheme == SUPERCOMPRESSION_ZLIB) {
+					inflated.resize(uncompressedLength);
+					const size_t inflatedLength = tinfl_decompress_mem_to_mem(inflated.data(), inflated.size(),
+						levelData, length, TINFL_FLAG_PARSE_ZLIB_HEADER);
+					if (inflatedLength != uncompressedLength) {
+						error = "level " + std::to_string(level) + " failed to decompress";
+						return false;
+					}
+					levelData = inflated.data();
+				} else if (length != uncompressedLength) {
+					error = "level " + std::to_string(level) + " is corrupt";
+					return false;
+				}
+
+				for (uint32_t face = 0; face < faces; face++)
+					memcpy(&image.data[face * faceSize + levelOffset], levelData + face * levelSize, levelSize);
+				levelOffset += levelSize;
+			}
+
+			image.format = format;
+			image.width = width;
+			image.height = height;
+			image.numMipMaps = levels;
+			image.numFaces = faces;
+			return true;
+		}
+
+		static void PutSample(std::string &out, uint32_t bitOffset, uint32_t channel)
+		{
+			PutU32(out, bitOffset | (63 << 16) | (channel << 24)); // 64 bits
+			PutU32(out, 0);							   // sample position
+			PutU32(out, 0);							   // lower
+			PutU32(out, 0xffffffff);				   // upper
+		}
+
+		std::string Write(const Image &image)
+		{
+			assert(image.format == TEXTURE_DXT1 || image.format == TEXTURE_DXT5);
+			const bool bc3 = (image.format == TEXTURE_DXT5);
+			const uint32_t blockSize = GetBlockSize(image.format);
+
+			// the data format descriptor: a basic block with a sample for each
+			// of BC3's alpha and colour halves, or BC1's colour
+			const uint32_t dfdBlockSize = 24 + 16 * (bc3 ? 2 : 1);
+			std::string dfd;
+			PutU32(dfd, 4 + dfdBlockSize);
+			PutU32(dfd, 0); // Khronos, basic descriptor
+			PutU32(dfd, 2 | (dfdBlockSize << 16));
+			PutU32(dfd, (bc3 ? KHR_DF_MODEL_BC3 : KHR_DF_MODEL_BC1A) | (KHR_DF_PRIMARIES_BT709 << 8) | (KHR_DF_TRANSFER_LINEAR << 16));
+			PutU32(dfd, 3 | (3 << 8)); // 4x4 blocks
+			PutU32(dfd, blockSize);
+			PutU32(dfd, 0);
+			if (bc3) {
+				PutSample(dfd, 0, KHR_DF_CHANNEL_BC3_ALPHA);
+				PutSample(dfd, 64, KHR_DF_CHANNEL_COLOR);
+			} else {
+				PutSample(dfd, 0, KHR_DF_CHANNEL_COLOR);
+			}
+
+			// gather each level's faces together and compress them
+			const size_t faceSize = image.GetFaceSize();
+			std::vector<std::string> levels(image.numMipMaps);
+			std::vector<uint64_t> uncompressedLengths(image.numMipMaps);
+			std::vector<uint8_t> levelData;
+			size_t levelOffset = 0;
+			for (uint32_t level = 0; level < image.numMipMaps; level++) {
+				const size_t levelSize = GetLevelSize(image.width, image.height, level, blockSize);
+				levelData.resize(levelSize * image.numFaces);
+				for (uint32_t face = 0; face < image.numFaces; face++)
+					memcpy(&levelData[face * levelSize], &image.data[face * faceSize + levelOffset], levelSize);
+				levelOffset += levelSize;
+
+				size_t compressedLength = 0;
+				void *compressed = tdefl_compress_mem_to_heap(levelData.data(), levelData.size(), &compressedLength,
+					TDEFL_WRITE_ZLIB_HEADER | TDEFL_DEFAULT_MAX_PROBES);
+				levels[level].assign(static_cast<const char *>(compressed), compressedLength);
+				mz_free(compressed);
+				uncompressedLengths[level] = levelData.size();
+			}
+
+			// the levels are stored from the smallest up, after the descriptor
+			const size_t dfdOffset = HEADER_SIZE + image.numMipMaps * LEVEL_INDEX_ENTRY_SIZE;
+			std::vector<uint64_t> offsets(image.numMipMaps);
+			uint64_t offset = dfdOffset + dfd.size();
+			for (uint32_t level = image.numMipMaps; level-- > 0;) {
+				offsets[level] = offset;
+				offset += levels[level].size();
+			}
+
+			std::string out;
+			out.reserve(offset);
+			out.append(reinterpret_cast<const char *>(s_identifier), sizeof(s_identifier));
+			PutU32(out, bc3 ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK);
+			PutU32(out, 1); // type size
+			PutU32(out, image.width);
+			PutU32(out, image.height);
+			PutU32(out, 0); // depth
+			PutU32(out, 0); // layers
+			PutU32(out, image.numFaces);
+			PutU32(out, image.numMipMaps);
+			PutU32(out, SUPERCOMPRESSION_ZLIB);
+
+			PutU32(out, dfdOffset);
+			PutU32(out, dfd.size());
+			PutU32(out, 0); // no key/value data
+			PutU32(out, 0);
+			PutU64(out, 0); // no supercompression global data
+			PutU64(out, 0);
+
+			for (uint32_t level = 0; level < image.numMipMaps; level++) {
+				PutU64(out, offsets[level]);
+				PutU64(out, levels[level].size());
+				PutU64(out, uncompressedLengths[level]);
+			}
+
+			out += dfd;
+			for (uint32_t level = image.numMipMaps; level-- > 0;)
+				out += levels[level];
+
+			return out;
+		}
+
+		static uint16_t To565(const float c[3])
+		{
+			const int r = Clamp(int(c[0] * (31.0f / 255.0f) + 0.5f), 0, 31);
+			const int g = Clamp(int(c[1] * (63.0f / 255.0f) + 0.5f), 0, 63);
+			const int b = Clamp(int(c[2] * (31.0f / 255.0f) + 0.5f), 0, 31);
+			return uint16_t((r << 11) | (g << 5) | b);
+		}
+
+		static void From565(uint16_t v, int c[3])
+		{
+			const int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+			c[0] = (r << 3) | (r >> 2);
+			c[1] = (g << 2) | (g >> 4);
+			c[2] = (b << 3) | (b >> 2);
+		}
+
+		// The colour half of a block, always in four colour mode. The end
+		// points are the extremes of the colours along their principal axis,
+		// inset a little as the ends of the range are rarely hit exactly.
+		static void CompressColorBlock(const uint8_t rgba[64], uint8_t out[8])
+		{
+			float mean[3] = { 0.0f, 0.0f, 0.0f };
+			for (int i = 0; i < 16; i++)
+				for (int c = 0; c < 3; c++)
+					mean[c] += rgba[i * 4 + c] * (1.0f / 16.0f);
+
+			float cov[3][3] = {};
+			for (int i = 0; i < 16; i++) {
+				const float d[3] = { rgba[i * 4] - mean[0], rgba[i * 4 + 1] - mean[1], rgba[i * 4 + 2] - mean[2] };
+				for (int r = 0; r < 3; r++)
+					for (int c = 0; c < 3; c++)
+						cov[r][c] += d[r] * d[c];
+			}
+
+			// power iteration from the luminance direction
+			float axis[3] = { 0.299f, 0.587f, 0.114f };
+			for (int iter = 0; iter < 8; iter++) {
+				float next[3];
+				for (int r = 0; r < 3; r++)
+					next[r] = cov[r][0] * axis[0] + cov[r][1] * axis[1] + cov[r][2] * axis[2];
+				const float len = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+				if (len < 1e-6f)
+					break;
+				for (int r = 0; r < 3; r++)
+					axis[r] = next[r] / len;
+			}
+
+			float lo = 0.0f, hi = 0.0f;
+			for (int i = 0; i < 16; i++) {
+				const float t = (rgba[i * 4] - mean[0]) * axis[0] + (rgba[i * 4 + 1] - mean[1]) * axis[1] + (rgba[i * 4 + 2] - mean[2]) * axis[2];
+				lo = std::min(lo, t);
+				hi = std::max(hi, t);
+			}
+			const float inset = (hi - lo) / 16.0f;
+			lo += inset;
+			hi -= inset;
+
+			float end0[3], end1[3];
+			for (int c = 0; c < 3; c++) {
+				end0[c] = mean[c] + axis[c] * hi;
+				end1[c] = mean[c] + axis[c] * lo;
+			}
+
+			uint16_t c0 = To565(end0), c1 = To565(end1);
+			if (c0 < c1)
+				std::swap(c0, c1);
+
+			out[0] = uint8_t(c0);
+			out[1] = uint8_t(c0 >> 8);
+			out[2] = uint8_t(c1);
+			out[3] = uint8_t(c1 >> 8);
+
+			uint32_t indices = 0;
+			if (c0 != c1) {
+				int palette[4][3];
+				From565(c0, palette[0]);
+				From565(c1, palette[1]);
+				for (int c = 0; c < 3; c++) {
+					palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+					palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+				}
+
+				for (int i = 0; i < 16; i++) {
+					int best = 0, bestError = INT32_MAX;
+					for (int p = 0; p < 4; p++) {
+						int error = 0;
+						for (int c = 0; c < 3; c++) {
+							const int d = rgba[i * 4 + c] - palette[p][c];
+							error += d * d;
+						}
+						if (error < bestError) {
+							best = p;
+							bestError = error;
+						}
+					}
+					indices |= uint32_t(best) << (i * 2);
+				}
+			}
+
+			for (int i = 0; i < 4; i++)
+				out[4 + i] = uint8_t(indices >> (i * 8));
+		}
+
+		// The alpha half of a BC3 block, in eight value mode
+		static void CompressAlphaBlock(const uint8_t rgba[64], uint8_t out[8])
+		{
+			int a0 = 0, a1 = 255;
+			for (int i = 0; i < 16; i++) {
+				a0 = std::max<int>(a0, rgba[i * 4 + 3]);
+				a1 = std::min<int>(a1, rgba[i * 4 + 3]);
+			}
+
+			out[0] = uint8_t(a0);
+			out[1] = uint8_t(a1);
+
+			uint64_t indices = 0;
+			if (a0 != a1) {
+				int palette[8] = { a0, a1 };
+				for (int p = 2; p < 8; p++)
+					palette[p] = ((8 - p) * a0 + (p - 1) * a1) / 7;
+
+				for (int i = 0; i < 16; i++) {
+					int best = 0, bestError = INT32_MAX;
+					for (int p = 0; p < 8; p++) {
+						const int error = std::abs(rgba[i * 4 + 3] - palette[p]);
+						if (error < bestError) {
+							best = p;
+							bestError = error;
+						}
+					}
+					indices |= uint64_t(best) << (i * 3);
+				}
+			}
+
+			for (int i = 0; i < 6; i++)
+				out[2 + i] = uint8_t(indices >> (i * 8));
+		}
+
+		void CompressBC1Block(const uint8_t rgba[64], uint8_t out[8])
+		{
+			CompressColorBlock(rgba, out);
+		}
+
+		void CompressBC3Block(const uint8_t rgba[64], uint8_t out[16])
+		{
+			CompressAlphaBlock(rgba, out);
+			CompressColorBlock(rgba, out + 8);
+		}
+
+		static void CompressLevel(const uint8_t *rgba, uint32_t width, uint32_t height, bool alpha, std::vector<uint8_t> &out)
+		{
+			const size_t blockSize = alpha ? 16 : 8;
+			uint8_t block[64];
+			for (uint32_t by = 0; by < height; by += 4) {
+				for (uint32_t bx = 0; bx < width; bx += 4) {
+					// blocks past the edge repeat its pixels
+					for (uint32_t y = 0; y < 4; y++) {
+						const uint32_t sy = std::min(by + y, height - 1);
+						for (uint32_t x = 0; x < 4; x++) {
+							const uint32_t sx = std::min(bx + x, width - 1);
+							memcpy(&block[(y * 4 + x) * 4], &rgba[(sy * width + sx) * 4], 4);
+						}
+					}
+
+					out.resize(out.size() + blockSize);
+					if (alpha)
+						CompressBC3Block(block, &out[out.size() - blockSize]);
+					else
+						CompressBC1Block(block, &out[out.size() - blockSize]);
+				}
+			}
+		}
+
+		Image Compress(const uint8_t *rgba, uint32_t width, uint32_t height, bool alpha)
+		{
+			Image image;
+			image.format = alpha ? TEXTURE_DXT5 : TEXTURE_DXT1;
+			image.width = width;
+			image.height = height;
+			image.numFaces = 1;
+
+			std::vector<uint8_t> level(rgba, rgba + size_t(width) * height * 4), next;
+			uint32_t w = width, h = height;
+			for (;;) {
+				CompressLevel(level.data(), w, h, alpha, image.data);
+				image.numMipMaps++;
+				if (w == 1 && h == 1)
+					break;
+
+				// box filter down to the next level
+				const uint32_t nw = std::max(w / 2, 1U), nh = std::max(h / 2, 1U);
+				next.resize(size_t(nw) * nh * 4);
+				for (uint32_t y = 0; y < nh; y++) {
+					const uint32_t y0 = std::min(y * 2, h - 1), y1 = std::min(y * 2 + 1, h - 1);
+					for (uint32_t x = 0; x < nw; x++) {
+						const uint32_t x0 = std::min(x * 2, w - 1), x1 = std::min(x * 2 + 1, w - 1);
+						for (uint32_t c = 0; c < 4; c++) {
+							const uint32_t sum = level[(y0 * w + x0) * 4 + c] + level[(y0 * w + x1) * 4 + c] +
+								level[(y1 * w + x0) * 4 + c] + level[(y1 * w + x1) * 4 + c];
+							next[(y * nw + x) * 4 + c] = uint8_t((sum + 2) / 4);
+						}
+					}
+				}
+				level.swap(next);
+				w = nw;
+				h = nh;
+			}
+
+			return image;
+		}
+
+	} // namespace KTX2
+} // namespace Graphics
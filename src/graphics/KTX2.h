@@ -0,0 +1,59 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include "Texture.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * KTX2 files of block compressed textures.
+ *
+ * texturecompiler converts the PNGs and JPEGs under data/textures to BC1
+ * (opaque) or BC3 (with alpha) KTX2 files beside them, each level
+ * supercompressed with zlib. TextureBuilder loads those in place of the
+ * originals for textures that may be compressed, which saves both the
+ * decoding and the driver's compression when they're uploaded.
+ *
+ * Basis Universal data would need its transcoder, which isn't built in;
+ * such files are rejected with an error.
+ */
+namespace Graphics {
+	namespace KTX2 {
+
+		struct Image {
+			TextureFormat format = TEXTURE_NONE; // TEXTURE_DXT1 or TEXTURE_DXT5
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t numMipMaps = 0; // number of levels, including the largest
+			uint32_t numFaces = 0;	 // 6 for a cube map
+			// for each face, its levels from the largest down, as DDS files
+			// hold them and Texture::Update takes them
+			std::vector<uint8_t> data;
+
+			size_t GetFaceSize() const { return data.size() / numFaces; }
+		};
+
+		bool IsKTX2(const char *data, size_t size);
+
+		// Reads a KTX2 file of BC1 or BC3 data, either not supercompressed or
+		// supercompressed with zlib. On failure returns false with the
+		// reason in error.
+		bool Read(const char *data, size_t size, Image &image, std::string &error);
+
+		// A KTX2 file of the image, supercompressed with zlib
+		std::string Write(const Image &image);
+
+		// Builds the mip chain of width x height RGBA8 pixels down to 1x1 and
+		// compresses it to BC3 if alpha is set, else BC1
+		Image Compress(const uint8_t *rgba, uint32_t width, uint32_t height, bool alpha);
+
+		// Compress one 4x4 block of RGBA8 pixels, rows from the top
+		void CompressBC1Block(const uint8_t rgba[64], uint8_t out[8]);
+		void CompressBC3Block(const uint8_t rgba[64], uint8_t out[16]);
+
+	} // namespace KTX2
+} // namespace Graphics
@@ -184,7 +184,7 @@ namespace Graphics {
 
 	protected:
 		MaterialDescriptor m_descriptor;
-		size_t m_renderStateHash;
+		uint32_t m_renderStateId;
 
 	private:
 		friend class RendererOGL;
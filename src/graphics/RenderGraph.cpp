@@ -0,0 +1,196 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "RenderGraph.h"
+#include "Renderer.h"
+
+#include "core/Log.h"
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace Graphics;
+
+static bool IsSameDesc(const RenderTargetDesc &a, const RenderTargetDesc &b)
+{
+	return a.width == b.width && a.height == b.height &&
+		a.colorFormat == b.colorFormat && a.depthFormat == b.depthFormat &&
+		a.allowDepthTexture == b.allowDepthTexture && a.numSamples == b.numSamples;
+}
+
+RenderTargetPool::RenderTargetPool(CreateFn create) :
+	m_create(std::move(create))
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+	Clear();
+}
+
+RenderTarget *RenderTargetPool::Acquire(const RenderTargetDesc &desc)
+{
+	for (Entry &entry : m_entries) {
+		if (!entry.inUse && IsSameDesc(entry.target->GetDesc(), desc)) {
+			entry.inUse = true;
+			entry.lastUsedFrame = m_frame;
+			return entry.target.get();
+		}
+	}
+
+	RenderTarget *target = m_create(desc);
+	if (!target)
+		return nullptr;
+
+	m_entries.push_back({ std::unique_ptr<RenderTarget>(target), m_frame, true });
+	return target;
+}
+
+void RenderTargetPool::Release(RenderTarget *target)
+{
+	for (Entry &entry : m_entries) {
+		if (entry.target.get() == target) {
+			assert(entry.inUse);
+			entry.inUse = false;
+			return;
+		}
+	}
+
+	assert(!"released a render target which doesn't belong to the pool");
+}
+
+void RenderTargetPool::EndFrame()
+{
+	m_frame++;
+	m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [this](const Entry &entry) {
+		return !entry.inUse && m_frame - entry.lastUsedFrame > MAX_UNUSED_FRAMES;
+	}),
+		m_entries.end());
+}
+
+void RenderTargetPool::Clear()
+{
+	assert(std::none_of(m_entries.begin(), m_entries.end(), [](const Entry &entry) { return entry.inUse; }));
+	m_entries.clear();
+}
+
+RenderGraph::RenderGraph(RenderTargetPool *pool, Renderer *renderer) :
+	m_pool(pool),
+	m_renderer(renderer)
+{
+	assert(m_pool);
+}
+
+RenderGraph::~RenderGraph()
+{
+	ReleaseTransients();
+}
+
+RenderGraph::ResourceId RenderGraph::ImportTarget(RenderTarget *target)
+{
+	assert(target);
+	m_resources.push_back({ target, target->GetDesc(), true, -1, -1 });
+	return ResourceId(m_resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::CreateTarget(const RenderTargetDesc &desc)
+{
+	m_resources.push_back({ nullptr, desc, false, -1, -1 });
+	return ResourceId(m_resources.size() - 1);
+}
+
+void RenderGraph::AddPass(const std::string &name, std::initializer_list<ResourceId> reads, std::initializer_list<ResourceId> writes, ExecuteFn execute)
+{
+	m_passes.push_back({ name, reads, writes, std::move(execute), false });
+}
+
+void RenderGraph::Cull()
+{
+	// walk backwards from the outputs of the graph, keeping every pass which
+	// writes something a live pass (or the outside) will see
+	std::vector<bool> needed(m_resources.size());
+	for (size_t i = 0; i < m_resources.size(); i++)
+		needed[i] = m_resources[i].imported;
+
+	m_numCulled = 0;
+	for (auto pass = m_passes.rbegin(); pass != m_passes.rend(); ++pass) {
+		pass->live = std::any_of(pass->writes.begin(), pass->writes.end(), [&](ResourceId id) { return needed[id]; });
+		if (!pass->live) {
+			m_numCulled++;
+			continue;
+		}
+
+		for (ResourceId id : pass->reads)
+			needed[id] = true;
+	}
+
+	// the lifetime of each resource spans the live passes using it
+	for (Resource &res : m_resources)
+		res.firstPass = res.lastPass = -1;
+
+	for (int i = 0; i < int(m_passes.size()); i++) {
+		if (!m_passes[i].live)
+			continue;
+
+		for (const auto *list : { &m_passes[i].reads, &m_passes[i].writes }) {
+			for (ResourceId id : *list) {
+				Resource &res = m_resources[id];
+				if (res.firstPass < 0)
+					res.firstPass = i;
+				res.lastPass = i;
+			}
+		}
+	}
+}
+
+bool RenderGraph::Execute()
+{
+	PROFILE_SCOPED()
+	Cull();
+
+	for (int i = 0; i < int(m_passes.size()); i++) {
+		Pass &pass = m_passes[i];
+		if (!pass.live)
+			continue;
+
+		for (Resource &res : m_resources) {
+			if (res.imported || res.firstPass != i)
+				continue;
+
+			res.target = m_pool->Acquire(res.desc);
+			if (!res.target) {
+				Log::Warning("RenderGraph: unable to create a render target for pass '{}'\n", pass.name);
+				ReleaseTransients();
+				return false;
+			}
+		}
+
+		if (m_renderer) {
+			Renderer::GPUZoneTicket zone(m_renderer, pass.name);
+			pass.execute(*this);
+		} else {
+			pass.execute(*this);
+		}
+
+		// hand targets back as soon as possible, so later passes can reuse them
+		for (Resource &res : m_resources) {
+			if (!res.imported && res.target && res.lastPass == i) {
+				m_pool->Release(res.target);
+				res.target = nullptr;
+			}
+		}
+	}
+
+	return true;
+}
+
+void RenderGraph::ReleaseTransients()
+{
+	for (Resource &res : m_resources) {
+		if (!res.imported && res.target) {
+			m_pool->Release(res.target);
+			res.target = nullptr;
+		}
+	}
+}
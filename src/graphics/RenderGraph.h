@@ -0,0 +1,139 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include "RenderTarget.h"
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Graphics {
+
+	class Renderer;
+
+	/*
+	 * Render targets which are only needed for part of a frame (e.g. the
+	 * multisampled target a view is drawn into before being resolved) are
+	 * borrowed from the pool instead of being owned by each user. Targets
+	 * with the same description are shared by everyone whose use doesn't
+	 * overlap, and targets nobody asked for in a while are deleted.
+	 *
+	 * As drawing is deferred to a command list, a released target may still
+	 * be referenced by pending commands; that is fine as long as the next user
+	 * issues its commands after the previous one. Targets are only deleted in
+	 * EndFrame, which must be called after the command lists are flushed.
+	 */
+	class RenderTargetPool {
+	public:
+		using CreateFn = std::function<RenderTarget *(const RenderTargetDesc &)>;
+
+		// frames a free target is kept for before it is deleted
+		static constexpr uint32_t MAX_UNUSED_FRAMES = 60;
+
+		RenderTargetPool(CreateFn create);
+		~RenderTargetPool();
+
+		RenderTargetPool(const RenderTargetPool &) = delete;
+		RenderTargetPool &operator=(const RenderTargetPool &) = delete;
+
+		// returns nullptr if the target could not be created
+		RenderTarget *Acquire(const RenderTargetDesc &desc);
+		void Release(RenderTarget *target);
+
+		void EndFrame();
+		// delete all targets, which must not be in use
+		void Clear();
+
+		size_t GetNumTargets() const { return m_entries.size(); }
+
+	private:
+		struct Entry {
+			std::unique_ptr<RenderTarget> target;
+			uint32_t lastUsedFrame;
+			bool inUse;
+		};
+
+		CreateFn m_create;
+		std::vector<Entry> m_entries;
+		uint32_t m_frame = 0;
+	};
+
+	/*
+	 * Declares the passes drawing a view (or a part of one) up front, with
+	 * the render targets each reads and writes, then runs them in one go.
+	 *
+	 * - passes run in the order they were added, which is the order their
+	 *   writes to a shared target happen in
+	 * - passes whose output nothing reads are culled; only writes to
+	 *   imported targets count as the output of the graph
+	 * - transient targets are taken from the pool just before the first pass
+	 *   using them and returned right after the last one, so targets which
+	 *   are never live at the same time alias the same memory
+	 *
+	 * A pass which draws on top of what an earlier pass wrote to a target
+	 * must list it as a write; it then keeps the earlier pass alive too.
+	 */
+	class RenderGraph {
+	public:
+		using ResourceId = uint32_t;
+		using ExecuteFn = std::function<void(const RenderGraph &)>;
+
+		// with a renderer, the GPU work of each pass is timed as a zone
+		// named after it, see Renderer::BeginGPUZone()
+		RenderGraph(RenderTargetPool *pool, Renderer *renderer = nullptr);
+		~RenderGraph();
+
+		RenderGraph(const RenderGraph &) = delete;
+		RenderGraph &operator=(const RenderGraph &) = delete;
+
+		// a target owned elsewhere, which outlives the graph
+		ResourceId ImportTarget(RenderTarget *target);
+		// a target only valid while the passes using it run
+		ResourceId CreateTarget(const RenderTargetDesc &desc);
+
+		void AddPass(const std::string &name, std::initializer_list<ResourceId> reads, std::initializer_list<ResourceId> writes, ExecuteFn execute);
+
+		// returns false if a transient target could not be created; passes
+		// after that point are not run
+		bool Execute();
+
+		// may only be called from inside a pass using the resource
+		RenderTarget *GetTarget(ResourceId id) const { return m_resources[id].target; }
+
+		// passes that were culled by the last Execute
+		uint32_t GetNumCulledPasses() const { return m_numCulled; }
+
+	private:
+		struct Resource {
+			RenderTarget *target;
+			RenderTargetDesc desc;
+			bool imported;
+			// live passes between which the resource is used
+			int firstPass;
+			int lastPass;
+		};
+
+		struct Pass {
+			std::string name;
+			std::vector<ResourceId> reads;
+			std::vector<ResourceId> writes;
+			ExecuteFn execute;
+			bool live;
+		};
+
+		void Cull();
+		void ReleaseTransients();
+
+		RenderTargetPool *m_pool;
+		Renderer *m_renderer;
+		std::vector<Resource> m_resources;
+		std::vector<Pass> m_passes;
+		uint32_t m_numCulled = 0;
+	};
+
+} // namespace Graphics
@@ -2,6 +2,7 @@
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
 #include "Renderer.h"
+#include "RenderGraph.h"
 #include "Texture.h"
 #include "jenkins/lookup3.h"
 
@@ -15,14 +16,24 @@ namespace Graphics {
 		m_ambient(Color::BLACK),
 		m_window(window)
 	{
+		m_renderTargetPool.reset(new RenderTargetPool([this](const RenderTargetDesc &desc) {
+			return CreateRenderTarget(desc);
+		}));
 	}
 
 	Renderer::~Renderer()
 	{
+		m_renderTargetPool.reset();
 		RemoveAllCachedTextures();
 		SDL_DestroyWindow(m_window);
 	}
 
+	const std::vector<Renderer::GPUZoneTime> &Renderer::GetGPUZoneTimes() const
+	{
+		static const std::vector<GPUZoneTime> none;
+		return none;
+	}
+
 	Texture *Renderer::GetCachedTexture(const std::string &type, const std::string &name)
 	{
 		TextureCacheMap::iterator i = m_textureCache.find(TextureCacheKey(type, name));
@@ -44,6 +55,14 @@ namespace Graphics {
 		m_textureCache.erase(i);
 	}
 
+	size_t Renderer::GetCachedTextureMemSize() const
+	{
+		size_t size = 0;
+		for (const auto &pair : m_textureCache)
+			size += pair.second->Get()->GetTextureMemSize();
+		return size;
+	}
+
 	void Renderer::RemoveAllCachedTextures()
 	{
 		for (TextureCacheMap::iterator i = m_textureCache.begin(); i != m_textureCache.end(); ++i)
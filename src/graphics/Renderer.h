@@ -13,6 +13,8 @@
 #include "matrix4x4.h"
 #include <map>
 #include <memory>
+#include <string_view>
+#include <vector>
 
 struct SDL_Window;
 
@@ -23,6 +25,7 @@ namespace Graphics {
 	 * It is also used to create render states, materials and vertex/index buffers.
 	 */
 
+	class CommandList;
 	class IndexBuffer;
 	class InstanceBuffer;
 	class Material;
@@ -30,6 +33,7 @@ namespace Graphics {
 	class MeshObject;
 	class RenderState;
 	class RenderTarget;
+	class RenderTargetPool;
 	class Texture;
 	class TextureDescriptor;
 	class UniformBuffer;
@@ -80,6 +84,37 @@ namespace Graphics {
 		//traditionally gui happens between endframe and swapbuffers
 		virtual bool SwapBuffers() = 0;
 
+		struct GPUZoneTime {
+			const char *name;
+			uint32_t depth; // of nesting inside other zones
+			double ms;
+		};
+
+		// time how long the GPU takes over each frame and each zone of it;
+		// takes effect from the next frame
+		virtual void SetGPUTimingEnabled(bool enabled) {}
+		// GPU time of the latest timed frame to finish, in milliseconds; a
+		// few frames behind, and negative when frames aren't being timed
+		virtual double GetGPUFrameTime() const { return -1.0; }
+		// mark out the GPU work of the commands issued between the two calls.
+		// Zones nest, and those with the same name are added together
+		virtual void BeginGPUZone(std::string_view name) {}
+		virtual void EndGPUZone() {}
+		// zones of the same frame as GetGPUFrameTime, in the order they began
+		virtual const std::vector<GPUZoneTime> &GetGPUZoneTimes() const;
+
+		// Keep at most this many frames queued ahead of the GPU: SwapBuffers
+		// waits for the GPU to finish the frame that many swaps back. 0 (the
+		// default) leaves it to the driver, which may queue several.
+		virtual void SetMaxFramesInFlight(uint32_t frames) {}
+		// When input was sampled for the frame being built, in
+		// SDL_GetPerformanceCounter ticks
+		virtual void SetFrameInputTime(uint64_t ticks) {}
+		// From the input of a frame being sampled to the GPU finishing it, in
+		// milliseconds; scanout adds up to one refresh interval on top.
+		// Negative unless the frames in flight are capped
+		virtual double GetInputLatency() const { return -1.0; }
+
 		// returns currently bound render target (if any)
 		virtual RenderTarget *GetRenderTarget() = 0;
 		//set 0 to render to screen
@@ -143,6 +178,10 @@ namespace Graphics {
 		// Upload and draw the contents of this VertexArray. Should be used for highly dynamic geometry that changes per-frame.
 		// The contents of the VertexArray will be cached internally by the renderer and uploaded in bulk.
 		virtual bool DrawBuffer(const VertexArray *v, Material *m) = 0;
+		// Reserve numVerts vertices with the given attributes in the same internal buffers and draw them with the material.
+		// Returns where the caller writes the vertices, which must be done before the next FlushCommandBuffers().
+		// Prefer using a VertexWriter (see VertexWriter.h) over calling this directly.
+		virtual void *AllocDrawBuffer(AttributeSet attrs, uint32_t numVerts, Material *m) = 0;
 		// Draw a subregion from an existing vertex+index buffer. Should be used for drawing aggregated vertex streams
 		// generated by middleware (e.g. UI buffers) that are updated once or twice during the frame.
 		// vtxOffset, idxOffset specify the starting element, not the starting byte offset in the buffer
@@ -152,12 +191,35 @@ namespace Graphics {
 		// Draw multiple instances of a mesh object using the given material.
 		virtual bool DrawMeshInstanced(MeshObject *, Material *, InstanceBuffer *) = 0;
 
+		// Opaque meshes drawn with DrawMeshBatched() between these calls are
+		// grouped by mesh and material state, and each group of more than one
+		// draw is issued as a single instanced draw. The material must have an
+		// instanced variant (MaterialDescriptor::instanced).
+		virtual void BeginInstanceBatch() {}
+		virtual void EndInstanceBatch() {}
+		// Draw a single mesh object, which may be merged into an instanced
+		// draw with others inside an instance batch.
+		virtual bool DrawMeshBatched(MeshObject *mesh, Material *mat) { return DrawMesh(mesh, mat); }
+
+		// Get a secondary CommandList to be recorded on a worker thread, or
+		// nullptr if the renderer doesn't support them and drawing should be
+		// done through the renderer instead. See CommandList.h.
+		virtual CommandList *BeginCommandList() { return nullptr; }
+		// Queue a recorded list for execution. It is released by the renderer
+		// and must not be used again.
+		virtual void SubmitCommandList(CommandList *list) {}
+
 		//creates a unique material based on the descriptor. It will not be deleted automatically.
 		virtual Material *CreateMaterial(const std::string &shader, const MaterialDescriptor &descriptor, const RenderStateDesc &stateDescriptor) = 0;
 		// Make a copy of the given material with a possibly new descriptor or render state.
 		virtual Material *CloneMaterial(const Material *mat, const MaterialDescriptor &descriptor, const RenderStateDesc &stateDescriptor) = 0;
 		virtual Texture *CreateTexture(const TextureDescriptor &descriptor) = 0;
+		// Exchange the contents (storage and descriptor) of two textures, so that
+		// everything referring to dst now samples what was uploaded to src
+		virtual void SwapTextureContents(Texture *dst, Texture *src) = 0;
 		virtual RenderTarget *CreateRenderTarget(const RenderTargetDesc &) = 0; //returns nullptr if unsupported
+		// Shared render targets for use within a frame, see RenderGraph.h
+		RenderTargetPool *GetRenderTargetPool() { return m_renderTargetPool.get(); }
 		virtual VertexBuffer *CreateVertexBuffer(const VertexBufferDesc &) = 0;
 		virtual IndexBuffer *CreateIndexBuffer(Uint32 size, BufferUsage, IndexBufferSize = INDEX_BUFFER_32BIT) = 0;
 		virtual InstanceBuffer *CreateInstanceBuffer(Uint32 size, BufferUsage) = 0;
@@ -180,8 +242,13 @@ namespace Graphics {
 		void RemoveAllCachedTextures();
 
 		const TextureCache &GetTextureCache() { return m_textureCache; }
+		// bytes of VRAM the cached textures take up
+		size_t GetCachedTextureMemSize() const;
 
 		virtual bool ReloadShaders() = 0;
+		// start compiling the shader variants used in previous sessions, so
+		// that they're ready before they're first drawn with
+		virtual void PreloadShaderVariants() {}
 
 		// take a ticket representing the current renderer state. when the ticket
 		// is deleted, the renderer state is restored
@@ -246,6 +313,27 @@ namespace Graphics {
 			matrix4x4f m_storedMat;
 		};
 
+		// Time the GPU work issued over the ticket's lifetime as a named zone
+		class GPUZoneTicket {
+		public:
+			GPUZoneTicket(Renderer *r, std::string_view name) :
+				m_renderer(r)
+			{
+				m_renderer->BeginGPUZone(name);
+			}
+
+			~GPUZoneTicket()
+			{
+				m_renderer->EndGPUZone();
+			}
+
+			GPUZoneTicket(const GPUZoneTicket &) = delete;
+			GPUZoneTicket &operator=(const GPUZoneTicket &) = delete;
+
+		private:
+			Renderer *m_renderer;
+		};
+
 		virtual bool Screendump(ScreendumpState &sd) { return false; }
 
 		Stats &GetStats() { return m_stats; }
@@ -260,6 +348,7 @@ namespace Graphics {
 		Light m_lights[4];
 		Stats m_stats;
 		SDL_Window *m_window;
+		std::unique_ptr<RenderTargetPool> m_renderTargetPool;
 
 		virtual void PushState() = 0;
 		virtual void PopState() = 0;
@@ -31,6 +31,12 @@ namespace Graphics {
 			GetOrCreateCounter("Num Cached Render States"),
 			GetOrCreateCounter("Num Cached Shader Programs"),
 			GetOrCreateCounter("Num CommandList Flushes"),
+			GetOrCreateCounter("Num CommandList Submits"),
+			GetOrCreateCounter("Program Switches Avoided"),
+			GetOrCreateCounter("Texture Switches Avoided"),
+			GetOrCreateCounter("Render State Switches Avoided"),
+			GetOrCreateCounter("Num Batched Instanced Draws"),
+			GetOrCreateCounter("Draw Calls Saved By Batching"),
 
 			GetOrCreateCounter("Num Buildings"),
 			GetOrCreateCounter("Num Cities"),
@@ -42,6 +48,7 @@ namespace Graphics {
 			GetOrCreateCounter("Num Gas Giants"),
 			GetOrCreateCounter("Num Stars"),
 			GetOrCreateCounter("Num Ships"),
+			GetOrCreateCounter("Num Occluded Bodies"),
 
 			GetOrCreateCounter("Num Billboards"),
 
@@ -59,11 +66,8 @@ namespace Graphics {
 		Perf::Stats::FlushFrame();
 
 		TFrameData &frame = m_frameStats[m_currentFrame];
-		auto &statsFrame = GetFrameStats();
-		for (size_t idx = 0; idx < m_counterRefs.size(); idx++) {
-			const std::string name = GetNameForCounter(m_counterRefs[idx]);
-			frame.m_stats[idx] = statsFrame.at(name);
-		}
+		for (size_t idx = 0; idx < m_counterRefs.size(); idx++)
+			frame.m_stats[idx] = GetFrameValue(m_counterRefs[idx]);
 
 		m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_STORE;
 		memset(&m_frameStats[m_currentFrame], 0, sizeof(TFrameData));
@@ -38,6 +38,12 @@ namespace Graphics {
 			STAT_NUM_RENDER_STATES,
 			STAT_NUM_SHADER_PROGRAMS,
 			STAT_NUM_CMDLIST_FLUSHES,
+			STAT_NUM_CMDLIST_SUBMITS,
+			STAT_PROGRAM_SWITCHES_AVOIDED,
+			STAT_TEXTURE_SWITCHES_AVOIDED,
+			STAT_RENDER_STATE_SWITCHES_AVOIDED,
+			STAT_BATCHED_INSTANCED_DRAWS,
+			STAT_BATCHED_DRAWS_SAVED,
 
 			// objects
 			STAT_BUILDINGS,
@@ -50,9 +56,12 @@ namespace Graphics {
 			STAT_GASGIANTS,
 			STAT_STARS,
 			STAT_SHIPS,
+			STAT_OCCLUDED_BODIES,
 
 			// scenegraph entries
 			STAT_BILLBOARD,
+			STAT_THRUSTERS,
+			STAT_EFFECT_BATCH_DRAWS,
 
 			// resource utilization stats
 			STAT_NUM_TEXTURE2D,
@@ -7,6 +7,7 @@
 #include "RefCounted.h"
 #include "vector2.h"
 #include "vector3.h"
+#include <utility>
 #include <vector>
 
 namespace Graphics {
@@ -128,6 +129,9 @@ namespace Graphics {
 		Texture(const TextureDescriptor &descriptor) :
 			m_descriptor(descriptor) {}
 
+		// only for exchanging the storage of two textures, see Renderer::SwapTextureContents
+		void SwapDescriptor(Texture &other) { std::swap(m_descriptor, other.m_descriptor); }
+
 	private:
 		TextureDescriptor m_descriptor;
 	};
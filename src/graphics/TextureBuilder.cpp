@@ -3,18 +3,21 @@
 
 #include "TextureBuilder.h"
 #include "FileSystem.h"
+#include "JobQueue.h"
 #include "MathUtil.h"
 #include "profiler/Profiler.h"
 #include "utils.h"
 #include <SDL_image.h>
 #include <SDL_rwops.h>
 #include <algorithm>
+#include <memory>
 #include <sstream>
 
 namespace Graphics {
 
 	//static
 	SDL_mutex *TextureBuilder::m_textureLock = nullptr;
+	bool TextureBuilder::s_useCompressedFiles = false;
 
 	TextureBuilder::TextureBuilder(const SDLSurfacePtr &surface, TextureSampleMode sampleMode, bool generateMipmaps, bool potExtend, bool forceRGBA, bool compressTextures, bool anisoFiltering) :
 		m_surface(surface),
@@ -63,9 +66,76 @@ namespace Graphics {
 	{
 	}
 
-	void TextureBuilder::Init()
+	void TextureBuilder::Init(bool useCompressedFiles)
 	{
 		m_textureLock = SDL_CreateMutex();
+		s_useCompressedFiles = useCompressedFiles;
+	}
+
+	// Loads and decodes a texture file on a worker, then swaps the uploaded
+	// texture into the placeholder handed out by GetOrCreateTextureAsync
+	class TextureStreamJob : public Job {
+	public:
+		TextureStreamJob(Renderer *r, Texture *texture, TextureBuilder *builder) :
+			m_renderer(r),
+			m_texture(texture),
+			m_builder(builder)
+		{}
+
+		virtual void OnRun() override
+		{
+			PROFILE_SCOPED()
+			m_builder->PrepareSurface();
+		}
+
+		virtual void OnFinish() override
+		{
+			PROFILE_SCOPED()
+			RefCountedPtr<Texture> loaded(m_builder->CreateTexture(m_renderer));
+			// the placeholder storage is released along with loaded
+			m_renderer->SwapTextureContents(m_texture, loaded.Get());
+		}
+
+	private:
+		Renderer *m_renderer;
+		// kept alive by the renderer's texture cache
+		Texture *m_texture;
+		std::unique_ptr<TextureBuilder> m_builder;
+	};
+
+	static std::unique_ptr<JobSet> s_streamingJobs;
+
+	void TextureBuilder::SetStreamingQueue(JobQueue *queue)
+	{
+		// releasing the job handles cancels the jobs
+		s_streamingJobs.reset(queue ? new JobSet(queue, JobPriority::Streaming) : nullptr);
+	}
+
+	Texture *TextureBuilder::GetOrCreateTextureAsync(Renderer *r, const std::string &type, const Color &placeholder)
+	{
+		// cube maps and arrays are few, and come without a sensible placeholder
+		if (!s_streamingJobs || m_filenames.empty() || m_textureType != TEXTURE_2D || m_surface)
+			return GetOrCreateTexture(r, type);
+
+		SDL_LockMutex(m_textureLock);
+		Texture *t = r->GetCachedTexture(type, m_filenames.front());
+		if (t) {
+			SDL_UnlockMutex(m_textureLock);
+			return t;
+		}
+
+		const TextureDescriptor desc(TEXTURE_RGBA_8888, vector3f(1.0f, 1.0f, 1.0f), m_sampleMode,
+			false, false, false, 0, TEXTURE_2D);
+		t = r->CreateTexture(desc);
+		t->Update(&placeholder, vector3f(1.0f, 1.0f, 0.0f), TEXTURE_RGBA_8888);
+		r->AddCachedTexture(type, m_filenames.front(), t);
+		SDL_UnlockMutex(m_textureLock);
+
+		TextureBuilder *builder = new TextureBuilder(m_filenames, m_sampleMode, m_generateMipmaps, m_potExtend,
+			m_forceRGBA, m_compressTextures, m_anisotropicFiltering, m_textureType, m_layers);
+		s_streamingJobs->Order(new TextureStreamJob(r, t, builder));
+
+		return t;
 	}
 
 // RGBA and RGBpixel format for converting textures
@@ -136,8 +206,18 @@ namespace Graphics {
 			std::transform(filename.begin(), filename.end(), filename.begin(), ::tolower);
 			if (ends_with_ci(filename, ".dds")) {
 				LoadDDS();
+			} else if (ends_with_ci(filename, ".ktx2")) {
+				if (!LoadKTX2(m_filenames.front()))
+					m_surface = LoadSurfaceFromFile("textures/unknown.png");
 			} else {
-				LoadSurface();
+				// use the compressed version of a texture which would be
+				// compressed on upload anyway
+				const size_t dot = filename.find_last_of('.');
+				const std::string compressed = m_filenames.front().substr(0, dot) + ".ktx2";
+				const bool useCompressed = s_useCompressedFiles && m_compressTextures && m_textureType == TEXTURE_2D &&
+					dot != std::string::npos && FileSystem::gameDataFiles.Lookup(compressed).IsFile();
+				if (!useCompressed || !LoadKTX2(compressed))
+					LoadSurface();
 			}
 		}
 
@@ -201,6 +281,16 @@ namespace Graphics {
 				if (width != virtualWidth || height != virtualHeight)
 					Output("WARNING: texture '%s' is not power-of-two and may not display correctly\n", m_filenames.front().c_str());
 			}
+		} else if (!m_ktx2.data.empty()) {
+			targetTextureFormat = m_ktx2.format;
+			virtualWidth = actualWidth = m_ktx2.width;
+			virtualHeight = actualHeight = m_ktx2.height;
+			numberOfMipMaps = m_ktx2.numMipMaps;
+			numberOfImages = m_ktx2.numFaces;
+			if (m_textureType == TEXTURE_CUBE_MAP) {
+				// Cube map must be fully defined (6 images) to be used correctly
+				assert(numberOfImages == 6);
+			}
 		} else {
 			if (m_textureType != TEXTURE_2D_ARRAY) {
 				switch (m_dds.GetTextureFormat()) {
@@ -312,6 +402,37 @@ namespace Graphics {
 		// XXX if we can't load the fallback texture, then what?
 	}
 
+	bool TextureBuilder::LoadKTX2(const std::string &filename)
+	{
+		PROFILE_SCOPED()
+		assert(!m_surface);
+		if (m_textureType == TEXTURE_2D_ARRAY) {
+			Output("LoadKTX2: %s: cannot load KTX2 texture array files\n", filename.c_str());
+			return false;
+		}
+
+		RefCountedPtr<FileSystem::FileData> filedata = FileSystem::gameDataFiles.ReadFile(filename);
+		if (!filedata) {
+			Output("LoadKTX2: %s: could not read file\n", filename.c_str());
+			return false;
+		}
+
+		std::string error;
+		if (!KTX2::Read(filedata->GetData(), filedata->GetSize(), m_ktx2, error)) {
+			Output("LoadKTX2: %s: %s\n", filename.c_str(), error.c_str());
+			m_ktx2 = KTX2::Image();
+			return false;
+		}
+
+		if (m_ktx2.numFaces != (m_textureType == TEXTURE_CUBE_MAP ? 6U : 1U)) {
+			Output("LoadKTX2: %s: wrong number of faces for the texture type\n", filename.c_str());
+			m_ktx2 = KTX2::Image();
+			return false;
+		}
+
+		return true;
+	}
+
 	void TextureBuilder::UpdateTexture(Texture *texture)
 	{
 		if (m_surface) {
@@ -353,6 +474,25 @@ namespace Graphics {
 				// Given texture and current texture don't have the same type!
 				assert(0);
 			}
+		} else if (!m_ktx2.data.empty()) {
+			if (texture->GetDescriptor().type == TEXTURE_2D && m_textureType == TEXTURE_2D) {
+				texture->Update(m_ktx2.data.data(), vector3f(m_ktx2.width, m_ktx2.height, 0.0f), m_descriptor.format, m_ktx2.numMipMaps);
+			} else if (texture->GetDescriptor().type == TEXTURE_CUBE_MAP && m_textureType == TEXTURE_CUBE_MAP) {
+				TextureCubeData tcd;
+				const size_t face_size = m_ktx2.GetFaceSize();
+				// Sequence of cube map face storage: +X -X +Y -Y +Z -Z
+				uint8_t *data = m_ktx2.data.data();
+				tcd.posX = static_cast<void *>(data + (0 * face_size));
+				tcd.negX = static_cast<void *>(data + (1 * face_size));
+				tcd.posY = static_cast<void *>(data + (2 * face_size));
+				tcd.negY = static_cast<void *>(data + (3 * face_size));
+				tcd.posZ = static_cast<void *>(data + (4 * face_size));
+				tcd.negZ = static_cast<void *>(data + (5 * face_size));
+				texture->Update(tcd, vector3f(m_ktx2.width, m_ktx2.height, 0.0f), m_descriptor.format, m_ktx2.numMipMaps);
+			} else {
+				// Given texture and current texture don't have the same type!
+				assert(0);
+			}
 		} else if (!m_ddsarray.empty()) {
 			// texture array
 			assert(m_textureType == TEXTURE_2D_ARRAY);
@@ -7,13 +7,18 @@
 #include "Renderer.h"
 #include "SDLWrappers.h"
 #include "SDL_mutex.h"
+#include "KTX2.h"
 #include "Texture.h"
 #include <string>
 
 #include "PicoDDS/PicoDDS.h"
 
+class JobQueue;
+
 namespace Graphics {
 
+	class TextureStreamJob;
+
 	class TextureBuilder {
 	public:
 		TextureBuilder(const SDLSurfacePtr &surface, TextureSampleMode sampleMode = LINEAR_CLAMP,
@@ -26,7 +31,14 @@ namespace Graphics {
 			TextureType textureType = TEXTURE_2D, const size_t layers = 1);
 		~TextureBuilder();
 
-		static void Init();
+		// useCompressedFiles loads textures which may be compressed from the
+		// block compressed .ktx2 files texturecompiler makes beside them,
+		// where there are any
+		static void Init(bool useCompressedFiles = false);
+
+		// Set the job queue streamed textures are decoded on; nullptr (the
+		// default) disables streaming and cancels any textures still loading.
+		static void SetStreamingQueue(JobQueue *queue);
 
 		// convenience constructors for common texture types
 		static TextureBuilder Model(const std::string &filename)
@@ -89,15 +101,23 @@ namespace Graphics {
 			return t;
 		}
 
+		// Like GetOrCreateTexture, but a 2D texture file is loaded and decoded
+		// on the streaming queue. Until it has been uploaded the returned
+		// texture is a single texel of the placeholder color.
+		Texture *GetOrCreateTextureAsync(Renderer *r, const std::string &type, const Color &placeholder = Color::WHITE);
+
 		//commonly used dummy textures
 		static Texture *GetWhiteTexture(Renderer *);
 		static Texture *GetTransparentTexture(Renderer *);
 
 	private:
+		friend class TextureStreamJob;
+
 		SDLSurfacePtr m_surface;
 		std::vector<SDLSurfacePtr> m_cubemap;
 		PicoDDS::DDSImage m_dds;
 		std::vector<PicoDDS::DDSImage> m_ddsarray;
+		KTX2::Image m_ktx2;
 		std::vector<std::string> m_filenames;
 
 		TextureSampleMode m_sampleMode;
@@ -125,8 +145,10 @@ namespace Graphics {
 
 		void LoadSurface();
 		void LoadDDS();
+		bool LoadKTX2(const std::string &filename);
 
 		static SDL_mutex *m_textureLock;
+		static bool s_useCompressedFiles;
 	};
 
 } // namespace Graphics
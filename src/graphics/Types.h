@@ -49,7 +49,9 @@ namespace Graphics {
 		ATTRIB_FORMAT_FLOAT2,
 		ATTRIB_FORMAT_FLOAT3,
 		ATTRIB_FORMAT_FLOAT4,
-		ATTRIB_FORMAT_UBYTE4
+		ATTRIB_FORMAT_UBYTE4,
+		ATTRIB_FORMAT_SBYTE4_NORM, // signed bytes, read as floats in [-1,1]
+		ATTRIB_FORMAT_USHORT2_NORM // unsigned shorts, read as floats in [0,1]
 	};
 
 	enum ConstantDataFormat : uint8_t {
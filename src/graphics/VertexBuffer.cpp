@@ -19,6 +19,8 @@ namespace Graphics {
 		case ATTRIB_FORMAT_FLOAT4:
 			return 16;
 		case ATTRIB_FORMAT_UBYTE4:
+		case ATTRIB_FORMAT_SBYTE4_NORM:
+		case ATTRIB_FORMAT_USHORT2_NORM:
 			return 4;
 		default:
 			return 0;
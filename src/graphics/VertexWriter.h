@@ -0,0 +1,131 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include "Color.h"
+#include "graphics/Renderer.h"
+#include "graphics/VertexBuffer.h"
+#include "vector2.h"
+#include "vector3.h"
+
+#include <cassert>
+#include <cstring>
+
+/**
+ * Typed vertex writing, for geometry that would otherwise be assembled in a
+ * VertexArray only to be copied attribute by attribute into a vertex buffer.
+ *
+ * A vertex format is a packed struct laid out as VertexBufferDesc::FromAttribSet
+ * lays out its ATTRIBS (position, normal, diffuse, uv0, tangent). A VertexWriter
+ * writes those straight into either a mapped VertexBuffer created with
+ * CreateVertexDesc<Format>(), or the renderer's per-frame dynamic draw buffer:
+ *
+ *   VertexWriter<VertexPosCol> out(renderer, material, numVerts);
+ *   for (...)
+ *       out.Add({ pos, color });
+ */
+namespace Graphics {
+
+#pragma pack(push, 4)
+	struct VertexPos {
+		static constexpr uint32_t ATTRIBS = ATTRIB_POSITION;
+		vector3f pos;
+	};
+
+	struct VertexPosCol {
+		static constexpr uint32_t ATTRIBS = ATTRIB_POSITION | ATTRIB_DIFFUSE;
+		vector3f pos;
+		Color4ub col;
+	};
+
+	struct VertexPosUV {
+		static constexpr uint32_t ATTRIBS = ATTRIB_POSITION | ATTRIB_UV0;
+		vector3f pos;
+		vector2f uv;
+	};
+
+	struct VertexPosColUV {
+		static constexpr uint32_t ATTRIBS = ATTRIB_POSITION | ATTRIB_DIFFUSE | ATTRIB_UV0;
+		vector3f pos;
+		Color4ub col;
+		vector2f uv;
+	};
+
+	struct VertexPosNormCol {
+		static constexpr uint32_t ATTRIBS = ATTRIB_POSITION | ATTRIB_NORMAL | ATTRIB_DIFFUSE;
+		vector3f pos;
+		vector3f norm;
+		Color4ub col;
+	};
+#pragma pack(pop)
+
+	// Description of a buffer of numVertices vertices in the given format
+	template <typename Format>
+	VertexBufferDesc CreateVertexDesc(uint32_t numVertices, BufferUsage usage)
+	{
+		VertexBufferDesc desc = VertexBufferDesc::FromAttribSet(Format::ATTRIBS);
+		assert(desc.stride == sizeof(Format));
+		desc.numVertices = numVertices;
+		desc.usage = usage;
+		return desc;
+	}
+
+	template <typename Format>
+	class VertexWriter {
+	public:
+		// Write the contents of a vertex buffer created for Format. The vertex
+		// count is set to the number of vertices written when the writer is done.
+		explicit VertexWriter(VertexBuffer *vb) :
+			m_buffer(vb)
+		{
+			assert(vb->GetDesc().stride == sizeof(Format));
+			m_begin = m_cur = vb->Map<Format>(BUFFER_MAP_WRITE);
+			m_end = m_begin + vb->GetCapacity();
+		}
+
+		// Draw numVerts vertices from the renderer's dynamic draw buffer with
+		// mat; all of them must be written before the writer is done.
+		VertexWriter(Renderer *r, Material *mat, uint32_t numVerts) :
+			m_buffer(nullptr)
+		{
+			m_begin = m_cur = static_cast<Format *>(r->AllocDrawBuffer(Format::ATTRIBS, numVerts, mat));
+			m_end = m_begin + numVerts;
+		}
+
+		~VertexWriter()
+		{
+			if (m_buffer) {
+				m_buffer->Unmap();
+				m_buffer->SetVertexCount(GetNumWritten());
+			} else {
+				assert(m_cur == m_end && "VertexWriter: too few vertices written to the draw buffer");
+			}
+		}
+
+		VertexWriter(const VertexWriter &) = delete;
+		VertexWriter &operator=(const VertexWriter &) = delete;
+
+		void Add(const Format &v)
+		{
+			assert(m_cur < m_end);
+			*m_cur++ = v;
+		}
+
+		void Add(const Format *v, uint32_t count)
+		{
+			assert(m_cur + count <= m_end);
+			std::memcpy(static_cast<void *>(m_cur), v, count * sizeof(Format));
+			m_cur += count;
+		}
+
+		uint32_t GetNumWritten() const { return uint32_t(m_cur - m_begin); }
+
+	private:
+		VertexBuffer *m_buffer;
+		Format *m_begin;
+		Format *m_cur;
+		Format *m_end;
+	};
+
+} // namespace Graphics
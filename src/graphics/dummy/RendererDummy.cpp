@@ -2,12 +2,29 @@
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
 #include "RendererDummy.h"
+#include "graphics/TextureBuilder.h"
+
+#include <SDL.h>
 
 namespace Graphics {
 
 	static Renderer *CreateRenderer(const Settings &vs)
 	{
-		return new RendererDummy();
+		// the model compiler loads models on several threads, which share
+		// the texture cache
+		TextureBuilder::Init();
+
+		// a headless game still needs a window for its input and UI to
+		// attach to; with SDL's dummy video driver it needs no display
+		if (!SDL_WasInit(SDL_INIT_VIDEO))
+			return new RendererDummy();
+
+		SDL_Window *window = SDL_CreateWindow(vs.title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+			vs.width, vs.height, SDL_WINDOW_HIDDEN);
+		if (!window)
+			return nullptr;
+
+		return new RendererDummy(window, vs.width, vs.height);
 	}
 
 	void RendererDummy::RegisterRenderer()
@@ -23,8 +23,8 @@ namespace Graphics {
 	public:
 		static void RegisterRenderer();
 
-		RendererDummy() :
-			Renderer(0, 0, 0),
+		RendererDummy(SDL_Window *window = nullptr, int width = 0, int height = 0) :
+			Renderer(window, width, height),
 			m_identity(matrix4x4f::Identity())
 		{}
 
@@ -70,6 +70,11 @@ namespace Graphics {
 		virtual bool FlushCommandBuffers() override final { return true; }
 
 		virtual bool DrawBuffer(const VertexArray *, Material *) override final { return true; }
+		virtual void *AllocDrawBuffer(AttributeSet attrs, uint32_t numVerts, Material *) override final
+		{
+			m_drawScratch.resize(numVerts * VertexBufferDesc::FromAttribSet(attrs).stride);
+			return m_drawScratch.data();
+		}
 		virtual bool DrawBufferDynamic(VertexBuffer *, uint32_t, IndexBuffer *, uint32_t, uint32_t, Material *) override final { return true; }
 		virtual bool DrawMesh(MeshObject *, Material *) override final { return true; }
 		virtual bool DrawMeshInstanced(MeshObject *, Material *, InstanceBuffer *) override final { return true; }
@@ -77,6 +82,7 @@ namespace Graphics {
 		virtual Material *CreateMaterial(const std::string &s, const MaterialDescriptor &d, const RenderStateDesc &rsd) override final { return new Graphics::Dummy::Material(rsd); }
 		virtual Material *CloneMaterial(const Material *m, const MaterialDescriptor &d, const RenderStateDesc &rsd) override final { return new Graphics::Dummy::Material(rsd); }
 		virtual Texture *CreateTexture(const TextureDescriptor &d) override final { return new Graphics::TextureDummy(d); }
+		virtual void SwapTextureContents(Texture *dst, Texture *src) override final {}
 		virtual RenderTarget *CreateRenderTarget(const RenderTargetDesc &d) override final { return new Graphics::Dummy::RenderTarget(d); }
 		virtual VertexBuffer *CreateVertexBuffer(const VertexBufferDesc &d) override final { return new Graphics::Dummy::VertexBuffer(d); }
 		virtual IndexBuffer *CreateIndexBuffer(Uint32 size, BufferUsage bu, IndexBufferSize el) override final { return new Graphics::Dummy::IndexBuffer(size, bu, el); }
@@ -101,6 +107,8 @@ namespace Graphics {
 	private:
 		const matrix4x4f m_identity;
 		Graphics::RenderTarget *m_rt;
+		// vertices written for AllocDrawBuffer go nowhere
+		std::vector<Uint8> m_drawScratch;
 	};
 
 } // namespace Graphics
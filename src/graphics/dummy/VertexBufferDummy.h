@@ -7,6 +7,8 @@
 #include "graphics/Types.h"
 #include "graphics/VertexBuffer.h"
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 
 namespace Graphics {
@@ -24,7 +26,10 @@ namespace Graphics {
 			virtual bool Populate(const VertexArray &) override final { return true; }
 
 			// change the buffer data without mapping
-			virtual void BufferData(const size_t, void *) override final {}
+			virtual void BufferData(const size_t size, void *data) override final
+			{
+				memcpy(m_buffer.get(), data, std::min(size, size_t(m_desc.numVertices * m_desc.stride)));
+			}
 
 			virtual void Bind() override final {}
 			virtual void Release() override final {}
@@ -53,7 +58,13 @@ namespace Graphics {
 			virtual Uint16 *Map16(BufferMapMode) override final { return m_buffer16.get(); }
 			virtual void Unmap() override final {}
 
-			virtual void BufferData(const size_t, void *) override final {}
+			virtual void BufferData(const size_t size, void *data) override final
+			{
+				if (m_buffer)
+					memcpy(m_buffer.get(), data, std::min(size, m_size * sizeof(Uint32)));
+				else
+					memcpy(m_buffer16.get(), data, std::min(size, m_size * sizeof(Uint16)));
+			}
 
 			virtual void Bind() override final {}
 			virtual void Release() override final {}
@@ -21,15 +21,24 @@ void CommandList::AddDrawCmd(Graphics::MeshObject *mesh, Graphics::Material *mat
 {
 	assert(!m_executing && "Attempt to append to a command list while it's being executed!");
 	OGL::Material *mat = static_cast<OGL::Material *>(material);
+	if (!m_batchGroups.empty())
+		FlushInstanceBatchBefore(mat->m_renderStateId);
 
 	DrawCmd cmd{};
 	cmd.mesh = static_cast<OGL::MeshObject *>(mesh);
 	cmd.inst = static_cast<OGL::InstanceBuffer *>(inst);
 
-	cmd.program = mat->EvaluateVariant();
 	cmd.shader = mat->GetShader();
-	cmd.renderStateHash = mat->m_renderStateHash;
-	cmd.drawData = SetupMaterialData(mat);
+	cmd.renderStateId = mat->m_renderStateId;
+	// the camera looks down -Z
+	cmd.viewDepth = -(m_isSecondary ? m_transform : m_renderer->GetTransform())[14];
+	if (m_isSecondary) {
+		// the program variant is looked up (and possibly compiled) later
+		cmd.drawData = SetupDeferredMaterialData(mat, m_drawCmds.size());
+	} else {
+		cmd.program = mat->EvaluateVariant();
+		cmd.drawData = SetupMaterialData(mat);
+	}
 
 	m_drawCmds.emplace_back(std::move(cmd));
 }
@@ -37,7 +46,10 @@ void CommandList::AddDrawCmd(Graphics::MeshObject *mesh, Graphics::Material *mat
 void CommandList::AddDynamicDrawCmd(BufferBinding<Graphics::VertexBuffer> vtxBind, BufferBinding<Graphics::IndexBuffer> idxBind, Graphics::Material *material)
 {
 	assert(!m_executing && "Attempt to append to a command list while it's being executed!");
+	assert(!m_isSecondary && "Dynamic draws can only be recorded by the renderer!");
 	OGL::Material *mat = static_cast<OGL::Material *>(material);
+	if (!m_batchGroups.empty())
+		FlushInstanceBatchBefore(mat->m_renderStateId);
 
 	DynamicDrawCmd cmd{};
 	cmd.vtxBind.buffer = static_cast<OGL::VertexBuffer *>(vtxBind.buffer);
@@ -50,7 +62,7 @@ void CommandList::AddDynamicDrawCmd(BufferBinding<Graphics::VertexBuffer> vtxBin
 
 	cmd.program = mat->EvaluateVariant();
 	cmd.shader = mat->GetShader();
-	cmd.renderStateHash = mat->m_renderStateHash;
+	cmd.renderStateId = mat->m_renderStateId;
 	cmd.drawData = SetupMaterialData(mat);
 
 	m_drawCmds.emplace_back(std::move(cmd));
@@ -61,6 +73,7 @@ void CommandList::AddDynamicDrawCmd(BufferBinding<Graphics::VertexBuffer> vtxBin
 void CommandList::AddRenderPassCmd(RenderTarget *renderTarget, ViewportExtents extents)
 {
 	assert(!m_executing && "Attempt to append to a command list while it's being executed!");
+	FlushInstanceBatch();
 
 	RenderPassCmd *lastCmd = IsEmpty() ? nullptr : std::get_if<RenderPassCmd>(&m_drawCmds.back());
 	if (!lastCmd || !lastCmd->setRenderTarget || lastCmd->renderTarget != renderTarget) {
@@ -85,6 +98,7 @@ void CommandList::AddRenderPassCmd(RenderTarget *renderTarget, ViewportExtents e
 void CommandList::AddScissorCmd(ViewportExtents scissor)
 {
 	assert(!m_executing && "Attempt to append to a command list while it's being executed!");
+	FlushInstanceBatch();
 
 	RenderPassCmd *lastCmd = IsEmpty() ? nullptr : std::get_if<RenderPassCmd>(&m_drawCmds.back());
 	if (!lastCmd) {
@@ -106,6 +120,7 @@ void CommandList::AddScissorCmd(ViewportExtents scissor)
 void CommandList::AddClearCmd(bool clearColors, bool clearDepth, Color color)
 {
 	assert(!m_executing && "Attempt to append to a command list while it's being executed!");
+	FlushInstanceBatch();
 
 	RenderPassCmd *lastCmd = IsEmpty() ? nullptr : std::get_if<RenderPassCmd>(&m_drawCmds.back());
 
@@ -135,6 +150,7 @@ void CommandList::AddBlitRenderTargetCmd(
 	bool linearFilter)
 {
 	assert(!m_executing && "Attempt to append to a command list while it's being executed!");
+	FlushInstanceBatch();
 
 	if (resolveMSAA) {
 		assert(srcExtents.w == dstExtents.w && srcExtents.h == dstExtents.h &&
@@ -153,6 +169,21 @@ void CommandList::AddBlitRenderTargetCmd(
 	m_drawCmds.emplace_back(std::move(cmd));
 }
 
+void CommandList::AddTimestampCmd(GLuint query)
+{
+	assert(!m_executing && "Attempt to append to a command list while it's being executed!");
+	// batched draws recorded before the timestamp have to be drawn before it
+	FlushInstanceBatch();
+
+	m_drawCmds.emplace_back(TimestampCmd{ query });
+}
+
+void CommandList::SetTransform(const matrix4x4f &m)
+{
+	assert(m_isSecondary && "Set the transform of the renderer's own command list through the renderer!");
+	m_transform = m;
+}
+
 void CommandList::Reset()
 {
 	assert(!m_executing && "Attempt to reset a command list while it's being executed!");
@@ -161,6 +192,354 @@ void CommandList::Reset()
 		bucket.used = 0;
 
 	m_drawCmds.clear();
+	m_deferredDraws.clear();
+	assert(m_batchGroups.empty() && "Attempt to reset a command list with unrecorded batched draws!");
+}
+
+void CommandList::Begin(const matrix4x4f &transform, const matrix4x4f &projection)
+{
+	assert(m_isSecondary && IsEmpty());
+	m_transform = transform;
+	m_projection = projection;
+}
+
+void CommandList::ResolveDeferredDraws()
+{
+	PROFILE_SCOPED()
+	for (const DeferredDraw &draw : m_deferredDraws) {
+		DrawCmd &cmd = std::get<DrawCmd>(m_drawCmds[draw.cmdIndex]);
+		cmd.program = draw.material->EvaluateVariant();
+		draw.material->WriteDrawData(cmd.drawData, getBufferBindings(cmd.shader, cmd.drawData), draw.dataBlock);
+	}
+
+	m_deferredDraws.clear();
+}
+
+void CommandList::Append(const CommandList &list)
+{
+	assert(!m_executing && "Attempt to append to a command list while it's being executed!");
+	assert(list.m_deferredDraws.empty() && "Attempt to append an unresolved command list!");
+	FlushInstanceBatch();
+
+	m_drawCmds.insert(m_drawCmds.end(), list.m_drawCmds.begin(), list.m_drawCmds.end());
+}
+
+static constexpr uint32_t INVALID_GROUP = ~0u;
+
+void CommandList::BeginInstanceBatch()
+{
+	assert(!m_isSecondary && "Instance batches can only be recorded by the renderer!");
+	assert(!m_batching && "Attempt to begin an instance batch inside another!");
+	m_batching = true;
+}
+
+void CommandList::EndInstanceBatch()
+{
+	assert(m_batching && "Attempt to end an instance batch that wasn't begun!");
+	FlushInstanceBatch();
+	m_batching = false;
+}
+
+void CommandList::AddBatchedDrawCmd(Graphics::MeshObject *mesh, Graphics::Material *material)
+{
+	assert(!m_executing && "Attempt to append to a command list while it's being executed!");
+	OGL::Material *mat = static_cast<OGL::Material *>(material);
+
+	if (!m_batching) {
+		AddDrawCmd(mesh, mat);
+		return;
+	}
+
+	// draws that blend (or skip the depth buffer) must keep their order
+	FlushInstanceBatchBefore(mat->m_renderStateId);
+	if (!m_batchStateOpaque) {
+		AddDrawCmd(mesh, mat);
+		return;
+	}
+
+	InstanceGroup group{};
+	group.mesh = static_cast<OGL::MeshObject *>(mesh);
+	group.material = mat;
+	group.shader = mat->GetShader();
+	group.program = mat->EvaluateVariant();
+	group.renderStateId = mat->m_renderStateId;
+	mat->FillDrawDataBlock(group.dataBlock, matrix4x4f::Identity(), m_renderer->GetProjection());
+
+	// capture the material and lighting state of this draw, leaving out the
+	// per-draw block binding left in the material by its last draw
+	const size_t drawDataSize = GetDrawDataSize(group.shader);
+	m_batchScratch.assign(drawDataSize, '\0');
+	group.drawData = m_batchScratch.data();
+	CopyMaterialData(mat, group.drawData);
+	BufferBinding<UniformBuffer> *buffers = getBufferBindings(group.shader, group.drawData);
+	mat->ClearDrawDataBlock(buffers);
+	mat->WriteLightData(group.drawData, buffers);
+
+	const matrix4x4f &transform = m_renderer->GetTransform();
+	const float viewDepth = -transform[14];
+
+	uint32_t groupIdx = FindInstanceGroup(group, drawDataSize);
+	if (groupIdx == INVALID_GROUP) {
+		// batched commands are recorded where the first of them would have been
+		if (m_batchGroups.empty())
+			m_batchInsertPos = m_drawCmds.size();
+
+		group.drawData = AllocDrawData(group.shader);
+		memcpy(group.drawData, m_batchScratch.data(), drawDataSize);
+		group.numDraws = 0;
+		group.viewDepth = viewDepth;
+
+		auto iter = m_batchGroupLookup.find(group.mesh);
+		group.next = iter != m_batchGroupLookup.end() ? iter->second : INVALID_GROUP;
+
+		groupIdx = m_batchGroups.size();
+		m_batchGroupLookup[group.mesh] = groupIdx;
+		m_batchGroups.push_back(group);
+	}
+
+	InstanceGroup &batchGroup = m_batchGroups[groupIdx];
+	batchGroup.numDraws++;
+	batchGroup.viewDepth = std::min(batchGroup.viewDepth, viewDepth);
+	m_batchDraws.push_back({ groupIdx, transform });
+}
+
+uint32_t CommandList::FindInstanceGroup(const InstanceGroup &group, size_t drawDataSize) const
+{
+	auto iter = m_batchGroupLookup.find(group.mesh);
+	uint32_t idx = iter != m_batchGroupLookup.end() ? iter->second : INVALID_GROUP;
+
+	for (; idx != INVALID_GROUP; idx = m_batchGroups[idx].next) {
+		const InstanceGroup &other = m_batchGroups[idx];
+		if (other.material == group.material && other.program == group.program &&
+			other.renderStateId == group.renderStateId &&
+			memcmp(&other.dataBlock, &group.dataBlock, sizeof(DrawDataBlock)) == 0 &&
+			memcmp(other.drawData, group.drawData, drawDataSize) == 0)
+			return idx;
+	}
+
+	return INVALID_GROUP;
+}
+
+void CommandList::FlushInstanceBatchBefore(uint32_t renderStateId)
+{
+	if (renderStateId != m_batchStateId) {
+		const Graphics::RenderStateDesc &rsd = m_renderer->GetStateCache()->GetRenderState(renderStateId);
+		m_batchStateId = renderStateId;
+		m_batchStateOpaque = rsd.blendMode == Graphics::BLEND_SOLID && rsd.depthTest && rsd.depthWrite;
+		m_batchStateDepthTest = rsd.depthTest;
+	}
+
+	// Batched draws only move earlier in the list, ahead of the draws
+	// recorded since the first of them. That is harmless for anything
+	// depth tested against them, but not for anything drawn over the top.
+	if (!m_batchStateDepthTest)
+		FlushInstanceBatch();
+}
+
+void CommandList::FlushInstanceBatch()
+{
+	if (m_batchGroups.empty())
+		return;
+
+	PROFILE_SCOPED()
+
+	// gather the transforms of each group together
+	uint32_t numTransforms = 0;
+	for (InstanceGroup &group : m_batchGroups) {
+		group.firstTransform = numTransforms;
+		numTransforms += group.numDraws;
+		group.numDraws = 0;
+	}
+
+	m_batchTransforms.resize(numTransforms);
+	for (const BatchedDraw &draw : m_batchDraws) {
+		InstanceGroup &group = m_batchGroups[draw.group];
+		m_batchTransforms[group.firstTransform + group.numDraws++] = draw.transform;
+	}
+
+	uint32_t numInstancedDraws = 0;
+	uint32_t numDrawsSaved = 0;
+	std::vector<Cmd> cmds;
+	cmds.reserve(m_batchGroups.size());
+
+	for (const InstanceGroup &group : m_batchGroups) {
+		const matrix4x4f *transforms = m_batchTransforms.data() + group.firstTransform;
+
+		DrawCmd cmd{};
+		cmd.mesh = group.mesh;
+		cmd.shader = group.shader;
+		cmd.renderStateId = group.renderStateId;
+
+		Program *instancedProgram = group.numDraws > 1 ? group.material->EvaluateInstancedVariant() : nullptr;
+		if (instancedProgram) {
+			InstanceBuffer *inst = m_renderer->GetBatchInstanceBuffer(group.numDraws);
+			matrix4x4f *data = inst->Map(Graphics::BUFFER_MAP_WRITE);
+			std::copy(transforms, transforms + group.numDraws, data);
+			inst->Unmap();
+			inst->SetInstanceCount(group.numDraws);
+
+			cmd.inst = inst;
+			cmd.program = instancedProgram;
+			cmd.drawData = group.drawData;
+			cmd.viewDepth = group.viewDepth;
+			group.material->WriteDrawDataBlock(getBufferBindings(group.shader, cmd.drawData), group.dataBlock);
+			cmds.emplace_back(cmd);
+
+			numInstancedDraws++;
+			numDrawsSaved += group.numDraws - 1;
+			continue;
+		}
+
+		// not worth it, or not possible: record each draw on its own
+		const size_t drawDataSize = GetDrawDataSize(group.shader);
+		for (uint32_t idx = 0; idx < group.numDraws; idx++) {
+			cmd.program = group.program;
+			cmd.viewDepth = -transforms[idx][14];
+			cmd.drawData = idx == 0 ? group.drawData : AllocDrawData(group.shader);
+			if (idx > 0)
+				memcpy(cmd.drawData, group.drawData, drawDataSize);
+
+			// the projection is all that's left of an identity view transform
+			DrawDataBlock dataBlock = group.dataBlock;
+			Material::SetDrawDataTransform(dataBlock, transforms[idx], group.dataBlock.uViewProjectionMatrix);
+			group.material->WriteDrawDataBlock(getBufferBindings(group.shader, cmd.drawData), dataBlock);
+			cmds.emplace_back(cmd);
+		}
+	}
+
+	m_drawCmds.insert(m_drawCmds.begin() + m_batchInsertPos, cmds.begin(), cmds.end());
+
+	m_batchGroups.clear();
+	m_batchDraws.clear();
+	m_batchGroupLookup.clear();
+
+	Graphics::Stats &stats = m_renderer->GetStats();
+	stats.AddToStatCount(Graphics::Stats::STAT_BATCHED_INSTANCED_DRAWS, numInstancedDraws);
+	stats.AddToStatCount(Graphics::Stats::STAT_BATCHED_DRAWS_SAVED, numDrawsSaved);
+}
+
+// Sort keys of opaque draws, from the most significant bits: render state,
+// program, material textures, mesh and finally a logarithmic depth bucket, so
+// that draws sharing state end up roughly front to back. All but the depth
+// are hashed down to their field, which at worst leaves some state unsorted.
+static constexpr int SORT_STATE_BITS = 10;
+static constexpr int SORT_PROGRAM_BITS = 14;
+static constexpr int SORT_MATERIAL_BITS = 14;
+static constexpr int SORT_MESH_BITS = 12;
+static constexpr int SORT_DEPTH_BITS = 14;
+static_assert(SORT_STATE_BITS + SORT_PROGRAM_BITS + SORT_MATERIAL_BITS + SORT_MESH_BITS + SORT_DEPTH_BITS == 64);
+
+static constexpr int SORT_DEPTH_SHIFT = 0;
+static constexpr int SORT_MESH_SHIFT = SORT_DEPTH_SHIFT + SORT_DEPTH_BITS;
+static constexpr int SORT_MATERIAL_SHIFT = SORT_MESH_SHIFT + SORT_MESH_BITS;
+static constexpr int SORT_PROGRAM_SHIFT = SORT_MATERIAL_SHIFT + SORT_MATERIAL_BITS;
+static constexpr int SORT_STATE_SHIFT = SORT_PROGRAM_SHIFT + SORT_PROGRAM_BITS;
+
+// depth buckets per doubling of the distance
+static constexpr float SORT_DEPTH_BUCKETS_PER_OCTAVE = 256.f;
+
+static uint64_t fold_bits(uint64_t value, int bits)
+{
+	// Fibonacci hashing keeps the spread of the high bits
+	return (value * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+}
+
+static uint64_t sort_key_field(uint64_t key, int shift, int bits)
+{
+	return (key >> shift) & ((1ull << bits) - 1);
+}
+
+uint64_t CommandList::MakeSortKey(const DrawCmd &cmd)
+{
+	uint64_t textureHash = 0;
+	TextureGL **textures = getTextureBindings(cmd.shader, cmd.drawData);
+	for (size_t index = 0; index < cmd.shader->GetNumTextureBindings(); index++)
+		textureHash = (textureHash ^ reinterpret_cast<uintptr_t>(textures[index])) * 0x100000001B3ull;
+
+	const float depth = cmd.viewDepth > 1.f ? std::log2(cmd.viewDepth) * SORT_DEPTH_BUCKETS_PER_OCTAVE : 0.f;
+	const uint64_t depthBucket = std::min<uint64_t>(uint64_t(depth), (1ull << SORT_DEPTH_BITS) - 1);
+
+	return fold_bits(cmd.renderStateId, SORT_STATE_BITS) << SORT_STATE_SHIFT |
+		fold_bits(reinterpret_cast<uintptr_t>(cmd.program), SORT_PROGRAM_BITS) << SORT_PROGRAM_SHIFT |
+		fold_bits(textureHash, SORT_MATERIAL_BITS) << SORT_MATERIAL_SHIFT |
+		fold_bits(reinterpret_cast<uintptr_t>(cmd.mesh), SORT_MESH_BITS) << SORT_MESH_SHIFT |
+		depthBucket << SORT_DEPTH_SHIFT;
+}
+
+// Opaque draws depth-test against and write everything they draw, so their
+// order doesn't change the image. Blended draws stay in the back-to-front
+// order they were recorded in, as does anything drawn without the depth buffer.
+bool CommandList::IsOpaqueDraw(const Cmd &cmd, uint32_t &lastStateId, bool &lastOpaque) const
+{
+	const DrawCmd *drawCmd = std::get_if<DrawCmd>(&cmd);
+	if (!drawCmd)
+		return false;
+
+	if (drawCmd->renderStateId != lastStateId) {
+		const Graphics::RenderStateDesc &rsd = m_renderer->GetStateCache()->GetRenderState(drawCmd->renderStateId);
+		lastStateId = drawCmd->renderStateId;
+		lastOpaque = rsd.blendMode == Graphics::BLEND_SOLID && rsd.depthTest && rsd.depthWrite;
+	}
+
+	return lastOpaque;
+}
+
+void CommandList::SortOpaqueDrawCmds()
+{
+	PROFILE_SCOPED()
+
+	// changes of each field between consecutive draws, before and after sorting
+	uint32_t numSwitches[2][3] = {};
+	auto countSwitches = [&](size_t begin, size_t end, uint32_t *counts) {
+		for (size_t idx = begin + 1; idx < end; idx++) {
+			const uint64_t prev = std::get<DrawCmd>(m_drawCmds[idx - 1]).sortKey;
+			const uint64_t next = std::get<DrawCmd>(m_drawCmds[idx]).sortKey;
+			counts[0] += sort_key_field(prev, SORT_PROGRAM_SHIFT, SORT_PROGRAM_BITS) != sort_key_field(next, SORT_PROGRAM_SHIFT, SORT_PROGRAM_BITS);
+			counts[1] += sort_key_field(prev, SORT_MATERIAL_SHIFT, SORT_MATERIAL_BITS) != sort_key_field(next, SORT_MATERIAL_SHIFT, SORT_MATERIAL_BITS);
+			counts[2] += sort_key_field(prev, SORT_STATE_SHIFT, SORT_STATE_BITS) != sort_key_field(next, SORT_STATE_SHIFT, SORT_STATE_BITS);
+		}
+	};
+
+	uint32_t lastStateId = 0;
+	bool lastOpaque = false;
+	size_t begin = 0;
+	while (begin < m_drawCmds.size()) {
+		if (!IsOpaqueDraw(m_drawCmds[begin], lastStateId, lastOpaque)) {
+			begin++;
+			continue;
+		}
+
+		size_t end = begin + 1;
+		while (end < m_drawCmds.size() && IsOpaqueDraw(m_drawCmds[end], lastStateId, lastOpaque))
+			end++;
+
+		if (end - begin > 1) {
+			for (size_t idx = begin; idx < end; idx++) {
+				DrawCmd &cmd = std::get<DrawCmd>(m_drawCmds[idx]);
+				cmd.sortKey = MakeSortKey(cmd);
+			}
+
+			countSwitches(begin, end, numSwitches[0]);
+			// stable, so that draws with equal keys keep their recorded order
+			std::stable_sort(m_drawCmds.begin() + begin, m_drawCmds.begin() + end, [](const Cmd &a, const Cmd &b) {
+				return std::get<DrawCmd>(a).sortKey < std::get<DrawCmd>(b).sortKey;
+			});
+			countSwitches(begin, end, numSwitches[1]);
+		}
+
+		begin = end;
+	}
+
+	// sorting by state first can add program or texture switches between
+	// groups, which don't count against the other runs
+	auto avoided = [&](int field) {
+		return numSwitches[0][field] - std::min(numSwitches[0][field], numSwitches[1][field]);
+	};
+
+	Graphics::Stats &stats = m_renderer->GetStats();
+	stats.AddToStatCount(Graphics::Stats::STAT_PROGRAM_SWITCHES_AVOIDED, avoided(0));
+	stats.AddToStatCount(Graphics::Stats::STAT_TEXTURE_SWITCHES_AVOIDED, avoided(1));
+	stats.AddToStatCount(Graphics::Stats::STAT_RENDER_STATE_SWITCHES_AVOIDED, avoided(2));
 }
 
 template <size_t I>
@@ -169,12 +548,17 @@ size_t align(size_t t)
 	return (t + (I - 1)) & ~(I - 1);
 }
 
-char *CommandList::AllocDrawData(const Shader *shader)
+size_t CommandList::GetDrawDataSize(const Shader *shader)
 {
 	size_t constantSize = align<8>(shader->GetConstantStorageSize());
 	size_t bufferSize = align<8>(shader->GetNumBufferBindings() * sizeof(BufferBinding<UniformBuffer>));
 	size_t textureSize = align<8>(shader->GetNumTextureBindings() * sizeof(Texture *));
-	size_t totalSize = constantSize + bufferSize + textureSize;
+	return constantSize + bufferSize + textureSize;
+}
+
+char *CommandList::AllocDrawData(const Shader *shader)
+{
+	size_t totalSize = GetDrawDataSize(shader);
 
 	char *alloc = nullptr;
 	for (auto &bucket : m_dataBuckets) {
@@ -211,9 +595,28 @@ char *CommandList::SetupMaterialData(OGL::Material *mat)
 {
 	PROFILE_SCOPED()
 	mat->UpdateDrawData();
-	const Shader *s = mat->GetShader();
 
-	char *alloc = AllocDrawData(s);
+	char *alloc = AllocDrawData(mat->GetShader());
+	CopyMaterialData(mat, alloc);
+	return alloc;
+}
+
+char *CommandList::SetupDeferredMaterialData(OGL::Material *mat, size_t cmdIndex)
+{
+	PROFILE_SCOPED()
+	char *alloc = AllocDrawData(mat->GetShader());
+	CopyMaterialData(mat, alloc);
+
+	DeferredDraw &draw = m_deferredDraws.emplace_back();
+	draw.cmdIndex = cmdIndex;
+	draw.material = mat;
+	mat->FillDrawDataBlock(draw.dataBlock, m_transform, m_projection);
+	return alloc;
+}
+
+void CommandList::CopyMaterialData(const OGL::Material *mat, char *alloc)
+{
+	const Shader *s = mat->GetShader();
 	if (mat->m_pushConstants) {
 		memcpy(alloc, mat->m_pushConstants.get(), s->GetConstantStorageSize());
 	}
@@ -227,8 +630,6 @@ char *CommandList::SetupMaterialData(OGL::Material *mat)
 	for (size_t index = 0; index < s->GetNumTextureBindings(); index++) {
 		textures[index] = static_cast<TextureGL *>(mat->m_textureBindings[index]);
 	}
-
-	return alloc;
 }
 
 void CommandList::ApplyDrawData(const Shader *shader, Program *program, char *drawData) const
@@ -244,6 +645,7 @@ void CommandList::ApplyDrawData(const Shader *shader, Program *program, char *dr
 	TextureGL **textures = getTextureBindings(shader, drawData);
 	for (auto &info : shader->GetTextureBindings())
 		state->SetTexture(info.binding, textures[info.index]);
+	state->FlushTextures();
 
 	for (auto &info : shader->GetPushConstantBindings()) {
 		GLuint location = program->GetConstantLocation(info.index);
@@ -280,7 +682,7 @@ void CommandList::ApplyDrawData(const Shader *shader, Program *program, char *dr
 void CommandList::ExecuteDrawCmd(const DrawCmd &cmd)
 {
 	RenderStateCache *stateCache = m_renderer->GetStateCache();
-	stateCache->SetRenderState(cmd.renderStateHash);
+	stateCache->SetRenderState(cmd.renderStateId);
 	CHECKERRORS();
 
 	ApplyDrawData(cmd.shader, cmd.program, cmd.drawData);
@@ -298,7 +700,7 @@ void CommandList::ExecuteDrawCmd(const DrawCmd &cmd)
 void CommandList::ExecuteDynamicDrawCmd(const DynamicDrawCmd &cmd)
 {
 	RenderStateCache *stateCache = m_renderer->GetStateCache();
-	stateCache->SetRenderState(cmd.renderStateHash);
+	stateCache->SetRenderState(cmd.renderStateId);
 	CHECKERRORS();
 
 	ApplyDrawData(cmd.shader, cmd.program, cmd.drawData);
@@ -356,3 +758,8 @@ void CommandList::ExecuteBlitRenderTargetCmd(const BlitRenderTargetCmd &cmd)
 	CHECKERRORS();
 
 }
+
+void CommandList::ExecuteTimestampCmd(const TimestampCmd &cmd)
+{
+	glQueryCounter(cmd.query, GL_TIMESTAMP);
+}
@@ -4,11 +4,14 @@
 #pragma once
 
 #include "Color.h"
+#include "graphics/CommandList.h"
 #include "graphics/Graphics.h"
 #include "graphics/Types.h"
 #include "graphics/VertexBuffer.h"
 
+#include "MaterialGL.h"
 #include "OpenGLLibs.h"
+#include <unordered_map>
 #include <variant>
 
 namespace Graphics {
@@ -33,15 +36,19 @@ namespace Graphics {
 		class UniformBuffer;
 		class VertexBuffer;
 
-		class CommandList {
+		// The renderer's own command list, or a secondary one recorded by a
+		// worker thread through the Graphics::CommandList interface
+		class CommandList final : public Graphics::CommandList {
 		public:
 			struct DrawCmd {
 				MeshObject *mesh;
 				InstanceBuffer *inst = nullptr;
 				const Shader *shader = nullptr;
 				Program *program = nullptr;
-				size_t renderStateHash = 0;
+				uint32_t renderStateId = 0;
 				char *drawData;
+				float viewDepth = 0.f; // distance along the view axis, for sorting
+				uint64_t sortKey = 0;
 			};
 
 			struct DynamicDrawCmd {
@@ -49,7 +56,7 @@ namespace Graphics {
 				BufferBinding<IndexBuffer> idxBind;
 				const Shader *shader = nullptr;
 				Program *program = nullptr;
-				size_t renderStateHash = 0;
+				uint32_t renderStateId = 0;
 				char *drawData;
 			};
 
@@ -74,13 +81,27 @@ namespace Graphics {
 				bool linearFilter;
 			};
 
+			// GPU timestamp query, see GPUTimer
+			struct TimestampCmd {
+				GLuint query;
+			};
+
 			// development asserts to ensure sizes are kept reasonable.
 			// if you need to go beyond these sizes, add a new command instead.
 			static_assert(sizeof(DrawCmd) <= 64);
 			static_assert(sizeof(DynamicDrawCmd) <= 64);
 			static_assert(sizeof(RenderPassCmd) <= 64);
 
+			// Graphics::CommandList, for secondary lists
+			void SetTransform(const matrix4x4f &m) override;
+			void DrawMesh(Graphics::MeshObject *mesh, Graphics::Material *mat) override { AddDrawCmd(mesh, mat); }
+			void DrawMeshInstanced(Graphics::MeshObject *mesh, Graphics::Material *mat, Graphics::InstanceBuffer *inst) override { AddDrawCmd(mesh, mat, inst); }
+
 			void AddDrawCmd(Graphics::MeshObject *mesh, Graphics::Material *mat, Graphics::InstanceBuffer *inst = nullptr);
+			// see Renderer::BeginInstanceBatch(); the renderer's own list only
+			void BeginInstanceBatch();
+			void EndInstanceBatch();
+			void AddBatchedDrawCmd(Graphics::MeshObject *mesh, Graphics::Material *mat);
 			void AddDynamicDrawCmd(BufferBinding<Graphics::VertexBuffer> vtx, BufferBinding<Graphics::IndexBuffer> idx, Graphics::Material *mat);
 
 			void AddRenderPassCmd(RenderTarget *renderTarget, ViewportExtents extents);
@@ -95,8 +116,10 @@ namespace Graphics {
 				const ViewportExtents &dstExtents,
 				bool resolveMSAA = false, bool blitDepthBuffer = false, bool linearFilter = true);
 
+			void AddTimestampCmd(GLuint query);
+
 		protected:
-			using Cmd = std::variant<DrawCmd, DynamicDrawCmd, RenderPassCmd, BlitRenderTargetCmd>;
+			using Cmd = std::variant<DrawCmd, DynamicDrawCmd, RenderPassCmd, BlitRenderTargetCmd, TimestampCmd>;
 			const std::vector<Cmd> &GetDrawCmds() const { return m_drawCmds; }
 
 			bool IsEmpty() const { return m_drawCmds.empty(); }
@@ -104,16 +127,73 @@ namespace Graphics {
 
 		private:
 			friend class Graphics::RendererOGL;
-			CommandList(Graphics::RendererOGL *r) :
-				m_renderer(r)
+			CommandList(Graphics::RendererOGL *r, bool isSecondary = false) :
+				m_renderer(r),
+				m_isSecondary(isSecondary)
 			{
 				m_drawCmds.reserve(32);
 			}
 
+			// Secondary lists record draws without touching the renderer or the
+			// materials; the rest of each draw's setup is deferred until the list
+			// is submitted, on the main thread.
+			struct DeferredDraw {
+				size_t cmdIndex;
+				OGL::Material *material;
+				DrawDataBlock dataBlock;
+			};
+
+			// Start recording a secondary list with this state
+			void Begin(const matrix4x4f &transform, const matrix4x4f &projection);
+			// Finish the setup of all draws in a secondary list
+			void ResolveDeferredDraws();
+			// Append the commands of a resolved secondary list to this one. The
+			// draw data stays in the secondary list until it is reset.
+			void Append(const CommandList &list);
+
+			// Batched draws of the same mesh and material state. The draw data
+			// is captured when the first one is recorded; the per-draw block
+			// holds an identity view transform, as instances carry their own.
+			struct InstanceGroup {
+				MeshObject *mesh;
+				OGL::Material *material;
+				const Shader *shader;
+				Program *program;
+				uint32_t renderStateId;
+				char *drawData;
+				DrawDataBlock dataBlock;
+				uint32_t numDraws;
+				uint32_t firstTransform; // into m_batchTransforms, once sorted
+				uint32_t next;			 // next group with the same mesh
+				float viewDepth;
+			};
+
+			struct BatchedDraw {
+				uint32_t group;
+				matrix4x4f transform;
+			};
+
+			// Record the groups collected so far, before any command that
+			// mustn't be reordered with them
+			void FlushInstanceBatch();
+			void FlushInstanceBatchBefore(uint32_t renderStateId);
+			uint32_t FindInstanceGroup(const InstanceGroup &group, size_t drawDataSize) const;
+
+			// Reorder each run of opaque draws to group those sharing state
+			void SortOpaqueDrawCmds();
+			bool IsOpaqueDraw(const Cmd &cmd, uint32_t &lastStateId, bool &lastOpaque) const;
+			static uint64_t MakeSortKey(const DrawCmd &cmd);
+
 			// Allocate space for all shader data that needs to be cached forward
 			char *AllocDrawData(const Shader *shader);
+			static size_t GetDrawDataSize(const Shader *shader);
 			// Create and cache all material data needed for later execution of a draw command
 			char *SetupMaterialData(OGL::Material *mat);
+			// As above, for a secondary list: copies the material data, leaving
+			// the per-draw data to ResolveDeferredDraws()
+			char *SetupDeferredMaterialData(OGL::Material *mat, size_t cmdIndex);
+			// Copy the bindings and push constants of a material into its draw data
+			static void CopyMaterialData(const OGL::Material *mat, char *alloc);
 
 			// These functions are called before and after a command is executed
 			void ApplyDrawData(const Shader *shader, Program *program, char *drawData) const;
@@ -122,6 +202,7 @@ namespace Graphics {
 			void ExecuteDynamicDrawCmd(const DynamicDrawCmd &);
 			void ExecuteRenderPassCmd(const RenderPassCmd &);
 			void ExecuteBlitRenderTargetCmd(const BlitRenderTargetCmd &);
+			void ExecuteTimestampCmd(const TimestampCmd &);
 
 			static BufferBinding<UniformBuffer> *getBufferBindings(const Shader *shader, char *data);
 			static TextureGL **getTextureBindings(const Shader *shader, char *data);
@@ -149,6 +230,23 @@ namespace Graphics {
 			std::vector<Cmd> m_drawCmds;
 			std::vector<DataBucket> m_dataBuckets;
 			bool m_executing = false;
+
+			bool m_isSecondary;
+			matrix4x4f m_transform;
+			matrix4x4f m_projection;
+			std::vector<DeferredDraw> m_deferredDraws;
+
+			bool m_batching = false;
+			size_t m_batchInsertPos = 0;
+			std::vector<InstanceGroup> m_batchGroups;
+			std::vector<BatchedDraw> m_batchDraws;
+			std::vector<matrix4x4f> m_batchTransforms;
+			std::vector<char> m_batchScratch;
+			std::unordered_map<MeshObject *, uint32_t> m_batchGroupLookup;
+			// memoized render state checks of the last state seen
+			uint32_t m_batchStateId = 0;
+			bool m_batchStateOpaque = false;
+			bool m_batchStateDepthTest = false;
 		};
 
 	}; // namespace OGL
@@ -0,0 +1,151 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "GPUTimer.h"
+
+#include "core/PerfTimeline.h"
+
+#include <algorithm>
+
+using namespace Graphics::OGL;
+
+static constexpr uint32_t NOT_RECORDED = ~0u;
+
+// the first two queries of a frame time the frame itself
+static constexpr uint32_t FRAME_BEGIN = 0;
+static constexpr uint32_t FRAME_END = 1;
+
+GPUTimer::GPUTimer()
+{
+	for (FrameQueries &frame : m_frames)
+		glGenQueries(MAX_QUERIES, frame.queries);
+}
+
+GPUTimer::~GPUTimer()
+{
+	for (FrameQueries &frame : m_frames)
+		glDeleteQueries(MAX_QUERIES, frame.queries);
+}
+
+GLuint GPUTimer::BeginFrame()
+{
+	m_current = (m_current + 1) % NUM_FRAMES;
+	FrameQueries &frame = m_frames[m_current];
+	if (frame.pending)
+		ReadBack(frame);
+
+	frame.numUsed = 2;
+	frame.zones.clear();
+	m_openZones.clear();
+
+	m_timingFrame = true;
+	return frame.queries[FRAME_BEGIN];
+}
+
+GLuint GPUTimer::EndFrame()
+{
+	if (!m_timingFrame)
+		return 0;
+
+	FrameQueries &frame = m_frames[m_current];
+	frame.pending = true;
+	m_timingFrame = false;
+	return frame.queries[FRAME_END];
+}
+
+GLuint GPUTimer::AllocQuery()
+{
+	FrameQueries &frame = m_frames[m_current];
+	if (frame.numUsed == MAX_QUERIES)
+		return 0;
+	return frame.queries[frame.numUsed++];
+}
+
+uint32_t GPUTimer::FindName(std::string_view name)
+{
+	auto it = m_nameLookup.find(name);
+	if (it != m_nameLookup.end())
+		return it->second;
+
+	const uint32_t index = uint32_t(m_names.size());
+	m_names.emplace_back(name);
+	m_counterNames.emplace_back("GPU " + m_names.back() + " (us)");
+	m_nameLookup.emplace(m_names.back(), index);
+	return index;
+}
+
+GLuint GPUTimer::BeginZone(std::string_view name)
+{
+	if (!m_timingFrame)
+		return 0;
+
+	// both ends are allocated up front, so a zone that's begun always ends
+	FrameQueries &frame = m_frames[m_current];
+	if (frame.numUsed + 2 > MAX_QUERIES) {
+		m_openZones.push_back(NOT_RECORDED);
+		return 0;
+	}
+
+	Zone zone;
+	zone.name = FindName(name);
+	zone.depth = uint32_t(m_openZones.size());
+	zone.begin = AllocQuery();
+	zone.end = AllocQuery();
+
+	m_openZones.push_back(uint32_t(frame.zones.size()));
+	frame.zones.push_back(zone);
+	return zone.begin;
+}
+
+GLuint GPUTimer::EndZone()
+{
+	if (!m_timingFrame || m_openZones.empty())
+		return 0;
+
+	const uint32_t index = m_openZones.back();
+	m_openZones.pop_back();
+	return index == NOT_RECORDED ? 0 : m_frames[m_current].zones[index].end;
+}
+
+void GPUTimer::ReadBack(FrameQueries &frame)
+{
+	frame.pending = false;
+
+	// the end of the frame was the last timestamp written
+	GLint available = 0;
+	glGetQueryObjectiv(frame.queries[FRAME_END], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return;
+
+	const auto timestamp = [](GLuint query) {
+		GLuint64 time = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &time);
+		return time;
+	};
+
+	m_frameTime = double(timestamp(frame.queries[FRAME_END]) - timestamp(frame.queries[FRAME_BEGIN])) * 1e-6;
+
+	// zones used several times over the frame are added up, and listed in
+	// the order they were first used
+	m_zoneTimes.clear();
+	for (const Zone &zone : frame.zones) {
+		const double ms = double(timestamp(zone.end) - timestamp(zone.begin)) * 1e-6;
+		const char *name = m_names[zone.name].c_str();
+
+		auto it = std::find_if(m_zoneTimes.begin(), m_zoneTimes.end(),
+			[name](const Renderer::GPUZoneTime &time) { return time.name == name; });
+		if (it == m_zoneTimes.end())
+			m_zoneTimes.push_back({ name, zone.depth, ms });
+		else
+			it->ms += ms;
+	}
+
+	// so the GPU's share of a stutter shows up in exported traces
+	if (Perf::Timeline::IsEnabled()) {
+		Perf::Timeline::RecordCounter("GPU Frame (us)", uint64_t(m_frameTime * 1e3));
+		for (const Renderer::GPUZoneTime &time : m_zoneTimes) {
+			const uint32_t index = m_nameLookup.at(time.name);
+			Perf::Timeline::RecordCounter(m_counterNames[index].c_str(), uint64_t(time.ms * 1e3));
+		}
+	}
+}
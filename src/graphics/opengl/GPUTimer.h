@@ -0,0 +1,98 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include "OpenGLLibs.h"
+#include "graphics/Renderer.h"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Graphics {
+
+	namespace OGL {
+
+		/*
+			Times frames and named zones of GPU work with GL_TIMESTAMP queries.
+
+			Timestamps rather than GL_TIME_ELAPSED queries, as only one of
+			those can be running at a time and zones nest. The timer only
+			hands out queries; the renderer writes them through its command
+			list so they land between the draws they surround.
+
+			Each frame in flight has its own set of queries, read back
+			NUM_FRAMES frames later when the GPU has normally finished with
+			them; a frame it hasn't finished by then is dropped rather than
+			waited for.
+		*/
+		class GPUTimer {
+		public:
+			static constexpr uint32_t NUM_FRAMES = 3;
+			// queries per frame, two per zone
+			static constexpr uint32_t MAX_QUERIES = 256;
+
+			GPUTimer();
+			~GPUTimer();
+
+			GPUTimer(const GPUTimer &) = delete;
+			GPUTimer &operator=(const GPUTimer &) = delete;
+
+			// Collect the results of the oldest frame and start timing a new
+			// one. Both return the query to write the frame's timestamp into,
+			// EndFrame 0 if no frame is being timed
+			GLuint BeginFrame();
+			GLuint EndFrame();
+			bool IsTimingFrame() const { return m_timingFrame; }
+
+			// The query to write the timestamp at the start or end of a zone
+			// into, or 0 when there's nothing to write
+			GLuint BeginZone(std::string_view name);
+			GLuint EndZone();
+
+			// of the latest frame read back, negative before the first
+			double GetFrameTime() const { return m_frameTime; }
+			const std::vector<Renderer::GPUZoneTime> &GetZoneTimes() const { return m_zoneTimes; }
+
+		private:
+			struct Zone {
+				uint32_t name;
+				uint32_t depth;
+				GLuint begin;
+				GLuint end;
+			};
+
+			struct FrameQueries {
+				GLuint queries[MAX_QUERIES];
+				uint32_t numUsed = 0;
+				std::vector<Zone> zones;
+				bool pending = false;
+			};
+
+			GLuint AllocQuery();
+			uint32_t FindName(std::string_view name);
+			void ReadBack(FrameQueries &frame);
+
+			FrameQueries m_frames[NUM_FRAMES];
+			uint32_t m_current = 0;
+			bool m_timingFrame = false;
+			// zones begun and not yet ended, ~0u for those not recorded
+			std::vector<uint32_t> m_openZones;
+
+			// zone names and their timeline counter names, which have to
+			// outlive everything that refers to them
+			std::deque<std::string> m_names;
+			std::deque<std::string> m_counterNames;
+			std::unordered_map<std::string_view, uint32_t> m_nameLookup;
+
+			double m_frameTime = -1.0;
+			std::vector<Renderer::GPUZoneTime> m_zoneTimes;
+		};
+
+	} // namespace OGL
+
+} // namespace Graphics
@@ -17,20 +17,6 @@
 namespace Graphics {
 	namespace OGL {
 
-		struct DrawDataBlock {
-			// matrix data
-			matrix4x4f uViewMatrix;
-			matrix4x4f uViewMatrixInverse;
-			matrix4x4f uViewProjectionMatrix;
-
-			// Material Struct
-			Color4f diffuse;
-			Color4f specular;
-			Color4f emission;
-
-			// Scene struct
-			Color4f ambient;
-		};
 		static_assert(sizeof(DrawDataBlock) == 256, "");
 
 		static size_t s_lightDataName = "LightData"_hash;
@@ -42,7 +28,10 @@ namespace Graphics {
 		void Material::SetShader(Shader *s)
 		{
 			m_shader = s;
-			m_activeVariant = s->GetProgramForDesc(GetDescriptor());
+			// until its own variant has compiled the material draws with another
+			Program *variant = s->GetProgramForDesc(GetDescriptor());
+			m_activeVariant = s->GetReadyProgramForDesc(GetDescriptor());
+			m_pendingVariant = variant != m_activeVariant ? variant : nullptr;
 
 			// Allocate storage for texture bindings
 			GLuint numTextureBindings = s->GetNumTextureBindings();
@@ -84,15 +73,44 @@ namespace Graphics {
 				variantChanged = true;
 			}
 
-			if (variantChanged) {
+			if (variantChanged || m_pendingVariant) {
 				Program *p = m_shader->GetProgramForDesc(desc);
-				if (p->Loaded())
-					m_activeVariant = p;
+				m_pendingVariant = p != m_activeVariant ? p : nullptr;
+			}
+
+			// swap in the wanted variant once it has finished compiling
+			if (m_pendingVariant && !m_pendingVariant->IsPending()) {
+				if (m_pendingVariant->Loaded())
+					m_activeVariant = m_pendingVariant;
+				m_pendingVariant = nullptr;
 			}
 
 			return m_activeVariant;
 		}
 
+		Program *Material::EvaluateInstancedVariant()
+		{
+			const uint32_t numLights = m_renderer->GetNumLights();
+			if (m_instancedVariantEvaluated && m_instancedVariantLights == numLights)
+				return m_instancedVariant;
+
+			MaterialDescriptor desc = GetDescriptor();
+			desc.instanced = true;
+			if (desc.lighting)
+				desc.dirLights = numLights;
+
+			// draw separately until the variant has compiled
+			Program *p = m_shader->GetProgramForDesc(desc);
+			if (p->IsPending())
+				return nullptr;
+
+			// remember a variant that failed to load too, rather than retrying it every draw
+			m_instancedVariant = p->Loaded() ? p : nullptr;
+			m_instancedVariantLights = numLights;
+			m_instancedVariantEvaluated = true;
+			return m_instancedVariant;
+		}
+
 		void Material::UpdateDrawData()
 		{
 			PROFILE_SCOPED()
@@ -114,25 +132,80 @@ namespace Graphics {
 				BufferBinding<UniformBuffer> binding;
 
 				auto dataBlock = buffer->Allocate<DrawDataBlock>(binding);
-				dataBlock->diffuse = this->diffuse.ToColor4f();
-				dataBlock->specular = this->specular.ToColor4f();
-				dataBlock->specular.a = this->shininess;
-				dataBlock->emission = this->emissive.ToColor4f();
-				dataBlock->ambient = m_renderer->GetAmbientColor().ToColor4f();
-
-				// We handle the normal matrix by transposing the orientation part of the inverse view matrix in the shader
-				const matrix4x4f &mv = m_renderer->GetTransform();
-				const matrix4x4f &proj = m_renderer->GetProjection();
-				dataBlock->uViewMatrix = mv;
-				dataBlock->uViewMatrixInverse = mv.Inverse();
-				dataBlock->uViewProjectionMatrix = proj * mv;
+				FillDrawDataBlock(*dataBlock.data(), m_renderer->GetTransform(), m_renderer->GetProjection());
 
 				SetBuffer(s_drawDataName, { binding.buffer, binding.offset, binding.size });
 			}
 		}
 
+		void Material::FillDrawDataBlock(DrawDataBlock &dataBlock, const matrix4x4f &mv, const matrix4x4f &proj) const
+		{
+			dataBlock.diffuse = this->diffuse.ToColor4f();
+			dataBlock.specular = this->specular.ToColor4f();
+			dataBlock.specular.a = this->shininess;
+			dataBlock.emission = this->emissive.ToColor4f();
+			dataBlock.ambient = m_renderer->GetAmbientColor().ToColor4f();
+
+			SetDrawDataTransform(dataBlock, mv, proj);
+		}
+
+		void Material::SetDrawDataTransform(DrawDataBlock &dataBlock, const matrix4x4f &mv, const matrix4x4f &proj)
+		{
+			// We handle the normal matrix by transposing the orientation part of the inverse view matrix in the shader
+			dataBlock.uViewMatrix = mv;
+			dataBlock.uViewMatrixInverse = mv.Inverse();
+			dataBlock.uViewProjectionMatrix = proj * mv;
+		}
+
+		void Material::WriteDrawData(char *drawData, BufferBinding<UniformBuffer> *buffers, const DrawDataBlock &dataBlock) const
+		{
+			WriteLightData(drawData, buffers);
+			WriteDrawDataBlock(buffers, dataBlock);
+		}
+
+		void Material::WriteLightData(char *drawData, BufferBinding<UniformBuffer> *buffers) const
+		{
+			if (m_descriptor.lighting) {
+				UniformBuffer *lightBuffer = m_renderer->GetLightUniformBuffer();
+				BufferBindingData info = m_shader->GetBufferBindingInfo(s_lightDataName);
+				if (info.binding != Shader::InvalidBinding)
+					buffers[info.index] = { lightBuffer, 0, lightBuffer->GetSize() };
+
+				float intensity[4] = { 0.f, 0.f, 0.f, 0.f };
+				for (uint32_t i = 0; i < m_renderer->GetNumLights(); i++)
+					intensity[i] = m_renderer->GetLight(i).GetIntensity();
+
+				PushConstantData constant = m_shader->GetPushConstantInfo(s_lightIntensityName);
+				if (constant.binding != Shader::InvalidBinding && constant.format == ConstantDataFormat::DATA_FORMAT_FLOAT4)
+					*reinterpret_cast<Color4f *>(drawData + constant.offset) = Color4f(intensity[0], intensity[1], intensity[2], intensity[3]);
+			}
+		}
+
+		void Material::WriteDrawDataBlock(BufferBinding<UniformBuffer> *buffers, const DrawDataBlock &dataBlock) const
+		{
+			if (m_perDrawBinding != Shader::InvalidBinding) {
+				UniformLinearBuffer *buffer = m_renderer->GetDrawUniformBuffer(sizeof(DrawDataBlock));
+				BufferBindingData info = m_shader->GetBufferBindingInfo(s_drawDataName);
+				buffers[info.index] = buffer->Allocate(const_cast<DrawDataBlock *>(&dataBlock), sizeof(DrawDataBlock));
+			}
+		}
+
+		void Material::ClearDrawDataBlock(BufferBinding<UniformBuffer> *buffers) const
+		{
+			if (m_perDrawBinding != Shader::InvalidBinding) {
+				BufferBindingData info = m_shader->GetBufferBindingInfo(s_drawDataName);
+				buffers[info.index] = { nullptr, 0, 0 };
+			}
+		}
+
 		bool Material::IsProgramLoaded() const
 		{
+			// whether the material's own variant loads, so wait for it
+			if (m_pendingVariant) {
+				m_pendingVariant->Finish();
+				return m_pendingVariant->Loaded();
+			}
+
 			return m_activeVariant && m_activeVariant->Loaded();
 		}
 
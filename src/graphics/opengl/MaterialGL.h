@@ -32,6 +32,21 @@ namespace Graphics {
 		class Program;
 		class UniformBuffer;
 
+		struct DrawDataBlock {
+			// matrix data
+			matrix4x4f uViewMatrix;
+			matrix4x4f uViewMatrixInverse;
+			matrix4x4f uViewProjectionMatrix;
+
+			// Material Struct
+			Color4f diffuse;
+			Color4f specular;
+			Color4f emission;
+
+			// Scene struct
+			Color4f ambient;
+		};
+
 		class Material : public Graphics::Material {
 		public:
 			Material() {}
@@ -58,14 +73,36 @@ namespace Graphics {
 			friend class OGL::CommandList;
 			void Copy(OGL::Material *to) const;
 			Program *EvaluateVariant();
+			// the instanced counterpart of the active variant, or nullptr if
+			// the shader can't be drawn instanced
+			Program *EvaluateInstancedVariant();
 			void UpdateDrawData();
+			// The two halves of UpdateDrawData for secondary command lists, which
+			// leave the material untouched: the per-draw block can be filled on
+			// any thread, and is then uploaded on the main thread along with the
+			// lighting state into a draw command's own copy of the material data.
+			void FillDrawDataBlock(DrawDataBlock &block, const matrix4x4f &mv, const matrix4x4f &proj) const;
+			void WriteDrawData(char *drawData, BufferBinding<UniformBuffer> *buffers, const DrawDataBlock &block) const;
+			// The two parts of WriteDrawData, for draws whose per-draw block
+			// is only known once the lighting state has been captured
+			void WriteLightData(char *drawData, BufferBinding<UniformBuffer> *buffers) const;
+			void WriteDrawDataBlock(BufferBinding<UniformBuffer> *buffers, const DrawDataBlock &block) const;
+			// reset the per-draw block binding copied from the material
+			void ClearDrawDataBlock(BufferBinding<UniformBuffer> *buffers) const;
+			static void SetDrawDataTransform(DrawDataBlock &block, const matrix4x4f &mv, const matrix4x4f &proj);
 
 			Shader *m_shader;
 			Program *m_activeVariant;
+			// the variant wanted in place of m_activeVariant, while it compiles
+			Program *m_pendingVariant = nullptr;
 			RendererOGL *m_renderer;
 
 			uint32_t m_perDrawBinding;
 
+			Program *m_instancedVariant = nullptr;
+			uint32_t m_instancedVariantLights = 0;
+			bool m_instancedVariantEvaluated = false;
+
 			std::unique_ptr<char[]> m_pushConstants;
 			std::unique_ptr<Texture *[]> m_textureBindings;
 			std::unique_ptr<BufferBinding<UniformBuffer>[]> m_bufferBindings;
@@ -0,0 +1,70 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "PersistentBufferRing.h"
+
+#include "profiler/Profiler.h"
+
+#include <cassert>
+
+using namespace Graphics::OGL;
+
+bool PersistentBufferRing::s_supported = false;
+
+// how long to block in each glClientWaitSync call, in nanoseconds
+static constexpr GLuint64 FENCE_WAIT_TIMEOUT = 1000000;
+
+PersistentBufferRing::PersistentBufferRing(GLenum target, GLuint buffer, uint32_t regionSize) :
+	m_target(target),
+	m_buffer(buffer),
+	m_regionSize(regionSize),
+	m_region(0),
+	m_fences()
+{
+	assert(s_supported);
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const GLsizeiptr size = GLsizeiptr(regionSize) * NUM_REGIONS;
+
+	glBindBuffer(m_target, m_buffer);
+	glBufferStorage(m_target, size, nullptr, flags);
+	m_mapping = static_cast<uint8_t *>(glMapBufferRange(m_target, 0, size, flags));
+	glBindBuffer(m_target, 0);
+
+	assert(m_mapping);
+}
+
+PersistentBufferRing::~PersistentBufferRing()
+{
+	for (GLsync &fence : m_fences) {
+		if (fence)
+			glDeleteSync(fence);
+	}
+
+	glBindBuffer(m_target, m_buffer);
+	glUnmapBuffer(m_target);
+	glBindBuffer(m_target, 0);
+}
+
+bool PersistentBufferRing::NextRegion()
+{
+	PROFILE_SCOPED()
+
+	m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_region = (m_region + 1) % NUM_REGIONS;
+
+	GLsync fence = m_fences[m_region];
+	if (!fence)
+		return false;
+
+	m_fences[m_region] = nullptr;
+
+	// common case: the frame is long done
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	const bool waited = result == GL_TIMEOUT_EXPIRED;
+	while (result == GL_TIMEOUT_EXPIRED)
+		result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT);
+
+	glDeleteSync(fence);
+	return waited;
+}
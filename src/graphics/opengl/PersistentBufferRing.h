@@ -0,0 +1,59 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include "OpenGLLibs.h"
+
+#include <cstdint>
+
+namespace Graphics {
+
+	namespace OGL {
+
+		/*
+			Immutable buffer storage split into one region per frame in flight,
+			persistently mapped for writing (GL_ARB_buffer_storage / GL 4.4).
+
+			The owner writes straight into the current region with no upload
+			step or driver synchronization; the mapping is coherent, so data is
+			visible to draw commands issued after it was written. NextRegion()
+			fences the region just used and moves on to the next one, waiting
+			only if the GPU is still reading the frame that last used it.
+		*/
+		class PersistentBufferRing {
+		public:
+			static constexpr uint32_t NUM_REGIONS = 3;
+
+			// set by the renderer once the GL context is up
+			static void SetSupported(bool supported) { s_supported = supported; }
+			static bool IsSupported() { return s_supported; }
+
+			// replace the storage of the given buffer with regionSize * NUM_REGIONS bytes
+			PersistentBufferRing(GLenum target, GLuint buffer, uint32_t regionSize);
+			~PersistentBufferRing();
+
+			PersistentBufferRing(const PersistentBufferRing &) = delete;
+			PersistentBufferRing &operator=(const PersistentBufferRing &) = delete;
+
+			uint8_t *GetRegionData() const { return m_mapping + GetRegionOffset(); }
+			uint32_t GetRegionOffset() const { return m_region * m_regionSize; }
+
+			// Called once all draw commands reading the current region have
+			// been issued. Returns true if it had to wait for the GPU.
+			bool NextRegion();
+
+		private:
+			static bool s_supported;
+
+			GLenum m_target;
+			GLuint m_buffer;
+			uint32_t m_regionSize;
+			uint32_t m_region;
+			uint8_t *m_mapping;
+			GLsync m_fences[NUM_REGIONS];
+		};
+
+	} // namespace OGL
+
+} // namespace Graphics
@@ -3,6 +3,7 @@
 
 #include "Program.h"
 #include "FileSystem.h"
+#include "ProgramCache.h"
 #include "Shader.h"
 #include "StringF.h"
 #include "StringRange.h"
@@ -84,15 +85,20 @@ namespace Graphics {
 		//     Program ->
 		//       ShaderProgram (vertex)
 		//       ShaderProgram (fragment)
+		//
+		// The source is assembled on construction; StartCompile() then creates
+		// the shader object, which isn't needed if a cached binary is used instead.
 		struct ShaderProgram {
-			ShaderProgram(GLenum type, const std::string &filename, const std::string &defines)
+			ShaderProgram(GLenum type, const std::string &filename, const std::string &defines) :
+				type(type),
+				filename(filename)
 			{
 				RefCountedPtr<FileSystem::FileData> filecode = FileSystem::gameDataFiles.ReadFile(filename);
 
 				if (!filecode.Valid())
 					Error("Could not load %s", filename.c_str());
 
-				std::string strCode(filecode->AsStringRange().ToString());
+				strCode = filecode->AsStringRange().ToString();
 				size_t found = strCode.find("#include");
 				while (found != std::string::npos) {
 					// find the name of the file to include
@@ -160,26 +166,29 @@ namespace Graphics {
 			}
 		}
 #endif
-				shader = glCreateShader(type);
+			};
+
+				// Hands the compiling shader over to the caller, as with parallel
+			// compilation it can't be checked for errors until later.
+			GLuint StartCompile()
+			{
+				GLuint shader = glCreateShader(type);
 				if (glIsShader(shader) != GL_TRUE)
 					throw ShaderCompileException();
 
 				Compile(shader);
+				return shader;
+			}
 
-				if (!check_glsl_errors(filename.c_str(), shader)) {
-					glDeleteShader(shader);
-					shader = 0;
-				}
-			};
-
-			~ShaderProgram()
+			// the complete text passed to the compiler
+			std::string GetSource() const
 			{
-				if (shader)
-					glDeleteShader(shader);
+				std::string source;
+				for (size_t i = 0; i < blocks.size(); i++)
+					source.append(blocks[i], block_sizes[i]);
+				return source;
 			}
 
-			GLuint shader = 0;
-
 		private:
 			void AppendSource(const char *str)
 			{
@@ -200,6 +209,11 @@ namespace Graphics {
 				glCompileShader(shader_id);
 			}
 
+			GLenum type;
+			std::string filename;
+			// the shader text with includes expanded, referenced by blocks
+			std::string strCode;
+
 			std::vector<const char *> blocks;
 			std::vector<GLint> block_sizes;
 			std::set<std::string> previousIncludes;
@@ -209,53 +223,131 @@ namespace Graphics {
 		// Program Setup and Creation
 		//
 
-		Program::Program(Shader *shader, const ProgramDef &def) :
+		static bool s_parallelCompile = false;
+
+		void Program::InitParallelCompile(bool enabled)
+		{
+			const bool supported = GLEW_ARB_parallel_shader_compile || glewIsSupported("GL_KHR_parallel_shader_compile");
+			s_parallelCompile = enabled && supported;
+
+			// let the driver decide how many threads to compile with
+			if (s_parallelCompile && GLEW_ARB_parallel_shader_compile)
+				glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+
+			Log::Info("Parallel shader compilation {}\n", s_parallelCompile ? "enabled" : (supported ? "disabled" : "not supported"));
+		}
+
+		bool Program::IsParallelCompileEnabled()
+		{
+			return s_parallelCompile;
+		}
+
+		Program::Program(Shader *shader, const ProgramDef &def, bool parallel) :
+			m_shader(shader),
 			m_program(0),
 			success(false)
 		{
-			m_program = LoadShaders(def);
-			if (success)
+			m_program = BeginLink(def, m_pending);
+			if (m_program) {
+				success = true;
 				InitUniforms(shader);
+			} else if (!parallel) {
+				Finish();
+			}
 		}
 
 		Program::~Program()
 		{
+			// deleting a program the driver is still working on abandons it
+			if (m_pending.program) {
+				glDeleteProgram(m_pending.program);
+				glDeleteShader(m_pending.vertexShader);
+				glDeleteShader(m_pending.fragmentShader);
+			}
+
 			if (m_program)
 				glDeleteProgram(m_program);
 		}
 
+		bool Program::IsPending()
+		{
+			if (!m_pending.program)
+				return false;
+
+			// a completion status query is the one thing that won't wait on
+			// the driver's compiler threads
+			GLint complete = GL_FALSE;
+			glGetProgramiv(m_pending.program, GL_COMPLETION_STATUS_ARB, &complete);
+			if (complete == GL_FALSE)
+				return true;
+
+			Finish();
+			return false;
+		}
+
+		void Program::Finish()
+		{
+			if (!m_pending.program)
+				return;
+
+			m_program = EndLink(m_pending);
+			success = m_program != 0;
+			if (success)
+				InitUniforms(m_shader);
+		}
+
 		void Program::Reload(Shader *shader, const ProgramDef &def)
 		{
+			Finish();
+
 			GLuint newProg = LoadShaders(def);
 			if (newProg) {
 				glDeleteProgram(m_program);
 				m_program = newProg;
+				m_shader = shader;
+				success = true;
 				InitUniforms(shader);
 			}
 		}
 
 		//load, compile and link
 		GLuint Program::LoadShaders(const ProgramDef &def)
+		{
+			PendingLink pending;
+			GLuint program = BeginLink(def, pending);
+			return program ? program : EndLink(pending);
+		}
+
+		GLuint Program::BeginLink(const ProgramDef &def, PendingLink &pending)
 		{
 			PROFILE_SCOPED()
 
-			//load, create and compile shaders
+			//load shader sources
 			ShaderProgram vs(GL_VERTEX_SHADER, def.vertexShader, def.defines);
 			ShaderProgram fs(GL_FRAGMENT_SHADER, def.fragmentShader, def.defines);
 
-			if (!vs.shader || !fs.shader) {
-				Log::Warning("Error loading GLSL shaders for program {}\n", def.name);
-				success = false;
-				return 0;
+			uint64_t cacheKey = 0;
+			if (ProgramCache::IsEnabled()) {
+				cacheKey = ProgramCache::GetKey(def.name, vs.GetSource(), fs.GetSource());
+
+				GLuint program = ProgramCache::Load(cacheKey);
+				if (program)
+					return program;
 			}
 
+			//compile shaders; errors are checked once the program has linked
+			pending.name = def.name;
+			pending.cacheKey = cacheKey;
+			pending.vertexShader = vs.StartCompile();
+			pending.fragmentShader = fs.StartCompile();
+
 			//create program, attach shaders and link
 			GLuint program = glCreateProgram();
 			if (glIsProgram(program) != GL_TRUE)
 				throw ProgramException();
 
-			glAttachShader(program, vs.shader);
-			glAttachShader(program, fs.shader);
+			glAttachShader(program, pending.vertexShader);
+			glAttachShader(program, pending.fragmentShader);
 
 			//extra attribs, if they exist
 			glBindAttribLocation(program, 0, "a_vertex");
@@ -271,15 +363,36 @@ namespace Graphics {
 			// TODO: setup fragment output locations from shaderdef attributes
 			glBindFragDataLocation(program, 0, "frag_color");
 
+			if (cacheKey)
+				glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 			glLinkProgram(program);
-			success = check_glsl_errors(def.name.c_str(), program);
+			pending.program = program;
+			return 0;
+		}
+
+		GLuint Program::EndLink(PendingLink &pending)
+		{
+			PROFILE_SCOPED()
+
+			GLuint program = pending.program;
+			const bool compiled = check_glsl_errors(pending.name.c_str(), pending.vertexShader) &&
+				check_glsl_errors(pending.name.c_str(), pending.fragmentShader);
+
+			if (!compiled)
+				Log::Warning("Error loading GLSL shaders for program {}\n", pending.name);
 
-			if (!success) {
+			if (!compiled || !check_glsl_errors(pending.name.c_str(), program)) {
 				glDeleteProgram(program);
-				return 0;
+				program = 0;
+			} else if (pending.cacheKey) {
+				ProgramCache::Store(pending.cacheKey, program);
 			}
 
-			//shaders may now be deleted by Shader destructor
+			//shaders are no longer needed once linked
+			glDeleteShader(pending.vertexShader);
+			glDeleteShader(pending.fragmentShader);
+			pending = PendingLink();
 			return program;
 		}
 
@@ -21,24 +21,53 @@ namespace Graphics {
 		/*
 		* A Program is a specific, immutable variant of a shader that maps closely to
 		* the underlying API's terminology (Program, GraphicsPipeline, etc.)
+		*
+		* With parallel compilation, the driver compiles and links the program in
+		* the background and it can't be used until IsPending() returns false.
 		*/
 		class Program {
 		public:
-			Program(Shader *shader, const ProgramDef &def);
+			Program(Shader *shader, const ProgramDef &def, bool parallel = false);
 			~Program();
 
 			void Reload(Shader *shader, const ProgramDef &def);
 			bool Loaded() const { return success; }
 
+			// Checks on a program compiling in the background, finishing it if
+			// the driver is done. Never waits for the driver.
+			bool IsPending();
+			// finish a program compiling in the background, waiting if need be
+			void Finish();
+
+			// parallel compilation needs GL_KHR/ARB_parallel_shader_compile
+			static void InitParallelCompile(bool enabled);
+			static bool IsParallelCompileEnabled();
+
 			GLuint GetConstantLocation(uint32_t index) const { return m_constants[index]; }
 			GLuint GetProgramID() const { return m_program; }
 
 		protected:
+			// a link started by BeginLink and not yet checked
+			struct PendingLink {
+				GLuint program = 0;
+				GLuint vertexShader = 0;
+				GLuint fragmentShader = 0;
+				uint64_t cacheKey = 0;
+				std::string name;
+			};
+
 			GLuint LoadShaders(const ProgramDef &def);
+			// Compiles the shaders and starts linking them. Returns a program
+			// loaded from the cache, or 0 with the link left in pending.
+			GLuint BeginLink(const ProgramDef &def, PendingLink &pending);
+			// returns the linked program, or 0 if compiling or linking failed
+			GLuint EndLink(PendingLink &pending);
 			void InitUniforms(Shader *shader);
 
+			Shader *m_shader;
 			GLuint m_program;
 			bool success;
+			PendingLink m_pending;
 
 			// map of push constant bindings to glUniform locations
 			std::vector<GLuint> m_constants;
@@ -0,0 +1,213 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "ProgramCache.h"
+
+#include "FileSystem.h"
+#include "core/FNV1a.h"
+#include "core/Log.h"
+#include "core/StringUtils.h"
+#include "profiler/Profiler.h"
+#include "scenegraph/Serializer.h"
+
+#include <vector>
+
+namespace {
+
+	static const std::string CACHE_DIR = "program_cache";
+	static const std::string CACHE_EXTENSION = ".bin";
+	// holds the driver the cached binaries were built by
+	static const std::string DRIVER_FILENAME = "driver.txt";
+
+	static const Uint32 CACHE_MAGIC = 0x31435050; // "PPC1"
+	// bump this whenever Program changes anything baked into the binary (e.g. attribute locations)
+	static const Uint32 CACHE_VERSION = 1;
+
+	// magic, version, key, binary format
+	static const size_t HEADER_SIZE = sizeof(Uint32) * 3 + sizeof(Uint64);
+
+	bool s_cacheEnabled = false;
+	std::string s_driverId;
+
+	std::string GetCacheFilename(const uint64_t key)
+	{
+		return FileSystem::JoinPath(CACHE_DIR, fmt::format("{:016x}{}", key, CACHE_EXTENSION));
+	}
+
+	void RemoveCachedPrograms()
+	{
+		std::vector<FileSystem::FileInfo> files;
+		FileSystem::userFiles.ReadDirectory(CACHE_DIR, files);
+		for (const FileSystem::FileInfo &info : files) {
+			if (info.IsFile() && ends_with_ci(info.GetName(), CACHE_EXTENSION))
+				FileSystem::userFiles.RemoveFile(info.GetPath());
+		}
+	}
+
+} // namespace
+
+namespace Graphics {
+
+	namespace OGL {
+
+		// static
+		void ProgramCache::Init(bool enabled)
+		{
+			PROFILE_SCOPED()
+			s_cacheEnabled = false;
+			s_driverId = fmt::format("{}\n{}\n{}\n", glstr_to_str(glGetString(GL_VENDOR)),
+				glstr_to_str(glGetString(GL_RENDERER)), glstr_to_str(glGetString(GL_VERSION)));
+
+			if (!enabled)
+				return;
+
+			GLint numFormats = 0;
+			if (glewIsSupported("GL_ARB_get_program_binary"))
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+
+			if (numFormats <= 0) {
+				Log::Info("Program binaries are not supported by the driver, shader cache disabled\n");
+				return;
+			}
+
+			if (!FileSystem::userFiles.MakeDirectory(CACHE_DIR)) {
+				Log::Warning("ProgramCache: unable to create cache directory '{}', shader cache disabled\n", CACHE_DIR);
+				return;
+			}
+
+			// binaries from another driver (or driver version) are useless; start over
+			const std::string driverFilename = FileSystem::JoinPath(CACHE_DIR, DRIVER_FILENAME);
+			RefCountedPtr<FileSystem::FileData> driverFile = FileSystem::userFiles.ReadFile(driverFilename);
+			if (!driverFile || driverFile->AsStringRange().ToString() != s_driverId) {
+				RemoveCachedPrograms();
+
+				FILE *f = FileSystem::userFiles.OpenWriteStream(driverFilename, FileSystem::FileSourceFS::WRITE_TEXT);
+				if (!f) {
+					Log::Warning("ProgramCache: unable to write '{}', shader cache disabled\n", driverFilename);
+					return;
+				}
+
+				const bool written = fwrite(s_driverId.data(), s_driverId.size(), 1, f) == 1;
+				fclose(f);
+
+				if (!written) {
+					FileSystem::userFiles.RemoveFile(driverFilename);
+					return;
+				}
+			}
+
+			s_cacheEnabled = true;
+		}
+
+		// static
+		bool ProgramCache::IsEnabled()
+		{
+			return s_cacheEnabled;
+		}
+
+		// static
+		uint64_t ProgramCache::GetKey(const std::string &name, const std::string &vertexSource, const std::string &fragmentSource)
+		{
+			Serializer::Writer wr;
+			wr.String(s_driverId);
+			wr.String(name);
+			wr.String(vertexSource);
+			wr.String(fragmentSource);
+
+			const std::string &data = wr.GetData();
+			return hash_64_fnv1a(data.data(), data.size());
+		}
+
+		// static
+		GLuint ProgramCache::Load(uint64_t key)
+		{
+			PROFILE_SCOPED()
+			if (!s_cacheEnabled)
+				return 0;
+
+			const std::string filename = GetCacheFilename(key);
+			RefCountedPtr<FileSystem::FileData> file = FileSystem::userFiles.ReadFile(filename);
+			if (!file)
+				return 0;
+
+			Serializer::Reader rd(file->AsByteRange());
+			ByteRange binary;
+			GLenum binaryFormat = 0;
+			bool valid = false;
+
+			try {
+				// the same hash may come from a different program on a collision; treat as a miss
+				if (rd.Check(HEADER_SIZE + sizeof(Uint32)) && rd.Int32() == CACHE_MAGIC && rd.Int32() == CACHE_VERSION) {
+					if (rd.Int64() != key)
+						return 0;
+
+					binaryFormat = rd.Int32();
+					binary = rd.Blob();
+					valid = binary.Size() > 0;
+				}
+			} catch (std::out_of_range &e) {
+				Log::Warning("ProgramCache: error reading {}: {}\n", filename, e.what());
+			}
+
+			GLuint program = 0;
+			if (valid) {
+				program = glCreateProgram();
+				glProgramBinary(program, binaryFormat, binary.begin, GLsizei(binary.Size()));
+
+				// the driver is free to reject binaries, e.g. after an update
+				// which didn't change its version string
+				GLint status = GL_FALSE;
+				glGetProgramiv(program, GL_LINK_STATUS, &status);
+				if (status != GL_TRUE) {
+					glDeleteProgram(program);
+					program = 0;
+				}
+			}
+
+			if (!program)
+				FileSystem::userFiles.RemoveFile(filename);
+
+			return program;
+		}
+
+		// static
+		void ProgramCache::Store(uint64_t key, GLuint program)
+		{
+			PROFILE_SCOPED()
+			if (!s_cacheEnabled)
+				return;
+
+			GLint length = 0;
+			glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+			if (length <= 0)
+				return;
+
+			std::vector<char> binary(length);
+			GLenum binaryFormat = 0;
+			glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+			if (length <= 0)
+				return;
+
+			Serializer::Writer wr;
+			wr.Int32(CACHE_MAGIC);
+			wr.Int32(CACHE_VERSION);
+			wr.Int64(key);
+			wr.Int32(binaryFormat);
+			wr.Blob(ByteRange(binary.data(), size_t(length)));
+
+			const std::string filename = GetCacheFilename(key);
+			FILE *f = FileSystem::userFiles.OpenWriteStream(filename);
+			if (!f)
+				return;
+
+			const std::string &data = wr.GetData();
+			const bool written = fwrite(data.data(), data.size(), 1, f) == 1;
+			fclose(f);
+
+			if (!written)
+				FileSystem::userFiles.RemoveFile(filename);
+		}
+
+	} // namespace OGL
+
+} // namespace Graphics
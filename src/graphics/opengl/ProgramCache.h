@@ -0,0 +1,41 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include "OpenGLLibs.h"
+
+#include <cstdint>
+#include <string>
+
+namespace Graphics {
+
+	namespace OGL {
+
+		/*
+		 * On-disk cache of linked program binaries, so that shader variants
+		 * don't have to be compiled from source again on every start.
+		 *
+		 * Binaries are stored one file per program in the user data directory,
+		 * keyed by the complete preprocessed source of the program and the GL
+		 * driver. The whole cache is discarded when the driver changes.
+		 *
+		 * All functions must be called on the thread owning the GL context.
+		 */
+		class ProgramCache {
+		public:
+			// the cache stays disabled if the driver can't retrieve program binaries
+			static void Init(bool enabled);
+			static bool IsEnabled();
+
+			static uint64_t GetKey(const std::string &name, const std::string &vertexSource, const std::string &fragmentSource);
+
+			// returns a linked program, or 0 if none is cached for the key
+			static GLuint Load(uint64_t key);
+			// the program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+			static void Store(uint64_t key, GLuint program);
+		};
+
+	} // namespace OGL
+
+} // namespace Graphics
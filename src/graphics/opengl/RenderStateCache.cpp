@@ -18,28 +18,56 @@ extern "C" {
 using namespace Graphics::OGL;
 using RenderStateDesc = Graphics::RenderStateDesc;
 
-const RenderStateDesc &RenderStateCache::GetRenderState(size_t hash) const
+const RenderStateDesc &RenderStateCache::GetRenderState(uint32_t id) const
 {
-	for (auto &pair : m_stateDescCache)
-		if (pair.first == hash)
-			return pair.second;
+	if (id && id <= m_stateCache.size())
+		return m_stateCache[id - 1].desc;
 
-	Log::Warning("Attempt to get render state for unknown hash {}! Returning current state.", hash);
+	Log::Warning("Attempt to get render state for unknown id {}! Returning current state.", id);
 	return m_activeRenderState;
 }
 
-void RenderStateCache::SetRenderState(size_t hash)
+void RenderStateCache::SetRenderState(uint32_t id)
 {
-	if (hash == m_activeRenderStateHash)
+	if (id == m_activeRenderStateId)
+		return;
+
+	if (!id || id > m_stateCache.size()) {
+		Log::Warning("Attempt to set unknown render state id {}!", id);
 		return;
+	}
+
+	ApplyRenderState(m_stateCache[id - 1]);
+	m_activeRenderStateId = id;
+}
 
-	ApplyRenderState(GetRenderState(hash));
-	m_activeRenderStateHash = hash;
+// bit layout of the packed GL state
+static constexpr uint32_t GLSTATE_BLEND_MASK = 0xf;
+static constexpr uint32_t GLSTATE_CULL_SHIFT = 4;
+static constexpr uint32_t GLSTATE_CULL_MASK = 0x3 << GLSTATE_CULL_SHIFT;
+static constexpr uint32_t GLSTATE_DEPTH_TEST = 1 << 6;
+static constexpr uint32_t GLSTATE_DEPTH_WRITE = 1 << 7;
+static constexpr uint32_t GLSTATE_SCISSOR_TEST = 1 << 8;
+
+uint32_t RenderStateCache::PackGLState(const RenderStateDesc &rsd)
+{
+	static_assert(BLEND_DEST_ALPHA <= GLSTATE_BLEND_MASK);
+	static_assert(CULL_NONE <= (GLSTATE_CULL_MASK >> GLSTATE_CULL_SHIFT));
+
+	return uint32_t(rsd.blendMode) |
+		uint32_t(rsd.cullMode) << GLSTATE_CULL_SHIFT |
+		(rsd.depthTest ? GLSTATE_DEPTH_TEST : 0) |
+		(rsd.depthWrite ? GLSTATE_DEPTH_WRITE : 0) |
+		(rsd.scissorTest ? GLSTATE_SCISSOR_TEST : 0);
 }
 
-void RenderStateCache::ApplyRenderState(const RenderStateDesc &rsd)
+void RenderStateCache::ApplyRenderState(const CachedRenderState &state)
 {
-	if (rsd.blendMode != m_activeRenderState.blendMode || !m_activeRenderStateHash) {
+	const RenderStateDesc &rsd = state.desc;
+	// with no active state everything is applied
+	const uint32_t changed = m_activeRenderStateId ? state.glState ^ m_activeGLState : ~0u;
+
+	if (changed & GLSTATE_BLEND_MASK) {
 		switch (rsd.blendMode) {
 		case BLEND_SOLID:
 			glDisable(GL_BLEND);
@@ -73,7 +101,7 @@ void RenderStateCache::ApplyRenderState(const RenderStateDesc &rsd)
 		}
 	}
 
-	if (rsd.cullMode != m_activeRenderState.cullMode || !m_activeRenderStateHash) {
+	if (changed & GLSTATE_CULL_MASK) {
 		if (rsd.cullMode == CULL_BACK) {
 			glEnable(GL_CULL_FACE);
 			glCullFace(GL_BACK);
@@ -85,21 +113,21 @@ void RenderStateCache::ApplyRenderState(const RenderStateDesc &rsd)
 		}
 	}
 
-	if (rsd.depthTest != m_activeRenderState.depthTest || !m_activeRenderStateHash) {
+	if (changed & GLSTATE_DEPTH_TEST) {
 		if (rsd.depthTest)
 			glEnable(GL_DEPTH_TEST);
 		else
 			glDisable(GL_DEPTH_TEST);
 	}
 
-	if (rsd.depthWrite != m_activeRenderState.depthWrite || !m_activeRenderStateHash) {
+	if (changed & GLSTATE_DEPTH_WRITE) {
 		if (rsd.depthWrite)
 			glDepthMask(GL_TRUE);
 		else
 			glDepthMask(GL_FALSE);
 	}
 
-	if (rsd.scissorTest != m_activeRenderState.scissorTest || !m_activeRenderStateHash) {
+	if (changed & GLSTATE_SCISSOR_TEST) {
 		if (rsd.scissorTest)
 			glEnable(GL_SCISSOR_TEST);
 		else
@@ -107,6 +135,7 @@ void RenderStateCache::ApplyRenderState(const RenderStateDesc &rsd)
 	}
 
 	m_activeRenderState = rsd;
+	m_activeGLState = state.glState;
 }
 
 static size_t HashRenderStateDesc(const RenderStateDesc &desc)
@@ -128,15 +157,16 @@ static size_t HashRenderStateDesc(const RenderStateDesc &desc)
 	return size_t(a) | (size_t(b) << 32);
 }
 
-size_t RenderStateCache::InternRenderState(const RenderStateDesc &rsd)
+uint32_t RenderStateCache::InternRenderState(const RenderStateDesc &rsd)
 {
+	// only done when creating materials, so a linear search is fine
 	size_t hash = HashRenderStateDesc(rsd);
-	for (auto &pair : m_stateDescCache)
-		if (pair.first == hash)
-			return pair.first;
+	for (uint32_t idx = 0; idx < m_stateCache.size(); idx++)
+		if (m_stateCache[idx].hash == hash)
+			return idx + 1;
 
-	m_stateDescCache.emplace_back(hash, rsd);
-	return hash;
+	m_stateCache.push_back({ hash, PackGLState(rsd), rsd });
+	return uint32_t(m_stateCache.size());
 }
 
 size_t RenderStateCache::CacheVertexDesc(const Graphics::VertexBufferDesc &desc)
@@ -179,11 +209,12 @@ void RenderStateCache::ResetFrame()
 	// so we clear the texture cache
 	for (uint32_t idx = 0; idx < m_textureCache.size(); idx++)
 		SetTexture(idx, nullptr);
+	FlushTextures();
 
 	if (m_activeRT)
 		m_activeRT->Unbind();
 
-	m_activeRenderStateHash = 0;
+	m_activeRenderStateId = 0;
 	m_activeProgram = 0;
 	m_activeRT = nullptr;
 }
@@ -198,6 +229,14 @@ void RenderStateCache::SetTexture(uint32_t index, TextureGL *texture)
 	if (current == texture)
 		return;
 
+	// the changed units are bound together with one call in FlushTextures
+	if (m_useMultiBind) {
+		m_textureCache[index] = texture;
+		m_dirtyTextureBegin = std::min(m_dirtyTextureBegin, index);
+		m_dirtyTextureEnd = std::max(m_dirtyTextureEnd, index + 1);
+		return;
+	}
+
 	glActiveTexture(GL_TEXTURE0 + index);
 
 	// Unbind the previous texture if we're changing texture targets or clearing the texture binding
@@ -210,6 +249,34 @@ void RenderStateCache::SetTexture(uint32_t index, TextureGL *texture)
 	m_textureCache[index] = texture;
 }
 
+void RenderStateCache::FlushTextures()
+{
+	if (m_dirtyTextureBegin >= m_dirtyTextureEnd)
+		return;
+
+	// units in between which didn't change are rebound with their current texture
+	m_textureNames.clear();
+	for (uint32_t index = m_dirtyTextureBegin; index < m_dirtyTextureEnd; index++) {
+		TextureGL *texture = m_textureCache[index];
+		m_textureNames.push_back(texture ? texture->GetTextureID() : 0);
+	}
+
+	glBindTextures(m_dirtyTextureBegin, m_dirtyTextureEnd - m_dirtyTextureBegin, m_textureNames.data());
+
+	m_dirtyTextureBegin = UINT32_MAX;
+	m_dirtyTextureEnd = 0;
+}
+
+void RenderStateCache::InvalidateTexture(TextureGL *texture)
+{
+	// the unit keeps the old GL texture bound until something else is bound
+	// there, which the next SetTexture will now do
+	for (TextureGL *&current : m_textureCache) {
+		if (current == texture)
+			current = nullptr;
+	}
+}
+
 void RenderStateCache::SetBufferBinding(uint32_t index, BufferBinding<UniformBuffer> binding)
 {
 	if (index >= m_bufferCache.size())
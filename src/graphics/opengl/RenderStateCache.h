@@ -25,13 +25,21 @@ namespace Graphics {
 
 		class RenderStateCache {
 		public:
-			size_t GetActiveRenderStateHash() const { return m_activeRenderStateHash; }
+			// Render states are interned into dense IDs counting from 1, so a
+			// draw's state is compared as a single integer and looked up by
+			// index. 0 is no state, and forces the next state to be applied whole.
+			uint32_t GetActiveRenderStateId() const { return m_activeRenderStateId; }
 			const RenderStateDesc &GetActiveRenderState() const { return m_activeRenderState; }
 
 			GLuint GetVertexArrayObject(size_t hash);
 
-			void SetRenderState(size_t hash);
+			void SetRenderState(uint32_t id);
 			void SetTexture(uint32_t index, TextureGL *texture);
+			// bind any textures changed since the last call; needed before drawing
+			// when the textures are bound with ARB_multi_bind
+			void FlushTextures();
+			// the GL texture of the given texture object has changed
+			void InvalidateTexture(TextureGL *texture);
 			void SetBufferBinding(uint32_t index, BufferBinding<UniformBuffer> binding);
 			void SetProgram(Program *program);
 
@@ -45,10 +53,13 @@ namespace Graphics {
 
 		private:
 			friend class Graphics::RendererOGL;
-			RenderStateCache() = default;
+			friend class CommandList;
+			RenderStateCache(bool useMultiBind) :
+				m_useMultiBind(useMultiBind)
+			{}
 
-			const RenderStateDesc &GetRenderState(size_t hash) const;
-			size_t InternRenderState(const RenderStateDesc &rsd);
+			const RenderStateDesc &GetRenderState(uint32_t id) const;
+			uint32_t InternRenderState(const RenderStateDesc &rsd);
 
 			// Cache the given vertex format descriptor and create the associated
 			// vertex array object needed to draw it.
@@ -58,15 +69,31 @@ namespace Graphics {
 			// and cache the VAO needed for it.
 			size_t InternVertexAttribSet(Graphics::AttributeSet attribSet);
 
-			void ApplyRenderState(const RenderStateDesc &rsd);
+			// A render state with its GL state packed into bits, so the
+			// state that differs from the active one is found with an XOR
+			struct CachedRenderState {
+				size_t hash;
+				uint32_t glState;
+				RenderStateDesc desc;
+			};
+
+			static uint32_t PackGLState(const RenderStateDesc &rsd);
+			void ApplyRenderState(const CachedRenderState &state);
 			void ResetFrame();
 
 			std::vector<TextureGL *> m_textureCache;
+			// range of texture units changed but not yet bound, with ARB_multi_bind
+			uint32_t m_dirtyTextureBegin = UINT32_MAX;
+			uint32_t m_dirtyTextureEnd = 0;
+			std::vector<GLuint> m_textureNames;
+			bool m_useMultiBind;
 			std::vector<BufferBinding<UniformBuffer>> m_bufferCache;
 
-			size_t m_activeRenderStateHash = 0;
+			uint32_t m_activeRenderStateId = 0;
+			uint32_t m_activeGLState = 0;
 			RenderStateDesc m_activeRenderState;
-			std::vector<std::pair<size_t, RenderStateDesc>> m_stateDescCache;
+			// indexed by render state ID - 1
+			std::vector<CachedRenderState> m_stateCache;
 
 			// contains a mapping of hash->VAO on a per-vertex-format basis
 			std::vector<std::pair<size_t, GLuint>> m_vtxDescObjectCache;
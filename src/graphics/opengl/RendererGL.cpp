@@ -2,6 +2,7 @@
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
 #include "RendererGL.h"
+#include "FileSystem.h"
 #include "MathUtil.h"
 #include "RefCounted.h"
 #include "SDL_video.h"
@@ -10,6 +11,7 @@
 #include "graphics/Graphics.h"
 #include "graphics/Light.h"
 #include "graphics/Material.h"
+#include "graphics/RenderGraph.h"
 #include "graphics/RenderState.h"
 #include "graphics/Texture.h"
 #include "graphics/TextureBuilder.h"
@@ -19,8 +21,11 @@
 
 #include "CommandBufferGL.h"
 #include "GLDebug.h"
+#include "GPUTimer.h"
 #include "MaterialGL.h"
+#include "PersistentBufferRing.h"
 #include "Program.h"
+#include "ProgramCache.h"
 #include "RenderStateCache.h"
 #include "RenderTargetGL.h"
 #include "Shader.h"
@@ -240,7 +245,7 @@ namespace Graphics {
 			Warning("Driver needs GL3ForwardCompatible=0 in config.ini to display billboards (stars, navlights etc.)");
 		}
 
-		TextureBuilder::Init();
+		TextureBuilder::Init(vs.useTextureCompression);
 
 		const bool useDXTnTextures = vs.useTextureCompression;
 		m_useCompressedTextures = useDXTnTextures;
@@ -248,6 +253,19 @@ namespace Graphics {
 		const bool useAnisotropicFiltering = vs.useAnisotropicFiltering;
 		m_useAnisotropicFiltering = useAnisotropicFiltering;
 
+		m_sortDrawCommands = vs.sortDrawCommands;
+		m_batchInstances = vs.batchInstances;
+
+		// per-frame vertex and uniform data is written into persistently mapped buffers where available
+		const bool usePersistentBuffers = vs.usePersistentBuffers && glewIsSupported("GL_ARB_buffer_storage");
+		OGL::PersistentBufferRing::SetSupported(usePersistentBuffers);
+		Log::Info("Using {} for dynamic buffer data", usePersistentBuffers ? "persistent mapped buffers" : "buffer uploads");
+
+		// linked shader programs are kept on disk between runs where the driver allows it
+		OGL::ProgramCache::Init(vs.useProgramCache);
+		// and compiled by the driver in the background where it can
+		OGL::Program::InitParallelCompile(vs.parallelShaderCompile);
+
 		//XXX bunch of fixed function states here!
 		glCullFace(GL_BACK);
 		glFrontFace(GL_CCW);
@@ -268,7 +286,9 @@ namespace Graphics {
 		CHECKERRORS();
 
 		// create the state cache immediately after establishing baseline state.
-		m_renderStateCache.reset(new OGL::RenderStateCache());
+		// all of a draw's textures are bound with a single call where the driver allows it
+		const bool useMultiBind = glewIsSupported("GL_ARB_multi_bind");
+		m_renderStateCache.reset(new OGL::RenderStateCache(useMultiBind));
 
 		// check enum PrimitiveType matches OpenGL values
 		static_assert(POINTS == GL_POINTS);
@@ -298,8 +318,16 @@ namespace Graphics {
 
 		m_lightUniformBuffer.Reset();
 
+		// pooled render targets must go before the context does
+		m_renderTargetPool->Clear();
+
+		m_gpuTimer.reset();
+		ClearFrameFences();
+
 		s_DynamicDrawBufferMap.clear();
 
+		SaveShaderVariants();
+
 		// HACK ANDYC - this crashes when shutting down? They'll be released anyway right?
 		while (!m_shaders.empty()) {
 			delete m_shaders.back().second;
@@ -496,9 +524,96 @@ namespace Graphics {
 		m_renderStateCache->SetProgram(nullptr);
 
 		m_frameNum++;
+
+		if (m_gpuTimingEnabled && !m_gpuTimer)
+			m_gpuTimer.reset(new OGL::GPUTimer());
+		else if (!m_gpuTimingEnabled)
+			m_gpuTimer.reset();
+
+		if (m_gpuTimer)
+			m_drawCommandList->AddTimestampCmd(m_gpuTimer->BeginFrame());
+
 		return true;
 	}
 
+	void RendererOGL::SetGPUTimingEnabled(bool enabled)
+	{
+		// the timer is created or destroyed at the start of the next frame,
+		// so a frame is never left half timed
+		m_gpuTimingEnabled = enabled;
+	}
+
+	double RendererOGL::GetGPUFrameTime() const
+	{
+		return m_gpuTimer ? m_gpuTimer->GetFrameTime() : -1.0;
+	}
+
+	const std::vector<Renderer::GPUZoneTime> &RendererOGL::GetGPUZoneTimes() const
+	{
+		return m_gpuTimer ? m_gpuTimer->GetZoneTimes() : Renderer::GetGPUZoneTimes();
+	}
+
+	void RendererOGL::SetMaxFramesInFlight(uint32_t frames)
+	{
+		m_maxFramesInFlight = frames;
+		if (!frames)
+			ClearFrameFences();
+	}
+
+	void RendererOGL::ClearFrameFences()
+	{
+		for (FrameFence &frame : m_frameFences)
+			glDeleteSync(frame.fence);
+		m_frameFences.clear();
+		m_inputLatency = -1.0;
+	}
+
+	void RendererOGL::WaitForFramesInFlight()
+	{
+		PROFILE_SCOPED()
+		// a frame the GPU hasn't finished in this long is given up on
+		static constexpr GLuint64 FENCE_TIMEOUT_NS = 100'000'000;
+
+		m_frameFences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), m_frameInputTime });
+		m_frameInputTime = 0;
+
+		// frames over the cap are waited for, and any older ones the GPU has
+		// already finished are collected on the way
+		while (!m_frameFences.empty()) {
+			const FrameFence &frame = m_frameFences.front();
+			const bool overCap = m_frameFences.size() >= m_maxFramesInFlight;
+
+			const GLenum result = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, overCap ? FENCE_TIMEOUT_NS : 0);
+			if (result == GL_TIMEOUT_EXPIRED && !overCap)
+				break;
+
+			const bool finished = result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+			if (finished && frame.inputTime)
+				m_inputLatency = double(SDL_GetPerformanceCounter() - frame.inputTime) * 1e3 / double(SDL_GetPerformanceFrequency());
+
+			glDeleteSync(frame.fence);
+			m_frameFences.pop_front();
+		}
+	}
+
+	void RendererOGL::BeginGPUZone(std::string_view name)
+	{
+		if (!m_gpuTimer)
+			return;
+
+		if (GLuint query = m_gpuTimer->BeginZone(name))
+			m_drawCommandList->AddTimestampCmd(query);
+	}
+
+	void RendererOGL::EndGPUZone()
+	{
+		if (!m_gpuTimer)
+			return;
+
+		if (GLuint query = m_gpuTimer->EndZone())
+			m_drawCommandList->AddTimestampCmd(query);
+	}
+
 	bool RendererOGL::EndFrame()
 	{
 		PROFILE_SCOPED()
@@ -539,6 +654,10 @@ namespace Graphics {
 		stat.SetStatCount(Stats::STAT_NUM_TEXTURECUBE, num_texCube);
 		stat.SetStatCount(Stats::STAT_MEM_TEXTURECUBE, used_texCube);
 
+		// draws still waiting in the command list read this frame's dynamic
+		// data, they have to be issued before the buffers move on
+		FlushCommandBuffers();
+
 		uint32_t numAllocs = 0;
 		for (auto &buffer : m_drawUniformBuffers) {
 			numAllocs += buffer->NumAllocs();
@@ -549,6 +668,9 @@ namespace Graphics {
 			buffer.vtxBuffer->Reset();
 		}
 
+		for (auto &sizeClass : m_batchInstanceBuffers)
+			sizeClass.numUsed = 0;
+
 		stat.SetStatCount(Stats::STAT_DYNAMIC_DRAW_BUFFER_INUSE, s_DynamicDrawBufferMap.size());
 		stat.SetStatCount(Stats::STAT_DRAW_UNIFORM_BUFFER_INUSE, uint32_t(m_drawUniformBuffers.size()));
 		stat.SetStatCount(Stats::STAT_DRAW_UNIFORM_BUFFER_ALLOCS, numAllocs);
@@ -557,7 +679,7 @@ namespace Graphics {
 		for (auto &pair : m_shaders)
 			numShaderPrograms += pair.second->GetNumVariants();
 
-		stat.SetStatCount(Stats::STAT_NUM_RENDER_STATES, m_renderStateCache->m_stateDescCache.size());
+		stat.SetStatCount(Stats::STAT_NUM_RENDER_STATES, m_renderStateCache->m_stateCache.size());
 		stat.SetStatCount(Stats::STAT_NUM_SHADER_PROGRAMS, numShaderPrograms);
 
 		return true;
@@ -621,7 +743,7 @@ namespace Graphics {
 		PROFILE_SCOPED()
 
 		// Reset to a "known good" render state (disable scissor etc.)
-		m_renderStateCache->ApplyRenderState(RenderStateDesc{});
+		m_renderStateCache->SetRenderState(m_renderStateCache->InternRenderState(RenderStateDesc{}));
 
 		// TODO(sturnclaw): handle upscaling to higher-resolution screens
 		// we'll need an intermediate target to resolve to; resolve and rescale are mutually exclusive
@@ -633,7 +755,13 @@ namespace Graphics {
 		FlushCommandBuffers();
 		CheckRenderErrors(__FUNCTION__, __LINE__);
 
+		if (m_gpuTimer && m_gpuTimer->IsTimingFrame())
+			glQueryCounter(m_gpuTimer->EndFrame(), GL_TIMESTAMP);
+
 		SDL_GL_SwapWindow(m_window);
+		if (m_maxFramesInFlight)
+			WaitForFramesInFlight();
+
 		m_activeRenderTarget = nullptr;
 		m_renderStateCache->ResetFrame();
 		m_stats.NextFrame();
@@ -803,24 +931,18 @@ namespace Graphics {
 
 	// 1MB vertex draw buffer should be enough for most cases, right?
 	static constexpr uint32_t DYNAMIC_DRAW_BUFFER_SIZE = 1 << 20;
-	bool RendererOGL::DrawBuffer(const VertexArray *v, Material *m)
+	RendererOGL::DynamicBufferData &RendererOGL::GetDynamicDrawBuffer(AttributeSet attrs, uint32_t numVerts)
 	{
-		PROFILE_SCOPED()
-
-		if (v->IsEmpty()) return false;
-
-		const AttributeSet attrs = v->GetAttributeSet();
-
 		// Find a buffer matching our attributes with enough free space
 		auto iter = std::find_if(s_DynamicDrawBufferMap.begin(), s_DynamicDrawBufferMap.end(), [&](DynamicBufferData &a) {
 			uint32_t freeSize = a.vtxBuffer->GetCapacity() - a.vtxBuffer->GetSize();
-			return a.attrs == attrs && freeSize >= v->GetNumVerts();
+			return a.attrs == attrs && freeSize >= numVerts;
 		});
 
 		// If we don't have one, make one
 		if (iter == s_DynamicDrawBufferMap.end()) {
-			auto desc = VertexBufferDesc::FromAttribSet(v->GetAttributeSet());
-			desc.numVertices = std::max(v->GetNumVerts(), DYNAMIC_DRAW_BUFFER_SIZE / desc.stride);
+			auto desc = VertexBufferDesc::FromAttribSet(attrs);
+			desc.numVertices = std::max(numVerts, DYNAMIC_DRAW_BUFFER_SIZE / desc.stride);
 			desc.usage = BUFFER_USAGE_DYNAMIC;
 
 			size_t stateHash = m_renderStateCache->CacheVertexDesc(desc);
@@ -833,17 +955,44 @@ namespace Graphics {
 			iter = s_DynamicDrawBufferMap.end() - 1;
 		}
 
+		return *iter;
+	}
+
+	bool RendererOGL::DrawBuffer(const VertexArray *v, Material *m)
+	{
+		PROFILE_SCOPED()
+
+		if (v->IsEmpty()) return false;
+
+		DynamicBufferData &buffer = GetDynamicDrawBuffer(v->GetAttributeSet(), v->GetNumVerts());
+
 		// Write our data into the buffer
-		uint32_t offset = iter->vtxBuffer->GetOffset();
-		iter->vtxBuffer->Populate(*v);
+		uint32_t offset = buffer.vtxBuffer->GetOffset();
+		buffer.vtxBuffer->Populate(*v);
 		CheckRenderErrors(__FUNCTION__, __LINE__);
 
 		// Append a command to the command list
-		m_drawCommandList->AddDynamicDrawCmd({ iter->mesh->GetVertexBuffer(), offset, v->GetNumVerts() }, {}, m);
+		m_drawCommandList->AddDynamicDrawCmd({ buffer.mesh->GetVertexBuffer(), offset, v->GetNumVerts() }, {}, m);
 
 		return true;
 	}
 
+	void *RendererOGL::AllocDrawBuffer(AttributeSet attrs, uint32_t numVerts, Material *m)
+	{
+		PROFILE_SCOPED()
+		assert(numVerts > 0);
+
+		DynamicBufferData &buffer = GetDynamicDrawBuffer(attrs, numVerts);
+
+		// the caller writes the vertices, they're uploaded when the buffer is flushed
+		uint32_t offset = buffer.vtxBuffer->GetOffset();
+		void *data = buffer.vtxBuffer->Allocate(numVerts);
+
+		m_drawCommandList->AddDynamicDrawCmd({ buffer.mesh->GetVertexBuffer(), offset, numVerts }, {}, m);
+
+		return data;
+	}
+
 	bool RendererOGL::DrawBufferDynamic(VertexBuffer *v, uint32_t vtxOffset, IndexBuffer *i, uint32_t idxOffset, uint32_t numElems, Material *mat)
 	{
 		if (!numElems)
@@ -870,11 +1019,93 @@ namespace Graphics {
 		return true;
 	}
 
+	Graphics::CommandList *RendererOGL::BeginCommandList()
+	{
+		if (m_freeCommandLists.empty()) {
+			m_commandLists.emplace_back(new OGL::CommandList(this, true));
+			m_freeCommandLists.push_back(m_commandLists.back().get());
+		}
+
+		OGL::CommandList *list = m_freeCommandLists.back();
+		m_freeCommandLists.pop_back();
+
+		list->Begin(m_modelViewMat, m_projectionMat);
+		return list;
+	}
+
+	void RendererOGL::SubmitCommandList(Graphics::CommandList *cmdList)
+	{
+		PROFILE_SCOPED()
+		OGL::CommandList *list = static_cast<OGL::CommandList *>(cmdList);
+
+		// the draw data of the list stays where it was recorded until the
+		// commands are executed
+		list->ResolveDeferredDraws();
+		m_drawCommandList->Append(*list);
+		m_submittedCommandLists.push_back(list);
+
+		m_stats.AddToStatCount(Stats::STAT_NUM_CMDLIST_SUBMITS, 1);
+	}
+
+	void RendererOGL::BeginInstanceBatch()
+	{
+		if (m_batchInstances)
+			m_drawCommandList->BeginInstanceBatch();
+	}
+
+	void RendererOGL::EndInstanceBatch()
+	{
+		if (m_batchInstances)
+			m_drawCommandList->EndInstanceBatch();
+	}
+
+	bool RendererOGL::DrawMeshBatched(MeshObject *mesh, Material *material)
+	{
+		m_drawCommandList->AddBatchedDrawCmd(mesh, material);
+		return true;
+	}
+
+	// smallest instance buffer handed out for a batch
+	static constexpr Uint32 MIN_BATCH_INSTANCE_BUFFER_SIZE = 16;
+	OGL::InstanceBuffer *RendererOGL::GetBatchInstanceBuffer(Uint32 numInstances)
+	{
+		size_t sizeClass = 0;
+		while ((MIN_BATCH_INSTANCE_BUFFER_SIZE << sizeClass) < numInstances)
+			sizeClass++;
+
+		if (sizeClass >= m_batchInstanceBuffers.size())
+			m_batchInstanceBuffers.resize(sizeClass + 1);
+
+		BatchInstanceBuffers &buffers = m_batchInstanceBuffers[sizeClass];
+		if (buffers.numUsed == buffers.buffers.size()) {
+			buffers.buffers.emplace_back(new OGL::InstanceBuffer(MIN_BATCH_INSTANCE_BUFFER_SIZE << sizeClass, BUFFER_USAGE_DYNAMIC));
+			GetStats().AddToStatCount(Stats::STAT_CREATE_BUFFER, 1);
+		}
+
+		return buffers.buffers[buffers.numUsed++].Get();
+	}
+
+	void RendererOGL::ReleaseSubmittedCommandLists()
+	{
+		for (OGL::CommandList *list : m_submittedCommandLists) {
+			list->Reset();
+			m_freeCommandLists.push_back(list);
+		}
+
+		m_submittedCommandLists.clear();
+	}
+
 	bool RendererOGL::FlushCommandBuffers()
 	{
 		PROFILE_SCOPED()
-		if (!m_drawCommandList || m_drawCommandList->IsEmpty())
+		// draws still being batched are recorded now, the batch carries on after them
+		if (m_drawCommandList)
+			m_drawCommandList->FlushInstanceBatch();
+
+		if (!m_drawCommandList || m_drawCommandList->IsEmpty()) {
+			ReleaseSubmittedCommandLists();
 			return false;
+		}
 
 		for (auto &buffer : m_drawUniformBuffers)
 			buffer->Flush();
@@ -882,6 +1113,9 @@ namespace Graphics {
 		for (auto &buffer : s_DynamicDrawBufferMap)
 			buffer.vtxBuffer->Flush();
 
+		if (m_sortDrawCommands)
+			m_drawCommandList->SortOpaqueDrawCmds();
+
 		m_drawCommandList->m_executing = true;
 
 		for (const auto &cmd : m_drawCommandList->GetDrawCmds()) {
@@ -893,6 +1127,8 @@ namespace Graphics {
 				m_drawCommandList->ExecuteRenderPassCmd(*renderPassCmd);
 			else if (auto *blitRenderTargetCmd = std::get_if<OGL::CommandList::BlitRenderTargetCmd>(&cmd))
 				m_drawCommandList->ExecuteBlitRenderTargetCmd(*blitRenderTargetCmd);
+			else if (auto *timestampCmd = std::get_if<OGL::CommandList::TimestampCmd>(&cmd))
+				m_drawCommandList->ExecuteTimestampCmd(*timestampCmd);
 		}
 
 		// we don't manually reset the active vertex array after each drawcall for performance,
@@ -901,6 +1137,7 @@ namespace Graphics {
 
 		m_drawCommandList->m_executing = false;
 		m_drawCommandList->Reset();
+		ReleaseSubmittedCommandLists();
 
 		m_stats.AddToStatCount(Stats::STAT_NUM_CMDLIST_FLUSHES, 1);
 		return true;
@@ -1008,23 +1245,9 @@ namespace Graphics {
 
 		mat->m_renderer = this;
 		mat->m_descriptor = desc;
-		mat->m_renderStateHash = m_renderStateCache->InternRenderState(stateDescriptor);
-
-		OGL::Shader *s = nullptr;
-		for (auto &pair : m_shaders) {
-			if (pair.first == shader)
-				s = pair.second;
-		}
-
-		if (!s) {
-			s = new OGL::Shader(shader);
-			Log::Info("Created shader {} (address={})\n", shader, (void *)s);
-			CheckRenderErrors(__FUNCTION__, __LINE__);
-
-			m_shaders.push_back({ shader, s });
-		}
+		mat->m_renderStateId = m_renderStateCache->InternRenderState(stateDescriptor);
 
-		mat->SetShader(s);
+		mat->SetShader(GetShader(shader));
 		CheckRenderErrors(__FUNCTION__, __LINE__);
 		return mat;
 	}
@@ -1034,7 +1257,7 @@ namespace Graphics {
 		OGL::Material *newMat = new OGL::Material();
 		newMat->m_renderer = this;
 		newMat->m_descriptor = descriptor;
-		newMat->m_renderStateHash = m_renderStateCache->InternRenderState(stateDescriptor);
+		newMat->m_renderStateId = m_renderStateCache->InternRenderState(stateDescriptor);
 
 		const OGL::Material *material = static_cast<const OGL::Material *>(old);
 		newMat->SetShader(material->m_shader);
@@ -1044,6 +1267,85 @@ namespace Graphics {
 		return newMat;
 	}
 
+	OGL::Shader *RendererOGL::GetShader(const std::string &name)
+	{
+		for (auto &pair : m_shaders) {
+			if (pair.first == name)
+				return pair.second;
+		}
+
+		OGL::Shader *s = new OGL::Shader(name);
+		Log::Info("Created shader {} (address={})\n", name, (void *)s);
+		CheckRenderErrors(__FUNCTION__, __LINE__);
+
+		m_shaders.push_back({ name, s });
+		return s;
+	}
+
+	// one variant per line: the shader name, then the descriptor's fields
+	static const std::string SHADER_VARIANTS_FILENAME = "shader_variants.txt";
+
+	void RendererOGL::SaveShaderVariants()
+	{
+		std::ostringstream out;
+		std::vector<MaterialDescriptor> descs;
+		for (auto &pair : m_shaders) {
+			descs.clear();
+			pair.second->GetUsedVariants(descs);
+			for (const MaterialDescriptor &desc : descs) {
+				out << pair.first << ' ' << int(desc.effect) << ' ' << desc.alphaTest << ' ' << desc.glowMap << ' '
+					<< desc.ambientMap << ' ' << desc.lighting << ' ' << desc.normalMap << ' ' << desc.specularMap << ' '
+					<< desc.usePatterns << ' ' << desc.vertexColors << ' ' << desc.instanced << ' ' << desc.textures << ' '
+					<< desc.dirLights << ' ' << desc.quality << '\n';
+			}
+		}
+
+		FILE *f = FileSystem::userFiles.OpenWriteStream(SHADER_VARIANTS_FILENAME, FileSystem::FileSourceFS::WRITE_TEXT);
+		if (!f) {
+			Log::Warning("Unable to write '{}'\n", SHADER_VARIANTS_FILENAME);
+			return;
+		}
+
+		const std::string text = out.str();
+		fwrite(text.data(), 1, text.size(), f);
+		fclose(f);
+	}
+
+	void RendererOGL::PreloadShaderVariants()
+	{
+		PROFILE_SCOPED()
+		RefCountedPtr<FileSystem::FileData> file = FileSystem::userFiles.ReadFile(SHADER_VARIANTS_FILENAME);
+		if (!file)
+			return;
+
+		// with parallel compilation this only queues the work for the driver
+		std::istringstream lines(file->AsStringRange().ToString());
+		std::string line;
+		uint32_t numVariants = 0;
+		while (std::getline(lines, line)) {
+			std::istringstream fields(line);
+			std::string shader;
+			int effect = 0;
+			MaterialDescriptor desc;
+			fields >> shader >> effect >> desc.alphaTest >> desc.glowMap >> desc.ambientMap >> desc.lighting >>
+				desc.normalMap >> desc.specularMap >> desc.usePatterns >> desc.vertexColors >> desc.instanced >>
+				desc.textures >> desc.dirLights >> desc.quality;
+			if (fields.fail())
+				continue;
+			desc.effect = EffectType(effect);
+
+			// the shader may have gone since the list was written
+			try {
+				GetShader(shader)->GetProgramForDesc(desc);
+				numVariants++;
+			} catch (OGL::ShaderException &) {
+				continue;
+			}
+		}
+
+		Log::Info("Preloading {} shader variants\n", numVariants);
+	}
+
 	bool RendererOGL::ReloadShaders()
 	{
 		m_renderStateCache->SetProgram(nullptr);
@@ -1063,6 +1365,19 @@ namespace Graphics {
 		return new OGL::TextureGL(descriptor, m_useCompressedTextures, m_useAnisotropicFiltering);
 	}
 
+	void RendererOGL::SwapTextureContents(Texture *dst, Texture *src)
+	{
+		PROFILE_SCOPED()
+		OGL::TextureGL *dstGL = static_cast<OGL::TextureGL *>(dst);
+		OGL::TextureGL *srcGL = static_cast<OGL::TextureGL *>(src);
+
+		// recorded commands refer to the texture objects, not their GL names,
+		// but the state cache has to forget what it thinks is bound
+		m_renderStateCache->InvalidateTexture(dstGL);
+		m_renderStateCache->InvalidateTexture(srcGL);
+		dstGL->SwapStorage(*srcGL);
+	}
+
 	RenderTarget *RendererOGL::CreateRenderTarget(const RenderTargetDesc &desc)
 	{
 		PROFILE_SCOPED()
@@ -1180,7 +1495,7 @@ namespace Graphics {
 
 	const RenderStateDesc &RendererOGL::GetMaterialRenderState(const Graphics::Material *m)
 	{
-		return m_renderStateCache->GetRenderState(m->m_renderStateHash);
+		return m_renderStateCache->GetRenderState(m->m_renderStateId);
 	}
 
 	bool RendererOGL::Screendump(ScreendumpState &sd)
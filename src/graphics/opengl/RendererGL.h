@@ -10,6 +10,7 @@
 
 #include "OpenGLLibs.h"
 #include "RefCounted.h"
+#include <deque>
 #include <stack>
 #include <unordered_map>
 
@@ -23,6 +24,7 @@ namespace Graphics {
 	namespace OGL {
 		class CachedVertexBuffer;
 		class CommandList;
+		class GPUTimer;
 		class InstanceBuffer;
 		class IndexBuffer;
 		class Material;
@@ -64,6 +66,15 @@ namespace Graphics {
 		virtual bool EndFrame() override final;
 		virtual bool SwapBuffers() override final;
 
+		virtual void SetGPUTimingEnabled(bool enabled) override final;
+		virtual double GetGPUFrameTime() const override final;
+		virtual void SetMaxFramesInFlight(uint32_t frames) override final;
+		virtual void SetFrameInputTime(uint64_t ticks) override final { m_frameInputTime = ticks; }
+		virtual double GetInputLatency() const override final { return m_inputLatency; }
+		virtual void BeginGPUZone(std::string_view name) override final;
+		virtual void EndGPUZone() override final;
+		virtual const std::vector<GPUZoneTime> &GetGPUZoneTimes() const override final;
+
 		virtual RenderTarget *GetRenderTarget() override final;
 		virtual bool SetRenderTarget(RenderTarget *) override final;
 		virtual bool SetScissor(ViewportExtents) override final;
@@ -95,13 +106,22 @@ namespace Graphics {
 		virtual bool FlushCommandBuffers() override final;
 
 		virtual bool DrawBuffer(const VertexArray *v, Material *m) override final;
+		virtual void *AllocDrawBuffer(AttributeSet attrs, uint32_t numVerts, Material *m) override final;
 		virtual bool DrawBufferDynamic(VertexBuffer *v, uint32_t vtxOffset, IndexBuffer *i, uint32_t idxOffset, uint32_t numElems, Material *m) override final;
 		virtual bool DrawMesh(MeshObject *, Material *) override final;
 		virtual bool DrawMeshInstanced(MeshObject *, Material *, InstanceBuffer *) override final;
 
+		virtual Graphics::CommandList *BeginCommandList() override final;
+		virtual void SubmitCommandList(Graphics::CommandList *list) override final;
+
+		virtual void BeginInstanceBatch() override final;
+		virtual void EndInstanceBatch() override final;
+		virtual bool DrawMeshBatched(MeshObject *mesh, Material *mat) override final;
+
 		virtual Material *CreateMaterial(const std::string &, const MaterialDescriptor &, const RenderStateDesc &) override final;
 		virtual Material *CloneMaterial(const Material *, const MaterialDescriptor &, const RenderStateDesc &) override final;
 		virtual Texture *CreateTexture(const TextureDescriptor &descriptor) override final;
+		virtual void SwapTextureContents(Texture *dst, Texture *src) override final;
 		virtual RenderTarget *CreateRenderTarget(const RenderTargetDesc &) override final;
 		virtual VertexBuffer *CreateVertexBuffer(const VertexBufferDesc &) override final;
 		virtual IndexBuffer *CreateIndexBuffer(Uint32 size, BufferUsage, IndexBufferSize) override final;
@@ -114,9 +134,12 @@ namespace Graphics {
 
 		OGL::UniformBuffer *GetLightUniformBuffer();
 		OGL::UniformLinearBuffer *GetDrawUniformBuffer(Uint32 size);
+		// an instance buffer for a batch of draws, valid until the end of the frame
+		OGL::InstanceBuffer *GetBatchInstanceBuffer(Uint32 numInstances);
 		OGL::RenderStateCache *GetStateCache() { return m_renderStateCache.get(); }
 
 		virtual bool ReloadShaders() override final;
+		virtual void PreloadShaderVariants() override final;
 
 		virtual bool Screendump(ScreendumpState &sd) override final;
 
@@ -136,6 +159,8 @@ namespace Graphics {
 		float m_maxZFar;
 		bool m_useCompressedTextures;
 		bool m_useAnisotropicFiltering;
+		bool m_sortDrawCommands;
+		bool m_batchInstances;
 
 		// TODO: iterate shaderdef files on startup and cache by Shader name directive rather than filename fragment
 		std::vector<std::pair<std::string, OGL::Shader *>> m_shaders;
@@ -145,6 +170,19 @@ namespace Graphics {
 		bool m_useNVDepthRanged;
 		OGL::RenderTarget *m_activeRenderTarget = nullptr;
 		std::unique_ptr<OGL::CommandList> m_drawCommandList;
+		// secondary command lists, which are reused once their commands have been
+		// executed
+		std::vector<std::unique_ptr<OGL::CommandList>> m_commandLists;
+		std::vector<OGL::CommandList *> m_freeCommandLists;
+		std::vector<OGL::CommandList *> m_submittedCommandLists;
+
+		// instance buffers of batched draws by power of two size, each used
+		// once per frame
+		struct BatchInstanceBuffers {
+			std::vector<RefCountedPtr<OGL::InstanceBuffer>> buffers;
+			size_t numUsed = 0;
+		};
+		std::vector<BatchInstanceBuffers> m_batchInstanceBuffers;
 
 		matrix4x4f m_modelViewMat;
 		matrix4x4f m_projectionMat;
@@ -153,6 +191,29 @@ namespace Graphics {
 	private:
 		static bool initted;
 
+		void ReleaseSubmittedCommandLists();
+
+		// finds the shader with the name, loading it if need be
+		OGL::Shader *GetShader(const std::string &name);
+		// record the variants used this session for PreloadShaderVariants
+		void SaveShaderVariants();
+
+		std::unique_ptr<OGL::GPUTimer> m_gpuTimer;
+		bool m_gpuTimingEnabled = false;
+
+		// fenced after each swap while the frames in flight are capped
+		struct FrameFence {
+			GLsync fence;
+			uint64_t inputTime;
+		};
+		void WaitForFramesInFlight();
+		void ClearFrameFences();
+
+		std::deque<FrameFence> m_frameFences;
+		uint32_t m_maxFramesInFlight = 0;
+		uint64_t m_frameInputTime = 0;
+		double m_inputLatency = -1.0;
+
 		struct DynamicBufferData {
 			AttributeSet attrs;
 			OGL::CachedVertexBuffer *vtxBuffer;
@@ -162,6 +223,9 @@ namespace Graphics {
 		using DynamicBufferMap = std::vector<DynamicBufferData>;
 		static DynamicBufferMap s_DynamicDrawBufferMap;
 
+		// find a dynamic draw buffer with the attributes and room for numVerts, or create one
+		DynamicBufferData &GetDynamicDrawBuffer(AttributeSet attrs, uint32_t numVerts);
+
 		SDL_GLContext m_glContext;
 	};
 #define CHECKERRORS() RendererOGL::CheckErrors(__FUNCTION__, __LINE__)
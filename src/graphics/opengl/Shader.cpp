@@ -99,13 +99,49 @@ Program *Shader::GetProgramForDesc(const MaterialDescriptor &desc)
 		if (pair.first == desc)
 			return pair.second;
 
+	// variants that failed are kept too, rather than compiled again each time
 	Program *program = LoadProgram(desc);
-	if (program->Loaded())
-		m_variants.push_back({ desc, program });
+	m_variants.push_back({ desc, program });
 
 	return program;
 }
 
+Program *Shader::GetReadyProgramForDesc(const MaterialDescriptor &desc)
+{
+	Program *program = GetProgramForDesc(desc);
+	if (!program->IsPending())
+		return program;
+
+	// Instancing changes the vertex inputs, but otherwise any variant can be
+	// drawn with the same bindings; prefer one that looks most like desc.
+	Program *fallback = nullptr;
+	int bestScore = -1;
+	for (auto &pair : m_variants) {
+		const MaterialDescriptor &other = pair.first;
+		if (other.instanced != desc.instanced || pair.second->IsPending() || !pair.second->Loaded())
+			continue;
+
+		const int score = (other.effect == desc.effect) * 4 + (other.textures == desc.textures) * 2 + (other.vertexColors == desc.vertexColors);
+		if (score > bestScore) {
+			fallback = pair.second;
+			bestScore = score;
+		}
+	}
+
+	if (fallback)
+		return fallback;
+
+	program->Finish();
+	return program;
+}
+
+void Shader::GetUsedVariants(std::vector<MaterialDescriptor> &descs) const
+{
+	for (auto &pair : m_variants)
+		if (pair.second->Loaded() || pair.second->IsPending())
+			descs.push_back(pair.first);
+}
+
 void Shader::Reload()
 {
 	// TODO: reload the shader definition file and regenerate
@@ -128,7 +164,7 @@ Program *Shader::LoadProgram(const MaterialDescriptor &desc)
 	ProgramDef def = m_programDef;
 	def.defines = GetProgramDefines(desc);
 
-	return new Program(this, def);
+	return new Program(this, def, Program::IsParallelCompileEnabled());
 }
 
 std::string Shader::GetProgramDefines(const MaterialDescriptor &desc)
@@ -74,8 +74,15 @@ namespace Graphics {
 
 			void Reload();
 
+			// the program may still be compiling, see Program::IsPending()
 			Program *GetProgramForDesc(const MaterialDescriptor &desc);
+			// Returns a program to draw desc with now: its own if that's ready,
+			// otherwise the closest loaded variant with the same vertex inputs,
+			// or failing that its own program once it has finished compiling.
+			Program *GetReadyProgramForDesc(const MaterialDescriptor &desc);
 			uint32_t GetNumVariants() const { return m_variants.size(); }
+			// the descriptors of all variants asked for that haven't failed to load
+			void GetUsedVariants(std::vector<MaterialDescriptor> &descs) const;
 
 			TextureBindingData GetTextureBindingInfo(size_t name) const;
 			size_t GetNumTextureBindings() const { return m_textureBindingInfo.size(); }
@@ -301,6 +301,15 @@ namespace Graphics {
 			glDeleteTextures(1, &m_texture);
 		}
 
+		void TextureGL::SwapStorage(TextureGL &other)
+		{
+			SwapDescriptor(other);
+			std::swap(m_target, other.m_target);
+			std::swap(m_texture, other.m_texture);
+			std::swap(m_allocSize, other.m_allocSize);
+			std::swap(m_useAnisoFiltering, other.m_useAnisoFiltering);
+		}
+
 		void TextureGL::Update(const void *data, const vector2f &pos, const vector3f &dataSize, TextureFormat format, const unsigned int numMips)
 		{
 			PROFILE_SCOPED()
@@ -37,11 +37,14 @@ namespace Graphics {
 
 			uint32_t GetTextureMemSize() const final { return m_allocSize; }
 
+			// exchange GL textures and descriptors with another texture
+			void SwapStorage(TextureGL &other);
+
 		private:
 			GLenum m_target;
 			GLuint m_texture;
 			uint32_t m_allocSize;
-			const bool m_useAnisoFiltering;
+			bool m_useAnisoFiltering;
 		};
 	} // namespace OGL
 } // namespace Graphics
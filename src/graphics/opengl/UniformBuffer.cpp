@@ -2,6 +2,7 @@
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
 #include "UniformBuffer.h"
+#include "PersistentBufferRing.h"
 
 #include "graphics/Types.h"
 #include "profiler/Profiler.h"
@@ -72,16 +73,24 @@ UniformLinearBuffer::UniformLinearBuffer(uint32_t size) :
 	m_numAllocs(0)
 {
 	glGenBuffers(1, &m_buffer);
+	m_size = 0;
+
+	// write allocations directly into a persistent mapping where possible
+	if (PersistentBufferRing::IsSupported()) {
+		m_ring.reset(new PersistentBufferRing(GL_UNIFORM_BUFFER, m_buffer, size));
+		return;
+	}
+
 	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
 	glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
 	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-	m_size = 0;
 	m_data.reset(new char[size]);
 }
 
 UniformLinearBuffer::~UniformLinearBuffer()
 {
 	assert(m_mapMode == BUFFER_MAP_NONE);
+	m_ring.reset();
 	glDeleteBuffers(1, &m_buffer);
 	m_data.reset();
 }
@@ -92,6 +101,11 @@ void UniformLinearBuffer::Reset()
 	m_lastFlush = 0;
 	m_numAllocs = 0;
 
+	if (m_ring) {
+		m_ring->NextRegion();
+		return;
+	}
+
 	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
 	glBufferData(GL_UNIFORM_BUFFER, m_capacity, nullptr, GL_DYNAMIC_DRAW);
 }
@@ -105,6 +119,12 @@ void UniformLinearBuffer::Flush()
 	if (m_lastFlush == m_size)
 		return;
 
+	// the persistent mapping is coherent, there's nothing to upload
+	if (m_ring) {
+		m_lastFlush = m_size;
+		return;
+	}
+
 	// Bind the buffer to the specified binding index as well as the GL_UNIFORM_BUFFER_TARGET
 	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
 
@@ -131,13 +151,13 @@ BufferBinding<UniformBuffer> UniformLinearBuffer::Allocate(void *data, size_t si
 		assert(0 && "Attempt to allocate beyond UniformLinearBuffer free size!");
 
 	uint32_t offset = m_size;
-	memcpy(m_data.get() + offset, data, size);
+	memcpy(GetWriteData() + offset, data, size);
 
 	// Consume the buffer in increments of aligned size
 	m_size += (size + MIN_BUFFER_ALIGNMENT_MASK) & ~MIN_BUFFER_ALIGNMENT_MASK;
 	m_numAllocs++;
 
-	return { this, offset, uint32_t(size) };
+	return { this, GetRegionOffset() + offset, uint32_t(size) };
 }
 
 void *UniformLinearBuffer::AllocInternal(size_t size, BufferBinding<UniformBuffer> &outBinding)
@@ -154,8 +174,18 @@ void *UniformLinearBuffer::AllocInternal(size_t size, BufferBinding<UniformBuffe
 	m_size += (size + MIN_BUFFER_ALIGNMENT_MASK) & ~MIN_BUFFER_ALIGNMENT_MASK;
 	m_numAllocs++;
 
-	outBinding = { this, offset, uint32_t(size) };
-	return m_data.get() + offset;
+	outBinding = { this, GetRegionOffset() + offset, uint32_t(size) };
+	return GetWriteData() + offset;
+}
+
+char *UniformLinearBuffer::GetWriteData() const
+{
+	return m_ring ? reinterpret_cast<char *>(m_ring->GetRegionData()) : m_data.get();
+}
+
+uint32_t UniformLinearBuffer::GetRegionOffset() const
+{
+	return m_ring ? m_ring->GetRegionOffset() : 0;
 }
 
 void UniformLinearBuffer::Unmap()
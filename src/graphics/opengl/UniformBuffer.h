@@ -13,6 +13,8 @@ namespace Graphics {
 
 	namespace OGL {
 
+		class PersistentBufferRing;
+
 		class UniformBuffer : public Graphics::UniformBuffer, public GLBufferBase {
 		public:
 			UniformBuffer(uint32_t size, BufferUsage usage);
@@ -34,6 +36,9 @@ namespace Graphics {
 			Implements a linear-allocator style uniform buffer binding.
 			Call Allocate to reserve and map a subrange of the buffer for code to write into once.
 			All allocations are reset at the start of the next frame.
+			Where GL_ARB_buffer_storage is available, allocations are written
+			straight into a persistently mapped ring of per-frame regions instead
+			of being staged in memory and uploaded by Flush().
 			TODO: there should be a better interface for attaching linear allocators to generic buffers.
 		*/
 		class UniformLinearBuffer : public UniformBuffer {
@@ -76,10 +81,18 @@ namespace Graphics {
 
 			void *AllocInternal(size_t size, BufferBinding<UniformBuffer> &outBinding);
 
+			// where allocations for the current frame are written to, and the
+			// offset of that memory in the GL buffer
+			char *GetWriteData() const;
+			uint32_t GetRegionOffset() const;
+
 			// cache individual allocations into a single buffer and upload to
 			// the GPU in one large chunk.
 			std::unique_ptr<char[]> m_data;
 
+			// replaces m_data when persistent mapping is supported
+			std::unique_ptr<PersistentBufferRing> m_ring;
+
 			// This tracks the end of the last section of flushed data so
 			// we can use the same allocator with multiple command lists
 			uint32_t m_lastFlush;
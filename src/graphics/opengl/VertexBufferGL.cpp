@@ -5,6 +5,7 @@
 #include "SDL_stdinc.h"
 #include "graphics/Types.h"
 #include "graphics/VertexArray.h"
+#include "graphics/opengl/PersistentBufferRing.h"
 #include "graphics/opengl/RendererGL.h"
 #include "utils.h"
 #include <algorithm>
@@ -27,8 +28,11 @@ namespace Graphics {
 			}
 		}
 
-		static GLuint is_attr_normalized(VertexAttrib semantic)
+		static GLuint is_attr_normalized(VertexAttrib semantic, VertexAttribFormat fmt)
 		{
+			if (fmt == ATTRIB_FORMAT_SBYTE4_NORM || fmt == ATTRIB_FORMAT_USHORT2_NORM)
+				return GL_TRUE;
+
 			return semantic == ATTRIB_DIFFUSE ? GL_TRUE : GL_FALSE;
 		}
 
@@ -36,11 +40,13 @@ namespace Graphics {
 		{
 			switch (fmt) {
 			case ATTRIB_FORMAT_FLOAT2:
+			case ATTRIB_FORMAT_USHORT2_NORM:
 				return 2;
 			case ATTRIB_FORMAT_FLOAT3:
 				return 3;
 			case ATTRIB_FORMAT_FLOAT4:
 			case ATTRIB_FORMAT_UBYTE4:
+			case ATTRIB_FORMAT_SBYTE4_NORM:
 				return 4;
 			default:
 				assert(false);
@@ -53,6 +59,10 @@ namespace Graphics {
 			switch (fmt) {
 			case ATTRIB_FORMAT_UBYTE4:
 				return GL_UNSIGNED_BYTE;
+			case ATTRIB_FORMAT_SBYTE4_NORM:
+				return GL_BYTE;
+			case ATTRIB_FORMAT_USHORT2_NORM:
+				return GL_UNSIGNED_SHORT;
 			case ATTRIB_FORMAT_FLOAT2:
 			case ATTRIB_FORMAT_FLOAT3:
 			case ATTRIB_FORMAT_FLOAT4:
@@ -311,6 +321,13 @@ namespace Graphics {
 			if (GetDesc().usage == BUFFER_USAGE_DYNAMIC) {
 				glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
 				glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(size), static_cast<GLvoid *>(data), GL_DYNAMIC_DRAW);
+			} else {
+				// static buffers keep their storage, and there's no client copy to update
+				assert(size <= m_desc.numVertices * m_desc.stride);
+				glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+				glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(size), static_cast<GLvoid *>(data));
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				m_written = true;
 			}
 		}
 
@@ -332,6 +349,31 @@ namespace Graphics {
 			assert(desc.usage == BufferUsage::BUFFER_USAGE_DYNAMIC);
 			m_size = 0;
 			m_lastFlushed = 0;
+			m_writeData = m_data;
+			m_regionOffset = 0;
+
+			if (PersistentBufferRing::IsSupported()) {
+				// the client data store isn't needed, vertices go into the mapping
+				delete[] m_data;
+				m_data = nullptr;
+
+				m_ring.reset(new PersistentBufferRing(GL_ARRAY_BUFFER, m_buffer, m_capacity * m_desc.stride));
+				m_writeData = m_ring->GetRegionData();
+			}
+		}
+
+		CachedVertexBuffer::~CachedVertexBuffer()
+		{
+			// unmap before the base class deletes the buffer
+			m_ring.reset();
+		}
+
+		Uint8 *CachedVertexBuffer::Allocate(uint32_t numVerts)
+		{
+			assert(m_capacity - m_size >= numVerts);
+			Uint8 *data = m_writeData + m_size * m_desc.stride;
+			m_size += numVerts;
+			return data;
 		}
 
 		bool CachedVertexBuffer::Populate(const VertexArray &va)
@@ -348,7 +390,7 @@ namespace Graphics {
 			for (size_t idx = 0; idx < va.GetNumVerts(); idx++) {
 				for (uint32_t n = 0; n < numAttrs; n++) {
 					// Calculate the location of this component inside the vertex being written
-					uint8_t *data = m_data + (m_size + idx) * m_desc.stride + m_desc.attrib[n].offset;
+					uint8_t *data = m_writeData + (m_size + idx) * m_desc.stride + m_desc.attrib[n].offset;
 					switch (m_desc.attrib[n].semantic) {
 					case ATTRIB_POSITION:
 						*reinterpret_cast<vector3f *>(data) = va.position[idx];
@@ -383,6 +425,13 @@ namespace Graphics {
 			if (m_lastFlushed >= dataSize)
 				return false;
 
+			// the persistent mapping is coherent, there's nothing to upload
+			if (m_ring) {
+				m_lastFlushed = dataSize;
+				m_written = true;
+				return true;
+			}
+
 			glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
 			glBufferSubData(GL_ARRAY_BUFFER, m_lastFlushed, dataSize - m_lastFlushed, m_data + m_lastFlushed);
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -394,14 +443,21 @@ namespace Graphics {
 		// Reset the cache and associated buffer for use in a new frame
 		void CachedVertexBuffer::Reset()
 		{
+			m_size = 0;
+			m_lastFlushed = 0;
+			m_written = false;
+
+			if (m_ring) {
+				m_ring->NextRegion();
+				m_writeData = m_ring->GetRegionData();
+				m_regionOffset = m_ring->GetRegionOffset();
+				return;
+			}
+
 			// respecify the buffer storage to orphan data that theoretically might still be in flight
 			glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
 			glBufferData(GL_ARRAY_BUFFER, m_capacity * m_desc.stride, nullptr, get_buffer_usage(m_desc.usage));
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-			m_size = 0;
-			m_lastFlushed = 0;
-			m_written = false;
 		}
 
 		// ------------------------------------------------------------
@@ -501,6 +557,13 @@ namespace Graphics {
 			if (GetUsage() == BUFFER_USAGE_DYNAMIC) {
 				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_buffer);
 				glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(size), static_cast<GLvoid *>(data), GL_DYNAMIC_DRAW);
+			} else {
+				// static buffers keep their storage, and there's no client copy to update
+				assert(size <= (m_elemSize == INDEX_BUFFER_16BIT ? sizeof(Uint16) : sizeof(Uint32)) * m_size);
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_buffer);
+				glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(size), static_cast<GLvoid *>(data));
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+				m_written = true;
 			}
 		}
 
@@ -646,7 +709,7 @@ namespace Graphics {
 				// Enable the attribute at that location
 				glEnableVertexAttribArray(attrib);
 				// Tell OpenGL what the array contains
-				glVertexAttribFormat(attrib, get_num_components(attr.format), get_component_type(attr.format), is_attr_normalized(attr.semantic), attr.offset);
+				glVertexAttribFormat(attrib, get_num_components(attr.format), get_component_type(attr.format), is_attr_normalized(attr.semantic, attr.format), attr.offset);
 				// All vertex attribs will be sourced from the same buffer
 				glVertexAttribBinding(attrib, 0);
 			}
@@ -14,6 +14,8 @@ namespace Graphics {
 
 	namespace OGL {
 
+		class PersistentBufferRing;
+
 		class VertexBuffer : public Graphics::VertexBuffer, public GLBufferBase {
 		public:
 			VertexBuffer(const VertexBufferDesc &, size_t stateHash);
@@ -38,12 +40,20 @@ namespace Graphics {
 			size_t m_vertexStateHash;
 		};
 
+		// With GL_ARB_buffer_storage, vertices are written straight into a
+		// persistently mapped ring of per-frame regions and Flush() has
+		// nothing left to upload.
 		class CachedVertexBuffer : public VertexBuffer {
 		public:
 			CachedVertexBuffer(const VertexBufferDesc &, size_t stateHash);
+			~CachedVertexBuffer();
 
 			virtual bool Populate(const VertexArray &) override final;
-			uint32_t GetOffset() { return m_size * m_desc.stride; }
+			uint32_t GetOffset() { return m_regionOffset + m_size * m_desc.stride; }
+
+			// Reserve space for numVerts vertices at the current offset, returning
+			// where to write them. They must be written before the next Flush.
+			Uint8 *Allocate(uint32_t numVerts);
 
 			bool Flush();
 			void Reset();
@@ -55,6 +65,11 @@ namespace Graphics {
 
 		private:
 			uint32_t m_lastFlushed;
+
+			// where this frame's vertices are written to, and its offset in the GL buffer
+			Uint8 *m_writeData;
+			uint32_t m_regionOffset;
+			std::unique_ptr<PersistentBufferRing> m_ring;
 		};
 
 		class IndexBuffer : public Graphics::IndexBuffer, public GLBufferBase {
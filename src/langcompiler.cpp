@@ -0,0 +1,80 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "FileSystem.h"
+#include "Lang.h"
+#include "core/Log.h"
+#include "core/StringUtils.h"
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+static int info()
+{
+	Output(
+		"langcompiler - Compile the translations in the data directory.\n"
+		"The JSON files of each language's modules, data/lang/<module>/<lang>.json,\n"
+		"are compiled into one string table, data/lang/<lang>.langtable, which the\n"
+		"game maps in place of parsing them.\n"
+		"USAGE: langcompiler\n");
+	return 1;
+}
+
+extern "C" int main(int argc, char **argv)
+{
+	if (argc > 1)
+		return info();
+
+	FileSystem::Init();
+	FileSystem::FileSourceFS dataFiles(FileSystem::GetDataDir());
+
+	// the modules of each language
+	std::map<std::string, std::vector<std::string>> languages;
+	for (FileSystem::FileEnumerator dirs(dataFiles, "lang", FileSystem::FileEnumerator::IncludeDirs | FileSystem::FileEnumerator::ExcludeFiles); !dirs.Finished(); dirs.Next()) {
+		const std::string module = dirs.Current().GetName();
+		for (FileSystem::FileEnumerator files(dataFiles, dirs.Current().GetPath()); !files.Finished(); files.Next()) {
+			const std::string name = files.Current().GetName();
+			if (ends_with_ci(name, ".json"))
+				languages[name.substr(0, name.size() - 5)].push_back(module);
+		}
+	}
+
+	int failed = 0;
+	for (const auto &language : languages) {
+		std::vector<Lang::ModuleStrings> modules;
+		size_t numStrings = 0;
+		for (const std::string &module : language.second) {
+			Lang::ModuleStrings &strings = modules.emplace_back();
+			if (!Lang::ReadModuleStrings(dataFiles, module, language.first, strings)) {
+				Output("lang/%s/%s.json: could not read file\n", module.c_str(), language.first.c_str());
+				modules.pop_back();
+				failed++;
+				continue;
+			}
+			numStrings += strings.strings.size();
+		}
+
+		const std::string table = Lang::WriteStringTable(modules);
+		const std::string output = "lang/" + language.first + ".langtable";
+
+		FILE *f = dataFiles.OpenWriteStream(output);
+		if (!f) {
+			Output("%s: could not open for writing\n", output.c_str());
+			failed++;
+			continue;
+		}
+		const bool written = fwrite(table.data(), 1, table.size(), f) == table.size();
+		if (fclose(f) != 0 || !written) {
+			Output("%s: write failed\n", output.c_str());
+			failed++;
+			continue;
+		}
+
+		Output("%s: %u modules, %u strings, %.1f KB\n", output.c_str(),
+			unsigned(modules.size()), unsigned(numStrings), table.size() / 1024.0);
+	}
+
+	FileSystem::Uninit();
+	return failed ? 2 : 0;
+}
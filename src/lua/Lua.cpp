@@ -5,6 +5,7 @@
 #include "Pi.h"
 
 #include "LuaColor.h"
+#include "LuaChunkCache.h"
 #include "LuaConsole.h"
 #include "LuaConstants.h"
 #include "LuaDev.h"
@@ -15,6 +16,7 @@
 #include "LuaFormat.h"
 #include "LuaGame.h"
 #include "LuaInput.h"
+#include "LuaJobs.h"
 #include "LuaJson.h"
 #include "LuaLang.h"
 #include "LuaManager.h"
@@ -47,6 +49,7 @@ namespace Lua {
 	void Init(JobQueue *asyncJobQueue)
 	{
 		manager = new LuaManager(asyncJobQueue);
+		LuaChunkCache::Init();
 		InitMath();
 	}
 
@@ -120,6 +123,7 @@ namespace Lua {
 		LuaShipDef::Register();
 		LuaMusic::Register();
 		LuaDev::Register();
+		LuaJobs::Register();
 		// LuaConsole::Register();
 
 		// XXX sigh
@@ -142,6 +146,7 @@ namespace Lua {
 	void UninitModules()
 	{
 		LuaEvent::Uninit();
+		LuaJobs::Uninit();
 
 		delete Pi::luaNameGen;
 
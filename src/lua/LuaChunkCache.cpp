@@ -0,0 +1,316 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "LuaChunkCache.h"
+
+#include "FileSystem.h"
+#include "JobQueue.h"
+#include "core/Log.h"
+#include "core/StringUtils.h"
+#include "profiler/Profiler.h"
+
+#define XXH_INLINE_ALL
+#include "lz4/xxhash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
+namespace {
+	static const std::string CACHE_DIR = "lua_cache";
+	static const std::string CACHE_EXTENSION = ".luac";
+
+	// enough to keep the workers busy without a job for every little module
+	static const size_t FILES_PER_JOB = 16;
+
+	// The cache file for a chunk is named by both halves of its key. The
+	// path half is a hash of the chunk name, which holds the path and
+	// whether the code is trusted. The content half is a hash of the source
+	// and the Lua build, so a file that changes replaces its own entry.
+	struct Key {
+		Uint64 path;
+		Uint64 content;
+	};
+
+	struct Chunk {
+		Key key;
+		std::string bytecode;
+	};
+
+	std::mutex s_chunksMutex;
+	std::map<std::string, Chunk> s_chunks; // by data path
+
+	// path hash -> content hash of the files in the cache dir
+	std::mutex s_indexMutex;
+	std::map<Uint64, Uint64> s_index;
+	bool s_diskCache = false;
+
+	Key MakeKey(std::string_view source, const std::string &chunkName)
+	{
+		Key key;
+		key.path = XXH64(chunkName.data(), chunkName.size(), 0);
+		key.content = XXH64(source.data(), source.size(), key.path + LUA_VERSION_NUM);
+		return key;
+	}
+
+	std::string CachePath(const Key &key)
+	{
+		return FileSystem::JoinPath(CACHE_DIR, fmt::format("{:016x}-{:016x}{}", key.path, key.content, CACHE_EXTENSION));
+	}
+
+	bool ParseCacheName(const std::string &name, Key &key)
+	{
+		if (name.size() != 33 + CACHE_EXTENSION.size() || name[16] != '-' || !ends_with_ci(name, CACHE_EXTENSION))
+			return false;
+
+		char *end = nullptr;
+		key.path = strtoull(name.c_str(), &end, 16);
+		if (end != name.c_str() + 16)
+			return false;
+		key.content = strtoull(name.c_str() + 17, &end, 16);
+		return end == name.c_str() + 33;
+	}
+
+	int WriteBytecode(lua_State *, const void *p, size_t sz, void *ud)
+	{
+		static_cast<std::string *>(ud)->append(static_cast<const char *>(p), sz);
+		return 0;
+	}
+
+	// cached bytecode is only used if Lua accepts it, which also catches
+	// files truncated by a crash
+	RefCountedPtr<FileSystem::FileData> LoadCacheFile(lua_State *l, const Key &key, const std::string &chunkName)
+	{
+		if (!s_diskCache)
+			return {};
+
+		{
+			std::lock_guard<std::mutex> lock(s_indexMutex);
+			auto it = s_index.find(key.path);
+			if (it == s_index.end() || it->second != key.content)
+				return {};
+		}
+
+		RefCountedPtr<FileSystem::FileData> cached = FileSystem::userFiles.ReadFile(CachePath(key));
+		if (!cached)
+			return {};
+
+		if (luaL_loadbufferx(l, cached->GetData(), cached->GetSize(), chunkName.c_str(), "b") != LUA_OK) {
+			lua_pop(l, 1);
+			return {};
+		}
+		return cached;
+	}
+
+	void WriteCacheFile(const Key &key, const std::string &bytecode)
+	{
+		if (!s_diskCache)
+			return;
+
+		FILE *f = FileSystem::userFiles.OpenWriteStream(CachePath(key));
+		if (!f)
+			return;
+		const bool written = fwrite(bytecode.data(), 1, bytecode.size(), f) == bytecode.size();
+		fclose(f);
+
+		std::lock_guard<std::mutex> lock(s_indexMutex);
+		auto it = s_index.find(key.path);
+		if (it != s_index.end() && it->second != key.content) {
+			// the file this one was compiled from before it changed
+			FileSystem::userFiles.RemoveFile(CachePath({ key.path, it->second }));
+		}
+		if (written)
+			s_index[key.path] = key.content;
+		else
+			s_index.erase(key.path);
+	}
+
+	class CompileJob : public Job {
+	public:
+		CompileJob(std::vector<FileSystem::FileInfo> &&files) :
+			m_files(std::move(files)),
+			m_cancelled(false)
+		{}
+
+		void OnRun() override
+		{
+			PROFILE_SCOPED()
+			// compiling needs a state to allocate in, but none of the libraries
+			lua_State *l = luaL_newstate();
+
+			for (const FileSystem::FileInfo &info : m_files) {
+				if (m_cancelled)
+					break;
+
+				RefCountedPtr<FileSystem::FileData> code = info.Read();
+				if (!code)
+					continue;
+
+				const StringRange source = code->AsStringRange().StripUTF8BOM();
+				const std::string chunkName = LuaChunkCache::ChunkName(info);
+
+				Chunk chunk;
+				chunk.key = MakeKey({ source.begin, source.Size() }, chunkName);
+
+				if (RefCountedPtr<FileSystem::FileData> cached = LoadCacheFile(l, chunk.key, chunkName)) {
+					chunk.bytecode.assign(cached->GetData(), cached->GetSize());
+				} else if (luaL_loadbuffer(l, source.begin, source.Size(), chunkName.c_str()) == LUA_OK) {
+					lua_dump(l, &WriteBytecode, &chunk.bytecode);
+					WriteCacheFile(chunk.key, chunk.bytecode);
+				} else {
+					// the error is reported when the module is loaded from source
+					lua_pop(l, 1);
+					continue;
+				}
+				lua_pop(l, 1);
+
+				m_chunks.emplace_back(info.GetPath(), std::move(chunk));
+			}
+
+			lua_close(l);
+		}
+
+		void OnFinish() override
+		{
+			std::lock_guard<std::mutex> lock(s_chunksMutex);
+			for (auto &chunk : m_chunks)
+				s_chunks[chunk.first] = std::move(chunk.second);
+		}
+
+		void OnCancel() override { m_cancelled = true; }
+
+	private:
+		std::vector<FileSystem::FileInfo> m_files;
+		std::vector<std::pair<std::string, Chunk>> m_chunks;
+		std::atomic<bool> m_cancelled;
+	};
+
+	void FindModules(const std::string &path, std::vector<FileSystem::FileInfo> &files)
+	{
+		for (FileSystem::FileEnumerator e(FileSystem::gameDataFiles, path, FileSystem::FileEnumerator::Recurse); !e.Finished(); e.Next()) {
+			const FileSystem::FileInfo &info = e.Current();
+			if (info.IsFile() && ends_with_ci(info.GetPath(), ".lua"))
+				files.push_back(info);
+		}
+	}
+} // namespace
+
+void LuaChunkCache::Init()
+{
+	PROFILE_SCOPED()
+	std::lock_guard<std::mutex> lock(s_indexMutex);
+	s_index.clear();
+
+	s_diskCache = FileSystem::userFiles.MakeDirectory(CACHE_DIR);
+	if (!s_diskCache) {
+		Log::Warning("LuaChunkCache: unable to create cache directory '{}', compiled modules won't be kept\n", CACHE_DIR);
+		return;
+	}
+
+	std::vector<FileSystem::FileInfo> files;
+	FileSystem::userFiles.ReadDirectory(CACHE_DIR, files);
+	std::sort(files.begin(), files.end(), [](const FileSystem::FileInfo &a, const FileSystem::FileInfo &b) {
+		return a.GetModificationTime() < b.GetModificationTime();
+	});
+
+	for (const FileSystem::FileInfo &info : files) {
+		if (!info.IsFile())
+			continue;
+
+		// anything else in here is left from an older layout, or is a
+		// version of a file older than the one after it
+		Key key;
+		if (!ParseCacheName(info.GetName(), key)) {
+			FileSystem::userFiles.RemoveFile(info.GetPath());
+			continue;
+		}
+
+		auto it = s_index.find(key.path);
+		if (it != s_index.end())
+			FileSystem::userFiles.RemoveFile(CachePath({ key.path, it->second }));
+		s_index[key.path] = key.content;
+	}
+}
+
+void LuaChunkCache::Precompile(JobSet *jobs, const std::vector<std::string> &dirs)
+{
+	PROFILE_SCOPED()
+
+	std::vector<FileSystem::FileInfo> files;
+	for (const std::string &dir : dirs)
+		FindModules(dir, files);
+
+	for (size_t i = 0; i < files.size(); i += FILES_PER_JOB) {
+		auto end = files.begin() + std::min(i + FILES_PER_JOB, files.size());
+		std::vector<FileSystem::FileInfo> batch(files.begin() + i, end);
+		jobs->Order(new CompileJob(std::move(batch)));
+	}
+
+	Output("LuaChunkCache: compiling %zu modules\n", files.size());
+}
+
+bool LuaChunkCache::Load(lua_State *l, std::string_view source, const std::string &chunkName, const std::string &path)
+{
+	const Key key = MakeKey(source, chunkName);
+
+	Chunk chunk;
+	bool found = false;
+	{
+		std::lock_guard<std::mutex> lock(s_chunksMutex);
+		auto it = s_chunks.find(path);
+		if (it != s_chunks.end()) {
+			chunk = std::move(it->second);
+			s_chunks.erase(it);
+			found = true;
+		}
+	}
+
+	// the file may have been edited since (package.reimport), or be a
+	// different file by that name from a mod mounted afterwards
+	if (found && chunk.key.path == key.path && chunk.key.content == key.content) {
+		if (luaL_loadbufferx(l, chunk.bytecode.data(), chunk.bytecode.size(), chunkName.c_str(), "b") == LUA_OK)
+			return true;
+		lua_pop(l, 1);
+	}
+
+	return bool(LoadCacheFile(l, key, chunkName));
+}
+
+void LuaChunkCache::Store(lua_State *l, std::string_view source, const std::string &chunkName)
+{
+	if (!s_diskCache)
+		return;
+
+	std::string bytecode;
+	lua_dump(l, &WriteBytecode, &bytecode);
+	WriteCacheFile(MakeKey(source, chunkName), bytecode);
+}
+
+void LuaChunkCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(s_chunksMutex);
+	s_chunks.clear();
+}
+
+std::string LuaChunkCache::ChunkName(const FileSystem::FileInfo &info)
+{
+	return (info.GetSource().IsTrusted() ? "@[T] " : "@") + info.GetPath();
+}
+
+bool LuaChunkCache::IsCachePath(const std::string &relPath)
+{
+	// Windows takes either separator
+	std::string path = relPath;
+	std::replace(path.begin(), path.end(), '\\', '/');
+
+	// throws std::invalid_argument for paths above the root, as Lookup does
+	path = FileSystem::NormalisePath(path);
+	std::string_view name(path);
+	if (starts_with(name, "/"))
+		name.remove_prefix(1);
+
+	return starts_with_ci(name, CACHE_DIR) &&
+		(name.size() == CACHE_DIR.size() || name[CACHE_DIR.size()] == '/');
+}
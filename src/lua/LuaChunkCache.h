@@ -0,0 +1,61 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _LUACHUNKCACHE_H
+#define _LUACHUNKCACHE_H
+
+#include <lua.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class JobSet;
+
+namespace FileSystem {
+	class FileInfo;
+}
+
+// Compiled Lua chunks, so that the game data scripts aren't all compiled
+// from source on every run.
+//
+// pi_lua_loadfile asks Load() for a chunk before compiling its source, and
+// passes what it compiles to Store(). The bytecode is kept in the user dir,
+// keyed by the file's path and a hash of its source and the Lua build, so a
+// stale entry is simply not found, and is replaced by the next Store().
+//
+// Reading and compiling a module also doesn't need the main state, so at
+// startup Precompile() does it for every module on the job queue. Modules
+// are still run one at a time on the main state in the order require()
+// asks for them; pi_lua_loadfile just finds them already compiled.
+namespace LuaChunkCache {
+
+	// Open the on-disk cache, once the user dir is available
+	void Init();
+
+	// Queue jobs on jobs that compile every .lua file below the given game
+	// data directories, to be used as the modules are loaded.
+	void Precompile(JobSet *jobs, const std::vector<std::string> &dirs);
+
+	// If there is a chunk compiled from the given source, push it as
+	// luaL_loadbuffer would and return true. Otherwise push nothing and
+	// return false. Precompiled chunks are only handed out once.
+	bool Load(lua_State *l, std::string_view source, const std::string &chunkName, const std::string &path);
+
+	// Keep the function on top of the stack, just compiled from source, for
+	// the next run
+	void Store(lua_State *l, std::string_view source, const std::string &chunkName);
+
+	// Free the precompiled chunks that were not loaded
+	void Clear();
+
+	// The chunk name pi_lua_loadfile gives the file
+	std::string ChunkName(const FileSystem::FileInfo &info);
+
+	// Whether a path in the user dir lies in the on-disk cache, which Lua
+	// code must not be able to write: bytecode is not checked the way
+	// source is.
+	bool IsCachePath(const std::string &relPath);
+
+} // namespace LuaChunkCache
+
+#endif
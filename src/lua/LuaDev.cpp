@@ -3,6 +3,7 @@
 
 #include "LuaDev.h"
 #include "Game.h"
+#include "Lua.h"
 #include "LuaObject.h"
 #include "Pi.h"
 #include "WorldView.h"
@@ -108,7 +109,7 @@ static int l_dev_galaxy_stats(lua_State *l)
 		void ProcessSystem(const Sector::System &system) override
 		{
 			if (system.IsExplored()) explored++;
-			double current = galaxy->GetStarSystem(SystemPath(system.sx, system.sy, system.sz, system.idx))->GetTotalPop().ToDouble();
+			double current = galaxy->GetStarSystemSummary(SystemPath(system.sx, system.sy, system.sz, system.idx))->GetTotalPop().ToDouble();
 			if (current > 0) {
 				inhabited++;
 				population += current;
@@ -251,6 +252,51 @@ static int l_dev_set_camera_offset(lua_State *l)
 	return 0;
 }
 
+/*
+ * Attribute the time Lua takes, and the memory it allocates, to the
+ * functions and files responsible, as shown by the Lua profiler tab of the
+ * debug window. The call hook slows Lua down a good deal while it runs.
+ *
+ * Dev.StartLuaProfiler()
+ * Dev.StopLuaProfiler()
+ * Dev.ResetLuaProfiler()
+ */
+static int l_dev_start_lua_profiler(lua_State *l)
+{
+	Lua::manager->GetProfiler().Start(Lua::manager->GetLuaState());
+	return 0;
+}
+
+static int l_dev_stop_lua_profiler(lua_State *l)
+{
+	Lua::manager->GetProfiler().Stop(Lua::manager->GetLuaState());
+	return 0;
+}
+
+static int l_dev_reset_lua_profiler(lua_State *l)
+{
+	Lua::manager->GetProfiler().Reset();
+	return 0;
+}
+
+/*
+ * Write what the Lua profiler has gathered so far to the profiler directory
+ * of the user dir, as <name>.folded (collapsed stacks, for flamegraph tools)
+ * and <name>.json (a Chrome trace, for chrome://tracing or Perfetto).
+ * Returns the path written, without the extension.
+ *
+ * path = Dev.WriteLuaProfile()
+ */
+static int l_dev_write_lua_profile(lua_State *l)
+{
+	const std::string path = LuaProfiler::MakeProfilePath();
+	if (!Lua::manager->GetProfiler().WriteProfile(path))
+		return luaL_error(l, "unable to write the Lua profile to '%s'", path.c_str());
+
+	LuaPush<std::string>(l, path);
+	return 1;
+}
+
 void LuaDev::Register()
 {
 	lua_State *l = Lua::manager->GetLuaState();
@@ -260,6 +306,10 @@ void LuaDev::Register()
 	static const luaL_Reg methods[] = {
 		{ "GalaxyStats", l_dev_galaxy_stats },
 		{ "SetCameraOffset", l_dev_set_camera_offset },
+		{ "StartLuaProfiler", l_dev_start_lua_profiler },
+		{ "StopLuaProfiler", l_dev_stop_lua_profiler },
+		{ "ResetLuaProfiler", l_dev_reset_lua_profiler },
+		{ "WriteLuaProfile", l_dev_write_lua_profile },
 		{ 0, 0 }
 	};
 
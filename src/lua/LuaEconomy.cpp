@@ -5,7 +5,11 @@
 #include "LuaMetaType.h"
 #include "LuaObject.h"
 #include "LuaUtils.h"
+#include "Game.h"
+#include "Pi.h"
+#include "SpaceStation.h"
 #include "galaxy/Economy.h"
+#include "galaxy/MarketSimulation.h"
 
 #include "LuaEconomy.h"
 
@@ -99,6 +103,54 @@ static int l_economy_get_economy_by_id(lua_State *l)
 	return 1;
 }
 
+// the market of a station in the current system, or SIZE_MAX
+static size_t find_market(lua_State *l, int index)
+{
+	SpaceStation *station = LuaObject<SpaceStation>::CheckFromLua(index);
+	if (!Pi::game)
+		luaL_error(l, "markets are only available while a game is running");
+
+	return Pi::game->GetMarkets()->FindMarket(station->GetSystemBody()->GetPath());
+}
+
+// market = Economy.GetMarket(station)
+// a table of { stock = ..., demand = ..., price = ... } by commodity name,
+// or nil if the station has no market
+static int l_economy_get_market(lua_State *l)
+{
+	const size_t market = find_market(l, 1);
+	if (market == SIZE_MAX) {
+		lua_pushnil(l);
+		return 1;
+	}
+
+	const GalacticEconomy::MarketSimulation *markets = Pi::game->GetMarkets();
+	lua_createtable(l, 0, GalacticEconomy::Commodities().size());
+	for (const auto &commodity : GalacticEconomy::Commodities()) {
+		lua_createtable(l, 0, 3);
+		pi_lua_settable(l, "stock", markets->GetStock(market, commodity.id));
+		pi_lua_settable(l, "demand", markets->GetDemand(market, commodity.id));
+		pi_lua_settable(l, "price", markets->GetPrice(market, commodity.id));
+		lua_setfield(l, -2, commodity.name);
+	}
+
+	return 1;
+}
+
+// Economy.AddMarketStock(station, commodityName, stock, demand)
+// for trades; selling to the station adds stock and takes away demand
+static int l_economy_add_market_stock(lua_State *l)
+{
+	const size_t market = find_market(l, 1);
+	const GalacticEconomy::CommodityId id = GalacticEconomy::GetCommodityByName(luaL_checkstring(l, 2));
+	if (id == GalacticEconomy::InvalidCommodityId)
+		return luaL_error(l, "unknown commodity '%s'", lua_tostring(l, 2));
+
+	if (market != SIZE_MAX)
+		Pi::game->GetMarkets()->AddStock(market, id, luaL_checknumber(l, 3), luaL_optnumber(l, 4, 0.0));
+	return 0;
+}
+
 void LuaEconomy::Register()
 {
 	lua_State *l = Lua::manager->GetLuaState();
@@ -111,6 +163,8 @@ void LuaEconomy::Register()
 		.AddFunction("GetCommodityById", l_economy_get_commodity_by_id)
 		.AddFunction("GetEconomies", l_economy_get_economies)
 		.AddFunction("GetEconomyById", l_economy_get_economy_by_id)
+		.AddFunction("GetMarket", l_economy_get_market)
+		.AddFunction("AddMarketStock", l_economy_add_market_stock)
 		.StopRecording();
 
 	lua_getfield(l, LUA_REGISTRYINDEX, "CoreImports");
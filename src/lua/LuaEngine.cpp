@@ -17,6 +17,7 @@
 #include "LuaUtils.h"
 #include "LuaVector.h"
 #include "LuaVector2.h"
+#include "ModelCache.h"
 #include "Pi.h"
 #include "Player.h"
 #include "Random.h"
@@ -1066,6 +1067,34 @@ static int l_engine_get_model(lua_State *l)
 	return 1;
 }
 
+/*
+ * Function: PrefetchModels
+ *
+ * Start loading models in the background, ahead of their first use.
+ *
+ * > Engine.PrefetchModels(name1, name2, ...)
+ *
+ * Parameters:
+ *
+ *   name - the names of the models to load
+ *
+ * Availability:
+ *
+ *   2024-05
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_engine_prefetch_models(lua_State *l)
+{
+	std::vector<std::string> names;
+	for (int i = 1; i <= lua_gettop(l); i++)
+		names.push_back(luaL_checkstring(l, i));
+	Pi::modelCache->Prefetch(names);
+	return 0;
+}
+
 static int l_engine_request_profile_frame(lua_State *l)
 {
 	if (lua_gettop(l) > 0) {
@@ -1172,6 +1201,7 @@ void LuaEngine::Register()
 		{ "OpenBrowseUserFolder", l_browse_user_folders },
 
 		{ "GetModel", l_engine_get_model },
+		{ "PrefetchModels", l_engine_prefetch_models },
 
 		{ "IsIntroZooming", l_engine_is_intro_zooming },
 		{ "GetIntroCurrentModelName", l_engine_get_intro_current_model_name },
@@ -8,10 +8,46 @@
 
 #include "core/Log.h"
 
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+
 namespace LuaEvent {
 
+	struct EventInfo {
+		// number of leading arguments identifying a mergeable event, or -1
+		int coalesceKeys = -1;
+		// queue indices of pending events that may still be merged into
+		std::vector<uint32_t> pending;
+		std::vector<std::pair<ListenerId, std::shared_ptr<NativeListener>>> listeners;
+	};
+
+	struct QueuedEvent {
+		const std::string *name;
+		EventInfo *info;
+		int firstArg; // index of the first argument in the slot table
+		int numArgs;
+	};
+
 	static LuaRef s_eventTable;
 
+	// Per-name rules and listeners; the map owns the interned event names
+	static std::map<std::string, EventInfo, std::less<>> s_events;
+
+	// Events queued natively since the last Emit(). Arguments live in a
+	// preallocated slot table in the registry which is reused every frame,
+	// so queueing an event builds no tables of its own.
+	static std::vector<QueuedEvent> s_queue;
+	static size_t s_head = 0;
+	static int s_argSlots = LUA_NOREF;
+	static int s_argTop = 0;
+
+	static ListenerId s_nextListenerId = 1;
+
+	static const int INITIAL_QUEUE_SIZE = 128;
+	static const int INITIAL_ARG_SLOTS = 512;
+
 	static bool _get_method_onto_stack(lua_State *l, const char *method)
 	{
 		LUA_DEBUG_START(l);
@@ -33,6 +69,90 @@ namespace LuaEvent {
 		return true;
 	}
 
+	static EventInfo &_get_event_info(std::string_view event, const std::string **name = nullptr)
+	{
+		auto iter = s_events.find(event);
+		if (iter == s_events.end())
+			iter = s_events.emplace(std::string(event), EventInfo()).first;
+
+		if (name)
+			*name = &iter->first;
+		return iter->second;
+	}
+
+	// Drop all natively queued events, releasing their arguments
+	static void _reset_queue(lua_State *l)
+	{
+		if (s_argSlots != LUA_NOREF) {
+			lua_rawgeti(l, LUA_REGISTRYINDEX, s_argSlots);
+			for (int i = 1; i <= s_argTop; i++) {
+				lua_pushnil(l);
+				lua_rawseti(l, -2, i);
+			}
+			lua_pop(l, 1);
+		}
+
+		for (auto &pair : s_events)
+			pair.second.pending.clear();
+
+		s_queue.clear();
+		s_head = 0;
+		s_argTop = 0;
+	}
+
+	static int _call_native_listener(lua_State *l)
+	{
+		NativeListener *fn = static_cast<NativeListener *>(lua_touserdata(l, 1));
+		lua_remove(l, 1);
+		(*fn)(l, lua_gettop(l));
+		return 0;
+	}
+
+	// Run the native listeners of every queued event and move the events on
+	// into the Lua queue for _Emit. Native listeners may queue further events,
+	// which are dispatched in the same pass.
+	static void _dispatch_queue(lua_State *l)
+	{
+		if (s_queue.empty())
+			return;
+
+		LUA_DEBUG_START(l);
+
+		lua_rawgeti(l, LUA_REGISTRYINDEX, s_argSlots);
+		const int slots = lua_gettop(l);
+		s_eventTable.PushCopyToStack();
+		const int queue = lua_gettop(l);
+
+		while (s_head < s_queue.size()) {
+			// copied, as a listener queueing an event may grow the queue
+			const QueuedEvent ev = s_queue[s_head++];
+
+			for (size_t i = 0; i < ev.info->listeners.size(); i++) {
+				std::shared_ptr<NativeListener> fn = ev.info->listeners[i].second;
+
+				lua_pushcfunction(l, _call_native_listener);
+				lua_pushlightuserdata(l, fn.get());
+				for (int arg = 0; arg < ev.numArgs; arg++)
+					lua_rawgeti(l, slots, ev.firstArg + arg);
+				pi_lua_protected_call(l, ev.numArgs + 1, 0);
+			}
+
+			lua_createtable(l, ev.numArgs, 1);
+			pi_lua_generic_push(l, *ev.name);
+			lua_setfield(l, -2, "name");
+			for (int arg = 0; arg < ev.numArgs; arg++) {
+				lua_rawgeti(l, slots, ev.firstArg + arg);
+				lua_rawseti(l, -2, arg + 1);
+			}
+			lua_rawseti(l, queue, lua_rawlen(l, queue) + 1);
+		}
+
+		lua_pop(l, 2);
+		_reset_queue(l);
+
+		LUA_DEBUG_END(l, 0);
+	}
+
 	void Init()
 	{
 		lua_State *l = Lua::manager->GetLuaState();
@@ -45,10 +165,28 @@ namespace LuaEvent {
 		s_eventTable = LuaRef(l, -1);
 
 		lua_pop(l, 1);
+
+		lua_createtable(l, INITIAL_ARG_SLOTS, 0);
+		s_argSlots = luaL_ref(l, LUA_REGISTRYINDEX);
+		s_queue.reserve(INITIAL_QUEUE_SIZE);
+
+		// Notifications of a changed state, where only the latest one for a
+		// given ship matters. onShipHit is deliberately not merged, as scripts
+		// count individual hits.
+		SetCoalesce("onFrameChanged", 1);
+		SetCoalesce("onShipAlertChanged", 1);
+		SetCoalesce("onShipFuelChanged", 1);
+		SetCoalesce("onShipFiring", 1);
 	}
 
 	void Uninit()
 	{
+		lua_State *l = Lua::manager->GetLuaState();
+
+		_reset_queue(l);
+		luaL_unref(l, LUA_REGISTRYINDEX, s_argSlots);
+		s_argSlots = LUA_NOREF;
+
 		s_eventTable.Unref();
 	}
 
@@ -57,6 +195,7 @@ namespace LuaEvent {
 		lua_State *l = Lua::manager->GetLuaState();
 
 		LUA_DEBUG_START(l);
+		_reset_queue(l);
 		if (!_get_method_onto_stack(l, "_Clear")) return;
 		pi_lua_protected_call(l, 0, 0);
 		LUA_DEBUG_END(l, 0);
@@ -67,8 +206,13 @@ namespace LuaEvent {
 		lua_State *l = Lua::manager->GetLuaState();
 
 		LUA_DEBUG_START(l);
-		if (!_get_method_onto_stack(l, "_Emit")) return;
-		pi_lua_protected_call(l, 0, 0);
+		// Lua listeners can trigger further native events; keep going until
+		// both queues are empty, as when everything was queued in Lua
+		do {
+			_dispatch_queue(l);
+			if (!_get_method_onto_stack(l, "_Emit")) return;
+			pi_lua_protected_call(l, 0, 0);
+		} while (!s_queue.empty());
 		LUA_DEBUG_END(l, 0);
 	}
 
@@ -77,4 +221,89 @@ namespace LuaEvent {
 		return s_eventTable;
 	}
 
+	void QueueFromStack(lua_State *l, std::string_view event, int nargs)
+	{
+		if (s_argSlots == LUA_NOREF) {
+			lua_pop(l, nargs);
+			return;
+		}
+
+		LUA_DEBUG_START(l);
+
+		const std::string *name;
+		EventInfo &info = _get_event_info(event, &name);
+
+		lua_rawgeti(l, LUA_REGISTRYINDEX, s_argSlots);
+		const int slots = lua_gettop(l);
+		const int base = slots - nargs;
+
+		if (info.coalesceKeys >= 0) {
+			for (uint32_t index : info.pending) {
+				// events already dispatched in this Emit() can't be merged into
+				if (index < s_head)
+					continue;
+
+				QueuedEvent &ev = s_queue[index];
+				if (ev.numArgs != nargs)
+					continue;
+
+				bool match = true;
+				for (int arg = 0; match && arg < std::min(info.coalesceKeys, nargs); arg++) {
+					lua_rawgeti(l, slots, ev.firstArg + arg);
+					match = lua_rawequal(l, -1, base + arg);
+					lua_pop(l, 1);
+				}
+
+				if (match) {
+					for (int arg = 0; arg < nargs; arg++) {
+						lua_pushvalue(l, base + arg);
+						lua_rawseti(l, slots, ev.firstArg + arg);
+					}
+					lua_pop(l, nargs + 1);
+					LUA_DEBUG_END(l, -nargs);
+					return;
+				}
+			}
+
+			info.pending.push_back(uint32_t(s_queue.size()));
+		}
+
+		s_queue.push_back({ name, &info, s_argTop + 1, nargs });
+		for (int arg = 0; arg < nargs; arg++) {
+			lua_pushvalue(l, base + arg);
+			lua_rawseti(l, slots, ++s_argTop);
+		}
+		lua_pop(l, nargs + 1);
+
+		LUA_DEBUG_END(l, -nargs);
+	}
+
+	void SetCoalesce(std::string_view event, int numKeyArgs)
+	{
+		EventInfo &info = _get_event_info(event);
+		info.coalesceKeys = numKeyArgs < 0 ? -1 : numKeyArgs;
+		if (info.coalesceKeys < 0)
+			info.pending.clear();
+	}
+
+	ListenerId SubscribeRaw(std::string_view event, NativeListener fn)
+	{
+		ListenerId id = s_nextListenerId++;
+		_get_event_info(event).listeners.emplace_back(id, std::make_shared<NativeListener>(std::move(fn)));
+		return id;
+	}
+
+	void Unsubscribe(ListenerId id)
+	{
+		for (auto &pair : s_events) {
+			auto &listeners = pair.second.listeners;
+			for (auto iter = listeners.begin(); iter != listeners.end(); ++iter) {
+				if (iter->first == id) {
+					listeners.erase(iter);
+					return;
+				}
+			}
+		}
+	}
+
 } // namespace LuaEvent
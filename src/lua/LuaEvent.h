@@ -9,6 +9,10 @@
 #include "LuaPushPull.h"
 #include "LuaTable.h"
 
+#include <functional>
+#include <tuple>
+#include <type_traits>
+
 namespace LuaEvent {
 
 	void Init();
@@ -19,6 +23,50 @@ namespace LuaEvent {
 
 	LuaRef &GetEventQueue();
 
+	// Queue the named event with the topmost nargs values on the stack as its
+	// arguments, popping them. Events queued this way are held natively until
+	// the next Emit() rather than each being built into a Lua table.
+	void QueueFromStack(lua_State *l, std::string_view event, int nargs);
+
+	// Allow pending instances of the named event to be merged. Queueing the
+	// event while one with the same first numKeyArgs arguments is still
+	// pending replaces that event's arguments in place instead of adding
+	// another. A negative numKeyArgs turns merging off again.
+	void SetCoalesce(std::string_view event, int numKeyArgs);
+
+	// A native listener is called from Emit() in a protected call, with the
+	// event's nargs arguments on the top of the stack, before the event is
+	// passed on to the Lua listeners
+	using NativeListener = std::function<void(lua_State *l, int nargs)>;
+	using ListenerId = uint32_t;
+
+	ListenerId SubscribeRaw(std::string_view event, NativeListener fn);
+	void Unsubscribe(ListenerId id);
+
+	namespace detail {
+		// nil pulls as nullptr for object arguments, as in onShipHit without
+		// an attacker
+		template <typename T>
+		inline T PullArg(lua_State *l, int index)
+		{
+			if constexpr (std::is_pointer_v<T>)
+				if (lua_isnil(l, index))
+					return nullptr;
+			return LuaPull<T>(l, index);
+		}
+	} // namespace detail
+
+	// Subscribe a C++ callable taking the event arguments as TArgs, e.g.
+	//   LuaEvent::Subscribe<Ship *>("onFrameChanged", [](Ship *s) { ... });
+	template <typename... TArgs, typename Fn>
+	inline ListenerId Subscribe(std::string_view event, Fn fn)
+	{
+		return SubscribeRaw(event, [fn](lua_State *l, int nargs) {
+			int index = lua_gettop(l) - nargs + 1;
+			std::apply(fn, std::tuple<TArgs...>{ detail::PullArg<TArgs>(l, index++)... });
+		});
+	}
+
 	// Push an event to the specified event queue, passed as a LuaRef &
 	template <typename... TArgs>
 	inline void Queue(const LuaRef &queue, std::string_view event, TArgs... args)
@@ -39,17 +87,13 @@ namespace LuaEvent {
 		ScopedTable(queue).PushBack(ev);
 	}
 
-	// Push an event to the specified event queue, passed as a LuaRef &
+	// Push an event to the global event queue
 	template <typename... TArgs>
 	inline void Queue(std::string_view event, TArgs... args)
 	{
-		Queue(GetEventQueue(), event, args...);
-	}
-
-	// Push an event to the specified event queue, passed as a LuaRef &
-	inline void Queue(std::string_view event)
-	{
-		Queue(GetEventQueue(), event);
+		lua_State *l = Lua::manager->GetLuaState();
+		pi_lua_multiple_push(l, args...);
+		QueueFromStack(l, event, sizeof...(TArgs));
 	}
 
 } // namespace LuaEvent
@@ -3,6 +3,7 @@
 
 #include "LuaFileSystem.h"
 #include "FileSystem.h"
+#include "LuaChunkCache.h"
 #include "LuaConstants.h"
 #include "LuaObject.h"
 #include "LuaUtils.h"
@@ -80,6 +81,10 @@ int LuaFileSystem::l_patched_io_open(lua_State* L)
 
 	try
 	{
+		if (fs.is_read_write && LuaChunkCache::IsCachePath(std::string(split_uri.rel_path))) {
+			return luaL_error(L, "'%s' is reserved for the engine's use.", split_uri.full_path.data());
+		}
+
 		::std::string abs_path = fs.source->Lookup(std::string(split_uri.rel_path)).GetAbsolutePath();
 		LuaPush(L, abs_path);
 		lua_replace(L, 1);
@@ -231,6 +236,9 @@ static int l_filesystem_make_directory(lua_State *l)
 
 		// shame these methods can't take a string_view.
 		std::string rel_path = std::string(split_uri.rel_path);
+		if (LuaChunkCache::IsCachePath(rel_path)) {
+			return luaL_error(l, "'%s' is reserved for the engine's use.", split_uri.full_path.data());
+		}
 		// At the moment, anything with a filesourceFS is also writeable, so the write permission test
 		// above also validates this...
 		wfs.MakeDirectory(rel_path);
@@ -102,7 +102,8 @@ static int l_format_date_only(lua_State *l)
 static int l_format_distance(lua_State *l)
 {
 	double t = luaL_checknumber(l, 1);
-	lua_pushstring(l, format_distance(t).c_str());
+	char buf[64];
+	lua_pushlstring(l, buf, format_distance(buf, sizeof(buf), t));
 	return 1;
 }
 
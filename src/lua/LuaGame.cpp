@@ -308,6 +308,70 @@ static int l_game_save_game(lua_State *l)
 	}
 }
 
+static void onSaveGameJobFinished(std::string_view filename, SaveGameManager::SaveResult result)
+{
+	LuaEvent::Queue("onGameSaved", filename, result == SaveGameManager::SAVE_OK);
+	LuaEvent::Emit();
+}
+
+/*
+ * Function: SaveGameAsync
+ *
+ * Save the current game in the background.
+ *
+ * > path = Game.SaveGameAsync(filename, delta)
+ *
+ * The game is captured when this is called, and written out by a Job while
+ * play continues. Once the file has been written, an "onGameSaved" event is
+ * queued with the filename and whether the save succeeded.
+ *
+ * Parameters:
+ *
+ *   filename - Filename to save to. The file will be placed the 'savefiles'
+ *              directory in the user's game directory.
+ *
+ *   delta - optional. If true, only what has changed since the save was
+ *           last written in full is written, which is much quicker for
+ *           frequent autosaves. Defaults to false.
+ *
+ * Return:
+ *
+ *   path - the full path the file will be saved to (so it can be displayed)
+ *
+ * Availability:
+ *
+ *   October 2026
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_game_save_game_async(lua_State *l)
+{
+	if (!Pi::game) {
+		return luaL_error(l, "can't save when no game is running");
+	}
+
+	const std::string filename(luaL_checkstring(l, 1));
+	const bool delta = lua_toboolean(l, 2);
+
+	try {
+		const std::string path = FileSystem::JoinPathBelow(SaveGameManager::GetSaveGameDirectory(), filename);
+		if (delta)
+			Lua::manager->ScheduleJob(SaveGameManager::SaveGameDeltaAsync(filename, Pi::game, onSaveGameJobFinished));
+		else
+			Lua::manager->ScheduleJob(SaveGameManager::SaveGameAsync(filename, Pi::game, onSaveGameJobFinished));
+		lua_pushlstring(l, path.c_str(), path.size());
+		return 1;
+	} catch (const CannotSaveInHyperspace &) {
+		return luaL_error(l, "%s", Lang::CANT_SAVE_IN_HYPERSPACE);
+	} catch (const CannotSaveDeadPlayer &) {
+		return luaL_error(l, "%s", Lang::CANT_SAVE_DEAD_PLAYER);
+	} catch (const std::invalid_argument &) {
+		return luaL_error(l, "%s", Lang::GAME_SAVE_INVALID_NAME);
+	}
+}
+
 /*
  * Function: DeleteSave
  *
@@ -767,6 +831,7 @@ void LuaGame::Register()
 		{ "LoadGame", l_game_load_game },
 		{ "CanLoadGame", l_game_can_load_game },
 		{ "SaveGame", l_game_save_game },
+		{ "SaveGameAsync", l_game_save_game_async },
 		{ "DeleteSave", l_game_delete_save },
 		{ "ListSaves", l_game_list_saves },
 		{ "EndGame", l_game_end_game },
@@ -0,0 +1,681 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "LuaJobs.h"
+#include "EnumStrings.h"
+#include "FileSystem.h"
+#include "Game.h"
+#include "LuaChunkCache.h"
+#include "LuaFixed.h"
+#include "LuaManager.h"
+#include "LuaObject.h"
+#include "LuaUtils.h"
+#include "LuaVector.h"
+#include "Pi.h"
+
+#include "galaxy/Factions.h"
+#include "galaxy/Galaxy.h"
+#include "galaxy/GalaxyGenerator.h"
+#include "galaxy/Sector.h"
+#include "galaxy/StarSystem.h"
+
+#include "core/Log.h"
+#include "profiler/Profiler.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace LuaJobs;
+
+namespace {
+	// deep enough for any sensible message, and stops a cyclic table
+	static const int MAX_VALUE_DEPTH = 32;
+	// instructions between checks for a cancelled job
+	static const int CANCEL_CHECK_COUNT = 10000;
+
+	static const char *NS_SCRIPTS = "PiJobScripts";
+	static const char *NS_CONTEXT = "PiJobContext";
+	// callbacks waiting for their job on the main state, by job
+	static const char *NS_CALLBACKS = "PiJobCallbacks";
+
+	// What the Galaxy functions of a worker need while a job runs in it
+	struct JobContext {
+		RefCountedPtr<Galaxy> galaxy;
+		std::map<SystemPath, RefCountedPtr<Sector>, SystemPath::LessSectorOnly> sectors;
+		const std::atomic<bool> *cancelled;
+
+		RefCountedPtr<const Sector> GetSector(const SystemPath &path)
+		{
+			auto iter = sectors.find(path);
+			if (iter == sectors.end()) {
+				// not the sector cache, that belongs to the main thread
+				RefCountedPtr<Sector> sec = galaxy->GetGenerator()->Generate<Sector, SectorCache>(galaxy, path.SectorOnly(), nullptr);
+				iter = sectors.emplace(path.SectorOnly(), sec).first;
+			}
+			return iter->second;
+		}
+	};
+
+	JobContext *GetContext(lua_State *L)
+	{
+		lua_getfield(L, LUA_REGISTRYINDEX, NS_CONTEXT);
+		JobContext *ctx = static_cast<JobContext *>(lua_touserdata(L, -1));
+		lua_pop(L, 1);
+		if (!ctx)
+			luaL_error(L, "Galaxy is only available while a job runs");
+		return ctx;
+	}
+
+	SystemPath CheckPath(lua_State *L, int index)
+	{
+		luaL_checktype(L, index, LUA_TTABLE);
+		lua_getfield(L, index, "sectorX");
+		lua_getfield(L, index, "sectorY");
+		lua_getfield(L, index, "sectorZ");
+		lua_getfield(L, index, "systemIndex");
+		lua_getfield(L, index, "bodyIndex");
+
+		SystemPath path(luaL_checkinteger(L, -5), luaL_checkinteger(L, -4), luaL_checkinteger(L, -3));
+		if (!lua_isnil(L, -2))
+			path.systemIndex = luaL_checkinteger(L, -2);
+		if (!lua_isnil(L, -1))
+			path.bodyIndex = luaL_checkinteger(L, -1);
+
+		lua_pop(L, 5);
+		return path;
+	}
+
+	const Sector::System *CheckSystem(lua_State *L, int index, RefCountedPtr<const Sector> &sec)
+	{
+		const SystemPath path = CheckPath(L, index);
+		sec = GetContext(L)->GetSector(path);
+		if (!path.HasValidSystem() || size_t(path.systemIndex) >= sec->m_systems.size())
+			luaL_error(L, "Path <%d,%d,%d : %d> does not name a system", path.sectorX, path.sectorY, path.sectorZ, path.systemIndex);
+		return &sec->m_systems[path.systemIndex];
+	}
+
+	void PushVector(lua_State *L, const vector3f &v)
+	{
+		lua_createtable(L, 0, 3);
+		lua_pushnumber(L, v.x);
+		lua_setfield(L, -2, "x");
+		lua_pushnumber(L, v.y);
+		lua_setfield(L, -2, "y");
+		lua_pushnumber(L, v.z);
+		lua_setfield(L, -2, "z");
+	}
+
+	/*
+	 * Worker function: Galaxy.GetSectorSystems
+	 *
+	 * > systems = Galaxy.GetSectorSystems(x, y, z)
+	 *
+	 * An array of the systems in the sector, each a table of path, name,
+	 * position (in light years, as an { x, y, z } table) and numStars.
+	 */
+	int l_worker_galaxy_get_sector_systems(lua_State *L)
+	{
+		const SystemPath path(luaL_checkinteger(L, 1), luaL_checkinteger(L, 2), luaL_checkinteger(L, 3));
+		RefCountedPtr<const Sector> sec = GetContext(L)->GetSector(path);
+
+		lua_createtable(L, sec->m_systems.size(), 0);
+		for (const Sector::System &sys : sec->m_systems) {
+			lua_createtable(L, 0, 4);
+			Value::PushPath(L, sys.GetPath());
+			lua_setfield(L, -2, "path");
+			lua_pushstring(L, sys.GetName().c_str());
+			lua_setfield(L, -2, "name");
+			PushVector(L, sys.GetFullPosition());
+			lua_setfield(L, -2, "position");
+			lua_pushinteger(L, sys.GetNumStars());
+			lua_setfield(L, -2, "numStars");
+			lua_rawseti(L, -2, sys.idx + 1);
+		}
+		return 1;
+	}
+
+	/*
+	 * Worker function: Galaxy.Distance
+	 *
+	 * > ly = Galaxy.Distance(pathA, pathB)
+	 *
+	 * The distance between two systems in light years.
+	 */
+	int l_worker_galaxy_distance(lua_State *L)
+	{
+		RefCountedPtr<const Sector> secA, secB;
+		const Sector::System *a = CheckSystem(L, 1, secA);
+		const Sector::System *b = CheckSystem(L, 2, secB);
+		lua_pushnumber(L, Sector::System::DistanceBetween(a, b));
+		return 1;
+	}
+
+	/*
+	 * Worker function: Galaxy.GetStarSystem
+	 *
+	 * > system = Galaxy.GetStarSystem(path)
+	 *
+	 * A summary of the system: path, name, shortDescription, numStars,
+	 * numBodies, population, agricultural, industrial, lawlessness, govType
+	 * and faction (its name, or nil).
+	 */
+	int l_worker_galaxy_get_star_system(lua_State *L)
+	{
+		RefCountedPtr<const Sector> sec;
+		const SystemPath path = CheckSystem(L, 1, sec)->GetPath();
+		JobContext *ctx = GetContext(L);
+
+		// a summary, as the star system cache jobs generate
+		RefCountedPtr<StarSystem> sys = ctx->galaxy->GetGenerator()->Generate<StarSystem, StarSystemCache>(ctx->galaxy, path, nullptr);
+
+		lua_createtable(L, 0, 11);
+		Value::PushPath(L, sys->GetPath());
+		lua_setfield(L, -2, "path");
+		lua_pushstring(L, sys->GetName().c_str());
+		lua_setfield(L, -2, "name");
+		lua_pushstring(L, sys->GetShortDescription().c_str());
+		lua_setfield(L, -2, "shortDescription");
+		lua_pushinteger(L, sys->GetNumStars());
+		lua_setfield(L, -2, "numStars");
+		lua_pushinteger(L, sys->GetNumBodies());
+		lua_setfield(L, -2, "numBodies");
+		lua_pushnumber(L, sys->GetTotalPop().ToDouble());
+		lua_setfield(L, -2, "population");
+		lua_pushnumber(L, sys->GetAgricultural().ToDouble());
+		lua_setfield(L, -2, "agricultural");
+		lua_pushnumber(L, sys->GetIndustrial().ToDouble());
+		lua_setfield(L, -2, "industrial");
+		lua_pushnumber(L, sys->GetSysPolit().lawlessness.ToDouble());
+		lua_setfield(L, -2, "lawlessness");
+		lua_pushstring(L, EnumStrings::GetString("PolitGovType", sys->GetSysPolit().govType));
+		lua_setfield(L, -2, "govType");
+		if (sys->GetFaction()) {
+			lua_pushstring(L, sys->GetFaction()->name.c_str());
+			lua_setfield(L, -2, "faction");
+		}
+		return 1;
+	}
+
+	void CancelHook(lua_State *L, lua_Debug *)
+	{
+		lua_getfield(L, LUA_REGISTRYINDEX, NS_CONTEXT);
+		const JobContext *ctx = static_cast<const JobContext *>(lua_touserdata(L, -1));
+		lua_pop(L, 1);
+		if (ctx && ctx->cancelled->load(std::memory_order_relaxed))
+			luaL_error(L, "job cancelled");
+	}
+
+	int TracebackHandler(lua_State *L)
+	{
+		luaL_traceback(L, L, lua_tostring(L, 1), 1);
+		return 1;
+	}
+
+	lua_State *CreateWorkerState()
+	{
+		lua_State *L = luaL_newstate();
+		LUA_DEBUG_START(L);
+
+		pi_lua_open_standard_base(L);
+
+		// read-only: no files, and no modules but what the script brings
+		static const char *removed[] = { LUA_IOLIBNAME, "import", "require", "package" };
+		for (const char *name : removed) {
+			lua_pushnil(L);
+			lua_setglobal(L, name);
+		}
+
+		LuaVector::Register(L);
+		LuaFixed::Register(L);
+
+		static const luaL_Reg galaxy[] = {
+			{ "GetSectorSystems", l_worker_galaxy_get_sector_systems },
+			{ "GetStarSystem", l_worker_galaxy_get_star_system },
+			{ "Distance", l_worker_galaxy_distance },
+			{ 0, 0 }
+		};
+		luaL_newlib(L, galaxy);
+		lua_setglobal(L, "Galaxy");
+
+		lua_newtable(L);
+		lua_setfield(L, LUA_REGISTRYINDEX, NS_SCRIPTS);
+
+		lua_sethook(L, CancelHook, LUA_MASKCOUNT, CANCEL_CHECK_COUNT);
+
+		LUA_DEBUG_END(L, 0);
+		return L;
+	}
+
+	// Worker states are made on the main thread, as many as there are jobs
+	// waiting to start, and reused once a job is done with one
+	class StatePool {
+	public:
+		StatePool() :
+			m_waiting(0) {}
+
+		~StatePool()
+		{
+			for (lua_State *L : m_free)
+				lua_close(L);
+		}
+
+		void Reserve()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_waiting++;
+			while (m_free.size() < m_waiting)
+				m_free.push_back(CreateWorkerState());
+		}
+
+		void Unreserve()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_waiting--;
+		}
+
+		lua_State *Acquire()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			assert(!m_free.empty());
+			m_waiting--;
+			lua_State *L = m_free.back();
+			m_free.pop_back();
+			return L;
+		}
+
+		void Release(lua_State *L)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_free.push_back(L);
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::vector<lua_State *> m_free;
+		size_t m_waiting;
+	};
+
+	static std::shared_ptr<StatePool> s_pool;
+
+	class ScriptJob : public Job {
+	public:
+		ScriptJob(std::shared_ptr<StatePool> pool, RefCountedPtr<Galaxy> galaxy, const std::string &script, Value &&input) :
+			m_pool(pool),
+			m_script(script),
+			m_input(std::move(input)),
+			m_cancelled(false),
+			m_started(false)
+		{
+			m_context.galaxy = galaxy;
+			m_context.cancelled = &m_cancelled;
+			m_pool->Reserve();
+		}
+
+		~ScriptJob()
+		{
+			if (!m_started)
+				m_pool->Unreserve();
+		}
+
+		void OnRun() override // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
+		{
+			PROFILE_SCOPED()
+			m_started = true;
+			lua_State *L = m_pool->Acquire();
+
+			if (!m_cancelled)
+				Run(L);
+
+			// the next job starts with a clean heap
+			m_context.sectors.clear();
+			lua_gc(L, LUA_GCCOLLECT, 0);
+			m_pool->Release(L);
+		}
+
+		void OnFinish() override // runs in primary thread of the context
+		{
+			lua_State *l = Lua::manager->GetLuaState();
+			LUA_DEBUG_START(l);
+
+			lua_getfield(l, LUA_REGISTRYINDEX, NS_CALLBACKS);
+			lua_rawgetp(l, -1, this);
+			lua_pushnil(l);
+			lua_rawsetp(l, -3, this);
+			lua_remove(l, -2);
+
+			if (m_error.empty()) {
+				m_result.Push(l, true);
+				lua_pushnil(l);
+			} else {
+				Log::Warning("Lua job '{}': {}\n", m_script, m_error);
+				lua_pushnil(l);
+				lua_pushstring(l, m_error.c_str());
+			}
+			pi_lua_protected_call(l, 2, 0);
+
+			LUA_DEBUG_END(l, 0);
+		}
+
+		// the callback is left in the registry: this is only called when
+		// the job queue is shut down, possibly after the main state
+		void OnCancel() override { m_cancelled = true; }
+
+	private:
+		// Leaves the script's function on the stack, loading it into this
+		// state the first time
+		bool PushScript(lua_State *L)
+		{
+			lua_getfield(L, LUA_REGISTRYINDEX, NS_SCRIPTS);
+			lua_getfield(L, -1, m_script.c_str());
+			if (lua_isfunction(L, -1)) {
+				lua_remove(L, -2);
+				return true;
+			}
+			lua_pop(L, 1);
+
+			RefCountedPtr<FileSystem::FileData> code = FileSystem::gameDataFiles.ReadFile(m_script);
+			if (!code) {
+				lua_pop(L, 1);
+				m_error = "could not read " + m_script;
+				return false;
+			}
+
+			const StringRange source = code->AsStringRange().StripUTF8BOM();
+			const std::string chunkName = LuaChunkCache::ChunkName(code->GetInfo());
+			if (luaL_loadbuffer(L, source.begin, source.Size(), chunkName.c_str()) != LUA_OK) {
+				m_error = lua_tostring(L, -1);
+				lua_pop(L, 2);
+				return false;
+			}
+
+			// the script gets its own globals, backed by the worker's
+			lua_newtable(L);
+			lua_newtable(L);
+			lua_getglobal(L, "_G");
+			lua_setfield(L, -2, "__index");
+			lua_setmetatable(L, -2);
+			lua_setupvalue(L, -2, 1);
+
+			lua_pushcfunction(L, TracebackHandler);
+			lua_insert(L, -2);
+			const int ret = lua_pcall(L, 0, 1, -2);
+			lua_remove(L, -2);
+			if (ret != LUA_OK) {
+				m_error = lua_tostring(L, -1);
+				lua_pop(L, 2);
+				return false;
+			}
+			if (!lua_isfunction(L, -1)) {
+				m_error = m_script + " did not return a function";
+				lua_pop(L, 2);
+				return false;
+			}
+
+			lua_pushvalue(L, -1);
+			lua_setfield(L, -3, m_script.c_str());
+			lua_remove(L, -2);
+			return true;
+		}
+
+		void Run(lua_State *L)
+		{
+			LUA_DEBUG_START(L);
+
+			if (!PushScript(L)) {
+				LUA_DEBUG_END(L, 0);
+				return;
+			}
+
+			lua_pushlightuserdata(L, &m_context);
+			lua_setfield(L, LUA_REGISTRYINDEX, NS_CONTEXT);
+
+			lua_pushcfunction(L, TracebackHandler);
+			lua_insert(L, -2);
+			m_input.Push(L, false);
+
+			if (lua_pcall(L, 1, 1, -3) != LUA_OK)
+				m_error = lua_tostring(L, -1);
+			else if (!Value::Pull(L, -1, false, m_result, m_error))
+				m_error = "result " + m_error;
+			lua_pop(L, 2);
+
+			lua_pushnil(L);
+			lua_setfield(L, LUA_REGISTRYINDEX, NS_CONTEXT);
+
+			LUA_DEBUG_END(L, 0);
+		}
+
+		std::shared_ptr<StatePool> m_pool;
+		JobContext m_context;
+		std::string m_script;
+		Value m_input;
+		std::atomic<bool> m_cancelled;
+		std::atomic<bool> m_started;
+
+		Value m_result;
+		std::string m_error;
+	};
+} // namespace
+
+bool Value::Pull(lua_State *l, int index, bool mainState, Value &out, std::string &error)
+{
+	return Pull(l, index, mainState, out, error, 0);
+}
+
+bool Value::Pull(lua_State *l, int index, bool mainState, Value &out, std::string &error, int depth)
+{
+	index = lua_absindex(l, index);
+
+	switch (lua_type(l, index)) {
+	case LUA_TNIL:
+		out.m_type = NIL;
+		return true;
+
+	case LUA_TBOOLEAN:
+		out.m_type = BOOLEAN;
+		out.m_number = lua_toboolean(l, index);
+		return true;
+
+	case LUA_TNUMBER:
+		out.m_type = NUMBER;
+		out.m_number = lua_tonumber(l, index);
+		return true;
+
+	case LUA_TSTRING: {
+		size_t len;
+		const char *str = lua_tolstring(l, index, &len);
+		out.m_type = STRING;
+		out.m_string.assign(str, len);
+		return true;
+	}
+
+	case LUA_TUSERDATA:
+		if (mainState) {
+			if (SystemPath *path = LuaObject<SystemPath>::GetFromLua(index)) {
+				out.m_type = PATH;
+				out.m_path = *path;
+				return true;
+			}
+		}
+		break;
+
+	case LUA_TTABLE: {
+		if (depth >= MAX_VALUE_DEPTH) {
+			error = "tables nested too deeply (or cyclic)";
+			return false;
+		}
+		if (!lua_checkstack(l, 3)) {
+			error = "out of stack space";
+			return false;
+		}
+
+		out.m_type = TABLE;
+		out.m_table.clear();
+
+		lua_pushnil(l);
+		while (lua_next(l, index)) {
+			out.m_table.emplace_back();
+			if (!Pull(l, -2, mainState, out.m_table.back().first, error, depth + 1) ||
+				!Pull(l, -1, mainState, out.m_table.back().second, error, depth + 1)) {
+				lua_pop(l, 2);
+				return false;
+			}
+			lua_pop(l, 1);
+		}
+		return true;
+	}
+
+	default:
+		break;
+	}
+
+	error = std::string("can't copy a ") + luaL_typename(l, index) + " value into another Lua state";
+	return false;
+}
+
+void Value::Push(lua_State *l, bool mainState) const
+{
+	switch (m_type) {
+	case NIL: lua_pushnil(l); break;
+	case BOOLEAN: lua_pushboolean(l, m_number != 0.0); break;
+	case NUMBER: lua_pushnumber(l, m_number); break;
+	case STRING: lua_pushlstring(l, m_string.data(), m_string.size()); break;
+
+	case PATH:
+		if (mainState)
+			pi_lua_generic_push(l, m_path);
+		else
+			PushPath(l, m_path);
+		break;
+
+	case TABLE:
+		luaL_checkstack(l, 3, "copying a value");
+		lua_newtable(l);
+		for (const auto &pair : m_table) {
+			pair.first.Push(l, mainState);
+			pair.second.Push(l, mainState);
+			lua_rawset(l, -3);
+		}
+		break;
+	}
+}
+
+void Value::PushPath(lua_State *l, const SystemPath &path)
+{
+	lua_createtable(l, 0, 5);
+	lua_pushinteger(l, path.sectorX);
+	lua_setfield(l, -2, "sectorX");
+	lua_pushinteger(l, path.sectorY);
+	lua_setfield(l, -2, "sectorY");
+	lua_pushinteger(l, path.sectorZ);
+	lua_setfield(l, -2, "sectorZ");
+	if (path.HasValidSystem()) {
+		lua_pushinteger(l, path.systemIndex);
+		lua_setfield(l, -2, "systemIndex");
+	}
+	if (path.HasValidBody()) {
+		lua_pushinteger(l, path.bodyIndex);
+		lua_setfield(l, -2, "bodyIndex");
+	}
+}
+
+/*
+ * Interface: Jobs
+ *
+ * Run Lua scripts off the main thread.
+ */
+
+/*
+ * Function: Run
+ *
+ * Run a worker script on the job queue.
+ *
+ * > Jobs.Run(script, input, callback)
+ *
+ * The script is a game data file returning a function, which is called with
+ * a copy of input in a worker Lua state. Workers have the standard library,
+ * vector, fixed and a Galaxy table:
+ *
+ * > Galaxy.GetSectorSystems(x, y, z)
+ * > Galaxy.GetStarSystem(path)
+ * > Galaxy.Distance(pathA, pathB)
+ *
+ * where paths are plain tables with SystemPath's fields. Nothing else of the
+ * game can be reached from a worker.
+ *
+ * Example:
+ *
+ * > Jobs.Run("modules/TradeRoutes/Scan.lua", { from = Game.system.path },
+ * >     function (result, err) ... end)
+ *
+ * Parameters:
+ *
+ *   script - path of the worker script
+ *   input - nil, a boolean, number, string, SystemPath or table of those,
+ *           copied into the worker
+ *   callback - called on the main thread with a copy of what the script
+ *              returned, or with nil and an error message if it failed.
+ *              SystemPaths in the input arrive as SystemPath objects again;
+ *              paths made by a worker are tables.
+ *
+ * Availability:
+ *
+ *   2024
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_jobs_run(lua_State *l)
+{
+	const std::string script = luaL_checkstring(l, 1);
+	luaL_checktype(l, 3, LUA_TFUNCTION);
+
+	if (!Pi::game)
+		return luaL_error(l, "Jobs.Run needs a game");
+
+	Value input;
+	std::string error;
+	if (!Value::Pull(l, 2, true, input, error))
+		return luaL_error(l, "Jobs.Run input: %s", error.c_str());
+
+	if (!s_pool)
+		s_pool = std::make_shared<StatePool>();
+
+	ScriptJob *job = new ScriptJob(s_pool, Pi::game->GetGalaxy(), script, std::move(input));
+
+	luaL_getsubtable(l, LUA_REGISTRYINDEX, NS_CALLBACKS);
+	lua_pushvalue(l, 3);
+	lua_rawsetp(l, -2, job);
+	lua_pop(l, 1);
+
+	Lua::manager->ScheduleJob(job);
+	return 0;
+}
+
+void LuaJobs::Register()
+{
+	lua_State *l = Lua::manager->GetLuaState();
+
+	LUA_DEBUG_START(l);
+
+	static const luaL_Reg methods[] = {
+		{ "Run", l_jobs_run },
+		{ 0, 0 }
+	};
+
+	lua_getfield(l, LUA_REGISTRYINDEX, "CoreImports");
+	luaL_newlib(l, methods);
+	lua_setfield(l, -2, "Jobs");
+	lua_pop(l, 1);
+
+	LUA_DEBUG_END(l, 0);
+}
+
+void LuaJobs::Uninit()
+{
+	// jobs still running keep the pool until they are done with it
+	s_pool.reset();
+}
@@ -0,0 +1,73 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _LUAJOBS_H
+#define _LUAJOBS_H
+
+#include "galaxy/SystemPath.h"
+
+#include <lua.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Lua scripts run on the async job queue, for heavy computation such as
+// scanning many systems for mission targets, that would otherwise block the
+// frame.
+//
+// A job runs in one of a pool of worker lua_States, each separate from the
+// main state and from each other. A worker has the sandboxed standard
+// library, vector and fixed, and a read-only Galaxy table for sector and
+// star system queries; nothing that touches the game. Its input and result
+// are copied between the states, and the result is handed to a callback on
+// the main state.
+namespace LuaJobs {
+
+	void Register();
+	void Uninit();
+
+	// A Lua value copied out of one state to be pushed into another: nil,
+	// booleans, numbers, strings, SystemPaths, and tables of those
+	class Value {
+	public:
+		enum Type {
+			NIL,
+			BOOLEAN,
+			NUMBER,
+			STRING,
+			PATH,
+			TABLE
+		};
+
+		Value() :
+			m_type(NIL),
+			m_number(0.0) {}
+
+		// Copy the value at index, or return false with the reason in error.
+		// SystemPath objects are only recognised on the main state; a worker
+		// has them as plain tables.
+		static bool Pull(lua_State *l, int index, bool mainState, Value &out, std::string &error);
+
+		// Paths are pushed as SystemPath objects on the main state and as
+		// { sectorX, sectorY, sectorZ, systemIndex, bodyIndex } tables on a
+		// worker
+		void Push(lua_State *l, bool mainState) const;
+
+		// A path as a worker has it
+		static void PushPath(lua_State *l, const SystemPath &path);
+
+		Type GetType() const { return m_type; }
+
+	private:
+		static bool Pull(lua_State *l, int index, bool mainState, Value &out, std::string &error, int depth);
+
+		Type m_type;
+		double m_number; // also the boolean
+		std::string m_string;
+		SystemPath m_path;
+		std::vector<std::pair<Value, Value>> m_table;
+	};
+
+} // namespace LuaJobs
+
+#endif
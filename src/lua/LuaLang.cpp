@@ -65,16 +65,19 @@ static int l_lang_get_resource(lua_State *l)
 	}
 	lua_pop(l, 1);
 
-	lua_newtable(l);
 	Lang::Resource &res = Lang::GetResource(resourceName, langCode);
 	if (res.Load()) {
-		for (auto i : res.GetStrings()) {
-			const std::string token(i.first);
-			const std::string text(i.second.empty() ? token : i.second);
-			lua_pushlstring(l, text.c_str(), text.size());
-			lua_setfield(l, -2, token.c_str());
+		const Uint32 numStrings = res.GetNumStrings();
+		lua_createtable(l, 0, numStrings + 1);
+		for (Uint32 i = 0; i < numStrings; i++) {
+			// the table's strings are NUL-terminated
+			const std::string_view token = res.GetToken(i);
+			const std::string_view text = res.GetString(i);
+			lua_pushlstring(l, text.data(), text.size());
+			lua_setfield(l, -2, token.data());
 		}
 	} else {
+		lua_newtable(l);
 		Log::Warning("Translation module {0} not found! This should be in data/lang/{0}/{1}.json. Returning dummy resource.\n",
 			resourceName, langCode);
 	}
@@ -3,21 +3,49 @@
 
 #include "LuaManager.h"
 #include "FileSystem.h"
+#include "profiler/Profiler.h"
 #include "utils.h"
 
+#include <algorithm>
 #include <cstdlib>
 
 bool instantiated = false;
 
+namespace {
+	// a new cycle is started once the heap has doubled since the last one,
+	// as Lua's own default pause would
+	static const double GC_PAUSE = 2.0;
+	// past this the rest of the cycle is run at once, budget or not
+	static const double GC_HARD_LIMIT = 4.0;
+	static const double GC_MAX_BUDGET_SCALE = 8.0;
+	// small heaps aren't worth a cycle every few frames
+	static const size_t GC_MIN_LIVE_HEAP_KB = 1024;
+	// steps small enough for the budget to be checked often
+	static const size_t GC_MIN_STEP_KB = 16;
+	static const size_t GC_MAX_STEP_KB = 512;
+	static const size_t GC_STEPS_PER_FRAME = 8;
+} // namespace
+
 LuaManager::LuaManager(JobQueue *asyncJobQueue) :
-	m_lua(0), m_jobs(asyncJobQueue)
+	m_lua(0), m_jobs(asyncJobQueue),
+	m_gcBudgetMs(0.f),
+	m_gcCycleActive(false),
+	m_gcLastHeapKB(0),
+	m_gcLiveHeapKB(0),
+	m_gcStepsCounter(m_gcStats.GetOrCreateCounter("GC steps")),
+	m_gcStepTimeCounter(m_gcStats.GetOrCreateCounter("GC step time (us)")),
+	m_gcCyclesCounter(m_gcStats.GetOrCreateCounter("GC cycles", false)),
+	m_gcOverrunsCounter(m_gcStats.GetOrCreateCounter("GC budget overruns", false)),
+	m_gcHeapCounter(m_gcStats.GetOrCreateCounter("Heap (KB)", false)),
+	m_gcLiveHeapCounter(m_gcStats.GetOrCreateCounter("Heap after last cycle (KB)", false))
 {
 	if (instantiated) {
 		Output("Can't instantiate more than one LuaManager");
 		abort();
 	}
 
-	m_lua = luaL_newstate();
+	// the profiler's allocator is a plain realloc until it's started
+	m_lua = lua_newstate(&LuaProfiler::Alloc, &m_profiler);
 	pi_lua_open_standard_base(m_lua);
 	lua_atpanic(m_lua, pi_lua_panic);
 
@@ -50,6 +78,81 @@ size_t LuaManager::GetMemoryUsage() const
 void LuaManager::CollectGarbage()
 {
 	lua_gc(m_lua, LUA_GCCOLLECT, 0);
+
+	// a full collection also ends any cycle in progress
+	m_gcCycleActive = false;
+	m_gcLiveHeapKB = m_gcLastHeapKB = lua_gc(m_lua, LUA_GCCOUNT, 0);
+	m_gcStats.CounterAdd(m_gcCyclesCounter);
+	m_gcStats.CounterSet(m_gcLiveHeapCounter, m_gcLiveHeapKB);
+}
+
+void LuaManager::SetGCFrameBudget(float ms)
+{
+	m_gcBudgetMs = std::max(ms, 0.f);
+
+	// Lua's own pacing steps the collector from whichever allocation brings
+	// the heap over its threshold, so a long step or a cycle's atomic phase
+	// can land in the middle of anything. With it stopped, only the frame
+	// driver collects, apart from the emergency collection Lua still runs
+	// when an allocation fails.
+	if (m_gcBudgetMs > 0.f) {
+		lua_gc(m_lua, LUA_GCSTOP, 0);
+		m_gcLastHeapKB = lua_gc(m_lua, LUA_GCCOUNT, 0);
+		m_gcLiveHeapKB = std::max(m_gcLiveHeapKB, m_gcLastHeapKB);
+	} else {
+		lua_gc(m_lua, LUA_GCRESTART, 0);
+	}
+}
+
+void LuaManager::StepGarbageCollector()
+{
+	PROFILE_SCOPED()
+
+	if (m_gcBudgetMs <= 0.f)
+		return;
+
+	const size_t heapKB = lua_gc(m_lua, LUA_GCCOUNT, 0);
+	const size_t growthKB = heapKB > m_gcLastHeapKB ? heapKB - m_gcLastHeapKB : 0;
+	const size_t liveKB = std::max(m_gcLiveHeapKB, GC_MIN_LIVE_HEAP_KB);
+	const double pressure = double(heapKB) / (double(liveKB) * GC_PAUSE);
+	m_gcStats.CounterSet(m_gcHeapCounter, heapKB);
+
+	if (!m_gcCycleActive && pressure < 1.0) {
+		m_gcLastHeapKB = heapKB;
+		return;
+	}
+	m_gcCycleActive = true;
+
+	// a few steps cover twice what was allocated over the last frame, so the
+	// cycle gains on the heap, and the budget stretches the further behind
+	// it is
+	const int stepKB = int(std::clamp(growthKB * 2 / GC_STEPS_PER_FRAME, GC_MIN_STEP_KB, GC_MAX_STEP_KB));
+	const bool finish = heapKB > liveKB * GC_HARD_LIMIT;
+	const double budgetMs = m_gcBudgetMs * std::clamp(pressure, 1.0, GC_MAX_BUDGET_SCALE);
+
+	Profiler::Clock clock;
+	clock.Start();
+	Uint32 steps = 0;
+	do {
+		steps++;
+		if (lua_gc(m_lua, LUA_GCSTEP, stepKB)) {
+			m_gcCycleActive = false;
+			m_gcLiveHeapKB = lua_gc(m_lua, LUA_GCCOUNT, 0);
+			m_gcStats.CounterAdd(m_gcCyclesCounter);
+			m_gcStats.CounterSet(m_gcLiveHeapCounter, m_gcLiveHeapKB);
+			break;
+		}
+		clock.SoftStop();
+	} while (finish || clock.milliseconds() < budgetMs);
+	clock.Stop();
+
+	// a single step can take longer than allowed, and a forced finish does
+	if (clock.milliseconds() > budgetMs)
+		m_gcStats.CounterAdd(m_gcOverrunsCounter);
+	m_gcStats.CounterAdd(m_gcStepsCounter, steps);
+	m_gcStats.CounterAdd(m_gcStepTimeCounter, Uint32(clock.milliseconds() * 1000.0));
+
+	m_gcLastHeapKB = lua_gc(m_lua, LUA_GCCOUNT, 0);
 }
 
 void LuaManager::ScheduleJob(Job *job)
@@ -5,7 +5,9 @@
 #define _LUAMANAGER_H
 
 #include "JobQueue.h"
+#include "LuaProfiler.h"
 #include "LuaUtils.h"
+#include "PerfStats.h"
 
 class LuaManager {
 public:
@@ -17,9 +19,24 @@ public:
 	~LuaManager();
 
 	lua_State *GetLuaState() { return m_lua; }
+	LuaProfiler &GetProfiler() { return m_profiler; }
 	size_t GetMemoryUsage() const;
 	void CollectGarbage();
 
+	// Give the collector up to ms milliseconds of each frame, run from
+	// StepGarbageCollector(), in place of its own pacing. Zero hands the
+	// collector back to Lua.
+	void SetGCFrameBudget(float ms);
+	float GetGCFrameBudget() const { return m_gcBudgetMs; }
+
+	// Run the collector for the frame, once the frame's work is done. The
+	// budget grows when the heap outgrows what the collector keeps up with,
+	// and a cycle is finished outright if the heap gets far enough ahead.
+	void StepGarbageCollector();
+
+	// Counters for the collector, updated by StepGarbageCollector()
+	Perf::Stats &GetGCStats() { return m_gcStats; }
+
 	// Schedule a job to be run on the LuaManager job queue
 	void ScheduleJob(Job *job);
 
@@ -27,8 +44,22 @@ private:
 	LuaManager(const LuaManager &);
 	LuaManager &operator=(const LuaManager &) = delete;
 
+	LuaProfiler m_profiler;
 	lua_State *m_lua;
 	JobSet m_jobs;
+
+	float m_gcBudgetMs;
+	bool m_gcCycleActive;
+	size_t m_gcLastHeapKB;
+	size_t m_gcLiveHeapKB; // after the last complete cycle
+
+	Perf::Stats m_gcStats;
+	Perf::Stats::CounterRef m_gcStepsCounter;
+	Perf::Stats::CounterRef m_gcStepTimeCounter;
+	Perf::Stats::CounterRef m_gcCyclesCounter;
+	Perf::Stats::CounterRef m_gcOverrunsCounter;
+	Perf::Stats::CounterRef m_gcHeapCounter;
+	Perf::Stats::CounterRef m_gcLiveHeapCounter;
 };
 
 #endif
@@ -9,19 +9,30 @@
 
 #include "utils.h"
 
-// if found, returns true, leaves item to return to lua on top of stack
-// if not found, returns false
-static bool get_method(lua_State *l, int metatable, int name)
+// l_index and l_newindex are closures over the metatype registry and the
+// names of the metatable fields they read, which saves looking the registry
+// up and hashing the names again on every access from Lua
+enum MetaTypeUpvalue {
+	UPVALUE_REGISTRY = 1,
+	UPVALUE_METHODS,
+	UPVALUE_ATTRS,
+	UPVALUE_PARENT,
+	UPVALUE_COUNT = UPVALUE_PARENT
+};
+
+// look name up in one of the metatable's tables (methods or attrs)
+static bool get_entry(lua_State *l, int metatable, int name, int table)
 {
 	LUA_DEBUG_START(l);
 
+	metatable = lua_absindex(l, metatable);
 	name = lua_absindex(l, name);
 
-	// look up the name in the list of methods.
-	lua_getfield(l, metatable, "methods");
+	lua_pushvalue(l, lua_upvalueindex(table));
+	lua_rawget(l, metatable);
 	lua_pushvalue(l, name); // make a copy of the name
-	lua_rawget(l, -2);		// look it up in the methods table
-	lua_remove(l, -2);		// remove the methods table
+	lua_rawget(l, -2);		// look it up in the table
+	lua_remove(l, -2);		// remove the table
 
 	// found something, return it
 	if (!lua_isnil(l, -1)) {
@@ -35,30 +46,40 @@ static bool get_method(lua_State *l, int metatable, int name)
 	return false;
 }
 
-// if found, returns true, leaves attribute entry on top of stack
+// if found, returns true, leaves item to return to lua on top of stack
 // if not found, returns false
-static bool get_attr_entry(lua_State *l, int metatable, int name)
+static bool get_method(lua_State *l, int metatable, int name)
 {
-	LUA_DEBUG_START(l);
-
-	name = lua_absindex(l, name);
+	return get_entry(l, metatable, name, UPVALUE_METHODS);
+}
 
-	// lookup the name in the list of attributes
-	lua_getfield(l, metatable, "attrs");
-	lua_pushvalue(l, name); // make a copy of the name
-	lua_rawget(l, -2);		// look it up in the methods table
-	lua_remove(l, -2);		// remove the attributes table
+// if found, returns true, leaves attribute entry on top of stack, without
+// evaluating it
+// if not found, returns false
+static bool get_attr_entry(lua_State *l, int metatable, int name)
+{
+	return get_entry(l, metatable, name, UPVALUE_ATTRS);
+}
 
-	// found an attribute entry, don't evaluate
-	if (!lua_isnil(l, -1)) {
-		LUA_DEBUG_END(l, 1);
-		return true;
+// replace the metatable on top of the stack with its parent's, returning
+// false and leaving the stack as it was if it has no parent
+static bool get_parent(lua_State *l)
+{
+	lua_pushvalue(l, lua_upvalueindex(UPVALUE_PARENT));
+	lua_rawget(l, -2);
+	if (lua_isnil(l, -1)) {
+		lua_pop(l, 1);
+		return false;
 	}
-	lua_pop(l, 1);
 
-	// not found
-	LUA_DEBUG_END(l, 0);
-	return false;
+	lua_pushvalue(l, -1);
+	lua_rawget(l, lua_upvalueindex(UPVALUE_REGISTRY));
+	if (lua_isnil(l, -1))
+		luaL_error(l, "Encountered invalid parent metatype name %s", lua_tostring(l, -2));
+
+	lua_remove(l, -2); // the parent's name
+	lua_replace(l, -2);
+	return true;
 }
 
 // takes the metatable, name on top of stack
@@ -123,10 +144,6 @@ static int l_index(lua_State *l)
 		}
 	}
 
-	// push the metatype registry here for later
-	lua_getfield(l, LUA_REGISTRYINDEX, "LuaMetaTypes");
-	int metaTypeRegistry = lua_gettop(l);
-
 	// push metatable, name onto the top of the stack
 	lua_getmetatable(l, 1);
 	lua_pushvalue(l, 2);
@@ -140,18 +157,10 @@ static int l_index(lua_State *l)
 		}
 
 		// if there's no parent metatable, get out
-		lua_getfield(l, -2, "parent");
-		if (lua_isnil(l, -1))
+		lua_pop(l, 1); // the name
+		if (!get_parent(l))
 			break;
-
-		std::string parentName = lua_tostring(l, -1);
-		lua_pop(l, 1); // pop the parent name
-
-		lua_getfield(l, metaTypeRegistry, parentName.c_str());
-		if (lua_isnil(l, -1))
-			return luaL_error(l, "Encountered invalid parent metatype name %s", parentName.c_str());
-
-		lua_replace(l, -3); // replace the metatable with the parent
+		lua_pushvalue(l, 2);
 	}
 
 	return 0;
@@ -188,10 +197,6 @@ static int l_newindex(lua_State *l)
 		}
 	}
 
-	// push the metatype registry here for later
-	lua_getfield(l, LUA_REGISTRYINDEX, "LuaMetaTypes");
-	int metaTypeRegistry = lua_gettop(l);
-
 	// Check the metatable for attributes
 	lua_getmetatable(l, 1); // get the metatable
 	while (true) {
@@ -208,18 +213,9 @@ static int l_newindex(lua_State *l)
 			lua_pop(l, 1);
 		}
 
-		lua_getfield(l, -1, "parent"); // get the parent field from the metatable
-		if (lua_isnil(l, -1))		   // hit the end of the chain, nothing here
+		// hit the end of the chain, nothing here
+		if (!get_parent(l))
 			break;
-
-		std::string parentName = lua_tostring(l, -1);
-		lua_pop(l, 1);
-
-		lua_getfield(l, metaTypeRegistry, parentName.c_str());
-		if (lua_isnil(l, -1))
-			return luaL_error(l, "Encountered invalid parent metatype name %s", parentName.c_str());
-
-		lua_remove(l, -2); // replace the metatable with the parent
 	}
 
 	return luaL_error(l, "Attempt to set undefined property %s on %s", lua_tostring(l, 2), lua_tostring(l, 1));
@@ -422,6 +418,16 @@ void *LuaMetaTypeBase::CheckUserdata(lua_State *l, int index, const char *type)
 	return p;
 }
 
+// push the upvalues l_index and l_newindex expect, given the registry
+static void push_upvalues(lua_State *l, int registry)
+{
+	registry = lua_absindex(l, registry);
+	lua_pushvalue(l, registry);
+	lua_pushstring(l, "methods");
+	lua_pushstring(l, "attrs");
+	lua_pushstring(l, "parent");
+}
+
 void LuaMetaTypeBase::CreateMetaType(lua_State *l, bool pushToStack)
 {
 	luaL_getsubtable(l, LUA_REGISTRYINDEX, "LuaMetaTypes");
@@ -468,10 +474,12 @@ void LuaMetaTypeBase::CreateMetaType(lua_State *l, bool pushToStack)
 	lua_setmetatable(l, -2);
 	lua_setfield(l, -2, "methods");
 
-	lua_pushcclosure(l, &l_index, 0);
+	push_upvalues(l, -2);
+	lua_pushcclosure(l, &l_index, UPVALUE_COUNT);
 	lua_setfield(l, -2, "__index");
 
-	lua_pushcclosure(l, &l_newindex, 0);
+	push_upvalues(l, -2);
+	lua_pushcclosure(l, &l_newindex, UPVALUE_COUNT);
 	lua_setfield(l, -2, "__newindex");
 
 	// replace the LuaMetaTypes registry table, leaving the created metatype on the stack
@@ -84,6 +84,35 @@ static int l_music_play(lua_State *l)
 	return 0;
 }
 
+/*
+ * Method: Prefetch
+ *
+ * Start decoding a song in the background, so that a later call to Play or
+ * FadeIn can start it without a gap. Useful for the next song of a playlist.
+ *
+ * Example:
+ *
+ * > Music.Prefetch("action/track02")
+ *
+ * Parameters:
+ *
+ *   name - song file name, without data/music/ or file extension
+ *
+ * Availability:
+ *
+ *   2024
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_music_prefetch(lua_State *l)
+{
+	const std::string song(luaL_checkstring(l, 1));
+	Pi::GetMusicPlayer().Prefetch(song);
+	return 0;
+}
+
 /*
  * Method: Stop
  *
@@ -240,6 +269,7 @@ void LuaMusic::Register()
 		{ "GetSongName", l_music_get_song },
 		{ "GetSongList", l_music_get_song_list },
 		{ "Play", l_music_play },
+		{ "Prefetch", l_music_prefetch },
 		{ "Stop", l_music_stop },
 		{ "FadeIn", l_music_fade_in },
 		{ "FadeOut", l_music_fade_out },
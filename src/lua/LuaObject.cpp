@@ -315,23 +315,51 @@ void LuaObjectBase::CreateObject(const luaL_Reg *methods, const luaL_Reg *attrs,
 	LUA_DEBUG_END(l, 1);
 }
 
+// The object registries are found by the address of these keys rather than
+// by name, as objects are pushed far too often to hash a name every time.
+static const char s_objectRegistryKey = 0;
+static const char s_persistentRegistryKey = 0;
+
+// push the registry mapping objects to their userdata, creating it if need be
+static void push_object_registry(lua_State *l)
+{
+	lua_rawgetp(l, LUA_REGISTRYINDEX, &s_objectRegistryKey);
+	if (lua_istable(l, -1))
+		return;
+	lua_pop(l, 1);
+
+	// configure the registry to use weak values
+	lua_newtable(l);
+	lua_newtable(l);
+	lua_pushstring(l, "v");
+	lua_setfield(l, -2, "__mode");
+	lua_setmetatable(l, -2);
+
+	lua_pushvalue(l, -1);
+	lua_rawsetp(l, LUA_REGISTRYINDEX, &s_objectRegistryKey);
+}
+
+// The persistent object registry - values stored in here have lifetimes
+// controlled by C++ and should not have their handles deleted by the Lua GC.
+static void push_persistent_registry(lua_State *l)
+{
+	lua_rawgetp(l, LUA_REGISTRYINDEX, &s_persistentRegistryKey);
+	if (lua_istable(l, -1))
+		return;
+	lua_pop(l, 1);
+
+	lua_newtable(l);
+	lua_pushvalue(l, -1);
+	lua_rawsetp(l, LUA_REGISTRYINDEX, &s_persistentRegistryKey);
+}
+
 static void initialize_object_registry(lua_State *l)
 {
-	// create the object registry if it doesn't already exist. this is the
+	// create the object registries if they don't already exist. this is the
 	// best place we have to do this since classes will always be registered
 	// before any objects actually turn up
-	if (!luaL_getsubtable(l, LUA_REGISTRYINDEX, "LuaObjectRegistry")) {
-		// configure the registry to use weak values
-		lua_newtable(l);
-		lua_pushstring(l, "v");
-		lua_setfield(l, -2, "__mode");
-		lua_setmetatable(l, -2);
-	}
-
-	// Create the persistent object registry - values stored in here have
-	// lifetimes controlled by C++ and should not have their handles deleted
-	// by the Lua GC.
-	luaL_getsubtable(l, LUA_REGISTRYINDEX, "LuaObjectPersistentRegistry");
+	push_object_registry(l);
+	push_persistent_registry(l);
 	lua_pop(l, 2);
 }
 
@@ -454,11 +482,8 @@ bool LuaObjectBase::PushRegistered(LuaWrappable *o)
 		return true;
 	}
 
-	lua_getfield(l, LUA_REGISTRYINDEX, "LuaObjectRegistry");
-	assert(lua_istable(l, -1));
-
-	lua_pushlightuserdata(l, o);
-	lua_gettable(l, -2);
+	push_object_registry(l);
+	lua_rawgetp(l, -1, o);
 
 	if (lua_isuserdata(l, -1)) {
 		lua_insert(l, -2);
@@ -508,12 +533,9 @@ void LuaObjectBase::Register(LuaObjectBase *lo)
 
 	LUA_DEBUG_START(l); // lo userdata
 
-	lua_getfield(l, LUA_REGISTRYINDEX, "LuaObjectRegistry"); // lo userdata, registry table
-	assert(lua_istable(l, -1));
-
-	lua_pushlightuserdata(l, lo->GetObject()); // lo userdata, registry table, o lightuserdata
-	lua_pushvalue(l, -3);					   // lo userdata, registry table, o lightuserdata, lo userdata
-	lua_settable(l, -3);					   // lo userdata, registry table
+	push_object_registry(l);			 // lo userdata, registry table
+	lua_pushvalue(l, -2);				 // lo userdata, registry table, lo userdata
+	lua_rawsetp(l, -2, lo->GetObject()); // lo userdata, registry table
 
 	lua_pop(l, 1); // lo userdata
 
@@ -568,10 +590,9 @@ void LuaObjectBase::RegisterPersistent(LuaObjectBase *lo)
 	Register(lo);
 
 	// Register the userdata object in the persistent registry to avoid it being garbage-collected
-	luaL_getsubtable(l, LUA_REGISTRYINDEX, "LuaObjectPersistentRegistry");
-	lua_pushlightuserdata(l, lo->GetObject()); // lo userdata, registry, o lightuserdata
-	lua_pushvalue(l, -3);
-	lua_settable(l, -3);
+	push_persistent_registry(l); // lo userdata, registry
+	lua_pushvalue(l, -2);
+	lua_rawsetp(l, -2, lo->GetObject());
 
 	lua_pop(l, 1);
 
@@ -585,19 +606,17 @@ void LuaObjectBase::DeregisterObject(LuaWrappable *o)
 
 	// Remove the object from the transient registry in case the object address
 	// is reused by the allocator.
-	luaL_getsubtable(l, LUA_REGISTRYINDEX, "LuaObjectRegistry");
+	push_object_registry(l);
 
-	lua_pushlightuserdata(l, o);
 	lua_pushnil(l);
-	lua_rawset(l, -3);
+	lua_rawsetp(l, -2, o);
 	lua_pop(l, 1);
 
 	// Remove the object from the persistent registry as well
-	luaL_getsubtable(l, LUA_REGISTRYINDEX, "LuaObjectPersistentRegistry");
+	push_persistent_registry(l);
 
 	// Retrieve the full userdata object from the registry
-	lua_pushlightuserdata(l, o);
-	lua_rawget(l, -2);
+	lua_rawgetp(l, -1, o);
 
 	if (lua_isuserdata(l, -1)) {
 		// Clear the LuaObject's underlying reference and convert it into an orphan LuaObject
@@ -643,7 +662,7 @@ LuaWrappable *LuaObjectBase::CheckFromLua(int index, const char *type)
 		return 0;
 	}
 
-	if (!lo->Isa(type))
+	if (!lo->IsaStatic(type))
 		luaL_error(l, "Object on stack has type %s which can not be used as type %s\n", lo->m_type, type);
 
 	// found it
@@ -663,26 +682,24 @@ LuaWrappable *LuaObjectBase::GetFromLua(int index, const char *type)
 	if (!o)
 		return 0;
 
-	if (!lo->Isa(type))
+	if (!lo->IsaStatic(type))
 		return 0;
 
 	// found it
 	return o;
 }
 
-bool LuaObjectBase::Isa(const char *base) const
+// walk type's ancestry looking for base. known is set unless the walk
+// stopped at a type that hasn't been registered (yet)
+static bool isa_walk(lua_State *l, const char *type, const char *base, bool &known)
 {
-	// fast path
-	if (strcmp(m_type, base) == 0)
-		return true;
-
-	lua_State *l = Lua::manager->GetLuaState();
-
 	LUA_DEBUG_START(l);
 
-	std::string current = m_type;
+	known = true;
+	std::string current = type;
 	while (current.compare(base) != 0) {
 		if (!LuaMetaTypeBase::GetMetatableFromName(l, current.c_str())) {
+			known = false;
 			LUA_DEBUG_END(l, 0);
 			return false;
 		}
@@ -706,6 +723,37 @@ bool LuaObjectBase::Isa(const char *base) const
 	return true;
 }
 
+bool LuaObjectBase::Isa(const char *base) const
+{
+	// fast path
+	if (strcmp(m_type, base) == 0)
+		return true;
+
+	bool known;
+	return isa_walk(Lua::manager->GetLuaState(), m_type, base, known);
+}
+
+// m_type is always a LuaObject<T>::s_type or a promotion's target name, so a
+// pair of pointers always gets the same answer once their types exist
+static std::map<std::pair<const char *, const char *>, bool> s_isaCache;
+
+bool LuaObjectBase::IsaStatic(const char *base) const
+{
+	if (m_type == base)
+		return true;
+
+	const auto key = std::make_pair(m_type, base);
+	auto it = s_isaCache.find(key);
+	if (it != s_isaCache.end())
+		return it->second;
+
+	bool known;
+	const bool isa = strcmp(m_type, base) == 0 || isa_walk(Lua::manager->GetLuaState(), m_type, base, known);
+	if (isa || known)
+		s_isaCache.emplace(key, isa);
+	return isa;
+}
+
 void LuaObjectBase::RegisterPromotion(const char *base_type, const char *target_type, PromotionTest test_fn)
 {
 	promotions[base_type][target_type] = test_fn;
@@ -737,11 +785,10 @@ bool LuaObjectBase::SerializeComponents(LuaWrappable *object, Json &out)
 	lua_State *l = Lua::manager->GetLuaState();
 	LUA_DEBUG_START(l);
 
-	luaL_getsubtable(l, LUA_REGISTRYINDEX, "LuaObjectRegistry");
+	push_object_registry(l);
 
 	// Get the LuaObject for the given LuaWrappable passed in
-	lua_pushlightuserdata(l, object);
-	lua_rawget(l, -2); // Registry, LuaObject
+	lua_rawgetp(l, -1, object); // Registry, LuaObject
 
 	if (lua_isnil(l, -1)) {
 		lua_pop(l, 2);
@@ -788,11 +835,10 @@ bool LuaObjectBase::DeserializeComponents(LuaWrappable *object, const Json &obj)
 	lua_State *l = Lua::manager->GetLuaState();
 	LUA_DEBUG_START(l);
 
-	luaL_getsubtable(l, LUA_REGISTRYINDEX, "LuaObjectRegistry");
+	push_object_registry(l);
 
 	// Get the LuaObject for the given LuaWrappable passed in
-	lua_pushlightuserdata(l, object);
-	lua_rawget(l, -2); // Registry, LuaObject
+	lua_rawgetp(l, -1, object); // Registry, LuaObject
 
 	if (lua_isnil(l, -1)) {
 		lua_pop(l, 2);
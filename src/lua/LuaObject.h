@@ -226,6 +226,10 @@ private:
 	// determine if the object has a class in its ancestry
 	bool Isa(const char *base) const;
 
+	// as Isa(), for a base name that lives as long as the program does, such
+	// as a LuaObject<T>::s_type, remembering the answer
+	bool IsaStatic(const char *base) const;
+
 	// lua type (ie method/metatable name)
 	const char *m_type;
 };
@@ -19,6 +19,7 @@
 #include "SDL_scancode.h"
 #include "Space.h"
 #include "WorldView.h"
+#include "core/FNV1a.h"
 #include "graphics/Graphics.h"
 #include "graphics/Renderer.h"
 #include "imgui/backends/imgui_impl_sdl2.h"
@@ -32,6 +33,7 @@
 #include "sound/Sound.h"
 #include "utils.h"
 
+#include <cstring>
 #include <iterator>
 #include <numeric>
 
@@ -1960,6 +1962,35 @@ static int l_pigui_end_child(lua_State *l)
 	return 0;
 }
 
+// Returns true if the region must be drawn, followed by EndCached(); false
+// if it was unchanged and has been drawn from the cache. The version may be
+// a number or a string.
+static int l_pigui_begin_cached(lua_State *l)
+{
+	PROFILE_SCOPED()
+	std::string id = LuaPull<std::string>(l, 1);
+
+	uint64_t version;
+	if (lua_type(l, 2) == LUA_TSTRING) {
+		size_t len;
+		const char *str = lua_tolstring(l, 2, &len);
+		version = hash_64_fnv1a(str, len);
+	} else {
+		const double num = luaL_checknumber(l, 2);
+		memcpy(&version, &num, sizeof(version));
+	}
+
+	LuaPush<bool>(l, Pi::pigui->GetDrawCache().Begin(id.c_str(), version));
+	return 1;
+}
+
+static int l_pigui_end_cached(lua_State *l)
+{
+	PROFILE_SCOPED()
+	Pi::pigui->GetDrawCache().End();
+	return 0;
+}
+
 static int l_pigui_is_item_hovered(lua_State *l)
 {
 	PROFILE_SCOPED()
@@ -2058,9 +2089,9 @@ static int l_pigui_pop_font(lua_State *l)
 static int l_pigui_calc_text_size(lua_State *l)
 {
 	PROFILE_SCOPED()
-	std::string text = LuaPull<std::string>(l, 1);
+	std::string_view text = LuaPull<std::string_view>(l, 1);
 	double wrapWidth = LuaPull<double>(l, 2, -1.0);
-	ImVec2 size = ImGui::CalcTextSize(text.c_str(), nullptr, false, wrapWidth);
+	ImVec2 size = Pi::pigui->GetTextSizeCache().CalcTextSize(text, wrapWidth);
 	LuaPush<vector2d>(l, vector2d(size.x, size.y));
 	return 1;
 }
@@ -3608,6 +3639,8 @@ void LuaObject<PiGui::Instance>::RegisterClass()
 		{ "NewLine", l_pigui_newline },
 		{ "BeginChild", l_pigui_begin_child },
 		{ "EndChild", l_pigui_end_child },
+		{ "BeginCached", l_pigui_begin_cached },
+		{ "EndCached", l_pigui_end_cached },
 		{ "PushFont", l_pigui_push_font },
 		{ "PopFont", l_pigui_pop_font },
 		{ "CalcTextSize", l_pigui_calc_text_size },
@@ -0,0 +1,390 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "LuaProfiler.h"
+
+#include "FileSystem.h"
+#include "Json.h"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <tuple>
+
+namespace {
+	Uint64 Now()
+	{
+		using namespace std::chrono;
+		return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+	}
+
+	// the number of levels on the stack, as luaL_traceback counts them
+	int StackDepth(lua_State *l)
+	{
+		lua_Debug ar;
+		int li = 1, le = 1;
+		while (lua_getstack(l, le, &ar)) {
+			li = le;
+			le *= 2;
+		}
+		while (li < le) {
+			const int m = (li + le) / 2;
+			if (lua_getstack(l, m, &ar))
+				li = m + 1;
+			else
+				le = m;
+		}
+		return le;
+	}
+
+	// the data path of a file, as pi_lua_loadfile named its chunk
+	std::string FileName(const lua_Debug &ar)
+	{
+		const char *source = ar.source;
+		if (source[0] != '@')
+			return ar.short_src;
+		source++;
+		if (strncmp(source, "[T] ", 4) == 0)
+			source += 4;
+		return source;
+	}
+
+	void WriteString(FILE *f, const std::string &data)
+	{
+		fwrite(data.data(), 1, data.size(), f);
+	}
+} // namespace
+
+LuaProfiler::LuaProfiler() :
+	m_running(false),
+	m_inHook(false),
+	m_lastEvent(0),
+	m_profiledTime(0),
+	m_current(nullptr),
+	m_currentStack(nullptr)
+{
+	Reset();
+}
+
+void LuaProfiler::Start(lua_State *l)
+{
+	if (m_running)
+		return;
+
+	m_running = true;
+	m_lastEvent = Now();
+	lua_sethook(l, &LuaProfiler::Hook, LUA_MASKCALL | LUA_MASKRET, 0);
+}
+
+void LuaProfiler::Stop(lua_State *l)
+{
+	if (!m_running)
+		return;
+
+	// coroutines created since Start() unhook themselves at their next event
+	lua_sethook(l, nullptr, 0, 0);
+	SwitchTo(nullptr, Now());
+	m_running = false;
+	m_stacks.clear();
+	m_currentStack = nullptr;
+	for (FunctionState &state : m_functionStates)
+		state.active = 0;
+}
+
+void LuaProfiler::Reset()
+{
+	m_profiledTime = 0;
+	m_current = nullptr;
+	m_currentStack = nullptr;
+	m_stacks.clear();
+
+	m_functions.clear();
+	m_functionStates.clear();
+	m_functionIds.clear();
+	m_files.clear();
+	m_fileIds.clear();
+	m_nodeIds.clear();
+
+	// the root of the call tree
+	m_nodes.assign(1, Node{ 0, 0 });
+}
+
+void *LuaProfiler::Alloc(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+	if (nsize == 0) {
+		free(ptr);
+		return nullptr;
+	}
+
+	// for a new block osize holds the type of object and not a size
+	LuaProfiler *profiler = static_cast<LuaProfiler *>(ud);
+	const size_t oldSize = ptr ? osize : 0;
+	if (profiler->m_running && nsize > oldSize)
+		profiler->OnAlloc(nsize - oldSize);
+
+	return realloc(ptr, nsize);
+}
+
+void LuaProfiler::Hook(lua_State *l, lua_Debug *ar)
+{
+	void *ud;
+	lua_getallocf(l, &ud);
+	LuaProfiler *profiler = static_cast<LuaProfiler *>(ud);
+
+	if (!profiler->m_running) {
+		lua_sethook(l, nullptr, 0, 0);
+		return;
+	}
+
+	profiler->m_inHook = true;
+	profiler->OnEvent(l, ar);
+	profiler->m_inHook = false;
+}
+
+void LuaProfiler::OnEvent(lua_State *l, lua_Debug *ar)
+{
+	const Uint64 now = Now();
+	SwitchTo(l, now);
+	std::vector<Frame> &stack = *m_currentStack;
+
+	// level 0 is the function being called or returning from; anything at
+	// its depth or deeper has returned, if not by a return event then by an
+	// error unwinding the stack
+	const int depth = StackDepth(l);
+	PopFrames(stack, depth, now);
+
+	if (ar->event != LUA_HOOKCALL && ar->event != LUA_HOOKTAILCALL)
+		return;
+
+	const Uint32 function = FindFunction(l, ar);
+	FunctionState &state = m_functionStates[function];
+	m_functions[function].calls++;
+	state.active++;
+
+	Frame frame;
+	frame.function = function;
+	frame.depth = depth;
+	frame.start = now;
+	if (stack.empty()) {
+		frame.file = state.file != NO_FILE ? state.file : FindFile("[C]");
+		frame.node = FindNode(0, function);
+	} else {
+		// C functions count towards the file that called them
+		frame.file = state.file != NO_FILE ? state.file : stack.back().file;
+		frame.node = FindNode(stack.back().node, function);
+	}
+	stack.push_back(frame);
+}
+
+void LuaProfiler::OnAlloc(size_t bytes)
+{
+	// the hook's own lua_getinfo calls don't count
+	if (m_inHook || !m_currentStack || m_currentStack->empty())
+		return;
+
+	const Frame &frame = m_currentStack->back();
+	Function &function = m_functions[frame.function];
+	function.allocBytes += bytes;
+	function.allocCount++;
+	File &file = m_files[frame.file];
+	file.allocBytes += bytes;
+	file.allocCount++;
+	m_nodes[frame.node].allocBytes += bytes;
+}
+
+void LuaProfiler::SwitchTo(lua_State *l, Uint64 now)
+{
+	// charge the time since the last event to whatever was running
+	if (m_currentStack && !m_currentStack->empty()) {
+		const Uint64 elapsed = now - m_lastEvent;
+		const Frame &frame = m_currentStack->back();
+		m_functions[frame.function].selfTime += elapsed;
+		m_files[frame.file].selfTime += elapsed;
+		m_nodes[frame.node].selfTime += elapsed;
+		m_profiledTime += elapsed;
+	}
+	m_lastEvent = now;
+
+	// references to unordered_map elements survive rehashing
+	if (l != m_current || !m_currentStack) {
+		m_current = l;
+		m_currentStack = l ? &m_stacks[l] : nullptr;
+	}
+}
+
+Uint32 LuaProfiler::FindFunction(lua_State *l, lua_Debug *ar)
+{
+	lua_getinfo(l, "Sf", ar);
+	const bool isC = ar->what[0] == 'C';
+	const void *id = isC ? reinterpret_cast<const void *>(lua_tocfunction(l, -1)) : ar->source;
+	const int line = isC ? -1 : ar->linedefined;
+	lua_pop(l, 1);
+
+	// functions defined on the same lines of a file are counted together
+	const auto key = std::make_tuple(id, line, ar->lastlinedefined);
+	auto it = m_functionIds.find(key);
+	if (it != m_functionIds.end() && (isC || m_functionStates[it->second].source == ar->source))
+		return it->second;
+
+	lua_getinfo(l, "n", ar);
+	const char *name = ar->name ? ar->name : "?";
+
+	Function function;
+	FunctionState state;
+	if (isC) {
+		function.name = name;
+		function.file = "[C]";
+		state.file = NO_FILE;
+	} else {
+		function.file = FileName(*ar);
+		// named as luaL_traceback names them
+		if (ar->what[0] == 'm')
+			function.name = fmt::format("main chunk ({})", function.file);
+		else if (ar->name)
+			function.name = fmt::format("{} ({}:{})", name, function.file, line);
+		else
+			function.name = fmt::format("function <{}:{}>", function.file, line);
+		state.source = ar->source;
+		state.file = FindFile(function.file);
+	}
+
+	const Uint32 index = m_functions.size();
+	m_functions.push_back(std::move(function));
+	m_functionStates.push_back(std::move(state));
+	m_functionIds[key] = index;
+	return index;
+}
+
+Uint32 LuaProfiler::FindFile(const std::string &name)
+{
+	auto it = m_fileIds.find(name);
+	if (it != m_fileIds.end())
+		return it->second;
+
+	const Uint32 index = m_files.size();
+	m_files.push_back(File{ name });
+	m_fileIds.emplace(name, index);
+	return index;
+}
+
+Uint32 LuaProfiler::FindNode(Uint32 parent, Uint32 function)
+{
+	const Uint64 key = (Uint64(parent) << 32) | function;
+	auto it = m_nodeIds.find(key);
+	if (it != m_nodeIds.end())
+		return it->second;
+
+	const Uint32 index = m_nodes.size();
+	m_nodes.push_back(Node{ function, parent });
+	m_nodeIds.emplace(key, index);
+	return index;
+}
+
+void LuaProfiler::PopFrames(std::vector<Frame> &stack, int depth, Uint64 now)
+{
+	while (!stack.empty() && stack.back().depth >= depth) {
+		const Frame &frame = stack.back();
+		// only the outermost of a recursive function's frames counts
+		if (--m_functionStates[frame.function].active == 0)
+			m_functions[frame.function].totalTime += now - frame.start;
+		stack.pop_back();
+	}
+}
+
+bool LuaProfiler::WriteProfile(const std::string &basePath) const
+{
+	// the folded format separates frames with ';'
+	std::vector<std::string> names;
+	names.reserve(m_functions.size());
+	for (const Function &function : m_functions) {
+		names.push_back(function.name);
+		std::replace(names.back().begin(), names.back().end(), ';', ':');
+	}
+
+	// a node is always created after its parent, so totals can be summed
+	// from the leaves up in one pass
+	std::vector<Uint64> totals(m_nodes.size());
+	std::vector<std::vector<Uint32>> children(m_nodes.size());
+	for (size_t i = m_nodes.size() - 1; i > 0; i--) {
+		totals[i] += m_nodes[i].selfTime;
+		totals[m_nodes[i].parent] += totals[i];
+		children[m_nodes[i].parent].push_back(i);
+	}
+
+	FILE *f = FileSystem::userFiles.OpenWriteStream(basePath + ".folded", FileSystem::FileSourceFS::WRITE_TEXT);
+	if (!f)
+		return false;
+
+	std::vector<Uint32> path;
+	for (size_t i = 1; i < m_nodes.size(); i++) {
+		const Uint64 micros = m_nodes[i].selfTime / 1000;
+		if (!micros)
+			continue;
+
+		path.clear();
+		for (Uint32 n = i; n != 0; n = m_nodes[n].parent)
+			path.push_back(n);
+
+		std::string line;
+		for (auto n = path.rbegin(); n != path.rend(); ++n) {
+			if (!line.empty())
+				line += ';';
+			line += names[m_nodes[*n].function];
+		}
+		WriteString(f, fmt::format("{} {}\n", line, micros));
+	}
+	fclose(f);
+
+	// lay each node's children out one after another from its start, the
+	// heaviest first, so the trace viewer draws the tree as a flame chart
+	Json events = Json::array();
+	std::vector<std::pair<Uint32, Uint64>> open = { { 0, 0 } };
+	while (!open.empty()) {
+		const auto [node, start] = open.back();
+		open.pop_back();
+
+		if (node != 0) {
+			const Function &function = m_functions[m_nodes[node].function];
+			Json event = Json::object();
+			event["name"] = function.name;
+			event["cat"] = function.file;
+			event["ph"] = "X";
+			event["ts"] = double(start) / 1000.0;
+			event["dur"] = double(totals[node]) / 1000.0;
+			event["pid"] = 0;
+			event["tid"] = 0;
+			event["args"] = Json::object({ { "self_ms", double(m_nodes[node].selfTime) * 1e-6 },
+				{ "alloc_bytes", m_nodes[node].allocBytes } });
+			events.push_back(std::move(event));
+		}
+
+		std::vector<Uint32> &kids = children[node];
+		std::sort(kids.begin(), kids.end(), [&](Uint32 a, Uint32 b) { return totals[a] > totals[b]; });
+		Uint64 at = start;
+		for (Uint32 kid : kids) {
+			open.emplace_back(kid, at);
+			at += totals[kid];
+		}
+	}
+
+	f = FileSystem::userFiles.OpenWriteStream(basePath + ".json", FileSystem::FileSourceFS::WRITE_TEXT);
+	if (!f)
+		return false;
+	WriteString(f, Json::object({ { "traceEvents", events } }).dump());
+	fclose(f);
+	return true;
+}
+
+std::string LuaProfiler::MakeProfilePath()
+{
+	FileSystem::userFiles.MakeDirectory("profiler");
+
+	char name[32];
+	const time_t t = time(nullptr);
+	strftime(name, sizeof(name), "lua-%Y%m%d-%H%M%S", localtime(&t));
+	return FileSystem::JoinPath("profiler", name);
+}
@@ -0,0 +1,128 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _LUAPROFILER_H
+#define _LUAPROFILER_H
+
+#include <SDL_stdinc.h>
+#include <lua.hpp>
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// Attributes the time spent running Lua, and the memory Lua allocates, to
+// the functions and source files responsible.
+//
+// While running, a call/return hook keeps a shadow of each coroutine's call
+// stack. The time between two hook events is charged to the function on top
+// of the stack, as is anything the allocator hands out in between, so C
+// functions called from Lua are measured as well. Time spent outside Lua
+// entirely is not charged to anything. Frames skipped by an error are
+// noticed by their depth and dropped at the next event.
+//
+// The hook costs a good deal, so the profiler is meant to be started from the
+// debug tools while looking into a problem, not left running. Coroutines
+// created before Start() aren't seen.
+class LuaProfiler {
+public:
+	struct Function {
+		std::string name;
+		std::string file;
+		Uint64 calls = 0;
+		Uint64 selfTime = 0; // ns
+		Uint64 totalTime = 0; // ns, not counting recursive calls twice
+		Uint64 allocBytes = 0;
+		Uint64 allocCount = 0;
+	};
+
+	struct File {
+		std::string name;
+		Uint64 selfTime = 0; // ns, including the C functions it called
+		Uint64 allocBytes = 0;
+		Uint64 allocCount = 0;
+	};
+
+	LuaProfiler();
+
+	void Start(lua_State *l);
+	void Stop(lua_State *l);
+	bool IsRunning() const { return m_running; }
+
+	// Forget everything gathered so far
+	void Reset();
+
+	Uint64 GetProfiledTime() const { return m_profiledTime; } // ns
+	const std::vector<Function> &GetFunctions() const { return m_functions; }
+	const std::vector<File> &GetFiles() const { return m_files; }
+
+	// Write the call tree gathered so far to basePath.folded, as collapsed
+	// stacks for flamegraph tools, and to basePath.json as a Chrome trace
+	// with the tree laid out as a flame chart
+	bool WriteProfile(const std::string &basePath) const;
+
+	// A new base path in the user dir's profiler directory, named for the
+	// current time
+	static std::string MakeProfilePath();
+
+	// The allocator for the profiled lua_State, with the profiler as ud
+	static void *Alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+private:
+	struct Frame {
+		Uint32 function;
+		Uint32 file;
+		Uint32 node;
+		int depth;
+		Uint64 start;
+	};
+
+	// a function as reached by a particular path through the call tree
+	struct Node {
+		Uint32 function;
+		Uint32 parent;
+		Uint64 selfTime = 0;
+		Uint64 allocBytes = 0;
+	};
+
+	static void Hook(lua_State *l, lua_Debug *ar);
+	void OnEvent(lua_State *l, lua_Debug *ar);
+	void OnAlloc(size_t bytes);
+
+	struct FunctionState {
+		std::string source; // to tell functions at reused addresses apart
+		Uint32 file; // or NO_FILE for C functions
+		int active = 0; // how many of its frames are live
+	};
+
+	static const Uint32 NO_FILE = ~Uint32(0);
+
+	void SwitchTo(lua_State *l, Uint64 now);
+	Uint32 FindFunction(lua_State *l, lua_Debug *ar);
+	Uint32 FindFile(const std::string &name);
+	Uint32 FindNode(Uint32 parent, Uint32 function);
+	void PopFrames(std::vector<Frame> &stack, int depth, Uint64 now);
+
+	bool m_running;
+	bool m_inHook;
+	Uint64 m_lastEvent;
+	Uint64 m_profiledTime;
+
+	lua_State *m_current;
+	std::vector<Frame> *m_currentStack;
+	std::unordered_map<lua_State *, std::vector<Frame>> m_stacks;
+
+	std::vector<Function> m_functions;
+	std::vector<FunctionState> m_functionStates;
+	std::map<std::tuple<const void *, int, int>, Uint32> m_functionIds;
+
+	std::vector<File> m_files;
+	std::unordered_map<std::string, Uint32> m_fileIds;
+
+	std::vector<Node> m_nodes;
+	std::unordered_map<Uint64, Uint32> m_nodeIds;
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "LuaObject.h"
 #include "Random.h"
+#include "Replay.h"
 
 extern "C" {
 #include "jenkins/lookup3.h"
@@ -58,7 +59,7 @@ static int l_rand_new(lua_State *l)
 		break;
 	case LUA_TNIL: // fallthrough
 	case LUA_TNONE:
-		rng->seed(Uint32(time(0)));
+		rng->seed(Replay::Seed(Uint32(time(0))));
 		break;
 	default:
 		return luaL_error(l, "seed must be a number or a string");
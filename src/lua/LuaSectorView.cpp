@@ -83,6 +83,14 @@ void LuaObject<SectorView>::RegisterClass()
 			LuaPush<std::string>(l, result);
 			return 1;
 		})
+		.AddFunction("StartAutoRoute", [](lua_State *l, SectorView *sv) {
+			LuaPush<std::string>(l, sv->StartAutoRoute());
+			return 1;
+		})
+		.AddFunction("GetAutoRouteStatus", [](lua_State *l, SectorView *sv) {
+			LuaPush<std::string>(l, sv->GetAutoRouteStatus());
+			return 1;
+		})
 		.AddFunction("GetRoute", [](lua_State *l, SectorView *sv) {
 			std::vector<SystemPath> route = sv->GetRoute();
 			lua_newtable(l);
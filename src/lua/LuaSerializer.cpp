@@ -13,12 +13,27 @@
 #include "core/Log.h"
 #include "profiler/Profiler.h"
 
+#include <algorithm>
+#include <unordered_map>
+
 // Well-known names of various serialization-related caches stored in the
 // Lua Registry
 static const char *NS_REFTABLE = "PiSerializerTableRefs";
 static const char *NS_CLASSES = "PiSerializerClasses";
 static const char *NS_CALLBACKS = "PiSerializerCallbacks";
 static const char *NS_PERSISTENT = "PiSerializerPersistent";
+static const char *NS_TABLEIDS = "PiSerializerTableIds";
+
+// Table ids are kept for as long as the table lives, weakly keyed, so a table
+// is written with the same id in every save of a session and unchanged data
+// hashes the same for delta saves
+static lua_Integer s_lastTableId = 0;
+
+// Strings of this length and longer are written once into the string table
+// and referred to by index wherever they occur
+static const size_t MIN_INTERNED_LENGTH = 12;
+static std::vector<std::string> s_strings;
+static std::unordered_map<std::string, lua_Integer> s_stringIds;
 
 // every module can save one object. that will usually be a table.  we call
 // each serializer in turn and capture its return value we build a table like
@@ -50,12 +65,19 @@ static const char *NS_PERSISTENT = "PiSerializerPersistent";
 // using a scheme as follows:
 //   "lua_table": {"table": []} - defines a new lua table with values pickled
 //                                in the 'table' array
-//   "ref": 10491324            - references a previously-defined lua table
+//   "ref": 10491               - references a previously-defined lua table
+//   "str": 12                  - a string from the "lua_strings" table
 //   "lua_class": "ClassName"   - indicates this Lua table is an object of a
 //                                specific class object registered by Lua
 //   "cpp_class": "ClassName"   - this object is a C++ userdata of a specific
 //                                class registered by C++ of the same name
 
+// Table ids are small integers assigned the first time a table is saved
+// (older saves used the table's address). Long strings, mostly repeated keys
+// and descriptor ids, are interned: the "lua_strings" array at the top level
+// of the save holds each one once, and is loaded before anything is
+// unpickled.
+
 // on serialize, if an item has a metatable with a "class" attribute, the
 // "Serialize" function under that namespace will be called with the type. the
 // data returned will then be serialized as an "object" above.
@@ -64,9 +86,89 @@ static const char *NS_PERSISTENT = "PiSerializerPersistent";
 // "Deserialize" function under that namespace. that data returned will be
 // given back to the module
 
+// The path is only turned into a string when something goes wrong: each
+// level refers to the key on the Lua stack that led to it, which stays there
+// while its value is pickled.
+struct LuaSerializer::KeyPath {
+	const KeyPath *parent;
+	const std::string *root; // set at the top
+	int keyIndex;
+
+	std::string ToString(lua_State *l) const
+	{
+		if (!parent)
+			return *root;
+
+		std::string path = parent->ToString(l);
+		lua_pushvalue(l, keyIndex); // lua_tostring would convert a number key in place
+		const char *k = lua_tostring(l, -1);
+		path += "." + (k ? std::string(k) : "<" + std::string(lua_typename(l, lua_type(l, -1))) + ">");
+		lua_pop(l, 1);
+		return path;
+	}
+};
+
+static lua_Integer _get_table_id(lua_State *l, int idx)
+{
+	LUA_DEBUG_START(l);
+
+	lua_getfield(l, LUA_REGISTRYINDEX, NS_TABLEIDS); // ids
+	lua_pushvalue(l, idx);							 // ids table
+	lua_rawget(l, -2);								 // ids id
+
+	lua_Integer id;
+	if (lua_isnil(l, -1)) {
+		id = ++s_lastTableId;
+		lua_pushvalue(l, idx);	// ids nil table
+		lua_pushinteger(l, id); // ids nil table id
+		lua_rawset(l, -4);		// ids nil
+	} else {
+		id = lua_tointeger(l, -1);
+	}
+	lua_pop(l, 2);
+
+	LUA_DEBUG_END(l, 0);
+	return id;
+}
+
+// Records the id a loaded table was saved with, so saving it again keeps it
+static void _set_table_id(lua_State *l, int idx, lua_Integer id)
+{
+	LUA_DEBUG_START(l);
+	idx = lua_absindex(l, idx);
+
+	lua_getfield(l, LUA_REGISTRYINDEX, NS_TABLEIDS);
+	lua_pushvalue(l, idx);
+	lua_pushinteger(l, id);
+	lua_rawset(l, -3);
+	lua_pop(l, 1);
+
+	s_lastTableId = std::max(s_lastTableId, id);
+
+	LUA_DEBUG_END(l, 0);
+}
+
+static void _new_table_ids(lua_State *l)
+{
+	lua_newtable(l);
+	lua_newtable(l);
+	lua_pushstring(l, "k");
+	lua_setfield(l, -2, "__mode");
+	lua_setmetatable(l, -2);
+	lua_setfield(l, LUA_REGISTRYINDEX, NS_TABLEIDS);
+
+	s_lastTableId = 0;
+}
+
 void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const std::string &key)
 {
 	PROFILE_SCOPED()
+	const KeyPath path = { nullptr, &key, 0 };
+	pickle_value(l, to_serialize, out, path);
+}
+
+void LuaSerializer::pickle_value(lua_State *l, int to_serialize, Json &out, const KeyPath &path)
+{
 	LUA_DEBUG_START(l);
 
 	// tables are pickled recursively, so we can run out of Lua stack space if we're not careful
@@ -125,7 +227,14 @@ void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const
 		lua_pushvalue(l, idx);
 		size_t len;
 		const char *str = lua_tolstring(l, -1, &len);
-		out = Json(std::string(str, str + len));
+		if (len < MIN_INTERNED_LENGTH) {
+			out = Json(std::string(str, str + len));
+		} else {
+			auto res = s_stringIds.emplace(std::string(str, str + len), lua_Integer(s_strings.size()));
+			if (res.second)
+				s_strings.push_back(res.first->first);
+			out["str"] = res.first->second;
+		}
 		lua_pop(l, 1);
 		break;
 	}
@@ -136,7 +245,7 @@ void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const
 	}
 
 	case LUA_TTABLE: {
-		lua_Integer ptr = lua_Integer(lua_topointer(l, to_serialize));
+		lua_Integer ptr = _get_table_id(l, to_serialize);
 		lua_pushinteger(l, ptr); // ptr
 
 		lua_getfield(l, LUA_REGISTRYINDEX, NS_REFTABLE); // ptr reftable
@@ -158,25 +267,21 @@ void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const
 			lua_pushvalue(l, idx);
 			lua_pushnil(l);
 			while (lua_next(l, -2)) {
-				lua_pushvalue(l, -2);
-				const char *k = lua_tostring(l, -1);
-				std::string new_key = key + "." + (k ? std::string(k) : "<" + std::string(lua_typename(l, lua_type(l, -1))) + ">");
-				lua_pop(l, 1);
+				const KeyPath entryPath = { &path, nullptr, lua_absindex(l, -2) };
 
-				// Copy the values to pickle, as they might be mutated by the pickling process.
 				Json out_k, out_v;
 
-				pickle_json(l, -2, out_k, new_key);
-				pickle_json(l, -1, out_v, new_key);
+				pickle_value(l, -2, out_k, entryPath);
+				pickle_value(l, -1, out_v, entryPath);
 
-				inner.push_back(out_k);
-				inner.push_back(out_v);
+				inner.push_back(std::move(out_k));
+				inner.push_back(std::move(out_v));
 
 				lua_pop(l, 1);
 			}
 			lua_pop(l, 1);
 
-			out["table"] = Json(inner);
+			out["table"] = std::move(inner);
 		}
 
 		break;
@@ -190,14 +295,14 @@ void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const
 		else
 			Log::Error("Lua serializer '{}' tried to serialize an invalid object\n"
 					   "The save file may be invalid.\n",
-				key.c_str());
+				path.ToString(l));
 
 		lua_pop(l, 1);
 		break;
 	}
 
 	default:
-		Log::Error("Lua serializer '{}' tried to serialize {} value", key.c_str(), lua_typename(l, lua_type(l, idx)));
+		Log::Error("Lua serializer '{}' tried to serialize {} value", path.ToString(l), lua_typename(l, lua_type(l, idx)));
 		break;
 	}
 
@@ -210,6 +315,11 @@ void LuaSerializer::pickle_json(lua_State *l, int to_serialize, Json &out, const
 void LuaSerializer::unpickle_json(lua_State *l, const Json &value)
 {
 	PROFILE_SCOPED()
+	unpickle_value(l, value);
+}
+
+void LuaSerializer::unpickle_value(lua_State *l, const Json &value)
+{
 	LUA_DEBUG_START(l);
 
 	// tables are also unpickled recursively, so we can run out of Lua stack space if we're not careful
@@ -232,11 +342,13 @@ void LuaSerializer::unpickle_json(lua_State *l, const Json &value)
 		LUA_DEBUG_CHECK(l, 1);
 		break;
 	case Json::value_t::string:
-		// FIXME: Should do something to make sure we can unpickle strings that include null bytes.
-		// However I'm not sure that the JSON library actually supports strings containing nulls which would make it moot.
-		lua_pushstring(l, value.get<std::string>().c_str());
+	{
+		// pickled with their length, so strings with null bytes come back whole
+		const std::string &str = value.get_ref<const std::string &>();
+		lua_pushlstring(l, str.data(), str.size());
 		LUA_DEBUG_CHECK(l, 1);
 		break;
+	}
 	case Json::value_t::boolean:
 		lua_pushboolean(l, value);
 		LUA_DEBUG_CHECK(l, 1);
@@ -245,9 +357,11 @@ void LuaSerializer::unpickle_json(lua_State *l, const Json &value)
 		// Pickle doesn't emit array type values except as part of another structure.
 		throw SavedGameCorruptException();
 		break;
-	case Json::value_t::object:
-		if (value.count("userdata")) {
-			if (!LuaObjectBase::DeserializeFromJson(l, value["userdata"])) {
+	case Json::value_t::object: {
+		// each member is looked up once; this is the bulk of loading
+		const auto userdata = value.find("userdata");
+		if (userdata != value.end()) {
+			if (!LuaObjectBase::DeserializeFromJson(l, *userdata)) {
 				throw SavedGameCorruptException();
 			}
 			LUA_DEBUG_CHECK(l, 1);
@@ -255,15 +369,23 @@ void LuaSerializer::unpickle_json(lua_State *l, const Json &value)
 			if (!LuaObjectBase::DeserializeFromJson(l, value))
 				throw SavedGameCorruptException();
 			LUA_DEBUG_CHECK(l, 1);
+		} else if (const auto str = value.find("str"); str != value.end()) {
+			if (!str->is_number_integer() || str->get<lua_Integer>() < 0 || str->get<size_t>() >= s_strings.size())
+				throw SavedGameCorruptException();
+			const std::string &s = s_strings[str->get<size_t>()];
+			lua_pushlstring(l, s.data(), s.size());
+			LUA_DEBUG_CHECK(l, 1);
 		} else {
 			// Object, table, or table-reference.
-			if (value["ref"].is_null()) {
+			const auto ref = value.find("ref");
+			if (ref == value.end() || ref->is_null()) {
 				throw SavedGameCorruptException();
 			}
 
-			lua_Integer ptr = value["ref"];
+			lua_Integer ptr = *ref;
 
-			if (value.count("table")) {
+			const auto table = value.find("table");
+			if (table != value.end()) {
 				lua_newtable(l);
 
 				lua_getfield(l, LUA_REGISTRYINDEX, NS_REFTABLE); // [t] [refs]
@@ -271,14 +393,15 @@ void LuaSerializer::unpickle_json(lua_State *l, const Json &value)
 				lua_pushvalue(l, -3);							 // [t] [refs] [key] [t]
 				lua_rawset(l, -3);								 // [t] [refs]
 				lua_pop(l, 1);									 // [t]
+				_set_table_id(l, -1, ptr);
 
-				const Json &inner = value["table"];
-				if (inner.size() % 2 != 0) {
+				const Json &inner = *table;
+				if (!inner.is_array() || inner.size() % 2 != 0) {
 					throw SavedGameCorruptException();
 				}
 				for (size_t i = 0; i < inner.size(); i += 2) {
-					unpickle_json(l, inner[i + 0]);
-					unpickle_json(l, inner[i + 1]);
+					unpickle_value(l, inner[i + 0]);
+					unpickle_value(l, inner[i + 1]);
 					lua_rawset(l, -3);
 				}
 
@@ -297,10 +420,11 @@ void LuaSerializer::unpickle_json(lua_State *l, const Json &value)
 				LUA_DEBUG_CHECK(l, 1);
 			}
 
-			if (value.count("lua_class")) {
-				const char *cl = value["lua_class"].get_ref<const std::string &>().c_str();
+			const auto lua_class = value.find("lua_class");
+			if (lua_class != value.end()) {
+				const char *cl = lua_class->get_ref<const std::string &>().c_str();
 				// If this was a full definition (not just a reference) then run the class's unserialiser function.
-				if (value.count("table")) {
+				if (table != value.end()) {
 					lua_getfield(l, LUA_REGISTRYINDEX, NS_CLASSES);
 					lua_pushstring(l, cl);
 					lua_gettable(l, -2);
@@ -329,6 +453,7 @@ void LuaSerializer::unpickle_json(lua_State *l, const Json &value)
 							lua_pushvalue(l, -3);							 // [t] [refs] [key] [t]
 							lua_rawset(l, -3);								 // [t] [refs]
 							lua_pop(l, 1);									 // [t]
+							_set_table_id(l, -1, ptr);
 						}
 					}
 				}
@@ -336,6 +461,7 @@ void LuaSerializer::unpickle_json(lua_State *l, const Json &value)
 			}
 		}
 		break;
+	}
 
 	default:
 		throw SavedGameCorruptException();
@@ -373,6 +499,35 @@ void LuaSerializer::UninitTableRefs()
 	lua_setfield(l, LUA_REGISTRYINDEX, "PiLuaRefLoadTable");
 }
 
+void LuaSerializer::SaveIdentities(Json &json)
+{
+	json["lua_strings"] = s_strings;
+}
+
+void LuaSerializer::LoadIdentities(const Json &json)
+{
+	// the loaded game's table ids replace whatever this session assigned
+	_new_table_ids(Lua::manager->GetLuaState());
+
+	s_strings.clear();
+	s_stringIds.clear();
+
+	// Savefile from before strings were interned
+	const auto strings = json.find("lua_strings");
+	if (strings == json.end())
+		return;
+
+	if (!strings->is_array())
+		throw SavedGameCorruptException();
+
+	for (const Json &str : *strings) {
+		if (!str.is_string())
+			throw SavedGameCorruptException();
+		s_stringIds.emplace(str.get<std::string>(), lua_Integer(s_strings.size()));
+		s_strings.push_back(str.get<std::string>());
+	}
+}
+
 void LuaSerializer::SavePersistent(Json &json)
 {
 	lua_State *l = Lua::manager->GetLuaState();
@@ -458,6 +613,8 @@ void LuaSerializer::LoadPersistent(const Json &json)
 		}
 
 		// All references to the prior saved value are replaced with the persistent object
+		if (!lua_isnil(l, -1))
+			_set_table_id(l, -1, lua_tointeger(l, -2));
 		lua_settable(l, idx_reftable);
 	}
 
@@ -750,6 +907,8 @@ void LuaObject<LuaSerializer>::RegisterClass()
 	lua_newtable(l);
 	lua_setfield(l, LUA_REGISTRYINDEX, NS_CLASSES);
 
+	_new_table_ids(l);
+
 	lua_getfield(l, LUA_REGISTRYINDEX, "CoreImports");
 	LuaObjectBase::CreateObject(l_methods, 0, 0);
 	lua_setfield(l, -2, "Serializer");
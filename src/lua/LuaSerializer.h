@@ -24,6 +24,12 @@ public:
 	void SaveComponents(Json &jsonObj, Space *space);
 	void LoadComponents(const Json &jsonObj, Space *space);
 
+	// The string table shared by everything pickled into a save, written
+	// after all Lua data and loaded before any. Loading also takes on the
+	// saved table ids.
+	void SaveIdentities(Json &jsonObj);
+	void LoadIdentities(const Json &jsonObj);
+
 	void SavePersistent(Json &jsonObj);
 	void LoadPersistent(const Json &jsonObj);
 
@@ -37,6 +43,11 @@ private:
 
 	static void pickle_json(lua_State *l, int idx, Json &out, const std::string &key = "");
 	static void unpickle_json(lua_State *l, const Json &value);
+
+	// where in the tree being pickled a value is, for error messages
+	struct KeyPath;
+	static void pickle_value(lua_State *l, int idx, Json &out, const KeyPath &path);
+	static void unpickle_value(lua_State *l, const Json &value);
 };
 
 #endif
@@ -10,7 +10,9 @@
 #include "HyperspaceCloud.h"
 #include "LuaBody.h"
 #include "LuaManager.h"
+#include "LuaMetaType.h"
 #include "LuaObject.h"
+#include "LuaRef.h"
 #include "LuaUtils.h"
 #include "LuaVector.h"
 #include "MathUtil.h"
@@ -18,6 +20,7 @@
 #include "Planet.h"
 #include "Player.h"
 #include "Ship.h"
+#include "ShipType.h"
 #include "Space.h"
 #include "SpaceStation.h"
 #include "profiler/Profiler.h"
@@ -211,6 +214,100 @@ static int l_space_spawn_ship(lua_State *l)
 	return 1;
 }
 
+/*
+ * Function: QueueSpawnShip
+ *
+ * Like <SpawnShip>, but the ship is created over the next few frames rather
+ * than straight away. Its model is loaded in the background first, and only
+ * a few ships are created each frame, so waves of arrivals don't stall the
+ * game.
+ *
+ * > Space.QueueSpawnShip(type, min, max, hyperspace, onSpawned)
+ *
+ * Parameters:
+ *
+ *   type - the name of the ship
+ *
+ *   min, max - distance range from the system centre, as for <SpawnShip>
+ *
+ *   hyperspace - hyperspace entry information as for <SpawnShip>, or nil
+ *
+ *   onSpawned - optional function, called with the new <Ship> once it
+ *               exists. It is not called if the player leaves the system
+ *               first.
+ *
+ * Example:
+ *
+ * > Space.QueueSpawnShip("eagle_lrf", 5, 6, nil, function (ship)
+ * >     ship:AIDockWith(station)
+ * > end)
+ *
+ * Availability:
+ *
+ *   2024
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_space_queue_spawn_ship(lua_State *l)
+{
+	if (!Pi::game)
+		luaL_error(l, "Game is not started");
+
+	LUA_DEBUG_START(l);
+
+	const std::string type = luaL_checkstring(l, 1);
+	const ShipType *shipType = ShipType::Get(type.c_str());
+	if (!shipType)
+		luaL_error(l, "Unknown ship type '%s'", type.c_str());
+
+	const float min_dist = luaL_checknumber(l, 2);
+	const float max_dist = luaL_checknumber(l, 3);
+
+	SystemPath *source = 0;
+	SystemPath *dest = 0;
+	double due = -1;
+	if (!lua_isnil(l, 4))
+		_unpack_hyperspace_args(l, 4, source, dest, due);
+	const bool hyperspace = source != nullptr;
+	// copied, the Lua objects may be gone by the time the ship is spawned
+	const SystemPath sourcePath = hyperspace ? *source : SystemPath();
+	const SystemPath destPath = hyperspace ? *dest : SystemPath();
+
+	LuaRef onSpawned;
+	if (!lua_isnoneornil(l, 5)) {
+		luaL_checktype(l, 5, LUA_TFUNCTION);
+		onSpawned = LuaRef(l, 5);
+	}
+
+	Space *space = Pi::game->GetSpace();
+	space->GetSpawnQueue().Queue(shipType->modelName, [=]() mutable {
+		Ship *ship = new Ship(type);
+		SystemPath src = sourcePath;
+		Body *thing = _maybe_wrap_ship_with_cloud(ship, hyperspace ? &src : nullptr, due);
+
+		thing->SetFrame(space->GetRootFrame());
+		if (!hyperspace)
+			thing->SetPosition(MathUtil::RandomPointOnSphere(min_dist, max_dist) * AU);
+		else
+			thing->SetPosition(space->GetHyperspaceExitPoint(sourcePath, destPath));
+		thing->SetVelocity(vector3d(0, 0, 0));
+		space->AddBody(thing);
+
+		if (onSpawned.IsValid()) {
+			lua_State *ls = onSpawned.GetLua();
+			onSpawned.PushCopyToStack();
+			LuaObject<Ship>::PushToLua(ship);
+			pi_lua_protected_call(ls, 1, 0);
+		}
+	});
+
+	LUA_DEBUG_END(l, 0);
+
+	return 0;
+}
+
 // functions from ShipAiCmd.cpp
 extern int CheckCollision(DynamicBody *dBody, const vector3d &pathdir, double pathdist, double targAlt, double endvel, double r);
 extern double MaxEffectRad(const Body *body, Propulsion *prop);
@@ -1131,6 +1228,149 @@ static int l_space_get_bodies_near(lua_State *l)
 	return 1;
 }
 
+/*
+ * Function: QueryBodies
+ *
+ * Get the <Body> objects that match a filter along with the values a HUD
+ * usually wants from each of them, in a single call
+ *
+ * > results, count = Space.QueryBodies(relTo, [dist], [type], [results])
+ *
+ * Parameters:
+ *
+ *   relTo - the reference body for positions, velocities and distances
+ *
+ *   dist - optional - the maximum distance from the reference body another
+ *          body can be, or nil for every body in the system
+ *
+ *   type - optional - a PhysicsObjectType enum value
+ *          (one of Constants.PhysicsObjectType) acting as a filter on the type
+ *          of the returned bodies
+ *
+ *   results - optional - the table a previous call returned, to be filled in
+ *             again. Its entry tables and vectors are reused, so nothing
+ *             taken from it must be kept across calls.
+ *
+ * Return:
+ *
+ *   results - an array with an entry for each matching body, other than
+ *             relTo itself. Each is a table with the fields 'body', 'label',
+ *             'type' (a PhysicsObjectType), 'position' and 'velocity'
+ *             (vectors relative to relTo) and 'distance'.
+ *
+ *   count - the number of entries in results
+ *
+ * Example:
+ *
+ * > -- refresh the radar contacts each frame without making new tables
+ * > contacts = Space.QueryBodies(Game.player, radarRange, "SHIP", contacts)
+ * > for _, contact in ipairs(contacts) do
+ * >     drawBlip(contact.position, contact.label)
+ * > end
+ *
+ * Availability:
+ *
+ *   2024
+ *
+ * Status:
+ *
+ *   experimental
+ */
+
+// set t[name] to v, reusing the vector already there if there is one
+static void set_vector_field(lua_State *l, int table, const char *name, const vector3d &v)
+{
+	lua_getfield(l, table, name);
+	vector3d *vec = static_cast<vector3d *>(LuaMetaTypeBase::TestUserdata(l, -1, LuaVector::TypeName));
+	lua_pop(l, 1);
+
+	if (vec) {
+		*vec = v;
+	} else {
+		LuaVector::PushToLua(l, v);
+		lua_setfield(l, table, name);
+	}
+}
+
+static int l_space_query_bodies(lua_State *l)
+{
+	PROFILE_SCOPED()
+
+	if (!Pi::game) {
+		luaL_error(l, "Game is not started");
+		return 0;
+	}
+
+	LUA_DEBUG_START(l);
+
+	Body *relTo = LuaPull<Body *>(l, 1);
+	const bool limited = !lua_isnoneornil(l, 2);
+	const double dist = limited ? LuaPull<double>(l, 2) : 0.0;
+	const double distSqr = dist * dist;
+
+	ObjectType filterBodyType = LuaPull<ObjectType>(l, 3, ObjectType::BODY);
+	bool filter = filterBodyType != ObjectType::BODY;
+
+	if (lua_istable(l, 4))
+		lua_pushvalue(l, 4);
+	else
+		lua_newtable(l);
+	const int results = lua_gettop(l);
+
+	int idx = 0;
+	auto addBody = [&](Body *b) {
+		if (b == relTo || (filter && !b->IsType(filterBodyType)))
+			return;
+
+		const vector3d pos = b->GetPositionRelTo(relTo);
+		const double lengthSqr = pos.LengthSqr();
+		if (limited && lengthSqr > distSqr)
+			return;
+
+		lua_rawgeti(l, results, ++idx);
+		if (!lua_istable(l, -1)) {
+			lua_pop(l, 1);
+			lua_newtable(l);
+			lua_pushvalue(l, -1);
+			lua_rawseti(l, results, idx);
+		}
+		const int entry = lua_gettop(l);
+
+		LuaObject<Body>::PushToLua(b);
+		lua_setfield(l, entry, "body");
+		LuaPush(l, b->GetLabel());
+		lua_setfield(l, entry, "label");
+		LuaPush(l, b->GetType());
+		lua_setfield(l, entry, "type");
+		set_vector_field(l, entry, "position", pos);
+		set_vector_field(l, entry, "velocity", b->GetVelocityRelTo(relTo));
+		LuaPush(l, sqrt(lengthSqr));
+		lua_setfield(l, entry, "distance");
+
+		lua_pop(l, 1);
+	};
+
+	if (limited) {
+		for (Body *b : Pi::game->GetSpace()->GetBodiesMaybeNear(relTo, dist))
+			addBody(b);
+	} else {
+		for (Body *b : Pi::game->GetSpace()->GetBodies())
+			addBody(b);
+	}
+
+	// drop whatever is left over from a longer previous result
+	for (int i = int(lua_rawlen(l, results)); i > idx; i--) {
+		lua_pushnil(l);
+		lua_rawseti(l, results, i);
+	}
+
+	lua_pushinteger(l, idx);
+
+	LUA_DEBUG_END(l, 2);
+
+	return 2;
+}
+
 static int l_space_dump_frames(lua_State *l)
 {
 	if (!Pi::game) {
@@ -1169,6 +1409,7 @@ void LuaSpace::Register()
 
 	static const luaL_Reg l_methods[] = {
 		{ "SpawnShip", l_space_spawn_ship },
+		{ "QueueSpawnShip", l_space_queue_spawn_ship },
 		{ "SpawnShipNear", l_space_spawn_ship_near },
 		{ "SpawnShipDocked", l_space_spawn_ship_docked },
 		{ "SpawnShipParked", l_space_spawn_ship_parked },
@@ -1183,6 +1424,7 @@ void LuaSpace::Register()
 		{ "GetNumBodies", l_space_get_num_bodies },
 		{ "GetBodies", l_space_get_bodies },
 		{ "GetBodiesNear", l_space_get_bodies_near },
+		{ "QueryBodies", l_space_query_bodies },
 
 		{ "DbgDumpFrames", l_space_dump_frames },
 		{ 0, 0 }
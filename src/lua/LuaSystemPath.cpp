@@ -12,6 +12,10 @@
 #include "galaxy/StarSystem.h"
 #include "galaxy/SystemPath.h"
 
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
 /*
  * Class: SystemPath
  *
@@ -396,6 +400,124 @@ static int l_sbodypath_get_system_body(lua_State *l)
 	return 1;
 }
 
+// Pulls the array of paths at index and finds the system of each. Scripts
+// pass many paths into the same few systems, so the paths are taken in system
+// order and each system is looked up once.
+static void pull_star_systems(lua_State *l, int index, const char *func, std::vector<SystemPath> &paths, std::vector<RefCountedPtr<StarSystem>> &systems)
+{
+	luaL_checktype(l, index, LUA_TTABLE);
+	const int count = int(lua_rawlen(l, index));
+	paths.resize(count);
+	for (int i = 0; i < count; i++) {
+		lua_rawgeti(l, index, i + 1);
+		const SystemPath *path = LuaObject<SystemPath>::GetFromLua(-1);
+		if (!path)
+			luaL_error(l, "%s: paths[%d] is not a SystemPath", func, i + 1);
+		if (path->IsSectorPath())
+			luaL_error(l, "%s: paths[%d] does not refer to a system", func, i + 1);
+		paths[i] = *path;
+		lua_pop(l, 1);
+	}
+
+	std::vector<int> order(count);
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](int a, int b) {
+		return SystemPath::LessSystemOnly()(paths[a], paths[b]);
+	});
+
+	Galaxy *galaxy = Pi::game->GetGalaxy().Get();
+	systems.resize(count);
+	for (int i = 0; i < count; i++) {
+		const int current = order[i];
+		if (i > 0 && paths[order[i - 1]].IsSameSystem(paths[current]))
+			systems[current] = systems[order[i - 1]];
+		else
+			systems[current] = galaxy->GetStarSystem(paths[current]);
+	}
+}
+
+/*
+ * Function: GetStarSystems
+ *
+ * Get the <StarSystem> objects for many paths at once
+ *
+ * > systems = SystemPath.GetStarSystems(paths)
+ *
+ * This is the same as calling <GetStarSystem> on each path, but looks up each
+ * system only once, however many of the paths point into it.
+ *
+ * Parameters:
+ *
+ *   paths - an array of system or body <SystemPaths>
+ *
+ * Return:
+ *
+ *   systems - an array of the <StarSystem> of each path, in the same order
+ *
+ * Availability:
+ *
+ *   2024
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_sbodypath_get_star_systems(lua_State *l)
+{
+	std::vector<SystemPath> paths;
+	std::vector<RefCountedPtr<StarSystem>> systems;
+	pull_star_systems(l, 1, "SystemPath.GetStarSystems()", paths, systems);
+
+	lua_createtable(l, int(systems.size()), 0);
+	for (size_t i = 0; i < systems.size(); i++) {
+		LuaObject<StarSystem>::PushToLua(systems[i].Get());
+		lua_rawseti(l, -2, int(i + 1));
+	}
+	return 1;
+}
+
+/*
+ * Function: GetSystemBodies
+ *
+ * Get the <SystemBody> objects for many paths at once
+ *
+ * > bodies = SystemPath.GetSystemBodies(paths)
+ *
+ * This is the same as calling <GetSystemBody> on each path, but looks up each
+ * system only once, however many of the paths point into it.
+ *
+ * Parameters:
+ *
+ *   paths - an array of body <SystemPaths>
+ *
+ * Return:
+ *
+ *   bodies - an array of the <SystemBody> of each path, in the same order
+ *
+ * Availability:
+ *
+ *   2024
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_sbodypath_get_system_bodies(lua_State *l)
+{
+	std::vector<SystemPath> paths;
+	std::vector<RefCountedPtr<StarSystem>> systems;
+	pull_star_systems(l, 1, "SystemPath.GetSystemBodies()", paths, systems);
+
+	lua_createtable(l, int(paths.size()), 0);
+	for (size_t i = 0; i < paths.size(); i++) {
+		if (!paths[i].IsBodyPath())
+			return luaL_error(l, "SystemPath.GetSystemBodies(): paths[%d] does not refer to a body", int(i + 1));
+		LuaObject<SystemBody>::PushToLua(systems[i]->GetBodyByPath(paths[i]));
+		lua_rawseti(l, -2, int(i + 1));
+	}
+	return 1;
+}
+
 static int l_sbodypath_is_body_path(lua_State *l)
 {
 	SystemPath *path = LuaObject<SystemPath>::CheckFromLua(1);
@@ -635,6 +757,8 @@ void LuaObject<SystemPath>::RegisterClass()
 
 		{ "GetStarSystem", l_sbodypath_get_star_system },
 		{ "GetSystemBody", l_sbodypath_get_system_body },
+		{ "GetStarSystems", l_sbodypath_get_star_systems },
+		{ "GetSystemBodies", l_sbodypath_get_system_bodies },
 		{ "IsSystemPath", l_sbodypath_is_system_path },
 		{ "IsSectorPath", l_sbodypath_is_sector_path },
 		{ "IsBodyPath", l_sbodypath_is_body_path },
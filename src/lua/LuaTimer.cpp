@@ -11,7 +11,8 @@
 
 #include <algorithm>
 
-LuaTimer::LuaTimer()
+LuaTimer::LuaTimer() :
+	m_nextOrder(0)
 {
 	m_called.reserve(8);
 }
@@ -22,15 +23,8 @@ LuaTimer::~LuaTimer()
 
 void LuaTimer::Insert(double at, int callbackId, bool repeats)
 {
-	CallInfo info { at, callbackId, repeats };
-
-	// Keep the queue sorted when inserting new elements.
-	// This is O(log N) + O(N/2) worst-case
-	auto iter = std::lower_bound(m_timeouts.cbegin(), m_timeouts.cend(), info, [](const CallInfo &timeout, const CallInfo &val) {
-		return timeout.at < val.at;
-	});
-
-	m_timeouts.insert(iter, std::move(info));
+	m_timeouts.push_back({ at, m_nextOrder++, callbackId, repeats });
+	std::push_heap(m_timeouts.begin(), m_timeouts.end());
 }
 
 void LuaTimer::RemoveAll()
@@ -51,10 +45,12 @@ void LuaTimer::Tick()
 
 	double now = Pi::game->GetTime();
 
-	// Move called timeouts out of the list into our scratch buffer
+	// Move called timeouts out of the heap into our scratch buffer, earliest
+	// first
 	while (!m_timeouts.empty() && m_timeouts.front().at <= now) {
-		m_called.push_back(m_timeouts.front());
-		m_timeouts.pop_front();
+		std::pop_heap(m_timeouts.begin(), m_timeouts.end());
+		m_called.push_back(m_timeouts.back());
+		m_timeouts.pop_back();
 	}
 
 	if (m_called.empty())
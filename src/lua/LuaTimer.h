@@ -8,7 +8,9 @@
 #include "LuaManager.h"
 #include "JsonFwd.h"
 
-#include <deque>
+#include <SDL_stdinc.h>
+
+#include <vector>
 
 class LuaTimer : public DeleteEmitter {
 public:
@@ -30,12 +32,23 @@ private:
 	 */
 	struct CallInfo {
 		double at;
+		Uint64 order; // timeouts due at the same time run in the order they were set
 		int callbackId;
 		bool repeats;
+
+		// the heap keeps the greatest element on top, so the earliest must
+		// compare greatest
+		bool operator<(const CallInfo &other) const
+		{
+			return at != other.at ? at > other.at : order > other.order;
+		}
 	};
 
-	// Queue of tracked 'timeout' entries
-	std::deque<CallInfo> m_timeouts;
+	// Binary min-heap of tracked 'timeout' entries, so that setting a timeout
+	// and taking the due ones off are O(log N) however many are pending, and
+	// a tick under time acceleration only visits the ones it passes
+	std::vector<CallInfo> m_timeouts;
+	Uint64 m_nextOrder;
 	// Scratch buffer for timeouts that elapsed this update
 	std::vector<CallInfo> m_called;
 };
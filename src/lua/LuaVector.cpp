@@ -15,6 +15,9 @@ void pi_lua_generic_pull(lua_State *l, int index, vector3d *&out)
 
 vector3d construct_vec3(lua_State *L, int index)
 {
+	if (const vector3d *vec3 = LuaVector::GetFromLua(L, index))
+		return *vec3;
+
 	const vector2d *vec2 = LuaVector2::GetFromLua(L, index);
 	double x, y, z;
 	if (vec2 != nullptr) {
@@ -40,6 +43,7 @@ static int l_vector_new(lua_State *L)
 
 /*
 	Construct a new vector from:
+	- another vector3
 	- one double
 	- three doubles x, y, z
 	- vector2 and an optional double
@@ -122,6 +126,64 @@ static int l_vector_unm(lua_State *L)
 	return 1;
 }
 
+// In-place counterparts of the arithmetic metamethods. These modify and
+// return their first argument instead of allocating a new userdata, so hot
+// loops can accumulate into a scratch vector without feeding the GC:
+//   acc:addInPlace(v):mulInPlace(0.5)
+
+static int l_vector_add_in_place(lua_State *L)
+{
+	vector3d *a = LuaVector::CheckFromLua(L, 1);
+	*a += *LuaVector::CheckFromLua(L, 2);
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int l_vector_sub_in_place(lua_State *L)
+{
+	vector3d *a = LuaVector::CheckFromLua(L, 1);
+	*a -= *LuaVector::CheckFromLua(L, 2);
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int l_vector_mul_in_place(lua_State *L)
+{
+	vector3d *a = LuaVector::CheckFromLua(L, 1);
+	if (lua_isnumber(L, 2))
+		*a *= lua_tonumber(L, 2);
+	else
+		*a = *a * *LuaVector::CheckFromLua(L, 2);
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int l_vector_div_in_place(lua_State *L)
+{
+	vector3d *a = LuaVector::CheckFromLua(L, 1);
+	*a /= luaL_checknumber(L, 2);
+	lua_settop(L, 1);
+	return 1;
+}
+
+// a += b * s, the usual integration step
+static int l_vector_add_scaled_in_place(lua_State *L)
+{
+	vector3d *a = LuaVector::CheckFromLua(L, 1);
+	const vector3d *b = LuaVector::CheckFromLua(L, 2);
+	*a += *b * luaL_checknumber(L, 3);
+	lua_settop(L, 1);
+	return 1;
+}
+
+static int l_vector_normalize_in_place(lua_State *L)
+{
+	vector3d *a = LuaVector::CheckFromLua(L, 1);
+	*a = a->NormalizedSafe();
+	lua_settop(L, 1);
+	return 1;
+}
+
 static int l_vector_new_index(lua_State *L)
 {
 	vector3d *v = LuaVector::CheckFromLua(L, 1);
@@ -140,8 +202,7 @@ static int l_vector_new_index(lua_State *L)
 	} else {
 		luaL_error(L, "Expected Vector3, but type is '%s'", luaL_typename(L, 2));
 	}
-	LuaVector::PushToLua(L, *v);
-	return 1;
+	return 0;
 }
 
 static int l_vector_index(lua_State *L)
@@ -203,6 +264,11 @@ static bool _deserialize_vector3(lua_State *l, const Json &out)
 	return true;
 }
 
+// The metatable is also stored in the registry under this key's address, so
+// pushing and checking a vector is a single raw lookup instead of going
+// through LuaMetaTypes by name.
+static const char s_metatableKey = 0;
+
 const char LuaVector::LibName[] = "Vector3";
 const char LuaVector::TypeName[] = "Vector3";
 
@@ -222,11 +288,19 @@ void LuaVector::Register(lua_State *L)
 		.AddFunction("length", &vector3d::Length)
 		.AddFunction("cross", &vector3d::Cross)
 		.AddFunction("dot", &vector3d::Dot)
+		.AddFunction("addInPlace", &l_vector_add_in_place)
+		.AddFunction("subInPlace", &l_vector_sub_in_place)
+		.AddFunction("mulInPlace", &l_vector_mul_in_place)
+		.AddFunction("divInPlace", &l_vector_div_in_place)
+		.AddFunction("addScaledInPlace", &l_vector_add_scaled_in_place)
+		.AddFunction("normalizeInPlace", &l_vector_normalize_in_place)
 		.StopRecording();
 
 	// set the meta functions
 	metaType.GetMetatable();
 	luaL_setfuncs(L, l_vector_meta, 0);
+	lua_pushvalue(L, -1);
+	lua_rawsetp(L, LUA_REGISTRYINDEX, &s_metatableKey);
 	// hide the metatable to thwart crazy exploits
 	lua_pushboolean(L, 0);
 	lua_setfield(L, -2, "__metatable");
@@ -243,17 +317,30 @@ void LuaVector::Register(lua_State *L)
 vector3d *LuaVector::PushNewToLua(lua_State *L)
 {
 	vector3d *ptr = static_cast<vector3d *>(lua_newuserdata(L, sizeof(vector3d)));
-	LuaMetaTypeBase::GetMetatableFromName(L, LuaVector::TypeName);
+	lua_rawgetp(L, LUA_REGISTRYINDEX, &s_metatableKey);
 	lua_setmetatable(L, -2);
 	return ptr;
 }
 
 const vector3d *LuaVector::GetFromLua(lua_State *L, int idx)
 {
-	return static_cast<vector3d *>(LuaMetaTypeBase::TestUserdata(L, idx, LuaVector::TypeName));
+	void *p = lua_touserdata(L, idx);
+	if (p != nullptr && lua_getmetatable(L, idx)) {
+		lua_rawgetp(L, LUA_REGISTRYINDEX, &s_metatableKey);
+		const bool isVector = lua_rawequal(L, -1, -2);
+		lua_pop(L, 2);
+		if (isVector)
+			return static_cast<vector3d *>(p);
+	}
+	return nullptr;
 }
 
 vector3d *LuaVector::CheckFromLua(lua_State *L, int idx)
 {
-	return static_cast<vector3d *>(LuaMetaTypeBase::CheckUserdata(L, idx, LuaVector::TypeName));
+	const vector3d *v = GetFromLua(L, idx);
+	if (!v) {
+		const char *msg = lua_pushfstring(L, "%s expected, got %s", LuaVector::TypeName, luaL_typename(L, idx));
+		luaL_argerror(L, idx, msg);
+	}
+	return const_cast<vector3d *>(v);
 }
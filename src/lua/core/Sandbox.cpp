@@ -3,6 +3,7 @@
 
 #include "CoreFwdDecl.h"
 #include "FileSystem.h"
+#include "LuaChunkCache.h"
 #include "LuaUtils.h"
 #include "core/Log.h"
 #include "utils.h"
@@ -302,10 +303,15 @@ int pi_lua_loadfile(lua_State *l, const FileSystem::FileData &code)
 
 	const StringRange source = code.AsStringRange().StripUTF8BOM();
 	const std::string &path(code.GetInfo().GetPath());
-	bool trusted = code.GetInfo().GetSource().IsTrusted();
-	const std::string chunkName = (trusted ? "@[T] " : "@") + path;
+	const std::string chunkName = LuaChunkCache::ChunkName(code.GetInfo());
 
-	return luaL_loadbuffer(l, source.begin, source.Size(), chunkName.c_str());
+	if (LuaChunkCache::Load(l, { source.begin, source.Size() }, chunkName, path))
+		return LUA_OK;
+
+	const int ret = luaL_loadbuffer(l, source.begin, source.Size(), chunkName.c_str());
+	if (ret == LUA_OK)
+		LuaChunkCache::Store(l, { source.begin, source.Size() }, chunkName);
+	return ret;
 }
 
 void pi_lua_dofile(lua_State *l, const FileSystem::FileData &code, int nret)
@@ -2,6 +2,7 @@
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
 #include "Game.h"
+#include "GameConfig.h"
 #include "Pi.h"
 #include "buildopts.h"
 #include "core/OS.h"
@@ -20,7 +21,11 @@
 enum RunMode {
 	MODE_GAME,
 	MODE_GALAXYDUMP,
+	MODE_GALAXYBAKE,
 	MODE_START_AT,
+	MODE_SIMBENCH,
+	MODE_FLYTHROUGH,
+	MODE_REPLAY,
 	MODE_VERSION,
 	MODE_USAGE,
 	MODE_USAGE_ERROR
@@ -56,6 +61,26 @@ extern "C" int main(int argc, char **argv)
 			goto start;
 		}
 
+		if (modeopt == "galaxybake" || modeopt == "gb") {
+			mode = MODE_GALAXYBAKE;
+			goto start;
+		}
+
+		if (starts_with(modeopt, "simbench") || modeopt == "sb" || starts_with(modeopt, "sb=")) {
+			mode = MODE_SIMBENCH;
+			goto start;
+		}
+
+		if (modeopt == "flythrough" || modeopt == "ft") {
+			mode = MODE_FLYTHROUGH;
+			goto start;
+		}
+
+		if (modeopt == "replay" || modeopt == "rp") {
+			mode = MODE_REPLAY;
+			goto start;
+		}
+
 		if (modeopt.find("startat", 0, 7) != std::string::npos ||
 			modeopt.find("sa", 0, 2) != std::string::npos) {
 			mode = MODE_START_AT;
@@ -84,9 +109,10 @@ start:
 	SystemPath startPath(0, 0, 0, 0, 0);
 
 	switch (mode) {
-	case MODE_GALAXYDUMP: {
+	case MODE_GALAXYDUMP:
+	case MODE_GALAXYBAKE: {
 		if (argc < 3) {
-			Output("pioneer: galaxy dump requires a filename\n");
+			Output("pioneer: %s requires a filename\n", mode == MODE_GALAXYDUMP ? "galaxy dump" : "galaxy bake");
 			break;
 		}
 		filename = argv[pos];
@@ -121,9 +147,20 @@ start:
 		}
 		// fallthrough
 	}
-	case MODE_START_AT: {
+	case MODE_FLYTHROUGH:
+	case MODE_REPLAY:
+	case MODE_START_AT:
+	case MODE_SIMBENCH: {
+		if (mode == MODE_FLYTHROUGH || mode == MODE_REPLAY) {
+			if (argc < 3) {
+				Output("pioneer: %s\n", mode == MODE_FLYTHROUGH ? "flythrough requires a camera path file" : "replay requires a replay file");
+				break;
+			}
+			filename = argv[pos];
+			++pos;
+		}
 		// fallthrough protect
-		if (mode == MODE_START_AT) {
+		if (mode == MODE_START_AT || mode == MODE_SIMBENCH) {
 			// try to get start planet number
 			std::vector<std::string> keyValue = SplitString(modeopt, "=").to_vector<std::string>();
 
@@ -147,7 +184,8 @@ start:
 			else
 				startPath = SystemPath(0, 0, 0, 0, 18);
 			// set usual mode
-			mode = MODE_GAME;
+			if (mode == MODE_START_AT)
+				mode = MODE_GAME;
 		}
 		// fallthrough
 	}
@@ -174,9 +212,28 @@ start:
 			}
 		}
 
-		Pi::Init(options, mode == MODE_GALAXYDUMP);
+		if (mode == MODE_SIMBENCH) {
+			// run without a GPU unless asked otherwise
+			options.emplace("RendererName", "Dummy");
+			if (options["RendererName"] == "Dummy")
+				SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+		}
+
+		Pi::Init(options, mode == MODE_GALAXYDUMP || mode == MODE_GALAXYBAKE || mode == MODE_SIMBENCH || mode == MODE_FLYTHROUGH);
 
-		if (mode == MODE_GAME) {
+		if (mode == MODE_FLYTHROUGH) {
+			Pi::GetApp()->QueueFlythroughBenchmark(filename);
+			Pi::GetApp()->Run();
+		} else if (mode == MODE_SIMBENCH) {
+			// time acceleration levels go from 1 (1x) to 5 (10000x)
+			const double hours = Pi::config->Float("BenchmarkHours", 24.0f);
+			const int timeAccel = Pi::config->Int("BenchmarkTimeAccel", 4);
+			Pi::GetApp()->QueueSimBenchmark(startPath, Pi::config->String("BenchmarkSave"), hours, timeAccel);
+			Pi::GetApp()->Run();
+		} else if (mode == MODE_REPLAY) {
+			Pi::GetApp()->QueueReplay(filename);
+			Pi::GetApp()->Run();
+		} else if (mode == MODE_GAME) {
 			if (startPath != SystemPath(0, 0, 0, 0, 0))
 				Pi::GetApp()->SetStartPath(startPath);
 
@@ -200,6 +257,21 @@ start:
 				Output("pioneer: writing to \"%s\" failed: %s\n", filename.c_str(), strerror(errno));
 			}
 			// We do not need to delete `Pi::luaNameGen` or call Lua::Uninit() here because Pi::Uninit() already does that
+		} else if (mode == MODE_GALAXYBAKE) {
+			// names and populations need the same setup as the dump
+			Lua::Init(Pi::GetAsyncJobQueue());
+			Pi::luaNameGen = new LuaNameGen(Lua::manager);
+			LuaObject<SystemBody>::RegisterClass();
+			FILE *file = fopen(filename.c_str(), "wb");
+			if (file == nullptr) {
+				Output("pioneer: could not open \"%s\" for writing: %s\n", filename.c_str(), strerror(errno));
+				break;
+			}
+			RefCountedPtr<Galaxy> galaxy = GalaxyGenerator::Create();
+			const bool written = galaxy->Bake(file, sx, sy, sz, radius);
+			if (fclose(file) != 0 || !written) {
+				Output("pioneer: writing to \"%s\" failed: %s\n", filename.c_str(), strerror(errno));
+			}
 		}
 
 		Pi::Uninit();
@@ -224,8 +296,14 @@ start:
 			"available modes:\n"
 			"    -game        [-g]     game (default)\n"
 			"    -galaxydump  [-gd]    galaxy dumper\n"
+			"    -galaxybake  [-gb]    write sectors for data/galaxy_baked.bin\n"
 			"    -startat     [-sa]    skip main menu and start at Mars\n"
 			"    -startat=sp  [-sa=sp]  skip main menu and start at systempath x,y,z,si,bi\n"
+			"    -simbench    [-sb]    run the simulation headless and report its timings\n"
+			"    -simbench=sp [-sb=sp]  as above, starting at systempath x,y,z,si,bi\n"
+			"                          (options BenchmarkHours, BenchmarkTimeAccel, BenchmarkSave)\n"
+			"    -flythrough  [-ft] file  fly the camera along a path file and record frame times\n"
+			"    -replay      [-rp] file  play back a replay recorded with Ctrl+R and report frame times\n"
 			"    -version     [-v]     show version\n"
 			"    -help        [-h,-?]  this help\n");
 		break;
@@ -16,6 +16,7 @@
 #include "ModManager.h"
 #include "StringF.h"
 #include "core/OS.h"
+#include "core/TaskGraph.h"
 #include "graphics/Drawables.h"
 #include "graphics/Graphics.h"
 #include "graphics/Light.h"
@@ -27,43 +28,18 @@
 #include "scenegraph/BinaryConverter.h"
 #include "scenegraph/DumpVisitor.h"
 #include "scenegraph/FindNodeVisitor.h"
+#include "scenegraph/LOD.h"
+#include "scenegraph/MeshSimplifier.h"
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 #include <SDL.h>
 
 std::unique_ptr<GameConfig> s_config;
 std::unique_ptr<Graphics::Renderer> s_renderer;
 
-//#define USES_THREADS
-#ifdef USES_THREADS
-std::unique_ptr<AsyncJobQueue> asyncJobQueue;
-#endif
-
 static const std::string s_dummyPath("");
 
-// fwd decl'
-void RunCompiler(const std::string &modelName, const std::string &filepath, const bool bInPlace);
-
-// ********************************************************************************
-// Overloaded PureJob class to handle compiling each model
-// ********************************************************************************
-class CompileJob : public Job {
-public:
-	CompileJob(){};
-	CompileJob(const std::string &name, const std::string &path, const bool inPlace) :
-		m_name(name),
-		m_path(path),
-		m_inPlace(inPlace) {}
-
-	virtual void OnRun() override final { RunCompiler(m_name, m_path, m_inPlace); } // RUNS IN ANOTHER THREAD!! MUST BE THREAD SAFE!
-	virtual void OnFinish() override final {}
-	virtual void OnCancel() override final {}
-
-protected:
-	std::string m_name;
-	std::string m_path;
-	bool m_inPlace;
-};
-
 // ********************************************************************************
 // functions
 // ********************************************************************************
@@ -98,20 +74,159 @@ void SetupRenderer()
 	videoSettings.iconFile = OS::GetIconFilename();
 	videoSettings.title = "Model Compiler";
 	s_renderer.reset(Graphics::Init(videoSettings));
+}
 
-#ifdef USES_THREADS
-	// get threads up
-	Uint32 numThreads = s_config->Int("WorkerThreads");
-	const int numCores = OS::GetNumCores();
-	assert(numCores > 0);
-	if (numThreads == 0)
-		numThreads = std::max(Uint32(numCores), 1U); // this is a tool, we can use all of the cores for processing unlike Pioneer
-	asyncJobQueue.reset(new AsyncJobQueue(numThreads));
-	Output("started %d worker threads\n", numThreads);
-#endif
+// ********************************************************************************
+// LOD generation
+// ********************************************************************************
+// generated levels, as fractions of the triangles of the full detail geometry
+static const float s_lodRatios[] = { 0.5f, 0.25f, 0.125f };
+// geometry with fewer triangles than this isn't worth simplifying
+static const Uint32 MIN_LOD_TRIANGLES = 1000;
+// the largest error a generated level may have, as a fraction of the geometry's bounding radius
+static const float MAX_LOD_ERROR = 0.05f;
+// a level must drop at least this fraction of the triangles of the previous one
+static const float MIN_LOD_REDUCTION = 0.2f;
+
+class LODGeometryVisitor : public SceneGraph::NodeVisitor {
+public:
+	virtual void ApplyStaticGeometry(SceneGraph::StaticGeometry &g) override { geometry.push_back(&g); }
+	// authored levels are kept as they are; don't look inside
+	virtual void ApplyLOD(SceneGraph::LOD &) override { hasLODs = true; }
+
+	std::vector<SceneGraph::StaticGeometry *> geometry;
+	bool hasLODs = false;
+};
+
+// copies the vertices used by the indices into a new, compacted buffer
+static void AddSimplifiedMesh(SceneGraph::StaticGeometry *geom, const SceneGraph::StaticGeometry::Mesh &mesh, const std::vector<Uint32> &indices)
+{
+	Graphics::VertexBufferDesc vbDesc = mesh.vertexBuffer->GetDesc();
+	const Uint32 stride = vbDesc.stride;
+
+	std::vector<Uint32> remap(vbDesc.numVertices, ~0U);
+	Uint32 numVertices = 0;
+	for (Uint32 i : indices) {
+		if (remap[i] == ~0U)
+			remap[i] = numVertices++;
+	}
+
+	vbDesc.numVertices = numVertices;
+	RefCountedPtr<Graphics::VertexBuffer> vtxBuffer(s_renderer->CreateVertexBuffer(vbDesc));
+	const Uint8 *srcPtr = mesh.vertexBuffer->Map<Uint8>(Graphics::BUFFER_MAP_READ);
+	Uint8 *dstPtr = vtxBuffer->Map<Uint8>(Graphics::BUFFER_MAP_WRITE);
+	for (Uint32 i = 0; i < remap.size(); i++) {
+		if (remap[i] != ~0U)
+			memcpy(dstPtr + remap[i] * stride, srcPtr + i * stride, stride);
+	}
+	vtxBuffer->Unmap();
+	mesh.vertexBuffer->Unmap();
+
+	RefCountedPtr<Graphics::IndexBuffer> idxBuffer(s_renderer->CreateIndexBuffer(indices.size(), Graphics::BUFFER_USAGE_STATIC));
+	Uint32 *idxPtr = idxBuffer->Map(Graphics::BUFFER_MAP_WRITE);
+	for (Uint32 i = 0; i < indices.size(); i++)
+		idxPtr[i] = remap[indices[i]];
+	idxBuffer->Unmap();
+
+	geom->AddMesh(vtxBuffer, idxBuffer, mesh.material);
 }
 
-void RunCompiler(const std::string &modelName, const std::string &filepath, const bool bInPlace)
+// Replaces large geometry with a LOD node of simplified copies, the
+// coarsest first. Returns the number of levels generated.
+static Uint32 GenerateLODs(SceneGraph::StaticGeometry *geom)
+{
+	PROFILE_SCOPED()
+	using SceneGraph::StaticGeometry;
+
+	const Uint32 numMeshes = geom->GetNumMeshes();
+	std::vector<std::vector<vector3f>> positions(numMeshes);
+	std::vector<std::vector<Uint32>> indices(numMeshes);
+	Uint32 numIndices = 0;
+
+	for (Uint32 m = 0; m < numMeshes; m++) {
+		const StaticGeometry::Mesh &mesh = geom->GetMeshAt(m);
+		const Graphics::VertexBufferDesc &vbDesc = mesh.vertexBuffer->GetDesc();
+		const Uint32 posOffset = vbDesc.GetOffset(Graphics::ATTRIB_POSITION);
+
+		const Uint8 *vtxPtr = mesh.vertexBuffer->Map<Uint8>(Graphics::BUFFER_MAP_READ);
+		positions[m].resize(vbDesc.numVertices);
+		for (Uint32 i = 0; i < vbDesc.numVertices; i++)
+			positions[m][i] = *reinterpret_cast<const vector3f *>(vtxPtr + i * vbDesc.stride + posOffset);
+		mesh.vertexBuffer->Unmap();
+
+		const Uint32 *idxPtr = mesh.indexBuffer->Map(Graphics::BUFFER_MAP_READ);
+		indices[m].assign(idxPtr, idxPtr + mesh.indexBuffer->GetSize());
+		mesh.indexBuffer->Unmap();
+		numIndices += indices[m].size();
+	}
+
+	if (numIndices / 3 < MIN_LOD_TRIANGLES)
+		return 0;
+
+	const float radius = 0.5f * float((geom->m_boundingBox.max - geom->m_boundingBox.min).Length());
+	const float maxError = MAX_LOD_ERROR * radius;
+
+	// finest first
+	std::vector<std::pair<float, RefCountedPtr<StaticGeometry>>> levels;
+	std::vector<Uint32> simplified;
+	Uint32 prevIndices = numIndices;
+	for (const float ratio : s_lodRatios) {
+		RefCountedPtr<StaticGeometry> level(new StaticGeometry(s_renderer.get()));
+		level->m_boundingBox = geom->m_boundingBox;
+		level->SetNodeMask(geom->GetNodeMask());
+
+		float error = 0.0f;
+		Uint32 levelIndices = 0;
+		for (Uint32 m = 0; m < numMeshes; m++) {
+			error = std::max(error, SceneGraph::SimplifyMesh(positions[m], indices[m], Uint32(indices[m].size() * ratio), maxError, simplified));
+			if (simplified.empty())
+				continue;
+			levelIndices += simplified.size();
+			AddSimplifiedMesh(level.Get(), geom->GetMeshAt(m), simplified);
+		}
+
+		// stuck on the error limit or on seams, coarser levels won't get better
+		if (levelIndices > prevIndices * (1.0f - MIN_LOD_REDUCTION))
+			break;
+
+		prevIndices = levelIndices;
+		levels.emplace_back(error, level);
+	}
+
+	if (levels.empty())
+		return 0;
+
+	RefCountedPtr<StaticGeometry> keep(geom);
+	SceneGraph::LOD *lod = new SceneGraph::LOD(s_renderer.get());
+	geom->GetParent()->ReplaceChild(geom, lod);
+	for (auto it = levels.rbegin(); it != levels.rend(); ++it)
+		lod->AddSimplifiedLevel(it->first, it->second.Get());
+	lod->AddSimplifiedLevel(0.0f, geom);
+
+	return levels.size();
+}
+
+static void GenerateLODs(SceneGraph::Model *model)
+{
+	PROFILE_SCOPED()
+	LODGeometryVisitor visitor;
+	model->GetRoot()->Accept(visitor);
+	if (visitor.hasLODs)
+		return;
+
+	Uint32 numLevels = 0, numNodes = 0;
+	for (SceneGraph::StaticGeometry *geom : visitor.geometry) {
+		const Uint32 n = GenerateLODs(geom);
+		numLevels += n;
+		numNodes += n > 0;
+	}
+
+	if (numNodes > 0)
+		Output("Generated %u LOD levels for %u geometry nodes\n", numLevels, numNodes);
+}
+
+// compiles one model; batch mode runs this on several threads at once
+bool RunCompiler(const std::string &modelName, const std::string &filepath, const bool bInPlace)
 {
 	PROFILE_SCOPED()
 	Profiler::Timer timer;
@@ -131,19 +246,186 @@ void RunCompiler(const std::string &modelName, const std::string &filepath, cons
 		}
 	} catch (...) {
 		//minimal error handling, this is not expected to happen since we got this far.
-		return;
+		return false;
 	}
 
+	//models without authored detail levels get generated ones
+	GenerateLODs(model.get());
+
 	try {
 		const std::string DataPath = FileSystem::NormalisePath(filepath.substr(0, filepath.size() - 6));
 		SceneGraph::BinaryConverter bc(s_renderer.get());
 		bc.Save(modelName, DataPath, model.get(), bInPlace);
 	} catch (const CouldNotOpenFileException &) {
+		return false;
 	} catch (const CouldNotWriteToFileException &) {
+		return false;
 	}
 
 	timer.Stop();
 	Output("Compiling \"%s\" took: %lf\n", modelName.c_str(), timer.millicycles());
+	return true;
+}
+
+// ********************************************************************************
+// batch mode
+// ********************************************************************************
+// hashes of the sources of the models compiled by earlier batch runs, so
+// that unchanged models can be skipped
+static const std::string s_batchCacheFile("modelcompiler.cache");
+
+struct BatchModel {
+	std::string name;
+	std::string path;
+	// where the .sgm is written, and the key of its cache entry
+	std::string dataPath;
+	std::string key;
+
+	Uint64 hash = 0;
+	bool upToDate = false;
+	bool compiled = false;
+	double milliseconds = 0.0;
+};
+
+static Uint64 HashData(Uint64 hash, const char *data, size_t len)
+{
+	// FNV-1a, continued from the given hash
+	for (size_t i = 0; i < len; i++) {
+		hash ^= Uint8(data[i]);
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+// A hash of everything in the model's directory, which holds the .model
+// file and the meshes it refers to. Textures there are hashed too; they
+// don't end up in the .sgm, but telling them apart from the meshes isn't
+// worth the trouble.
+static Uint64 HashModelSources(const std::string &modelPath)
+{
+	PROFILE_SCOPED()
+	std::vector<std::string> paths;
+	const std::string dir = modelPath.substr(0, modelPath.find_last_of('/'));
+	for (FileSystem::FileEnumerator files(FileSystem::gameDataFiles, dir); !files.Finished(); files.Next()) {
+		if (files.Current().IsFile())
+			paths.push_back(files.Current().GetPath());
+	}
+	std::sort(paths.begin(), paths.end());
+
+	// a new format, or new processing of the meshes, needs a rebuild too
+	const std::string version = std::to_string(SceneGraph::SGM_VERSION) + " " PIONEER_VERSION;
+	Uint64 hash = HashData(0xcbf29ce484222325ULL, version.data(), version.size());
+	for (const std::string &path : paths) {
+		RefCountedPtr<FileSystem::FileData> data = FileSystem::gameDataFiles.ReadFile(path);
+		if (!data)
+			continue;
+		hash = HashData(hash, path.data(), path.size() + 1);
+		hash = HashData(hash, data->GetData(), data->GetSize());
+	}
+	return hash;
+}
+
+static std::map<std::string, Uint64> ReadBatchCache()
+{
+	std::map<std::string, Uint64> cache;
+	RefCountedPtr<FileSystem::FileData> data = FileSystem::userFiles.ReadFile(s_batchCacheFile);
+	if (!data)
+		return cache;
+
+	// one "<hash> <key>" line per model
+	std::istringstream in{ std::string(data->AsStringView()) };
+	std::string line;
+	while (std::getline(in, line)) {
+		const size_t space = line.find(' ');
+		if (space == std::string::npos)
+			continue;
+		cache[line.substr(space + 1)] = std::strtoull(line.substr(0, space).c_str(), nullptr, 16);
+	}
+	return cache;
+}
+
+static void WriteBatchCache(const std::map<std::string, Uint64> &cache)
+{
+	FILE *f = FileSystem::userFiles.OpenWriteStream(s_batchCacheFile, FileSystem::FileSourceFS::WRITE_TEXT);
+	if (!f) {
+		Output("Could not write %s\n", s_batchCacheFile.c_str());
+		return;
+	}
+	for (const auto &entry : cache)
+		fprintf(f, "%016llx %s\n", static_cast<unsigned long long>(entry.second), entry.first.c_str());
+	fclose(f);
+}
+
+static void RunBatch(std::vector<BatchModel> &models, const bool bInPlace, const bool force, Uint32 numThreads)
+{
+	PROFILE_SCOPED()
+	Profiler::Timer timer;
+	timer.Start();
+
+	std::map<std::string, Uint64> cache = ReadBatchCache();
+
+	// the main thread takes part while waiting, so one fewer worker
+	TaskGraph taskGraph;
+	taskGraph.SetWorkerThreads(std::max(numThreads, 1U) - 1);
+	Output("compiling %u models on %u threads\n", Uint32(models.size()), std::max(numThreads, 1U));
+	// models with many mesh files spread them over the idle threads too
+	SceneGraph::Loader::SetTaskGraph(&taskGraph);
+
+	// checking the hashes reads every source file, so it's done in the tasks too
+	TaskSet *taskSet = new TaskSet();
+	for (Uint32 i = 0; i < models.size(); i++) {
+		BatchModel &model = models[i];
+		model.dataPath = FileSystem::NormalisePath(model.path.substr(0, model.path.size() - 6));
+		model.key = (bInPlace ? "inplace:" : "user:") + model.dataPath;
+		auto cached = cache.find(model.key);
+		const Uint64 cachedHash = (cached != cache.end() && !force) ? cached->second : 0;
+
+		taskSet->AddTaskLambda({ i, i + 1 }, [&model, cachedHash, bInPlace](TaskRange) {
+			model.hash = HashModelSources(model.path);
+			if (cachedHash == model.hash && SceneGraph::BinaryConverter::IsSaved(model.dataPath, bInPlace)) {
+				model.upToDate = true;
+				return;
+			}
+
+			Profiler::Timer modelTimer;
+			modelTimer.Start();
+			model.compiled = RunCompiler(model.name, model.path, bInPlace);
+			modelTimer.Stop();
+			model.milliseconds = modelTimer.millicycles();
+		});
+	}
+
+	TaskSet::Handle handle = taskGraph.QueueTaskSet(taskSet);
+	taskGraph.WaitForTaskSet(handle);
+	SceneGraph::Loader::SetTaskGraph(nullptr);
+
+	// report and remember the results
+	Uint32 numUpToDate = 0, numCompiled = 0, numFailed = 0;
+	std::vector<const BatchModel *> compiled;
+	for (const BatchModel &model : models) {
+		if (model.upToDate) {
+			numUpToDate++;
+		} else if (model.compiled) {
+			numCompiled++;
+			compiled.push_back(&model);
+			cache[model.key] = model.hash;
+		} else {
+			numFailed++;
+			Output("Failed to compile \"%s\"\n", model.name.c_str());
+			cache.erase(model.key);
+		}
+	}
+	WriteBatchCache(cache);
+
+	std::sort(compiled.begin(), compiled.end(), [](const BatchModel *a, const BatchModel *b) {
+		return a->milliseconds > b->milliseconds;
+	});
+	Output("\n---\nModel compile times:\n");
+	for (const BatchModel *model : compiled)
+		Output("%10.1f ms  %s\n", model->milliseconds, model->name.c_str());
+
+	timer.Stop();
+	Output("%u compiled, %u up to date, %u failed in %.1f ms\n", numCompiled, numUpToDate, numFailed, timer.millicycles());
 }
 
 // ********************************************************************************
@@ -248,19 +530,29 @@ start:
 	case MODE_MODELBATCHEXPORT: {
 		// determine if we're meant to be writing these in the source directory
 		bool isInPlace = false;
-		if (argc > 2) {
-			std::string arg2 = argv[2];
-			isInPlace = (arg2 == "inplace" || arg2 == "true");
-
-			if (!isInPlace && !arg2.empty()) {
-				customDataDir = FileSystem::FileSourceFS(arg2);
-				FileSystem::gameDataFiles.AppendSource(&customDataDir);
-				isInPlace = true;
+		bool force = false;
+		Uint32 numThreads = 0;
+		for (int i = 2; i < argc; i++) {
+			const std::string arg = argv[i];
+			if (arg == "-force" || arg == "-f") {
+				force = true;
+			} else if (arg == "-j" && i + 1 < argc) {
+				numThreads = std::atoi(argv[++i]);
+			} else if (arg.size() > 2 && arg.compare(0, 2, "-j") == 0) {
+				numThreads = std::atoi(arg.c_str() + 2);
+			} else {
+				isInPlace = (arg == "inplace" || arg == "true");
+
+				if (!isInPlace && !arg.empty()) {
+					customDataDir = FileSystem::FileSourceFS(arg);
+					FileSystem::gameDataFiles.AppendSource(&customDataDir);
+					isInPlace = true;
+				}
 			}
 		}
 
 		// find all of the models
-		std::vector<std::pair<std::string, std::string>> list_model;
+		std::vector<BatchModel> list_model;
 		FileSystem::FileSource &fileSource = FileSystem::gameDataFiles;
 		for (FileSystem::FileEnumerator files(fileSource, "models", FileSystem::FileEnumerator::Recurse); !files.Finished(); files.Next()) {
 			const FileSystem::FileInfo &info = files.Current();
@@ -269,33 +561,22 @@ start:
 			//check it's the expected type
 			if (info.IsFile()) {
 				if (ends_with_ci(fpath, ".model")) { // store the path for ".model" files
-					list_model.push_back(std::make_pair(info.GetName().substr(0, info.GetName().size() - 6), fpath));
+					list_model.emplace_back();
+					list_model.back().name = info.GetName().substr(0, info.GetName().size() - 6);
+					list_model.back().path = fpath;
 				}
 			}
 		}
 
 		SetupRenderer();
 
-#ifndef USES_THREADS
-		for (auto &modelName : list_model) {
-			RunCompiler(modelName.first, modelName.second, isInPlace);
-		}
-#else
-		std::deque<Job::Handle> handles;
-		for (auto &modelName : list_model) {
-			handles.push_back(asyncJobQueue->Queue(new CompileJob(modelName.first, modelName.second, isInPlace)));
-		}
-
-		while (true) {
-			asyncJobQueue->FinishJobs();
-			bool hasJobs = false;
-			for (auto &handle : handles)
-				hasJobs |= handle.HasJob();
+		// this is a tool, we can use all of the cores for processing unlike Pioneer
+		if (numThreads == 0)
+			numThreads = s_config->Int("WorkerThreads");
+		if (numThreads == 0)
+			numThreads = std::max(OS::GetNumCores(), 1U);
 
-			if (!hasJobs)
-				break;
-		}
-#endif
+		RunBatch(list_model, isInPlace, force, numThreads);
 		break;
 	}
 
@@ -318,6 +599,8 @@ start:
 			"    -compile inplace  [-c ... inplace]  model compiler\n"
 			"    -batch            [-b]              batch mode output into users home/Pioneer directory\n"
 			"    -batch inplace    [-b inplace]      batch mode output into the source folder\n"
+			"    -batch ... -j N   [-b ... -jN]      batch mode on N threads (default: all cores)\n"
+			"    -batch ... -force [-b ... -f]       batch mode, also compiling unchanged models\n"
 			"    -version          [-v]              show version\n"
 			"    -help             [-h,-?]           this help\n");
 		break;
@@ -330,9 +613,6 @@ start:
 	Graphics::Uninit();
 	SDL_Quit();
 	FileSystem::Uninit();
-#ifdef USES_THREADS
-	asyncJobQueue.reset();
-#endif
 	//exit(0);
 
 	return 0;
@@ -0,0 +1,68 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "FileSourcePack.h"
+#include "FileSystem.h"
+#include "core/StringUtils.h"
+#include <SDL.h>
+#include <cstdio>
+#include <string>
+
+int info()
+{
+	printf(
+		"packdata - Pack the data directory into a single archive.\n"
+		"The game mounts data/data.pak ahead of the loose data files.\n"
+		"USAGE: packdata [--no-compress] <datadir> <output>\n");
+	return 1;
+}
+
+// leaves out what isn't installed (see the install rules in CMakeLists.txt)
+static bool SkipFile(const FileSystem::FileInfo &info)
+{
+	const std::string &path = info.GetPath();
+	const std::string name = info.GetName();
+	if (ends_with(name, ".pak") || starts_with(name, ".") || starts_with(name, "listdata.") || name == "Makefile.am")
+		return true;
+
+	// only the compiled models and their textures
+	if (starts_with(path, "models/"))
+		return !(ends_with(name, ".sgm") || ends_with(name, ".dds") || ends_with(name, ".png") || ends_with(name, ".ktx2"));
+
+	return false;
+}
+
+extern "C" int main(int argc, char **argv)
+{
+	bool compress = true;
+	int shift = 0;
+	if (argc > 1 && std::string(argv[1]) == "--no-compress") {
+		compress = false;
+		shift = 1;
+	}
+
+	if (argc != shift + 3) return info();
+	const std::string dataDir = argv[shift + 1];
+	const std::string outname = argv[shift + 2];
+
+	FileSystem::FileSourceFS source(dataDir);
+	if (!source.Lookup("").IsDir()) {
+		printf("Data directory %s could not be found.\n", dataDir.c_str());
+		return 1;
+	}
+
+	FILE *out = fopen(outname.c_str(), "wb");
+	if (!out) {
+		printf("Could not open %s for writing.\n", outname.c_str());
+		return 1;
+	}
+
+	const bool written = FileSystem::FileSourcePack::Write(source, out, compress, SkipFile);
+	if (fclose(out) != 0 || !written) {
+		printf("Writing %s failed.\n", outname.c_str());
+		std::remove(outname.c_str());
+		return 2;
+	}
+
+	return 0;
+}
@@ -4,6 +4,14 @@
 #include "perlin.h"
 #include <math.h>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PERLIN_SIMD_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PERLIN_SIMD_SSE2 1
+#endif
+
 /* Simplex.cpp
  *
  * Copyright 2007 Eliot Eshelman
@@ -202,6 +210,185 @@ double noise(const vector3d &p)
 	return 32.0 * (n0 + n1 + n2 + n3);
 }
 
+// =============================================================================
+// Batched simplex noise
+//
+// The floating point math below mirrors noise() above operation for
+// operation so that the batched results are bit-identical to the scalar ones
+// (neighbouring terrain patches must agree exactly along their edges). Only
+// the integer lattice hashing is done per-lane, as there is no cheap gather
+// for the permutation tables.
+
+#if defined(PERLIN_SIMD_AVX) || defined(PERLIN_SIMD_SSE2)
+
+namespace {
+#if defined(PERLIN_SIMD_AVX)
+	struct Lanes {
+		using V = __m256d;
+		static constexpr int WIDTH = 4;
+		static V load(const double *p) { return _mm256_loadu_pd(p); }
+		static void store(double *p, V v) { _mm256_storeu_pd(p, v); }
+		static V set1(double d) { return _mm256_set1_pd(d); }
+		static V add(V a, V b) { return _mm256_add_pd(a, b); }
+		static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+		static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+		static V and_(V a, V b) { return _mm256_and_pd(a, b); }
+		static V cmpgt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+		static V cmpge(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+		static V select(V mask, V a, V b) { return _mm256_blendv_pd(b, a, mask); }
+		static int movemask(V v) { return _mm256_movemask_pd(v); }
+	};
+#else
+	struct Lanes {
+		using V = __m128d;
+		static constexpr int WIDTH = 2;
+		static V load(const double *p) { return _mm_loadu_pd(p); }
+		static void store(double *p, V v) { _mm_storeu_pd(p, v); }
+		static V set1(double d) { return _mm_set1_pd(d); }
+		static V add(V a, V b) { return _mm_add_pd(a, b); }
+		static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+		static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+		static V and_(V a, V b) { return _mm_and_pd(a, b); }
+		static V cmpgt(V a, V b) { return _mm_cmpgt_pd(a, b); }
+		static V cmpge(V a, V b) { return _mm_cmpge_pd(a, b); }
+		static V select(V mask, V a, V b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+		static int movemask(V v) { return _mm_movemask_pd(v); }
+	};
+#endif
+
+	using V = Lanes::V;
+	constexpr int W = Lanes::WIDTH;
+
+	// contribution of one simplex corner, t = 0.6 - |d|^2
+	inline V corner(V t, V gx, V gy, V gz, V x, V y, V z)
+	{
+		const V mask = Lanes::cmpgt(t, Lanes::set1(0.0));
+		const V t2 = Lanes::mul(t, t);
+		const V dot = Lanes::add(Lanes::add(Lanes::mul(gx, x), Lanes::mul(gy, y)), Lanes::mul(gz, z));
+		return Lanes::and_(mask, Lanes::mul(Lanes::mul(t2, t2), dot));
+	}
+
+	inline V falloff(V x, V y, V z)
+	{
+		return Lanes::sub(Lanes::sub(Lanes::sub(Lanes::set1(0.6), Lanes::mul(x, x)), Lanes::mul(y, y)), Lanes::mul(z, z));
+	}
+
+	void noise_lanes(const double *px, const double *py, const double *pz, double *out)
+	{
+		const V x = Lanes::load(px);
+		const V y = Lanes::load(py);
+		const V z = Lanes::load(pz);
+
+		// Skew the input space to determine which simplex cell we're in
+		const V s = Lanes::mul(Lanes::add(Lanes::add(x, y), z), Lanes::set1(F3));
+		const V one = Lanes::set1(1.0);
+		const V zero = Lanes::set1(0.0);
+
+		double sel[3][W];
+		const V sx = Lanes::add(x, s), sy = Lanes::add(y, s), sz = Lanes::add(z, s);
+		Lanes::store(sel[0], Lanes::select(Lanes::cmpgt(sx, zero), sx, Lanes::sub(sx, one)));
+		Lanes::store(sel[1], Lanes::select(Lanes::cmpgt(sy, zero), sy, Lanes::sub(sy, one)));
+		Lanes::store(sel[2], Lanes::select(Lanes::cmpgt(sz, zero), sz, Lanes::sub(sz, one)));
+
+		// integer lattice coordinates, converted exactly as fastfloor() does
+		int ci[W], cj[W], ck[W];
+		double di[W], dj[W], dk[W], dsum[W];
+		for (int l = 0; l < W; l++) {
+			ci[l] = long(sel[0][l]);
+			cj[l] = long(sel[1][l]);
+			ck[l] = long(sel[2][l]);
+			di[l] = ci[l];
+			dj[l] = cj[l];
+			dk[l] = ck[l];
+			dsum[l] = ci[l] + cj[l] + ck[l];
+		}
+
+		const V t = Lanes::mul(Lanes::load(dsum), Lanes::set1(G3));
+		const V x0 = Lanes::sub(x, Lanes::sub(Lanes::load(di), t));
+		const V y0 = Lanes::sub(y, Lanes::sub(Lanes::load(dj), t));
+		const V z0 = Lanes::sub(z, Lanes::sub(Lanes::load(dk), t));
+
+		const V x_ge_y = Lanes::cmpge(x0, y0);
+		const V y_ge_z = Lanes::cmpge(y0, z0);
+		const V x_ge_z = Lanes::cmpge(x0, z0);
+		const int m_xy = Lanes::movemask(x_ge_y);
+		const int m_yz = Lanes::movemask(y_ge_z);
+		const int m_xz = Lanes::movemask(x_ge_z);
+
+		// Simplex offsets and hashed gradients for each corner, per lane
+		double off[6][W];
+		double grad[4][3][W];
+		for (int l = 0; l < W; l++) {
+			const int xy = (m_xy >> l) & 1, yz = (m_yz >> l) & 1, xz = (m_xz >> l) & 1;
+			const int i1 = xy & xz;
+			const int j1 = yz & (!xy);
+			const int k1 = (!xz) & (!yz);
+			const int i2 = xy | xz;
+			const int j2 = (!xy) | yz;
+			const int k2 = !(xz & yz);
+			off[0][l] = i1;
+			off[1][l] = j1;
+			off[2][l] = k1;
+			off[3][l] = i2;
+			off[4][l] = j2;
+			off[5][l] = k2;
+
+			const int ii = ci[l] & 255;
+			const int jj = cj[l] & 255;
+			const int kk = ck[l] & 255;
+			const int gi[4] = {
+				mod12[perm[ii + perm[jj + perm[kk]]]],
+				mod12[perm[ii + i1 + perm[jj + j1 + perm[kk + k1]]]],
+				mod12[perm[ii + i2 + perm[jj + j2 + perm[kk + k2]]]],
+				mod12[perm[ii + 1 + perm[jj + 1 + perm[kk + 1]]]]
+			};
+			for (int c = 0; c < 4; c++) {
+				grad[c][0][l] = grad3[gi[c]][0];
+				grad[c][1][l] = grad3[gi[c]][1];
+				grad[c][2][l] = grad3[gi[c]][2];
+			}
+		}
+
+		const V g3 = Lanes::set1(G3), g3m2 = Lanes::set1(G3mul2), g3m3 = Lanes::set1(G3mul3);
+		const V x1 = Lanes::add(Lanes::sub(x0, Lanes::load(off[0])), g3);
+		const V y1 = Lanes::add(Lanes::sub(y0, Lanes::load(off[1])), g3);
+		const V z1 = Lanes::add(Lanes::sub(z0, Lanes::load(off[2])), g3);
+		const V x2 = Lanes::add(Lanes::sub(x0, Lanes::load(off[3])), g3m2);
+		const V y2 = Lanes::add(Lanes::sub(y0, Lanes::load(off[4])), g3m2);
+		const V z2 = Lanes::add(Lanes::sub(z0, Lanes::load(off[5])), g3m2);
+		const V x3 = Lanes::add(Lanes::sub(x0, one), g3m3);
+		const V y3 = Lanes::add(Lanes::sub(y0, one), g3m3);
+		const V z3 = Lanes::add(Lanes::sub(z0, one), g3m3);
+
+		const V n0 = corner(falloff(x0, y0, z0), Lanes::load(grad[0][0]), Lanes::load(grad[0][1]), Lanes::load(grad[0][2]), x0, y0, z0);
+		const V n1 = corner(falloff(x1, y1, z1), Lanes::load(grad[1][0]), Lanes::load(grad[1][1]), Lanes::load(grad[1][2]), x1, y1, z1);
+		const V n2 = corner(falloff(x2, y2, z2), Lanes::load(grad[2][0]), Lanes::load(grad[2][1]), Lanes::load(grad[2][2]), x2, y2, z2);
+		const V n3 = corner(falloff(x3, y3, z3), Lanes::load(grad[3][0]), Lanes::load(grad[3][1]), Lanes::load(grad[3][2]), x3, y3, z3);
+
+		Lanes::store(out, Lanes::mul(Lanes::set1(32.0), Lanes::add(Lanes::add(Lanes::add(n0, n1), n2), n3)));
+	}
+} // namespace
+
+void noise(const double *x, const double *y, const double *z, double *out, size_t count)
+{
+	size_t idx = 0;
+	for (; idx + W <= count; idx += W)
+		noise_lanes(&x[idx], &y[idx], &z[idx], &out[idx]);
+
+	for (; idx < count; idx++)
+		out[idx] = noise(vector3d(x[idx], y[idx], z[idx]));
+}
+
+#else
+
+void noise(const double *x, const double *y, const double *z, double *out, size_t count)
+{
+	for (size_t idx = 0; idx < count; idx++)
+		out[idx] = noise(vector3d(x[idx], y[idx], z[idx]));
+}
+
+#endif
+
 #ifdef UNIT_TEST
 #include <stdio.h>
 #include <stdlib.h>
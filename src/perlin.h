@@ -5,7 +5,13 @@
 #define _PERLIN_H
 
 #include "vector3.h"
+#include <cstddef>
 
 double noise(const vector3d &p);
 
+// Evaluate raw simplex noise for count points given in structure-of-arrays
+// form. Results are identical to calling noise() on each point, but several
+// points are evaluated at once using SIMD where the target supports it.
+void noise(const double *x, const double *y, const double *z, double *out, size_t count);
+
 #endif /* _PERLIN_H */
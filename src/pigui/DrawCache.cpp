@@ -0,0 +1,172 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "DrawCache.h"
+
+#include "imgui/imgui_internal.h"
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace PiGui;
+
+// regions not drawn for this many frames are dropped
+static constexpr uint32_t MAX_IDLE_FRAMES = 300;
+
+bool DrawCache::Begin(const char *id, uint64_t version)
+{
+	ImGuiWindow *window = ImGui::GetCurrentWindow();
+	const ImGuiID regionId = ImGui::GetID(id);
+
+	auto iter = m_regions.find(regionId);
+	if (iter != m_regions.end() && iter->second.version == version) {
+		Region &region = iter->second;
+		region.lastFrame = m_frame;
+
+		if (!window->SkipItems) {
+			const ImVec2 pos = ImGui::GetCursorScreenPos();
+			Replay(region, window->DrawList, ImVec2(pos.x - region.origin.x, pos.y - region.origin.y));
+		}
+
+		ImGui::Dummy(region.size);
+		return false;
+	}
+
+	ImGui::BeginGroup();
+
+	ImDrawList *drawList = window->SkipItems ? nullptr : window->DrawList;
+	m_captures.push_back({ regionId, version, drawList,
+		drawList ? drawList->_Splitter._Current : 0,
+		drawList ? drawList->IdxBuffer.Size : 0,
+		drawList ? drawList->VtxBuffer.Size : 0,
+		ImGui::GetCursorScreenPos() });
+
+	return true;
+}
+
+void DrawCache::End()
+{
+	assert(!m_captures.empty());
+	const Capture capture = m_captures.back();
+	m_captures.pop_back();
+
+	ImGui::EndGroup();
+
+	ImGuiWindow *window = ImGui::GetCurrentWindow();
+	const ImRect rect(ImGui::GetItemRectMin(), ImGui::GetItemRectMax());
+
+	// content clipped away while recording would be missing from the replay,
+	// and the draw list is only comparable if it's still on the same channel
+	Region region;
+	const bool recordable = capture.drawList &&
+		window->DrawList == capture.drawList &&
+		capture.drawList->_Splitter._Current == capture.channel &&
+		window->ClipRect.Contains(rect);
+
+	if (!recordable || !Record(capture, rect.GetSize(), region)) {
+		m_regions.erase(capture.id);
+		return;
+	}
+
+	region.version = capture.version;
+	region.lastFrame = m_frame;
+	region.origin = capture.origin;
+	m_regions[capture.id] = std::move(region);
+}
+
+void DrawCache::NewFrame()
+{
+	m_frame++;
+
+	// a region left open by an error in the previous frame
+	m_captures.clear();
+
+	for (auto iter = m_regions.begin(); iter != m_regions.end();) {
+		if (m_frame - iter->second.lastFrame > MAX_IDLE_FRAMES)
+			iter = m_regions.erase(iter);
+		else
+			++iter;
+	}
+}
+
+void DrawCache::Clear()
+{
+	m_regions.clear();
+}
+
+// static
+bool DrawCache::Record(const Capture &capture, ImVec2 size, Region &region)
+{
+	PROFILE_SCOPED()
+	const ImDrawList *drawList = capture.drawList;
+	const int idxEnd = drawList->IdxBuffer.Size;
+	const int vtxEnd = drawList->VtxBuffer.Size;
+	if (idxEnd < capture.idxStart || vtxEnd < capture.vtxStart)
+		return false;
+
+	region.size = size;
+
+	// the command that was current at Begin() may have been extended, so take
+	// whatever part of each command falls within the recorded indices
+	for (const ImDrawCmd &cmd : drawList->CmdBuffer) {
+		const int begin = std::max(int(cmd.IdxOffset), capture.idxStart);
+		const int end = std::min(int(cmd.IdxOffset + cmd.ElemCount), idxEnd);
+		if (begin >= end)
+			continue;
+
+		if (cmd.UserCallback)
+			return false;
+
+		uint32_t vtxMin = UINT32_MAX;
+		uint32_t vtxMax = 0;
+		for (int idx = begin; idx < end; idx++) {
+			const uint32_t vtx = cmd.VtxOffset + drawList->IdxBuffer[idx];
+			if (vtx < uint32_t(capture.vtxStart) || vtx >= uint32_t(vtxEnd))
+				return false;
+
+			vtxMin = std::min(vtxMin, vtx);
+			vtxMax = std::max(vtxMax, vtx);
+		}
+
+		Segment &segment = region.segments.emplace_back();
+		segment.textureId = cmd.TextureId;
+		segment.clipRect = cmd.ClipRect;
+		segment.vertices.assign(drawList->VtxBuffer.Data + vtxMin, drawList->VtxBuffer.Data + vtxMax + 1);
+		segment.indices.reserve(end - begin);
+		for (int idx = begin; idx < end; idx++)
+			segment.indices.push_back(ImDrawIdx(cmd.VtxOffset + drawList->IdxBuffer[idx] - vtxMin));
+	}
+
+	return true;
+}
+
+// static
+void DrawCache::Replay(const Region &region, ImDrawList *drawList, ImVec2 offset)
+{
+	PROFILE_SCOPED()
+	for (const Segment &segment : region.segments) {
+		const ImVec4 &clip = segment.clipRect;
+		drawList->PushClipRect(ImVec2(clip.x + offset.x, clip.y + offset.y), ImVec2(clip.z + offset.x, clip.w + offset.y), true);
+		drawList->PushTextureID(segment.textureId);
+
+		const int numVertices = int(segment.vertices.size());
+		const int numIndices = int(segment.indices.size());
+		drawList->PrimReserve(numIndices, numVertices);
+
+		// read after reserving, which may have started a new vertex offset
+		const uint32_t base = drawList->_VtxCurrentIdx;
+		for (const ImDrawVert &vertex : segment.vertices) {
+			ImDrawVert &out = *drawList->_VtxWritePtr++;
+			out = vertex;
+			out.pos.x += offset.x;
+			out.pos.y += offset.y;
+		}
+		for (ImDrawIdx index : segment.indices)
+			*drawList->_IdxWritePtr++ = ImDrawIdx(base + index);
+		drawList->_VtxCurrentIdx += numVertices;
+
+		drawList->PopTextureID();
+		drawList->PopClipRect();
+	}
+}
@@ -0,0 +1,78 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include "imgui/imgui.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace PiGui {
+
+	/*
+	 * Retained draw data for UI regions whose content rarely changes.
+	 *
+	 * A region is marked with a version key. While the key stays the same,
+	 * Begin() appends the vertices and indices recorded the last time the
+	 * region was built to the current window's draw list, reserves the same
+	 * space in the layout, and returns false so the caller can skip building
+	 * it. When the key changes, or nothing is cached, Begin() returns true and
+	 * the caller builds the region as usual, then calls End() to record it.
+	 *
+	 * Replayed regions submit no items, so they should hold display-only
+	 * content such as text, images and custom drawing. The version key must
+	 * cover everything the content depends on apart from its position.
+	 */
+	class DrawCache {
+	public:
+		// Returns true if the region's content must be submitted, followed by
+		// a call to End()
+		bool Begin(const char *id, uint64_t version);
+		void End();
+
+		// Drop regions that haven't been drawn for a while
+		void NewFrame();
+
+		// Drop every region, e.g. when the font atlas is rebuilt
+		void Clear();
+
+		size_t GetNumRegions() const { return m_regions.size(); }
+
+	private:
+		// a run of indices sharing a texture and clip rect
+		struct Segment {
+			ImTextureID textureId;
+			ImVec4 clipRect;
+			std::vector<ImDrawVert> vertices;
+			std::vector<ImDrawIdx> indices; // relative to the first vertex
+		};
+
+		struct Region {
+			uint64_t version = 0;
+			uint32_t lastFrame = 0;
+			ImVec2 origin;
+			ImVec2 size;
+			std::vector<Segment> segments;
+		};
+
+		struct Capture {
+			ImGuiID id;
+			uint64_t version;
+			ImDrawList *drawList; // null if the region can't be recorded
+			int channel;
+			int idxStart;
+			int vtxStart;
+			ImVec2 origin;
+		};
+
+		static bool Record(const Capture &capture, ImVec2 size, Region &region);
+		static void Replay(const Region &region, ImDrawList *drawList, ImVec2 offset);
+
+		std::unordered_map<ImGuiID, Region> m_regions;
+		std::vector<Capture> m_captures;
+		uint32_t m_frame = 0;
+	};
+
+} // namespace PiGui
@@ -2,9 +2,7 @@
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
 #include "Face.h"
-#include "FileSystem.h"
-#include "SDLWrappers.h"
-#include "graphics/TextureBuilder.h"
+#include "FaceCache.h"
 #include "profiler/Profiler.h"
 
 namespace PiGui {
@@ -16,12 +14,9 @@ namespace PiGui {
 
 		m_seed = seed;
 
-		SDLSurfacePtr faceim = SDLSurfacePtr::WrapNew(SDL_CreateRGBSurface(SDL_SWSURFACE, FaceParts::FACE_WIDTH, FaceParts::FACE_HEIGHT, 24, 0xff, 0xff00, 0xff0000, 0));
-
+		// once every part is picked the descriptor identifies the image
 		FaceParts::PickFaceParts(face, m_seed);
-		FaceParts::BuildFaceImage(faceim.Get(), face);
-
-		m_texture.Reset(Graphics::TextureBuilder(faceim, Graphics::LINEAR_CLAMP, true, true).GetOrCreateTexture(Pi::renderer, std::string("face")));
+		m_texture = FaceCache::Get()->GetFaceTexture(face);
 	}
 
 	void *Face::GetImTextureID()
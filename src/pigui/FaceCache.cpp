@@ -0,0 +1,175 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "FaceCache.h"
+#include "JobQueue.h"
+#include "MathUtil.h"
+#include "SDLWrappers.h"
+#include "graphics/Renderer.h"
+#include "graphics/TextureBuilder.h"
+#include "profiler/Profiler.h"
+
+namespace PiGui {
+
+	// Composites a face and converts it for upload on a worker; the texture is
+	// created and swapped into the placeholder when the job finishes
+	class FaceCompositeJob : public Job {
+	public:
+		FaceCompositeJob(Graphics::Renderer *r, Graphics::Texture *texture, const FaceParts::FaceDescriptor &face) :
+			m_renderer(r),
+			m_texture(texture),
+			m_face(face)
+		{}
+
+		virtual void OnRun() override
+		{
+			PROFILE_SCOPED()
+			SDLSurfacePtr faceim = SDLSurfacePtr::WrapNew(SDL_CreateRGBSurface(SDL_SWSURFACE, FaceParts::FACE_WIDTH, FaceParts::FACE_HEIGHT, 24, 0xff, 0xff00, 0xff0000, 0));
+			FaceParts::BuildFaceImage(faceim.Get(), m_face);
+
+			m_builder.reset(new Graphics::TextureBuilder(faceim, Graphics::LINEAR_CLAMP, true, true));
+			// converts and extends the surface here rather than on upload
+			m_builder->GetDescriptor();
+		}
+
+		virtual void OnFinish() override
+		{
+			PROFILE_SCOPED()
+			RefCountedPtr<Graphics::Texture> composited(m_builder->GetOrCreateTexture(m_renderer, "face"));
+			// the placeholder storage is released along with composited
+			m_renderer->SwapTextureContents(m_texture.Get(), composited.Get());
+		}
+
+	private:
+		Graphics::Renderer *m_renderer;
+		// kept alive in case the face is evicted before the job finishes
+		RefCountedPtr<Graphics::Texture> m_texture;
+		FaceParts::FaceDescriptor m_face;
+		std::unique_ptr<Graphics::TextureBuilder> m_builder;
+	};
+
+	static std::unique_ptr<FaceCache> s_faceCache;
+
+	void FaceCache::Init(Graphics::Renderer *r)
+	{
+		s_faceCache.reset(new FaceCache(r));
+	}
+
+	void FaceCache::Uninit()
+	{
+		s_faceCache.reset();
+	}
+
+	FaceCache *FaceCache::Get()
+	{
+		return s_faceCache.get();
+	}
+
+	FaceCache::FaceCache(Graphics::Renderer *r) :
+		m_renderer(r),
+		m_useCounter(0)
+	{
+	}
+
+	FaceCache::~FaceCache()
+	{
+		// cancel the jobs before the textures they fill in go
+		m_jobs.reset();
+	}
+
+	void FaceCache::SetJobQueue(JobQueue *queue)
+	{
+		// releasing the job handles cancels the jobs, leaving their faces
+		// as placeholders; drop those so they're composited again
+		if (m_jobs && !m_jobs->IsEmpty())
+			Flush();
+
+		m_jobs.reset(queue ? new JobSet(queue, JobPriority::Streaming) : nullptr);
+	}
+
+	FaceCache::FaceKey FaceCache::MakeKey(const FaceParts::FaceDescriptor &face)
+	{
+		return { face.species, face.race, face.gender, face.head, face.eyes, face.nose, face.mouth,
+			face.hairstyle, face.accessories, face.clothes, face.armour };
+	}
+
+	vector2f FaceCache::GetFaceTextureSize()
+	{
+		return vector2f(
+			float(FaceParts::FACE_WIDTH) / float(ceil_pow2(FaceParts::FACE_WIDTH)),
+			float(FaceParts::FACE_HEIGHT) / float(ceil_pow2(FaceParts::FACE_HEIGHT)));
+	}
+
+	RefCountedPtr<Graphics::Texture> FaceCache::GetFaceTexture(const FaceParts::FaceDescriptor &face)
+	{
+		PROFILE_SCOPED()
+		const FaceKey key = MakeKey(face);
+
+		auto it = m_faces.find(key);
+		if (it != m_faces.end()) {
+			it->second.lastUsed = ++m_useCounter;
+			return it->second.texture;
+		}
+
+		RefCountedPtr<Graphics::Texture> texture;
+		if (m_jobs) {
+			const Graphics::TextureDescriptor desc(Graphics::TEXTURE_RGBA_8888, vector3f(1.0f, 1.0f, 0.0f), GetFaceTextureSize(),
+				Graphics::LINEAR_CLAMP, false, false, false, 0, Graphics::TEXTURE_2D);
+			const Color4ub placeholder(32, 32, 32, 255);
+
+			texture.Reset(m_renderer->CreateTexture(desc));
+			texture->Update(&placeholder, vector3f(1.0f, 1.0f, 0.0f), Graphics::TEXTURE_RGBA_8888);
+			m_jobs->Order(new FaceCompositeJob(m_renderer, texture.Get(), face));
+		} else {
+			SDLSurfacePtr faceim = SDLSurfacePtr::WrapNew(SDL_CreateRGBSurface(SDL_SWSURFACE, FaceParts::FACE_WIDTH, FaceParts::FACE_HEIGHT, 24, 0xff, 0xff00, 0xff0000, 0));
+			FaceParts::BuildFaceImage(faceim.Get(), face);
+			texture.Reset(Graphics::TextureBuilder(faceim, Graphics::LINEAR_CLAMP, true, true).GetOrCreateTexture(m_renderer, "face"));
+		}
+
+		if (m_faces.size() >= MAX_FACES)
+			EvictLeastRecentlyUsed();
+
+		Entry &entry = m_faces[key];
+		entry.texture = texture;
+		entry.lastUsed = ++m_useCounter;
+		return texture;
+	}
+
+	size_t FaceCache::GetMemoryUsage() const
+	{
+		size_t usage = 0;
+		for (const auto &face : m_faces)
+			usage += face.second.texture->GetTextureMemSize();
+		return usage;
+	}
+
+	size_t FaceCache::EvictLeastRecentlyUsed()
+	{
+		auto lru = m_faces.end();
+		for (auto it = m_faces.begin(); it != m_faces.end(); ++it) {
+			if (lru == m_faces.end() || it->second.lastUsed < lru->second.lastUsed)
+				lru = it;
+		}
+
+		if (lru == m_faces.end())
+			return 0;
+
+		// faces still shown keep their texture alive through their own reference
+		const size_t freed = lru->second.texture->GetTextureMemSize();
+		m_faces.erase(lru);
+		return freed;
+	}
+
+	void FaceCache::Trim(size_t bytes)
+	{
+		size_t freed = 0;
+		while (freed < bytes && m_faces.size() > MIN_FACES)
+			freed += EvictLeastRecentlyUsed();
+	}
+
+	void FaceCache::Flush()
+	{
+		m_faces.clear();
+	}
+
+} // namespace PiGui
@@ -0,0 +1,87 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef PIGUI_FACECACHE_H
+#define PIGUI_FACECACHE_H
+
+#include "FaceParts.h"
+#include "RefCounted.h"
+#include "vector2.h"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+
+class JobQueue;
+class JobSet;
+
+namespace Graphics {
+	class Renderer;
+	class Texture;
+} // namespace Graphics
+
+namespace PiGui {
+
+	/*
+	 * Keeps the textures of recently shown faces, so the same NPC seen again
+	 * (scrolling a bulletin board, reopening a mission) isn't composited and
+	 * uploaded again.
+	 *
+	 * A face that isn't cached is composited on the job queue. Until that
+	 * finishes its texture is a single texel placeholder, which is swapped
+	 * for the composited image in place. The placeholder already has the
+	 * texture size of a composited face, so callers can use it straight away.
+	 */
+	class FaceCache {
+	public:
+		// the least recently used face is evicted when there are more than
+		// MAX_FACES; Trim leaves MIN_FACES, as those are likely on screen
+		static constexpr size_t MIN_FACES = 8;
+		static constexpr size_t MAX_FACES = 32;
+
+		FaceCache(Graphics::Renderer *r);
+		~FaceCache();
+
+		static void Init(Graphics::Renderer *r);
+		static void Uninit();
+		static FaceCache *Get();
+
+		// Set the job queue faces are composited on; nullptr (the default)
+		// composites them immediately and cancels any jobs in flight.
+		void SetJobQueue(JobQueue *queue);
+
+		// the texture of a face whose parts have all been picked
+		RefCountedPtr<Graphics::Texture> GetFaceTexture(const FaceParts::FaceDescriptor &face);
+
+		// texture coordinates of the composited image within a face texture
+		static vector2f GetFaceTextureSize();
+
+		size_t GetMemoryUsage() const;
+		// evicts faces, least recently used first, until at least bytes have
+		// been freed or only MIN_FACES are left
+		void Trim(size_t bytes);
+
+		void Flush();
+
+	private:
+		typedef std::array<int, 11> FaceKey;
+
+		struct Entry {
+			RefCountedPtr<Graphics::Texture> texture;
+			uint64_t lastUsed = 0;
+		};
+
+		static FaceKey MakeKey(const FaceParts::FaceDescriptor &face);
+		// returns the bytes of texture memory freed
+		size_t EvictLeastRecentlyUsed();
+
+		Graphics::Renderer *m_renderer;
+		std::map<FaceKey, Entry> m_faces;
+		std::unique_ptr<JobSet> m_jobs;
+		uint64_t m_useCounter;
+	};
+
+} // namespace PiGui
+
+#endif
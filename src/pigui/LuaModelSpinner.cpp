@@ -54,6 +54,10 @@ void LuaObject<PiGui::ModelSpinner>::RegisterClass()
 		.AddMember("spinning", &T::GetSpinning, &T::SetSpinning)
 		.AddFunction("setSize", &T::SetSize)
 		.AddFunction("setModel", &l_model_set_model)
+		.AddFunction("setLightPosition", [](lua_State *l, T *obj) {
+			obj->SetLightPosition(LuaVector::CheckFromLuaF(l, 2));
+			return 0;
+		})
 		.AddFunction("getTagPos", &T::GetTagPos)
 		.AddFunction("draw", [](lua_State *l, T *obj) {
 			obj->Render();
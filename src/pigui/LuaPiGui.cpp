@@ -6,6 +6,7 @@
 #include "Image.h"
 #include "ModelSpinner.h"
 #include "Radar.h"
+#include "core/PerfTimeline.h"
 #include "lua/LuaPiGuiInternal.h"
 #include "lua/LuaTable.h"
 #include "utils.h"
@@ -106,6 +107,7 @@ namespace PiGui {
 	void RunHandler(double delta, const std::string &handler)
 	{
 		PROFILE_SCOPED()
+		PERF_ZONE("Lua UI")
 		ScopedTable t(GetHandlers());
 		if (t.Get<bool>(handler)) {
 			t.Call<bool>(handler, delta);
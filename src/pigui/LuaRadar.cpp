@@ -3,13 +3,65 @@
 
 #include "LuaPiGui.h"
 #include "Radar.h"
+#include "Sensors.h"
+#include "Ship.h"
 #include "lua/Lua.h"
 #include "lua/LuaMetaType.h"
 #include "lua/LuaPiGuiInternal.h"
+#include "lua/LuaTable.h"
 #include "lua/LuaVector2.h"
 
 using RadarWidget = PiGui::RadarWidget;
 
+/*
+ * Method: DrawContacts
+ *
+ * Draw the sensor contacts of a ship over the radar, after calling Draw().
+ *
+ * > radar:DrawContacts(ship, style, filter)
+ *
+ * Parameters:
+ *
+ *   ship - the <Ship> whose contacts are shown
+ *
+ *   style - optional table with any of the fields blipSize, stalkThickness,
+ *           velocityTime, velocityThickness, bracketSize and alpha; see
+ *           PiGui::RadarContactStyle
+ *
+ *   filter - optional table of booleans: unknown, neutral, ally and hostile
+ *            select contacts by IFF, and outOfRange pins contacts beyond the
+ *            zoom distance to the edge of the radar (all default to true)
+ */
+static int l_radar_draw_contacts(lua_State *l, RadarWidget *radar)
+{
+	const Ship *ship = LuaObject<Ship>::CheckFromLua(2);
+
+	PiGui::RadarContactStyle style;
+	if (lua_istable(l, 3)) {
+		LuaTable t(l, 3);
+		style.blipSize = t.Get<float>("blipSize", style.blipSize);
+		style.stalkThickness = t.Get<float>("stalkThickness", style.stalkThickness);
+		style.velocityTime = t.Get<float>("velocityTime", style.velocityTime);
+		style.velocityThickness = t.Get<float>("velocityThickness", style.velocityThickness);
+		style.bracketSize = t.Get<float>("bracketSize", style.bracketSize);
+		style.alpha = t.Get<float>("alpha", style.alpha);
+	}
+
+	PiGui::RadarContactFilter filter;
+	if (lua_istable(l, 4)) {
+		LuaTable t(l, 4);
+		filter.iffMask = 0;
+		filter.iffMask |= t.Get<bool>("unknown", true) ? 1u << Sensors::IFF_UNKNOWN : 0;
+		filter.iffMask |= t.Get<bool>("neutral", true) ? 1u << Sensors::IFF_NEUTRAL : 0;
+		filter.iffMask |= t.Get<bool>("ally", true) ? 1u << Sensors::IFF_ALLY : 0;
+		filter.iffMask |= t.Get<bool>("hostile", true) ? 1u << Sensors::IFF_HOSTILE : 0;
+		filter.showOutOfRange = t.Get<bool>("outOfRange", filter.showOutOfRange);
+	}
+
+	radar->DrawContacts(ship, style, filter);
+	return 0;
+}
+
 template <>
 const char *LuaObject<RadarWidget>::s_type = "PiGui.Modules.RadarWidget";
 
@@ -27,6 +79,7 @@ void LuaObject<RadarWidget>::RegisterClass()
 		.AddMember("radius", &RadarWidget::GetRadius)
 		.AddMember("center", &RadarWidget::GetCenter)
 		.AddFunction("Draw", &RadarWidget::DrawPiGui)
+		.AddFunction("DrawContacts", &l_radar_draw_contacts)
 		.StopRecording();
 
 	LuaObjectBase::CreateClass(&s_metaType);
@@ -6,6 +6,7 @@
 #include "Pi.h"
 #include "PiGui.h"
 #include "graphics/Graphics.h"
+#include "graphics/RenderGraph.h"
 #include "graphics/RenderTarget.h"
 #include "graphics/Renderer.h"
 #include "graphics/Texture.h"
@@ -16,11 +17,13 @@
 using namespace PiGui;
 
 ModelSpinner::ModelSpinner() :
+	m_needsRender(true),
 	m_spinning(true),
 	m_pauseTime(.0f),
 	m_rot(vector2f(DEG2RAD(-15.0), DEG2RAD(120.0))),
 	m_zoom(1.0f),
-	m_zoomTo(1.0f)
+	m_zoomTo(1.0f),
+	m_renderedZoom(0.0f)
 {
 	Color lc(Color::WHITE);
 	m_light.SetDiffuse(lc);
@@ -31,22 +34,11 @@ ModelSpinner::ModelSpinner() :
 
 void ModelSpinner::CreateRenderTarget()
 {
-	if (m_renderTarget)
-		m_renderTarget.reset();
 	if (m_resolveTarget)
 		m_resolveTarget.reset();
 
-	Graphics::RenderTargetDesc rtDesc{
-		uint16_t(m_size.x), uint16_t(m_size.y),
-		Graphics::TextureFormat::TEXTURE_RGBA_8888,
-		Graphics::TextureFormat::TEXTURE_DEPTH, true,
-		uint16_t(Pi::GetApp()->GetGraphicsSettings().requestedSamples)
-	};
-
-	m_renderTarget.reset(Pi::renderer->CreateRenderTarget(rtDesc));
-	if (!m_renderTarget) Error("Error creating render target for model viewer.");
-
-
+	// the multisampled target is only needed while drawing, and is borrowed
+	// from the renderer's pool in Render()
 	Graphics::RenderTargetDesc resolveDesc{
 		uint16_t(m_size.x), uint16_t(m_size.y),
 		Graphics::TextureFormat::TEXTURE_RGBA_8888,
@@ -57,6 +49,7 @@ void ModelSpinner::CreateRenderTarget()
 	if (!m_resolveTarget) Error("Error creating MSAA resolve render target for model viewer.");
 
 	m_needsResize = false;
+	m_needsRender = true;
 }
 
 void ModelSpinner::SetModel(SceneGraph::Model *model, const SceneGraph::ModelSkin &skin, unsigned int pattern)
@@ -65,6 +58,16 @@ void ModelSpinner::SetModel(SceneGraph::Model *model, const SceneGraph::ModelSki
 	skin.Apply(m_model.get());
 	m_model->SetPattern(pattern);
 	// m_model->SetDebugFlags(SceneGraph::Model::DEBUG_BBOX);
+	m_needsRender = true;
+}
+
+void ModelSpinner::SetLightPosition(const vector3f &pos)
+{
+	if (pos == m_light.GetPosition())
+		return;
+
+	m_light.SetPosition(pos);
+	m_needsRender = true;
 }
 
 constexpr float SPINNER_FOV = 45.f;
@@ -73,32 +76,58 @@ void ModelSpinner::Render()
 	PROFILE_SCOPED()
 	// Resizing a render target involves destroying the old one and creating a new one.
 	if (m_needsResize) CreateRenderTarget();
-	if (!m_renderTarget) return;
+	if (!m_resolveTarget) return;
 	if (!m_model) return;
 
+	// the resolve target keeps the last image, so only draw again when
+	// something in it has changed
+	AnimationCurves::Approach(m_zoom, m_zoomTo, Pi::GetFrameTime(), 5.0f, 0.4f);
+	if (!m_needsRender && m_rot == m_renderedRot && m_zoom == m_renderedZoom)
+		return;
+
+	m_needsRender = false;
+	m_renderedRot = m_rot;
+	m_renderedZoom = m_zoom;
+
 	Graphics::Renderer *r = Pi::renderer;
 	Graphics::Renderer::StateTicket ticket(r);
 
-	const auto &desc = m_renderTarget.get()->GetDesc();
+	const auto &desc = m_resolveTarget->GetDesc();
 	Graphics::ViewportExtents extents = { 0, 0, desc.width, desc.height };
 
-	r->SetRenderTarget(m_renderTarget.get());
-	r->SetViewport(extents);
+	Graphics::RenderTargetDesc sceneDesc{
+		desc.width, desc.height,
+		Graphics::TextureFormat::TEXTURE_RGBA_8888,
+		Graphics::TextureFormat::TEXTURE_DEPTH, true,
+		uint16_t(Pi::GetApp()->GetGraphicsSettings().requestedSamples)
+	};
 
-	float lightIntensity[4] = { 0.75f, 0.f, 0.f, 0.f };
-	r->SetLightIntensity(4, lightIntensity);
-	r->SetAmbientColor(Color(64, 64, 64));
+	Graphics::RenderGraph graph(r->GetRenderTargetPool(), r);
+	const auto scene = graph.CreateTarget(sceneDesc);
+	const auto resolve = graph.ImportTarget(m_resolveTarget.get());
 
-	r->ClearScreen(Color(0, 0, 0, 0));
+	graph.AddPass("ModelSpinner", {}, { scene }, [&](const Graphics::RenderGraph &g) {
+		r->SetRenderTarget(g.GetTarget(scene));
+		r->SetViewport(extents);
 
-	r->SetProjection(matrix4x4f::PerspectiveMatrix(DEG2RAD(SPINNER_FOV), m_size.x / m_size.y, 1.f, 10000.f, true));
-	r->SetTransform(matrix4x4f::Identity());
+		float lightIntensity[4] = { 0.75f, 0.f, 0.f, 0.f };
+		r->SetLightIntensity(4, lightIntensity);
+		r->SetAmbientColor(Color(64, 64, 64));
 
-	r->SetLights(1, &m_light);
-	AnimationCurves::Approach(m_zoom, m_zoomTo, Pi::GetFrameTime(), 5.0f, 0.4f);
-	m_model->Render(MakeModelViewMat());
+		r->ClearScreen(Color(0, 0, 0, 0));
+
+		r->SetProjection(matrix4x4f::PerspectiveMatrix(DEG2RAD(SPINNER_FOV), m_size.x / m_size.y, 1.f, 10000.f, true));
+		r->SetTransform(matrix4x4f::Identity());
+
+		r->SetLights(1, &m_light);
+		m_model->Render(MakeModelViewMat());
+	});
+
+	graph.AddPass("ModelSpinner Resolve", { scene }, { resolve }, [&](const Graphics::RenderGraph &g) {
+		r->ResolveRenderTarget(g.GetTarget(scene), g.GetTarget(resolve), extents);
+	});
 
-	r->ResolveRenderTarget(m_renderTarget.get(), m_resolveTarget.get(), extents);
+	graph.Execute();
 }
 
 void ModelSpinner::SetSize(vector2d size)
@@ -126,7 +155,7 @@ void ModelSpinner::DrawPiGui()
 {
 	ImVec2 size(m_size.x, m_size.y);
 
-	if (m_renderTarget) {
+	if (m_resolveTarget) {
 		// Draw the image and stretch it over the available region.
 		// ImGui inverts the vertical axis to get top-left coordinates, so we need to invert our UVs to match.
 		ImGui::Image(m_resolveTarget->GetColorTexture(), size, ImVec2(0, 1), ImVec2(1, 0));
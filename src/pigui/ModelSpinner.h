@@ -29,7 +29,11 @@ namespace PiGui {
 		// Set the ship we should be looking at.
 		void SetModel(SceneGraph::Model *model, const SceneGraph::ModelSkin &skin, unsigned int pattern);
 
-		// Called to draw the model to the render target.
+		// Set the direction the model is lit from.
+		void SetLightPosition(const vector3f &pos);
+
+		// Called to draw the model to the render target. The model is only
+		// drawn again when its view or anything set above has changed.
 		void Render();
 
 		// Draws the model spinner widget and handles user interaction.
@@ -51,7 +55,6 @@ namespace PiGui {
 		bool GetSpinning() const { return m_spinning; }
 
 	private:
-		std::unique_ptr<Graphics::RenderTarget> m_renderTarget;
 		std::unique_ptr<Graphics::RenderTarget> m_resolveTarget;
 		std::unique_ptr<SceneGraph::Model> m_model;
 		SceneGraph::ModelSkin m_skin;
@@ -67,6 +70,8 @@ namespace PiGui {
 		vector2f m_size;
 		// Do we need to resize the render target next frame?
 		bool m_needsResize;
+		// Has the model, its skin or the lighting changed since it was drawn?
+		bool m_needsRender;
 
 		// Shoulde we spinne?
 		bool m_spinning;
@@ -80,5 +85,9 @@ namespace PiGui {
 		vector2f m_rot;
 		float m_zoom;
 		float m_zoomTo;
+
+		// The view the render target was last drawn with.
+		vector2f m_renderedRot;
+		float m_renderedZoom;
 	};
 } // namespace PiGui
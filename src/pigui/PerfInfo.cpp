@@ -4,13 +4,21 @@
 #include "PerfInfo.h"
 #include "Frame.h"
 #include "Game.h"
+#include "GeoSphere.h"
 #include "Input.h"
 #include "LuaPiGui.h"
 #include "Pi.h"
+#include "PiGui.h"
 #include "Player.h"
 #include "SectorView.h"
 #include "Space.h"
+#include "core/AllocTracker.h"
 #include "core/Log.h"
+#include "core/MemoryBudget.h"
+#include "core/PerfTimeline.h"
+#include "core/PoolAllocator.h"
+#include "galaxy/Galaxy.h"
+#include "graphics/DynamicResolution.h"
 #include "graphics/Renderer.h"
 #include "graphics/Stats.h"
 #include "graphics/Texture.h"
@@ -24,9 +32,11 @@
 #include <imgui/imgui.h>
 #include <algorithm>
 #include <cstddef>
+#include <ctime>
 #include <fstream>
 #include <functional>
 #include <sstream>
+#include <string_view>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -52,6 +62,14 @@ struct PerfInfo::ImGuiState {
 
 	bool hasSelectedTexture = false;
 	std::pair<std::string, std::string> selectedTexture;
+
+	bool gpuTiming = false;
+	// GPU time of each zone the renderer has reported, by name
+	std::map<std::string, CounterInfo> gpuZoneCounters;
+
+	// allocations and KB of each tag, with ALLOC_TRACKING
+	std::unique_ptr<Perf::Stats> allocStats;
+	std::map<const char *, std::pair<Perf::Stats::CounterRef, Perf::Stats::CounterRef>> allocCounters;
 };
 
 PerfInfo::CounterInfo::CounterInfo(const char *n, const char *u, uint32_t recent) :
@@ -67,6 +85,11 @@ PerfInfo::PerfInfo() :
 	m_fpsCounter("Frame Time", "ms"),
 	m_physCounter("Update Time", "ms"),
 	m_piguiCounter("PiGui Time", "ms"),
+	m_poolAllocCounter("Pooled allocations", "/frame"),
+	m_poolHeapCounter("Pool misses (heap)", "/frame"),
+	m_geoBudgetCounter("GeoSphere budget used", "%"),
+	m_gpuCounter("GPU Frame Time", "ms"),
+	m_latencyCounter("Input Latency", "ms"),
 	m_procMemCounter("Process memory usage", "MB", 1),
 	m_luaMemCounter("Lua memory usage", "MB", 1)
 {
@@ -132,6 +155,11 @@ PerfInfo::CounterInfo &PerfInfo::GetCounter(CounterType ct)
 	case COUNTER_PIGUI: return m_piguiCounter;
 	case COUNTER_PROCMEM: return m_procMemCounter;
 	case COUNTER_LUAMEM: return m_luaMemCounter;
+	case COUNTER_POOLALLOC: return m_poolAllocCounter;
+	case COUNTER_POOLHEAP: return m_poolHeapCounter;
+	case COUNTER_GEOBUDGET: return m_geoBudgetCounter;
+	case COUNTER_GPU: return m_gpuCounter;
+	case COUNTER_LATENCY: return m_latencyCounter;
 	// default value is never reached, calm down -Werror=return-type
 	default: return m_fpsCounter;
 	}
@@ -147,13 +175,16 @@ void PerfInfo::ClearCounter(CounterType ct)
 }
 
 void PerfInfo::UpdateCounter(CounterType ct, float sample)
+{
+	UpdateCounter(GetCounter(ct), sample);
+}
+
+void PerfInfo::UpdateCounter(CounterInfo &counter, float sample)
 {
 	// Don't accumulate new frames when performance data is paused.
 	if (m_state->updatePause)
 		return;
 
-	CounterInfo &counter = GetCounter(ct);
-
 	// Index of the first "recent" sample in the history buffer
 	size_t recentSamplesIdx = counter.history.size() - counter.numRecentSamples;
 	float oldestSample = counter.history.front();
@@ -197,6 +228,42 @@ void PerfInfo::Update(float deltaTime)
 {
 	UpdateCounter(COUNTER_FPS, deltaTime * 1e3);
 
+	// Job / Task / scratch buffer allocations made since the last frame
+	const PoolAllocator::Stats poolStats = PoolAllocator::GetStats();
+	UpdateCounter(COUNTER_POOLALLOC, float(poolStats.numAllocs - m_lastPoolAllocs));
+	UpdateCounter(COUNTER_POOLHEAP, float(poolStats.numHeapAllocs - m_lastPoolHeapAllocs));
+	m_lastPoolAllocs = poolStats.numAllocs;
+	m_lastPoolHeapAllocs = poolStats.numHeapAllocs;
+
+	// the larger share of the GeoSphere time and upload budgets used this frame
+	const GeoSphere::FrameBudget &geoBudget = GeoSphere::GetFrameBudget();
+	const double geoTimeUsed = geoBudget.timeBudgetMs > 0.0 ? geoBudget.timeUsedMs / geoBudget.timeBudgetMs : 0.0;
+	const double geoUploadUsed = geoBudget.uploadBudgetBytes ? double(geoBudget.uploadBytes) / double(geoBudget.uploadBudgetBytes) : 0.0;
+	UpdateCounter(COUNTER_GEOBUDGET, float(std::max(geoTimeUsed, geoUploadUsed) * 100.0));
+
+	// GPU times are of a frame a few frames back, and only there while timing
+	const double gpuFrameTime = Pi::renderer->GetGPUFrameTime();
+	if (gpuFrameTime >= 0.0) {
+		UpdateCounter(COUNTER_GPU, float(gpuFrameTime));
+
+		for (const Graphics::Renderer::GPUZoneTime &zone : Pi::renderer->GetGPUZoneTimes()) {
+			auto iter = m_state->gpuZoneCounters.find(zone.name);
+			if (iter == m_state->gpuZoneCounters.end()) {
+				iter = m_state->gpuZoneCounters.emplace(zone.name, CounterInfo(nullptr, "ms")).first;
+				iter->second.name = iter->first.c_str();
+			}
+			UpdateCounter(iter->second, float(zone.ms));
+		}
+	}
+
+	// only measured while the frames in flight are capped
+	const double inputLatency = Pi::renderer->GetInputLatency();
+	if (inputLatency >= 0.0)
+		UpdateCounter(COUNTER_LATENCY, float(inputLatency));
+
+	if (Perf::AllocTracker::IsEnabled())
+		UpdateAllocStats();
+
 	lastUpdateTime += deltaTime;
 	constexpr double update_rate = 0.5;
 	if (lastUpdateTime > update_rate) {
@@ -257,6 +324,7 @@ void PerfInfo::Draw()
 static const char *s_rendererIcon = "\uF082";
 static const char *s_worldIcon = "\uF092";
 static const char *s_perfIcon = "\uF0F0";
+static const char *s_luaIcon = "\uF0F1";
 
 bool BeginDebugTab(const char *icon, const char *label)
 {
@@ -342,6 +410,11 @@ void PerfInfo::DrawPerfWindow()
 				EndDebugTab();
 			}
 
+			if (BeginDebugTab(s_luaIcon, "Lua Profiler")) {
+				DrawLuaProfiler();
+				EndDebugTab();
+			}
+
 			if (false && ImGui::BeginTabItem("Input")) {
 				DrawInputDebug();
 				ImGui::EndTabItem();
@@ -379,6 +452,12 @@ void PerfInfo::DrawPerformanceStats()
 	DrawCounter(m_piguiCounter, "##guit", 0.0, 5.0, 45, true);
 	ImGui::Spacing();
 
+	if (Pi::GetApp()->IsLowLatencyMode()) {
+		ImGui::Text("Low latency mode: frame start delayed %.1f ms", Pi::GetApp()->GetFrameDelay());
+		DrawCounter(m_latencyCounter, "##latency", 0.0, 50.0, 45, true);
+		ImGui::Spacing();
+	}
+
 	if (ImGui::Button(m_state->updatePause ? "Unpause" : "Pause")) {
 		SetUpdatePause(!m_state->updatePause);
 	}
@@ -393,6 +472,339 @@ void PerfInfo::DrawPerformanceStats()
 	ImGui::Spacing();
 
 	DrawCounter(m_luaMemCounter, "##luamem", 0, 0, 25, true);
+	ImGui::Spacing();
+
+	if (::Lua::manager->GetGCFrameBudget() > 0.f) {
+		ImGui::Text("Lua GC budget: %.2f ms", ::Lua::manager->GetGCFrameBudget());
+		Perf::Stats &gcStats = ::Lua::manager->GetGCStats();
+		gcStats.FlushFrame();
+		for (const auto &counter : gcStats.GetFrameStats())
+			ImGui::Text("%s: %u", counter.first.c_str(), counter.second);
+
+		const auto stepTime = gcStats.FindCounter("GC step time (us)");
+		if (stepTime.id) {
+			std::array<float, Perf::Stats::HISTORY_FRAMES> history;
+			const uint32_t numFrames = gcStats.GetNumFrames();
+			for (uint32_t frame = 0; frame < numFrames; frame++)
+				history[numFrames - 1 - frame] = float(gcStats.GetFrameValue(stepTime, frame));
+
+			ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x);
+			ImGui::PlotLines("##gcsteptime", history.data(), numFrames, 0, nullptr, 0.f, FLT_MAX, { 0.f, 25.f });
+			ImGui::PopItemWidth();
+		}
+		ImGui::Spacing();
+	}
+
+	// polled by the budget about once a second
+	if (Pi::memoryBudget) {
+		const double budget = double(Pi::memoryBudget->GetBudget());
+		const double total = double(Pi::memoryBudget->GetTotalUsage());
+		if (budget > 0.0)
+			ImGui::Text("Caches: %.1f / %.1f MB", total / scale_MB, budget / scale_MB);
+		else
+			ImGui::Text("Caches: %.1f MB, no budget", total / scale_MB);
+
+		for (const MemoryBudget::Cache &cache : Pi::memoryBudget->GetCaches()) {
+			if (cache.trimmed)
+				ImGui::BulletText("%s: %.1f MB (%.1f MB trimmed)", cache.name.c_str(), double(cache.usage) / scale_MB, double(cache.trimmed) / scale_MB);
+			else
+				ImGui::BulletText("%s: %.1f MB", cache.name.c_str(), double(cache.usage) / scale_MB);
+		}
+		ImGui::Spacing();
+	}
+
+	ImGui::SeparatorText("Job / Task Allocations");
+
+	// these counters are frequently zero, so scale the plot explicitly rather
+	// than through the log2 auto-range
+	DrawCounter(m_poolAllocCounter, "##poolalloc", 0.0, m_poolAllocCounter.max + 1.f, 25, true);
+	ImGui::Spacing();
+
+	DrawCounter(m_poolHeapCounter, "##poolheap", 0.0, m_poolHeapCounter.max + 1.f, 25, true);
+
+	if (Perf::AllocTracker::IsEnabled())
+		DrawAllocTracking();
+
+	ImGui::SeparatorText("GeoSphere Frame Budget");
+
+	const GeoSphere::FrameBudget &geoBudget = GeoSphere::GetFrameBudget();
+	ImGui::Text("Time: %.2f / %.2f ms", geoBudget.timeUsedMs, geoBudget.timeBudgetMs);
+	ImGui::Text("Uploads: %.1f / %.1f MB", double(geoBudget.uploadBytes) / scale_MB, double(geoBudget.uploadBudgetBytes) / scale_MB);
+	ImGui::Text("Patches: %u integrated, %u deferred", geoBudget.resultsProcessed, geoBudget.resultsDeferred);
+	ImGui::Text("Split jobs: %u issued, %u deferred", geoBudget.requestsIssued, geoBudget.requestsDeferred);
+
+	// over 100% means a single result or request didn't fit the budget by itself
+	DrawCounter(m_geoBudgetCounter, "##geobudget", 0.0, std::max(m_geoBudgetCounter.max, 100.f), 25, true);
+
+	DrawTimeline();
+
+	if (Pi::game) {
+		ImGui::SeparatorText("Frame Transforms");
+
+		Perf::Stats &frameStats = Frame::GetStats();
+		frameStats.FlushFrame();
+		for (const auto &counter : frameStats.GetFrameStats())
+			ImGui::Text("%s: %u", counter.first.c_str(), counter.second);
+
+		ImGui::SeparatorText("Galaxy Generation Stages");
+
+		// the counters run for the lifetime of the galaxy
+		Perf::Stats &galaxyStats = Pi::game->GetGalaxy()->GetStats();
+		galaxyStats.FlushFrame();
+		for (const auto &counter : galaxyStats.GetFrameStats())
+			ImGui::Text("%s: %u", counter.first.c_str(), counter.second);
+	}
+}
+
+std::string PerfInfo::ExportTimeline()
+{
+	const std::string trace = Perf::Timeline::ToChromeTrace(Perf::Timeline::Collect());
+
+	FileSystem::userFiles.MakeDirectory("profiler");
+
+	char name[40];
+	const time_t t = time(nullptr);
+	strftime(name, sizeof(name), "trace-%Y%m%d-%H%M%S.json", localtime(&t));
+	const std::string path = FileSystem::JoinPath("profiler", name);
+
+	FILE *f = FileSystem::userFiles.OpenWriteStream(path, FileSystem::FileSourceFS::WRITE_TEXT);
+	if (!f)
+		return std::string();
+
+	const bool ok = fwrite(trace.data(), 1, trace.size(), f) == trace.size();
+	fclose(f);
+
+	return ok ? path : std::string();
+}
+
+void PerfInfo::DrawTimeline()
+{
+	ImGui::SeparatorText("Timeline");
+
+	bool enabled = Perf::Timeline::IsEnabled();
+	if (ImGui::Checkbox("Record", &enabled))
+		Perf::Timeline::SetEnabled(enabled);
+	ImGui::SameLine();
+	if (ImGui::Button("Export Trace")) {
+		const std::string path = ExportTimeline();
+		if (!path.empty())
+			Log::Info("Timeline trace written to {}\n", path);
+		else
+			Log::Warning("Unable to write timeline trace\n");
+	}
+
+	// summarise the zones of the last second by thread
+	struct ZoneStats {
+		uint32_t count = 0;
+		uint64_t total = 0;
+		uint64_t max = 0;
+	};
+
+	const uint64_t now = Perf::Timeline::Now();
+	const uint64_t since = now > 1000000000 ? now - 1000000000 : 1;
+
+	const ImGuiTableFlags tableFlags = ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_BordersInnerV;
+
+	for (const auto &thread : Perf::Timeline::Collect(since)) {
+		std::map<std::string_view, ZoneStats> zones;
+		for (const auto &ev : thread.events) {
+			if (ev.type != Perf::Timeline::EVENT_ZONE)
+				continue;
+
+			ZoneStats &stats = zones[ev.name];
+			const uint64_t duration = ev.value - ev.start;
+			stats.count++;
+			stats.total += duration;
+			stats.max = std::max(stats.max, duration);
+		}
+
+		if (zones.empty())
+			continue;
+
+		ImGui::PushID(int(thread.tid));
+		if (ImGui::TreeNode(thread.name.c_str())) {
+			if (ImGui::BeginTable("##zones", 4, tableFlags)) {
+				ImGui::TableSetupColumn("Zone", ImGuiTableColumnFlags_WidthStretch);
+				ImGui::TableSetupColumn("Count");
+				ImGui::TableSetupColumn("Avg (ms)");
+				ImGui::TableSetupColumn("Max (ms)");
+				ImGui::TableHeadersRow();
+
+				for (const auto &zone : zones) {
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::TextUnformatted(zone.first.data(), zone.first.data() + zone.first.size());
+					ImGui::TableNextColumn();
+					ImGui::Text("%u", zone.second.count);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", double(zone.second.total) * 1e-6 / zone.second.count);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", double(zone.second.max) * 1e-6);
+				}
+				ImGui::EndTable();
+			}
+			ImGui::TreePop();
+		}
+		ImGui::PopID();
+	}
+}
+
+void PerfInfo::UpdateAllocStats()
+{
+	if (!m_state->allocStats)
+		m_state->allocStats.reset(new Perf::Stats());
+	Perf::Stats &stats = *m_state->allocStats;
+
+	for (const Perf::AllocTracker::TagStats &tag : Perf::AllocTracker::GetFrameStats()) {
+		auto iter = m_state->allocCounters.find(tag.name);
+		if (iter == m_state->allocCounters.end()) {
+			try {
+				auto counters = std::make_pair(stats.GetOrCreateCounter(fmt::format("{} allocs", tag.name)),
+					stats.GetOrCreateCounter(fmt::format("{} KB", tag.name)));
+				iter = m_state->allocCounters.emplace(tag.name, counters).first;
+			} catch (const std::runtime_error &) {
+				// out of counters; the frame's table still lists the tag
+				continue;
+			}
+		}
+
+		stats.CounterAdd(iter->second.first, uint32_t(tag.count));
+		stats.CounterAdd(iter->second.second, uint32_t(tag.bytes / 1024));
+	}
+
+	stats.FlushFrame();
+}
+
+void PerfInfo::DrawAllocTracking()
+{
+	ImGui::SeparatorText("Heap Allocations");
+
+	// of the last whole frame, by the innermost PERF_ZONE they were made in
+	const std::vector<Perf::AllocTracker::TagStats> &tags = Perf::AllocTracker::GetFrameStats();
+	uint64_t totalCount = 0, totalBytes = 0;
+	for (const Perf::AllocTracker::TagStats &tag : tags) {
+		totalCount += tag.count;
+		totalBytes += tag.bytes;
+	}
+	ImGui::Text("%llu allocations, %.1f KB last frame", (unsigned long long)totalCount, double(totalBytes) / 1024.0);
+
+	constexpr size_t MAX_ROWS = 16;
+	const ImGuiTableFlags tableFlags = ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_BordersInnerV;
+	if (!tags.empty() && ImGui::BeginTable("##allocs", 3, tableFlags)) {
+		ImGui::TableSetupColumn("Top allocators", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn("Allocs");
+		ImGui::TableSetupColumn("KB");
+		ImGui::TableHeadersRow();
+
+		for (size_t i = 0; i < std::min(tags.size(), MAX_ROWS); i++) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(tags[i].name);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", (unsigned long long)tags[i].count);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", double(tags[i].bytes) / 1024.0);
+		}
+		ImGui::EndTable();
+	}
+}
+
+void PerfInfo::DrawLuaProfiler()
+{
+	LuaProfiler &profiler = ::Lua::manager->GetProfiler();
+	lua_State *l = ::Lua::manager->GetLuaState();
+
+	if (ImGui::Button(profiler.IsRunning() ? "Stop" : "Start")) {
+		if (profiler.IsRunning())
+			profiler.Stop(l);
+		else
+			profiler.Start(l);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Reset"))
+		profiler.Reset();
+	ImGui::SameLine();
+	if (ImGui::Button("Write Profile")) {
+		const std::string path = LuaProfiler::MakeProfilePath();
+		if (profiler.WriteProfile(path))
+			Log::Info("Lua profile written to {}.folded and .json\n", path);
+		else
+			Log::Warning("Unable to write Lua profile to {}\n", path);
+	}
+
+	const double profiledMs = double(profiler.GetProfiledTime()) * 1e-6;
+	ImGui::Text("%.1f ms of Lua profiled", profiledMs);
+	if (profiler.GetProfiledTime() == 0)
+		return;
+
+	static constexpr size_t MAX_ROWS = 25;
+	const ImGuiTableFlags tableFlags = ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_BordersInnerV;
+
+	ImGui::SeparatorText("By File");
+
+	std::vector<const LuaProfiler::File *> files;
+	for (const LuaProfiler::File &file : profiler.GetFiles())
+		files.push_back(&file);
+	std::sort(files.begin(), files.end(), [](const LuaProfiler::File *a, const LuaProfiler::File *b) {
+		return a->selfTime > b->selfTime;
+	});
+	files.resize(std::min(files.size(), MAX_ROWS));
+
+	if (ImGui::BeginTable("##luafiles", 4, tableFlags)) {
+		ImGui::TableSetupColumn("Time (ms)");
+		ImGui::TableSetupColumn("%");
+		ImGui::TableSetupColumn("Alloc (KB)");
+		ImGui::TableSetupColumn("File", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableHeadersRow();
+
+		for (const LuaProfiler::File *file : files) {
+			const double ms = double(file->selfTime) * 1e-6;
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", ms);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", 100.0 * ms / profiledMs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", double(file->allocBytes) / 1024.0);
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(file->name.c_str());
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::SeparatorText("By Function");
+
+	std::vector<const LuaProfiler::Function *> functions;
+	for (const LuaProfiler::Function &function : profiler.GetFunctions())
+		functions.push_back(&function);
+	std::sort(functions.begin(), functions.end(), [](const LuaProfiler::Function *a, const LuaProfiler::Function *b) {
+		return a->selfTime > b->selfTime;
+	});
+	functions.resize(std::min(functions.size(), MAX_ROWS));
+
+	if (ImGui::BeginTable("##luafunctions", 5, tableFlags)) {
+		ImGui::TableSetupColumn("Self (ms)");
+		ImGui::TableSetupColumn("Total (ms)");
+		ImGui::TableSetupColumn("Calls");
+		ImGui::TableSetupColumn("Alloc (KB)");
+		ImGui::TableSetupColumn("Function", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableHeadersRow();
+
+		for (const LuaProfiler::Function *function : functions) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", double(function->selfTime) * 1e-6);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", double(function->totalTime) * 1e-6);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", (unsigned long long)function->calls);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", double(function->allocBytes) / 1024.0);
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(function->name.c_str());
+		}
+		ImGui::EndTable();
+	}
 }
 
 void PerfInfo::DrawRendererStats()
@@ -403,6 +815,12 @@ void PerfInfo::DrawRendererStats()
 	const Uint32 numLines = stats.m_stats[Graphics::Stats::STAT_NUM_LINES];
 	const Uint32 numPoints = stats.m_stats[Graphics::Stats::STAT_NUM_POINTS];
 	const Uint32 numCmdListFlushes = stats.m_stats[Graphics::Stats::STAT_NUM_CMDLIST_FLUSHES];
+	const Uint32 numCmdListSubmits = stats.m_stats[Graphics::Stats::STAT_NUM_CMDLIST_SUBMITS];
+	const Uint32 numProgramSwitchesAvoided = stats.m_stats[Graphics::Stats::STAT_PROGRAM_SWITCHES_AVOIDED];
+	const Uint32 numTextureSwitchesAvoided = stats.m_stats[Graphics::Stats::STAT_TEXTURE_SWITCHES_AVOIDED];
+	const Uint32 numStateSwitchesAvoided = stats.m_stats[Graphics::Stats::STAT_RENDER_STATE_SWITCHES_AVOIDED];
+	const Uint32 numBatchedInstancedDraws = stats.m_stats[Graphics::Stats::STAT_BATCHED_INSTANCED_DRAWS];
+	const Uint32 numBatchedDrawsSaved = stats.m_stats[Graphics::Stats::STAT_BATCHED_DRAWS_SAVED];
 	const Uint32 numBuffersCreated = stats.m_stats[Graphics::Stats::STAT_CREATE_BUFFER];
 	const Uint32 numBuffersInUse = stats.m_stats[Graphics::Stats::STAT_BUFFER_INUSE];
 	const Uint32 numDynamicBuffersCreated = stats.m_stats[Graphics::Stats::STAT_DYNAMIC_DRAW_BUFFER_CREATED];
@@ -421,7 +839,10 @@ void PerfInfo::DrawRendererStats()
 	const Uint32 numDrawGasGiants = stats.m_stats[Graphics::Stats::STAT_GASGIANTS];
 	const Uint32 numDrawStars = stats.m_stats[Graphics::Stats::STAT_STARS];
 	const Uint32 numDrawShips = stats.m_stats[Graphics::Stats::STAT_SHIPS];
+	const Uint32 numOccludedBodies = stats.m_stats[Graphics::Stats::STAT_OCCLUDED_BODIES];
 	const Uint32 numDrawBillBoards = stats.m_stats[Graphics::Stats::STAT_BILLBOARD];
+	const Uint32 numDrawThrusters = stats.m_stats[Graphics::Stats::STAT_THRUSTERS];
+	const Uint32 numEffectBatchDraws = stats.m_stats[Graphics::Stats::STAT_EFFECT_BATCH_DRAWS];
 
 	const Uint32 numTex2ds = stats.m_stats[Graphics::Stats::STAT_NUM_TEXTURE2D];
 	const Uint32 tex2dMemUsage = stats.m_stats[Graphics::Stats::STAT_MEM_TEXTURE2D];
@@ -433,8 +854,8 @@ void PerfInfo::DrawRendererStats()
 	const Uint32 cachedTextureMemUsage = tex2dMemUsage + texCubeMemUsage + texArray2dMemUsage;
 
 	ImGui::SeparatorText("Renderer");
-	ImGui::Text("%u Draw calls, %u CommandList flushes",
-		numDrawCalls, numCmdListFlushes);
+	ImGui::Text("%u Draw calls, %u CommandList flushes, %u CommandLists submitted",
+		numDrawCalls, numCmdListFlushes, numCmdListSubmits);
 
 	ImGui::Indent();
 	ImGui::Text("%u points", numPoints);
@@ -447,13 +868,17 @@ void PerfInfo::DrawRendererStats()
 		numDrawBuildings, numDrawCities, numDrawGroundStations, numDrawSpaceStations);
 	ImGui::Text("%u Atmospheres, %u Planets, %u Gas Giants, %u Stars, %u Ships",
 		numDrawAtmospheres, numDrawPlanets, numDrawGasGiants, numDrawStars, numDrawShips);
-	ImGui::Text("%u Billboards, %u GeoPatches (%d tris)",
-		numDrawBillBoards, Pi::statNumPatches, Pi::statSceneTris);
+	ImGui::Text("%u Billboards, %u GeoPatches (%d tris), %u Bodies occluded",
+		numDrawBillBoards, Pi::statNumPatches, Pi::statSceneTris, numOccludedBodies);
+	ImGui::Text("%u Thrusters, drawn with the billboards in %u batched effect draws", numDrawThrusters, numEffectBatchDraws);
 	ImGui::Text("%u Buffers Created (%u in use)", numBuffersCreated, numBuffersInUse);
 	ImGui::Text("%u Dynamic Draw Buffers Created (%u in use)", numDynamicBuffersCreated, numDynamicBuffersInUse);
 	ImGui::Text("%u Draw Uniform Buffers (%u allocations)", numDrawBuffers, numDrawBufferAllocs);
 	ImGui::Spacing();
 
+	ImGui::Text("%u program, %u texture, %u render state switches avoided by sorting",
+		numProgramSwitchesAvoided, numTextureSwitchesAvoided, numStateSwitchesAvoided);
+	ImGui::Text("%u instanced draws batched, saving %u draw calls", numBatchedInstancedDraws, numBatchedDrawsSaved);
 	ImGui::Text("%u cached shader programs", numShaderPrograms);
 	ImGui::Text("%u cached render states", numRenderStates);
 	ImGui::Text("%u cached textures, using %.3f MB VRAM", numCachedTextures, double(cachedTextureMemUsage) / scale_MB);
@@ -467,6 +892,59 @@ void PerfInfo::DrawRendererStats()
 	ImGui::Text("%u Texture2D in cache (%.3f MB)", numTex2ds, double(tex2dMemUsage) / scale_MB);
 	ImGui::Text("%u Cubemaps in cache (%.3f MB)", numTexCubemaps, double(texCubeMemUsage) / scale_MB);
 	ImGui::Text("%u TextureArray2D in cache (%.3f MB)", numTexArray2ds, double(texArray2dMemUsage) / scale_MB);
+
+	DrawGPUTiming();
+}
+
+void PerfInfo::DrawGPUTiming()
+{
+	ImGui::SeparatorText("GPU Timing");
+
+	// dynamic resolution and frame pacing run off the GPU times, so they
+	// can't be turned off
+	const Graphics::DynamicResolution *dynres = Pi::GetApp()->GetDynamicResolution();
+	const bool timingRequired = dynres || Pi::GetApp()->IsLowLatencyMode();
+	if (timingRequired)
+		m_state->gpuTiming = true;
+	if (dynres) {
+		ImGui::Text("Dynamic resolution: scene drawn at %.0f%% scale (%.1f ms budget)",
+			dynres->GetScale() * 100.f, dynres->GetSettings().targetFrameTime);
+	}
+
+	ImGui::BeginDisabled(timingRequired);
+	if (ImGui::Checkbox("Time GPU work", &m_state->gpuTiming)) {
+		Pi::renderer->SetGPUTimingEnabled(m_state->gpuTiming);
+		if (!m_state->gpuTiming) {
+			ClearCounter(COUNTER_GPU);
+			m_state->gpuZoneCounters.clear();
+		}
+	}
+	ImGui::EndDisabled();
+
+	if (!m_state->gpuTiming)
+		return;
+
+	DrawCounter(m_gpuCounter, "##gpuframet", 0.0, 33.0, 45, true);
+	ImGui::Spacing();
+
+	// zones in the order the GPU ran them, nested ones indented
+	for (const Graphics::Renderer::GPUZoneTime &zone : Pi::renderer->GetGPUZoneTimes()) {
+		auto iter = m_state->gpuZoneCounters.find(zone.name);
+		if (iter == m_state->gpuZoneCounters.end())
+			continue;
+
+		CounterInfo &counter = iter->second;
+		const float indent = ImGui::GetStyle().IndentSpacing * zone.depth;
+		if (indent > 0.f)
+			ImGui::Indent(indent);
+
+		ImGui::PushID(counter.name);
+		DrawCounter(counter, "##gpuzone", 0.0, std::max(counter.max, 1.f), 25, true);
+		ImGui::PopID();
+
+		if (indent > 0.f)
+			ImGui::Unindent(indent);
+	}
 }
 
 void PerfInfo::DrawWorldViewStats()
@@ -630,6 +1108,8 @@ void PerfInfo::DrawImGuiStats()
 	ImGui::Text("%d verts, %d tris", io.MetricsRenderVertices, io.MetricsRenderIndices / 3);
 	ImGui::Text("%d active windows (%d visible)", io.MetricsActiveWindows, io.MetricsRenderWindows);
 	ImGui::Text("%d current allocations", io.MetricsActiveAllocations);
+	ImGui::Text("%zu cached regions", Pi::pigui->GetDrawCache().GetNumRegions());
+	ImGui::Text("%zu cached text sizes", Pi::pigui->GetTextSizeCache().GetNumEntries());
 
 	if (ImGui::Button("Toggle Metrics Window")) {
 		m_state->metricsWindowOpen = !m_state->metricsWindowOpen;
@@ -5,6 +5,7 @@
 
 #include "PerfStats.h"
 #include <array>
+#include <string>
 
 namespace PiGui {
 
@@ -19,6 +20,11 @@ namespace PiGui {
 			COUNTER_PIGUI,
 			COUNTER_PROCMEM,
 			COUNTER_LUAMEM,
+			COUNTER_POOLALLOC,
+			COUNTER_POOLHEAP,
+			COUNTER_GEOBUDGET,
+			COUNTER_GPU,
+			COUNTER_LATENCY,
 		};
 
 		// Information about the current process memory usage in KB.
@@ -57,6 +63,11 @@ namespace PiGui {
 		void SetShowDebugInfo(bool open);
 		void SetUpdatePause(bool pause);
 
+		// Write the Perf::Timeline of every thread to a Chrome trace file in
+		// the user's profiler directory, returning its path or an empty
+		// string on failure
+		static std::string ExportTimeline();
+
 	private:
 		void DrawPerfWindow();
 		void DrawTextureCache();
@@ -67,8 +78,15 @@ namespace PiGui {
 		void DrawWorldViewStats();
 		void DrawImGuiStats();
 		void DrawInputDebug();
+		void DrawLuaProfiler();
 		void DrawStatList(const Perf::Stats::FrameInfo &fi);
+		void DrawTimeline();
+
+		void DrawGPUTiming();
+		void DrawAllocTracking();
+		void UpdateAllocStats();
 
+		void UpdateCounter(CounterInfo &counter, float sample);
 		void DrawCounter(CounterInfo &counter, const char *label, float min, float max, float height, bool drawStats = false);
 		CounterInfo &GetCounter(CounterType ct);
 
@@ -76,6 +94,11 @@ namespace PiGui {
 		CounterInfo m_fpsCounter;
 		CounterInfo m_physCounter;
 		CounterInfo m_piguiCounter;
+		CounterInfo m_poolAllocCounter;
+		CounterInfo m_poolHeapCounter;
+		CounterInfo m_geoBudgetCounter;
+		CounterInfo m_gpuCounter;
+		CounterInfo m_latencyCounter;
 
 		// Per-second counters
 		CounterInfo m_procMemCounter;
@@ -83,6 +106,9 @@ namespace PiGui {
 
 		MemoryInfo process_mem;
 		size_t lua_mem = 0;
+		// running PoolAllocator totals as of the previous frame
+		uint64_t m_lastPoolAllocs = 0;
+		uint64_t m_lastPoolHeapAllocs = 0;
 		float framesThisSecond = 0;
 		float physFramesThisSecond = 0;
 
@@ -8,6 +8,7 @@
 #include "Pi.h"
 #include "PiGuiRenderer.h"
 
+#include "core/PerfTimeline.h"
 #include "core/TaskGraph.h"
 #include "graphics/Graphics.h"
 #include "graphics/Material.h"
@@ -21,6 +22,7 @@
 #include <float.h>
 #include <stdio.h>
 #include <string.h>
+#include <thread>
 
 #define NANOSVG_IMPLEMENTATION
 #include "nanosvg/nanosvg.h"
@@ -153,6 +155,96 @@ private:
 	NSVGimage *image;
 };
 
+// Build a complete font atlas on a separate thread. The fonts and their glyph
+// ranges are gathered on the main thread; loading the font files, rasterizing
+// and packing the glyphs happen here, away from the frame.
+class PiGui::BakeFontsTask : public Task, public CompleteNotifier {
+public:
+	struct FontData {
+		PiFont *font;
+		ImVector<ImWchar> ranges;
+		// one per face, null for TTF faces
+		std::vector<RasterizeSVGResult *> svgData;
+		ImFont *imfont = nullptr;
+	};
+
+	BakeFontsTask() :
+		atlas(new ImFontAtlas())
+	{
+		SetOwner(this);
+	}
+
+	virtual void OnExecute(TaskRange range) override
+	{
+		PROFILE_SCOPED()
+		PERF_ZONE("Bake Fonts")
+
+		for (FontData &data : fonts)
+			AddFont(data);
+
+		atlas->Build();
+
+		for (PiFont::CustomGlyphData &glyphData : customGlyphs)
+			glyphData.face->finishSVGFaceData(atlas.get(), glyphData.font, glyphData.pixelSize, glyphData.svgData, glyphData.glyphRects.get());
+		customGlyphs.clear();
+
+		// convert to the format the texture is uploaded in while still off the main thread
+		uint8_t *pixels;
+		atlas->GetTexDataAsRGBA32(&pixels, nullptr, nullptr);
+	}
+
+	std::unique_ptr<ImFontAtlas> atlas;
+	std::vector<FontData> fonts;
+
+private:
+	void AddFont(FontData &data)
+	{
+		PiFont &font = *data.font;
+		ImFontConfig config;
+
+		// Set the ImGui font name for debugging purposes
+		std::string name = fmt::format("{}:{}", font.name(), font.pixelsize());
+		strncpy(config.Name, name.c_str(), 39);
+
+		// The main face of the font should go first in the list, because:
+		//
+		// - when a glyph is loaded from the font, a search is started in
+		// the faces, and the faces are scanned in the order of this list
+		// ( see ImFontAtlasBuildWithStbTruetype in imgui.cpp )
+		//
+		// - the default imgui glyph range ( 0x20 .. 0xFF ) is almost always
+		// defined in every font, so the first font will provide the glyphs for
+		// the basic range
+		//
+		for (size_t idx = 0; idx < font.faces().size(); idx++) {
+			PiFace &face = font.faces()[idx];
+			config.MergeMode = data.imfont != nullptr;
+
+			if (face.isSvgFont()) {
+				if (!data.svgData[idx])
+					continue;
+
+				PiFont::CustomGlyphData glyphData = {};
+				glyphData.face = &face;
+				glyphData.pixelSize = font.pixelsize();
+				glyphData.svgData = data.svgData[idx];
+				glyphData.glyphRects.reset(new ImVector<int>);
+				glyphData.font = face.addSVGFaceToAtlas(atlas.get(), font.pixelsize(), &config, &data.ranges, glyphData.svgData, glyphData.glyphRects.get());
+
+				if (!glyphData.glyphRects->empty())
+					customGlyphs.emplace_back(std::move(glyphData));
+			} else {
+				ImFont *f = face.addTTFFaceToAtlas(atlas.get(), font.pixelsize(), &config, &data.ranges);
+				if (data.imfont != nullptr)
+					assert(f == data.imfont);
+				data.imfont = f;
+			}
+		}
+	}
+
+	std::vector<PiFont::CustomGlyphData> customGlyphs;
+};
+
 static Graphics::Texture *makeSVGTexture(Graphics::Renderer *renderer, int width, int height)
 {
 	const vector3f dataSize(width, height, 0.f);
@@ -228,6 +320,7 @@ void StyleColorsDarkPlus(ImGuiStyle &style)
 Instance::Instance(GuiApplication *app) :
 	m_app(app),
 	m_should_bake_fonts(true),
+	m_bakeFontsTask(nullptr),
 	m_debugStyle(),
 	m_debugStyleActive(false)
 {
@@ -390,7 +483,9 @@ void Instance::Init(Graphics::Renderer *renderer)
 	m_instanceRenderer.reset(new InstanceRenderer(renderer));
 
 	IMGUI_CHECKVERSION();
-	ImGui::CreateContext();
+	// the atlas is ours, so it can be replaced by one baked in the background
+	m_fontAtlas.reset(new ImFontAtlas());
+	ImGui::CreateContext(m_fontAtlas.get());
 
 	// TODO: FIXME before upgrading! The sdl_gl_context parameter is currently
 	// unused, but that is slated to change very soon.
@@ -460,11 +555,19 @@ void Instance::NewFrame()
 
 	m_svgFontTasks.erase(std::remove(m_svgFontTasks.begin(), m_svgFontTasks.end(), nullptr), m_svgFontTasks.end());
 
-	// Bake fonts before a frame is begun.
+	// Swap in newly-baked fonts before a frame is begun.
 	// This avoids any dangling texture pointers from recreating the texture between
 	// issuing draw commands and rendering
-	if (m_should_bake_fonts) {
-		BakeFonts();
+	if (m_bakeFontsTask && m_bakeFontsTask->IsComplete()) {
+		FinishBakeFonts(m_bakeFontsTask);
+		m_bakeFontsTask = nullptr;
+	}
+
+	// Until then, the current fonts show missing glyphs as the fallback
+	// character. Nothing can be drawn without the first atlas, so that one
+	// is baked right away.
+	if (m_should_bake_fonts && !m_bakeFontsTask) {
+		BakeFonts(ImGui::GetIO().Fonts->IsBuilt());
 	}
 
 	switch (m_renderer->GetRendererType()) {
@@ -478,6 +581,8 @@ void Instance::NewFrame()
 	}
 	ImGui_ImplSDL2_NewFrame(m_renderer->GetSDLWindow());
 	ImGui::NewFrame();
+	m_drawCache.NewFrame();
+	m_textSizeCache.NewFrame();
 
 	m_renderer->CheckRenderErrors(__FUNCTION__, __LINE__);
 	ImGui::SetMouseCursor(ImGuiMouseCursor_Arrow);
@@ -495,8 +600,12 @@ void Instance::EndFrame()
 void Instance::Render()
 {
 	PROFILE_SCOPED()
+	PERF_ZONE("PiGui Render")
 	EndFrame();
 
+	// the zone's start is written by the flush below, its end by the next one
+	Graphics::Renderer::GPUZoneTicket zone(m_renderer, "PiGui");
+
 	// FIXME: renderer uses async command execution but imgui impl is still directly generating GL commands
 	m_renderer->FlushCommandBuffers();
 
@@ -512,16 +621,6 @@ void Instance::Render()
 	}
 }
 
-void Instance::ClearFonts()
-{
-	PROFILE_SCOPED()
-	ImGuiIO &io = ImGui::GetIO();
-	// TODO: should also release all glyph_ranges...
-	m_fonts.clear();
-	m_im_fonts.clear();
-	io.Fonts->Clear();
-}
-
 RasterizeSVGResult *Instance::RequestSVGFaceData(PiFace *face, int pixelsize)
 {
 	int width = face->m_svgcolumns * pixelsize;
@@ -548,12 +647,10 @@ RasterizeSVGResult *Instance::RequestSVGFaceData(PiFace *face, int pixelsize)
 	return bestResult;
 }
 
-// this function rasterizes a specific font
-void Instance::BakeFont(PiFont &font)
+// this function gathers what is needed to rasterize a specific font
+void Instance::BakeFont(BakeFontsTask *task, PiFont &font)
 {
 	PROFILE_SCOPED()
-	ImGuiIO &io = ImGui::GetIO();
-	ImFont *imfont = nullptr;
 
 	// note that if there are no ranges at all in the font, it is ignored
 	if (font.used_ranges().empty()) {
@@ -565,7 +662,7 @@ void Instance::BakeFont(PiFont &font)
 
 	// ( default imgui glyph range - 0x0020 .. 0x00FF : Basic Latin + Latin Supplement )
 	if (font.definition().loadDefaultRange)
-		gb.AddRanges(io.Fonts->GetGlyphRangesDefault());
+		gb.AddRanges(ImGui::GetIO().Fonts->GetGlyphRangesDefault());
 
 	// Add any glyphs outside of the default range that have been used at least once before
 	ImWchar gr[3] = { 0, 0, 0 };
@@ -575,63 +672,24 @@ void Instance::BakeFont(PiFont &font)
 		gb.AddRanges(gr);
 	}
 
-	ImVector<ImWchar> *font_char_ranges = new ImVector<ImWchar>;
-	m_glyphRanges.emplace_back(font_char_ranges);
-
-	gb.BuildRanges(font_char_ranges);
-
-	ImFontConfig config;
-
-	// Set the ImGui font name for debugging purposes
-	std::string name = fmt::format("{}:{}", font.name(), font.pixelsize());
-	strncpy(config.Name, name.c_str(), 39);
+	BakeFontsTask::FontData &data = task->fonts.emplace_back();
+	data.font = &font;
+	gb.BuildRanges(&data.ranges);
 
-	// The main face of the font should go first in the list, because:
-	//
-	// - when a glyph is loaded from the font, a search is started in
-	// the faces, and the faces are scanned in the order of this list
-	// ( see ImFontAtlasBuildWithStbTruetype in imgui.cpp )
-	//
-	// - the default imgui glyph range ( 0x20 .. 0xFF ) is almost always
-	// defined in every font, so the first font will provide the glyphs for
-	// the basic range
-	//
 	for (PiFace &face : font.faces()) {
-		config.MergeMode = imfont != nullptr;
+		RasterizeSVGResult *svgData = nullptr;
 
 		if (face.isSvgFont()) {
-			PiFont::CustomGlyphData data = {};
-			data.face = &face;
-
-			data.svgData = RequestSVGFaceData(&face, font.pixelsize());
-			if (!data.svgData) {
+			svgData = RequestSVGFaceData(&face, font.pixelsize());
+			if (!svgData)
 				Log::Warning("No SVG data available to rasterize icon font {}", face.svgname());
-				continue;
-			}
-
-			data.glyphRects.reset(new ImVector<int>);
-			data.font = face.addSVGFaceToAtlas(font.pixelsize(), &config, font_char_ranges, data.svgData, data.glyphRects.get());
-
-			if (!data.glyphRects->empty())
-				font.custom_glyphs().emplace_back(std::move(data));
-		} else {
-			ImFont *f = face.addTTFFaceToAtlas(font.pixelsize(), &config, font_char_ranges);
-			if (imfont != nullptr)
-				assert(f == imfont);
-			imfont = f;
 		}
-	}
 
-	m_im_fonts[imfont] = std::make_pair(font.name(), font.pixelsize());
-	// 	Output("setting %s %i to %p\n", font.name(), font.pixelsize(), imfont);
-	m_fonts[std::make_pair(font.name(), font.pixelsize())] = imfont;
-	if (!imfont->MissingGlyphs.empty()) {
-		Log::Warning("PiGui: newly-built font {}:{} has glyphs missing", font.name(), font.pixelsize());
-		imfont->MissingGlyphs.clear();
+		data.svgData.push_back(svgData);
 	}
 }
 
-void Instance::BakeFonts()
+void Instance::BakeFonts(bool async)
 {
 	PROFILE_SCOPED()
 	//	Output("Baking fonts\n");
@@ -643,40 +701,74 @@ void Instance::BakeFonts()
 		return;
 	}
 
-	ClearFonts();
+	BakeFontsTask *task = new BakeFontsTask();
 
 	// first bake tooltip/default font
-	BakeFont(m_pi_fonts.at(std::make_pair("pionillium", 14)));
+	BakeFont(task, m_pi_fonts.at(std::make_pair("pionillium", 14)));
 
 	for (auto &iter : m_pi_fonts) {
 		// don't bake tooltip/default font again
 		if (!(iter.first.first == "pionillium" && iter.first.second == 14))
-			BakeFont(iter.second);
-		//		Output("Fonts registered: %i\n", io.Fonts->Fonts.Size);
+			BakeFont(task, iter.second);
+	}
+
+	if (async) {
+		m_bakeFontsTask = task;
+		m_app->GetTaskGraph()->QueueTask(task);
+	} else {
+		task->OnExecute({});
+		FinishBakeFonts(task);
 	}
+}
 
-	ImGui::GetIO().Fonts->Build();
+void Instance::FinishBakeFonts(BakeFontsTask *task)
+{
+	PROFILE_SCOPED()
 
-	for (auto &iter : m_pi_fonts) {
-		for (auto &glyph_data : iter.second.custom_glyphs()) {
-			glyph_data.face->finishSVGFaceData(glyph_data.font, iter.second.pixelsize(), glyph_data.svgData, glyph_data.glyphRects.get());
-		}
+	// fonts requested since the bake began stay known, but unbaked
+	for (auto &iter : m_fonts)
+		iter.second = nullptr;
+	m_im_fonts.clear();
 
-		iter.second.custom_glyphs().clear();
-	}
+	for (BakeFontsTask::FontData &data : task->fonts) {
+		auto key = std::make_pair(data.font->name(), data.font->pixelsize());
+		ImFont *imfont = data.imfont;
+		if (!imfont)
+			continue;
 
-	for (ImVector<ImWchar> *scratchVec : m_glyphRanges) {
-		delete scratchVec;
+		m_im_fonts[imfont] = key;
+		// 	Output("setting %s %i to %p\n", key.first, key.second, imfont);
+		m_fonts[key] = imfont;
+		if (!imfont->MissingGlyphs.empty()) {
+			Log::Warning("PiGui: newly-built font {}:{} has glyphs missing", key.first, key.second);
+			imfont->MissingGlyphs.clear();
+		}
 	}
 
-	m_glyphRanges.clear();
+	// cached regions and sizes refer to the old atlas
+	m_drawCache.Clear();
+	m_textSizeCache.Clear();
 
+	ImGui::GetIO().Fonts = task->atlas.get();
+	m_fontAtlas = std::move(task->atlas);
+	delete task;
+
+	// updated in place unless the atlas changed size
 	m_instanceRenderer->CreateFontsTexture();
 }
 
 void Instance::Uninit()
 {
 	PROFILE_SCOPED()
+	// the task refers to our fonts
+	if (m_bakeFontsTask) {
+		while (!m_bakeFontsTask->IsComplete())
+			std::this_thread::yield();
+
+		delete m_bakeFontsTask;
+		m_bakeFontsTask = nullptr;
+	}
+
 	for (auto tex : m_svg_textures) {
 		delete tex;
 	}
@@ -692,6 +784,7 @@ void Instance::Uninit()
 
 	ImGui_ImplSDL2_Shutdown();
 	ImGui::DestroyContext();
+	m_fontAtlas.reset();
 	delete[] m_ioIniFilename;
 }
 
@@ -699,21 +792,20 @@ void Instance::Uninit()
 // PiGui::PiFace
 //
 
-ImFont *PiFace::addTTFFaceToAtlas(int pixelSize, ImFontConfig *config, ImVector<ImWchar> *ranges)
+ImFont *PiFace::addTTFFaceToAtlas(ImFontAtlas *atlas, int pixelSize, ImFontConfig *config, ImVector<ImWchar> *ranges)
 {
 	float size = pixelSize * sizefactor();
 	const std::string path = FileSystem::JoinPath(FileSystem::JoinPath(FileSystem::GetDataDir(), "fonts"), ttfname());
-	ImFont *f = ImGui::GetIO().Fonts->AddFontFromFileTTF(path.c_str(), size, config, ranges->Data);
+	ImFont *f = atlas->AddFontFromFileTTF(path.c_str(), size, config, ranges->Data);
 	assert(f);
 
 	return f;
 }
 
-ImFont *PiFace::addSVGFaceToAtlas(int pixelSize, ImFontConfig *config, ImVector<ImWchar> *ranges, RasterizeSVGResult *svgData, ImVector<int> *outGlyphRects)
+ImFont *PiFace::addSVGFaceToAtlas(ImFontAtlas *atlas, int pixelSize, ImFontConfig *config, ImVector<ImWchar> *ranges, RasterizeSVGResult *svgData, ImVector<int> *outGlyphRects)
 {
 	assert(config->MergeMode);
 
-	ImFontAtlas *atlas = ImGui::GetIO().Fonts;
 	ImFont *font = atlas->Fonts.back();
 
 	// we'll stretch the icon/character size if we're rendering with a lower-resolution fallback
@@ -742,10 +834,8 @@ int RGBA32TexOffsetFromCoords(int x, int y, int pitch)
 	return (pitch * y * 4) + (x * 4);
 }
 
-void PiFace::finishSVGFaceData(ImFont *font, int pixelSize, RasterizeSVGResult *svgData, ImVector<int> *glyphRects)
+void PiFace::finishSVGFaceData(ImFontAtlas *atlas, ImFont *font, int pixelSize, RasterizeSVGResult *svgData, ImVector<int> *glyphRects)
 {
-	ImFontAtlas *atlas = ImGui::GetIO().Fonts;
-
 	// Ensure texture data pointer is available and in RGBA32
 	uint8_t *texData;
 	int texWidth;
@@ -3,12 +3,15 @@
 
 #pragma once
 
+#include "DrawCache.h"
+#include "TextSizeCache.h"
 #include "FileSystem.h"
 #include "RefCounted.h"
 #include "imgui/imgui.h"
 
 #include "utils.h"
 
+#include <deque>
 #include <map>
 #include <unordered_set>
 
@@ -24,6 +27,7 @@ class GuiApplication;
 namespace PiGui {
 
 	class RasterizeSVGTask;
+	class BakeFontsTask;
 
 	struct RasterizeSVGResult {
 		RasterizeSVGResult(uint8_t *data, int width, int height) :
@@ -63,13 +67,13 @@ namespace PiGui {
 		int svgRows() const { return m_svgrows; }
 		int svgCols() const { return m_svgcolumns; }
 
-		// Add this fontface at the specified size to the global font atlas
-		ImFont *addTTFFaceToAtlas(int pixelSize, ImFontConfig *config, ImVector<ImWchar> *ranges);
+		// Add this fontface at the specified size to the given font atlas
+		ImFont *addTTFFaceToAtlas(ImFontAtlas *atlas, int pixelSize, ImFontConfig *config, ImVector<ImWchar> *ranges);
 
-		// Add this SVG fontface at the specified size to the global font atlas
-		ImFont *addSVGFaceToAtlas(int pixelSize, ImFontConfig *config, ImVector<ImWchar> *ranges, RasterizeSVGResult *svgData, ImVector<int> *outGlyphRects);
-		// Copy the pixel data for this fontface into the global font atlas
-		void finishSVGFaceData(ImFont *font, int pixelSize, RasterizeSVGResult *svgData, ImVector<int> *glyphRects);
+		// Add this SVG fontface at the specified size to the given font atlas
+		ImFont *addSVGFaceToAtlas(ImFontAtlas *atlas, int pixelSize, ImFontConfig *config, ImVector<ImWchar> *ranges, RasterizeSVGResult *svgData, ImVector<int> *outGlyphRects);
+		// Copy the pixel data for this fontface into the given (built) font atlas
+		void finishSVGFaceData(ImFontAtlas *atlas, ImFont *font, int pixelSize, RasterizeSVGResult *svgData, ImVector<int> *glyphRects);
 
 	private:
 		friend class Instance; // need access to some private data
@@ -105,6 +109,7 @@ namespace PiGui {
 		struct CustomGlyphData {
 			ImFont *font;
 			PiFace *face;
+			int pixelSize;
 			std::unique_ptr<ImVector<int>> glyphRects;
 			RasterizeSVGResult *svgData;
 		};
@@ -121,8 +126,6 @@ namespace PiGui {
 		int pixelsize() const { return m_pixelsize; }
 		const PiFontDefinition &definition() const { return m_fontDef; }
 
-		std::vector<CustomGlyphData> &custom_glyphs() { return m_custom_glyphs; }
-
 		void describe(bool withFaces = false) const;
 
 		bool addGlyph(unsigned short glyph);
@@ -131,7 +134,6 @@ namespace PiGui {
 		PiFontDefinition &m_fontDef;
 		int m_pixelsize;
 		std::vector<UsedRange> m_used_ranges;
-		std::vector<CustomGlyphData> m_custom_glyphs;
 	};
 
 	class InstanceRenderer;
@@ -146,6 +148,12 @@ namespace PiGui {
 
 		InstanceRenderer *GetRenderer() { return m_instanceRenderer.get(); }
 
+		// Retained draw data for UI regions that rarely change
+		DrawCache &GetDrawCache() { return m_drawCache; }
+
+		// Sizes of recently measured text
+		TextSizeCache &GetTextSizeCache() { return m_textSizeCache; }
+
 		// Call at the start of every frame. Calls ImGui::NewFrame() internally.
 		void NewFrame();
 
@@ -184,13 +192,21 @@ namespace PiGui {
 
 		std::map<std::string, PiFontDefinition> m_font_definitions;
 
-		std::vector<ImVector<ImWchar> *> m_glyphRanges;
+		// The atlas ImGui draws with. A rebuilt atlas is baked on a worker
+		// thread while this one stays in use, and swapped in by NewFrame().
+		std::unique_ptr<ImFontAtlas> m_fontAtlas;
+		BakeFontsTask *m_bakeFontsTask;
+
 		std::vector<RasterizeSVGTask *> m_svgFontTasks;
-		std::map<std::string, std::vector<RasterizeSVGResult>> m_svgFontRasterData;
+		// a deque, so results stay put while a bake task refers to them
+		std::map<std::string, std::deque<RasterizeSVGResult>> m_svgFontRasterData;
 
 		ImGuiStyle m_debugStyle;
 		bool m_debugStyleActive;
 
+		DrawCache m_drawCache;
+		TextSizeCache m_textSizeCache;
+
 		void AddFontDefinition(const PiFontDefinition &font)
 		{
 			m_font_definitions[font.name] = font;
@@ -198,9 +214,10 @@ namespace PiGui {
 
 		void LoadFontDefinitionFromFile(const std::string &filePath);
 
-		void BakeFonts();
-		void BakeFont(PiFont &font);
-		void ClearFonts();
+		// Bake every font into a new atlas, either right away or on a worker thread
+		void BakeFonts(bool async);
+		void BakeFont(BakeFontsTask *task, PiFont &font);
+		void FinishBakeFonts(BakeFontsTask *task);
 
 		RasterizeSVGResult *RequestSVGFaceData(PiFace *face, int pixelsize);
 	};
@@ -16,6 +16,7 @@ public:
 	virtual void Update() override {}
 	virtual void Draw3D() override {}
 	virtual void DrawPiGui() override;
+	virtual bool HasScene() override { return false; }
 
 	const std::string &GetViewName() { return m_handlerName; }
 
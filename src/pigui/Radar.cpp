@@ -1,13 +1,22 @@
 
 #include "Radar.h"
 #include "MathUtil.h"
+#include "Player.h"
+#include "Sensors.h"
+#include "Ship.h"
 #include "imgui/imgui.h"
+#include "imgui/imgui_internal.h"
 #include "profiler/Profiler.h"
 
+#include <algorithm>
+
 using RadarWidget = PiGui::RadarWidget;
 
 static constexpr int RADAR_STEPS = 100;
 
+// quads reserved at once, keeping each reservation well within 16-bit indices
+static constexpr size_t MAX_BATCH_QUADS = 4096;
+
 ImVec2 circlePos(float a, ImVec2 center, ImVec2 radius, float scale = 1.0f)
 {
 	return ImVec2(center.x + sin(a) * scale * radius.x, center.y + cos(a) * scale * radius.y);
@@ -95,3 +104,135 @@ void RadarWidget::DrawPiGui()
 	}
 	drawList->PathStroke(ImGui::GetColorU32(ImGuiCol_FrameBgActive), false, 6.0f);
 }
+
+// Reserve space for count quads in as few reservations as possible and let
+// emit(i) write each of them. Consecutive reservations share the draw list's
+// texture and clip rect, so ImGui folds them into a single draw command.
+template <typename EmitFn>
+static void AddQuadBatch(ImDrawList *drawList, size_t count, EmitFn &&emit)
+{
+	for (size_t start = 0; start < count; start += MAX_BATCH_QUADS) {
+		const size_t end = std::min(count, start + MAX_BATCH_QUADS);
+		drawList->PrimReserve(int(end - start) * 6, int(end - start) * 4);
+		for (size_t i = start; i < end; i++)
+			emit(i);
+	}
+}
+
+// Write a line as a quad into space already reserved. Unlike AddLine() this
+// is not anti-aliased, which is fine for the thin lines drawn here.
+static void PrimLine(ImDrawList *drawList, ImVec2 a, ImVec2 b, float thickness, ImU32 col)
+{
+	ImVec2 dir(b.x - a.x, b.y - a.y);
+	const float len = sqrtf(dir.x * dir.x + dir.y * dir.y);
+	const float scale = len > 0.f ? 0.5f * thickness / len : 0.f;
+	const ImVec2 n(-dir.y * scale, dir.x * scale);
+
+	const ImVec2 uv = drawList->_Data->TexUvWhitePixel;
+	drawList->PrimQuadUV(ImVec2(a.x + n.x, a.y + n.y), ImVec2(b.x + n.x, b.y + n.y),
+		ImVec2(b.x - n.x, b.y - n.y), ImVec2(a.x - n.x, a.y - n.y),
+		uv, uv, uv, uv, col);
+}
+
+void RadarWidget::DrawContacts(const Ship *owner, const RadarContactStyle &style, const RadarContactFilter &filter)
+{
+	PROFILE_SCOPED()
+
+	Sensors *sensors = owner->GetSensors();
+	if (!sensors || m_currentZoom <= 0.f)
+		return;
+
+	const Body *combatTarget = nullptr;
+	const Body *navTarget = nullptr;
+	if (owner->IsType(ObjectType::PLAYER)) {
+		combatTarget = static_cast<const Player *>(owner)->GetCombatTarget();
+		navTarget = static_cast<const Player *>(owner)->GetNavTarget();
+	}
+
+	// contact positions in the owner's coordinates, where -z is forward and
+	// shown at the top of the disk, and +y is up
+	const matrix3x3d &orient = owner->GetInterpOrient();
+	const double scale = 1.0 / m_currentZoom;
+
+	auto project = [this](const vector3d &p) {
+		return ImVec2(m_center.x + float(p.x) * m_radius.x, m_center.y + float(p.z) * m_radius.y);
+	};
+
+	m_markers.clear();
+
+	// the combat and nav targets, if they're among the contacts
+	size_t targets[2];
+	size_t numTargets = 0;
+
+	for (const Sensors::RadarContact &contact : sensors->GetContacts()) {
+		if (!contact.body || !(filter.iffMask & (1u << contact.iff)))
+			continue;
+
+		vector3d pos = (contact.body->GetInterpPositionRelTo(owner) * orient) * scale;
+		const double planar = sqrt(pos.x * pos.x + pos.z * pos.z);
+		if (planar > 1.0) {
+			if (!filter.showOutOfRange)
+				continue;
+			pos /= planar;
+		}
+
+		Marker &marker = m_markers.emplace_back();
+		marker.plane = project(pos);
+		marker.blip = ImVec2(marker.plane.x, marker.plane.y - float(pos.y) * m_radius.y);
+
+		const vector3d vel = (contact.body->GetVelocityRelTo(owner) * orient) * (scale * style.velocityTime);
+		const ImVec2 velocity = project(pos + vel);
+		marker.velocity = ImVec2(velocity.x, velocity.y - float(pos.y + vel.y) * m_radius.y);
+
+		Color color = Sensors::IFFColor(contact.iff);
+		color.a = uint8_t(color.a * std::clamp(style.alpha, 0.f, 1.f));
+		marker.color = IM_COL32(color.r, color.g, color.b, color.a);
+
+		if (contact.body == combatTarget || contact.body == navTarget)
+			targets[numTargets++] = m_markers.size() - 1;
+	}
+
+	if (m_markers.empty())
+		return;
+
+	ImDrawList *drawList = ImGui::GetWindowDrawList();
+
+	// stalks first, so the blips sit on top of them
+	if (style.stalkThickness > 0.f) {
+		AddQuadBatch(drawList, m_markers.size(), [&](size_t i) {
+			const Marker &marker = m_markers[i];
+			PrimLine(drawList, marker.plane, marker.blip, style.stalkThickness, marker.color);
+		});
+	}
+
+	if (style.velocityTime > 0.f) {
+		AddQuadBatch(drawList, m_markers.size(), [&](size_t i) {
+			const Marker &marker = m_markers[i];
+			PrimLine(drawList, marker.blip, marker.velocity, style.velocityThickness, marker.color);
+		});
+	}
+
+	const float halfBlip = style.blipSize * 0.5f;
+	AddQuadBatch(drawList, m_markers.size(), [&](size_t i) {
+		const Marker &marker = m_markers[i];
+		drawList->PrimRect(ImVec2(marker.blip.x - halfBlip, marker.blip.y - halfBlip),
+			ImVec2(marker.blip.x + halfBlip, marker.blip.y + halfBlip), marker.color);
+	});
+
+	if (style.bracketSize > 0.f && numTargets > 0) {
+		// each bracket is four corners of two lines each
+		const float size = style.bracketSize;
+		const float arm = size * 0.5f;
+		AddQuadBatch(drawList, numTargets * 8, [&](size_t i) {
+			const Marker &marker = m_markers[targets[i / 8]];
+			const int corner = (i % 8) / 2;
+			const float sx = (corner & 1) ? 1.f : -1.f;
+			const float sy = (corner & 2) ? 1.f : -1.f;
+			const ImVec2 p(marker.blip.x + sx * size, marker.blip.y + sy * size);
+			if (i % 2)
+				PrimLine(drawList, p, ImVec2(p.x, p.y - sy * arm), 1.f, marker.color);
+			else
+				PrimLine(drawList, p, ImVec2(p.x - sx * arm, p.y), 1.f, marker.color);
+		});
+	}
+}
@@ -7,13 +7,40 @@
 #include "imgui/imgui.h"
 #include "vector2.h"
 
+#include <cstdint>
+#include <vector>
+
+class Ship;
+
 namespace PiGui {
+	// Appearance of the sensor contacts drawn by RadarWidget::DrawContacts()
+	struct RadarContactStyle {
+		float blipSize = 4.f;		 // side of the square marking a contact, in pixels
+		float stalkThickness = 1.f;	 // line from the radar plane up to the contact, 0 to hide
+		float velocityTime = 0.f;	 // seconds of relative motion shown as a line from the contact, 0 to hide
+		float velocityThickness = 1.f;
+		float bracketSize = 8.f;	 // half-size of the brackets around the player's targets, 0 to hide
+		float alpha = 1.f;
+	};
+
+	// Which sensor contacts RadarWidget::DrawContacts() shows
+	struct RadarContactFilter {
+		uint32_t iffMask = ~0u;		// bit (1 << Sensors::IFF) set for each IFF shown
+		bool showOutOfRange = true; // pin contacts beyond the zoom distance to the edge of the disk
+	};
+
 	class RadarWidget : public RefCounted {
 	public:
 		// Draws the radar widget
 		// Expected to be called during a Begin/End ImGui block.
 		void DrawPiGui();
 
+		// Draws the sensor contacts of the given ship over the radar disk.
+		// Each kind of marker is written to the draw list as one batch, so
+		// the contacts cost a handful of draw commands however many there are.
+		// Expected to be called after DrawPiGui() in the same window.
+		void DrawContacts(const Ship *owner, const RadarContactStyle &style, const RadarContactFilter &filter);
+
 		// Set the total size of the radar widget
 		void SetSize(ImVec2 size);
 		// Return the total size of the radar widget
@@ -40,6 +67,16 @@ namespace PiGui {
 		ImVec2 GetCenter() const { return m_center; }
 
 	private:
+		struct Marker {
+			ImVec2 plane;	 // position projected onto the radar plane
+			ImVec2 blip;	 // position including the height above the plane
+			ImVec2 velocity; // end of the velocity line
+			ImU32 color;
+		};
+
+		// scratch space reused between frames
+		std::vector<Marker> m_markers;
+
 		ImVec2 m_size;
 		ImVec2 m_radius;
 		ImVec2 m_center;
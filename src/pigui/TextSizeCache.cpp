@@ -0,0 +1,62 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "TextSizeCache.h"
+
+#include "core/FNV1a.h"
+
+using namespace PiGui;
+
+// entries not used for this many frames are dropped
+static constexpr uint32_t MAX_IDLE_FRAMES = 120;
+
+// don't bother keeping long text around, it's rarely measured twice
+static constexpr size_t MAX_TEXT_LENGTH = 256;
+
+ImVec2 TextSizeCache::CalcTextSize(std::string_view text, float wrapWidth)
+{
+	ImFont *font = ImGui::GetFont();
+	const float fontSize = ImGui::GetFontSize();
+
+	if (text.size() > MAX_TEXT_LENGTH)
+		return ImGui::CalcTextSize(text.data(), text.data() + text.size(), false, wrapWidth);
+
+	const struct {
+		ImFont *font;
+		float fontSize;
+		float wrapWidth;
+	} params = { font, fontSize, wrapWidth };
+	const uint64_t key = hash_64_fnv1a(text.data(), text.size()) ^
+		(hash_64_fnv1a(reinterpret_cast<const char *>(&params), sizeof(params)) * 31);
+
+	Entry &entry = m_entries[key];
+	entry.lastFrame = m_frame;
+
+	// a hash collision just replaces the other entry
+	if (entry.font != font || entry.fontSize != fontSize || entry.wrapWidth != wrapWidth || entry.text != text) {
+		entry.text.assign(text.data(), text.size());
+		entry.font = font;
+		entry.fontSize = fontSize;
+		entry.wrapWidth = wrapWidth;
+		entry.size = ImGui::CalcTextSize(text.data(), text.data() + text.size(), false, wrapWidth);
+	}
+
+	return entry.size;
+}
+
+void TextSizeCache::NewFrame()
+{
+	m_frame++;
+
+	for (auto iter = m_entries.begin(); iter != m_entries.end();) {
+		if (m_frame - iter->second.lastFrame > MAX_IDLE_FRAMES)
+			iter = m_entries.erase(iter);
+		else
+			++iter;
+	}
+}
+
+void TextSizeCache::Clear()
+{
+	m_entries.clear();
+}
@@ -0,0 +1,52 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include "imgui/imgui.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace PiGui {
+
+	/*
+	 * Remembers the laid-out size of text, so that strings measured every
+	 * frame (labels, distances, speeds) aren't run through the font again
+	 * while they stay the same.
+	 *
+	 * Entries are keyed by the text, the font and size it was measured with,
+	 * and the wrap width. Entries that haven't been asked for in a while are
+	 * dropped by NewFrame(), and everything when the fonts are rebuilt.
+	 */
+	class TextSizeCache {
+	public:
+		// Equivalent to ImGui::CalcTextSize(text, text_end, false, wrapWidth)
+		// with the current font
+		ImVec2 CalcTextSize(std::string_view text, float wrapWidth = -1.0f);
+
+		// Drop entries that haven't been used for a while
+		void NewFrame();
+
+		// Drop every entry, e.g. when the font atlas is rebuilt
+		void Clear();
+
+		size_t GetNumEntries() const { return m_entries.size(); }
+
+	private:
+		struct Entry {
+			std::string text;
+			ImFont *font = nullptr;
+			float fontSize = 0.f;
+			float wrapWidth = 0.f;
+			ImVec2 size;
+			uint32_t lastFrame = 0;
+		};
+
+		std::unordered_map<uint64_t, Entry> m_entries;
+		uint32_t m_frame = 0;
+	};
+
+} // namespace PiGui
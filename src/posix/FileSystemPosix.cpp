@@ -5,6 +5,8 @@
 #include "buildopts.h"
 #include "utils.h"
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -207,6 +209,7 @@ namespace FileSystem {
 				}
 				fclose(fl);
 
+				RecordRead(this, fullpath);
 				return RefCountedPtr<FileData>(new FileDataMalloc(MakeFileInfo(path, ty, mtime), sz, data));
 			}
 		}
@@ -214,6 +217,57 @@ namespace FileSystem {
 		return RefCountedPtr<FileData>(0);
 	}
 
+	class FileDataMapped : public FileData {
+	public:
+		FileDataMapped(const FileInfo &info, size_t size, char *data) :
+			FileData(info, size, data) {}
+		virtual ~FileDataMapped() { munmap(m_data, m_size); }
+	};
+
+	RefCountedPtr<FileData> FileSourceFS::MapFile(const std::string &path)
+	{
+		const std::string fullpath = JoinPathBelow(GetRoot(), path);
+		Time::DateTime mtime;
+
+		FileInfo::FileType ty = stat_path(fullpath.c_str(), mtime);
+		if (ty != FileInfo::FT_FILE)
+			return RefCountedPtr<FileData>(0);
+
+		const int fd = open(fullpath.c_str(), O_RDONLY);
+		if (fd < 0)
+			return RefCountedPtr<FileData>(0);
+
+		struct stat info;
+		void *data = MAP_FAILED;
+		if (fstat(fd, &info) == 0 && info.st_size > 0)
+			data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		// the mapping stays valid after the descriptor is closed
+		close(fd);
+
+		// empty files can't be mapped
+		if (data == MAP_FAILED)
+			return ReadFile(path);
+
+		RecordRead(this, fullpath);
+		return RefCountedPtr<FileData>(new FileDataMapped(MakeFileInfo(path, ty, mtime), info.st_size, static_cast<char *>(data)));
+	}
+
+	void PrefetchFile(const std::string &fullPath)
+	{
+		const int fd = open(fullPath.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+#ifdef POSIX_FADV_WILLNEED
+		// starts the kernel reading the file in, without waiting for it
+		posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#else
+		char buf[65536];
+		while (read(fd, buf, sizeof(buf)) > 0) {
+		}
+#endif
+		close(fd);
+	}
+
 	bool FileSourceFS::ReadDirectory(const std::string &dirpath, std::vector<FileInfo> &output)
 	{
 		const std::string fulldirpath = JoinPathBelow(GetRoot(), dirpath);
@@ -342,4 +396,26 @@ namespace FileSystem {
 			return false;
 		return !unlink(combinedPath.c_str());
 	}
+
+	bool FileSourceFS::RenameFile(const std::string &relativePath, const std::string &newRelativePath)
+	{
+		if (relativePath.empty() || newRelativePath.empty())
+			return false;
+		std::string combinedPath, newCombinedPath;
+		try {
+			combinedPath = JoinPathBelow(GetRoot(), relativePath);
+			newCombinedPath = JoinPathBelow(GetRoot(), newRelativePath);
+		} catch (const std::invalid_argument &) {
+			return false;
+		}
+		struct stat fileAttributes;
+		memset(&fileAttributes, 0, sizeof(fileAttributes));
+		if (stat(combinedPath.c_str(), &fileAttributes))
+			return false;
+		if (!S_ISREG(fileAttributes.st_mode))
+			return false;
+		if (!IsChildOfRoot(combinedPath) || !IsChildOfRoot(newCombinedPath))
+			return false;
+		return !rename(combinedPath.c_str(), newCombinedPath.c_str());
+	}
 } // namespace FileSystem
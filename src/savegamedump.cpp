@@ -4,33 +4,273 @@
 #include "FileSystem.h"
 #include "Json.h"
 #include "core/GZipFormat.h"
+#include "core/LZ4Format.h"
 #include <SDL.h>
 
+#include <chrono>
+#include <istream>
+#include <map>
+#include <memory>
+#include <vector>
+
 int info()
 {
 	printf(
 		"savegamedump - Dump saved games to JSON for easy inspection.\n"
 		"All paths are relative to the pioneer data folder.\n"
-		"USAGE: savegamedump [--pretty] <input> [output]\n");
+		"USAGE: savegamedump [--pretty] <input> [output]\n"
+		"       savegamedump --report <input>\n"
+		"  --report prints the size and decode time of each section of the save instead.\n");
 	return 1;
 }
 
+// Reads uncompressed saves straight out of the file data
+class MemoryStreamBuf : public std::streambuf {
+public:
+	MemoryStreamBuf(const char *data, size_t size)
+	{
+		char *begin = const_cast<char *>(data);
+		setg(begin, begin, begin + size);
+	}
+};
+
+// Counts the bytes read from another stream buffer, so the parser's
+// position in the uncompressed save is known at each SAX event
+class CountingStreamBuf : public std::streambuf {
+public:
+	CountingStreamBuf(std::streambuf *source) :
+		m_source(source),
+		m_count(0)
+	{}
+
+	size_t GetCount() const { return m_count; }
+
+protected:
+	// no get area, so every character read goes through uflow and is counted
+	int_type underflow() override { return m_source->sgetc(); }
+
+	int_type uflow() override
+	{
+		const int_type c = m_source->sbumpc();
+		if (!traits_type::eq_int_type(c, traits_type::eof()))
+			++m_count;
+		return c;
+	}
+
+private:
+	std::streambuf *m_source;
+	size_t m_count;
+};
+
+// Receives the saved game from the parser one value at a time: writes it
+// out as JSON text if given a file, and measures the sections of the save.
+class SaveGameHandler : public Json::json_sax_t {
+public:
+	struct Section {
+		std::string name;
+		size_t depth = 0;
+		size_t count = 0;
+		size_t bytes = 0;
+		double seconds = 0.0;
+	};
+
+	SaveGameHandler(const CountingStreamBuf &input, FILE *out, int indent) :
+		m_input(input),
+		m_out(out),
+		m_indent(indent)
+	{}
+
+	const std::vector<Section> &GetSections() const { return m_sections; }
+
+	bool null() override { return Value("null"); }
+	bool boolean(bool val) override { return Value(val ? "true" : "false"); }
+	bool number_integer(number_integer_t val) override { return Value(Json(val).dump()); }
+	bool number_unsigned(number_unsigned_t val) override { return Value(Json(val).dump()); }
+	bool number_float(number_float_t val, const string_t &) override { return Value(Json(val).dump()); }
+	bool string(string_t &val) override { return Value(Json(val).dump()); }
+
+	bool start_object(std::size_t) override { return StartContainer('{', true); }
+	bool end_object() override { return EndContainer('}'); }
+	bool start_array(std::size_t) override { return StartContainer('[', false); }
+	bool end_array() override { return EndContainer(']'); }
+
+	bool key(string_t &val) override
+	{
+		Level &level = m_levels.back();
+		level.key = val;
+		if (m_out) {
+			NextElement();
+			fputs(Json(val).dump().c_str(), m_out);
+			fputs(m_indent >= 0 ? ": " : ":", m_out);
+		}
+
+		// the value's bytes start right after its key
+		m_pending = FindSection(val);
+		if (m_pending >= 0) {
+			m_pendingOffset = m_input.GetCount();
+			m_pendingStart = Clock::now();
+		}
+		return true;
+	}
+
+	bool parse_error(std::size_t position, const std::string &, const nlohmann::detail::exception &ex) override
+	{
+		throw Json::parse_error::create(101, position, ex.what());
+	}
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Level {
+		bool isObject;
+		size_t numElements = 0;
+		std::string key;
+		// the section this container is the value of
+		int section = -1;
+		size_t offset = 0;
+		Clock::time_point start;
+	};
+
+	// The sections worth reporting on: every top-level key, the parts of
+	// "space", and the Sfx saved with each frame.
+	int FindSection(const std::string &key)
+	{
+		std::string name;
+		if (key == "sfx_array")
+			name = "sfx_array (in space.frame)";
+		else if (m_levels.size() == 1)
+			name = key;
+		else if (m_levels.size() == 2 && m_levels[0].key == "space")
+			name = "space." + key;
+		else
+			return -1;
+
+		auto it = m_sectionIndex.find(name);
+		if (it != m_sectionIndex.end())
+			return it->second;
+
+		Section section;
+		section.name = name;
+		section.depth = name.find('.') == std::string::npos ? 0 : 1;
+		m_sections.push_back(section);
+		return m_sectionIndex[name] = int(m_sections.size() - 1);
+	}
+
+	void EndSection(int section, size_t offset, Clock::time_point start)
+	{
+		if (section < 0)
+			return;
+		Section &s = m_sections[section];
+		s.count++;
+		s.bytes += m_input.GetCount() - offset;
+		s.seconds += std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// separator and indentation before an array element or object key
+	void NextElement()
+	{
+		Level &level = m_levels.back();
+		if (level.numElements++ > 0)
+			fputc(',', m_out);
+		if (m_indent >= 0) {
+			fputc('\n', m_out);
+			fprintf(m_out, "%*s", int(m_levels.size() * m_indent), "");
+		}
+	}
+
+	// before the value of an array element; objects did this at the key
+	void BeginValue()
+	{
+		if (m_out && !m_levels.empty() && !m_levels.back().isObject)
+			NextElement();
+	}
+
+	bool Value(const std::string &text)
+	{
+		BeginValue();
+		if (m_out)
+			fputs(text.c_str(), m_out);
+		EndSection(m_pending, m_pendingOffset, m_pendingStart);
+		m_pending = -1;
+		return true;
+	}
+
+	bool StartContainer(char open, bool isObject)
+	{
+		BeginValue();
+		if (m_out)
+			fputc(open, m_out);
+
+		Level level;
+		level.isObject = isObject;
+		level.section = m_pending;
+		level.offset = m_pendingOffset;
+		level.start = m_pendingStart;
+		m_levels.push_back(level);
+		m_pending = -1;
+		return true;
+	}
+
+	bool EndContainer(char close)
+	{
+		const Level level = m_levels.back();
+		m_levels.pop_back();
+		if (m_out) {
+			if (m_indent >= 0 && level.numElements > 0) {
+				fputc('\n', m_out);
+				fprintf(m_out, "%*s", int(m_levels.size() * m_indent), "");
+			}
+			fputc(close, m_out);
+		}
+		EndSection(level.section, level.offset, level.start);
+		return true;
+	}
+
+	const CountingStreamBuf &m_input;
+	FILE *m_out;
+	int m_indent;
+
+	std::vector<Level> m_levels;
+	std::vector<Section> m_sections;
+	std::map<std::string, int> m_sectionIndex;
+
+	// the section of the value following the last key
+	int m_pending = -1;
+	size_t m_pendingOffset = 0;
+	Clock::time_point m_pendingStart;
+};
+
+static void PrintReport(const std::vector<SaveGameHandler::Section> &sections, size_t totalBytes, double totalSeconds)
+{
+	printf("%-32s %8s %12s %7s %10s\n", "section", "count", "bytes", "size", "decode ms");
+	for (const auto &s : sections) {
+		const std::string name = std::string(s.depth * 2, ' ') + s.name;
+		printf("%-32s %8zu %12zu %6.1f%% %10.2f\n", name.c_str(), s.count, s.bytes,
+			totalBytes ? 100.0 * double(s.bytes) / double(totalBytes) : 0.0, s.seconds * 1000.0);
+	}
+	printf("%-32s %8s %12zu %6.1f%% %10.2f\n", "total", "", totalBytes, 100.0, totalSeconds * 1000.0);
+}
+
 extern "C" int main(int argc, char **argv)
 {
 	if (argc < 2) return info();
 
 	int indent = -1;
+	bool report = false;
 	int shift = 0;
 
 	std::string filename = argv[1];
 	if (filename == "--pretty") {
 		indent = 2;
 		shift = 1;
+	} else if (filename == "--report") {
+		report = true;
+		shift = 1;
 	}
 
-	if (argc < shift+2 || argc > shift+3) return info();
-	filename = argv[shift+1];
-	std::string outname = argc > shift+2 ? argv[shift+2] : filename + ".json";
+	if (argc < shift + 2 || argc > shift + (report ? 2 : 3)) return info();
+	filename = argv[shift + 1];
+	std::string outname = argc > shift + 2 ? argv[shift + 2] : filename + ".json";
 
 	auto fileinfo = FileSystem::userFiles.Lookup(filename);
 	if (!fileinfo.Exists()) {
@@ -45,43 +285,57 @@ extern "C" int main(int argc, char **argv)
 		return 1;
 	}
 
+	FILE *outFile = nullptr;
+	if (!report) {
+		outFile = FileSystem::userFiles.OpenWriteStream(outname);
+		if (!outFile) {
+			printf("Could not open output file %s.\n", outname.c_str());
+			return 1;
+		}
+	}
+
+	// decompress and parse the save as the output is written, rather than
+	// holding the uncompressed data and the whole document in memory
 	const auto compressed_data = file->AsByteRange();
-	Json rootNode;
+	const std::string_view data(compressed_data.begin, compressed_data.Size());
+	int result = 0;
 	try {
-		std::string plain_data;
-		if (gzip::IsGZipFormat(reinterpret_cast<const uint8_t *>(compressed_data.begin), compressed_data.Size()))
-			plain_data = gzip::DecompressDeflateOrGZip(reinterpret_cast<const uint8_t *>(compressed_data.begin), compressed_data.Size());
+		std::unique_ptr<std::streambuf> plain;
+		if (gzip::IsGZipFormat(reinterpret_cast<const uint8_t *>(data.data()), data.size()))
+			plain.reset(new gzip::DecompressStreamBuf(data));
+		else if (data.size() >= sizeof(uint32_t) && lz4::IsLZ4Format(data.data(), data.size()))
+			plain.reset(new lz4::DecompressStreamBuf(data));
 		else
-			plain_data = std::string(compressed_data.begin, compressed_data.Size());
+			plain.reset(new MemoryStreamBuf(data.data(), data.size()));
 
+		CountingStreamBuf counted(plain.get());
+		std::istream input(&counted);
+		SaveGameHandler handler(counted, outFile, indent);
+
+		// Allow loading files in JSON format as well as CBOR
+		const auto format = counted.sgetc() == '{' ? Json::input_format_t::json : Json::input_format_t::cbor;
+
+		const auto start = std::chrono::steady_clock::now();
 		try {
-			// Allow loading files in JSON format as well as CBOR
-			if (plain_data[0] == '{')
-				rootNode = Json::parse(plain_data);
-			else
-				rootNode = Json::from_cbor(plain_data);
+			Json::sax_parse(input, &handler, format);
 		} catch (Json::parse_error &e) {
 			printf("Saved game is not a valid JSON object: %s.\n", e.what());
-			return 2;
+			result = 2;
 		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
 
-		if (!rootNode.is_object()) {
-			printf("Saved game's root is not a JSON object.\n");
-			return 2;
-		}
+		if (report && result == 0)
+			PrintReport(handler.GetSections(), counted.GetCount(), elapsed.count());
 	} catch (gzip::DecompressionFailedException) {
 		printf("Decompressing saved data failed - saved game is corrupt.\n");
-		return 3;
-	}
-
-	auto outFile = FileSystem::userFiles.OpenWriteStream(outname);
-	if (!outFile) {
-		printf("Could not open output file %s.\n", outname.c_str());
-		return 1;
+		result = 3;
+	} catch (const lz4::DecompressionFailedException &) {
+		printf("Decompressing saved data failed - saved game is corrupt.\n");
+		result = 3;
 	}
 
-	fputs(rootNode.dump(indent).c_str(), outFile);
-	fclose(outFile);
+	if (outFile)
+		fclose(outFile);
 
-	return 0;
+	return result;
 }
@@ -12,9 +12,25 @@ namespace SceneGraph {
 	typedef std::vector<AnimationChannel> ChannelList;
 	typedef ChannelList::iterator ChannelIterator;
 
+	// Index of the last key at or before time (or the first key), searching
+	// from the one found last time: animations mostly play forwards in small
+	// steps, so this is usually the same key or the next one.
+	template <typename Key>
+	static unsigned int FindFrame(const std::vector<Key> &keys, double time, unsigned int &cursor)
+	{
+		unsigned int frame = cursor < keys.size() ? cursor : 0;
+		while (frame > 0 && time < keys[frame].time)
+			frame--;
+		while (frame + 1 < keys.size() && time >= keys[frame + 1].time)
+			frame++;
+		cursor = frame;
+		return frame;
+	}
+
 	Animation::Animation(const std::string &name, double duration) :
 		m_duration(duration),
 		m_time(0.0),
+		m_interpolatedTime(-1.0),
 		m_name(name)
 	{
 	}
@@ -22,6 +38,7 @@ namespace SceneGraph {
 	Animation::Animation(const Animation &anim) :
 		m_duration(anim.m_duration),
 		m_time(0.0),
+		m_interpolatedTime(-1.0),
 		m_name(anim.m_name)
 	{
 		for (ChannelList::const_iterator chan = anim.m_channels.begin(); chan != anim.m_channels.end(); ++chan) {
@@ -37,25 +54,21 @@ namespace SceneGraph {
 			assert(trans);
 			chan->node = trans;
 		}
+		m_interpolatedTime = -1.0;
 	}
 
 	void Animation::Interpolate()
 	{
 		PROFILE_SCOPED()
 		const double mtime = m_time;
+		m_interpolatedTime = m_time;
 
 		//go through channels and calculate transforms
 		for (ChannelIterator chan = m_channels.begin(); chan != m_channels.end(); ++chan) {
 			matrix4x4f trans = chan->node->GetTransform();
 
 			if (!chan->rotationKeys.empty()) {
-				//find a frame. To optimize, should begin search from previous frame (when mTime > previous mTime)
-				unsigned int frame = 0;
-				while (frame + 1 < chan->rotationKeys.size()) {
-					if (mtime < chan->rotationKeys[frame + 1].time)
-						break;
-					frame++;
-				}
+				const unsigned int frame = FindFrame(chan->rotationKeys, mtime, chan->rotationFrame);
 
 				const RotationKey &a = chan->rotationKeys[frame];
 				vector3f saved_position = trans.GetTranslate();
@@ -75,13 +88,7 @@ namespace SceneGraph {
 			//continously scale the transform (would have to add originalTransform or
 			//something to MT)
 			if (!chan->scaleKeys.empty() && !chan->rotationKeys.empty()) {
-				//find a frame. To optimize, should begin search from previous frame (when mTime > previous mTime)
-				unsigned int frame = 0;
-				while (frame + 1 < chan->scaleKeys.size()) {
-					if (mtime < chan->scaleKeys[frame + 1].time)
-						break;
-					frame++;
-				}
+				const unsigned int frame = FindFrame(chan->scaleKeys, mtime, chan->scaleFrame);
 
 				const ScaleKey &a = chan->scaleKeys[frame];
 				vector3f out;
@@ -98,13 +105,7 @@ namespace SceneGraph {
 			}
 
 			if (!chan->positionKeys.empty()) {
-				//find a frame. To optimize, should begin search from previous frame (when mTime > previous mTime)
-				unsigned int frame = 0;
-				while (frame + 1 < chan->positionKeys.size()) {
-					if (mtime < chan->positionKeys[frame + 1].time)
-						break;
-					frame++;
-				}
+				const unsigned int frame = FindFrame(chan->positionKeys, mtime, chan->positionFrame);
 
 				const PositionKey &a = chan->positionKeys[frame];
 				vector3f out;
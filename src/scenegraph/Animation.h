@@ -26,6 +26,8 @@ namespace SceneGraph {
 		double GetProgress();
 		void SetProgress(double); //0.0 -- 1.0, overrides m_time
 		void Interpolate(); //update transforms according to m_time;
+		// whether the progress moved since the last Interpolate
+		bool IsDirty() const { return m_time != m_interpolatedTime; }
 		const std::vector<AnimationChannel> &GetChannels() const { return m_channels; }
 
 	private:
@@ -33,6 +35,7 @@ namespace SceneGraph {
 		friend class BinaryConverter;
 		double m_duration;
 		double m_time;
+		double m_interpolatedTime;
 		std::string m_name;
 		std::vector<AnimationChannel> m_channels;
 	};
@@ -13,11 +13,19 @@ namespace SceneGraph {
 	class AnimationChannel {
 	public:
 		AnimationChannel(MatrixTransform *t) :
-			node(t) {}
+			node(t),
+			positionFrame(0),
+			rotationFrame(0),
+			scaleFrame(0) {}
 		std::vector<PositionKey> positionKeys;
 		std::vector<RotationKey> rotationKeys;
 		std::vector<ScaleKey> scaleKeys;
 		MatrixTransform *node;
+
+		// keys found by the last interpolation, where the next search starts
+		unsigned int positionFrame;
+		unsigned int rotationFrame;
+		unsigned int scaleFrame;
 	};
 
 } // namespace SceneGraph
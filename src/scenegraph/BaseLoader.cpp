@@ -69,20 +69,22 @@ void BaseLoader::ConvertMaterialDefinition(const MaterialDefinition &mdef)
 	Graphics::Texture *texture2 = nullptr;
 	Graphics::Texture *texture3 = nullptr;
 	Graphics::Texture *texture6 = nullptr;
+	// streamed in the background; the placeholders are chosen to look neutral
+	// for the frames until the actual textures have arrived
 	if (!diffTex.empty())
-		texture0 = Graphics::TextureBuilder::Model(diffTex).GetOrCreateTexture(m_renderer, "model");
+		texture0 = Graphics::TextureBuilder::Model(diffTex).GetOrCreateTextureAsync(m_renderer, "model", Color::WHITE);
 	else
 		texture0 = Graphics::TextureBuilder::GetWhiteTexture(m_renderer);
 	if (!specTex.empty())
-		texture1 = Graphics::TextureBuilder::Model(specTex).GetOrCreateTexture(m_renderer, "model");
+		texture1 = Graphics::TextureBuilder::Model(specTex).GetOrCreateTextureAsync(m_renderer, "model", Color::BLACK);
 	if (!glowTex.empty())
-		texture2 = Graphics::TextureBuilder::Model(glowTex).GetOrCreateTexture(m_renderer, "model");
+		texture2 = Graphics::TextureBuilder::Model(glowTex).GetOrCreateTextureAsync(m_renderer, "model", Color::BLACK);
 	if (!ambiTex.empty())
-		texture3 = Graphics::TextureBuilder::Model(ambiTex).GetOrCreateTexture(m_renderer, "model");
+		texture3 = Graphics::TextureBuilder::Model(ambiTex).GetOrCreateTextureAsync(m_renderer, "model", Color::WHITE);
 	//texture4 is reserved for pattern
 	//texture5 is reserved for color gradient
 	if (!normTex.empty())
-		texture6 = Graphics::TextureBuilder::Normal(normTex).GetOrCreateTexture(m_renderer, "model");
+		texture6 = Graphics::TextureBuilder::Normal(normTex).GetOrCreateTextureAsync(m_renderer, "model", Color(128, 128, 255, 255));
 
 	mat->SetTexture("texture0"_hash, texture0);
 	mat->SetTexture("texture1"_hash, texture1);
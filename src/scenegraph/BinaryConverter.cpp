@@ -28,13 +28,30 @@ const SGM_STRING_VALUE SGM_STRING_ID = { { 's', 'g', 'm', SGM_VERSION } };
 const std::string SGM_EXTENSION = ".sgm";
 const std::string SAVE_TARGET_DIR = "binarymodels";
 
+// An SGM file is laid out as:
+//   SgmHeader
+//   the node hierarchy, materials, animations etc. as an LZ4 frame
+//   vertex and index data, uncompressed and in the layout buffers are
+//   created with, at offsets aligned to SGM_BUFFER_ALIGNMENT
+// so loading only parses the (small) hierarchy, and buffers are filled
+// straight from the mapped file.
+struct SgmHeader {
+	char id[4];
+	Uint32 version;
+	Uint32 hierarchySize;
+	Uint32 bufferOffset;
+	Uint32 bufferSize;
+};
+static_assert(sizeof(SgmHeader) == 20, "SgmHeader must not be padded");
+
 class SaveHelperVisitor : public NodeVisitor {
 public:
-	SaveHelperVisitor(Serializer::Writer *wr, Model *m)
+	SaveHelperVisitor(Serializer::Writer *wr, std::string *bufferWr, Model *m)
 	{
 		db.wr = wr;
 		db.rd = nullptr;
 		db.model = m;
+		db.bufferWr = bufferWr;
 	}
 
 	virtual void ApplyNode(Node &n) override
@@ -118,10 +135,23 @@ void BinaryConverter::Save(const std::string &filename, const std::string &savep
 
 	SaveMaterials(wr, m);
 
-	SaveHelperVisitor sv(&wr, m);
+	std::string bufferData;
+	SaveHelperVisitor sv(&wr, &bufferData, m);
 	m->GetRoot()->Accept(sv);
 
-	m->GetCollisionMesh()->Save(wr);
+	// the collision trees go with the buffers, so loading can leave them
+	// in the file until something collides with the model
+	RefCountedPtr<CollMesh> collMesh = m->GetCollisionMesh();
+	collMesh->Save(wr);
+	{
+		Serializer::Writer treeWr;
+		collMesh->SaveTrees(treeWr);
+		const std::string &trees = treeWr.GetData();
+		bufferData.resize((bufferData.size() + SGM_BUFFER_ALIGNMENT - 1) & ~size_t(SGM_BUFFER_ALIGNMENT - 1), '\0');
+		wr.Int32(bufferData.size());
+		wr.Int32(trees.size());
+		bufferData.append(trees);
+	}
 	wr.Float(m->GetDrawClipRadius());
 
 	SaveAnimations(wr, m);
@@ -142,14 +172,21 @@ void BinaryConverter::Save(const std::string &filename, const std::string &savep
 		wr.String(m->GetTagByIndex(i)->GetName().c_str());
 
 
-	// compress in memory, write to open file
-	size_t outSize = 0;
+	// compress the hierarchy in memory, write it and the buffer data to the open file
 	const std::string &data = wr.GetData();
 	try {
 		std::string compressedData = lz4::CompressLZ4(data, 6);
-		outSize = compressedData.size();
-		Output("Compressed model (%s): %.2f KB -> %.2f KB\n", filename.c_str(), data.size() / 1024.f, outSize / 1024.f);
-		fwrite(compressedData.data(), outSize, 1, f);
+		Output("Compressed model (%s): %.2f KB -> %.2f KB, %.2f KB of buffer data\n", filename.c_str(), data.size() / 1024.f, compressedData.size() / 1024.f, bufferData.size() / 1024.f);
+
+		SgmHeader header = { { 's', 'g', 'm', '#' }, SGM_VERSION, Uint32(compressedData.size()), 0, Uint32(bufferData.size()) };
+		const size_t hierarchyEnd = sizeof(SgmHeader) + compressedData.size();
+		header.bufferOffset = (hierarchyEnd + SGM_BUFFER_ALIGNMENT - 1) & ~size_t(SGM_BUFFER_ALIGNMENT - 1);
+		const char padding[SGM_BUFFER_ALIGNMENT] = {};
+
+		fwrite(&header, sizeof(SgmHeader), 1, f);
+		fwrite(compressedData.data(), compressedData.size(), 1, f);
+		fwrite(padding, header.bufferOffset - hierarchyEnd, 1, f);
+		fwrite(bufferData.data(), bufferData.size(), 1, f);
 		fclose(f);
 	} catch (std::runtime_error &e) {
 		Log::Error("Error saving SGM model: {}\n", e.what());
@@ -157,18 +194,99 @@ void BinaryConverter::Save(const std::string &filename, const std::string &savep
 	}
 }
 
+bool BinaryConverter::IsSaved(const std::string &savepath, const bool bInPlace)
+{
+	if (bInPlace) {
+		FileSystem::FileSourceFS dataFS(FileSystem::GetDataDir());
+		return dataFS.Lookup(savepath + SGM_EXTENSION).IsFile();
+	}
+	return FileSystem::userFiles.Lookup(FileSystem::JoinPathBelow(SAVE_TARGET_DIR, savepath + SGM_EXTENSION)).IsFile();
+}
+
 Model *BinaryConverter::Load(const std::string &filename)
 {
 	return Load(filename, "models");
 }
 
+bool BinaryConverter::PrepareFile(const std::string &name, RefCountedPtr<FileSystem::FileData> binfile, PreparedFile &out)
+{
+	PROFILE_SCOPED()
+	const ByteRange bin = binfile->AsByteRange();
+
+	SgmHeader header = {};
+	if (bin.Size() >= sizeof(SgmHeader))
+		memcpy(&header, bin.begin, sizeof(SgmHeader));
+
+	if (header.version != SGM_VERSION) {
+		Log::Warning("Error whilst loading {}\nSGM versioning ({}) did not match the supported SGM_VERSION ({})\nSGM file will be ignored\n", name.c_str(), header.version, SGM_VERSION);
+		return false;
+	}
+	if (header.bufferOffset < sizeof(SgmHeader) || header.hierarchySize > header.bufferOffset - sizeof(SgmHeader) || header.bufferOffset > bin.Size() || header.bufferSize > bin.Size() - header.bufferOffset) {
+		Log::Warning("Error whilst loading {}\nSGM file is truncated and will be ignored\n", name.c_str());
+		return false;
+	}
+
+	// only the hierarchy is decompressed; buffers are read in place
+	try {
+		out.hierarchy = lz4::DecompressLZ4({ bin.begin + sizeof(SgmHeader), header.hierarchySize });
+	} catch (std::runtime_error &e) {
+		Log::Error("Error loading SGM model: {}\n", e.what());
+		return false;
+	}
+	out.buffers = ByteRange(bin.begin + header.bufferOffset, header.bufferSize);
+	out.data = binfile;
+	return true;
+}
+
+bool BinaryConverter::PrepareFile(const FileSystem::FileInfo &info, PreparedFile &out)
+{
+	RefCountedPtr<FileSystem::FileData> binfile = info.Map();
+	if (!binfile.Valid() || !PrepareFile(info.GetName(), binfile, out))
+		return false;
+
+	//curPath is used to find textures, patterns,
+	//possibly other data files for this model.
+	//Strip trailing slash
+	out.dir = info.GetDir();
+	if (!out.dir.empty() && out.dir.back() == '/')
+		out.dir.pop_back();
+	return true;
+}
+
+Model *BinaryConverter::Load(const std::string &name, const PreparedFile &file)
+{
+	PROFILE_SCOPED()
+	Model *model(nullptr);
+	if (!file.dir.empty())
+		m_curPath = file.dir;
+
+	try {
+		Serializer::Reader rd(ByteRange(file.hierarchy.data(), file.hierarchy.size()));
+		m_bufferData = file.buffers;
+		m_fileData = file.data;
+		model = CreateModel(name, rd);
+	} catch (std::runtime_error &e) {
+		Log::Error("Error loading SGM model: {}\n", e.what());
+	}
+	m_bufferData = ByteRange();
+	m_fileData.Reset();
+
+	return model;
+}
+
 Model *BinaryConverter::Load(const std::string &name, RefCountedPtr<FileSystem::FileData> binfile)
 {
 	PROFILE_SCOPED()
 	Model *model(nullptr);
-	// decompress the loaded ByteRange in memory
 	const ByteRange bin = binfile->AsByteRange();
-	if (lz4::IsLZ4Format(bin.begin, bin.Size())) {
+
+	if (bin.Size() >= sizeof(SgmHeader) && memcmp(bin.begin, "sgm", 3) == 0) {
+		PreparedFile file;
+		if (PrepareFile(name, binfile, file))
+			model = Load(name, file);
+	} else if (lz4::IsLZ4Format(bin.begin, bin.Size())) {
+		// older files compressed everything; they fail the version check
+		// in CreateModel, which is all they're decompressed for
 		try {
 			std::string decompressedData = lz4::DecompressLZ4({ bin.begin, bin.Size() });
 			// Output("decompressed model file %s (%.2f KB) -> %.2f KB\n", name.c_str(), binfile->GetSize() / 1024.f, decompressedData.size() / 1024.f);
@@ -212,15 +330,10 @@ Model *BinaryConverter::Load(const std::string &shortname, const std::string &ba
 			const std::string name = info.GetName();
 
 			if (shortname == name.substr(0, name.length() - SGM_EXTENSION.length())) {
-				//curPath is used to find textures, patterns,
-				//possibly other data files for this model.
-				//Strip trailing slash
-				m_curPath = info.GetDir();
-				if (m_curPath[m_curPath.length() - 1] == '/')
-					m_curPath = m_curPath.substr(0, m_curPath.length() - 1);
-
-				RefCountedPtr<FileSystem::FileData> binfile = info.Read();
-				if (binfile.Valid()) return Load(name, binfile);
+				PreparedFile file;
+				if (PrepareFile(info, file)) return Load(name, file);
+				// not of the current version; Loader falls back to the .model
+				return nullptr;
 			}
 		}
 	}
@@ -258,6 +371,27 @@ Model *BinaryConverter::CreateModel(const std::string &filename, Serializer::Rea
 
 	RefCountedPtr<CollMesh> collMesh(new CollMesh());
 	collMesh->Load(rd);
+	const Uint32 treesOffset = rd.Int32();
+	const Uint32 treesSize = rd.Int32();
+	if (treesOffset > m_bufferData.Size() || treesSize > m_bufferData.Size() - treesOffset)
+		throw LoadingError("Collision data out of range");
+
+	// A mapped file is held on to until the trees are read, which only
+	// touches its pages then; of a file read onto the heap, only the
+	// trees' bytes are kept.
+	const ByteRange trees(m_bufferData.begin + treesOffset, treesSize);
+	if (dynamic_cast<FileSystem::FileDataMalloc *>(m_fileData.Get())) {
+		auto copy = std::make_shared<std::string>(trees.begin, trees.Size());
+		collMesh->SetTreeBuilder([copy](CollMesh &cm) {
+			Serializer::Reader treeRd(ByteRange(copy->data(), copy->size()));
+			cm.LoadTrees(treeRd);
+		});
+	} else {
+		collMesh->SetTreeBuilder([file = m_fileData, trees](CollMesh &cm) {
+			Serializer::Reader treeRd(trees);
+			cm.LoadTrees(treeRd);
+		});
+	}
 	m_model->SetCollisionMesh(collMesh);
 	m_model->SetDrawClipRadius(rd.Float());
 
@@ -461,6 +595,7 @@ Node *BinaryConverter::LoadNode(Serializer::Reader &rd)
 	db.loader = this;
 	db.model = m_model;
 	db.rd = &rd;
+	db.bufferRd = m_bufferData;
 
 	auto loadFuncIt = m_loaders.find(ntype);
 	if (loadFuncIt == m_loaders.end()) {
@@ -40,16 +40,41 @@ namespace SceneGraph {
 	// 6.2: ignored StaticGeometry::m_blendMode in files. Still write blank value.
 	// 7:   Added discrete Tag node, tags are registered in the model hierarchy instead of at the root.
 	// 8:	Save model bound metadata
-	constexpr Uint32 SGM_VERSION = 8;
+	// 9:	LOD levels generated by the model compiler store their error
+	// 10:	uncompressed, aligned vertex and index data after the compressed node hierarchy
+	// 11:	collision trees stored with the vertex and index data, read when first used
+	constexpr Uint32 SGM_VERSION = 11;
+
+	// alignment of vertex and index data within the file
+	constexpr Uint32 SGM_BUFFER_ALIGNMENT = 16;
 
 	class BinaryConverter : public BaseLoader {
 	public:
+		// A current-format .sgm file, read and with its hierarchy
+		// decompressed, ready for the scenegraph to be built from it
+		struct PreparedFile {
+			RefCountedPtr<FileSystem::FileData> data;
+			std::string hierarchy;
+			ByteRange buffers;
+			// where textures, patterns etc. of the model are looked for
+			std::string dir;
+		};
+
+		// Reads and decompresses the file. Doesn't touch the renderer, so
+		// it's safe to call from any thread. False if the file isn't a
+		// valid .sgm file of the current version.
+		static bool PrepareFile(const FileSystem::FileInfo &info, PreparedFile &out);
+
 		BinaryConverter(Graphics::Renderer *);
 		void Save(const std::string &filename, Model *m);
 		void Save(const std::string &filename, const std::string &savepath, Model *m, const bool bInPlace);
+		// whether the file Save would write for savepath exists
+		static bool IsSaved(const std::string &savepath, const bool bInPlace);
 		Model *Load(const std::string &filename);
 		Model *Load(const std::string &filename, const std::string &path);
 		Model *Load(const std::string &filename, RefCountedPtr<FileSystem::FileData> binfile);
+		// builds the model of a prepared file; main thread only
+		Model *Load(const std::string &filename, const PreparedFile &file);
 
 		//if you implement any new node types, you must also register a loader function
 		//before calling Load.
@@ -62,12 +87,16 @@ namespace SceneGraph {
 		void SaveAnimations(Serializer::Writer &, Model *m);
 		void LoadAnimations(Serializer::Reader &);
 		ModelDefinition FindModelDefinition(const std::string &);
+		static bool PrepareFile(const std::string &filename, RefCountedPtr<FileSystem::FileData> binfile, PreparedFile &out);
 
 		Node *LoadNode(Serializer::Reader &);
 		//this is a very simple loader so it's implemented here
 		static Label3D *LoadLabel3D(NodeDatabase &);
 
 		bool m_patternsUsed;
+		//vertex and index data of the file being loaded
+		ByteRange m_bufferData;
+		RefCountedPtr<FileSystem::FileData> m_fileData;
 		std::map<std::string, std::function<Node *(NodeDatabase &)>> m_loaders;
 	};
 } // namespace SceneGraph
@@ -179,13 +179,11 @@ namespace SceneGraph {
 
 		m_totalTris += numTris;
 
-		//create geomtree
-		//copy data
-		GeomTree *gt = new GeomTree(
-			numVertices, numTris,
-			m_vertices,
-			m_indices, m_flags);
-		m_collMesh->SetGeomTree(gt);
+		//the geomtree is only built once something collides with the model;
+		//the data moves into the builder until then
+		m_collMesh->SetTreeBuilder([numVertices, numTris, vertices = std::move(m_vertices), indices = std::move(m_indices), flags = std::move(m_flags)](CollMesh &collMesh) {
+			collMesh.SetGeomTree(new GeomTree(numVertices, numTris, vertices, indices, flags));
+		});
 		m_collMesh->SetNumTriangles(m_totalTris);
 		m_boundingRadius = m_collMesh->GetAabb().GetRadius();
 
@@ -4,11 +4,69 @@
 #include "ColorMap.h"
 #include "graphics/Renderer.h"
 #include <SDL_stdinc.h>
+#include <list>
+#include <unordered_map>
 
 namespace SceneGraph {
 
+	// number of textures no model is using that are kept around in case the
+	// colors are used again, e.g. by the next ship of a convoy spawning
+	static const size_t MAX_UNUSED_TEXTURES = 32;
+
+	struct ColorMapKeyHash {
+		size_t operator()(const ColorMap::Key &k) const
+		{
+			size_t h = k.a;
+			h = h * 0x9E3779B1u ^ k.b;
+			h = h * 0x9E3779B1u ^ k.c;
+			return h * 2 + k.smooth;
+		}
+	};
+
+	struct ColorMapCacheEntry {
+		ColorMap::Key key;
+		RefCountedPtr<Graphics::Texture> texture;
+	};
+
+	// most recently used at the front, indexed by key
+	typedef std::list<ColorMapCacheEntry> ColorMapLRU;
+	static ColorMapLRU s_textureLRU;
+	static std::unordered_map<ColorMap::Key, ColorMapLRU::iterator, ColorMapKeyHash> s_textureIndex;
+
+	static inline Uint32 PackRGB(const Color &c)
+	{
+		return Uint32(c.r) << 16 | Uint32(c.g) << 8 | Uint32(c.b);
+	}
+
+	static inline Color UnpackRGB(Uint32 rgb)
+	{
+		return Color((rgb >> 16) & 0xff, (rgb >> 8) & 0xff, rgb & 0xff);
+	}
+
+	// drop the least recently used textures once too many are only
+	// referenced by the cache
+	static void PruneTextureCache()
+	{
+		size_t unused = 0;
+		for (auto it = s_textureLRU.begin(); it != s_textureLRU.end();) {
+			if (it->texture->GetRefCount() == 1 && ++unused > MAX_UNUSED_TEXTURES) {
+				s_textureIndex.erase(it->key);
+				it = s_textureLRU.erase(it);
+			} else
+				++it;
+		}
+	}
+
+	//static
+	void ColorMap::ClearCache()
+	{
+		s_textureIndex.clear();
+		s_textureLRU.clear();
+	}
+
 	ColorMap::ColorMap() :
-		m_smooth(true)
+		m_renderer(nullptr),
+		m_key({ 0, 0, 0, true })
 	{
 	}
 
@@ -27,32 +85,52 @@ namespace SceneGraph {
 		}
 	}
 
-	void ColorMap::Generate(Graphics::Renderer *r, const Color &a, const Color &b, const Color &c)
+	RefCountedPtr<Graphics::Texture> ColorMap::FindOrCreateTexture(Graphics::Renderer *r, const Key &key)
 	{
+		auto found = s_textureIndex.find(key);
+		if (found != s_textureIndex.end()) {
+			s_textureLRU.splice(s_textureLRU.begin(), s_textureLRU, found->second);
+			return found->second->texture;
+		}
+
 		std::vector<Uint8> colors;
 		const int w = 4;
 		AddColor(w, Color(255, 255, 255), colors);
-		AddColor(w, a, colors);
-		AddColor(w, b, colors);
-		AddColor(w, c, colors);
+		AddColor(w, UnpackRGB(key.a), colors);
+		AddColor(w, UnpackRGB(key.b), colors);
+		AddColor(w, UnpackRGB(key.c), colors);
 		const vector3f size(colors.size() / 3, 1.f, 0.0f);
 
 		const Graphics::TextureFormat format = Graphics::TEXTURE_RGB_888;
+		const Graphics::TextureSampleMode sampleMode = key.smooth ? Graphics::LINEAR_CLAMP : Graphics::NEAREST_CLAMP;
+		RefCountedPtr<Graphics::Texture> texture(r->CreateTexture(Graphics::TextureDescriptor(format, size, sampleMode, true, true, true, 0, Graphics::TEXTURE_2D)));
+		texture->Update(&colors[0], size, format);
 
-		if (!m_texture.Valid()) {
-			const Graphics::TextureSampleMode sampleMode = m_smooth ? Graphics::LINEAR_CLAMP : Graphics::NEAREST_CLAMP;
-			m_texture.Reset(r->CreateTexture(Graphics::TextureDescriptor(Graphics::TEXTURE_RGB_888, size, sampleMode, true, true, true, 0, Graphics::TEXTURE_2D)));
-		}
+		PruneTextureCache();
+		s_textureLRU.push_front({ key, texture });
+		s_textureIndex.emplace(key, s_textureLRU.begin());
+		return texture;
+	}
 
-		m_texture->Update(&colors[0], size, format);
+	void ColorMap::Generate(Graphics::Renderer *r, const Color &a, const Color &b, const Color &c)
+	{
+		m_renderer = r;
+		m_key.a = PackRGB(a);
+		m_key.b = PackRGB(b);
+		m_key.c = PackRGB(c);
+		m_texture = FindOrCreateTexture(r, m_key);
 	}
 
 	void ColorMap::SetSmooth(bool smooth)
 	{
-		m_smooth = smooth;
-		if (m_texture.Valid()) {
-			m_texture->SetSampleMode(m_smooth ? Graphics::LINEAR_CLAMP : Graphics::NEAREST_CLAMP);
-		}
+		if (m_key.smooth == smooth)
+			return;
+
+		m_key.smooth = smooth;
+		// shared textures can't have their sample mode changed, so switch to
+		// the texture with the other one
+		if (m_texture.Valid())
+			m_texture = FindOrCreateTexture(m_renderer, m_key);
 	}
 
 } // namespace SceneGraph
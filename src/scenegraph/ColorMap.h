@@ -5,6 +5,9 @@
 #define _SCENEGRAPH_COLORMAP_H
 /*
  * Color look-up texture generator for newmodel pattern system
+ *
+ * Textures are shared between all color maps with the same colors and
+ * sampling, so instances painted alike only generate one.
  */
 #include "Color.h"
 #include "graphics/Texture.h"
@@ -22,10 +25,23 @@ namespace SceneGraph {
 		void Generate(Graphics::Renderer *r, const Color &a, const Color &b, const Color &c);
 		void SetSmooth(bool);
 
+		// release the shared textures, must be called before the renderer goes away
+		static void ClearCache();
+
+		// identifies a shared texture
+		struct Key {
+			Uint32 a, b, c; // packed RGB
+			bool smooth;
+
+			bool operator==(const Key &o) const { return a == o.a && b == o.b && c == o.c && smooth == o.smooth; }
+		};
+
 	private:
-		void AddColor(int width, const Color &c, std::vector<Uint8> &out);
+		static void AddColor(int width, const Color &c, std::vector<Uint8> &out);
+		static RefCountedPtr<Graphics::Texture> FindOrCreateTexture(Graphics::Renderer *r, const Key &key);
 
-		bool m_smooth;
+		Graphics::Renderer *m_renderer;
+		Key m_key;
 		RefCountedPtr<Graphics::Texture> m_texture;
 	};
 
@@ -0,0 +1,94 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "EffectBatch.h"
+#include "graphics/Renderer.h"
+#include "graphics/Stats.h"
+#include "graphics/VertexArray.h"
+#include "profiler/Profiler.h"
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+namespace {
+	struct Batch {
+		Graphics::Material *material;
+		std::unique_ptr<Graphics::VertexArray> verts;
+	};
+
+	// kept from frame to frame so that the arrays keep their storage
+	static std::vector<Batch> s_batches;
+	static bool s_collecting = false;
+
+	template <typename T>
+	static void append(std::vector<T> &to, const std::vector<T> &from)
+	{
+		to.insert(to.end(), from.begin(), from.end());
+	}
+
+	static Graphics::VertexArray &get_vertex_array(Graphics::Material *mat, Graphics::AttributeSet attribs)
+	{
+		for (Batch &batch : s_batches) {
+			if (batch.material == mat && batch.verts->GetAttributeSet() == attribs)
+				return *batch.verts;
+		}
+
+		s_batches.push_back({ mat, std::make_unique<Graphics::VertexArray>(attribs) });
+		return *s_batches.back().verts;
+	}
+} // namespace
+
+namespace SceneGraph {
+
+	void EffectBatch::Begin()
+	{
+		assert(!s_collecting);
+		s_collecting = true;
+	}
+
+	void EffectBatch::End(Graphics::Renderer *r)
+	{
+		PROFILE_SCOPED()
+		assert(s_collecting);
+		s_collecting = false;
+
+		Graphics::Renderer::MatrixTicket mt(r, matrix4x4f::Identity());
+		for (Batch &batch : s_batches) {
+			if (batch.verts->IsEmpty())
+				continue;
+
+			r->DrawBuffer(batch.verts.get(), batch.material);
+			r->GetStats().AddToStatCount(Graphics::Stats::STAT_EFFECT_BATCH_DRAWS, 1);
+			batch.verts->Clear();
+		}
+	}
+
+	bool EffectBatch::IsCollecting()
+	{
+		return s_collecting;
+	}
+
+	void EffectBatch::AddMesh(Graphics::Material *mat, const Graphics::VertexArray &mesh, const matrix4x4f &trans, const Color &tint)
+	{
+		assert(s_collecting);
+		assert(mesh.HasAttrib(Graphics::ATTRIB_UV0));
+		Graphics::VertexArray &va = get_vertex_array(mat, Graphics::ATTRIB_POSITION | Graphics::ATTRIB_DIFFUSE | Graphics::ATTRIB_UV0);
+
+		for (Uint32 i = 0; i < mesh.GetNumVerts(); i++)
+			va.Add(trans * mesh.position[i], tint, mesh.uv0[i]);
+	}
+
+	void EffectBatch::AddVertices(Graphics::Material *mat, const Graphics::VertexArray &verts)
+	{
+		assert(s_collecting);
+		Graphics::VertexArray &va = get_vertex_array(mat, verts.GetAttributeSet());
+
+		append(va.position, verts.position);
+		append(va.normal, verts.normal);
+		append(va.diffuse, verts.diffuse);
+		append(va.uv0, verts.uv0);
+		append(va.tangent, verts.tangent);
+	}
+
+} // namespace SceneGraph
@@ -0,0 +1,43 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _SCENEGRAPH_EFFECTBATCH_H
+#define _SCENEGRAPH_EFFECTBATCH_H
+/*
+ * Collects the small additive effects of every model drawn in a frame
+ * (thruster flames, navlight sprites) and draws them as one buffer per
+ * material once all bodies are drawn, rather than a draw or two per node.
+ * They blend additively without writing depth, so the order they are
+ * drawn in doesn't matter.
+ *
+ * Nothing is collected outside Begin/End and callers draw as usual, so
+ * models rendered on their own (model viewer, ship spinners) are unaffected.
+ */
+#include "Color.h"
+#include "matrix4x4.h"
+
+namespace Graphics {
+	class Material;
+	class Renderer;
+	class VertexArray;
+} // namespace Graphics
+
+namespace SceneGraph {
+
+	class EffectBatch {
+	public:
+		static void Begin();
+		// draws and clears everything collected since Begin
+		static void End(Graphics::Renderer *r);
+		static bool IsCollecting();
+
+		// Appends a mesh of positions and uv0 moved into view space by trans
+		// and tinted. The material must use vertex colours.
+		static void AddMesh(Graphics::Material *mat, const Graphics::VertexArray &mesh, const matrix4x4f &trans, const Color &tint);
+		// appends vertices already in view space
+		static void AddVertices(Graphics::Material *mat, const Graphics::VertexArray &verts);
+	};
+
+} // namespace SceneGraph
+
+#endif
@@ -3,15 +3,86 @@
 
 #include "Group.h"
 #include "BaseLoader.h"
+#include "MatrixTransform.h"
 #include "NodeCopyCache.h"
 #include "NodeVisitor.h"
+#include "StaticGeometry.h"
 #include "matrix4x4.h"
 #include "utils.h"
 
 namespace SceneGraph {
 
+	namespace {
+		// the RenderData::nodemask values, 0-7, a node with the given mask passes
+		Uint8 PassMask(unsigned int nodeMask)
+		{
+			Uint8 mask = 0;
+			for (unsigned int v = 0; v < 8; v++)
+				if (nodeMask & v)
+					mask |= 1 << v;
+			return mask;
+		}
+
+		// Gathers the geometry of a subtree made only of groups, transforms
+		// that no animation moves and static geometry
+		class FlattenVisitor : public NodeVisitor {
+		public:
+			FlattenVisitor() :
+				m_flattenable(true)
+			{
+				m_transforms.push_back(matrix4x4f::Identity());
+				m_pathMasks.push_back(0xff);
+			}
+
+			// billboards, thrusters, labels, submodels...
+			virtual void ApplyNode(Node &) override { m_flattenable = false; }
+			virtual void ApplyGroup(Group &g) override { Descend(g, matrix4x4f::Identity()); }
+
+			virtual void ApplyMatrixTransform(MatrixTransform &m) override
+			{
+				if (m.IsAnimated())
+					m_flattenable = false;
+				else
+					Descend(m, m.GetTransform());
+			}
+
+			// the level is picked every frame
+			virtual void ApplyLOD(LOD &) override { m_flattenable = false; }
+
+			// not drawn
+			virtual void ApplyCollisionGeometry(CollisionGeometry &) override {}
+
+			virtual void ApplyStaticGeometry(StaticGeometry &g) override
+			{
+				if (m_flattenable)
+					geometry.push_back({ &g, m_transforms.back(), m_pathMasks.back() });
+			}
+
+			bool IsFlattenable() const { return m_flattenable; }
+
+			std::vector<FlatGeometry> geometry;
+
+		private:
+			void Descend(Group &g, const matrix4x4f &m)
+			{
+				if (!m_flattenable)
+					return;
+				m_transforms.push_back(m_transforms.back() * m);
+				m_pathMasks.push_back(m_pathMasks.back() & PassMask(g.GetNodeMask()));
+				g.Traverse(*this);
+				m_pathMasks.pop_back();
+				m_transforms.pop_back();
+			}
+
+			bool m_flattenable;
+			std::vector<matrix4x4f> m_transforms;
+			std::vector<Uint8> m_pathMasks;
+		};
+	} // namespace
+
 	Group::Group(Graphics::Renderer *r) :
-		Node(r, NODE_SOLID | NODE_TRANSPARENT)
+		Node(r, NODE_SOLID | NODE_TRANSPARENT),
+		m_flatState(FlatState::Unknown)
 	{
 	}
 
@@ -23,7 +94,8 @@ namespace SceneGraph {
 	}
 
 	Group::Group(const Group &group, NodeCopyCache *cache) :
-		Node(group, cache)
+		Node(group, cache),
+		m_flatState(FlatState::Unknown)
 	{
 		for (std::vector<Node *>::const_iterator itr = group.m_children.begin();
 			 itr != group.m_children.end();
@@ -55,6 +127,7 @@ namespace SceneGraph {
 		child->IncRefCount();
 		child->SetParent(this);
 		m_children.push_back(child);
+		InvalidateFlattened();
 	}
 
 	bool Group::RemoveChild(Node *node)
@@ -67,6 +140,7 @@ namespace SceneGraph {
 				itr = m_children.erase(itr);
 				node->SetParent(nullptr);
 				node->DecRefCount();
+				InvalidateFlattened();
 				return true;
 			}
 		}
@@ -80,9 +154,27 @@ namespace SceneGraph {
 		node->SetParent(nullptr);
 		node->DecRefCount();
 		m_children.erase(m_children.begin() + idx);
+		InvalidateFlattened();
 		return true;
 	}
 
+	bool Group::ReplaceChild(Node *node, Node *replacement)
+	{
+		if (!node || !replacement) return false;
+		for (Node *&child : m_children) {
+			if (child == node) {
+				replacement->IncRefCount();
+				replacement->SetParent(this);
+				child = replacement;
+				node->SetParent(nullptr);
+				node->DecRefCount();
+				InvalidateFlattened();
+				return true;
+			}
+		}
+		return false;
+	}
+
 	Node *Group::GetChildAt(unsigned int idx)
 	{
 		return m_children.at(idx);
@@ -107,6 +199,30 @@ namespace SceneGraph {
 		return GetParent() ? GetParent()->CalcGlobalTransform() : matrix4x4fIdentity;
 	}
 
+	void Group::InvalidateFlattened()
+	{
+		// a flat group above may have been drawing this subtree
+		for (Group *g = this; g; g = g->GetParent()) {
+			g->m_flatState = FlatState::Unknown;
+			g->m_flatGeometry.clear();
+		}
+	}
+
+	void Group::Flatten()
+	{
+		PROFILE_SCOPED()
+		FlattenVisitor fv;
+		for (Node *child : m_children)
+			child->Accept(fv);
+
+		if (fv.IsFlattenable()) {
+			m_flatGeometry = std::move(fv.geometry);
+			m_flatState = FlatState::Flat;
+		} else {
+			m_flatState = FlatState::Nested;
+		}
+	}
+
 	void Group::Accept(NodeVisitor &nv)
 	{
 		nv.ApplyGroup(*this);
@@ -127,6 +243,20 @@ namespace SceneGraph {
 	void Group::RenderChildren(const matrix4x4f &trans, const RenderData *rd)
 	{
 		PROFILE_SCOPED()
+		// static parts of models are drawn from a flat list, rather than
+		// by walking down to them and multiplying transforms every frame
+		if (m_flatState == FlatState::Unknown)
+			Flatten();
+
+		if (m_flatState == FlatState::Flat) {
+			for (const FlatGeometry &flat : m_flatGeometry) {
+				// the geometry's own mask can change (shields), so it isn't baked in
+				if (((flat.pathMask >> (rd->nodemask & 0x7)) & 1) && (flat.geometry->GetNodeMask() & rd->nodemask))
+					flat.geometry->Render(trans * flat.transform, rd);
+			}
+			return;
+		}
+
 		for (std::vector<Node *>::iterator itr = m_children.begin(), itEnd = m_children.end(); itr != itEnd; ++itr) {
 			if ((*itr)->GetNodeMask() & rd->nodemask)
 				(*itr)->Render(trans, rd);
@@ -10,6 +10,18 @@
 
 namespace SceneGraph {
 
+	class StaticGeometry;
+
+	// a StaticGeometry below a group with the transforms in between
+	// multiplied out (see Group::RenderChildren)
+	struct FlatGeometry {
+		StaticGeometry *geometry;
+		matrix4x4f transform;
+		// bit n is set if every node between the group and the geometry
+		// passes a RenderData::nodemask of n
+		Uint8 pathMask;
+	};
+
 	class Group : public Node {
 	public:
 		Group(Graphics::Renderer *r);
@@ -22,6 +34,7 @@ namespace SceneGraph {
 		virtual void AddChild(Node *child);
 		virtual bool RemoveChild(Node *node); //true on success
 		virtual bool RemoveChildAt(unsigned int position); //true on success
+		bool ReplaceChild(Node *node, Node *replacement); //keeps the position, true on success
 		unsigned int GetNumChildren() const { return static_cast<Uint32>(m_children.size()); }
 		Node *GetChildAt(unsigned int);
 		virtual void Accept(NodeVisitor &v) override;
@@ -34,11 +47,27 @@ namespace SceneGraph {
 		// The result of this *should* be cached if the model has not changed
 		virtual matrix4x4f CalcGlobalTransform() const;
 
+		// Drops the flattened geometry of this group and the groups above
+		// it, after something below them changed
+		void InvalidateFlattened();
+
 	protected:
 		virtual ~Group();
 		virtual void RenderChildren(const matrix4x4f &trans, const RenderData *rd);
 		virtual void RenderChildren(const std::vector<matrix4x4f> &trans, const RenderData *rd);
 		std::vector<Node *> m_children;
+
+	private:
+		enum class FlatState : Uint8 {
+			Unknown, // not worked out since the subtree last changed
+			Flat,    // m_flatGeometry holds everything to draw
+			Nested   // something below moves or isn't plain geometry
+		};
+
+		void Flatten();
+
+		std::vector<FlatGeometry> m_flatGeometry;
+		FlatState m_flatState;
 	};
 
 } // namespace SceneGraph
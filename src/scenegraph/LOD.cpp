@@ -11,8 +11,17 @@
 #include "graphics/VertexBuffer.h"
 #include "profiler/Profiler.h"
 
+#include <cmath>
+
 namespace SceneGraph {
 
+	float LOD::s_detailScale = 1.f;
+
+	void LOD::SetDetailBias(int bias)
+	{
+		s_detailScale = std::ldexp(1.f, -bias);
+	}
+
 	LOD::LOD(Graphics::Renderer *r) :
 		Group(r)
 	{
@@ -20,7 +29,8 @@ namespace SceneGraph {
 
 	LOD::LOD(const LOD &lod, NodeCopyCache *cache) :
 		Group(lod, cache),
-		m_pixelSizes(lod.m_pixelSizes)
+		m_pixelSizes(lod.m_pixelSizes),
+		m_errors(lod.m_errors)
 	{
 	}
 
@@ -43,33 +53,60 @@ namespace SceneGraph {
 		AddChild(nod);
 	}
 
-	void LOD::Render(const matrix4x4f &trans, const RenderData *rd)
+	void LOD::AddSimplifiedLevel(float error, Node *nod)
+	{
+		m_errors.push_back(error);
+		if (nod->GetName().empty()) {
+			nod->SetName(stringf("%0{f.4}", error));
+		}
+		AddChild(nod);
+	}
+
+	unsigned int LOD::SelectLevel(const matrix4x4f &trans, const RenderData *rd) const
 	{
-		PROFILE_SCOPED()
-		//figure out approximate pixel size of object's bounding radius
-		//on screen and pick a child to render
 		const vector3f cameraPos(-trans[12], -trans[13], -trans[14]);
 		//fov is vertical, so using screen height
 		// FIXME: this should reference a camera object instead of querying the render height
-		const float pixrad = m_renderer->GetWindowHeight() * rd->boundingRadius / (cameraPos.Length() * Graphics::GetFovFactor());
-		if (m_pixelSizes.empty()) return;
+		const float pixelsPerUnit = s_detailScale * m_renderer->GetWindowHeight() / (cameraPos.Length() * Graphics::GetFovFactor());
 		unsigned int lod = m_children.size() - 1;
+
+		if (!m_errors.empty()) {
+			//coarsest level whose error is too small to be seen
+			for (unsigned int i = 0; i < m_errors.size(); i++) {
+				if (m_errors[i] * pixelsPerUnit <= MAX_PIXEL_ERROR) {
+					lod = i;
+					break;
+				}
+			}
+			return lod;
+		}
+
+		//figure out approximate pixel size of object's bounding radius
+		//on screen and pick a child to render
+		const float pixrad = rd->boundingRadius * pixelsPerUnit;
 		for (unsigned int i = m_pixelSizes.size(); i > 0; i--) {
 			if (pixrad < m_pixelSizes[i - 1]) lod = i - 1;
 		}
-		m_children[lod]->Render(trans, rd);
+		return lod;
+	}
+
+	void LOD::Render(const matrix4x4f &trans, const RenderData *rd)
+	{
+		PROFILE_SCOPED()
+		if (m_children.empty()) return;
+		m_children[SelectLevel(trans, rd)]->Render(trans, rd);
 	}
 
 	void LOD::Render(const std::vector<matrix4x4f> &trans, const RenderData *rd)
 	{
 		// anything to draw?
-		if (m_pixelSizes.empty())
+		if (m_children.empty())
 			return;
 
 		// got something to draw with
 		Graphics::Renderer *r = GetRenderer();
 		if (r != nullptr) {
-			const size_t count = m_pixelSizes.size();
+			const size_t count = m_children.size();
 			const size_t tsize = trans.size();
 
 			// transformation buffers
@@ -80,21 +117,8 @@ namespace SceneGraph {
 			}
 
 			// seperate out the transformations
-			for (auto mt : trans) {
-				//figure out approximate pixel size of object's bounding radius
-				//on screen and pick a child to render
-				const vector3f cameraPos(-mt[12], -mt[13], -mt[14]);
-				//fov is vertical, so using screen height
-				// FIXME: this should reference a camera object instead of querying the window height
-				const float pixrad = m_renderer->GetWindowHeight() * rd->boundingRadius / (cameraPos.Length() * Graphics::GetFovFactor());
-				unsigned int lod = m_children.size() - 1;
-				for (unsigned int i = m_pixelSizes.size(); i > 0; i--) {
-					if (pixrad < m_pixelSizes[i - 1]) {
-						lod = i - 1;
-					}
-				}
-
-				transform[lod].push_back(mt);
+			for (const matrix4x4f &mt : trans) {
+				transform[SelectLevel(mt, rd)].push_back(mt);
 			}
 
 			// now render each of the buffers for each of the lods
@@ -113,6 +137,9 @@ namespace SceneGraph {
 		db.wr->Int32(m_pixelSizes.size());
 		for (auto i : m_pixelSizes)
 			db.wr->Int32(i);
+		db.wr->Int32(m_errors.size());
+		for (float e : m_errors)
+			db.wr->Float(e);
 	}
 
 	LOD *LOD::Load(NodeDatabase &db)
@@ -121,6 +148,9 @@ namespace SceneGraph {
 		const Uint32 numLevels = db.rd->Int32();
 		for (Uint32 i = 0; i < numLevels; i++)
 			lod->m_pixelSizes.push_back(db.rd->Int32());
+		const Uint32 numErrors = db.rd->Int32();
+		for (Uint32 i = 0; i < numErrors; i++)
+			lod->m_errors.push_back(db.rd->Float());
 		return lod;
 	}
 
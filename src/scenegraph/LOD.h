@@ -5,6 +5,12 @@
 #define _LOD_H
 /*
  * Level of detail switch node
+ *
+ * Levels are either authored, switching at a given pixel size of the
+ * model's bounding radius, or generated by the model compiler, in which
+ * case each carries the error of its simplified geometry and the coarsest
+ * level whose error projects to at most MAX_PIXEL_ERROR is drawn.
+ * Levels are ordered from the least to the most detailed.
  */
 #include "Group.h"
 
@@ -20,12 +26,25 @@ namespace SceneGraph {
 		virtual void Render(const matrix4x4f &trans, const RenderData *rd) override;
 		virtual void Render(const std::vector<matrix4x4f> &trans, const RenderData *rd) override;
 		void AddLevel(float pixelRadius, Node *child);
+		// error: how far, in model units, the level deviates from the full detail mesh
+		void AddSimplifiedLevel(float error, Node *child);
 		virtual void Save(NodeDatabase &) override;
 		static LOD *Load(NodeDatabase &);
 
+		static constexpr float MAX_PIXEL_ERROR = 1.0f;
+
+		// Levels of detail to shift every LOD by, coarser when positive, see
+		// QualityGovernor. Each level halves the on-screen size levels are
+		// chosen by.
+		static void SetDetailBias(int bias);
+
 	protected:
 		virtual ~LOD() {}
-		std::vector<unsigned int> m_pixelSizes; // same number as children
+		unsigned int SelectLevel(const matrix4x4f &trans, const RenderData *rd) const;
+		std::vector<unsigned int> m_pixelSizes; // same number as children, or empty
+		std::vector<float> m_errors; // same number as children, or empty
+
+		static float s_detailScale;
 	};
 
 } // namespace SceneGraph
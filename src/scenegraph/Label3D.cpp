@@ -7,7 +7,6 @@
 #include "graphics/RenderState.h"
 #include "graphics/Renderer.h"
 #include "graphics/Types.h"
-#include "graphics/VertexArray.h"
 #include "graphics/VertexBuffer.h"
 
 #include "profiler/Profiler.h"
@@ -27,7 +26,6 @@ namespace SceneGraph {
 		rsd.depthWrite = false;
 		rsd.blendMode = Graphics::BLEND_ALPHA;
 
-		m_geometry.reset(font->CreateVertexArray());
 		m_material.Reset(r->CreateMaterial("label", matdesc, rsd));
 		m_material->SetTexture("texture0"_hash, font->GetTexture());
 		m_material->diffuse = Color::WHITE;
@@ -40,7 +38,6 @@ namespace SceneGraph {
 		m_material(label.m_material),
 		m_font(label.m_font)
 	{
-		m_geometry.reset(m_font->CreateVertexArray());
 	}
 
 	Node *Label3D::Clone(NodeCopyCache *cache)
@@ -50,32 +47,20 @@ namespace SceneGraph {
 
 	void Label3D::SetText(const std::string &text)
 	{
-		//regenerate geometry
-		m_geometry->Clear();
-		m_textMesh.reset();
-
-		if (!text.empty()) {
-			m_font->GetGeometry(*m_geometry, text, vector2f(0.f));
-
-			// Happens if none of the characters in the string have glyphs in the SDF font.
-			// Most noticeably, this means text consisting of entirely Cyrillic
-			// or Chinese characters will vanish when rendered on a Label3D.
-			if (m_geometry->IsEmpty()) {
-				return;
-			}
-
-			//create buffer and upload data
-			m_textMesh.reset(m_renderer->CreateMeshObjectFromArray(m_geometry.get()));
-		}
+		// empty if none of the characters have glyphs
+		if (text.empty())
+			m_textMesh.Reset();
+		else
+			m_textMesh = m_font->GetMesh(m_renderer, text);
 	}
 
 	void Label3D::Render(const matrix4x4f &trans, const RenderData *rd)
 	{
 		PROFILE_SCOPED()
-		if (m_textMesh.get()) {
+		if (m_textMesh.Valid()) {
 			Graphics::Renderer *r = GetRenderer();
 			r->SetTransform(trans);
-			r->DrawMesh(m_textMesh.get(), m_material.Get());
+			r->DrawMesh(m_textMesh.Get(), m_material.Get());
 		}
 	}
 
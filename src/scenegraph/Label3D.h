@@ -11,8 +11,6 @@
 #include "graphics/VertexBuffer.h"
 #include "text/DistanceFieldFont.h"
 
-#include <memory>
-
 namespace Graphics {
 	class Renderer;
 	class RenderState;
@@ -32,8 +30,7 @@ namespace SceneGraph {
 
 	private:
 		RefCountedPtr<Graphics::Material> m_material;
-		std::unique_ptr<Graphics::VertexArray> m_geometry;
-		std::unique_ptr<Graphics::MeshObject> m_textMesh;
+		RefCountedPtr<Graphics::MeshObject> m_textMesh; // shared with labels of the same text
 		RefCountedPtr<Text::DistanceFieldFont> m_font;
 	};
 
@@ -14,6 +14,7 @@
 #include "FileSystem.h"
 #include "StringF.h"
 #include "core/Log.h"
+#include "core/TaskGraph.h"
 #include "graphics/RenderState.h"
 #include "graphics/Renderer.h"
 #include "graphics/TextureBuilder.h"
@@ -123,12 +124,74 @@ namespace {
 } // anonymous namespace
 
 namespace SceneGraph {
+	// Reads a mesh file to be converted into the model's scenegraph; Assimp's
+	// post-processing (welding, tangents, normals...) is most of the work.
+	// Safe to run on any thread, with an importer of its own.
+	static const aiScene *ImportMeshFile(Assimp::Importer &importer, const std::string &filename)
+	{
+		PROFILE_SCOPED()
+		importer.SetIOHandler(new AssimpFileSystem(FileSystem::gameDataFiles));
+
+		//Removing components is suggested to optimize loading. We do not care about vtx colors now.
+		importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, aiComponent_COLORS);
+		importer.SetPropertyInteger(AI_CONFIG_PP_SLM_VERTEX_LIMIT, AI_SLM_DEFAULT_MAX_VERTICES);
+
+		//There are several optimizations assimp can do, intentionally skipping them now
+		return importer.ReadFile(
+			filename,
+			aiProcess_RemoveComponent |
+				aiProcess_Triangulate |
+				aiProcess_SortByPType | //ignore point, line primitive types (collada dummy nodes seem to be fine)
+				aiProcess_GenUVCoords |
+				aiProcess_FlipUVs |
+				aiProcess_CalcTangentSpace |
+				aiProcess_JoinIdenticalVertices |
+				aiProcess_GenSmoothNormals | //only if normals not specified
+				aiProcess_ImproveCacheLocality |
+				aiProcess_LimitBoneWeights |
+				aiProcess_FindDegenerates |
+				aiProcess_FindInvalidData);
+	}
+
+	// Reads a collision mesh file, as ImportMeshFile does
+	static const aiScene *ImportCollisionFile(Assimp::Importer &importer, const std::string &filename)
+	{
+		PROFILE_SCOPED()
+		importer.SetIOHandler(new AssimpFileSystem(FileSystem::gameDataFiles));
+
+		//discard extra data
+		importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS,
+			aiComponent_COLORS |
+				aiComponent_TEXCOORDS |
+				aiComponent_NORMALS |
+				aiComponent_MATERIALS);
+		return importer.ReadFile(
+			filename,
+			aiProcess_RemoveComponent |
+				aiProcess_Triangulate |
+				aiProcess_PreTransformVertices //"bake" transformations so we can disregard the structure
+		);
+	}
+
+	TaskGraph *Loader::s_taskGraph = nullptr;
+
 	Loader::Loader(Graphics::Renderer *r, bool logWarnings, bool loadSGMfiles) :
 		BaseLoader(r),
 		m_doLog(logWarnings),
 		m_loadSGMs(loadSGMfiles),
-		m_mostDetailedLod(false)
+		m_mostDetailedLod(false),
+		m_importCache(nullptr),
+		m_importProgress(nullptr)
+	{
+	}
+
+	Loader::~Loader()
+	{
+	}
+
+	void Loader::SetTaskGraph(TaskGraph *graph)
 	{
+		s_taskGraph = graph;
 	}
 
 	Model *Loader::LoadModel(const std::string &filename)
@@ -143,20 +206,7 @@ namespace SceneGraph {
 
 		std::vector<std::string> list_model;
 		std::vector<std::string> list_sgm;
-		FileSystem::FileSource &fileSource = FileSystem::gameDataFiles;
-		for (FileSystem::FileEnumerator files(fileSource, basepath, FileSystem::FileEnumerator::Recurse); !files.Finished(); files.Next()) {
-			const FileSystem::FileInfo &info = files.Current();
-			const std::string &fpath = info.GetPath();
-
-			//check it's the expected type
-			if (info.IsFile()) {
-				if (ends_with_ci(fpath, ".model")) { // store the path for ".model" files
-					list_model.push_back(fpath);
-				} else if (m_loadSGMs & ends_with_ci(fpath, ".sgm")) { // store only the shortname for ".sgm" files.
-					list_sgm.push_back(info.GetName().substr(0, info.GetName().size() - 4));
-				}
-			}
-		}
+		FindModelFiles(basepath, list_model, list_sgm);
 
 		if (m_loadSGMs) {
 			for (auto &sgmname : list_sgm) {
@@ -172,18 +222,102 @@ namespace SceneGraph {
 			}
 		}
 
+		ModelDefinition modelDefinition;
+		if (!ParseModelDefinition(shortname, list_model, modelDefinition))
+			throw(LoadingError("File not found"));
+
+		ImportFiles(modelDefinition, false);
+		return CreateModel(modelDefinition);
+	}
+
+	void Loader::PrepareModel(const std::string &shortname, const std::string &basepath)
+	{
+		PROFILE_SCOPED()
+		m_logMessages.clear();
+
+		std::vector<std::string> list_model;
+		std::vector<std::string> list_sgm;
+		FindModelFiles(basepath, list_model, list_sgm);
+
+		m_preparedDef = ModelDefinition();
+		if (!ParseModelDefinition(shortname, list_model, m_preparedDef))
+			throw(LoadingError("File not found"));
+
+		ImportFiles(m_preparedDef, true);
+	}
+
+	Model *Loader::CreatePreparedModel()
+	{
+		PROFILE_SCOPED()
+		assert(!m_preparedDef.name.empty());
+		return CreateModel(m_preparedDef);
+	}
+
+	std::vector<std::string> Loader::GetSourceFiles() const
+	{
+		std::vector<std::string> files = GetMeshFiles();
+		files.push_back(m_modelFile);
+
+		for (const MaterialDefinition &mat : m_preparedDef.matDefs) {
+			for (const std::string *tex : { &mat.tex_diff, &mat.tex_spec, &mat.tex_glow, &mat.tex_ambi, &mat.tex_norm }) {
+				if (!tex->empty() && std::find(files.begin(), files.end(), *tex) == files.end())
+					files.push_back(*tex);
+			}
+		}
+
+		return files;
+	}
+
+	std::vector<std::string> Loader::GetMeshFiles() const
+	{
+		std::vector<std::string> files;
+		for (const LodDefinition &lod : m_preparedDef.lodDefs) {
+			for (const std::string &name : lod.meshNames) {
+				if (std::find(files.begin(), files.end(), name) == files.end())
+					files.push_back(name);
+			}
+		}
+
+		for (const std::string &name : m_preparedDef.collisionDefs) {
+			if (std::find(files.begin(), files.end(), name) == files.end())
+				files.push_back(name);
+		}
+
+		return files;
+	}
+
+	void Loader::FindModelFiles(const std::string &basepath, std::vector<std::string> &list_model, std::vector<std::string> &list_sgm)
+	{
+		FileSystem::FileSource &fileSource = FileSystem::gameDataFiles;
+		for (FileSystem::FileEnumerator files(fileSource, basepath, FileSystem::FileEnumerator::Recurse); !files.Finished(); files.Next()) {
+			const FileSystem::FileInfo &info = files.Current();
+			const std::string &fpath = info.GetPath();
+
+			//check it's the expected type
+			if (info.IsFile()) {
+				if (ends_with_ci(fpath, ".model")) { // store the path for ".model" files
+					list_model.push_back(fpath);
+				} else if (m_loadSGMs & ends_with_ci(fpath, ".sgm")) { // store only the shortname for ".sgm" files.
+					list_sgm.push_back(info.GetName().substr(0, info.GetName().size() - 4));
+				}
+			}
+		}
+	}
+
+	bool Loader::ParseModelDefinition(const std::string &shortname, const std::vector<std::string> &list_model, ModelDefinition &def)
+	{
+		FileSystem::FileSource &fileSource = FileSystem::gameDataFiles;
 		for (auto &fpath : list_model) {
 			RefCountedPtr<FileSystem::FileData> filedata = FileSystem::gameDataFiles.ReadFile(fpath);
 			if (!filedata) {
 				Output("LoadModel: %s: could not read file\n", fpath.c_str());
-				return nullptr;
+				throw LoadingError("Could not read file");
 			}
 
 			//check it's the wanted name & load it
 			const FileSystem::FileInfo &info = filedata->GetInfo();
 			const std::string name = info.GetName();
 			if (name.substr(0, name.length() - 6) == shortname) {
-				ModelDefinition modelDefinition;
 				try {
 					//curPath is used to find textures, patterns,
 					//possibly other data files for this model.
@@ -194,16 +328,17 @@ namespace SceneGraph {
 						m_curPath = m_curPath.substr(0, m_curPath.length() - 1);
 
 					Parser p(fileSource, fpath, m_curPath);
-					p.Parse(&modelDefinition);
+					p.Parse(&def);
 				} catch (ParseError &err) {
 					Output("%s\n", err.what());
 					throw LoadingError(err.what());
 				}
-				modelDefinition.name = shortname;
-				return CreateModel(modelDefinition);
+				def.name = shortname;
+				m_modelFile = fpath;
+				return true;
 			}
 		}
-		throw(LoadingError("File not found"));
+		return false;
 	}
 
 	Model *Loader::CreateModel(ModelDefinition &def)
@@ -308,10 +443,20 @@ namespace SceneGraph {
 			}
 		}
 
-		// Run CollisionVisitor to create the initial CM and its GeomTree.
-		// If no collision mesh is defined, a simple bounding box will be generated
-		Output("CreateCollisionMesh for : (%s)\n", m_model->m_name.c_str());
-		m_model->CreateCollisionMesh();
+		// anything imported but not used
+		m_importedMeshes.clear();
+		m_importedCollisions.clear();
+
+		if (m_reuseCollMesh) {
+			m_model->m_collMesh = m_reuseCollMesh;
+			m_model->m_boundingRadius = m_reuseCollMesh->GetAabb().GetRadius();
+			m_reuseCollMesh.Reset();
+		} else {
+			// Run CollisionVisitor to create the initial CM and its GeomTree.
+			// If no collision mesh is defined, a simple bounding box will be generated
+			Output("CreateCollisionMesh for : (%s)\n", m_model->m_name.c_str());
+			m_model->CreateCollisionMesh();
+		}
 
 		// Do an initial animation update to get all the animation transforms correct
 		m_model->InitAnimations();
@@ -326,6 +471,129 @@ namespace SceneGraph {
 		return model;
 	}
 
+	void Loader::ImportFiles(const ModelDefinition &def, bool importAll)
+	{
+		PROFILE_SCOPED()
+		m_importedMeshes.clear();
+		m_importedCollisions.clear();
+
+		struct Import {
+			const std::string *filename;
+			ImportedFile *file;
+			bool collision;
+		};
+		std::vector<Import> imports;
+		for (const LodDefinition &lod : def.lodDefs) {
+			for (const std::string &name : lod.meshNames) {
+				auto result = m_importedMeshes.emplace(name, ImportedFile());
+				if (result.second)
+					imports.push_back({ &result.first->first, &result.first->second, false });
+			}
+		}
+		for (const std::string &name : def.collisionDefs) {
+			auto result = m_importedCollisions.emplace(name, ImportedFile());
+			if (result.second)
+				imports.push_back({ &result.first->first, &result.first->second, true });
+		}
+
+		if (m_importProgress) {
+			m_importProgress->numFiles = uint32_t(imports.size());
+			m_importProgress->numImported = 0;
+		}
+
+		if (m_importCache) {
+			// files the model no longer uses
+			for (auto *cached : { &m_importCache->meshes, &m_importCache->collisions }) {
+				const auto &used = cached == &m_importCache->meshes ? m_importedMeshes : m_importedCollisions;
+				for (auto iter = cached->begin(); iter != cached->end();) {
+					if (used.count(iter->first))
+						++iter;
+					else
+						iter = cached->erase(iter);
+				}
+			}
+
+			// files unchanged since they were last imported
+			for (auto iter = imports.begin(); iter != imports.end();) {
+				auto &cached = iter->collision ? m_importCache->collisions : m_importCache->meshes;
+				auto cachedFile = cached.find(*iter->filename);
+				iter->file->modTime = FileSystem::gameDataFiles.Lookup(*iter->filename).GetModificationTime();
+
+				if (cachedFile != cached.end() && cachedFile->second.scene && cachedFile->second.modTime == iter->file->modTime) {
+					*iter->file = cachedFile->second;
+					iter = imports.erase(iter);
+					if (m_importProgress)
+						m_importProgress->numImported++;
+				} else {
+					++iter;
+				}
+			}
+		}
+
+		// a lone file gains nothing from a worker
+		if (!importAll && (!s_taskGraph || imports.size() < 2)) {
+			for (const Import &job : imports) {
+				(job.collision ? m_importedCollisions : m_importedMeshes).erase(*job.filename);
+			}
+			return;
+		}
+
+		auto importFile = [this](Import &job) {
+			job.file->importer.reset(new Assimp::Importer());
+			job.file->scene = job.collision ?
+				ImportCollisionFile(*job.file->importer, *job.filename) :
+				ImportMeshFile(*job.file->importer, *job.filename);
+			if (m_importProgress)
+				m_importProgress->numImported++;
+		};
+
+		if (s_taskGraph && imports.size() >= 2) {
+			// only the conversion into the scenegraph, which creates the GPU
+			// buffers, is left for the calling thread
+			TaskSet *taskSet = new TaskSet();
+			for (uint32_t i = 0; i < imports.size(); i++) {
+				taskSet->AddTaskLambda({ i, i + 1 }, [&imports, &importFile](TaskRange range) {
+					importFile(imports[range.begin]);
+				});
+			}
+
+			TaskSet::Handle handle = s_taskGraph->QueueTaskSet(taskSet);
+			s_taskGraph->WaitForTaskSet(handle);
+		} else {
+			for (Import &job : imports)
+				importFile(job);
+		}
+
+		if (m_importCache) {
+			for (const Import &job : imports) {
+				if (job.file->scene)
+					(job.collision ? m_importCache->collisions : m_importCache->meshes)[*job.filename] = *job.file;
+			}
+		}
+	}
+
+	Loader::ImportedFile Loader::TakeImportedFile(const std::string &filename, bool collision)
+	{
+		std::map<std::string, ImportedFile> &imported = collision ? m_importedCollisions : m_importedMeshes;
+		auto iter = imported.find(filename);
+		if (iter != imported.end()) {
+			ImportedFile file = std::move(iter->second);
+			imported.erase(iter);
+			return file;
+		}
+
+		// not imported ahead, so do it now
+		ImportedFile file;
+		file.importer.reset(new Assimp::Importer());
+		file.scene = collision ? ImportCollisionFile(*file.importer, filename) : ImportMeshFile(*file.importer, filename);
+
+		if (m_importCache && file.scene) {
+			file.modTime = FileSystem::gameDataFiles.Lookup(filename).GetModificationTime();
+			(collision ? m_importCache->collisions : m_importCache->meshes)[filename] = file;
+		}
+		return file;
+	}
+
 	RefCountedPtr<Node> Loader::LoadMesh(const std::string &filename, const std::vector<AnimDefinition> &animDefs)
 	{
 		PROFILE_SCOPED()
@@ -347,33 +615,12 @@ namespace SceneGraph {
 		else
 			m_modelFormat = ModelFormat::UNKNOWN;
 
-		Assimp::Importer importer;
-		importer.SetIOHandler(new AssimpFileSystem(FileSystem::gameDataFiles));
-
-		//Removing components is suggested to optimize loading. We do not care about vtx colors now.
-		importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, aiComponent_COLORS);
-		importer.SetPropertyInteger(AI_CONFIG_PP_SLM_VERTEX_LIMIT, AI_SLM_DEFAULT_MAX_VERTICES);
-
-		//There are several optimizations assimp can do, intentionally skipping them now
-		const aiScene *scene = importer.ReadFile(
-			filename,
-			aiProcess_RemoveComponent |
-				aiProcess_Triangulate |
-				aiProcess_SortByPType | //ignore point, line primitive types (collada dummy nodes seem to be fine)
-				aiProcess_GenUVCoords |
-				aiProcess_FlipUVs |
-				aiProcess_CalcTangentSpace |
-				aiProcess_JoinIdenticalVertices |
-				aiProcess_GenSmoothNormals | //only if normals not specified
-				aiProcess_ImproveCacheLocality |
-				aiProcess_LimitBoneWeights |
-				aiProcess_FindDegenerates |
-				aiProcess_FindInvalidData);
-
+		ImportedFile file = TakeImportedFile(filename, false);
+		const aiScene *scene = file.scene;
 		if (!scene) {
 			// Assimp 3.1.1 doesn't have aiGetVersionPatch(), add it back in at some point
 			std::string err = fmt::format("Assimp {}.{} importer error: {}\n",
-				aiGetVersionMajor(), aiGetVersionMinor(), importer.GetErrorString());
+				aiGetVersionMajor(), aiGetVersionMinor(), file.importer->GetErrorString());
 			throw LoadingError(err);
 		}
 
@@ -958,22 +1205,8 @@ namespace SceneGraph {
 		//Animations and node structure can be ignored
 		assert(m_model);
 
-		Assimp::Importer importer;
-		importer.SetIOHandler(new AssimpFileSystem(FileSystem::gameDataFiles));
-
-		//discard extra data
-		importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS,
-			aiComponent_COLORS |
-				aiComponent_TEXCOORDS |
-				aiComponent_NORMALS |
-				aiComponent_MATERIALS);
-		const aiScene *scene = importer.ReadFile(
-			filename,
-			aiProcess_RemoveComponent |
-				aiProcess_Triangulate |
-				aiProcess_PreTransformVertices //"bake" transformations so we can disregard the structure
-		);
-
+		ImportedFile file = TakeImportedFile(filename, true);
+		const aiScene *scene = file.scene;
 		if (!scene)
 			throw LoadingError("Could not load file");
 
@@ -8,6 +8,7 @@
  */
 #include "BaseLoader.h"
 #include "CollisionGeometry.h"
+#include "DateTime.h"
 #include "graphics/Material.h"
 
 // Disable some GCC diagnostics errors.
@@ -22,23 +23,80 @@
 #include <assimp/types.h>
 #endif
 
+#include <atomic>
+#include <map>
+#include <memory>
+
 struct aiNode;
 struct aiMesh;
 struct aiScene;
 struct aiNodeAnim;
 
+namespace Assimp {
+	class Importer;
+}
+
+class TaskGraph;
+
 namespace SceneGraph {
 
 	class Loader : public BaseLoader {
 	public:
+		// A mesh file imported by Assimp, ahead of being converted
+		struct ImportedFile {
+			std::shared_ptr<Assimp::Importer> importer;
+			const aiScene *scene = nullptr;
+			Time::DateTime modTime;
+		};
+
+		// Imported mesh files kept from one load of a model to the next (e.g.
+		// the editor reloading a model after its files changed). Files that
+		// haven't been modified since are not imported again.
+		struct ImportCache {
+			std::map<std::string, ImportedFile> meshes;
+			std::map<std::string, ImportedFile> collisions;
+		};
+
+		// Mesh files of the model being prepared, readable from other threads
+		struct ImportProgress {
+			std::atomic<uint32_t> numFiles { 0 };
+			std::atomic<uint32_t> numImported { 0 };
+		};
+
 		Loader(Graphics::Renderer *r, bool logWarnings = false, bool loadSGMfiles = true);
+		~Loader();
 
 		//find & attempt to load a model, based on filename (without path or .model suffix)
 		Model *LoadModel(const std::string &name);
 		Model *LoadModel(const std::string &name, const std::string &basepath);
 
+		// Split LoadModel in two: PrepareModel finds and parses the .model
+		// file and imports all its mesh files, without touching the renderer,
+		// so it can run on a job. CreatePreparedModel then builds the model
+		// on the main thread. .sgm files are not considered.
+		// Both throw LoadingError if the model can't be loaded.
+		void PrepareModel(const std::string &name, const std::string &basepath = "models");
+		Model *CreatePreparedModel();
+
+		// The .model file, mesh files and textures of the prepared model
+		std::vector<std::string> GetSourceFiles() const;
+		// The mesh and collision files of the prepared model
+		std::vector<std::string> GetMeshFiles() const;
+
+		void SetImportCache(ImportCache *cache) { m_importCache = cache; }
+		void SetImportProgress(ImportProgress *progress) { m_importProgress = progress; }
+
+		// Give the next model this collision mesh rather than building one
+		// (and its GeomTree) from its collision geometry again
+		void SetCollisionMesh(RefCountedPtr<CollMesh> collMesh) { m_reuseCollMesh = collMesh; }
+
 		const std::vector<std::string> &GetLogMessages() const { return m_logMessages; }
 
+		// The mesh files of a model are imported (and welded, given tangents
+		// etc. by Assimp) in parallel on the worker threads of this graph.
+		// If no graph is set, they're imported one by one as they're needed.
+		static void SetTaskGraph(TaskGraph *graph);
+
 	protected:
 		// store the format of the mesh file we're currently importing to
 		// enable importer-specific quirks/workarounds
@@ -59,9 +117,24 @@ namespace SceneGraph {
 		RefCountedPtr<Group> m_thrustersRoot;
 		RefCountedPtr<Group> m_billboardsRoot;
 
+		std::map<std::string, ImportedFile> m_importedMeshes;
+		std::map<std::string, ImportedFile> m_importedCollisions;
+		ImportCache *m_importCache;
+		ImportProgress *m_importProgress;
+		RefCountedPtr<CollMesh> m_reuseCollMesh;
+
+		std::string m_modelFile;
+		ModelDefinition m_preparedDef;
+
+		static TaskGraph *s_taskGraph;
+
 		bool CheckKeysInRange(const aiNodeAnim *, double start, double end);
 		matrix4x4f ConvertMatrix(const aiMatrix4x4 &) const;
+		void FindModelFiles(const std::string &basepath, std::vector<std::string> &list_model, std::vector<std::string> &list_sgm);
+		bool ParseModelDefinition(const std::string &shortname, const std::vector<std::string> &list_model, ModelDefinition &def); //false if there's no such model
 		Model *CreateModel(ModelDefinition &def);
+		void ImportFiles(const ModelDefinition &def, bool importAll); //import the mesh files of the model up front, in parallel; importAll even without a task graph
+		ImportedFile TakeImportedFile(const std::string &filename, bool collision); //the file imported by ImportFiles, or import it now
 		RefCountedPtr<Node> LoadMesh(const std::string &filename, const std::vector<AnimDefinition> &animDefs); //load one mesh file so it can be added to the model scenegraph. Materials should be created before this!
 		void AddLog(const std::string &);
 		void CheckAnimationConflicts(const Animation *, const std::vector<Animation *> &); //detect animation overlap
@@ -13,13 +13,15 @@ namespace SceneGraph {
 
 	MatrixTransform::MatrixTransform(Graphics::Renderer *r, const matrix4x4f &m) :
 		Group(r),
-		m_transform(m)
+		m_transform(m),
+		m_animated(false)
 	{
 	}
 
 	MatrixTransform::MatrixTransform(const MatrixTransform &mt, NodeCopyCache *cache) :
 		Group(mt, cache),
-		m_transform(mt.m_transform)
+		m_transform(mt.m_transform),
+		m_animated(mt.m_animated)
 	{
 	}
 
@@ -33,6 +35,17 @@ namespace SceneGraph {
 		nv.ApplyMatrixTransform(*this);
 	}
 
+	void MatrixTransform::SetAnimated(bool animated)
+	{
+		if (animated == m_animated)
+			return;
+		m_animated = animated;
+		// the transform itself is applied in Render, only the groups above
+		// bake it in
+		if (GetParent())
+			GetParent()->InvalidateFlattened();
+	}
+
 	matrix4x4f MatrixTransform::CalcGlobalTransform() const
 	{
 		return GetParent() ? GetParent()->CalcGlobalTransform() * m_transform : m_transform;
@@ -37,7 +37,17 @@ namespace SceneGraph {
 		virtual void Render(const std::vector<matrix4x4f> &trans, const RenderData *rd) override;
 
 		const matrix4x4f &GetTransform() const { return m_transform; }
-		void SetTransform(const matrix4x4f &m) { m_transform = m; }
+		void SetTransform(const matrix4x4f &m)
+		{
+			m_transform = m;
+			if (!m_animated) SetAnimated(true);
+		}
+
+		// Animated transforms keep the groups above them from drawing their
+		// static geometry flattened. Set on the first SetTransform; cleared
+		// by the model when the animations moving it stop.
+		bool IsAnimated() const { return m_animated; }
+		void SetAnimated(bool animated);
 
 		virtual matrix4x4f CalcGlobalTransform() const override;
 
@@ -46,6 +56,7 @@ namespace SceneGraph {
 
 	private:
 		matrix4x4f m_transform;
+		bool m_animated;
 	};
 } // namespace SceneGraph
 #endif
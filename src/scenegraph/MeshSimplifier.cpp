@@ -0,0 +1,322 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "MeshSimplifier.h"
+
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+
+	// collapses may turn a triangle by no more than ~75 degrees
+	static constexpr double MIN_NORMAL_COS = 0.25;
+
+	// symmetric 4x4 matrix summing the squared distances to a set of planes
+	struct Quadric {
+		double a2 = 0, ab = 0, ac = 0, ad = 0;
+		double b2 = 0, bc = 0, bd = 0;
+		double c2 = 0, cd = 0;
+		double d2 = 0;
+
+		static Quadric FromPlane(const vector3d &n, double d)
+		{
+			Quadric q;
+			q.a2 = n.x * n.x, q.ab = n.x * n.y, q.ac = n.x * n.z, q.ad = n.x * d;
+			q.b2 = n.y * n.y, q.bc = n.y * n.z, q.bd = n.y * d;
+			q.c2 = n.z * n.z, q.cd = n.z * d;
+			q.d2 = d * d;
+			return q;
+		}
+
+		Quadric &operator+=(const Quadric &o)
+		{
+			a2 += o.a2, ab += o.ab, ac += o.ac, ad += o.ad;
+			b2 += o.b2, bc += o.bc, bd += o.bd;
+			c2 += o.c2, cd += o.cd;
+			d2 += o.d2;
+			return *this;
+		}
+
+		Quadric operator+(const Quadric &o) const { return Quadric(*this) += o; }
+
+		double Eval(const vector3d &p) const
+		{
+			const double e = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x +
+				b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y +
+				c2 * p.z * p.z + 2 * cd * p.z + d2;
+			return std::max(e, 0.0);
+		}
+	};
+
+	struct Collapse {
+		double cost;
+		uint32_t from;
+		uint32_t to;
+		uint32_t version;
+
+		bool operator<(const Collapse &o) const { return cost > o.cost; } // min-heap
+	};
+
+	class Simplifier {
+	public:
+		Simplifier(const std::vector<vector3f> &positions, const std::vector<uint32_t> &indices);
+		float Run(uint32_t targetIndices, float maxError, std::vector<uint32_t> &indicesOut);
+
+	private:
+		bool TriHas(uint32_t tri, uint32_t v) const
+		{
+			return m_tris[tri * 3] == v || m_tris[tri * 3 + 1] == v || m_tris[tri * 3 + 2] == v;
+		}
+
+		void GatherNeighbours(uint32_t v, std::vector<uint32_t> &out) const;
+		bool IsValidCollapse(uint32_t from, uint32_t to);
+		void UpdateCandidate(uint32_t v);
+		void DoCollapse(uint32_t from, uint32_t to);
+
+		std::vector<vector3d> m_pos;
+		std::vector<uint32_t> m_tris;
+		std::vector<bool> m_triAlive;
+		uint32_t m_numAliveTris = 0;
+
+		std::vector<std::vector<uint32_t>> m_vertTris;
+		std::vector<Quadric> m_quadrics;
+		std::vector<bool> m_locked;
+		std::vector<uint32_t> m_version;
+
+		std::priority_queue<Collapse> m_heap;
+		std::vector<uint32_t> m_scratchA, m_scratchB;
+	};
+
+	Simplifier::Simplifier(const std::vector<vector3f> &positions, const std::vector<uint32_t> &indices) :
+		m_tris(indices.begin(), indices.begin() + (indices.size() / 3) * 3)
+	{
+		const uint32_t numVerts = positions.size();
+		const uint32_t numTris = m_tris.size() / 3;
+
+		m_pos.reserve(numVerts);
+		for (const vector3f &p : positions)
+			m_pos.push_back(vector3d(p));
+
+		m_triAlive.assign(numTris, true);
+		m_numAliveTris = numTris;
+		m_vertTris.resize(numVerts);
+		m_quadrics.resize(numVerts);
+		m_locked.assign(numVerts, false);
+		m_version.assign(numVerts, 0);
+
+		std::unordered_map<uint64_t, uint32_t> edgeCount;
+		for (uint32_t t = 0; t < numTris; t++) {
+			const uint32_t *tri = &m_tris[t * 3];
+			for (int i = 0; i < 3; i++) {
+				m_vertTris[tri[i]].push_back(t);
+
+				const uint32_t a = std::min(tri[i], tri[(i + 1) % 3]);
+				const uint32_t b = std::max(tri[i], tri[(i + 1) % 3]);
+				edgeCount[(uint64_t(a) << 32) | b]++;
+			}
+
+			// unweighted planes, so the error stays in units of distance
+			const vector3d n = (m_pos[tri[1]] - m_pos[tri[0]]).Cross(m_pos[tri[2]] - m_pos[tri[0]]);
+			const double len = n.Length();
+			if (len <= 0.0)
+				continue;
+
+			const vector3d nn = n / len;
+			const Quadric q = Quadric::FromPlane(nn, -nn.Dot(m_pos[tri[0]]));
+			for (int i = 0; i < 3; i++)
+				m_quadrics[tri[i]] += q;
+		}
+
+		// lock open borders
+		for (const auto &edge : edgeCount) {
+			if (edge.second != 1)
+				continue;
+			m_locked[edge.first >> 32] = true;
+			m_locked[edge.first & 0xFFFFFFFF] = true;
+		}
+
+		// lock seams, where several vertices share a position
+		std::vector<uint32_t> byPos(numVerts);
+		for (uint32_t v = 0; v < numVerts; v++)
+			byPos[v] = v;
+		std::sort(byPos.begin(), byPos.end(), [&positions](uint32_t a, uint32_t b) {
+			const vector3f &pa = positions[a], &pb = positions[b];
+			return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z);
+		});
+		for (uint32_t i = 1; i < numVerts; i++) {
+			if (positions[byPos[i]] == positions[byPos[i - 1]]) {
+				m_locked[byPos[i]] = true;
+				m_locked[byPos[i - 1]] = true;
+			}
+		}
+	}
+
+	void Simplifier::GatherNeighbours(uint32_t v, std::vector<uint32_t> &out) const
+	{
+		out.clear();
+		for (uint32_t t : m_vertTris[v]) {
+			if (!m_triAlive[t])
+				continue;
+			for (int i = 0; i < 3; i++) {
+				const uint32_t n = m_tris[t * 3 + i];
+				if (n != v)
+					out.push_back(n);
+			}
+		}
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+	}
+
+	bool Simplifier::IsValidCollapse(uint32_t from, uint32_t to)
+	{
+		// the vertices of the edge must share no neighbours other than the
+		// far corners of the triangles on it, or the result isn't manifold
+		GatherNeighbours(from, m_scratchA);
+		GatherNeighbours(to, m_scratchB);
+
+		uint32_t numShared = 0;
+		for (uint32_t t : m_vertTris[from])
+			numShared += m_triAlive[t] && TriHas(t, to);
+
+		uint32_t numCommon = 0;
+		auto b = m_scratchB.begin();
+		for (uint32_t n : m_scratchA) {
+			b = std::lower_bound(b, m_scratchB.end(), n);
+			numCommon += b != m_scratchB.end() && *b == n;
+		}
+
+		if (numShared == 0 || numCommon != numShared)
+			return false;
+
+		// no remaining triangle may flip over, turn too far (which folds
+		// the surface over a few collapses) or become degenerate
+		for (uint32_t t : m_vertTris[from]) {
+			if (!m_triAlive[t] || TriHas(t, to))
+				continue;
+
+			vector3d before[3], after[3];
+			for (int i = 0; i < 3; i++) {
+				const uint32_t v = m_tris[t * 3 + i];
+				before[i] = m_pos[v];
+				after[i] = m_pos[v == from ? to : v];
+			}
+
+			const vector3d nb = (before[1] - before[0]).Cross(before[2] - before[0]);
+			const vector3d na = (after[1] - after[0]).Cross(after[2] - after[0]);
+			const double lenA = na.Length(), lenB = nb.Length();
+			if (na.Dot(nb) <= MIN_NORMAL_COS * lenA * lenB || lenA < 1e-3 * lenB)
+				return false;
+		}
+
+		return true;
+	}
+
+	void Simplifier::UpdateCandidate(uint32_t v)
+	{
+		m_version[v]++;
+		if (m_locked[v])
+			return;
+
+		std::vector<uint32_t> neighbours;
+		GatherNeighbours(v, neighbours);
+
+		Collapse best = { INFINITY, v, v, m_version[v] };
+		for (uint32_t n : neighbours) {
+			const double cost = (m_quadrics[v] + m_quadrics[n]).Eval(m_pos[n]);
+			if (cost < best.cost && IsValidCollapse(v, n)) {
+				best.cost = cost;
+				best.to = n;
+			}
+		}
+
+		if (best.to != v)
+			m_heap.push(best);
+	}
+
+	void Simplifier::DoCollapse(uint32_t from, uint32_t to)
+	{
+		for (uint32_t t : m_vertTris[from]) {
+			if (!m_triAlive[t])
+				continue;
+
+			if (TriHas(t, to)) {
+				m_triAlive[t] = false;
+				m_numAliveTris--;
+				continue;
+			}
+
+			for (int i = 0; i < 3; i++) {
+				if (m_tris[t * 3 + i] == from)
+					m_tris[t * 3 + i] = to;
+			}
+			m_vertTris[to].push_back(t);
+		}
+
+		m_vertTris[from].clear();
+		m_quadrics[to] += m_quadrics[from];
+		// the vertex is gone; keep it out of the heap
+		m_locked[from] = true;
+		m_version[from]++;
+	}
+
+	float Simplifier::Run(uint32_t targetIndices, float maxError, std::vector<uint32_t> &indicesOut)
+	{
+		for (uint32_t v = 0; v < m_pos.size(); v++)
+			UpdateCandidate(v);
+
+		const double maxCost = double(maxError) * double(maxError);
+		double resultCost = 0.0;
+		std::vector<uint32_t> neighbours;
+
+		while (m_numAliveTris * 3 > targetIndices && !m_heap.empty()) {
+			const Collapse c = m_heap.top();
+			m_heap.pop();
+
+			if (c.version != m_version[c.from])
+				continue; // stale
+			if (c.cost > maxCost)
+				break;
+
+			// neighbourhoods may have changed since this was queued
+			if (!IsValidCollapse(c.from, c.to)) {
+				UpdateCandidate(c.from);
+				continue;
+			}
+
+			GatherNeighbours(c.from, neighbours);
+			DoCollapse(c.from, c.to);
+			resultCost = std::max(resultCost, c.cost);
+
+			UpdateCandidate(c.to);
+			for (uint32_t n : neighbours)
+				if (n != c.to)
+					UpdateCandidate(n);
+		}
+
+		indicesOut.clear();
+		indicesOut.reserve(m_numAliveTris * 3);
+		for (uint32_t t = 0; t < m_triAlive.size(); t++) {
+			if (m_triAlive[t])
+				indicesOut.insert(indicesOut.end(), &m_tris[t * 3], &m_tris[t * 3] + 3);
+		}
+
+		return float(std::sqrt(resultCost));
+	}
+
+} // namespace
+
+namespace SceneGraph {
+
+	float SimplifyMesh(const std::vector<vector3f> &positions, const std::vector<uint32_t> &indices,
+		uint32_t targetIndices, float maxError, std::vector<uint32_t> &indicesOut)
+	{
+		PROFILE_SCOPED()
+		Simplifier simplifier(positions, indices);
+		return simplifier.Run(targetIndices, maxError, indicesOut);
+	}
+
+} // namespace SceneGraph
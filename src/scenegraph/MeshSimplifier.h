@@ -0,0 +1,32 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#pragma once
+
+#include "vector3.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace SceneGraph {
+
+	/*
+	 * Reduces an indexed triangle list by repeatedly collapsing the edge
+	 * whose removal moves the surface the least, as measured by the
+	 * quadric error metric (Garland & Heckbert, 1997).
+	 *
+	 * Collapses always move a vertex onto one of its neighbours, so the
+	 * output only refers to input vertices and their attributes are kept.
+	 * Vertices on open borders, and vertices sharing their position with
+	 * another one (normal or UV seams), are never moved so that the mesh
+	 * doesn't tear.
+	 *
+	 * Collapsing stops once at most targetIndices remain, or when the next
+	 * collapse would exceed maxError. Returns the error of the result: a
+	 * conservative estimate of how far, in model units, the simplified
+	 * surface lies from the original one.
+	 */
+	float SimplifyMesh(const std::vector<vector3f> &positions, const std::vector<uint32_t> &indices,
+		uint32_t targetIndices, float maxError, std::vector<uint32_t> &indicesOut);
+
+} // namespace SceneGraph
@@ -53,6 +53,7 @@ namespace SceneGraph {
 		m_renderer(r),
 		m_name(name),
 		m_activeAnimations(0),
+		m_settlingAnimations(0),
 		m_curPatternIndex(0),
 		m_curPattern(0),
 		m_debugFlags(0)
@@ -71,6 +72,7 @@ namespace SceneGraph {
 		m_renderer(model.m_renderer),
 		m_name(model.m_name),
 		m_activeAnimations(0),
+		m_settlingAnimations(0),
 		m_curPatternIndex(model.m_curPatternIndex),
 		m_curPattern(model.m_curPattern),
 		m_debugFlags(0)
@@ -102,6 +104,9 @@ namespace SceneGraph {
 			m_animations.back()->UpdateChannelTargets(m_root.Get());
 		}
 
+		//the transforms the template's animations moved are copied marked as animated
+		m_settlingAnimations = AllAnimationsMask();
+
 		//m_tags needs to be updated
 		for (const Tag *tag : model.m_tags) {
 			Node *node = m_root->FindNode(tag->GetName());
@@ -380,21 +385,68 @@ namespace SceneGraph {
 	{
 		for (AnimationContainer::iterator anim = m_animations.begin(); anim != m_animations.end(); ++anim)
 			(*anim)->Interpolate();
+
+		// the nodes of animations that won't be ticked can be drawn flattened
+		m_settlingAnimations |= AllAnimationsMask() & ~m_activeAnimations;
+	}
+
+	uint64_t Model::AllAnimationsMask() const
+	{
+		return m_animations.size() >= 64 ? ~uint64_t(0) : (uint64_t(1) << m_animations.size()) - 1;
 	}
 
 	void Model::UpdateAnimations()
 	{
+		PROFILE_SCOPED()
+		// active animations which haven't moved (gear that is fully down,
+		// closed doors) leave their transforms as they are
+		bool interpolated = false;
 		for (size_t i = 0; i < m_animations.size(); i++) {
-			if (m_activeAnimations & (1 << i))
+			if ((m_activeAnimations & (1 << i)) && m_animations[i]->IsDirty()) {
 				m_animations[i]->Interpolate();
+				interpolated = true;
+			}
 		}
 
-		// Assume if we're ticking an active animation, our tags most likely need to be updated.
+		// Assume if we've moved an animation, our tags most likely need to be updated.
 		// This can be optimized slightly by walking the node hierarchy and looking for a "dirty"
 		// flag to determine if the tag needs to be updated, but at current it's not a significant
 		// performance issue compared to animation interpolation.
-		if (m_activeAnimations)
+		if (interpolated)
 			UpdateTagTransforms();
+
+		if (m_settlingAnimations)
+			SettleAnimations();
+	}
+
+	void Model::SettleAnimations()
+	{
+		for (size_t i = 0; i < m_animations.size(); i++) {
+			if (!(m_settlingAnimations & (1 << i)))
+				continue;
+
+			// wait for the last interpolation after the animation was stopped
+			if (m_activeAnimations & (1 << i)) {
+				m_settlingAnimations &= ~(1 << i);
+				continue;
+			}
+			if (m_animations[i]->IsDirty())
+				continue;
+
+			for (const AnimationChannel &chan : m_animations[i]->GetChannels()) {
+				// still moved by another animation?
+				bool moving = false;
+				for (size_t j = 0; j < m_animations.size() && !moving; j++) {
+					if (!(m_activeAnimations & (1 << j)))
+						continue;
+					for (const AnimationChannel &other : m_animations[j]->GetChannels())
+						moving |= other.node == chan.node;
+				}
+				if (!moving)
+					chan.node->SetAnimated(false);
+			}
+			m_settlingAnimations &= ~(1 << i);
+		}
 	}
 
 	uint32_t Model::FindAnimationIndex(Animation *anim) const
@@ -409,10 +461,12 @@ namespace SceneGraph {
 	void Model::SetAnimationActive(uint32_t index, bool active)
 	{
 		if (index >= m_animations.size()) return;
-		if (active)
+		if (active) {
 			m_activeAnimations |= (1 << index);
-		else
+		} else {
 			m_activeAnimations &= ~(1 << index);
+			m_settlingAnimations |= (1 << index);
+		}
 	}
 
 	bool Model::GetAnimationActive(uint32_t index) const
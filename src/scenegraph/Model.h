@@ -166,7 +166,8 @@ namespace SceneGraph {
 		// Mark an animation as actively updating. A maximum of 64 active animations are supported.
 		void SetAnimationActive(uint32_t index, bool active);
 		bool GetAnimationActive(uint32_t index) const;
-		// Update all active animations.
+		// Update all active animations, and let the parts stopped ones moved
+		// be drawn as static geometry again.
 		void UpdateAnimations();
 
 		Graphics::Renderer *GetRenderer() const { return m_renderer; }
@@ -201,6 +202,9 @@ namespace SceneGraph {
 	private:
 		Model(const Model &);
 
+		void SettleAnimations();
+		uint64_t AllAnimationsMask() const;
+
 		static const unsigned int MAX_DECAL_MATERIALS = 4;
 		ColorMap m_colorMap;
 		float m_boundingRadius;
@@ -214,6 +218,7 @@ namespace SceneGraph {
 
 		AnimationContainer m_animations;
 		uint64_t m_activeAnimations; // bitmask of actively ticking animations
+		uint64_t m_settlingAnimations; // bitmask of stopped animations whose nodes may still be marked animated
 
 		std::vector<Tag *> m_tags;		 //named attachment points
 
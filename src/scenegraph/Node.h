@@ -6,6 +6,7 @@
 /*
  * Generic node for the model scenegraph
  */
+#include "ByteRange.h"
 #include "RefCounted.h"
 #include "graphics/Material.h"
 
@@ -70,6 +71,10 @@ namespace SceneGraph {
 		Model *model;
 		std::vector<std::pair<std::string, RefCountedPtr<Graphics::Material>>> *materials;
 		BaseLoader *loader;
+		//raw vertex and index data is kept apart from the serialized
+		//nodes, so that it can be uploaded straight from the file
+		std::string *bufferWr = nullptr; //when saving
+		ByteRange bufferRd; //when loading
 	};
 
 	class Node : public RefCounted {
@@ -15,6 +15,8 @@
 #include "scenegraph/BinaryConverter.h"
 #include "utils.h"
 
+#include <cstring>
+
 namespace SceneGraph {
 
 	StaticGeometry::StaticGeometry(Graphics::Renderer *r) :
@@ -48,8 +50,9 @@ namespace SceneGraph {
 		PROFILE_SCOPED()
 		Graphics::Renderer *r = GetRenderer();
 		r->SetTransform(trans);
+		// repeats of this geometry may be merged into instanced draws
 		for (auto &it : m_meshes)
-			r->DrawMesh(it.meshObject.Get(), it.material.Get());
+			r->DrawMeshBatched(it.meshObject.Get(), it.material.Get());
 
 		//DrawBoundingBox(m_boundingBox);
 	}
@@ -105,6 +108,22 @@ namespace SceneGraph {
 	}
 
 	typedef std::vector<std::pair<std::string, RefCountedPtr<Graphics::Material>>> MaterialContainer;
+
+	//appends to the buffer data of the file, returning the offset written at
+	static Uint32 WriteBufferData(std::string &bufferData, const void *data, size_t size)
+	{
+		bufferData.resize((bufferData.size() + SGM_BUFFER_ALIGNMENT - 1) & ~size_t(SGM_BUFFER_ALIGNMENT - 1), '\0');
+		const Uint32 offset = bufferData.size();
+		bufferData.append(static_cast<const char *>(data), size);
+		return offset;
+	}
+
+	static const char *ReadBufferData(const ByteRange &bufferData, Uint32 offset, size_t size)
+	{
+		if (offset > bufferData.Size() || size > bufferData.Size() - offset)
+			throw LoadingError("Buffer data out of range");
+		return bufferData.begin + offset;
+	}
 	void StaticGeometry::Save(NodeDatabase &db)
 	{
 		PROFILE_SCOPED()
@@ -131,38 +150,36 @@ namespace SceneGraph {
 
 			const bool hasTangents = (attribCombo & Graphics::ATTRIB_TANGENT);
 
-			//save positions, normals and uvs interleaved (only known format now)
+			//vertices are stored in the layout Load creates the buffer with,
+			//whatever the layout of this buffer
+			const Graphics::VertexBufferDesc fileDesc = Graphics::VertexBufferDesc::FromAttribSet(attribCombo);
 			const Uint32 posOffset = vbDesc.GetOffset(Graphics::ATTRIB_POSITION);
 			const Uint32 nrmOffset = vbDesc.GetOffset(Graphics::ATTRIB_NORMAL);
 			const Uint32 uv0Offset = vbDesc.GetOffset(Graphics::ATTRIB_UV0);
 			const Uint32 tanOffset = hasTangents ? vbDesc.GetOffset(Graphics::ATTRIB_TANGENT) : 0;
 			const Uint32 stride = vbDesc.stride;
-			db.wr->Int32(vbDesc.numVertices);
-			Uint8 *vtxPtr = mesh.vertexBuffer->Map<Uint8>(Graphics::BUFFER_MAP_READ);
-			if (hasTangents) {
-				for (Uint32 i = 0; i < vbDesc.numVertices; i++) {
-					db.wr->Vector3f(*reinterpret_cast<vector3f *>(vtxPtr + i * stride + posOffset));
-					db.wr->Vector3f(*reinterpret_cast<vector3f *>(vtxPtr + i * stride + nrmOffset));
-					db.wr->Float(reinterpret_cast<vector2f *>(vtxPtr + i * stride + uv0Offset)->x);
-					db.wr->Float(reinterpret_cast<vector2f *>(vtxPtr + i * stride + uv0Offset)->y);
-					db.wr->Vector3f(*reinterpret_cast<vector3f *>(vtxPtr + i * stride + tanOffset));
-				}
-			} else {
-				for (Uint32 i = 0; i < vbDesc.numVertices; i++) {
-					db.wr->Vector3f(*reinterpret_cast<vector3f *>(vtxPtr + i * stride + posOffset));
-					db.wr->Vector3f(*reinterpret_cast<vector3f *>(vtxPtr + i * stride + nrmOffset));
-					db.wr->Float(reinterpret_cast<vector2f *>(vtxPtr + i * stride + uv0Offset)->x);
-					db.wr->Float(reinterpret_cast<vector2f *>(vtxPtr + i * stride + uv0Offset)->y);
-				}
+
+			std::vector<Uint8> vertices(vbDesc.numVertices * fileDesc.stride);
+			const Uint8 *vtxPtr = mesh.vertexBuffer->Map<Uint8>(Graphics::BUFFER_MAP_READ);
+			for (Uint32 i = 0; i < vbDesc.numVertices; i++) {
+				Uint8 *out = &vertices[i * fileDesc.stride];
+				memcpy(out + fileDesc.GetOffset(Graphics::ATTRIB_POSITION), vtxPtr + i * stride + posOffset, sizeof(vector3f));
+				memcpy(out + fileDesc.GetOffset(Graphics::ATTRIB_NORMAL), vtxPtr + i * stride + nrmOffset, sizeof(vector3f));
+				memcpy(out + fileDesc.GetOffset(Graphics::ATTRIB_UV0), vtxPtr + i * stride + uv0Offset, sizeof(vector2f));
+				if (hasTangents)
+					memcpy(out + fileDesc.GetOffset(Graphics::ATTRIB_TANGENT), vtxPtr + i * stride + tanOffset, sizeof(vector3f));
 			}
 			mesh.vertexBuffer->Unmap();
 
+			db.wr->Int32(vbDesc.numVertices);
+			db.wr->Int32(fileDesc.stride);
+			db.wr->Int32(WriteBufferData(*db.bufferWr, vertices.data(), vertices.size()));
+
 			//indices
 			const Uint32 *indexPtr = mesh.indexBuffer->Map(Graphics::BUFFER_MAP_READ);
 			const Uint32 numIndices = mesh.indexBuffer->GetSize();
 			db.wr->Int32(numIndices);
-			for (Uint32 i = 0; i < numIndices; i++)
-				db.wr->Int32(indexPtr[i]);
+			db.wr->Int32(WriteBufferData(*db.bufferWr, indexPtr, numIndices * sizeof(Uint32)));
 			mesh.indexBuffer->Unmap();
 		}
 	}
@@ -196,58 +213,24 @@ namespace SceneGraph {
 				throw LoadingError("Unsupported vertex format");
 			}
 
-			const bool hasTangents = (vtxFormat & Graphics::ATTRIB_TANGENT);
-
-			//vertex buffer
-			// XXX evaluate whether we can use VertexBufferDesc::FromAttribSet here
-			Graphics::VertexBufferDesc vbDesc;
-			vbDesc.attrib[0].semantic = Graphics::ATTRIB_POSITION;
-			vbDesc.attrib[0].format = Graphics::ATTRIB_FORMAT_FLOAT3;
-			vbDesc.attrib[1].semantic = Graphics::ATTRIB_NORMAL;
-			vbDesc.attrib[1].format = Graphics::ATTRIB_FORMAT_FLOAT3;
-			vbDesc.attrib[2].semantic = Graphics::ATTRIB_UV0;
-			vbDesc.attrib[2].format = Graphics::ATTRIB_FORMAT_FLOAT2;
-			if (hasTangents) {
-				vbDesc.attrib[3].semantic = Graphics::ATTRIB_TANGENT;
-				vbDesc.attrib[3].format = Graphics::ATTRIB_FORMAT_FLOAT3;
-			}
+			//vertex buffer, filled straight from the file
+			Graphics::VertexBufferDesc vbDesc = Graphics::VertexBufferDesc::FromAttribSet(vtxFormat);
 			vbDesc.usage = Graphics::BUFFER_USAGE_STATIC;
 			vbDesc.numVertices = db.rd->Int32();
+			if (Uint32(db.rd->Int32()) != vbDesc.stride)
+				throw LoadingError("Unexpected vertex layout");
 
+			const size_t vtxSize = vbDesc.numVertices * vbDesc.stride;
+			const char *vtxData = ReadBufferData(db.bufferRd, db.rd->Int32(), vtxSize);
 			RefCountedPtr<Graphics::VertexBuffer> vtxBuffer(db.loader->GetRenderer()->CreateVertexBuffer(vbDesc));
-			const Uint32 posOffset = vtxBuffer->GetDesc().GetOffset(Graphics::ATTRIB_POSITION);
-			const Uint32 nrmOffset = vtxBuffer->GetDesc().GetOffset(Graphics::ATTRIB_NORMAL);
-			const Uint32 uv0Offset = vtxBuffer->GetDesc().GetOffset(Graphics::ATTRIB_UV0);
-			const Uint32 tanOffset = hasTangents ? vtxBuffer->GetDesc().GetOffset(Graphics::ATTRIB_TANGENT) : 0;
-			const Uint32 stride = vtxBuffer->GetDesc().stride;
-			Uint8 *vtxPtr = vtxBuffer->Map<Uint8>(BUFFER_MAP_WRITE);
-			if (hasTangents) {
-				for (Uint32 i = 0; i < vbDesc.numVertices; i++) {
-					*reinterpret_cast<vector3f *>(vtxPtr + i * stride + posOffset) = db.rd->Vector3f();
-					*reinterpret_cast<vector3f *>(vtxPtr + i * stride + nrmOffset) = db.rd->Vector3f();
-					const float uvx = db.rd->Float();
-					const float uvy = db.rd->Float();
-					*reinterpret_cast<vector2f *>(vtxPtr + i * stride + uv0Offset) = vector2f(uvx, uvy);
-					*reinterpret_cast<vector3f *>(vtxPtr + i * stride + tanOffset) = db.rd->Vector3f();
-				}
-			} else {
-				for (Uint32 i = 0; i < vbDesc.numVertices; i++) {
-					*reinterpret_cast<vector3f *>(vtxPtr + i * stride + posOffset) = db.rd->Vector3f();
-					*reinterpret_cast<vector3f *>(vtxPtr + i * stride + nrmOffset) = db.rd->Vector3f();
-					const float uvx = db.rd->Float();
-					const float uvy = db.rd->Float();
-					*reinterpret_cast<vector2f *>(vtxPtr + i * stride + uv0Offset) = vector2f(uvx, uvy);
-				}
-			}
-			vtxBuffer->Unmap();
+			vtxBuffer->BufferData(vtxSize, (void *)vtxData);
 
 			//index buffer
 			const Uint32 numIndices = db.rd->Int32();
+			const size_t idxSize = numIndices * sizeof(Uint32);
+			const char *idxData = ReadBufferData(db.bufferRd, db.rd->Int32(), idxSize);
 			RefCountedPtr<Graphics::IndexBuffer> idxBuffer(db.loader->GetRenderer()->CreateIndexBuffer(numIndices, Graphics::BUFFER_USAGE_STATIC));
-			Uint32 *idxPtr = idxBuffer->Map(BUFFER_MAP_WRITE);
-			for (Uint32 i = 0; i < numIndices; i++)
-				idxPtr[i] = db.rd->Int32();
-			idxBuffer->Unmap();
+			idxBuffer->BufferData(idxSize, (void *)idxData);
 
 			sg->AddMesh(vtxBuffer, idxBuffer, material);
 		}
@@ -4,12 +4,14 @@
 #include "Thruster.h"
 #include "BaseLoader.h"
 #include "Easing.h"
+#include "EffectBatch.h"
 #include "MathUtil.h"
 #include "NodeVisitor.h"
 #include "Serializer.h"
 #include "graphics/Material.h"
 #include "graphics/RenderState.h"
 #include "graphics/Renderer.h"
+#include "graphics/Stats.h"
 #include "graphics/TextureBuilder.h"
 #include "graphics/VertexArray.h"
 #include "graphics/VertexBuffer.h"
@@ -19,6 +21,10 @@ namespace SceneGraph {
 
 	RefCountedPtr<Graphics::MeshObject> Thruster::s_thrustMesh;
 	RefCountedPtr<Graphics::MeshObject> Thruster::s_glowMesh;
+	std::unique_ptr<Graphics::VertexArray> Thruster::s_thrustVerts;
+	std::unique_ptr<Graphics::VertexArray> Thruster::s_glowVerts;
+	RefCountedPtr<Graphics::Material> Thruster::s_batchThrustMat;
+	RefCountedPtr<Graphics::Material> Thruster::s_batchGlowMat;
 
 	static const std::string thrusterTextureFilename("textures/thruster.dds");
 	static const std::string thrusterGlowTextureFilename("textures/halo.dds");
@@ -101,19 +107,29 @@ namespace SceneGraph {
 		}
 		if (power < 0.001f) return;
 
-		m_tMat->diffuse = m_glowMat->diffuse = currentColor * power;
+		Color thrustColor = currentColor * power;
+		Color glowColor = thrustColor;
 
 		//directional fade
 		vector3f cdir = vector3f(trans * -dir).Normalized();
 		vector3f vdir = vector3f(trans[2], trans[6], -trans[10]).Normalized();
 		// XXX check this for transition to new colors.
-		m_glowMat->diffuse.a = Easing::Circ::EaseIn(Clamp(vdir.Dot(cdir), 0.f, 1.f), 0.f, 1.f, 1.f) * 255;
-		m_tMat->diffuse.a = 255 - m_glowMat->diffuse.a;
+		glowColor.a = Easing::Circ::EaseIn(Clamp(vdir.Dot(cdir), 0.f, 1.f), 0.f, 1.f, 1.f) * 255;
+		thrustColor.a = 255 - glowColor.a;
 
 		Graphics::Renderer *r = GetRenderer();
 		if (!s_thrustMesh.Valid())
 			CreateThrusterGeometry(r);
 
+		r->GetStats().AddToStatCount(Graphics::Stats::STAT_THRUSTERS, 1);
+		if (EffectBatch::IsCollecting()) {
+			EffectBatch::AddMesh(s_batchThrustMat.Get(), *s_thrustVerts, trans, thrustColor);
+			EffectBatch::AddMesh(s_batchGlowMat.Get(), *s_glowVerts, trans, glowColor);
+			return;
+		}
+
+		m_tMat->diffuse = thrustColor;
+		m_glowMat->diffuse = glowColor;
 		r->SetTransform(trans);
 		r->DrawMesh(s_thrustMesh.Get(), m_tMat.Get());
 		r->DrawMesh(s_glowMesh.Get(), m_glowMat.Get());
@@ -178,6 +194,7 @@ namespace SceneGraph {
 
 		//create buffer and upload data
 		s_thrustMesh.Reset(r->CreateMeshObjectFromArray(&verts));
+		s_thrustVerts.reset(new Graphics::VertexArray(verts));
 
 		verts.Clear();
 		{
@@ -211,6 +228,25 @@ namespace SceneGraph {
 
 		//create buffer and upload data
 		s_glowMesh.Reset(r->CreateMeshObjectFromArray(&verts));
+		s_glowVerts.reset(new Graphics::VertexArray(verts));
+
+		// batched thrusters carry their colour in the vertices
+		Graphics::MaterialDescriptor desc;
+		desc.textures = 1;
+		desc.vertexColors = true;
+
+		Graphics::RenderStateDesc rsd;
+		rsd.blendMode = Graphics::BLEND_ALPHA_ONE;
+		rsd.depthWrite = false;
+		rsd.cullMode = Graphics::CULL_NONE;
+
+		s_batchThrustMat.Reset(r->CreateMaterial("unlit", desc, rsd));
+		s_batchThrustMat->SetTexture("texture0"_hash,
+			Graphics::TextureBuilder::Billboard(thrusterTextureFilename).GetOrCreateTexture(r, "billboard"));
+
+		s_batchGlowMat.Reset(r->CreateMaterial("unlit", desc, rsd));
+		s_batchGlowMat->SetTexture("texture0"_hash,
+			Graphics::TextureBuilder::Billboard(thrusterGlowTextureFilename).GetOrCreateTexture(r, "billboard"));
 	}
 
 } // namespace SceneGraph
@@ -9,11 +9,14 @@
 
 #include "Node.h"
 
+#include <memory>
+
 namespace Graphics {
 	class Renderer;
 	class Material;
 	class MeshObject;
 	class RenderState;
+	class VertexArray;
 } // namespace Graphics
 
 namespace SceneGraph {
@@ -37,6 +40,11 @@ namespace SceneGraph {
 		static void CreateThrusterGeometry(Graphics::Renderer *);
 		static RefCountedPtr<Graphics::MeshObject> s_thrustMesh;
 		static RefCountedPtr<Graphics::MeshObject> s_glowMesh;
+		// the same geometry, for appending to an EffectBatch
+		static std::unique_ptr<Graphics::VertexArray> s_thrustVerts;
+		static std::unique_ptr<Graphics::VertexArray> s_glowVerts;
+		static RefCountedPtr<Graphics::Material> s_batchThrustMat;
+		static RefCountedPtr<Graphics::Material> s_batchGlowMat;
 
 		RefCountedPtr<Graphics::Material> m_tMat;
 		RefCountedPtr<Graphics::Material> m_glowMat;
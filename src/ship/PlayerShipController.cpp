@@ -509,7 +509,7 @@ void PlayerShipController::StaticUpdate(const float timeStep)
 
 	int mouseMotion[2];
 	// have to use this function. SDL mouse position event is bugged in windows
-	SDL_GetRelativeMouseState(mouseMotion + 0, mouseMotion + 1); // call to flush
+	Pi::input->GetRelativeMouseState(mouseMotion + 0, mouseMotion + 1); // call to flush
 
 	UpdateLandingGear();
 
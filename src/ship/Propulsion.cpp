@@ -64,6 +64,7 @@ Propulsion::Propulsion()
 	m_angThrusters = vector3d(0, 0, 0);
 	m_smodel = nullptr;
 	m_dBody = nullptr;
+	InvalidateThrust();
 }
 
 void Propulsion::Init(DynamicBody *b, SceneGraph::Model *m, const int tank_mass, const double effExVel, const float lin_Thrust[], const float ang_Thrust)
@@ -77,6 +78,7 @@ void Propulsion::Init(DynamicBody *b, SceneGraph::Model *m, const int tank_mass,
 	m_angThrust = ang_Thrust;
 	m_smodel = m;
 	m_dBody = b;
+	InvalidateThrust();
 }
 
 void Propulsion::Init(DynamicBody *b, SceneGraph::Model *m, const int tank_mass, const double effExVel, const float lin_Thrust[], const float ang_Thrust, const float lin_AccelerationCap[])
@@ -84,6 +86,7 @@ void Propulsion::Init(DynamicBody *b, SceneGraph::Model *m, const int tank_mass,
 	Init(b, m, tank_mass, effExVel, lin_Thrust, ang_Thrust);
 	for (int i = 0; i < Thruster::THRUSTER_MAX; i++)
 		m_linAccelerationCap[i] = lin_AccelerationCap[i];
+	InvalidateThrust();
 }
 
 void Propulsion::SetThrustPowerMult(double p, const float lin_Thrust[], const float ang_Thrust)
@@ -92,12 +95,14 @@ void Propulsion::SetThrustPowerMult(double p, const float lin_Thrust[], const fl
 	for (int i = 0; i < Thruster::THRUSTER_MAX; i++)
 		m_linThrust[i] = lin_Thrust[i] * p;
 	m_angThrust = ang_Thrust * p;
+	InvalidateThrust();
 }
 
 void Propulsion::SetAccelerationCapMult(double p, const float lin_AccelerationCap[])
 {
 	for (int i = 0; i < Thruster::THRUSTER_MAX; i++)
 		m_linAccelerationCap[i] = lin_AccelerationCap[i] * p;
+	InvalidateThrust();
 }
 
 void Propulsion::SetAngThrusterState(const vector3d &levels)
@@ -163,13 +168,23 @@ void Propulsion::SetLinThrusterState(const vector3d &levels)
 }
 
 double Propulsion::GetThrust(Thruster thruster) const
+{
+	// the AI asks for these many times a step, but mass only changes once
+	// a step (with fuel use), so all six are worked out together
+	const double mass = m_dBody->GetMass();
+	if (mass != m_cappedThrustMass)
+		UpdateCappedThrust(mass);
+	return m_cappedThrust[thruster];
+}
+
+void Propulsion::UpdateCappedThrust(double mass) const
 {
 	// acceleration = thrust / mass
 	// thrust = acceleration * mass
-	const float mass = static_cast<float>(m_dBody->GetMass());
-	return std::min(
-		m_linThrust[thruster],
-		m_linAccelerationCap[thruster] * mass);
+	const float fmass = static_cast<float>(mass);
+	for (int i = 0; i < Thruster::THRUSTER_MAX; i++)
+		m_cappedThrust[i] = std::min(m_linThrust[i], m_linAccelerationCap[i] * fmass);
+	m_cappedThrustMass = mass;
 }
 
 vector3d Propulsion::GetThrust(const vector3d &dir) const
@@ -123,6 +123,9 @@ public:
 	vector3d AIGetLeadDir(const Body *target, const vector3d &targaccel, double projspeed);
 
 private:
+	void UpdateCappedThrust(double mass) const;
+	void InvalidateThrust() { m_cappedThrustMass = -1.0; }
+
 	// Thrust and thrusters
 	float m_linThrust[THRUSTER_MAX];
 	float m_angThrust;
@@ -130,6 +133,9 @@ private:
 	vector3d m_angThrusters; // 0.0-1.0
 	// Used to calculate max linear thrust by limiting the thruster levels
 	float m_linAccelerationCap[THRUSTER_MAX];
+	// GetThrust() for each thruster at m_cappedThrustMass
+	mutable float m_cappedThrust[THRUSTER_MAX];
+	mutable double m_cappedThrustMass;
 
 	// Fuel
 	int m_fuelTankMass;
@@ -269,6 +269,9 @@ void ShipViewController::Update()
 		cam->Reset();
 	cam->ZoomEventUpdate(frameTime);
 
+	// this is as late as input can be read before the camera is drawn
+	Pi::input->LatchMouseMotion();
+
 	int mouseMotion[2];
 	Pi::input->GetMouseMotion(mouseMotion);
 
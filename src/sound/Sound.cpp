@@ -11,25 +11,39 @@
 #include "JobQueue.h"
 #include "Pi.h"
 #include "Player.h"
+#include "RefCounted.h"
 #include "utils.h"
 
 #include "SDL_audio.h"
 #include "SDL_events.h"
+#include "atomic_queue/atomic_queue.h"
 #include <SDL.h>
 #include <vorbis/vorbisfile.h>
 
+#include <atomic>
 #include <cassert>
 #include <cerrno>
+#include <cfloat>
 #include <cstdio>
+#include <memory>
 #include <string>
 #include <vector>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOUND_SIMD_SSE2
+#endif
+
 namespace Sound {
 
 	static const unsigned int FREQ = 44100;
 	static const unsigned int BUF_SIZE = 4096;
 	static const unsigned int MAX_WAVSTREAMS = 10; //first two are for music
 	static const double STREAM_IF_LONGER_THAN = 10.0;
+	static const unsigned int MIX_BLOCK_FRAMES = 1024; // input frames mixed at a time
+	static const unsigned int COMMAND_QUEUE_SIZE = 1024;
+	static const unsigned int DECODE_RING_SIZE = 1 << 17; // Sint16 values, ~1.5s of stereo
+	static const unsigned int MAX_PREFETCHED = 4;
 
 	static SDL_AudioDeviceID m_audioDevice = 0;
 
@@ -126,6 +140,153 @@ namespace Sound {
 		&OggFileDataStream::ov_callback_tell
 	};
 
+	/*
+	 * Decodes a streamed sample ahead of the mixer. A job fills the ring
+	 * buffer on a worker thread, and the audio callback reads from it, so
+	 * the callback never waits on file access or Vorbis.
+	 *
+	 * The ring has a single writer (the decode job, of which there is at
+	 * most one at a time) and a single reader (the mixer).
+	 */
+	class StreamDecoder : public RefCounted {
+	public:
+		explicit StreamDecoder(const Sample *sample, bool repeat) :
+			m_sample(sample),
+			m_ring(new Sint16[DECODE_RING_SIZE]),
+			m_readPos(0),
+			m_writePos(0),
+			m_repeat(repeat),
+			m_endOfStream(false)
+		{}
+
+		~StreamDecoder()
+		{
+			if (m_open)
+				ov_clear(&m_oggv);
+		}
+
+		const Sample *GetSample() const { return m_sample; }
+
+		// Game thread
+		void SetRepeat(bool repeat) { m_repeat.store(repeat, std::memory_order_relaxed); }
+
+		bool NeedsData() const
+		{
+			if (m_endOfStream.load(std::memory_order_relaxed))
+				return false;
+			const Uint32 used = m_writePos.load(std::memory_order_relaxed) - m_readPos.load(std::memory_order_relaxed);
+			return used < DECODE_RING_SIZE / 2;
+		}
+
+		// Worker thread: decode until the ring is full or the stream ends
+		void Decode()
+		{
+			PROFILE_SCOPED()
+			if (!m_open && !Open()) {
+				m_endOfStream.store(true, std::memory_order_release);
+				return;
+			}
+
+			Uint32 writePos = m_writePos.load(std::memory_order_relaxed);
+			for (;;) {
+				const Uint32 used = writePos - m_readPos.load(std::memory_order_acquire);
+				const Uint32 offset = writePos % DECODE_RING_SIZE;
+				// decode straight into the ring, up to its end
+				const Uint32 space = std::min(DECODE_RING_SIZE - used, DECODE_RING_SIZE - offset);
+				if (space < m_sample->channels)
+					break;
+
+				int music_section;
+				const long amt = ov_read(&m_oggv, reinterpret_cast<char *>(m_ring.get() + offset),
+					space * sizeof(Sint16), 0, 2, 1, &music_section);
+				if (amt > 0) {
+					writePos += Uint32(amt) / sizeof(Sint16);
+					m_writePos.store(writePos, std::memory_order_release);
+				} else if (amt == 0 && m_repeat.load(std::memory_order_relaxed)) {
+					ov_pcm_seek(&m_oggv, 0);
+				} else if (amt == OV_HOLE) {
+					// a gap in the data, carry on after it
+					continue;
+				} else {
+					// end of the stream, or an error we can't recover from
+					m_endOfStream.store(true, std::memory_order_release);
+					break;
+				}
+			}
+		}
+
+		// Audio thread: copy up to count values out of the ring, returns the
+		// number copied
+		Uint32 Read(Sint16 *out, Uint32 count)
+		{
+			const Uint32 readPos = m_readPos.load(std::memory_order_relaxed);
+			count = std::min(count, m_writePos.load(std::memory_order_acquire) - readPos);
+
+			const Uint32 offset = readPos % DECODE_RING_SIZE;
+			const Uint32 first = std::min(count, DECODE_RING_SIZE - offset);
+			memcpy(out, m_ring.get() + offset, first * sizeof(Sint16));
+			memcpy(out + first, m_ring.get(), (count - first) * sizeof(Sint16));
+
+			m_readPos.store(readPos + count, std::memory_order_release);
+			return count;
+		}
+
+		// Audio thread: nothing more will be written to the ring. Check this
+		// before reading, so data written just before the end isn't missed.
+		bool IsEndOfStream() const { return m_endOfStream.load(std::memory_order_acquire); }
+
+		// game thread only: there's a decode job queued or running
+		bool m_decodePending = false;
+
+	private:
+		bool Open()
+		{
+			RefCountedPtr<FileSystem::FileData> oggdata = FileSystem::gameDataFiles.ReadFile(m_sample->path);
+			if (!oggdata) {
+				Output("Could not open '%s'", m_sample->path.c_str());
+				return false;
+			}
+			m_dataStream.Reset(oggdata);
+			oggdata.Reset();
+			if (ov_open_callbacks(&m_dataStream, &m_oggv, 0, 0, OggFileDataStream::CALLBACKS) < 0) {
+				Output("Vorbis could not understand '%s'", m_sample->path.c_str());
+				m_dataStream.Reset();
+				return false;
+			}
+			m_open = true;
+			return true;
+		}
+
+		const Sample *m_sample;
+		OggVorbis_File m_oggv;
+		OggFileDataStream m_dataStream;
+		bool m_open = false;
+
+		std::unique_ptr<Sint16[]> m_ring;
+		std::atomic<Uint32> m_readPos;
+		std::atomic<Uint32> m_writePos;
+		std::atomic<bool> m_repeat;
+		std::atomic<bool> m_endOfStream;
+	};
+
+	class DecodeJob : public Job {
+	public:
+		explicit DecodeJob(StreamDecoder *decoder) :
+			m_decoder(decoder)
+		{
+			m_decoder->m_decodePending = true;
+		}
+
+		virtual void OnRun() override { m_decoder->Decode(); }
+		virtual void OnFinish() override { m_decoder->m_decodePending = false; }
+		virtual void OnCancel() override { m_decoder->m_decodePending = false; }
+
+	private:
+		RefCountedPtr<StreamDecoder> m_decoder;
+	};
+
+	static std::unique_ptr<JobSet> s_decodeJobs;
+
 	static float m_masterVol = 1.0f;
 	static float m_sfxVol = 1.0f;
 
@@ -181,8 +342,7 @@ namespace Sound {
 
 	struct SoundEvent {
 		const Sample *sample;
-		OggVorbis_File *oggv; // if sample->buf = 0 then stream this
-		OggFileDataStream ogg_data_stream;
+		StreamDecoder *decoder; // if sample->buf = 0 then stream from this
 		Uint32 buf_pos;
 		float volume[2]; // left and right channels
 		eventid identifier;
@@ -194,8 +354,61 @@ namespace Sound {
 	};
 
 	static std::map<std::string, Sample> sfx_samples;
+
+	// Mixer state, only touched from the audio callback (or with the audio
+	// device locked, see SubmitCommand)
 	struct SoundEvent wavstream[MAX_WAVSTREAMS];
 
+	/*
+	 * The game thread doesn't touch the mixer state. It chooses a stream for
+	 * each event, remembers which event it gave each stream, and sends its
+	 * requests through a lock-free queue that the audio callback drains
+	 * before mixing. The callback publishes which event each stream is
+	 * playing, so the game thread can tell when one has finished.
+	 */
+	struct Command {
+		enum Type : Uint8 {
+			PLAY,
+			STOP,
+			STOP_ALL,
+			STOP_ALL_EXCEPT_MUSIC,
+			SET_OP,
+			SET_VOLUME,
+			ANIMATE_VOLUME
+		};
+
+		Type type;
+		Uint8 stream;
+		eventid id;
+		const Sample *sample;
+		StreamDecoder *decoder;
+		Op op;
+		float volume[2];
+		float rateOfChange[2];
+	};
+
+	// only the game thread pushes, only the mixer pops
+	static atomic_queue::AtomicQueue2<Command, COMMAND_QUEUE_SIZE, true, true, false, true> s_commands;
+
+	// published by the mixer: the event each stream is playing (0 if none),
+	// how far into its sample it is, and the newest event it has started
+	static std::atomic<eventid> s_streamEvent[MAX_WAVSTREAMS];
+	static std::atomic<Uint32> s_streamPos[MAX_WAVSTREAMS];
+	static std::atomic<eventid> s_startedEvent;
+
+	// game thread only: the event last given to each stream
+	static eventid s_streamOwner[MAX_WAVSTREAMS];
+
+	// game thread only: decoders handed to the mixer, kept alive until it's
+	// done with them, and decoders warmed up before their sample is played
+	struct ActiveDecoder {
+		unsigned int stream;
+		eventid id;
+		RefCountedPtr<StreamDecoder> decoder;
+	};
+	static std::vector<ActiveDecoder> s_activeDecoders;
+	static std::vector<RefCountedPtr<StreamDecoder>> s_prefetchedDecoders;
+
 	static Sample *GetSample(const char *filename)
 	{
 		if (sfx_samples.find(filename) != sfx_samples.end()) {
@@ -206,78 +419,270 @@ namespace Sound {
 		}
 	}
 
-	static SoundEvent *GetEvent(eventid id)
+	static void DestroyEvent(SoundEvent *ev)
+	{
+		// the game thread frees the decoder once it sees the event has ended
+		ev->decoder = nullptr;
+		ev->sample = nullptr;
+	}
+
+	// Apply the game thread's requests to the mixer state.
+	// Runs in the audio callback, or with the audio device locked.
+	static void ProcessCommands()
+	{
+		Command cmd;
+		while (s_commands.try_pop(cmd)) {
+			SoundEvent &ev = wavstream[cmd.stream];
+			// requests for an event the stream has moved on from are dropped
+			const bool current = ev.sample && ev.identifier == cmd.id;
+
+			switch (cmd.type) {
+			case Command::PLAY:
+				DestroyEvent(&ev);
+				ev.sample = cmd.sample;
+				ev.decoder = cmd.decoder;
+				ev.buf_pos = 0;
+				ev.volume[0] = ev.targetVolume[0] = cmd.volume[0];
+				ev.volume[1] = ev.targetVolume[1] = cmd.volume[1];
+				ev.op = cmd.op;
+				ev.identifier = cmd.id;
+				ev.rateOfChange[0] = ev.rateOfChange[1] = 0.0f;
+				// published before the event counts as started
+				s_streamEvent[cmd.stream].store(cmd.id, std::memory_order_relaxed);
+				s_streamPos[cmd.stream].store(0, std::memory_order_relaxed);
+				s_startedEvent.store(cmd.id, std::memory_order_release);
+				break;
+			case Command::STOP:
+				if (current)
+					DestroyEvent(&ev);
+				break;
+			case Command::STOP_ALL:
+			case Command::STOP_ALL_EXCEPT_MUSIC:
+				/* music is on wavstream[0] and [1] */
+				for (unsigned int idx = (cmd.type == Command::STOP_ALL ? 0 : 2); idx < MAX_WAVSTREAMS; idx++)
+					DestroyEvent(&wavstream[idx]);
+				break;
+			case Command::SET_OP:
+				if (current)
+					ev.op = cmd.op;
+				break;
+			case Command::SET_VOLUME:
+				if (current) {
+					ev.volume[0] = ev.targetVolume[0] = cmd.volume[0];
+					ev.volume[1] = ev.targetVolume[1] = cmd.volume[1];
+				}
+				break;
+			case Command::ANIMATE_VOLUME:
+				if (current) {
+					ev.targetVolume[0] = cmd.volume[0];
+					ev.targetVolume[1] = cmd.volume[1];
+					ev.rateOfChange[0] = cmd.rateOfChange[0];
+					ev.rateOfChange[1] = cmd.rateOfChange[1];
+				}
+				break;
+			}
+		}
+	}
+
+	// Let the game thread know what the streams are doing
+	static void PublishStreams()
 	{
 		for (unsigned int i = 0; i < MAX_WAVSTREAMS; i++) {
-			if (wavstream[i].sample && (wavstream[i].identifier == id))
-				return &wavstream[i];
+			s_streamEvent[i].store(wavstream[i].sample ? wavstream[i].identifier : 0, std::memory_order_release);
+			s_streamPos[i].store(wavstream[i].buf_pos, std::memory_order_relaxed);
 		}
-		return nullptr;
 	}
 
-	bool SetOp(eventid id, Op op)
+	static void SubmitCommand(Command cmd)
 	{
-		if (id == 0) return false;
-		bool ret = false;
+		if (s_commands.try_push(cmd))
+			return;
+
+		// The queue only fills up when the callback isn't draining it: no
+		// device is open, or it's paused. Apply the requests here instead.
 		SDL_LockAudioDevice(m_audioDevice);
-		SoundEvent *se = GetEvent(id);
-		if (se) {
-			se->op = op;
-			ret = true;
-		}
+		ProcessCommands();
+		PublishStreams();
 		SDL_UnlockAudioDevice(m_audioDevice);
-		return ret;
+
+		const bool pushed = s_commands.try_push(cmd);
+		assert(pushed);
+		(void)pushed;
 	}
 
-	static void DestroyEvent(SoundEvent *ev)
+	// Whether the event last given to the stream is (or is about to be) playing.
+	// Game thread only.
+	static bool IsStreamPlaying(unsigned int stream)
 	{
-		if (ev->oggv) {
-			// streaming ogg
-			ov_clear(ev->oggv);
-			delete ev->oggv;
-			ev->oggv = 0;
-			ev->ogg_data_stream.Reset();
+		const eventid id = s_streamOwner[stream];
+		if (!id)
+			return false;
+
+		// not picked up by the mixer yet
+		if (id > s_startedEvent.load(std::memory_order_acquire))
+			return true;
+
+		return s_streamEvent[stream].load(std::memory_order_acquire) == id;
+	}
+
+	// Find the stream playing an event. Game thread only.
+	static int FindStream(eventid id)
+	{
+		if (id == 0)
+			return -1;
+
+		for (unsigned int i = 0; i < MAX_WAVSTREAMS; i++) {
+			if (s_streamOwner[i] == id)
+				return IsStreamPlaying(i) ? int(i) : -1;
 		}
-		ev->sample = nullptr;
+		return -1;
+	}
+
+	static Command MakeCommand(Command::Type type, int stream, eventid id)
+	{
+		Command cmd = {};
+		cmd.type = type;
+		cmd.stream = Uint8(stream);
+		cmd.id = id;
+		return cmd;
+	}
+
+	// The decoder the mixer is using for an event, if it's streamed
+	static StreamDecoder *FindDecoder(eventid id)
+	{
+		for (ActiveDecoder &active : s_activeDecoders) {
+			if (active.id == id)
+				return active.decoder.Get();
+		}
+		return nullptr;
+	}
+
+	// Decoders the mixer can't be using any more are released, the others are
+	// topped up. Game thread only.
+	static void UpdateDecoders()
+	{
+		const eventid started = s_startedEvent.load(std::memory_order_acquire);
+		for (auto iter = s_activeDecoders.begin(); iter != s_activeDecoders.end();) {
+			if (iter->id <= started && s_streamEvent[iter->stream].load(std::memory_order_acquire) != iter->id) {
+				iter = s_activeDecoders.erase(iter);
+				continue;
+			}
+
+			StreamDecoder *decoder = iter->decoder.Get();
+			if (s_decodeJobs && !decoder->m_decodePending && decoder->NeedsData())
+				s_decodeJobs->Order(new DecodeJob(decoder));
+			++iter;
+		}
+	}
+
+	static RefCountedPtr<StreamDecoder> GetDecoder(const Sample *sample, bool repeat)
+	{
+		// use a prefetched decoder if there is one
+		for (auto iter = s_prefetchedDecoders.begin(); iter != s_prefetchedDecoders.end(); ++iter) {
+			if ((*iter)->GetSample() == sample) {
+				RefCountedPtr<StreamDecoder> decoder = *iter;
+				s_prefetchedDecoders.erase(iter);
+				decoder->SetRepeat(repeat);
+				return decoder;
+			}
+		}
+
+		return RefCountedPtr<StreamDecoder>(new StreamDecoder(sample, repeat));
+	}
+
+	bool SetOp(eventid id, Op op)
+	{
+		const int stream = FindStream(id);
+		if (stream < 0) return false;
+
+		if (StreamDecoder *decoder = FindDecoder(id))
+			decoder->SetRepeat(op & OP_REPEAT);
+
+		Command cmd = MakeCommand(Command::SET_OP, stream, id);
+		cmd.op = op;
+		SubmitCommand(cmd);
+		return true;
+	}
+
+	static eventid StartEvent(unsigned int stream, const char *fx, const float volume_left, const float volume_right, const Op op)
+	{
+		static eventid identifier = 1;
+		const eventid id = identifier++;
+
+		const Sample *sample = GetSample(fx);
+		if (!sample) {
+			// nothing to play, the event is over before it began
+			return id;
+		}
+
+		s_streamOwner[stream] = id;
+
+		Command cmd = MakeCommand(Command::PLAY, stream, id);
+		cmd.sample = sample;
+		if (!sample->buf) {
+			RefCountedPtr<StreamDecoder> decoder = GetDecoder(sample, op & OP_REPEAT);
+			cmd.decoder = decoder.Get();
+			s_activeDecoders.push_back({ stream, id, decoder });
+			UpdateDecoders();
+		}
+		cmd.op = op;
+		cmd.volume[0] = volume_left;
+		cmd.volume[1] = volume_right;
+		SubmitCommand(cmd);
+		return id;
 	}
 
 	/*
  * Volume should be 0-65535
  */
-	static Uint32 identifier = 1;
 	eventid PlaySfx(const char *fx, const float volume_left, const float volume_right, const Op op)
 	{
-		SDL_LockAudioDevice(m_audioDevice);
 		unsigned int idx;
 		Uint32 age;
 		/* find free wavstream (first two reserved for music) */
 		for (idx = 2; idx < MAX_WAVSTREAMS; idx++) {
-			if (!wavstream[idx].sample) break;
+			if (!IsStreamPlaying(idx)) break;
 		}
 		if (idx == MAX_WAVSTREAMS) {
 			/* otherwise overwrite oldest one */
 			age = 0;
-			idx = 0;
+			idx = 2;
 			for (unsigned int i = 2; i < MAX_WAVSTREAMS; i++) {
-				if ((i == 0) || (wavstream[i].buf_pos > age)) {
+				const Uint32 pos = s_streamPos[i].load(std::memory_order_relaxed);
+				if (pos > age) {
 					idx = i;
-					age = wavstream[i].buf_pos;
+					age = pos;
 				}
 			}
-			DestroyEvent(&wavstream[idx]);
-		}
-		wavstream[idx].sample = GetSample(fx);
-		wavstream[idx].oggv = 0;
-		wavstream[idx].buf_pos = 0;
-		wavstream[idx].volume[0] = volume_left * GetSfxVolume();
-		wavstream[idx].volume[1] = volume_right * GetSfxVolume();
-		wavstream[idx].op = op;
-		wavstream[idx].identifier = identifier;
-		wavstream[idx].targetVolume[0] = volume_left * GetSfxVolume();
-		wavstream[idx].targetVolume[1] = volume_right * GetSfxVolume();
-		wavstream[idx].rateOfChange[0] = wavstream[idx].rateOfChange[1] = 0.0f;
-		SDL_UnlockAudioDevice(m_audioDevice);
-		return identifier++;
+		}
+		return StartEvent(idx, fx, volume_left * GetSfxVolume(), volume_right * GetSfxVolume(), op);
+	}
+
+	void Prefetch(const char *fx)
+	{
+		const Sample *sample = GetSample(fx);
+		if (!sample || sample->buf)
+			return;
+
+		for (const RefCountedPtr<StreamDecoder> &decoder : s_prefetchedDecoders) {
+			if (decoder->GetSample() == sample)
+				return;
+		}
+
+		if (s_prefetchedDecoders.size() >= MAX_PREFETCHED)
+			s_prefetchedDecoders.erase(s_prefetchedDecoders.begin());
+
+		// decoded from the start, the ring is filled before the sample plays
+		RefCountedPtr<StreamDecoder> decoder(new StreamDecoder(sample, false));
+		if (s_decodeJobs)
+			s_decodeJobs->Order(new DecodeJob(decoder.Get()));
+		s_prefetchedDecoders.push_back(decoder);
+	}
+
+	void Update()
+	{
+		PROFILE_SCOPED()
+		UpdateDecoders();
 	}
 
 	//unlike PlaySfx, we want uninterrupted play and do not care about age
@@ -287,21 +692,98 @@ namespace Sound {
 	{
 		const int idx = nextMusicStream;
 		nextMusicStream ^= 1;
-		SDL_LockAudioDevice(m_audioDevice);
-		if (wavstream[idx].sample)
-			DestroyEvent(&wavstream[idx]);
-		wavstream[idx].sample = GetSample(fx);
-		wavstream[idx].oggv = nullptr;
-		wavstream[idx].buf_pos = 0;
-		wavstream[idx].volume[0] = volume_left;
-		wavstream[idx].volume[1] = volume_right;
-		wavstream[idx].op = op;
-		wavstream[idx].identifier = identifier;
-		wavstream[idx].targetVolume[0] = volume_left; //already scaled in MusicPlayer
-		wavstream[idx].targetVolume[1] = volume_right;
-		wavstream[idx].rateOfChange[0] = wavstream[idx].rateOfChange[1] = 0.0f;
-		SDL_UnlockAudioDevice(m_audioDevice);
-		return identifier++;
+		//already scaled in MusicPlayer
+		return StartEvent(idx, fx, volume_left, volume_right, op);
+	}
+
+	// Scratch space for the mixer, only used from the audio callback
+	static Sint16 s_decodeBuf[MIX_BLOCK_FRAMES * 2];
+	static float s_mixBuf[MIX_BLOCK_FRAMES * 2];
+
+	/*
+	 * Expand frames of 16-bit input to interleaved stereo floats.
+	 * The SSE2 path converts four (mono) or eight (stereo) samples at a time.
+	 */
+	template <int T_channels>
+	static void expand_to_stereo(float *out, const Sint16 *in, int frames)
+	{
+		int frame = 0;
+#ifdef SOUND_SIMD_SSE2
+		for (; frame + 4 <= frames; frame += 4) {
+			__m128i lo, hi;
+			if (T_channels == 1) {
+				// a b c d -> a a b b c c d d
+				__m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + frame));
+				x = _mm_unpacklo_epi16(x, x);
+				lo = x;
+				hi = x;
+			} else {
+				const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + frame * 2));
+				lo = x;
+				hi = x;
+			}
+			// sign extend to 32 bits
+			lo = _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16);
+			hi = _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16);
+			_mm_storeu_ps(out + frame * 2, _mm_cvtepi32_ps(lo));
+			_mm_storeu_ps(out + frame * 2 + 4, _mm_cvtepi32_ps(hi));
+		}
+#endif
+		for (; frame < frames; frame++) {
+			if (T_channels == 1) {
+				out[frame * 2] = out[frame * 2 + 1] = float(in[frame]);
+			} else {
+				out[frame * 2] = float(in[frame * 2]);
+				out[frame * 2 + 1] = float(in[frame * 2 + 1]);
+			}
+		}
+	}
+
+	/*
+	 * Add frames of stereo input to the output buffer, following the
+	 * event's volume animation. The gain for frame k is volume + step * (k + 1)
+	 * clamped to [lo, hi], which is what stepping the volume once per frame
+	 * towards its target works out to.
+	 */
+	template <int T_upsample>
+	static void mix_block(float *out, const float *in, int frames, const float volume[2], const float step[2], const float lo[2], const float hi[2])
+	{
+		int frame = 0;
+#ifdef SOUND_SIMD_SSE2
+		const __m128 vVolume = _mm_setr_ps(volume[0], volume[1], volume[0], volume[1]);
+		const __m128 vStep = _mm_setr_ps(step[0], step[1], step[0], step[1]);
+		const __m128 vLo = _mm_setr_ps(lo[0], lo[1], lo[0], lo[1]);
+		const __m128 vHi = _mm_setr_ps(hi[0], hi[1], hi[0], hi[1]);
+		const __m128 vTwo = _mm_set1_ps(2.0f);
+		__m128 vCount = _mm_setr_ps(1.0f, 1.0f, 2.0f, 2.0f);
+
+		// two stereo frames at a time
+		for (; frame + 2 <= frames; frame += 2) {
+			__m128 gain = _mm_add_ps(vVolume, _mm_mul_ps(vStep, vCount));
+			gain = _mm_min_ps(_mm_max_ps(gain, vLo), vHi);
+			vCount = _mm_add_ps(vCount, vTwo);
+
+			const __m128 s = _mm_mul_ps(_mm_loadu_ps(in + frame * 2), gain);
+			if (T_upsample == 1) {
+				float *dst = out + frame * 2;
+				_mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), s));
+			} else {
+				// each frame is written twice
+				float *dst = out + frame * 4;
+				_mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_movelh_ps(s, s)));
+				_mm_storeu_ps(dst + 4, _mm_add_ps(_mm_loadu_ps(dst + 4), _mm_movehl_ps(s, s)));
+			}
+		}
+#endif
+		for (; frame < frames; frame++) {
+			const float count = float(frame + 1);
+			const float s0 = in[frame * 2] * Clamp(volume[0] + step[0] * count, lo[0], hi[0]);
+			const float s1 = in[frame * 2 + 1] * Clamp(volume[1] + step[1] * count, lo[1], hi[1]);
+			for (int i = 0; i < T_upsample; i++) {
+				out[(frame * T_upsample + i) * 2] += s0;
+				out[(frame * T_upsample + i) * 2 + 1] += s1;
+			}
+		}
 	}
 
 	/*
@@ -310,110 +792,100 @@ namespace Sound {
 	template <int T_channels, int T_upsample>
 	static void fill_audio_1stream(float *buffer, int len, int stream_num)
 	{
-		// inbuf will be smaller for mono and for 22050hz samples
-		Sint16 *inbuf = static_cast<Sint16 *>(alloca(len * T_channels / T_upsample));
-		// hm pity to put this here ^^ since not used by ev.sample->buf case
 		SoundEvent &ev = wavstream[stream_num];
-		int inbuf_pos = 0;
+
+		// volume animation, as a step per input frame towards the target
+		float step[2], lo[2], hi[2];
+		for (int chan = 0; chan < 2; chan++) {
+			if (ev.ascend[chan]) {
+				step[chan] = ev.rateOfChange[chan];
+				lo[chan] = -FLT_MAX;
+				hi[chan] = ev.targetVolume[chan];
+			} else {
+				step[chan] = -ev.rateOfChange[chan];
+				lo[chan] = ev.targetVolume[chan];
+				hi[chan] = FLT_MAX;
+			}
+		}
+
 		int pos = 0;
 		while ((pos < len) && ev.sample) {
+			// input frames wanted to fill the rest of the buffer, a block at a time
+			int frames = std::min(int(MIX_BLOCK_FRAMES), (len - pos) / (2 * T_upsample));
+			if (frames == 0) break;
+
+			const Sint16 *inbuf;
 			if (ev.sample->buf) {
 				// already decoded
-				inbuf = reinterpret_cast<Sint16 *>(ev.sample->buf);
-				inbuf_pos = ev.buf_pos;
-			} else {
-				// stream ogg vorbis
-				// ogg vorbis streaming
-				if (!ev.oggv) {
-					// open file to start streaming
-					ev.oggv = new OggVorbis_File;
-					RefCountedPtr<FileSystem::FileData> oggdata = FileSystem::gameDataFiles.ReadFile(ev.sample->path);
-					if (!oggdata) {
-						Output("Could not open '%s'", ev.sample->path.c_str());
-						ev.sample = nullptr;
-						return;
-					}
-					ev.ogg_data_stream.Reset(oggdata);
-					oggdata.Reset();
-					if (ov_open_callbacks(&ev.ogg_data_stream, ev.oggv, 0, 0, OggFileDataStream::CALLBACKS) < 0) {
-						Output("Vorbis could not understand '%s'", ev.sample->path.c_str());
-						ev.sample = nullptr;
-						return;
-					}
+				inbuf = reinterpret_cast<const Sint16 *>(ev.sample->buf) + ev.buf_pos;
+				frames = std::min(frames, int((ev.sample->buf_len - ev.buf_pos) / T_channels));
+				if (frames <= 0) {
+					// empty sample
+					DestroyEvent(&ev);
+					break;
 				}
-				int i = 0;
-				// (len-pos) = num floats the destination buffer wants.
-				// if we are stereo then to fill this we need (len-pos)*2 bytes
-				// if we are mono we want (len-pos) bytes
-				int wanted_bytes = (len - pos) * T_channels / T_upsample;
-				for (;;) {
-					int music_section;
-					if (wanted_bytes == 0) break;
-					int amt = ov_read(ev.oggv, reinterpret_cast<char *>(inbuf) + i,
-						wanted_bytes, 0, 2, 1, &music_section);
-					i += amt;
-					wanted_bytes -= amt;
-					if (amt == 0) break;
+			} else {
+				// streamed, decoded ahead of us by a DecodeJob
+				const bool ended = ev.decoder->IsEndOfStream();
+				frames = int(ev.decoder->Read(s_decodeBuf, frames * T_channels) / T_channels);
+				if (frames == 0) {
+					// if the decoder has fallen behind, this stream is
+					// silent until it catches up
+					if (ended)
+						DestroyEvent(&ev);
+					break;
 				}
+				inbuf = s_decodeBuf;
 			}
 
-			while (pos < len) {
-				/* Volume animations */
-				for (int chan = 0; chan < 2; chan++) {
-					if (ev.ascend[chan]) {
-						ev.volume[chan] = std::min(ev.volume[chan] + ev.rateOfChange[chan], ev.targetVolume[chan]);
-					} else {
-						ev.volume[chan] = std::max(ev.volume[chan] - ev.rateOfChange[chan], ev.targetVolume[chan]);
-					}
-				}
+			expand_to_stereo<T_channels>(s_mixBuf, inbuf, frames);
+			mix_block<T_upsample>(buffer + pos, s_mixBuf, frames, ev.volume, step, lo, hi);
 
-				float s0, s1;
-
-				if (T_channels == 1) {
-					s0 = float(inbuf[inbuf_pos++]);
-					s1 = ev.volume[1] * s0;
-					s0 = ev.volume[0] * s0;
-					ev.buf_pos += 1;
-				} else /* stereo */ {
-					s0 = ev.volume[0] * float(inbuf[inbuf_pos++]);
-					s1 = ev.volume[1] * float(inbuf[inbuf_pos++]);
-					ev.buf_pos += 2;
-				}
+			for (int chan = 0; chan < 2; chan++)
+				ev.volume[chan] = Clamp(ev.volume[chan] + step[chan] * float(frames), lo[chan], hi[chan]);
 
-				if (T_upsample == 1) {
-					buffer[pos] += s0;
-					buffer[pos + 1] += s1;
-					pos += 2;
-				} else {
-					buffer[pos] += s0;
-					buffer[pos + 1] += s1;
-					buffer[pos + 2] += s0;
-					buffer[pos + 3] += s1;
-					pos += 4;
-				}
+			ev.buf_pos += frames * T_channels;
+			pos += frames * 2 * T_upsample;
 
-				/* Repeat or end? */
-				if (ev.buf_pos >= ev.sample->buf_len) {
-					ev.buf_pos = 0;
-					inbuf_pos = 0;
-					if (!(ev.op & OP_REPEAT)) {
-						DestroyEvent(&ev);
-						break;
-					}
-					if (ev.oggv) {
-						// streaming ogg
-						ov_pcm_seek(ev.oggv, 0);
-						// repeat outer loop to decode some
-						// more vorbis from the start of the stream
-						break;
-					}
+			/* Repeat or end? The decoder takes care of that for streams */
+			if (ev.buf_pos >= ev.sample->buf_len) {
+				ev.buf_pos = 0;
+				if (!ev.decoder && !(ev.op & OP_REPEAT)) {
+					DestroyEvent(&ev);
+					break;
 				}
 			}
 		}
 	}
 
+	/*
+	 * Scale by the master volume and convert to the Sint16 samples the
+	 * hardware likes, truncating like the scalar cast would.
+	 */
+	static void convert_to_s16(Sint16 *out, const float *in, int len)
+	{
+		int pos = 0;
+#ifdef SOUND_SIMD_SSE2
+		const __m128 vVol = _mm_set1_ps(m_masterVol);
+		const __m128 vMin = _mm_set1_ps(-32768.0f);
+		const __m128 vMax = _mm_set1_ps(32767.0f);
+		for (; pos + 8 <= len; pos += 8) {
+			const __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + pos), vVol), vMin), vMax);
+			const __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + pos + 4), vVol), vMin), vMax);
+			const __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out + pos), packed);
+		}
+#endif
+		for (; pos < len; pos++) {
+			const float val = m_masterVol * in[pos];
+			out[pos] = Sint16(Clamp(val, -32768.0f, 32767.0f));
+		}
+	}
+
 	static void fill_audio(void *udata, Uint8 *dsp_buf, int len)
 	{
+		ProcessCommands();
+
 		const int len_in_floats = len >> 1;
 		float *tmpbuf = static_cast<float *>(alloca(sizeof(float) * len_in_floats)); // len is in chars not samples
 		memset(static_cast<void *>(tmpbuf), 0, sizeof(float) * len_in_floats);
@@ -455,32 +927,26 @@ namespace Sound {
 			}
 		}
 
-		/* Convert float sample buffer to Sint16 samples the hardware likes */
-		for (int pos = 0; pos < len_in_floats; pos++) {
-			const float val = m_masterVol * tmpbuf[pos];
-			(reinterpret_cast<Sint16 *>(dsp_buf))[pos] = Sint16(Clamp(val, -32768.0f, 32767.0f));
-		}
+		convert_to_s16(reinterpret_cast<Sint16 *>(dsp_buf), tmpbuf, len_in_floats);
+
+		PublishStreams();
 	}
 
 	void DestroyAllEvents()
 	{
 		/* silence any sound events */
-		SDL_LockAudioDevice(m_audioDevice);
-		for (unsigned int idx = 0; idx < MAX_WAVSTREAMS; idx++) {
-			DestroyEvent(&wavstream[idx]);
-		}
-		SDL_UnlockAudioDevice(m_audioDevice);
+		for (unsigned int idx = 0; idx < MAX_WAVSTREAMS; idx++)
+			s_streamOwner[idx] = 0;
+		SubmitCommand(MakeCommand(Command::STOP_ALL, 0, 0));
 	}
 
 	void DestroyAllEventsExceptMusic()
 	{
 		/* silence any sound events EXCEPT music
 		   which are on wavstream[0] and [1] */
-		SDL_LockAudioDevice(m_audioDevice);
-		for (unsigned int idx = 2; idx < MAX_WAVSTREAMS; idx++) {
-			DestroyEvent(&wavstream[idx]);
-		}
-		SDL_UnlockAudioDevice(m_audioDevice);
+		for (unsigned int idx = 2; idx < MAX_WAVSTREAMS; idx++)
+			s_streamOwner[idx] = 0;
+		SubmitCommand(MakeCommand(Command::STOP_ALL_EXCEPT_MUSIC, 0, 0));
 	}
 
 	static std::pair<std::string, Sample> load_sound(const std::string &basename, const std::string &path, bool is_music)
@@ -597,6 +1063,8 @@ namespace Sound {
 			return false;
 		}
 
+		s_decodeJobs.reset(new JobSet(Pi::GetApp()->GetAsyncJobQueue(), JobPriority::Interactive));
+
 		// load all the wretched effects
 		Pi::GetApp()->GetAsyncStartupQueue()->Order(new LoadSoundJob("sounds", false));
 
@@ -661,15 +1129,25 @@ namespace Sound {
 
 	void Uninit()
 	{
+		// decode jobs keep their decoder alive until they're done with it
+		s_prefetchedDecoders.clear();
+		s_decodeJobs.reset();
+
 		if (!m_audioDevice)
 			return;
 
 		DestroyAllEvents();
+		SDL_CloseAudioDevice(m_audioDevice);
+		m_audioDevice = 0;
+
+		// the callback has stopped, clean up whatever it hadn't got to
+		ProcessCommands();
+		PublishStreams();
+		s_activeDecoders.clear();
+
 		std::map<std::string, Sample>::iterator i;
 		for (i = sfx_samples.begin(); i != sfx_samples.end(); ++i)
 			delete[](*i).second.buf;
-		SDL_CloseAudioDevice(m_audioDevice);
-		m_audioDevice = 0;
 	}
 
 	void UpdateAudioDevices()
@@ -695,71 +1173,51 @@ namespace Sound {
 
 	bool Event::Stop()
 	{
-		if (eid) {
-			SDL_LockAudioDevice(m_audioDevice);
-			SoundEvent *s = GetEvent(eid);
-			if (s) {
-				DestroyEvent(s);
-			}
-			SDL_UnlockAudioDevice(m_audioDevice);
-			return s != nullptr;
-		} else {
+		const int stream = FindStream(eid);
+		if (stream < 0)
 			return false;
-		}
+
+		s_streamOwner[stream] = 0;
+		SubmitCommand(MakeCommand(Command::STOP, stream, eid));
+		return true;
 	}
 
 	bool Event::IsPlaying() const
 	{
-		if (eid == 0)
-			return false;
-		else
-			return GetEvent(eid) != nullptr;
+		return FindStream(eid) >= 0;
 	}
 
 	bool Event::SetOp(Op op)
 	{
-		if (eid == 0) return false;
-		bool ret = false;
-		SDL_LockAudioDevice(m_audioDevice);
-		SoundEvent *se = GetEvent(eid);
-		if (se) {
-			se->op = op;
-			ret = true;
-		}
-		SDL_UnlockAudioDevice(m_audioDevice);
-		return ret;
+		return Sound::SetOp(eid, op);
 	}
 
 	bool Event::VolumeAnimate(const float targetVol1, const float targetVol2, const float dv_dt1, const float dv_dt2)
 	{
-		SDL_LockAudioDevice(m_audioDevice);
-		SoundEvent *ev = GetEvent(eid);
-		if (ev) {
-			ev->targetVolume[0] = targetVol1;
-			ev->targetVolume[1] = targetVol2;
-			ev->rateOfChange[0] = dv_dt1 / float(FREQ);
-			ev->rateOfChange[1] = dv_dt2 / float(FREQ);
-		}
-		SDL_UnlockAudioDevice(m_audioDevice);
-		return (ev != nullptr);
+		const int stream = FindStream(eid);
+		if (stream < 0)
+			return false;
+
+		Command cmd = MakeCommand(Command::ANIMATE_VOLUME, stream, eid);
+		cmd.volume[0] = targetVol1;
+		cmd.volume[1] = targetVol2;
+		cmd.rateOfChange[0] = dv_dt1 / float(FREQ);
+		cmd.rateOfChange[1] = dv_dt2 / float(FREQ);
+		SubmitCommand(cmd);
+		return true;
 	}
 
 	bool Event::SetVolume(const float vol_left, const float vol_right)
 	{
-		SDL_LockAudioDevice(m_audioDevice);
-		bool status = false;
-		for (unsigned int i = 0; i < MAX_WAVSTREAMS; i++) {
-			if (wavstream[i].sample && (wavstream[i].identifier == eid)) {
-				wavstream[i].volume[0] = vol_left;
-				wavstream[i].volume[1] = vol_right;
-				wavstream[i].targetVolume[0] = vol_left;
-				wavstream[i].targetVolume[1] = vol_right;
-				status = true;
-				break;
-			}
-		}
-		SDL_UnlockAudioDevice(m_audioDevice);
-		return status;
+		const int stream = FindStream(eid);
+		if (stream < 0)
+			return false;
+
+		Command cmd = MakeCommand(Command::SET_VOLUME, stream, eid);
+		cmd.volume[0] = vol_left;
+		cmd.volume[1] = vol_right;
+		SubmitCommand(cmd);
+		return true;
 	}
 
 	const std::map<std::string, Sample> &GetSamples()
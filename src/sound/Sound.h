@@ -71,6 +71,15 @@ namespace Sound {
 	void Pause(int on);
 	eventid PlaySfx(const char *fx, const float volume_left, const float volume_right, const Op op);
 	eventid PlayMusic(const char *fx, const float volume_left, const float volume_right, const Op op);
+	/**
+	 * Start decoding a streamed (long) sample in the background, so it's
+	 * ready to play without a gap. Does nothing for short samples.
+	 */
+	void Prefetch(const char *fx);
+	/**
+	 * Keep streamed samples decoding. Call once per frame.
+	 */
+	void Update();
 	inline static eventid PlaySfx(const char *fx) { return PlaySfx(fx, 1.0f, 1.0f, 0); }
 	void CalculateStereo(const Body *b, float vol, float *volLeftOut, float *volRightOut);
 	eventid BodyMakeNoise(const Body *b, const char *fx, float vol);
@@ -80,6 +80,12 @@ namespace Sound {
 		m_playing = false;
 	}
 
+	void MusicPlayer::Prefetch(const std::string &name)
+	{
+		if (!m_enabled) return;
+		Sound::Prefetch(name.c_str());
+	}
+
 	void MusicPlayer::FadeOut(const float fadeDelta)
 	{
 		if (m_eventOnePlaying) { //2 might be already fading out
@@ -27,6 +27,8 @@ namespace Sound {
 		void SetVolume(const float);
 		void Play(const std::string &, const bool repeat = false, const float fadeDelta = 1.f);
 		void Stop();
+		// Get a song ready to play, e.g. the next one in a playlist
+		void Prefetch(const std::string &);
 		void FadeOut(const float fadeDelta);
 		void Update();
 		const std::string& GetCurrentSongName() const;
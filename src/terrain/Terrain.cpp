@@ -8,10 +8,19 @@
 #include "GameConfig.h"
 #include "MathUtil.h"
 #include "perlin.h"
+#include "core/FNV1a.h"
 #include "core/macros.h"
 #include "core/Log.h"
 #include "../galaxy/SystemBody.h"
 
+#include <iterator>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TERRAIN_SIMD_SSE2
+#endif
+
 // static instancer. selects the best height and color classes for the body
 Terrain *Terrain::InstanceTerrain(const SystemBody *body)
 {
@@ -371,37 +380,25 @@ static size_t bufread_or_die(void *ptr, size_t size, size_t nmemb, ByteRange &bu
 	return read_count;
 }
 
-// XXX this sucks, but there isn't a reliable cross-platform way to get them
-#ifndef INT16_MIN
-#define INT16_MIN (-32767 - 1)
-#endif
-#ifndef INT16_MAX
-#define INT16_MAX (32767)
-#endif
-#ifndef UINT16_MAX
-#define UINT16_MAX (65535)
-#endif
-
 Terrain::Terrain(const SystemBody *body) :
 	m_seed(body->GetSeed()),
 	m_rand(body->GetSeed()),
+	m_heightMap(nullptr),
+	m_heightMapSigned(false),
 	m_heightScaling(0),
 	m_minh(0),
 	m_minBody(body)
 {
 
-	// load the heightmap
+	// map the heightmap
 	if (!body->GetHeightMapFilename().empty()) {
-		RefCountedPtr<FileSystem::FileData> fdata = FileSystem::gameDataFiles.ReadFile(body->GetHeightMapFilename());
-		if (!fdata) {
+		m_heightMapFile = FileSystem::gameDataFiles.MapFile(body->GetHeightMapFilename());
+		if (!m_heightMapFile) {
 			Output("Error: could not open file '%s'\n", body->GetHeightMapFilename().c_str());
 			abort();
 		}
 
-		ByteRange databuf = fdata->AsByteRange();
-
-		Sint16 minHMap = INT16_MAX, maxHMap = INT16_MIN;
-		Uint16 minHMapScld = UINT16_MAX, maxHMapScld = 0;
+		ByteRange databuf = m_heightMapFile->AsByteRange();
 
 		// XXX unify heightmap types
 		switch (body->GetHeightMapFractal()) {
@@ -411,22 +408,7 @@ Terrain::Terrain(const SystemBody *body) :
 			m_heightMapSizeX = v;
 			bufread_or_die(&v, 2, 1, databuf);
 			m_heightMapSizeY = v;
-			const Uint32 heightmapPixelArea = (m_heightMapSizeX * m_heightMapSizeY);
-
-			std::unique_ptr<Sint16[]> heightMap(new Sint16[heightmapPixelArea]);
-			bufread_or_die(heightMap.get(), sizeof(Sint16), heightmapPixelArea, databuf);
-			m_heightMap.reset(new double[heightmapPixelArea]);
-			double *pHeightMap = m_heightMap.get();
-			for (Uint32 i = 0; i < heightmapPixelArea; i++) {
-				const Sint16 val = heightMap.get()[i];
-				minHMap = std::min(minHMap, val);
-				maxHMap = std::max(maxHMap, val);
-				// store then increment pointer
-				(*pHeightMap) = val;
-				++pHeightMap;
-			}
-			assert(pHeightMap == &m_heightMap[heightmapPixelArea]);
-			//Output("minHMap = (%hd), maxHMap = (%hd)\n", minHMap, maxHMap);
+			m_heightMapSigned = true;
 			break;
 		}
 
@@ -437,7 +419,6 @@ Terrain::Terrain(const SystemBody *body) :
 			m_heightMapSizeY = v;
 			bufread_or_die(&v, 2, 1, databuf);
 			m_heightMapSizeX = v;
-			const Uint32 heightmapPixelArea = (m_heightMapSizeX * m_heightMapSizeY);
 
 			// read height scaling and min height which are doubles
 			double te;
@@ -445,27 +426,21 @@ Terrain::Terrain(const SystemBody *body) :
 			m_heightScaling = te;
 			bufread_or_die(&te, 8, 1, databuf);
 			m_minh = te;
-
-			std::unique_ptr<Uint16[]> heightMapScaled(new Uint16[heightmapPixelArea]);
-			bufread_or_die(heightMapScaled.get(), sizeof(Uint16), heightmapPixelArea, databuf);
-			m_heightMap.reset(new double[heightmapPixelArea]);
-			double *pHeightMap = m_heightMap.get();
-			for (Uint32 i = 0; i < heightmapPixelArea; i++) {
-				const Uint16 val = heightMapScaled[i];
-				minHMapScld = std::min(minHMapScld, val);
-				maxHMapScld = std::max(maxHMapScld, val);
-				// store then increment pointer
-				(*pHeightMap) = val;
-				++pHeightMap;
-			}
-			assert(pHeightMap == &m_heightMap[heightmapPixelArea]);
-			//Output("minHMapScld = (%hu), maxHMapScld = (%hu)\n", minHMapScld, maxHMapScld);
 			break;
 		}
 
 		default:
 			assert(0);
 		}
+
+		// the samples follow the header; they aren't copied or converted
+		// here, as that would load the whole map
+		const size_t heightmapPixelArea = size_t(m_heightMapSizeX) * size_t(m_heightMapSizeY);
+		if (databuf.Size() < heightmapPixelArea * sizeof(Uint16)) {
+			Output("Error: failed to read file (truncated)\n");
+			abort();
+		}
+		m_heightMap = reinterpret_cast<const Uint16 *>(databuf.begin);
 	}
 
 	m_sealevel = Clamp(body->GetVolatileLiquid(), 0.0, 1.0);
@@ -645,7 +620,33 @@ void Terrain::SetFracDef(const unsigned int index, const double featureHeightMet
 	//Output("%d octaves\n", m_fracdef[index].octaves); //print
 }
 
-double Terrain::BiCubicInterpolation(const vector3d &p) const
+Uint64 Terrain::GetParametersHash() const
+{
+	// field by field, so struct padding doesn't end up in the hash
+	std::vector<double> params;
+	for (const fracdef_t &def : m_fracdef) {
+		params.push_back(def.amplitude);
+		params.push_back(def.frequency);
+		params.push_back(def.lacunarity);
+		params.push_back(def.octaves);
+	}
+
+	params.insert(params.end(), { m_sealevel, m_icyness, m_volcanic, double(m_surfaceEffects),
+		m_maxHeightInMeters, m_planetRadius, m_heightScaling, m_minh });
+
+	params.insert(params.end(), std::begin(m_entropy), std::end(m_entropy));
+	for (const vector3d *colors : { m_rockColor, m_darkrockColor, m_greyrockColor, m_plantColor, m_darkplantColor,
+			 m_sandColor, m_darksandColor, m_dirtColor, m_darkdirtColor, m_gglightColor, m_ggdarkColor }) {
+		for (int i = 0; i < 8; i++)
+			params.insert(params.end(), { colors[i].x, colors[i].y, colors[i].z });
+	}
+
+	return hash_64_fnv1a(reinterpret_cast<const char *>(params.data()), params.size() * sizeof(double));
+}
+
+// The 4x4 heightmap samples around the cell p falls in, as map[x][y], and
+// the position of p within the cell
+void Terrain::GetHeightMapCell(const vector3d &p, double map[4][4], double &dx, double &dy) const
 {
 	double latitude = -asin(p.y);
 	if (p.y < -1.0) latitude = -0.5 * M_PI;
@@ -661,41 +662,93 @@ double Terrain::BiCubicInterpolation(const vector3d &p) const
 	int iy = int(floor(py));
 	ix = Clamp(ix, 0, m_heightMapSizeX - 1);
 	iy = Clamp(iy, 0, m_heightMapSizeY - 1);
-	const double dx = px - ix;
-	const double dy = py - iy;
+	dx = px - ix;
+	dy = py - iy;
 
 	// p0,3 p1,3 p2,3 p3,3
 	// p0,2 p1,2 p2,2 p3,2
 	// p0,1 p1,1 p2,1 p3,1
 	// p0,0 p1,0 p2,0 p3,0
-	double map[4][4];
-	const double *pHMap = m_heightMap.get();
 	for (int x = -1; x < 3; x++) {
 		for (int y = -1; y < 3; y++) {
-			map[x + 1][y + 1] = pHMap[Clamp(iy + y, 0, m_heightMapSizeY - 1) * m_heightMapSizeX + Clamp(ix + x, 0, m_heightMapSizeX - 1)];
+			const size_t row = Clamp(iy + y, 0, m_heightMapSizeY - 1);
+			const size_t col = Clamp(ix + x, 0, m_heightMapSizeX - 1);
+			const Uint16 sample = m_heightMap[row * m_heightMapSizeX + col];
+			map[x + 1][y + 1] = m_heightMapSigned ? double(Sint16(sample)) : double(sample);
 		}
 	}
+}
 
-	double c[4];
-	for (int j = 0; j < 4; j++) {
-		const double d0 = map[0][j] - map[1][j];
-		const double d2 = map[2][j] - map[1][j];
-		const double d3 = map[3][j] - map[1][j];
-		const double a0 = map[1][j];
-		const double a1 = -(1 / 3.0) * d0 + d2 - (1 / 6.0) * d3;
-		const double a2 = 0.5 * d0 + 0.5 * d2;
-		const double a3 = -(1 / 6.0) * d0 - 0.5 * d2 + (1 / 6.0) * d3;
-		c[j] = a0 + a1 * dx + a2 * dx * dx + a3 * dx * dx * dx;
-	}
-
-	const double d0 = c[0] - c[1];
-	const double d2 = c[2] - c[1];
-	const double d3 = c[3] - c[1];
-	const double a0 = c[1];
+// Cubic through m0..m3 (at -1, 0, 1 and 2) at t, plus base. The SSE2
+// version does the same operations in the same order, so both give
+// identical results.
+static inline double HeightMapCubic(double m0, double m1, double m2, double m3, double t, double base)
+{
+	const double d0 = m0 - m1;
+	const double d2 = m2 - m1;
+	const double d3 = m3 - m1;
+	const double a0 = m1;
 	const double a1 = -(1 / 3.0) * d0 + d2 - (1 / 6.0) * d3;
 	const double a2 = 0.5 * d0 + 0.5 * d2;
 	const double a3 = -(1 / 6.0) * d0 - 0.5 * d2 + (1 / 6.0) * d3;
-	return (0.1 + a0 + a1 * dy + a2 * dy * dy + a3 * dy * dy * dy);
+	return base + a0 + a1 * t + a2 * t * t + a3 * t * t * t;
+}
+
+#ifdef TERRAIN_SIMD_SSE2
+static inline __m128d HeightMapCubic(__m128d m0, __m128d m1, __m128d m2, __m128d m3, __m128d t, __m128d base)
+{
+	const __m128d half = _mm_set1_pd(0.5);
+	const __m128d sixth = _mm_set1_pd(1 / 6.0);
+	const __m128d d0 = _mm_sub_pd(m0, m1);
+	const __m128d d2 = _mm_sub_pd(m2, m1);
+	const __m128d d3 = _mm_sub_pd(m3, m1);
+	const __m128d a1 = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(_mm_set1_pd(-(1 / 3.0)), d0), d2), _mm_mul_pd(sixth, d3));
+	const __m128d a2 = _mm_add_pd(_mm_mul_pd(half, d0), _mm_mul_pd(half, d2));
+	const __m128d a3 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(_mm_set1_pd(-(1 / 6.0)), d0), _mm_mul_pd(half, d2)), _mm_mul_pd(sixth, d3));
+	__m128d v = _mm_add_pd(_mm_add_pd(base, m1), _mm_mul_pd(a1, t));
+	v = _mm_add_pd(v, _mm_mul_pd(_mm_mul_pd(a2, t), t));
+	return _mm_add_pd(v, _mm_mul_pd(_mm_mul_pd(_mm_mul_pd(a3, t), t), t));
+}
+#endif
+
+double Terrain::BiCubicInterpolation(const vector3d &p) const
+{
+	double map[4][4];
+	double dx, dy;
+	GetHeightMapCell(p, map, dx, dy);
+
+	double c[4];
+	for (int j = 0; j < 4; j++)
+		c[j] = HeightMapCubic(map[0][j], map[1][j], map[2][j], map[3][j], dx, 0.0);
+
+	return HeightMapCubic(c[0], c[1], c[2], c[3], dy, 0.1);
+}
+
+void Terrain::BiCubicInterpolation(const vector3d *p, double *heights, size_t count) const
+{
+	size_t idx = 0;
+#ifdef TERRAIN_SIMD_SSE2
+	// the samples are gathered point by point, and the interpolation done
+	// for two points at once
+	for (; idx + 2 <= count; idx += 2) {
+		double mapA[4][4], mapB[4][4];
+		double dxA, dyA, dxB, dyB;
+		GetHeightMapCell(p[idx], mapA, dxA, dyA);
+		GetHeightMapCell(p[idx + 1], mapB, dxB, dyB);
+
+		const __m128d dx = _mm_setr_pd(dxA, dxB);
+		const __m128d zero = _mm_setzero_pd();
+		__m128d c[4];
+		for (int j = 0; j < 4; j++) {
+			c[j] = HeightMapCubic(_mm_setr_pd(mapA[0][j], mapB[0][j]), _mm_setr_pd(mapA[1][j], mapB[1][j]),
+				_mm_setr_pd(mapA[2][j], mapB[2][j]), _mm_setr_pd(mapA[3][j], mapB[3][j]), dx, zero);
+		}
+
+		_mm_storeu_pd(heights + idx, HeightMapCubic(c[0], c[1], c[2], c[3], _mm_setr_pd(dyA, dyB), _mm_set1_pd(0.1)));
+	}
+#endif
+	for (; idx < count; idx++)
+		heights[idx] = BiCubicInterpolation(p[idx]);
 }
 
 Terrain::MinBodyData::MinBodyData(const SystemBody *body)
@@ -19,6 +19,10 @@
 
 class SystemBody;
 
+namespace FileSystem {
+	class FileData;
+}
+
 template <typename, typename>
 class TerrainGenerator;
 
@@ -46,14 +50,27 @@ public:
 	virtual double GetHeight(const vector3d &p) const = 0;
 	virtual vector3d GetColor(const vector3d &p, double height, const vector3d &norm) const = 0;
 
+	// Evaluate GetHeight / GetColor for count points with a single virtual call.
+	// Results are identical to calling the single point versions.
+	virtual void GetHeights(const vector3d *p, double *heights, size_t count) const = 0;
+	virtual void GetColors(const vector3d *p, const double *heights, const vector3d *norms, vector3d *colors, size_t count) const = 0;
+
 	virtual const char *GetHeightFractalName() const = 0;
 	virtual const char *GetColorFractalName() const = 0;
 
 	double GetMaxHeight() const { return m_maxHeight; }
 
+	Uint32 GetSeed() const { return m_seed; }
+
 	Uint32 GetSurfaceEffects() const { return m_surfaceEffects; }
 
+	// Hash of everything besides the fractal types that the generated heights
+	// and colors depend on: the fracdefs, and the values taken from the body
+	Uint64 GetParametersHash() const;
+
 	double BiCubicInterpolation(const vector3d &p) const;
+	// BiCubicInterpolation for count points, two at a time where SSE2 is available
+	void BiCubicInterpolation(const vector3d *p, double *heights, size_t count) const;
 
 	void DebugDump() const;
 
@@ -63,6 +80,8 @@ private:
 
 	typedef Terrain *(*GeneratorInstancer)(const SystemBody *);
 
+	void GetHeightMapCell(const vector3d &p, double map[4][4], double &dx, double &dy) const;
+
 protected:
 	Terrain(const SystemBody *body);
 
@@ -77,7 +96,12 @@ protected:
 
 	// heightmap stuff
 	// XXX unify heightmap types
-	std::unique_ptr<double[]> m_heightMap;
+	// The 16-bit samples (signed for fractal 0, unsigned for fractal 1) are
+	// read straight from the mapped file, so only the parts of the map that
+	// patches are built on get loaded.
+	RefCountedPtr<FileSystem::FileData> m_heightMapFile;
+	const Uint16 *m_heightMap;
+	bool m_heightMapSigned;
 	double m_heightScaling, m_minh;
 
 	int m_heightMapSizeX;
@@ -125,6 +149,7 @@ class TerrainHeightFractal : virtual public Terrain {
 public:
 	TerrainHeightFractal() = delete;
 	virtual double GetHeight(const vector3d &p) const;
+	virtual void GetHeights(const vector3d *p, double *heights, size_t count) const;
 	virtual const char *GetHeightFractalName() const;
 
 protected:
@@ -138,6 +163,7 @@ class TerrainColorFractal : virtual public Terrain {
 public:
 	TerrainColorFractal() = delete;
 	virtual vector3d GetColor(const vector3d &p, double height, const vector3d &norm) const;
+	virtual void GetColors(const vector3d *p, const double *heights, const vector3d *norms, vector3d *colors, size_t count) const;
 	virtual const char *GetColorFractalName() const;
 
 protected:
@@ -146,6 +172,23 @@ protected:
 private:
 };
 
+// By default the batch functions loop over the (non-virtual) single point
+// function; fractals can specialise these with a vectorised implementation.
+// Specialisations must be declared at the end of this file.
+template <typename HeightFractal>
+void TerrainHeightFractal<HeightFractal>::GetHeights(const vector3d *p, double *heights, size_t count) const
+{
+	for (size_t idx = 0; idx < count; idx++)
+		heights[idx] = TerrainHeightFractal<HeightFractal>::GetHeight(p[idx]);
+}
+
+template <typename ColorFractal>
+void TerrainColorFractal<ColorFractal>::GetColors(const vector3d *p, const double *heights, const vector3d *norms, vector3d *colors, size_t count) const
+{
+	for (size_t idx = 0; idx < count; idx++)
+		colors[idx] = TerrainColorFractal<ColorFractal>::GetColor(p[idx], heights[idx], norms[idx]);
+}
+
 template <typename HeightFractal, typename ColorFractal>
 class TerrainGenerator : public TerrainHeightFractal<HeightFractal>, public TerrainColorFractal<ColorFractal> {
 public:
@@ -253,6 +296,14 @@ class TerrainColorTFGood;
 class TerrainColorTFPoor;
 class TerrainColorVolcanic;
 
+// fractals with a vectorised batch implementation
+template <>
+void TerrainHeightFractal<TerrainHeightHillsNormal>::GetHeights(const vector3d *p, double *heights, size_t count) const;
+template <>
+void TerrainHeightFractal<TerrainHeightMapped>::GetHeights(const vector3d *p, double *heights, size_t count) const;
+template <>
+void TerrainHeightFractal<TerrainHeightMapped2>::GetHeights(const vector3d *p, double *heights, size_t count) const;
+
 #ifdef _MSC_VER
 #pragma warning(default : 4250)
 #endif
@@ -50,3 +50,73 @@ double TerrainHeightFractal<TerrainHeightHillsNormal>::GetHeight(const vector3d
 	if (n > 0.0) return n * m_maxHeight;
 	return 0.0;
 }
+
+template <>
+void TerrainHeightFractal<TerrainHeightHillsNormal>::GetHeights(const vector3d *p, double *heights, size_t count) const
+{
+	// Same as GetHeight above, evaluated NOISE_BATCH_SIZE points at a time.
+	// Points below sea level are dropped after the continent pass so that the
+	// remaining octaves are only evaluated for land.
+	vector3d land[NOISE_BATCH_SIZE];
+	size_t landIdx[NOISE_BATCH_SIZE];
+	double continents[NOISE_BATCH_SIZE], distrib[NOISE_BATCH_SIZE], persistence[NOISE_BATCH_SIZE];
+	double m[NOISE_BATCH_SIZE], noiseVal[NOISE_BATCH_SIZE];
+
+	for (size_t base = 0; base < count; base += NOISE_BATCH_SIZE) {
+		const size_t num = std::min(count - base, NOISE_BATCH_SIZE);
+
+		octavenoise(GetFracDef(3), 0.65, &p[base], noiseVal, num);
+
+		size_t numLand = 0;
+		for (size_t idx = 0; idx < num; idx++) {
+			heights[base + idx] = 0.0;
+			const double c = noiseVal[idx] * (1.0 - m_sealevel) - (m_sealevel * 0.1);
+			if (c < 0) continue;
+
+			land[numLand] = p[base + idx];
+			landIdx[numLand] = base + idx;
+			continents[numLand] = c;
+			numLand++;
+		}
+
+		if (!numLand) continue;
+
+		octavenoise(GetFracDef(4), 0.5, land, distrib, numLand);
+		for (size_t idx = 0; idx < numLand; idx++) {
+			distrib[idx] *= distrib[idx];
+			persistence[idx] = 0.55 * distrib[idx];
+		}
+
+		octavenoise(GetFracDef(4), persistence, land, noiseVal, numLand);
+		for (size_t idx = 0; idx < numLand; idx++)
+			m[idx] = 0.5 * GetFracDef(3).amplitude * noiseVal[idx] * GetFracDef(5).amplitude;
+
+		billow_octavenoise(GetFracDef(5), persistence, land, noiseVal, numLand);
+		for (size_t idx = 0; idx < numLand; idx++) {
+			m[idx] += 0.25 * noiseVal[idx];
+			persistence[idx] = 0.6 * (1.0 - distrib[idx]);
+		}
+
+		//hill footings
+		octavenoise(GetFracDef(2), persistence, land, noiseVal, numLand);
+		for (size_t idx = 0; idx < numLand; idx++) {
+			m[idx] -= noiseVal[idx] * Clamp(0.05 - m[idx], 0.0, 0.05) * Clamp(0.05 - m[idx], 0.0, 0.05);
+			persistence[idx] = 0.765 * distrib[idx];
+		}
+
+		//hill footings
+		voronoiscam_octavenoise(GetFracDef(6), persistence, land, noiseVal, numLand);
+		for (size_t idx = 0; idx < numLand; idx++) {
+			m[idx] += noiseVal[idx] * Clamp(0.025 - m[idx], 0.0, 0.025) * Clamp(0.025 - m[idx], 0.0, 0.025);
+
+			double n = continents[idx];
+			// cliffs at shore
+			if (continents[idx] < 0.01)
+				n += m[idx] * continents[idx] * 100.0f;
+			else
+				n += m[idx];
+
+			heights[landIdx[idx]] = n > 0.0 ? n * m_maxHeight : 0.0;
+		}
+	}
+}
@@ -19,16 +19,29 @@ TerrainHeightFractal<TerrainHeightMapped2>::TerrainHeightFractal(const SystemBod
 template <>
 double TerrainHeightFractal<TerrainHeightMapped2>::GetHeight(const vector3d &p) const
 {
-	double v = BiCubicInterpolation(p);
+	double height;
+	TerrainHeightFractal<TerrainHeightMapped2>::GetHeights(&p, &height, 1);
+	return height;
+}
+
+template <>
+void TerrainHeightFractal<TerrainHeightMapped2>::GetHeights(const vector3d *points, double *heights, size_t count) const
+{
+	BiCubicInterpolation(points, heights, count);
+
+	for (size_t idx = 0; idx < count; idx++) {
+		const vector3d &p = points[idx];
+		double v = heights[idx];
 
-	v = v * m_heightScaling + m_minh; // v = v*height scaling+min height
-	v *= m_invPlanetRadius;
+		v = v * m_heightScaling + m_minh; // v = v*height scaling+min height
+		v *= m_invPlanetRadius;
 
-	v += 0.1;
-	double h = 1.5 * v * v * v * ridged_octavenoise(16, 4.0 * v, 4.0, p);
-	h += 30000.0 * v * v * v * v * v * v * v * ridged_octavenoise(16, 5.0 * v, 20.0 * v, p);
-	h += v;
-	h -= 0.09;
+		v += 0.1;
+		double h = 1.5 * v * v * v * ridged_octavenoise(16, 4.0 * v, 4.0, p);
+		h += 30000.0 * v * v * v * v * v * v * v * ridged_octavenoise(16, 5.0 * v, 20.0 * v, p);
+		h += v;
+		h -= 0.09;
 
-	return (h > 0.0 ? h : 0.0);
+		heights[idx] = (h > 0.0 ? h : 0.0);
+	}
 }
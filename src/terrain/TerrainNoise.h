@@ -7,48 +7,89 @@
 #include "perlin.h"
 #include "MathUtil.h"
 
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+#include <utility>
+
 namespace TerrainNoise {
 
+	// Fracdefs are fixed once a terrain is instanced, and nearly all of them
+	// have at most this many octaves. Sums over these octave counts use
+	// kernels with the count known at compile time, so the octave loop is
+	// fully unrolled; anything larger falls back to a runtime loop.
+	static constexpr int MAX_UNROLLED_OCTAVES = 16;
+
+	namespace detail {
+		// sum of octaves at a single point, with AbsNoise summing the
+		// absolute value of each octave instead
+		template <bool AbsNoise>
+		inline double point_octave_sum_loop(const fracdef_t &def, const int octaves, const double persistence, const vector3d &p)
+		{
+			double n = 0;
+			double amplitude = persistence;
+			double frequency = def.frequency;
+			for (int i = 0; i < octaves; i++) {
+				const double octave = noise(frequency * p);
+				n += amplitude * (AbsNoise ? fabs(octave) : octave);
+				amplitude *= persistence;
+				frequency *= def.lacunarity;
+			}
+			return n;
+		}
+
+		// identical arithmetic to point_octave_sum_loop, unrolled
+		template <bool AbsNoise, int Octaves>
+		inline double point_octave_sum_fixed(const fracdef_t &def, const double persistence, const vector3d &p)
+		{
+			double n = 0;
+			double amplitude = persistence;
+			double frequency = def.frequency;
+			for (int i = 0; i < Octaves; i++) {
+				const double octave = noise(frequency * p);
+				n += amplitude * (AbsNoise ? fabs(octave) : octave);
+				amplitude *= persistence;
+				frequency *= def.lacunarity;
+			}
+			return n;
+		}
+
+		template <bool AbsNoise, int... Octaves>
+		inline double point_octave_sum_dispatch(const fracdef_t &def, const int octaves, const double persistence, const vector3d &p, std::integer_sequence<int, Octaves...>)
+		{
+			using Kernel = double (*)(const fracdef_t &, double, const vector3d &);
+			static constexpr Kernel kernels[] = { &point_octave_sum_fixed<AbsNoise, Octaves + 1>... };
+			return kernels[octaves - 1](def, persistence, p);
+		}
+
+		template <bool AbsNoise>
+		inline double point_octave_sum(const fracdef_t &def, const int octaves, const double persistence, const vector3d &p)
+		{
+			if (octaves >= 1 && octaves <= MAX_UNROLLED_OCTAVES)
+				return point_octave_sum_dispatch<AbsNoise>(def, octaves, persistence, p, std::make_integer_sequence<int, MAX_UNROLLED_OCTAVES>());
+			return point_octave_sum_loop<AbsNoise>(def, octaves, persistence, p);
+		}
+	} // namespace detail
+
 	// octavenoise functions return range [0,1] if persistence = 0.5
 	inline double octavenoise(const fracdef_t &def, const double persistence, const vector3d &p)
 	{
 		//assert(persistence <= (1.0 / def.lacunarity));
-		double n = 0;
-		double amplitude = persistence;
-		double frequency = def.frequency;
-		for (int i = 0; i < def.octaves; i++) {
-			n += amplitude * noise(frequency * p);
-			amplitude *= persistence;
-			frequency *= def.lacunarity;
-		}
+		const double n = detail::point_octave_sum<false>(def, def.octaves, persistence, p);
 		return (n + 1.0) * 0.5;
 	}
 
 	inline double river_octavenoise(const fracdef_t &def, const double persistence, const vector3d &p)
 	{
 		//assert(persistence <= (1.0 / def.lacunarity));
-		double n = 0;
-		double amplitude = persistence;
-		double frequency = def.frequency;
-		for (int i = 0; i < def.octaves; i++) {
-			n += amplitude * fabs(noise(frequency * p));
-			amplitude *= persistence;
-			frequency *= def.lacunarity;
-		}
+		const double n = detail::point_octave_sum<true>(def, def.octaves, persistence, p);
 		return fabs(n);
 	}
 
 	inline double ridged_octavenoise(const fracdef_t &def, const double persistence, const vector3d &p)
 	{
 		//assert(persistence <= (1.0 / def.lacunarity));
-		double n = 0;
-		double amplitude = persistence;
-		double frequency = def.frequency;
-		for (int i = 0; i < def.octaves; i++) {
-			n += amplitude * noise(frequency * p);
-			amplitude *= persistence;
-			frequency *= def.lacunarity;
-		}
+		double n = detail::point_octave_sum<false>(def, def.octaves, persistence, p);
 		n = 1.0 - fabs(n);
 		n *= n;
 		return n;
@@ -57,42 +98,21 @@ namespace TerrainNoise {
 	inline double billow_octavenoise(const fracdef_t &def, const double persistence, const vector3d &p)
 	{
 		//assert(persistence <= (1.0 / def.lacunarity));
-		double n = 0;
-		double amplitude = persistence;
-		double frequency = def.frequency;
-		for (int i = 0; i < def.octaves; i++) {
-			n += amplitude * noise(frequency * p);
-			amplitude *= persistence;
-			frequency *= def.lacunarity;
-		}
+		const double n = detail::point_octave_sum<false>(def, def.octaves, persistence, p);
 		return (2.0 * fabs(n) - 1.0) + 1.0;
 	}
 
 	inline double voronoiscam_octavenoise(const fracdef_t &def, const double persistence, const vector3d &p)
 	{
 		//assert(persistence <= (1.0 / def.lacunarity));
-		double n = 0;
-		double amplitude = persistence;
-		double frequency = def.frequency;
-		for (int i = 0; i < def.octaves; i++) {
-			n += amplitude * noise(frequency * p);
-			amplitude *= persistence;
-			frequency *= def.lacunarity;
-		}
+		const double n = detail::point_octave_sum<false>(def, def.octaves, persistence, p);
 		return sqrt(10.0 * fabs(n));
 	}
 
 	inline double dunes_octavenoise(const fracdef_t &def, const double persistence, const vector3d &p)
 	{
 		//assert(persistence <= (1.0 / def.lacunarity));
-		double n = 0;
-		double amplitude = persistence;
-		double frequency = def.frequency;
-		for (int i = 0; i < 3; i++) {
-			n += amplitude * noise(frequency * p);
-			amplitude *= persistence;
-			frequency *= def.lacunarity;
-		}
+		const double n = detail::point_octave_sum_fixed<false, 3>(def, persistence, p);
 		return 1.0 - fabs(n);
 	}
 
@@ -169,6 +189,107 @@ namespace TerrainNoise {
 		return sqrt(10.0 * fabs(n));
 	}
 
+	// Batched versions of the fracdef octavenoise functions, evaluating count
+	// points at once. persistence is either a single value for all points or
+	// an array with one value per point. Results are identical to calling the
+	// single point versions for each point.
+	static constexpr size_t NOISE_BATCH_SIZE = 64;
+
+	namespace detail {
+		inline double persistence_at(const double persistence, size_t) { return persistence; }
+		inline double persistence_at(const double *persistence, size_t idx) { return persistence[idx]; }
+
+		// sum of octaves over up to NOISE_BATCH_SIZE points, with AbsNoise
+		// summing the absolute value of each octave instead
+		template <bool AbsNoise, typename Persistence>
+		inline void octave_sum(const fracdef_t &def, int octaves, Persistence persistence, const vector3d *p, double *n, size_t count)
+		{
+			assert(count <= NOISE_BATCH_SIZE);
+			double x[NOISE_BATCH_SIZE], y[NOISE_BATCH_SIZE], z[NOISE_BATCH_SIZE];
+			double octave[NOISE_BATCH_SIZE], amplitude[NOISE_BATCH_SIZE];
+
+			for (size_t idx = 0; idx < count; idx++) {
+				n[idx] = 0;
+				amplitude[idx] = persistence_at(persistence, idx);
+			}
+
+			double frequency = def.frequency;
+			for (int i = 0; i < octaves; i++) {
+				for (size_t idx = 0; idx < count; idx++) {
+					x[idx] = p[idx].x * frequency;
+					y[idx] = p[idx].y * frequency;
+					z[idx] = p[idx].z * frequency;
+				}
+
+				noise(x, y, z, octave, count);
+
+				for (size_t idx = 0; idx < count; idx++) {
+					n[idx] += amplitude[idx] * (AbsNoise ? fabs(octave[idx]) : octave[idx]);
+					amplitude[idx] *= persistence_at(persistence, idx);
+				}
+				frequency *= def.lacunarity;
+			}
+		}
+
+		// evaluate octave_sum over count points in chunks, then apply op to each sum
+		template <bool AbsNoise, typename Persistence, typename Op>
+		inline void octave_batch(const fracdef_t &def, int octaves, Persistence persistence, const vector3d *p, double *out, size_t count, Op op)
+		{
+			for (size_t base = 0; base < count; base += NOISE_BATCH_SIZE) {
+				const size_t num = std::min(count - base, NOISE_BATCH_SIZE);
+				if constexpr (std::is_pointer_v<Persistence>)
+					octave_sum<AbsNoise>(def, octaves, persistence + base, &p[base], &out[base], num);
+				else
+					octave_sum<AbsNoise>(def, octaves, persistence, &p[base], &out[base], num);
+
+				for (size_t idx = base; idx < base + num; idx++)
+					out[idx] = op(out[idx]);
+			}
+		}
+	} // namespace detail
+
+	template <typename Persistence>
+	inline void octavenoise(const fracdef_t &def, Persistence persistence, const vector3d *p, double *out, size_t count)
+	{
+		detail::octave_batch<false>(def, def.octaves, persistence, p, out, count,
+			[](double n) { return (n + 1.0) * 0.5; });
+	}
+
+	template <typename Persistence>
+	inline void river_octavenoise(const fracdef_t &def, Persistence persistence, const vector3d *p, double *out, size_t count)
+	{
+		detail::octave_batch<true>(def, def.octaves, persistence, p, out, count,
+			[](double n) { return fabs(n); });
+	}
+
+	template <typename Persistence>
+	inline void ridged_octavenoise(const fracdef_t &def, Persistence persistence, const vector3d *p, double *out, size_t count)
+	{
+		detail::octave_batch<false>(def, def.octaves, persistence, p, out, count,
+			[](double n) { n = 1.0 - fabs(n); n *= n; return n; });
+	}
+
+	template <typename Persistence>
+	inline void billow_octavenoise(const fracdef_t &def, Persistence persistence, const vector3d *p, double *out, size_t count)
+	{
+		detail::octave_batch<false>(def, def.octaves, persistence, p, out, count,
+			[](double n) { return (2.0 * fabs(n) - 1.0) + 1.0; });
+	}
+
+	template <typename Persistence>
+	inline void voronoiscam_octavenoise(const fracdef_t &def, Persistence persistence, const vector3d *p, double *out, size_t count)
+	{
+		detail::octave_batch<false>(def, def.octaves, persistence, p, out, count,
+			[](double n) { return sqrt(10.0 * fabs(n)); });
+	}
+
+	template <typename Persistence>
+	inline void dunes_octavenoise(const fracdef_t &def, Persistence persistence, const vector3d *p, double *out, size_t count)
+	{
+		detail::octave_batch<false>(def, 3, persistence, p, out, count,
+			[](double n) { return 1.0 - fabs(n); });
+	}
+
 	// not really a noise function but no better place for it
 	inline vector3d interpolate_color(const double n, const vector3d &start, const vector3d &end)
 	{
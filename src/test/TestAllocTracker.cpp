@@ -0,0 +1,62 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "core/AllocTracker.h"
+
+#include <algorithm>
+#include <thread>
+#include "doctest.h"
+
+namespace AllocTracker = Perf::AllocTracker;
+
+static const AllocTracker::TagStats *FindTag(const char *name)
+{
+	const std::vector<AllocTracker::TagStats> &tags = AllocTracker::GetFrameStats();
+	auto iter = std::find_if(tags.begin(), tags.end(), [&](const AllocTracker::TagStats &t) {
+		return t.name == name;
+	});
+	return iter != tags.end() ? &*iter : nullptr;
+}
+
+static const char OUTER[] = "Alloc Outer";
+static const char INNER[] = "Alloc Inner";
+
+TEST_CASE("AllocTracker")
+{
+	AllocTracker::EndFrame();
+
+	// counted against the innermost tag, from any thread
+	std::thread([]() {
+		AllocTracker::PushTag(OUTER);
+		AllocTracker::RecordAlloc(100);
+		AllocTracker::PushTag(INNER);
+		AllocTracker::RecordAlloc(10);
+		AllocTracker::RecordAlloc(20);
+		AllocTracker::PopTag();
+		AllocTracker::RecordAlloc(200);
+		AllocTracker::PopTag();
+	}).join();
+
+	AllocTracker::EndFrame();
+
+	const AllocTracker::TagStats *outer = FindTag(OUTER);
+	const AllocTracker::TagStats *inner = FindTag(INNER);
+	REQUIRE(outer != nullptr);
+	REQUIRE(inner != nullptr);
+	CHECK(outer->count == 2);
+	CHECK(outer->bytes == 300);
+	CHECK(inner->count == 2);
+	CHECK(inner->bytes == 30);
+
+	// each frame only has what was allocated since the last
+	AllocTracker::PushTag(INNER);
+	AllocTracker::RecordAlloc(5);
+	AllocTracker::PopTag();
+	AllocTracker::EndFrame();
+
+	CHECK(FindTag(OUTER) == nullptr);
+	inner = FindTag(INNER);
+	REQUIRE(inner != nullptr);
+	CHECK(inner->count == 1);
+	CHECK(inner->bytes == 5);
+}
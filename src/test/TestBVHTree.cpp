@@ -0,0 +1,171 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "collider/BVHTree.h"
+#include "core/TaskGraph.h"
+#include "doctest/doctest.h"
+
+#include <random>
+
+// enough objects to take the parallel build path
+static constexpr uint32_t NUM_TEST_OBJS = 20000;
+
+static std::vector<AABBd> MakeTestAabbs(AABBd &bounds)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<double> pos(-1000.0, 1000.0);
+	std::uniform_real_distribution<double> size(0.1, 10.0);
+
+	std::vector<AABBd> aabbs(NUM_TEST_OBJS);
+	bounds = AABBd::Invalid();
+	for (AABBd &aabb : aabbs) {
+		const vector3d center(pos(rng), pos(rng), pos(rng));
+		const vector3d extent(size(rng), size(rng), size(rng));
+		aabb = AABBd{ center - extent, center + extent };
+		bounds.Update(aabb);
+	}
+
+	return aabbs;
+}
+
+template <typename Tree>
+static void CheckTreeValid(const Tree &tree, const std::vector<AABBd> &aabbs)
+{
+	REQUIRE(tree.GetNumNodes() == 2 * aabbs.size() - 1);
+
+	uint32_t maxHeight = 0;
+	std::vector<uint32_t> leafSeen(aabbs.size(), 0);
+	for (uint32_t idx = 0; idx < tree.GetNumNodes(); idx++) {
+		const SingleBVHTreeBase::Node *node = tree.GetNode(idx);
+		maxHeight = std::max(maxHeight, node->treeHeight);
+
+		if (node->kids[0] == 0) {
+			leafSeen[node->leafIndex]++;
+			continue;
+		}
+
+		for (uint32_t kid : node->kids) {
+			const SingleBVHTreeBase::Node *kidNode = tree.GetNode(kid);
+			CHECK(kidNode->treeHeight == node->treeHeight + 1);
+			CHECK(kidNode->aabb.min >= node->aabb.min);
+			CHECK(kidNode->aabb.max <= node->aabb.max);
+		}
+	}
+
+	CHECK(tree.GetHeight() == maxHeight);
+	CHECK(std::count(leafSeen.begin(), leafSeen.end(), 1) == long(aabbs.size()));
+}
+
+template <typename Tree>
+static void CheckTreesEqual(const Tree &a, const Tree &b)
+{
+	REQUIRE(a.GetNumNodes() == b.GetNumNodes());
+	CHECK(a.GetHeight() == b.GetHeight());
+
+	uint32_t numMismatched = 0;
+	for (uint32_t idx = 0; idx < a.GetNumNodes(); idx++) {
+		const SingleBVHTreeBase::Node *na = a.GetNode(idx);
+		const SingleBVHTreeBase::Node *nb = b.GetNode(idx);
+		const bool equal = na->aabb.min == nb->aabb.min && na->aabb.max == nb->aabb.max &&
+			na->kids[0] == nb->kids[0] && na->kids[1] == nb->kids[1] &&
+			na->leafIndex == nb->leafIndex && na->treeHeight == nb->treeHeight;
+		numMismatched += !equal;
+	}
+
+	CHECK(numMismatched == 0);
+}
+
+template <typename Tree>
+static void TestParallelBuild(TaskGraph *graph)
+{
+	AABBd bounds;
+	std::vector<AABBd> aabbs = MakeTestAabbs(bounds);
+
+	Tree serialTree;
+	SingleBVHTreeBase::SetTaskGraph(nullptr);
+	serialTree.Build(bounds, aabbs.data(), aabbs.size());
+	CheckTreeValid(serialTree, aabbs);
+
+	Tree parallelTree;
+	SingleBVHTreeBase::SetTaskGraph(graph);
+	parallelTree.Build(bounds, aabbs.data(), aabbs.size());
+	SingleBVHTreeBase::SetTaskGraph(nullptr);
+
+	// the parallel build must produce exactly the same tree
+	CheckTreesEqual(serialTree, parallelTree);
+}
+
+TEST_CASE("BVH Tree Refit")
+{
+	AABBd bounds;
+	std::vector<AABBd> aabbs = MakeTestAabbs(bounds);
+
+	SingleBVHTree tree;
+	tree.Build(bounds, aabbs.data(), aabbs.size());
+
+	// move every object a short, random distance
+	std::mt19937 rng(5678);
+	std::uniform_real_distribution<double> offset(-20.0, 20.0);
+	for (AABBd &aabb : aabbs) {
+		const vector3d delta(offset(rng), offset(rng), offset(rng));
+		aabb = AABBd{ aabb.min + delta, aabb.max + delta };
+	}
+
+	const double sah = tree.Refit(aabbs.data());
+	CheckTreeValid(tree, aabbs);
+	CHECK(sah == doctest::Approx(tree.CalculateSAH()));
+
+	for (uint32_t idx = 0; idx < tree.GetNumNodes(); idx++) {
+		const SingleBVHTreeBase::Node *node = tree.GetNode(idx);
+		if (node->kids[0] == 0) {
+			CHECK(node->aabb.min == aabbs[node->leafIndex].min);
+			CHECK(node->aabb.max == aabbs[node->leafIndex].max);
+		}
+	}
+}
+
+TEST_CASE("BVH Tree Build")
+{
+	TaskGraph *graph = new TaskGraph();
+	graph->SetWorkerThreads(3);
+
+	SUBCASE("SingleBVHTree")
+	{
+		TestParallelBuild<SingleBVHTree>(graph);
+	}
+
+	SUBCASE("BinnedAreaBVHTree")
+	{
+		TestParallelBuild<BinnedAreaBVHTree>(graph);
+	}
+
+	delete graph;
+}
+
+TEST_CASE("Compact BVH Tree")
+{
+	AABBd bounds;
+	std::vector<AABBd> aabbs = MakeTestAabbs(bounds);
+
+	BinnedAreaBVHTree tree;
+	tree.Build(bounds, aabbs.data(), aabbs.size());
+
+	CompactBVHTree compactTree;
+	compactTree.Build(tree);
+	REQUIRE(compactTree.GetNumNodes() == tree.GetNumNodes());
+	CHECK(compactTree.GetHeight() == tree.GetHeight());
+
+	for (uint32_t idx = 0; idx < tree.GetNumNodes(); idx++) {
+		const SingleBVHTreeBase::Node *node = tree.GetNode(idx);
+		const CompactBVHTree::Node *compactNode = compactTree.GetNode(idx);
+
+		CHECK(compactNode->firstKid == node->kids[0]);
+		if (compactNode->IsLeaf())
+			CHECK(compactNode->leafIndex == node->leafIndex);
+
+		// single precision bounds must never be smaller than the originals
+		const AABBd compactAabb = compactNode->GetAabb();
+		CHECK(compactAabb.min <= node->aabb.min);
+		CHECK(compactAabb.max >= node->aabb.max);
+	}
+}
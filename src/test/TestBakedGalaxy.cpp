@@ -0,0 +1,106 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "galaxy/BakedGalaxy.h"
+#include "doctest/doctest.h"
+
+static BakedGalaxy::SystemData make_system(const std::string &name, int seed)
+{
+	BakedGalaxy::SystemData sys;
+	sys.name = name;
+	sys.pos = vector3f(1.0f, 2.0f, float(seed));
+	sys.numStars = 2;
+	sys.starType[0] = SystemBody::TYPE_STAR_G;
+	sys.starType[1] = SystemBody::TYPE_STAR_M;
+	sys.seed = seed;
+	sys.explored = seed % 2;
+	sys.population = fixed(seed, 100);
+	sys.factionIdx = seed;
+	return sys;
+}
+
+// a 2 x 1 x 2 box at (-1, 0, 3) with three systems in its second sector and
+// one in its last
+static std::vector<char> bake_box()
+{
+	BakedGalaxy::Builder builder("legacy", 1, 42, -1, 0, 3, 2, 1, 2);
+	builder.EndSector();
+
+	BakedGalaxy::SystemData custom = make_system("Sol", 7);
+	custom.isCustom = true;
+	builder.AddSystem(custom);
+	builder.AddSystem(make_system("Lave", 8));
+	builder.AddSystem(make_system("", 9));
+	builder.EndSector();
+
+	builder.EndSector();
+
+	builder.AddSystem(make_system("Diso", 10));
+	builder.EndSector();
+	return builder.Finish();
+}
+
+TEST_CASE("BakedGalaxy")
+{
+	SUBCASE("reads back what was baked")
+	{
+		std::unique_ptr<BakedGalaxy> baked = BakedGalaxy::FromBuffer(bake_box(), "legacy", 1, 42);
+		REQUIRE(baked);
+		CHECK(baked->GetNumSystems() == 4);
+
+		Uint32 first, count;
+		REQUIRE(baked->FindSector(-1, 0, 3, first, count));
+		CHECK(count == 0);
+
+		REQUIRE(baked->FindSector(-1, 0, 4, first, count));
+		REQUIRE(count == 3);
+		CHECK(baked->IsCustom(first));
+		CHECK_FALSE(baked->IsCustom(first + 1));
+		CHECK(std::string(baked->GetName(first)) == "Sol");
+		CHECK(std::string(baked->GetName(first + 1)) == "Lave");
+		CHECK(std::string(baked->GetName(first + 2)) == "");
+
+		const Uint32 lave = first + 1;
+		CHECK(baked->GetPosition(lave) == vector3f(1.0f, 2.0f, 8.0f));
+		CHECK(baked->GetNumStars(lave) == 2);
+		CHECK(baked->GetStarType(lave, 0) == SystemBody::TYPE_STAR_G);
+		CHECK(baked->GetStarType(lave, 1) == SystemBody::TYPE_STAR_M);
+		CHECK(baked->GetSeed(lave) == 8);
+		CHECK_FALSE(baked->IsExplored(lave));
+		CHECK(baked->IsExplored(first));
+		CHECK(baked->GetPopulation(lave) == fixed(8, 100));
+		CHECK(baked->GetFactionIndex(lave) == 8);
+
+		REQUIRE(baked->FindSector(0, 0, 4, first, count));
+		REQUIRE(count == 1);
+		CHECK(std::string(baked->GetName(first)) == "Diso");
+	}
+
+	SUBCASE("sectors outside the box aren't baked")
+	{
+		std::unique_ptr<BakedGalaxy> baked = BakedGalaxy::FromBuffer(bake_box(), "legacy", 1, 42);
+		REQUIRE(baked);
+
+		Uint32 first, count;
+		CHECK_FALSE(baked->FindSector(-2, 0, 3, first, count));
+		CHECK_FALSE(baked->FindSector(1, 0, 3, first, count));
+		CHECK_FALSE(baked->FindSector(0, 1, 3, first, count));
+		CHECK_FALSE(baked->FindSector(0, 0, 5, first, count));
+	}
+
+	SUBCASE("isn't used by a different galaxy")
+	{
+		CHECK_FALSE(BakedGalaxy::FromBuffer(bake_box(), "other", 1, 42));
+		CHECK_FALSE(BakedGalaxy::FromBuffer(bake_box(), "legacy", 0, 42));
+		CHECK_FALSE(BakedGalaxy::FromBuffer(bake_box(), "legacy", 1, 43));
+	}
+
+	SUBCASE("rejects truncated files")
+	{
+		std::vector<char> data = bake_box();
+		while (!data.empty()) {
+			data.pop_back();
+			CHECK_FALSE(BakedGalaxy::FromBuffer(data, "legacy", 1, 42));
+		}
+	}
+}
@@ -0,0 +1,93 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "BinaryArchive.h"
+#include "GameSaveError.h"
+#include "Json.h"
+#include "doctest/doctest.h"
+
+static std::string MakeTestArchive()
+{
+	BinaryArchiveWriter ar("test", 2);
+	ar.Bool(true);
+	ar.Int32(-12345);
+	ar.UInt32(0xdeadbeef);
+	ar.Float(1.5f);
+	ar.Double(-1e300);
+	ar.String("Sol");
+	ar.String("");
+	ar.Vector3d(vector3d(1.0, -2.0, 3.25));
+	ar.Matrix3x3d(matrix3x3d::RotateY(0.5));
+	return ar.GetData();
+}
+
+TEST_CASE("BinaryArchive")
+{
+	const std::string data = MakeTestArchive();
+
+	SUBCASE("values read back as written")
+	{
+		BinaryArchiveReader ar(data, "test", 2);
+		CHECK(ar.GetVersion() == 2);
+		CHECK(ar.Bool() == true);
+		CHECK(ar.Int32() == -12345);
+		CHECK(ar.UInt32() == 0xdeadbeef);
+		CHECK(ar.Float() == 1.5f);
+		CHECK(ar.Double() == -1e300);
+		CHECK(ar.String() == "Sol");
+		CHECK(ar.String().empty());
+		CHECK(ar.Vector3d() == vector3d(1.0, -2.0, 3.25));
+		const matrix3x3d m = ar.Matrix3x3d();
+		const matrix3x3d expected = matrix3x3d::RotateY(0.5);
+		for (int i = 0; i < 9; i++)
+			CHECK(m[i] == expected[i]);
+		CHECK(ar.AtEnd());
+	}
+
+	SUBCASE("and through Json")
+	{
+		BinaryArchiveWriter writer("test", 1);
+		writer.String("through json");
+		Json jsonObj;
+		writer.ToJson(jsonObj);
+		CHECK(jsonObj.is_string());
+
+		const std::string readBack = BinaryArchiveReader::FromJson(jsonObj);
+		BinaryArchiveReader ar(readBack, "test", 1);
+		CHECK(ar.String() == "through json");
+		CHECK(ar.AtEnd());
+	}
+
+	SUBCASE("an older version is accepted")
+	{
+		BinaryArchiveReader ar(data, "test", 3);
+		CHECK(ar.GetVersion() == 2);
+	}
+
+	SUBCASE("another schema or a newer version is not")
+	{
+		CHECK_THROWS_AS(BinaryArchiveReader(data, "other", 2), SavedGameCorruptException);
+		CHECK_THROWS_AS(BinaryArchiveReader(data, "test", 1), SavedGameCorruptException);
+		CHECK_THROWS_AS(BinaryArchiveReader::FromJson(Json(42)), SavedGameCorruptException);
+	}
+
+	SUBCASE("reading the wrong type fails")
+	{
+		BinaryArchiveReader ar(data, "test", 2);
+		CHECK_THROWS_AS(ar.Int32(), SavedGameCorruptException);
+	}
+
+	SUBCASE("reading past the end fails")
+	{
+		BinaryArchiveReader ar(std::string_view(data).substr(0, data.size() - 4), "test", 2);
+		ar.Bool();
+		ar.Int32();
+		ar.UInt32();
+		ar.Float();
+		ar.Double();
+		ar.String();
+		ar.String();
+		ar.Vector3d();
+		CHECK_THROWS_AS(ar.Matrix3x3d(), SavedGameCorruptException);
+	}
+}
@@ -0,0 +1,62 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "CameraPath.h"
+#include "Json.h"
+
+#include "doctest.h"
+
+TEST_CASE("Camera Path")
+{
+	CameraPath path;
+	std::string error;
+
+	SUBCASE("Malformed paths are rejected")
+	{
+		CHECK_FALSE(path.Load(Json::parse(R"({ "keys": [] })"), error));
+		CHECK_FALSE(path.Load(Json::parse(R"({ "keys": [ { "time": 0 } ] })"), error));
+		CHECK_FALSE(path.Load(Json::parse(R"({ "keys": [ { "time": 0, "body": "Mars", "position": [1, 2] } ] })"), error));
+		CHECK_FALSE(path.Load(Json::parse(R"({ "keys": [
+			{ "time": 5, "body": "Mars" },
+			{ "time": 1, "body": "Mars" } ] })"), error));
+	}
+
+	SUBCASE("Linear moves between keys")
+	{
+		REQUIRE(path.Load(Json::parse(R"({ "time_step": 0.5, "keys": [
+			{ "time": 0, "body": "Mars", "position": [0, 0, 100] },
+			{ "time": 10, "body": "Mars", "position": [0, 0, 200] } ] })"), error));
+
+		CHECK(path.GetTimeStep() == 0.5);
+		CHECK(path.GetDuration() == 10.0);
+
+		CHECK(path.Evaluate(-1.0).position.z == doctest::Approx(100.0));
+		CHECK(path.Evaluate(5.0).position.z == doctest::Approx(150.0));
+		CHECK(path.Evaluate(20.0).position.z == doctest::Approx(200.0));
+
+		// looking at the origin, down -z
+		const CameraPath::Sample sample = path.Evaluate(5.0);
+		CHECK(*sample.body == "Mars");
+		CHECK(sample.orient.VectorZ().z == doctest::Approx(1.0));
+	}
+
+	SUBCASE("Logarithmic distance")
+	{
+		REQUIRE(path.Load(Json::parse(R"({ "keys": [
+			{ "time": 0, "body": "Mars", "position": [0, 0, 1e6], "log_distance": true },
+			{ "time": 10, "body": "Mars", "position": [0, 0, 1e2] } ] })"), error));
+
+		CHECK(path.Evaluate(5.0).position.z == doctest::Approx(1e4));
+	}
+
+	SUBCASE("Cuts between bodies")
+	{
+		REQUIRE(path.Load(Json::parse(R"({ "keys": [
+			{ "time": 0, "body": "Mars", "position": [0, 0, 100] },
+			{ "time": 10, "body": "Phobos", "position": [0, 0, 50] } ] })"), error));
+
+		CHECK(*path.Evaluate(5.0).body == "Mars");
+		CHECK(path.Evaluate(5.0).position.z == doctest::Approx(100.0));
+		CHECK(*path.Evaluate(10.0).body == "Phobos");
+	}
+}
@@ -0,0 +1,59 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "CollMesh.h"
+#include "collider/GeomTree.h"
+#include "doctest/doctest.h"
+#include "scenegraph/Serializer.h"
+
+#include <atomic>
+#include <thread>
+
+// a single triangle
+static GeomTree *MakeTriangleTree()
+{
+	const std::vector<vector3f> vertices = { vector3f(0.f, 0.f, 0.f), vector3f(1.f, 0.f, 0.f), vector3f(0.f, 1.f, 0.f) };
+	const std::vector<Uint32> indices = { 0, 1, 2 };
+	const std::vector<Uint32> triFlags = { 0 };
+	return new GeomTree(3, 1, vertices, indices, triFlags);
+}
+
+TEST_CASE("CollMesh lazy trees")
+{
+	RefCountedPtr<CollMesh> collMesh(new CollMesh());
+	std::atomic<int> builds = 0;
+	collMesh->SetTreeBuilder([&builds](CollMesh &cm) {
+		builds++;
+		cm.SetGeomTree(MakeTriangleTree());
+		cm.AddDynGeomTree(MakeTriangleTree());
+	});
+
+	CHECK(!collMesh->HasTrees());
+	CHECK(builds == 0);
+
+	// built once, by whichever thread asks first
+	std::thread other([&]() { CHECK(collMesh->GetGeomTree() != nullptr); });
+	CHECK(collMesh->GetDynGeomTrees().size() == 1);
+	other.join();
+
+	CHECK(builds == 1);
+	CHECK(collMesh->HasTrees());
+	CHECK(collMesh->GetGeomTreeNumTris() == 1);
+
+	SUBCASE("trees survive a save and lazy load")
+	{
+		Serializer::Writer wr;
+		collMesh->SaveTrees(wr);
+		const std::string data = wr.GetData();
+
+		RefCountedPtr<CollMesh> loaded(new CollMesh());
+		loaded->SetTreeBuilder([&data](CollMesh &cm) {
+			Serializer::Reader rd(ByteRange(data.data(), data.size()));
+			cm.LoadTrees(rd);
+		});
+
+		CHECK(loaded->GetGeomTreeNumTris() == 1);
+		CHECK(loaded->GetGeomTreeVertices().size() == 3);
+		CHECK(loaded->GetDynGeomTrees().size() == 1);
+	}
+}
@@ -0,0 +1,73 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "graphics/DynamicResolution.h"
+#include "doctest/doctest.h"
+
+using namespace Graphics;
+
+TEST_CASE("DynamicResolution")
+{
+	DynamicResolution::Settings settings;
+	settings.minScale = 0.5f;
+	settings.maxScale = 1.f;
+	settings.targetFrameTime = 10.0;
+
+	DynamicResolution dynres(settings);
+	CHECK(dynres.GetScale() == 1.f);
+
+	SUBCASE("stays put within budget or without measurements")
+	{
+		for (int i = 0; i < 100; i++) {
+			dynres.Update(9.0);
+			dynres.Update(-1.0);
+		}
+		CHECK(dynres.GetScale() == 1.f);
+	}
+
+	SUBCASE("drops to the scale that meets the budget")
+	{
+		// four times the pixels it can afford
+		dynres.Update(40.0);
+		CHECK(dynres.GetScale() == doctest::Approx(0.5f));
+		CHECK(dynres.GetScaledSize(1920) == 960);
+	}
+
+	SUBCASE("never leaves its bounds")
+	{
+		dynres.Update(1000.0);
+		CHECK(dynres.GetScale() == 0.5f);
+
+		for (int i = 0; i < 1000; i++)
+			dynres.Update(1.0);
+		CHECK(dynres.GetScale() == 1.f);
+	}
+
+	SUBCASE("ignores frames drawn at the old scale")
+	{
+		dynres.Update(20.0);
+		const float scale = dynres.GetScale();
+		CHECK(scale < 1.f);
+
+		for (uint32_t i = 0; i < DynamicResolution::SETTLE_FRAMES; i++)
+			dynres.Update(20.0);
+		CHECK(dynres.GetScale() == scale);
+
+		dynres.Update(20.0);
+		CHECK(dynres.GetScale() < scale);
+	}
+
+	SUBCASE("creeps back up once well under budget")
+	{
+		dynres.Update(40.0);
+		for (uint32_t i = 0; i < DynamicResolution::SETTLE_FRAMES; i++)
+			dynres.Update(5.0);
+
+		for (uint32_t i = 0; i < DynamicResolution::RAISE_FRAMES - 1; i++)
+			dynres.Update(5.0);
+		CHECK(dynres.GetScale() == doctest::Approx(0.5f));
+
+		dynres.Update(5.0);
+		CHECK(dynres.GetScale() == doctest::Approx(0.5f + DynamicResolution::RAISE_STEP));
+	}
+}
@@ -0,0 +1,187 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "galaxy/FactionClaimGrid.h"
+#include "doctest/doctest.h"
+#include "profiler/Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+static const float SECTOR_SIZE = 8.0f;
+
+// factions scattered about a few hundred light years of the origin, some with
+// a claimed sector or two far outside their radius and one without a homeworld
+static std::vector<FactionClaimGrid::Territory> MakeTestTerritories(uint32_t numFactions)
+{
+	std::mt19937 rng(4321);
+	std::uniform_real_distribution<float> home(-400.0f, 400.0f);
+	std::uniform_real_distribution<float> radius(-20.0f, 150.0f);
+	std::uniform_int_distribution<int> claim(-80, 80);
+
+	std::vector<FactionClaimGrid::Territory> territories(numFactions);
+	for (uint32_t idx = 0; idx < numFactions; idx++) {
+		FactionClaimGrid::Territory &ter = territories[idx];
+		ter.id = idx;
+		if (idx == numFactions / 2)
+			continue;
+
+		ter.bounded = true;
+		ter.homePos = vector3f(home(rng), home(rng), home(rng) / 4.0f);
+		ter.homeSector = SystemPath(int(std::floor(ter.homePos.x / SECTOR_SIZE)),
+			int(std::floor(ter.homePos.y / SECTOR_SIZE)), int(std::floor(ter.homePos.z / SECTOR_SIZE)));
+		ter.radius = radius(rng);
+		if (idx % 5 == 0)
+			ter.claims.push_back(SystemPath(claim(rng), claim(rng), claim(rng)));
+	}
+	return territories;
+}
+
+// whether any point of the sector is within the territory
+static bool MightOwn(const FactionClaimGrid::Territory &ter, int sx, int sy, int sz)
+{
+	if (!ter.bounded || ter.homeSector.IsSameSector(SystemPath(sx, sy, sz)))
+		return true;
+	for (const SystemPath &claim : ter.claims) {
+		if (claim.IsSameSector(SystemPath(sx, sy, sz)))
+			return true;
+	}
+
+	const vector3f lo = SECTOR_SIZE * vector3f(float(sx), float(sy), float(sz));
+	vector3f nearest;
+	for (int i = 0; i < 3; i++)
+		nearest[i] = std::max(lo[i], std::min(ter.homePos[i], lo[i] + SECTOR_SIZE));
+	return (nearest - ter.homePos).Length() < ter.radius;
+}
+
+TEST_CASE("FactionClaimGrid")
+{
+	const std::vector<FactionClaimGrid::Territory> territories = MakeTestTerritories(40);
+	FactionClaimGrid grid(SECTOR_SIZE);
+	grid.Build(territories);
+	REQUIRE(grid.GetNumCells() > 0);
+
+	SUBCASE("candidates include every faction that might own the sector, in order")
+	{
+		uint32_t numMissing = 0;
+		uint32_t numUnordered = 0;
+		size_t numCandidates = 0;
+		for (int sx = -90; sx <= 90; sx += 3) {
+			for (int sy = -90; sy <= 90; sy += 3) {
+				for (int sz = -30; sz <= 30; sz += 2) {
+					const Uint32 *first, *last;
+					grid.GetCandidates(sx, sy, sz, first, last);
+					numCandidates += last - first;
+					for (const Uint32 *it = first; it + 1 < last; ++it)
+						numUnordered += it[0] >= it[1];
+
+					for (const FactionClaimGrid::Territory &ter : territories) {
+						if (MightOwn(ter, sx, sy, sz) && std::find(first, last, ter.id) == last)
+							numMissing++;
+					}
+				}
+			}
+		}
+		CHECK(numMissing == 0);
+		CHECK(numUnordered == 0);
+		// and it does leave most of them out
+		CHECK(numCandidates < size_t(61 * 61 * 31) * territories.size() / 4);
+	}
+
+	SUBCASE("outside the grid only the unbounded faction is a candidate")
+	{
+		const Uint32 *first, *last;
+		grid.GetCandidates(10000, 0, 0, first, last);
+		REQUIRE(last - first == 1);
+		CHECK(*first == territories.size() / 2);
+	}
+
+	SUBCASE("without territories every lookup is empty")
+	{
+		FactionClaimGrid empty(SECTOR_SIZE);
+		empty.Build({});
+		const Uint32 *first, *last;
+		empty.GetCandidates(0, 0, 0, first, last);
+		CHECK(first == last);
+	}
+}
+
+// Nearest claimant microbenchmark over the systems of a 50x50x10 block of
+// sectors, against the two by two by two octant boxes the grid replaced.
+// This is skipped by default; invoke it with:
+//   unittest -tc="FactionClaimGrid Benchmark" --no-skip
+TEST_CASE("FactionClaimGrid Benchmark" * doctest::skip())
+{
+	printf("%8s %16s %16s\n", "factions", "octant systems/s", "grid systems/s");
+
+	for (uint32_t numFactions : { 20, 80, 320 }) {
+		const std::vector<FactionClaimGrid::Territory> territories = MakeTestTerritories(numFactions);
+
+		// a dozen systems in each sector, as the random generator makes near the core
+		std::mt19937 rng(99);
+		std::uniform_real_distribution<float> coord(0.0f, SECTOR_SIZE);
+		std::vector<std::pair<SystemPath, vector3f>> systems;
+		for (int sx = -25; sx < 25; sx++)
+			for (int sy = -25; sy < 25; sy++)
+				for (int sz = -5; sz < 5; sz++)
+					for (int i = 0; i < 12; i++)
+						systems.emplace_back(SystemPath(sx, sy, sz, i),
+							SECTOR_SIZE * vector3f(float(sx), float(sy), float(sz)) + vector3f(coord(rng), coord(rng), coord(rng)));
+
+		// the nearest faction containing the system, as FactionsDatabase::GetNearestClaimant
+		auto nearest = [&](const std::pair<SystemPath, vector3f> &sys, const Uint32 *first, const Uint32 *last) {
+			Uint32 result = ~0u;
+			float closest = HUGE_VAL;
+			for (const Uint32 *it = first; it != last; ++it) {
+				const FactionClaimGrid::Territory &ter = territories[*it];
+				const float dist = ter.bounded ? (ter.homePos - sys.second).Length() : HUGE_VAL;
+				if ((!ter.bounded || dist < ter.radius) && dist <= closest) {
+					closest = dist;
+					result = *it;
+				}
+			}
+			return result;
+		};
+
+		// the previous approach: each faction in every octant its bounding cube touches
+		std::vector<Uint32> octbox[2][2][2];
+		for (const FactionClaimGrid::Territory &ter : territories) {
+			for (int i = 0; i < 8; i++) {
+				const vector3f corner = ter.homePos + ter.radius * vector3f(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+				std::vector<Uint32> &box = ter.bounded ?
+					octbox[Sint32(corner.x) >= 0][Sint32(corner.y) >= 0][Sint32(corner.z) >= 0] :
+					octbox[i & 1][(i >> 1) & 1][(i >> 2) & 1];
+				if (box.empty() || box.back() != ter.id)
+					box.push_back(ter.id);
+			}
+		}
+
+		Profiler::Clock clock{};
+		Uint64 octantSum = 0;
+		clock.Start();
+		for (const auto &sys : systems) {
+			const std::vector<Uint32> &box = octbox[sys.first.sectorX >= 0][sys.first.sectorY >= 0][sys.first.sectorZ >= 0];
+			octantSum += nearest(sys, box.data(), box.data() + box.size());
+		}
+		clock.Stop();
+		const double octantRate = systems.size() / (clock.milliseconds() / 1000.0);
+
+		clock.Reset();
+		FactionClaimGrid grid(SECTOR_SIZE);
+		grid.Build(territories);
+		Uint64 gridSum = 0;
+		clock.Start();
+		for (const auto &sys : systems) {
+			const Uint32 *first, *last;
+			grid.GetCandidates(sys.first.sectorX, sys.first.sectorY, sys.first.sectorZ, first, last);
+			gridSum += nearest(sys, first, last);
+		}
+		clock.Stop();
+		const double gridRate = systems.size() / (clock.milliseconds() / 1000.0);
+
+		printf("%8u %16.0f %16.0f (%zu systems, %s)\n", numFactions, octantRate, gridRate, systems.size(),
+			octantSum == gridSum ? "same owners" : "DIFFERENT OWNERS");
+	}
+}
@@ -0,0 +1,71 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "galaxy/FactionMask.h"
+#include "doctest/doctest.h"
+
+#include <climits>
+#include <vector>
+
+static const Uint32 NO_FACTION_IDX = UINT_MAX; // Faction::BAD_FACTION_IDX
+
+TEST_CASE("FactionMask")
+{
+	SUBCASE("set, test and reset")
+	{
+		FactionMask mask;
+		CHECK(mask.IsEmpty());
+		CHECK_FALSE(mask.Test(0));
+		CHECK_FALSE(mask.Test(NO_FACTION_IDX));
+
+		mask.Set(NO_FACTION_IDX);
+		mask.Set(3);
+		mask.Set(130);
+		CHECK(mask.Test(NO_FACTION_IDX));
+		CHECK(mask.Test(3));
+		CHECK(mask.Test(130));
+		CHECK_FALSE(mask.Test(0));
+		CHECK_FALSE(mask.Test(63));
+		CHECK_FALSE(mask.Test(1000));
+
+		mask.Reset(130);
+		mask.Reset(1000);
+		CHECK_FALSE(mask.Test(130));
+		CHECK_FALSE(mask.IsEmpty());
+
+		mask.Clear();
+		CHECK(mask.IsEmpty());
+	}
+
+	SUBCASE("visits the factions in order, the no faction first")
+	{
+		FactionMask mask;
+		const std::vector<Uint32> factions = { NO_FACTION_IDX, 0, 62, 63, 64, 200 };
+		for (Uint32 idx : factions)
+			mask.Set(idx);
+
+		std::vector<Uint32> visited;
+		mask.ForEach([&](Uint32 idx) { visited.push_back(idx); });
+		CHECK(visited == factions);
+	}
+
+	SUBCASE("combines masks of different lengths")
+	{
+		FactionMask a, b;
+		a.Set(1);
+		b.Set(300);
+		CHECK_FALSE(a.Intersects(b));
+		CHECK_FALSE(b.Intersects(a));
+
+		a |= b;
+		CHECK(a.Test(1));
+		CHECK(a.Test(300));
+		CHECK(a.Intersects(b));
+		CHECK(b.Intersects(a));
+
+		// trailing empty words don't make masks differ
+		b.Reset(300);
+		CHECK(b == FactionMask());
+		CHECK(a != b);
+	}
+}
@@ -0,0 +1,112 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "FileSourcePack.h"
+#include "doctest/doctest.h"
+
+#include <cstdio>
+
+static void WriteTestFile(FileSystem::FileSourceFS &fs, const std::string &path, const std::string &content)
+{
+	FILE *f = fs.OpenWriteStream(path);
+	REQUIRE(f);
+	fwrite(content.data(), 1, content.size(), f);
+	fclose(f);
+}
+
+static bool SkipIgnored(const FileSystem::FileInfo &info)
+{
+	return info.GetName() == "ignored.txt";
+}
+
+TEST_CASE("FileSourcePack")
+{
+	// the files and the pack are put below the working directory, as
+	// FileSourceFS needs a root
+	FileSystem::FileSourceFS fs(".");
+	const std::string dir = "test-filesourcepack";
+	const std::string packName = "test-filesourcepack.pak";
+	for (const char *subdir : { "", "/libs", "/libs/ui", "/models" })
+		REQUIRE(fs.MakeDirectory(dir + subdir));
+
+	const std::string lua(20000, 'a');
+	std::string model(5000, 0);
+	for (size_t i = 0; i < model.size(); i++)
+		model[i] = char(i * 7919 >> 3); // doesn't compress
+	WriteTestFile(fs, dir + "/libs/ui/Screen.lua", lua);
+	WriteTestFile(fs, dir + "/libs/Module.lua", "return {}");
+	WriteTestFile(fs, dir + "/models/ship.sgm", model);
+	WriteTestFile(fs, dir + "/ignored.txt", "x");
+	WriteTestFile(fs, dir + "/empty.json", "");
+
+	FileSystem::FileSourceFS source(dir);
+	FILE *out = fs.OpenWriteStream(packName);
+	REQUIRE(out);
+	REQUIRE(FileSystem::FileSourcePack::Write(source, out, true, SkipIgnored));
+	fclose(out);
+
+	{
+		FileSystem::FileSourcePack pack(fs, packName);
+		REQUIRE(pack.IsOpen());
+
+		SUBCASE("files and the directories above them are found")
+		{
+			CHECK(pack.Lookup("libs/ui/Screen.lua").IsFile());
+			CHECK(pack.Lookup("libs/./ui//Screen.lua").IsFile());
+			CHECK(pack.Lookup("libs/ui").IsDir());
+			CHECK(pack.Lookup("libs").IsDir());
+			CHECK(pack.Lookup("").IsDir());
+			CHECK(!pack.Lookup("libs/Missing.lua").Exists());
+			CHECK(!pack.Lookup("ignored.txt").Exists());
+		}
+
+		SUBCASE("compressed, stored and empty files read back")
+		{
+			RefCountedPtr<FileSystem::FileData> data = pack.ReadFile("libs/ui/Screen.lua");
+			REQUIRE(data);
+			CHECK(data->AsStringView() == lua);
+
+			data = pack.MapFile("models/ship.sgm");
+			REQUIRE(data);
+			CHECK(data->AsStringView() == model);
+			// stored data starts on a 64 byte boundary
+			CHECK(reinterpret_cast<uintptr_t>(data->GetData()) % 64 == 0);
+
+			data = pack.ReadFile("libs/Module.lua");
+			REQUIRE(data);
+			CHECK(data->AsStringView() == "return {}");
+
+			data = pack.ReadFile("empty.json");
+			REQUIRE(data);
+			CHECK(data->GetSize() == 0);
+
+			CHECK(!pack.ReadFile("libs"));
+		}
+
+		SUBCASE("directories list their files and subdirectories")
+		{
+			std::vector<FileSystem::FileInfo> files;
+			REQUIRE(pack.ReadDirectory("libs", files));
+			REQUIRE(files.size() == 2);
+			CHECK(files[0].GetPath() == "libs/Module.lua");
+			CHECK(files[0].IsFile());
+			CHECK(files[1].GetPath() == "libs/ui");
+			CHECK(files[1].IsDir());
+
+			files.clear();
+			REQUIRE(pack.ReadDirectory("", files));
+			CHECK(files.size() == 3);
+		}
+
+		SUBCASE("a file that isn't a pack is not mounted")
+		{
+			FileSystem::FileSourcePack notPack(fs, dir + "/libs/Module.lua");
+			CHECK(!notPack.IsOpen());
+			CHECK(!notPack.Lookup("libs").Exists());
+		}
+	}
+
+	std::remove(packName.c_str());
+	for (const char *path : { "/libs/ui/Screen.lua", "/libs/Module.lua", "/models/ship.sgm", "/ignored.txt", "/empty.json", "/libs/ui", "/libs", "/models", "" })
+		std::remove((dir + path).c_str());
+}
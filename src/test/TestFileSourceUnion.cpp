@@ -0,0 +1,82 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "FileSystem.h"
+#include "doctest/doctest.h"
+
+#include <cstdio>
+
+static void WriteTestFile(FileSystem::FileSourceFS &fs, const std::string &path, const std::string &content)
+{
+	FILE *f = fs.OpenWriteStream(path);
+	REQUIRE(f);
+	fwrite(content.data(), 1, content.size(), f);
+	fclose(f);
+}
+
+TEST_CASE("FileSourceUnion index")
+{
+	// the sources are put below the working directory, as FileSourceFS
+	// needs a root
+	FileSystem::FileSourceFS fs(".");
+	const std::string dir = "test-filesourceunion";
+	const std::string cacheName = "test-filesourceunion.idx";
+	for (const char *subdir : { "", "/mod", "/mod/libs", "/data", "/data/libs", "/data/lang" })
+		REQUIRE(fs.MakeDirectory(dir + subdir));
+	WriteTestFile(fs, dir + "/mod/libs/Module.lua", "mod");
+	WriteTestFile(fs, dir + "/data/libs/Module.lua", "data");
+	WriteTestFile(fs, dir + "/data/lang/en.json", "{}");
+
+	FileSystem::FileSourceFS mod(dir + "/mod");
+	FileSystem::FileSourceFS data(dir + "/data");
+	FileSystem::FileSourceUnion files;
+	files.AppendSource(&mod);
+	files.AppendSource(&data);
+
+	auto checkLookups = [&]() {
+		FileSystem::FileInfo info = files.Lookup("libs/Module.lua");
+		REQUIRE(info.IsFile());
+		CHECK(&info.GetSource() == &mod);
+		CHECK(files.LookupAll("libs/Module.lua").size() == 2);
+		CHECK(files.Lookup("lang/en.json").IsFile());
+		CHECK(files.Lookup("lang/./en.json").IsFile());
+		CHECK(files.Lookup("libs").IsDir());
+		CHECK(!files.Lookup("lang/de.json").Exists());
+
+		RefCountedPtr<FileSystem::FileData> read = files.ReadFile("libs/Module.lua");
+		REQUIRE(read);
+		CHECK(read->AsStringView() == "mod");
+	};
+
+	SUBCASE("lookups agree with the sources")
+	{
+		checkLookups();
+		files.BuildIndex(fs, cacheName);
+		checkLookups();
+		CHECK(fs.Lookup(cacheName).IsFile());
+
+		// built again from the cache
+		files.BuildIndex(fs, cacheName);
+		checkLookups();
+	}
+
+	SUBCASE("changing the sources drops the index")
+	{
+		files.BuildIndex(fs, cacheName);
+		files.RemoveSource(&mod);
+		FileSystem::FileInfo info = files.Lookup("libs/Module.lua");
+		REQUIRE(info.IsFile());
+		CHECK(&info.GetSource() == &data);
+	}
+
+	SUBCASE("a damaged cache is rebuilt")
+	{
+		WriteTestFile(fs, cacheName, "PIDX");
+		files.BuildIndex(fs, cacheName);
+		checkLookups();
+	}
+
+	std::remove(cacheName.c_str());
+	for (const char *path : { "/mod/libs/Module.lua", "/data/libs/Module.lua", "/data/lang/en.json", "/mod/libs", "/mod", "/data/libs", "/data/lang", "/data", "" })
+		std::remove((dir + path).c_str());
+}
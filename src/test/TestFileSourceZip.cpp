@@ -0,0 +1,64 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "FileSourceZip.h"
+#include "doctest/doctest.h"
+
+extern "C" {
+#include "miniz/miniz.h"
+}
+
+#include <cstdio>
+
+TEST_CASE("FileSourceZip")
+{
+	// the archive is put in the working directory, as FileSourceFS needs a root
+	FileSystem::FileSourceFS fs(".");
+	const std::string zipName = "test-filesourcezip.zip";
+	std::remove(zipName.c_str());
+
+	const std::string shader(10000, 's');
+	REQUIRE(mz_zip_add_mem_to_archive_file_in_place(zipName.c_str(), "shaders/opengl/test.frag", shader.data(), shader.size(), nullptr, 0, MZ_DEFAULT_COMPRESSION));
+	REQUIRE(mz_zip_add_mem_to_archive_file_in_place(zipName.c_str(), "shaders/opengl/test.vert", "vert", 4, nullptr, 0, MZ_DEFAULT_COMPRESSION));
+	REQUIRE(mz_zip_add_mem_to_archive_file_in_place(zipName.c_str(), "modules/a.lua", "return {}", 9, nullptr, 0, MZ_DEFAULT_COMPRESSION));
+
+	{
+		FileSystem::FileSourceZip zip(fs, zipName);
+
+		SUBCASE("files and the directories above them are found")
+		{
+			CHECK(zip.Lookup("shaders/opengl/test.frag").IsFile());
+			CHECK(zip.Lookup("shaders/./opengl//test.vert").IsFile());
+			CHECK(zip.Lookup("shaders/opengl").IsDir());
+			CHECK(zip.Lookup("shaders").IsDir());
+			CHECK(!zip.Lookup("shaders/opengl/missing.frag").Exists());
+			CHECK(!zip.Lookup("missing/test.frag").Exists());
+		}
+
+		SUBCASE("files read back, the same data for a second read")
+		{
+			RefCountedPtr<FileSystem::FileData> first = zip.ReadFile("shaders/opengl/test.frag");
+			REQUIRE(first);
+			CHECK(first->AsStringView() == shader);
+
+			RefCountedPtr<FileSystem::FileData> second = zip.ReadFile("shaders/opengl/test.frag");
+			CHECK(second.Get() == first.Get());
+
+			RefCountedPtr<FileSystem::FileData> lua = zip.ReadFile("modules/a.lua");
+			REQUIRE(lua);
+			CHECK(lua->AsStringView() == "return {}");
+
+			CHECK(!zip.ReadFile("shaders/opengl"));
+			CHECK(!zip.ReadFile("modules/b.lua"));
+		}
+
+		SUBCASE("directories list their contents")
+		{
+			std::vector<FileSystem::FileInfo> files;
+			REQUIRE(zip.ReadDirectory("shaders/opengl", files));
+			CHECK(files.size() == 2);
+		}
+	}
+
+	std::remove(zipName.c_str());
+}
@@ -0,0 +1,77 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "graphics/Frustum.h"
+#include "doctest/doctest.h"
+
+#include <random>
+
+using namespace Graphics;
+
+TEST_CASE("Frustum batch tests")
+{
+	const Frustum frustum(1280.0f, 720.0f, 60.0f, 1.0f, 10000.0f);
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> coord(-2000.0f, 2000.0f);
+	std::uniform_real_distribution<float> size(0.0f, 200.0f);
+
+	// an odd count, so the tail after the last full SIMD group is covered
+	const size_t COUNT = 1001;
+	std::vector<uint32_t> visible;
+
+	SUBCASE("spheres agree with TestPoint")
+	{
+		SphereBatch spheres;
+		for (size_t i = 0; i < COUNT; i++)
+			spheres.Add(vector3f(coord(rng), coord(rng), -std::abs(coord(rng))), size(rng));
+
+		frustum.TestSpheres(spheres, visible);
+		REQUIRE(visible.size() == (COUNT + 31) / 32);
+
+		size_t numVisible = 0;
+		for (size_t i = 0; i < COUNT; i++) {
+			const vector3d centre(spheres.x[i], spheres.y[i], spheres.z[i]);
+			CHECK(Frustum::IsVisible(visible, i) == frustum.TestPoint(centre, spheres.radius[i]));
+			numVisible += Frustum::IsVisible(visible, i);
+		}
+		// both sides of the test get exercised
+		CHECK(numVisible > 0);
+		CHECK(numVisible < COUNT);
+	}
+
+	SUBCASE("boxes are culled only when wholly outside")
+	{
+		AabbBatch boxes;
+		for (size_t i = 0; i < COUNT; i++) {
+			const vector3f min(coord(rng), coord(rng), -std::abs(coord(rng)));
+			boxes.Add(min, min + vector3f(size(rng), size(rng), size(rng)));
+		}
+
+		frustum.TestAabbs(boxes, visible);
+
+		for (size_t i = 0; i < COUNT; i++) {
+			const vector3f min(boxes.minX[i], boxes.minY[i], boxes.minZ[i]);
+			const vector3f max(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]);
+			const vector3d centre = vector3d(min + max) * 0.5;
+			const double radius = (max - min).Length() * 0.5;
+
+			// any box with a corner in view is visible, and a box is never
+			// visible if its bounding sphere isn't
+			bool cornerInside = false;
+			for (int c = 0; c < 8; c++) {
+				const vector3d corner(c & 1 ? max.x : min.x, c & 2 ? max.y : min.y, c & 4 ? max.z : min.z);
+				cornerInside |= frustum.TestPoint(corner, 0.0);
+			}
+			if (cornerInside)
+				CHECK(Frustum::IsVisible(visible, i));
+			if (!frustum.TestPoint(centre, radius))
+				CHECK(!Frustum::IsVisible(visible, i));
+		}
+	}
+
+	SUBCASE("an empty batch")
+	{
+		frustum.TestSpheres(SphereBatch(), visible);
+		CHECK(visible.empty());
+	}
+}
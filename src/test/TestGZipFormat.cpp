@@ -0,0 +1,66 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "core/GZipFormat.h"
+#include "Json.h"
+#include "doctest/doctest.h"
+
+#include <istream>
+
+// enough to inflate in several chunks
+static Json MakeTestJson()
+{
+	Json root = Json::object();
+	Json bodies = Json::array();
+	for (int i = 0; i < 5000; i++) {
+		Json body = Json::object();
+		body["index"] = i;
+		body["label"] = "Body " + std::to_string(i * 7919 % 10007);
+		body["pos"] = Json::array({ i * 0.5, -i * 1.25, double(i * i) });
+		bodies.push_back(body);
+	}
+	root["bodies"] = bodies;
+	root["name"] = "test";
+	return root;
+}
+
+TEST_CASE("GZip streams")
+{
+	const Json root = MakeTestJson();
+	const std::vector<uint8_t> cbor = Json::to_cbor(root);
+	REQUIRE(cbor.size() > 4 * 65536);
+
+	const std::string compressed = gzip::CompressGZip(std::string(cbor.begin(), cbor.end()), "test.sav");
+	REQUIRE(gzip::IsGZipFormat(reinterpret_cast<const unsigned char *>(compressed.data()), compressed.size()));
+
+	SUBCASE("CBOR reads back through the decompressing stream")
+	{
+		gzip::DecompressStreamBuf buf(compressed);
+		std::istream in(&buf);
+		CHECK(Json::from_cbor(in) == root);
+	}
+
+	SUBCASE("a truncated stream fails to read")
+	{
+		const std::string truncated = compressed.substr(0, compressed.size() / 2);
+		gzip::DecompressStreamBuf buf(truncated);
+		std::istream in(&buf);
+		CHECK_THROWS(Json::from_cbor(in));
+	}
+
+	SUBCASE("a damaged stream fails to read")
+	{
+		std::string damaged = compressed;
+		damaged[damaged.size() / 2] ^= 0x55;
+		gzip::DecompressStreamBuf buf(damaged);
+		std::istream in(&buf);
+		CHECK_THROWS(Json::from_cbor(in));
+	}
+
+	SUBCASE("a damaged header fails straight away")
+	{
+		std::string damaged = compressed;
+		damaged[2] = 0;
+		CHECK_THROWS_AS(gzip::DecompressStreamBuf{ damaged }, gzip::DecompressionFailedException);
+	}
+}
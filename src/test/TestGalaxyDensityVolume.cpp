@@ -0,0 +1,65 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "galaxy/GalaxyDensityVolume.h"
+#include "doctest/doctest.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+// a disc which thins out linearly away from the plane, empty beyond 64 sectors
+static float TestDensity(int sx, int sy, int sz)
+{
+	if (sx * sx + sy * sy > 64 * 64)
+		return 0.f;
+	return std::max(0.f, 128.f - 8.f * std::abs(sz));
+}
+
+TEST_CASE("GalaxyDensityVolume")
+{
+	SUBCASE("level 0 averages the sampled sectors")
+	{
+		int calls = 0;
+		GalaxyDensityVolume volume([&](int, int, int) { calls++; return 100.f; }, 8, 3);
+		CHECK(volume.GetDensity(0, 3, -5, 7) == doctest::Approx(100.f));
+		// 4 samples along each side, and only once
+		CHECK(calls == 64);
+		CHECK(volume.GetDensity(0, 1, -2, 3) == doctest::Approx(100.f));
+		CHECK(calls == 64);
+	}
+
+	SUBCASE("coarse levels are the mean of the level below")
+	{
+		GalaxyDensityVolume volume(TestDensity, 2, 3);
+		CHECK(volume.GetBlockSectors(2) == 8);
+
+		float sum = 0.f;
+		for (int x = 0; x < 2; x++)
+			for (int y = 0; y < 2; y++)
+				for (int z = 0; z < 2; z++)
+					sum += volume.GetDensity(1, 8 + x * 4, -16 + y * 4, z * 4);
+		CHECK(volume.GetDensity(2, 8, -16, 0) == doctest::Approx(sum / 8.f));
+	}
+
+	SUBCASE("negative sectors fall in their own blocks")
+	{
+		GalaxyDensityVolume volume([](int, int, int sz) { return sz < 0 ? 10.f : 20.f; }, 4, 1);
+		CHECK(volume.GetDensity(0, 0, 0, -1) == doctest::Approx(10.f));
+		CHECK(volume.GetDensity(0, 0, 0, 0) == doctest::Approx(20.f));
+	}
+
+	SUBCASE("blocks are gathered within the shell and empty ones skipped")
+	{
+		GalaxyDensityVolume volume(TestDensity, 8, 2);
+		std::vector<GalaxyDensityVolume::Block> blocks;
+		volume.GetBlocks(1, vector3f(0.f), 16.f, 200.f, blocks);
+		REQUIRE(!blocks.empty());
+		for (const auto &block : blocks) {
+			CHECK(block.density > 0.f);
+			CHECK(block.centre.Length() >= 16.f);
+			CHECK(block.centre.Length() <= 200.f);
+			// nothing beyond the disc
+			CHECK(std::abs(block.centre.z) < 24.f);
+		}
+	}
+}
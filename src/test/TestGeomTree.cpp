@@ -0,0 +1,181 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "collider/GeomTree.h"
+#include "doctest/doctest.h"
+#include "profiler/Profiler.h"
+
+#include <cstdio>
+#include <random>
+
+// A soup of randomly placed and oriented triangles, standing in for the
+// collision mesh of a large station
+static std::unique_ptr<GeomTree> MakeTestGeomTree(uint32_t numTris)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> pos(-500.f, 500.f);
+	std::uniform_real_distribution<float> offset(-20.f, 20.f);
+
+	std::vector<vector3f> vertices;
+	std::vector<Uint32> indices;
+	std::vector<Uint32> triFlags(numTris, 0);
+
+	for (uint32_t tri = 0; tri < numTris; tri++) {
+		const vector3f center(pos(rng), pos(rng), pos(rng));
+		for (uint32_t idx = 0; idx < 3; idx++) {
+			indices.push_back(vertices.size());
+			vertices.push_back(center + vector3f(offset(rng), offset(rng), offset(rng)));
+		}
+	}
+
+	return std::make_unique<GeomTree>(vertices.size(), numTris, vertices, indices, triFlags);
+}
+
+// Bundles of raysPerOrigin rays, each bundle starting from one point and
+// spreading out slightly like the rays of a sensor sweep
+static void MakeTestRays(uint32_t numRays, uint32_t raysPerOrigin, std::vector<vector3f> &starts, std::vector<vector3f> &dirs)
+{
+	std::mt19937 rng(5678);
+	std::uniform_real_distribution<float> pos(-600.f, 600.f);
+	std::uniform_real_distribution<float> unit(-1.f, 1.f);
+	std::uniform_real_distribution<float> spread(-0.05f, 0.05f);
+
+	starts.clear();
+	dirs.clear();
+	for (uint32_t ray = 0; ray < numRays; ray += raysPerOrigin) {
+		const vector3f start(pos(rng), pos(rng), pos(rng));
+		const vector3f dir = vector3f(unit(rng), unit(rng), unit(rng)).NormalizedSafe();
+		for (uint32_t idx = 0; idx < raysPerOrigin && ray + idx < numRays; idx++) {
+			starts.push_back(start);
+			dirs.push_back((dir + vector3f(spread(rng), spread(rng), spread(rng))).NormalizedSafe());
+		}
+	}
+}
+
+static std::vector<isect_t> MakeIsects(size_t numRays, float dist)
+{
+	return std::vector<isect_t>(numRays, isect_t{ -1, dist });
+}
+
+TEST_CASE("GeomTree Ray Packets")
+{
+	std::unique_ptr<GeomTree> tree = MakeTestGeomTree(20000);
+
+	std::vector<vector3f> starts;
+	std::vector<vector3f> dirs;
+	// an odd number of rays exercises partially filled packets
+	MakeTestRays(1001, 5, starts, dirs);
+
+	for (float dist : { 100.f, FLT_MAX }) {
+		std::vector<isect_t> single = MakeIsects(starts.size(), dist);
+		for (size_t ray = 0; ray < starts.size(); ray++)
+			tree->TraceRay(starts[ray], dirs[ray], &single[ray]);
+
+		std::vector<isect_t> packet = MakeIsects(starts.size(), dist);
+		tree->TraceRays(starts.size(), starts.data(), dirs.data(), packet.data());
+
+		uint32_t numHits = 0;
+		for (size_t ray = 0; ray < starts.size(); ray++) {
+			CHECK(packet[ray].triIdx == single[ray].triIdx);
+			CHECK(packet[ray].dist == doctest::Approx(single[ray].dist));
+			numHits += single[ray].triIdx != -1;
+		}
+
+		// make sure the test actually hits something
+		CHECK(numHits > 0);
+	}
+}
+
+// Ray throughput microbenchmark for single rays against ray packets.
+// This is skipped by default as it takes some time to run; invoke it with:
+//   unittest -tc="GeomTree Ray Benchmark" --no-skip
+TEST_CASE("GeomTree Ray Benchmark" * doctest::skip())
+{
+	static constexpr uint32_t BENCH_NUM_RAYS = 1 << 16;
+
+	std::unique_ptr<GeomTree> tree = MakeTestGeomTree(200000);
+
+	printf("%12s %16s %16s\n", "rays/origin", "single rays/s", "packet rays/s");
+
+	for (uint32_t raysPerOrigin : { 1, 4, 8, 16 }) {
+		std::vector<vector3f> starts;
+		std::vector<vector3f> dirs;
+		MakeTestRays(BENCH_NUM_RAYS, raysPerOrigin, starts, dirs);
+
+		std::vector<isect_t> single = MakeIsects(starts.size(), FLT_MAX);
+		Profiler::Clock clock{};
+		clock.Start();
+		for (size_t ray = 0; ray < starts.size(); ray++)
+			tree->TraceRay(starts[ray], dirs[ray], &single[ray]);
+		clock.Stop();
+		const double singleRate = BENCH_NUM_RAYS / (clock.milliseconds() / 1000.0);
+
+		std::vector<isect_t> packet = MakeIsects(starts.size(), FLT_MAX);
+		clock.Reset();
+		clock.Start();
+		tree->TraceRays(starts.size(), starts.data(), dirs.data(), packet.data());
+		clock.Stop();
+		const double packetRate = BENCH_NUM_RAYS / (clock.milliseconds() / 1000.0);
+
+		printf("%12u %16.0f %16.0f\n", raysPerOrigin, singleRate, packetRate);
+	}
+}
+
+TEST_CASE("GeomTree Swept Spheres")
+{
+	// a 20m square wall in the z = 0 plane
+	const std::vector<vector3f> vertices = {
+		{ -10.f, -10.f, 0.f }, { 10.f, -10.f, 0.f }, { 10.f, 10.f, 0.f }, { -10.f, 10.f, 0.f }
+	};
+	const std::vector<Uint32> indices = { 0, 1, 2, 0, 2, 3 };
+	const std::vector<Uint32> triFlags(2, 0);
+	GeomTree wall(vertices.size(), 2, vertices, indices, triFlags);
+
+	auto sweep = [&](const vector3f &start, float radius, float dist) {
+		isect_t isect{ -1, dist };
+		wall.SweepSphere(start, vector3f(0.f, 0.f, -1.f), radius, &isect);
+		return isect;
+	};
+
+	// face on, and from behind as triangles are two sided
+	CHECK(sweep({ 0.f, 0.f, 5.f }, 1.f, 10.f).dist == doctest::Approx(4.f));
+	isect_t back{ -1, 10.f };
+	wall.SweepSphere({ 3.f, 3.f, -5.f }, { 0.f, 0.f, 1.f }, 1.f, &back);
+	CHECK(back.dist == doctest::Approx(4.f));
+
+	// a sweep much longer than the sphere, which a step would jump right over
+	isect_t through = sweep({ 2.f, -3.f, 50.f }, 0.5f, 100.f);
+	CHECK(through.triIdx != -1);
+	CHECK(through.dist == doctest::Approx(49.5f));
+
+	// grazing an edge and a corner
+	CHECK(sweep({ 10.5f, 0.f, 5.f }, 1.f, 10.f).dist == doctest::Approx(5.f - sqrtf(0.75f)));
+	CHECK(sweep({ 10.5f, 10.5f, 5.f }, 1.f, 10.f).dist == doctest::Approx(5.f - sqrtf(0.5f)));
+
+	// passing by, stopping short and starting in contact all miss
+	CHECK(sweep({ 11.5f, 0.f, 5.f }, 1.f, 10.f).triIdx == -1);
+	CHECK(sweep({ 0.f, 0.f, 5.f }, 1.f, 3.f).triIdx == -1);
+	CHECK(sweep({ 0.f, 0.f, 0.5f }, 1.f, 10.f).triIdx == -1);
+
+	// a vanishing sphere hits what a ray does
+	std::unique_ptr<GeomTree> tree = MakeTestGeomTree(2000);
+	std::vector<vector3f> starts;
+	std::vector<vector3f> dirs;
+	MakeTestRays(200, 1, starts, dirs);
+
+	uint32_t numHits = 0;
+	for (size_t ray = 0; ray < starts.size(); ray++) {
+		isect_t traced{ -1, 2000.f };
+		tree->TraceRay(starts[ray], dirs[ray], &traced);
+		isect_t swept{ -1, 2000.f };
+		tree->SweepSphere(starts[ray], dirs[ray], 1e-3f, &swept);
+
+		// the sphere touches a little earlier, the more so the more glancing
+		// the hit
+		CHECK(swept.triIdx == traced.triIdx);
+		CHECK(swept.dist <= traced.dist);
+		CHECK(swept.dist > traced.dist - 0.05f);
+		numHits += traced.triIdx != -1;
+	}
+	CHECK(numHits > 0);
+}
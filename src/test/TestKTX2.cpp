@@ -0,0 +1,139 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "graphics/KTX2.h"
+#include "doctest/doctest.h"
+
+#include <cstdlib>
+
+using namespace Graphics;
+
+// decode the colour half of a block in four colour mode
+static void DecodeColorBlock(const uint8_t *in, uint8_t rgba[64])
+{
+	const int c0 = in[0] | (in[1] << 8), c1 = in[2] | (in[3] << 8);
+	int palette[4][3];
+	for (int e = 0; e < 2; e++) {
+		const int v = e ? c1 : c0;
+		const int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+		palette[e][0] = (r << 3) | (r >> 2);
+		palette[e][1] = (g << 2) | (g >> 4);
+		palette[e][2] = (b << 3) | (b >> 2);
+	}
+	for (int c = 0; c < 3; c++) {
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	const uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | (uint32_t(in[7]) << 24);
+	for (int i = 0; i < 16; i++) {
+		const int p = (indices >> (i * 2)) & 3;
+		for (int c = 0; c < 3; c++)
+			rgba[i * 4 + c] = palette[p][c];
+	}
+}
+
+static void DecodeAlphaBlock(const uint8_t *in, uint8_t rgba[64])
+{
+	int palette[8] = { in[0], in[1] };
+	for (int p = 2; p < 8; p++)
+		palette[p] = ((8 - p) * in[0] + (p - 1) * in[1]) / 7;
+
+	uint64_t indices = 0;
+	for (int i = 0; i < 6; i++)
+		indices |= uint64_t(in[2 + i]) << (i * 8);
+	for (int i = 0; i < 16; i++)
+		rgba[i * 4 + 3] = palette[(indices >> (i * 3)) & 7];
+}
+
+TEST_CASE("KTX2")
+{
+	SUBCASE("BC1 keeps the colours of a two colour block")
+	{
+		uint8_t block[64], decoded[64], bc1[8];
+		for (int i = 0; i < 16; i++) {
+			// colours exactly representable in 5:6:5
+			const bool second = (i % 3 == 0);
+			block[i * 4 + 0] = second ? 0 : 255;
+			block[i * 4 + 1] = second ? 255 : 0;
+			block[i * 4 + 2] = second ? 0 : 255;
+			block[i * 4 + 3] = 255;
+		}
+		KTX2::CompressBC1Block(block, bc1);
+		// four colour mode, as the GL format is opaque
+		CHECK((bc1[0] | (bc1[1] << 8)) > (bc1[2] | (bc1[3] << 8)));
+
+		DecodeColorBlock(bc1, decoded);
+		int maxError = 0;
+		for (int i = 0; i < 16; i++)
+			for (int c = 0; c < 3; c++)
+				maxError = std::max(maxError, std::abs(decoded[i * 4 + c] - block[i * 4 + c]));
+		// the ends are inset by a sixteenth
+		CHECK(maxError <= 255 / 8);
+
+		// a flat colour is exact
+		for (int i = 0; i < 16; i++) {
+			block[i * 4 + 0] = 255;
+			block[i * 4 + 1] = 130;
+			block[i * 4 + 2] = 0;
+		}
+		KTX2::CompressBC1Block(block, bc1);
+		DecodeColorBlock(bc1, decoded);
+		CHECK(decoded[0] == 255);
+		CHECK(decoded[1] == 130);
+		CHECK(decoded[2] == 0);
+	}
+
+	SUBCASE("BC3 alpha follows a gradient")
+	{
+		uint8_t block[64], decoded[64], bc3[16];
+		for (int i = 0; i < 16; i++) {
+			block[i * 4 + 0] = block[i * 4 + 1] = block[i * 4 + 2] = 128;
+			block[i * 4 + 3] = uint8_t(i * 17);
+		}
+		KTX2::CompressBC3Block(block, bc3);
+		DecodeAlphaBlock(bc3, decoded);
+		for (int i = 0; i < 16; i++)
+			CHECK(std::abs(decoded[i * 4 + 3] - block[i * 4 + 3]) <= 19);
+	}
+
+	SUBCASE("written files read back the same")
+	{
+		const uint32_t width = 16, height = 8;
+		std::vector<uint8_t> rgba(width * height * 4);
+		for (uint32_t i = 0; i < width * height; i++) {
+			rgba[i * 4 + 0] = uint8_t(i * 7);
+			rgba[i * 4 + 1] = uint8_t(i * 13);
+			rgba[i * 4 + 2] = uint8_t(i * 29);
+			rgba[i * 4 + 3] = uint8_t(255 - i);
+		}
+
+		const KTX2::Image image = KTX2::Compress(rgba.data(), width, height, true);
+		CHECK(image.format == TEXTURE_DXT5);
+		CHECK(image.numMipMaps == 5);
+		// 16x8, 8x4, 4x2, 2x1 and 1x1, in 8, 2, 1, 1 and 1 blocks
+		CHECK(image.data.size() == 13 * 16);
+
+		const std::string file = KTX2::Write(image);
+		CHECK(KTX2::IsKTX2(file.data(), file.size()));
+
+		KTX2::Image read;
+		std::string error;
+		REQUIRE(KTX2::Read(file.data(), file.size(), read, error));
+		CHECK(read.format == image.format);
+		CHECK(read.width == width);
+		CHECK(read.height == height);
+		CHECK(read.numMipMaps == image.numMipMaps);
+		CHECK(read.numFaces == 1);
+		CHECK(read.data == image.data);
+
+		// truncated
+		CHECK_FALSE(KTX2::Read(file.data(), file.size() - 4, read, error));
+
+		// Basis Universal
+		std::string basis = file;
+		basis[12] = basis[13] = 0;
+		CHECK_FALSE(KTX2::Read(basis.data(), basis.size(), read, error));
+		CHECK(error.find("Basis") != std::string::npos);
+	}
+}
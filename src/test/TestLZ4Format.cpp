@@ -0,0 +1,94 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "core/LZ4Format.h"
+#include "Json.h"
+#include "doctest/doctest.h"
+
+#include <cstdio>
+#include <istream>
+#include <ostream>
+
+// a tree with enough in it to take several chunks
+static Json MakeTestJson()
+{
+	Json root = Json::object();
+	Json bodies = Json::array();
+	for (int i = 0; i < 5000; i++) {
+		Json body = Json::object();
+		body["index"] = i;
+		body["label"] = "Body " + std::to_string(i * 7919 % 10007);
+		body["pos"] = Json::array({ i * 0.5, -i * 1.25, double(i * i) });
+		bodies.push_back(body);
+	}
+	root["bodies"] = bodies;
+	root["name"] = "test";
+	return root;
+}
+
+static std::string ReadAll(FILE *f)
+{
+	std::string data;
+	rewind(f);
+	char buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		data.append(buf, n);
+	return data;
+}
+
+TEST_CASE("LZ4 streams")
+{
+	const Json root = MakeTestJson();
+	const std::vector<uint8_t> cbor = Json::to_cbor(root);
+	REQUIRE(cbor.size() > 4 * 65536);
+
+	FILE *f = tmpfile();
+	REQUIRE(f);
+	{
+		lz4::CompressStreamBuf buf(f, 0);
+		std::ostream out(&buf);
+		Json::to_cbor(root, out);
+		buf.Finish();
+	}
+	const std::string compressed = ReadAll(f);
+	fclose(f);
+
+	SUBCASE("a streamed frame is an ordinary lz4 frame")
+	{
+		REQUIRE(lz4::IsLZ4Format(compressed.data(), compressed.size()));
+		const std::string plain = lz4::DecompressLZ4(compressed);
+		CHECK(plain == std::string(cbor.begin(), cbor.end()));
+	}
+
+	SUBCASE("CBOR reads back through the decompressing stream")
+	{
+		lz4::DecompressStreamBuf buf(compressed);
+		std::istream in(&buf);
+		CHECK(Json::from_cbor(in) == root);
+	}
+
+	SUBCASE("and so does a frame compressed in one go")
+	{
+		const std::string whole = lz4::CompressLZ4({ reinterpret_cast<const char *>(cbor.data()), cbor.size() }, 0);
+		lz4::DecompressStreamBuf buf(whole);
+		std::istream in(&buf);
+		CHECK(Json::from_cbor(in) == root);
+	}
+
+	SUBCASE("a truncated frame fails to read")
+	{
+		lz4::DecompressStreamBuf buf(std::string_view(compressed).substr(0, compressed.size() / 2));
+		std::istream in(&buf);
+		CHECK_THROWS(Json::from_cbor(in));
+	}
+
+	SUBCASE("a damaged frame fails to read")
+	{
+		std::string damaged = compressed;
+		damaged[damaged.size() / 2] ^= 0x55;
+		lz4::DecompressStreamBuf buf(damaged);
+		std::istream in(&buf);
+		CHECK_THROWS(Json::from_cbor(in));
+	}
+}
@@ -0,0 +1,63 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "Lang.h"
+#include "doctest/doctest.h"
+
+TEST_CASE("Lang string tables")
+{
+	std::vector<Lang::ModuleStrings> modules(2);
+	modules[0].name = "core";
+	modules[0].strings = { { "YES", "Ja" }, { "NO", "Nein" }, { "CANCEL", "Abbrechen" }, { "NO", "Nee" } };
+	modules[1].name = "ui-core";
+	modules[1].strings = { { "YES", "Jawohl" }, { "BACK", "Zurück" } };
+
+	const std::string table = Lang::WriteStringTable(modules);
+
+	SUBCASE("modules read back in token order")
+	{
+		Lang::Resource core("core", "de");
+		REQUIRE(core.Load(table));
+		REQUIRE(core.GetNumStrings() == 3);
+		CHECK(core.GetToken(0) == "CANCEL");
+		CHECK(core.GetToken(1) == "NO");
+		CHECK(core.GetToken(2) == "YES");
+		// the last of a repeated token
+		CHECK(core.GetString(1) == "Nee");
+		// NUL-terminated for Lua
+		CHECK(core.GetToken(2).data()[3] == '\0');
+		CHECK(core.GetString(2).data()[2] == '\0');
+
+		Lang::Resource ui("ui-core", "de");
+		REQUIRE(ui.Load(table));
+		CHECK(ui.GetNumStrings() == 2);
+		CHECK(ui.Get("YES") == "Jawohl");
+		CHECK(ui.Get("BACK") == "Zurück");
+		CHECK(ui.Get("NO").empty());
+
+		CHECK(core.Get("YES") == "Ja");
+		CHECK(core.Get("CANCEL") == "Abbrechen");
+		CHECK(core.Get("ABORT").empty());
+		CHECK(core.Get("ZZZ").empty());
+
+		Lang::Resource missing("equipment", "de");
+		CHECK_FALSE(missing.Load(table));
+	}
+
+	SUBCASE("damaged tables are rejected")
+	{
+		Lang::Resource truncated("core", "de");
+		CHECK_FALSE(truncated.Load(table.substr(0, table.size() - 1)));
+
+		// a text running off the end of the blob
+		std::string damaged = table;
+		damaged[damaged.size() - 1] = 'x';
+		Lang::Resource unterminated("core", "de");
+		CHECK_FALSE(unterminated.Load(damaged));
+
+		std::string version = table;
+		version[4] = 2;
+		Lang::Resource newer("core", "de");
+		CHECK_FALSE(newer.Load(version));
+	}
+}
@@ -0,0 +1,81 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "lua/LuaJobs.h"
+
+#include "doctest.h"
+
+#include <lua.hpp>
+#include <string>
+
+using LuaJobs::Value;
+
+static void RunString(lua_State *l, const char *code)
+{
+	REQUIRE(luaL_dostring(l, code) == LUA_OK);
+}
+
+TEST_CASE("LuaJobs message copy")
+{
+	// two states standing in for the main state and a worker
+	lua_State *from = luaL_newstate();
+	lua_State *to = luaL_newstate();
+	luaL_openlibs(to);
+
+	std::string error;
+
+	SUBCASE("Nested tables")
+	{
+		RunString(from, "return { name = 'Sol', pos = { 1.5, -2, 3 }, flags = { [true] = false }, [10] = 'ten' }");
+
+		Value value;
+		REQUIRE(Value::Pull(from, -1, false, value, error));
+		CHECK(value.GetType() == Value::TABLE);
+
+		value.Push(to, false);
+		lua_setglobal(to, "msg");
+		RunString(to, "assert(msg.name == 'Sol' and msg.pos[1] == 1.5 and msg.pos[2] == -2 and msg.pos[3] == 3)");
+		RunString(to, "assert(msg.flags[true] == false and msg[10] == 'ten')");
+	}
+
+	SUBCASE("Strings keep embedded nulls")
+	{
+		lua_pushlstring(from, "a\0b", 3);
+
+		Value value;
+		REQUIRE(Value::Pull(from, -1, false, value, error));
+		value.Push(to, false);
+
+		size_t len;
+		lua_tolstring(to, -1, &len);
+		CHECK(len == 3);
+	}
+
+	SUBCASE("Functions are refused")
+	{
+		RunString(from, "return { f = function() end }");
+
+		Value value;
+		CHECK_FALSE(Value::Pull(from, -1, false, value, error));
+		CHECK(error.find("function") != std::string::npos);
+	}
+
+	SUBCASE("Cyclic tables are refused")
+	{
+		RunString(from, "local t = {} t.self = t return t");
+
+		Value value;
+		CHECK_FALSE(Value::Pull(from, -1, false, value, error));
+		CHECK(lua_gettop(from) == 1);
+	}
+
+	SUBCASE("Paths are tables on a worker")
+	{
+		Value::PushPath(to, SystemPath(1, -2, 3, 4));
+		lua_setglobal(to, "path");
+		RunString(to, "assert(path.sectorX == 1 and path.sectorY == -2 and path.sectorZ == 3 and path.systemIndex == 4 and path.bodyIndex == nil)");
+	}
+
+	lua_close(to);
+	lua_close(from);
+}
@@ -0,0 +1,118 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "lua/LuaProfiler.h"
+
+#include "doctest.h"
+
+#include <cstring>
+#include <string>
+
+static const char s_script[] = R"(
+local function work(n)
+	local t = {}
+	for i = 1, n do t[i] = { i } end
+	return #t
+end
+
+local function fail()
+	error("expected")
+end
+
+function run()
+	for i = 1, 10 do work(100) end
+	for i = 1, 5 do pcall(fail) end
+	work(100)
+end
+)";
+
+static void RunScript(lua_State *l, const char *chunkName)
+{
+	REQUIRE(luaL_loadbuffer(l, s_script, strlen(s_script), chunkName) == LUA_OK);
+	lua_call(l, 0, 0);
+	lua_getglobal(l, "run");
+	lua_call(l, 0, 0);
+}
+
+static const LuaProfiler::Function *FindFunction(const LuaProfiler &profiler, const char *prefix)
+{
+	for (const LuaProfiler::Function &function : profiler.GetFunctions())
+		if (function.name.compare(0, strlen(prefix), prefix) == 0)
+			return &function;
+	return nullptr;
+}
+
+TEST_CASE("LuaProfiler")
+{
+	LuaProfiler profiler;
+	lua_State *l = lua_newstate(&LuaProfiler::Alloc, &profiler);
+	luaL_openlibs(l);
+
+	SUBCASE("calls, time and allocations are attributed to functions and files")
+	{
+		profiler.Start(l);
+		RunScript(l, "@[T] modules/Test/Test.lua");
+		profiler.Stop(l);
+
+		const LuaProfiler::Function *work = FindFunction(profiler, "work (modules/Test/Test.lua:");
+		REQUIRE(work);
+		CHECK(work->calls == 11);
+		CHECK(work->file == "modules/Test/Test.lua");
+		CHECK(work->allocBytes > 11 * 100 * sizeof(void *));
+		CHECK(work->allocCount >= 11 * 100);
+		CHECK(work->totalTime >= work->selfTime);
+
+		// called from C, where it has no name
+		const LuaProfiler::Function *run = FindFunction(profiler, "function <modules/Test/Test.lua:12>");
+		REQUIRE(run);
+		CHECK(run->calls == 1);
+		CHECK(run->totalTime >= work->totalTime);
+
+		// an error unwinding past the hook leaves no frames behind, so
+		// run is still its caller afterwards and still ends
+		const LuaProfiler::Function *fail = FindFunction(profiler, "function <modules/Test/Test.lua:8>");
+		REQUIRE(fail);
+		CHECK(fail->calls == 5);
+
+		const LuaProfiler::Function *pcall = FindFunction(profiler, "pcall");
+		REQUIRE(pcall);
+		CHECK(pcall->file == "[C]");
+
+		Uint64 fileTime = 0;
+		for (const LuaProfiler::File &file : profiler.GetFiles()) {
+			CHECK(file.name != "[C]"); // everything was called from the script
+			fileTime += file.selfTime;
+		}
+		CHECK(fileTime == profiler.GetProfiledTime());
+		CHECK(profiler.GetProfiledTime() > 0);
+	}
+
+	SUBCASE("nothing is gathered while stopped")
+	{
+		RunScript(l, "@modules/Test/Test.lua");
+		CHECK(profiler.GetFunctions().empty());
+		CHECK(profiler.GetProfiledTime() == 0);
+
+		profiler.Start(l);
+		profiler.Stop(l);
+		RunScript(l, "@modules/Test/Test.lua");
+		CHECK(profiler.GetFunctions().empty());
+	}
+
+	SUBCASE("reset forgets what was gathered")
+	{
+		profiler.Start(l);
+		RunScript(l, "@modules/Test/Test.lua");
+		profiler.Reset();
+		CHECK(profiler.GetFunctions().empty());
+		CHECK(profiler.GetFiles().empty());
+
+		RunScript(l, "@modules/Test/Test.lua");
+		profiler.Stop(l);
+		const LuaProfiler::Function *work = FindFunction(profiler, "work (");
+		REQUIRE(work);
+		CHECK(work->calls == 11);
+	}
+
+	lua_close(l);
+}
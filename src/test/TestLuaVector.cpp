@@ -0,0 +1,108 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "lua/Lua.h"
+#include "lua/LuaVector.h"
+#include "profiler/Profiler.h"
+
+#include "doctest.h"
+
+#include <cstdio>
+
+static void RunLua(lua_State *l, const char *code)
+{
+	const bool ok = luaL_dostring(l, code) == LUA_OK;
+	if (!ok)
+		FAIL_CHECK(lua_tostring(l, -1));
+	REQUIRE(ok);
+}
+
+TEST_CASE("Lua Vector3 In-Place Operations")
+{
+	lua_State *l = luaL_newstate();
+	luaL_openlibs(l);
+	LuaVector::Register(l);
+
+	SUBCASE("Push / Pull")
+	{
+		LuaVector::PushToLua(l, vector3d(1.0, 2.0, 3.0));
+		REQUIRE(LuaVector::GetFromLua(l, -1) != nullptr);
+		CHECK(*LuaVector::GetFromLua(l, -1) == vector3d(1.0, 2.0, 3.0));
+
+		lua_newuserdata(l, sizeof(vector3d));
+		CHECK(LuaVector::GetFromLua(l, -1) == nullptr);
+	}
+
+	SUBCASE("Methods modify and return self")
+	{
+		RunLua(l, R"(
+			v = Vector3(1, 2, 3)
+			r = v:addInPlace(Vector3(1, 1, 1)):mulInPlace(2):subInPlace(Vector3(0, 2, 4))
+			same = rawequal(r, v)
+			w = Vector3(1, 1, 1):addScaledInPlace(Vector3(1, 2, 3), 0.5):divInPlace(0.5)
+			n = Vector3(0, 3, 0):normalizeInPlace()
+			c = Vector3(0, 0, 0)
+			c(v)
+		)");
+
+		lua_getglobal(l, "same");
+		CHECK(lua_toboolean(l, -1));
+		lua_getglobal(l, "v");
+		CHECK(*LuaVector::CheckFromLua(l, -1) == vector3d(4.0, 4.0, 4.0));
+		lua_getglobal(l, "w");
+		CHECK(*LuaVector::CheckFromLua(l, -1) == vector3d(3.0, 4.0, 5.0));
+		lua_getglobal(l, "n");
+		CHECK(*LuaVector::CheckFromLua(l, -1) == vector3d(0.0, 1.0, 0.0));
+		lua_getglobal(l, "c");
+		CHECK(*LuaVector::CheckFromLua(l, -1) == vector3d(4.0, 4.0, 4.0));
+	}
+
+	lua_close(l);
+}
+
+// Vector3 arithmetic microbenchmark, comparing the allocating metamethods
+// with the in-place methods. This is skipped by default; invoke it with:
+//   unittest -tc="Lua Vector3 Benchmark" --no-skip
+
+static constexpr int BENCH_NUM_ITERATIONS = 1000000;
+
+static double RunLuaBenchmark(lua_State *l, const char *code)
+{
+	luaL_loadstring(l, code);
+	lua_pushinteger(l, BENCH_NUM_ITERATIONS);
+
+	Profiler::Clock clock{};
+	clock.Start();
+	const bool ok = lua_pcall(l, 1, 0, 0) == LUA_OK;
+	clock.Stop();
+
+	if (!ok)
+		FAIL_CHECK(lua_tostring(l, -1));
+	return double(BENCH_NUM_ITERATIONS) / (clock.milliseconds() / 1000.0);
+}
+
+TEST_CASE("Lua Vector3 Benchmark" * doctest::skip())
+{
+	lua_State *l = luaL_newstate();
+	luaL_openlibs(l);
+	LuaVector::Register(l);
+
+	const double allocating = RunLuaBenchmark(l, R"(
+		local pos, vel = Vector3(0, 0, 0), Vector3(1, 2, 3)
+		for i = 1, ... do
+			pos = pos + vel * 0.016
+		end
+	)");
+
+	const double inPlace = RunLuaBenchmark(l, R"(
+		local pos, vel = Vector3(0, 0, 0), Vector3(1, 2, 3)
+		for i = 1, ... do
+			pos:addScaledInPlace(vel, 0.016)
+		end
+	)");
+
+	printf("%16s %16s\n", "alloc steps/s", "in-place steps/s");
+	printf("%16.0f %16.0f\n", allocating, inPlace);
+
+	lua_close(l);
+}
@@ -0,0 +1,114 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "galaxy/MarketSimulation.h"
+#include "Json.h"
+#include "doctest/doctest.h"
+
+using GalacticEconomy::MarketSimulation;
+
+static const double DAY = 24.0 * 60.0 * 60.0;
+
+// three commodities after the invalid one: a cheap surplus, a dear scarcity
+// and something illegal
+static std::vector<MarketSimulation::Equilibrium> make_levels()
+{
+	return {
+		{},
+		MarketSimulation::GetEquilibrium(20.0f, -20, true),
+		MarketSimulation::GetEquilibrium(800.0f, 25, true),
+		MarketSimulation::GetEquilibrium(300.0f, 0, false),
+	};
+}
+
+TEST_CASE("MarketSimulation")
+{
+	MarketSimulation markets(4);
+	const std::vector<MarketSimulation::Equilibrium> levels = make_levels();
+	// enough to grow the arrays a couple of times
+	for (Uint32 i = 0; i < 20; i++)
+		markets.AddMarket(SystemPath(1, 2, 3, 0, i), levels);
+	REQUIRE(markets.GetNumMarkets() == 20);
+
+	SUBCASE("equilibrium follows the price alteration")
+	{
+		CHECK(levels[1].price == doctest::Approx(16.0f));
+		CHECK(levels[1].stock > levels[1].demand);
+		CHECK(levels[2].price == doctest::Approx(1000.0f));
+		CHECK(levels[2].stock < levels[2].demand);
+		CHECK(levels[3].stock == 0.0f);
+		CHECK(levels[3].demand == 0.0f);
+	}
+
+	SUBCASE("markets start and stay at equilibrium")
+	{
+		markets.Update(30.0 * DAY);
+		for (size_t market = 0; market < markets.GetNumMarkets(); market++) {
+			for (GalacticEconomy::CommodityId id = 1; id < 4; id++) {
+				CHECK(markets.GetStock(market, id) == doctest::Approx(levels[id].stock));
+				CHECK(markets.GetDemand(market, id) == doctest::Approx(levels[id].demand));
+				CHECK(markets.GetPrice(market, id) == doctest::Approx(levels[id].price));
+			}
+		}
+	}
+
+	SUBCASE("trades move prices, and time brings them back")
+	{
+		const size_t market = markets.FindMarket(SystemPath(1, 2, 3, 0, 7));
+		REQUIRE(market == 7);
+		CHECK(markets.FindMarket(SystemPath(1, 2, 3, 0, 20)) == SIZE_MAX);
+
+		// buying out the station
+		markets.AddStock(market, 2, -levels[2].stock, 0.0f);
+		const float soldOut = markets.GetPrice(market, 2);
+		CHECK(soldOut > levels[2].price);
+		// the neighbours are untouched
+		CHECK(markets.GetPrice(market + 1, 2) == doctest::Approx(levels[2].price));
+
+		// flooding it
+		markets.AddStock(market, 1, 10.0f * levels[1].stock, -levels[1].demand);
+		CHECK(markets.GetPrice(market, 1) == doctest::Approx(0.5f * levels[1].price));
+
+		// a day at a time comes out the same as a week at once
+		MarketSimulation other(4);
+		for (Uint32 i = 0; i < 20; i++)
+			other.AddMarket(SystemPath(1, 2, 3, 0, i), levels);
+		other.AddStock(market, 2, -levels[2].stock, 0.0f);
+		for (int i = 0; i < 7; i++)
+			markets.Update(DAY);
+		other.Update(7.0 * DAY);
+		CHECK(markets.GetStock(market, 2) == doctest::Approx(other.GetStock(market, 2)));
+
+		const float recovering = markets.GetPrice(market, 2);
+		CHECK(recovering < soldOut);
+		CHECK(recovering > levels[2].price);
+
+		markets.Update(365.0 * DAY);
+		CHECK(markets.GetPrice(market, 1) == doctest::Approx(levels[1].price));
+		CHECK(markets.GetPrice(market, 2) == doctest::Approx(levels[2].price));
+	}
+
+	SUBCASE("stock never goes negative")
+	{
+		markets.AddStock(0, 1, -1e6f, -1e6f);
+		CHECK(markets.GetStock(0, 1) == 0.0f);
+		CHECK(markets.GetDemand(0, 1) == 0.0f);
+	}
+
+	SUBCASE("saved state is restored into matching markets")
+	{
+		markets.AddStock(3, 2, -10.0f, 5.0f);
+		Json saved = Json::object();
+		markets.SaveToJson(saved);
+
+		MarketSimulation loaded(4);
+		// only some of the stations, and in another order
+		loaded.AddMarket(SystemPath(1, 2, 3, 0, 5), levels);
+		loaded.AddMarket(SystemPath(1, 2, 3, 0, 3), levels);
+		loaded.LoadFromJson(saved);
+		CHECK(loaded.GetStock(1, 2) == doctest::Approx(markets.GetStock(3, 2)));
+		CHECK(loaded.GetDemand(1, 2) == doctest::Approx(markets.GetDemand(3, 2)));
+		CHECK(loaded.GetPrice(1, 2) == doctest::Approx(markets.GetPrice(3, 2)));
+		CHECK(loaded.GetPrice(0, 2) == doctest::Approx(levels[2].price));
+	}
+}
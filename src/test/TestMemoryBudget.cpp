@@ -0,0 +1,87 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "core/MemoryBudget.h"
+#include "doctest/doctest.h"
+
+#include <algorithm>
+
+// a cache which gives back what it's asked for, down to a floor
+struct FakeCache {
+	size_t usage;
+	size_t floor;
+	int trims = 0;
+
+	MemoryBudget::UsageFn Usage()
+	{
+		return [this]() { return usage; };
+	}
+	MemoryBudget::TrimFn Trim()
+	{
+		return [this](size_t bytes) {
+			trims++;
+			usage -= std::min(bytes, usage - floor);
+		};
+	}
+};
+
+TEST_CASE("MemoryBudget")
+{
+	MemoryBudget budget;
+	FakeCache cheap{ 300, 100 };
+	FakeCache dear{ 400, 0 };
+	FakeCache fixed{ 200, 200 };
+
+	// added out of order, they're trimmed by priority
+	budget.AddCache("dear", 2, dear.Usage(), dear.Trim());
+	const MemoryBudget::CacheId fixedId = budget.AddCache("fixed", 0, fixed.Usage());
+	budget.AddCache("cheap", 1, cheap.Usage(), cheap.Trim());
+
+	REQUIRE(budget.GetCaches().size() == 3);
+	CHECK(budget.GetCaches()[0].name == "fixed");
+	CHECK(budget.GetCaches()[1].name == "cheap");
+	CHECK(budget.GetCaches()[2].name == "dear");
+
+	SUBCASE("only measures without a budget")
+	{
+		CHECK(budget.Update() == 0);
+		CHECK(budget.GetTotalUsage() == 900);
+		CHECK(cheap.trims == 0);
+		CHECK(dear.trims == 0);
+	}
+
+	SUBCASE("trims the lowest priority first")
+	{
+		budget.SetBudget(750);
+		CHECK(budget.Update() == 150);
+		CHECK(budget.GetTotalUsage() == 750);
+		CHECK(cheap.usage == 150);
+		CHECK(dear.trims == 0);
+	}
+
+	SUBCASE("moves on when a cache runs dry")
+	{
+		budget.SetBudget(500);
+		CHECK(budget.Update() == 400);
+		CHECK(cheap.usage == 100);
+		CHECK(dear.usage == 200);
+		CHECK(fixed.usage == 200);
+		CHECK(budget.GetCaches()[1].trimmed == 200);
+		CHECK(budget.GetCaches()[2].trimmed == 200);
+	}
+
+	SUBCASE("gives up when nothing is left to trim")
+	{
+		budget.SetBudget(100);
+		CHECK(budget.Update() == 600);
+		CHECK(budget.GetTotalUsage() == 300);
+	}
+
+	SUBCASE("removed caches no longer count")
+	{
+		budget.RemoveCache(fixedId);
+		budget.SetBudget(700);
+		CHECK(budget.Update() == 0);
+		CHECK(budget.GetTotalUsage() == 700);
+	}
+}
@@ -0,0 +1,127 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "scenegraph/MeshSimplifier.h"
+#include "doctest/doctest.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace SceneGraph;
+
+// a flat grid of size x size quads in the xy plane, facing +z
+static void MakeGrid(uint32_t size, std::vector<vector3f> &positions, std::vector<uint32_t> &indices)
+{
+	for (uint32_t y = 0; y <= size; y++)
+		for (uint32_t x = 0; x <= size; x++)
+			positions.push_back(vector3f(float(x), float(y), 0.0f));
+
+	for (uint32_t y = 0; y < size; y++) {
+		for (uint32_t x = 0; x < size; x++) {
+			const uint32_t i = y * (size + 1) + x;
+			indices.insert(indices.end(), { i, i + 1, i + size + 2 });
+			indices.insert(indices.end(), { i, i + size + 2, i + size + 1 });
+		}
+	}
+}
+
+// a closed unit sphere with a single vertex at each pole
+static void MakeSphere(uint32_t rings, uint32_t segments, std::vector<vector3f> &positions, std::vector<uint32_t> &indices)
+{
+	positions.push_back(vector3f(0.0f, 1.0f, 0.0f));
+	for (uint32_t r = 1; r < rings; r++) {
+		const float lat = float(M_PI) * r / rings;
+		for (uint32_t s = 0; s < segments; s++) {
+			const float lon = 2.0f * float(M_PI) * s / segments;
+			positions.push_back(vector3f(std::sin(lat) * std::cos(lon), std::cos(lat), std::sin(lat) * std::sin(lon)));
+		}
+	}
+	positions.push_back(vector3f(0.0f, -1.0f, 0.0f));
+
+	const uint32_t bottom = positions.size() - 1;
+	auto ringVertex = [segments](uint32_t r, uint32_t s) { return 1 + (r - 1) * segments + (s % segments); };
+	for (uint32_t s = 0; s < segments; s++) {
+		indices.insert(indices.end(), { 0, ringVertex(1, s + 1), ringVertex(1, s) });
+		for (uint32_t r = 1; r < rings - 1; r++) {
+			indices.insert(indices.end(), { ringVertex(r, s), ringVertex(r, s + 1), ringVertex(r + 1, s + 1) });
+			indices.insert(indices.end(), { ringVertex(r, s), ringVertex(r + 1, s + 1), ringVertex(r + 1, s) });
+		}
+		indices.insert(indices.end(), { bottom, ringVertex(rings - 1, s), ringVertex(rings - 1, s + 1) });
+	}
+}
+
+static vector3f TriNormal(const std::vector<vector3f> &positions, const uint32_t *tri)
+{
+	return (positions[tri[1]] - positions[tri[0]]).Cross(positions[tri[2]] - positions[tri[0]]);
+}
+
+TEST_CASE("SimplifyMesh")
+{
+	std::vector<vector3f> positions;
+	std::vector<uint32_t> indices;
+	std::vector<uint32_t> result;
+
+	SUBCASE("flat surfaces collapse without error or folds")
+	{
+		MakeGrid(16, positions, indices);
+		const float error = SimplifyMesh(positions, indices, 0, 1.0f, result);
+
+		CHECK(error == doctest::Approx(0.0f));
+		CHECK(result.size() < indices.size() / 4);
+		for (size_t i = 0; i < result.size(); i += 3)
+			CHECK(TriNormal(positions, &result[i]).z > 0.0f);
+
+		// the border is kept
+		for (uint32_t x = 0; x <= 16; x++)
+			CHECK(std::find(result.begin(), result.end(), x) != result.end());
+	}
+
+	SUBCASE("curved surfaces stop at the target with a bounded error")
+	{
+		MakeSphere(24, 48, positions, indices);
+		const uint32_t target = indices.size() / 4;
+		const float error = SimplifyMesh(positions, indices, target, 1.0f, result);
+
+		CHECK(result.size() <= target);
+		CHECK(error > 0.0f);
+		CHECK(error < 0.2f);
+		for (size_t i = 0; i < result.size(); i += 3) {
+			const vector3f centre = positions[result[i]] + positions[result[i + 1]] + positions[result[i + 2]];
+			CHECK(TriNormal(positions, &result[i]).Dot(centre) > 0.0f);
+		}
+	}
+
+	SUBCASE("the error limit is respected")
+	{
+		MakeSphere(24, 48, positions, indices);
+		const float error = SimplifyMesh(positions, indices, 0, 0.01f, result);
+
+		CHECK(error <= 0.01f);
+		CHECK(result.size() < indices.size());
+		CHECK(result.size() > indices.size() / 8);
+	}
+
+	SUBCASE("seams are kept")
+	{
+		MakeGrid(8, positions, indices);
+		// split the grid along x = 4, giving the right half its own vertices
+		const uint32_t numVerts = positions.size();
+		for (uint32_t y = 0; y <= 8; y++)
+			positions.push_back(positions[y * 9 + 4]);
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			const vector3f centre = positions[indices[i]] + positions[indices[i + 1]] + positions[indices[i + 2]];
+			if (centre.x <= 12.0f)
+				continue;
+			for (size_t j = i; j < i + 3; j++) {
+				if (indices[j] % 9 == 4)
+					indices[j] = numVerts + indices[j] / 9;
+			}
+		}
+
+		SimplifyMesh(positions, indices, 0, 1.0f, result);
+		for (uint32_t y = 0; y <= 8; y++) {
+			CHECK(std::find(result.begin(), result.end(), y * 9 + 4) != result.end());
+			CHECK(std::find(result.begin(), result.end(), numVerts + y) != result.end());
+		}
+	}
+}
@@ -0,0 +1,46 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "Random.h"
+#include "galaxy/NameGenerator.h"
+#include "doctest/doctest.h"
+
+#include <vector>
+
+TEST_CASE("NameGenerator")
+{
+	SUBCASE("skipping a name takes the same numbers as drawing it")
+	{
+		Random named(1234);
+		Random skipped(1234);
+		for (int i = 0; i < 10000; i++) {
+			std::string name;
+			NameGenerator::GetSystemName(name, named);
+			NameGenerator::SkipSystemName(skipped);
+			REQUIRE(!name.empty());
+			REQUIRE(named.DrawsSince(skipped) == 0);
+		}
+		CHECK(named.Int32() == skipped.Int32());
+	}
+
+	SUBCASE("a name can be drawn again from where it started")
+	{
+		const Uint32 seeds[4] = { 3, Uint32(-7), 1, 0xabcd1234 };
+		Random origin(seeds, 4);
+		Random rng(seeds, 4);
+		std::vector<std::pair<Uint64, std::string>> names;
+		for (int i = 0; i < 100; i++) {
+			rng.Int32(); // something else in between
+			names.emplace_back(rng.DrawsSince(origin), std::string());
+			NameGenerator::GetSystemName(names.back().second, rng);
+		}
+
+		for (const auto &drawn : names) {
+			Random again(seeds, 4);
+			again.Skip(drawn.first);
+			std::string name;
+			NameGenerator::GetSystemName(name, again);
+			CHECK(name == drawn.second);
+		}
+	}
+}
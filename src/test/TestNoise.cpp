@@ -0,0 +1,133 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "Random.h"
+#include "perlin.h"
+#include "terrain/FracDef.h"
+#include "terrain/TerrainNoise.h"
+
+#include "doctest.h"
+#include "profiler/Profiler.h"
+
+#include <cstdio>
+#include <vector>
+
+// Neighbouring terrain patches must agree exactly along shared edges, so the
+// batched noise functions have to produce bit-identical results to the scalar
+// versions regardless of which SIMD path is compiled in.
+TEST_CASE("Batch Noise")
+{
+	// odd count to exercise the scalar tail of the SIMD loop
+	static constexpr size_t NUM_POINTS = 1001;
+
+	Random rand(42);
+	std::vector<vector3d> points(NUM_POINTS);
+	std::vector<double> x(NUM_POINTS), y(NUM_POINTS), z(NUM_POINTS), out(NUM_POINTS);
+	for (size_t idx = 0; idx < NUM_POINTS; idx++) {
+		points[idx] = vector3d(rand.Double(-1e4, 1e4), rand.Double(-1e4, 1e4), rand.Double(-1e4, 1e4));
+		x[idx] = points[idx].x;
+		y[idx] = points[idx].y;
+		z[idx] = points[idx].z;
+	}
+
+	SUBCASE("Simplex Noise")
+	{
+		noise(x.data(), y.data(), z.data(), out.data(), NUM_POINTS);
+
+		size_t mismatches = 0;
+		for (size_t idx = 0; idx < NUM_POINTS; idx++)
+			mismatches += out[idx] != noise(points[idx]);
+		CHECK(mismatches == 0);
+	}
+
+	SUBCASE("Octave Noise")
+	{
+		fracdef_t def;
+		def.frequency = 0.01;
+		def.lacunarity = 2.0;
+		def.octaves = 8;
+
+		std::vector<double> persistence(NUM_POINTS);
+		for (size_t idx = 0; idx < NUM_POINTS; idx++)
+			persistence[idx] = rand.Double(0.3, 0.7);
+
+		TerrainNoise::octavenoise(def, 0.5, points.data(), out.data(), NUM_POINTS);
+		size_t mismatches = 0;
+		for (size_t idx = 0; idx < NUM_POINTS; idx++)
+			mismatches += out[idx] != TerrainNoise::octavenoise(def, 0.5, points[idx]);
+		CHECK(mismatches == 0);
+
+		TerrainNoise::ridged_octavenoise(def, persistence.data(), points.data(), out.data(), NUM_POINTS);
+		mismatches = 0;
+		for (size_t idx = 0; idx < NUM_POINTS; idx++)
+			mismatches += out[idx] != TerrainNoise::ridged_octavenoise(def, persistence[idx], points[idx]);
+		CHECK(mismatches == 0);
+	}
+}
+
+// The unrolled octave kernels must match the runtime loop exactly, for the
+// same reason as above
+TEST_CASE("Unrolled Octave Noise")
+{
+	static constexpr size_t NUM_POINTS = 101;
+
+	Random rand(42);
+	fracdef_t def;
+	def.frequency = 0.01;
+	def.lacunarity = 2.0;
+
+	size_t mismatches = 0;
+	for (int octaves = 1; octaves <= TerrainNoise::MAX_UNROLLED_OCTAVES + 2; octaves++) {
+		def.octaves = octaves;
+		for (size_t idx = 0; idx < NUM_POINTS; idx++) {
+			const vector3d p(rand.Double(-1e4, 1e4), rand.Double(-1e4, 1e4), rand.Double(-1e4, 1e4));
+			const double persistence = rand.Double(0.3, 0.7);
+			mismatches += TerrainNoise::detail::point_octave_sum<false>(def, octaves, persistence, p) !=
+				TerrainNoise::detail::point_octave_sum_loop<false>(def, octaves, persistence, p);
+			mismatches += TerrainNoise::detail::point_octave_sum<true>(def, octaves, persistence, p) !=
+				TerrainNoise::detail::point_octave_sum_loop<true>(def, octaves, persistence, p);
+		}
+	}
+	CHECK(mismatches == 0);
+}
+
+// Single point octave noise with the unrolled kernels against the runtime
+// loop, for the octave counts the terrains typically use.
+// This is skipped by default; invoke it with:
+//   unittest -tc="Unrolled Octave Noise Benchmark" --no-skip
+TEST_CASE("Unrolled Octave Noise Benchmark" * doctest::skip())
+{
+	static constexpr size_t NUM_POINTS = 200000;
+
+	Random rand(42);
+	std::vector<vector3d> points(NUM_POINTS);
+	for (vector3d &p : points)
+		p = vector3d(rand.Double(-1.0, 1.0), rand.Double(-1.0, 1.0), rand.Double(-1.0, 1.0)).Normalized();
+
+	fracdef_t def;
+	def.frequency = 1000.0;
+	def.lacunarity = 2.0;
+
+	printf("%8s %16s %16s\n", "octaves", "loop points/s", "unrolled points/s");
+
+	for (int octaves : { 2, 4, 8, 12, 16 }) {
+		def.octaves = octaves;
+		Profiler::Clock clock{};
+		double sum = 0.0;
+
+		clock.Start();
+		for (const vector3d &p : points)
+			sum += TerrainNoise::detail::point_octave_sum_loop<false>(def, octaves, 0.5, p);
+		clock.Stop();
+		const double loopRate = NUM_POINTS / (clock.milliseconds() / 1000.0);
+
+		clock.Reset();
+		clock.Start();
+		for (const vector3d &p : points)
+			sum -= TerrainNoise::detail::point_octave_sum<false>(def, octaves, 0.5, p);
+		clock.Stop();
+		const double unrolledRate = NUM_POINTS / (clock.milliseconds() / 1000.0);
+
+		printf("%8d %16.0f %16.0f (%g)\n", octaves, loopRate, unrolledRate, sum);
+	}
+}
@@ -0,0 +1,178 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "Orbit.h"
+#include "doctest/doctest.h"
+#include "gameconsts.h"
+#include "profiler/Profiler.h"
+
+#include <cstdio>
+#include <random>
+
+// A system's worth of moons and asteroids on random, mostly elliptic orbits
+static std::vector<Orbit> MakeTestOrbits(uint32_t numOrbits, double maxEccentricity)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<double> axis(1e7, 1e12);
+	std::uniform_real_distribution<double> ecc(0.0, maxEccentricity);
+	std::uniform_real_distribution<double> angle(-M_PI, M_PI);
+
+	std::vector<Orbit> orbits(numOrbits);
+	for (Orbit &orbit : orbits) {
+		orbit.SetShapeAroundPrimary(axis(rng), 2e30, ecc(rng));
+		orbit.SetPlane(matrix3x3d::RotateY(angle(rng)) * matrix3x3d::RotateX(angle(rng)));
+		orbit.SetPhase(angle(rng));
+	}
+
+	return orbits;
+}
+
+// Mean anomaly of an elliptic orbit as OrbitalPosAtTime computes it
+static double MeanAnomalyAtTime(const Orbit &orbit, double t)
+{
+	return 2.0 * M_PI * t / orbit.Period() + orbit.GetOrbitalPhaseAtStart();
+}
+
+TEST_CASE("Orbit Batch Positions")
+{
+	std::vector<Orbit> orbits = MakeTestOrbits(1001, 0.99);
+	// eccentricities at the very edge of what FromBodyState produces
+	orbits.emplace_back();
+	orbits.back().SetShapeAroundPrimary(1e10, 2e30, 0.9999);
+	// the scalar paths of the batch: a static body and a hyperbolic orbit
+	orbits.push_back(Orbit::ForStaticBody(vector3d(1e9, 2e9, 3e9)));
+	orbits.emplace_back();
+	orbits.back().SetShapeAroundPrimary(1e10, 2e30, 1.5);
+
+	std::vector<const Orbit *> orbitPtrs;
+	for (const Orbit &orbit : orbits)
+		orbitPtrs.push_back(&orbit);
+
+	std::mt19937 rng(5678);
+	std::uniform_real_distribution<double> time(0.0, 1e9);
+	std::vector<double> times(orbits.size());
+	for (double &t : times)
+		t = time(rng);
+	times.back() = 1e5;
+
+	std::vector<vector3d> positions(orbits.size());
+	Orbit::OrbitalPosAtTimes(orbits.size(), orbitPtrs.data(), times.data(), positions.data());
+
+	uint32_t numMismatched = 0;
+	uint32_t numUnsolved = 0;
+	for (size_t idx = 0; idx < orbits.size(); idx++) {
+		const Orbit &orbit = orbits[idx];
+		const vector3d expected = orbit.OrbitalPosAtTime(times[idx]);
+		// the scalar solver stops once its step is below 1e-4 radians, or falls
+		// back to a bisection accurate to 6e-5 radians
+		const double tolerance = 1e-3 * std::max(expected.Length(), 1.0);
+		numMismatched += !((positions[idx] - expected).Length() <= tolerance);
+
+		const double e = orbit.GetEccentricity();
+		const double a = orbit.GetSemiMajorAxis();
+		if (a == 0.0 || e >= 1.0)
+			continue;
+
+		// recover the eccentric anomaly from the position, which must solve
+		// Kepler's equation far more precisely than the scalar solver does
+		const vector3d planePos = orbit.GetPlane().Transpose() * positions[idx];
+		const double E = atan2(planePos.y / (a * sqrt(1.0 - e * e)), e - planePos.x / a);
+		const double residual = remainder(E - e * sin(E) - MeanAnomalyAtTime(orbit, times[idx]), 2.0 * M_PI);
+		numUnsolved += !(std::abs(residual) < 1e-9);
+	}
+
+	CHECK(numMismatched == 0);
+	CHECK(numUnsolved == 0);
+}
+
+TEST_CASE("Orbit Ephemeris")
+{
+	std::vector<Orbit> orbits = MakeTestOrbits(1000, 0.99);
+	orbits.emplace_back();
+	orbits.back().SetShapeAroundPrimary(1e10, 2e30, 0.9999);
+
+	std::vector<const Orbit *> orbitPtrs;
+	for (const Orbit &orbit : orbits)
+		orbitPtrs.push_back(&orbit);
+
+	// the batch solves Kepler's equation to the same precision as the ephemeris
+	std::mt19937 rng(5678);
+	std::uniform_real_distribution<double> time(-1e9, 1e9);
+	std::vector<double> times(orbits.size());
+	for (double &t : times)
+		t = time(rng);
+
+	std::vector<vector3d> expected(orbits.size());
+	Orbit::OrbitalPosAtTimes(orbits.size(), orbitPtrs.data(), times.data(), expected.data());
+
+	uint32_t numMismatched = 0;
+	for (size_t idx = 0; idx < orbits.size(); idx++) {
+		const vector3d pos = orbits[idx].EphemerisPosAtTime(times[idx]);
+		numMismatched += !((pos - expected[idx]).Length() <= 1e-9 * expected[idx].Length());
+	}
+	CHECK(numMismatched == 0);
+
+	// a trajectory starts from the same true anomaly with or without the
+	// ephemeris, and the copy of an orbit shares it
+	const Orbit &orbit = orbits[12];
+	const Orbit copy = orbit;
+	Orbit uncached = orbit;
+	uncached.SetShapeAroundPrimary(orbit.GetSemiMajorAxis(), 2e30, orbit.GetEccentricity());
+	const double trueAnomaly = copy.TrueAnomalyAtTime(1e6);
+	CHECK(std::abs(remainder(trueAnomaly - uncached.TrueAnomalyAtTime(1e6), 2.0 * M_PI)) < 1e-3);
+	CHECK(copy.EvenSpacedPosTrajectoryFrom(0.25, trueAnomaly) == copy.EvenSpacedPosTrajectory(0.25, 1e6));
+
+	// changing the shape of an orbit replaces its ephemeris
+	Orbit reshaped = orbit;
+	reshaped.SetShapeAroundPrimary(orbit.GetSemiMajorAxis(), 2e30, 0.5);
+	const double t = 1e6;
+	vector3d reshapedExpected;
+	const Orbit *reshapedPtr = &reshaped;
+	Orbit::OrbitalPosAtTimes(1, &reshapedPtr, &t, &reshapedExpected);
+	CHECK((reshaped.EphemerisPosAtTime(t) - reshapedExpected).Length() <= 1e-9 * reshapedExpected.Length());
+}
+
+// Throughput of the batched solver and the ephemeris against one
+// OrbitalPosAtTime per orbit.
+// This is skipped by default; invoke it with:
+//   unittest -tc="Orbit Batch Benchmark" --no-skip
+TEST_CASE("Orbit Batch Benchmark" * doctest::skip())
+{
+	static constexpr uint32_t BENCH_NUM_ORBITS = 1 << 16;
+
+	std::vector<Orbit> orbits = MakeTestOrbits(BENCH_NUM_ORBITS, 0.3);
+	std::vector<const Orbit *> orbitPtrs;
+	for (const Orbit &orbit : orbits)
+		orbitPtrs.push_back(&orbit);
+
+	std::vector<double> times(orbits.size(), 1e9);
+	std::vector<vector3d> positions(orbits.size());
+
+	Profiler::Clock clock{};
+	clock.Start();
+	for (size_t idx = 0; idx < orbits.size(); idx++)
+		positions[idx] = orbits[idx].OrbitalPosAtTime(times[idx]);
+	clock.Stop();
+	const double singleRate = BENCH_NUM_ORBITS / (clock.milliseconds() / 1000.0);
+
+	clock.Reset();
+	clock.Start();
+	Orbit::OrbitalPosAtTimes(orbits.size(), orbitPtrs.data(), times.data(), positions.data());
+	clock.Stop();
+	const double batchRate = BENCH_NUM_ORBITS / (clock.milliseconds() / 1000.0);
+
+	// like the system map: the few orbits of a system, each evaluated many
+	// times after its ephemeris has been built
+	static constexpr uint32_t BENCH_NUM_EPHEMERIDES = 64;
+	for (uint32_t idx = 0; idx < BENCH_NUM_EPHEMERIDES; idx++)
+		orbits[idx].EphemerisPosAtTime(0.0);
+	clock.Reset();
+	clock.Start();
+	for (size_t idx = 0; idx < orbits.size(); idx++)
+		positions[idx] = orbits[idx % BENCH_NUM_EPHEMERIDES].EphemerisPosAtTime(times[idx] + double(idx));
+	clock.Stop();
+	const double ephemerisRate = BENCH_NUM_ORBITS / (clock.milliseconds() / 1000.0);
+
+	printf("%16s %16s %16s\n", "single orbits/s", "batch orbits/s", "ephemeris/s");
+	printf("%16.0f %16.0f %16.0f\n", singleRate, batchRate, ephemerisRate);
+}
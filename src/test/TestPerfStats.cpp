@@ -0,0 +1,131 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "PerfStats.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+#include "doctest.h"
+
+TEST_CASE("Perf Stats")
+{
+	auto stats = std::make_unique<Perf::Stats>();
+
+	SUBCASE("Counters are found by name")
+	{
+		auto a = stats->GetOrCreateCounter("Counter A");
+		auto b = stats->GetOrCreateCounter(std::string("Counter B"), false);
+
+		CHECK(a.id != b.id);
+		CHECK(stats->GetOrCreateCounter("Counter A").id == a.id);
+		CHECK(stats->FindCounter("Counter B").id == b.id);
+		CHECK(stats->FindCounter("Counter C").id == 0);
+		CHECK(stats->GetNameForCounter(b) == "Counter B");
+	}
+
+	SUBCASE("Adds from many threads are totalled")
+	{
+		static constexpr uint32_t NUM_THREADS = 12;
+		static constexpr uint32_t NUM_ADDS = 10000;
+
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < NUM_THREADS; i++) {
+			threads.emplace_back([&stats]() {
+				auto ref = stats->GetOrCreateCounter("Shared");
+				for (uint32_t n = 0; n < NUM_ADDS; n++)
+					stats->CounterAdd(ref);
+			});
+		}
+		for (auto &thread : threads)
+			thread.join();
+
+		auto ref = stats->FindCounter("Shared");
+		REQUIRE(ref.id != 0);
+
+		stats->FlushFrame();
+		CHECK(stats->GetFrameValue(ref) == NUM_THREADS * NUM_ADDS);
+		CHECK(stats->GetFrameStats().at("Shared") == NUM_THREADS * NUM_ADDS);
+
+		// reset on the new frame
+		stats->FlushFrame();
+		CHECK(stats->GetFrameValue(ref) == 0);
+		CHECK(stats->GetFrameValue(ref, 1) == NUM_THREADS * NUM_ADDS);
+	}
+
+	SUBCASE("Set and persistent counters")
+	{
+		auto ref = stats->GetOrCreateCounter("Persistent", false);
+		stats->CounterAdd(ref, 5);
+		std::thread([&]() { stats->CounterAdd(ref, 3); }).join();
+
+		stats->FlushFrame();
+		CHECK(stats->GetFrameValue(ref) == 8);
+
+		stats->CounterDec(ref, 2);
+		stats->FlushFrame();
+		CHECK(stats->GetFrameValue(ref) == 6);
+
+		stats->CounterSet(ref, 100);
+		stats->FlushFrame();
+		CHECK(stats->GetFrameValue(ref) == 100);
+		CHECK(stats->GetNumFrames() == 3);
+	}
+
+	SUBCASE("History wraps around")
+	{
+		auto ref = stats->GetOrCreateCounter("Frame");
+		for (uint32_t frame = 0; frame < Perf::Stats::HISTORY_FRAMES + 10; frame++) {
+			stats->CounterAdd(ref, frame);
+			stats->FlushFrame();
+		}
+
+		CHECK(stats->GetNumFrames() == Perf::Stats::HISTORY_FRAMES);
+		CHECK(stats->GetFrameValue(ref) == Perf::Stats::HISTORY_FRAMES + 9);
+		CHECK(stats->GetFrameValue(ref, Perf::Stats::HISTORY_FRAMES - 1) == 10);
+		CHECK(stats->GetFrameValue(ref, Perf::Stats::HISTORY_FRAMES) == 0);
+	}
+
+	SUBCASE("Capacity is limited")
+	{
+		for (uint32_t i = 0; i < Perf::Stats::MAX_COUNTERS; i++)
+			stats->GetOrCreateCounter("Counter " + std::to_string(i));
+
+		CHECK_THROWS(stats->GetOrCreateCounter("One Too Many"));
+		CHECK(stats->FindCounter("Counter 17").id != 0);
+	}
+}
+
+TEST_CASE("Perf Summary")
+{
+	SUBCASE("Empty series")
+	{
+		const Perf::Summary summary = Perf::Summarise({});
+		CHECK(summary.count == 0);
+		CHECK(summary.p99 == 0.0);
+	}
+
+	SUBCASE("Nearest-rank percentiles")
+	{
+		// 1..100 in reverse, so the samples have to be sorted
+		std::vector<double> samples;
+		for (int i = 100; i > 0; i--)
+			samples.push_back(i);
+
+		const Perf::Summary summary = Perf::Summarise(samples);
+		CHECK(summary.count == 100);
+		CHECK(summary.mean == doctest::Approx(50.5));
+		CHECK(summary.min == 1.0);
+		CHECK(summary.p50 == 50.0);
+		CHECK(summary.p95 == 95.0);
+		CHECK(summary.p99 == 99.0);
+		CHECK(summary.max == 100.0);
+	}
+
+	SUBCASE("A single sample is every percentile")
+	{
+		const Perf::Summary summary = Perf::Summarise({ 16.7 });
+		CHECK(summary.p50 == 16.7);
+		CHECK(summary.p99 == 16.7);
+	}
+}
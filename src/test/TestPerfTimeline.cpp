@@ -0,0 +1,89 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "core/PerfTimeline.h"
+
+#include <algorithm>
+#include <thread>
+#include "doctest.h"
+
+using Timeline = Perf::Timeline;
+
+static const Timeline::ThreadEvents *FindThread(const std::vector<Timeline::ThreadEvents> &threads, const std::string &name)
+{
+	auto iter = std::find_if(threads.begin(), threads.end(), [&](const Timeline::ThreadEvents &t) {
+		return t.name == name;
+	});
+	return iter != threads.end() ? &*iter : nullptr;
+}
+
+TEST_CASE("Perf Timeline")
+{
+	Timeline::SetEnabled(true);
+
+	SUBCASE("Zones and counters")
+	{
+		std::thread([]() {
+			Timeline::SetThreadName("Timeline Zones");
+			{
+				PERF_ZONE("Outer")
+				PERF_ZONE("Inner")
+			}
+			Timeline::RecordCounter("Value", 42);
+		}).join();
+
+		const auto threads = Timeline::Collect();
+		const Timeline::ThreadEvents *thread = FindThread(threads, "Timeline Zones");
+		REQUIRE(thread != nullptr);
+		REQUIRE(thread->events.size() == 3);
+
+		// zones are recorded as they end
+		CHECK(std::string(thread->events[0].name) == "Inner");
+		CHECK(std::string(thread->events[1].name) == "Outer");
+		CHECK(thread->events[1].start <= thread->events[0].start);
+		CHECK(thread->events[1].value >= thread->events[0].value);
+
+		CHECK(thread->events[2].type == Timeline::EVENT_COUNTER);
+		CHECK(thread->events[2].value == 42);
+
+		const std::string trace = Timeline::ToChromeTrace(threads);
+		CHECK(trace.find("\"name\":\"Timeline Zones\"") != std::string::npos);
+		CHECK(trace.find("{\"name\":\"Outer\",\"ph\":\"X\"") != std::string::npos);
+		CHECK(trace.find("\"args\":{\"value\":42}") != std::string::npos);
+	}
+
+	SUBCASE("Ring wraps around")
+	{
+		std::thread([]() {
+			Timeline::SetThreadName("Timeline Wrap");
+			for (uint64_t i = 0; i < Timeline::RING_SIZE + 100; i++)
+				Timeline::RecordCounter("Index", i);
+		}).join();
+
+		const auto threads = Timeline::Collect();
+		const Timeline::ThreadEvents *thread = FindThread(threads, "Timeline Wrap");
+		REQUIRE(thread != nullptr);
+		REQUIRE(thread->events.size() > Timeline::RING_SIZE / 2);
+		CHECK(thread->events.size() <= Timeline::RING_SIZE);
+
+		// only the newest events are kept, in order
+		CHECK(thread->events.back().value == Timeline::RING_SIZE + 99);
+		for (size_t i = 1; i < thread->events.size(); i++)
+			CHECK(thread->events[i].value == thread->events[i - 1].value + 1);
+	}
+
+	SUBCASE("Disabled")
+	{
+		Timeline::SetEnabled(false);
+		std::thread([]() {
+			Timeline::SetThreadName("Timeline Disabled");
+			PERF_ZONE("Ignored")
+		}).join();
+		Timeline::SetEnabled(true);
+
+		const auto threads = Timeline::Collect();
+		const Timeline::ThreadEvents *thread = FindThread(threads, "Timeline Disabled");
+		REQUIRE(thread != nullptr);
+		CHECK(thread->events.empty());
+	}
+}
@@ -311,3 +311,63 @@ TEST_CASE("PropertyMap")
 		}
 	}
 }
+
+TEST_CASE("PropertyMap Change Delivery")
+{
+	PropertyMapWrapper map = PropertyMapWrapper(new PropertyMap());
+
+	int deliveries = 0;
+	std::vector<StringName> changed;
+	map->OnChanged().connect([&](PropertyMap *m, const std::vector<StringName> &keys) {
+		CHECK(m == map.get());
+		deliveries++;
+		changed = keys;
+	});
+
+	SUBCASE("Changes are coalesced until delivered")
+	{
+		for (int idx = 0; idx < 10; idx++) {
+			map->Set("speed", idx);
+			map->Set("heading", idx * 2);
+		}
+		CHECK(deliveries == 0);
+
+		PropertyMap::DeliverChanges();
+		CHECK(deliveries == 1);
+		CHECK(changed.size() == 2);
+		CHECK(std::count(changed.begin(), changed.end(), StringName("speed")) == 1);
+		CHECK(std::count(changed.begin(), changed.end(), StringName("heading")) == 1);
+
+		// nothing changed since
+		PropertyMap::DeliverChanges();
+		CHECK(deliveries == 1);
+	}
+
+	SUBCASE("Setting the same value isn't a change")
+	{
+		map->Set("speed", 5);
+		PropertyMap::DeliverChanges();
+		CHECK(deliveries == 1);
+
+		map->Set("speed", 5);
+		PropertyMap::DeliverChanges();
+		CHECK(deliveries == 1);
+
+		map->Set("speed", 6);
+		map->Clear();
+		PropertyMap::DeliverChanges();
+		CHECK(deliveries == 2);
+		CHECK(changed.size() == 1);
+	}
+
+	SUBCASE("Destroyed maps aren't delivered to")
+	{
+		PropertyMap *other = new PropertyMap();
+		other->OnChanged().connect([&](PropertyMap *, const std::vector<StringName> &) { deliveries++; });
+		other->Set("speed", 1);
+		delete other;
+
+		PropertyMap::DeliverChanges();
+		CHECK(deliveries == 0);
+	}
+}
@@ -0,0 +1,69 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "QualityGovernor.h"
+#include "doctest/doctest.h"
+
+// frames for the smoothed times to settle after a step change
+static constexpr int SETTLE = 200;
+
+static void run(QualityGovernor &governor, int frames, double frameTime, double jobLatency = -1.0)
+{
+	for (int i = 0; i < frames; i++)
+		governor.Update(frameTime, jobLatency);
+}
+
+TEST_CASE("QualityGovernor")
+{
+	QualityGovernor::Settings settings;
+	settings.targetFrameTime = 16.0;
+	settings.maxJobLatency = 400.0;
+
+	QualityGovernor governor(settings);
+	CHECK(governor.GetLevel() == 0);
+
+	SUBCASE("holds steady near the target")
+	{
+		run(governor, 5000, 15.0, 300.0);
+		CHECK(governor.GetLevel() == 0);
+	}
+
+	SUBCASE("ignores a single slow frame")
+	{
+		run(governor, SETTLE, 14.0);
+		governor.Update(200.0, -1.0);
+		run(governor, SETTLE, 14.0);
+		CHECK(governor.GetLevel() == 0);
+	}
+
+	SUBCASE("drops detail when frames stay slow")
+	{
+		run(governor, SETTLE, 30.0);
+		CHECK(governor.GetLevel() == 1);
+
+		// and keeps dropping, one level per cool-down, down to the limit
+		run(governor, 10 * (SETTLE + QualityGovernor::COOLDOWN_FRAMES), 30.0);
+		CHECK(governor.GetLevel() == QualityGovernor::MAX_LEVEL);
+	}
+
+	SUBCASE("drops detail when terrain jobs lag")
+	{
+		run(governor, SETTLE, 10.0, 1000.0);
+		CHECK(governor.GetLevel() == 1);
+	}
+
+	SUBCASE("raises detail only after a long spell of spare time")
+	{
+		run(governor, SETTLE, 30.0);
+		REQUIRE(governor.GetLevel() == 1);
+
+		run(governor, QualityGovernor::COOLDOWN_FRAMES + QualityGovernor::RAISE_FRAMES / 2, 5.0);
+		CHECK(governor.GetLevel() == 1);
+
+		run(governor, QualityGovernor::RAISE_FRAMES, 5.0);
+		CHECK(governor.GetLevel() == 0);
+
+		run(governor, 10 * (QualityGovernor::COOLDOWN_FRAMES + QualityGovernor::RAISE_FRAMES), 5.0);
+		CHECK(governor.GetLevel() == QualityGovernor::MIN_LEVEL);
+	}
+}
@@ -0,0 +1,76 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "Random.h"
+#include "doctest/doctest.h"
+
+#include <vector>
+
+TEST_CASE("Random streams")
+{
+	SUBCASE("Philox4x32-10 known answers")
+	{
+		// from the Random123 test vectors
+		Uint32 zero[4] = { 0, 0, 0, 0 };
+		const Uint32 zeroKey[2] = { 0, 0 };
+		Philox4x32(zero, zeroKey);
+		CHECK(zero[0] == 0x6627e8d5);
+		CHECK(zero[1] == 0xe169c58d);
+		CHECK(zero[2] == 0xbc57ac4c);
+		CHECK(zero[3] == 0x9b00dbd8);
+
+		Uint32 pi[4] = { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 };
+		const Uint32 piKey[2] = { 0xa4093822, 0x299f31d0 };
+		Philox4x32(pi, piKey);
+		CHECK(pi[0] == 0xd16cfe09);
+		CHECK(pi[1] == 0x94fdcceb);
+		CHECK(pi[2] == 0x5001e420);
+		CHECK(pi[3] == 0x24126ea1);
+	}
+
+	SUBCASE("a stream is the same however it's reached")
+	{
+		Random drawn;
+		drawn.seedStream({ 1, 2, 3 }, 7, 42);
+		std::vector<Uint32> numbers;
+		for (int i = 0; i < 64; i++)
+			numbers.push_back(drawn.Int32());
+
+		// after other streams, and after reseeding from a sequence
+		Random again(1234);
+		again.Int32();
+		again.seedStream({ 1, 2, 3 }, 8, 42);
+		again.Int32();
+		again.seedStream({ 1, 2, 3 }, 7, 42);
+		for (int i = 0; i < 64; i++)
+			REQUIRE(again.Int32() == numbers[i]);
+
+		// skipping into the middle of a block
+		for (Uint64 skip : { 1, 3, 4, 5, 30 }) {
+			Random skipped;
+			skipped.seedStream({ 1, 2, 3 }, 7, 42);
+			skipped.Skip(skip);
+			CHECK(skipped.Int32() == numbers[skip]);
+
+			Random origin;
+			origin.seedStream({ 1, 2, 3 }, 7, 42);
+			CHECK(skipped.DrawsSince(origin) == skip + 1);
+		}
+	}
+
+	SUBCASE("streams differ by seed, index and purpose")
+	{
+		Random base, seed, index, purpose;
+		base.seedStream({ 1, 2, 3 }, 7, 42);
+		seed.seedStream({ 1, 2, 4 }, 7, 42);
+		index.seedStream({ 1, 2, 3 }, 8, 42);
+		purpose.seedStream({ 1, 2, 3 }, 7, 43);
+
+		int same = 0;
+		for (int i = 0; i < 64; i++) {
+			const Uint32 n = base.Int32();
+			same += (n == seed.Int32()) + (n == index.Int32()) + (n == purpose.Int32());
+		}
+		CHECK(same == 0);
+	}
+}
@@ -0,0 +1,111 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "graphics/RenderGraph.h"
+#include "doctest/doctest.h"
+
+#include <string>
+#include <vector>
+
+using namespace Graphics;
+
+class FakeRenderTarget : public RenderTarget {
+public:
+	FakeRenderTarget(const RenderTargetDesc &desc) :
+		RenderTarget(desc) {}
+
+	Texture *GetColorTexture() const override { return nullptr; }
+	Texture *GetDepthTexture() const override { return nullptr; }
+	void SetCubeFaceTexture(const Uint32, Texture *) override {}
+	void SetColorTexture(Texture *) override {}
+	void SetDepthTexture(Texture *) override {}
+};
+
+TEST_CASE("RenderGraph")
+{
+	uint32_t numCreated = 0;
+	RenderTargetPool pool([&](const RenderTargetDesc &desc) {
+		numCreated++;
+		return new FakeRenderTarget(desc);
+	});
+
+	const RenderTargetDesc desc(256, 256, TEXTURE_RGBA_8888, TEXTURE_DEPTH, false, 4);
+	FakeRenderTarget output(RenderTargetDesc(256, 256, TEXTURE_RGBA_8888, TEXTURE_NONE));
+	std::vector<std::string> ran;
+
+	SUBCASE("passes nothing reads are culled")
+	{
+		RenderGraph graph(&pool);
+		const auto scene = graph.CreateTarget(desc);
+		const auto unused = graph.CreateTarget(desc);
+		const auto out = graph.ImportTarget(&output);
+
+		graph.AddPass("scene", {}, { scene }, [&](const RenderGraph &) { ran.push_back("scene"); });
+		graph.AddPass("unused", { scene }, { unused }, [&](const RenderGraph &) { ran.push_back("unused"); });
+		graph.AddPass("resolve", { scene }, { out }, [&](const RenderGraph &g) {
+			CHECK(g.GetTarget(out) == &output);
+			ran.push_back("resolve");
+		});
+
+		CHECK(graph.Execute());
+		CHECK(ran == std::vector<std::string>{ "scene", "resolve" });
+		CHECK(graph.GetNumCulledPasses() == 1);
+		CHECK(numCreated == 1);
+	}
+
+	SUBCASE("transients which don't overlap share a target")
+	{
+		RenderGraph graph(&pool);
+		const auto a = graph.CreateTarget(desc);
+		const auto b = graph.CreateTarget(desc);
+		const auto out = graph.ImportTarget(&output);
+		RenderTarget *targetA = nullptr;
+		RenderTarget *targetB = nullptr;
+
+		graph.AddPass("draw a", {}, { a }, [&](const RenderGraph &g) { targetA = g.GetTarget(a); });
+		graph.AddPass("resolve a", { a }, { out }, [](const RenderGraph &) {});
+		graph.AddPass("draw b", {}, { b }, [&](const RenderGraph &g) { targetB = g.GetTarget(b); });
+		graph.AddPass("resolve b", { b }, { out }, [](const RenderGraph &) {});
+
+		CHECK(graph.Execute());
+		CHECK(targetA != nullptr);
+		CHECK(targetA == targetB);
+		CHECK(numCreated == 1);
+	}
+
+	SUBCASE("transients which overlap get their own target")
+	{
+		RenderGraph graph(&pool);
+		const auto a = graph.CreateTarget(desc);
+		const auto b = graph.CreateTarget(desc);
+		const auto out = graph.ImportTarget(&output);
+
+		graph.AddPass("draw a", {}, { a }, [](const RenderGraph &) {});
+		graph.AddPass("draw b", {}, { b }, [](const RenderGraph &) {});
+		graph.AddPass("combine", { a, b }, { out }, [&](const RenderGraph &g) {
+			CHECK(g.GetTarget(a) != g.GetTarget(b));
+		});
+
+		CHECK(graph.Execute());
+		CHECK(numCreated == 2);
+	}
+
+	SUBCASE("pooled targets are reused across graphs and expire")
+	{
+		for (int i = 0; i < 2; i++) {
+			RenderGraph graph(&pool);
+			const auto scene = graph.CreateTarget(desc);
+			const auto out = graph.ImportTarget(&output);
+			graph.AddPass("scene", {}, { scene }, [](const RenderGraph &) {});
+			graph.AddPass("resolve", { scene }, { out }, [](const RenderGraph &) {});
+			CHECK(graph.Execute());
+		}
+
+		CHECK(numCreated == 1);
+		CHECK(pool.GetNumTargets() == 1);
+
+		for (uint32_t i = 0; i <= RenderTargetPool::MAX_UNUSED_FRAMES; i++)
+			pool.EndFrame();
+		CHECK(pool.GetNumTargets() == 0);
+	}
+}
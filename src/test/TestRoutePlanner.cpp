@@ -0,0 +1,188 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "galaxy/RoutePlanner.h"
+#include "doctest/doctest.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+static const float CELL_SIZE = 8.0f;
+
+// every jump costs its length plus a fixed amount, so fewer jumps are better
+static RoutePlanner::JumpCost make_cost(float range)
+{
+	std::vector<float> samples;
+	for (int i = 0; i <= 16; i++)
+		samples.push_back(1.0f + range * float(i) / 16.0f);
+	return RoutePlanner::JumpCost(range, samples);
+}
+
+// a few random systems per sector, the same ones every time a sector is asked for
+static RoutePlanner::SectorSource random_sectors(int systemsPerSector, int *loads = nullptr)
+{
+	return [=](const SystemPath &sector, std::vector<RoutePlanner::System> &systems) {
+		if (loads)
+			++*loads;
+		std::mt19937 rng(Uint32(sector.sectorX * 73856093) ^ Uint32(sector.sectorY * 19349663) ^ Uint32(sector.sectorZ * 83492791));
+		std::uniform_real_distribution<float> coord(0.0f, CELL_SIZE);
+		for (int i = 0; i < systemsPerSector; i++) {
+			const vector3f origin = CELL_SIZE * vector3f(float(sector.sectorX), float(sector.sectorY), float(sector.sectorZ));
+			systems.push_back({ SystemPath(sector.sectorX, sector.sectorY, sector.sectorZ, i), origin + vector3f(coord(rng), coord(rng), coord(rng)) });
+		}
+	};
+}
+
+// plain Dijkstra over every system in the box of sectors between the ends
+static float brute_force_cost(const RoutePlanner::SectorSource &source, const SystemPath &start, const SystemPath &target,
+	const RoutePlanner::JumpCost &cost, int margin)
+{
+	std::vector<RoutePlanner::System> systems;
+	for (int x = std::min(start.sectorX, target.sectorX) - margin; x <= std::max(start.sectorX, target.sectorX) + margin; x++)
+		for (int y = std::min(start.sectorY, target.sectorY) - margin; y <= std::max(start.sectorY, target.sectorY) + margin; y++)
+			for (int z = std::min(start.sectorZ, target.sectorZ) - margin; z <= std::max(start.sectorZ, target.sectorZ) + margin; z++)
+				source(SystemPath(x, y, z), systems);
+
+	const float INF = std::numeric_limits<float>::infinity();
+	std::vector<float> dist(systems.size(), INF);
+	std::vector<bool> done(systems.size(), false);
+	size_t targetIdx = 0;
+	for (size_t i = 0; i < systems.size(); i++) {
+		if (systems[i].path.IsSameSystem(start))
+			dist[i] = 0.0f;
+		if (systems[i].path.IsSameSystem(target))
+			targetIdx = i;
+	}
+
+	for (;;) {
+		size_t u = systems.size();
+		for (size_t i = 0; i < systems.size(); i++) {
+			if (!done[i] && dist[i] < INF && (u == systems.size() || dist[i] < dist[u]))
+				u = i;
+		}
+		if (u == systems.size() || u == targetIdx)
+			break;
+		done[u] = true;
+		for (size_t v = 0; v < systems.size(); v++) {
+			const float d = (systems[v].pos - systems[u].pos).Length();
+			if (!done[v] && d <= cost.GetMaxRange())
+				dist[v] = std::min(dist[v], dist[u] + cost(d));
+		}
+	}
+	return dist[targetIdx];
+}
+
+TEST_CASE("RoutePlanner")
+{
+	SUBCASE("jump costs interpolate between samples")
+	{
+		const RoutePlanner::JumpCost cost(10.0f, { 0.0f, 10.0f, 30.0f });
+		CHECK(cost(0.0f) == doctest::Approx(0.0f));
+		CHECK(cost(2.5f) == doctest::Approx(5.0f));
+		CHECK(cost(7.5f) == doctest::Approx(20.0f));
+		CHECK(cost(10.0f) == doctest::Approx(30.0f));
+		// cheapest per light year is the first step, at two per light year
+		CHECK(cost.GetMinCostPerLy() == doctest::Approx(2.0f));
+	}
+
+	SUBCASE("routes never jump further than the range")
+	{
+		const RoutePlanner::SectorSource source = random_sectors(3);
+		const RoutePlanner::JumpCost cost = make_cost(7.0f);
+		RoutePlanner planner(CELL_SIZE, source);
+
+		const SystemPath start(0, 0, 0, 0), target(6, -3, 2, 1);
+		std::vector<SystemPath> route;
+		REQUIRE(planner.FindRoute(start, target, cost, route));
+		REQUIRE(!route.empty());
+		CHECK(route.back().IsSameSystem(target));
+
+		std::vector<RoutePlanner::System> systems;
+		auto position = [&](const SystemPath &path) {
+			systems.clear();
+			source(path.SectorOnly(), systems);
+			return systems[path.systemIndex].pos;
+		};
+
+		vector3f from = position(start);
+		for (const SystemPath &path : route) {
+			CHECK_FALSE(path.IsSameSystem(start));
+			const vector3f to = position(path);
+			CHECK((to - from).Length() <= cost.GetMaxRange());
+			from = to;
+		}
+	}
+
+	SUBCASE("finds the cheapest route")
+	{
+		const RoutePlanner::SectorSource source = random_sectors(2);
+		const RoutePlanner::JumpCost cost = make_cost(9.0f);
+
+		std::mt19937 rng(99);
+		std::uniform_int_distribution<int> coord(-3, 3);
+		for (int i = 0; i < 10; i++) {
+			const SystemPath start(coord(rng), coord(rng), coord(rng), rng() % 2);
+			const SystemPath target(coord(rng), coord(rng), coord(rng), rng() % 2);
+
+			RoutePlanner planner(CELL_SIZE, source);
+			std::vector<SystemPath> route;
+			const bool found = planner.FindRoute(start, target, cost, route);
+			const float expected = brute_force_cost(source, start, target, cost, 3);
+			REQUIRE(found == std::isfinite(expected));
+			if (!found)
+				continue;
+
+			std::vector<RoutePlanner::System> systems;
+			float total = 0.0f;
+			SystemPath from = start;
+			for (const SystemPath &path : route) {
+				systems.clear();
+				source(from.SectorOnly(), systems);
+				const vector3f a = systems[from.systemIndex].pos;
+				systems.clear();
+				source(path.SectorOnly(), systems);
+				total += cost((systems[path.systemIndex].pos - a).Length());
+				from = path;
+			}
+			CHECK(total == doctest::Approx(expected).epsilon(0.001));
+		}
+	}
+
+	SUBCASE("only loads sectors near the route")
+	{
+		int loads = 0;
+		RoutePlanner planner(CELL_SIZE, random_sectors(4, &loads));
+		std::vector<SystemPath> route;
+		REQUIRE(planner.FindRoute(SystemPath(0, 0, 0, 0), SystemPath(40, 0, 0, 0), make_cost(10.0f), route));
+		CHECK(planner.GetNumLoadedSectors() == size_t(loads));
+		// a search without the heuristic would load every sector within 40 of
+		// the start, over a quarter of a million of them
+		CHECK(loads < 10000);
+	}
+
+	SUBCASE("reports isolated systems as unreachable")
+	{
+		// one system per sector, packed in the corner so the neighbours are a cell apart
+		RoutePlanner planner(CELL_SIZE, [](const SystemPath &sector, std::vector<RoutePlanner::System> &systems) {
+			const vector3f origin = CELL_SIZE * vector3f(float(sector.sectorX), float(sector.sectorY), float(sector.sectorZ));
+			if (sector.sectorX != 5)
+				systems.push_back({ SystemPath(sector.sectorX, sector.sectorY, sector.sectorZ, 0), origin });
+		});
+
+		std::vector<SystemPath> route;
+		// the empty slab at x = 5 can't be crossed with jumps of less than two sectors
+		CHECK_FALSE(planner.FindRoute(SystemPath(0, 0, 0, 0), SystemPath(8, 0, 0, 0), make_cost(CELL_SIZE * 1.5f), route, 5000));
+		CHECK(route.empty());
+
+		REQUIRE(planner.FindRoute(SystemPath(0, 0, 0, 0), SystemPath(8, 0, 0, 0), make_cost(CELL_SIZE * 2.5f), route));
+		CHECK(route.back().IsSameSystem(SystemPath(8, 0, 0, 0)));
+	}
+
+	SUBCASE("unknown systems have no route")
+	{
+		RoutePlanner planner(CELL_SIZE, random_sectors(1));
+		std::vector<SystemPath> route;
+		CHECK_FALSE(planner.FindRoute(SystemPath(0, 0, 0, 0), SystemPath(1, 0, 0, 3), make_cost(10.0f), route));
+	}
+}
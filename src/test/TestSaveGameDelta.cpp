@@ -0,0 +1,100 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "GameSaveError.h"
+#include "SaveGameDelta.h"
+#include "doctest/doctest.h"
+
+// shaped as a save is, with a lot in it that won't change
+static Json MakeTestSave()
+{
+	Json root = Json::object();
+	root["time"] = 1000.0;
+
+	Json bodies = Json::array();
+	for (int i = 0; i < 100; i++) {
+		Json body = Json::object();
+		body["label"] = "Body " + std::to_string(i);
+		body["pos"] = Json::array({ i * 1.0, i * 2.0, i * 3.0 });
+		bodies.push_back(body);
+	}
+	root["space"]["bodies"] = bodies;
+
+	Json explored = Json::array();
+	for (int i = 0; i < 5000; i++)
+		explored.push_back(i * 7);
+	root["sector_persistence"]["explored"] = explored;
+
+	root["lua_modules_json"]["table"]["Missions"] = Json::array({ "a", "b" });
+	root["lua_modules_json"]["table"]["Odd/Name~"] = 1;
+	return root;
+}
+
+TEST_CASE("SaveGameDelta")
+{
+	Json baseSave = MakeTestSave();
+	const SaveGameDelta::Base base = SaveGameDelta::MakeBase(baseSave, 1234);
+	CHECK(SaveGameDelta::GetBaseId(baseSave) == 1234);
+
+	SUBCASE("an unchanged game has an empty delta")
+	{
+		Json later = MakeTestSave();
+		size_t size;
+		CHECK(SaveGameDelta::Diff(base, later, size).empty());
+		CHECK(size == 0);
+	}
+
+	SUBCASE("a delta holds only what changed, and brings the base up to date")
+	{
+		Json later = MakeTestSave();
+		later["time"] = 2000.0;
+		later["space"]["bodies"][42]["pos"][0] = -1.0;
+		later["lua_modules_json"]["table"]["Odd/Name~"] = 2;
+
+		size_t size;
+		Json chunks = SaveGameDelta::Diff(base, later, size);
+		CHECK(chunks.size() == 3);
+		CHECK(size < base.size / 10);
+
+		const Json delta = SaveGameDelta::MakeDeltaFile(base, std::move(chunks));
+		Json loaded = baseSave;
+		REQUIRE(SaveGameDelta::Apply(loaded, delta));
+		CHECK(loaded == later);
+	}
+
+	SUBCASE("added and removed members replace what they're in")
+	{
+		Json later = MakeTestSave();
+		later["space"]["bodies"].erase(7);
+		later["lua_modules_json"]["table"]["News"] = "new";
+
+		size_t size;
+		const Json delta = SaveGameDelta::MakeDeltaFile(base, SaveGameDelta::Diff(base, later, size));
+		Json loaded = baseSave;
+		REQUIRE(SaveGameDelta::Apply(loaded, delta));
+		CHECK(loaded == later);
+	}
+
+	SUBCASE("a delta of another base is left alone")
+	{
+		Json other = MakeTestSave();
+		const SaveGameDelta::Base otherBase = SaveGameDelta::MakeBase(other, 99);
+		other["time"] = 5.0;
+		size_t size;
+		const Json delta = SaveGameDelta::MakeDeltaFile(otherBase, SaveGameDelta::Diff(otherBase, other, size));
+
+		Json loaded = baseSave;
+		CHECK_FALSE(SaveGameDelta::Apply(loaded, delta));
+		CHECK(loaded == baseSave);
+	}
+
+	SUBCASE("a damaged delta fails to apply")
+	{
+		Json delta = SaveGameDelta::MakeDeltaFile(base, Json::array({ Json::array({ "no/leading/slash", 1 }) }));
+		Json loaded = baseSave;
+		CHECK_THROWS_AS(SaveGameDelta::Apply(loaded, delta), SavedGameCorruptException);
+
+		delta["chunks"] = "not chunks";
+		CHECK_THROWS_AS(SaveGameDelta::Apply(loaded, delta), SavedGameCorruptException);
+	}
+}
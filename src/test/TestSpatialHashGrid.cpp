@@ -0,0 +1,132 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "SpatialHashGrid.h"
+#include "doctest/doctest.h"
+#include "profiler/Profiler.h"
+
+#include <cstdio>
+#include <random>
+
+// Clusters of bodies within a few thousand km of a number of stations spread
+// over a system, like the ships and cargo of a busy star system
+static std::vector<vector3d> MakeTestPositions(uint32_t numBodies)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<double> system(-1e12, 1e12);
+	std::normal_distribution<double> cluster(0.0, 1e6);
+
+	std::vector<vector3d> stations(16);
+	for (vector3d &station : stations)
+		station = vector3d(system(rng), system(rng), system(rng));
+
+	std::vector<vector3d> positions(numBodies);
+	for (uint32_t idx = 0; idx < numBodies; idx++) {
+		const vector3d &station = stations[idx % stations.size()];
+		positions[idx] = station + vector3d(cluster(rng), cluster(rng), cluster(rng));
+	}
+
+	return positions;
+}
+
+static SpatialHashGrid<uint32_t> MakeTestGrid(const std::vector<vector3d> &positions)
+{
+	SpatialHashGrid<uint32_t> grid(200000.0);
+	for (uint32_t idx = 0; idx < positions.size(); idx++)
+		grid.Add(idx, positions[idx]);
+	grid.Build();
+
+	return grid;
+}
+
+TEST_CASE("SpatialHashGrid Radius Query")
+{
+	std::vector<vector3d> positions = MakeTestPositions(2000);
+	SpatialHashGrid<uint32_t> grid = MakeTestGrid(positions);
+	REQUIRE(grid.GetNumEntries() == positions.size());
+
+	std::vector<uint32_t> found;
+	// small queries visit the overlapping cells, the huge one every cell
+	for (double dist : { 4000.0, 100000.0, 1e6, 1e13 }) {
+		uint32_t numMismatched = 0;
+		uint32_t numFound = 0;
+		for (uint32_t query = 0; query < positions.size(); query += 7) {
+			found.clear();
+			grid.QueryRadius(positions[query], dist, found);
+			std::sort(found.begin(), found.end());
+
+			std::vector<uint32_t> expected;
+			for (uint32_t idx = 0; idx < positions.size(); idx++) {
+				if ((positions[idx] - positions[query]).LengthSqr() <= dist * dist)
+					expected.push_back(idx);
+			}
+
+			numMismatched += found != expected;
+			numFound += found.size();
+		}
+
+		CHECK(numMismatched == 0);
+		CHECK(numFound > 0);
+	}
+
+	found.clear();
+	grid.QueryRadius(positions[0], -1.0, found);
+	CHECK(found.empty());
+}
+
+// Radius query microbenchmark against the sorted distance shell the grid
+// replaced. Like most callers, results are filtered by their actual distance.
+// This is skipped by default; invoke it with:
+//   unittest -tc="SpatialHashGrid Benchmark" --no-skip
+TEST_CASE("SpatialHashGrid Benchmark" * doctest::skip())
+{
+	static constexpr double QUERY_DIST = 100000.0;
+
+	printf("%8s %16s %16s\n", "bodies", "shell queries/s", "grid queries/s");
+
+	for (uint32_t numBodies : { 1000, 4000, 16000 }) {
+		std::vector<vector3d> positions = MakeTestPositions(numBodies);
+		Profiler::Clock clock{};
+
+		// the previous approach: bodies sorted by distance from the origin,
+		// returning the shell of bodies at about the same distance
+		std::vector<std::pair<double, uint32_t>> shell;
+		for (uint32_t idx = 0; idx < numBodies; idx++)
+			shell.emplace_back(positions[idx].Length(), idx);
+		std::sort(shell.begin(), shell.end());
+
+		size_t numShellResults = 0;
+		size_t numNear = 0;
+		std::vector<uint32_t> found;
+		clock.Start();
+		for (const vector3d &pos : positions) {
+			const double len = pos.Length();
+			auto min = std::lower_bound(shell.begin(), shell.end(), std::make_pair(len - QUERY_DIST, 0u));
+			auto max = std::upper_bound(min, shell.end(), std::make_pair(len + QUERY_DIST, ~0u));
+			found.clear();
+			for (auto iter = min; iter != max; ++iter)
+				found.push_back(iter->second);
+			numShellResults += found.size();
+			for (uint32_t idx : found)
+				numNear += (positions[idx] - pos).LengthSqr() < QUERY_DIST * QUERY_DIST;
+		}
+		clock.Stop();
+		const double shellRate = numBodies / (clock.milliseconds() / 1000.0);
+
+		SpatialHashGrid<uint32_t> grid = MakeTestGrid(positions);
+		size_t numGridResults = 0;
+		clock.Reset();
+		clock.Start();
+		for (const vector3d &pos : positions) {
+			found.clear();
+			grid.QueryRadius(pos, QUERY_DIST, found);
+			numGridResults += found.size();
+			for (uint32_t idx : found)
+				numNear += (positions[idx] - pos).LengthSqr() < QUERY_DIST * QUERY_DIST;
+		}
+		clock.Stop();
+		const double gridRate = numBodies / (clock.milliseconds() / 1000.0);
+
+		printf("%8u %16.0f %16.0f (%zu vs %zu results, %zu near)\n", numBodies, shellRate, gridRate, numShellResults, numGridResults, numNear / 2);
+	}
+}
@@ -7,6 +7,7 @@
 #include "profiler/Profiler.h"
 
 #include <iostream>
+#include <thread>
 #include "doctest.h"
 
 static constexpr uint32_t ITERATIONS = 10000;
@@ -119,11 +120,11 @@ TEST_CASE("StringName")
 
 	SUBCASE("Creation")
 	{
-		CHECK(StringTable::Get()->Size() == 0);
+		CHECK(SharedStringTable::Get()->Size() == 0);
 
 		auto name = StringName("testing one two three");
 		auto name2 = StringName(std::string_view("testing one two three"));
-		CHECK(StringTable::Get()->Size() == 1);
+		CHECK(SharedStringTable::Get()->Size() == 1);
 
 		CHECK(name.size() == 21);
 		CHECK(name.hash() != 0);
@@ -133,12 +134,12 @@ TEST_CASE("StringName")
 		CHECK(name.hash() == name2.hash());
 
 		name = {};
-		StringTable::Get()->Reclaim(true);
-		CHECK(StringTable::Get()->Size() == 1);
+		SharedStringTable::Get()->Reclaim(true);
+		CHECK(SharedStringTable::Get()->Size() == 1);
 
 		name2 = {};
-		StringTable::Get()->Reclaim(true);
-		CHECK(StringTable::Get()->Size() == 0);
+		SharedStringTable::Get()->Reclaim(true);
+		CHECK(SharedStringTable::Get()->Size() == 0);
 	}
 
 	SUBCASE("Copy Construction")
@@ -160,30 +161,124 @@ TEST_CASE("StringName")
 	SUBCASE("Occupancy")
 	{
 		static constexpr uint32_t PERSISTENT_SIZE = 256;
-		StringTable::Get()->Reclaim(true);
-		CHECK(StringTable::Get()->Size() == 0);
+		SharedStringTable::Get()->Reclaim(true);
+		CHECK(SharedStringTable::Get()->Size() == 0);
 
 		std::vector<StringName> persistent_names;
 		for (uint32_t idx = 0; idx < PERSISTENT_SIZE; idx++) {
 			persistent_names.emplace_back(fmt::format("this is some test {}", idx));
 		}
 
-		CHECK(StringTable::Get()->Size() == PERSISTENT_SIZE);
+		CHECK(SharedStringTable::Get()->Size() == PERSISTENT_SIZE);
 
 		std::vector<StringName> temporary_names;
 		for (uint32_t idx = 0; idx < 1024; idx++) {
 			temporary_names.emplace_back("this is some test 1");
 		}
 
-		CHECK(StringTable::Get()->Size() == PERSISTENT_SIZE);
+		CHECK(SharedStringTable::Get()->Size() == PERSISTENT_SIZE);
 
 		temporary_names.clear();
-		CHECK(StringTable::Get()->Size() == PERSISTENT_SIZE);
+		CHECK(SharedStringTable::Get()->Size() == PERSISTENT_SIZE);
 
 		persistent_names.clear();
-		CHECK(StringTable::Get()->Size() == PERSISTENT_SIZE);
+		CHECK(SharedStringTable::Get()->Size() == PERSISTENT_SIZE);
 
-		StringTable::Get()->Reclaim(true);
-		CHECK(StringTable::Get()->Size() == 0);
+		SharedStringTable::Get()->Reclaim(true);
+		CHECK(SharedStringTable::Get()->Size() == 0);
 	}
+
+	SUBCASE("Hash Collisions")
+	{
+		// force the hashes of two different strings to collide
+		StringName a("the first long string", 12345);
+		StringName b("the second long string", 12345);
+		StringName a2("the first long string", 12345);
+		CHECK(SharedStringTable::Get()->Size() == 1);
+
+		CHECK(a.sv() == "the first long string");
+		CHECK(b.sv() == "the second long string");
+		CHECK(a.hash() == 12345);
+		CHECK(b.hash() == 12345);
+		CHECK(a != b);
+		CHECK(a == a2);
+
+		a = {};
+		a2 = {};
+		SharedStringTable::Get()->Reclaim(true);
+		CHECK(SharedStringTable::Get()->Size() == 1);
+
+		// the second string is still found after the first is reclaimed
+		StringName b2("the second long string", 12345);
+		CHECK(b2 == b);
+		CHECK(SharedStringTable::Get()->Size() == 1);
+
+		b = {};
+		b2 = {};
+		SharedStringTable::Get()->Reclaim(true);
+		CHECK(SharedStringTable::Get()->Size() == 0);
+	}
+}
+
+static constexpr uint32_t CONCURRENT_THREADS = 8;
+static constexpr uint32_t CONCURRENT_NAMES = 2048;
+
+TEST_CASE("StringName Concurrency")
+{
+	SharedStringTable::Get()->Reclaim(true);
+	const size_t initialSize = SharedStringTable::Get()->Size();
+
+	// every thread interns the same set of names, in a different order, so
+	// creation of each name races with its lookup on the other threads
+	std::vector<std::vector<StringName>> names(CONCURRENT_THREADS);
+	std::vector<std::thread> threads;
+
+	Profiler::Clock clock{};
+	clock.Start();
+
+	for (uint32_t thread = 0; thread < CONCURRENT_THREADS; thread++) {
+		threads.emplace_back([thread, &names]() {
+			names[thread].reserve(CONCURRENT_NAMES);
+			for (uint32_t idx = 0; idx < CONCURRENT_NAMES; idx++) {
+				const uint32_t name = (idx * 7 + thread * 131) % CONCURRENT_NAMES;
+				names[thread].emplace_back(fmt::format("concurrent test name {}", name));
+
+				// churn some short-lived names too
+				StringName temp(fmt::format("temporary test name {}", idx % 64));
+			}
+		});
+	}
+
+	for (auto &thread : threads)
+		thread.join();
+
+	clock.Stop();
+	Log::Info("SharedStringTable: {} threads interning {} names each took {}ms\n",
+		CONCURRENT_THREADS, CONCURRENT_NAMES, clock.milliseconds());
+
+	CHECK(SharedStringTable::Get()->Size() == initialSize + CONCURRENT_NAMES + 64);
+
+	// all threads share the same string data
+	for (uint32_t thread = 1; thread < CONCURRENT_THREADS; thread++) {
+		for (uint32_t idx = 0; idx < CONCURRENT_NAMES; idx++) {
+			const StringName &name = names[thread][idx];
+			const StringName *match = nullptr;
+			for (const StringName &other : names[0]) {
+				if (other == name) {
+					match = &other;
+					break;
+				}
+			}
+
+			REQUIRE(match != nullptr);
+			CHECK(match->c_str() == name.c_str());
+		}
+	}
+
+	SharedStringTable::Get()->Reclaim(true);
+	CHECK(SharedStringTable::Get()->Size() == initialSize + CONCURRENT_NAMES);
+
+	names.clear();
+	SharedStringTable::Get()->Reclaim(true);
+	CHECK(SharedStringTable::Get()->Size() == initialSize);
 }
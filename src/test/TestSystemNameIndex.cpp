@@ -0,0 +1,68 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "galaxy/SystemNameIndex.h"
+#include "doctest/doctest.h"
+
+TEST_CASE("SystemNameIndex")
+{
+	const SystemPath sol(0, 0, 0, 0);
+	const SystemPath barnard(-1, 0, 0, 0);
+	const SystemPath proxima(0, -1, 0, 1);
+	const SystemPath lave(4, 2, 0, 3);
+
+	SystemNameIndex index;
+	index.Add(sol, "Sol");
+	index.Add(barnard, "Barnard's Star");
+	index.Add(proxima, "Proxima Centauri");
+	index.Add(proxima, "Alpha Centauri C");
+	index.Add(lave, "Lave");
+
+	auto find = [&](std::string_view pattern) {
+		std::vector<SystemPath> systems;
+		index.Find(pattern, systems);
+		return systems;
+	};
+
+	SUBCASE("patterns match any part of a name, ignoring case")
+	{
+		CHECK(find("sol") == std::vector<SystemPath>{ sol });
+		CHECK(find("S").size() == 2);
+		CHECK(find("ave") == std::vector<SystemPath>{ lave });
+		CHECK(find("STAR") == std::vector<SystemPath>{ barnard });
+		CHECK(find("a centauri") == std::vector<SystemPath>{ proxima });
+		CHECK(find("ard's st") == std::vector<SystemPath>{ barnard });
+		CHECK(find("xyz").empty());
+		CHECK(find("centaurus").empty());
+		CHECK(find("").size() == 4);
+	}
+
+	SUBCASE("a system matching by several names is found once")
+	{
+		CHECK(find("centauri") == std::vector<SystemPath>{ proxima });
+		CHECK(find("a") == std::vector<SystemPath>{ barnard, proxima, lave });
+	}
+
+	SUBCASE("removed sectors are no longer found")
+	{
+		index.RemoveSector(proxima.SectorOnly());
+		CHECK(index.GetNumNames() == 3);
+		CHECK(find("centauri").empty());
+		CHECK(find("a") == std::vector<SystemPath>{ barnard, lave });
+
+		index.Add(proxima, "Proxima Centauri");
+		CHECK(find("centauri") == std::vector<SystemPath>{ proxima });
+	}
+
+	SUBCASE("the index survives compaction")
+	{
+		for (int i = 0; i < 2000; i++)
+			index.Add(SystemPath(100 + i, 0, 0, 0), "Filler");
+		for (int i = 0; i < 2000; i++)
+			index.RemoveSector(SystemPath(100 + i, 0, 0));
+		CHECK(index.GetNumNames() == 5);
+		CHECK(find("filler").empty());
+		CHECK(find("centauri") == std::vector<SystemPath>{ proxima });
+		CHECK(find("sol") == std::vector<SystemPath>{ sol });
+	}
+}
@@ -0,0 +1,75 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "galaxy/SystemPathHashMap.h"
+#include "doctest/doctest.h"
+
+#include <map>
+#include <random>
+
+TEST_CASE("SystemPathHashMap")
+{
+	SUBCASE("sector keys ignore the system and body")
+	{
+		SystemPathHashMap<int, SystemPath::LessSectorOnly> map;
+		CHECK(map.insert(std::make_pair(SystemPath(1, -2, 3), 1)).second);
+		CHECK_FALSE(map.insert(std::make_pair(SystemPath(1, -2, 3, 4), 2)).second);
+
+		CHECK(map.size() == 1);
+		CHECK(map.find(SystemPath(1, -2, 3, 7, 8))->second == 1);
+		CHECK(map.find(SystemPath(-1, -2, 3)) == map.end());
+		CHECK(map.find(SystemPath(1, 2, 3)) == map.end());
+	}
+
+	SUBCASE("system keys include the system index")
+	{
+		SystemPathHashMap<int, SystemPath::LessSystemOnly> map;
+		map[SystemPath(0, 0, 0, 0)] = 1;
+		map[SystemPath(0, 0, 0, 1)] = 2;
+		map[SystemPath(0, 0, 0, 1, 5)] = 3;
+
+		CHECK(map.size() == 2);
+		CHECK(map.find(SystemPath(0, 0, 0, 0))->second == 1);
+		CHECK(map.find(SystemPath(0, 0, 0, 1))->second == 3);
+	}
+
+	SUBCASE("matches std::map through inserts, erases and iteration")
+	{
+		SystemPathHashMap<int, SystemPath::LessSectorOnly> map;
+		std::map<SystemPath, int, SystemPath::LessSectorOnly> reference;
+
+		std::mt19937 rng(1234);
+		std::uniform_int_distribution<int> coord(-20, 20);
+		for (int i = 0; i < 20000; i++) {
+			const SystemPath path(coord(rng), coord(rng), coord(rng));
+			if (rng() % 3) {
+				map[path] = i;
+				reference[path] = i;
+			} else {
+				CHECK(map.erase(path) == reference.erase(path));
+			}
+		}
+
+		CHECK(map.size() == reference.size());
+		for (const auto &entry : reference) {
+			auto it = map.find(entry.first);
+			REQUIRE(it != map.end());
+			CHECK(it->second == entry.second);
+		}
+
+		// erasing while iterating visits every entry once
+		size_t visited = 0;
+		auto it = map.begin();
+		while (it != map.end()) {
+			visited++;
+			if (it->second % 2)
+				map.erase(it++);
+			else
+				++it;
+		}
+
+		CHECK(visited == reference.size());
+		for (const auto &entry : map)
+			CHECK(entry.second % 2 == 0);
+	}
+}
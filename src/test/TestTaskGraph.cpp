@@ -216,3 +216,61 @@ TEST_CASE("Task Graph")
 
 	delete graph;
 }
+
+class OrderJob : public Job {
+public:
+	OrderJob(std::vector<int> &order, int id) :
+		m_order(order),
+		m_id(id) {}
+
+	void OnRun() override { m_order.push_back(m_id); }
+	void OnFinish() override {}
+	void OnCancel() override { m_order.push_back(-m_id); }
+
+private:
+	std::vector<int> &m_order;
+	int m_id;
+};
+
+TEST_CASE("Job Priorities")
+{
+	SyncJobQueue queue;
+	std::vector<int> order;
+
+	SUBCASE("Priority Order")
+	{
+		Job::Handle h1 = queue.Queue(new OrderJob(order, 1), nullptr, JobPriority::Background);
+		Job::Handle h2 = queue.Queue(new OrderJob(order, 2), nullptr, JobPriority::Streaming);
+		Job::Handle h3 = queue.Queue(new OrderJob(order, 3), nullptr, JobPriority::Interactive);
+		Job::Handle h4 = queue.Queue(new OrderJob(order, 4), nullptr, JobPriority::Interactive);
+
+		queue.RunJobs(4);
+		queue.FinishJobs();
+
+		CHECK(order == std::vector<int>{ 3, 4, 2, 1 });
+		CHECK(!h1.HasJob());
+	}
+
+	SUBCASE("Missed Deadlines")
+	{
+		Job *demoted = new OrderJob(order, 1);
+		demoted->SetDeadline(1);
+		Job *cancelled = new OrderJob(order, 2);
+		cancelled->SetDeadline(1, Job::DeadlineAction::Cancel);
+
+		Job::Handle h1 = queue.Queue(demoted, nullptr, JobPriority::Interactive);
+		Job::Handle h2 = queue.Queue(cancelled, nullptr, JobPriority::Interactive);
+		Job::Handle h3 = queue.Queue(new OrderJob(order, 3), nullptr, JobPriority::Streaming);
+
+		// let both deadlines pass without running any jobs
+		queue.FinishJobs();
+		queue.FinishJobs();
+
+		CHECK(demoted->GetPriority() == JobPriority::Interactive);
+		queue.RunJobs(3);
+		queue.FinishJobs();
+
+		CHECK(order == std::vector<int>{ 3, 1, -2 });
+		CHECK(!h2.HasJob());
+	}
+}
@@ -0,0 +1,82 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "graphics/VertexWriter.h"
+
+#include "doctest.h"
+
+#include <cstddef>
+#include <memory>
+
+using namespace Graphics;
+
+// keeps the vertices in memory, like a dynamic buffer's client store
+class MemoryVertexBuffer : public VertexBuffer {
+public:
+	MemoryVertexBuffer(const VertexBufferDesc &desc) :
+		VertexBuffer(desc),
+		m_data(new Uint8[desc.numVertices * desc.stride])
+	{}
+
+	virtual bool Populate(const VertexArray &) override { return false; }
+	virtual void BufferData(const size_t, void *) override {}
+	virtual void Bind() override {}
+	virtual void Release() override {}
+	virtual void Unmap() override {}
+
+	const Uint8 *GetData() const { return m_data.get(); }
+
+protected:
+	virtual Uint8 *MapInternal(BufferMapMode) override { return m_data.get(); }
+
+private:
+	std::unique_ptr<Uint8[]> m_data;
+};
+
+TEST_CASE("VertexWriter formats match their buffer layout")
+{
+	VertexBufferDesc desc = CreateVertexDesc<VertexPosCol>(1, BUFFER_USAGE_DYNAMIC);
+	CHECK(desc.stride == sizeof(VertexPosCol));
+	CHECK(desc.GetOffset(ATTRIB_DIFFUSE) == offsetof(VertexPosCol, col));
+
+	desc = CreateVertexDesc<VertexPosNormCol>(1, BUFFER_USAGE_DYNAMIC);
+	CHECK(desc.stride == sizeof(VertexPosNormCol));
+	CHECK(desc.GetOffset(ATTRIB_NORMAL) == offsetof(VertexPosNormCol, norm));
+	CHECK(desc.GetOffset(ATTRIB_DIFFUSE) == offsetof(VertexPosNormCol, col));
+
+	desc = CreateVertexDesc<VertexPosColUV>(1, BUFFER_USAGE_DYNAMIC);
+	CHECK(desc.stride == sizeof(VertexPosColUV));
+	CHECK(desc.GetOffset(ATTRIB_DIFFUSE) == offsetof(VertexPosColUV, col));
+	CHECK(desc.GetOffset(ATTRIB_UV0) == offsetof(VertexPosColUV, uv));
+
+	desc = CreateVertexDesc<VertexPosUV>(1, BUFFER_USAGE_DYNAMIC);
+	CHECK(desc.stride == sizeof(VertexPosUV));
+	CHECK(desc.GetOffset(ATTRIB_UV0) == offsetof(VertexPosUV, uv));
+}
+
+TEST_CASE("VertexWriter writes into a vertex buffer")
+{
+	MemoryVertexBuffer vb(CreateVertexDesc<VertexPosCol>(8, BUFFER_USAGE_DYNAMIC));
+
+	const VertexPosCol verts[2] = {
+		{ vector3f(4.f, 5.f, 6.f), Color4ub(0, 255, 0, 255) },
+		{ vector3f(7.f, 8.f, 9.f), Color4ub(0, 0, 255, 255) },
+	};
+
+	{
+		VertexWriter<VertexPosCol> out(&vb);
+		out.Add({ vector3f(1.f, 2.f, 3.f), Color4ub(255, 0, 0, 255) });
+		out.Add(verts, 2);
+		CHECK(out.GetNumWritten() == 3);
+	}
+
+	// the vertex count is that written, not the capacity
+	CHECK(vb.GetSize() == 3);
+	CHECK(vb.GetCapacity() == 8);
+
+	const VertexPosCol *written = reinterpret_cast<const VertexPosCol *>(vb.GetData());
+	CHECK(written[0].pos == vector3f(1.f, 2.f, 3.f));
+	CHECK(written[0].col == Color4ub(255, 0, 0, 255));
+	CHECK(written[2].pos == vector3f(7.f, 8.f, 9.f));
+	CHECK(written[2].col == Color4ub(0, 0, 255, 255));
+}
@@ -3,18 +3,32 @@
 
 #include "DistanceFieldFont.h"
 #include "FileSystem.h"
+#include "graphics/Renderer.h"
 #include "graphics/Texture.h"
 #include "graphics/VertexArray.h"
+#include "graphics/VertexBuffer.h"
+#include "profiler/Profiler.h"
 #include "utils.h"
 #include <iostream>
 #include <sstream>
 
 namespace Text {
 
+	static const size_t MIN_MESH_CACHE_LIMIT = 64;
+
+#pragma pack(push, 4)
+	struct LabelVertex {
+		vector3f pos;
+		vector3f norm;
+		vector2f uv;
+	};
+#pragma pack(pop)
+
 	DistanceFieldFont::DistanceFieldFont(const std::string &definition, Graphics::Texture *tex) :
 		m_texture(tex),
 		m_sheetSize(0.f),
-		m_fontSize(0.f)
+		m_fontSize(0.f),
+		m_meshCacheLimit(MIN_MESH_CACHE_LIMIT)
 	{
 		//parse definition
 		RefCountedPtr<FileSystem::FileData> fontdef = FileSystem::gameDataFiles.ReadFile(definition);
@@ -40,6 +54,10 @@ namespace Text {
 		}
 	}
 
+	DistanceFieldFont::~DistanceFieldFont()
+	{
+	}
+
 	void DistanceFieldFont::GetGeometry(Graphics::VertexArray &va, const std::string &text, const vector2f &offset)
 	{
 		assert(va.HasAttrib(Graphics::ATTRIB_NORMAL) && va.HasAttrib(Graphics::ATTRIB_UV0));
@@ -72,6 +90,109 @@ namespace Text {
 		}
 	}
 
+	// Calls fn(glyph, pos) for each character with a glyph, where pos is the
+	// glyph's lower left corner
+	template <typename Fn>
+	void DistanceFieldFont::ForEachGlyph(const std::string &text, Fn &&fn) const
+	{
+		vector2f cursor(0.f);
+		for (const char c : text) {
+			//Look for \n and do a linebreak
+			if (c == '\n') {
+				cursor.y--;
+				cursor.x = 0;
+			} else {
+				auto it = m_glyphs.find(Uint32(c));
+				if (it != m_glyphs.end()) {
+					const Glyph &glyph = it->second;
+					fn(glyph, cursor + glyph.offset);
+					cursor.x += glyph.xAdvance;
+				}
+			}
+		}
+	}
+
+	RefCountedPtr<Graphics::MeshObject> DistanceFieldFont::GetMesh(Graphics::Renderer *r, const std::string &text)
+	{
+		auto it = m_meshCache.find(text);
+		if (it != m_meshCache.end())
+			return it->second;
+
+		if (m_meshCache.size() >= m_meshCacheLimit)
+			PruneMeshCache();
+
+		RefCountedPtr<Graphics::MeshObject> mesh(CreateMesh(r, text));
+		m_meshCache.emplace(text, mesh);
+		return mesh;
+	}
+
+	void DistanceFieldFont::PruneMeshCache()
+	{
+		for (auto it = m_meshCache.begin(); it != m_meshCache.end();) {
+			// only referenced by the cache
+			if (!it->second.Valid() || it->second->GetRefCount() == 1)
+				it = m_meshCache.erase(it);
+			else
+				++it;
+		}
+		m_meshCacheLimit = std::max(MIN_MESH_CACHE_LIMIT, m_meshCache.size() * 2);
+	}
+
+	// Builds the same triangles as GetGeometry, but measures the text first
+	// so the vertices can be written, already centred, straight into the
+	// buffer
+	Graphics::MeshObject *DistanceFieldFont::CreateMesh(Graphics::Renderer *r, const std::string &text) const
+	{
+		PROFILE_SCOPED()
+		Uint32 numGlyphs = 0;
+		vector2f bounds(0.f);
+		ForEachGlyph(text, [&](const Glyph &g, const vector2f &pos) {
+			numGlyphs++;
+			bounds.x = std::max(bounds.x, pos.x + g.size.x);
+			bounds.y = std::max(bounds.y, pos.y + g.size.y);
+		});
+
+		// Happens if none of the characters in the string have glyphs in the SDF font.
+		// Most noticeably, this means text consisting of entirely Cyrillic
+		// or Chinese characters will vanish when rendered on a Label3D.
+		if (!numGlyphs)
+			return nullptr;
+
+		Graphics::VertexBufferDesc vbd = Graphics::VertexBufferDesc::FromAttribSet(
+			Graphics::ATTRIB_POSITION | Graphics::ATTRIB_NORMAL | Graphics::ATTRIB_UV0);
+		vbd.numVertices = numGlyphs * 6;
+		vbd.usage = Graphics::BUFFER_USAGE_STATIC;
+
+		Graphics::VertexBuffer *vertexBuf = r->CreateVertexBuffer(vbd);
+		LabelVertex *vtx = vertexBuf->Map<LabelVertex>(Graphics::BUFFER_MAP_WRITE);
+		assert(vertexBuf->GetDesc().stride == sizeof(LabelVertex));
+
+		const vector3f norm(0.f, 0.f, 1.f);
+		const vector2f center = bounds / 2.f;
+		ForEachGlyph(text, [&](const Glyph &g, const vector2f &pos) {
+			const float x0 = pos.x - center.x;
+			const float y0 = pos.y - center.y;
+			const float x1 = x0 + g.size.x;
+			const float y1 = y0 + g.size.y;
+			const float u0 = g.uv.x;
+			const float v0 = g.uv.y;
+			const float u1 = u0 + g.uvSize.x;
+			const float v1 = v0 + g.uvSize.y;
+
+			vtx[0] = { vector3f(x0, y0, 0.f), norm, vector2f(u0, v1) };
+			vtx[1] = { vector3f(x1, y0, 0.f), norm, vector2f(u1, v1) };
+			vtx[2] = { vector3f(x0, y1, 0.f), norm, vector2f(u0, v0) };
+
+			vtx[3] = { vector3f(x0, y1, 0.f), norm, vector2f(u0, v0) };
+			vtx[4] = { vector3f(x1, y0, 0.f), norm, vector2f(u1, v1) };
+			vtx[5] = { vector3f(x1, y1, 0.f), norm, vector2f(u1, v0) };
+			vtx += 6;
+		});
+		vertexBuf->Unmap();
+
+		return r->CreateMeshObject(vertexBuf);
+	}
+
 	// create a preferred format vertex array
 	Graphics::VertexArray *DistanceFieldFont::CreateVertexArray() const
 	{
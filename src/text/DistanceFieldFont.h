@@ -28,8 +28,11 @@
 
 #include <string>
 #include <map>
+#include <unordered_map>
 
 namespace Graphics {
+	class MeshObject;
+	class Renderer;
 	class Texture;
 	class VertexArray;
 } // namespace Graphics
@@ -39,7 +42,14 @@ namespace Text {
 	class DistanceFieldFont : public RefCounted {
 	public:
 		DistanceFieldFont(const std::string &definitionFileName, Graphics::Texture *);
+		~DistanceFieldFont();
 		void GetGeometry(Graphics::VertexArray &, const std::string &, const vector2f &offset);
+
+		// A static mesh of the text (position, normal, uv0), centred on the
+		// origin. Meshes are cached by text, so labels showing the same
+		// string share one. Returns an empty pointer if none of the
+		// characters have glyphs.
+		RefCountedPtr<Graphics::MeshObject> GetMesh(Graphics::Renderer *, const std::string &);
 		Graphics::Texture *GetTexture() const { return m_texture; }
 		Graphics::VertexArray *CreateVertexArray() const;
 
@@ -57,6 +67,16 @@ namespace Text {
 		float m_lineHeight;
 		float m_fontSize; //32 etc. Glyph size/advance will be scaled to 1/fontSize.
 
+		// meshes no label holds any more are dropped when the cache has
+		// grown past m_meshCacheLimit
+		std::unordered_map<std::string, RefCountedPtr<Graphics::MeshObject>> m_meshCache;
+		size_t m_meshCacheLimit;
+
+		template <typename Fn>
+		void ForEachGlyph(const std::string &text, Fn &&fn) const;
+		Graphics::MeshObject *CreateMesh(Graphics::Renderer *, const std::string &) const;
+		void PruneMeshCache();
+
 		void AddGlyph(Graphics::VertexArray &va, const vector2f &pos, const Glyph &, vector2f &bounds);
 		void ParseChar(std::string_view line);
 		void ParseCommon(std::string_view line);
@@ -0,0 +1,186 @@
+// Copyright © 2008-2024 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "FileSystem.h"
+#include "SDLWrappers.h"
+#include "core/Log.h"
+#include "core/OS.h"
+#include "core/StringUtils.h"
+#include "core/TaskGraph.h"
+#include "graphics/KTX2.h"
+#include <SDL.h>
+#include <SDL_image.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static int info()
+{
+	Output(
+		"texturecompiler - Compress the textures in the data directory.\n"
+		"Each power-of-two PNG or JPEG texture gets a BC1 (opaque) or BC3 (with alpha)\n"
+		"KTX2 file beside it, which the game loads in its place where textures may be\n"
+		"compressed.\n"
+		"USAGE: texturecompiler [-f] [-j N] [dir...]\n"
+		"    -f     also convert textures whose KTX2 file is up to date\n"
+		"    -j N   convert on N threads (default: all cores)\n"
+		"    dir    directories of the data directory to convert (default: textures models)\n");
+	return 1;
+}
+
+struct TextureFile {
+	std::string path;
+	std::string output;
+
+	enum Result {
+		FAILED,
+		CONVERTED,
+		UP_TO_DATE,
+		SKIPPED
+	};
+	Result result = FAILED;
+	size_t sourceSize = 0;
+	size_t outputSize = 0;
+};
+
+static bool IsPowerOfTwo(int v)
+{
+	return v > 0 && (v & (v - 1)) == 0;
+}
+
+static void Convert(TextureFile &texture, FileSystem::FileSourceFS &dataFiles)
+{
+	RefCountedPtr<FileSystem::FileData> data = dataFiles.ReadFile(texture.path);
+	if (!data) {
+		Output("%s: could not read file\n", texture.path.c_str());
+		return;
+	}
+
+	SDLSurfacePtr loaded = SDLSurfacePtr::WrapNew(IMG_Load_RW(SDL_RWFromConstMem(data->GetData(), data->GetSize()), 1));
+	if (!loaded) {
+		Output("%s: %s\n", texture.path.c_str(), IMG_GetError());
+		return;
+	}
+
+	// textures of other sizes may be extended to a power of two when they're
+	// loaded, which can't be done to a compressed one
+	if (!IsPowerOfTwo(loaded->w) || !IsPowerOfTwo(loaded->h) || loaded->w < 4 || loaded->h < 4) {
+		texture.result = TextureFile::SKIPPED;
+		return;
+	}
+
+	SDLSurfacePtr surface = SDLSurfacePtr::WrapNew(SDL_ConvertSurfaceFormat(loaded.Get(), SDL_PIXELFORMAT_RGBA32, 0));
+	if (!surface) {
+		Output("%s: %s\n", texture.path.c_str(), SDL_GetError());
+		return;
+	}
+
+	const uint32_t width = surface->w, height = surface->h;
+	std::vector<uint8_t> rgba(size_t(width) * height * 4);
+	for (uint32_t y = 0; y < height; y++)
+		memcpy(&rgba[y * width * 4], static_cast<const uint8_t *>(surface->pixels) + y * surface->pitch, width * 4);
+
+	bool alpha = false;
+	for (size_t i = 3; i < rgba.size() && !alpha; i += 4)
+		alpha = (rgba[i] != 255);
+
+	const std::string file = Graphics::KTX2::Write(Graphics::KTX2::Compress(rgba.data(), width, height, alpha));
+
+	FILE *f = dataFiles.OpenWriteStream(texture.output);
+	if (!f) {
+		Output("%s: could not open for writing\n", texture.output.c_str());
+		return;
+	}
+	const bool written = fwrite(file.data(), 1, file.size(), f) == file.size();
+	if (fclose(f) != 0 || !written) {
+		Output("%s: write failed\n", texture.output.c_str());
+		return;
+	}
+
+	texture.result = TextureFile::CONVERTED;
+	texture.sourceSize = data->GetSize();
+	texture.outputSize = file.size();
+}
+
+extern "C" int main(int argc, char **argv)
+{
+	bool force = false;
+	Uint32 numThreads = 0;
+	std::vector<std::string> dirs;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "-f") {
+			force = true;
+		} else if (arg == "-j" && i + 1 < argc) {
+			numThreads = std::atoi(argv[++i]);
+		} else if (arg.size() > 2 && arg.compare(0, 2, "-j") == 0) {
+			numThreads = std::atoi(arg.c_str() + 2);
+		} else if (arg[0] == '-') {
+			return info();
+		} else {
+			dirs.push_back(arg);
+		}
+	}
+	if (dirs.empty())
+		dirs = { "textures", "models" };
+
+	FileSystem::Init();
+	FileSystem::FileSourceFS dataFiles(FileSystem::GetDataDir());
+
+	std::vector<TextureFile> textures;
+	for (const std::string &dir : dirs) {
+		for (FileSystem::FileEnumerator files(dataFiles, dir, FileSystem::FileEnumerator::Recurse); !files.Finished(); files.Next()) {
+			const FileSystem::FileInfo &info = files.Current();
+			const std::string &path = info.GetPath();
+			if (!info.IsFile() || !(ends_with_ci(path, ".png") || ends_with_ci(path, ".jpg") || ends_with_ci(path, ".jpeg")))
+				continue;
+
+			textures.emplace_back();
+			TextureFile &texture = textures.back();
+			texture.path = path;
+			texture.output = path.substr(0, path.find_last_of('.')) + ".ktx2";
+
+			const FileSystem::FileInfo output = dataFiles.Lookup(texture.output);
+			if (!force && output.IsFile() && output.GetModificationTime() >= info.GetModificationTime())
+				texture.result = TextureFile::UP_TO_DATE;
+		}
+	}
+
+	if (numThreads == 0)
+		numThreads = std::max(OS::GetNumCores(), 1U);
+
+	// the main thread takes part while waiting, so one fewer worker
+	TaskGraph taskGraph;
+	taskGraph.SetWorkerThreads(numThreads - 1);
+
+	TaskSet *taskSet = new TaskSet();
+	for (Uint32 i = 0; i < textures.size(); i++) {
+		if (textures[i].result == TextureFile::UP_TO_DATE)
+			continue;
+		TextureFile &texture = textures[i];
+		taskSet->AddTaskLambda({ i, i + 1 }, [&texture, &dataFiles](TaskRange) {
+			Convert(texture, dataFiles);
+		});
+	}
+
+	TaskSet::Handle handle = taskGraph.QueueTaskSet(taskSet);
+	taskGraph.WaitForTaskSet(handle);
+
+	Uint32 numResults[4] = {};
+	size_t sourceSize = 0, outputSize = 0;
+	for (const TextureFile &texture : textures) {
+		numResults[texture.result]++;
+		sourceSize += texture.sourceSize;
+		outputSize += texture.outputSize;
+	}
+
+	Output("%u converted (%.1f MB to %.1f MB), %u up to date, %u skipped as not power-of-two, %u failed\n",
+		numResults[TextureFile::CONVERTED], sourceSize / (1024.0 * 1024.0), outputSize / (1024.0 * 1024.0),
+		numResults[TextureFile::UP_TO_DATE], numResults[TextureFile::SKIPPED], numResults[TextureFile::FAILED]);
+
+	FileSystem::Uninit();
+	return numResults[TextureFile::FAILED] ? 2 : 0;
+}
@@ -222,10 +222,61 @@ namespace FileSystem {
 
 			CloseHandle(filehandle);
 
+			RecordRead(this, fullpath);
 			return RefCountedPtr<FileData>(new FileDataMalloc(MakeFileInfo(path, FileInfo::FT_FILE, modtime), size, data));
 		}
 	}
 
+	class FileDataMapped : public FileData {
+	public:
+		FileDataMapped(const FileInfo &info, size_t size, char *data) :
+			FileData(info, size, data) {}
+		virtual ~FileDataMapped() { UnmapViewOfFile(m_data); }
+	};
+
+	RefCountedPtr<FileData> FileSourceFS::MapFile(const std::string &path)
+	{
+		const std::string fullpath = JoinPathBelow(GetRoot(), path);
+		const std::wstring wfullpath = transcode_utf8_to_utf16(fullpath);
+		HANDLE filehandle = CreateFileW(wfullpath.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		if (filehandle == INVALID_HANDLE_VALUE)
+			return RefCountedPtr<FileData>(0);
+
+		const Time::DateTime modtime = file_modtime_for_handle(filehandle);
+		LARGE_INTEGER large_size;
+		void *data = nullptr;
+		if (GetFileSizeEx(filehandle, &large_size) && large_size.QuadPart > 0) {
+			HANDLE mapping = CreateFileMappingW(filehandle, 0, PAGE_READONLY, 0, 0, 0);
+			if (mapping) {
+				data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				// the view keeps the mapping alive
+				CloseHandle(mapping);
+			}
+		}
+		CloseHandle(filehandle);
+
+		// empty files can't be mapped
+		if (!data)
+			return ReadFile(path);
+
+		RecordRead(this, fullpath);
+		return RefCountedPtr<FileData>(new FileDataMapped(MakeFileInfo(path, FileInfo::FT_FILE, modtime), size_t(large_size.QuadPart), static_cast<char *>(data)));
+	}
+
+	void PrefetchFile(const std::string &fullPath)
+	{
+		// read through, so the file is in the system file cache afterwards
+		const std::wstring wfullpath = transcode_utf8_to_utf16(fullPath);
+		HANDLE filehandle = CreateFileW(wfullpath.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+		if (filehandle == INVALID_HANDLE_VALUE)
+			return;
+		char buf[65536];
+		DWORD read_size;
+		while (::ReadFile(filehandle, buf, sizeof(buf), &read_size, 0) && read_size > 0) {
+		}
+		CloseHandle(filehandle);
+	}
+
 	bool FileSourceFS::ReadDirectory(const std::string &dirpath, std::vector<FileInfo> &output)
 	{
 		size_t output_head_size = output.size();
@@ -357,4 +408,23 @@ namespace FileSystem {
 			return false;
 		return DeleteFileW(combinedPath.c_str());
 	}
+
+	bool FileSourceFS::RenameFile(const std::string &relativePath, const std::string &newRelativePath)
+	{
+		if (relativePath.empty() || newRelativePath.empty())
+			return false;
+		std::wstring combinedPath, newCombinedPath;
+		try {
+			combinedPath = transcode_utf8_to_utf16(JoinPathBelow(GetRoot(), relativePath));
+			newCombinedPath = transcode_utf8_to_utf16(JoinPathBelow(GetRoot(), newRelativePath));
+		} catch (const std::invalid_argument &) {
+			return false;
+		}
+		const DWORD fileAttributes = GetFileAttributesW(combinedPath.c_str());
+		if (file_type_for_attributes(fileAttributes) != FileSystem::FileInfo::FileType::FT_FILE)
+			return false;
+		if (!IsChildOfRoot(transcode_utf16_to_utf8(combinedPath)) || !IsChildOfRoot(transcode_utf16_to_utf8(newCombinedPath)))
+			return false;
+		return MoveFileExW(combinedPath.c_str(), newCombinedPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+	}
 } // namespace FileSystem